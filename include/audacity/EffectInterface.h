@@ -193,6 +193,9 @@ public:
    // This may be called during stack unwinding:
    virtual bool ProcessFinalize() /* noexcept */ = 0;
    virtual size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) = 0;
+   // Whether ProcessBlock and RealtimeProcess may be given the same buffers
+   // for input and output, so that the host keeps no separate output
+   virtual bool SupportsInPlace() { return false; }
 
    virtual bool RealtimeInitialize() = 0;
    virtual bool RealtimeAddProcessor(unsigned numChannels, float sampleRate) = 0;
@@ -15,6 +15,7 @@
 
 #include "stdlib.h"
 #include "string.h"
+#include "time.h"
 #include "xlisp.h"
 
 #ifdef WIN32
@@ -37,6 +38,7 @@ extern FILE *debug_input_fp;
 SEGMENT *segs,*lastseg,*fixseg,*charseg;
 int anodes,nsegs,gccalls;
 long nnodes,nfree,total;
+double gcseconds;
 LVAL fnodes;
 
 #ifdef DEBUG_MEM
@@ -310,6 +312,7 @@ void gc(void)
     char buf[STRMAX+1];
     LVAL *newfp,fun;
     extern LVAL profile_fixnum;
+    clock_t gcstart = clock();
 
     /* print the start of the gc message */
     if (s_gcflag && getvalue(s_gcflag)) {
@@ -343,8 +346,9 @@ void gc(void)
     /* sweep memory collecting all unmarked nodes */
     sweep();
 
-    /* count the gc call */
+    /* count the gc call, and its time, not counting the hook */
     ++gccalls;
+    gcseconds += (double) (clock() - gcstart) / CLOCKS_PER_SEC;
 
     /* call the *gc-hook* if necessary */
     if (s_gchook && (fun = getvalue(s_gchook))) {
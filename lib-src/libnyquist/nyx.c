@@ -55,6 +55,12 @@ extern int nsegs;
 extern SEGMENT *segs;
 extern SEGMENT *lastseg;
 extern LVAL fnodes;
+extern int gccalls;
+extern double gcseconds;
+
+/* xlsys and xlglob variables for (PROFILE) */
+extern FIXTYPE profile_flag;
+extern LVAL s_profile;
 
 /* nyquist externs */
 extern LVAL a_sound;
@@ -1167,6 +1173,65 @@ void nyx_get_label(unsigned int index,
    *label = (const char *)getstring(str_expr);
 }
 
+void nyx_get_gc_stats(long *calls, double *seconds)
+{
+   *calls = gccalls;
+   *seconds = gcseconds;
+}
+
+void nyx_set_profiling(int enable)
+{
+   LVAL array = getvalue(obarray);
+   LVAL sym;
+   int i;
+
+   // Forget the counts of earlier evaluations, which the copies of the
+   // obarray may keep on the property lists
+   for (i = 0; i < HSIZE; i++) {
+      for (sym = getelement(array, i); sym; sym = cdr(sym)) {
+         xlremprop(car(sym), s_profile);
+      }
+   }
+   setvalue(s_profile, NIL);
+
+   profile_flag = enable ? TRUE : FALSE;
+}
+
+unsigned int nyx_get_num_profile_entries()
+{
+   LVAL s;
+   unsigned int count = 0;
+
+   for (s = getvalue(s_profile); consp(s); s = cdr(s)) {
+      count++;
+   }
+
+   return count;
+}
+
+void nyx_get_profile_entry(unsigned int index,
+                           const char **name,
+                           long *count)
+{
+   LVAL s = getvalue(s_profile);
+   LVAL prop;
+
+   while (index && consp(s)) {
+      index--;
+      s = cdr(s);
+   }
+
+   if (!consp(s) || !symbolp(car(s))) {
+      *name = "";
+      *count = 0;
+      return;
+   }
+
+   *name = (const char *)getstring(getpname(car(s)));
+   prop = findprop(car(s), s_profile);
+   *count = (prop && fixp(car(prop))) ? (long)getfixnum(car(prop)) : 0;
+}
+
 const char *nyx_get_error_str()
 {
    return NULL;
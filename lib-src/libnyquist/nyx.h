@@ -89,6 +89,18 @@ extern "C"
 
    const char *nyx_get_error_str();
 
+   /* Garbage collections so far, and the processor seconds they took */
+   void        nyx_get_gc_stats(long *calls, double *seconds);
+
+   /* Starts or stops XLISP's (PROFILE) counts of the evaluations
+    * directly within each named function, clearing earlier counts.
+    * Read the counts before nyx_cleanup(). */
+   void        nyx_set_profiling(int enable);
+   unsigned int nyx_get_num_profile_entries();
+   void         nyx_get_profile_entry(unsigned int index,
+                                      const char **name,
+                                      long *count);
+
 
 
 #ifdef __cplusplus
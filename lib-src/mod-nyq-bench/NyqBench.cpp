@@ -15,6 +15,7 @@
 #include <wx/font.h>
 #include <wx/fontdlg.h>
 #include <wx/msgdlg.h>
+#include <wx/numdlg.h>
 #include <wx/settings.h>
 #include <wx/sizer.h>
 #include <wx/splitter.h>
@@ -28,6 +29,7 @@
 #include "Prefs.h"
 #include "Project.h"
 #include "ShuttleGui.h"
+#include "UndoManager.h"
 #include "effects/EffectManager.h"
 #include "effects/nyquist/Nyquist.h"
 #include "../images/AudacityLogo.xpm"
@@ -36,9 +38,11 @@
 
 #include "NyqBench.h"
 
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 #include <sstream>
+#include <vector>
 
 //
 // Images are from the Tango Icon Gallery
@@ -620,6 +624,7 @@ enum
    ID_NEXT,
 
    ID_GO,
+   ID_PROFILE,
    ID_STOP,
 
    ID_SCRIPT,
@@ -663,6 +668,7 @@ BEGIN_EVENT_TABLE(NyqBench, wxFrame)
    EVT_MENU(ID_LARGEICONS, NyqBench::OnLargeIcons)
 
    EVT_MENU(ID_GO, NyqBench::OnGo)
+   EVT_MENU(ID_PROFILE, NyqBench::OnProfile)
    EVT_MENU(ID_STOP, NyqBench::OnStop)
 
    EVT_MENU(wxID_ABOUT, NyqBench::OnAbout)
@@ -692,6 +698,7 @@ BEGIN_EVENT_TABLE(NyqBench, wxFrame)
    EVT_UPDATE_UI(ID_TOGGLEOUTPUT, NyqBench::OnViewUpdate)
 
    EVT_UPDATE_UI(ID_GO, NyqBench::OnRunUpdate)
+   EVT_UPDATE_UI(ID_PROFILE, NyqBench::OnRunUpdate)
 
    EVT_UPDATE_UI(ID_SCRIPT, NyqBench::OnScriptUpdate)
    EVT_UPDATE_UI(ID_OUTPUT, NyqBench::OnOutputUpdate)
@@ -793,6 +800,7 @@ NyqBench::NyqBench(wxWindow * parent)
 
    menu = new wxMenu();
    menu->Append(ID_GO, _("&Go\tF5"));
+   menu->Append(ID_PROFILE, _("&Profile...\tShift+F5"));
    menu->Append(ID_STOP, _("&Stop\tF6"));
    bar->Append(menu, wxT("&Run"));
 
@@ -1413,6 +1421,102 @@ void NyqBench::OnGo(wxCommandEvent & e)
    EffectManager::Get().UnregisterEffect(ID);
 }
 
+void NyqBench::OnProfile(wxCommandEvent & e)
+{
+   AudacityProject *p = GetActiveProject();
+   wxASSERT(p != NULL);
+   if (!p) {
+      return;
+   }
+
+   long runs = wxGetNumberFromUser(_("Run the script on the selection this many times,\nundoing each run, and report the time it took."),
+                                   _("Runs:"),
+                                   _("Profile"),
+                                   gPrefs->Read(wxT("NyqBench/Profile/Runs"), 10L),
+                                   1, 1000,
+                                   this);
+   if (runs < 1) {
+      return;
+   }
+   gPrefs->Write(wxT("NyqBench/Profile/Runs"), runs);
+   gPrefs->Flush();
+
+   // No need to delete...EffectManager will do it
+   mEffect = new NyquistEffect(wxT("Nyquist Effect Workbench"));
+   const PluginID & ID = EffectManager::Get().RegisterEffect(mEffect);
+
+   mEffect->SetCommand(mScript->GetValue());
+   mEffect->RedirectOutput();
+   mEffect->EnableProfiling();
+
+   // Each run starts from the same selection
+   UndoManager *undo = p->GetUndoManager();
+   const unsigned int start = undo->GetCurrentState();
+
+   long done = 0;
+   {
+      wxWindowDisabler disable(this);
+      NyqRedirector redir((NyqTextCtrl *)mOutput);
+
+      mRunning = true;
+      UpdateWindowUI();
+
+      for (; done < runs && mRunning; done++) {
+         // Only the first run may ask for the values of the controls
+         int flags = OnEffectFlags::kDontRepeatLast;
+         if (done > 0) {
+            flags |= OnEffectFlags::kConfigured;
+         }
+         if (!p->DoEffect(ID, CommandContext(*p), flags)) {
+            break;
+         }
+         if (undo->GetCurrentState() != start) {
+            p->SetStateTo(start);
+         }
+      }
+
+      mRunning = false;
+      UpdateWindowUI();
+   }
+
+   const NyquistEffect::Profile &profile = mEffect->GetProfile();
+
+   wxString report;
+   report += wxString::Format(_("\nProfile of %ld runs, %u evaluations:\n"),
+                              done, profile.runs);
+   if (profile.seconds > 0) {
+      report += wxString::Format(_("  %.3f s in all, %.3f s each run, %.0f samples per second\n"),
+                                 profile.seconds,
+                                 done > 0 ? profile.seconds / done : 0.0,
+                                 profile.samples / profile.seconds);
+      report += wxString::Format(_("  Garbage collection: %ld times, %.3f s of processor time (%.1f%%)\n"),
+                                 profile.gcCalls,
+                                 profile.gcSeconds,
+                                 100.0 * profile.gcSeconds / profile.seconds);
+   }
+
+   // The most evaluated functions first.  The counts are of Lisp
+   // evaluations; the time in the unit generators shows only in the total.
+   std::vector< std::pair<long, wxString> > counts;
+   for (const auto &entry : profile.evaluations) {
+      counts.push_back(std::make_pair(entry.second, entry.first));
+   }
+   std::sort(counts.rbegin(), counts.rend());
+   const size_t shown = std::min<size_t>(counts.size(), 30);
+   if (shown > 0) {
+      report += _("  Evaluations directly within each function:\n");
+   }
+   for (size_t i = 0; i < shown; i++) {
+      report += wxString::Format(wxT("    %10ld  %s\n"),
+                                 counts[i].first, counts[i].second);
+   }
+   mOutput->AppendText(report);
+
+   Raise();
+
+   EffectManager::Get().UnregisterEffect(ID);
+}
+
 void NyqBench::OnStop(wxCommandEvent & e)
 {
    mRunning = false;
@@ -1590,6 +1694,7 @@ void NyqBench::OnRunUpdate(wxUpdateUIEvent & e)
 
    if (p && gAudioIO->IsBusy()) {
       mbar->Enable(ID_GO, false);
+      mbar->Enable(ID_PROFILE, false);
       mbar->Enable(ID_STOP, false);
 
       tbar->EnableTool(ID_GO, false);
@@ -1597,6 +1702,7 @@ void NyqBench::OnRunUpdate(wxUpdateUIEvent & e)
    }
    else {
       mbar->Enable(ID_GO, (mScript->GetLastPosition() > 0) && !mRunning);
+      mbar->Enable(ID_PROFILE, (mScript->GetLastPosition() > 0) && !mRunning);
       mbar->Enable(ID_STOP, (mScript->GetLastPosition() > 0) && mRunning);
 
       tbar->EnableTool(ID_GO, (mScript->GetLastPosition() > 0) && !mRunning);
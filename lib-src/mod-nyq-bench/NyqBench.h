@@ -154,6 +154,7 @@ class NyqBench:public wxFrame
    void OnLargeIcons(wxCommandEvent & e);
 
    void OnGo(wxCommandEvent & e);
+   void OnProfile(wxCommandEvent & e);
    void OnStop(wxCommandEvent & e);
 
    void OnAbout(wxCommandEvent & e);
@@ -1,3 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+// Besides one command per line, each answered by lines ending with an empty
+// one, a script may send a frame:  a line "@<length>" and then that many
+// bytes of UTF-8, holding any number of commands, one per line.  The reply
+// is one frame holding all of their responses, so that a batch takes one
+// round trip and needs no scanning for its end.
+
+extern std::string DoSrvBatch( const std::string &request );
+
+// Whether line is the header of a frame, and if so, the length that follows
+static bool IsFrameHeader( const std::string &line, size_t &length )
+{
+   if( line.size() < 2 || line[0] != '@' )
+      return false;
+   const char *digits = line.c_str() + 1;
+   char *end = NULL;
+   const unsigned long long value = strtoull( digits, &end, 10 );
+   if( end == digits || ( *end != '\0' && *end != '\r' ) )
+      return false;
+   length = (size_t)value;
+   return true;
+}
+
+static std::string FrameHeader( size_t length )
+{
+   char header[32];
+   sprintf( header, "@%llu\n", (unsigned long long)length );
+   return header;
+}
+
+
 #if defined(WIN32)
 
 #define WIN32_LEAN_AND_MEAN  // Exclude rarely-used stuff from Windows headers
@@ -49,6 +83,7 @@ void PipeServer()
    DWORD cbBytesWritten;
    CHAR chRequest[ nBuff ];
    CHAR chResponse[ nBuff ];
+   std::string request;
 
    int jj=0;
 
@@ -70,16 +105,47 @@ void PipeServer()
          for(;;)
          {
             printf( "About to read\n" );
-            bSuccess = ReadFile( hPipeToSrv, chRequest, nBuff, &cbBytesRead, NULL);
+            // A message may be longer than the buffer
+            request.clear();
+            do {
+               bSuccess = ReadFile( hPipeToSrv, chRequest, nBuff, &cbBytesRead, NULL);
+               request.append( chRequest, cbBytesRead );
+            } while( !bSuccess && GetLastError() == ERROR_MORE_DATA );
+
+            if( !bSuccess || request.empty() )
+               break;
+
+            size_t length;
+            const size_t headerEnd = request.find( '\n' );
+            if( IsFrameHeader( request.substr( 0, headerEnd ), length ) )
+            {
+               // The body may be in the same message or in later ones
+               std::string body;
+               if( headerEnd != std::string::npos )
+                  body = request.substr( headerEnd + 1 );
+               while( body.size() < length )
+               {
+                  bSuccess = ReadFile( hPipeToSrv, chRequest, nBuff, &cbBytesRead, NULL);
+                  if( !bSuccess && GetLastError() != ERROR_MORE_DATA )
+                     break;
+                  body.append( chRequest, cbBytesRead );
+               }
+               if( body.size() < length )
+                  break;
+               body.resize( length );
 
-            chRequest[ cbBytesRead] = '\0'; 
+               printf( "Rxd frame of %lu bytes\n", (unsigned long)length );
 
-            if( !bSuccess || cbBytesRead==0 )
-               break;
+               const std::string response = DoSrvBatch( body );
+               const std::string reply = FrameHeader( response.size() ) + response;
+               WriteFile( hPipeFromSrv, reply.data(), (DWORD)reply.size(), &cbBytesWritten, NULL);
+               jj++;
+               continue;
+            }
 
-            printf( "Rxd %s\n", chRequest );
+            printf( "Rxd %s\n", request.c_str() );
 
-            DoSrv( chRequest );
+            DoSrv( &request[0] );
             jj++;
             while( true )
             {
@@ -110,7 +176,6 @@ void PipeServer()
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <stdio.h>
 #include <unistd.h>
 #include <string.h>
 
@@ -121,6 +186,23 @@ const int nBuff = 1024;
 extern "C" int DoSrv( char * pIn );
 extern "C" int DoSrvMore( char * pOut, int nMax );
 
+// Read a line of any length, without its newline
+static bool ReadLine( FILE *file, std::string &line )
+{
+   char buf[nBuff];
+   line.clear();
+   while (fgets(buf, sizeof(buf), file) != NULL)
+   {
+      line += buf;
+      if (line[line.size() - 1] == '\n')
+      {
+         line.erase(line.size() - 1);
+         return true;
+      }
+   }
+   return !line.empty();
+}
+
 void PipeServer()
 {
    FILE *fromFifo = NULL;
@@ -164,19 +246,36 @@ void PipeServer()
       return;
    }
 
-   while (fgets(buf, sizeof(buf), toFifo) != NULL)
+   std::string line;
+   while (ReadLine(toFifo, line))
    {
-      int len = strlen(buf);
-      if (len <= 1)
+      size_t length;
+      if (IsFrameHeader(line, length))
       {
+         std::string request(length, '\0');
+         if (length > 0 && fread(&request[0], 1, length, toFifo) != length)
+         {
+            break;
+         }
+
+         printf("Server received frame of %lu bytes\n", (unsigned long)length);
+         const std::string response = DoSrvBatch(request);
+         const std::string header = FrameHeader(response.size());
+         fwrite(header.data(), 1, header.size(), fromFifo);
+         fwrite(response.data(), 1, response.size(), fromFifo);
+         fflush(fromFifo);
          continue;
       }
 
-      buf[len - 1] = '\0';
+      if (line.empty())
+      {
+         continue;
+      }
 
-      printf("Server received %s\n", buf);
-      DoSrv(buf);
+      printf("Server received %s\n", line.c_str());
+      DoSrv(&line[0]);
 
+      int len;
       while (true)
       {
          len = DoSrvMore(buf, nBuff);
@@ -13,6 +13,7 @@
 // Enabling other programs to connect to Audacity via a pipe is a potential 
 // security risk.  Use at your own risk.
 
+#include <string>
 #include <wx/wx.h>
 #include "ScripterCallback.h"
 //#include "../lib_widget_extra/ShuttleGuiBase.h"
@@ -232,3 +233,17 @@ int DoSrvMore(char *pOut, size_t nMax)
 }
 
 } // End extern "C"
+
+// Send a whole batch of commands, one per line, to Audacity and return all
+// of their responses at once.  Unlike DoSrv(), this is for the framed
+// protocol, so both are UTF-8 and may be of any length.
+std::string DoSrvBatch(const std::string &request)
+{
+   wxString in(request.data(), wxConvUTF8, request.size());
+   in.Replace( wxT("\r"), wxT(""));
+   wxString out;
+   (*pScriptServerFn)( &in, &out);
+
+   const wxScopedCharBuffer utf8 = out.utf8_str();
+   return std::string(utf8.data(), utf8.length());
+}
@@ -3441,6 +3441,30 @@ void Alg_iterator::begin_seq(Alg_seq_ptr s, void *cookie, double offset)
 }
 
 
+void Alg_iterator::begin_seq_at(Alg_seq_ptr s, double start_time,
+                                void *cookie, double offset)
+{
+    int i;
+    for (i = 0; i < s->track_list.length(); i++) {
+        Alg_track &track = s->track_list[i];
+        // find the first event not before start_time
+        long low = 0;
+        long high = track.length();
+        while (low < high) {
+            long mid = (low + high) / 2;
+            if (track[mid]->time < start_time) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low < track.length()) {
+            insert(&track, low, true, cookie, offset);
+        }
+    }
+}
+
+
 Alg_event_ptr Alg_iterator::next(bool *note_on, void **cookie_ptr, 
                                  double *offset_ptr, double end_time)
     // return the next event in time from any track
@@ -968,6 +968,10 @@ public:
     // sequence to be included in the iteration unless you call begin()
     // (see below).
     void begin_seq(Alg_seq_ptr s, void *cookie = NULL, double offset = 0.0);
+    // Like begin_seq(), but skips the events of each track before
+    // start_time (not counting offset), found by binary search
+    void begin_seq_at(Alg_seq_ptr s, double start_time, void *cookie = NULL,
+                      double offset = 0.0);
     ~Alg_iterator();
     // Prepare to enumerate events in order. If note_off_flag is true, then
     // iteration_next will merge note-off events into the sequence. If you
@@ -1,6 +1,6 @@
 dnl Please increment the serial number below whenever you alter this macro
 dnl for the benefit of automatic macro update systems
-# audacity_checklib_libsbsms.m4 serial 2
+# audacity_checklib_libsbsms.m4 serial 3
 
 
 AC_DEFUN([AUDACITY_CHECKLIB_LIBSBSMS], [
@@ -30,8 +30,8 @@ AC_DEFUN([AUDACITY_CHECKLIB_LIBSBSMS], [
                  LIBSBSMS_LOCAL_AVAILABLE="no")
 
    if test "$LIBSBSMS_LOCAL_AVAILABLE" = "yes"; then
-      dnl do not build programs we don't need
-      LIBSBSMS_LOCAL_CONFIGURE_ARGS="--disable-programs"
+      dnl do not build programs we don't need, and thread the analysis
+      LIBSBSMS_LOCAL_CONFIGURE_ARGS="--disable-programs --enable-multithreaded"
       AC_MSG_NOTICE([libsbsms libraries are available in the local tree])
    else
       AC_MSG_NOTICE([libsbsms libraries are NOT available in the local tree])
@@ -42,7 +42,7 @@ AC_DEFUN([AUDACITY_CHECKLIB_LIBSBSMS], [
 AC_DEFUN([AUDACITY_CONFIG_LIBSBSMS], [
    if test "$LIBSBSMS_USE_LOCAL" = yes; then
       SBSMS_CFLAGS='-I$(top_srcdir)/lib-src/sbsms/include'
-      SBSMS_LIBS='$(top_builddir)/lib-src/sbsms/src/.libs/libsbsms.a'
+      SBSMS_LIBS='$(top_builddir)/lib-src/sbsms/src/.libs/libsbsms.a -lpthread'
       AC_CONFIG_SUBDIRS([lib-src/sbsms])
    fi
 
@@ -45,7 +45,7 @@
 #define LT_OBJDIR ".libs/"
 
 /* Define to compile multithreaded sbsms */
-/* #undef MULTITHREADED */
+#define MULTITHREADED 1
 
 /* Name of package */
 #define PACKAGE "sbsms"
@@ -426,6 +426,7 @@ void AColor::Solo(wxDC * dc, bool on, bool selected)
 }
 
 bool AColor::gradient_inited = 0;
+unsigned AColor::gradient_version = 0;
 
 void AColor::ReInit()
 {
@@ -625,6 +626,7 @@ void AColor::PreComputeGradient() {
    {
       if (!gradient_inited) {
          gradient_inited = 1;
+         ++gradient_version;
 
          for (int selected = 0; selected < ColorGradientTotal; selected++)
             for (int grayscale = 0; grayscale <= 1; grayscale++) {
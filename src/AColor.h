@@ -140,6 +140,8 @@ class AColor {
    static wxBrush tooltipBrush;
 
    static bool gradient_inited;
+   // Incremented whenever gradient_pre is computed again
+   static unsigned gradient_version;
    static const int gradientSteps = 512;
    static unsigned char gradient_pre[ColorGradientTotal][2][gradientSteps][3];
 
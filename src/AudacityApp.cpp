@@ -65,6 +65,7 @@ It handles initialization and termination by subclassing wxApp.
 #include "AColor.h"
 #include "AudioIO.h"
 #include "Benchmark.h"
+#include "DeferredDeleter.h"
 #include "DirManager.h"
 #include "commands/CommandHandler.h"
 #include "commands/AppCommandEvent.h"
@@ -77,7 +78,9 @@ It handles initialization and termination by subclassing wxApp.
 #include "Languages.h"
 #include "PluginManager.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Project.h"
+#include "Resample.h"
 #include "Screenshot.h"
 #include "Sequence.h"
 #include "WaveTrack.h"
@@ -88,6 +91,7 @@ It handles initialization and termination by subclassing wxApp.
 #include "AutoRecovery.h"
 #include "SplashDialog.h"
 #include "FFT.h"
+#include "HeadlessBatch.h"
 #include "BlockFile.h"
 #include "ondemand/ODManager.h"
 #include "commands/Keyboard.h"
@@ -96,7 +100,6 @@ It handles initialization and termination by subclassing wxApp.
 #include "tracks/ui/Scrubbing.h"
 
 //temporarilly commented out till it is added to all projects
-//#include "Profiler.h"
 
 #include "ModuleManager.h"
 
@@ -320,10 +323,6 @@ void QuitAudacity(bool bForce)
    //release ODManager Threads
    ODManager::Quit();
 
-   //print out profile if we have one by deleting it
-   //temporarilly commented out till it is added to all projects
-   //DELETE Profiler::Instance();
-
    //remove our logger
    std::unique_ptr<wxLog>{ wxLog::SetActiveTarget(NULL) }; // DELETE
 
@@ -1244,6 +1243,13 @@ bool AudacityApp::OnInit()
    // Ensure we have an event loop during initialization
    wxEventLoopGuarantor eventLoop;
 
+   // Setting AUDACITY_STARTUP_TRACE to a file name records the phases of
+   // startup, and writes them there once the first window is up
+   const wxString startupTrace = wxGetenv(wxT("AUDACITY_STARTUP_TRACE"));
+   const auto startupBegin = Profiler::Get().Now();
+   if (!startupTrace.empty())
+      Profiler::Get().SetRecording(true);
+
    // wxWidgets will clean up the logger for the main thread, so we can say
    // safenew.  See:
    // http://docs.wxwidgets.org/3.0/classwx_log.html#a2525bf54fa3f31dc50e6e3cd8651e71d
@@ -1404,8 +1410,17 @@ bool AudacityApp::OnInit()
    }
 #endif
 
+   // Not needing preferences, device enumeration can begin soonest
+   StartAudioIOInitialization();
+
    // Initialize preferences and language
-   InitPreferences();
+   {
+      PROFILE_SCOPE("Startup::Preferences");
+      InitPreferences();
+   }
+
+   // Decode the theme's images while modules and plug-ins are found
+   theTheme.PrefetchPreferredTheme();
 
 #if defined(__WXMSW__) && !defined(__WXUNIVERSAL__) && !defined(__CYGWIN__)
    this->AssociateFileTypes();
@@ -1415,14 +1430,14 @@ bool AudacityApp::OnInit()
    mRecentFiles = std::make_unique<FileHistory>(ID_RECENT_LAST - ID_RECENT_FIRST + 1, ID_RECENT_CLEAR);
    mRecentFiles->Load(*gPrefs, wxT("RecentFiles"));
 
-   theTheme.EnsureInitialised();
-
-   // AColor depends on theTheme.
-   AColor::Init();
-
    // Init DirManager, which initializes the temp directory
    // If this fails, we must exit the program.
-   if (!InitTempDir()) {
+   bool tempDirOk;
+   {
+      PROFILE_SCOPE("Startup::TempDir");
+      tempDirOk = InitTempDir();
+   }
+   if (!tempDirOk) {
       FinishPreferences();
       return false;
    }
@@ -1436,10 +1451,26 @@ bool AudacityApp::OnInit()
    InitCommandHandler();
 
    // Initialize the PluginManager
-   PluginManager::Get().Initialize();
+   {
+      PROFILE_SCOPE("Startup::PluginManager");
+      PluginManager::Get().Initialize();
+   }
 
    // Initialize the ModuleManager, including loading found modules
-   ModuleManager::Get().Initialize(*mCmdHandler);
+   {
+      PROFILE_SCOPE("Startup::ModuleManager");
+      ModuleManager::Get().Initialize(*mCmdHandler);
+   }
+
+   // The theme is wanted from here on, for the splash screen.  Anything
+   // before that uses it initialises it on demand.
+   {
+      PROFILE_SCOPE("Startup::Theme");
+      theTheme.EnsureInitialised();
+
+      // AColor depends on theTheme.
+      AColor::Init();
+   }
 
    // Parse command line and handle options that might require
    // immediate exit...no need to initialize all of the audio
@@ -1484,6 +1515,9 @@ bool AudacityApp::OnInit()
       exit(1);
    }
 
+   // A batch on the command line shows no project, and talks to no devices
+   const bool batchMode = parser->Found(wxT("macro"));
+
    // BG: Create a temporary window to set as the top window
    wxImage logoimage((const char **)AudacityLogoWithName_xpm);
    logoimage.Rescale(logoimage.GetWidth() / 2, logoimage.GetHeight() / 2);
@@ -1530,7 +1564,9 @@ bool AudacityApp::OnInit()
 
       // More initialization
 
+      PROFILE_SCOPE("Startup::AudioIO");
       InitDitherers();
+      Resample::UpdateMethods();
       InitAudioIO();
 
 #ifdef __WXMAC__
@@ -1574,7 +1610,8 @@ bool AudacityApp::OnInit()
    // Root cause is problem with wxSplashScreen and other dialogs co-existing, that
    // seemed to arrive with wx3.
    {
-      project = CreateNewAudacityProject();
+      PROFILE_SCOPE("Startup::Project");
+      project = CreateNewAudacityProject(!batchMode);
       mCmdHandler->SetProject(project);
       wxWindow * pWnd = MakeHijackPanel();
       if (pWnd)
@@ -1586,7 +1623,7 @@ bool AudacityApp::OnInit()
       }
    }
 
-   if( project->mShowSplashScreen ){
+   if( project->mShowSplashScreen && !batchMode ){
       // This may do a check-for-updates at every start up.
       // Mainly this is to tell users of ALPHAS who don't know that they have an ALPHA.
       // Disabled for now, after discussion.
@@ -1599,16 +1636,58 @@ bool AudacityApp::OnInit()
    // Monitoring stops again after any
    // PLAY or RECORD completes.
    // So we also call StartMonitoring when STOP is called.
-   project->MayStartMonitoring();
+   if (!batchMode)
+      project->MayStartMonitoring();
 
    #ifdef USE_FFMPEG
-   FFmpegStartup();
+   {
+      PROFILE_SCOPE("Startup::FFmpeg");
+      FFmpegStartup();
+   }
    #endif
 
    Importer::Get().Initialize();
 
    // Bug1561: delay the recovery dialog, to avoid crashes.
    CallAfter( [=] () mutable {
+      if (!startupTrace.empty()) {
+         auto &profiler = Profiler::Get();
+         profiler.Record("Startup", startupBegin, profiler.Now());
+         profiler.SetRecording(false);
+         if (!profiler.WriteTrace(startupTrace))
+            wxLogMessage(wxT("Could not write the startup trace to %s"),
+               startupTrace);
+      }
+
+      wxString macro;
+      if (parser->Found(wxT("macro"), &macro))
+      {
+         wxArrayString files;
+         for (size_t i = 0, cnt = parser->GetParamCount(); i < cnt; i++)
+            files.Add(parser->GetParam(i));
+         // On the Mac, the file names arrive as AppleEvents instead
+         WX_APPEND_ARRAY(files, ofqueue);
+         ofqueue.Clear();
+
+         wxString workerTempDir;
+         long jobs = 1;
+         if (parser->Found(wxT("batch-worker"), &workerTempDir))
+            RunMacroOnFilesAsWorker(project, macro, files, workerTempDir);
+         else if (HaveFilesToRecover())
+         {
+            // Leave them for an interactive session to recover
+            wxPrintf(_("Projects were not closed; start Audacity without --macro to recover them\n"));
+            DirManager::SetDontDeleteTempFiles();
+         }
+         else
+         {
+            parser->Found(wxT("jobs"), &jobs);
+            RunMacroOnFiles(project, macro, files, jobs);
+         }
+         QuitAudacity(true);
+         return;
+      }
+
       //
       // Auto-recovery
       //
@@ -1631,6 +1710,14 @@ bool AudacityApp::OnInit()
             QuitAudacity(true);
          }
 
+         wxString benchmarkFile;
+         if (parser->Found(wxT("benchmark"), &benchmarkFile))
+         {
+            if (!RunBenchmarkSuite(project, benchmarkFile))
+               wxPrintf(_("Some benchmarks failed; see %s\n"), benchmarkFile);
+            QuitAudacity(true);
+         }
+
          // As of wx3, there's no need to process the filename arguments as they
          // will be sent view the MacOpenFile() method.
 #if !defined(__WXMAC__)
@@ -1646,6 +1733,10 @@ bool AudacityApp::OnInit()
 
    gInited = true;
 
+   // Now that the window is up, and recovery has had its chance at the
+   // temporary files, remove those that earlier sessions left to be deleted
+   DeferredDeleter::Get().Start(DirManager::GetTempDir());
+
    ModuleManager::Get().Dispatch(AppInitialized);
 
    mWindowRectAlreadySaved = FALSE;
@@ -1740,6 +1831,19 @@ void SetToExtantDirectory( wxString & result, const wxString & dir ){
 
 bool AudacityApp::InitTempDir()
 {
+   // A worker process of a batch uses the directory that its parent made for
+   // it, and takes no part in the single instance check
+   const wxString workerOption = wxT("--batch-worker=");
+   for (int i = 1; i < argc; i++)
+   {
+      const wxString arg = argv[i];
+      if (arg.StartsWith(workerOption))
+      {
+         DirManager::SetTempDir(arg.Mid(workerOption.length()));
+         return true;
+      }
+   }
+
    // We need to find a temp directory location.
 
    wxString tempFromPrefs = gPrefs->Read(wxT("/Directories/TempDir"), wxT(""));
@@ -2036,9 +2140,31 @@ std::unique_ptr<wxCmdLineParser> AudacityApp::ParseCommandLine()
    /*i18n-hint: This runs a set of automatic tests on Audacity itself */
    parser->AddSwitch(wxT("t"), wxT("test"), _("run self diagnostics"));
 
+   /*i18n-hint: This times parts of Audacity, without showing dialogs, and
+    *           writes the results to a file */
+   parser->AddOption(wxEmptyString, wxT("benchmark"),
+                     _("run the benchmark suite and write the results to a file"),
+                     wxCMD_LINE_VAL_STRING);
+
    /*i18n-hint: This displays the Audacity version */
    parser->AddSwitch(wxT("v"), wxT("version"), _("display Audacity version"));
 
+   /*i18n-hint: This applies a macro to each of the files named on the
+    *           command line, without showing a window, then quits */
+   parser->AddOption(wxEmptyString, wxT("macro"),
+                     _("apply a macro to each file, without showing the project, and quit"),
+                     wxCMD_LINE_VAL_STRING);
+
+   /*i18n-hint: This is how many copies of Audacity share the files given
+    *           with --macro */
+   parser->AddOption(wxEmptyString, wxT("jobs"),
+                     _("number of processes to share the files of --macro"),
+                     wxCMD_LINE_VAL_NUMBER);
+
+   // Given by a batch to the processes it starts, with their temp directory
+   parser->AddOption(wxEmptyString, wxT("batch-worker"), wxEmptyString,
+                     wxCMD_LINE_VAL_STRING, wxCMD_LINE_HIDDEN);
+
    /*i18n-hint: This is a list of one or more files that Audacity
     *           should open upon startup */
    parser->AddParam(_("audio or project file name"),
@@ -49,47 +49,128 @@ enum
    LoggerID_Close
 };
 
+namespace {
+   // Lines queued by other threads before the main thread takes them; a
+   // power of two
+   const size_t QueueCapacity = 4096;
+
+   // Older text is discarded when the log grows past this
+   const size_t MaxBufferLength = 4 * 1024 * 1024;
+}
+
 AudacityLogger::AudacityLogger()
 :  wxEvtHandler(),
-   wxLog()
+   wxLog(),
+   mRecords{ QueueCapacity }
 {
+   for (size_t ii = 0; ii < QueueCapacity; ++ii)
+      mRecords[ii].sequence.store(ii, std::memory_order_relaxed);
    mText = NULL;
+   mShown = wxString::npos;
    mUpdated = false;
 }
 
-void AudacityLogger::Flush()
+bool AudacityLogger::Enqueue(const wxString & str)
 {
-   if (mUpdated && mFrame && mFrame->IsShown()) {
-      mUpdated = false;
-      mText->ChangeValue(mBuffer);
+   // A slot whose sequence equals the position is free for that position;
+   // claim the position, fill the slot, then publish it
+   auto pos = mEnqueuePos.load(std::memory_order_relaxed);
+   Record *record;
+   while (true) {
+      record = &mRecords[pos & (QueueCapacity - 1)];
+      const auto sequence = record->sequence.load(std::memory_order_acquire);
+      if (sequence == pos) {
+         if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+               std::memory_order_relaxed))
+            break;
+      }
+      else if (sequence < pos) {
+         // Full; the consumer has not freed this slot yet
+         mDropped.fetch_add(1, std::memory_order_relaxed);
+         return false;
+      }
+      else
+         pos = mEnqueuePos.load(std::memory_order_relaxed);
    }
+   record->text = str;
+   record->sequence.store(pos + 1, std::memory_order_release);
+   return true;
 }
 
-void AudacityLogger::DoLogText(const wxString & str)
+bool AudacityLogger::Dequeue(wxString & str)
 {
-   if (!wxIsMainThread()) {
-      wxMutexGuiEnter();
-   }
+   auto &record = mRecords[mDequeuePos & (QueueCapacity - 1)];
+   if (record.sequence.load(std::memory_order_acquire) != mDequeuePos + 1)
+      return false;
+   str.clear();
+   str.swap(record.text);
+   record.sequence.store(mDequeuePos + QueueCapacity,
+      std::memory_order_release);
+   ++mDequeuePos;
+   return true;
+}
+
+void AudacityLogger::DrainRecords()
+{
+   wxString str;
+   while (Dequeue(str)) {
+      if (mBuffer.IsEmpty()) {
+         wxString stamp;
+
+         TimeStamp(&stamp);
 
-   if (mBuffer.IsEmpty()) {
-      wxString stamp;
+         mBuffer << stamp << _TS("Audacity ") << AUDACITY_VERSION_STRING << wxT("\n");
+      }
 
-      TimeStamp(&stamp);
+      mBuffer << str << wxT("\n");
 
-      mBuffer << stamp << _TS("Audacity ") << AUDACITY_VERSION_STRING << wxT("\n");
+      mUpdated = true;
    }
 
-   mBuffer << str << wxT("\n");
+   if (const auto dropped = mDropped.exchange(0, std::memory_order_relaxed)) {
+      mBuffer << wxString::Format(wxT("(%llu log messages were lost)\n"),
+         dropped);
+      mUpdated = true;
+   }
 
-   mUpdated = true;
+   if (mBuffer.length() > MaxBufferLength) {
+      // Keep the newest three quarters, from the start of a line
+      auto start = mBuffer.find(wxT('\n'), mBuffer.length() - MaxBufferLength * 3 / 4);
+      mBuffer.erase(0, start == wxString::npos ? mBuffer.length() : start + 1);
+      mShown = wxString::npos;
+   }
+}
 
-   Flush();
+void AudacityLogger::Flush()
+{
+   // Formatting and display are left to the main thread
+   if (!wxIsMainThread())
+      return;
 
-   if (!wxIsMainThread()) {
-      wxMutexGuiLeave();
+   DrainRecords();
+
+   if (mUpdated && mFrame && mFrame->IsShown()) {
+      mUpdated = false;
+      if (mShown <= mBuffer.length())
+         mText->AppendText(mBuffer.Mid(mShown));
+      else
+         mText->ChangeValue(mBuffer);
+      mShown = mBuffer.length();
    }
 }
 
+void AudacityLogger::DoLogText(const wxString & str)
+{
+   // Other threads only queue the line, without waiting for the main
+   // thread, which takes it when it next flushes the log
+   Enqueue(str);
+
+   if (wxIsMainThread())
+      // Take the lines at once, so that they are not dropped when the main
+      // thread logs much before it is idle
+      DrainRecords();
+}
+
 void AudacityLogger::Show(bool show)
 {
    // Hide the frame if created, otherwise do nothing
@@ -103,7 +184,9 @@ void AudacityLogger::Show(bool show)
    // If the frame already exists, refresh its contents and show it
    if (mFrame) {
       if (!mFrame->IsShown()) {
+         DrainRecords();
          mText->ChangeValue(mBuffer);
+         mShown = mBuffer.length();
          mText->SetInsertionPointEnd();
          mText->ShowPosition(mText->GetLastPosition());
       }
@@ -142,7 +225,9 @@ void AudacityLogger::Show(bool show)
       S.StartVerticalLay(true);
       {
          S.SetStyle(wxTE_MULTILINE | wxHSCROLL | wxTE_READONLY);
+         DrainRecords();
          mText = S.AddTextWindow(mBuffer);
+         mShown = mBuffer.length();
 
          S.AddSpace(0, 5);
          S.StartHorizontalLay(wxALIGN_CENTER, 0);
@@ -199,6 +284,8 @@ void AudacityLogger::Show(bool show)
 #if defined(EXPERIMENTAL_CRASH_REPORT)
 wxString AudacityLogger::GetLog()
 {
+   if (wxIsMainThread())
+      DrainRecords();
    return mBuffer;
 }
 #endif
@@ -224,7 +311,9 @@ void AudacityLogger::OnClose(wxCommandEvent & WXUNUSED(e))
 void AudacityLogger::OnClear(wxCommandEvent & WXUNUSED(e))
 {
    mBuffer = wxEmptyString;
+   mShown = wxString::npos;
    DoLogText(wxT("Log Cleared."));
+   Flush();
 }
 
 void AudacityLogger::OnSave(wxCommandEvent & WXUNUSED(e))
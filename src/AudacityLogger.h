@@ -17,6 +17,7 @@
 #include "Audacity.h"
 
 #include "MemoryX.h"
+#include <atomic>
 #include <wx/event.h>
 #include <wx/log.h>
 #include <wx/frame.h>
@@ -45,9 +46,28 @@ class AudacityLogger final : public wxEvtHandler, public wxLog {
    void OnClear(wxCommandEvent & e);
    void OnSave(wxCommandEvent & e);
 
+   // Bounded queue of lines logged, for many producers and the main thread
+   // as the one consumer.  A producer never waits:  when the queue is full,
+   // the line is dropped and counted.
+   bool Enqueue(const wxString & str);
+   bool Dequeue(wxString & str);
+   // Move queued lines into mBuffer, and keep that bounded; main thread only
+   void DrainRecords();
+
+   struct Record {
+      std::atomic<size_t> sequence;
+      wxString text;
+   };
+   ArrayOf<Record> mRecords;
+   std::atomic<size_t> mEnqueuePos{ 0 };
+   size_t mDequeuePos{ 0 };
+   std::atomic<unsigned long long> mDropped{ 0 };
+
    Destroy_ptr<wxFrame> mFrame;
    wxTextCtrl *mText;
    wxString mBuffer;
+   // How much of mBuffer mText shows, or npos if it must be replaced
+   size_t mShown;
    bool mUpdated;
 };
 
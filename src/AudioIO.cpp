@@ -413,6 +413,10 @@ TimeTrack and AudioIOListener and whether the playback is looped.
 #include <math.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <chrono>
+#include <future>
+#include <limits>
+#include <new>
 
 #ifdef __WXMSW__
 #include <malloc.h>
@@ -436,12 +440,18 @@ TimeTrack and AudioIOListener and whether the playback is looped.
 
 #include "AudacityApp.h"
 #include "AudacityException.h"
+#include "BlockPrefetchQueue.h"
+#include "BlockReadBatch.h"
+#include "DeviceManager.h"
 #include "Mix.h"
 #include "MixerBoard.h"
 #include "Resample.h"
+#include "Profiler.h"
 #include "RingBuffer.h"
+#include "TaskScheduler.h"
 #include "prefs/GUISettings.h"
 #include "Prefs.h"
+#include "PrefsSnapshot.h"
 #include "Project.h"
 #include "TimeTrack.h"
 #include "WaveTrack.h"
@@ -481,6 +491,153 @@ using std::min;
 std::unique_ptr<AudioIO> ugAudioIO;
 AudioIO *gAudioIO{};
 
+namespace {
+
+thread_local bool sInAudioCallback = false;
+
+// The most latency of realtime effects that is compensated
+const double MaxRealtimeDelaySecs = 1.0;
+
+// Delays the samples in place, through the ring, which holds the last of
+// those of the previous call.  A change of delay inserts silence or skips.
+void DelaySamples(RingBuffer &ring, float *buffer, size_t len, size_t delay)
+{
+   delay = std::min(delay, ring.GetCapacity() - 1);
+   const auto held = ring.AvailForGet();
+   if (held < delay)
+      ring.Clear(floatSample, delay - held);
+   else if (held > delay)
+      ring.Discard(held - delay);
+   if (delay == 0)
+      return;
+
+   while (len > 0) {
+      const auto chunk = std::min(len, ring.GetCapacity() - delay);
+      ring.Put((samplePtr)buffer, floatSample, chunk);
+      ring.Get((samplePtr)buffer, floatSample, chunk);
+      buffer += chunk;
+      len -= chunk;
+   }
+}
+
+// Index of the first of bounds that value is under, or the number of bounds
+template<size_t nBounds>
+size_t TelemetryBucket(double value, const double (&bounds)[nBounds])
+{
+   size_t ii = 0;
+   while (ii < nBounds && value >= bounds[ii])
+      ++ii;
+   return ii;
+}
+
+void AtomicMax(std::atomic<double> &maximum, double value)
+{
+   auto old = maximum.load(std::memory_order_relaxed);
+   while (value > old &&
+          !maximum.compare_exchange_weak(old, value, std::memory_order_relaxed))
+      ;
+}
+
+#ifdef __WXDEBUG__
+// The first blocking call seen in the callback, for StopStream to report
+std::atomic<const char *> sBlockingFile{ nullptr };
+std::atomic<int> sBlockingLine{ 0 };
+#endif
+
+}
+
+bool IsAudioCallbackThread()
+{
+   return sInAudioCallback;
+}
+
+#ifdef __WXDEBUG__
+void NoteBlockingAudioCallback(const char *file, int line)
+{
+   const char *expected = nullptr;
+   if (sBlockingFile.compare_exchange_strong(expected, file))
+      sBlockingLine = line;
+}
+
+namespace {
+// Heap allocations in the callback, which may wait on the lock of the
+// allocator, for StopStream to report
+std::atomic<unsigned> sCallbackAllocations{ 0 };
+}
+
+// Allocating as the default does, but counting those of the callback,
+// including any by realtime effects
+void *operator new(std::size_t size)
+{
+   if (sInAudioCallback)
+      ++sCallbackAllocations;
+   if (auto result = malloc(size ? size : 1))
+      return result;
+   throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size)
+{
+   return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+   free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+   free(pointer);
+}
+#endif
+
+struct AudioIO::CallbackScratch
+{
+   CallbackScratch(size_t frames_,
+      unsigned playbackChannels, unsigned captureChannels,
+      size_t playbackTracks, size_t groups)
+      : frames{ frames_ }
+      , temp{ frames * std::max(playbackChannels, captureChannels) }
+      , meter{ frames * playbackChannels }
+      , channels{ frames * playbackChannels }
+      , monitor{ frames * 2 }
+      , chans{ playbackChannels }
+      , tempBufs{ playbackChannels }
+      , scratchBufs{ playbackChannels }
+      , pendingCommits{ playbackChannels }
+      , processedAhead{ groups }
+      , groups{ groups }
+      , groupBufs{ playbackTracks }
+   {}
+
+   // Callbacks of more frames take the buffers of samples from the stack
+   const size_t frames;
+   Floats temp;
+   Floats meter;
+   Floats channels;
+   Floats monitor;
+
+   ArrayOf<const WaveTrack *> chans;
+   ArrayOf<float *> tempBufs;
+   ArrayOf<float *> scratchBufs;
+   ArrayOf<RingBuffer *> pendingCommits;
+   ArrayOf<bool> processedAhead;
+   ArrayOf<EffectManager::RealtimeGroup> groups;
+   ArrayOf<float *> groupBufs;
+};
+
+void AudioIO::AllocateCallbackScratch()
+{
+   // Hosts ask for far less than a second, except with the largest latencies
+   const auto frames = std::max<size_t>(1, lrint(mRate));
+   const auto nGroups = mPlaybackGroupStarts.empty()
+      ? 0 : mPlaybackGroupStarts.size() - 1;
+   mCallbackScratch = std::make_unique<CallbackScratch>(frames,
+      mNumPlaybackChannels, mNumCaptureChannels,
+      mPlaybackTracks.size(), nGroups);
+}
+
 wxDEFINE_EVENT(EVT_AUDIOIO_PLAYBACK, wxCommandEvent);
 wxDEFINE_EVENT(EVT_AUDIOIO_CAPTURE, wxCommandEvent);
 wxDEFINE_EVENT(EVT_AUDIOIO_MONITOR, wxCommandEvent);
@@ -553,7 +710,6 @@ struct AudioIO::ScrubQueue
       , mRate(rate)
       , mLastScrubTimeMillis(startClockMillis)
       , mMaxDebt { maxDebt }
-      , mUpdating()
    {
       const auto s0 = std::max(options.minSample, std::min(options.maxSample,
          sampleCount(lrint(t0 * mRate))
@@ -581,9 +737,9 @@ struct AudioIO::ScrubQueue
 
    double LastTimeInQueue() const
    {
-      // Needed by the main thread sometimes
-      wxMutexLocker locker(mUpdating);
-      const Entry &previous = mEntries[(mLeadingIdx + Size - 1) % Size];
+      // Needed by the main thread sometimes; only it changes mLeadingIdx
+      const Entry &previous =
+         mEntries[(mLeadingIdx.load(std::memory_order_relaxed) + Size - 1) % Size];
       return previous.mS1.as_double() / mRate;
    }
 
@@ -591,9 +747,8 @@ struct AudioIO::ScrubQueue
    // Audio stream needs to be unblocked
    void Nudge()
    {
-      wxMutexLocker locker(mUpdating);
       mNudged = true;
-      mAvailable.Signal();
+      gAudioIO->WakeAudioThread();
    }
 
    bool Producer(double end, const ScrubbingOptions &options)
@@ -602,13 +757,15 @@ struct AudioIO::ScrubQueue
 
       // MAY ADVANCE mLeadingIdx, BUT IT NEVER CATCHES UP TO mTrailingIdx.
 
-      wxMutexLocker locker(mUpdating);
+      // Only this thread stores mLeadingIdx.  Entries from mTrailingIdx up
+      // to it belong to the other threads until they advance past them.
       bool result = true;
-      unsigned next = (mLeadingIdx + 1) % Size;
-      if (next != mTrailingIdx)
+      auto leading = mLeadingIdx.load(std::memory_order_relaxed);
+      unsigned next = (leading + 1) % Size;
+      if (next != mTrailingIdx.load(std::memory_order_acquire))
       {
-         auto current = &mEntries[mLeadingIdx];
-         auto previous = &mEntries[(mLeadingIdx + Size - 1) % Size];
+         auto current = &mEntries[leading];
+         auto previous = &mEntries[(leading + Size - 1) % Size];
 
          // Use the previous end as NEW start.
          const auto s0 = previous->mS1;
@@ -626,7 +783,8 @@ struct AudioIO::ScrubQueue
          auto success =
             current->Init(previous, s0, s1, actualDuration, options);
          if (success)
-            mLeadingIdx = next;
+            // Publish the entry to Transformer()
+            mLeadingIdx.store(leading = next, std::memory_order_release);
          else {
             dd.Cancel();
             return false;
@@ -635,19 +793,19 @@ struct AudioIO::ScrubQueue
          // Fill up the queue with some silence if there was trimming
          wxASSERT(actualDuration <= origDuration);
          if (actualDuration < origDuration) {
-            next = (mLeadingIdx + 1) % Size;
-            if (next != mTrailingIdx) {
-               previous = &mEntries[(mLeadingIdx + Size - 1) % Size];
-               current = &mEntries[mLeadingIdx];
+            next = (leading + 1) % Size;
+            if (next != mTrailingIdx.load(std::memory_order_acquire)) {
+               previous = &mEntries[(leading + Size - 1) % Size];
+               current = &mEntries[leading];
                current->InitSilent(*previous, origDuration - actualDuration);
-               mLeadingIdx = next;
+               mLeadingIdx.store(next, std::memory_order_release);
             }
             else
                // Oops, can't enqueue the silence -- so do what?
                ;
          }
 
-         mAvailable.Signal();
+         gAudioIO->WakeAudioThread();
          return result;
       }
       else
@@ -663,21 +821,26 @@ struct AudioIO::ScrubQueue
 
    void Transformer(sampleCount &startSample, sampleCount &endSample,
                     sampleCount &duration,
-                    Maybe<wxMutexLocker> &cleanup)
+                    bool &debtChecked)
    {
       // Audio thread is ready for the next interval.
 
       // MAY ADVANCE mMiddleIdx, WHICH MAY EQUAL mLeadingIdx, BUT DOES NOT PASS IT.
 
-      bool checkDebt = false;
-      if (!cleanup) {
-         cleanup.create(mUpdating);
+      ASSERT_NOT_AUDIO_CALLBACK();
 
-         // Check for cancellation of work only when re-enetering the cricial section
-         checkDebt = true;
+      // Check for cancellation of work only once in each FillBuffers() pass
+      const bool checkDebt = !debtChecked;
+      debtChecked = true;
+
+      // Only this thread stores mMiddleIdx
+      auto middle = mMiddleIdx.load(std::memory_order_relaxed);
+      auto leading = mLeadingIdx.load(std::memory_order_acquire);
+      while(!mNudged && middle == leading) {
+         // Producer() and Nudge() wake the thread at once
+         gAudioIO->WaitForAudioThreadWork(10);
+         leading = mLeadingIdx.load(std::memory_order_acquire);
       }
-      while(!mNudged && mMiddleIdx == mLeadingIdx)
-         mAvailable.Wait();
 
       mNudged = false;
 
@@ -685,7 +848,7 @@ struct AudioIO::ScrubQueue
 
       if (checkDebt &&
           mLastTransformerTimeMillis >= 0 && // Not the first time for this scrub
-          mMiddleIdx != mLeadingIdx) {
+          middle != leading) {
          // There is work in the queue, but if Producer is outrunning us, discard some,
          // which may make a skip yet keep playback better synchronized with user gestures.
          const auto interval = (now - mLastTransformerTimeMillis).ToDouble() / 1000.0;
@@ -696,16 +859,16 @@ struct AudioIO::ScrubQueue
          mCredit = 0;
          mDebt += deficit;
          auto toDiscard = mDebt - mMaxDebt;
-         while (toDiscard > 0 && mMiddleIdx != mLeadingIdx) {
+         while (toDiscard > 0 && middle != leading) {
             // Cancel some debt (discard some NEW work)
-            auto &entry = mEntries[mMiddleIdx];
+            auto &entry = mEntries[middle];
             auto &dur = entry.mDuration;
             if (toDiscard >= dur) {
                // Discard entire queue entry
                mDebt -= dur;
                toDiscard -= dur;
                dur = 0; // So Consumer() will handle abandoned entry correctly
-               mMiddleIdx = (mMiddleIdx + 1) % Size;
+               middle = (middle + 1) % Size;
             }
             else {
                // Adjust the start time
@@ -727,13 +890,13 @@ struct AudioIO::ScrubQueue
          }
       }
 
-      if (mMiddleIdx != mLeadingIdx) {
+      if (middle != leading) {
          // There is still work in the queue, after cancelling debt
-         Entry &entry = mEntries[mMiddleIdx];
+         Entry &entry = mEntries[middle];
          startSample = entry.mS0;
          endSample = entry.mS1;
          duration = entry.mDuration;
-         mMiddleIdx = (mMiddleIdx + 1) % Size;
+         middle = (middle + 1) % Size;
          mCredit += duration;
       }
       else {
@@ -741,6 +904,9 @@ struct AudioIO::ScrubQueue
          startSample = endSample = duration = -1L;
       }
 
+      // Publish changes to the entries passed, to Consumer()
+      mMiddleIdx.store(middle, std::memory_order_release);
+
       if (checkDebt)
          mLastTransformerTimeMillis = now;
    }
@@ -752,7 +918,9 @@ struct AudioIO::ScrubQueue
 
       // MAY ADVANCE mTrailingIdx, BUT IT NEVER CATCHES UP TO mMiddleIdx.
 
-      wxMutexLocker locker(mUpdating);
+      // Only this thread stores mTrailingIdx, and it never waits
+      auto trailing = mTrailingIdx.load(std::memory_order_relaxed);
+      const auto middle = mMiddleIdx.load(std::memory_order_acquire);
 
       // Mark entries as partly or fully "consumed" for
       // purposes of mTime update.  It should not happen that
@@ -760,7 +928,7 @@ struct AudioIO::ScrubQueue
       // but in that case we just use the t1 of the latest entry.
       while (1)
       {
-         Entry *pEntry = &mEntries[mTrailingIdx];
+         Entry *pEntry = &mEntries[trailing];
          auto remaining = pEntry->mDuration - pEntry->mPlayed;
          if (frames >= remaining)
          {
@@ -773,12 +941,14 @@ struct AudioIO::ScrubQueue
             pEntry->mPlayed += frames;
             break;
          }
-         const unsigned next = (mTrailingIdx + 1) % Size;
-         if (next == mMiddleIdx)
+         const unsigned next = (trailing + 1) % Size;
+         if (next == middle)
             break;
-         mTrailingIdx = next;
+         trailing = next;
       }
-      return mEntries[mTrailingIdx].GetTime(mRate);
+      // Give the entries passed back to Producer()
+      mTrailingIdx.store(trailing, std::memory_order_release);
+      return mEntries[trailing].GetTime(mRate);
    }
 
 private:
@@ -960,9 +1130,12 @@ private:
 
    enum { Size = 10 };
    Entry mEntries[Size];
-   unsigned mTrailingIdx;
-   unsigned mMiddleIdx;
-   unsigned mLeadingIdx;
+   // Each is stored by one thread only:  the PortAudio, audio and main
+   // thread respectively.  Release and acquire pass the entries between
+   // them, so no thread ever waits for another's lock.
+   std::atomic<unsigned> mTrailingIdx;
+   std::atomic<unsigned> mMiddleIdx;
+   std::atomic<unsigned> mLeadingIdx;
    const double mRate;
    wxLongLong mLastScrubTimeMillis;
 
@@ -971,9 +1144,7 @@ private:
    sampleCount mDebt { 0 };
    const long mMaxDebt;
 
-   mutable wxMutex mUpdating;
-   mutable wxCondition mAvailable { mUpdating };
-   bool mNudged { false };
+   std::atomic<bool> mNudged { false };
 };
 #endif
 
@@ -1038,6 +1209,56 @@ const int AudioIO::RatesToTry[] = {
 const int AudioIO::NumRatesToTry = sizeof(AudioIO::RatesToTry) /
                                       sizeof(AudioIO::RatesToTry[0]);
 
+template<typename Sample>
+static void Deinterleave(const Sample *input, unsigned nChannels,
+                         samplePtr *destinations, size_t len)
+{
+   for (size_t i = 0; i < len; ++i, input += nChannels)
+      for (unsigned t = 0; t < nChannels; ++t)
+         reinterpret_cast<Sample*>(destinations[t])[i] = input[t];
+}
+
+// Writes len frames of interleaved input into the capture ring buffers in
+// one pass, straight into their memory.  Returns false, having written
+// nothing, if any buffer holds another format than the input.
+static bool DeinterleaveCapture(const void *inputBuffer,
+   sampleFormat inputFormat,
+   const ArrayOf<std::unique_ptr<RingBuffer>> &buffers,
+   samplePtr *destinations, unsigned nChannels, size_t len)
+{
+   if (inputFormat != floatSample && inputFormat != int16Sample)
+      return false;
+   for (unsigned t = 0; t < nChannels; t++)
+      if (buffers[t]->GetFormat() != inputFormat)
+         return false;
+
+   // Each buffer may wrap around at a different place, so write as much as
+   // all of them can take contiguously, then go round again
+   size_t done = 0;
+   while (done < len) {
+      auto chunk = len - done;
+      for (unsigned t = 0; t < nChannels; t++) {
+         size_t avail;
+         destinations[t] = buffers[t]->AcquireForPut(avail);
+         chunk = std::min(chunk, avail);
+      }
+      if (chunk == 0)
+         break;
+
+      if (inputFormat == floatSample)
+         Deinterleave(static_cast<const float*>(inputBuffer) + done * nChannels,
+                      nChannels, destinations, chunk);
+      else
+         Deinterleave(static_cast<const short*>(inputBuffer) + done * nChannels,
+                      nChannels, destinations, chunk);
+
+      for (unsigned t = 0; t < nChannels; t++)
+         buffers[t]->CommitPut(chunk);
+      done += chunk;
+   }
+   return true;
+}
+
 int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
                           unsigned long framesPerBuffer,
                           const PaStreamCallbackTimeInfo *timeInfo,
@@ -1113,6 +1334,28 @@ class MidiThread final : public AudioThread {
 //
 //////////////////////////////////////////////////////////////////////
 
+namespace {
+   std::future<PaError> &EarlyPortAudioInitialization()
+   {
+      static std::future<PaError> result;
+      return result;
+   }
+}
+
+void StartAudioIOInitialization()
+{
+   // Windows host APIs initialize COM for the calling thread, which must
+   // also be the one to terminate them; Core Audio prefers the main thread
+#ifdef __WXGTK__
+   auto &result = EarlyPortAudioInitialization();
+   if (!result.valid())
+      result = std::async(std::launch::async, []{
+         PROFILE_SCOPE("Startup::PortAudio");
+         return Pa_Initialize();
+      });
+#endif
+}
+
 void InitAudioIO()
 {
    ugAudioIO.reset(safenew AudioIO());
@@ -1183,6 +1426,7 @@ AudioIO::AudioIO()
    mAudioThreadFillBuffersLoopRunning = false;
    mAudioThreadFillBuffersLoopActive = false;
    mPortStreamV19 = NULL;
+   mTelemetry.Reset();
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    mMidiStream = NULL;
@@ -1215,7 +1459,10 @@ AudioIO::AudioIO()
    mOwningProject = NULL;
    mOutputMeter = NULL;
 
-   PaError err = Pa_Initialize();
+   auto &earlyInitialization = EarlyPortAudioInitialization();
+   PaError err = earlyInitialization.valid()
+      ? earlyInitialization.get()
+      : Pa_Initialize();
 
    if (err != paNoError) {
       wxString errStr = _("Could not find any audio devices.\n");
@@ -1253,6 +1500,8 @@ AudioIO::AudioIO()
 #ifdef USE_MIDI_THREAD
    mMidiThread = std::make_unique<MidiThread>();
    mMidiThread->Create();
+   // A wakeup delayed behind other threads delays the notes
+   mMidiThread->SetPriority(WXTHREAD_MAX_PRIORITY);
 #endif
 
 #endif
@@ -1277,6 +1526,10 @@ AudioIO::AudioIO()
    mScrubQueue = NULL;
    mScrubDuration = 0;
    mSilentScrub = false;
+   mScrubSpeed = 0.0;
+   mScrubBackwards = false;
+   mScrubRampFrom = mScrubRampTo = 0.0;
+   mScrubRampLength = mScrubRampDone = 0;
 #endif
 }
 
@@ -1642,6 +1895,9 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
                                    unsigned int numCaptureChannels,
                                    sampleFormat captureFormat)
 {
+   mTelemetry.Reset();
+   mMonitorEffectGroup = -1;
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    mNumFrames = 0;
    mNumPauseFrames = 0;
@@ -1668,9 +1924,14 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
    mOutputMeter = NULL;
 
    mLastPaError = paNoError;
+   const auto prefs = PrefsSnapshot::Get();
+   const auto nullDevice = prefs->nullDevice;
    // pick a rate to do the audio I/O at, from those available. The project
-   // rate is suggested, but we may get something else if it isn't supported
-   mRate = GetBestRate(numCaptureChannels > 0, numPlaybackChannels > 0, sampleRate);
+   // rate is suggested, but we may get something else if it isn't supported.
+   // The null device takes any rate.
+   mRate = nullDevice
+      ? sampleRate
+      : GetBestRate(numCaptureChannels > 0, numPlaybackChannels > 0, sampleRate);
 
    // July 2016 (Carsten and Uwe)
    // BUG 193: Tell PortAudio sound card will handle 24 bit (under DirectSound) using 
@@ -1691,12 +1952,18 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
    mNumPlaybackChannels = numPlaybackChannels;
    mNumCaptureChannels = numCaptureChannels;
 
+   if (nullDevice != NullDeviceOff) {
+      mCaptureFormat = captureFormat;
+      return OpenNullStream(numPlaybackChannels, numCaptureChannels,
+         nullDevice == NullDevicePaced,
+         std::max(16L, prefs->nullDeviceBufferFrames));
+   }
+
    bool usePlayback = false, useCapture = false;
    PaStreamParameters playbackParameters{};
    PaStreamParameters captureParameters{};
 
-   double latencyDuration = DEFAULT_LATENCY_DURATION;
-   gPrefs->Read(wxT("/AudioIO/LatencyDuration"), &latencyDuration);
+   const double latencyDuration = prefs->latencyDuration;
 
    if( numPlaybackChannels > 0)
    {
@@ -1747,9 +2014,10 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
       captureParameters.hostApiSpecificStreamInfo = NULL;
       captureParameters.channelCount = mNumCaptureChannels;
 
+      // Monitoring wants the input soon, as much as the output
       if (mSoftwarePlaythrough)
          captureParameters.suggestedLatency =
-            captureDeviceInfo->defaultHighInputLatency;
+            captureDeviceInfo->defaultLowInputLatency;
       else
          captureParameters.suggestedLatency = latencyDuration/1000.0;
 
@@ -1772,10 +2040,19 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
    int  userData = 24;
    int* lpUserData = (captureFormat_saved == int24Sample) ? &userData : NULL;
 
+   // A fixed, small callback buffer bounds the monitoring delay, which
+   // otherwise is whatever the host chooses
+   unsigned long framesPerBuffer = paFramesPerBufferUnspecified;
+   if (mSoftwarePlaythrough && useCapture && usePlayback) {
+      const auto bufferMs = prefs->playthroughBufferMs;
+      if (bufferMs > 0)
+         framesPerBuffer = std::max(16L, lrint(bufferMs * mRate / 1000.0));
+   }
+
    mLastPaError = Pa_OpenStream( &mPortStreamV19,
                                  useCapture ? &captureParameters : NULL,
                                  usePlayback ? &playbackParameters : NULL,
-                                 mRate, paFramesPerBufferUnspecified,
+                                 mRate, framesPerBuffer,
                                  paNoFlag,
                                  audacityAudioCallback, lpUserData );
 
@@ -1805,10 +2082,16 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
    }
 #endif
 
+   if (mPortStreamV19 != NULL && mLastPaError == paNoError) {
+      const PaStreamInfo* info = GetPortStreamInfo();
+      mTelemetry.inputLatencyMillis = info->inputLatency * 1000.0;
+      mTelemetry.outputLatencyMillis = info->outputLatency * 1000.0;
+   }
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    // We use audio latency to estimate how far ahead of DACS we are writing
    if (mPortStreamV19 != NULL && mLastPaError == paNoError) {
-      const PaStreamInfo* info = Pa_GetStreamInfo(mPortStreamV19);
+      const PaStreamInfo* info = GetPortStreamInfo();
       // this is an initial guess, but for PA/Linux/ALSA it's wrong and will be
       // updated with a better value:
       mAudioOutLatency = info->outputLatency;
@@ -1819,16 +2102,105 @@ bool AudioIO::StartPortAudioStream(double sampleRate,
    return (mLastPaError == paNoError);
 }
 
+bool AudioIO::OpenNullStream(unsigned int numPlaybackChannels,
+                             unsigned int numCaptureChannels,
+                             bool paced, unsigned long framesPerBuffer)
+{
+   if (numPlaybackChannels > 0)
+      mOutputMeter = mOwningProject->GetPlaybackMeter();
+   if (numCaptureChannels > 0)
+      SetCaptureMeter( mOwningProject, mOwningProject->GetCaptureMeter() );
+   SetMeters();
+
+   mNullStream = std::make_unique<NullAudioStream>(
+      audacityAudioCallback, nullptr,
+      numCaptureChannels, SAMPLE_SIZE(mCaptureFormat), numPlaybackChannels,
+      mRate, framesPerBuffer, paced,
+      [this, framesPerBuffer]{ return NullStreamReady(framesPerBuffer); } );
+   mPortStreamV19 = mNullStream.get();
+   mNullStreamTracks = 0;
+   mNullStatistics = {};
+   return true;
+}
+
+bool AudioIO::NullStreamReady(unsigned long framesPerBuffer) const
+{
+   // Monitoring, or the buffers are not made yet
+   if (mStreamToken <= 0 || !mPlaybackBuffers || mPlaybackTracks.empty())
+      return true;
+   // Don't spin through silence; the stream waits its timeout instead
+   if (mPaused)
+      return false;
+   // The mixers are done, and the callback will find the end
+   if (mPlayMode == PLAY_STRAIGHT && mWarpedTime >= mWarpedLength)
+      return true;
+   for (size_t ii = 0; ii < mPlaybackTracks.size(); ++ii)
+      if (mPlaybackBuffers[ii]->AvailForGet() < framesPerBuffer)
+         return false;
+   return true;
+}
+
+PaError AudioIO::StartPortStream()
+{
+   if (mNullStream)
+      return mNullStream->Start();
+   return Pa_StartStream( mPortStreamV19 );
+}
+
+void AudioIO::ClosePortStream()
+{
+   if (mNullStream) {
+      mNullStream->Stop();
+      mNullStatistics = mNullStream->GetStatistics();
+      mNullStreamTracks = mPlaybackTracks.size();
+      mNullStream.reset();
+   }
+   else {
+      Pa_AbortStream( mPortStreamV19 );
+      Pa_CloseStream( mPortStreamV19 );
+   }
+   mPortStreamV19 = NULL;
+}
+
+bool AudioIO::IsPortStreamStopped() const
+{
+   if (mNullStream)
+      return mNullStream->IsStopped();
+   // An error counts as stopped, too
+   return Pa_IsStreamStopped( mPortStreamV19 ) != 0;
+}
+
+bool AudioIO::IsPortStreamActive() const
+{
+   if (mNullStream)
+      return mNullStream->IsActive();
+   return Pa_IsStreamActive( mPortStreamV19 ) > 0;
+}
+
+double AudioIO::GetPortStreamTime() const
+{
+   if (mNullStream)
+      return mNullStream->GetTime();
+   return Pa_GetStreamTime( mPortStreamV19 );
+}
+
+const PaStreamInfo *AudioIO::GetPortStreamInfo() const
+{
+   if (mNullStream)
+      return mNullStream->GetInfo();
+   return Pa_GetStreamInfo( mPortStreamV19 );
+}
+
 void AudioIO::StartMonitoring(double sampleRate)
 {
    if ( mPortStreamV19 || mStreamToken )
       return;
 
    bool success;
-   long captureChannels;
    auto captureFormat = QualityPrefs::SampleFormatChoice();
-   gPrefs->Read(wxT("/AudioIO/RecordChannels"), &captureChannels, 2L);
-   gPrefs->Read(wxT("/AudioIO/SWPlaythrough"), &mSoftwarePlaythrough, false);
+   const auto prefs = PrefsSnapshot::Get();
+   const long captureChannels = prefs->recordChannels;
+   mSoftwarePlaythrough = prefs->swPlaythrough;
    int playbackChannels = 0;
 
    if (mSoftwarePlaythrough)
@@ -1852,7 +2224,8 @@ void AudioIO::StartMonitoring(double sampleRate)
    // Now start the PortAudio stream!
    // TODO: ? Factor out and reuse error reporting code from end of 
    // AudioIO::StartStream?
-   mLastPaError = Pa_StartStream( mPortStreamV19 );
+   AllocateCallbackScratch();
+   mLastPaError = StartPortStream();
 
    // Update UI display only now, after all possibilities for error are past.
    if ((mLastPaError == paNoError) && mListener) {
@@ -1867,8 +2240,11 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 {
    mLostSamples = 0;
    mLostCaptureIntervals.clear();
-   mDetectDropouts =
-      gPrefs->Read( WarningDialogKey(wxT("DropoutDetected")), true ) != 0;
+   // The callback adds to these, and should not need to allocate
+   mLostCaptureIntervals.reserve(256);
+   // One snapshot for the whole start, however the preferences change
+   const auto prefs = PrefsSnapshot::Get();
+   mDetectDropouts = prefs->detectDropouts;
    auto cleanup = finally ( [this] { ClearRecordingException(); } );
 
    if( IsBusy() )
@@ -1900,15 +2276,13 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 #ifdef __WXGTK__
    // Detect whether ALSA is the chosen host, and do the various involved MIDI
    // timing compensations only then.
-   mUsingAlsa = (gPrefs->Read(wxT("/AudioIO/Host"), wxT("")) == "ALSA");
+   mUsingAlsa = (prefs->host == "ALSA");
 #endif
 
-   gPrefs->Read(wxT("/AudioIO/SWPlaythrough"), &mSoftwarePlaythrough, false);
-   gPrefs->Read(wxT("/AudioIO/SoundActivatedRecord"), &mPauseRec, false);
-   int silenceLevelDB;
-   gPrefs->Read(wxT("/AudioIO/SilenceLevel"), &silenceLevelDB, -50);
-   int dBRange;
-   dBRange = gPrefs->Read(ENV_DB_KEY, ENV_DB_RANGE);
+   mSoftwarePlaythrough = prefs->swPlaythrough;
+   mPauseRec = prefs->soundActivatedRecord;
+   int silenceLevelDB = prefs->silenceLevel;
+   const int dBRange = prefs->dBRange;
    if(silenceLevelDB < -dBRange)
    {
       silenceLevelDB = -dBRange + 3;   // meter range was made smaller than SilenceLevel
@@ -1935,10 +2309,11 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    mT1      = t1;
    mRecordingSchedule = {};
    mRecordingSchedule.mPreRoll = preRoll;
-   mRecordingSchedule.mLatencyCorrection =
-      (gPrefs->ReadDouble(wxT("/AudioIO/LatencyCorrection"),
-                   DEFAULT_LATENCY_CORRECTION))
-         / 1000.0;
+   // A measurement for the devices, if any, beats the preference
+   double latencyCorrection;
+   if (!DeviceManager::Instance()->GetMeasuredLatency(latencyCorrection))
+      latencyCorrection = prefs->latencyCorrection;
+   mRecordingSchedule.mLatencyCorrection = latencyCorrection / 1000.0;
    mRecordingSchedule.mDuration = t1 - t0;
    if (tracks.captureTracks.size() > 0)
       // adjust mT1 so that we don't give paComplete too soon to fill up the
@@ -1976,7 +2351,10 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 
    mPlaybackBuffers.reset();
    mPlaybackMixers.reset();
+   mPlaybackDelays.reset();
+   mLoopCache.Stop();
    mCaptureBuffers.reset();
+   mCaptureDestinations.reset();
    mResample.reset();
 
    double playbackTime = 4.0;
@@ -2031,6 +2409,22 @@ int AudioIO::StartStream(const TransportTracks &tracks,
       mWarpedLength = fabs(mWarpedLength);
    }
 
+   // Realtime effects may instead be processed by the audio thread, where a
+   // slow effect does not glitch the output and the groups run in parallel.
+   // The playback buffers then hold only a fixed, short latency, so that
+   // changes to the effects are soon heard.
+   double lookAheadSecs = 0.0;
+   {
+      mRealtimeLookAhead = prefs->realtimeLookAhead &&
+         (mPlayMode == PLAY_STRAIGHT || mPlayMode == PLAY_LOOPED);
+      if (mRealtimeLookAhead) {
+         lookAheadSecs = std::max(0.02, std::min(2.0,
+            prefs->realtimeLookAheadMs / 1000.0));
+         // Refill each quarter of the latency
+         playbackTime = lookAheadSecs / 4;
+      }
+   }
+
    //
    // The RingBuffer sizes, and the max amount of the buffer to
    // fill at a time, both grow linearly with the number of
@@ -2049,7 +2443,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    mPlaybackSamplesToCopy = playbackTime * mRate;
 
    // Capacity of the playback buffer.
-   mPlaybackRingBufferSecs = 10.0;
+   mPlaybackRingBufferSecs = mRealtimeLookAhead ? lookAheadSecs : 10.0;
 
    mCaptureRingBufferSecs = 4.5 + 0.5 * std::min(size_t(16), mCaptureTracks.size());
    mMinCaptureSecsToCopy = 0.2 + 0.2 * std::min(size_t(16), mCaptureTracks.size());
@@ -2139,6 +2533,18 @@ int AudioIO::StartStream(const TransportTracks &tracks,
 
             mPlaybackBuffers.reinit(mPlaybackTracks.size());
             mPlaybackMixers.reinit(mPlaybackTracks.size());
+            mLookAheadBuffers.reinit(
+               mRealtimeLookAhead ? mPlaybackTracks.size() : 0);
+            mLookAheadBufferPtrs.reinit(
+               mRealtimeLookAhead ? mPlaybackTracks.size() : 0);
+            for (size_t i = 0; mRealtimeLookAhead && i < mPlaybackTracks.size(); ++i) {
+               mLookAheadBuffers[i].reinit(playbackMixBufferSize);
+               mLookAheadBufferPtrs[i] = mLookAheadBuffers[i].get();
+            }
+            mPlaybackDelays.reinit(mPlaybackTracks.size());
+            for (size_t i = 0; i < mPlaybackTracks.size(); ++i)
+               mPlaybackDelays[i] = std::make_unique<RingBuffer>(floatSample,
+                  (size_t)lrint(mRate * MaxRealtimeDelaySecs));
 
             const Mixer::WarpOptions &warpOptions =
 #ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
@@ -2180,6 +2586,23 @@ int AudioIO::StartStream(const TransportTracks &tracks,
                   mRate, floatSample, false);
                mPlaybackMixers[i]->ApplyTrackGains(false);
             }
+
+            // Group the channels of each track, to be filled together
+            mPlaybackGroupStarts.clear();
+            for (size_t i = 0; i < mPlaybackTracks.size(); ++i)
+               if (i == 0 || !mPlaybackTracks[i - 1]->GetLinked())
+                  mPlaybackGroupStarts.push_back(i);
+            const auto nGroups = mPlaybackGroupStarts.size();
+            mPlaybackGroupStarts.push_back(mPlaybackTracks.size());
+
+            // The audio thread's helpers are the shared workers, in the
+            // lane that goes first
+            long nThreads = lrint(prefs->fillBuffersThreads);
+            if (nThreads <= 0)
+               nThreads = TaskScheduler::Get().GetConcurrency();
+            // Never more threads than groups
+            mFillBuffersConcurrency = std::max<size_t>(1,
+               std::min<size_t>(nThreads, nGroups));
          }
 
          if( mNumCaptureChannels > 0 )
@@ -2197,6 +2620,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
             }
 
             mCaptureBuffers.reinit(mCaptureTracks.size());
+            mCaptureDestinations.reinit(mCaptureTracks.size());
             mResample.reinit(mCaptureTracks.size());
             mFactor = sampleRate / mRate;
 
@@ -2258,6 +2682,15 @@ int AudioIO::StartStream(const TransportTracks &tracks,
          // stream, not the rate of the track.
          em.RealtimeAddProcessor(group++, chanCnt, mRate);
       }
+
+      // The monitored input may have the effects too, after the tracks'
+      // groups, but only when the callback applies them
+      if (prefs->playthroughEffects && mSoftwarePlaythrough &&
+          mNumCaptureChannels > 0 && !mRealtimeLookAhead) {
+         mMonitorEffectGroup = group;
+         em.RealtimeAddProcessor(group++,
+            std::min(2u, mNumCaptureChannels), mRate);
+      }
    }
 
 #ifdef EXPERIMENTAL_AUTOMATED_INPUT_LEVEL_ADJUSTMENT
@@ -2288,16 +2721,29 @@ int AudioIO::StartStream(const TransportTracks &tracks,
             scrubOptions);
       mScrubDuration = 0;
       mSilentScrub = false;
+      mScrubSpeed = 0.0;
+      mScrubRampLength = mScrubRampDone = 0;
    }
    else
       mScrubQueue.reset();
 #endif
 
+   if (mPlayMode == PLAY_LOOPED && mNumPlaybackChannels > 0)
+      mLoopCache.Start(mPlaybackTracks.size(), mRate, mWarpedLength * mRate,
+         mWarpedTime == 0.0);
+   else
+      mLoopCache.Stop();
+
+   // Beyond what priming reads now
+   if (mNumPlaybackChannels > 0)
+      PrefetchPlayback(mTime);
+
    // We signal the audio thread to call FillBuffers, to prime the RingBuffers
    // so that they will have data in them when the stream starts.  Having the
    // audio thread call FillBuffers here makes the code more predictable, since
    // FillBuffers will ALWAYS get called from the Audio thread.
    mAudioThreadShouldCallFillBuffersOnce = true;
+   WakeAudioThread();
 
    while( mAudioThreadShouldCallFillBuffersOnce == true ) {
       if (mScrubQueue)
@@ -2318,7 +2764,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
       // (Which we should be able to determine from fields of
       // PaStreamCallbackTimeInfo, but that seems not to work as documented with
       // ALSA.)
-      if (mUsingAlsa)
+      if (mUsingAlsa && !mNullStream)
          // Perhaps we should do this only if also playing MIDI ?
          PaAlsa_EnableRealtimeScheduling( mPortStreamV19, 1 );
 #endif
@@ -2339,9 +2785,11 @@ int AudioIO::StartStream(const TransportTracks &tracks,
       // of audio, but then we might be scrubbing, so do it.
       mAudioThreadFillBuffersLoopRunning = true;
 
+      AllocateCallbackScratch();
+
       // Now start the PortAudio stream!
       PaError err;
-      err = Pa_StartStream( mPortStreamV19 );
+      err = StartPortStream();
 
       if( err != paNoError )
       {
@@ -2393,14 +2841,15 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
 
    mPlaybackBuffers.reset();
    mPlaybackMixers.reset();
+   mPlaybackDelays.reset();
+   mLoopCache.Stop();
    mCaptureBuffers.reset();
+   mCaptureDestinations.reset();
    mResample.reset();
 
    if(!bOnlyBuffers)
    {
-      Pa_AbortStream( mPortStreamV19 );
-      Pa_CloseStream( mPortStreamV19 );
-      mPortStreamV19 = NULL;
+      ClosePortStream();
       mStreamToken = 0;
    }
 
@@ -2428,7 +2877,7 @@ void AudioIO::PrepareMidiIterator(bool send, double offset)
 {
    int i;
    int nTracks = mMidiPlaybackTracks.size();
-   // instead of initializing with an Alg_seq, we use begin_seq()
+   // instead of initializing with an Alg_seq, we use begin_seq_at()
    // below to add ALL Alg_seq's.
    mIterator = std::make_unique<Alg_iterator>(nullptr, false);
    // Iterator not yet intialized, must add each track...
@@ -2439,20 +2888,49 @@ void AudioIO::PrepareMidiIterator(bool send, double offset)
       // off to another thread and want to make sure nothing happens
       // to the data until playback finishes. This is just a sanity check.
       seq->set_in_use(true);
-      mIterator->begin_seq(seq,
+      // Notes before the cursor are never played, so skip them
+      mIterator->begin_seq_at(seq, mT0 - t->GetOffset(),
          // casting away const, but allegro just uses the pointer as an opaque "cookie"
          (void*)t, t->GetOffset() + offset);
    }
-   GetNextEvent(); // prime the pump for FillMidiBuffers
 
-   // Start MIDI from current cursor position
-   mSendMidiState = true;
-   while (mNextEvent &&
-          mNextEventTime < mT0 + offset) {
-      if (send) OutputEvent();
-      GetNextEvent();
+   // Start MIDI from current cursor position, sending the control changes
+   // before it, which the events index finds without visiting the notes
+   if (send) {
+      struct Update {
+         double time;
+         Alg_event_ptr event;
+         const NoteTrack *track;
+      };
+      std::vector<Update> updates;
+      for (i = 0; i < nTracks; i++) {
+         const auto t = mMidiPlaybackTracks[i].get();
+         const auto &index = t->GetEventIndex();
+         const auto start = mT0 - t->GetOffset();
+         for (int tr = 0, nSeqTracks = t->GetSeq().tracks();
+              tr < nSeqTracks; ++tr)
+            for (const auto event : index.GetUpdates(tr)) {
+               if (event->time >= start)
+                  break;
+               updates.push_back({ event->time + t->GetOffset(), event, t });
+            }
+      }
+      std::stable_sort(updates.begin(), updates.end(),
+         [](const Update &a, const Update &b){ return a.time < b.time; });
+
+      mSendMidiState = true;
+      for (const auto &update : updates) {
+         mNextEvent = update.event;
+         mNextEventTrack = const_cast<NoteTrack*>(update.track);
+         mNextIsNoteOn = true;
+         mNextEventTime = update.time + offset;
+         ComputeNextEventWarpedTime();
+         OutputEvent();
+      }
+      mSendMidiState = false;
    }
-   mSendMidiState = false;
+
+   GetNextEvent(); // prime the pump for FillMidiBuffers
 }
 
 bool AudioIO::StartPortMidiStream()
@@ -2507,6 +2985,7 @@ bool AudioIO::StartPortMidiStream()
       // data for MidiTime().
       Pm_Synchronize(mMidiStream); // start using timestamps
       // start midi output flowing (pending first audio callback)
+      mMidiWakeTime = std::numeric_limits<double>::lowest();
       mMidiThreadFillBuffersLoopRunning = true;
    }
    return (mLastPmError == pmNoError);
@@ -2573,14 +3052,23 @@ void AudioIO::StopStream()
      )
       return;
 
-   if( Pa_IsStreamStopped( mPortStreamV19 )
+   if( IsPortStreamStopped()
 #ifdef EXPERIMENTAL_MIDI_OUT
        && !mMidiStreamActive
 #endif
      )
       return;
 
-   wxMutexLocker locker(mSuspendAudioThread);
+#ifdef __WXDEBUG__
+   // Report a blocking call that the callback made, away from the callback
+   if (const auto file = sBlockingFile.exchange(nullptr))
+      wxFAIL_MSG(wxString::Format(
+         wxT("Blocking call in the audio callback at %s:%d"),
+         wxString::FromUTF8(file), sBlockingLine.load()));
+   if (const auto count = sCallbackAllocations.exchange(0))
+      wxFAIL_MSG(wxString::Format(
+         wxT("%u heap allocations in the audio callback"), count));
+#endif
 
    // No longer need effects processing
    if (mNumPlaybackChannels > 0)
@@ -2641,11 +3129,8 @@ void AudioIO::StopStream()
    }
   #endif
 
-   if (mPortStreamV19) {
-      Pa_AbortStream( mPortStreamV19 );
-      Pa_CloseStream( mPortStreamV19 );
-      mPortStreamV19 = NULL;
-   }
+   if (mPortStreamV19)
+      ClosePortStream();
 
    if (mNumPlaybackChannels > 0)
    {
@@ -2718,6 +3203,7 @@ void AudioIO::StopStream()
       // call FillBuffers one last time (it normally would not do so since
       // Pa_GetStreamActive() would now return false
       mAudioThreadShouldCallFillBuffersOnce = true;
+      WakeAudioThread();
 
       while( mAudioThreadShouldCallFillBuffersOnce == true )
       {
@@ -2737,6 +3223,8 @@ void AudioIO::StopStream()
       {
          mPlaybackBuffers.reset();
          mPlaybackMixers.reset();
+         mPlaybackDelays.reset();
+         mLoopCache.Stop();
       }
 
       //
@@ -2745,6 +3233,7 @@ void AudioIO::StopStream()
       if (mCaptureTracks.size() > 0)
       {
          mCaptureBuffers.reset();
+         mCaptureDestinations.reset();
          mResample.reset();
 
          //
@@ -2892,7 +3381,7 @@ bool AudioIO::IsStreamActive()
    bool isActive = false;
    // JKC: Not reporting any Pa error, but that looks OK.
    if( mPortStreamV19 )
-      isActive = (Pa_IsStreamActive( mPortStreamV19 ) > 0);
+      isActive = IsPortStreamActive();
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    if( mMidiStreamActive && !mMidiOutputComplete )
@@ -2916,6 +3405,62 @@ bool AudioIO::IsMonitoring()
    return ( mPortStreamV19 && mStreamToken==0 );
 }
 
+void AudioIO::SeekStream(double seconds)
+{
+   // Read ahead from where the audio thread will go, while it flushes
+   // its buffers to seek
+   PrefetchPlayback(LimitStreamTime(GetStreamTime() + seconds));
+   mSeek = seconds;
+   WakeAudioThread();
+}
+
+void AudioIO::PrefetchPlayback(double absoluteTime)
+{
+   // More than the ring buffers hold, so that the audio thread catches up
+   // with the reading ahead only after it has filled them
+   const double PrefetchSeconds = 10.0;
+   const double t0 = ReversedTime()
+      ? LimitStreamTime(absoluteTime - PrefetchSeconds) : absoluteTime;
+   const double t1 = ReversedTime()
+      ? absoluteTime : LimitStreamTime(absoluteTime + PrefetchSeconds);
+
+   BlockPrefetchQueue::BlockFiles files;
+   for (const auto &track : mPlaybackTracks)
+      track->CollectBlockFiles(t0, t1, files);
+   BlockPrefetchQueue::Get().PushData(std::move(files));
+}
+
+bool AudioIO::RenderLoopPreroll(size_t channel, float *buffer, size_t frames)
+{
+   // Played backwards, the loop is not entered from before mT0
+   if (ReversedTime())
+      return false;
+
+   std::fill(buffer, buffer + frames, 0.0f);
+   // Enough track time for Play-at-Speed, which goes to 3x
+   const double MaxSpeed = 4.0;
+   const double t0 = std::max(0.0, mT0 - MaxSpeed * frames / mRate);
+   if (t0 >= mT0)
+      // Silence before the start of the project
+      return true;
+
+   WaveTrackConstArray mixTracks;
+   mixTracks.push_back(mPlaybackTracks[channel]);
+   Mixer mixer(mixTracks, false, Mixer::WarpOptions(mTimeTrack),
+      t0, mT0, 1, frames, false, mRate, floatSample, false);
+   mixer.ApplyTrackGains(false);
+
+   // Keep the last frames, which end at mT0
+   std::vector<float> mixed;
+   while (auto processed = mixer.Process(frames)) {
+      const auto samples = reinterpret_cast<const float*>(mixer.GetBuffer());
+      mixed.insert(mixed.end(), samples, samples + processed);
+   }
+   const auto count = std::min(frames, mixed.size());
+   std::copy(mixed.end() - count, mixed.end(), buffer + (frames - count));
+   return true;
+}
+
 double AudioIO::LimitStreamTime(double absoluteTime) const
 {
    // Allows for forward or backward play
@@ -2962,7 +3507,15 @@ double AudioIO::GetStreamTime()
    if( !IsStreamActive() )
       return BAD_STREAM_TIME;
 
-   return NormalizeStreamTime(mTime);
+   // What is heard lags behind, by the latency of realtime effects
+   auto time = mTime;
+   if (mPlayMode == PLAY_STRAIGHT && mNumPlaybackChannels > 0) {
+      const auto delay =
+         EffectManager::Get().GetRealtimeDelay() / mRate;
+      time += ReversedTime() ? delay : -delay;
+   }
+
+   return NormalizeStreamTime(time);
 }
 
 
@@ -3253,6 +3806,8 @@ AudioThread::ExitCode AudioThread::Entry()
       }
       else if( gAudioIO->mAudioThreadFillBuffersLoopRunning )
       {
+         if (gAudioIO->mSeek)
+            gAudioIO->ApplySeek();
          gAudioIO->FillBuffers();
       }
       gAudioIO->mAudioThreadFillBuffersLoopActive = false;
@@ -3263,15 +3818,113 @@ AudioThread::ExitCode AudioThread::Entry()
          // playback becoming intermittent.
       }
       else {
-         // Perhaps this too could use a condition variable, for available space in the
-         // ring buffer, instead of a polling loop?  But no harm in doing it this way.
-         Sleep(10);
+         // The callback wakes us when it has freed or filled enough of the
+         // ring buffers; the timeout is only a fallback for missed wakeups
+         gAudioIO->WaitForAudioThreadWork(10);
       }
    }
 
    return 0;
 }
 
+void AudioIO::ApplySeek()
+{
+   ASSERT_NOT_AUDIO_CALLBACK();
+
+#ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
+   // While scrubbing, ignore seek requests
+   if (mPlayMode == PLAY_SCRUB) {
+      mSeek = 0.0;
+      return;
+   }
+#endif
+
+   // Have the callback drop what the ring buffers hold, and wait for it;
+   // give up if the stream is stopping, because callbacks may have ceased
+   mSeekState.store(SeekFlushRequested, std::memory_order_release);
+   while (mSeekState.load(std::memory_order_acquire) != SeekFlushed) {
+      if (!mAudioThreadFillBuffersLoopRunning) {
+         mSeekState = SeekIdle;
+         return;
+      }
+      wxMilliSleep(1);
+   }
+
+   // Now the callback neither takes samples nor moves mTime, until idle
+
+   // Calculate the NEW time position
+   mTime += mSeek;
+   mTime = LimitStreamTime(mTime);
+   mSeek = 0.0;
+
+   // Reset mixer positions for all tracks
+   if(mTimeTrack)
+      // Following gives negative when mT0 > mTime
+      mWarpedTime = mTimeTrack->ComputeWarpedLength(mT0, mTime);
+   else
+      mWarpedTime = mTime - mT0;
+   mWarpedTime = std::abs(mWarpedTime);
+
+   for (size_t i = 0; i < mPlaybackTracks.size(); i++)
+      mPlaybackMixers[i]->Reposition(mTime);
+   mLoopCache.Seek(mWarpedTime * mRate);
+
+   // Reload the ring buffers before letting the callback play them
+   FillBuffers();
+   mSeekState.store(SeekIdle, std::memory_order_release);
+}
+
+void AudioIO::WakeAudioThread()
+{
+   if (!mAudioThreadWakeRequested.exchange(true))
+      mAudioThreadWakeCondition.notify_one();
+}
+
+void AudioIO::WaitForAudioThreadWork(int ms)
+{
+   ASSERT_NOT_AUDIO_CALLBACK();
+   std::unique_lock<std::mutex> lock{ mAudioThreadWakeMutex };
+   mAudioThreadWakeCondition.wait_for(lock, std::chrono::milliseconds(ms),
+      [this]{ return mAudioThreadWakeRequested.load(); });
+   mAudioThreadWakeRequested = false;
+}
+
+
+#if defined(EXPERIMENTAL_MIDI_OUT) && defined(USE_MIDI_THREAD)
+void AudioIO::WakeMidiThread()
+{
+   // Repeated until the thread wakes, so stamp only the first request
+   if (mMidiThreadWakeRequested.load(std::memory_order_relaxed))
+      return;
+   mMidiThreadWakeRequestTime =
+      std::chrono::steady_clock::now().time_since_epoch().count();
+   if (!mMidiThreadWakeRequested.exchange(true))
+      mMidiThreadWakeCondition.notify_one();
+}
+
+void AudioIO::WaitForMidiThreadWork(int ms)
+{
+   std::unique_lock<std::mutex> lock{ mMidiThreadWakeMutex };
+   const bool woken =
+      mMidiThreadWakeCondition.wait_for(lock, std::chrono::milliseconds(ms),
+         [this]{ return mMidiThreadWakeRequested.load(); });
+   mMidiThreadWakeRequested = false;
+   lock.unlock();
+
+   if (woken) {
+      const auto now =
+         std::chrono::steady_clock::now().time_since_epoch().count();
+      const double millis =
+         std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::duration(
+               now - mMidiThreadWakeRequestTime.load())).count();
+      ++mTelemetry.midiWakes;
+      mTelemetry.totalMidiWakeMillis =
+         mTelemetry.totalMidiWakeMillis.load() + millis;
+      AtomicMax(mTelemetry.maxMidiWakeMillis, millis);
+   }
+}
+#endif
 
 #ifdef EXPERIMENTAL_MIDI_OUT
 MidiThread::ExitCode MidiThread::Entry()
@@ -3287,7 +3940,14 @@ MidiThread::ExitCode MidiThread::Entry()
          gAudioIO->FillMidiBuffers();
       }
       gAudioIO->mMidiThreadFillBuffersLoopActive = false;
+      // The callback wakes this thread when the audio time reaches the next
+      // event, so that it is written with all of its lead, and not up to
+      // MIDI_SLEEP later; the timeout still notices pauses and the end
+#ifdef USE_MIDI_THREAD
+      gAudioIO->WaitForMidiThreadWork(MIDI_SLEEP);
+#else
       Sleep(MIDI_SLEEP);
+#endif
    }
    return 0;
 }
@@ -3679,6 +4339,207 @@ wxString AudioIO::GetDeviceInfo()
    return o.GetString();
 }
 
+void AudioIO::TelemetryCounters::Reset()
+{
+   for (auto &count : callbackLoad)
+      count = 0;
+   callbacks = 0;
+   maxCallbackMillis = 0;
+   for (auto &count : playbackFill)
+      count = 0;
+   for (auto &count : captureFill)
+      count = 0;
+   for (auto &count : fillBuffersMillis)
+      count = 0;
+   maxFillBuffersMillis = 0;
+   playbackUnderruns = 0;
+   captureOverruns = 0;
+   deviceUnderflows = 0;
+   deviceOverflows = 0;
+   inputLatencyMillis = 0;
+   outputLatencyMillis = 0;
+   lastDriftMillis = 0;
+   maxDriftMillis = 0;
+   lastCallbackFrames = 0;
+   midiEvents = 0;
+   midiLateEvents = 0;
+   minMidiLeadMillis = 0;
+   midiWakes = 0;
+   totalMidiWakeMillis = 0;
+   maxMidiWakeMillis = 0;
+   firstDeviceTime = -1;
+   framesSinceFirst = 0;
+}
+
+void AudioIO::NoteCallbackTelemetry(unsigned long framesPerBuffer,
+   const PaStreamCallbackTimeInfo *timeInfo,
+   PaStreamCallbackFlags statusFlags, double millis)
+{
+   auto &telemetry = mTelemetry;
+
+   ++telemetry.callbacks;
+   telemetry.lastCallbackFrames = framesPerBuffer;
+   const double periodMillis = 1000.0 * framesPerBuffer / mRate;
+   if (periodMillis > 0) {
+      const double bounds[] = { 25, 50, 75, 100, 150 };
+      ++telemetry.callbackLoad[
+         TelemetryBucket(100.0 * millis / periodMillis, bounds)];
+   }
+   AtomicMax(telemetry.maxCallbackMillis, millis);
+
+   if (statusFlags & (paOutputUnderflow | paInputUnderflow))
+      ++telemetry.deviceUnderflows;
+   if (statusFlags & (paOutputOverflow | paInputOverflow))
+      ++telemetry.deviceOverflows;
+
+   // In fifths of what the first channel's buffer can hold
+   const auto fifth = [](RingBuffer &buffer) {
+      const auto capacity = buffer.GetCapacity();
+      return std::min<size_t>(Telemetry::nFillBuckets - 1,
+         Telemetry::nFillBuckets * buffer.AvailForGet() / capacity);
+   };
+   if (mStreamToken > 0) {
+      if (mPlaybackBuffers && !mPlaybackTracks.empty())
+         ++telemetry.playbackFill[fifth(*mPlaybackBuffers[0])];
+      if (mCaptureBuffers && !mCaptureTracks.empty())
+         ++telemetry.captureFill[fifth(*mCaptureBuffers[0])];
+   }
+
+   // Compare the device's clock with the count of frames it has taken;
+   // some host APIs give no times
+   const double deviceTime = !timeInfo ? 0
+      : mNumPlaybackChannels > 0 ? timeInfo->outputBufferDacTime
+      : timeInfo->inputBufferAdcTime;
+   if (deviceTime > 0) {
+      if (telemetry.firstDeviceTime < 0)
+         telemetry.firstDeviceTime = deviceTime;
+      else {
+         const double drift = 1000.0 *
+            ((deviceTime - telemetry.firstDeviceTime) -
+             telemetry.framesSinceFirst / mRate);
+         telemetry.lastDriftMillis = drift;
+         AtomicMax(telemetry.maxDriftMillis, std::abs(drift));
+      }
+      telemetry.framesSinceFirst += framesPerBuffer;
+   }
+}
+
+AudioIO::Telemetry AudioIO::GetTelemetry() const
+{
+   const auto &counters = mTelemetry;
+   Telemetry result;
+   for (size_t ii = 0; ii < Telemetry::nLoadBuckets; ++ii)
+      result.callbackLoad[ii] = counters.callbackLoad[ii];
+   result.callbacks = counters.callbacks;
+   result.maxCallbackMillis = counters.maxCallbackMillis;
+   for (size_t ii = 0; ii < Telemetry::nFillBuckets; ++ii) {
+      result.playbackFill[ii] = counters.playbackFill[ii];
+      result.captureFill[ii] = counters.captureFill[ii];
+   }
+   for (size_t ii = 0; ii < Telemetry::nFillBuffersBuckets; ++ii)
+      result.fillBuffersMillis[ii] = counters.fillBuffersMillis[ii];
+   result.maxFillBuffersMillis = counters.maxFillBuffersMillis;
+   result.playbackUnderruns = counters.playbackUnderruns;
+   result.captureOverruns = counters.captureOverruns;
+   result.deviceUnderflows = counters.deviceUnderflows;
+   result.deviceOverflows = counters.deviceOverflows;
+   result.lostSamples = mLostSamples;
+   result.inputLatencyMillis = counters.inputLatencyMillis;
+   result.outputLatencyMillis = counters.outputLatencyMillis;
+   result.lastDriftMillis = counters.lastDriftMillis;
+   result.maxDriftMillis = counters.maxDriftMillis;
+   result.monitorLatencyMillis =
+      (mSoftwarePlaythrough && mNumCaptureChannels > 0 && mRate > 0)
+         ? result.inputLatencyMillis + result.outputLatencyMillis +
+              1000.0 * counters.lastCallbackFrames / mRate
+         : 0.0;
+   result.midiEvents = counters.midiEvents;
+   result.midiLateEvents = counters.midiLateEvents;
+   result.minMidiLeadMillis = counters.minMidiLeadMillis;
+   result.midiWakes = counters.midiWakes;
+   result.meanMidiWakeMillis = result.midiWakes > 0
+      ? counters.totalMidiWakeMillis / result.midiWakes
+      : 0.0;
+   result.maxMidiWakeMillis = counters.maxMidiWakeMillis;
+
+   const auto statistics =
+      mNullStream ? mNullStream->GetStatistics() : mNullStatistics;
+   result.nullAudioSeconds =
+      statistics.rate > 0 ? statistics.frames / statistics.rate : 0.0;
+   result.nullWallSeconds = statistics.wallSeconds;
+   result.nullCallbackSeconds = statistics.callbackSeconds;
+   result.playbackTracks =
+      mNullStream ? mPlaybackTracks.size() : mNullStreamTracks;
+   result.fillThreads = mFillBuffersConcurrency;
+   // Paced, the device and not the tracks limit the rate, so this says
+   // only that the tracks kept up
+   result.tracksPerCore = result.nullWallSeconds > 0
+      ? result.playbackTracks *
+           (result.nullAudioSeconds / result.nullWallSeconds) /
+           std::max<size_t>(1, result.fillThreads)
+      : 0.0;
+   return result;
+}
+
+wxString AudioIO::GetTelemetryReport() const
+{
+   const auto telemetry = GetTelemetry();
+   const auto histogram = [](const unsigned long long *counts, size_t n) {
+      wxString result;
+      for (size_t ii = 0; ii < n; ++ii)
+         result += wxString::Format(wxT(" %llu"), counts[ii]);
+      return result;
+   };
+
+   wxStringOutputStream o;
+   wxTextOutputStream s(o, wxEOL_UNIX);
+   const wxString e(wxT("\n"));
+
+   s << wxT("Since the stream last started:") << e;
+   s << wxString::Format(wxT("Callbacks: %llu, longest %.2f ms"),
+      telemetry.callbacks, telemetry.maxCallbackMillis) << e;
+   s << wxT("Callback time, % of buffer (<25 <50 <75 <100 <150 more):")
+     << histogram(telemetry.callbackLoad, Telemetry::nLoadBuckets) << e;
+   s << wxT("Playback buffer fill, in fifths:")
+     << histogram(telemetry.playbackFill, Telemetry::nFillBuckets) << e;
+   s << wxT("Capture buffer fill, in fifths:")
+     << histogram(telemetry.captureFill, Telemetry::nFillBuckets) << e;
+   s << wxT("FillBuffers ms (<1 <5 <20 <100 <500 more):")
+     << histogram(telemetry.fillBuffersMillis, Telemetry::nFillBuffersBuckets)
+     << wxString::Format(wxT(", longest %.2f ms"),
+           telemetry.maxFillBuffersMillis) << e;
+   s << wxString::Format(wxT("Playback underruns: %llu, capture overruns: %llu, lost samples: %llu"),
+      telemetry.playbackUnderruns, telemetry.captureOverruns,
+      telemetry.lostSamples) << e;
+   s << wxString::Format(wxT("Device underflows: %llu, overflows: %llu"),
+      telemetry.deviceUnderflows, telemetry.deviceOverflows) << e;
+   s << wxString::Format(wxT("Latency: input %.1f ms, output %.1f ms"),
+      telemetry.inputLatencyMillis, telemetry.outputLatencyMillis) << e;
+   s << wxString::Format(wxT("Device clock drift: %.2f ms, most %.2f ms"),
+      telemetry.lastDriftMillis, telemetry.maxDriftMillis) << e;
+   if (telemetry.monitorLatencyMillis > 0)
+      s << wxString::Format(wxT("Playthrough round trip: %.1f ms"),
+         telemetry.monitorLatencyMillis) << e;
+   if (telemetry.midiEvents > 0)
+      s << wxString::Format(wxT("MIDI events: %llu, late %llu, least lead %.1f ms"),
+         telemetry.midiEvents, telemetry.midiLateEvents,
+         telemetry.minMidiLeadMillis) << e;
+   if (telemetry.midiWakes > 0)
+      s << wxString::Format(wxT("MIDI thread wakes: %llu, mean %.2f ms, longest %.2f ms"),
+         telemetry.midiWakes, telemetry.meanMidiWakeMillis,
+         telemetry.maxMidiWakeMillis) << e;
+   if (telemetry.nullWallSeconds > 0)
+      s << wxString::Format(wxT("Null device: %.2f s of audio in %.2f s (%.1fx), callbacks %.2f s; %llu tracks on %llu threads, %.1f tracks per core"),
+         telemetry.nullAudioSeconds, telemetry.nullWallSeconds,
+         telemetry.nullAudioSeconds / telemetry.nullWallSeconds,
+         telemetry.nullCallbackSeconds,
+         (unsigned long long)telemetry.playbackTracks,
+         (unsigned long long)telemetry.fillThreads,
+         telemetry.tracksPerCore) << e;
+
+   return o.GetString();
+}
+
 #ifdef EXPERIMENTAL_MIDI_OUT
 // FIXME: When EXPERIMENTAL_MIDI_IN is added (eventually) this should also be enabled -- Poke
 wxString AudioIO::GetMidiDeviceInfo()
@@ -3783,13 +4644,39 @@ wxString AudioIO::GetMidiDeviceInfo()
 }
 #endif
 
+#ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
+namespace {
+   // How long a change of scrub speed takes, and the steps it is taken in
+   const double ScrubRampSecs = 0.02;
+   const double ScrubRampStepSecs = 0.002;
+}
+
+void AudioIO::SetScrubSpeed(double speed)
+{
+   for (size_t i = 0; i < mPlaybackTracks.size(); i++)
+      mPlaybackMixers[i]->SetSpeed(speed);
+   mScrubSpeed = speed;
+}
+#endif
+
 // This method is the data gateway between the audio thread (which
 // communicates with the disk) and the PortAudio callback thread
 // (which communicates with the audio device).
 void AudioIO::FillBuffers()
 {
+   PROFILE_SCOPE("AudioIO::FillBuffers");
    unsigned int i;
 
+   const auto fillStart = std::chrono::steady_clock::now();
+   auto noteDuration = finally([&]{
+      const std::chrono::duration<double, std::milli> elapsed =
+         std::chrono::steady_clock::now() - fillStart;
+      const double bounds[] = { 1, 5, 20, 100, 500 };
+      ++mTelemetry.fillBuffersMillis[
+         TelemetryBucket(elapsed.count(), bounds)];
+      AtomicMax(mTelemetry.maxFillBuffersMillis, elapsed.count());
+   });
+
    auto delayedHandler = [this] ( AudacityException * pException ) {
       // In the main thread, stop recording
       // This is one place where the application handles disk
@@ -3844,15 +4731,35 @@ void AudioIO::FillBuffers()
          // PRL: or, when scrubbing, we may get work repeatedly from the
          // scrub queue.
          bool done = false;
-         Maybe<wxMutexLocker> cleanup;
+         bool scrubDebtChecked = false;
          do {
             // How many samples to produce for each channel.
             auto frames = available;
             bool progress = true;
 #ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
-            if (mPlayMode == PLAY_SCRUB)
+            if (mPlayMode == PLAY_SCRUB) {
                // scrubbing does not use warped time and length
                frames = limitSampleBufferSize(frames, mScrubDuration);
+               if (mScrubRampDone < mScrubRampLength) {
+                  // Take the ramp in short steps, each at the speed of its
+                  // middle
+                  const auto step = std::max<sampleCount>(1,
+                     lrint(ScrubRampStepSecs * mRate));
+                  frames = limitSampleBufferSize(frames,
+                     std::min(step, mScrubRampLength - mScrubRampDone));
+                  const auto fraction =
+                     (mScrubRampDone.as_double() + frames / 2.0) /
+                        mScrubRampLength.as_double();
+                  SetScrubSpeed(mScrubRampFrom +
+                     (mScrubRampTo - mScrubRampFrom) * fraction);
+                  mScrubRampDone += frames;
+               }
+               else if (mScrubRampLength > 0) {
+                  // Hold the speed after the ramp to the interval's end
+                  SetScrubSpeed(mScrubRampTo);
+                  mScrubRampLength = mScrubRampDone = 0;
+               }
+            }
             else
 #endif
             {
@@ -3874,54 +4781,149 @@ void AudioIO::FillBuffers()
             if (!progress)
                frames = available;
 
-            for (i = 0; i < mPlaybackTracks.size(); i++)
-            {
-               // The mixer here isn't actually mixing: it's just doing
-               // resampling, format conversion, and possibly time track
-               // warping
-               decltype(mPlaybackMixers[i]->Process(frames))
-                  processed = 0;
-               samplePtr warpedSamples;
-               //don't do anything if we have no length.  In particular, Process() will fail an wxAssert
-               //that causes a crash since this is not the GUI thread and wxASSERT is a GUI call.
-
-               // don't generate either if scrubbing at zero speed.
+            // don't generate either if scrubbing at zero speed.
 #ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
-               const bool silent = (mPlayMode == PLAY_SCRUB) && mSilentScrub;
+            const bool silent = (mPlayMode == PLAY_SCRUB) && mSilentScrub;
 #else
-               const bool silent = false;
+            const bool silent = false;
 #endif
 
-               if (progress && !silent && frames > 0)
+            // Prepare the silence once, because the groups share it
+            if (mPlayMode != PLAY_STRAIGHT)
+            {
+               mSilentBuf.Resize(frames, floatSample);
+               ClearSamples(mSilentBuf.ptr(), floatSample, 0, frames);
+            }
+
+            // Realtime effects hold their lock for the whole pass, so the
+            // groups need not take turns
+            const bool lookAhead =
+               mRealtimeLookAhead && progress && !silent && frames > 0;
+            EffectManager &em = EffectManager::Get();
+            if (lookAhead)
+               em.RealtimeProcessStartConcurrent();
+            auto endConcurrent = finally([&]{
+               if (lookAhead)
+                  em.RealtimeProcessEndConcurrent();
+            });
+
+            // Passes of a loop after the first may come from memory
+            const auto cacheState = mLoopCache.GetState();
+            const bool fromCache = cacheState == LoopCache::Ready;
+            const bool capture = cacheState == LoopCache::Capturing;
+
+            // Read what all the tracks need as one batch first, so that the
+            // waits for the disk overlap, instead of the groups' threads
+            // waiting in turn
+            if (progress && !silent && frames > 0 && !fromCache &&
+                mPlaybackTracks.size() > 1)
+            {
+               if (!mPlaybackReads)
+                  mPlaybackReads = std::make_unique<BlockReadBatch>();
+               for (i = 0; i < mPlaybackTracks.size(); i++)
+                  mPlaybackMixers[i]->PlanReads(frames, *mPlaybackReads);
+               mPlaybackReads->Run();
+            }
+
+            // Groups are independent and may be filled in parallel; each
+            // channel advances by the same number of frames, and all are
+            // done before the next pass of the do-loop
+            TaskScheduler::Get().ParallelFor(TaskScheduler::RealtimeAdjacent,
+               mPlaybackGroupStarts.size() - 1,
+               [&](size_t group)
+            {
+               const auto first = mPlaybackGroupStarts[group];
+               const auto end = mPlaybackGroupStarts[group + 1];
+               for (auto i = first; i < end; ++i)
                {
-                  processed = mPlaybackMixers[i]->Process(frames);
-                  wxASSERT(processed <= frames);
-                  warpedSamples = mPlaybackMixers[i]->GetBuffer();
-                  const auto put = mPlaybackBuffers[i]->Put
-                     (warpedSamples, floatSample, processed);
-                  // wxASSERT(put == processed);
-                  // but we can't assert in this thread
-                  wxUnusedVar(put);
+                  // The mixer here isn't actually mixing: it's just doing
+                  // resampling, format conversion, and possibly time track
+                  // warping
+                  decltype(mPlaybackMixers[i]->Process(frames))
+                     processed = 0;
+                  samplePtr warpedSamples;
+                  //don't do anything if we have no length.  In particular, Process() will fail an wxAssert
+                  //that causes a crash since this is not the GUI thread and wxASSERT is a GUI call.
+
+                  if (progress && !silent && frames > 0)
+                  {
+                     if (fromCache)
+                     {
+                        const float *cached;
+                        processed = mLoopCache.Read(i, frames, cached);
+                        warpedSamples = (samplePtr)cached;
+                     }
+                     else
+                     {
+                        processed = mPlaybackMixers[i]->Process(frames);
+                        wxASSERT(processed <= frames);
+                        warpedSamples = mPlaybackMixers[i]->GetBuffer();
+                        if (capture)
+                           mLoopCache.Capture(i, (const float*)warpedSamples,
+                              processed, frames);
+                     }
+                     if (lookAhead)
+                     {
+                        // Put all of the group after its effects, padding a
+                        // short channel so the effects see equal lengths
+                        const auto buffer = mLookAheadBuffers[i].get();
+                        memcpy(buffer, warpedSamples, processed * sizeof(float));
+                        std::fill(buffer + processed, buffer + frames, 0.0f);
+                        processed = frames;
+                     }
+                     else
+                     {
+                        const auto put = mPlaybackBuffers[i]->Put
+                           (warpedSamples, floatSample, processed);
+                        // wxASSERT(put == processed);
+                        // but we can't assert in this thread
+                        wxUnusedVar(put);
+                     }
+                  }
+
+                  //if looping and processed is less than the full chunk/block/buffer that gets pulled from
+                  //other longer tracks, then we still need to advance the ring buffers or
+                  //we'll trip up on ourselves when we start them back up again.
+                  //if not looping we never start them up again, so its okay to not do anything
+                  // If scrubbing, we may be producing some silence.  Otherwise this should not happen,
+                  // but makes sure anyway that we produce equal
+                  // numbers of samples for all channels for this pass of the do-loop.
+                  if(processed < frames && mPlayMode != PLAY_STRAIGHT)
+                  {
+                     const auto put = mPlaybackBuffers[i]->Put
+                        (mSilentBuf.ptr(), floatSample, frames - processed);
+                     // wxASSERT(put == frames - processed);
+                     // but we can't assert in this thread
+                     wxUnusedVar(put);
+                  }
                }
-               
-               //if looping and processed is less than the full chunk/block/buffer that gets pulled from
-               //other longer tracks, then we still need to advance the ring buffers or
-               //we'll trip up on ourselves when we start them back up again.
-               //if not looping we never start them up again, so its okay to not do anything
-               // If scrubbing, we may be producing some silence.  Otherwise this should not happen,
-               // but makes sure anyway that we produce equal
-               // numbers of samples for all channels for this pass of the do-loop.
-               if(processed < frames && mPlayMode != PLAY_STRAIGHT)
+
+               if (lookAhead)
                {
-                  mSilentBuf.Resize(frames, floatSample);
-                  ClearSamples(mSilentBuf.ptr(), floatSample, 0, frames);
-                  const auto put = mPlaybackBuffers[i]->Put
-                     (mSilentBuf.ptr(), floatSample, frames - processed);
-                  // wxASSERT(put == frames - processed);
-                  // but we can't assert in this thread
-                  wxUnusedVar(put);
+                  // The group index matches the processors added at the
+                  // start of the stream, as in audacityAudioCallback
+                  if (mPlaybackTracks[first]->GetSelected())
+                     em.RealtimeProcessConcurrent(group, end - first,
+                        &mLookAheadBufferPtrs[first], frames);
+                  else
+                     // Keep in step with the groups that have effects
+                     for (auto i = first; i < end; ++i)
+                        DelaySamples(*mPlaybackDelays[i],
+                           mLookAheadBufferPtrs[i], frames,
+                           em.GetRealtimeDelay());
+                  for (auto i = first; i < end; ++i)
+                  {
+                     const auto put = mPlaybackBuffers[i]->Put
+                        ((samplePtr)mLookAheadBufferPtrs[i], floatSample, frames);
+                     // wxASSERT(put == frames);
+                     // but we can't assert in this thread
+                     wxUnusedVar(put);
+                  }
                }
-            }
+            }, mFillBuffersConcurrency);
+
+            if (progress && !silent && frames > 0)
+               mLoopCache.Advance(frames);
 
             available -= frames;
             wxASSERT(available >= 0);
@@ -3937,7 +4939,8 @@ void AudioIO::FillBuffers()
                if (!done && mScrubDuration <= 0)
                {
                   sampleCount startSample, endSample;
-                  mScrubQueue->Transformer(startSample, endSample, mScrubDuration, cleanup);
+                  mScrubQueue->Transformer(startSample, endSample, mScrubDuration,
+                     scrubDebtChecked);
                   if (mScrubDuration < 0)
                   {
                      // Can't play anything
@@ -3948,6 +4951,7 @@ void AudioIO::FillBuffers()
                   else
                   {
                      mSilentScrub = (endSample == startSample);
+                     mScrubRampLength = mScrubRampDone = 0;
                      if (!mSilentScrub)
                      {
                         double startTime, endTime, speed;
@@ -3955,9 +4959,35 @@ void AudioIO::FillBuffers()
                         endTime = endSample.as_double() / mRate;
                         auto diff = (endSample - startSample).as_long_long();
                         speed = double(std::abs(diff)) / mScrubDuration.as_double();
+
+                        // Ramp from the speed before, if that went the same
+                        // way.  The speed held after the ramp is chosen so
+                        // that the whole interval still covers diff.
+                        const bool backwards = (diff < 0);
+                        auto initialSpeed = speed;
+                        if (mScrubSpeed > 0 && backwards == mScrubBackwards) {
+                           const auto duration = mScrubDuration.as_double();
+                           const auto length = std::min(floor(duration / 2),
+                              floor(ScrubRampSecs * mRate));
+                           const auto held =
+                              (speed * duration - length * mScrubSpeed / 2) /
+                                 (duration - length / 2);
+                           if (length >= 1 &&
+                               held >= ScrubbingOptions::MinAllowedScrubSpeed() &&
+                               held <= ScrubbingOptions::MaxAllowedScrubSpeed()) {
+                              initialSpeed = mScrubRampFrom = mScrubSpeed;
+                              mScrubRampTo = held;
+                              mScrubRampLength = sampleCount(length);
+                           }
+                        }
+
                         for (i = 0; i < mPlaybackTracks.size(); i++)
-                           mPlaybackMixers[i]->SetTimesAndSpeed(startTime, endTime, speed);
+                           mPlaybackMixers[i]->SetTimesAndSpeed(startTime, endTime, initialSpeed);
+                        mScrubSpeed = initialSpeed;
+                        mScrubBackwards = backwards;
                      }
+                     else
+                        mScrubSpeed = 0.0;
                   }
                }
             }
@@ -3970,8 +5000,15 @@ void AudioIO::FillBuffers()
                // and if yes, restart from the beginning.
                if (mWarpedTime >= mWarpedLength)
                {
-                  for (i = 0; i < mPlaybackTracks.size(); i++)
-                     mPlaybackMixers[i]->Restart();
+                  // The mixers are wanted again only if the pass is not
+                  // kept in memory
+                  const bool restart = mLoopCache.Wrap(
+                     [this](size_t channel, float *buffer, size_t frames){
+                        return RenderLoopPreroll(channel, buffer, frames);
+                     });
+                  if (restart)
+                     for (i = 0; i < mPlaybackTracks.size(); i++)
+                        mPlaybackMixers[i]->Restart();
                   mWarpedTime = 0.0;
                }
             }
@@ -4062,7 +5099,31 @@ void AudioIO::FillBuffers()
                SampleBuffer temp;
                size_t size;
                sampleFormat format;
-               if( mFactor == 1.0 )
+               if( mFactor == 1.0 && !pCrossfadeSrc )
+               {
+                  // Append straight from the ring buffer's memory, which
+                  // holds the track's format, without copying to temp
+                  auto toAppend = std::min<size_t>(toGet,
+                     std::max(0.0, floor(remainingSamples)));
+                  while (toGet > 0) {
+                     size_t got;
+                     const auto region =
+                        mCaptureBuffers[i]->AcquireForGet(got);
+                     got = std::min(got, toGet);
+                     if (got == 0)
+                        break;
+                     const auto appended = std::min(got, toAppend);
+                     if (appended > 0)
+                        mCaptureTracks[i]->Append(region, trackFormat,
+                           appended, 1, &appendLog);
+                     mCaptureBuffers[i]->CommitGet(got);
+                     toAppend -= appended;
+                     toGet -= got;
+                  }
+                  size = 0;
+                  format = trackFormat;
+               }
+               else if( mFactor == 1.0 )
                {
                   // Take captured samples directly
                   size = toGet;
@@ -4124,9 +5185,10 @@ void AudioIO::FillBuffers()
 
                // Now append
                // see comment in second handler about guarantee
-               mCaptureTracks[i]->Append(temp.ptr(), format,
-                  size, 1,
-                  &appendLog);
+               if (size > 0)
+                  mCaptureTracks[i]->Append(temp.ptr(), format,
+                     size, 1,
+                     &appendLog);
 
                if (!appendLog.IsEmpty())
                {
@@ -4177,13 +5239,19 @@ void AudioIO::SetListener(AudioIOListener* listener)
 static Alg_update gAllNotesOff; // special event for loop ending
 // the fields of this event are never used, only the address is important
 
+void AudioIO::ComputeNextEventWarpedTime()
+{
+   if (mTimeTrack)
+      mNextEventWarpedTime =
+         mTimeTrack->ComputeWarpedLength(mT0, mNextEventTime - MidiLoopOffset())
+            + mT0;
+}
+
 double AudioIO::UncorrectedMidiEventTime()
 {
    double time;
    if (mTimeTrack)
-      time =
-         mTimeTrack->ComputeWarpedLength(mT0, mNextEventTime - MidiLoopOffset())
-            + mT0 + (mMidiLoopPasses * mWarpedLength);
+      time = mNextEventWarpedTime + (mMidiLoopPasses * mWarpedLength);
    else
       time = mNextEventTime;
 
@@ -4326,6 +5394,8 @@ void AudioIO::OutputEvent()
          if (timestamp > mMaxMidiTimestamp) {
             mMaxMidiTimestamp = timestamp;
          }
+         if (!mSendMidiState)
+            NoteMidiEventTelemetry(timestamp);
          Pm_WriteShort(mMidiStream, timestamp,
                     Pm_Message((int) (command + channel),
                                   (long) data1, (long) data2));
@@ -4363,6 +5433,21 @@ void AudioIO::GetNextEvent()
       mIterator->end();
       mIterator.reset(); // debugging aid
    }
+   ComputeNextEventWarpedTime();
+}
+
+void AudioIO::NoteMidiEventTelemetry(PmTimestamp timestamp)
+{
+   // Only this thread writes these, so load and store need not be atomic
+   // together
+   auto &telemetry = mTelemetry;
+   const double lead = timestamp - MidiTime();
+   if (telemetry.midiEvents.load() == 0 ||
+       lead < telemetry.minMidiLeadMillis.load())
+      telemetry.minMidiLeadMillis = lead;
+   ++telemetry.midiEvents;
+   if (lead < 0)
+      ++telemetry.midiLateEvents;
 }
 
 
@@ -4381,6 +5466,9 @@ void AudioIO::FillMidiBuffers()
          gAudioIO->mMidiPaused = true;
          gAudioIO->AllNotesOff(); // to avoid hanging notes during pause
       }
+      // Pause frames move the events as fast as the audio time; look again
+      // at the timeout
+      mMidiWakeTime = std::numeric_limits<double>::max();
       return;
    }
 
@@ -4411,14 +5499,19 @@ void AudioIO::FillMidiBuffers()
    // compute-ahead to deal with mSynthLatency or even this thread.
    double actual_latency  = (MIDI_SLEEP + THREAD_LATENCY +
                              MIDI_MINIMAL_LATENCY_MS + mSynthLatency) * 0.001;
+   double ahead = 0;
    if (actual_latency > mAudioOutLatency) {
-       time += actual_latency - mAudioOutLatency;
+       ahead = actual_latency - mAudioOutLatency;
    }
+   time += ahead;
    while (mNextEvent &&
           UncorrectedMidiEventTime() < time) {
       OutputEvent();
       GetNextEvent();
    }
+   mMidiWakeTime = mNextEvent
+      ? UncorrectedMidiEventTime() - ahead
+      : std::numeric_limits<double>::max();
 
    // test for end
    double realTime = gAudioIO->MidiTime() * 0.001 -
@@ -4570,7 +5663,7 @@ bool AudioIO::AILAIsActive() {
 }
 
 void AudioIO::AILASetStartTime() {
-   mAILAAbsolutStartTime = Pa_GetStreamTime(mPortStreamV19);
+   mAILAAbsolutStartTime = GetPortStreamTime();
    wxPrintf("START TIME %f\n\n", mAILAAbsolutStartTime);
 }
 
@@ -4659,7 +5752,7 @@ void AudioIO::AILAProcess(double maxPeak) {
          //if (info)
          //   latency = info->inputLatency;
          //mAILAAnalysisEndTime = mTime+latency;
-         mAILAAnalysisEndTime = Pa_GetStreamTime(mPortStreamV19) - mAILAAbsolutStartTime;
+         mAILAAnalysisEndTime = GetPortStreamTime() - mAILAAbsolutStartTime;
          mAILAMax             = 0;
          wxPrintf("\tA decision was made @ %f\n", mAILAAnalysisEndTime);
          mAILAClipped         = false;
@@ -4720,24 +5813,63 @@ static void DoSoftwarePlaythrough(const void *inputBuffer,
          outputBuffer[2*i + 1] = outputBuffer[2*i];
 }
 
+// Like DoSoftwarePlaythrough, but applying the realtime effects of group to
+// up to two input channels on the way.  Call between RealtimeProcessStart
+// and RealtimeProcessEnd.
+static void DoMonitorWithEffects(const void *inputBuffer,
+                                 sampleFormat inputFormat,
+                                 unsigned inputChannels,
+                                 int group,
+                                 float *outputBuffer,
+                                 size_t len,
+                                 float *scratch)
+{
+   const auto chans = std::min(2u, inputChannels);
+   float *buffers[2];
+   for (unsigned c = 0; c < chans; c++) {
+      // scratch, if not null, holds len samples for each of two channels
+      buffers[c] = scratch
+         ? scratch + c * len
+         : (float *) alloca(len * sizeof(float));
+      CopySamples(((samplePtr)inputBuffer) + (c * SAMPLE_SIZE(inputFormat)),
+                  inputFormat, (samplePtr)buffers[c], floatSample,
+                  len, true, inputChannels, 1);
+   }
+
+   EffectManager::Get().RealtimeProcess(group, chans, buffers, len);
+
+   // One mono input channel goes to both output channels...
+   for (size_t i = 0; i < len; i++) {
+      outputBuffer[2*i] = buffers[0][i];
+      outputBuffer[2*i + 1] = buffers[chans - 1][i];
+   }
+}
+
 int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
                           unsigned long framesPerBuffer,
-// If there were more of these conditionally used arguments, it 
-// could make sense to make a NEW macro that looks like this:
-// USEDIF( EXPERIMENTAL_MIDI_OUT, timeInfo )
-#ifdef EXPERIMENTAL_MIDI_OUT
                           const PaStreamCallbackTimeInfo *timeInfo,
-#else
-                          const PaStreamCallbackTimeInfo * WXUNUSED(timeInfo),
-#endif
                           const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   PROFILE_SCOPE("audacityAudioCallback");
+   sInAudioCallback = true;
+   const auto callbackStart = std::chrono::steady_clock::now();
+   auto leaveCallback = finally([&]{
+      const std::chrono::duration<double, std::milli> elapsed =
+         std::chrono::steady_clock::now() - callbackStart;
+      gAudioIO->NoteCallbackTelemetry(
+         framesPerBuffer, timeInfo, statusFlags, elapsed.count());
+      sInAudioCallback = false;
+   });
    auto numPlaybackChannels = gAudioIO->mNumPlaybackChannels;
    auto numPlaybackTracks = gAudioIO->mPlaybackTracks.size();
    auto numCaptureChannels = gAudioIO->mNumCaptureChannels;
    int callbackReturn = paContinue;
-   void *tempBuffer = alloca(framesPerBuffer*sizeof(float)*
-                             MAX(numCaptureChannels,numPlaybackChannels));
+   auto &scratch = *gAudioIO->mCallbackScratch;
+   // Longer callbacks than the scratch memory was made for use the stack
+   const bool fits = framesPerBuffer <= scratch.frames;
+   void *tempBuffer = fits ? scratch.temp.get() :
+      alloca(framesPerBuffer*sizeof(float)*
+             MAX(numCaptureChannels,numPlaybackChannels));
    float *tempFloats = (float*)tempBuffer;
 
    // output meter may need samples untouched by volume emulation
@@ -4745,7 +5877,8 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
    outputMeterFloats =
       (outputBuffer && gAudioIO->mEmulateMixerOutputVol &&
                        gAudioIO->mMixerOutputVol != 1.0) ?
-         (float *)alloca(framesPerBuffer*numPlaybackChannels * sizeof(float)) :
+         (fits ? scratch.meter.get() :
+            (float *)alloca(framesPerBuffer*numPlaybackChannels * sizeof(float))) :
          (float *)outputBuffer;
 
 #ifdef EXPERIMENTAL_MIDI_OUT
@@ -4825,6 +5958,11 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
 #ifndef USE_MIDI_THREAD
    if (gAudioIO->mMidiStream)
       gAudioIO->FillMidiBuffers();
+#else
+   if (gAudioIO->mMidiStream &&
+       gAudioIO->AudioTime() >=
+          gAudioIO->mMidiWakeTime.load(std::memory_order_relaxed))
+      gAudioIO->WakeMidiThread();
 #endif
 
 #endif
@@ -4923,7 +6061,9 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
          for( i = 0; i < framesPerBuffer*numPlaybackChannels; i++)
             outputFloats[i] = 0.0;
 
-         if (inputBuffer && gAudioIO->mSoftwarePlaythrough) {
+         // With effects, the input is monitored below, once they may run
+         const bool monitorEffects = gAudioIO->mMonitorEffectGroup >= 0;
+         if (inputBuffer && gAudioIO->mSoftwarePlaythrough && !monitorEffects) {
             DoSoftwarePlaythrough(inputBuffer, gAudioIO->mCaptureFormat,
                                   numCaptureChannels,
                                   (float *)outputBuffer, (int)framesPerBuffer);
@@ -4936,65 +6076,29 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             }
          }
 
-#ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
-         // While scrubbing, ignore seek requests
-         if (gAudioIO->mSeek && gAudioIO->mPlayMode == AudioIO::PLAY_SCRUB)
-            gAudioIO->mSeek = 0.0;
-         else
-#endif
-         if (gAudioIO->mSeek)
+         if (gAudioIO->mSeekState.load(std::memory_order_acquire) !=
+             AudioIO::SeekIdle)
          {
-            int token = gAudioIO->mStreamToken;
-            wxMutexLocker locker(gAudioIO->mSuspendAudioThread);
-            if (token != gAudioIO->mStreamToken)
-               // This stream got destroyed while we waited for it
-               return paAbort;
-
-            // Pause audio thread and wait for it to finish
-            gAudioIO->mAudioThreadFillBuffersLoopRunning = false;
-            while( gAudioIO->mAudioThreadFillBuffersLoopActive == true )
-            {
-               wxMilliSleep( 50 );
-            }
-
-            // Calculate the NEW time position
-            gAudioIO->mTime += gAudioIO->mSeek;
-            gAudioIO->mTime = gAudioIO->LimitStreamTime(gAudioIO->mTime);
-            gAudioIO->mSeek = 0.0;
-
-            // Reset mixer positions and flush buffers for all tracks
-            if(gAudioIO->mTimeTrack)
-               // Following gives negative when mT0 > mTime
-               gAudioIO->mWarpedTime =
-                  gAudioIO->mTimeTrack->ComputeWarpedLength
-                     (gAudioIO->mT0, gAudioIO->mTime);
-            else
-               gAudioIO->mWarpedTime = gAudioIO->mTime - gAudioIO->mT0;
-            gAudioIO->mWarpedTime = std::abs(gAudioIO->mWarpedTime);
-
-            // Reset mixer positions and flush buffers for all tracks
-            for (i = 0; i < numPlaybackTracks; i++)
+            // The audio thread is moving the play position.  Drop what the
+            // ring buffers hold, since only this thread may take from them,
+            // then play silence until it has refilled them.
+            if (gAudioIO->mSeekState.load(std::memory_order_relaxed) ==
+                AudioIO::SeekFlushRequested)
             {
-               gAudioIO->mPlaybackMixers[i]->Reposition(gAudioIO->mTime);
-               const auto toDiscard =
-                  gAudioIO->mPlaybackBuffers[i]->AvailForGet();
-               const auto discarded =
-                  gAudioIO->mPlaybackBuffers[i]->Discard( toDiscard );
-               // wxASSERT( discarded == toDiscard );
-               // but we can't assert in this thread
-               wxUnusedVar(discarded);
-            }
-
-            // Reload the ring buffers
-            gAudioIO->mAudioThreadShouldCallFillBuffersOnce = true;
-            while( gAudioIO->mAudioThreadShouldCallFillBuffersOnce == true )
-            {
-               wxMilliSleep( 50 );
+               for (i = 0; i < numPlaybackTracks; i++)
+               {
+                  const auto toDiscard =
+                     gAudioIO->mPlaybackBuffers[i]->AvailForGet();
+                  const auto discarded =
+                     gAudioIO->mPlaybackBuffers[i]->Discard( toDiscard );
+                  // wxASSERT( discarded == toDiscard );
+                  // but we can't assert in this thread
+                  wxUnusedVar(discarded);
+               }
+               gAudioIO->mSeekState.store(AudioIO::SeekFlushed,
+                  std::memory_order_release);
             }
 
-            // Reenable the audio thread
-            gAudioIO->mAudioThreadFillBuffersLoopRunning = true;
-
             return paContinue;
          }
 
@@ -5009,20 +6113,89 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
                numSolo++;
 #endif
 
-         const WaveTrack **chans = (const WaveTrack **) alloca(numPlaybackChannels * sizeof(WaveTrack *));
-         float **tempBufs = (float **) alloca(numPlaybackChannels * sizeof(float *));
+         const WaveTrack **chans = scratch.chans.get();
+         float **tempBufs = scratch.tempBufs.get();
+         float **scratchBufs = scratch.scratchBufs.get();
+         // When a channel's samples are read in place from its ring buffer,
+         // consumption is committed only after they are mixed
+         RingBuffer **pendingCommits = scratch.pendingCommits.get();
          for (unsigned int c = 0; c < numPlaybackChannels; c++)
          {
-            tempBufs[c] = (float *) alloca(framesPerBuffer * sizeof(float));
+            tempBufs[c] = scratchBufs[c] = fits
+               ? scratch.channels.get() + c * scratch.frames
+               : (float *) alloca(framesPerBuffer * sizeof(float));
+            pendingCommits[c] = nullptr;
          }
 
+         // Unless the audio thread has processed them already
+         const bool processEffects = !gAudioIO->mRealtimeLookAhead;
          EffectManager & em = EffectManager::Get();
-         em.RealtimeProcessStart();
+         if (processEffects)
+            em.RealtimeProcessStart();
+
+         if (inputBuffer && gAudioIO->mSoftwarePlaythrough && monitorEffects) {
+            // The monitored input goes through the effects in this callback,
+            // so it is no later than without them
+            DoMonitorWithEffects(inputBuffer, gAudioIO->mCaptureFormat,
+               numCaptureChannels, gAudioIO->mMonitorEffectGroup,
+               outputFloats, framesPerBuffer,
+               fits ? scratch.monitor.get() : nullptr);
+            if (outputMeterFloats != outputFloats)
+               for (i = 0; i < framesPerBuffer*numPlaybackChannels; ++i)
+                  outputMeterFloats[i] = outputFloats[i];
+         }
 
          bool selected = false;
          int group = 0;
          int chanCnt = 0;
          decltype(framesPerBuffer) maxLen = 0;
+         bool anyAudible = false;
+
+         // Groups whose samples all lie whole in their ring buffers can have
+         // their effects applied there first, on the realtime workers at
+         // once, instead of one after another below
+         const auto nGroups = gAudioIO->mPlaybackGroupStarts.empty()
+            ? 0 : gAudioIO->mPlaybackGroupStarts.size() - 1;
+         bool *processedAhead = scratch.processedAhead.get();
+         std::fill(processedAhead, processedAhead + nGroups, false);
+         if (processEffects && nGroups > 1)
+         {
+            auto groups = scratch.groups.get();
+            auto groupBufs = scratch.groupBufs.get();
+            size_t nReady = 0;
+            for (size_t g = 0; g < nGroups; ++g)
+            {
+               const auto first = gAudioIO->mPlaybackGroupStarts[g];
+               const auto end = gAudioIO->mPlaybackGroupStarts[g + 1];
+               const WaveTrack *vt = gAudioIO->mPlaybackTracks[first].get();
+               // As below
+               if ((numSolo > 0 && !vt->GetSolo()) ||
+                   (vt->GetMute() && !vt->GetSolo()) ||
+                   !vt->GetSelected())
+                  continue;
+
+               bool whole = true;
+               for (auto i = first; whole && i < end; ++i)
+               {
+                  size_t avail = 0;
+                  groupBufs[i] = (float *)
+                     gAudioIO->mPlaybackBuffers[i]->AcquireForGet(avail);
+                  whole = (avail >= framesPerBuffer);
+               }
+               if (!whole)
+                  continue;
+
+               groups[nReady++] = { (int)g, (unsigned)(end - first),
+                                    &groupBufs[first], framesPerBuffer };
+               processedAhead[g] = true;
+            }
+            if (nReady > 1)
+               em.RealtimeProcessGroups(groups, nReady);
+            else
+               // Not worth it; leave them to the loop
+               std::fill(processedAhead, processedAhead + nGroups, false);
+         }
+
          for (unsigned t = 0; t < numPlaybackTracks; t++)
          {
             const WaveTrack *vt = gAudioIO->mPlaybackTracks[t].get();
@@ -5045,6 +6218,10 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
                linkFlag = vt->GetLinked();
                selected = vt->GetSelected();
 
+               // Previous group may have left pointers into ring buffers
+               for (unsigned int c = 0; c < numPlaybackChannels; c++)
+                  tempBufs[c] = scratchBufs[c];
+
                // If we have a mono track, clear the right channel
                if (!linkFlag)
                {
@@ -5064,13 +6241,28 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             }
             else
             {
-               len = gAudioIO->mPlaybackBuffers[t]->Get((samplePtr)tempBufs[chanCnt],
-                                                         floatSample,
-                                                         framesPerBuffer);
-               if (len < framesPerBuffer)
-                  // Pad with zeroes to the end, in case of a short channel
-                  memset((void*)&tempBufs[chanCnt][len], 0,
-                     (framesPerBuffer - len) * sizeof(float));
+               anyAudible = true;
+               auto &ringBuffer = *gAudioIO->mPlaybackBuffers[t];
+               size_t avail = 0;
+               const auto direct = ringBuffer.AcquireForGet(avail);
+               if (avail >= framesPerBuffer) {
+                  // Whole buffer is contiguous:  process and mix it where it
+                  // lies, without copying
+                  tempBufs[chanCnt] = (float *)direct;
+                  pendingCommits[chanCnt] = &ringBuffer;
+                  len = framesPerBuffer;
+               }
+               else {
+                  // Wrapped around, or short
+                  pendingCommits[chanCnt] = nullptr;
+                  len = ringBuffer.Get((samplePtr)tempBufs[chanCnt],
+                                       floatSample,
+                                       framesPerBuffer);
+                  if (len < framesPerBuffer)
+                     // Pad with zeroes to the end, in case of a short channel
+                     memset((void*)&tempBufs[chanCnt][len], 0,
+                        (framesPerBuffer - len) * sizeof(float));
+               }
 
                chanCnt++;
             }
@@ -5112,10 +6304,18 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             // Last channel seen now
             len = maxLen;
 
-            if( !cut && selected )
+            if( !cut && selected && processEffects && !processedAhead[group] )
             {
                len = em.RealtimeProcess(group, chanCnt, tempBufs, len);
             }
+            else if( !cut && !selected && processEffects )
+            {
+               // Keep in step with the groups that have effects
+               const auto delay = em.GetRealtimeDelay();
+               for (int c = 0; c < chanCnt; ++c)
+                  DelaySamples(*gAudioIO->mPlaybackDelays[t + 1 - chanCnt + c],
+                     tempBufs[c], len, delay);
+            }
             group++;
 
             // If our buffer is empty and the time indicator is past
@@ -5181,8 +6381,21 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
                }
             }
 
+            // Done with any samples read in place
+            for (int c = 0; c < chanCnt; c++)
+               if (pendingCommits[c]) {
+                  pendingCommits[c]->CommitGet(framesPerBuffer);
+                  pendingCommits[c] = nullptr;
+               }
+
             chanCnt = 0;
          }
+         // Short of samples, though the audio thread has more to give
+         if (anyAudible && maxLen < framesPerBuffer &&
+             (gAudioIO->mPlayMode != AudioIO::PLAY_STRAIGHT ||
+              gAudioIO->mWarpedTime < gAudioIO->mWarpedLength))
+            ++gAudioIO->mTelemetry.playbackUnderruns;
+
          // Poke: If there are no playback tracks, then the earlier check
          // about the time indicator being passed the end won't happen;
          // do it here instead (but not if looping or scrubbing)
@@ -5210,7 +6423,8 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             gAudioIO->mTime = gAudioIO->mScrubQueue->Consumer(maxLen);
 #endif
 
-         em.RealtimeProcessEnd();
+         if (processEffects)
+            em.RealtimeProcessEnd();
 
          gAudioIO->mLastPlaybackTimeMillis = ::wxGetLocalTimeMillis();
 
@@ -5290,11 +6504,18 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
 
          if (len < framesPerBuffer)
          {
+            ++gAudioIO->mTelemetry.captureOverruns;
             gAudioIO->mLostSamples += (framesPerBuffer - len);
             wxPrintf(wxT("lost %d samples\n"), (int)(framesPerBuffer - len));
          }
 
-         if (len > 0) {
+         if (len > 0 &&
+             !DeinterleaveCapture(inputBuffer, gAudioIO->mCaptureFormat,
+                gAudioIO->mCaptureBuffers,
+                gAudioIO->mCaptureDestinations.get(),
+                numCaptureChannels, len)) {
+            // The tracks want samples in another format; convert a channel
+            // at a time
             for(unsigned t = 0; t < numCaptureChannels; t++) {
 
                // dmazzoni:
@@ -5394,7 +6615,7 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             gAudioIO->mLastRecordingOffset = timeInfo->inputBufferAdcTime - timeInfo->outputBufferDacTime;
          else if (gAudioIO->mLastRecordingOffset == 0.0)
          {
-            const PaStreamInfo* si = Pa_GetStreamInfo( gAudioIO->mPortStreamV19 );
+            const PaStreamInfo* si = gAudioIO->GetPortStreamInfo();
             gAudioIO->mLastRecordingOffset = -si->inputLatency;
          }
       }
@@ -5460,6 +6681,17 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
       gAudioIO->mUpdatingMeters = false;
    }  // end playback VU meter update
 
+   // Wake the audio thread only when FillBuffers would find enough to do
+   if (callbackReturn == paContinue &&
+       gAudioIO->mAudioThreadFillBuffersLoopRunning &&
+       ((gAudioIO->mPlaybackTracks.size() > 0 &&
+         gAudioIO->GetCommonlyAvailPlayback() >=
+            gAudioIO->mPlaybackSamplesToCopy) ||
+        (gAudioIO->mCaptureTracks.size() > 0 &&
+         gAudioIO->GetCommonlyAvailCapture() >=
+            gAudioIO->mMinCaptureSecsToCopy * gAudioIO->mRate)))
+      gAudioIO->WakeAudioThread();
+
    return callbackReturn;
 }
 
@@ -17,7 +17,12 @@
 #include "Audacity.h"
 #include "Experimental.h"
 
+#include "LoopCache.h"
 #include "MemoryX.h"
+#include "NullAudioStream.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <utility>
 #include <vector>
 #include <wx/atomic.h>
@@ -55,6 +60,7 @@ class AudioIO;
 class RingBuffer;
 class Mixer;
 class Resample;
+class BlockReadBatch;
 class TimeTrack;
 class AudioThread;
 class MeterPanel;
@@ -68,12 +74,32 @@ using WaveTrackConstArray = std::vector < std::shared_ptr < const WaveTrack > >;
 
 extern AUDACITY_DLL_API AudioIO *gAudioIO;
 
+// Begins the enumeration of devices, which can be slow, ahead of
+// InitAudioIO(), where the platform allows it to be on another thread
+void StartAudioIOInitialization();
 void InitAudioIO();
 void DeinitAudioIO();
 wxString DeviceName(const PaDeviceInfo* info);
 wxString HostName(const PaDeviceInfo* info);
 bool ValidateDeviceNames();
 
+/// Whether the calling thread is running audacityAudioCallback, which must
+/// never wait for another thread
+bool IsAudioCallbackThread();
+
+/// Put this before anything that may block, such as taking a lock or
+/// sleeping.  In debug builds, a call from the audio callback is recorded,
+/// and AudioIO::StopStream() asserts that there were none; asserting in the
+/// callback itself could block it.
+#ifdef __WXDEBUG__
+void NoteBlockingAudioCallback(const char *file, int line);
+#define ASSERT_NOT_AUDIO_CALLBACK() \
+   (IsAudioCallbackThread() ? NoteBlockingAudioCallback(__FILE__, __LINE__) \
+      : (void)0)
+#else
+#define ASSERT_NOT_AUDIO_CALLBACK() ((void)0)
+#endif
+
 class AudioIOListener;
 
 // #include <cfloat> if you need this constant
@@ -206,7 +232,10 @@ class AUDACITY_DLL_API AudioIO final {
    void StopStream();
    /** \brief Move the playback / recording position of the current stream
     * by the specified amount from where it is now */
-   void SeekStream(double seconds) { mSeek = seconds; }
+   void SeekStream(double seconds);
+   /** \brief The tracks changed, so that a loop kept in memory must be
+    * mixed again, from the next pass */
+   void InvalidateLoopCache() { mLoopCache.Invalidate(); }
 
 #ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
    bool IsScrubbing() { return IsBusy() && mScrubQueue != 0; }
@@ -419,6 +448,73 @@ class AUDACITY_DLL_API AudioIO final {
    wxString GetMidiDeviceInfo();
 #endif
 
+   /** \brief Counts of the health of the stream since it last started, for
+    * telling whether glitches come from the disk, the processor or the device
+    */
+   struct Telemetry
+   {
+      // Callback durations, in percent of the buffer they fill:
+      // under 25, 50, 75, 100, 150, and more; the last two are overruns
+      enum { nLoadBuckets = 6 };
+      unsigned long long callbackLoad[nLoadBuckets];
+      unsigned long long callbacks;
+      double maxCallbackMillis;
+
+      // Fill levels of the ring buffers at each callback, in fifths
+      enum { nFillBuckets = 5 };
+      unsigned long long playbackFill[nFillBuckets];
+      unsigned long long captureFill[nFillBuckets];
+
+      // FillBuffers durations in ms: under 1, 5, 20, 100, 500, and more
+      enum { nFillBuffersBuckets = 6 };
+      unsigned long long fillBuffersMillis[nFillBuffersBuckets];
+      double maxFillBuffersMillis;
+
+      // Playback buffers that ran short before the end, and capture
+      // buffers that had no room, because FillBuffers fell behind
+      unsigned long long playbackUnderruns;
+      unsigned long long captureOverruns;
+      // As PortAudio reports them, from the device
+      unsigned long long deviceUnderflows;
+      unsigned long long deviceOverflows;
+      unsigned long long lostSamples;
+
+      // As PortAudio reports them, in ms
+      double inputLatencyMillis;
+      double outputLatencyMillis;
+      // How far the device clock strayed from the samples it took, in ms
+      double lastDriftMillis;
+      double maxDriftMillis;
+      // From input to output in software playthrough, in ms, or 0 if none:
+      // both latencies and one callback buffer
+      double monitorLatencyMillis;
+
+      // MIDI events written with a timestamp, and those written after it
+      // had passed, which play late; the least time by which a timestamp
+      // led the writing, in ms, or 0 if none
+      unsigned long long midiEvents;
+      unsigned long long midiLateEvents;
+      double minMidiLeadMillis;
+      // How long the MIDI thread took to wake when an event came due, in ms
+      unsigned long long midiWakes;
+      double meanMidiWakeMillis;
+      double maxMidiWakeMillis;
+
+      // With the null device only:  seconds of audio called back for, and
+      // of the wall clock that took, with the playback tracks and the
+      // threads filling them; and so how many tracks each thread could
+      // sustain in real time.  Wall seconds are 0 otherwise.
+      double nullAudioSeconds;
+      double nullWallSeconds;
+      double nullCallbackSeconds;
+      size_t playbackTracks;
+      size_t fillThreads;
+      double tracksPerCore;
+   };
+   Telemetry GetTelemetry() const;
+   /** \brief GetTelemetry() as text, for showing to people */
+   wxString GetTelemetryReport() const;
+
    /** \brief Ensure selected device names are valid
     *
     */
@@ -471,8 +567,43 @@ private:
                              unsigned int numPlaybackChannels,
                              unsigned int numCaptureChannels,
                              sampleFormat captureFormat);
+   /// Opens mNullStream, in place of a device, for StartPortAudioStream
+   bool OpenNullStream(unsigned int numPlaybackChannels,
+                       unsigned int numCaptureChannels,
+                       bool paced, unsigned long framesPerBuffer);
+   /// Whether the playback buffers hold the next callback's frames, or
+   /// will get no more; for the unpaced null device
+   bool NullStreamReady(unsigned long framesPerBuffer) const;
+
+   // Pa_ functions on mPortStreamV19, or on mNullStream if that is open
+   PaError StartPortStream();
+   /// Aborts and closes the stream, and nulls mPortStreamV19
+   void ClosePortStream();
+   bool IsPortStreamStopped() const;
+   bool IsPortStreamActive() const;
+   double GetPortStreamTime() const;
+   const PaStreamInfo *GetPortStreamInfo() const;
    void FillBuffers();
 
+   /** \brief Tell the audio thread there is work for FillBuffers.
+    *
+    * Safe to call from the PortAudio callback; it takes no lock, so a
+    * wakeup may be missed, but then WaitForAudioThreadWork times out. */
+   void WakeAudioThread();
+   /// Block the audio thread until woken, or for at most ms milliseconds
+   void WaitForAudioThreadWork(int ms);
+   /// Move the play position by mSeek, in the audio thread.  The callback
+   /// flushes the ring buffers for it, without waiting on any lock.
+   void ApplySeek();
+
+#if defined(EXPERIMENTAL_MIDI_OUT) && defined(USE_MIDI_THREAD)
+   /// Tell the MIDI thread an event is due; safe from the callback, as
+   /// WakeAudioThread is
+   void WakeMidiThread();
+   /// Block the MIDI thread until woken, or for at most ms milliseconds
+   void WaitForMidiThreadWork(int ms);
+#endif
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    void PrepareMidiIterator(bool send = true, double offset = 0);
    bool StartPortMidiStream();
@@ -480,9 +611,15 @@ private:
    // Compute nondecreasing time stamps, accounting for pauses, but not the
    // synth latency.
    double UncorrectedMidiEventTime();
+   // Warp mNextEventTime by the time track once, when it is set, and not
+   // at each test of UncorrectedMidiEventTime()
+   void ComputeNextEventWarpedTime();
 
    void OutputEvent();
+   // Sets mMidiWakeTime, when the next event is due
    void FillMidiBuffers();
+   // Count the event in mTelemetry, before it is written
+   void NoteMidiEventTelemetry(PmTimestamp timestamp);
    void GetNextEvent();
    double AudioTime() { return mT0 + mNumFrames / mRate; }
    double PauseTime();
@@ -550,6 +687,13 @@ private:
     */
    double LimitStreamTime(double absoluteTime) const;
 
+   /** \brief Has the block files of the playback tracks read ahead of the
+    * play head, from the given time, so that the first reads after a start
+    * or a seek do not wait on the disk */
+   void PrefetchPlayback(double absoluteTime);
+   /** \brief The LoopCache::Preroll for playback channel, before mT0 */
+   bool RenderLoopPreroll(size_t channel, float *buffer, size_t frames);
+
    /** \brief Normalizes the given time, clamping it and handling gaps from cut preview.
     *
     * Clamps the time (unless scrubbing), and skips over the cut section.
@@ -562,6 +706,9 @@ private:
      *
      * If bOnlyBuffers is specified, it only cleans up the buffers. */
    void StartStreamCleanup(bool bOnlyBuffers = false);
+   /// Makes the memory that audacityAudioCallback uses, for the channels
+   /// and tracks of the stream, before it starts
+   void AllocateCallbackScratch();
 
    PRCrossfadeData     mCrossfadeData{};
 
@@ -627,6 +774,9 @@ private:
    /// Time at which the next event should be output, measured in seconds.
    /// Note that this could be a note's time+duration for note offs.
    double           mNextEventTime;
+   /// mNextEventTime warped by the time track, from the start of the loop
+   /// pass, but not counting pauses
+   double           mNextEventWarpedTime;
    /// Track of next event
    NoteTrack        *mNextEventTrack;
    /// True when output reaches mT1
@@ -666,11 +816,37 @@ private:
 #endif
    ArrayOf<std::unique_ptr<Resample>> mResample;
    ArrayOf<std::unique_ptr<RingBuffer>> mCaptureBuffers;
+   /// Where the callback writes each capture channel, for one pass over
+   /// the interleaved input
+   ArrayOf<samplePtr> mCaptureDestinations;
    WaveTrackArray      mCaptureTracks;
    ArrayOf<std::unique_ptr<RingBuffer>> mPlaybackBuffers;
    WaveTrackConstArray mPlaybackTracks;
 
    ArrayOf<std::unique_ptr<Mixer>> mPlaybackMixers;
+   // Reused by each pass of FillBuffers, for the reads of all the mixers
+   std::unique_ptr<BlockReadBatch> mPlaybackReads;
+   /// Passes of looped play after the first, from memory
+   LoopCache           mLoopCache;
+   /// Indices into mPlaybackTracks where each group of linked channels
+   /// begins, followed by the number of tracks
+   std::vector<size_t> mPlaybackGroupStarts;
+   /// Threads, counting the audio thread, that fill the ring buffers of the
+   /// groups in parallel
+   unsigned mFillBuffersConcurrency{ 1 };
+   /// True if realtime effects are processed in FillBuffers, a buffer
+   /// ahead, rather than in the PortAudio callback
+   bool                mRealtimeLookAhead{ false };
+   /// When mRealtimeLookAhead, the mixed samples of each channel wait
+   /// here until the effects of their group have processed them
+   ArrayOf<Floats>     mLookAheadBuffers;
+   ArrayOf<float *>    mLookAheadBufferPtrs;
+   /// Delays each channel of a group that the realtime effects don't
+   /// process, by as much as they delay the others
+   ArrayOf<std::unique_ptr<RingBuffer>> mPlaybackDelays;
+   /// So that the callback neither allocates nor puts much on the stack
+   struct CallbackScratch;
+   std::unique_ptr<CallbackScratch> mCallbackScratch;
    volatile int        mStreamToken;
    static int          mNextStreamToken;
    double              mFactor;
@@ -701,7 +877,16 @@ private:
    /// True if audio playback is paused
    bool                mPaused;
    PaStream           *mPortStreamV19;
+   /// Stands in for a device when /AudioIO/NullDevice is set; then
+   /// mPortStreamV19 points to it, for the tests of whether a stream is open
+   std::unique_ptr<NullAudioStream> mNullStream;
+   /// Of the last null stream, kept for GetTelemetry() after it closes
+   NullAudioStream::Statistics mNullStatistics;
+   size_t              mNullStreamTracks{ 0 };
    bool                mSoftwarePlaythrough;
+   /// Realtime effects group for the monitored input in software
+   /// playthrough, or -1 if it passes unprocessed
+   int                 mMonitorEffectGroup{ -1 };
    /// True if Sound Activated Recording is enabled
    bool                mPauseRec;
    float               mSilenceLevel;
@@ -709,15 +894,74 @@ private:
    unsigned int        mNumPlaybackChannels;
    sampleFormat        mCaptureFormat;
    unsigned long long  mLostSamples{ 0 };
+
+   // Updated atomically by the callback and the audio thread, for
+   // GetTelemetry()
+   struct TelemetryCounters
+   {
+      void Reset();
+
+      std::atomic<unsigned long long> callbackLoad[Telemetry::nLoadBuckets];
+      std::atomic<unsigned long long> callbacks;
+      std::atomic<double> maxCallbackMillis;
+      std::atomic<unsigned long long> playbackFill[Telemetry::nFillBuckets];
+      std::atomic<unsigned long long> captureFill[Telemetry::nFillBuckets];
+      std::atomic<unsigned long long>
+         fillBuffersMillis[Telemetry::nFillBuffersBuckets];
+      std::atomic<double> maxFillBuffersMillis;
+      std::atomic<unsigned long long> playbackUnderruns;
+      std::atomic<unsigned long long> captureOverruns;
+      std::atomic<unsigned long long> deviceUnderflows;
+      std::atomic<unsigned long long> deviceOverflows;
+      std::atomic<double> inputLatencyMillis;
+      std::atomic<double> outputLatencyMillis;
+      std::atomic<double> lastDriftMillis;
+      std::atomic<double> maxDriftMillis;
+      std::atomic<unsigned long> lastCallbackFrames;
+      // Written by whichever thread fills the MIDI buffers
+      std::atomic<unsigned long long> midiEvents;
+      std::atomic<unsigned long long> midiLateEvents;
+      std::atomic<double> minMidiLeadMillis;
+      std::atomic<unsigned long long> midiWakes;
+      std::atomic<double> totalMidiWakeMillis;
+      std::atomic<double> maxMidiWakeMillis;
+
+      // Used only by the callback
+      double firstDeviceTime;
+      unsigned long long framesSinceFirst;
+   };
+   TelemetryCounters   mTelemetry;
+   void NoteCallbackTelemetry(unsigned long framesPerBuffer,
+      const PaStreamCallbackTimeInfo *timeInfo,
+      PaStreamCallbackFlags statusFlags, double millis);
    volatile bool       mAudioThreadShouldCallFillBuffersOnce;
    volatile bool       mAudioThreadFillBuffersLoopRunning;
    volatile bool       mAudioThreadFillBuffersLoopActive;
 
+   std::mutex              mAudioThreadWakeMutex;
+   std::condition_variable mAudioThreadWakeCondition;
+   std::atomic<bool>       mAudioThreadWakeRequested{ false };
+
+   /// Hands a seek between the audio thread and the callback
+   enum SeekState { SeekIdle, SeekFlushRequested, SeekFlushed };
+   std::atomic<int>        mSeekState{ SeekIdle };
+
    wxLongLong          mLastPlaybackTimeMillis;
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    volatile bool       mMidiThreadFillBuffersLoopRunning;
    volatile bool       mMidiThreadFillBuffersLoopActive;
+
+   /// AudioTime() at which FillMidiBuffers has the next event to write;
+   /// the callback wakes the MIDI thread when it passes
+   std::atomic<double>     mMidiWakeTime{ 0 };
+#ifdef USE_MIDI_THREAD
+   std::mutex              mMidiThreadWakeMutex;
+   std::condition_variable mMidiThreadWakeCondition;
+   std::atomic<bool>       mMidiThreadWakeRequested{ false };
+   /// steady_clock ticks when the wake was requested
+   std::atomic<long long>  mMidiThreadWakeRequestTime{ 0 };
+#endif
 #endif
 
    volatile double     mLastRecordingOffset;
@@ -807,16 +1051,22 @@ private:
                 const PaStreamCallbackTimeInfo *timeInfo,
                 PaStreamCallbackFlags statusFlags, void *userData );
 
-   // Serialize main thread and PortAudio thread's attempts to pause and change
-   // the state used by the third, Audio thread.
-   wxMutex mSuspendAudioThread;
-
 #ifdef EXPERIMENTAL_SCRUBBING_SUPPORT
    struct ScrubQueue;
    std::unique_ptr<ScrubQueue> mScrubQueue;
 
    bool mSilentScrub;
    sampleCount mScrubDuration;
+
+   // Speed changes between scrub intervals are ramped over the start of
+   // the later interval, in short steps, instead of jumping
+   void SetScrubSpeed(double speed);
+   double mScrubSpeed;        // As last given to the mixers; 0 if silent
+   bool mScrubBackwards;
+   double mScrubRampFrom;
+   double mScrubRampTo;
+   sampleCount mScrubRampLength;
+   sampleCount mScrubRampDone;
 #endif
 
    // A flag tested and set in one thread, cleared in another.  Perhaps
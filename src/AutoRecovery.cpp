@@ -31,6 +31,9 @@ text or binary format to a file.
 #include <wx/dialog.h>
 #include <wx/app.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "WaveTrack.h"
 #include "widgets/ErrorDialog.h"
 
@@ -154,7 +157,7 @@ void AutoRecoveryDialog::OnRecoverAll(wxCommandEvent & WXUNUSED(event))
 
 ////////////////////////////////////////////////////////////////////////////
 
-static bool HaveFilesToRecover()
+bool HaveFilesToRecover()
 {
    wxDir dir(FileNames::AutoSaveDir());
    if (!dir.IsOpened())
@@ -454,6 +457,18 @@ XMLTagHandler* RecordingRecoveryHandler::HandleXMLChild(const wxChar *tag)
 // to preserve the active dictionary.  The decoder will then restore the
 // dictionary when an FT_Pop is encountered.  Nesting is unlimited.
 //
+// An AutoSaveJournal file begins with "<?xml autosave journal>" instead,
+// followed by records:
+//
+//    FT_Fragment       type, ID, length, then a name dictionary and data
+//                      fields, much as for a subtree
+//    FT_State          type, length, then a name dictionary and data fields
+//                      for the whole project, with FT_FragmentRef, ID, in
+//                      place of fragments
+//
+// Only the last complete state counts.  Data fields that recording appends
+// after it belong to it, as they do in the simple format.
+//
 // To save space, each name (attribute or element) encountered is stored in
 // the name dictionary and replaced with the assigned 2-byte identifier.
 //
@@ -477,7 +492,10 @@ enum FieldTypes
    FT_Raw,           // type, string length, string
    FT_Push,          // type only
    FT_Pop,           // type only
-   FT_Name           // type, name length, name
+   FT_Name,          // type, name length, name
+   FT_Fragment,      // type, ID, length, fragment
+   FT_FragmentRef,   // type, ID
+   FT_State          // type, length, state
 };
 
 AutoSaveFile::AutoSaveFile(size_t allocSize)
@@ -672,15 +690,363 @@ void AutoSaveFile::WriteName(const wxString & name)
    mBuffer.Write(&id, sizeof(id));
 }
 
+void AutoSaveFile::WriteFragmentRef(int id)
+{
+   CheckSpace(mBuffer);
+   mBuffer.PutC(FT_FragmentRef);
+   mBuffer.Write(&id, sizeof(id));
+}
+
+bool AutoSaveFile::AppendFragment(wxFFile & file, int id) const
+{
+   const char type = FT_Fragment;
+   const int length = mDict.GetOutputStreamBuffer()->GetIntPosition() +
+      mBuffer.GetOutputStreamBuffer()->GetIntPosition();
+
+   return file.Write(&type, sizeof(type)) == sizeof(type) &&
+      file.Write(&id, sizeof(id)) == sizeof(id) &&
+      file.Write(&length, sizeof(length)) == sizeof(length) &&
+      Append(file);
+}
+
+bool AutoSaveFile::AppendState(wxFFile & file) const
+{
+   const char type = FT_State;
+   const int length = mDict.GetOutputStreamBuffer()->GetIntPosition() +
+      mBuffer.GetOutputStreamBuffer()->GetIntPosition();
+
+   return file.Write(&type, sizeof(type)) == sizeof(type) &&
+      file.Write(&length, sizeof(length)) == sizeof(length) &&
+      Append(file);
+}
+
 bool AutoSaveFile::IsEmpty() const
 {
    return mBuffer.GetLength() == 0;
 }
 
+namespace {
+
+// Replays the data fields of an auto-save file to an XMLWriter
+class AutoSaveDecoder
+{
+public:
+   AutoSaveDecoder(const char *data, size_t length)
+      : mData{ data }, mLength{ length }
+   {}
+
+   // The simple format
+   void Decode(XMLWriter &out)
+   {
+      Decode(mData, mLength, &out);
+   }
+
+   // Find the records of a journal.  Returns false if there is no complete
+   // state.
+   bool FindJournalRecords()
+   {
+      // Without a writer, only skip the data fields
+      Decode(mData, mLength, nullptr);
+      return mHaveState;
+   }
+
+   // The last complete state of a journal, and what was appended after it
+   void DecodeJournal(XMLWriter &out)
+   {
+      if (!mHaveState)
+         return;
+
+      Decode(mData + mState.first, mState.second, &out);
+      const auto end = mState.first + mState.second;
+      Decode(mData + end, mLength - end, &out);
+   }
+
+private:
+   using Extent = std::pair<size_t, size_t>;
+
+   void Decode(const char *data, size_t length, XMLWriter *out);
+   void DecodeFragment(int fragmentId, XMLWriter &out);
+
+   const char *const mData;
+   const size_t mLength;
+
+   IdMap mIds;
+   std::vector<IdMap> mIdStack;
+
+   std::unordered_map<int, Extent> mFragments;
+   Extent mState;
+   bool mHaveState{ false };
+};
+
+void AutoSaveDecoder::DecodeFragment(int fragmentId, XMLWriter &out)
+{
+   auto it = mFragments.find(fragmentId);
+   if (it == mFragments.end())
+      return;
+
+   mIdStack.push_back(mIds);
+   mIds.clear();
+   Decode(mData + it->second.first, it->second.second, &out);
+   mIds = mIdStack.back();
+   mIdStack.pop_back();
+}
+
+void AutoSaveDecoder::Decode(const char *data, size_t length, XMLWriter *out)
+{
+   using WxChars = ArrayOf < wxChar >;
+
+   wxMemoryInputStream in(data, length);
+   const size_t base = data - mData;
+
+   // Find where a record's contents are, and skip them
+   auto record = [&](int recordLength, Extent &extent) {
+      const size_t offset = base + (size_t) in.TellI();
+      if (recordLength < 0 || offset + recordLength > mLength)
+         return false;
+      extent = Extent{ offset, (size_t) recordLength };
+      in.SeekI(recordLength, wxFromCurrent);
+      return true;
+   };
+
+   while ( !in.Eof() )
+   {
+      short id;
+
+      switch (in.GetC())
+      {
+         case FT_Push:
+         {
+            mIdStack.push_back(mIds);
+            mIds.clear();
+         }
+         break;
+
+         case FT_Pop:
+         {
+            mIds = mIdStack.back();
+            mIdStack.pop_back();
+         }
+         break;
+
+         case FT_Name:
+         {
+            short len;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&len, sizeof(len));
+            WxChars name{ len / sizeof(wxChar) };
+            in.Read(name.get(), len);
+
+            mIds[id] = wxString(name.get(), len / sizeof(wxChar));
+         }
+         break;
+
+         case FT_StartTag:
+         {
+            in.Read(&id, sizeof(id));
+
+            if (out)
+               out->StartTag(mIds[id]);
+         }
+         break;
+
+         case FT_EndTag:
+         {
+            in.Read(&id, sizeof(id));
+
+            if (out)
+               out->EndTag(mIds[id]);
+         }
+         break;
+
+         case FT_String:
+         {
+            int len;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&len, sizeof(len));
+            WxChars val{ len / sizeof(wxChar) };
+            in.Read(val.get(), len);
+
+            if (out)
+               out->WriteAttr(mIds[id], wxString(val.get(), len / sizeof(wxChar)));
+         }
+         break;
+
+         case FT_Float:
+         {
+            float val;
+            int dig;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+            in.Read(&dig, sizeof(dig));
+
+            if (out)
+               out->WriteAttr(mIds[id], val, dig);
+         }
+         break;
+
+         case FT_Double:
+         {
+            double val;
+            int dig;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+            in.Read(&dig, sizeof(dig));
+
+            if (out)
+               out->WriteAttr(mIds[id], val, dig);
+         }
+         break;
+
+         case FT_Int:
+         {
+            int val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            if (out)
+               out->WriteAttr(mIds[id], val);
+         }
+         break;
+
+         case FT_Bool:
+         {
+            bool val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            if (out)
+               out->WriteAttr(mIds[id], val);
+         }
+         break;
+
+         case FT_Long:
+         {
+            long val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            if (out)
+               out->WriteAttr(mIds[id], val);
+         }
+         break;
+
+         case FT_LongLong:
+         {
+            long long val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            if (out)
+               out->WriteAttr(mIds[id], val);
+         }
+         break;
+
+         case FT_SizeT:
+         {
+            size_t val;
+
+            in.Read(&id, sizeof(id));
+            in.Read(&val, sizeof(val));
+
+            if (out)
+               out->WriteAttr(mIds[id], val);
+         }
+         break;
+
+         case FT_Data:
+         {
+            int len;
+
+            in.Read(&len, sizeof(len));
+            WxChars val{ len / sizeof(wxChar) };
+            in.Read(val.get(), len);
+
+            if (out)
+               out->WriteData(wxString(val.get(), len / sizeof(wxChar)));
+         }
+         break;
+
+         case FT_Raw:
+         {
+            int len;
+
+            in.Read(&len, sizeof(len));
+            WxChars val{ len / sizeof(wxChar) };
+            in.Read(val.get(), len);
+
+            if (out)
+               out->Write(wxString(val.get(), len / sizeof(wxChar)));
+         }
+         break;
+
+         case FT_Fragment:
+         {
+            int fragmentId, len;
+            Extent extent;
+
+            in.Read(&fragmentId, sizeof(fragmentId));
+            in.Read(&len, sizeof(len));
+            if (!record(len, extent))
+               // Incompletely written
+               return;
+
+            if (!out)
+               mFragments[fragmentId] = extent;
+         }
+         break;
+
+         case FT_FragmentRef:
+         {
+            int fragmentId;
+
+            in.Read(&fragmentId, sizeof(fragmentId));
+
+            if (out)
+               DecodeFragment(fragmentId, *out);
+         }
+         break;
+
+         case FT_State:
+         {
+            int len;
+            Extent extent;
+
+            // A later state ends what was appended to the one being replayed
+            if (out)
+               return;
+
+            in.Read(&len, sizeof(len));
+            if (!record(len, extent))
+               // Incompletely written; the previous state is the last
+               return;
+
+            mState = extent;
+            mHaveState = true;
+         }
+         break;
+
+         default:
+            wxASSERT(true);
+         break;
+      }
+   }
+}
+
+}
+
 bool AutoSaveFile::Decode(const wxString & fileName)
 {
-   char ident[sizeof(AutoSaveIdent)];
+   char ident[sizeof(AutoSaveJournalIdent)];
    size_t len = strlen(AutoSaveIdent);
+   const size_t journalLen = strlen(AutoSaveJournalIdent);
 
    const wxFileName fn(fileName);
    const wxString fnPath{fn.GetFullPath()};
@@ -691,7 +1057,15 @@ bool AutoSaveFile::Decode(const wxString & fileName)
       return false;
    }
 
-   if (file.Read(&ident, len) != len || strncmp(ident, AutoSaveIdent, len) != 0)
+   const bool simple = file.Read(&ident, len) == len &&
+      strncmp(ident, AutoSaveIdent, len) == 0;
+   const bool journal = !simple && file.Seek(0) &&
+      file.Read(&ident, journalLen) == journalLen &&
+      strncmp(ident, AutoSaveJournalIdent, journalLen) == 0;
+   if (journal)
+      len = journalLen;
+
+   if (!simple && !journal)
    {
       // It could be that the file has already been decoded or that it is one
       // from 2.1.0 or earlier.  In the latter case, we need to ensure the
@@ -739,15 +1113,12 @@ bool AutoSaveFile::Decode(const wxString & fileName)
 
    len = file.Length() - len;
    using Chars = ArrayOf < char >;
-   using WxChars = ArrayOf < wxChar >;
    Chars buf{ len };
    if (file.Read(buf.get(), len) != len)
    {
       return false;
    }
 
-   wxMemoryInputStream in(buf.get(), len);
-
    file.Close();
 
    // JKC: ANSWER-ME: Is the try catch actually doing anything?
@@ -756,188 +1127,329 @@ bool AutoSaveFile::Decode(const wxString & fileName)
    // PRL: Yes, now we are doing GuardedCall everywhere that XMLFileWriter is
    // used.
    return GuardedCall< bool >( [&] {
-      XMLFileWriter out{ fileName, _("Error Decoding File") };
-
-      IdMap mIds;
-      std::vector<IdMap> mIdStack;
-
-      mIds.clear();
-
-      while ( !in.Eof() )
-      {
-         short id;
-
-         switch (in.GetC())
-         {
-            case FT_Push:
-            {
-               mIdStack.push_back(mIds);
-               mIds.clear();
-            }
-            break;
-
-            case FT_Pop:
-            {
-               mIds = mIdStack.back();
-               mIdStack.pop_back();
-            }
-            break;
-
-            case FT_Name:
-            {
-               short len;
-
-               in.Read(&id, sizeof(id));
-               in.Read(&len, sizeof(len));
-               WxChars name{ len / sizeof(wxChar) };
-               in.Read(name.get(), len);
-
-               mIds[id] = wxString(name.get(), len / sizeof(wxChar));
-            }
-            break;
-
-            case FT_StartTag:
-            {
-               in.Read(&id, sizeof(id));
+      AutoSaveDecoder decoder{ buf.get(), len };
 
-               out.StartTag(mIds[id]);
-            }
-            break;
-
-            case FT_EndTag:
-            {
-               in.Read(&id, sizeof(id));
-
-               out.EndTag(mIds[id]);
-            }
-            break;
+      // Don't replace the file if a journal has nothing to recover
+      if (journal && !decoder.FindJournalRecords())
+         return false;
 
-            case FT_String:
-            {
-               int len;
+      XMLFileWriter out{ fileName, _("Error Decoding File") };
 
-               in.Read(&id, sizeof(id));
-               in.Read(&len, sizeof(len));
-               WxChars val{ len / sizeof(wxChar) };
-               in.Read(val.get(), len);
+      if (journal)
+         decoder.DecodeJournal(out);
+      else
+         decoder.Decode(out);
 
-               out.WriteAttr(mIds[id], wxString(val.get(), len / sizeof(wxChar)));
-            }
-            break;
+      out.Commit();
 
-            case FT_Float:
-            {
-               float val;
-               int dig;
+      return true;
+   } );
+}
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
-               in.Read(&dig, sizeof(dig));
+///
+/// AutoSaveJournal class
+///
 
-               out.WriteAttr(mIds[id], val, dig);
-            }
-            break;
+namespace {
 
-            case FT_Double:
-            {
-               double val;
-               int dig;
+// Compact only journals at least this big, and then only when the live
+// records are less than half of it
+const unsigned long long MinCompactBytes = 4 * 1024 * 1024;
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
-               in.Read(&dig, sizeof(dig));
+const size_t CopyBufferSize = 1024 * 1024;
 
-               out.WriteAttr(mIds[id], val, dig);
-            }
-            break;
+// Grow the encoding of each clip by this much at a time
+const size_t FragmentAllocSize = 64 * 1024;
 
-            case FT_Int:
-            {
-               int val;
+// Copy bytes from the current position of source to the end of dest
+bool CopyBytes(wxFFile &source, wxFFile &dest, unsigned long long bytes,
+               ArrayOf<char> &buffer)
+{
+   while (bytes > 0) {
+      const size_t chunk =
+         std::min<unsigned long long>(bytes, CopyBufferSize);
+      if (source.Read(buffer.get(), chunk) != chunk ||
+          dest.Write(buffer.get(), chunk) != chunk)
+         return false;
+      bytes -= chunk;
+   }
+   return true;
+}
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+}
 
-               out.WriteAttr(mIds[id], val);
-            }
+struct AutoSaveJournal::Compaction
+{
+   wxString tempName;
+   // The live records when compaction began, in the order to copy them
+   std::vector<Record> records;
+   // Length of the journal when compaction began
+   unsigned long long end{ 0 };
+
+   std::thread thread;
+   std::atomic<bool> done{ false };
+   std::atomic<bool> cancelled{ false };
+
+   // Written by the worker before done:
+   // Offsets of the records in the NEW file
+   std::vector<unsigned long long> newOffsets;
+   bool ok{ false };
+
+   // Runs on the worker thread
+   void Run(const wxString &sourceName)
+   {
+      const size_t identLen = strlen(AutoSaveJournalIdent);
+      wxFFile source{ sourceName, wxT("rb") };
+      wxFFile dest{ tempName, wxT("wb") };
+      bool result = source.IsOpened() && dest.IsOpened() &&
+         dest.Write(AutoSaveJournalIdent, identLen) == identLen;
+
+      ArrayOf<char> buffer{ CopyBufferSize };
+      for (const auto &record : records) {
+         if (!result || cancelled.load(std::memory_order_relaxed)) {
+            result = false;
             break;
+         }
+         newOffsets.push_back(dest.Tell());
+         result = source.Seek(record.offset) &&
+            CopyBytes(source, dest, record.bytes, buffer);
+      }
 
-            case FT_Bool:
-            {
-               bool val;
+      result = dest.Close() && result;
+      ok = result;
+      done.store(true, std::memory_order_release);
+   }
+};
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+AutoSaveJournal::AutoSaveJournal()
+{
+}
 
-               out.WriteAttr(mIds[id], val);
-            }
-            break;
+AutoSaveJournal::~AutoSaveJournal()
+{
+   CancelCompaction();
+}
 
-            case FT_Long:
-            {
-               long val;
+void AutoSaveJournal::Reset()
+{
+   CancelCompaction();
+
+   mFileName.clear();
+   mNextId = 0;
+   mFileBytes = 0;
+   mFragments.clear();
+   mLiveFragments.clear();
+   mLiveState = { 0, 0 };
+}
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+bool AutoSaveJournal::Save( const wxString &fileName,
+                            const std::shared_ptr<const TrackList> &stateTracks,
+                            bool mayCompact, const StateWriter &writeState )
+{
+   const bool begin = (fileName != mFileName);
+   if (begin)
+      Reset();
+
+   AutoSaveFile state;
+   mState = &state;
+   auto cleanup = finally( [&] {
+      mState = nullptr;
+      mStateTracks.clear();
+      mNewFragments.clear();
+      mReused.clear();
+      mNewRecords.clear();
+   } );
 
-               out.WriteAttr(mIds[id], val);
-            }
-            break;
+   if (stateTracks) {
+      for (auto t : *stateTracks)
+         if (t->GetKind() == Track::Wave)
+            mStateTracks[t->GetId()] = static_cast<const WaveTrack*>(t);
+   }
 
-            case FT_LongLong:
-            {
-               long long val;
+   // Clips come to WriteClip
+   writeState(state);
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+   // Replace the journal with a finished compaction before appending
+   if (mayCompact && mCompaction &&
+       mCompaction->done.load(std::memory_order_acquire))
+      FinishCompaction();
 
-               out.WriteAttr(mIds[id], val);
-            }
+   // A NEW journal is written aside first, so that it is not found for
+   // recovery until it has a complete state
+   const wxString path = begin ? fileName + wxT(".tmp") : fileName;
+   wxFFile file;
+   bool ok = file.Open(path, begin ? wxT("wb") : wxT("ab"));
+   if (ok && begin) {
+      const size_t identLen = strlen(AutoSaveJournalIdent);
+      ok = file.Write(AutoSaveJournalIdent, identLen) == identLen;
+   }
+   // Recording may have appended, so always find the end
+   ok = ok && file.SeekEnd();
+
+   std::map<int, Record> liveFragments;
+   Record liveState{ 0, 0 };
+   if (ok) {
+      for (auto id : mReused)
+         liveFragments[id] = mLiveFragments[id];
+
+      for (const auto &newRecord : mNewRecords) {
+         const auto offset = file.Tell();
+         ok = offset != wxInvalidOffset &&
+            newRecord.file->AppendFragment(file, newRecord.id);
+         if (!ok)
             break;
+         liveFragments[newRecord.id] = Record{
+            (unsigned long long) offset,
+            (unsigned long long) (file.Tell() - offset) };
+      }
+   }
+   if (ok) {
+      const auto offset = file.Tell();
+      ok = offset != wxInvalidOffset && state.AppendState(file);
+      if (ok)
+         liveState = Record{
+            (unsigned long long) offset,
+            (unsigned long long) (file.Tell() - offset) };
+   }
+   const auto fileBytes = file.IsOpened() ? file.Tell() : wxInvalidOffset;
+   ok = ok && fileBytes != wxInvalidOffset;
+   ok = file.Close() && ok;
+
+   if (begin) {
+      ok = ok && wxRenameFile(path, fileName);
+      if (!ok && wxFileExists(path))
+         wxRemoveFile(path);
+   }
 
-            case FT_SizeT:
-            {
-               size_t val;
+   if (!ok) {
+      Reset();
+      return false;
+   }
 
-               in.Read(&id, sizeof(id));
-               in.Read(&val, sizeof(val));
+   mFileName = fileName;
+   mFileBytes = fileBytes;
+   mFragments.swap(mNewFragments);
+   mLiveFragments.swap(liveFragments);
+   mLiveState = liveState;
+
+   if (mayCompact && !mCompaction && mFileBytes >= MinCompactBytes) {
+      unsigned long long liveBytes = mLiveState.bytes;
+      for (const auto &pair : mLiveFragments)
+         liveBytes += pair.second.bytes;
+
+      if (mFileBytes > 2 * liveBytes) {
+         auto compaction = std::make_unique<Compaction>();
+         compaction->tempName = mFileName + wxT(".compact");
+         for (const auto &pair : mLiveFragments)
+            compaction->records.push_back(pair.second);
+         compaction->records.push_back(mLiveState);
+         compaction->end = mFileBytes;
+
+         auto pCompaction = compaction.get();
+         const wxString sourceName = mFileName;
+         compaction->thread = std::thread{ [pCompaction, sourceName] {
+            pCompaction->Run(sourceName);
+         } };
+         mCompaction = std::move(compaction);
+      }
+   }
 
-               out.WriteAttr(mIds[id], val);
-            }
-            break;
+   return true;
+}
 
-            case FT_Data:
-            {
-               int len;
+void AutoSaveJournal::WriteClip( const WaveTrack &track, const WaveClip &clip,
+                                 size_t index )
+{
+   // The undo state's copy of the clip, if it is the same
+   WaveClipHolder stateClip;
+   auto it = mStateTracks.find(track.GetId());
+   if (it != mStateTracks.end())
+      stateClip = it->second->FindEquivalentClip(clip, index);
+
+   if (stateClip) {
+      // Unchanged since the last save?
+      auto found = mFragments.find(stateClip.get());
+      if (found != mFragments.end() &&
+          found->second.clip.lock() == stateClip) {
+         mState->WriteFragmentRef(found->second.id);
+         mNewFragments[stateClip.get()] = found->second;
+         mReused.push_back(found->second.id);
+         return;
+      }
+   }
 
-               in.Read(&len, sizeof(len));
-               WxChars val{ len / sizeof(wxChar) };
-               in.Read(val.get(), len);
+   const int id = mNextId++;
+   auto fragment = std::make_unique<AutoSaveFile>(FragmentAllocSize);
+   clip.WriteXML(*fragment);
+   mState->WriteFragmentRef(id);
+   mNewRecords.push_back({ id, std::move(fragment) });
 
-               out.WriteData(wxString(val.get(), len / sizeof(wxChar)));
-            }
-            break;
+   if (stateClip)
+      mNewFragments[stateClip.get()] = Fragment{ stateClip, id };
+}
 
-            case FT_Raw:
-            {
-               int len;
+bool AutoSaveJournal::FinishCompaction()
+{
+   auto compaction = std::move(mCompaction);
+   compaction->thread.join();
+
+   // Copy what was appended since compaction began
+   bool ok = compaction->ok;
+   unsigned long long tailOffset = 0, tailBytes = 0;
+   if (ok) {
+      wxFFile source{ mFileName, wxT("rb") };
+      wxFFile dest{ compaction->tempName, wxT("ab") };
+      ok = source.IsOpened() && dest.IsOpened() &&
+         source.Seek(compaction->end) && dest.SeekEnd();
+      if (ok) {
+         const auto length = source.Length();
+         const auto offset = dest.Tell();
+         ok = length != wxInvalidOffset && offset != wxInvalidOffset &&
+            (unsigned long long) length >= compaction->end;
+         if (ok) {
+            tailOffset = offset;
+            tailBytes = length - compaction->end;
+            ArrayOf<char> buffer{ CopyBufferSize };
+            ok = CopyBytes(source, dest, tailBytes, buffer);
+         }
+      }
+      ok = dest.Close() && ok;
+   }
 
-               in.Read(&len, sizeof(len));
-               WxChars val{ len / sizeof(wxChar) };
-               in.Read(val.get(), len);
+   ok = ok && wxRenameFile(compaction->tempName, mFileName, true);
+   if (!ok) {
+      if (wxFileExists(compaction->tempName))
+         wxRemoveFile(compaction->tempName);
+      return false;
+   }
 
-               out.Write(wxString(val.get(), len / sizeof(wxChar)));
-            }
-            break;
+   // Find the live records in the NEW file.  Each one older than the
+   // compaction was live when it began, so it was copied.
+   std::unordered_map<unsigned long long, unsigned long long> moved;
+   for (size_t ii = 0, nn = compaction->records.size(); ii < nn; ++ii)
+      moved[compaction->records[ii].offset] = compaction->newOffsets[ii];
+   auto relocate = [&](Record &record) {
+      if (record.offset >= compaction->end)
+         record.offset = record.offset - compaction->end + tailOffset;
+      else
+         record.offset = moved[record.offset];
+   };
+   for (auto &pair : mLiveFragments)
+      relocate(pair.second);
+   relocate(mLiveState);
+   mFileBytes = tailOffset + tailBytes;
 
-            default:
-               wxASSERT(true);
-            break;
-         }
-      }
+   return true;
+}
 
-      out.Commit();
+void AutoSaveJournal::CancelCompaction()
+{
+   if (!mCompaction)
+      return;
 
-      return true;
-   } );
+   mCompaction->cancelled.store(true, std::memory_order_relaxed);
+   mCompaction->thread.join();
+   if (wxFileExists(mCompaction->tempName))
+      wxRemoveFile(mCompaction->tempName);
+   mCompaction.reset();
 }
@@ -12,6 +12,7 @@
 #define __AUDACITY_AUTORECOVERY__
 
 #include "Project.h"
+#include "Track.h"
 
 #include "xml/XMLTagHandler.h"
 #include "xml/XMLWriter.h"
@@ -21,7 +22,11 @@
 #include <wx/hashmap.h>
 #include <wx/mstream.h>
 
+#include <atomic>
+#include <functional>
+#include <map>
 #include <unordered_map>
+#include <vector>
 
 //
 // Show auto recovery dialog if there are projects to recover. Should be
@@ -39,6 +44,9 @@
 bool ShowAutoRecoveryDialogIfNeeded(AudacityProject** pproj,
                                     bool *didRecoverAnything);
 
+// Whether any auto save files were left by projects that were not closed
+bool HaveFilesToRecover();
+
 //
 // XML Handler for a <recordingrecovery> tag
 //
@@ -68,6 +76,8 @@ private:
 
 // Should be plain ASCII
 #define AutoSaveIdent "<?xml autosave>"
+// Begins the file of an AutoSaveJournal instead
+#define AutoSaveJournalIdent "<?xml autosave journal>"
 
 using NameMap = std::unordered_map<wxString, short>;
 using IdMap = std::unordered_map<short, wxString>;
@@ -103,6 +113,12 @@ public:
    bool Write(wxFFile & file) const;
    bool Append(wxFFile & file) const;
 
+   // For AutoSaveJournal:  refer to a fragment record of the same journal
+   void WriteFragmentRef(int id);
+   // Append this as a fragment record, or as a state record
+   bool AppendFragment(wxFFile & file, int id) const;
+   bool AppendState(wxFFile & file) const;
+
    bool IsEmpty() const;
 
    bool Decode(const wxString & fileName);
@@ -118,5 +134,99 @@ private:
    size_t mAllocSize;
 };
 
+///
+/// AutoSaveJournal
+///
+
+class WaveClip;
+class WaveTrack;
+
+// Keeps the auto-save file of a project as a journal, so that the work of
+// each auto-save is in proportion to what changed, not to the project.
+//
+// Each save appends a state record:  the project as AutoSaveFile encodes
+// it, except that each wave clip refers to a fragment record.  A clip that
+// is unchanged since the previous save refers to the same fragment again,
+// so only the fragments of changed clips are appended.  AutoSaveFile::Decode
+// replays the last complete state, and whatever recording appended after it.
+//
+// When superseded records make up most of the file, a worker thread copies
+// the live ones to a NEW file, which replaces the journal at a later save.
+class AUDACITY_DLL_API AutoSaveJournal final
+{
+public:
+   using StateWriter = std::function< void( AutoSaveFile &state ) >;
+
+   AutoSaveJournal();
+   ~AutoSaveJournal();
+
+   AutoSaveJournal( const AutoSaveJournal& ) PROHIBITED;
+   AutoSaveJournal &operator= ( const AutoSaveJournal& ) PROHIBITED;
+
+   // The file being appended, or empty
+   const wxString &GetFileName() const { return mFileName; }
+
+   // Encode a state with writeState, then append it to the journal at
+   // fileName, or begin a NEW journal there if that is not the current one.
+   // stateTracks are those of the current undo state; clips equal to theirs
+   // are remembered as unchanged.  Compaction may only begin or end if
+   // mayCompact.  Returns false if the file could not be written, and then
+   // forgets the journal.
+   bool Save( const wxString &fileName,
+              const std::shared_ptr<const TrackList> &stateTracks,
+              bool mayCompact, const StateWriter &writeState );
+
+   // True during Save
+   bool IsSaving() const { return mState != nullptr; }
+
+   // During Save, write a clip of the track in place of WaveClip::WriteXML
+   void WriteClip( const WaveTrack &track, const WaveClip &clip,
+                   size_t index );
+
+   // Forget the journal, as when its file is removed.  Waits for compaction.
+   void Reset();
+
+private:
+   struct Record
+   {
+      unsigned long long offset;
+      unsigned long long bytes;
+   };
+   struct Fragment
+   {
+      std::weak_ptr<const WaveClip> clip;
+      int id;
+   };
+   struct Compaction;
+
+   // Replace the journal with a finished compaction
+   bool FinishCompaction();
+   void CancelCompaction();
+
+   wxString mFileName;
+   int mNextId{ 0 };
+   unsigned long long mFileBytes{ 0 };
+
+   // Fragments of the last state, by the clips of its undo state
+   std::unordered_map<const WaveClip*, Fragment> mFragments;
+   // Records that the last state needs, by fragment id
+   std::map<int, Record> mLiveFragments;
+   Record mLiveState{ 0, 0 };
+
+   // Valid during Save
+   AutoSaveFile *mState{};
+   std::map<TrackId, const WaveTrack*> mStateTracks;
+   std::unordered_map<const WaveClip*, Fragment> mNewFragments;
+   std::vector<int> mReused;
+   struct NewRecord
+   {
+      int id;
+      std::unique_ptr<AutoSaveFile> file;
+   };
+   std::vector<NewRecord> mNewRecords;
+
+   std::unique_ptr<Compaction> mCompaction;
+};
+
 
 #endif
@@ -12,6 +12,11 @@
 \brief BenchmarkDialog is used for measuring performance and accuracy
 of the BlockFile system.
 
+\class BenchmarkSuite
+\brief Times the main processing paths without user interaction, for the
+--benchmark command line option, and writes the results as JSON so that
+releases can be compared.
+
 *//*******************************************************************/
 
 
@@ -40,8 +45,32 @@ of the BlockFile system.
 #include "Sequence.h"
 #include "Prefs.h"
 
+#include "BlockFile.h"
+#include "DirManager.h"
+#include "Experimental.h"
 #include "FileNames.h"
+#include "Internat.h"
+#include "Mix.h"
+#include "PluginManager.h"
+#include "RealFFTf.h"
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+#include "RealFFTf48x.h"
+#endif
+#include "Tags.h"
+#include "WaveClip.h"
+#include "effects/EffectManager.h"
+#include "export/Export.h"
+#include "import/Import.h"
 #include "widgets/ErrorDialog.h"
+#include "widgets/ProgressDialog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <math.h>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
 
 class BenchmarkDialog final : public wxDialogWrapper
 {
@@ -555,3 +584,449 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    Printf(_("Benchmark completed successfully.\n"));
    HoldPrint(false);
 }
+
+//
+// Headless benchmark suite
+//
+
+namespace {
+
+// Each measurement repeats until it has run at least this long
+const double MinSeconds = 0.25;
+const double SuiteRate = 44100.0;
+// Ten seconds of signal
+const size_t SuiteSamples = 441000;
+
+class BenchmarkSuite
+{
+public:
+   explicit BenchmarkSuite(AudacityProject &project);
+
+   void RunAll();
+   bool Write(const wxString &fileName) const;
+
+   bool AllSucceeded() const;
+
+private:
+   struct Result {
+      wxString name;
+      // What the work is counted in, such as samples or transforms
+      wxString unit;
+      size_t iterations;
+      double seconds;
+      double work;
+      bool ok;
+   };
+
+   // body returns the quantity of work done in one iteration, or throws.
+   // Failures are recorded, not propagated.
+   void Measure(const wxString &name, const wxString &unit,
+                const std::function< double() > &body);
+
+   std::shared_ptr<WaveTrack> MakeTrack();
+
+   void BlockIO();
+   void SequenceGetAppend();
+   void Mixing();
+   void FFTs();
+   void Spectrogram();
+   void Effects();
+   void ImportExport();
+
+   AudacityProject &mProject;
+   Floats mSignal;
+   std::vector<Result> mResults;
+};
+
+BenchmarkSuite::BenchmarkSuite(AudacityProject &project)
+   : mProject{ project }
+   , mSignal{ SuiteSamples }
+{
+   // A tone with some noise, so that nothing compresses trivially
+   srand(234657);
+   for (size_t i = 0; i < SuiteSamples; i++)
+      mSignal[i] = 0.5f * sin(2 * M_PI * 440.0 * i / SuiteRate) +
+         0.1f * (rand() / (float)RAND_MAX - 0.5f);
+}
+
+void BenchmarkSuite::Measure(const wxString &name, const wxString &unit,
+                             const std::function< double() > &body)
+{
+   using namespace std::chrono;
+   Result result{ name, unit, 0, 0.0, 0.0, true };
+   const auto start = steady_clock::now();
+   try {
+      do {
+         result.work += body();
+         ++result.iterations;
+         result.seconds =
+            duration_cast< duration<double> >(steady_clock::now() - start)
+               .count();
+      } while (result.seconds < MinSeconds);
+   }
+   catch (...) {
+      result.ok = false;
+   }
+   if (result.ok && result.work <= 0)
+      result.ok = false;
+   mResults.push_back(result);
+}
+
+std::shared_ptr<WaveTrack> BenchmarkSuite::MakeTrack()
+{
+   std::shared_ptr<WaveTrack> track{
+      mProject.GetTrackFactory()->NewWaveTrack(floatSample, SuiteRate) };
+   track->Append((samplePtr)mSignal.get(), floatSample, SuiteSamples);
+   track->Flush();
+   return track;
+}
+
+void BenchmarkSuite::RunAll()
+{
+   BlockIO();
+   SequenceGetAppend();
+   Mixing();
+   FFTs();
+   Spectrogram();
+   Effects();
+   ImportExport();
+}
+
+void BenchmarkSuite::BlockIO()
+{
+   auto &dirManager = *mProject.GetDirManager();
+   const auto blockSize = Sequence::GetMaxDiskBlockSize() / sizeof(float);
+   const auto nBlocks = SuiteSamples / blockSize;
+   std::vector<BlockFilePtr> blocks;
+
+   Measure(wxT("BlockFile write"), wxT("samples"), [&]{
+      blocks.clear();
+      for (size_t i = 0; i < nBlocks; i++)
+         blocks.push_back(dirManager.NewSimpleBlockFile(
+            (samplePtr)(mSignal.get() + i * blockSize), blockSize, floatSample));
+      return (double)(nBlocks * blockSize);
+   });
+
+   Floats buffer{ blockSize };
+   Measure(wxT("BlockFile read"), wxT("samples"), [&]{
+      for (const auto &block : blocks)
+         block->ReadData((samplePtr)buffer.get(), floatSample, 0, blockSize,
+                         true);
+      return (double)(blocks.size() * blockSize);
+   });
+
+   // Min, max and RMS of each 256 samples, as drawing uses
+   const auto frames256 = (blockSize + 255) / 256;
+   Floats summary{ 3 * frames256 };
+   Measure(wxT("BlockFile read summary"), wxT("blocks"), [&]{
+      for (const auto &block : blocks)
+         block->Read256(summary.get(), 0, frames256);
+      return (double)blocks.size();
+   });
+}
+
+void BenchmarkSuite::SequenceGetAppend()
+{
+   const auto dirManager = mProject.GetDirManager();
+   // Roughly the pieces that recording and playback use
+   const size_t chunk = 4096;
+   std::unique_ptr<Sequence> sequence;
+
+   Measure(wxT("Sequence::Append"), wxT("samples"), [&]{
+      sequence = std::make_unique<Sequence>(dirManager, floatSample);
+      for (size_t start = 0; start < SuiteSamples; start += chunk)
+         sequence->Append((samplePtr)(mSignal.get() + start), floatSample,
+                          std::min(chunk, SuiteSamples - start));
+      return (double)SuiteSamples;
+   });
+
+   if (!sequence)
+      return;
+
+   Floats buffer{ chunk };
+   Measure(wxT("Sequence::Get"), wxT("samples"), [&]{
+      const auto len = sequence->GetNumSamples().as_size_t();
+      for (size_t start = 0; start < len; start += chunk)
+         sequence->Get((samplePtr)buffer.get(), floatSample, start,
+                       std::min(chunk, len - start), true);
+      return (double)len;
+   });
+}
+
+void BenchmarkSuite::Mixing()
+{
+   // A session of several tracks, mixed to stereo
+   const size_t nTracks = 8;
+   WaveTrackConstArray tracks;
+   for (size_t i = 0; i < nTracks; i++) {
+      auto track = MakeTrack();
+      track->SetPan((2.0f * i) / (nTracks - 1) - 1.0f);
+      track->SetGain(0.5f);
+      tracks.push_back(track);
+   }
+   const double duration = SuiteSamples / SuiteRate;
+   const size_t bufferSize = 4096;
+
+   auto mix = [&](double outRate){
+      Mixer mixer(tracks, true, Mixer::WarpOptions{ nullptr },
+                  0.0, duration, 2, bufferSize, true, outRate, floatSample);
+      double frames = 0;
+      while (auto n = mixer.Process(bufferSize))
+         frames += n;
+      return frames * nTracks;
+   };
+
+   Measure(wxT("Mixer::Process"), wxT("track samples"),
+      [&]{ return mix(SuiteRate); });
+   Measure(wxT("Mixer::Process resampling"), wxT("track samples"),
+      [&]{ return mix(48000.0); });
+}
+
+void BenchmarkSuite::FFTs()
+{
+   for (size_t fftLen : { 1024u, 16384u }) {
+      const auto hFFT = GetFFT(fftLen);
+      // Room for four interleaved transforms, for the 4x variants
+      Floats buffer{ 4 * fftLen };
+      const size_t repeats = (1 << 22) / fftLen;
+
+      auto fill = [&] {
+         std::copy(mSignal.get(), mSignal.get() + 4 * fftLen, buffer.get());
+      };
+
+      Measure(wxString::Format(wxT("RealFFTf %d"), (int)fftLen),
+              wxT("transforms"), [&]{
+         for (size_t i = 0; i < repeats; i++) {
+            fill();
+            RealFFTf(buffer.get(), hFFT.get());
+         }
+         return (double)repeats;
+      });
+
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+      const std::pair<const wxChar *, int> variants[] = {
+         { wxT("SinCosBRTable"), FFT_SinCosBRTable },
+         { wxT("SinCosTableVBR16"), FFT_SinCosTableVBR16 },
+         { wxT("SinCosTableBR16"), FFT_SinCosTableBR16 },
+         { wxT("FastMathBR16"), FFT_FastMathBR16 },
+         { wxT("FastMathBR24"), FFT_FastMathBR24 },
+      };
+      for (const auto &variant : variants) {
+         Measure(wxString::Format(wxT("RealFFTf1x %s %d"),
+                                  variant.first, (int)fftLen),
+                 wxT("transforms"), [&]{
+            for (size_t i = 0; i < repeats; i++) {
+               fill();
+               RealFFTf1x(buffer.get(), hFFT.get(), variant.second);
+            }
+            return (double)repeats;
+         });
+         Measure(wxString::Format(wxT("RealFFTf4x %s %d"),
+                                  variant.first, (int)fftLen),
+                 wxT("transforms"), [&]{
+            for (size_t i = 0; i < repeats / 4; i++) {
+               fill();
+               RealFFTf4x(buffer.get(), hFFT.get(), variant.second);
+            }
+            return (double)(4 * (repeats / 4));
+         });
+      }
+#endif
+   }
+}
+
+void BenchmarkSuite::Spectrogram()
+{
+   const auto track = MakeTrack();
+   const auto clip = track->GetClipByIndex(0);
+   WaveTrackCache cache{ track };
+   const size_t numPixels = 1000;
+   const double pixelsPerSecond = numPixels * SuiteRate / SuiteSamples;
+
+   Measure(wxT("Spectrogram cache fill"), wxT("columns"), [&]{
+      // Invalidate the cache
+      clip->MarkChanged();
+      const float *spectrogram;
+      const sampleCount *where;
+      clip->GetSpectrogram(cache, spectrogram, where, numPixels,
+                           0.0, pixelsPerSecond);
+      return (double)numPixels;
+   });
+}
+
+void BenchmarkSuite::Effects()
+{
+   const size_t blockLen = 4096;
+   auto &pm = PluginManager::Get();
+   for (auto plug = pm.GetFirstPluginForEffectType(EffectTypeProcess);
+        plug; plug = pm.GetNextPluginForEffectType(EffectTypeProcess)) {
+      if (!plug->GetPath().StartsWith(BUILTIN_EFFECT_PREFIX))
+         continue;
+      const auto effect = EffectManager::Get().GetEffect(plug->GetID());
+      if (!effect)
+         continue;
+      const auto nIn = effect->GetAudioInCount();
+      const auto nOut = effect->GetAudioOutCount();
+      if (nIn == 0 || nOut == 0)
+         continue;
+
+      FloatBuffers inputs{ nIn, blockLen };
+      FloatBuffers outputs{ nOut, blockLen };
+      std::vector<float *> inPtrs, outPtrs;
+      for (unsigned i = 0; i < nIn; i++)
+         inPtrs.push_back(inputs[i].get());
+      for (unsigned i = 0; i < nOut; i++)
+         outPtrs.push_back(outputs[i].get());
+
+      effect->SetSampleRate(SuiteRate);
+      const auto len = std::min(blockLen, effect->SetBlockSize(blockLen));
+      if (len == 0 || !effect->ProcessInitialize(SuiteSamples))
+         continue;
+
+      auto fill = [&](size_t start){
+         for (unsigned i = 0; i < nIn; i++)
+            std::copy(mSignal.get() + start, mSignal.get() + start + len,
+                      inputs[i].get());
+      };
+
+      // Only effects that implement ProcessBlock, not Process, do any work
+      fill(0);
+      if (effect->ProcessBlock(inPtrs.data(), outPtrs.data(), len) == 0) {
+         effect->ProcessFinalize();
+         continue;
+      }
+
+      Measure(effect->GetSymbol().Internal() + wxT(" ProcessBlock"),
+              wxT("samples"), [&]{
+         double done = 0;
+         for (size_t start = 0; start + len <= SuiteSamples; start += len) {
+            fill(start);
+            done += effect->ProcessBlock(inPtrs.data(), outPtrs.data(), len);
+         }
+         return done;
+      });
+      effect->ProcessFinalize();
+   }
+}
+
+void BenchmarkSuite::ImportExport()
+{
+   // Copy uncompressed files in, without asking
+   const wxString copyKey{ wxT("/FileFormats/CopyOrEditUncompressedData") };
+   const wxString askKey{ wxT("/Warnings/CopyOrEditUncompressedDataAsk") };
+   const wxString firstKey{ wxT("/Warnings/CopyOrEditUncompressedDataFirstAsk") };
+   const auto oldCopy = gPrefs->Read(copyKey, wxT("copy"));
+   const auto oldAsk = gPrefs->Read(askKey, true);
+   const auto oldFirst = gPrefs->Read(firstKey, true);
+   gPrefs->Write(copyKey, wxT("copy"));
+   gPrefs->Write(askKey, false);
+   gPrefs->Write(firstKey, false);
+
+   auto tracks = mProject.GetTracks();
+   const auto pTrack = tracks->Add(MakeTrack());
+
+   const auto cleanup = finally( [&] {
+      tracks->Remove(pTrack);
+      gPrefs->Write(copyKey, oldCopy);
+      gPrefs->Write(askKey, oldAsk);
+      gPrefs->Write(firstKey, oldFirst);
+      gPrefs->Flush();
+   } );
+
+   const double duration = SuiteSamples / SuiteRate;
+   Exporter exporter;
+   for (const auto &plugin : exporter.GetPlugins()) {
+      for (int subformat = 0; subformat < plugin->GetFormatCount(); subformat++) {
+         const auto format = plugin->GetFormat(subformat);
+         // These run external programs, or need libraries that the user
+         // may be asked to locate
+         if (format == wxT("CL") || format == wxT("MP3") ||
+             format == wxT("FFMPEG"))
+            continue;
+
+         wxFileName fileName{ FileNames::TempDir(),
+            wxT("benchmark"), plugin->GetExtension(subformat) };
+         const auto path = fileName.GetFullPath();
+
+         Measure(format + wxT(" export"), wxT("samples"), [&]{
+            std::unique_ptr<ProgressDialog> pDialog;
+            const auto result = plugin->Export(&mProject, pDialog, 1, path,
+               false, 0.0, duration, nullptr, nullptr, subformat);
+            return (result == ProgressResult::Success ||
+                    result == ProgressResult::Stopped)
+               ? (double)SuiteSamples : 0.0;
+         });
+
+         if (wxFileExists(path)) {
+            Measure(format + wxT(" import"), wxT("samples"), [&]{
+               TrackHolders imported;
+               Tags tags;
+               wxString errorMessage;
+               if (!Importer::Get().Import(path, mProject.GetTrackFactory(),
+                                           imported, &tags, errorMessage))
+                  return 0.0;
+               double samples = 0;
+               for (const auto &track : imported)
+                  samples += track->TimeToLongSamples(track->GetEndTime())
+                     .as_double();
+               return samples;
+            });
+            wxRemoveFile(path);
+         }
+      }
+   }
+}
+
+bool BenchmarkSuite::AllSucceeded() const
+{
+   return std::all_of(mResults.begin(), mResults.end(),
+      [](const Result &result){ return result.ok; });
+}
+
+bool BenchmarkSuite::Write(const wxString &fileName) const
+{
+   wxFFile file{ fileName, wxT("w") };
+   if (!file.IsOpened())
+      return false;
+
+   auto quote = [](const wxString &str){
+      wxString result{ wxT("\"") };
+      for (const auto c : str) {
+         if (c == wxT('"') || c == wxT('\\'))
+            result += wxT('\\');
+         result += c;
+      }
+      return result + wxT("\"");
+   };
+
+   // JSON, and always with a dot as the decimal separator
+   bool ok = file.Write(wxString::Format(
+      wxT("{\"version\":%s,\"results\":[\n"),
+      quote(AUDACITY_VERSION_STRING)));
+   bool first = true;
+   for (const auto &result : mResults) {
+      const auto rate = result.seconds > 0 ? result.work / result.seconds : 0;
+      ok = ok && file.Write(wxString::Format(
+         wxT("%s{\"name\":%s,\"unit\":%s,\"ok\":%s,\"iterations\":%d,")
+         wxT("\"seconds\":%s,\"work\":%s,\"per_second\":%s}"),
+         first ? wxT("") : wxT(",\n"),
+         quote(result.name), quote(result.unit),
+         result.ok ? wxT("true") : wxT("false"),
+         (int)result.iterations,
+         Internat::ToString(result.seconds, 6),
+         Internat::ToString(result.work, 0),
+         Internat::ToString(rate, 1)));
+      first = false;
+   }
+   ok = ok && file.Write(wxT("\n]}\n"));
+   return file.Close() && ok;
+}
+
+}
+
+bool RunBenchmarkSuite(AudacityProject *project, const wxString &fileName)
+{
+   BenchmarkSuite suite{ *project };
+   suite.RunAll();
+   return suite.Write(fileName) && suite.AllSucceeded();
+}
@@ -11,6 +11,14 @@
 #ifndef __AUDACITY_BENCHMARK__
 #define __AUDACITY_BENCHMARK__
 
+class AudacityProject;
+
 void RunBenchmark(wxWindow *parent);
 
+/// Runs timings of block files, sequences, mixing, FFTs, spectrograms,
+/// effects and each import and export format, without user interaction, and
+/// writes the results to fileName as JSON.  The project should be empty.
+/// Returns false if any test fails or the file can't be written.
+bool RunBenchmarkSuite(AudacityProject *project, const wxString &fileName);
+
 #endif // define __AUDACITY_BENCHMARK__
@@ -0,0 +1,252 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockCompactor.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "BlockCompactor.h"
+
+#include <algorithm>
+#include <wx/utils.h>
+#include <wx/window.h>
+
+#include "AudacityException.h"
+#include "AudioIO.h"
+#include "BlockFile.h"
+#include "Project.h"
+#include "Sequence.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+
+namespace {
+   // Each run is at most one block, about 1 MB, so this bounds the memory
+   // that one job holds
+   const size_t MaxRunsPerJob = 16;
+
+   // Seconds before looking again in a project that had no small blocks
+   const long SearchInterval = 10;
+}
+
+struct BlockCompactor::Job
+{
+   // Compared, never dereferenced
+   const AudacityProject *project;
+   std::weak_ptr<WaveTrack> pTrack;
+   // Compared, never dereferenced
+   const WaveClip *clip;
+   // Holding the block files also keeps their addresses from being reused
+   BlockArray blocks;
+   sampleFormat format;
+   std::vector<Sequence::BlockRun> runs;
+
+   // Written by the thread, then used by the main thread:
+   std::vector< ArrayOf<char> > samples;
+   bool finished { false };
+   bool failed { false };
+
+   // Whether the clip still has the blocks that were read.  Every edit of
+   // the samples makes NEW block files.
+   bool Matches(const WaveClip &other) const
+   {
+      if (&other != clip)
+         return false;
+      const auto &otherBlocks = other.GetSequence()->GetBlockArray();
+      return otherBlocks.size() == blocks.size() &&
+         std::equal(blocks.begin(), blocks.end(), otherBlocks.begin(),
+            [](const SeqBlock &a, const SeqBlock &b)
+               { return a.f == b.f && a.start == b.start; });
+   }
+};
+
+BlockCompactor &BlockCompactor::Get()
+{
+   static BlockCompactor compactor;
+   return compactor;
+}
+
+BlockCompactor::BlockCompactor()
+{
+   mThread = std::thread{ [this]{ ReaderLoop(); } };
+}
+
+BlockCompactor::~BlockCompactor()
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mStopping = true;
+   }
+   mCondition.notify_all();
+   if ( mThread.joinable() )
+      mThread.join();
+}
+
+void BlockCompactor::ReaderLoop()
+{
+   std::unique_lock< std::mutex > lock{ mMutex };
+   while ( true ) {
+      mCondition.wait( lock,
+         [this]{ return mStopping || ( mJob && !mJob->finished ); } );
+      if ( mStopping )
+         return;
+
+      // The main thread leaves an unfinished job alone
+      auto &job = *mJob;
+      mReading = true;
+      lock.unlock();
+      const bool success = Read( job );
+      lock.lock();
+      job.failed = !success;
+      job.finished = true;
+      mReading = false;
+      mCondition.notify_all();
+   }
+}
+
+bool BlockCompactor::Read(Job &job)
+{
+   const auto sampleSize = SAMPLE_SIZE(job.format);
+   try {
+      for (const auto &run : job.runs) {
+         size_t total = 0;
+         for (size_t ii = 0; ii < run.second; ++ii)
+            total += job.blocks[run.first + ii].f->GetLength();
+
+         ArrayOf<char> samples{ total * sampleSize };
+         size_t offset = 0;
+         for (size_t ii = 0; ii < run.second; ++ii) {
+            const auto &file = *job.blocks[run.first + ii].f;
+            const auto len = file.GetLength();
+            if (file.ReadData(samples.get() + offset * sampleSize,
+                  job.format, 0, len, false) != len)
+               return false;
+            offset += len;
+         }
+         job.samples.push_back(std::move(samples));
+      }
+   }
+   catch ( ... ) {
+      return false;
+   }
+   return true;
+}
+
+bool BlockCompactor::CanReplace(AudacityProject &project)
+{
+   // Not while the audio thread reads the tracks, nor while a dialog or a
+   // drag might hold on to their clips
+   return !gAudioIO->IsBusy() && project.IsEnabled() && !wxWindow::GetCapture();
+}
+
+void BlockCompactor::Poll(AudacityProject &project)
+{
+   if (!CanReplace(project))
+      return;
+
+   std::unique_ptr<Job> finished;
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      if (mJob) {
+         if (mJob->project != &project || !mJob->finished)
+            return;
+         finished = std::move(mJob);
+      }
+   }
+
+   if (finished) {
+      // The block files of the job are released here, on the main thread
+      if (!finished->failed)
+         Replace(project, *finished);
+      return;
+   }
+
+   const auto now = ::wxGetUTCTime();
+   auto &next = mNextSearch[&project];
+   if (now < next)
+      return;
+
+   auto job = FindJob(project);
+   if (!job) {
+      next = now + SearchInterval;
+      return;
+   }
+
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mJob = std::move(job);
+   }
+   mCondition.notify_all();
+}
+
+void BlockCompactor::Abandon(const AudacityProject &project)
+{
+   mNextSearch.erase(&project);
+
+   std::unique_ptr<Job> abandoned;
+   {
+      std::unique_lock< std::mutex > lock{ mMutex };
+      if (!mJob || mJob->project != &project)
+         return;
+      mCondition.wait( lock, [this]{ return !mReading; } );
+      abandoned = std::move(mJob);
+   }
+}
+
+std::unique_ptr<BlockCompactor::Job>
+BlockCompactor::FindJob(AudacityProject &project)
+{
+   TrackListOfKindIterator iter(Track::Wave, project.GetTracks());
+   for (Track *t = iter.First(); t; t = iter.Next()) {
+      const auto track = static_cast<WaveTrack*>(t);
+      for (const auto &clip : track->GetClips()) {
+         const auto sequence = clip->GetSequence();
+         auto runs = sequence->FindSmallBlockRuns();
+         if (runs.empty())
+            continue;
+         if (runs.size() > MaxRunsPerJob)
+            runs.resize(MaxRunsPerJob);
+
+         auto job = std::make_unique<Job>();
+         job->project = &project;
+         job->pTrack = Track::Pointer<WaveTrack>(track);
+         job->clip = clip.get();
+         job->blocks = sequence->GetBlockArray();
+         job->format = sequence->GetSampleFormat();
+         job->runs = std::move(runs);
+         return job;
+      }
+   }
+   return {};
+}
+
+void BlockCompactor::Replace(AudacityProject &project, Job &job)
+{
+   // Deleting the track, or any edit of the clip, abandons the job
+   const auto track = project.GetTracks()->Lock(job.pTrack);
+   if (!track)
+      return;
+   WaveClip *clip = nullptr;
+   for (const auto &pClip : track->GetClips())
+      if (job.Matches(*pClip))
+         clip = pClip.get();
+   if (!clip)
+      return;
+
+   const auto sequence = clip->GetSequence();
+   // A failure, such as of a full disk, is not reported:  the small blocks
+   // serve as well
+   GuardedCall( [&] {
+      // From the last run, so that the indices of the others stay good
+      for (auto ii = job.runs.size(); ii--;)
+         sequence->MergeBlocks(job.runs[ii], job.samples[ii].get());
+   }, MakeSimpleGuard(), [](AudacityException*){} );
+
+   // Even if only some runs were merged, the samples are the same
+   clip->MarkChanged();
+   project.ModifyState(false);
+}
@@ -0,0 +1,83 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockCompactor.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class BlockCompactor
+\brief Merges the runs of small blocks that editing leaves in sequences
+into blocks of good size, while the project is idle.
+
+  One thread reads the small blocks of one clip at a time, from its own
+  references to the block files, so the clip may be edited meanwhile.  On
+  the main thread, Poll() finds the next clip with small blocks, and when
+  the reading is done and the clip still has the same blocks, makes the
+  merged block files, because DirManager is not thread-safe, and swaps
+  them into the sequence.  Then it modifies the present undo state to
+  share the merged blocks, so that the small ones are freed once no other
+  state holds them.  The samples stay the same, so the project is not
+  made dirty.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_COMPACTOR__
+#define __AUDACITY_BLOCK_COMPACTOR__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+class AudacityProject;
+
+class BlockCompactor
+{
+ public:
+   ///Gets the singleton instance, starting the thread
+   static BlockCompactor &Get();
+
+   ///Call on the main thread, often.  Does nothing while the project is
+   ///busy, playing, or recording.
+   void Poll(AudacityProject &project);
+
+   ///Drops the work for the project, which is closing, waiting for reading
+   ///of its blocks to finish
+   void Abandon(const AudacityProject &project);
+
+ private:
+   struct Job;
+
+   BlockCompactor();
+   ~BlockCompactor();
+   BlockCompactor( const BlockCompactor& ) PROHIBITED;
+   BlockCompactor &operator= ( const BlockCompactor& ) PROHIBITED;
+
+   void ReaderLoop();
+   static bool Read(Job &job);
+   static bool CanReplace(AudacityProject &project);
+   static std::unique_ptr<Job> FindJob(AudacityProject &project);
+   static void Replace(AudacityProject &project, Job &job);
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+
+   // Guarded by mMutex:
+   std::unique_ptr<Job> mJob;
+   bool mReading { false };
+   bool mStopping { false };
+
+   // Used only by the main thread:  when to look again in each project
+   // that had no small blocks
+   std::map< const AudacityProject*, long > mNextSearch;
+
+   std::thread mThread;
+};
+
+#endif
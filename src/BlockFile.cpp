@@ -44,6 +44,7 @@ out.
 
 #include <float.h>
 #include <cmath>
+#include <limits>
 
 #include <wx/utils.h>
 #include <wx/filefn.h>
@@ -55,6 +56,9 @@ out.
 #include "sndfile.h"
 #include "FileFormats.h"
 #include "AudacityApp.h"
+#include "DirManager.h"
+#include "MappedFile.h"
+#include "SoundFileCache.h"
 
 // msmeyer: Define this to add debug output via wxPrintf()
 //#define DEBUG_BLOCKFILE
@@ -102,7 +106,8 @@ BlockFile::BlockFile(wxFileNameWrapper &&fileName, size_t samples):
    mLockCount(0),
    mFileName(std::move(fileName)),
    mLen(samples),
-   mSummaryInfo(samples)
+   mSummaryInfo(samples),
+   mSampleSum(std::numeric_limits<double>::quiet_NaN())
 {
    mSilentLog=FALSE;
 }
@@ -112,9 +117,12 @@ unsigned long BlockFile::gBlockFileDestructionCount { 0 };
 
 BlockFile::~BlockFile()
 {
-   if (!IsLocked() && mFileName.HasName())
+   if (!IsLocked() && mFileName.HasName()) {
+      const auto fullPath = mFileName.GetFullPath();
+      DirManager::GetMappedFileCache().Invalidate(fullPath);
       // PRL: what should be done if this fails?
-      wxRemoveFile(mFileName.GetFullPath());
+      wxRemoveFile(fullPath);
+   }
 
    ++gBlockFileDestructionCount;
 }
@@ -132,6 +140,8 @@ auto BlockFile::GetFileName() const -> GetFileNameResult
 ///sets the file name the summary info will be saved in.  threadsafe.
 void BlockFile::SetFileName(wxFileNameWrapper &&name)
 {
+   if (mFileName.HasName())
+      DirManager::GetMappedFileCache().Invalidate(mFileName.GetFullPath());
    mFileName=std::move(name);
 }
 
@@ -208,6 +218,7 @@ void BlockFile::CalcSummaryFromBuffer(const float *fbuffer, size_t len,
    float min, max;
    float sumsq;
    double totalSquares = 0.0;
+   double total = 0.0;
    double fraction { 0.0 };
 
    // Recalc 256 summaries
@@ -218,6 +229,7 @@ void BlockFile::CalcSummaryFromBuffer(const float *fbuffer, size_t len,
       min = fbuffer[i * 256];
       max = fbuffer[i * 256];
       sumsq = ((float)min) * ((float)min);
+      total += min;
       decltype(len) jcount = 256;
       if (jcount > len - i * 256) {
          jcount = len - i * 256;
@@ -226,6 +238,7 @@ void BlockFile::CalcSummaryFromBuffer(const float *fbuffer, size_t len,
       for (decltype(jcount) j = 1; j < jcount; j++) {
          float f1 = fbuffer[i * 256 + j];
          sumsq += ((float)f1) * ((float)f1);
+         total += f1;
          if (f1 < min)
             min = f1;
          else if (f1 > max)
@@ -250,6 +263,7 @@ void BlockFile::CalcSummaryFromBuffer(const float *fbuffer, size_t len,
 
    // Calculate now while we can do it accurately
    mRMS = sqrt(totalSquares/len);
+   mSampleSum.store(total, std::memory_order_relaxed);
 
    // Recalc 64K summaries
    sumLen = (len + 65535) / 65536;
@@ -366,28 +380,83 @@ void BlockFile::FixSummary(void *data)
 ///
 /// @param start The offset in this block where the region should begin
 /// @param len   The number of samples to include in the region
-auto BlockFile::GetMinMaxRMS(size_t start, size_t len, bool mayThrow)
-   const -> MinMaxRMS
+double BlockFile::GetSum(size_t start, size_t len, bool mayThrow) const
 {
-   // TODO: actually use summaries
-   SampleBuffer blockData(len, floatSample);
+   const bool whole = (start == 0 && len == mLen);
+   if (whole) {
+      const auto sum = mSampleSum.load(std::memory_order_relaxed);
+      if (!std::isnan(sum))
+         return sum;
+   }
 
-   this->ReadData(blockData.ptr(), floatSample, start, len, mayThrow);
+   SampleBuffer blockData(len, floatSample);
+   const auto count =
+      this->ReadData(blockData.ptr(), floatSample, start, len, mayThrow);
+   const auto samples = (const float*)blockData.ptr();
+   double sum = 0;
+   for (decltype(count) i = 0; i < count; i++)
+      sum += samples[i];
+
+   // Any thread reading the whole block finds the same sum; but not if the
+   // samples were not all there
+   if (whole && count == len)
+      mSampleSum.store(sum, std::memory_order_relaxed);
+   return sum;
+}
 
+auto BlockFile::GetMinMaxRMS(size_t start, size_t len, bool mayThrow)
+   const -> MinMaxRMS
+{
    float min = FLT_MAX;
    float max = -FLT_MAX;
-   float sumsq = 0;
+   double sumsq = 0;
 
-   for( decltype(len) i = 0; i < len; i++ )
-   {
-      float sample = ((float*)blockData.ptr())[i];
-
-      if( sample > max )
-         max = sample;
-      if( sample < min )
-         min = sample;
-      sumsq += (sample*sample);
+   auto scan = [&](size_t from, size_t to) {
+      if (from >= to)
+         return;
+      const auto count = to - from;
+      SampleBuffer blockData(count, floatSample);
+      this->ReadData(blockData.ptr(), floatSample, from, count, mayThrow);
+
+      for( decltype(count) i = 0; i < count; i++ )
+      {
+         float sample = ((float*)blockData.ptr())[i];
+
+         if( sample > max )
+            max = sample;
+         if( sample < min )
+            min = sample;
+         sumsq += (sample*sample);
+      }
+   };
+
+   // Whole groups of 256 samples are taken from the summary, if it has
+   // true RMS values (not so in legacy files) and is computed already.
+   // Only the group at the end of the block may be shorter.
+   const auto end = start + len;
+   const size_t first = (start + 255) / 256;
+   const size_t last = (end == mLen) ? (mLen + 255) / 256 : end / 256;
+   bool summarized = false;
+   if (first < last && mSummaryInfo.fields == 3 && IsSummaryAvailable()) {
+      Floats summary{ 3 * (last - first) };
+      // Reading the summary changes no more than the mutable log flag
+      if (const_cast<BlockFile*>(this)->Read256(
+             summary.get(), first, last - first)) {
+         for (size_t i = 0; i < last - first; ++i) {
+            const auto groupStart = (first + i) * 256;
+            const auto count = std::min<size_t>(256, mLen - groupStart);
+            min = std::min(min, summary[3 * i]);
+            max = std::max(max, summary[3 * i + 1]);
+            const double rms = summary[3 * i + 2];
+            sumsq += rms * rms * count;
+         }
+         scan(start, first * 256);
+         scan(std::min(last * 256, mLen), end);
+         summarized = true;
+      }
    }
+   if (!summarized)
+      scan(start, end);
 
    return { min, max, (float)sqrt(sumsq/len) };
 }
@@ -480,6 +549,63 @@ bool BlockFile::Read64K(float *buffer,
    return result;
 }
 
+/// Retrieves a portion of the 4096-sample summary, in the same triples as
+/// Read256() and Read64K().  That level is not saved with the block but
+/// made from the 256-sample summary by ComputeSummary4K().
+///
+/// @param *buffer The area where the summary information will be
+///                written.  It must be at least len*3 long.
+/// @param start   The offset in 4096-sample increments
+/// @param len     The number of 4096-sample summary frames to read
+bool BlockFile::Read4K(float *buffer, size_t start, size_t len) const
+{
+   const auto summary = std::atomic_load( &mSummary4K );
+   if (!summary)
+      return false;
+
+   const auto frames = summary->size() / 3;
+   start = std::min( start, frames );
+   len = std::min( len, frames - start );
+   std::copy(summary->begin() + 3 * start,
+             summary->begin() + 3 * (start + len), buffer);
+   return true;
+}
+
+void BlockFile::ComputeSummary4K()
+{
+   if (IsSummary4KAvailable() || !IsSummaryAvailable())
+      return;
+
+   const auto frames256 = mSummaryInfo.frames256;
+   Floats summary256{ 3 * frames256 };
+   if (!Read256(summary256.get(), 0, frames256))
+      return;
+
+   // Frames past the end of the samples are padding, and have no RMS
+   const size_t used256 = (mLen + 255) / 256;
+   const size_t frames4K = (used256 + 15) / 16;
+   auto summary = std::make_shared< std::vector< float > >( 3 * frames4K );
+   for (size_t ii = 0; ii < frames4K; ++ii) {
+      const size_t first = 16 * ii;
+      const size_t last = std::min( first + 16, used256 );
+      float min = summary256[3 * first];
+      float max = summary256[3 * first + 1];
+      double sumsq = 0;
+      for (auto jj = first; jj < last; ++jj) {
+         min = std::min( min, summary256[3 * jj] );
+         max = std::max( max, summary256[3 * jj + 1] );
+         const double rms = summary256[3 * jj + 2];
+         sumsq += rms * rms;
+      }
+      (*summary)[3 * ii] = min;
+      (*summary)[3 * ii + 1] = max;
+      (*summary)[3 * ii + 2] = sqrt(sumsq / (last - first));
+   }
+
+   std::shared_ptr< const std::vector< float > > result{ std::move(summary) };
+   std::atomic_store( &mSummary4K, result );
+}
+
 size_t BlockFile::CommonReadData(
    bool mayThrow,
    const wxFileName &fileName, bool &mSilentLog,
@@ -518,6 +644,10 @@ size_t BlockFile::CommonReadData(
 
    wxFile f;   // will be closed when it goes out of scope
    SFFile sf;
+   // Or, for aliased files, which are read a block at a time, a file kept
+   // open between reads
+   SoundFileCache::Lease lease;
+   SNDFILE *sndFile = nullptr;
 
    {
       Maybe<wxLogNull> silence{};
@@ -525,14 +655,22 @@ size_t BlockFile::CommonReadData(
          silence.create();
 
       const auto fullPath = fileName.GetFullPath();
-      if (wxFile::Exists(fullPath) && f.Open(fullPath)) {
+      if (pAliasFile && !pLegacyFormat) {
+         lease = DirManager::GetSoundFileCache().Acquire(fullPath);
+         if (lease) {
+            sndFile = lease->sf.get();
+            info = lease->info;
+         }
+      }
+      else if (wxFile::Exists(fullPath) && f.Open(fullPath)) {
          // Even though there is an sf_open() that takes a filename, use the one that
          // takes a file descriptor since wxWidgets can open a file with a Unicode name and
          // libsndfile can't (under Windows).
          sf.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &info, FALSE));
+         sndFile = sf.get();
       }
 
-      if (!sf) {
+      if (!sndFile) {
 
          memset(data, 0, SAMPLE_SIZE(format)*len);
 
@@ -543,12 +681,12 @@ size_t BlockFile::CommonReadData(
          }
       }
    }
-   mSilentLog = !sf;
+   mSilentLog = !sndFile;
 
    size_t framesRead = 0;
-   if (sf) {
+   if (sndFile) {
       auto seek_result = SFCall<sf_count_t>(
-         sf_seek, sf.get(), ( origin + start ).as_long_long(), SEEK_SET);
+         sf_seek, sndFile, ( origin + start ).as_long_long(), SEEK_SET);
 
       if (seek_result < 0)
          // error
@@ -564,13 +702,13 @@ size_t BlockFile::CommonReadData(
             // If both the src and dest formats are integer formats,
             // read integers directly from the file, comversions not needed
             framesRead = SFCall<sf_count_t>(
-               sf_readf_short, sf.get(), (short *)data, len);
+               sf_readf_short, sndFile, (short *)data, len);
          }
          else if (channels == 1 &&
                   format == int24Sample &&
                   sf_subtype_is_integer(info.format)) {
             framesRead = SFCall<sf_count_t>(
-               sf_readf_int, sf.get(), (int *)data, len);
+               sf_readf_int, sndFile, (int *)data, len);
 
             // libsndfile gave us the 3 byte sample in the 3 most
             // significant bytes -- we want it in the 3 least
@@ -587,7 +725,7 @@ size_t BlockFile::CommonReadData(
             // case, as most audio files are 16-bit.
             SampleBuffer buffer(len * channels, int16Sample);
             framesRead = SFCall<sf_count_t>(
-               sf_readf_short, sf.get(), (short *)buffer.ptr(), len);
+               sf_readf_short, sndFile, (short *)buffer.ptr(), len);
             for (size_t i = 0; i < framesRead; i++)
                ((short *)data)[i] =
                ((short *)buffer.ptr())[(channels * i) + channel];
@@ -598,7 +736,7 @@ size_t BlockFile::CommonReadData(
             // then convert to whatever format we want.
             SampleBuffer buffer(len * channels, floatSample);
             framesRead = SFCall<sf_count_t>(
-               sf_readf_float, sf.get(), (float *)buffer.ptr(), len);
+               sf_readf_float, sndFile, (float *)buffer.ptr(), len);
             auto bufferPtr = (samplePtr)((float *)buffer.ptr() + channel);
             CopySamples(bufferPtr, floatSample,
                         (samplePtr)data, format,
@@ -610,6 +748,8 @@ size_t BlockFile::CommonReadData(
    }
 
    if ( framesRead < len ) {
+      // Don't trust the state of a file that failed
+      lease.Discard();
       if (mayThrow)
          throw FileException{ FileException::Cause::Read, fileName };
       ClearSamples(data, format, framesRead, len - framesRead);
@@ -681,6 +821,12 @@ void AliasBlockFile::WriteSummary()
    SampleBuffer sampleData(mLen, floatSample);
    this->ReadData(sampleData.ptr(), floatSample, 0, mLen);
 
+   WriteSummaryFromSamples(sampleData.ptr(), floatSample);
+}
+
+void AliasBlockFile::WriteSummaryFromSamples(samplePtr sampleData,
+                                             sampleFormat format)
+{
    // Now checked carefully in the DirManager
    //wxASSERT( !wxFileExists(FILENAME(mFileName.GetFullPath())));
 
@@ -699,8 +845,8 @@ void AliasBlockFile::WriteSummary()
    }
 
    ArrayOf<char> cleanup;
-   void *summaryData = BlockFile::CalcSummary(sampleData.ptr(), mLen,
-                                            floatSample, cleanup);
+   void *summaryData = BlockFile::CalcSummary(sampleData, mLen,
+                                            format, cleanup);
    summaryFile.Write(summaryData, mSummaryInfo.totalSummaryBytes);
 }
 
@@ -16,6 +16,8 @@
 #include <wx/string.h>
 #include <wx/ffile.h>
 #include <wx/filename.h>
+#include <atomic>
+#include <vector>
 
 #include "xml/XMLTagHandler.h"
 #include "xml/XMLWriter.h"
@@ -74,17 +76,17 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
                         size_t start, size_t len, bool mayThrow = true)
       const = 0;
 
+   /// Reads the samples, or only the summary, and discards them, so that
+   /// the operating system has them cached when really read.  May be
+   /// called on any thread; errors are ignored.
+   virtual void Prefetch(bool WXUNUSED(summaryOnly)) const {}
+
    // Other Properties
 
    // Write cache to disk, if it has any
    virtual bool GetNeedWriteCacheToDisk() { return false; }
    virtual void WriteCacheToDisk() { /* no cache by default */ }
 
-   // Fill read cache of block file, if it has any
-   virtual bool GetNeedFillCache() { return false; }
-
-   virtual void FillCache() /* noexcept */ { /* no cache by default */ }
-
    /// Stores a representation of this file in XML
    virtual void SaveXML(XMLWriter &xmlFile) = 0;
 
@@ -128,11 +130,23 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
                           bool mayThrow = true) const;
    /// Gets extreme values for the entire block
    virtual MinMaxRMS GetMinMaxRMS(bool mayThrow = true) const;
+   /// Gets the sum of the samples in the specified region; the sum of the
+   /// entire block is kept in memory once known
+   double GetSum(size_t start, size_t len, bool mayThrow = true) const;
    /// Returns the 256 byte summary data block
    virtual bool Read256(float *buffer, size_t start, size_t len);
    /// Returns the 64K summary data block
    virtual bool Read64K(float *buffer, size_t start, size_t len);
 
+   /// Returns frames of the 4096-sample summary, which is kept only in
+   /// memory; false if ComputeSummary4K() has not yet been done
+   bool Read4K(float *buffer, size_t start, size_t len) const;
+   bool IsSummary4KAvailable() const
+   { return std::atomic_load( &mSummary4K ) != nullptr; }
+   /// Reduces the 256-sample summary to the 4096-sample one, if the
+   /// summary is available.  May be called on any thread.
+   void ComputeSummary4K();
+
    /// Returns TRUE if this block references another disk file
    virtual bool IsAlias() const { return false; }
 
@@ -236,7 +250,13 @@ class PROFILE_DLL_API BlockFile /* not final, abstract */ {
    size_t mLen;
    SummaryInfo mSummaryInfo;
    float mMin, mMax, mRMS;
+   // Not known, until NaN is replaced by the summary or a first full read
+   mutable std::atomic<double> mSampleSum;
    mutable bool mSilentLog;
+
+ private:
+   // Set once, by std::atomic_store, because the samples never change
+   std::shared_ptr< const std::vector< float > > mSummary4K;
 };
 
 /// A BlockFile that refers to data in an existing file
@@ -276,6 +296,7 @@ class AliasBlockFile /* not final */ : public BlockFile
    // These methods are for advanced use only!
    //
    const wxFileName &GetAliasedFileName() const { return mAliasedFileName; }
+   sampleCount GetAliasStart() const { return mAliasStart; }
    void ChangeAliasedFileName(wxFileNameWrapper &&newAliasedFile);
    bool IsAlias() const override { return true; }
 
@@ -283,6 +304,8 @@ class AliasBlockFile /* not final */ : public BlockFile
    // Introduce a NEW virtual.
    /// Write the summary to disk, using the derived ReadData() to get the data
    virtual void WriteSummary();
+   /// Write the summary to disk from samples already read from the aliased file
+   void WriteSummaryFromSamples(samplePtr sampleData, sampleFormat format);
    /// Read the summary into a buffer
    bool ReadSummary(ArrayOf<char> &data) override;
 
@@ -0,0 +1,127 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockPrefetchQueue.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "BlockPrefetchQueue.h"
+
+#include <algorithm>
+
+#include "BlockFile.h"
+#include "ondemand/ODManager.h"
+
+namespace {
+   // Blocks reduced in each loop of the worker threads, few enough that
+   // reading and drawing don't wait long behind them
+   const size_t ReductionBatch = 16;
+   // Older requests for reductions are dropped beyond this
+   const size_t MaxReductions = 1024;
+}
+
+BlockPrefetchQueue &BlockPrefetchQueue::Get()
+{
+   static BlockPrefetchQueue queue;
+   return queue;
+}
+
+BlockPrefetchQueue::BlockPrefetchQueue()
+   : mThread{ [this]{ ReaderLoop(); } }
+{
+}
+
+BlockPrefetchQueue::~BlockPrefetchQueue()
+{
+   // Unlike writes, blocks still waiting are just dropped
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mStopping = true;
+      mData.clear();
+      mSummaries.clear();
+      mReductions.clear();
+   }
+   mPushedCondition.notify_one();
+   mThread.join();
+}
+
+void BlockPrefetchQueue::PushData( BlockFiles &&files )
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mData.assign(
+         std::make_move_iterator( files.begin() ),
+         std::make_move_iterator( files.end() ) );
+   }
+   mPushedCondition.notify_one();
+}
+
+void BlockPrefetchQueue::PushSummaries( BlockFiles &&files )
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mSummaries.assign(
+         std::make_move_iterator( files.begin() ),
+         std::make_move_iterator( files.end() ) );
+   }
+   mPushedCondition.notify_one();
+}
+
+void BlockPrefetchQueue::PushReductions( BlockFiles &&files )
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      // Each clip drawn asks for its own blocks, so these accumulate
+      mReductions.insert( mReductions.end(),
+         std::make_move_iterator( files.begin() ),
+         std::make_move_iterator( files.end() ) );
+      if ( mReductions.size() > MaxReductions )
+         mReductions.erase( mReductions.begin(),
+            mReductions.end() - MaxReductions );
+   }
+   mPushedCondition.notify_one();
+}
+
+void BlockPrefetchQueue::ReaderLoop()
+{
+   while ( true ) {
+      std::weak_ptr< BlockFile > next;
+      bool summaryOnly = false;
+      BlockFiles batch;
+      {
+         std::unique_lock< std::mutex > lock{ mMutex };
+         mPushedCondition.wait( lock, [this]{
+            return mStopping || !mData.empty() || !mSummaries.empty() ||
+               !mReductions.empty(); } );
+         if ( mStopping )
+            return;
+         if ( mData.empty() && mSummaries.empty() ) {
+            const auto end = mReductions.begin() +
+               std::min( ReductionBatch, mReductions.size() );
+            batch.assign( std::make_move_iterator( mReductions.begin() ),
+               std::make_move_iterator( end ) );
+            mReductions.erase( mReductions.begin(), end );
+         }
+         else {
+            summaryOnly = mData.empty();
+            auto &queue = summaryOnly ? mSummaries : mData;
+            next = std::move( queue.front() );
+            queue.pop_front();
+         }
+      }
+
+      if ( !batch.empty() )
+         ODManager::Instance()->ParallelFor( batch.size(), [&]( size_t ii ){
+            if ( auto file = batch[ ii ].lock() )
+               file->ComputeSummary4K();
+         } );
+      // A block discarded before its turn needs no reading
+      else if ( auto file = next.lock() )
+         file->Prefetch( summaryOnly );
+   }
+}
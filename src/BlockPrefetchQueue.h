@@ -0,0 +1,76 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockPrefetchQueue.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class BlockPrefetchQueue
+\brief One thread that reads block files ahead of need, so that the
+operating system has them cached when playback or drawing gets to them.
+
+  Nothing read is kept; BlockFile::Prefetch() only touches the disk.
+  Each request replaces the blocks of the same kind still waiting from
+  the request before, because the play head or the view has moved on.
+  Blocks for playback are read before summaries for the view.
+
+  Last of all, blocks whose 4096-sample summary level the view wants are
+  given to BlockFile::ComputeSummary4K() in batches, on the worker threads
+  of ODManager.  That result is kept, in the block.  These requests
+  accumulate, rather than replace, up to a limit.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_PREFETCH_QUEUE__
+#define __AUDACITY_BLOCK_PREFETCH_QUEUE__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class BlockFile;
+
+class BlockPrefetchQueue
+{
+ public:
+   using BlockFiles = std::vector< std::weak_ptr< BlockFile > >;
+
+   ///Gets the singleton instance, starting the thread
+   static BlockPrefetchQueue &Get();
+
+   ///Samples of the blocks, for playback
+   void PushData( BlockFiles &&files );
+   ///Summaries of the blocks, for drawing
+   void PushSummaries( BlockFiles &&files );
+   ///Blocks lacking the 4096-sample summary, for drawing
+   void PushReductions( BlockFiles &&files );
+
+ private:
+   BlockPrefetchQueue();
+   ~BlockPrefetchQueue();
+   BlockPrefetchQueue( const BlockPrefetchQueue& ) PROHIBITED;
+   BlockPrefetchQueue &operator= ( const BlockPrefetchQueue& ) PROHIBITED;
+
+   void ReaderLoop();
+
+   std::mutex mMutex;
+   std::condition_variable mPushedCondition;
+
+   // Guarded by mMutex:
+   std::deque< std::weak_ptr< BlockFile > > mData;
+   std::deque< std::weak_ptr< BlockFile > > mSummaries;
+   std::deque< std::weak_ptr< BlockFile > > mReductions;
+   bool mStopping { false };
+
+   std::thread mThread;
+};
+
+#endif
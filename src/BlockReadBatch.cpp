@@ -0,0 +1,117 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockReadBatch.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "BlockReadBatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "ThreadPool.h"
+
+namespace {
+   // Enough reads in flight to keep a solid state drive or a network share
+   // busy; they cost little processor time
+   const unsigned MinimumReadThreads = 16;
+
+   class ThreadedBackend final : public BlockReadBatch::Backend
+   {
+   public:
+      ThreadedBackend()
+         : mPool{ std::max( MinimumReadThreads,
+                            ThreadPool::DefaultConcurrency() ) }
+      {}
+
+      void ReadAll( const std::vector< BlockReadBatch::Read > &reads,
+                    std::vector< char > &results ) override
+      {
+         mPool.ParallelFor( reads.size(), [&]( size_t ii ){
+            results[ii] = reads[ii]() ? 1 : 0;
+         } );
+      }
+
+   private:
+      ThreadPool mPool;
+   };
+
+   // Held while a batch runs, because ThreadPool::ParallelFor allows one
+   // caller at a time, and so that the backend is not replaced meanwhile
+   std::mutex &BackendMutex()
+   {
+      static std::mutex mutex;
+      return mutex;
+   }
+
+   // Guarded by BackendMutex(); made when first wanted
+   std::unique_ptr< BlockReadBatch::Backend > &TheBackend()
+   {
+      static std::unique_ptr< BlockReadBatch::Backend > pBackend;
+      return pBackend;
+   }
+
+   std::atomic< unsigned long long > sBatches{ 0 };
+   std::atomic< unsigned long long > sReads{ 0 };
+   std::atomic< unsigned long long > sFailures{ 0 };
+}
+
+BlockReadBatch::Backend::~Backend()
+{
+}
+
+void BlockReadBatch::SetBackend( std::unique_ptr< Backend > pBackend )
+{
+   std::lock_guard< std::mutex > lock{ BackendMutex() };
+   TheBackend() = std::move( pBackend );
+}
+
+auto BlockReadBatch::GetStatistics() -> Statistics
+{
+   return { sBatches.load(), sReads.load(), sFailures.load() };
+}
+
+void BlockReadBatch::Add( Read read, Completion completion )
+{
+   mReads.push_back( std::move( read ) );
+   mCompletions.push_back( std::move( completion ) );
+}
+
+void BlockReadBatch::Run()
+{
+   if ( mReads.empty() )
+      return;
+
+   // Empty the batch, even if a completion throws
+   auto cleanup = finally( [this]{
+      mReads.clear();
+      mCompletions.clear();
+   } );
+
+   mResults.assign( mReads.size(), 0 );
+   if ( mReads.size() == 1 )
+      // Nothing to overlap
+      mResults[0] = mReads[0]() ? 1 : 0;
+   else {
+      std::lock_guard< std::mutex > lock{ BackendMutex() };
+      auto &pBackend = TheBackend();
+      if ( !pBackend )
+         pBackend = std::make_unique< ThreadedBackend >();
+      pBackend->ReadAll( mReads, mResults );
+   }
+
+   ++sBatches;
+   sReads += mReads.size();
+   sFailures += std::count( mResults.begin(), mResults.end(), 0 );
+
+   for ( size_t ii = 0; ii < mCompletions.size(); ++ii )
+      if ( mCompletions[ii] )
+         mCompletions[ii]( mResults[ii] != 0 );
+}
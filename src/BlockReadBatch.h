@@ -0,0 +1,81 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockReadBatch.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class BlockReadBatch
+\brief Reads of blocks gathered from many tracks, that are submitted all
+at once and waited for together, so that their latencies overlap.
+
+  Each read is a blocking call, as BlockFile::ReadData() is, and reports
+  success.  When all are finished, Run() calls each completion on the
+  calling thread, in the order added, so that it may publish the result
+  without locking.
+
+  How the reads are performed is up to a BlockReadBatch::Backend, which
+  may be replaced.  The default one gives them to a pool of threads that
+  is larger than the number of processors, because the threads mostly
+  wait on the disk or the network.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_READ_BATCH__
+#define __AUDACITY_BLOCK_READ_BATCH__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+#include <functional>
+#include <vector>
+
+class BlockReadBatch
+{
+public:
+   // Called on any thread; must not throw
+   using Read = std::function< bool() >;
+   // Called on the thread of Run(), with the result of the read
+   using Completion = std::function< void( bool success ) >;
+
+   class Backend
+   {
+   public:
+      virtual ~Backend();
+      // Perform every read, setting results[i] nonzero for each success,
+      // and return when all are done
+      virtual void ReadAll(
+         const std::vector< Read > &reads, std::vector< char > &results ) = 0;
+   };
+
+   // Replace the backend for all batches; null restores the default
+   static void SetBackend( std::unique_ptr< Backend > pBackend );
+
+   // Counts since the program started, for diagnostics
+   struct Statistics {
+      unsigned long long batches, reads, failures;
+   };
+   static Statistics GetStatistics();
+
+   BlockReadBatch() = default;
+   BlockReadBatch( const BlockReadBatch& ) PROHIBITED;
+   BlockReadBatch &operator= ( const BlockReadBatch& ) PROHIBITED;
+
+   void Add( Read read, Completion completion );
+   size_t size() const { return mReads.size(); }
+   bool empty() const { return mReads.empty(); }
+
+   // Perform all reads added, then call their completions, and empty the
+   // batch for reuse
+   void Run();
+
+private:
+   std::vector< Read > mReads;
+   std::vector< Completion > mCompletions;
+   std::vector< char > mResults;
+};
+
+#endif
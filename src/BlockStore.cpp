@@ -0,0 +1,402 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockStore.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "BlockStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+
+#include "FileException.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(__WXMAC__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const wxChar *ExtentPrefix = wxT("blocks");
+const wxChar *ExtentExtension = wxT("aub");
+
+enum class Allocation { Done, Unsupported, Failed };
+
+// Allocates the bytes from the offset on, not changing the size of the file
+Allocation Preallocate(
+   wxFile &file, unsigned long long offset, unsigned long long bytes )
+{
+#if defined(__linux__)
+   if ( fallocate( file.fd(), FALLOC_FL_KEEP_SIZE, offset, bytes ) == 0 )
+      return Allocation::Done;
+   return ( errno == EOPNOTSUPP || errno == ENOSYS )
+      ? Allocation::Unsupported
+      : Allocation::Failed;
+#elif defined(__WXMAC__)
+   // From the physical end of the file, which is at the offset, or near
+   wxUnusedVar( offset );
+   fstore_t store{ F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE,
+      0, (off_t)bytes, 0 };
+   if ( fcntl( file.fd(), F_PREALLOCATE, &store ) != -1 )
+      return Allocation::Done;
+   // Not contiguous, then
+   store.fst_flags = F_ALLOCATEALL;
+   if ( fcntl( file.fd(), F_PREALLOCATE, &store ) != -1 )
+      return Allocation::Done;
+   return Allocation::Failed;
+#else
+   wxUnusedVar( file );
+   wxUnusedVar( offset );
+   wxUnusedVar( bytes );
+   return Allocation::Unsupported;
+#endif
+}
+
+// Frees what was allocated beyond the size of the file
+void Unallocate( wxFile &file )
+{
+#if defined(__linux__)
+   // Truncating to the same size frees the blocks past the end
+   const auto length = file.Length();
+   if ( length != wxInvalidOffset )
+      ftruncate( file.fd(), length );
+#else
+   // Elsewhere the space is freed when the file closes
+   wxUnusedVar( file );
+#endif
+}
+}
+
+BlockStore::BlockStore( const wxString &directory )
+   : mDirectory{ directory }
+{
+}
+
+BlockStore::~BlockStore()
+{
+}
+
+// static
+std::shared_ptr< BlockStore > BlockStore::Open( const wxString &directory )
+{
+   static std::mutex registryMutex;
+   static std::vector< std::weak_ptr< BlockStore > > registry;
+
+   std::lock_guard< std::mutex > lock{ registryMutex };
+   // Stores move with SetDirectory, so compare their present directories
+   auto end = std::remove_if( registry.begin(), registry.end(),
+      []( const std::weak_ptr< BlockStore > &wStore ){
+         return wStore.expired(); } );
+   registry.erase( end, registry.end() );
+   for ( const auto &wStore : registry ) {
+      auto pStore = wStore.lock();
+      if ( pStore && pStore->GetDirectory() == directory )
+         return pStore;
+   }
+
+   auto pStore = std::make_shared< BlockStore >( directory );
+   registry.push_back( pStore );
+   return pStore;
+}
+
+wxString BlockStore::GetDirectory() const
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   return mDirectory;
+}
+
+void BlockStore::SetDirectory( const wxString &directory )
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   ReleaseReserveLocked();
+   mFiles.clear();
+   mAppending = false;
+   mDirectory = directory;
+}
+
+wxString BlockStore::GetExtentPath( unsigned extent ) const
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   return ExtentPath( extent );
+}
+
+wxArrayString BlockStore::GetExtentPaths() const
+{
+   wxArrayString paths;
+   const auto directory = GetDirectory();
+   if ( wxDirExists( directory ) )
+      wxDir::GetAllFiles( directory, &paths,
+         wxString{ ExtentPrefix } + wxT("*.") + ExtentExtension,
+         wxDIR_FILES );
+   return paths;
+}
+
+// static
+bool BlockStore::IsExtentFileName( const wxString &fullName )
+{
+   wxFileName fileName{ fullName };
+   return fileName.GetExt() == ExtentExtension &&
+      fileName.GetName().StartsWith( ExtentPrefix );
+}
+
+void BlockStore::CloseFiles()
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   // Don't leave empty reserved extents to be moved or copied
+   ReleaseReserveLocked();
+   mFiles.clear();
+   mAppending = false;
+}
+
+auto BlockStore::Append( const void *header, size_t headerBytes,
+                         const void *data, size_t dataBytes ) -> Location
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+
+   const auto bytes = (unsigned long long)headerBytes + dataBytes;
+   if ( !mAppending ||
+        ( mAppendOffset > 0 && mAppendOffset + bytes > MaxExtentBytes ) )
+      StartExtent();
+
+   auto pFile = OpenExtent( mAppendExtent );
+   auto fail = [&]{
+      // Leave mAppendOffset as it was, so that the next record overwrites
+      // any partial write
+      throw FileException{
+         FileException::Cause::Write, ExtentPath( mAppendExtent ) };
+   };
+   if ( !pFile || pFile->Seek( mAppendOffset ) == wxInvalidOffset )
+      fail();
+   if ( headerBytes > 0 && pFile->Write( header, headerBytes ) != headerBytes )
+      fail();
+   if ( dataBytes > 0 && pFile->Write( data, dataBytes ) != dataBytes )
+      fail();
+
+   Location result{ mAppendExtent, mAppendOffset };
+   mAppendOffset += bytes;
+   return result;
+}
+
+bool BlockStore::Reserve( unsigned long long bytes )
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   ReleaseReserveLocked();
+
+   try {
+      if ( !mAppending )
+         StartExtent();
+
+      // First the rest of the extent being appended, then NEW extents
+      auto extent = mAppendExtent;
+      auto offset = mAppendOffset;
+      auto remaining = bytes;
+      while ( true ) {
+         const auto room =
+            offset < MaxExtentBytes ? MaxExtentBytes - offset : 0;
+         const auto amount = std::min( room, remaining );
+         if ( amount > 0 ) {
+            auto pFile = OpenExtent( extent );
+            const auto result = pFile
+               ? Preallocate( *pFile, offset, amount )
+               : Allocation::Failed;
+            if ( result == Allocation::Failed ) {
+               ReleaseReserveLocked();
+               return false;
+            }
+            if ( result == Allocation::Unsupported )
+               break;
+            remaining -= amount;
+         }
+         if ( remaining == 0 )
+            break;
+
+         extent = CreateExtent( extent + 1 );
+         mReservedExtents.push_back( extent );
+         offset = 0;
+      }
+   }
+   catch ( const FileException& ) {
+      ReleaseReserveLocked();
+      return false;
+   }
+
+   return true;
+}
+
+void BlockStore::ReleaseReserve()
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   ReleaseReserveLocked();
+}
+
+size_t BlockStore::Read( const Location &location, unsigned long long start,
+                         void *buffer, size_t bytes )
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+
+   auto pFile = OpenExtent( location.extent );
+   if ( !pFile ||
+        pFile->Seek( location.offset + start ) == wxInvalidOffset )
+      return 0;
+
+   auto result = pFile->Read( buffer, bytes );
+   if ( result < 0 )
+      return 0;
+   return result;
+}
+
+bool BlockStore::ReadPieces(
+   unsigned extent, const std::vector< Piece > &pieces )
+{
+   // Summaries between the samples of adjacent records are read and
+   // dropped, which costs less than seeking over them
+   const size_t MaxGapBytes = 64 * 1024;
+   const size_t MaxSpanBytes = 4 * 1024 * 1024;
+
+   std::lock_guard< std::mutex > lock{ mMutex };
+
+   auto pFile = OpenExtent( extent );
+   if ( !pFile )
+      return false;
+
+   ArrayOf< char > span;
+   size_t spanSize = 0;
+   for ( size_t first = 0, nPieces = pieces.size(); first < nPieces; ) {
+      // Find how many pieces may be read together
+      const auto start = pieces[ first ].offset;
+      auto end = start + pieces[ first ].bytes;
+      auto last = first + 1;
+      for ( ; last < nPieces; ++last ) {
+         const auto &piece = pieces[ last ];
+         if ( piece.offset < end || piece.offset - end > MaxGapBytes ||
+              piece.offset + piece.bytes - start > MaxSpanBytes )
+            break;
+         end = piece.offset + piece.bytes;
+      }
+
+      if ( pFile->Seek( start ) == wxInvalidOffset )
+         return false;
+
+      if ( last == first + 1 ) {
+         const auto &piece = pieces[ first ];
+         if ( pFile->Read( piece.buffer, piece.bytes ) !=
+              (ssize_t)piece.bytes )
+            return false;
+      }
+      else {
+         const auto bytes = end - start;
+         if ( spanSize < bytes )
+            span.reinit( spanSize = bytes );
+         if ( pFile->Read( span.get(), bytes ) != (ssize_t)bytes )
+            return false;
+         for ( auto ii = first; ii < last; ++ii ) {
+            const auto &piece = pieces[ ii ];
+            memcpy( piece.buffer,
+                    span.get() + ( piece.offset - start ), piece.bytes );
+         }
+      }
+
+      first = last;
+   }
+
+   return true;
+}
+
+wxString BlockStore::ExtentPath( unsigned extent ) const
+{
+   wxFileName fileName{ mDirectory,
+      wxString::Format( wxT("%s%04u"), ExtentPrefix, extent ),
+      ExtentExtension };
+   return fileName.GetFullPath();
+}
+
+wxFile *BlockStore::OpenExtent( unsigned extent )
+{
+   auto &pFile = mFiles[ extent ];
+   if ( !pFile ) {
+      const auto path = ExtentPath( extent );
+      if ( !wxFileExists( path ) )
+         return nullptr;
+
+      // Don't complain about missing extents here; block files report
+      // short reads
+      wxLogNull nolog;
+      auto pNewFile = std::make_unique< wxFile >();
+      if ( !pNewFile->Open( path, wxFile::read_write ) &&
+           !pNewFile->Open( path, wxFile::read ) )
+         return nullptr;
+      pFile = std::move( pNewFile );
+   }
+   return pFile.get();
+}
+
+void BlockStore::StartExtent()
+{
+   unsigned extent;
+   if ( !mReservedExtents.empty() ) {
+      extent = mReservedExtents.front();
+      mReservedExtents.pop_front();
+   }
+   else
+      extent = CreateExtent( mAppending ? mAppendExtent + 1 : 0 );
+
+   mAppending = true;
+   mAppendExtent = extent;
+   mAppendOffset = 0;
+}
+
+unsigned BlockStore::CreateExtent( unsigned first )
+{
+   // Choose the first unused number, never appending to extents that may
+   // belong to a saved project
+   unsigned extent = first;
+   while ( wxFileExists( ExtentPath( extent ) ) )
+      ++extent;
+
+   const auto path = ExtentPath( extent );
+   if ( !wxDirExists( mDirectory ) &&
+        !wxFileName::Mkdir( mDirectory, 0777, wxPATH_MKDIR_FULL ) )
+      throw FileException{ FileException::Cause::Write, path };
+
+   {
+      wxFile file;
+      if ( !file.Create( path ) )
+         throw FileException{ FileException::Cause::Open, path };
+   }
+
+   return extent;
+}
+
+void BlockStore::ReleaseReserveLocked()
+{
+   // Extents never appended are still empty
+   for ( auto extent : mReservedExtents ) {
+      mFiles.erase( extent );
+      wxLogNull nolog;
+      wxRemoveFile( ExtentPath( extent ) );
+   }
+   mReservedExtents.clear();
+
+   if ( mAppending ) {
+      auto iter = mFiles.find( mAppendExtent );
+      if ( iter != mFiles.end() && iter->second ) {
+         Unallocate( *iter->second );
+         mFiles.erase( iter );
+      }
+   }
+}
@@ -0,0 +1,138 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockStore.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class BlockStore
+\brief Packs the records of many block files into a few large,
+append-only extent files in one directory.
+
+  A record is identified by its extent number and byte offset; its length
+  is known to the block file that refers to it.  Records are never
+  overwritten, so copies of a block file may share one record.  Space of
+  records no longer referenced is not reclaimed.
+
+  Extents are created only as needed, and a NEW extent is started rather
+  than appending to any existing one that this object did not create.
+
+  Space may be reserved ahead, as for a long recording:  the extents that
+  appends will fill are allocated then, contiguously where the file system
+  allows, while their sizes stay as they are.
+
+  Stores are shared by all projects of the session, which may refer to the
+  records of one another, as after a paste from one project to another.
+
+  All functions may be used from any thread.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_STORE__
+#define __AUDACITY_BLOCK_STORE__
+
+#include "MemoryX.h"
+#include <wx/arrstr.h>
+#include <wx/string.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class wxFile;
+
+class BlockStore
+{
+public:
+   // Extents are not made larger than this, except by a single record
+   static const unsigned long long MaxExtentBytes = 1ull << 30;
+
+   struct Location
+   {
+      unsigned extent { 0 };
+      unsigned long long offset { 0 };
+   };
+
+   // No files are created until the first Append
+   explicit BlockStore( const wxString &directory );
+   // The store in the directory that is in use in this session, or else a
+   // NEW one
+   static std::shared_ptr< BlockStore > Open( const wxString &directory );
+   ~BlockStore();
+
+   BlockStore( const BlockStore& ) PROHIBITED;
+   BlockStore &operator= ( const BlockStore& ) PROHIBITED;
+
+   wxString GetDirectory() const;
+   // Closes all files; the caller is responsible for moving or copying
+   // the extents from the old directory
+   void SetDirectory( const wxString &directory );
+
+   wxString GetExtentPath( unsigned extent ) const;
+   // Paths of all extent files now in the directory
+   wxArrayString GetExtentPaths() const;
+   static bool IsExtentFileName( const wxString &fullName );
+
+   // Close all open files, as before they are moved or removed
+   void CloseFiles();
+
+   // Writes the two pieces contiguously, as one record.
+   // Throws FileException on failure.
+   Location Append( const void *header, size_t headerBytes,
+                    const void *data, size_t dataBytes );
+
+   // Allocates disk space for that many more bytes of records, replacing
+   // any reservation not yet filled.  Returns false, reserving nothing, if
+   // the space can't be had.  Where the file system can't preallocate,
+   // reserves nothing but returns true.
+   bool Reserve( unsigned long long bytes );
+   // Gives back the reserved space that records don't yet fill
+   void ReleaseReserve();
+
+   // Returns the number of bytes read, which may be short if the extent is
+   // missing or truncated
+   size_t Read( const Location &location, unsigned long long start,
+                void *buffer, size_t bytes );
+
+   // Bytes of one extent, at an offset from the start of the extent
+   struct Piece
+   {
+      unsigned long long offset;
+      void *buffer;
+      size_t bytes;
+   };
+
+   // Reads pieces of one extent.  Pieces in increasing order, with small
+   // gaps between, are read with one call for all.  Returns false unless
+   // all were read in full.
+   bool ReadPieces( unsigned extent, const std::vector< Piece > &pieces );
+
+private:
+   // Caller holds the lock
+   wxString ExtentPath( unsigned extent ) const;
+   wxFile *OpenExtent( unsigned extent );
+   void StartExtent();
+   // Makes an empty extent, numbered first or the next unused after
+   unsigned CreateExtent( unsigned first );
+   void ReleaseReserveLocked();
+
+   mutable std::mutex mMutex;
+   wxString mDirectory;
+   std::map< unsigned, std::unique_ptr< wxFile > > mFiles;
+
+   // The extent being appended; valid only when mAppending
+   bool mAppending { false };
+   unsigned mAppendExtent { 0 };
+   unsigned long long mAppendOffset { 0 };
+
+   // Extents allocated by Reserve(), to be appended in this order, after
+   // mAppendExtent
+   std::deque< unsigned > mReservedExtents;
+};
+
+#endif
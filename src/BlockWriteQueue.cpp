@@ -0,0 +1,86 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockWriteQueue.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "BlockWriteQueue.h"
+
+#include "BlockFile.h"
+
+BlockWriteQueue &BlockWriteQueue::Get()
+{
+   static BlockWriteQueue queue;
+   return queue;
+}
+
+BlockWriteQueue::BlockWriteQueue()
+   : mThread{ [this]{ WriterLoop(); } }
+{
+}
+
+BlockWriteQueue::~BlockWriteQueue()
+{
+   // Blocks still waiting are written first
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mStopping = true;
+   }
+   mPushedCondition.notify_one();
+   mThread.join();
+}
+
+bool BlockWriteQueue::Push( const BlockFilePtr &file )
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      if ( mDepth.load( std::memory_order_relaxed ) >= MaxDepth )
+         return false;
+      mQueue.push_back( file );
+      ++mDepth;
+   }
+   mPushedCondition.notify_one();
+   return true;
+}
+
+void BlockWriteQueue::Flush()
+{
+   std::unique_lock< std::mutex > lock{ mMutex };
+   mWrittenCondition.wait( lock, [this]{
+      return mDepth.load( std::memory_order_relaxed ) == 0; } );
+}
+
+void BlockWriteQueue::WriterLoop()
+{
+   while ( true ) {
+      std::weak_ptr< BlockFile > next;
+      {
+         std::unique_lock< std::mutex > lock{ mMutex };
+         mPushedCondition.wait( lock, [this]{
+            return mStopping || !mQueue.empty(); } );
+         if ( mQueue.empty() )
+            return;
+         next = std::move( mQueue.front() );
+         mQueue.pop_front();
+      }
+
+      // A block discarded before it was written needs no file
+      if ( auto file = next.lock() ) {
+         // Failure leaves the data cached, for DirManager::WriteCacheToDisk()
+         // to try again when recording stops
+         file->WriteCacheToDisk();
+      }
+
+      {
+         std::lock_guard< std::mutex > lock{ mMutex };
+         --mDepth;
+      }
+      mWrittenCondition.notify_all();
+   }
+}
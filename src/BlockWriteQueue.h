@@ -0,0 +1,82 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockWriteQueue.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class BlockWriteQueue
+\brief One thread that writes to disk the block files made while
+recording, so that the audio thread never waits on the file system.
+
+  A block pushed on the queue keeps its samples and summary in memory
+  until written, and may be read meanwhile.  The queue is bounded:  when
+  it is full, Push() refuses the block, and the caller writes it at once
+  as before.  A GetDepth() above WarningDepth means the disk is not
+  keeping up.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_WRITE_QUEUE__
+#define __AUDACITY_BLOCK_WRITE_QUEUE__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class BlockFile;
+using BlockFilePtr = std::shared_ptr<BlockFile>;
+
+class BlockWriteQueue
+{
+ public:
+   // Blocks are at most about 1 MB, so this is three minutes of stereo
+   // float samples at 44100 Hz, held in memory
+   static const size_t MaxDepth = 64;
+   static const size_t WarningDepth = MaxDepth / 4;
+
+   ///Gets the singleton instance, starting the thread
+   static BlockWriteQueue &Get();
+
+   ///False if the queue is full; otherwise the file's WriteCacheToDisk()
+   ///will be called on the thread, unless the file is destroyed first
+   bool Push( const BlockFilePtr &file );
+
+   ///Wait until the blocks pushed so far are written
+   void Flush();
+
+   ///Blocks waiting, counting the one being written.  Lock-free.
+   size_t GetDepth() const
+   { return mDepth.load( std::memory_order_relaxed ); }
+
+ private:
+   BlockWriteQueue();
+   ~BlockWriteQueue();
+   BlockWriteQueue( const BlockWriteQueue& ) PROHIBITED;
+   BlockWriteQueue &operator= ( const BlockWriteQueue& ) PROHIBITED;
+
+   void WriterLoop();
+
+   std::mutex mMutex;
+   std::condition_variable mPushedCondition;
+   std::condition_variable mWrittenCondition;
+
+   // Guarded by mMutex:
+   std::deque< std::weak_ptr< BlockFile > > mQueue;
+   bool mStopping { false };
+
+   // Also counts the block being written, so is not just mQueue.size()
+   std::atomic< size_t > mDepth { 0 };
+
+   std::thread mThread;
+};
+
+#endif
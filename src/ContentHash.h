@@ -0,0 +1,54 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ContentHash.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class ContentHash
+\brief A fast hash of bytes, to find content already seen.
+
+  FNV-1a, but taking a word at a time and folding the high bits down,
+  so that hashing keeps up with reading a file.  Not for security.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_CONTENT_HASH__
+#define __AUDACITY_CONTENT_HASH__
+
+#include <cstdint>
+#include <cstring>
+
+class ContentHash
+{
+public:
+   void Add(const void *data, size_t size)
+   {
+      auto bytes = static_cast<const unsigned char *>(data);
+      for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+         uint64_t word;
+         memcpy(&word, bytes, sizeof word);
+         bytes += sizeof word;
+         Mix(word);
+      }
+      for (; size > 0; --size)
+         Mix(*bytes++);
+   }
+
+   uint64_t Value() const { return mHash; }
+
+private:
+   void Mix(uint64_t value)
+   {
+      mHash = (mHash ^ value) * 1099511628211ULL;
+      mHash ^= mHash >> 29;
+   }
+
+   uint64_t mHash{ 14695981039346656037ULL };
+};
+
+#endif
@@ -0,0 +1,158 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DeferredDeleter.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "DeferredDeleter.h"
+
+#include <chrono>
+#include <vector>
+#include <wx/dir.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+
+namespace {
+   // Not matching "project*", so that CleanTempDir and recovery ignore it
+   const wxChar *const TrashName = wxT("deleted");
+   // Files removed between pauses, few enough that other use of the disk
+   // is hardly slowed
+   const int RemovalBatch = 64;
+   const auto RemovalPause = std::chrono::milliseconds( 5 );
+
+   wxString TrashOf( const wxString &tempDir )
+   {
+      return tempDir + wxFILE_SEP_PATH + TrashName;
+   }
+}
+
+DeferredDeleter &DeferredDeleter::Get()
+{
+   static DeferredDeleter deleter;
+   return deleter;
+}
+
+DeferredDeleter::DeferredDeleter()
+{
+}
+
+DeferredDeleter::~DeferredDeleter()
+{
+   // What remains is removed in the next session
+   mStopping.store( true );
+   if ( mThread.joinable() )
+      mThread.join();
+}
+
+bool DeferredDeleter::Defer( const wxString &tempDir, const wxString &directory )
+{
+   const auto trash = TrashOf( tempDir );
+   if ( !wxDirExists( trash ) && !wxMkdir( trash, 0755 ) )
+      return false;
+
+   // Don't replace trash of another session not yet removed
+   const auto name = wxFileName{ directory }.GetFullName();
+   auto target = trash + wxFILE_SEP_PATH + name;
+   for ( int ii = 1; wxDirExists( target ) || wxFileExists( target ); ++ii )
+      target = trash + wxFILE_SEP_PATH + name + wxString::Format( wxT("-%d"), ii );
+
+   // Not wxRenameFile, which would copy the files instead, one at a time
+   return wxRename( directory, target ) == 0;
+}
+
+void DeferredDeleter::Start( const wxString &tempDir )
+{
+   if ( mThread.joinable() )
+      return;
+   const auto trash = TrashOf( tempDir );
+   mThread = std::thread{ [this, trash]{ RemoverLoop( trash ); } };
+}
+
+void DeferredDeleter::RemoverLoop( wxString trash )
+{
+   // Failures are left for the next session, and not reported
+   wxLogNull noLog;
+
+   while ( !mStopping.load() ) {
+      // More may be deferred while the thread runs
+      std::vector< wxString > entries;
+      {
+         wxDir dir( trash );
+         if ( !dir.IsOpened() )
+            return;
+         wxString name;
+         auto cont = dir.GetFirst( &name, wxEmptyString,
+            wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN | wxDIR_NO_FOLLOW );
+         while ( cont ) {
+            entries.push_back( trash + wxFILE_SEP_PATH + name );
+            cont = dir.GetNext( &name );
+         }
+      }
+      if ( entries.empty() )
+         return;
+
+      size_t removed = 0;
+      for ( const auto &entry : entries ) {
+         if ( wxDirExists( entry ) )
+            RemoveTree( entry );
+         else
+            wxRemoveFile( entry );
+         if ( wxFileExists( entry ) || wxDirExists( entry ) )
+            continue;
+         ++removed;
+      }
+      // Whatever could not be removed is tried again next session
+      if ( removed == 0 )
+         return;
+   }
+}
+
+void DeferredDeleter::RemoveTree( const wxString &path )
+{
+   std::vector< wxString > files, subdirs;
+   {
+      wxDir dir( path );
+      if ( !dir.IsOpened() )
+         return;
+      wxString name;
+      auto cont = dir.GetFirst( &name, wxEmptyString,
+         wxDIR_FILES | wxDIR_HIDDEN | wxDIR_NO_FOLLOW );
+      while ( cont ) {
+         files.push_back( path + wxFILE_SEP_PATH + name );
+         cont = dir.GetNext( &name );
+      }
+      cont = dir.GetFirst( &name, wxEmptyString,
+         wxDIR_DIRS | wxDIR_HIDDEN | wxDIR_NO_FOLLOW );
+      while ( cont ) {
+         subdirs.push_back( path + wxFILE_SEP_PATH + name );
+         cont = dir.GetNext( &name );
+      }
+   }
+
+   int count = 0;
+   for ( const auto &file : files ) {
+      if ( mStopping.load() )
+         return;
+      wxRemoveFile( file );
+      if ( ++count % RemovalBatch == 0 )
+         std::this_thread::sleep_for( RemovalPause );
+   }
+   for ( const auto &subdir : subdirs ) {
+      if ( mStopping.load() )
+         return;
+      RemoveTree( subdir );
+   }
+
+#ifdef __WXMSW__
+   // See RecursivelyRemove in DirManager.cpp about wxRmdir on Windows
+   wxRemoveFile( path );
+#endif
+   wxRmdir( path );
+}
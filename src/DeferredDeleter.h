@@ -0,0 +1,61 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DeferredDeleter.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class DeferredDeleter
+\brief Removes directories of temporary files slowly, in the background,
+after they were moved out of the way at once.
+
+  A directory is deferred by renaming it into the "deleted" directory of
+  the temporary directory, which takes no time however many files are in
+  it.  One low-priority thread then removes the trash a batch of files at
+  a time, pausing between batches.  Trash left when Audacity exits, or
+  crashes, is removed by the thread of the next session.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_DEFERRED_DELETER__
+#define __AUDACITY_DEFERRED_DELETER__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+#include <atomic>
+#include <thread>
+#include <wx/string.h>
+
+class DeferredDeleter
+{
+ public:
+   ///Gets the singleton instance
+   static DeferredDeleter &Get();
+
+   ///Moves directory into the trash of tempDir, to be removed later.
+   ///Returns false, moving nothing, if it can't be renamed, for instance
+   ///to another file system.
+   static bool Defer( const wxString &tempDir, const wxString &directory );
+
+   ///Starts the thread, if not already started, that removes all the trash
+   ///of tempDir, and stops when it is empty
+   void Start( const wxString &tempDir );
+
+ private:
+   DeferredDeleter();
+   ~DeferredDeleter();
+   DeferredDeleter( const DeferredDeleter& ) PROHIBITED;
+   DeferredDeleter &operator= ( const DeferredDeleter& ) PROHIBITED;
+
+   void RemoverLoop( wxString trash );
+   void RemoveTree( const wxString &path );
+
+   std::atomic< bool > mStopping { false };
+   std::thread mThread;
+};
+
+#endif
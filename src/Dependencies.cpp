@@ -46,6 +46,13 @@ AliasedFile s.
 #include <wx/choice.h>
 #include <wx/clipbrd.h>
 #include <wx/dataobj.h>
+#include <wx/utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
 
 #include "BlockFile.h"
 #include "DirManager.h"
@@ -54,6 +61,7 @@ AliasedFile s.
 #include "Project.h"
 #include "Sequence.h"
 #include "ShuttleGui.h"
+#include "ThreadPool.h"
 #include "WaveTrack.h"
 #include "WaveClip.h"
 #include "widgets/ErrorDialog.h"
@@ -190,44 +198,110 @@ static void RemoveDependencies(AudacityProject *project,
    GetAllSeqBlocks(project, &blocks);
 
    const sampleFormat format = project->GetDefaultFormat();
-   ReplacedBlockFileHash blockFileHash;
-   wxLongLong completedBytes = 0;
-   for (const auto blockFile : blocks) {
-      const auto &f = blockFile->f;
-      if (f->IsAlias() && (blockFileHash.count( &*f ) == 0))
-      {
-         // f is an alias block we have not yet processed.
-         auto aliasBlockFile = static_cast<AliasBlockFile*>( &*f );
-         const wxFileName &fileName = aliasBlockFile->GetAliasedFileName();
-         const wxString &fileNameStr = fileName.GetFullPath();
 
+   // Gather the alias blocks to replace, each once, grouped by the file
+   // they read, so that each file is read by one thread, from start to end
+   std::vector< std::vector< AliasBlockFile* > > groups;
+   {
+      BoolBlockFileHash seen;
+      std::unordered_map< wxString, size_t > groupIndices;
+      for (const auto blockFile : blocks) {
+         const auto &f = blockFile->f;
+         if (!f->IsAlias())
+            continue;
+         auto aliasBlockFile = static_cast<AliasBlockFile*>( &*f );
+         if (!seen.emplace(aliasBlockFile, true).second)
+            // Shared by more than one sequence, and already gathered
+            continue;
+         const wxString &fileNameStr =
+            aliasBlockFile->GetAliasedFileName().GetFullPath();
          if (aliasedFileHash.count(fileNameStr) == 0)
             // This aliased file was not selected to be replaced. Skip it.
             continue;
-
-         // Convert it from an aliased file to an actual file in the project.
-         auto len = aliasBlockFile->GetLength();
-         BlockFilePtr newBlockFile;
-         {
-            SampleBuffer buffer(len, format);
-            // We tolerate exceptions from NewSimpleBlockFile and so we
-            // can allow exceptions from ReadData too
-            f->ReadData(buffer.ptr(), format, 0, len);
-            newBlockFile =
-               dirManager->NewSimpleBlockFile(buffer.ptr(), len, format);
-         }
-
-         // Update our hash so we know what block files we've done
-         blockFileHash[ &*f ] = newBlockFile;
-
-         // Update the progress bar
-         completedBytes += SAMPLE_SIZE(format) * len;
-         updateResult = progress.Update(completedBytes, totalBytesToProcess);
+         auto result = groupIndices.emplace(fileNameStr, groups.size());
+         if (result.second)
+            groups.emplace_back();
+         groups[result.first->second].push_back(aliasBlockFile);
+      }
+   }
+   for (auto &group : groups)
+      std::sort(group.begin(), group.end(),
+         [](const AliasBlockFile *a, const AliasBlockFile *b) {
+            return a->GetAliasStart() < b->GetAliasStart(); });
+
+   // The copies wait mostly on the disk, so they get threads of their own,
+   // a few, because the files may all be on one disk
+   const unsigned concurrency = std::max< unsigned >( 1,
+      std::min< size_t >( { groups.size(), 4,
+         ThreadPool::DefaultConcurrency() } ) );
+
+   std::vector< std::vector< BlockFilePtr > > newBlockFiles(groups.size());
+   std::atomic< wxLongLong_t > completedBytes{ 0 };
+   std::atomic< bool > stopped{ false };
+   std::exception_ptr exception;
+   std::atomic< bool > done{ false };
+
+   // The loop runs on another thread, so that this one can show progress
+   std::thread runner{ [&] {
+      try {
+         ThreadPool pool{ concurrency };
+         pool.ParallelFor(groups.size(), [&](size_t ii) {
+            const auto &group = groups[ii];
+            auto &results = newBlockFiles[ii];
+            results.reserve(group.size());
+            SampleBuffer buffer;
+            size_t bufferLen = 0;
+            for (const auto aliasBlockFile : group) {
+               if (stopped.load())
+                  return;
+
+               // Convert it from an aliased file to an actual file in the
+               // project.
+               auto len = aliasBlockFile->GetLength();
+               if (len > bufferLen) {
+                  buffer.Allocate(len, format);
+                  bufferLen = len;
+               }
+               // We tolerate exceptions from NewSimpleBlockFile and so we
+               // can allow exceptions from ReadData too
+               aliasBlockFile->ReadData(buffer.ptr(), format, 0, len);
+               results.push_back(
+                  dirManager->NewSimpleBlockFile(buffer.ptr(), len, format));
+
+               completedBytes += SAMPLE_SIZE(format) * len;
+            }
+         });
+      }
+      catch (...) {
+         exception = std::current_exception();
+      }
+      done.store(true);
+   } };
+   while (!done.load()) {
+      ::wxMilliSleep(50);
+      if (!stopped.load()) {
+         updateResult = progress.Update(
+            wxLongLong{ completedBytes.load() }, totalBytesToProcess);
          if (updateResult != ProgressResult::Success)
-            // leave the project unchanged
-            return;
+            stopped.store(true);
       }
    }
+   runner.join();
+
+   if (exception)
+      // The new block files are destroyed, and the project is unchanged
+      std::rethrow_exception(exception);
+   if (stopped.load())
+      // leave the project unchanged
+      return;
+
+   // Hash the new block files by the blocks they replace
+   ReplacedBlockFileHash blockFileHash;
+   for (size_t ii = 0; ii < groups.size(); ++ii) {
+      const auto &group = groups[ii];
+      for (size_t jj = 0; jj < group.size(); ++jj)
+         blockFileHash[ group[jj] ] = newBlockFiles[ii][jj];
+   }
 
    // COMMIT OPERATIONS needing NOFAIL-GUARANTEE:
 
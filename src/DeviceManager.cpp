@@ -32,6 +32,7 @@
 #include "Project.h"
 
 #include "AudioIO.h"
+#include "Prefs.h"
 
 #include "DeviceChange.h"
 #include "DeviceManager.h"
@@ -246,6 +247,29 @@ static void AddSources(int deviceIndex, int rate, std::vector<DeviceSourceMap> *
 }
 
 
+// Measurements are kept for each combination of host and devices, since
+// each has its own buffering
+static wxString MeasuredLatencyKey()
+{
+   wxString key = gPrefs->Read(wxT("/AudioIO/Host"), wxT("")) + wxT("|") +
+      gPrefs->Read(wxT("/AudioIO/PlaybackDevice"), wxT("")) + wxT("|") +
+      gPrefs->Read(wxT("/AudioIO/RecordingDevice"), wxT(""));
+   // Not a path separator in the key
+   key.Replace(wxT("/"), wxT("_"));
+   return wxT("/AudioIO/MeasuredLatency/") + key;
+}
+
+bool DeviceManager::GetMeasuredLatency(double &correctionMs)
+{
+   return gPrefs->Read(MeasuredLatencyKey(), &correctionMs);
+}
+
+void DeviceManager::SetMeasuredLatency(double correctionMs)
+{
+   gPrefs->Write(MeasuredLatencyKey(), correctionMs);
+   gPrefs->Flush();
+}
+
 /// Gets a NEW list of devices by terminating and restarting portaudio
 /// Assumes that DeviceManager is only used on the main thread.
 void DeviceManager::Rescan()
@@ -61,6 +61,12 @@ class DeviceManager final
    const std::vector<DeviceSourceMap> &GetInputDeviceMaps();
    const std::vector<DeviceSourceMap> &GetOutputDeviceMaps();
 
+   /// The time shift for recording measured by LatencyCalibration for the
+   /// host and devices now chosen in preferences, in milliseconds, negative
+   /// like /AudioIO/LatencyCorrection.  False if never measured.
+   bool GetMeasuredLatency(double &correctionMs);
+   void SetMeasuredLatency(double correctionMs);
+
 #if defined(EXPERIMENTAL_DEVICE_CHANGE_HANDLER)
 #if defined(HAVE_DEVICE_CHANGE)
    // DeviceChangeHandler implementation
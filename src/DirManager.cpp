@@ -66,6 +66,9 @@
 #include "MemoryX.h"
 
 #include <time.h> // to use time() for srand()
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 #include <wx/defs.h>
 #include <wx/app.h>
@@ -77,6 +80,7 @@
 #include <wx/timer.h>
 #include <wx/intl.h>
 #include <wx/file.h>
+#include <wx/textfile.h>
 #include <wx/filename.h>
 #include <wx/object.h>
 
@@ -89,17 +93,25 @@
 #include "AudacityApp.h"
 #include "AudacityException.h"
 #include "BlockFile.h"
+#include "BlockStore.h"
+#include "BlockWriteQueue.h"
+#include "ContentHash.h"
+#include "DeferredDeleter.h"
 #include "FileException.h"
 #include "FileNames.h"
 #include "blockfile/LegacyBlockFile.h"
 #include "blockfile/LegacyAliasBlockFile.h"
 #include "blockfile/SimpleBlockFile.h"
 #include "blockfile/SilentBlockFile.h"
+#include "blockfile/PackedBlockFile.h"
 #include "blockfile/PCMAliasBlockFile.h"
+#include "blockfile/RawAliasBlockFile.h"
 #include "blockfile/ODPCMAliasBlockFile.h"
 #include "blockfile/ODDecodeBlockFile.h"
 #include "InconsistencyException.h"
 #include "Internat.h"
+#include "MappedFile.h"
+#include "SoundFileCache.h"
 #include "Project.h"
 #include "Prefs.h"
 #include "Sequence.h"
@@ -108,6 +120,7 @@
 #include "widgets/ErrorDialog.h"
 
 #include "ondemand/ODManager.h"
+#include "TaskScheduler.h"
 
 #include "Track.h"
 
@@ -213,26 +226,134 @@ static int RecursivelyEnumerate(wxString dirPath,
    return count;
 }
 
-static int RecursivelyEnumerateWithProgress(wxString dirPath,
-                                             wxArrayString& filePathArray, // output: all files in dirPath tree
-                                             wxString dirspec,
-                                             wxString filespec,
-                                             bool bFiles, bool bDirs,
-                                             int progress_count,
-                                             const wxChar* message)
+// A directory in the tree that ProjectFSCK inspects, with what only
+// changes when files are added to it or removed
+struct ScannedDirectory
 {
-   Maybe<ProgressDialog> progress{};
+   wxString path;
+   time_t modified;
+   size_t count;
+};
+
+// Lists all files in the tree under dirPath, like RecursivelyEnumerate, but
+// with directories of each depth opened in parallel, which matters most on
+// network storage.  Also notes every directory, dirPath too.
+static void EnumerateProjectInParallel(const wxString &dirPath,
+                                       wxArrayString& filePathArray,
+                                       std::vector<ScannedDirectory> &directories,
+                                       const wxChar* message)
+{
+   struct Listing
+   {
+      wxArrayString files;
+      std::vector<wxString> subdirs;
+      time_t modified;
+   };
+   const auto list = [](const wxString &path, Listing &listing) {
+      listing.modified = wxFileModificationTime(path);
+      wxDir dir(path);
+      if (!dir.IsOpened())
+         return;
+      wxString name;
+      bool cont = dir.GetFirst(&name, wxEmptyString,
+         wxDIR_FILES | wxDIR_HIDDEN | wxDIR_NO_FOLLOW);
+      while (cont) {
+         listing.files.Add(path + wxFILE_SEP_PATH + name);
+         cont = dir.GetNext(&name);
+      }
+      cont = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_NO_FOLLOW);
+      while (cont) {
+         listing.subdirs.push_back(path + wxFILE_SEP_PATH + name);
+         cont = dir.GetNext(&name);
+      }
+   };
+
+   ProgressDialog progress(_("Progress"), message);
+   auto &manager = *ODManager::Instance();
+   // Few enough at a time that the progress moves
+   const size_t batch = 4 * std::max(1u, manager.GetWorkerConcurrency());
+
+   std::vector<wxString> level{ dirPath };
+   while (!level.empty()) {
+      std::vector<Listing> listings(level.size());
+      for (size_t first = 0; first < level.size(); first += batch) {
+         const auto count = std::min(batch, level.size() - first);
+         manager.ParallelFor(count, [&](size_t ii) {
+            list(level[first + ii], listings[first + ii]);
+         });
+         progress.Update(int(directories.size() + first + count),
+            int(directories.size() + level.size()));
+      }
 
-   if (message)
-      progress.create( _("Progress"), message );
+      std::vector<wxString> next;
+      for (size_t ii = 0; ii < level.size(); ii++) {
+         auto &listing = listings[ii];
+         for (const auto &file : listing.files)
+            filePathArray.Add(file);
+         directories.push_back({ level[ii], listing.modified,
+            listing.files.size() + listing.subdirs.size() });
+         next.insert(next.end(), listing.subdirs.begin(), listing.subdirs.end());
+      }
+      level.swap(next);
+   }
+}
 
-   int count = RecursivelyEnumerate(
-                  dirPath, filePathArray, dirspec,filespec,
-                  bFiles, bDirs,
-                  progress_count, 0,
-                  progress.get());
+// ProjectFSCK notes here, in the project data directory, the directories
+// it found nothing wrong with.  Their block files are not inspected again
+// while no file is added to or removed from them.
+static const wxChar *const FSCKManifestName = wxT("fsck-manifest.txt");
 
-   return count;
+// Directories of the last clean project check, relative to dirPath, with
+// their modification times and numbers of entries
+using FSCKManifest =
+   std::unordered_map< wxString, std::pair< long long, size_t > >;
+
+static FSCKManifest ReadFSCKManifest(const wxString &dirPath)
+{
+   FSCKManifest manifest;
+   const wxString path = dirPath + wxFILE_SEP_PATH + FSCKManifestName;
+   if (!wxFileExists(path))
+      return manifest;
+
+   wxLogNull noLog;
+   wxTextFile file(path);
+   if (!file.Open())
+      return manifest;
+   for (size_t i = 0; i < file.GetLineCount(); i++) {
+      // modified, count, and path, separated by tabs
+      const wxString &line = file[i];
+      const wxString rest = line.AfterFirst(wxT('\t'));
+      long long modified;
+      unsigned long count;
+      if (!line.BeforeFirst(wxT('\t')).ToLongLong(&modified) ||
+          !rest.BeforeFirst(wxT('\t')).ToULong(&count))
+         continue;
+      manifest[rest.AfterFirst(wxT('\t'))] = { modified, count };
+   }
+   return manifest;
+}
+
+static void WriteFSCKManifest(const wxString &dirPath,
+                              const std::vector<ScannedDirectory> &directories)
+{
+   wxLogNull noLog;
+   const wxString path = dirPath + wxFILE_SEP_PATH + FSCKManifestName;
+   wxTextFile file(path);
+   if (!file.Exists())
+      file.Create();
+   file.Open();
+   if (!file.IsOpened())
+      return;
+   file.Clear();
+   for (const auto &directory : directories) {
+      // Writing the manifest will change the time of dirPath itself
+      if (directory.path == dirPath || directory.modified == (time_t)-1)
+         continue;
+      file.AddLine(wxString::Format(wxT("%lld\t%lu\t%s"),
+         (long long)directory.modified, (unsigned long)directory.count,
+         directory.path.Mid(dirPath.length())));
+   }
+   file.Write();
 }
 
 static int RecursivelyCountSubdirs(wxString dirPath)
@@ -398,6 +519,12 @@ DirManager::DirManager()
    mLoadingTargetIdx = 0;
    mMaxSamples = ~size_t(0);
 
+   mBlockStore = BlockStore::Open(mytemp);
+   // Read the preference only here, because blockfiles are also made by
+   // the audio thread while recording
+   mUsePackedBlockStore =
+      gPrefs->Read(wxT("/Directories/PackedBlockStore"), 0L) != 0;
+
    // toplevel pool hash is fully populated to begin
    {
       // We can bypass the accessor function while initializing
@@ -419,11 +546,20 @@ DirManager::DirManager()
 
 DirManager::~DirManager()
 {
+   // Extents can't be removed while open on some systems
+   mBlockStore->CloseFiles();
+   // Nor may the user's aliased files be, so don't keep them open after a
+   // project closes
+   GetSoundFileCache().Clear();
+   // Block files of other projects may borrow our records.  Then leave the
+   // temporary directory for CleanTempDir.
+   const bool borrowed = mBlockStore.use_count() > 1;
+
    numDirManagers--;
    if (numDirManagers == 0) {
       CleanTempDir();
       //::wxRmdir(temp);
-   } else if( projFull.IsEmpty() && !mytemp.IsEmpty()) {
+   } else if( projFull.IsEmpty() && !mytemp.IsEmpty() && !borrowed) {
       CleanDir(mytemp, wxEmptyString, ".DS_Store", _("Cleaning project temporary files"), kCleanTopDirToo | kCleanDirsOnlyIfEmpty );
    }
 }
@@ -435,6 +571,31 @@ DirManager::~DirManager()
 // project but just something else called project.
 void DirManager::CleanTempDir()
 {
+   if (dontDeleteTempFiles)
+      return; // do nothing
+
+   // Mapped files could not be moved on some systems
+   GetMappedFileCache().Clear();
+
+   // Move the projects out of the way at once, for the files to be removed
+   // in the background, in this session or the next
+   wxArrayString projectDirs;
+   {
+      wxDir dir(globaltemp);
+      wxString name;
+      bool cont = dir.IsOpened() &&
+         dir.GetFirst(&name, wxT("project*"), wxDIR_DIRS | wxDIR_NO_FOLLOW);
+      while (cont) {
+         projectDirs.Add(globaltemp + wxFILE_SEP_PATH + name);
+         cont = dir.GetNext(&name);
+      }
+   }
+   bool deferredAll = true;
+   for (const auto &projectDir : projectDirs)
+      deferredAll = DeferredDeleter::Defer(globaltemp, projectDir) && deferredAll;
+   if (deferredAll)
+      return;
+
    // with default flags (none) this does not clean the top directory, and may remove non-empty 
    // directories.
    CleanDir(globaltemp, wxT("project*"), wxEmptyString, _("Cleaning up temporary files"));
@@ -451,6 +612,9 @@ void DirManager::CleanDir(
    if (dontDeleteTempFiles)
       return; // do nothing
 
+   // Mapped files could not be removed on some systems
+   GetMappedFileCache().Clear();
+
    wxArrayString filePathArray, dirPathArray;
 
    int countFiles =
@@ -580,6 +744,24 @@ bool DirManager::SetProject(wxString& newProjPath, wxString& newProjName, const
       // in case there are any nulls
       trueTotal = count;
 
+      // Copy the extents of the block store too, as a few large files
+      const bool relocateStore = (mBlockStore->GetDirectory() != projFull);
+      const auto oldExtentPaths = mBlockStore->GetExtentPaths();
+      wxArrayString newExtentPaths;
+      if (success && relocateStore) {
+         mBlockStore->CloseFiles();
+         for (const auto &oldExtentPath : oldExtentPaths) {
+            const wxFileName newExtent{
+               projFull, wxFileName{ oldExtentPath }.GetFullName() };
+            if (!FileNames::CopyFile(
+                  oldExtentPath, newExtent.GetFullPath())) {
+               success = false;
+               break;
+            }
+            newExtentPaths.push_back(newExtent.GetFullPath());
+         }
+      }
+
       if (success) {
          auto size = newPaths.size();
          wxASSERT( size == mBlockFileHash.size() );
@@ -612,8 +794,10 @@ bool DirManager::SetProject(wxString& newProjPath, wxString& newProjName, const
                if (moving || !b->IsLocked()) {
                   auto result = b->GetFileName();
                   auto oldPath = result.name.GetFullPath();
-                  if (!oldPath.empty())
+                  if (!oldPath.empty()) {
+                     GetMappedFileCache().Invalidate( oldPath );
                      wxRemoveFile( oldPath );
+                  }
                }
 
                if (ii < size)
@@ -623,8 +807,20 @@ bool DirManager::SetProject(wxString& newProjPath, wxString& newProjName, const
 
             ++ii;
          }
+
+         if (relocateStore) {
+            // Extents of a saved project must stay, as for locked
+            // blockfiles; records are shared by its saved version
+            if (oldFull.empty())
+               for (const auto &oldExtentPath : oldExtentPaths)
+                  wxRemoveFile(oldExtentPath);
+            mBlockStore->SetDirectory(projFull);
+         }
       }
       else {
+         for (const auto &newExtentPath : newExtentPaths)
+            wxRemoveFile(newExtentPath);
+
          this->projFull = oldFull;
          this->projPath = oldPath;
          this->projName = oldName;
@@ -707,6 +903,29 @@ wxLongLong DirManager::GetFreeDiskSpace()
    return freeSpace;
 }
 
+bool DirManager::ReserveSpaceFor(sampleCount samples, sampleFormat format)
+{
+   if (!mUsePackedBlockStore)
+      return false;
+
+   // Summaries take three floats for each 256 samples, and records have
+   // small headers
+   const double perSample = SAMPLE_SIZE_DISK(format) + 3.0 * sizeof(float) / 256;
+   const auto bytes = 1.01 * perSample * samples.as_double();
+
+   // Also where space can't be preallocated
+   const auto freeSpace = GetFreeDiskSpace();
+   if (freeSpace < 0 || freeSpace.ToDouble() < bytes)
+      return false;
+
+   return mBlockStore->Reserve((unsigned long long)bytes);
+}
+
+void DirManager::ReleaseReservedSpace()
+{
+   mBlockStore->ReleaseReserve();
+}
+
 wxString DirManager::GetDataFilesDir() const
 {
    return projFull != wxT("")? projFull: mytemp;
@@ -715,6 +934,8 @@ wxString DirManager::GetDataFilesDir() const
 void DirManager::SetLocalTempDir(const wxString &path)
 {
    mytemp = path;
+   if (projFull.IsEmpty())
+      mBlockStore->SetDirectory(mytemp);
 }
 
 wxFileNameWrapper DirManager::MakeBlockFilePath(const wxString &value) {
@@ -749,36 +970,62 @@ wxFileNameWrapper DirManager::MakeBlockFilePath(const wxString &value) {
    return dir;
 }
 
+// Loading a project assigns a name to every block file, but there are
+// only a few hundred directories for them; build and check each once
+const wxFileNameWrapper &DirManager::GetBlockFileDir(const wxString &value)
+{
+   const auto base = GetDataFilesDir();
+   if (base != mBlockFileDirsBase) {
+      mBlockFileDirs.clear();
+      mBlockFileDirsBase = base;
+   }
+
+   wxString key;
+   if (value.GetChar(0) == wxT('d'))
+      key = value.Mid(0, value.Find(wxT('b')));
+   else if (value.GetChar(0) == wxT('e'))
+      key = value.Mid(0, 5);
+
+   auto iter = mBlockFileDirs.find(key);
+   if (iter == mBlockFileDirs.end())
+      iter = mBlockFileDirs.emplace(key, MakeBlockFilePath(value)).first;
+   return iter->second;
+}
+
 bool DirManager::AssignFile(wxFileNameWrapper &fileName,
                             const wxString &value,
                             bool diskcheck)
 {
+   if (!diskcheck) {
+      fileName = GetBlockFileDir(value);
+      fileName.SetFullName(value);
+      return fileName.IsOk();
+   }
+
    wxFileNameWrapper dir{ MakeBlockFilePath(value) };
 
-   if(diskcheck){
-      // verify that there's no possible collision on disk.  If there
-      // is, log the problem and return FALSE so that MakeBlockFileName
-      // can try again
+   // verify that there's no possible collision on disk.  If there
+   // is, log the problem and return FALSE so that MakeBlockFileName
+   // can try again
 
-      wxDir checkit(dir.GetFullPath());
-      if(!checkit.IsOpened()) return FALSE;
+   wxDir checkit(dir.GetFullPath());
+   if(!checkit.IsOpened()) return FALSE;
 
-      // this code is only valid if 'value' has no extention; that
-      // means, effectively, AssignFile may be called with 'diskcheck'
-      // set to true only if called from MakeFileBlockName().
+   // this code is only valid if 'value' has no extention; that
+   // means, effectively, AssignFile may be called with 'diskcheck'
+   // set to true only if called from MakeFileBlockName().
 
-      wxString filespec;
-      filespec.Printf(wxT("%s.*"),value);
-      if(checkit.HasFiles(filespec)){
-         // collision with on-disk state!
-         wxString collision;
-         checkit.GetFirst(&collision,filespec);
+   wxString filespec;
+   filespec.Printf(wxT("%s.*"),value);
+   if(checkit.HasFiles(filespec)){
+      // collision with on-disk state!
+      wxString collision;
+      checkit.GetFirst(&collision,filespec);
 
-         wxLogWarning(_("Audacity found an orphan block file: %s. \nPlease consider saving and reloading the project to perform a complete project check."),
-                      collision);
+      wxLogWarning(_("Audacity found an orphan block file: %s. \nPlease consider saving and reloading the project to perform a complete project check."),
+                   collision);
 
-         return FALSE;
-      }
+      return FALSE;
    }
    fileName.Assign(dir.GetFullPath(),value);
    return fileName.IsOk();
@@ -924,7 +1171,8 @@ void DirManager::BalanceInfoDel(const wxString &file)
             // back if its needed (unlike the dirTopPool hash)
             dirMidPool.erase(midkey);
 
-            // DELETE the actual directory
+            // DELETE the actual directory, which must then be made again
+            mBlockFileDirs.clear();
             wxString dir=(projFull != wxT("")? projFull: mytemp);
             dir += wxFILE_SEP_PATH;
             dir += file.Mid(0,3);
@@ -1079,13 +1327,92 @@ BlockFilePtr DirManager::NewSimpleBlockFile(
                                  sampleFormat format,
                                  bool allowDeferredWrite)
 {
-   wxFileNameWrapper filePath{ MakeBlockFileName() };
+   // Blocks of the same samples, as from repeated imports, generated
+   // noise or silence, or repeats, share one file
+   ContentHash hash;
+   hash.Add(&format, sizeof format);
+   hash.Add(&sampleLen, sizeof sampleLen);
+   hash.Add(sampleData, sampleLen * SAMPLE_SIZE(format));
+   const auto key = hash.Value();
+   if (auto existing = FindSameBlockFile(key, sampleData, sampleLen, format))
+      return existing;
+
+   auto newBlockFile =
+      MakeSimpleBlockFile(sampleData, sampleLen, format, allowDeferredWrite);
+
+   std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+   if (mContentHash.size() >= mContentHashSweepSize) {
+      for (auto it = mContentHash.begin(); it != mContentHash.end();)
+         it = it->second.expired() ? mContentHash.erase(it) : ++it;
+      mContentHashSweepSize = std::max<size_t>(1024, 2 * mContentHash.size());
+   }
+   mContentHash[key] = newBlockFile;
+   return newBlockFile;
+}
+
+BlockFilePtr DirManager::FindSameBlockFile(uint64_t key,
+   samplePtr sampleData, size_t sampleLen, sampleFormat format)
+{
+   BlockFilePtr existing;
+   {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      auto it = mContentHash.find(key);
+      if (it != mContentHash.end())
+         existing = it->second.lock();
+   }
+   // As in CopyBlockFile, locked files are not shared
+   if (!existing || existing->IsLocked() || existing->GetLength() != sampleLen)
+      return {};
+
+   // The hash is only a hint; compare the samples
+   const auto bytes = sampleLen * SAMPLE_SIZE(format);
+   SampleBuffer buffer(sampleLen, format);
+   if (existing->ReadData(buffer.ptr(), format, 0, sampleLen, false)
+          != sampleLen ||
+       memcmp(buffer.ptr(), sampleData, bytes) != 0)
+      return {};
+
+   return existing;
+}
+
+BlockFilePtr DirManager::MakeSimpleBlockFile(
+                                 samplePtr sampleData, size_t sampleLen,
+                                 sampleFormat format,
+                                 bool allowDeferredWrite)
+{
+   // Files importing at once make blocks on several threads
+   if (mUsePackedBlockStore) {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      // Not hashed:  the block has no file of its own
+      return make_blockfile<PackedBlockFile>
+         (mBlockStore, sampleData, sampleLen, format);
+   }
+
+   wxFileNameWrapper filePath{ [&] {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      auto result = MakeBlockFileName();
+      // Reserve the name while the file is written
+      mBlockFileHash[result.GetName()];
+      return result;
+   }() };
    const wxString fileName{ filePath.GetName() };
 
    auto newBlockFile = make_blockfile<SimpleBlockFile>
       (std::move(filePath), sampleData, sampleLen, format, allowDeferredWrite);
 
-   mBlockFileHash[fileName] = newBlockFile;
+   if (newBlockFile->GetNeedWriteBehind() &&
+       !BlockWriteQueue::Get().Push(newBlockFile)) {
+      // The disk is behind; write now, as if there were no queue
+      newBlockFile->WriteCacheToDisk();
+      if (newBlockFile->GetNeedWriteCacheToDisk())
+         throw FileException{
+            FileException::Cause::Write, newBlockFile->GetFileName().name };
+   }
+
+   {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      mBlockFileHash[fileName] = newBlockFile;
+   }
 
    return newBlockFile;
 }
@@ -1107,6 +1434,64 @@ BlockFilePtr DirManager::NewAliasBlockFile(
    return newBlockFile;
 }
 
+BlockFilePtr DirManager::NewAliasBlockFile(
+                                 const wxString &aliasedFile, sampleCount aliasStart,
+                                 size_t aliasLen, int aliasChannel,
+                                 samplePtr sampleData, sampleFormat format)
+{
+   // Files importing at once make blocks on several threads
+   wxFileNameWrapper filePath{ [&] {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      auto result = MakeBlockFileName();
+      // Reserve the name while the summary is written
+      mBlockFileHash[result.GetName()];
+      return result;
+   }() };
+   const wxString fileName = filePath.GetName();
+
+   auto newBlockFile = make_blockfile<PCMAliasBlockFile>
+      (std::move(filePath), wxFileNameWrapper{aliasedFile},
+       aliasStart, aliasLen, aliasChannel, sampleData, format);
+
+   {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      mBlockFileHash[fileName]=newBlockFile;
+      aliasList.Add(aliasedFile);
+   }
+
+   return newBlockFile;
+}
+
+BlockFilePtr DirManager::NewRawAliasBlockFile(
+                                 const wxString &aliasedFile, sampleCount aliasStart,
+                                 size_t aliasLen, int aliasChannel,
+                                 const RawLayout &layout,
+                                 samplePtr sampleData, sampleFormat format)
+{
+   // The raw importer makes blocks on several threads
+   wxFileNameWrapper filePath{ [&] {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      auto result = MakeBlockFileName();
+      // Reserve the name while the summary is written
+      mBlockFileHash[result.GetName()];
+      return result;
+   }() };
+   const wxString fileName = filePath.GetName();
+
+   auto newBlockFile = make_blockfile<RawAliasBlockFile>
+      (std::move(filePath), wxFileNameWrapper{aliasedFile},
+       aliasStart, aliasLen, aliasChannel, layout, sampleData, format);
+
+   {
+      std::lock_guard<std::mutex> lock{ mNewBlockMutex };
+      mBlockFileHash[fileName]=newBlockFile;
+      if (aliasList.Index(aliasedFile) == wxNOT_FOUND)
+         aliasList.Add(aliasedFile);
+   }
+
+   return newBlockFile;
+}
+
 BlockFilePtr DirManager::NewODAliasBlockFile(
                                  const wxString &aliasedFile, sampleCount aliasStart,
                                  size_t aliasLen, int aliasChannel)
@@ -1162,6 +1547,22 @@ bool DirManager::ContainsBlockFile(const wxString &filepath) const
       BlockFilePtr{ it->second.lock() };
 }
 
+// This function returns non-NULL, or else throws
+BlockFilePtr DirManager::AdoptBlockFile(const BlockFilePtr &b)
+{
+   auto pPacked = dynamic_cast<PackedBlockFile*>(b.get());
+   if (!pPacked || !pPacked->IsBorrowed() ||
+       pPacked->GetStore() == mBlockStore)
+      return b;
+
+   auto &wAdopted = mAdoptedBlockHash[pPacked->GetKey()];
+   if (auto adopted = wAdopted.lock())
+      return adopted;
+   auto adopted = pPacked->CopyTo(mBlockStore);
+   wAdopted = adopted;
+   return adopted;
+}
+
 // Adds one to the reference count of the block file,
 // UNLESS it is "locked", then it makes a NEW copy of
 // the BlockFile.
@@ -1171,6 +1572,16 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
    if (!b)
       THROW_INCONSISTENCY_EXCEPTION;
 
+   if (auto pPacked = dynamic_cast<PackedBlockFile*>(b.get())) {
+      // Records in the store of another project are not copied into ours
+      // until we are saved, whether or not locked.  Otherwise, records
+      // never change, and the code below just shares or copies the object.
+      if (pPacked->GetStore() != mBlockStore)
+         return pPacked->IsBorrowed() && !b->IsLocked()
+            ? b
+            : pPacked->Borrow();
+   }
+
    auto result = b->GetFileName();
    const auto &fn = result.name;
 
@@ -1205,7 +1616,10 @@ BlockFilePtr DirManager::CopyBlockFile(const BlockFilePtr &b)
       //a summary file, so we should check before we copy.
       if(b->IsSummaryAvailable())
       {
-         if( !FileNames::CopyFile(fn.GetFullPath(),
+         // The file of a block just recorded may not be written yet
+         b->WriteCacheToDisk();
+
+         if( !FileNames::CloneFile(fn.GetFullPath(),
                   newFile.GetFullPath()) )
             // Disk space exhaustion, maybe
             throw FileException{
@@ -1244,8 +1658,12 @@ bool DirManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    }
    else if ( !wxStricmp(tag, wxT("simpleblockfile")) )
       pBlockFile = SimpleBlockFile::BuildFromXML(*this, attrs);
+   else if ( !wxStricmp(tag, wxT("packedblockfile")) )
+      pBlockFile = PackedBlockFile::BuildFromXML(*this, attrs);
    else if( !wxStricmp(tag, wxT("pcmaliasblockfile")) )
       pBlockFile = PCMAliasBlockFile::BuildFromXML(*this, attrs);
+   else if( !wxStricmp(tag, wxT("rawaliasblockfile")) )
+      pBlockFile = RawAliasBlockFile::BuildFromXML(*this, attrs);
    else if( !wxStricmp(tag, wxT("odpcmaliasblockfile")) )
    {
       pBlockFile = ODPCMAliasBlockFile::BuildFromXML(*this, attrs);
@@ -1308,15 +1726,28 @@ bool DirManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    // return a reference to the existing object instead.
    //
 
-   wxString name = target->GetFileName().name.GetName();
-   auto &wRetrieved = mBlockFileHash[name];
+   // Packed blockfiles have no file names, but are identified by their
+   // records, and kept out of mBlockFileHash, whose entries are moved by
+   // SetProject
+   auto pPacked = dynamic_cast<PackedBlockFile*>(target.get());
+   wxString name = pPacked
+      ? pPacked->GetKey()
+      : target->GetFileName().name.GetName();
+   auto &wRetrieved = (pPacked ? mPackedBlockHash : mBlockFileHash)[name];
    BlockFilePtr retrieved = wRetrieved.lock();
    if (retrieved) {
       // Lock it in order to DELETE it safely, i.e. without having
       // it DELETE the file, too...
       target->Lock();
 
+      const auto count = BlockFile::gBlockFileDestructionCount;
       target = retrieved;
+
+      // The duplicate was never in the hash, so don't let its destruction
+      // make the next GetBalanceInfo() search all of the hash for nothing
+      if (mLastBlockFileDestructionCount == count &&
+          BlockFile::gBlockFileDestructionCount == count + 1)
+         mLastBlockFileDestructionCount = count + 1;
       return true;
    }
 
@@ -1324,7 +1755,8 @@ bool DirManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    wRetrieved = target;
    // MakeBlockFileName wasn't used so we must add the directory
    // balancing information
-   BalanceInfoAdd(name);
+   if (!pPacked)
+      BalanceInfoAdd(name);
 
    return true;
 }
@@ -1357,7 +1789,9 @@ std::pair<bool, wxString> DirManager::CopyToNewProjectDirectory(BlockFile *f)
       bool summaryExisted = f->IsSummaryAvailable();
       auto oldPath = oldFileNameRef.GetFullPath();
       if (summaryExisted) {
-         auto success = FileNames::CopyFile(oldPath, newPath);
+         // The file of a block just recorded may not be written yet
+         f->WriteCacheToDisk();
+         auto success = FileNames::CloneFile(oldPath, newPath);
          if (!success)
             return { false, {} };
       }
@@ -1486,6 +1920,9 @@ bool DirManager::EnsureSafeFilename(const wxFileName &fName)
    }
 
    if (needToRename) {
+      // Open files could not be renamed on some systems
+      GetSoundFileCache().Invalidate(fullPath);
+      GetRawFileMappings().Invalidate(fullPath);
       if (!wxRenameFile(fullPath,
                         renamedFullPath))
       {
@@ -1583,15 +2020,28 @@ int DirManager::ProjectFSCK(const bool bForceError, const bool bAutoRecoverMode)
 
    wxArrayString filePathArray; // *all* files in the project directory/subdirectories
    wxString dirPath = (projFull != wxT("") ? projFull : mytemp);
-   RecursivelyEnumerateWithProgress(
+   std::vector<ScannedDirectory> directories;
+   EnumerateProjectInParallel(
       dirPath,
       filePathArray,          // output: all files in project directory tree
-      wxEmptyString,          // All dirs
-      wxEmptyString,          // All files
-      true, false,
-      mBlockFileHash.size(),  // rough guess of how many BlockFiles will be found/processed, for progress
+      directories,            // output: all directories, with their times
       _("Inspecting project file data"));
 
+   // Lookups in these replace most checks for the existence of files
+   FilePathSet foundFiles(filePathArray.begin(), filePathArray.end());
+   // Only a saved project keeps a manifest; the temporary one is deleted
+   FilePathSet verifiedDirs;
+   if (!projFull.empty()) {
+      const auto manifest = ReadFSCKManifest(dirPath);
+      for (const auto &directory : directories) {
+         const auto found = manifest.find(directory.path.Mid(dirPath.length()));
+         if (found != manifest.end() &&
+             found->second.first == (long long)directory.modified &&
+             found->second.second == directory.count)
+            verifiedDirs.insert(directory.path);
+      }
+   }
+
    //
    // MISSING ALIASED AUDIO FILES
    //
@@ -1685,7 +2135,7 @@ _("Project check of \"%s\" folder \
    // Alias summary regeneration must happen after checking missing aliased files.
    //
    BlockHash missingAUFHash;              // missing (.auf) AliasBlockFiles
-   this->FindMissingAUFs(missingAUFHash);
+   this->FindMissingAUFs(missingAUFHash, foundFiles);
    if ((nResult != FSCKstatus_CLOSE_REQ) && !missingAUFHash.empty())
    {
       // In auto-recover mode, we just recreate the alias files, and do not ask user.
@@ -1751,7 +2201,7 @@ _("Project check of \"%s\" folder \
    // MISSING (.AU) SimpleBlockFiles
    //
    BlockHash missingAUHash;               // missing data (.au) blockfiles
-   this->FindMissingAUs(missingAUHash);
+   this->FindMissingAUs(missingAUHash, foundFiles, verifiedDirs);
    if ((nResult != FSCKstatus_CLOSE_REQ) && !missingAUHash.empty())
    {
       // In auto-recover mode, we just always create silent blocks.
@@ -1898,6 +2348,9 @@ other projects. \
             _("Warning: Problems in Automatic Recovery"),
             wxOK  | wxICON_EXCLAMATION);
    }
+   else if (nResult == 0 && !projFull.empty())
+      // Nothing was wrong, and nothing was changed
+      WriteFSCKManifest(dirPath, directories);
 
    wxGetApp().SetMissingAliasedFileWarningShouldShow(true);
    return nResult;
@@ -1907,6 +2360,33 @@ void DirManager::FindMissingAliasedFiles(
       BlockHash& missingAliasedFileAUFHash,     // output: (.auf) AliasBlockFiles whose aliased files are missing
       BlockHash& missingAliasedFilePathHash)    // output: full paths of missing aliased files
 {
+   // Many blocks alias each file, so look for each file once, and for
+   // all of them in parallel
+   std::unordered_map< wxString, bool > aliasedFileExists;
+   for (const auto &pair : mBlockFileHash)
+   {
+      BlockFilePtr b = pair.second.lock();
+      if (b && b->IsAlias())
+      {
+         wxString aliasedFileFullPath = static_cast< AliasBlockFile* >
+            ( &*b )->GetAliasedFileName().GetFullPath();
+         // wxEmptyString can happen if user already chose to "replace... with silence".
+         if (aliasedFileFullPath != wxEmptyString)
+            aliasedFileExists[aliasedFileFullPath] = true;
+      }
+   }
+   {
+      std::vector< wxString > paths;
+      for (const auto &pair : aliasedFileExists)
+         paths.push_back(pair.first);
+      ArrayOf< char > exists{ paths.size() };
+      TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, paths.size(), [&](size_t ii) {
+         exists[ii] = wxFileName::FileExists(paths[ii]);
+      });
+      for (size_t ii = 0; ii < paths.size(); ii++)
+         aliasedFileExists[paths[ii]] = exists[ii];
+   }
+
    BlockHash::iterator iter = mBlockFileHash.begin();
    while (iter != mBlockFileHash.end())
    {
@@ -1920,7 +2400,7 @@ void DirManager::FindMissingAliasedFiles(
             wxString aliasedFileFullPath = aliasedFileName.GetFullPath();
             // wxEmptyString can happen if user already chose to "replace... with silence".
             if ((aliasedFileFullPath != wxEmptyString) &&
-                !aliasedFileName.FileExists())
+                !aliasedFileExists[aliasedFileFullPath])
             {
                missingAliasedFileAUFHash[key] = b;
                if (missingAliasedFilePathHash.find(aliasedFileFullPath) ==
@@ -1943,7 +2423,8 @@ void DirManager::FindMissingAliasedFiles(
 }
 
 void DirManager::FindMissingAUFs(
-      BlockHash& missingAUFHash)                // output: missing (.auf) AliasBlockFiles
+      BlockHash& missingAUFHash,                // output: missing (.auf) AliasBlockFiles
+      const FilePathSet& foundFiles)            // input: files in the project directory
 {
    BlockHash::iterator iter = mBlockFileHash.begin();
    while (iter != mBlockFileHash.end())
@@ -1958,7 +2439,10 @@ void DirManager::FindMissingAUFs(
             wxFileNameWrapper fileName{ MakeBlockFilePath(key) };
             fileName.SetName(key);
             fileName.SetExt(wxT("auf"));
-            if (!fileName.FileExists())
+            // A file not found where expected might still have been named
+            // differently in the enumeration
+            if (!foundFiles.count(fileName.GetFullPath()) &&
+                !fileName.FileExists())
             {
                missingAUFHash[key] = b;
                wxLogWarning(_("Missing alias (.auf) block file: '%s'"),
@@ -1971,8 +2455,18 @@ void DirManager::FindMissingAUFs(
 }
 
 void DirManager::FindMissingAUs(
-      BlockHash& missingAUHash)                 // missing data (.au) blockfiles
+      BlockHash& missingAUHash,                 // missing data (.au) blockfiles
+      const FilePathSet& foundFiles,            // input: files in the project directory
+      const FilePathSet& verifiedDirs)          // input: directories unchanged since a clean check
 {
+   struct Candidate
+   {
+      wxString key;
+      BlockFilePtr b;
+      wxString path;
+      bool missing;
+   };
+   std::vector< Candidate > candidates;
    BlockHash::iterator iter = mBlockFileHash.begin();
    while (iter != mBlockFileHash.end())
    {
@@ -1985,16 +2479,33 @@ void DirManager::FindMissingAUs(
             fileName.SetName(key);
             fileName.SetExt(wxT("au"));
             const auto path = fileName.GetFullPath();
-            if (!fileName.FileExists() ||
-                wxFile{ path }.Length() == 0)
-            {
-               missingAUHash[key] = b;
-               wxLogWarning(_("Missing data block file: '%s'"), path);
-            }
+            // Files found in a directory that has not changed since a clean
+            // check were not empty then, and can't be now
+            const bool verified = foundFiles.count(path) &&
+               verifiedDirs.count(fileName.GetPath());
+            if (!verified)
+               candidates.push_back({ key, b, path, false });
          }
       }
       ++iter;
    }
+
+   TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, candidates.size(), [&](size_t ii) {
+      auto &candidate = candidates[ii];
+      candidate.missing =
+         (!foundFiles.count(candidate.path) &&
+          !wxFileName::FileExists(candidate.path)) ||
+         wxFileName::GetSize(candidate.path) == 0u;
+   });
+
+   for (const auto &candidate : candidates)
+   {
+      if (candidate.missing)
+      {
+         missingAUHash[candidate.key] = candidate.b;
+         wxLogWarning(_("Missing data block file: '%s'"), candidate.path);
+      }
+   }
 }
 
 // Find .au and .auf files that are not in the project.
@@ -2040,13 +2551,11 @@ void DirManager::RemoveOrphanBlockfiles()
 {
    wxArrayString filePathArray; // *all* files in the project directory/subdirectories
    wxString dirPath = (projFull != wxT("") ? projFull : mytemp);
-   RecursivelyEnumerateWithProgress(
+   std::vector<ScannedDirectory> directories;
+   EnumerateProjectInParallel(
       dirPath,
       filePathArray,          // output: all files in project directory tree
-      wxEmptyString,          // All dirs
-      wxEmptyString,          // All files
-      true, false,
-      mBlockFileHash.size(),  // rough guess of how many BlockFiles will be found/processed, for progress
+      directories,
       _("Inspecting project file data"));
 
    wxArrayString orphanFilePathArray;
@@ -2054,64 +2563,54 @@ void DirManager::RemoveOrphanBlockfiles()
             filePathArray,          // input: all files in project directory tree
             orphanFilePathArray);   // output: orphan files
 
-   // Remove all orphan blockfiles.
-   for (size_t i = 0; i < orphanFilePathArray.GetCount(); i++)
-      wxRemoveFile(orphanFilePathArray[i]);
+   // Remove all orphan blockfiles.  Not deferred, because new blockfiles
+   // could be given the same names before they were gone.
+   TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, orphanFilePathArray.GetCount(),
+      [&](size_t i) { wxRemoveFile(orphanFilePathArray[i]); });
 }
 
-void DirManager::FillBlockfilesCache()
+namespace {
+size_t MappedFileBudget()
 {
-#ifdef DEPRECATED_AUDIO_CACHE
-   // See http://bugzilla.audacityteam.org/show_bug.cgi?id=545.
-   bool cacheBlockFiles = false;
-   gPrefs->Read(wxT("/Directories/CacheBlockFiles"), &cacheBlockFiles);
-
-   if (!cacheBlockFiles)
-      return; // user opted not to cache block files
-
-   int lowMem = gPrefs->Read(wxT("/Directories/CacheLowMem"), 16l);
-   if (lowMem < 16) {
-      lowMem = 16;
-   }
-   lowMem <<= 20;
-
-   BlockHash::iterator iter;
-   int numNeed = 0;
-
-   iter = mBlockFileHash.begin();
-   while (iter != mBlockFileHash.end())
-   {
-      BlockFilePtr b = iter->second.lock();
-      if (b) {
-         if (b->GetNeedFillCache())
-            numNeed++;
-      }
-      ++iter;
-   }
+   // Be modest with address space in 32 bit builds
+   const long defaultMB = sizeof(void*) > 4 ? 512 : 64;
+   long budgetMB =
+      gPrefs->Read(wxT("/Directories/MappedFilesMB"), defaultMB);
+   return size_t( std::max(0L, budgetMB) ) << 20;
+}
+}
 
-   if (numNeed == 0)
-      return;
+// static
+MappedFileCache &DirManager::GetMappedFileCache()
+{
+   static MappedFileCache theCache{ MappedFileBudget() };
+   return theCache;
+}
 
-   ProgressDialog progress(_("Caching audio"),
-                           _("Caching audio into memory"));
+// static
+void DirManager::UpdateMappedFileBudget()
+{
+   GetMappedFileCache().SetBudget( MappedFileBudget() );
+}
 
-   iter = mBlockFileHash.begin();
-   int current = 0;
-   while (iter != mBlockFileHash.end())
-   {
-      BlockFilePtr b = iter->second.lock();
-      if (b) {
-         if (b->GetNeedFillCache() && (GetFreeMemory() > lowMem)) {
-            b->FillCache();
-         }
+// static
+MappedFileCache &DirManager::GetRawFileMappings()
+{
+   // Files of many gigabytes are mapped whole, which only 64 bit builds
+   // have room for; others read the files
+   static MappedFileCache theCache{
+      sizeof(void*) > 4 ? size_t( 1ULL << 42 ) : 0 };
+   return theCache;
+}
 
-         if (!progress.Update(current, numNeed))
-            break; // user cancelled progress dialog, stop caching
-         current++;
-      }
-      ++iter;
-   }
-#endif // DEPRECATED_AUDIO_CACHE
+// static
+SoundFileCache &DirManager::GetSoundFileCache()
+{
+   // Well under the limit of open files on all systems
+   static SoundFileCache theCache{
+      size_t( std::max( 0L,
+         gPrefs->Read(wxT("/Directories/OpenAliasedFiles"), 32L) ) ) };
+   return theCache;
 }
 
 void DirManager::WriteCacheToDisk()
@@ -22,11 +22,18 @@
 #include "xml/XMLTagHandler.h"
 #include "wxFileNameWrapper.h"
 
+#include <cstdint>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 class wxHashTable;
 class BlockArray;
 class BlockFile;
+class BlockStore;
+class MappedFileCache;
+class RawLayout;
+class SoundFileCache;
 
 #define FSCKstatus_CLOSE_REQ 0x1
 #define FSCKstatus_CHANGED   0x2
@@ -39,6 +46,8 @@ using BlockFilePtr = std::shared_ptr<BlockFile>;
 
 using BlockHash = std::unordered_map< wxString, std::weak_ptr<BlockFile> >;
 
+using FilePathSet = std::unordered_set< wxString >;
+
 wxMemorySize GetFreeMemory();
 
 enum {
@@ -58,6 +67,7 @@ class PROFILE_DLL_API DirManager final : public XMLTagHandler {
    virtual ~DirManager();
 
    static void SetTempDir(const wxString &_temp) { globaltemp = _temp; }
+   static const wxString &GetTempDir() { return globaltemp; }
 
    // Returns true on success.
    // If SetProject is told NOT to create the directory
@@ -79,6 +89,21 @@ class PROFILE_DLL_API DirManager final : public XMLTagHandler {
       NewAliasBlockFile( const wxString &aliasedFile, sampleCount aliasStart,
                                  size_t aliasLen, int aliasChannel);
 
+   // The samples were read from the aliased file by the caller, and the
+   // summary is computed from them
+   BlockFilePtr
+      NewAliasBlockFile( const wxString &aliasedFile, sampleCount aliasStart,
+                                 size_t aliasLen, int aliasChannel,
+                                 samplePtr sampleData, sampleFormat format);
+
+   // An alias to a file with no header; the summary is computed from the
+   // samples the caller decoded
+   BlockFilePtr
+      NewRawAliasBlockFile( const wxString &aliasedFile, sampleCount aliasStart,
+                                 size_t aliasLen, int aliasChannel,
+                                 const RawLayout &layout,
+                                 samplePtr sampleData, sampleFormat format);
+
    BlockFilePtr
       NewODAliasBlockFile( const wxString &aliasedFile, sampleCount aliasStart,
                                  size_t aliasLen, int aliasChannel);
@@ -99,6 +124,12 @@ class PROFILE_DLL_API DirManager final : public XMLTagHandler {
    // returns non-null.
    BlockFilePtr CopyBlockFile(const BlockFilePtr &b);
 
+   // Returns the block file, or if it refers to a record in the store of
+   // another project, a NEW one with a copy of the record in ours.  Call
+   // before saving.  Records shared by several block files are copied once.
+   // May throw.
+   BlockFilePtr AdoptBlockFile(const BlockFilePtr &b);
+
    BlockFile *LoadBlockFile(const wxChar **attrs, sampleFormat format);
    void SaveBlockFile(BlockFile *f, int depth, FILE *fp);
 
@@ -148,10 +179,15 @@ class PROFILE_DLL_API DirManager final : public XMLTagHandler {
    void FindMissingAliasedFiles(
          BlockHash& missingAliasedFileAUFHash,     // output: (.auf) AliasBlockFiles whose aliased files are missing
          BlockHash& missingAliasedFilePathHash);   // output: full paths of missing aliased files
+   // The files found are only a shortcut; others are still looked for
    void FindMissingAUFs(
-         BlockHash& missingAUFHash);               // output: missing (.auf) AliasBlockFiles
+         BlockHash& missingAUFHash,                // output: missing (.auf) AliasBlockFiles
+         const FilePathSet& foundFiles);           // input: files in the project directory
+   // .au files found in verifiedDirs are not opened to check they have data
    void FindMissingAUs(
-         BlockHash& missingAUHash);                // missing data (.au) blockfiles
+         BlockHash& missingAUHash,                 // missing data (.au) blockfiles
+         const FilePathSet& foundFiles,            // input: files in the project directory
+         const FilePathSet& verifiedDirs);         // input: directories unchanged since a clean check
    // Find .au and .auf files that are not in the project.
    void FindOrphanBlockFiles(
          const wxArrayString& filePathArray,       // input: all files in project directory
@@ -178,17 +214,67 @@ class PROFILE_DLL_API DirManager final : public XMLTagHandler {
    // Write all write-cached block files to disc, if any
    void WriteCacheToDisk();
 
-   // (Try to) fill cache of blockfiles, if caching is enabled (otherwise do
-   // nothing)
-   // A no-fail operation that does not throw
-   void FillBlockfilesCache();
+   // Memory mappings of block files, shared by all projects, for fast reads
+   static MappedFileCache &GetMappedFileCache();
+   // Apply the preference for the total size of mappings
+   static void UpdateMappedFileBudget();
+
+   // Aliased sound files kept open between reads, shared by all projects
+   static SoundFileCache &GetSoundFileCache();
+
+   // Memory mappings of aliased raw files, which may be far larger than
+   // block files, so they are not counted against the budget above
+   static MappedFileCache &GetRawFileMappings();
+
+   // Holds the records of PackedBlockFile objects, in GetDataFilesDir()
+   const std::shared_ptr<BlockStore> &GetBlockStore() const
+   { return mBlockStore; }
+   // Whether NEW simple blockfiles are packed into the block store
+   bool UsesPackedBlockStore() const { return mUsePackedBlockStore; }
+
+   // For a long recording:  allocates the space that packed blockfiles of
+   // that many samples (of all channels) will take, so that the recording
+   // does not fail late for lack of it, and its blocks lie in order.
+   // Returns false if the project doesn't pack its blockfiles, or the
+   // space isn't free.
+   bool ReserveSpaceFor(sampleCount samples, sampleFormat format);
+   // Frees the reserved space that the recording did not use
+   void ReleaseReservedSpace();
 
  private:
 
+   // Returns a block file of the same samples, by the hash of its content,
+   // or null
+   BlockFilePtr FindSameBlockFile(uint64_t key,
+      samplePtr sampleData, size_t sampleLen, sampleFormat format);
+   BlockFilePtr MakeSimpleBlockFile(samplePtr sampleData, size_t sampleLen,
+      sampleFormat format, bool allowDeferredWrite);
+
    wxFileNameWrapper MakeBlockFileName();
    wxFileNameWrapper MakeBlockFilePath(const wxString &value);
+   const wxFileNameWrapper &GetBlockFileDir(const wxString &value);
 
    BlockHash mBlockFileHash; // repository for blockfiles
+   // Sub-directories of GetDataFilesDir() made or found by
+   // GetBlockFileDir(), by the prefix of the block file names in them
+   std::unordered_map<wxString, wxFileNameWrapper> mBlockFileDirs;
+   wxString mBlockFileDirsBase;
+   // Guards the making of NEW simple blockfiles, which may happen on
+   // several threads at once
+   std::mutex mNewBlockMutex;
+   BlockHash mPackedBlockHash; // packed blockfiles loaded, by record
+   // Simple and packed blockfiles made in this session, by the hash of
+   // their content; guarded by mNewBlockMutex.  Those loaded are not
+   // hashed, but a block shared by several sequences is saved once, by
+   // name or record, and loaded again as one object.
+   std::unordered_map<uint64_t, std::weak_ptr<BlockFile>> mContentHash;
+   size_t mContentHashSweepSize { 1024 };
+   // Copies made by AdoptBlockFile, by the record borrowed
+   BlockHash mAdoptedBlockHash;
+
+   std::shared_ptr<BlockStore> mBlockStore;
+   // Whether NEW simple blockfiles are packed; fixed for the project
+   bool mUsePackedBlockStore;
 
    // Hashes for management of the sub-directory tree of _data
    struct BalanceInfo
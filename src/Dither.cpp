@@ -29,8 +29,19 @@
 
 Dither class. You must construct an instance because it keeps
 state. Call Dither::Apply() to apply the dither. You can call
-Reset() between subsequent dithers to reset the dither state
-and get deterministic behaviour.
+Reset() between subsequent dithers to reset the state of the
+dither filters.
+
+  Conversions go through a small block of floats, so that the loads,
+  the scaling and clipping, and the rounding stores can use SSE2 or
+  NEON instructions where the processor has them as its baseline.
+  Only the dither itself, which keeps state from sample to sample,
+  remains a scalar loop.
+
+  Conversions without dither are looked up, once per call, in a table of
+  kernels made from templates for each pair of formats and kind of
+  stride, so that CopySamples() callers such as RingBuffer, Sequence and
+  the exporters run loops specialized to their case.
 
 *//*******************************************************************/
 
@@ -43,6 +54,8 @@ and get deterministic behaviour.
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <type_traits>
 //#include <sys/types.h>
 //#include <memory.h>
 //#include <assert.h>
@@ -51,6 +64,18 @@ and get deterministic behaviour.
 
 #include "Dither.h"
 
+// SSE2 is part of every x86-64 processor, and NEON (with the rounding
+// conversions used here) of every AArch64 processor, so no run time test
+// is needed for either
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DITHER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define DITHER_NEON
+#include <arm_neon.h>
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 
 // Constants for the noise shaping buffer
@@ -61,73 +86,7 @@ const int Dither::BUF_SIZE = 8;
 const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 
 // This is supposed to produce white noise and no dc
-#define DITHER_NOISE (rand() / (float)RAND_MAX - 0.5f)
-
-// The following is a rather ugly, but fast implementation
-// of a dither loop. The macro "DITHER" is expanded to an implementation
-// of a dithering algorithm, which contains no branches in the inner loop
-// except the branches for clipping the sample, and therefore should
-// be quite fast.
-
-#if 0
-// To assist in understanding what the macros are doing, here's an example of what
-// the result would be for Shaped dither:
-//
-// DITHER(ShapedDither, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-
-    do {
-        if (sourceFormat == int24Sample && destFormat == int16Sample)
-            do {
-                char *d, *s;
-                unsigned int i;
-                int x;
-                for (d = (char*)dest, s = (char*)source, i = 0; i < len; i++, d += (int16Sample >> 16) * destStride, s += (int24Sample >> 16) * sourceStride)
-                    do {
-                        x = lrintf((ShapedDither((((*(( int*)(s)) / float(1<<23))) * float(1<<15)))));
-                        if (x>(32767))
-                            *((short*)((((d)))))=(32767);
-                        else if (x<(-32768))
-                            *((short*)((((d)))))=(-32768);
-                        else *((short*)((((d)))))=(short)x;
-                    } while (0);
-            } while (0);
-        else if (sourceFormat == floatSample && destFormat == int16Sample)
-            do {
-                char *d, *s;
-                unsigned int i;
-                int x;
-                for (d = (char*)dest, s = (char*)source, i = 0; i < len; i++, d += (int16Sample >> 16) * destStride, s += (floatSample >> 16) * sourceStride)
-                    do {
-                        x = lrintf((ShapedDither((((*((float*)(s)) > 1.0 ? 1.0 : *((float*)(s)) < -1.0 ? -1.0 : *((float*)(s)))) * float(1<<15)))));
-                        if (x>(32767))
-                            *((short*)((((d)))))=(32767);
-                        else if (x<(-32768))
-                            *((short*)((((d)))))=(-32768);
-                        else *((short*)((((d)))))=(short)x;
-                    } while (0);
-            } while (0);
-        else if (sourceFormat == floatSample && destFormat == int24Sample)
-            do {
-                char *d, *s;
-                unsigned int i;
-                int x;
-                for (d = (char*)dest, s = (char*)source, i = 0; i < len; i++, d += (int24Sample >> 16) * destStride, s += (floatSample >> 16) * sourceStride)
-                    do {
-                        x = lrintf((ShapedDither((((*((float*)(s)) > 1.0 ? 1.0 : *((float*)(s)) < -1.0 ? -1.0 : *((float*)(s)))) * float(1<<23)))));
-                        if (x>(8388607))
-                            *((int*)((((d)))))=(8388607);
-                        else if (x<(-8388608))
-                            *((int*)((((d)))))=(-8388608);
-                        else *((int*)((((d)))))=(int)x;
-                    } while (0);
-            } while (0);
-        else {
-            if ( false )
-                ;
-            else wxOnAssert(L"c:\\users\\yam\\documents\\audacity\\mixer\\n\\audacity\\src\\dither.cpp", 348,  __FUNCTION__  , L"false", 0);
-        }
-    } while (0);
-#endif
+#define DITHER_NOISE Noise()
 
 // Defines for sample conversion
 #define CONVERT_DIV16 float(1<<15)
@@ -144,10 +103,6 @@ const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
                          *((float*)(ptr)) < -1.0 ? -1.0 : \
                          *((float*)(ptr)))
 
-// Promote sample to range of specified type, keep it float, though
-#define PROMOTE_TO_INT16(sample) ((sample) * CONVERT_DIV16)
-#define PROMOTE_TO_INT24(sample) ((sample) * CONVERT_DIV24)
-
 // Store float sample 'sample' into pointer 'ptr', clip it, if necessary
 // Note: This assumes, a variable 'x' of type int is valid which is
 //       used by this macro.
@@ -161,48 +116,392 @@ const float Dither::SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 #define STORE_INT16(ptr, sample) IMPLEMENT_STORE((ptr), (sample), short, -32768, 32767)
 #define STORE_INT24(ptr, sample) IMPLEMENT_STORE((ptr), (sample), int, -8388608, 8388607)
 
-// Dither single float 'sample' and store it in pointer 'dst', using 'dither' as algorithm
-#define DITHER_TO_INT16(dither, dst, sample) STORE_INT16((dst), dither(PROMOTE_TO_INT16(sample)))
-#define DITHER_TO_INT24(dither, dst, sample) STORE_INT24((dst), dither(PROMOTE_TO_INT24(sample)))
+namespace {
 
-// Implement one single dither step
-#define DITHER_STEP(dither, store, load, dst, src) \
-    store(dither, (dst), load(src))
+// Dithering converts through a buffer of this many floats
+enum : unsigned { BlockSize = 256 };
 
-// Implement a dithering loop
-// Note: The variable 'x' is needed for the STORE_... macros
-#define DITHER_LOOP(dither, store, load, dst, dstFormat, dstStride, src, srcFormat, srcStride, len) \
-    do { \
-       char *d, *s; \
-       unsigned int i; \
-       int x; \
-       for (d = (char*)dst, s = (char*)src, i = 0; \
-            i < len; \
-            i++, d += SAMPLE_SIZE(dstFormat) * dstStride, \
-                 s += SAMPLE_SIZE(srcFormat) * srcStride) \
-          DITHER_STEP(dither, store, load, d, s); \
-   } while (0)
-
-// Shortcuts to dithering loops
-#define DITHER_INT24_TO_INT16(dither, dst, dstStride, src, srcStride, len) \
-    DITHER_LOOP(dither, DITHER_TO_INT16, FROM_INT24, dst, int16Sample, dstStride, src, int24Sample, srcStride, len)
-#define DITHER_FLOAT_TO_INT16(dither, dst, dstStride, src, srcStride, len) \
-    DITHER_LOOP(dither, DITHER_TO_INT16, FROM_FLOAT, dst, int16Sample, dstStride, src, floatSample, srcStride, len)
-#define DITHER_FLOAT_TO_INT24(dither, dst, dstStride, src, srcStride, len) \
-    DITHER_LOOP(dither, DITHER_TO_INT24, FROM_FLOAT, dst, int24Sample, dstStride, src, floatSample, srcStride, len)
-
-// Implement a dither. There are only 3 cases where we must dither,
-// in all other cases, no dithering is necessary.
-#define DITHER(dither, dst, dstFormat, dstStride, src, srcFormat, srcStride, len) \
-    do { if (srcFormat == int24Sample && dstFormat == int16Sample) \
-        DITHER_INT24_TO_INT16(dither, dst, dstStride, src, srcStride, len); \
-    else if (srcFormat == floatSample && dstFormat == int16Sample) \
-        DITHER_FLOAT_TO_INT16(dither, dst, dstStride, src, srcStride, len); \
-    else if (srcFormat == floatSample && dstFormat == int24Sample) \
-        DITHER_FLOAT_TO_INT24(dither, dst, dstStride, src, srcStride, len); \
-    else { wxASSERT(false); } \
-    } while (0)
+// The vectorized loops below each return how many leading samples they
+// did, a multiple of the vector width; the caller does the rest.  They
+// give the same results as the scalar code, which rounds with lrintf,
+// because the vector conversions also use the current rounding mode.
+
+unsigned Int16ToFloat(const short *s, float *d, unsigned len)
+{
+    unsigned i = 0;
+#if defined(DITHER_SSE2)
+    const __m128 scale = _mm_set1_ps(1.0f / CONVERT_DIV16);
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        // Sign-extend to 32 bits
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(d + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(d + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(DITHER_NEON)
+    const float32x4_t scale = vdupq_n_f32(1.0f / CONVERT_DIV16);
+    for (; i + 8 <= len; i += 8) {
+        int16x8_t v = vld1q_s16(s + i);
+        vst1q_f32(d + i,
+           vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(d + i + 4,
+           vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#endif
+    return i;
+}
+
+// Also used to bring 24 bit samples into the range of 16 bit samples,
+// with a different scale
+unsigned Int24ToFloat(const int *s, float *d, unsigned len,
+                      float scale = 1.0f / CONVERT_DIV24)
+{
+    unsigned i = 0;
+#if defined(DITHER_SSE2)
+    const __m128 vScale = _mm_set1_ps(scale);
+    for (; i + 4 <= len; i += 4)
+        _mm_storeu_ps(d + i, _mm_mul_ps(
+           _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(s + i))),
+           vScale));
+#elif defined(DITHER_NEON)
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    for (; i + 4 <= len; i += 4)
+        vst1q_f32(d + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(s + i)), vScale));
+#endif
+    return i;
+}
+
+unsigned Int16ToInt24(const short *s, int *d, unsigned len)
+{
+    unsigned i = 0;
+#if defined(DITHER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        // Put each sample in the high half of 32 bits, then shift right
+        // arithmetically, to shift left by 8 preserving the sign
+        _mm_storeu_si128((__m128i*)(d + i),
+           _mm_srai_epi32(_mm_unpacklo_epi16(zero, v), 8));
+        _mm_storeu_si128((__m128i*)(d + i + 4),
+           _mm_srai_epi32(_mm_unpackhi_epi16(zero, v), 8));
+    }
+#elif defined(DITHER_NEON)
+    for (; i + 8 <= len; i += 8) {
+        int16x8_t v = vld1q_s16(s + i);
+        vst1q_s32(d + i, vshll_n_s16(vget_low_s16(v), 8));
+        vst1q_s32(d + i + 4, vshll_n_s16(vget_high_s16(v), 8));
+    }
+#endif
+    return i;
+}
+
+// Clip floats to -1...1, as FROM_FLOAT does, and multiply
+unsigned ClipAndScale(const float *s, float *d, unsigned len, float scale)
+{
+    unsigned i = 0;
+#if defined(DITHER_SSE2)
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    for (; i + 4 <= len; i += 4) {
+        // The argument order passes NaN through, as FROM_FLOAT does
+        __m128 v = _mm_loadu_ps(s + i);
+        v = _mm_max_ps(minusOne, _mm_min_ps(one, v));
+        _mm_storeu_ps(d + i, _mm_mul_ps(v, vScale));
+    }
+#elif defined(DITHER_NEON)
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t minusOne = vdupq_n_f32(-1.0f);
+    for (; i + 4 <= len; i += 4) {
+        float32x4_t v = vld1q_f32(s + i);
+        v = vmaxq_f32(minusOne, vminq_f32(one, v));
+        vst1q_f32(d + i, vmulq_f32(v, vScale));
+    }
+#endif
+    return i;
+}
+
+// Round and saturate floats already in the range of the integer format
+unsigned StoreInt16(const float *s, short *d, unsigned len)
+{
+    unsigned i = 0;
+#if defined(DITHER_SSE2)
+    for (; i + 8 <= len; i += 8) {
+        __m128i lo = _mm_cvtps_epi32(_mm_loadu_ps(s + i));
+        __m128i hi = _mm_cvtps_epi32(_mm_loadu_ps(s + i + 4));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(DITHER_NEON)
+    for (; i + 8 <= len; i += 8) {
+        int32x4_t lo = vcvtnq_s32_f32(vld1q_f32(s + i));
+        int32x4_t hi = vcvtnq_s32_f32(vld1q_f32(s + i + 4));
+        vst1q_s16(d + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    return i;
+}
 
+unsigned StoreInt24(const float *s, int *d, unsigned len)
+{
+    unsigned i = 0;
+#if defined(DITHER_SSE2)
+    // Clamping before rounding gives the same results as clamping after,
+    // and avoids overflow of the conversion.  The argument order takes NaN
+    // to the lower bound, as lrintf and STORE_INT24 do.
+    const __m128 maxBound = _mm_set1_ps(8388607.0f);
+    const __m128 minBound = _mm_set1_ps(-8388608.0f);
+    for (; i + 4 <= len; i += 4) {
+        __m128 v = _mm_loadu_ps(s + i);
+        v = _mm_max_ps(_mm_min_ps(maxBound, v), minBound);
+        _mm_storeu_si128((__m128i*)(d + i), _mm_cvtps_epi32(v));
+    }
+#elif defined(DITHER_NEON)
+    const float32x4_t maxBound = vdupq_n_f32(8388607.0f);
+    const float32x4_t minBound = vdupq_n_f32(-8388608.0f);
+    for (; i + 4 <= len; i += 4) {
+        float32x4_t v = vld1q_f32(s + i);
+        v = vmaxnmq_f32(vminq_f32(maxBound, v), minBound);
+        vst1q_s32(d + i, vcvtnq_s32_f32(v));
+    }
+#endif
+    return i;
+}
+
+// Load samples to be dithered into floats, promoted to the range of the
+// destination format
+void LoadPromoted(const char *source, sampleFormat sourceFormat,
+                  unsigned int sourceStride, sampleFormat destFormat,
+                  float *buffer, unsigned int len)
+{
+    const float scale =
+       destFormat == int16Sample ? CONVERT_DIV16 : CONVERT_DIV24;
+    unsigned int i = 0;
+    if (sourceFormat == int24Sample) {
+        const int* s = (const int*)source;
+        if (sourceStride == 1)
+            i = Int24ToFloat(s, buffer, len, scale / CONVERT_DIV24);
+        for (s += i * sourceStride; i < len; i++, s += sourceStride)
+            buffer[i] = FROM_INT24(s) * scale;
+    }
+    else {
+        const float* s = (const float*)source;
+        if (sourceStride == 1)
+            i = ClipAndScale(s, buffer, len, scale);
+        for (s += i * sourceStride; i < len; i++, s += sourceStride)
+            buffer[i] = FROM_FLOAT(s) * scale;
+    }
+}
+
+// Round and clip the dithered floats into the destination
+void StorePromoted(const float *buffer, char *dest, sampleFormat destFormat,
+                   unsigned int destStride, unsigned int len)
+{
+    unsigned int i;
+    int x;
+    if (destFormat == int16Sample) {
+        short* d = (short*)dest;
+        if (destStride == 1) {
+            i = StoreInt16(buffer, d, len);
+            for (d += i; i < len; i++, d++)
+                STORE_INT16(d, buffer[i]);
+        }
+        else {
+            // Convert contiguously, then scatter
+            short temp[BlockSize];
+            i = StoreInt16(buffer, temp, len);
+            for (; i < len; i++)
+                STORE_INT16(temp + i, buffer[i]);
+            for (i = 0; i < len; i++, d += destStride)
+                *d = temp[i];
+        }
+    }
+    else {
+        int* d = (int*)dest;
+        if (destStride == 1) {
+            i = StoreInt24(buffer, d, len);
+            for (d += i; i < len; i++, d++)
+                STORE_INT24(d, buffer[i]);
+        }
+        else {
+            int temp[BlockSize];
+            i = StoreInt24(buffer, temp, len);
+            for (; i < len; i++)
+                STORE_INT24(temp + i, buffer[i]);
+            for (i = 0; i < len; i++, d += destStride)
+                *d = temp[i];
+        }
+    }
+}
+
+// The conversions that need no dither each have a kernel, specialized at
+// compile time for the pair of formats and for the strides that matter:
+// contiguous, stereo interleaved (as captured and exported), or any other.
+// Each gives the same results as the scalar code.
+
+template< sampleFormat Format > struct SampleType;
+template<> struct SampleType< int16Sample > { using type = short; };
+template<> struct SampleType< int24Sample > { using type = int; };
+template<> struct SampleType< floatSample > { using type = float; };
+
+// Whether the conversion loses precision, so that it may be dithered
+constexpr bool Narrows(sampleFormat sourceFormat, sampleFormat destFormat)
+{
+    return destFormat != floatSample &&
+       SAMPLE_SIZE(destFormat) <= SAMPLE_SIZE(sourceFormat) &&
+       destFormat != sourceFormat;
+}
+
+// One sample at a time, for widening conversions and copies
+template< sampleFormat Src, sampleFormat Dst > struct SampleConverter;
+
+template< sampleFormat Format > struct SampleConverter< Format, Format >
+{
+    using T = typename SampleType< Format >::type;
+    static T Apply(T s) { return s; }
+};
+
+template<> struct SampleConverter< int16Sample, int24Sample >
+{
+    static int Apply(short s) { return ((int)s) << 8; }
+};
+
+template<> struct SampleConverter< int16Sample, floatSample >
+{
+    static float Apply(short s) { return FROM_INT16(&s); }
+};
+
+template<> struct SampleConverter< int24Sample, floatSample >
+{
+    static float Apply(int s) { return FROM_INT24(&s); }
+};
+
+// The leading samples of a contiguous conversion, with vector instructions;
+// returns how many were done
+template< sampleFormat Src, sampleFormat Dst > struct ContiguousConverter;
+
+template< sampleFormat Format > struct ContiguousConverter< Format, Format >
+{
+    static unsigned Apply(const char *s, char *d, unsigned len)
+    {
+        memcpy(d, s, len * SAMPLE_SIZE(Format));
+        return len;
+    }
+};
+
+template<> struct ContiguousConverter< int16Sample, int24Sample >
+{
+    static unsigned Apply(const char *s, char *d, unsigned len)
+    { return Int16ToInt24((const short*)s, (int*)d, len); }
+};
+
+template<> struct ContiguousConverter< int16Sample, floatSample >
+{
+    static unsigned Apply(const char *s, char *d, unsigned len)
+    { return Int16ToFloat((const short*)s, (float*)d, len); }
+};
+
+template<> struct ContiguousConverter< int24Sample, floatSample >
+{
+    static unsigned Apply(const char *s, char *d, unsigned len)
+    { return Int24ToFloat((const int*)s, (float*)d, len); }
+};
+
+// Narrowing conversions round and clip, which is faster through the block
+// of floats, whose loads and stores are vectorized at any stride
+template< sampleFormat Src, sampleFormat Dst >
+void ConvertSamples(std::true_type, const char *source, char *dest,
+                    unsigned int len,
+                    unsigned int sourceStride, unsigned int destStride)
+{
+    float buffer[BlockSize];
+    const auto sourceStep = SAMPLE_SIZE(Src) * sourceStride;
+    const auto destStep = SAMPLE_SIZE(Dst) * destStride;
+    while (len > 0) {
+        const auto block = std::min<unsigned int>(len, BlockSize);
+        LoadPromoted(source, Src, sourceStride, Dst, buffer, block);
+        StorePromoted(buffer, dest, Dst, destStride, block);
+        source += block * sourceStep;
+        dest += block * destStep;
+        len -= block;
+    }
+}
+
+template< sampleFormat Src, sampleFormat Dst >
+void ConvertSamples(std::false_type, const char *source, char *dest,
+                    unsigned int len,
+                    unsigned int sourceStride, unsigned int destStride)
+{
+    using S = typename SampleType< Src >::type;
+    using D = typename SampleType< Dst >::type;
+    unsigned int i = 0;
+    if (sourceStride == 1 && destStride == 1)
+        i = ContiguousConverter< Src, Dst >::Apply(source, dest, len);
+
+    const S *s = (const S*)source;
+    D *d = (D*)dest;
+    for (; i < len; i++)
+        d[i * destStride] =
+           SampleConverter< Src, Dst >::Apply(s[i * sourceStride]);
+}
+
+// A stride of 0 is given at run time; the others are constants, so that the
+// loops are specialized for them
+template< sampleFormat Src, sampleFormat Dst,
+          unsigned SrcStride, unsigned DstStride >
+void Convert(const char *source, char *dest, unsigned int len,
+             unsigned int sourceStride, unsigned int destStride)
+{
+    ConvertSamples< Src, Dst >(
+       std::integral_constant< bool, Narrows(Src, Dst) >{},
+       source, dest, len,
+       SrcStride ? SrcStride : sourceStride,
+       DstStride ? DstStride : destStride);
+}
+
+using Kernel = void (*)(const char *source, char *dest, unsigned int len,
+                        unsigned int sourceStride, unsigned int destStride);
+
+// Indexed by source stride, then destination stride:  1, 2, other
+#define CONVERSION_KERNELS(Src, Dst) { \
+    { &Convert<Src, Dst, 1, 1>, &Convert<Src, Dst, 1, 2>, \
+      &Convert<Src, Dst, 1, 0> }, \
+    { &Convert<Src, Dst, 2, 1>, &Convert<Src, Dst, 2, 2>, \
+      &Convert<Src, Dst, 2, 0> }, \
+    { &Convert<Src, Dst, 0, 1>, &Convert<Src, Dst, 0, 2>, \
+      &Convert<Src, Dst, 0, 0> } }
+
+// Indexed by source format, then destination format:  16, 24 bit, float
+const Kernel Kernels[3][3][3][3] = {
+    { CONVERSION_KERNELS(int16Sample, int16Sample),
+      CONVERSION_KERNELS(int16Sample, int24Sample),
+      CONVERSION_KERNELS(int16Sample, floatSample) },
+    { CONVERSION_KERNELS(int24Sample, int16Sample),
+      CONVERSION_KERNELS(int24Sample, int24Sample),
+      CONVERSION_KERNELS(int24Sample, floatSample) },
+    { CONVERSION_KERNELS(floatSample, int16Sample),
+      CONVERSION_KERNELS(floatSample, int24Sample),
+      CONVERSION_KERNELS(floatSample, floatSample) },
+};
+
+#undef CONVERSION_KERNELS
+
+unsigned FormatIndex(sampleFormat format)
+{
+    switch (format) {
+    case int16Sample: return 0;
+    case int24Sample: return 1;
+    default: return 2;
+    }
+}
+
+unsigned StrideIndex(unsigned int stride)
+{
+    return stride == 1 ? 0 : stride == 2 ? 1 : 2;
+}
+
+}
 
 Dither::Dither()
 {
@@ -212,13 +511,15 @@ Dither::Dither()
 
 void Dither::Reset()
 {
+    // The noise generator is not reset, so that repeated conversions do
+    // not repeat the same noise
     mTriangleState = 0;
     mPhase = 0;
     memset(mBuffer, 0, sizeof(float) * BUF_SIZE);
 }
 
-// This only decides if we must dither at all, the dithers
-// are all implemented using macros.
+// This only decides if we must dither at all; the dithers are applied
+// to blocks of floats between vectorized loads and stores.
 //
 // "source" and "dest" can contain either interleaved or non-interleaved
 // samples.  They do not have to be the same...one can be interleaved while
@@ -256,101 +557,69 @@ void Dither::Apply(enum DitherType ditherType,
     if (len == 0)
         return; // nothing to do
 
-    if (destFormat == sourceFormat)
+    if (ditherType == DitherType::none ||
+        !Narrows(sourceFormat, destFormat))
     {
-        // No need to dither, because source and destination
-        // format are the same. Just copy samples.
-        if (destStride == 1 && sourceStride == 1)
-            memcpy(dest, source, len * SAMPLE_SIZE(destFormat));
-        else
-        {
-            if (sourceFormat == floatSample)
-            {
-                float* d = (float*)dest;
-                float* s = (float*)source;
+        // Copy or convert, with the kernel for the formats and strides
+        Kernels[FormatIndex(sourceFormat)][FormatIndex(destFormat)]
+           [StrideIndex(sourceStride)][StrideIndex(destStride)]
+           ((const char *)source, (char *)dest, len,
+            sourceStride, destStride);
+    }
+    else
+    {
+        // We must do dithering
+        if (ditherType == DitherType::triangle ||
+            ditherType == DitherType::shaped)
+            Reset(); // reset dither filter for this NEW conversion
 
-                for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                    *d = *s;
-            } else
-            if (sourceFormat == int24Sample)
+        float buffer[BlockSize];
+        const char *s = (const char *)source;
+        char *d = (char *)dest;
+        const auto sourceStep = SAMPLE_SIZE(sourceFormat) * sourceStride;
+        const auto destStep = SAMPLE_SIZE(destFormat) * destStride;
+        while (len > 0) {
+            const auto block = std::min<unsigned int>(len, BlockSize);
+            LoadPromoted(s, sourceFormat, sourceStride, destFormat,
+                         buffer, block);
+
+            switch (ditherType)
             {
-                int* d = (int*)dest;
-                int* s = (int*)source;
+            case DitherType::none:
+                break;
+            case DitherType::rectangle:
+                for (i = 0; i < block; i++)
+                    buffer[i] = RectangleDither(buffer[i]);
+                break;
+            case DitherType::triangle:
+                for (i = 0; i < block; i++)
+                    buffer[i] = TriangleDither(buffer[i]);
+                break;
+            case DitherType::shaped:
+                for (i = 0; i < block; i++)
+                    buffer[i] = ShapedDither(buffer[i]);
+                break;
+            default:
+                wxASSERT(false); // unknown dither algorithm
+            }
 
-                for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                    *d = *s;
-            } else
-            if (sourceFormat == int16Sample)
-            {
-                short* d = (short*)dest;
-                short* s = (short*)source;
+            StorePromoted(buffer, d, destFormat, destStride, block);
 
-                for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                    *d = *s;
-            } else {
-                wxASSERT(false); // source format unknown
-            }
-        }
-    } else
-    if (destFormat == floatSample)
-    {
-        // No need to dither, just convert samples to float.
-        // No clipping should be necessary.
-        float* d = (float*)dest;
-
-        if (sourceFormat == int16Sample)
-        {
-            short* s = (short*)source;
-            for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                *d = FROM_INT16(s);
-        } else
-        if (sourceFormat == int24Sample)
-        {
-            int* s = (int*)source;
-            for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                *d = FROM_INT24(s);
-        } else {
-            wxASSERT(false); // source format unknown
-        }
-    } else
-    if (destFormat == int24Sample && sourceFormat == int16Sample)
-    {
-        // Special case when promoting 16 bit to 24 bit
-        int* d = (int*)dest;
-        short* s = (short*)source;
-        for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-            *d = ((int)*s) << 8;
-    } else
-    {
-        // We must do dithering
-        switch (ditherType)
-        {
-        case DitherType::none:
-            DITHER(NoDither, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::rectangle:
-            DITHER(RectangleDither, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::triangle:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(TriangleDither, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::shaped:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(ShapedDither, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        default:
-            wxASSERT(false); // unknown dither algorithm
+            s += block * sourceStep;
+            d += block * destStep;
+            len -= block;
         }
     }
 }
 
 // Dither implementations
 
-// No dither, just return sample
-inline float Dither::NoDither(float sample)
+// Uniform white noise in -0.5...0.5.  This is much faster than rand(),
+// which may take a lock, and has none of the correlations of the low bits
+// of a linear congruential generator.
+inline float Dither::Noise()
 {
-    return sample;
+    return mRandom.NextFloat(-0.5f, 0.5f);
 }
 
 // Rectangle dithering, apply one-step noise
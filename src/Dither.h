@@ -11,6 +11,7 @@
 #define __AUDACITY_DITHER_H__
 
 #include "SampleFormat.h"
+#include "FastRandom.h"
 
 
 /// These ditherers are currently available:
@@ -39,7 +40,7 @@ public:
 
 private:
     // Dither methods
-    float NoDither(float sample);
+    float Noise();
     float RectangleDither(float sample);
     float TriangleDither(float sample);
     float ShapedDither(float sample);
@@ -53,6 +54,7 @@ private:
     int mPhase;
     float mTriangleState;
     float mBuffer[8 /* = BUF_SIZE */];
+    FastRandom mRandom;
 };
 
 #endif /* __AUDACITY_DITHER_H__ */
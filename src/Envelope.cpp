@@ -100,6 +100,7 @@ bool Envelope::ConsistencyCheck()
          std::stable_sort( mEnv.begin(), mEnv.end(),
             []( const EnvPoint &a, const EnvPoint &b )
                { return a.GetT() < b.GetT(); } );
+         Changed();
       }
    } while ( disorder );
 
@@ -128,7 +129,7 @@ void Envelope::RescaleValues(double minValue, double maxValue)
       factor = (mEnv[i].GetVal() - oldMinValue) / (oldMaxValue - oldMinValue);
       mEnv[i].SetVal( this, mMinValue + (mMaxValue - mMinValue) * factor );
    }
-
+   Changed();
 }
 
 /// Flatten removes all points from the envelope to
@@ -138,6 +139,7 @@ void Envelope::Flatten(double value)
 {
    mEnv.clear();
    mDefaultValue = ClampValue(value);
+   Changed();
 }
 
 void Envelope::SetDragPoint(int dragPoint)
@@ -150,6 +152,8 @@ void Envelope::SetDragPointValid(bool valid)
 {
    mDragPointValid = (valid && mDragPoint >= 0);
    if (mDragPoint >= 0 && !valid) {
+      Changed();
+
       // We're going to be deleting the point; On
       // screen we show this by having the envelope move to
       // the position it will have after deletion of the point.
@@ -207,6 +211,7 @@ void Envelope::MoveDragPoint(double newWhen, double value)
    // points share a time value.
    dragPoint.SetT(tt);
    dragPoint.SetVal( this, value );
+   Changed();
 }
 
 void Envelope::ClearDragPoint()
@@ -224,6 +229,7 @@ void Envelope::SetRange(double minValue, double maxValue) {
    mDefaultValue = ClampValue(mDefaultValue);
    for( unsigned int i = 0; i < mEnv.size(); i++ )
       mEnv[i].SetVal( this, mEnv[i].GetVal() ); // this clamps the value to the NEW range
+   Changed();
 }
 
 // This is used only during construction of an Envelope by complete or partial
@@ -243,6 +249,7 @@ void Envelope::AddPointAtEnd( double t, double val )
       mEnv.erase( mEnv.begin() + nn - 1 );
       --nn;
    }
+   Changed();
 }
 
 Envelope::Envelope(const Envelope &orig, double t0, double t1)
@@ -270,6 +277,25 @@ Envelope::Envelope(const Envelope &orig)
    CopyRange(orig, 0, orig.GetNumberOfPoints());
 }
 
+bool Envelope::IsEquivalent(const Envelope &other) const
+{
+   if (mDB != other.mDB ||
+       mMinValue != other.mMinValue ||
+       mMaxValue != other.mMaxValue ||
+       mDefaultValue != other.mDefaultValue ||
+       mOffset != other.mOffset ||
+       mTrackLen != other.mTrackLen ||
+       mEnv.size() != other.mEnv.size())
+      return false;
+
+   for (size_t ii = 0, nn = mEnv.size(); ii < nn; ++ii)
+      if (mEnv[ii].GetT() != other.mEnv[ii].GetT() ||
+          mEnv[ii].GetVal() != other.mEnv[ii].GetVal())
+         return false;
+
+   return true;
+}
+
 void Envelope::CopyRange(const Envelope &orig, size_t begin, size_t end)
 {
    size_t len = orig.mEnv.size();
@@ -412,6 +438,7 @@ bool Envelope::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
 
    mEnv.clear();
    mEnv.reserve(numPoints);
+   Changed();
    return true;
 }
 
@@ -420,7 +447,9 @@ XMLTagHandler *Envelope::HandleXMLChild(const wxChar *tag)
    if (wxStrcmp(tag, wxT("controlpoint")))
       return NULL;
 
+   // The point is read after this returns, but before any query
    mEnv.push_back( EnvPoint{} );
+   Changed();
    return &mEnv.back();
 }
 
@@ -648,11 +677,13 @@ bool EnvelopeEditor::HandleMouseButtonUp()
 void Envelope::Delete( int point )
 {
    mEnv.erase(mEnv.begin() + point);
+   Changed();
 }
 
 void Envelope::Insert(int point, const EnvPoint &p)
 {
    mEnv.insert(mEnv.begin() + point, p);
+   Changed();
 }
 
 // Returns true if parent needs to be redrawn
@@ -739,6 +770,7 @@ void Envelope::CollapseRegion( double t0, double t1, double sampleDur )
       else
          point.SetT( point.GetT() - (t1 - t0) );
    }
+   Changed();
 
    // See if the discontinuity is removable.
    if ( rightPoint )
@@ -814,6 +846,7 @@ void Envelope::Paste( double t0, const Envelope *e, double sampleDur )
       auto &point = mEnv[ index ];
       point.SetT( point.GetT() + otherOffset + t0 );
    }
+   Changed();
 
    // Treat removable discontinuities
    // Right edge outward:
@@ -921,6 +954,7 @@ std::pair< int, int > Envelope::ExpandRegion
       auto &point = mEnv[ ii ];
       point.SetT( point.GetT() + tlen );
    }
+   Changed();
 
    mTrackLen += tlen;
    
@@ -973,6 +1007,7 @@ int Envelope::Reassign(double when, double value)
       return -1;
 
    mEnv[i].SetVal( this, value );
+   Changed();
    return 0;
 }
 
@@ -1034,10 +1069,12 @@ int Envelope::InsertOrReplaceRelative(double when, double value)
    auto range = EqualRange( when, 0 );
    int index = range.first;
 
-   if ( index < range.second )
+   if ( index < range.second ) {
       // modify existing
       // In case of a discontinuity, ALWAYS CHANGING LEFT LIMIT ONLY!
       mEnv[ index ].SetVal( this, value );
+      Changed();
+   }
    else
      // Add NEW
       Insert( index, EnvPoint { when, value } );
@@ -1090,6 +1127,7 @@ void Envelope::SetTrackLen( double trackLen, double sampleDur )
    // If more than one point already at the end, keep only the first of them.
    int newLen = std::min( 1 + range.first, range.second );
    mEnv.resize( newLen );
+   Changed();
 
    if ( needPoint )
       AddPointAtEnd( mTrackLen, value );
@@ -1108,6 +1146,7 @@ void Envelope::RescaleTimes( double newLength )
          point.SetT( point.GetT() * ratio );
    }
    mTrackLen = newLength;
+   Changed();
 }
 
 // Accessors
@@ -1219,120 +1258,197 @@ void Envelope::GetValues( double *buffer, int bufferLen,
    GetValuesRelative( buffer, bufferLen, t0, tstep);
 }
 
-void Envelope::GetValuesRelative
-   (double *buffer, int bufferLen, double t0, double tstep, bool leftLimit)
+void Envelope::GetValues( float *buffer, int bufferLen,
+                          double t0, double tstep ) const
+{
+   t0 -= mOffset;
+   GetValuesRelative( buffer, bufferLen, t0, tstep);
+}
+
+template< typename Value > void Envelope::GetValuesRelative
+   (Value *buffer, int bufferLen, double t0, double tstep, bool leftLimit)
    const
 {
    // JC: If bufferLen ==0 we have probably just allocated a zero sized buffer.
    // wxASSERT( bufferLen > 0 );
 
-   const auto epsilon = tstep / 2;
-   int len = mEnv.size();
-
-   double t = t0;
-   double increment = 0;
-   if ( len > 1 && t <= mEnv[0].GetT() && mEnv[0].GetT() == mEnv[1].GetT() )
-      increment = leftLimit ? -epsilon : epsilon;
-
-   double tprev, vprev, tnext = 0, vnext, vstep = 0;
-
-   for (int b = 0; b < bufferLen; b++) {
-
-      // Get easiest cases out the way first...
-      // IF empty envelope THEN default value
-      if (len <= 0) {
-         buffer[b] = mDefaultValue;
-         t += tstep;
-         continue;
-      }
+   EnvelopeCursor cursor{
+      *this, t0, tstep, leftLimit, EnvelopeCursor::RelativeTime{} };
+   for (int b = 0; b < bufferLen;) {
+      const auto ramp = cursor.Next(bufferLen - b);
+      ramp.Fill(buffer + b);
+      b += ramp.length;
+   }
+}
 
-      auto tplus = t + increment;
+EnvelopeCursor::EnvelopeCursor(
+   const Envelope &envelope, double t0, double tstep)
+   : EnvelopeCursor{
+      envelope, t0 - envelope.mOffset, tstep, false, RelativeTime{} }
+{
+}
+
+EnvelopeCursor::EnvelopeCursor(const Envelope &envelope,
+   double t0, double tstep, bool leftLimit, RelativeTime)
+   : mEnvelope{ envelope }
+   , mT0{ t0 }
+   , mTStep{ tstep }
+   , mLeftLimit{ leftLimit }
+{
+   const auto &env = mEnvelope.mEnv;
+   if ( env.size() > 1 && t0 <= env[0].GetT() &&
+        env[0].GetT() == env[1].GetT() )
+      mIncrement = leftLimit ? -tstep / 2 : tstep / 2;
+}
+
+// The number of samples, from the one at offset from the current one, up to
+// maxLength of them, whose times are before limit
+size_t EnvelopeCursor::CountBefore(
+   size_t from, size_t maxLength, double limit) const
+{
+   const auto first = mSample + from;
+   auto before = [&](size_t ii)
+      { return Before(Time(first + ii) + mIncrement, limit); };
+   if ( maxLength == 0 )
+      return 0;
+   if ( !(mTStep > 0) )
+      return before(0) ? maxLength : 0;
+
+   // Estimate, then correct for roundoff
+   const double estimate =
+      ceil((limit - mIncrement - Time(first)) / mTStep);
+   size_t count = !(estimate > 0) ? 0
+      : estimate >= maxLength ? maxLength : size_t(estimate);
+   while (count > 0 && !before(count - 1))
+      --count;
+   while (count < maxLength && before(count))
+      ++count;
+   return count;
+}
+
+void EnvelopeCursor::FindSegment(double tplus)
+{
+   const auto &env = mEnvelope.mEnv;
+   const int len = env.size();
+
+   // Find the last point at or before tplus (before it, for the left
+   // limit), searching onward from the last segment.  Gallop, so that
+   // far jumps over many points take few comparisons.
+   auto atOrBefore = [&](int index)
+      { return !Before(tplus, env[index].GetT()); };
+   int lo = std::min(mLo, len - 1);
+   if (!atOrBefore(lo))
+      lo = 0;
+   int hi = lo + 1;
+   for (int stride = 2; hi < len && atOrBefore(hi); stride *= 2) {
+      lo = hi;
+      hi = std::min(len, lo + stride);
+   }
+   while (hi > lo + 1) {
+      int mid = (lo + hi) / 2;
+      if (atOrBefore(mid))
+         lo = mid;
+      else
+         hi = mid;
+   }
+   // mEnv[0] is before tplus because of eliminations in Next, therefore
+   // lo >= 0; mEnv[len - 1] is after tplus, therefore hi <= len - 1
+   wxASSERT( lo >= 0 && hi <= len - 1 );
+   mLo = lo;
+
+   const double tprev = env[lo].GetT();
+   mTNext = env[hi].GetT();
+
+   if ( hi + 1 < len && mTNext == env[ hi + 1 ].GetT() )
+      // There is a discontinuity after this point-to-point interval.
+      // Usually will stop evaluating in this interval when time is slightly
+      // before tNext, then use the right limit.
+      // This is the right intent
+      // in case small roundoff errors cause a sample time to be a little
+      // before the envelope point time.
+      // Less commonly we want a left limit, so we continue evaluating in
+      // this interval until shortly after the discontinuity.
+      mIncrement = mLeftLimit ? -mTStep / 2 : mTStep / 2;
+   else
+      mIncrement = 0;
+
+   const double vprev = mEnvelope.GetInterpolationStartValueAtPoint( lo );
+   const double vnext = mEnvelope.GetInterpolationStartValueAtPoint( hi );
+
+   // Interpolate, either linear or log depending on mDB.
+   const double dt = mTNext - tprev;
+   const double to = Time(mSample) - tprev;
+   double v, vstep;
+   if (dt > 0.0) {
+      v = (vprev * (dt - to) + vnext * to) / dt;
+      vstep = (vnext - vprev) * mTStep / dt;
+   }
+   else {
+      v = vnext;
+      vstep = 0.0;
+   }
 
-      // IF before envelope THEN first value
-      if ( leftLimit ? tplus <= mEnv[0].GetT() : tplus < mEnv[0].GetT() ) {
-         buffer[b] = mEnv[0].GetVal();
-         t += tstep;
-         continue;
-      }
-      // IF after envelope THEN last value
-      if ( leftLimit
-            ? tplus > mEnv[len - 1].GetT() : tplus >= mEnv[len - 1].GetT() ) {
-         buffer[b] = mEnv[len - 1].GetVal();
-         t += tstep;
-         continue;
-      }
+   // An adjustment if logarithmic scale.
+   if ( mEnvelope.mDB ) {
+      v = pow(10.0, v);
+      vstep = pow(10.0, vstep);
+   }
 
-      // be careful to get the correct limit even in case epsilon == 0
-      if ( b == 0 ||
-           ( leftLimit ? tplus > tnext : tplus >= tnext ) ) {
+   mInSegment = true;
+   mSegmentStart = mSample;
+   mSegmentValue = v;
+   mSegmentStep = vstep;
+}
 
-         // We're beyond our tnext, so find the next one.
-         // Don't just increment lo or hi because we might
-         // be zoomed far out and that could be a large number of
-         // points to move over.  That's why we binary search.
+EnvelopeCursor::Ramp EnvelopeCursor::Next(size_t maxLength)
+{
+   const auto &env = mEnvelope.mEnv;
+   const bool exponential = mEnvelope.mDB;
+   Ramp ramp{ 0.0, exponential ? 1.0 : 0.0, exponential, maxLength };
+   if (maxLength == 0)
+      return ramp;
 
-         int lo,hi;
-         if ( leftLimit )
-            BinarySearchForTime_LeftLimit( lo, hi, tplus );
-         else
-            BinarySearchForTime( lo, hi, tplus );
-
-         // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
-         // mEnv[len - 1] is after tplus, therefore hi <= len - 1
-         wxASSERT( lo >= 0 && hi <= len - 1 );
-
-         tprev = mEnv[lo].GetT();
-         tnext = mEnv[hi].GetT();
-
-         if ( hi + 1 < len && tnext == mEnv[ hi + 1 ].GetT() )
-            // There is a discontinuity after this point-to-point interval.
-            // Usually will stop evaluating in this interval when time is slightly
-            // before tNext, then use the right limit.
-            // This is the right intent
-            // in case small roundoff errors cause a sample time to be a little
-            // before the envelope point time.
-            // Less commonly we want a left limit, so we continue evaluating in
-            // this interval until shortly after the discontinuity.
-            increment = leftLimit ? -epsilon : epsilon;
-         else
-            increment = 0;
+   // IF empty envelope THEN default value
+   const int len = env.size();
+   if (len <= 0) {
+      ramp.value = mEnvelope.mDefaultValue;
+      mSample += maxLength;
+      return ramp;
+   }
 
-         vprev = GetInterpolationStartValueAtPoint( lo );
-         vnext = GetInterpolationStartValueAtPoint( hi );
+   const auto tplus = Time(mSample) + mIncrement;
 
-         // Interpolate, either linear or log depending on mDB.
-         double dt = (tnext - tprev);
-         double to = t - tprev;
-         double v;
-         if (dt > 0.0)
-         {
-            v = (vprev * (dt - to) + vnext * to) / dt;
-            vstep = (vnext - vprev) * tstep / dt;
-         }
-         else
-         {
-            v = vnext;
-            vstep = 0.0;
-         }
-
-         // An adjustment if logarithmic scale.
-         if( mDB )
-         {
-            v = pow(10.0, v);
-            vstep = pow( 10.0, vstep );
-         }
+   // IF before envelope THEN first value
+   if ( Before(tplus, env[0].GetT()) ) {
+      ramp.value = env[0].GetVal();
+      ramp.length =
+         std::max<size_t>(1, CountBefore(0, maxLength, env[0].GetT()));
+      mSample += ramp.length;
+      return ramp;
+   }
+   // IF after envelope THEN last value, and so for all that follow
+   if ( !Before(tplus, env[len - 1].GetT()) ) {
+      ramp.value = env[len - 1].GetVal();
+      mSample += maxLength;
+      return ramp;
+   }
 
-         buffer[b] = v;
-      } else {
-         if (mDB){
-            buffer[b] = buffer[b - 1] * vstep;
-         }else{
-            buffer[b] = buffer[b - 1] + vstep;
-         }
-      }
+   // be careful to get the correct limit even in case epsilon == 0
+   if ( !mInSegment || !Before(tplus, mTNext) )
+      FindSegment(tplus);
 
-      t += tstep;
-   }
+   // The sample that found the segment is in it, whatever the increment
+   // now is
+   const auto offset = mSample - mSegmentStart;
+   ramp.length = offset == 0
+      ? 1 + CountBefore(1, maxLength - 1, mTNext)
+      : std::max<size_t>(1, CountBefore(0, maxLength, mTNext));
+   ramp.step = mSegmentStep;
+   ramp.value = offset == 0 ? mSegmentValue
+      : exponential ? mSegmentValue * pow(mSegmentStep, double(offset))
+      : mSegmentValue + offset * mSegmentStep;
+   mSample += ramp.length;
+   return ramp;
 }
 
 void Envelope::GetValues
@@ -1559,13 +1675,13 @@ double Envelope::Integral( double t0, double t1 ) const
    }
 }
 
-double Envelope::IntegralOfInverse( double t0, double t1 ) const
+double Envelope::IntegralOfInverseByWalking( double t0, double t1 ) const
 {
    if(t0 == t1)
       return 0.0;
    if(t0 > t1)
    {
-      return -IntegralOfInverse(t1, t0); // this makes more sense than returning the default value
+      return -IntegralOfInverseByWalking(t1, t0); // this makes more sense than returning the default value
    }
 
    unsigned int count = mEnv.size();
@@ -1622,7 +1738,7 @@ double Envelope::IntegralOfInverse( double t0, double t1 ) const
    }
 }
 
-double Envelope::SolveIntegralOfInverse( double t0, double area ) const
+double Envelope::SolveIntegralOfInverseByWalking( double t0, double area ) const
 {
    if(area == 0.0)
       return t0;
@@ -1725,6 +1841,87 @@ double Envelope::SolveIntegralOfInverse( double t0, double area ) const
    }();
 }
 
+void Envelope::UpdateInverseIntegrals() const
+{
+   const auto changes = mChanges.load();
+   if (mIntegralsChanges == changes)
+      return;
+
+   const auto count = mEnv.size();
+   mInverseIntegrals.resize(count);
+   double total = 0.0;
+   for (size_t i = 0; i < count; ++i) {
+      if (i > 0)
+         total += IntegrateInverseInterpolated(mEnv[i - 1].GetVal(), mEnv[i].GetVal(), mEnv[i].GetT() - mEnv[i - 1].GetT(), mDB);
+      mInverseIntegrals[i] = total;
+   }
+   // A change made while this ran leaves the table out of date
+   mIntegralsChanges = changes;
+}
+
+double Envelope::InverseIntegralAt( double t ) const
+{
+   const auto count = mEnv.size();
+   const auto &first = mEnv[0];
+   const auto &last = mEnv[count - 1];
+   if(t < first.GetT()) // preceding the first point
+      return (t - first.GetT()) / first.GetVal();
+   if(t >= last.GetT()) // at or following the last point
+      return mInverseIntegrals[count - 1] + (t - last.GetT()) / last.GetVal();
+
+   int lo, hi;
+   BinarySearchForTime(lo, hi, t);
+   const auto &point0 = mEnv[lo], &point1 = mEnv[hi];
+   const double val = InterpolatePoints(point0.GetVal(), point1.GetVal(), (t - point0.GetT()) / (point1.GetT() - point0.GetT()), mDB);
+   return mInverseIntegrals[lo] + IntegrateInverseInterpolated(point0.GetVal(), val, t - point0.GetT(), mDB);
+}
+
+double Envelope::IntegralOfInverse( double t0, double t1 ) const
+{
+   if(t0 == t1)
+      return 0.0;
+   if(mEnv.empty()) // 'empty' envelope
+      return (t1 - t0) / mDefaultValue;
+
+   std::unique_lock<std::mutex> lock{ mIntegralsMutex, std::try_to_lock };
+   if (!lock.owns_lock())
+      return IntegralOfInverseByWalking(t0, t1);
+
+   UpdateInverseIntegrals();
+   return InverseIntegralAt(t1 - mOffset) - InverseIntegralAt(t0 - mOffset);
+}
+
+double Envelope::SolveIntegralOfInverse( double t0, double area ) const
+{
+   if(area == 0.0)
+      return t0;
+   const auto count = mEnv.size();
+   if(count == 0) // 'empty' envelope
+      return t0 + area * mDefaultValue;
+
+   std::unique_lock<std::mutex> lock{ mIntegralsMutex, std::try_to_lock };
+   if (!lock.owns_lock())
+      return SolveIntegralOfInverseByWalking(t0, area);
+
+   UpdateInverseIntegrals();
+   // The integral from the first point to the answer
+   const double target = InverseIntegralAt(t0 - mOffset) + area;
+   const auto &first = mEnv[0];
+   const auto &last = mEnv[count - 1];
+   if(target < 0.0) // preceding the first point
+      return mOffset + first.GetT() + target * first.GetVal();
+   if(target >= mInverseIntegrals[count - 1]) // following the last point
+      return mOffset + last.GetT() +
+         (target - mInverseIntegrals[count - 1]) * last.GetVal();
+
+   // Find the segment, which has nonzero length, because the integrals
+   // at its ends differ
+   const auto i = std::upper_bound(mInverseIntegrals.begin(),
+      mInverseIntegrals.end(), target) - mInverseIntegrals.begin() - 1;
+   const auto &point0 = mEnv[i], &point1 = mEnv[i + 1];
+   return mOffset + point0.GetT() + SolveIntegrateInverseInterpolated(point0.GetVal(), point1.GetVal(), point1.GetT() - point0.GetT(), target - mInverseIntegrals[i], mDB);
+}
+
 void Envelope::print() const
 {
    for( unsigned int i = 0; i < mEnv.size(); i++ )
@@ -13,6 +13,8 @@
 
 #include <stdlib.h>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include <wx/brush.h>
@@ -20,6 +22,7 @@
 
 #include "xml/XMLTagHandler.h"
 #include "Internat.h"
+#include "MemoryUse.h"
 
 class wxRect;
 class wxDC;
@@ -71,7 +74,8 @@ private:
 
 };
 
-typedef std::vector<EnvPoint> EnvArray;
+typedef std::vector<EnvPoint,
+   MemoryUse::Allocator<EnvPoint, MemoryUse::Envelopes>> EnvArray;
 struct TrackPanelDrawingContext;
 
 class Envelope final : public XMLTagHandler {
@@ -92,11 +96,15 @@ public:
    // and repaired
    bool ConsistencyCheck();
 
+   // Whether the other has the same points and settings, so that it
+   // gives the same values everywhere
+   bool IsEquivalent(const Envelope &other) const;
+
    double GetOffset() const { return mOffset; }
    double GetTrackLen() const { return mTrackLen; }
 
    bool GetExponential() const { return mDB; }
-   void SetExponential(bool db) { mDB = db; }
+   void SetExponential(bool db) { mDB = db; Changed(); }
 
    void Flatten(double value);
 
@@ -150,6 +158,8 @@ public:
     * This is much faster than calling GetValue() multiple times if you need
     * more than one value in a row. */
    void GetValues(double *buffer, int len, double t0, double tstep) const;
+   /** \brief The same, computed in double precision but stored as float */
+   void GetValues(float *buffer, int len, double t0, double tstep) const;
 
    /** \brief Get many envelope points for pixel columns at once,
     * but don't assume uniform time per pixel.
@@ -170,8 +180,8 @@ private:
       ( size_t startAt, bool rightward, bool testNeighbors = true );
 
    double GetValueRelative(double t, bool leftLimit = false) const;
-   void GetValuesRelative
-      (double *buffer, int len, double t0, double tstep, bool leftLimit = false)
+   template< typename Value > void GetValuesRelative
+      (Value *buffer, int len, double t0, double tstep, bool leftLimit = false)
       const;
    // relative time
    int NumberOfPointsAfter(double t) const;
@@ -212,6 +222,7 @@ private:
    int InsertOrReplaceRelative(double when, double value);
 
    friend class EnvelopeEditor;
+   friend class EnvelopeCursor;
    /** \brief Accessor for points */
    const EnvPoint &operator[] (int index) const
    {
@@ -248,6 +259,16 @@ private:
    void BinarySearchForTime_LeftLimit( int &Lo, int &Hi, double t ) const;
    double GetInterpolationStartValueAtPoint( int iPoint ) const;
 
+   // Every change of the points, or of the interpolation, must call this,
+   // so that the table of integrals is rebuilt
+   void Changed() { ++mChanges; }
+   double IntegralOfInverseByWalking( double t0, double t1 ) const;
+   double SolveIntegralOfInverseByWalking( double t0, double area ) const;
+   // Call only with mIntegralsMutex held
+   void UpdateInverseIntegrals() const;
+   // relative time; call only with the table up to date
+   double InverseIntegralAt( double t ) const;
+
    // The list of envelope control points.
    EnvArray mEnv;
 
@@ -271,6 +292,17 @@ private:
    int mDragPoint { -1 };
 
    mutable int mSearchGuess { -2 };
+
+   // The integral of the inverse from the first point to each point, so
+   // that time warping need not walk all the points before t0.  It is
+   // rebuilt on the first query after a change, by whichever thread asks;
+   // a thread that finds another rebuilding it walks the points instead,
+   // so that the audio callback never waits.
+   std::atomic<unsigned> mChanges { 1 };
+   mutable unsigned mIntegralsChanges { 0 };
+   mutable std::vector<double> mInverseIntegrals;
+   mutable std::mutex mIntegralsMutex;
+
    friend class GetInfoCommand;
    friend class SetEnvelopeCommand;
 };
@@ -282,6 +314,99 @@ inline void EnvPoint::SetVal( Envelope *pEnvelope, double val )
    mVal = val;
 }
 
+/// \brief Walks an envelope at evenly spaced times, a ramp at a time.
+///
+/// Between two points the values of a linear envelope add a constant step
+/// from one sample to the next, and those of an exponential one multiply by
+/// a constant factor, so a buffer is filled a ramp at a time with no search
+/// for each sample.  Points are sought only onward from the cursor's own
+/// place, so any number of cursors may walk one envelope at once.
+class EnvelopeCursor
+{
+public:
+   struct Ramp
+   {
+      /// The first value
+      double value;
+      /// Added to each value for the next, or multiplies it if exponential
+      double step;
+      bool exponential;
+      size_t length;
+
+      /// Writes the length values of the ramp
+      template< typename Value > void Fill(Value *buffer) const;
+   };
+
+   /// t0 is absolute time
+   EnvelopeCursor(const Envelope &envelope, double t0, double tstep);
+
+   /// The ramp of up to maxLength values at the cursor, moving past it.
+   /// Its length is at least one, if maxLength is.
+   Ramp Next(size_t maxLength);
+
+private:
+   friend class Envelope;
+   struct RelativeTime {};
+   EnvelopeCursor(const Envelope &envelope, double t0, double tstep,
+      bool leftLimit, RelativeTime);
+
+   double Time(size_t sample) const { return mT0 + sample * mTStep; }
+   bool Before(double tplus, double limit) const
+   { return mLeftLimit ? tplus <= limit : tplus < limit; }
+   size_t CountBefore(size_t from, size_t maxLength, double limit) const;
+   void FindSegment(double tplus);
+
+   const Envelope &mEnvelope;
+   const double mT0;
+   const double mTStep;
+   const bool mLeftLimit;
+
+   // Samples passed
+   size_t mSample{ 0 };
+   // Added to sample times when comparing with point times, near
+   // discontinuities
+   double mIncrement{ 0 };
+
+   // The point starting the segment, and whether there is a segment yet
+   int mLo{ 0 };
+   bool mInSegment{ false };
+   double mTNext{ 0 };
+   // The first sample in the segment, its value, and the step
+   size_t mSegmentStart{ 0 };
+   double mSegmentValue{ 0 };
+   double mSegmentStep{ 0 };
+};
+
+template< typename Value >
+void EnvelopeCursor::Ramp::Fill(Value *buffer) const
+{
+   // Each value is found from the first, so that the loop carries nothing
+   // from one value to the next
+   if (!exponential) {
+      for (size_t i = 0; i < length; i++)
+         buffer[i] = value + i * step;
+      return;
+   }
+
+   // The geometric series in lanes, each multiplying by step to the power
+   // of the number of lanes
+   const size_t Lanes = 8;
+   double lanes[Lanes];
+   double factor = 1.0;
+   for (size_t j = 0; j < Lanes; j++) {
+      lanes[j] = value * factor;
+      factor *= step;
+   }
+   size_t i = 0;
+   for (; i + Lanes <= length; i += Lanes)
+      for (size_t j = 0; j < Lanes; j++) {
+         buffer[i + j] = lanes[j];
+         lanes[j] *= factor;
+      }
+   for (size_t j = 0; i < length; i++, j++)
+      buffer[i] = lanes[j];
+}
+
 // A class that holds state for the duration of dragging
 // of an envelope point.
 class EnvelopeEditor
@@ -128,9 +128,14 @@
 // have not been fully imported in builds without FLAC support, so disabled for
 // 2.0 release
 //#define EXPERIMENTAL_OD_FLAC
-// similarly for FFmpeg:
-// Won't build on Fedora 17 or Windows VC++, per http://bugzilla.audacityteam.org/show_bug.cgi?id=539.
-//#define EXPERIMENTAL_OD_FFMPEG 1
+// On-demand importing for FFmpeg, when the library preference is set.  Each
+// stream is decoded by a task of its own, and each decoder opens the file for
+// itself, so the decoders no longer share the importer's contexts.
+#define EXPERIMENTAL_OD_FFMPEG 1
+// Use on-demand importing for MP3 and Ogg Vorbis.  MP3 frames are indexed
+// in one scan of the headers; Ogg uses libvorbisfile's seeking.
+#define EXPERIMENTAL_OD_MP3
+#define EXPERIMENTAL_OD_OGG
 
 // Paul Licameli (PRL) 5 Oct 2014
 #define EXPERIMENTAL_SPECTRAL_EDITING
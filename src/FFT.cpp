@@ -50,11 +50,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <mutex>
 
 #include "RealFFTf.h"
 #include "Experimental.h"
 
 static ArraysOf<int> gFFTBitTable;
+static std::mutex gFFTBitTableMutex;
 static const size_t MaxFastBits = 16;
 
 /* Declare Static functions */
@@ -142,8 +144,12 @@ void FFT(size_t NumSamples,
       exit(1);
    }
 
-   if (!gFFTBitTable)
-      InitFFT();
+   {
+      // FFT may be called on several threads at once
+      std::lock_guard<std::mutex> lock{ gFFTBitTableMutex };
+      if (!gFFTBitTable)
+         InitFFT();
+   }
 
    if (!InverseTransform)
       angle_numerator = -angle_numerator;
@@ -0,0 +1,204 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FastRandom.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "FastRandom.h"
+
+// As in Dither.cpp, no run time test is needed for either
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FAST_RANDOM_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define FAST_RANDOM_NEON
+#include <arm_neon.h>
+#endif
+
+constexpr float FastRandom::Unit;
+
+void FastRandom::Seed( uint64_t seed )
+{
+   // Each word of the state from splitmix64, which never makes them all zero
+   // for the four words of a lane
+   const auto next = [&seed]{
+      uint64_t z = ( seed += 0x9E3779B97F4A7C15ull );
+      z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+      z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+      return uint32_t( ( z ^ ( z >> 31 ) ) >> 32 );
+   };
+   for ( unsigned ll = 0; ll < Lanes; ++ll ) {
+      mS0[ ll ] = next();
+      mS1[ ll ] = next();
+      mS2[ ll ] = next();
+      mS3[ ll ] = next();
+   }
+   mCached = Lanes;
+}
+
+size_t FastRandom::Drain( uint32_t *buffer, size_t len )
+{
+   size_t ii = 0;
+   for ( ; ii < len && mCached < Lanes; ++ii )
+      buffer[ ii ] = mCache[ mCached++ ];
+   return ii;
+}
+
+namespace {
+
+#if defined(FAST_RANDOM_SSE2)
+
+   struct State
+   {
+      __m128i s0, s1, s2, s3;
+
+      State( const uint32_t *p0, const uint32_t *p1,
+             const uint32_t *p2, const uint32_t *p3 )
+         : s0{ _mm_loadu_si128( (const __m128i*)p0 ) }
+         , s1{ _mm_loadu_si128( (const __m128i*)p1 ) }
+         , s2{ _mm_loadu_si128( (const __m128i*)p2 ) }
+         , s3{ _mm_loadu_si128( (const __m128i*)p3 ) }
+      {}
+
+      void Store( uint32_t *p0, uint32_t *p1, uint32_t *p2, uint32_t *p3 )
+      {
+         _mm_storeu_si128( (__m128i*)p0, s0 );
+         _mm_storeu_si128( (__m128i*)p1, s1 );
+         _mm_storeu_si128( (__m128i*)p2, s2 );
+         _mm_storeu_si128( (__m128i*)p3, s3 );
+      }
+
+      // The same as FastRandom::Step, in all lanes at once
+      __m128i Step()
+      {
+         const __m128i result = _mm_add_epi32( s0, s3 );
+         const __m128i t = _mm_slli_epi32( s1, 9 );
+         s2 = _mm_xor_si128( s2, s0 );
+         s3 = _mm_xor_si128( s3, s1 );
+         s1 = _mm_xor_si128( s1, s2 );
+         s0 = _mm_xor_si128( s0, s3 );
+         s2 = _mm_xor_si128( s2, t );
+         s3 = _mm_or_si128( _mm_slli_epi32( s3, 11 ), _mm_srli_epi32( s3, 21 ) );
+         return result;
+      }
+   };
+
+#elif defined(FAST_RANDOM_NEON)
+
+   struct State
+   {
+      uint32x4_t s0, s1, s2, s3;
+
+      State( const uint32_t *p0, const uint32_t *p1,
+             const uint32_t *p2, const uint32_t *p3 )
+         : s0{ vld1q_u32( p0 ) }
+         , s1{ vld1q_u32( p1 ) }
+         , s2{ vld1q_u32( p2 ) }
+         , s3{ vld1q_u32( p3 ) }
+      {}
+
+      void Store( uint32_t *p0, uint32_t *p1, uint32_t *p2, uint32_t *p3 )
+      {
+         vst1q_u32( p0, s0 );
+         vst1q_u32( p1, s1 );
+         vst1q_u32( p2, s2 );
+         vst1q_u32( p3, s3 );
+      }
+
+      uint32x4_t Step()
+      {
+         const uint32x4_t result = vaddq_u32( s0, s3 );
+         const uint32x4_t t = vshlq_n_u32( s1, 9 );
+         s2 = veorq_u32( s2, s0 );
+         s3 = veorq_u32( s3, s1 );
+         s1 = veorq_u32( s1, s2 );
+         s0 = veorq_u32( s0, s3 );
+         s2 = veorq_u32( s2, t );
+         s3 = vorrq_u32( vshlq_n_u32( s3, 11 ), vshrq_n_u32( s3, 21 ) );
+         return result;
+      }
+   };
+
+#endif
+
+}
+
+void FastRandom::FillBits( uint32_t *buffer, size_t len )
+{
+   // Continue the sequence of Next()
+   auto ii = Drain( buffer, len );
+
+#if defined(FAST_RANDOM_SSE2) || defined(FAST_RANDOM_NEON)
+   {
+      State state{ mS0, mS1, mS2, mS3 };
+      for ( ; ii + Lanes <= len; ii += Lanes )
+#if defined(FAST_RANDOM_SSE2)
+         _mm_storeu_si128( (__m128i*)( buffer + ii ), state.Step() );
+#else
+         vst1q_u32( buffer + ii, state.Step() );
+#endif
+      state.Store( mS0, mS1, mS2, mS3 );
+   }
+#else
+   for ( ; ii + Lanes <= len; ii += Lanes )
+      Step( buffer + ii );
+#endif
+
+   for ( ; ii < len; ++ii )
+      buffer[ ii ] = Next();
+}
+
+void FastRandom::FillUniform( float *buffer, size_t len, float low, float high )
+{
+   const float scale = ( high - low ) * Unit;
+
+   size_t ii = 0;
+   for ( ; ii < len && mCached < Lanes; ++ii )
+      buffer[ ii ] = ToFloat( mCache[ mCached++ ], scale, low );
+
+#if defined(FAST_RANDOM_SSE2)
+   {
+      State state{ mS0, mS1, mS2, mS3 };
+      const __m128 vScale = _mm_set1_ps( scale );
+      const __m128 vLow = _mm_set1_ps( low );
+      for ( ; ii + Lanes <= len; ii += Lanes ) {
+         // Shifted to 24 bits, the signed conversion is exact
+         const __m128 value =
+            _mm_cvtepi32_ps( _mm_srli_epi32( state.Step(), 8 ) );
+         _mm_storeu_ps( buffer + ii,
+            _mm_add_ps( _mm_mul_ps( value, vScale ), vLow ) );
+      }
+      state.Store( mS0, mS1, mS2, mS3 );
+   }
+#elif defined(FAST_RANDOM_NEON)
+   {
+      State state{ mS0, mS1, mS2, mS3 };
+      const float32x4_t vScale = vdupq_n_f32( scale );
+      const float32x4_t vLow = vdupq_n_f32( low );
+      for ( ; ii + Lanes <= len; ii += Lanes ) {
+         const float32x4_t value =
+            vcvtq_f32_u32( vshrq_n_u32( state.Step(), 8 ) );
+         // Not vmlaq, which may fuse, and round otherwise than ToFloat
+         vst1q_f32( buffer + ii, vaddq_f32( vmulq_f32( value, vScale ), vLow ) );
+      }
+      state.Store( mS0, mS1, mS2, mS3 );
+   }
+#else
+   for ( ; ii + Lanes <= len; ii += Lanes ) {
+      uint32_t bits[ Lanes ];
+      Step( bits );
+      for ( unsigned ll = 0; ll < Lanes; ++ll )
+         buffer[ ii + ll ] = ToFloat( bits[ ll ], scale, low );
+   }
+#endif
+
+   for ( ; ii < len; ++ii )
+      buffer[ ii ] = ToFloat( Next(), scale, low );
+}
@@ -0,0 +1,95 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  FastRandom.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class FastRandom
+\brief A small, fast pseudo-random generator for noise, dither and
+random phases, where rand() is too slow and too poor.
+
+  It runs four xoshiro128+ generators side by side, so that the filling
+  functions make four numbers at once with SSE2 or NEON; the one-at-a-time
+  functions take them from the same sequence.  The bits depend only on
+  the seed, not on the processor.
+
+  It is not for cryptography.  Each object is for one thread at a time.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_FAST_RANDOM__
+#define __AUDACITY_FAST_RANDOM__
+
+#include <cstddef>
+#include <cstdint>
+
+class FastRandom
+{
+public:
+   static const unsigned Lanes = 4;
+
+   explicit FastRandom( uint64_t seed = 1 ) { Seed( seed ); }
+
+   // Restart the sequence; nearby seeds give unrelated sequences
+   void Seed( uint64_t seed );
+
+   // 32 random bits
+   uint32_t Next()
+   {
+      if ( mCached == Lanes ) {
+         Step( mCache );
+         mCached = 0;
+      }
+      return mCache[ mCached++ ];
+   }
+
+   // Uniform in low...high, with 24 random bits, as the fill functions
+   // make them
+   float NextFloat( float low, float high )
+   {
+      return ToFloat( Next(), ( high - low ) * Unit, low );
+   }
+
+   void FillBits( uint32_t *buffer, size_t len );
+   // Uniform white noise in low...high
+   void FillUniform( float *buffer, size_t len, float low, float high );
+
+private:
+   static constexpr float Unit = 1.0f / 16777216.0f;
+
+   static float ToFloat( uint32_t bits, float scale, float offset )
+   {
+      return float( bits >> 8 ) * scale + offset;
+   }
+
+   // Advance each lane once
+   void Step( uint32_t *out )
+   {
+      for ( unsigned ll = 0; ll < Lanes; ++ll ) {
+         out[ ll ] = mS0[ ll ] + mS3[ ll ];
+         const uint32_t t = mS1[ ll ] << 9;
+         mS2[ ll ] ^= mS0[ ll ];
+         mS3[ ll ] ^= mS1[ ll ];
+         mS1[ ll ] ^= mS2[ ll ];
+         mS0[ ll ] ^= mS3[ ll ];
+         mS2[ ll ] ^= t;
+         mS3[ ll ] = ( mS3[ ll ] << 11 ) | ( mS3[ ll ] >> 21 );
+      }
+   }
+
+   // Take what is left of the last Step, and return how many were taken
+   size_t Drain( uint32_t *buffer, size_t len );
+
+   // The state, lane by lane
+   uint32_t mS0[ Lanes ], mS1[ Lanes ], mS2[ Lanes ], mS3[ Lanes ];
+   // Made by Step, not yet returned by Next
+   uint32_t mCache[ Lanes ];
+   unsigned mCached { Lanes };
+};
+
+#endif
@@ -39,6 +39,21 @@ used throughout Audacity into this one place.
 
 #if defined(__WXMSW__)
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#elif defined(__APPLE__)
+#include <AvailabilityMacros.h>
+#if defined(MAC_OS_X_VERSION_10_12)
+#include <sys/attr.h>
+#include <sys/clonefile.h>
+#define HAVE_CLONEFILE
+#endif
 #endif
 
 static wxString gDataDir;
@@ -69,6 +84,53 @@ bool FileNames::CopyFile(
 #endif
 }
 
+bool FileNames::CloneFile(const wxString& file1, const wxString& file2)
+{
+   // Don't disturb a file already there, which might share data with
+   // another
+   if (wxFileExists(file2))
+      return CopyFile(file1, file2);
+
+#if defined(__WXMSW__)
+
+   if (::CreateHardLinkW(file2.wc_str(), file1.wc_str(), NULL))
+      return true;
+
+#else
+
+#if defined(__linux__) && defined(FICLONE)
+   {
+      // Reflink on btrfs, XFS and others
+      int src = open(OSINPUT(file1), O_RDONLY);
+      if (src >= 0) {
+         int dst = open(OSOUTPUT(file2), O_WRONLY | O_CREAT | O_EXCL, 0666);
+         bool cloned = false;
+         if (dst >= 0) {
+            cloned = (ioctl(dst, FICLONE, src) == 0);
+            close(dst);
+            if (!cloned)
+               unlink(OSOUTPUT(file2));
+         }
+         close(src);
+         if (cloned)
+            return true;
+      }
+   }
+#elif defined(HAVE_CLONEFILE)
+   // APFS
+   if (clonefile(OSINPUT(file1), OSOUTPUT(file2), 0) == 0)
+      return true;
+#endif
+
+   if (link(OSINPUT(file1), OSOUTPUT(file2)) == 0)
+      return true;
+
+#endif
+
+   // Different volumes, or a file system with neither
+   return CopyFile(file1, file2, false);
+}
+
 wxString FileNames::MkDir(const wxString &Str)
 {
    // Behaviour of wxFileName::DirExists() and wxFileName::MkDir() has
@@ -274,6 +336,12 @@ wxString FileNames::ThemeCachePng()
    return wxFileName( ThemeDir(), wxT("ImageCache.png") ).GetFullPath();
 }
 
+wxString FileNames::ThemeDecodedCache(const wxString &themeName)
+{
+   return wxFileName( ThemeDir(),
+      wxT("ImageCache-") + themeName + wxT(".decoded") ).GetFullPath();
+}
+
 wxString FileNames::ThemeCacheHtm()
 {
    return wxFileName( ThemeDir(), wxT("ImageCache.htm") ).GetFullPath();
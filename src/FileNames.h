@@ -27,6 +27,11 @@ public:
    static bool CopyFile(
       const wxString& file1, const wxString& file2, bool overwrite = true);
 
+   // Like CopyFile, but file2 shares the data of file1 on disk where the
+   // file system allows: by a copy-on-write clone, else by a hard link.
+   // Use only for files that are never modified in place, like block files.
+   static bool CloneFile(const wxString& file1, const wxString& file2);
+
    static wxString MkDir(const wxString &Str);
    static wxString TempDir();
 
@@ -63,6 +68,8 @@ public:
    static wxString ThemeDir();
    static wxString ThemeComponentsDir();
    static wxString ThemeCachePng();
+   // The decoded pixels of a theme, kept to skip decoding its png
+   static wxString ThemeDecodedCache(const wxString &themeName);
    static wxString ThemeCacheAsCee();
    static wxString ThemeComponent(const wxString &Str);
    static wxString ThemeCacheHtm();
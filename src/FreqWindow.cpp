@@ -66,6 +66,7 @@ and in the spectrogram spectral selection.
 #include "ShuttleGui.h"
 #include "AColor.h"
 #include "FFT.h"
+#include "TaskScheduler.h"
 #include "Internat.h"
 #include "PitchName.h"
 #include "prefs/GUISettings.h"
@@ -110,6 +111,13 @@ enum {
 #define FREQ_WINDOW_WIDTH 480
 #define FREQ_WINDOW_HEIGHT 330
 
+// The most samples analyzed, a little more than an hour at 44100 Hz
+static const size_t MaxDataLen = 160 * 1048576;
+// Samples of each further selected track added in at a time
+static const size_t SumChunkLen = 1048576;
+// Windows summed by one thread in one go, when calculating the spectrum
+static const size_t WindowsPerBatch = 64;
+
 
 static const char * ZoomIn[] = {
 "16 16 6 1",
@@ -587,12 +595,12 @@ void FreqWindow::GetAudio()
             auto start = track->TimeToLongSamples(p->mViewInfo.selectedRegion.t0());
             auto end = track->TimeToLongSamples(p->mViewInfo.selectedRegion.t1());
             auto dataLen = end - start;
-            if (dataLen > 10485760) {
+            if (dataLen > MaxDataLen) {
                warning = true;
-               mDataLen = 10485760;
+               mDataLen = MaxDataLen;
             }
             else
-               // dataLen is not more than 10 * 2 ^ 20
+               // dataLen is not more than MaxDataLen
                mDataLen = dataLen.as_size_t();
             mData = Floats{ mDataLen };
             // Don't allow throw for bad reads
@@ -607,12 +615,16 @@ void FreqWindow::GetAudio()
                return;
             }
             auto start = track->TimeToLongSamples(p->mViewInfo.selectedRegion.t0());
-            Floats buffer2{ mDataLen };
-            // Again, stop exceptions
-            track->Get((samplePtr)buffer2.get(), floatSample, start, mDataLen,
-                       fillZero, false);
-            for (size_t i = 0; i < mDataLen; i++)
-               mData[i] += buffer2[i];
+            // In pieces, so that long selections don't need twice the memory
+            Floats buffer2{ std::min(mDataLen, SumChunkLen) };
+            for (size_t done = 0; done < mDataLen; done += SumChunkLen) {
+               const auto len = std::min(mDataLen - done, SumChunkLen);
+               // Again, stop exceptions
+               track->Get((samplePtr)buffer2.get(), floatSample, start + done,
+                          len, fillZero, false);
+               for (size_t i = 0; i < len; i++)
+                  mData[done + i] += buffer2[i];
+            }
          }
          selcount++;
       }
@@ -1196,6 +1208,105 @@ void FreqGauge::Reset()
    Refresh(true);
 }
 
+namespace {
+
+// Scratch space and the sum of the results for a batch of windows
+struct WindowAccumulator
+{
+   size_t windowSize{};
+   Floats in, out, out2;
+   std::vector<float> sums;
+
+   void Init(size_t size)
+   {
+      windowSize = size;
+      in.reinit(size);
+      out.reinit(size);
+      out2.reinit(size);
+      sums.resize(size / 2);
+   }
+
+   // The autocorrelations are computed with the FFT, as the inverse
+   // transform of the power spectrum
+   void Add(SpectrumAnalyst::Algorithm alg, const float *win, const float *data)
+   {
+      const auto half = windowSize / 2;
+      for (size_t i = 0; i < windowSize; i++)
+         in[i] = win[i] * data[i];
+
+      switch (alg) {
+         case SpectrumAnalyst::Spectrum:
+            PowerSpectrum(windowSize, in.get(), out.get());
+
+            for (size_t i = 0; i < half; i++)
+               sums[i] += out[i];
+            break;
+
+         case SpectrumAnalyst::Autocorrelation:
+         case SpectrumAnalyst::CubeRootAutocorrelation:
+         case SpectrumAnalyst::EnhancedAutocorrelation:
+
+            // Take FFT
+            RealFFT(windowSize, in.get(), out.get(), out2.get());
+            // Compute power
+            for (size_t i = 0; i < windowSize; i++)
+               in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+
+            if (alg == SpectrumAnalyst::Autocorrelation) {
+               for (size_t i = 0; i < windowSize; i++)
+                  in[i] = sqrt(in[i]);
+            }
+            if (alg == SpectrumAnalyst::CubeRootAutocorrelation ||
+                alg == SpectrumAnalyst::EnhancedAutocorrelation) {
+               // Tolonen and Karjalainen recommend taking the cube root
+               // of the power, instead of the square root
+
+               for (size_t i = 0; i < windowSize; i++)
+                  in[i] = pow(in[i], 1.0f / 3.0f);
+            }
+            // Take FFT
+            RealFFT(windowSize, in.get(), out.get(), out2.get());
+
+            // Take real part of result
+            for (size_t i = 0; i < half; i++)
+               sums[i] += out[i];
+            break;
+
+         case SpectrumAnalyst::Cepstrum:
+            RealFFT(windowSize, in.get(), out.get(), out2.get());
+
+            // Compute log power
+            // Set a sane lower limit assuming maximum time amplitude of 1.0
+            {
+               float power;
+               float minpower = 1e-20*windowSize*windowSize;
+               for (size_t i = 0; i < windowSize; i++)
+               {
+                  power = (out[i] * out[i]) + (out2[i] * out2[i]);
+                  if(power < minpower)
+                     in[i] = log(minpower);
+                  else
+                     in[i] = log(power);
+               }
+               // Take IFFT
+               InverseRealFFT(windowSize, in.get(), NULL, out.get());
+
+               // Take real part of result
+               for (size_t i = 0; i < half; i++)
+                  sums[i] += out[i];
+            }
+
+            break;
+
+         default:
+            wxASSERT(false);
+            break;
+      }                         //switch
+   }
+};
+
+}
+
 bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
                                 size_t windowSize, double rate,
                                 const float *data, size_t dataLen,
@@ -1229,9 +1340,7 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
    auto half = mWindowSize / 2;
    mProcessed.resize(mWindowSize);
 
-   Floats in{ mWindowSize };
    Floats out{ mWindowSize };
-   Floats out2{ mWindowSize };
    Floats win{ mWindowSize };
 
    for (size_t i = 0; i < mWindowSize; i++) {
@@ -1255,88 +1364,40 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       progress->SetRange(dataLen);
    }
 
-   size_t start = 0;
-   int windows = 0;
-   while (start + mWindowSize <= dataLen) {
-      for (size_t i = 0; i < mWindowSize; i++)
-         in[i] = win[i] * data[start + i];
-
-      switch (alg) {
-         case Spectrum:
-            PowerSpectrum(mWindowSize, in.get(), out.get());
-
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Autocorrelation:
-         case CubeRootAutocorrelation:
-         case EnhancedAutocorrelation:
-
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-            // Compute power
-            for (size_t i = 0; i < mWindowSize; i++)
-               in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
-
-            if (alg == Autocorrelation) {
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = sqrt(in[i]);
-            }
-            if (alg == CubeRootAutocorrelation ||
-                alg == EnhancedAutocorrelation) {
-               // Tolonen and Karjalainen recommend taking the cube root
-               // of the power, instead of the square root
-
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = pow(in[i], 1.0f / 3.0f);
-            }
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Take real part of result
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Cepstrum:
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Compute log power
-            // Set a sane lower limit assuming maximum time amplitude of 1.0
-            {
-               float power;
-               float minpower = 1e-20*mWindowSize*mWindowSize;
-               for (size_t i = 0; i < mWindowSize; i++)
-               {
-                  power = (out[i] * out[i]) + (out2[i] * out2[i]);
-                  if(power < minpower)
-                     in[i] = log(minpower);
-                  else
-                     in[i] = log(power);
-               }
-               // Take IFFT
-               InverseRealFFT(mWindowSize, in.get(), NULL, out.get());
-
-               // Take real part of result
-               for (size_t i = 0; i < half; i++)
-                  mProcessed[i] += out[i];
-            }
-
-            break;
-
-         default:
-            wxASSERT(false);
-            break;
-      }                         //switch
+   // Each thread sums a batch of windows into its own accumulator.  The
+   // batches of each round are added in order as the round finishes, so
+   // the result doesn't depend on the threads, and progress can be shown
+   const size_t windows = 1 + (dataLen - mWindowSize) / half;
+   const size_t nBatches = (windows + WindowsPerBatch - 1) / WindowsPerBatch;
+   const size_t concurrency =
+      std::max(1u, TaskScheduler::Get().GetConcurrency());
+   std::vector<WindowAccumulator> accumulators(
+      std::min(nBatches, concurrency));
+   for (auto &accumulator : accumulators)
+      accumulator.Init(mWindowSize);
+
+   for (size_t first = 0; first < nBatches; first += accumulators.size()) {
+      const auto count = std::min(accumulators.size(), nBatches - first);
+      TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, count, [&](size_t ii) {
+         auto &accumulator = accumulators[ii];
+         std::fill(accumulator.sums.begin(), accumulator.sums.end(), 0.0f);
+         const auto begin = (first + ii) * WindowsPerBatch;
+         const auto end = std::min(windows, begin + WindowsPerBatch);
+         for (auto window = begin; window < end; ++window)
+            accumulator.Add(alg, win.get(), data + window * half);
+      });
+
+      for (size_t ii = 0; ii < count; ++ii) {
+         const auto &sums = accumulators[ii].sums;
+         for (size_t i = 0; i < half; i++)
+            mProcessed[i] += sums[i];
+      }
 
       // Update the progress bar
       if (progress) {
-         progress->SetValue(start);
+         progress->SetValue(
+            std::min(dataLen, (first + count) * WindowsPerBatch * half));
       }
-
-      start += half;
-      windows++;
    }
 
    if (progress) {
@@ -1448,6 +1509,29 @@ const float *SpectrumAnalyst::GetProcessed() const
    return &mProcessed[0];
 }
 
+bool SpectrumAnalyst::CalculateFromPowers(size_t windowSize, double rate,
+   const std::vector<double> &powers, size_t count)
+{
+   mProcessed.resize(0);
+   mRate = 0.0;
+   mWindowSize = 0;
+
+   if (count == 0 || powers.size() != windowSize / 2)
+      return false;
+
+   mRate = rate;
+   mWindowSize = windowSize;
+   mAlg = Spectrum;
+
+   // Only the shape matters for finding peaks, not the scale of the window
+   mProcessed.resize(mWindowSize, 0.0f);
+   for (size_t i = 0; i < powers.size(); i++) {
+      const double power = powers[i] / count;
+      mProcessed[i] = power > 0 ? 10 * log10(power) : -160.0;
+   }
+   return true;
+}
+
 int SpectrumAnalyst::GetProcessedSize() const
 {
    return mProcessed.size() / 2;
@@ -66,6 +66,12 @@ public:
       float *pYMin = NULL, float *pYMax = NULL, // outputs
       FreqGauge *progress = NULL);
 
+   // Make the Spectrum result from the sums of the powers of count
+   // windows, one for each bin below the Nyquist frequency, that were
+   // computed elsewhere
+   bool CalculateFromPowers(size_t windowSize, double rate,
+      const std::vector<double> &powers, size_t count);
+
    const float *GetProcessed() const;
    int GetProcessedSize() const;
 
@@ -0,0 +1,195 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  HeadlessBatch.cpp
+
+*******************************************************************//**
+
+\file HeadlessBatch.cpp
+\brief Runs a macro on files from the command line, without showing any
+project window.
+
+  Macro commands all work on the active project from the main thread, so
+  one process can only do one file at a time.  Parallel work is therefore
+  in worker processes, which are copies of Audacity started with the
+  --batch-worker option.  Each is given a temporary directory of its own,
+  which keeps its block files away from the others' clean up, and takes no
+  part in the single instance check.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "HeadlessBatch.h"
+
+#include <algorithm>
+#include <vector>
+#include <wx/app.h>
+#include <wx/filename.h>
+#include <wx/process.h>
+#include <wx/textfile.h>
+#include <wx/utils.h>
+
+#include "AudacityException.h"
+#include "BatchCommands.h"
+#include "DirManager.h"
+#include "MemoryX.h"
+#include "PlatformCompatibility.h"
+#include "Project.h"
+#include "UndoManager.h"
+
+namespace {
+
+const wxChar *const FailuresFileName = wxT("failures.txt");
+
+class BatchWorker final : public wxProcess
+{
+public:
+   void OnTerminate(int WXUNUSED(pid), int status) override
+   {
+      mStatus = status;
+      mActive = false;
+   }
+
+   wxString mTempDir;
+   wxArrayString mFiles;
+   bool mActive{ true };
+   int mStatus{ 0 };
+};
+
+// Returns the files that failed
+wxArrayString ApplyMacroToFiles(AudacityProject &project,
+   const wxString &macro, const wxArrayString &files)
+{
+   wxArrayString failures;
+
+   MacroCommands commands;
+   if (!commands.ReadMacro(macro)) {
+      wxPrintf(_("Macro %s could not be read\n"), macro);
+      return files;
+   }
+   const MacroCommandsCatalog catalog{ &project };
+
+   for (const auto &file : files) {
+      auto success = GuardedCall< bool >( [&] {
+         // Unlike ApplyMacroDialog, there's no zooming, since nothing is seen
+         if (!project.Import(file))
+            return false;
+         project.OnSelectAll(project);
+         return commands.ApplyMacro(catalog);
+      } );
+
+      if (success)
+         wxPrintf(_("Processed %s\n"), file);
+      else {
+         wxPrintf(_("Failed to process %s\n"), file);
+         failures.Add(file);
+      }
+
+      // Start the next file afresh
+      project.GetUndoManager()->ClearStates();
+      project.OnSelectAll(project);
+      project.OnRemoveTracks(project);
+   }
+
+   return failures;
+}
+
+std::unique_ptr<BatchWorker> StartWorker(const wxString &macro,
+   wxArrayString files, int number)
+{
+   auto worker = std::make_unique<BatchWorker>();
+   wxFileName dir{ DirManager::GetTempDir(), wxEmptyString };
+   dir.AppendDir(wxString::Format(wxT("batch-%lu-%d"),
+      wxGetProcessId(), number));
+   if (!dir.Mkdir(0700, wxPATH_MKDIR_FULL))
+      return {};
+   worker->mTempDir = dir.GetPath();
+
+   wxString cmd = wxString::Format(wxT("\"%s\" \"--batch-worker=%s\" \"--macro=%s\""),
+      PlatformCompatibility::GetExecutablePath(), worker->mTempDir, macro);
+   for (const auto &file : files)
+      cmd += wxString::Format(wxT(" \"%s\""), file);
+   worker->mFiles = std::move(files);
+
+   if (wxExecute(cmd, wxEXEC_ASYNC, worker.get()) == 0) {
+      wxFileName::Rmdir(worker->mTempDir, wxPATH_RMDIR_RECURSIVE);
+      return {};
+   }
+   return worker;
+}
+
+// Returns the files that failed
+wxArrayString FinishWorker(BatchWorker &worker)
+{
+   wxArrayString failures;
+   wxTextFile file{ wxFileName{ worker.mTempDir, FailuresFileName }.GetFullPath() };
+   if (worker.mStatus != 0)
+      // It did not get as far as saying which; assume the worst
+      failures = worker.mFiles;
+   else if (file.Exists() && file.Open()) {
+      for (size_t ii = 0; ii < file.GetLineCount(); ++ii)
+         if (!file[ii].empty())
+            failures.Add(file[ii]);
+      file.Close();
+   }
+   wxFileName::Rmdir(worker.mTempDir, wxPATH_RMDIR_RECURSIVE);
+   return failures;
+}
+
+}
+
+bool RunMacroOnFiles(AudacityProject *project, const wxString &macro,
+   const wxArrayString &files, long jobs)
+{
+   jobs = std::max(1L, std::min<long>(jobs, files.size()));
+
+   // Deal the files out in turn, keeping the first share for this process
+   std::vector<wxArrayString> shares(jobs);
+   for (size_t ii = 0; ii < files.size(); ++ii)
+      shares[ii % jobs].Add(files[ii]);
+
+   std::vector< std::unique_ptr<BatchWorker> > workers;
+   wxArrayString failures;
+   for (long ii = 1; ii < jobs; ++ii) {
+      auto worker = StartWorker(macro, shares[ii], ii);
+      if (worker)
+         workers.push_back(std::move(worker));
+      else
+         // Do it here instead
+         WX_APPEND_ARRAY(shares[0], shares[ii]);
+   }
+
+   auto mine = ApplyMacroToFiles(*project, macro, shares[0]);
+   WX_APPEND_ARRAY(failures, mine);
+
+   // Termination is reported through the event loop
+   for (auto &worker : workers) {
+      while (worker->mActive) {
+         wxMilliSleep(10);
+         wxTheApp->Yield();
+      }
+      auto theirs = FinishWorker(*worker);
+      WX_APPEND_ARRAY(failures, theirs);
+   }
+
+   if (!failures.empty())
+      wxPrintf(_("%d of %d files could not be processed\n"),
+         (int)failures.size(), (int)files.size());
+   return failures.empty();
+}
+
+void RunMacroOnFilesAsWorker(AudacityProject *project, const wxString &macro,
+   const wxArrayString &files, const wxString &tempDir)
+{
+   const auto failures = ApplyMacroToFiles(*project, macro, files);
+   if (failures.empty())
+      return;
+
+   wxTextFile file{ wxFileName{ tempDir, FailuresFileName }.GetFullPath() };
+   if (file.Create()) {
+      for (const auto &failure : failures)
+         file.AddLine(failure);
+      file.Write();
+   }
+}
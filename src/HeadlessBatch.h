@@ -0,0 +1,30 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  HeadlessBatch.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_HEADLESS_BATCH__
+#define __AUDACITY_HEADLESS_BATCH__
+
+class AudacityProject;
+class wxArrayString;
+class wxString;
+
+/// Applies the macro to each of the files in turn, as ApplyMacroDialog does,
+/// in a project that is never shown, so that nothing is drawn.  With jobs
+/// greater than one, the files are shared among that many processes, each
+/// with a project and temporary directory of its own.  Writes a line for each
+/// file, and returns false if any failed.
+bool RunMacroOnFiles(AudacityProject *project, const wxString &macro,
+   const wxArrayString &files, long jobs);
+
+/// The part of the batch given to a process started by RunMacroOnFiles(),
+/// whose temporary directory is tempDir.  Failures are written there, for
+/// the parent to report.
+void RunMacroOnFilesAsWorker(AudacityProject *project, const wxString &macro,
+   const wxArrayString &files, const wxString &tempDir);
+
+#endif // define __AUDACITY_HEADLESS_BATCH__
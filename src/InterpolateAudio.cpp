@@ -8,13 +8,13 @@
 
 **********************************************************************/
 
+#include <algorithm>
 #include <math.h>
 #include <stdlib.h>
 
 #include <wx/defs.h>
 
 #include "InterpolateAudio.h"
-#include "Matrix.h"
 #include "SampleFormat.h"
 
 static inline int imin(int x, int y)
@@ -77,6 +77,45 @@ static void LinearInterpolateAudio(float *buffer, int len,
    }
 }
 
+// Solves M v = rhs in place, for symmetric positive definite M of size n,
+// given as its lower band:  band[j * width + (j - k)] is M[j][k] for
+// j - width < k <= j.  The Cholesky factor L, in M = L L', has the same
+// band and replaces it.  False if M is singular.
+static bool CholeskySolve(double *band, size_t n, size_t width, double *rhs)
+{
+   const size_t P = width - 1;
+   for(size_t j=0; j<n; j++) {
+      const size_t kBegin = j > P ? j - P : 0;
+      for(size_t k=kBegin; k<=j; k++) {
+         double sum = band[j * width + (j - k)];
+         for(size_t m=kBegin; m<k; m++)
+            sum -= band[j * width + (j - m)] * band[k * width + (k - m)];
+         if (k < j)
+            band[j * width + (j - k)] = sum / band[k * width];
+         else if (sum > 0)
+            band[j * width] = sqrt(sum);
+         else
+            return false;
+      }
+   }
+
+   // Solve L y = rhs, then L' v = y
+   for(size_t j=0; j<n; j++) {
+      const size_t kBegin = j > P ? j - P : 0;
+      for(size_t k=kBegin; k<j; k++)
+         rhs[j] -= band[j * width + (j - k)] * rhs[k];
+      rhs[j] /= band[j * width];
+   }
+   for(size_t j=n; j--;) {
+      const size_t kEnd = std::min(n, j + width);
+      for(size_t k=j+1; k<kEnd; k++)
+         rhs[j] -= band[k * width + (k - j)] * rhs[k];
+      rhs[j] /= band[j * width];
+   }
+
+   return true;
+}
+
 // Here's the main interpolate function, using
 // Least Squares AutoRegression (LSAR):
 void InterpolateAudio(float *buffer, const size_t len,
@@ -106,7 +145,9 @@ void InterpolateAudio(float *buffer, const size_t len,
       return;
    }
 
-   Vector s(len, buffer);
+   Doubles s{ N };
+   for(size_t i=0; i<N; i++)
+      s[i] = buffer[i];
 
    // Choose P, the order of the autoregression equation
    const int IP =
@@ -128,22 +169,26 @@ void InterpolateAudio(float *buffer, const size_t len,
    for(size_t i=0; i<N; i++)
       s[i] += (rand()-(RAND_MAX/2))/(RAND_MAX*10000.0);
 
+   // The same with the bad samples as zeroes
+   Doubles x{ N };
+   for(size_t i=0; i<N; i++)
+      x[i] = (i < firstBad || i >= firstBad + numBad) ? s[i] : 0.0;
+
    // Solve for the best autoregression coefficients
    // using a least-squares fit to all of the non-bad
    // data we have in the buffer
-   Matrix X(P, P);
-   Vector b(P);
-
+   Doubles X{ P * P, true };
+   Doubles a{ P, true };
    for(size_t i = 0; i + P < len; i++)
       if (i+P < firstBad || i >= (firstBad + numBad))
          for(size_t row=0; row<P; row++) {
-            for(size_t col=0; col<P; col++)
-               X[row][col] += (s[i+row] * s[i+col]);
-            b[row] += s[i+P] * s[i+row];
+            // Only the lower triangle, by row, is wanted
+            for(size_t col=0; col<=row; col++)
+               X[row * P + (row - col)] += (s[i+row] * s[i+col]);
+            a[row] += s[i+P] * s[i+row];
          }
 
-   Matrix Xinv(P, P);
-   if (!InvertMatrix(X, Xinv)) {
+   if (!CholeskySolve(X.get(), P, P, a.get())) {
       // The matrix is singular!  Fall back on linear...
       // In practice I have never seen this happen if
       // we add the tiny bit of random noise.
@@ -151,54 +196,53 @@ void InterpolateAudio(float *buffer, const size_t len,
       return;
    }
 
-   // This vector now contains the autoregression coefficients
-   const Vector &a = Xinv * b;
-
-   // Create a matrix (a "Toeplitz" matrix, as it turns out)
-   // which encodes the autoregressive relationship between
-   // elements of the sequence.
-   Matrix A(N-P, N);
-   for(size_t row=0; row<N-P; row++) {
-      for(size_t col=0; col<P; col++)
-         A[row][row+col] = -a[col];
-      A[row][row+P] = 1;
+   // Each row of the (Toeplitz) matrix A of the autoregressive
+   // relationship between elements of the sequence is this filter,
+   // one sample further along:  A[row][row+col] = h[col], for rows
+   // 0 through N-P-1.
+   Doubles h{ P + 1 };
+   for(size_t col=0; col<P; col++)
+      h[col] = -a[col];
+   h[P] = 1;
+
+   // Split both A and the signal into the "u"nknown (bad) and
+   // "k"nown (good) pieces.  The best guess for su minimizes
+   // |Au su + Ak sk|, so solves (Au' Au) su = -Au' Ak sk, in which
+   // Au' Au is banded, P wide on each side of the diagonal.  Only
+   // the rows of A that reach the bad samples matter.
+   const size_t rowBegin = firstBad > P ? firstBad - P : 0;
+   const size_t rowEnd = std::min(N - P, firstBad + numBad);
+   const size_t width = P + 1;
+
+   // Lower band of Au' Au, band[j * width + (j - k)] for k <= j
+   Doubles band{ numBad * width, true };
+   // -Au' Ak sk
+   Doubles rhs{ numBad, true };
+   for(size_t row=rowBegin; row<rowEnd; row++) {
+      // Ak sk, for this row
+      double residual = 0;
+      for(size_t col=0; col<=P; col++)
+         residual += h[col] * x[row+col];
+
+      // The bad samples that this row reaches
+      const size_t jBegin = row > firstBad ? row - firstBad : 0;
+      const size_t jEnd = std::min(numBad, row + P + 1 - firstBad);
+      for(size_t j=jBegin; j<jEnd; j++) {
+         const double hj = h[firstBad + j - row];
+         rhs[j] -= hj * residual;
+         for(size_t k=jBegin; k<=j; k++)
+            band[j * width + (j - k)] += hj * h[firstBad + k - row];
+      }
    }
 
-   // Split both the Toeplitz matrix and the signal into
-   // two pieces.  Note that this code could be made to
-   // work even in the case where the "bad" samples are
-   // not contiguous, but currently it assumes they are.
-   //   "u" is for unknown (bad)
-   //   "k" is for known (good)
-   Matrix Au = MatrixSubset(A, 0, N-P, firstBad, numBad);
-   Matrix A_left = MatrixSubset(A, 0, N-P, 0, firstBad);
-   Matrix A_right = MatrixSubset(A, 0, N-P,
-                                 firstBad+numBad, N-(firstBad+numBad));
-   Matrix Ak = MatrixConcatenateCols(A_left, A_right);
-
-   const Vector &s_left = VectorSubset(s, 0, firstBad);
-   const Vector &s_right = VectorSubset(s, firstBad+numBad,
-                                 N-(firstBad+numBad));
-   const Vector &sk = VectorConcatenate(s_left, s_right);
-
-   // Do some linear algebra to find the best possible
-   // values that fill in the "bad" area
-   Matrix AuT = TransposeMatrix(Au);
-   Matrix X1 = MatrixMultiply(AuT, Au);
-   Matrix X2(X1.Rows(), X1.Cols());
-   if (!InvertMatrix(X1, X2)) {
+   if (!CholeskySolve(band.get(), numBad, width, rhs.get())) {
       // The matrix is singular!  Fall back on linear...
       LinearInterpolateAudio(buffer, len, firstBad, numBad);
       return;
    }
-   Matrix X2b = X2 * -1.0;
-   Matrix X3 = MatrixMultiply(X2b, AuT);
-   Matrix X4 = MatrixMultiply(X3, Ak);
-   // This vector contains our best guess as to the
-   // unknown values
-   const Vector &su = X4 * sk;
 
-   // Put the results into the return buffer
+   // This vector contains our best guess as to the
+   // unknown values; put them into the return buffer
    for(size_t i=0; i<numBad; i++)
-      buffer[firstBad+i] = (float)su[i];
+      buffer[firstBad+i] = (float)rhs[i];
 }
@@ -20,6 +20,9 @@
  This is the same work used by Gnome Wave Cleaner (GWC), however this
  implementation is original.
 
+ The linear algebra uses the band structure of the autoregression, so
+ the time grows only linearly with the number of bad samples.
+
 *//*******************************************************************/
 
 #ifndef __AUDACITY_INTERPOLATE_AUDIO__
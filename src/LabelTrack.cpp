@@ -35,6 +35,8 @@ for drawing different aspects of the label and its text box.
 
 #include <stdio.h>
 #include <algorithm>
+#include <numeric>
+#include <string>
 #include <limits.h>
 #include <float.h>
 
@@ -45,6 +47,7 @@ for drawing different aspects of the label and its text box.
 #include <wx/dc.h>
 #include <wx/dcclient.h>
 #include <wx/event.h>
+#include <wx/ffile.h>
 #include <wx/intl.h>
 #include <wx/log.h>
 #include <wx/pen.h>
@@ -128,6 +131,8 @@ LabelTrack::LabelTrack(const LabelTrack &orig) :
    mSelIndex(-1),
    mClipLen(0.0)
 {
+   // The undo manager reads spilled tracks before they are used
+   wxASSERT(!orig.IsSpilled());
    for (auto &original: orig.mLabels) {
       LabelStruct l { original.selectedRegion, original.title };
       mLabels.push_back(l);
@@ -144,12 +149,14 @@ LabelTrack::~LabelTrack()
 
 void LabelTrack::SetOffset(double dOffset)
 {
+   InvalidateSpatialIndex();
    for (auto &labelStruct: mLabels)
       labelStruct.selectedRegion.move(dOffset);
 }
 
 void LabelTrack::Clear(double b, double e)
 {
+   InvalidateSpatialIndex();
    // May DELETE labels, so use subscripts to iterate
    for (size_t i = 0; i < mLabels.size(); ++i) {
       auto &labelStruct = mLabels[i];
@@ -199,6 +206,7 @@ bool LabelTrack::SplitDelete(double b, double e)
 
 void LabelTrack::ShiftLabelsOnInsert(double length, double pt)
 {
+   InvalidateSpatialIndex();
    for (auto &labelStruct: mLabels) {
       LabelStruct::TimeRelations relation =
                         labelStruct.RegionRelation(pt, pt, this);
@@ -212,6 +220,7 @@ void LabelTrack::ShiftLabelsOnInsert(double length, double pt)
 
 void LabelTrack::ChangeLabelsOnReverse(double b, double e)
 {
+   InvalidateSpatialIndex();
    for (auto &labelStruct: mLabels) {
       if (labelStruct.RegionRelation(b, e, this) ==
                                     LabelStruct::SURROUNDS_LABEL)
@@ -227,6 +236,7 @@ void LabelTrack::ChangeLabelsOnReverse(double b, double e)
 
 void LabelTrack::ScaleLabels(double b, double e, double change)
 {
+   InvalidateSpatialIndex();
    for (auto &labelStruct: mLabels) {
       labelStruct.selectedRegion.setTimes(
          AdjustTimeStampOnScale(labelStruct.getT0(), b, e, change),
@@ -254,6 +264,7 @@ double LabelTrack::AdjustTimeStampOnScale(double t, double b, double e, double c
 // (If necessary this could be optimised by ignoring labels that occur before a
 // specified time, as in most cases they don't need to move.)
 void LabelTrack::WarpLabels(const TimeWarper &warper) {
+   InvalidateSpatialIndex();
    for (auto &labelStruct: mLabels) {
       labelStruct.selectedRegion.setTimes(
          warper.Warp(labelStruct.getT0()),
@@ -455,8 +466,84 @@ void LabelTrack::ComputeTextPosition(const wxRect & r, int index) const
    labelStruct.xText = xText;
 }
 
+namespace {
+
+// Appends, in increasing order, the indices less than end of the leaves
+// under node whose values are at least t
+void CollectEndingAfter(const std::vector<double> &maxEnds, size_t node,
+   size_t lo, size_t hi, size_t end, double t, std::vector<int> &indices)
+{
+   if (lo >= end || maxEnds[node] < t)
+      return;
+   if (hi - lo == 1) {
+      indices.push_back(lo);
+      return;
+   }
+   const auto mid = (lo + hi) / 2;
+   CollectEndingAfter(maxEnds, 2 * node, lo, mid, end, t, indices);
+   CollectEndingAfter(maxEnds, 2 * node + 1, mid, hi, end, t, indices);
+}
+
+}
+
+/// CollectLabelsInView finds the labels that may show in the rectangle,
+/// in time logarithmic in the number of labels plus the number found.
+/// Function assumes that the labels are sorted.
+void LabelTrack::CollectLabelsInView(
+   const wxRect & r, const ZoomInfo &zoomInfo) const
+{
+   mLabelsInView.clear();
+   const size_t nn = mLabels.size();
+   if (nn == 0)
+      return;
+
+   if (mMaxEnds.empty()) {
+      size_t leaves = 1;
+      while (leaves < nn)
+         leaves <<= 1;
+      mMaxEnds.assign(2 * leaves, -DBL_MAX);
+      for (size_t i = 0; i < nn; ++i)
+         mMaxEnds[leaves + i] = mLabels[i].getT1();
+      for (auto node = leaves; --node > 0;)
+         mMaxEnds[node] = std::max(mMaxEnds[2 * node], mMaxEnds[2 * node + 1]);
+   }
+
+   // The text of a label may hang past its end, to the right, by its width,
+   // which is not yet measured; allow for as much as the width of the view.
+   // The glyphs may hang past either end by half an icon.
+   const double tEdge = zoomInfo.PositionToTime(r.x - mIconWidth, r.x);
+   const double tLeft =
+      zoomInfo.PositionToTime(r.x - r.width - mIconWidth, r.x);
+   const double tRight =
+      zoomInfo.PositionToTime(r.x + r.width + mIconWidth, r.x);
+
+   const auto starts = [](const LabelStruct &label, double t)
+      { return label.getT0() < t; };
+   const size_t first = std::lower_bound(
+      mLabels.begin(), mLabels.end(), tLeft, starts) - mLabels.begin();
+   const size_t last = std::lower_bound(
+      mLabels.begin() + first, mLabels.end(), tRight, starts) - mLabels.begin();
+
+   // Those starting earlier show only if they end in view
+   const auto leaves = mMaxEnds.size() / 2;
+   CollectEndingAfter(mMaxEnds, 1, 0, leaves, first, tEdge, mLabelsInView);
+   for (auto i = first; i < last; ++i)
+      mLabelsInView.push_back(i);
+
+   // The label being edited is always laid out, so that its caret may be
+   // scrolled into view
+   if (mSelIndex >= 0 && mSelIndex < (int)nn) {
+      const auto where = std::lower_bound(
+         mLabelsInView.begin(), mLabelsInView.end(), mSelIndex);
+      if (where == mLabelsInView.end() || *where != mSelIndex)
+         mLabelsInView.insert(where, mSelIndex);
+   }
+}
+
 /// ComputeLayout determines which row each label
 /// should be placed on, and reserves space for it.
+/// Only the labels in view are placed, so the rows may
+/// differ as the view scrolls.
 /// Function assumes that the labels are sorted.
 void LabelTrack::ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) const
 {
@@ -485,7 +572,8 @@ void LabelTrack::ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) const
    }
    int nRowsUsed=0;
 
-   { int i = -1; for (auto &labelStruct : mLabels) { ++i;
+   for (auto i : mLabelsInView) {
+      auto &labelStruct = mLabels[i];
       const int x = zoomInfo.TimeToPosition(labelStruct.getT0(), r.x);
       const int x1 = zoomInfo.TimeToPosition(labelStruct.getT1(), r.x);
       int y = r.y;
@@ -522,7 +610,7 @@ void LabelTrack::ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) const
          if( xUsed[iRow] < x1 ) xUsed[iRow]=x1;
          ComputeTextPosition( r, i );
       }
-   }}
+   }
 }
 
 LabelStruct::LabelStruct(const SelectedRegion &region,
@@ -800,10 +888,13 @@ void LabelTrack::Draw
 
    wxCoord textWidth, textHeight;
 
+   CollectLabelsInView( r, zoomInfo );
+
    // Get the text widths.
    // TODO: Make more efficient by only re-computing when a
    // text label title changes.
-   for (auto &labelStruct : mLabels) {
+   for (auto i : mLabelsInView) {
+      auto &labelStruct = mLabels[i];
       dc.GetTextExtent(labelStruct.title, &textWidth, &textHeight);
       labelStruct.width = textWidth;
    }
@@ -827,11 +918,12 @@ void LabelTrack::Draw
    // so that the correct things overpaint each other.
 
    // Draw vertical lines that show where the end positions are.
-   for (auto &labelStruct : mLabels)
-      labelStruct.DrawLines( dc, r );
+   for (auto i : mLabelsInView)
+      mLabels[i].DrawLines( dc, r );
 
    // Draw the end glyphs.
-   { int i = -1; for (auto &labelStruct : mLabels) { ++i;
+   for (auto i : mLabelsInView) {
+      const auto &labelStruct = mLabels[i];
       GlyphLeft=0;
       GlyphRight=1;
       if( pHit && i == pHit->mMouseOverLabelLeft )
@@ -839,7 +931,7 @@ void LabelTrack::Draw
       if( pHit && i == pHit->mMouseOverLabelRight )
          GlyphRight = (pHit->mEdge & 4) ? 7:4;
       labelStruct.DrawGlyphs( dc, r, GlyphLeft, GlyphRight );
-   }}
+   }
 
    // Draw the label boxes.
    {
@@ -848,7 +940,8 @@ void LabelTrack::Draw
       auto target = dynamic_cast<LabelTextHandle*>(context.target.get());
       highlightTrack = target && target->GetTrack().get() == this;
 #endif
-      int i = -1; for (auto &labelStruct : mLabels) { ++i;
+      for (auto i : mLabelsInView) {
+         const auto &labelStruct = mLabels[i];
          bool highlight = false;
 #ifdef EXPERIMENTAL_TRACK_PANEL_HIGHLIGHTING
          highlight = highlightTrack && target->GetLabelNum() == i;
@@ -875,13 +968,13 @@ void LabelTrack::Draw
    }
 
    // Draw the text and the label boxes.
-   { int i = -1; for (auto &labelStruct : mLabels) { ++i;
+   for (auto i : mLabelsInView) {
       if( mSelIndex==i)
          dc.SetBrush(AColor::labelTextEditBrush);
-      labelStruct.DrawText( dc, r );
+      mLabels[i].DrawText( dc, r );
       if( mSelIndex==i)
          dc.SetBrush(AColor::labelTextNormalBrush);
-   }}
+   }
 
    // Draw the cursor, if there is one.
    if( mDrawCursor && mSelIndex >=0 )
@@ -1143,6 +1236,68 @@ Track::Holder LabelTrack::Duplicate() const
    return std::make_unique<LabelTrack>( *this );
 }
 
+size_t LabelTrack::GetSpillableBytes() const
+{
+   size_t result = 0;
+   for (const auto &labelStruct : mLabels)
+      result += sizeof(LabelStruct) + labelStruct.title.length() * sizeof(wxChar);
+   return result;
+}
+
+// A count, then for each label four times and the title in UTF-8 with its
+// length, in native byte order, because only this session reads it
+bool LabelTrack::WriteSpill(wxFFile &file) const
+{
+   const uint32_t count = mLabels.size();
+   if (file.Write(&count, sizeof count) != sizeof count)
+      return false;
+   for (const auto &labelStruct : mLabels) {
+      const auto &region = labelStruct.selectedRegion;
+      const double times[] =
+         { region.t0(), region.t1(), region.f0(), region.f1() };
+      const auto title = labelStruct.title.utf8_str();
+      const uint32_t length = title.length();
+      if (file.Write(times, sizeof times) != sizeof times ||
+          file.Write(&length, sizeof length) != sizeof length ||
+          file.Write(title.data(), length) != length)
+         return false;
+   }
+   return true;
+}
+
+void LabelTrack::FreeSpilled()
+{
+   LabelArray{}.swap(mLabels);
+   InvalidateSpatialIndex();
+}
+
+bool LabelTrack::ReadSpill(wxFFile &file)
+{
+   uint32_t count;
+   if (file.Read(&count, sizeof count) != sizeof count)
+      return false;
+   LabelArray labels;
+   labels.reserve(count);
+   std::string title;
+   while (count--) {
+      double times[4];
+      uint32_t length;
+      if (file.Read(times, sizeof times) != sizeof times ||
+          file.Read(&length, sizeof length) != sizeof length)
+         return false;
+      title.resize(length);
+      if (length > 0 && file.Read(&title[0], length) != length)
+         return false;
+      SelectedRegion region{ times[0], times[1] };
+      region.setFrequencies(times[2], times[3]);
+      labels.push_back(
+         LabelStruct{ region, wxString::FromUTF8(title.data(), length) });
+   }
+   mLabels.swap(labels);
+   InvalidateSpatialIndex();
+   return true;
+}
+
 void LabelTrack::SetSelected(bool s)
 {
    Track::SetSelected(s);
@@ -1164,7 +1319,10 @@ void LabelTrack::OverGlyph(LabelTrackHit &hit, int x, int y) const
    hit.mMouseOverLabelLeft  = -1;
    hit.mMouseOverLabelRight = -1;
    hit.mEdge = 0;
-   { int i = -1; for (auto &labelStruct : mLabels) { ++i;
+   for (auto i : mLabelsInView) {
+      if (i >= (int)mLabels.size())
+         break;
+      const auto &labelStruct = mLabels[i];
       //over left or right selection bound
       //Check right bound first, since it is drawn after left bound,
       //so give it precedence for matching/highlighting.
@@ -1202,13 +1360,17 @@ void LabelTrack::OverGlyph(LabelTrackHit &hit, int x, int y) const
          result = 0;
       }
 
-   }}
+   }
    hit.mEdge = result;
 }
 
 int LabelTrack::OverATextBox(int xx, int yy) const
 {
-   for (int nn = (int)mLabels.size(); nn--;) {
+   for (auto iter = mLabelsInView.rbegin(); iter != mLabelsInView.rend();
+        ++iter) {
+      const auto nn = *iter;
+      if (nn >= (int)mLabels.size())
+         continue;
       const auto &labelStruct = mLabels[nn];
       if (OverTextBox(&labelStruct, xx, yy))
          return nn;
@@ -1429,6 +1591,7 @@ void LabelTrack::MayAdjustLabel
 {
    if( iLabel < 0 )
       return;
+   InvalidateSpatialIndex();
    LabelStruct &labelStruct = mLabels[ iLabel ];
 
    // Adjust the requested edge.
@@ -1454,6 +1617,7 @@ void LabelTrack::MayMoveLabel( int iLabel, int iEdge, double fNewTime)
 {
    if( iLabel < 0 )
       return;
+   InvalidateSpatialIndex();
    mLabels[ iLabel ].MoveLabel( iEdge, fNewTime );
 }
 
@@ -2290,6 +2454,7 @@ void LabelTrack::Import(wxTextFile & in)
 {
    int lines = in.GetLineCount();
 
+   InvalidateSpatialIndex();
    mLabels.clear();
    mLabels.reserve(lines);
 
@@ -2348,6 +2513,7 @@ bool LabelTrack::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
 
       LabelStruct l { selectedRegion, title };
       mLabels.push_back(l);
+      InvalidateSpatialIndex();
 
       return true;
    }
@@ -2371,6 +2537,7 @@ bool LabelTrack::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
                wxLogWarning(wxT("Project shows negative number of labels: %d"), nValue);
                return false;
             }
+            InvalidateSpatialIndex();
             mLabels.clear();
             mLabels.reserve(nValue);
          }
@@ -2433,6 +2600,7 @@ bool LabelTrack::Load(wxTextFile * in, DirManager * dirManager)
    if (!(in->GetNextLine().ToULong(&len)))
       return false;
 
+   InvalidateSpatialIndex();
    mLabels.clear();
    mLabels.reserve(len);
 
@@ -2551,6 +2719,7 @@ bool LabelTrack::PasteOver(double t, const Track * src)
       // THROW_INCONSISTENCY_EXCEPTION; // ?
       return false;
 
+   InvalidateSpatialIndex();
    int len = mLabels.size();
    int pos = 0;
 
@@ -2593,6 +2762,7 @@ bool LabelTrack::Repeat(double t0, double t1, int n)
       return false;
 
    double tLen = t1 - t0;
+   InvalidateSpatialIndex();
 
    // Insert space for the repetitions
    ShiftLabelsOnInsert(tLen * n, t1);
@@ -2640,6 +2810,7 @@ bool LabelTrack::Repeat(double t0, double t1, int n)
 
 void LabelTrack::Silence(double t0, double t1)
 {
+   InvalidateSpatialIndex();
    int len = mLabels.size();
 
    // mLabels may resize as we iterate, so use subscripting
@@ -2686,6 +2857,7 @@ void LabelTrack::Silence(double t0, double t1)
 
 void LabelTrack::InsertSilence(double t, double len)
 {
+   InvalidateSpatialIndex();
    for (auto &labelStruct: mLabels) {
       double t0 = labelStruct.getT0();
       double t1 = labelStruct.getT1();
@@ -2737,13 +2909,14 @@ int LabelTrack::AddLabel(const SelectedRegion &selectedRegion,
    LabelStruct l { selectedRegion, title };
    mInitialCursorPos = mCurrentCursorPos = title.length();
 
-   int len = mLabels.size();
-   int pos = 0;
-
-   while (pos < len && mLabels[pos].getT0() < selectedRegion.t0())
-      pos++;
+   // Before any label at the same time, as the labels are sorted
+   const auto where = std::lower_bound(mLabels.begin(), mLabels.end(),
+      selectedRegion.t0(),
+      [](const LabelStruct &label, double t){ return label.getT0() < t; });
+   const int pos = where - mLabels.begin();
 
-   mLabels.insert(mLabels.begin() + pos, l);
+   InvalidateSpatialIndex();
+   mLabels.insert(where, l);
 
    // restoreFocus is -2 e.g. from Nyquist label creation, when we should not
    // even lose the focus and open the label to edit in the first place.
@@ -2771,6 +2944,7 @@ int LabelTrack::AddLabel(const SelectedRegion &selectedRegion,
 void LabelTrack::DeleteLabel(int index)
 {
    wxASSERT((index < (int)mLabels.size()));
+   InvalidateSpatialIndex();
    mLabels.erase(mLabels.begin() + index);
    // IF we've deleted the selected label
    // THEN set no label selected.
@@ -2936,45 +3110,39 @@ bool LabelTrack::IsGoodLabelEditKey(const wxKeyEvent & evt)
 /// sort (with a linear search) is a reasonable choice.
 void LabelTrack::SortLabels( LabelTrackHit *pHit )
 {
-   const auto begin = mLabels.begin();
-   const auto nn = (int)mLabels.size();
-   int i = 1;
-   while (true)
-   {
-      // Find the next disorder
-      while (i < nn && mLabels[i - 1].getT0() <= mLabels[i].getT0())
-         ++i;
-      if (i >= nn)
-         break;
+   const auto earlier = [](const LabelStruct &a, const LabelStruct &b)
+      { return a.getT0() < b.getT0(); };
+   if (std::is_sorted(mLabels.begin(), mLabels.end(), earlier))
+      return;
 
-      // Where must element i sink to?  At most i - 1, maybe less
-      int j = i - 2;
-      while( (j >= 0) && (mLabels[j].getT0() > mLabels[i].getT0()) )
-         --j;
-      ++j;
-
-      // Now fix the disorder
-      std::rotate(
-         begin + j,
-         begin + i,
-         begin + i + 1
-      );
-
-      // Various indices need to be updated with the moved items...
-      auto update = [=](int &index) {
-         if( index <= i ) {
-            if( index == i )
-               index = j;
-            else if( index >= j)
-               ++index;
-         }
-      };
-      if ( pHit ) {
-         update( pHit->mMouseOverLabelLeft );
-         update( pHit->mMouseOverLabelRight );
-      }
-      update(mSelIndex);
-   }
+   // Sort a permutation, stably so that labels at the same time keep their
+   // order, and so that the indices held elsewhere can follow the labels
+   const int nn = mLabels.size();
+   std::vector<int> order(nn);
+   std::iota(order.begin(), order.end(), 0);
+   std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+      { return earlier(mLabels[a], mLabels[b]); });
+
+   LabelArray sorted;
+   sorted.reserve(nn);
+   std::vector<int> newIndices(nn);
+   for (int i = 0; i < nn; ++i) {
+      sorted.push_back(std::move(mLabels[order[i]]));
+      newIndices[order[i]] = i;
+   }
+   InvalidateSpatialIndex();
+   mLabels.swap(sorted);
+
+   // Various indices need to be updated with the moved items...
+   auto update = [&](int &index) {
+      if( index >= 0 && index < nn )
+         index = newIndices[index];
+   };
+   if ( pHit ) {
+      update( pHit->mMouseOverLabelLeft );
+      update( pHit->mMouseOverLabelRight );
+   }
+   update(mSelIndex);
 }
 
 wxString LabelTrack::GetTextOfLabels(double t0, double t1) const
@@ -162,6 +162,8 @@ class AUDACITY_DLL_API LabelTrack final : public Track
    using Holder = std::unique_ptr<LabelTrack>;
    Track::Holder Duplicate() const override;
 
+   size_t GetSpillableBytes() const override;
+
    void SetSelected(bool s) override;
 
    bool HandleXMLTag(const wxChar *tag, const wxChar **attrs) override;
@@ -273,6 +275,11 @@ class AUDACITY_DLL_API LabelTrack final : public Track
 
  public:
    void SortLabels(LabelTrackHit *pHit = nullptr);
+ protected:
+   bool WriteSpill(wxFFile &file) const override;
+   void FreeSpilled() override;
+   bool ReadSpill(wxFFile &file) override;
+
  private:
    void ShowContextMenu();
    void OnContextMenu(wxCommandEvent & evt);
@@ -305,6 +312,21 @@ class AUDACITY_DLL_API LabelTrack final : public Track
    void ComputeLayout(const wxRect & r, const ZoomInfo &zoomInfo) const;
    void ComputeTextPosition(const wxRect & r, int index) const;
 
+   // Fills mLabelsInView
+   void CollectLabelsInView(const wxRect & r, const ZoomInfo &zoomInfo) const;
+   // Call whenever labels are added, removed, reordered or retimed
+   void InvalidateSpatialIndex()
+   { mMaxEnds.clear(); mLabelsInView.clear(); }
+
+   // Maximum end times of ranges of mLabels, as a tree in the implicit
+   // layout of a heap, leaves in the second half; so that labels starting
+   // long before the view but ending in it are found without visiting all.
+   // Empty when it must be rebuilt.
+   mutable std::vector<double> mMaxEnds;
+   // Increasing indices of the labels that the last Draw laid out, which
+   // are all that hit tests consider
+   mutable std::vector<int> mLabelsInView;
+
 public:
    int FindCurrentCursorPosition(int xPos);
    void SetCurrentCursorPosition(int xPos);
@@ -0,0 +1,247 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LatencyCalibration.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "LatencyCalibration.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <wx/intl.h>
+#include <wx/string.h>
+#include <wx/utils.h>
+
+#include "portaudio.h"
+
+#include "AudioIO.h"
+#include "FFT.h"
+#include "MemoryX.h"
+#include "Prefs.h"
+
+namespace {
+
+const double RecordSecs = 2.0;
+const double ChirpSecs = 0.05;
+// Unequal gaps, so that the chirps correlate with each other only weakly
+const double ChirpStarts[] = { 0.25, 0.65, 1.15 };
+// Longer lags would take the last chirp past the end of the recording
+const double MaxLagSecs = 0.75;
+// How far the peak must stand above the rest of the correlation
+const double MinPeakToRms = 6.0;
+
+struct Probe
+{
+   const float *signal;
+   float *captured;
+   size_t length;
+   unsigned outChannels;
+   unsigned inChannels;
+   std::atomic<size_t> position{ 0 };
+};
+
+// Plays and records the same frame numbers together, so that a lag in the
+// recording is a lag relative to the callback
+int ProbeCallback(const void *inputBuffer, void *outputBuffer,
+                  unsigned long framesPerBuffer,
+                  const PaStreamCallbackTimeInfo *WXUNUSED(timeInfo),
+                  PaStreamCallbackFlags WXUNUSED(statusFlags), void *userData)
+{
+   auto &probe = *static_cast<Probe *>(userData);
+   auto output = static_cast<float *>(outputBuffer);
+   auto input = static_cast<const float *>(inputBuffer);
+   auto position = probe.position.load(std::memory_order_relaxed);
+
+   for (unsigned long i = 0; i < framesPerBuffer; ++i, ++position) {
+      const bool inside = position < probe.length;
+      const float sample = inside ? probe.signal[position] : 0.0f;
+      for (unsigned c = 0; c < probe.outChannels; ++c)
+         output[i * probe.outChannels + c] = sample;
+      if (inside && input) {
+         float sum = 0;
+         for (unsigned c = 0; c < probe.inChannels; ++c)
+            sum += input[i * probe.inChannels + c];
+         probe.captured[position] = sum;
+      }
+   }
+
+   probe.position.store(position, std::memory_order_release);
+   return position >= probe.length ? paComplete : paContinue;
+}
+
+void MakeSignal(float *signal, size_t length, double rate)
+{
+   std::fill(signal, signal + length, 0.0f);
+
+   const size_t chirpLength = ChirpSecs * rate;
+   const double f0 = 200.0;
+   const double f1 = std::min(16000.0, 0.4 * rate);
+   for (auto start : ChirpStarts) {
+      const size_t first = start * rate;
+      for (size_t i = 0; i < chirpLength && first + i < length; ++i) {
+         const double t = i / rate;
+         const double phase =
+            2 * M_PI * (f0 * t + (f1 - f0) * t * t / (2 * ChirpSecs));
+         // A Hann window keeps the ends from clicking
+         const double window = 0.5 - 0.5 * cos(2 * M_PI * i / chirpLength);
+         signal[first + i] = 0.5 * window * sin(phase);
+      }
+   }
+}
+
+// Lag of recorded behind played in samples, with a fraction from the
+// parabola through the peak, or a negative value if no clear peak
+double FindLag(const float *played, const float *recorded, size_t length,
+               size_t maxLag)
+{
+   size_t size = 1;
+   while (size < 2 * length)
+      size <<= 1;
+
+   Floats a{ size }, b{ size };
+   std::copy(recorded, recorded + length, a.get());
+   std::fill(a.get() + length, a.get() + size, 0.0f);
+   std::copy(played, played + length, b.get());
+   std::fill(b.get() + length, b.get() + size, 0.0f);
+
+   Floats ar{ size }, ai{ size }, br{ size }, bi{ size };
+   RealFFT(size, a.get(), ar.get(), ai.get());
+   RealFFT(size, b.get(), br.get(), bi.get());
+
+   // Multiplying by the conjugate correlates, rather than convolves
+   for (size_t i = 0; i < size; ++i) {
+      const float re = ar[i] * br[i] + ai[i] * bi[i];
+      const float im = ai[i] * br[i] - ar[i] * bi[i];
+      ar[i] = re;
+      ai[i] = im;
+   }
+   auto &correlation = a;
+   InverseRealFFT(size, ar.get(), ai.get(), correlation.get());
+
+   maxLag = std::min(maxLag, size - 2);
+   size_t peak = 0;
+   double sumSquares = 0;
+   for (size_t k = 0; k <= maxLag; ++k) {
+      sumSquares += correlation[k] * correlation[k];
+      if (correlation[k] > correlation[peak])
+         peak = k;
+   }
+   const double rms = sqrt(sumSquares / (maxLag + 1));
+   if (correlation[peak] <= 0 || correlation[peak] < MinPeakToRms * rms)
+      return -1;
+
+   double fraction = 0;
+   if (peak > 0) {
+      const double left = correlation[peak - 1];
+      const double middle = correlation[peak];
+      const double right = correlation[peak + 1];
+      const double denominator = left - 2 * middle + right;
+      if (denominator < 0)
+         fraction = 0.5 * (left - right) / denominator;
+   }
+   return peak + fraction;
+}
+
+}
+
+bool LatencyCalibration::Measure(
+   double rate, double &correctionMs, wxString &error)
+{
+   if (gAudioIO->IsBusy()) {
+      error = _("Stop playing, recording or monitoring first.");
+      return false;
+   }
+
+   const int playDevice = AudioIO::getPlayDevIndex();
+   const int recordDevice = AudioIO::getRecordDevIndex();
+   const PaDeviceInfo *playInfo =
+      playDevice < 0 ? nullptr : Pa_GetDeviceInfo(playDevice);
+   const PaDeviceInfo *recordInfo =
+      recordDevice < 0 ? nullptr : Pa_GetDeviceInfo(recordDevice);
+   if (!playInfo || !recordInfo ||
+       playInfo->maxOutputChannels < 1 || recordInfo->maxInputChannels < 1) {
+      error = _("The playback and recording devices could not be found.");
+      return false;
+   }
+
+   // Buffer as AudioIO does, since the lag depends on it
+   double latencyDuration = DEFAULT_LATENCY_DURATION;
+   gPrefs->Read(wxT("/AudioIO/LatencyDuration"), &latencyDuration);
+
+   PaStreamParameters playbackParameters{};
+   playbackParameters.device = playDevice;
+   playbackParameters.channelCount = std::min(2, playInfo->maxOutputChannels);
+   playbackParameters.sampleFormat = paFloat32;
+   playbackParameters.suggestedLatency = latencyDuration / 1000.0;
+
+   PaStreamParameters captureParameters{};
+   captureParameters.device = recordDevice;
+   captureParameters.channelCount = std::min(2, recordInfo->maxInputChannels);
+   captureParameters.sampleFormat = paFloat32;
+   captureParameters.suggestedLatency = latencyDuration / 1000.0;
+
+   const size_t length = RecordSecs * rate;
+   Floats signal{ length }, captured{ length };
+   MakeSignal(signal.get(), length, rate);
+   std::fill(captured.get(), captured.get() + length, 0.0f);
+
+   Probe probe;
+   probe.signal = signal.get();
+   probe.captured = captured.get();
+   probe.length = length;
+   probe.outChannels = playbackParameters.channelCount;
+   probe.inChannels = captureParameters.channelCount;
+
+   PaStream *stream = nullptr;
+   auto paError = Pa_OpenStream(&stream,
+      &captureParameters, &playbackParameters,
+      rate, paFramesPerBufferUnspecified, paClipOff | paDitherOff,
+      ProbeCallback, &probe);
+   if (paError == paNoError) {
+      auto closeStream = finally([&]{ Pa_CloseStream(stream); });
+      paError = Pa_StartStream(stream);
+      if (paError == paNoError) {
+         // Allow for some start-up time, but don't hang on a stuck device
+         for (int waited = 0;
+              Pa_IsStreamActive(stream) == 1 &&
+                 waited < 2000 + 2000 * RecordSecs;
+              waited += 50)
+            wxMilliSleep(50);
+         Pa_StopStream(stream);
+      }
+   }
+   if (paError != paNoError) {
+      error = wxString::Format(_("Could not open the devices: %s"),
+         wxString(wxSafeConvertMB2WX(Pa_GetErrorText(paError))));
+      return false;
+   }
+   if (probe.position.load(std::memory_order_acquire) < length) {
+      error = _("The devices stopped before the measurement was done.");
+      return false;
+   }
+
+   const float loudest = std::abs(*std::max_element(
+      captured.get(), captured.get() + length,
+      [](float x, float y){ return std::abs(x) < std::abs(y); }));
+   if (loudest < 1e-4) {
+      error = _("Nothing was recorded.  Connect the output to the input, or turn up the recording level.");
+      return false;
+   }
+
+   const auto lag = FindLag(signal.get(), captured.get(), length,
+      (size_t)(MaxLagSecs * rate));
+   if (lag < 0) {
+      error = _("The test signal could not be found in the recording.  Reduce background noise, or connect the output to the input.");
+      return false;
+   }
+
+   correctionMs = -1000.0 * lag / rate;
+   return true;
+}
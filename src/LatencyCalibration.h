@@ -0,0 +1,42 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LatencyCalibration.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class LatencyCalibration
+\brief Measures the time from a sample leaving the playback device to it
+arriving again at the recording device, through a loopback cable or a
+microphone near the speakers.
+
+  A train of chirps is played through the devices chosen in preferences,
+  while the input is recorded in the same full duplex stream, so that the
+  lag found is relative to the callback, as AudioIO's recording schedule
+  is.  The lag is the peak of the cross-correlation of what was played
+  with what was recorded, computed with the FFT.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_LATENCY_CALIBRATION__
+#define __AUDACITY_LATENCY_CALIBRATION__
+
+#include "Audacity.h"
+
+class wxString;
+
+class LatencyCalibration
+{
+public:
+   /// Plays and records at rate, blocking for a few seconds.  On success
+   /// sets correctionMs to the time shift for recording, in milliseconds,
+   /// negative like /AudioIO/LatencyCorrection.  Otherwise returns false,
+   /// with a message for the user.
+   static bool Measure(double rate, double &correctionMs, wxString &error);
+};
+
+#endif
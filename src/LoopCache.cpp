@@ -0,0 +1,151 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LoopCache.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "LoopCache.h"
+
+#include <algorithm>
+#include <math.h>
+
+const double LoopCache::CrossfadeSeconds = 0.010;
+
+void LoopCache::Start(
+   size_t nChannels, double rate, double frames, bool atLoopStart )
+{
+   Stop();
+   mRate = rate;
+   if ( nChannels == 0 || !( frames >= 1 ) ||
+        frames * nChannels > MaxSamples )
+      return;
+
+   mChannels.resize( nChannels );
+   // Some slack for the rounding of the chunks
+   mExpectedFrames = static_cast< size_t >( frames + 1.0 + rate / 100 );
+   if ( atLoopStart )
+      BeginCapture();
+   else
+      mState = Waiting;
+}
+
+void LoopCache::Stop()
+{
+   mState = Off;
+   mPosition = 0;
+   mExpectedFrames = 0;
+   // Give back the memory, as clear() would not
+   std::vector< std::vector< float > >().swap( mChannels );
+   mInvalidated.store( false );
+}
+
+void LoopCache::BeginCapture()
+{
+   for ( auto &channel : mChannels ) {
+      channel.clear();
+      channel.reserve( mExpectedFrames );
+   }
+   mPosition = 0;
+   mState = Capturing;
+}
+
+bool LoopCache::Wrap( const Preroll &preroll )
+{
+   const bool invalidated = mInvalidated.exchange( false );
+   switch ( mState ) {
+   case Off:
+      return true;
+   case Waiting:
+      BeginCapture();
+      return true;
+   case Capturing:
+   case Ready:
+      if ( invalidated ) {
+         // Some of the pass may be older than the edit
+         BeginCapture();
+         return true;
+      }
+      if ( mState == Capturing ) {
+         Finish( preroll );
+         mState = Ready;
+      }
+      mPosition = 0;
+      return false;
+   }
+   return true;
+}
+
+void LoopCache::Seek( double frame )
+{
+   if ( mState == Capturing ) {
+      // The pass is not whole now; take the next one
+      for ( auto &channel : mChannels )
+         channel.clear();
+      mPosition = 0;
+      mState = Waiting;
+   }
+   else if ( mState == Ready ) {
+      const auto length = mChannels.empty() ? 0 : mChannels[0].size();
+      mPosition = std::min< double >( length, std::max( 0.0, frame ) );
+   }
+}
+
+void LoopCache::Capture(
+   size_t channel, const float *samples, size_t length, size_t frames )
+{
+   auto &buffer = mChannels[ channel ];
+   buffer.insert( buffer.end(), samples, samples + length );
+   if ( frames > length )
+      buffer.resize( buffer.size() + ( frames - length ), 0.0f );
+}
+
+size_t LoopCache::Read(
+   size_t channel, size_t frames, const float *&samples ) const
+{
+   const auto &buffer = mChannels[ channel ];
+   const auto position = std::min( mPosition, buffer.size() );
+   samples = buffer.data() + position;
+   return std::min( frames, buffer.size() - position );
+}
+
+void LoopCache::Advance( size_t frames )
+{
+   if ( mState == Capturing ) {
+      mPosition += frames;
+      if ( mPosition * mChannels.size() > MaxSamples )
+         // Longer than it seemed, as with a time track; play from the mixers
+         Stop();
+   }
+   else if ( mState == Ready )
+      mPosition += frames;
+}
+
+void LoopCache::Finish( const Preroll &preroll )
+{
+   const auto length = mChannels.empty() ? 0 : mChannels[0].size();
+   const auto frames = std::min< size_t >(
+      lrint( CrossfadeSeconds * mRate ), length / 2 );
+   if ( frames == 0 )
+      return;
+
+   // Raised cosine gains that sum to one, because the audio on both sides
+   // of the seam is of the same track, and correlated
+   std::vector< float > gains( frames );
+   for ( size_t ii = 0; ii < frames; ++ii )
+      gains[ii] = 0.5 - 0.5 * cos( M_PI * ( ii + 0.5 ) / frames );
+
+   std::vector< float > before( frames );
+   for ( size_t cc = 0; cc < mChannels.size(); ++cc ) {
+      if ( !preroll( cc, before.data(), frames ) )
+         continue;
+      const auto tail = mChannels[cc].data() + ( length - frames );
+      for ( size_t ii = 0; ii < frames; ++ii )
+         tail[ii] += gains[ii] * ( before[ii] - tail[ii] );
+   }
+}
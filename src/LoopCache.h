@@ -0,0 +1,108 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LoopCache.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class LoopCache
+\brief Keeps one pass of looped play in memory, as the playback mixers
+made it, so that later passes are played from memory and not read again
+from the disk.
+
+  The first whole pass, from the start of the loop, is captured from the
+  mixers, before realtime effects.  At its end, the last few milliseconds
+  are crossfaded into the audio just before the start of the loop, so that
+  the seam continues as the track would.  Later passes read that copy,
+  until it is invalidated by an edit; then the next pass comes from the
+  mixers again, and is captured again.
+
+  All but Invalidate() are for the audio thread.  The channels may be
+  captured or read on different threads, but the positions are advanced
+  by the audio thread, after each chunk.
+
+  A loop with more samples, over all channels, than MaxSamples is played
+  from the mixers, as before.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_LOOP_CACHE__
+#define __AUDACITY_LOOP_CACHE__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class LoopCache
+{
+public:
+   // 64 MB of floats:  three minutes of stereo at 44100 Hz
+   static const size_t MaxSamples = 16 * 1024 * 1024;
+   // Of the crossfade at the seam
+   static const double CrossfadeSeconds;
+
+   enum State {
+      // Not looping, or the loop is too long
+      Off,
+      // For the start of a pass
+      Waiting,
+      // Taking a pass from the mixers
+      Capturing,
+      // Playing from memory
+      Ready,
+   };
+
+   // Fill buffer with the frames of the channel just before the start of
+   // the loop; or return false, if there should be no crossfade
+   using Preroll =
+      std::function< bool( size_t channel, float *buffer, size_t frames ) >;
+
+   // For a stream, before its first pass, which starts at the start of
+   // the loop if atLoopStart; frames is the expected length of one pass
+   void Start( size_t nChannels, double rate, double frames,
+               bool atLoopStart );
+   // Free the memory, at the end of the stream
+   void Stop();
+
+   // From any thread, when the tracks are edited; takes effect at the end
+   // of the pass
+   void Invalidate() { mInvalidated.store( true ); }
+
+   State GetState() const { return mState; }
+
+   // At the end of each pass.  Returns true if the next pass is to come
+   // from the mixers, which then must start again from the loop start
+   bool Wrap( const Preroll &preroll );
+   // When the play position jumps to the given frame of the pass
+   void Seek( double frame );
+
+   // While Capturing:  append the frames given to the mixer, of which the
+   // first length came from it, and the rest are silence
+   void Capture( size_t channel,
+                 const float *samples, size_t length, size_t frames );
+   // While Ready:  point samples at the frames of the channel from the
+   // play position, and return how many there are, up to frames
+   size_t Read( size_t channel, size_t frames, const float *&samples ) const;
+   // After the chunk of frames was captured or read, in all channels
+   void Advance( size_t frames );
+
+private:
+   void BeginCapture();
+   void Finish( const Preroll &preroll );
+
+   State mState { Off };
+   double mRate { 0 };
+   size_t mExpectedFrames { 0 };
+   std::vector< std::vector< float > > mChannels;
+   // Frames of the pass, captured or read so far
+   size_t mPosition { 0 };
+   std::atomic< bool > mInvalidated{ false };
+};
+
+#endif
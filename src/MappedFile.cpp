@@ -0,0 +1,163 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MappedFile.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "MappedFile.h"
+
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile( const wxString &path )
+{
+#ifdef __WXMSW__
+   HANDLE file = ::CreateFileW( path.wc_str(), GENERIC_READ,
+      FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( file == INVALID_HANDLE_VALUE )
+      return;
+
+   LARGE_INTEGER size;
+   if ( ::GetFileSizeEx( file, &size ) && size.QuadPart > 0 &&
+        (unsigned long long)size.QuadPart <= (size_t)-1 ) {
+      // The mapping keeps the file open after the handle is closed
+      mMapping =
+         ::CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL );
+      if ( mMapping ) {
+         mData = (const char *)
+            ::MapViewOfFile( (HANDLE)mMapping, FILE_MAP_READ, 0, 0, 0 );
+         if ( mData )
+            mSize = size.QuadPart;
+         else {
+            ::CloseHandle( (HANDLE)mMapping );
+            mMapping = nullptr;
+         }
+      }
+   }
+   ::CloseHandle( file );
+#else
+   int fd = ::open( (const char *)path.fn_str(), O_RDONLY );
+   if ( fd < 0 )
+      return;
+
+   struct stat st;
+   if ( ::fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+      // The mapping keeps the file open after the descriptor is closed
+      void *data = ::mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+      if ( data != MAP_FAILED ) {
+         mData = (const char *)data;
+         mSize = st.st_size;
+      }
+   }
+   ::close( fd );
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+   if ( !mData )
+      return;
+#ifdef __WXMSW__
+   ::UnmapViewOfFile( mData );
+   ::CloseHandle( (HANDLE)mMapping );
+#else
+   ::munmap( (void *)mData, mSize );
+#endif
+}
+
+MappedFileCache::MappedFileCache( size_t budgetBytes )
+   : mBudget{ budgetBytes }
+{
+}
+
+void MappedFileCache::SetBudget( size_t budgetBytes )
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   mBudget = budgetBytes;
+   Evict();
+}
+
+MappedFilePtr MappedFileCache::Get( const wxString &path )
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      if ( mBudget == 0 )
+         return {};
+
+      auto found = mIndex.find( path );
+      if ( found != mIndex.end() ) {
+         // Move to the front
+         mList.splice( mList.begin(), mList, found->second );
+         ++mHits;
+         return mList.front().pFile;
+      }
+      ++mMisses;
+   }
+
+   // Map outside of the lock; another thread might map the same file
+   // meanwhile, which is harmless
+   auto pFile = std::make_shared< const MappedFile >( path );
+   if ( !pFile->IsOk() )
+      return {};
+
+   std::lock_guard< std::mutex > lock{ mMutex };
+   auto found = mIndex.find( path );
+   if ( found != mIndex.end() ) {
+      mList.splice( mList.begin(), mList, found->second );
+      return mList.front().pFile;
+   }
+   mList.push_front( { path, pFile } );
+   mIndex[ path ] = mList.begin();
+   mTotal += pFile->GetSize();
+   Evict();
+   return pFile;
+}
+
+void MappedFileCache::Invalidate( const wxString &path )
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   auto found = mIndex.find( path );
+   if ( found != mIndex.end() ) {
+      mTotal -= found->second->pFile->GetSize();
+      mList.erase( found->second );
+      mIndex.erase( found );
+   }
+}
+
+void MappedFileCache::Clear()
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   mIndex.clear();
+   mList.clear();
+   mTotal = 0;
+}
+
+void MappedFileCache::Evict()
+{
+   // Caller holds the lock
+   while ( mTotal > mBudget && !mList.empty() ) {
+      auto &entry = mList.back();
+      mTotal -= entry.pFile->GetSize();
+      mIndex.erase( entry.path );
+      mList.pop_back();
+      ++mEvictions;
+   }
+}
+
+auto MappedFileCache::GetStatistics() -> Statistics
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   return { mHits, mMisses, mEvictions, mTotal, mBudget, mIndex.size() };
+}
@@ -0,0 +1,104 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MappedFile.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class MappedFile
+\brief A whole file mapped read-only into memory.
+
+\class MappedFileCache
+\brief A bounded, least-recently-used set of MappedFile objects, keyed by
+path, that may be used from any thread.
+
+  Mappings are shared, so one that is evicted stays valid for readers
+  still holding it.  Before a file is removed, rewritten or renamed, its
+  mapping must be invalidated, because some systems (Windows) forbid those
+  operations on mapped files.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_MAPPED_FILE__
+#define __AUDACITY_MAPPED_FILE__
+
+#include "MemoryX.h"
+#include <wx/string.h>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+class MappedFile
+{
+public:
+   // Fails (IsOk() returns false) if the file is missing or empty
+   explicit MappedFile( const wxString &path );
+   ~MappedFile();
+
+   MappedFile( const MappedFile& ) PROHIBITED;
+   MappedFile &operator= ( const MappedFile& ) PROHIBITED;
+
+   bool IsOk() const { return mData != nullptr; }
+   const char *GetData() const { return mData; }
+   size_t GetSize() const { return mSize; }
+
+private:
+   const char *mData { nullptr };
+   size_t mSize { 0 };
+#ifdef __WXMSW__
+   void *mMapping { nullptr };
+#endif
+};
+
+using MappedFilePtr = std::shared_ptr< const MappedFile >;
+
+class MappedFileCache
+{
+public:
+   explicit MappedFileCache( size_t budgetBytes );
+
+   size_t GetBudget() const { return mBudget; }
+   // Evicts as needed to fit the NEW budget
+   void SetBudget( size_t budgetBytes );
+
+   // Returns the mapping, creating it if necessary, or null if the file
+   // can't be mapped
+   MappedFilePtr Get( const wxString &path );
+
+   void Invalidate( const wxString &path );
+   void Clear();
+
+   // Counts since the cache was made, for diagnostics
+   struct Statistics {
+      unsigned long long hits, misses, evictions;
+      size_t residentBytes, budgetBytes, files;
+   };
+   Statistics GetStatistics();
+
+private:
+   void Evict();
+
+   struct Entry {
+      wxString path;
+      MappedFilePtr pFile;
+   };
+   using List = std::list< Entry >;
+
+   std::mutex mMutex;
+   // Most recently used first
+   List mList;
+   std::unordered_map< wxString, List::iterator > mIndex;
+   size_t mBudget;
+   size_t mTotal { 0 };
+
+   unsigned long long mHits { 0 };
+   unsigned long long mMisses { 0 };
+   unsigned long long mEvictions { 0 };
+};
+
+#endif
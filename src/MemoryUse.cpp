@@ -0,0 +1,63 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MemoryUse.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "MemoryUse.h"
+
+#include <atomic>
+
+namespace {
+   std::atomic< unsigned long long > sLive[ MemoryUse::nSubsystems ];
+   std::atomic< unsigned long long > sPeak[ MemoryUse::nSubsystems ];
+}
+
+wxString MemoryUse::GetName( Subsystem subsystem )
+{
+   switch ( subsystem ) {
+      case BlockArrays:     return wxT("BlockArrays");
+      case Envelopes:       return wxT("Envelopes");
+      case SummaryPyramids: return wxT("SummaryPyramids");
+      case WaveDisplay:     return wxT("WaveDisplay");
+      case Spectrograms:    return wxT("Spectrograms");
+      default:              return {};
+   }
+}
+
+auto MemoryUse::GetStatistics( Subsystem subsystem ) -> Statistics
+{
+   return { sLive[ subsystem ].load( std::memory_order_relaxed ),
+            sPeak[ subsystem ].load( std::memory_order_relaxed ) };
+}
+
+void MemoryUse::Add( Subsystem subsystem, size_t bytes )
+{
+   const auto live = sLive[ subsystem ].fetch_add(
+      bytes, std::memory_order_relaxed ) + bytes;
+   auto &peak = sPeak[ subsystem ];
+   auto oldPeak = peak.load( std::memory_order_relaxed );
+   while ( oldPeak < live &&
+      !peak.compare_exchange_weak( oldPeak, live, std::memory_order_relaxed ) )
+      ;
+}
+
+void MemoryUse::Remove( Subsystem subsystem, size_t bytes )
+{
+   sLive[ subsystem ].fetch_sub( bytes, std::memory_order_relaxed );
+}
+
+void MemoryUse::Tracker::Set( size_t bytes )
+{
+   if ( bytes > mBytes )
+      Add( mSubsystem, bytes - mBytes );
+   else if ( bytes < mBytes )
+      Remove( mSubsystem, mBytes - bytes );
+   mBytes = bytes;
+}
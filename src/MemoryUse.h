@@ -0,0 +1,107 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MemoryUse.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class MemoryUse
+\brief Counts the bytes that some subsystems hold in memory, and their
+peaks, for diagnostics.
+
+  Containers count their storage with MemoryUse::Allocator.  Other holders
+  of memory, such as the display caches of clips, report their sizes with a
+  MemoryUse::Tracker member.  The counts are atomic, so that any thread may
+  change them.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_MEMORY_USE__
+#define __AUDACITY_MEMORY_USE__
+
+#include "Audacity.h"
+#include <cstddef>
+#include <memory>
+#include <wx/string.h>
+
+class MemoryUse
+{
+public:
+   enum Subsystem {
+      BlockArrays,      // of the sequences of all tracks, and undo states
+      Envelopes,        // points of the envelopes of all clips
+      SummaryPyramids,  // block summaries of sequences, reduced
+      WaveDisplay,      // min, max and rms columns of clips
+      Spectrograms,     // spectrum columns and pixel values of clips
+      nSubsystems
+   };
+
+   static wxString GetName( Subsystem subsystem );
+
+   struct Statistics {
+      unsigned long long live, peak; // bytes
+   };
+   static Statistics GetStatistics( Subsystem subsystem );
+
+   static void Add( Subsystem subsystem, size_t bytes );
+   static void Remove( Subsystem subsystem, size_t bytes );
+
+   // Reports the size of one holder; a copy counts again
+   class Tracker
+   {
+   public:
+      explicit Tracker( Subsystem subsystem ) : mSubsystem{ subsystem } {}
+      Tracker( const Tracker &other ) : mSubsystem{ other.mSubsystem }
+         { Set( other.mBytes ); }
+      Tracker &operator= ( const Tracker &other )
+      {
+         if ( this != &other ) {
+            Set( 0 );
+            mSubsystem = other.mSubsystem;
+            Set( other.mBytes );
+         }
+         return *this;
+      }
+      ~Tracker() { Set( 0 ); }
+
+      void Set( size_t bytes );
+
+   private:
+      Subsystem mSubsystem;
+      size_t mBytes { 0 };
+   };
+
+   // A std::allocator that counts what it holds
+   template< typename T, Subsystem S > class Allocator
+   {
+   public:
+      using value_type = T;
+      template< typename U > struct rebind { using other = Allocator< U, S >; };
+
+      Allocator() = default;
+      template< typename U > Allocator( const Allocator< U, S >& ) {}
+
+      T *allocate( size_t n )
+      {
+         auto result = std::allocator< T >{}.allocate( n );
+         Add( S, n * sizeof( T ) );
+         return result;
+      }
+      void deallocate( T *p, size_t n )
+      {
+         Remove( S, n * sizeof( T ) );
+         std::allocator< T >{}.deallocate( p, n );
+      }
+
+      template< typename U >
+      bool operator== ( const Allocator< U, S >& ) const { return true; }
+      template< typename U >
+      bool operator!= ( const Allocator< U, S >& ) const { return false; }
+   };
+};
+
+#endif
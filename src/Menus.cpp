@@ -61,8 +61,13 @@ simplifies construction of menu items.
 #include "AudacityLogger.h"
 #include "AudioIO.h"
 #include "Dependencies.h"
+#include "DirManager.h"
 #include "float_cast.h"
 #include "LabelTrack.h"
+#include "MappedFile.h"
+#include "SoundFileCache.h"
+#include "BlockReadBatch.h"
+#include "MemoryUse.h"
 #ifdef USE_MIDI
 #include "import/ImportMIDI.h"
 #endif // USE_MIDI
@@ -81,6 +86,7 @@ simplifies construction of menu items.
 #include "PluginManager.h"
 #include "Prefs.h"
 #include "Printing.h"
+#include "Profiler.h"
 #ifdef USE_MIDI
 #include "NoteTrack.h"
 #endif // USE_MIDI
@@ -91,6 +97,7 @@ simplifies construction of menu items.
 #include "Benchmark.h"
 #include "Screenshot.h"
 #include "ondemand/ODManager.h"
+#include "ondemand/ODResampleTask.h"
 
 #include "BatchProcessDialog.h"
 #include "BatchCommands.h"
@@ -119,6 +126,7 @@ simplifies construction of menu items.
 #include "SplashDialog.h"
 #include "widgets/HelpSystem.h"
 #include "DeviceManager.h"
+#include "LatencyCalibration.h"
 
 #include "UndoManager.h"
 #include "WaveTrack.h"
@@ -930,6 +938,9 @@ void AudacityProject::CreateMenusAndCommands()
       c->AddItem(wxT("RescanDevices"), XXO("R&escan Audio Devices"), FN(OnRescanDevices),
                  AudioIONotBusyFlag | CanStopAudioStreamFlag,
                  AudioIONotBusyFlag | CanStopAudioStreamFlag);
+      c->AddItem(wxT("MeasureLatency"), XXO("Measure Recording &Latency..."), FN(OnMeasureLatency),
+                 AudioIONotBusyFlag | CanStopAudioStreamFlag,
+                 AudioIONotBusyFlag | CanStopAudioStreamFlag);
 
       c->BeginSubMenu(_("Transport &Options"));
       // Sound Activated recording options
@@ -1301,6 +1312,10 @@ void AudacityProject::CreateMenusAndCommands()
       c->AddItem(wxT("DeviceInfo"), XXO("Au&dio Device Info..."), FN(OnAudioDeviceInfo),
          AudioIONotBusyFlag,
          AudioIONotBusyFlag);
+      // Useful while playing or recording, so always enabled
+      c->AddItem(wxT("AudioIOTelemetry"), XXO("Audio I/O &Telemetry..."), FN(OnAudioIOTelemetry),
+         AlwaysEnabledFlag,
+         AlwaysEnabledFlag);
 #ifdef EXPERIMENTAL_MIDI_OUT
       c->AddItem(wxT("MidiDeviceInfo"), XXO("&MIDI Device Info..."), FN(OnMidiDeviceInfo),
          AudioIONotBusyFlag,
@@ -1308,6 +1323,9 @@ void AudacityProject::CreateMenusAndCommands()
 #endif
 
       c->AddItem(wxT("Log"), XXO("Show &Log..."), FN(OnShowLog));
+      c->AddCheck(wxT("RecordProfile"), XXO("&Record Profile"),
+                  FN(OnRecordProfile), Profiler::IsRecording());
+      c->AddItem(wxT("SaveProfile"), XXO("Sa&ve Profile..."), FN(OnSaveProfile));
 
 #if defined(EXPERIMENTAL_CRASH_REPORT)
       c->AddItem(wxT("CrashReport"), XXO("&Generate Support Data..."), FN(OnCrashReport));
@@ -2178,6 +2196,99 @@ CommandFlag AudacityProject::GetFocusedFrame()
    return AlwaysEnabledFlag;
 }
 
+CommandFlag AudacityProject::GetTrackFlags()
+{
+   auto &cache = mTrackFlagsCache;
+   const auto tracks = GetTracks();
+   const auto trackGeneration = tracks->GetGeneration();
+   const auto undoGeneration = GetUndoManager()->GetGeneration();
+
+   // While audio is busy, recording may lengthen the tracks without any
+   // change of generation, so visit them each time
+   const bool busy = gAudioIO->IsBusy();
+
+   if (busy || !cache.valid || cache.tracks != tracks ||
+       cache.trackGeneration != trackGeneration ||
+       cache.undoGeneration != undoGeneration) {
+      auto flags = AlwaysEnabledFlag;
+      cache.labelTracks.clear();
+
+      TrackListIterator iter(tracks);
+      Track *t = iter.First();
+      while (t) {
+         flags |= TracksExistFlag;
+         if (t->GetKind() == Track::Label) {
+            flags |= LabelTracksExistFlag;
+            if (t->GetSelected())
+               flags |= TracksSelectedFlag;
+            cache.labelTracks.push_back(static_cast<LabelTrack*>(t));
+         }
+         else if (t->GetKind() == Track::Wave) {
+            flags |= WaveTracksExistFlag;
+            flags |= PlayableTracksExistFlag;
+            if (t->GetSelected()) {
+               flags |= TracksSelectedFlag;
+               if (t->GetLinked()) {
+                  flags |= StereoRequiredFlag;
+               }
+               else {
+                  flags |= WaveTracksSelectedFlag;
+                  flags |= AudioTracksSelectedFlag;
+               }
+            }
+            if( t->GetEndTime() > t->GetStartTime() )
+               flags |= HasWaveDataFlag;
+         }
+#if defined(USE_MIDI)
+         else if (t->GetKind() == Track::Note) {
+            NoteTrack *nt = (NoteTrack *) t;
+
+            flags |= NoteTracksExistFlag;
+#ifdef EXPERIMENTAL_MIDI_OUT
+            flags |= PlayableTracksExistFlag;
+#endif
+
+            if (nt->GetSelected()) {
+               flags |= TracksSelectedFlag;
+               flags |= NoteTracksSelectedFlag;
+               flags |= AudioTracksSelectedFlag; // even if not EXPERIMENTAL_MIDI_OUT
+            }
+         }
+#endif
+         t = iter.Next();
+      }
+
+      cache.tracks = tracks;
+      cache.trackGeneration = trackGeneration;
+      cache.undoGeneration = undoGeneration;
+      cache.valid = !busy;
+      cache.flags = flags;
+   }
+
+   auto flags = cache.flags;
+
+   // Labels, and the editing of their text, change with no new generation,
+   // and the selected region with none at all
+   for (auto lt : cache.labelTracks) {
+      if (lt->GetSelected() && !(flags & LabelsSelectedFlag)) {
+         for (int i = 0; i < lt->GetNumLabels(); i++) {
+            const LabelStruct *ls = lt->GetLabel(i);
+            if (ls->getT0() >= mViewInfo.selectedRegion.t0() &&
+                ls->getT1() <= mViewInfo.selectedRegion.t1()) {
+               flags |= LabelsSelectedFlag;
+               break;
+            }
+         }
+      }
+
+      if (lt->IsTextSelected()) {
+         flags |= CutCopyAvailableFlag;
+      }
+   }
+
+   return flags;
+}
+
 CommandFlag AudacityProject::GetUpdateFlags(bool checkActive)
 {
    // This method determines all of the flags that determine whether
@@ -2216,65 +2327,7 @@ CommandFlag AudacityProject::GetUpdateFlags(bool checkActive)
    if (!mViewInfo.selectedRegion.isPoint())
       flags |= TimeSelectedFlag;
 
-   TrackListIterator iter(GetTracks());
-   Track *t = iter.First();
-   while (t) {
-      flags |= TracksExistFlag;
-      if (t->GetKind() == Track::Label) {
-         LabelTrack *lt = (LabelTrack *) t;
-
-         flags |= LabelTracksExistFlag;
-
-         if (lt->GetSelected()) {
-            flags |= TracksSelectedFlag;
-            for (int i = 0; i < lt->GetNumLabels(); i++) {
-               const LabelStruct *ls = lt->GetLabel(i);
-               if (ls->getT0() >= mViewInfo.selectedRegion.t0() &&
-                   ls->getT1() <= mViewInfo.selectedRegion.t1()) {
-                  flags |= LabelsSelectedFlag;
-                  break;
-               }
-            }
-         }
-
-         if (lt->IsTextSelected()) {
-            flags |= CutCopyAvailableFlag;
-         }
-      }
-      else if (t->GetKind() == Track::Wave) {
-         flags |= WaveTracksExistFlag;
-         flags |= PlayableTracksExistFlag;
-         if (t->GetSelected()) {
-            flags |= TracksSelectedFlag;
-            if (t->GetLinked()) {
-               flags |= StereoRequiredFlag;
-            }
-            else {
-               flags |= WaveTracksSelectedFlag;
-               flags |= AudioTracksSelectedFlag;
-            }
-         }
-         if( t->GetEndTime() > t->GetStartTime() )
-            flags |= HasWaveDataFlag;
-      }
-#if defined(USE_MIDI)
-      else if (t->GetKind() == Track::Note) {
-         NoteTrack *nt = (NoteTrack *) t;
-
-         flags |= NoteTracksExistFlag;
-#ifdef EXPERIMENTAL_MIDI_OUT
-         flags |= PlayableTracksExistFlag;
-#endif
-
-         if (nt->GetSelected()) {
-            flags |= TracksSelectedFlag;
-            flags |= NoteTracksSelectedFlag;
-            flags |= AudioTracksSelectedFlag; // even if not EXPERIMENTAL_MIDI_OUT
-         }
-      }
-#endif
-      t = iter.Next();
-   }
+   flags |= GetTrackFlags();
 
    if((msClipT1 - msClipT0) > 0.0)
       flags |= ClipboardFlag;
@@ -4739,7 +4792,9 @@ void AudacityProject::OnClose(const CommandContext &WXUNUSED(context) )
 
 void AudacityProject::OnSave(const CommandContext &WXUNUSED(context) )
 {
-   Save();
+   // Saving again must include any changes made since the last save began
+   WaitForBackgroundSave();
+   SaveInBackground();
 }
 
 void AudacityProject::OnSaveAs(const CommandContext &WXUNUSED(context) )
@@ -7192,10 +7247,10 @@ void AudacityProject::OnImport(const CommandContext &WXUNUSED(context) )
       wxString fileName = selectedFiles[ff];
 
       FileNames::UpdateDefaultPath(FileNames::Operation::Open, fileName);
-
-      Import(fileName);
    }
 
+   ImportFiles(selectedFiles);
+
    ZoomAfterImport(nullptr);
 }
 
@@ -8475,6 +8530,33 @@ void AudacityProject::OnRescanDevices(const CommandContext &WXUNUSED(context) )
    DeviceManager::Instance()->Rescan();
 }
 
+void AudacityProject::OnMeasureLatency(const CommandContext &WXUNUSED(context) )
+{
+   const wxString title = _("Measure Recording Latency");
+   if (AudacityMessageBox(
+         _("Audacity will play a short test signal and record it, to find how late recordings arrive.\n\nConnect the playback output to the recording input, or put the microphone near the speakers, then click OK."),
+         title, wxOK | wxCANCEL | wxICON_INFORMATION, this) != wxOK)
+      return;
+
+   double correctionMs;
+   wxString error;
+   bool measured;
+   {
+      wxBusyCursor busy;
+      measured = LatencyCalibration::Measure(GetRate(), correctionMs, error);
+   }
+   if (!measured) {
+      AudacityMessageBox(error, title, wxOK | wxICON_ERROR, this);
+      return;
+   }
+
+   DeviceManager::Instance()->SetMeasuredLatency(correctionMs);
+   AudacityMessageBox(
+      wxString::Format(_("Recordings through these devices arrive %.1f milliseconds late.  From now on they will be shifted by that much, instead of by the time shift in Devices preferences."),
+         -correctionMs),
+      title, wxOK | wxICON_INFORMATION, this);
+}
+
 int AudacityProject::DialogForLabelName(const wxString& initialValue, wxString& value)
 {
    wxPoint position = mTrackPanel->FindTrackRect(mTrackPanel->GetFocusedTrack(), false).GetBottomLeft();
@@ -8888,10 +8970,69 @@ void AudacityProject::OnShowLog(const CommandContext &WXUNUSED(context) )
 {
    AudacityLogger *logger = wxGetApp().GetLogger();
    if (logger) {
+      // Counters are logged only when asked for
+      const auto stats = WaveTrackCache::GetStatistics();
+      wxLogMessage(wxT("Track sample cache: %llu hits, %llu misses, %llu blocks prefetched"),
+                   stats.hits, stats.misses, stats.prefetches);
+      const auto mapped = DirManager::GetMappedFileCache().GetStatistics();
+      const auto lookups = mapped.hits + mapped.misses;
+      wxLogMessage(wxT("Mapped block file cache: %llu hits (%.1f%%), %llu misses, %llu evictions, %llu files using %llu of %llu MB"),
+                   mapped.hits,
+                   lookups ? 100.0 * mapped.hits / lookups : 0.0,
+                   mapped.misses, mapped.evictions,
+                   (unsigned long long)mapped.files,
+                   (unsigned long long)(mapped.residentBytes >> 20),
+                   (unsigned long long)(mapped.budgetBytes >> 20));
+      const auto aliased = DirManager::GetSoundFileCache().GetStatistics();
+      wxLogMessage(wxT("Open aliased files: %llu hits, %llu misses, %llu reopened, %llu evictions, %llu of %llu open"),
+                   aliased.hits, aliased.misses, aliased.reopens,
+                   aliased.evictions,
+                   (unsigned long long)aliased.idle,
+                   (unsigned long long)aliased.capacity);
+      const auto batches = BlockReadBatch::GetStatistics();
+      wxLogMessage(wxT("Batched block reads: %llu batches of %llu reads, %llu failed"),
+                   batches.batches, batches.reads, batches.failures);
+      for (int ii = 0; ii < MemoryUse::nSubsystems; ++ii) {
+         const auto subsystem = static_cast<MemoryUse::Subsystem>(ii);
+         const auto memory = MemoryUse::GetStatistics(subsystem);
+         wxLogMessage(wxT("Memory for %s: %.1f MB, at most %.1f MB"),
+                      MemoryUse::GetName(subsystem),
+                      memory.live / 1048576.0, memory.peak / 1048576.0);
+      }
       logger->Show();
    }
 }
 
+void AudacityProject::OnRecordProfile(const CommandContext &WXUNUSED(context) )
+{
+   auto &profiler = Profiler::Get();
+   const bool setting = !Profiler::IsRecording();
+   if (setting)
+      // Start a NEW trace
+      profiler.Clear();
+   profiler.SetRecording(setting);
+   mCommandManager.Check(wxT("RecordProfile"), setting);
+}
+
+void AudacityProject::OnSaveProfile(const CommandContext &WXUNUSED(context) )
+{
+   wxString fName = FileNames::SelectFile(FileNames::Operation::Export,
+                        _("Save Profile As:"),
+                        wxEmptyString,
+                        wxT("profile.json"),
+                        wxT("json"),
+                        _("Trace files (*.json)|*.json"),
+                        wxFD_SAVE | wxFD_OVERWRITE_PROMPT | wxRESIZE_BORDER,
+                        this);
+   if (fName.IsEmpty())
+      return;
+
+   if (!Profiler::Get().WriteTrace(fName))
+      AudacityMessageBox(
+         wxString::Format(_("Could not write profile to %s"), fName),
+         _("Error Saving Profile"), wxOK | wxICON_ERROR, this);
+}
+
 void AudacityProject::OnBenchmark(const CommandContext &WXUNUSED(context) )
 {
    ::RunBenchmark(this);
@@ -8968,6 +9109,46 @@ void AudacityProject::OnAudioDeviceInfo(const CommandContext &WXUNUSED(context)
    }
 }
 
+void AudacityProject::OnAudioIOTelemetry(const CommandContext &WXUNUSED(context) )
+{
+   wxString info = gAudioIO->GetTelemetryReport();
+
+   wxDialogWrapper dlg(this, wxID_ANY, wxString(_("Audio I/O Telemetry")));
+   dlg.SetName(dlg.GetTitle());
+   ShuttleGui S(&dlg, eIsCreating);
+
+   wxTextCtrl *text;
+   S.StartVerticalLay();
+   {
+      S.SetStyle(wxTE_MULTILINE | wxTE_READONLY);
+      text = S.Id(wxID_STATIC).AddTextWindow(info);
+      S.AddStandardButtons(eOkButton | eCancelButton);
+   }
+   S.EndVerticalLay();
+
+   dlg.FindWindowById(wxID_OK)->SetLabel(_("&Save"));
+   dlg.SetSize(400, 500);
+
+   if (dlg.ShowModal() == wxID_OK)
+   {
+      wxString fName = FileNames::SelectFile(FileNames::Operation::Export,
+                                    _("Save Audio I/O Telemetry"),
+                                    wxEmptyString,
+                                    wxT("audioiotelemetry.txt"),
+                                    wxT("txt"),
+                                    wxT("*.txt"),
+                                    wxFD_SAVE | wxFD_OVERWRITE_PROMPT | wxRESIZE_BORDER,
+                                    this);
+      if (!fName.IsEmpty())
+      {
+         if (!text->SaveFile(fName))
+         {
+            AudacityMessageBox(_("Unable to save audio I/O telemetry"), _("Save Audio I/O Telemetry"));
+         }
+      }
+   }
+}
+
 #ifdef EXPERIMENTAL_MIDI_OUT
 void AudacityProject::OnMidiDeviceInfo(const CommandContext &WXUNUSED(context) )
 {
@@ -9224,6 +9405,27 @@ void AudacityProject::OnResample(const CommandContext &WXUNUSED(context) )
                    wxICON_ERROR, this);
    }
 
+   if (ODResampleTask::IsEnabled()) {
+      // The tracks play at the old rate with real-time conversion, until
+      // the task replaces their samples and pushes the undo state
+      for (Track *t = iter.First(); t; t = iter.Next()) {
+         if (!(t->GetSelected() && t->GetKind() == Track::Wave))
+            continue;
+         std::vector<WaveTrack*> channels{ static_cast<WaveTrack*>(t) };
+         if (t->GetLinked()) {
+            Track *partner = iter.Next();
+            if (partner && partner->GetKind() == Track::Wave)
+               channels.push_back(static_cast<WaveTrack*>(partner));
+         }
+
+         auto task = std::make_unique<ODResampleTask>(*this, channels, newRate);
+         // Begin at the cursor
+         task->DemandTrackUpdate(channels[0], mViewInfo.selectedRegion.t0());
+         ODManager::Instance()->AddNewTask(std::move(task));
+      }
+      return;
+   }
+
    int ndx = 0;
    auto flags = UndoPush::AUTOSAVE;
    for (Track *t = iter.First(); t; t = iter.Next())
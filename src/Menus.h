@@ -46,6 +46,8 @@ public:
 // If checkActive, do not do complete flags testing on an
 // inactive project as it is needlessly expensive.
 CommandFlag GetUpdateFlags(bool checkActive = false);
+// The part of GetUpdateFlags() that depends on the tracks
+CommandFlag GetTrackFlags();
 
 //Adds label and returns index of label in labeltrack.
 int DoAddLabel(const SelectedRegion& region, bool preserveFocus = false);
@@ -402,6 +404,7 @@ void OnToggleSWPlaythrough(const CommandContext &context );
    void OnToggleAutomatedInputLevelAdjustment(const CommandContext &context );
 #endif
 void OnRescanDevices(const CommandContext &context );
+void OnMeasureLatency(const CommandContext &context );
 
 #ifdef EXPERIMENTAL_PUNCH_AND_ROLL
 void OnPunchAndRoll(const CommandContext &context);
@@ -523,6 +526,8 @@ void OnManual(const CommandContext &context );
 void OnCheckForUpdates(const CommandContext &context );
 void MayCheckForUpdates();
 void OnShowLog(const CommandContext &context );
+void OnRecordProfile(const CommandContext &context );
+void OnSaveProfile(const CommandContext &context );
 void OnHelpWelcome(const CommandContext &context );
 void OnBenchmark(const CommandContext &context );
 #if defined(EXPERIMENTAL_CRASH_REPORT)
@@ -532,6 +537,7 @@ void OnSimulateRecordingErrors(const CommandContext &context );
 void OnDetectUpstreamDropouts(const CommandContext &context );
 void OnScreenshot(const CommandContext &context );
 void OnAudioDeviceInfo(const CommandContext &context );
+void OnAudioIOTelemetry(const CommandContext &context );
 #ifdef EXPERIMENTAL_MIDI_OUT
 void OnMidiDeviceInfo(const CommandContext &context );
 #endif
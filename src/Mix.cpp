@@ -25,6 +25,7 @@
 #include "Mix.h"
 
 #include <math.h>
+#include <algorithm>
 
 #include <wx/textctrl.h>
 #include <wx/progdlg.h>
@@ -35,12 +36,46 @@
 #include "DirManager.h"
 #include "Internat.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Project.h"
 #include "Resample.h"
+#include "TaskScheduler.h"
 #include "TimeTrack.h"
 #include "float_cast.h"
 
+
 //TODO-MB: wouldn't it make more sense to DELETE the time track after 'mix and render'?
+namespace {
+// Tracks mixed together on one thread, when there are more tracks.  Fixed,
+// so that the order of the sums, and so the result, is the same whatever
+// the number of cores.
+const size_t TracksPerSubmix = 8;
+
+// Processes the submixers on separate threads, then sums their float
+// outputs in the order of the tracks.  Returns the number of samples.
+size_t ProcessSubmixes(const std::vector< std::unique_ptr<Mixer> > &submixers,
+   size_t numChannels, size_t maxToProcess, const Floats *sums)
+{
+   std::vector<size_t> lens(submixers.size());
+   TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, submixers.size(), [&](size_t g){
+      lens[g] = submixers[g]->Process(maxToProcess);
+   });
+
+   const auto len = *std::max_element(lens.begin(), lens.end());
+   for (size_t c = 0; c < numChannels; c++) {
+      const auto sum = sums[c].get();
+      std::fill(sum, sum + len, 0.0f);
+      for (size_t g = 0; g < submixers.size(); g++) {
+         // A submixer whose tracks end sooner gives fewer samples
+         const auto submix = (const float *)submixers[g]->GetBuffer(c);
+         for (size_t i = 0; i < lens[g]; i++)
+            sum[i] += submix[i];
+      }
+   }
+   return len;
+}
+}
+
 void MixAndRender(TrackList *tracks, TrackFactory *trackFactory,
                   double rate, sampleFormat format,
                   double startTime, double endTime,
@@ -158,12 +193,43 @@ void MixAndRender(TrackList *tracks, TrackFactory *trackFactory,
       endTime = mixEndTime;
    }
 
-   Mixer mixer(waveArray,
-      // Throw to abort mix-and-render if read fails:
-      true,
-      Mixer::WarpOptions(tracks->GetTimeTrack()),
-      startTime, endTime, mono ? 1 : 2, maxBlockLen, false,
-      rate, format);
+   const size_t numChannels = mono ? 1 : 2;
+
+   // Many tracks are mixed in subgroups on separate threads, into float
+   // submixes that are then summed, and converted to the format at last.
+   // Not with a time track, whose warping of each subgroup would read its
+   // envelope from several threads.
+   std::vector< std::unique_ptr<Mixer> > submixers;
+   std::unique_ptr<Mixer> mixer;
+   if (waveArray.size() > TracksPerSubmix && !tracks->GetTimeTrack()) {
+      for (size_t first = 0; first < waveArray.size(); first += TracksPerSubmix) {
+         const auto last = std::min(first + TracksPerSubmix, waveArray.size());
+         WaveTrackConstArray group(
+            waveArray.begin() + first, waveArray.begin() + last);
+         submixers.push_back(std::make_unique<Mixer>(group,
+            // Throw to abort mix-and-render if read fails:
+            true,
+            Mixer::WarpOptions(tracks->GetTimeTrack()),
+            startTime, endTime, numChannels, maxBlockLen, false,
+            rate, floatSample));
+      }
+   }
+   else
+      mixer = std::make_unique<Mixer>(waveArray,
+         // Throw to abort mix-and-render if read fails:
+         true,
+         Mixer::WarpOptions(tracks->GetTimeTrack()),
+         startTime, endTime, numChannels, maxBlockLen, false,
+         rate, format);
+
+   Floats sums[2];
+   SampleBuffer converted;
+   if (!submixers.empty()) {
+      for (size_t c = 0; c < numChannels; c++)
+         sums[c].reinit(maxBlockLen);
+      if (format != floatSample)
+         converted.Allocate(maxBlockLen, format);
+   }
 
    ::wxSafeYield();
 
@@ -173,24 +239,50 @@ void MixAndRender(TrackList *tracks, TrackFactory *trackFactory,
          _("Mixing and rendering tracks"));
 
       while (updateResult == ProgressResult::Success) {
-         auto blockLen = mixer.Process(maxBlockLen);
+         double currentTime;
+         if (mixer) {
+            auto blockLen = mixer->Process(maxBlockLen);
 
-         if (blockLen == 0)
-            break;
+            if (blockLen == 0)
+               break;
 
-         if (mono) {
-            samplePtr buffer = mixer.GetBuffer();
-            mixLeft->Append(buffer, format, blockLen);
+            if (mono) {
+               samplePtr buffer = mixer->GetBuffer();
+               mixLeft->Append(buffer, format, blockLen);
+            }
+            else {
+               samplePtr buffer;
+               buffer = mixer->GetBuffer(0);
+               mixLeft->Append(buffer, format, blockLen);
+               buffer = mixer->GetBuffer(1);
+               mixRight->Append(buffer, format, blockLen);
+            }
+            currentTime = mixer->MixGetCurrentTime();
          }
          else {
-            samplePtr buffer;
-            buffer = mixer.GetBuffer(0);
-            mixLeft->Append(buffer, format, blockLen);
-            buffer = mixer.GetBuffer(1);
-            mixRight->Append(buffer, format, blockLen);
+            auto blockLen =
+               ProcessSubmixes(submixers, numChannels, maxBlockLen, sums);
+
+            if (blockLen == 0)
+               break;
+
+            for (size_t c = 0; c < numChannels; c++) {
+               auto buffer = (samplePtr)sums[c].get();
+               if (format != floatSample) {
+                  // Dithered as the single mixer would
+                  CopySamples(buffer, floatSample, converted.ptr(), format,
+                     blockLen);
+                  buffer = converted.ptr();
+               }
+               (c == 0 ? mixLeft : mixRight)->Append(buffer, format, blockLen);
+            }
+
+            currentTime = startTime;
+            for (const auto &submixer : submixers)
+               currentTime = std::max(currentTime, submixer->MixGetCurrentTime());
          }
 
-         updateResult = progress.Update(mixer.MixGetCurrentTime() - startTime, endTime - startTime);
+         updateResult = progress.Update(currentTime - startTime, endTime - startTime);
       }
    }
 
@@ -343,6 +435,21 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
 
    const auto envLen = std::max(mQueueMaxLen, mInterleavedBufferSize);
    mEnvValues.reinit(envLen);
+
+   // Resampling at best quality is the slow part of export and of mixing
+   // and rendering.  A time track is not used, because its envelope caches
+   // searches, so can't be shared among threads.
+   if (mHighQuality && !mTimeTrack) {
+      size_t nResampled = 0;
+      for (size_t i = 0; i < mNumInputTracks; i++)
+         if (NeedsResampling(i))
+            ++nResampled;
+      if (nResampled > 1) {
+         mResampled.reinit(mNumInputTracks, mInterleavedBufferSize);
+         mResampleEnvValues.reinit(mNumInputTracks, envLen);
+         mResampledLen.reinit(mNumInputTracks, true);
+      }
+   }
 }
 
 Mixer::~Mixer()
@@ -351,8 +458,13 @@ Mixer::~Mixer()
 
 void Mixer::MakeResamplers()
 {
-   for (size_t i = 0; i < mNumInputTracks; i++)
-      mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   // Making one designs its filters, which is costly.  Tracks at the rate of
+   // the mixer need none, and a resampler not yet used is as good as new.
+   for (size_t i = 0; i < mNumInputTracks; i++) {
+      const auto &pResample = mResample[i];
+      if (NeedsResampling(i) && !(pResample && !pResample->HasProcessed()))
+         mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   }
 }
 
 void Mixer::ApplyTrackGains(bool apply)
@@ -367,39 +479,94 @@ void Mixer::Clear()
    }
 }
 
-void MixBuffers(unsigned numChannels, int *channelFlags, float *gains,
-                samplePtr src, SampleBuffer *dests,
-                int len, bool interleaved)
+namespace {
+// The loops are simple enough for the compiler to vectorize, with the test
+// for an envelope taken out of them
+template< bool withEnvelope > void MixInto(
+   float *dest, unsigned stride, float gain,
+   const float *src, const float *env, size_t len)
 {
+   if (stride == 1)
+      for (size_t j = 0; j < len; j++)
+         dest[j] += withEnvelope ? src[j] * env[j] * gain : src[j] * gain;
+   else
+      for (size_t j = 0; j < len; j++)
+         dest[j * stride] +=
+            withEnvelope ? src[j] * env[j] * gain : src[j] * gain;
+}
+
+template< bool withEnvelope > void MixIntoStereo(
+   float *dest, float gain0, float gain1,
+   const float *src, const float *env, size_t len)
+{
+   for (size_t j = 0; j < len; j++) {
+      const auto value = withEnvelope ? src[j] * env[j] : src[j];
+      dest[2 * j] += value * gain0;
+      dest[2 * j + 1] += value * gain1;
+   }
+}
+}
+
+void MixBuffers(unsigned numChannels, const int *channelFlags,
+                const float *gains, const float *src, const float *env,
+                SampleBuffer *dests, size_t len, bool interleaved)
+{
+   if (interleaved && numChannels == 2) {
+      // The usual case, in one pass over the output; a channel that is off
+      // gets zero gain
+      const auto dest = (float *)dests[0].ptr();
+      const float gain0 = channelFlags[0] ? gains[0] : 0.0f;
+      const float gain1 = channelFlags[1] ? gains[1] : 0.0f;
+      if (env)
+         MixIntoStereo<true>(dest, gain0, gain1, src, env, len);
+      else
+         MixIntoStereo<false>(dest, gain0, gain1, src, env, len);
+      return;
+   }
+
    for (unsigned int c = 0; c < numChannels; c++) {
       if (!channelFlags[c])
          continue;
 
-      samplePtr destPtr;
+      float *dest;
       unsigned skip;
 
       if (interleaved) {
-         destPtr = dests[0].ptr() + c*SAMPLE_SIZE(floatSample);
+         dest = (float *)dests[0].ptr() + c;
          skip = numChannels;
       } else {
-         destPtr = dests[c].ptr();
+         dest = (float *)dests[c].ptr();
          skip = 1;
       }
 
-      float gain = gains[c];
-      float *dest = (float *)destPtr;
-      float *temp = (float *)src;
-      for (int j = 0; j < len; j++) {
-         *dest += temp[j] * gain;   // the actual mixing process
-         dest += skip;
-      }
+      if (env)
+         MixInto<true>(dest, skip, gains[c], src, env, len);
+      else
+         MixInto<false>(dest, skip, gains[c], src, env, len);
    }
 }
 
+bool Mixer::NeedsResampling(size_t i) const
+{
+   return mbVariableRates || mInputTrack[i].GetTrack()->GetRate() != mRate;
+}
+
 size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                                     sampleCount *pos, float *queue,
                                     int *queueStart, int *queueLen,
                                     Resample * pResample)
+{
+   const auto out = ResampleVariableRates(cache, pos, queue,
+      queueStart, queueLen, pResample, mFloatBuffer.get(), mEnvValues.get());
+   MixResampled(channelFlags, cache.GetTrack(), mFloatBuffer.get(), out);
+   return out;
+}
+
+size_t Mixer::ResampleVariableRates(WaveTrackCache &cache,
+                                    sampleCount *pos, float *queue,
+                                    int *queueStart, int *queueLen,
+                                    Resample * pResample,
+                                    float *floatBuffer, float *envValues)
 {
    const WaveTrack *const track = cache.GetTrack();
    const double trackRate = track->GetRate();
@@ -452,7 +619,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               track->GetEnvelopeValues(envValues,
                                         getLen,
                                         (*pos - (getLen- 1)).as_double() / trackRate);
                *pos -= getLen;
@@ -464,7 +631,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               track->GetEnvelopeValues(envValues,
                                         getLen,
                                         (*pos).as_double() / trackRate);
 
@@ -472,7 +639,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
             }
 
             for (decltype(getLen) i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
+               queue[(*queueLen) + i] *= envValues[i];
             }
 
             if (backwards)
@@ -509,7 +676,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                                       &queue[*queueStart],
                                       thisProcessLen,
                                       last,
-                                      &mFloatBuffer[out],
+                                      &floatBuffer[out],
                                       mMaxOut - out);
 
       const auto input_used = results.first;
@@ -523,6 +690,12 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
       }
    }
 
+   return out;
+}
+
+void Mixer::MixResampled(int *channelFlags, const WaveTrack *track,
+                         const float *floatBuffer, size_t len)
+{
    for (size_t c = 0; c < mNumChannels; c++) {
       if (mApplyTrackGains) {
          mGains[c] = track->GetChannelGain(c);
@@ -532,15 +705,15 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
       }
    }
 
+   // The envelope was applied before resampling
    MixBuffers(mNumChannels,
               channelFlags,
               mGains.get(),
-              (samplePtr)mFloatBuffer.get(),
+              floatBuffer,
+              nullptr,
               mTemp.get(),
-              out,
+              len,
               mInterleaved);
-
-   return out;
 }
 
 size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
@@ -567,6 +740,12 @@ size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
       sampleCount{ (backwards ? t - tEnd : tEnd - t) * track->GetRate() + 0.5 }
    );
 
+   for(size_t c=0; c<mNumChannels; c++)
+      if (mApplyTrackGains)
+         mGains[c] = track->GetChannelGain(c);
+      else
+         mGains[c] = 1.0;
+
    if (backwards) {
       auto results = cache.Get(floatSample, *pos - (slen - 1), slen, mMayThrow);
       if (results)
@@ -575,48 +754,75 @@ size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
          memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
       track->GetEnvelopeValues(mEnvValues.get(), slen, t - (slen - 1) / mRate);
       for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+         mFloatBuffer[i] *= mEnvValues[i];
       ReverseSamples((samplePtr)mFloatBuffer.get(), floatSample, 0, slen);
 
+      MixBuffers(mNumChannels, channelFlags, mGains.get(),
+                 mFloatBuffer.get(), nullptr, mTemp.get(), slen, mInterleaved);
+
       *pos -= slen;
    }
    else {
+      // Mix straight from the cache, applying envelope, gain and pan in the
+      // same pass
       auto results = cache.Get(floatSample, *pos, slen, mMayThrow);
-      if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
-      else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+      if (results) {
+         track->GetEnvelopeValues(mEnvValues.get(), slen, t);
+         MixBuffers(mNumChannels, channelFlags, mGains.get(),
+                    (const float *)results, mEnvValues.get(), mTemp.get(),
+                    slen, mInterleaved);
+      }
 
       *pos += slen;
    }
 
-   for(size_t c=0; c<mNumChannels; c++)
-      if (mApplyTrackGains)
-         mGains[c] = track->GetChannelGain(c);
-      else
-         mGains[c] = 1.0;
-
-   MixBuffers(mNumChannels, channelFlags, mGains.get(),
-              (samplePtr)mFloatBuffer.get(), mTemp.get(), slen, mInterleaved);
-
    return slen;
 }
 
+void Mixer::PlanReads(size_t maxSamples, BlockReadBatch &batch)
+{
+   const bool backwards = (mT1 < mT0);
+   for (size_t i = 0; i < mNumInputTracks; i++) {
+      const auto track = mInputTrack[i].GetTrack();
+      // Input samples per output sample; at the fastest, under a time track
+      const double ratio = mTimeTrack
+         ? 1.0 / mMinFactor[i]
+         : mSpeed * track->GetRate() / mRate;
+      sampleCount len{ ceil(maxSamples * ratio) };
+      auto start = backwards ? mSamplePos[i] - len : mSamplePos[i];
+      if (start < 0) {
+         len += start;
+         start = 0;
+      }
+      mInputTrack[i].PlanRead(start, len, batch);
+   }
+}
+
 size_t Mixer::Process(size_t maxToProcess)
 {
+   PROFILE_SCOPE("Mixer::Process");
    // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
    // it here. It's also unnecessary I think.
    //if (mT >= mT1)
    //   return 0;
 
    decltype(Process(0)) maxOut = 0;
-   ArrayOf<int> channelFlags{ mNumChannels };
+   PooledArrayOf<int> channelFlags{ mNumChannels };
 
    mMaxOut = maxToProcess;
 
+   // Resample the tracks at once, if allowed, before mixing them in order
+   if (mResampled) {
+      auto &scheduler = TaskScheduler::Get();
+      scheduler.ParallelFor(TaskScheduler::Interactive, mNumInputTracks, [this](size_t i){
+         if (NeedsResampling(i))
+            mResampledLen[i] = ResampleVariableRates(mInputTrack[i],
+               &mSamplePos[i], mSampleQueue[i].get(),
+               &mQueueStart[i], &mQueueLen[i], mResample[i].get(),
+               mResampled[i].get(), mResampleEnvValues[i].get());
+      });
+   }
+
    Clear();
    for(size_t i=0; i<mNumInputTracks; i++) {
       const WaveTrack *const track = mInputTrack[i].GetTrack();
@@ -646,7 +852,12 @@ size_t Mixer::Process(size_t maxToProcess)
             break;
          }
       }
-      if (mbVariableRates || track->GetRate() != mRate)
+      if (NeedsResampling(i) && mResampled) {
+         MixResampled(channelFlags.get(), track,
+            mResampled[i].get(), mResampledLen[i]);
+         maxOut = std::max(maxOut, mResampledLen[i]);
+      }
+      else if (NeedsResampling(i))
          maxOut = std::max(maxOut,
             MixVariableRates(channelFlags.get(), mInputTrack[i],
                &mSamplePos[i], mSampleQueue[i].get(),
@@ -720,7 +931,8 @@ void Mixer::Restart()
 
    // Bug 1887:  libsoxr 0.1.3, first used in Audacity 2.3.0, crashes with
    // constant rate resampling if you try to reuse the resampler after it has
-   // flushed.  Should that be considered a bug in sox?  This works around it:
+   // flushed.  Should that be considered a bug in sox?  This works around it,
+   // remaking only the resamplers that were used:
    MakeResamplers();
 }
 
@@ -749,6 +961,12 @@ void Mixer::SetTimesAndSpeed(double t0, double t1, double speed)
    Reposition(t0);
 }
 
+void Mixer::SetSpeed(double speed)
+{
+   wxASSERT(std::isfinite(speed));
+   mSpeed = fabs(speed);
+}
+
 MixerSpec::MixerSpec( unsigned numTracks, unsigned maxNumChannels )
 {
    mNumTracks = mNumChannels = numTracks;
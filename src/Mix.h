@@ -33,6 +33,7 @@ class TrackList;
 class WaveTrack;
 using WaveTrackConstArray = std::vector < std::shared_ptr < const WaveTrack > >;
 class WaveTrackCache;
+class BlockReadBatch;
 
 /** @brief Mixes together all input tracks, applying any envelopes, amplitude
  * gain, panning, and real-time effects in the process.
@@ -51,9 +52,11 @@ void MixAndRender(TrackList * tracks, TrackFactory *factory,
                   double startTime, double endTime,
                   std::unique_ptr<WaveTrack> &uLeft, std::unique_ptr<WaveTrack> &uRight);
 
-void MixBuffers(unsigned numChannels, int *channelFlags, float *gains,
-                samplePtr src,
-                samplePtr *dests, int len, bool interleaved);
+/// Adds src[j] * env[j] * gains[c] to each output channel c whose flag is
+/// set, reading src and env once.  env may be null, meaning all 1.
+void MixBuffers(unsigned numChannels, const int *channelFlags,
+                const float *gains, const float *src, const float *env,
+                SampleBuffer *dests, size_t len, bool interleaved);
 
 class AUDACITY_DLL_API MixerSpec
 {
@@ -125,6 +128,10 @@ class AUDACITY_DLL_API Mixer {
    /// more samples that must be processed.
    size_t Process(size_t maxSamples);
 
+   /// Add to the batch reads of the blocks that the next Process(maxSamples)
+   /// will likely need from the tracks.  Run the batch before that call.
+   void PlanReads(size_t maxSamples, BlockReadBatch &batch);
+
    /// Restart processing at beginning of buffer next time
    /// Process() is called.
    void Restart();
@@ -135,6 +142,8 @@ class AUDACITY_DLL_API Mixer {
 
    // Used in scrubbing.
    void SetTimesAndSpeed(double t0, double t1, double speed);
+   /// Change speed without repositioning, so that the output stays continuous
+   void SetSpeed(double speed);
 
    /// Current time in seconds (unwarped, i.e. always between startTime and stopTime)
    /// This value is not accurate, it's useful for progress bars and indicators, but nothing else.
@@ -157,6 +166,17 @@ class AUDACITY_DLL_API Mixer {
                                 int *queueStart, int *queueLen,
                                 Resample * pResample);
 
+   // Resample into floatBuffer, using envValues as scratch; touches no other
+   // members that are shared among the tracks
+   size_t ResampleVariableRates(WaveTrackCache &cache,
+                                sampleCount *pos, float *queue,
+                                int *queueStart, int *queueLen,
+                                Resample * pResample,
+                                float *floatBuffer, float *envValues);
+   void MixResampled(int *channelFlags, const WaveTrack *track,
+                     const float *floatBuffer, size_t len);
+   bool NeedsResampling(size_t track) const;
+
    void MakeResamplers();
 
  private:
@@ -168,7 +188,7 @@ class AUDACITY_DLL_API Mixer {
    const TimeTrack *mTimeTrack;
    ArrayOf<sampleCount> mSamplePos;
    bool             mApplyTrackGains;
-   Doubles          mEnvValues;
+   Floats           mEnvValues;
    double           mT0; // Start time
    double           mT1; // Stop time (none if mT0==mT1)
    double           mTime;  // Current time (renamed from mT to mTime for consistency with AudioIO - mT represented warped time there)
@@ -196,6 +216,12 @@ class AUDACITY_DLL_API Mixer {
    bool             mHighQuality;
    std::vector<double> mMinFactor, mMaxFactor;
 
+   // When mixing offline, tracks that need resampling are resampled at once,
+   // each into its own buffer; these are empty otherwise
+   FloatBuffers     mResampled;
+   FloatBuffers     mResampleEnvValues;
+   ArrayOf<size_t>  mResampledLen;
+
    bool             mMayThrow;
 };
 
@@ -672,6 +672,14 @@ void MixerTrackCluster::UpdateMeter(const double t0, const double t1)
       this->ResetMeter(false);
 }
 
+void MixerTrackCluster::RefreshMeter()
+{
+   // Only invalidate:  the paints of all the meters are then handled
+   // together, rather than one immediate Update() for each
+   if (mMeter && mMeter->ConsumeUpdates())
+      mMeter->Refresh(false);
+}
+
 // private
 
 wxColour MixerTrackCluster::GetTrackColor()
@@ -1297,6 +1305,8 @@ void MixerBoard::UpdateMeters(const double t1, const bool bLoopedPlay)
 
    for (unsigned int i = 0; i < mMixerTrackClusters.size(); i++)
       mMixerTrackClusters[i]->UpdateMeter(mPrevT1, t1);
+   for (unsigned int i = 0; i < mMixerTrackClusters.size(); i++)
+      mMixerTrackClusters[i]->RefreshMeter();
 
    mPrevT1 = t1;
 }
@@ -107,6 +107,7 @@ public:
    void UpdateVelocity();
 #endif
    void UpdateMeter(const double t0, const double t1);
+   void RefreshMeter();
 
 private:
    wxColour GetTrackColor();
@@ -19,11 +19,13 @@
 #include "Experimental.h"
 
 #include <wx/dc.h>
+#include <wx/ffile.h>
 #include <wx/brush.h>
 #include <wx/pen.h>
 #include <wx/intl.h>
 
 #if defined(USE_MIDI)
+#include <algorithm>
 #include <sstream>
 
 #define ROUND(x) ((int) ((x) + 0.5))
@@ -133,6 +135,8 @@ NoteTrack::~NoteTrack()
 
 Alg_seq &NoteTrack::GetSeq() const
 {
+   // The undo manager reads spilled tracks before they are used
+   wxASSERT(!IsSpilled());
    if (!mSeq) {
       if (!mSerializationBuffer)
          mSeq = std::make_unique<Alg_seq>();
@@ -153,8 +157,136 @@ Alg_seq &NoteTrack::GetSeq() const
    return *mSeq;
 }
 
+const NoteEventIndex &NoteTrack::GetEventIndex() const
+{
+   auto &seq = GetSeq();
+   seq.convert_to_seconds();
+   if (!mEventIndex || !mEventIndex->Matches(seq))
+      mEventIndex = std::make_unique<NoteEventIndex>(seq);
+   return *mEventIndex;
+}
+
+namespace {
+   // Average number of notes starting in each bucket of the index
+   const size_t NotesPerBucket = 16;
+   // Notes spanning more buckets are kept apart
+   const size_t MaxBucketsPerNote = 8;
+}
+
+NoteEventIndex::NoteEventIndex(Alg_seq &seq)
+   : mSeq{ &seq }
+{
+   std::vector<Alg_note_ptr> notes;
+   double end = 0.0;
+   const int nTracks = seq.tracks();
+   mUpdates.resize(nTracks);
+   for (int tr = 0; tr < nTracks; ++tr) {
+      auto &events = *seq.track(tr);
+      const auto len = events.length();
+      mNumEvents += len;
+      for (int ii = 0; ii < len; ++ii) {
+         const auto event = events[ii];
+         if (event->is_note()) {
+            const auto note = static_cast<Alg_note_ptr>(event);
+            notes.push_back(note);
+            end = std::max(end, note->time + note->dur);
+         }
+         else if (event->is_update())
+            mUpdates[tr].push_back(event);
+      }
+   }
+
+   // Each track is in time order, but the tracks must be merged
+   std::stable_sort(notes.begin(), notes.end(),
+      [](Alg_note_ptr a, Alg_note_ptr b){ return a->time < b->time; });
+
+   const size_t nBuckets = std::max<size_t>(1, notes.size() / NotesPerBucket);
+   if (end > 0)
+      mBucketDuration = end / nBuckets;
+   mBuckets.resize(nBuckets);
+   for (const auto note : notes) {
+      const auto first = BucketOf(note->time);
+      const auto last = BucketOf(note->time + note->dur);
+      if (last - first >= MaxBucketsPerNote)
+         mLongNotes.push_back(note);
+      else for (auto bb = first; bb <= last; ++bb)
+         mBuckets[bb].push_back(note);
+   }
+}
+
+bool NoteEventIndex::Matches(Alg_seq &seq) const
+{
+   if (mSeq != &seq || (int)mUpdates.size() != seq.tracks())
+      return false;
+   long numEvents = 0;
+   for (int tr = 0, nTracks = seq.tracks(); tr < nTracks; ++tr)
+      numEvents += seq.track(tr)->length();
+   return numEvents == mNumEvents;
+}
+
+size_t NoteEventIndex::BucketOf(double t) const
+{
+   const auto bucket = floor(t / mBucketDuration);
+   if (!(bucket > 0))
+      return 0;
+   return std::min(mBuckets.size() - 1, (size_t)std::min(bucket, 1e15));
+}
+
+void NoteEventIndex::FindNotes
+   (double t0, double t1, std::vector<Alg_note_ptr> &notes) const
+{
+   const auto overlaps = [=](Alg_note_ptr note)
+      { return note->time < t1 && note->time + note->dur > t0; };
+   const auto start = notes.size();
+
+   for (const auto note : mLongNotes)
+      if (overlaps(note))
+         notes.push_back(note);
+
+   // A note overlapping several of the buckets is found in the first of them
+   const auto first = BucketOf(t0), last = BucketOf(t1);
+   for (auto bb = first; bb <= last; ++bb)
+      for (const auto note : mBuckets[bb])
+         if (std::max(first, BucketOf(note->time)) == bb && overlaps(note))
+            notes.push_back(note);
+
+   std::stable_sort(notes.begin() + start, notes.end(),
+      [](Alg_note_ptr a, Alg_note_ptr b){ return a->time < b->time; });
+}
+
+size_t NoteTrack::GetSpillableBytes() const
+{
+   // Tracks of undo states are serialized, unless used since
+   return mSerializationBuffer ? mSerializationLength : 0;
+}
+
+bool NoteTrack::WriteSpill(wxFFile &file) const
+{
+   return mSerializationBuffer &&
+      file.Write(mSerializationBuffer.get(), mSerializationLength) ==
+         (size_t)mSerializationLength;
+}
+
+void NoteTrack::FreeSpilled()
+{
+   // Keep the length, to read it again
+   mSerializationBuffer.reset();
+}
+
+bool NoteTrack::ReadSpill(wxFFile &file)
+{
+   mSerializationBuffer.reset( safenew char[ mSerializationLength ] );
+   if (file.Read(mSerializationBuffer.get(), mSerializationLength) !=
+         (size_t)mSerializationLength) {
+      mSerializationBuffer.reset();
+      return false;
+   }
+   return true;
+}
+
 Track::Holder NoteTrack::Duplicate() const
 {
+   wxASSERT(!IsSpilled());
    auto duplicate = std::make_unique<NoteTrack>(mDirManager);
    duplicate->Init(*this);
    // The duplicate begins life in serialized state.  Often the duplicate is
@@ -232,6 +364,7 @@ void NoteTrack::WarpAndTransposeNotes(double t0, double t1,
 {
    double offset = this->GetOffset(); // track is shifted this amount
    auto &seq = GetSeq();
+   mEventIndex.reset();
    seq.convert_to_seconds(); // make sure time units are right
    t1 -= offset; // adjust time range to compensate for track offset
    t0 -= offset;
@@ -392,6 +525,7 @@ bool NoteTrack::LabelClick(const wxRect &rect, int mx, int my, bool right)
 void NoteTrack::SetSequence(std::unique_ptr<Alg_seq> &&seq)
 {
    mSeq = std::move(seq);
+   mEventIndex.reset();
 }
 
 void NoteTrack::PrintSequence()
@@ -468,6 +602,7 @@ Track::Holder NoteTrack::Cut(double t0, double t1)
    newTrack->Init(*this);
 
    auto &seq = GetSeq();
+   mEventIndex.reset();
    seq.convert_to_seconds();
    newTrack->mSeq.reset(seq.cut(t0 - GetOffset(), len, false));
    newTrack->SetOffset(0);
@@ -513,6 +648,7 @@ bool NoteTrack::Trim(double t0, double t1)
    if (t1 < t0)
       return false;
    auto &seq = GetSeq();
+   mEventIndex.reset();
    //auto delta = -(
       //( GetEndTime() - std::min( GetEndTime(), t1 ) ) +
       //( std::max(t0, GetStartTime()) - GetStartTime() )
@@ -540,6 +676,7 @@ void NoteTrack::Clear(double t0, double t1)
    double len = t1-t0;
 
    auto &seq = GetSeq();
+   mEventIndex.reset();
 
    auto offset = GetOffset();
    auto start = t0 - offset;
@@ -592,6 +729,7 @@ void NoteTrack::Paste(double t, const Track *src)
 
    double delta = 0.0;
    auto &seq = GetSeq();
+   mEventIndex.reset();
    auto offset = other->GetOffset();
    if ( offset > 0 ) {
       seq.convert_to_seconds();
@@ -620,6 +758,7 @@ void NoteTrack::Silence(double t0, double t1)
    auto len = t1 - t0;
 
    auto &seq = GetSeq();
+   mEventIndex.reset();
    seq.convert_to_seconds();
    // XXX: do we want to set the all param?
    // If it's set, then it seems like notes are silenced if they start or end in the range,
@@ -633,6 +772,7 @@ void NoteTrack::InsertSilence(double t, double len)
       THROW_INCONSISTENCY_EXCEPTION;
 
    auto &seq = GetSeq();
+   mEventIndex.reset();
    seq.convert_to_seconds();
    seq.insert_silence(t - GetOffset(), len);
 
@@ -644,6 +784,7 @@ void NoteTrack::InsertSilence(double t, double len)
 // NOT the function that handles horizontal dragging.
 bool NoteTrack::Shift(double t) // t is always seconds
 {
+   mEventIndex.reset();
    if (t > 0) {
       auto &seq = GetSeq();
       // insert an even number of measures
@@ -696,6 +837,7 @@ bool NoteTrack::StretchRegion
    ( QuantizedTimeAndBeat t0, QuantizedTimeAndBeat t1, double newDur )
 {
    auto &seq = GetSeq();
+   mEventIndex.reset();
    bool result = seq.stretch_region( t0.second, t1.second, newDur );
    if (result) {
       const auto oldDur = t1.first - t0.first;
@@ -908,6 +1050,7 @@ bool NoteTrack::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
              std::string s(strValue.mb_str(wxConvUTF8));
              std::istringstream data(s);
              mSeq = std::make_unique<Alg_seq>(data, false);
+             mEventIndex.reset();
          }
       } // while
       return true;
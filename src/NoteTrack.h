@@ -12,6 +12,7 @@
 #define __AUDACITY_NOTETRACK__
 
 #include <utility>
+#include <vector>
 #include <wx/string.h>
 #include "Audacity.h"
 #include "Experimental.h"
@@ -63,6 +64,38 @@ using QuantizedTimeAndBeat = std::pair< double, double >;
 
 class StretchHandle;
 
+/// Finds the notes of an Alg_seq in a range of time, and its updates before a
+/// time, without visiting all of its events.  Notes are listed in buckets of
+/// equal duration, each with the notes overlapping it, except that the few
+/// notes spanning many buckets are kept apart.  It holds pointers to the
+/// events, and does not follow changes of the sequence, so it must be
+/// rebuilt.  Times are in seconds, not counting the track offset.
+class NoteEventIndex {
+ public:
+   // The sequence must be in seconds
+   explicit NoteEventIndex(Alg_seq &seq);
+
+   // Cheap test that the sequence did not obviously change
+   bool Matches(Alg_seq &seq) const;
+
+   // Appends, by start time, the notes overlapping (t0, t1)
+   void FindNotes(double t0, double t1, std::vector<Alg_note_ptr> &notes) const;
+
+   // The update events of one track of the sequence, by time
+   const std::vector<Alg_event_ptr> &GetUpdates(int track) const
+   { return mUpdates[track]; }
+
+ private:
+   size_t BucketOf(double t) const;
+
+   const Alg_seq *mSeq;
+   long mNumEvents { 0 };
+   double mBucketDuration { 1.0 };
+   std::vector< std::vector<Alg_note_ptr> > mBuckets;
+   std::vector<Alg_note_ptr> mLongNotes;
+   std::vector< std::vector<Alg_event_ptr> > mUpdates;
+};
+
 class AUDACITY_DLL_API NoteTrack final
    : public NoteTrackBase
 {
@@ -78,6 +111,8 @@ class AUDACITY_DLL_API NoteTrack final
    using Holder = std::unique_ptr<NoteTrack>;
    Track::Holder Duplicate() const override;
 
+   size_t GetSpillableBytes() const override;
+
    int GetKind() const override { return Note; }
 
    double GetOffset() const override;
@@ -87,6 +122,8 @@ class AUDACITY_DLL_API NoteTrack final
    void DoSetHeight(int h) override;
 
    Alg_seq &GetSeq() const;
+   // Converts the sequence to seconds, and builds the index if needed
+   const NoteEventIndex &GetEventIndex() const;
 
    void WarpAndTransposeNotes(double t0, double t1,
                               const TimeWarper &warper, double semitones);
@@ -237,6 +274,11 @@ class AUDACITY_DLL_API NoteTrack final
          mVisibleChannels = CHANNEL_BIT(c);
    }
 
+ protected:
+   bool WriteSpill(wxFFile &file) const override;
+   void FreeSpilled() override;
+   bool ReadSpill(wxFFile &file) override;
+
  private:
    void AddToDuration( double delta );
 
@@ -248,6 +290,9 @@ class AUDACITY_DLL_API NoteTrack final
    mutable std::unique_ptr<char[]> mSerializationBuffer;
    mutable long mSerializationLength;
 
+   // Built on demand for mSeq; reset by each change of the notes
+   mutable std::unique_ptr<NoteEventIndex> mEventIndex;
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    float mVelocity; // velocity offset
 #endif
@@ -0,0 +1,156 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  NullAudioStream.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "NullAudioStream.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+
+   // Unpaced, how long to wait for the producer before calling back
+   // anyway, so that a stalled producer shows up as underruns, not a hang
+   const auto ReadyTimeout = std::chrono::seconds( 1 );
+   const auto ReadyPollInterval = std::chrono::microseconds( 200 );
+
+   long long NanosSince(Clock::time_point start)
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+         Clock::now() - start).count();
+   }
+}
+
+NullAudioStream::NullAudioStream(PaStreamCallback *callback, void *userData,
+   unsigned numCaptureChannels, size_t inputSampleBytes,
+   unsigned numPlaybackChannels,
+   double rate, unsigned long framesPerBuffer,
+   bool paced, ReadyFunction ready)
+   : mCallback{ callback }
+   , mUserData{ userData }
+   , mNumCaptureChannels{ numCaptureChannels }
+   , mNumPlaybackChannels{ numPlaybackChannels }
+   , mRate{ rate }
+   , mFramesPerBuffer{ framesPerBuffer }
+   , mPaced{ paced }
+   , mReady{ std::move(ready) }
+{
+   if (mNumCaptureChannels > 0) {
+      const auto bytes = framesPerBuffer * numCaptureChannels * inputSampleBytes;
+      mInput.reinit(bytes);
+      memset(mInput.get(), 0, bytes);
+   }
+   if (mNumPlaybackChannels > 0)
+      mOutput.reinit(framesPerBuffer * numPlaybackChannels);
+
+   mInfo.structVersion = 1;
+   mInfo.inputLatency = 0;
+   mInfo.outputLatency = 0;
+   mInfo.sampleRate = rate;
+}
+
+NullAudioStream::~NullAudioStream()
+{
+   Stop();
+}
+
+PaError NullAudioStream::Start()
+{
+   if (mThread.joinable())
+      return paStreamIsNotStopped;
+
+   mStopping.store( false );
+   mFrames.store( 0 );
+   mWallNanos.store( 0 );
+   mCallbackNanos.store( 0 );
+   mActive.store( true );
+   mThread = std::thread{ [this]{ StreamLoop(); } };
+   return paNoError;
+}
+
+PaError NullAudioStream::Stop()
+{
+   mStopping.store( true );
+   if (mThread.joinable())
+      mThread.join();
+   mActive.store( false );
+   return paNoError;
+}
+
+bool NullAudioStream::IsActive() const
+{
+   return mActive.load();
+}
+
+bool NullAudioStream::IsStopped() const
+{
+   return !mActive.load();
+}
+
+double NullAudioStream::GetTime() const
+{
+   return mFrames.load() / mRate;
+}
+
+NullAudioStream::Statistics NullAudioStream::GetStatistics() const
+{
+   Statistics result;
+   result.frames = mFrames.load();
+   result.rate = mRate;
+   result.wallSeconds = mWallNanos.load() * 1e-9;
+   result.callbackSeconds = mCallbackNanos.load() * 1e-9;
+   result.paced = mPaced;
+   return result;
+}
+
+void NullAudioStream::StreamLoop()
+{
+   const auto start = Clock::now();
+   const auto bufferDuration = std::chrono::duration<double>(
+      mFramesPerBuffer / mRate );
+   unsigned long long buffers = 0;
+
+   while (!mStopping.load()) {
+      if (mPaced) {
+         std::this_thread::sleep_until( start +
+            std::chrono::duration_cast<Clock::duration>(
+               buffers * bufferDuration ) );
+      }
+      else if (mReady) {
+         const auto deadline = Clock::now() + ReadyTimeout;
+         while (!mStopping.load() && !mReady() && Clock::now() < deadline)
+            std::this_thread::sleep_for( ReadyPollInterval );
+      }
+      if (mStopping.load())
+         break;
+
+      const auto frames = mFrames.load();
+      PaStreamCallbackTimeInfo timeInfo;
+      timeInfo.currentTime = frames / mRate;
+      timeInfo.inputBufferAdcTime = timeInfo.currentTime;
+      timeInfo.outputBufferDacTime = timeInfo.currentTime;
+
+      const auto callbackStart = Clock::now();
+      const auto result = mCallback( mInput.get(), mOutput.get(),
+         mFramesPerBuffer, &timeInfo, 0, mUserData );
+      mCallbackNanos.fetch_add( NanosSince( callbackStart ) );
+
+      mFrames.store( frames + mFramesPerBuffer );
+      mWallNanos.store( NanosSince( start ) );
+      ++buffers;
+
+      if (result != paContinue)
+         break;
+   }
+
+   mActive.store( false );
+}
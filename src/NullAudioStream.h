@@ -0,0 +1,103 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  NullAudioStream.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class NullAudioStream
+\brief A virtual audio device, that calls a PortAudio stream callback
+from a thread of its own, for measuring the playback pipeline without a
+sound card.
+
+  Paced, it calls back once each buffer's duration, as a device would.
+  Unpaced, it calls back as soon as the function it is given says that
+  the next buffer is ready, so that the stream runs as fast as the
+  producer allows.  The input is silence and the output is dropped.  The
+  stream time is the count of frames called back for, so the "device"
+  never drifts.
+
+  It stops when the callback returns other than paContinue, as PortAudio
+  streams do.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_NULL_AUDIO_STREAM__
+#define __AUDACITY_NULL_AUDIO_STREAM__
+
+#include "portaudio.h"
+#include "MemoryX.h"
+#include <atomic>
+#include <functional>
+#include <thread>
+
+class NullAudioStream
+{
+ public:
+   /// True when the next buffer may be called back for, unpaced
+   using ReadyFunction = std::function< bool() >;
+
+   /// The callback is called with interleaved buffers, of floats for the
+   /// output and of inputSampleBytes per sample for the input
+   NullAudioStream(PaStreamCallback *callback, void *userData,
+      unsigned numCaptureChannels, size_t inputSampleBytes,
+      unsigned numPlaybackChannels,
+      double rate, unsigned long framesPerBuffer,
+      bool paced, ReadyFunction ready);
+   ~NullAudioStream();
+
+   PaError Start();
+   /// Waits for the thread to finish
+   PaError Stop();
+   bool IsActive() const;
+   bool IsStopped() const;
+   /// Seconds of frames called back for
+   double GetTime() const;
+   const PaStreamInfo *GetInfo() const { return &mInfo; }
+
+   struct Statistics
+   {
+      unsigned long long frames { 0 };
+      double rate { 0 };
+      /// From Start() to the end of the last callback
+      double wallSeconds { 0 };
+      /// Spent in the callback
+      double callbackSeconds { 0 };
+      bool paced { true };
+   };
+   Statistics GetStatistics() const;
+
+ private:
+   NullAudioStream( const NullAudioStream& ) PROHIBITED;
+   NullAudioStream &operator= ( const NullAudioStream& ) PROHIBITED;
+
+   void StreamLoop();
+
+   PaStreamCallback *const mCallback;
+   void *const mUserData;
+   const unsigned mNumCaptureChannels;
+   const unsigned mNumPlaybackChannels;
+   const double mRate;
+   const unsigned long mFramesPerBuffer;
+   const bool mPaced;
+   const ReadyFunction mReady;
+
+   ArrayOf<char> mInput;
+   ArrayOf<float> mOutput;
+   PaStreamInfo mInfo;
+
+   std::atomic<bool> mStopping{ false };
+   std::atomic<bool> mActive{ false };
+   std::atomic<unsigned long long> mFrames{ 0 };
+   // In nanoseconds
+   std::atomic<long long> mWallNanos{ 0 };
+   std::atomic<long long> mCallbackNanos{ 0 };
+
+   std::thread mThread;
+};
+
+#endif
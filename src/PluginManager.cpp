@@ -1735,9 +1735,12 @@ void PluginManager::Initialize()
    // Then look for providers (they may autoregister plugins)
    ModuleManager::Get().DiscoverProviders();
 
-   // And finally check for updates
+   // And finally check for updates.  Known plugins are taken from the
+   // registry as they are, since validating some kinds loads each one; an
+   // invalid one fails when first used, and the Plug-in Manager checks all
 #ifndef EXPERIMENTAL_EFFECT_MANAGEMENT
-   CheckForUpdates();
+   const bool kFastValidation = true;
+   CheckForUpdates( false, kFastValidation );
 #else
    const bool kFast = true;
    CheckForUpdates( kFast );
@@ -2302,7 +2305,7 @@ void PluginManager::SaveGroup(wxFileConfig *pRegistry, PluginType type)
 // If bFast is true, do not do a full check.  Just check the ones
 // that are quick to check.  Currently (Feb 2017) just Nyquist
 // and built-ins.
-void PluginManager::CheckForUpdates(bool bFast)
+void PluginManager::CheckForUpdates(bool bFast, bool bFastValidation)
 {
    // Get ModuleManager reference
    ModuleManager & mm = ModuleManager::Get();
@@ -2379,7 +2382,8 @@ void PluginManager::CheckForUpdates(bool bFast)
       }
       else if (plugType != PluginTypeNone && plugType != PluginTypeStub)
       {
-         plug.SetValid(mm.IsPluginValid(plug.GetProviderID(), plugPath, bFast));
+         plug.SetValid(mm.IsPluginValid(plug.GetProviderID(), plugPath,
+            bFast || bFastValidation));
          if (!plug.IsValid())
          {
             plug.SetEnabled(false);
@@ -256,7 +256,9 @@ public:
    const IdentInterfaceSymbol & GetSymbol(const PluginID & ID);
    IdentInterface *GetInstance(const PluginID & ID);
 
-   void CheckForUpdates(bool bFast = false);
+   // bFast skips the search for NEW plugins too; bFastValidation only
+   // skips the checks of known plugins that would load them
+   void CheckForUpdates(bool bFast = false, bool bFastValidation = false);
 
    bool ShowManager(wxWindow *parent, EffectType type = EffectTypeNone);
 
@@ -65,6 +65,7 @@
 #include "Languages.h"
 
 #include "Prefs.h"
+#include "PrefsSnapshot.h"
 #include "widgets/ErrorDialog.h"
 #include "Internat.h"
 
@@ -151,6 +152,14 @@ AudacityPrefs::AudacityPrefs(const wxString& appName,
 
 
 
+bool AudacityPrefs::Flush(bool bCurrentOnly)
+{
+   const bool result = wxFileConfig::Flush(bCurrentOnly);
+   // Whether or not the file was written, the values are changed
+   PrefsSnapshot::Update();
+   return result;
+}
+
 // Bug 825 is essentially that SyncLock requires EditClipsCanMove.
 // SyncLock needs rethinking, but meanwhile this function 
 // fixes the issues of Bug 825 by allowing clips to move when in 
@@ -55,6 +55,9 @@ public:
                long style = wxCONFIG_USE_LOCAL_FILE | wxCONFIG_USE_GLOBAL_FILE,
                const wxMBConv& conv = wxConvAuto());
    bool GetEditClipsCanMove();
+
+   // Also makes a NEW PrefsSnapshot
+   bool Flush(bool bCurrentOnly = false) override;
 };
 
 // Packages a table of user-visible choices each with an internal code string,
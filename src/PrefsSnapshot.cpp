@@ -0,0 +1,88 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PrefsSnapshot.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "PrefsSnapshot.h"
+
+#include <atomic>
+
+#include "AudioIO.h"
+#include "Prefs.h"
+#include "prefs/GUISettings.h"
+#include "widgets/Warning.h"
+
+namespace {
+   // Replaced whole, never modified, so readers need no lock
+   std::shared_ptr<const PrefsSnapshot> sSnapshot =
+      std::make_shared<PrefsSnapshot>();
+}
+
+PrefsSnapshot::PrefsSnapshot()
+   : latencyDuration{ DEFAULT_LATENCY_DURATION }
+   , latencyCorrection{ DEFAULT_LATENCY_CORRECTION }
+   , dBRange{ ENV_DB_RANGE }
+{
+}
+
+std::shared_ptr<const PrefsSnapshot> PrefsSnapshot::Get()
+{
+   return std::atomic_load(&sSnapshot);
+}
+
+void PrefsSnapshot::Update()
+{
+   if (!gPrefs)
+      return;
+
+   const auto previous = Get();
+   auto snapshot = std::make_shared<PrefsSnapshot>();
+   snapshot->version = previous->version + 1;
+
+   snapshot->host = gPrefs->Read(wxT("/AudioIO/Host"), wxT(""));
+   gPrefs->Read(wxT("/AudioIO/RecordChannels"), &snapshot->recordChannels, 2L);
+   gPrefs->Read(wxT("/AudioIO/LatencyDuration"), &snapshot->latencyDuration,
+      DEFAULT_LATENCY_DURATION);
+   snapshot->latencyCorrection =
+      gPrefs->ReadDouble(wxT("/AudioIO/LatencyCorrection"),
+         DEFAULT_LATENCY_CORRECTION);
+   gPrefs->Read(wxT("/AudioIO/SWPlaythrough"), &snapshot->swPlaythrough, false);
+   snapshot->playthroughBufferMs =
+      gPrefs->ReadDouble(wxT("/AudioIO/PlaythroughBufferMs"), 0.0);
+   gPrefs->Read(wxT("/AudioIO/PlaythroughEffects"),
+      &snapshot->playthroughEffects, false);
+   gPrefs->Read(wxT("/AudioIO/SoundActivatedRecord"),
+      &snapshot->soundActivatedRecord, false);
+   gPrefs->Read(wxT("/AudioIO/SilenceLevel"), &snapshot->silenceLevel, -50);
+   snapshot->detectDropouts =
+      gPrefs->Read( WarningDialogKey(wxT("DropoutDetected")), true ) != 0;
+   gPrefs->Read(wxT("/AudioIO/RealtimeLookAhead"),
+      &snapshot->realtimeLookAhead, false);
+   snapshot->realtimeLookAheadMs =
+      gPrefs->ReadDouble(wxT("/AudioIO/RealtimeLookAheadMs"), 200.0);
+   snapshot->fillBuffersThreads =
+      gPrefs->ReadDouble(wxT("/AudioIO/FillBuffersThreads"), 0.0);
+   gPrefs->Read(wxT("/AudioIO/EffectsPreviewLen"),
+      &snapshot->effectsPreviewLen, 6.0);
+   gPrefs->Read(wxT("/AudioIO/SeekShortPeriod"),
+      &snapshot->seekShortPeriod, 1.0);
+   gPrefs->Read(wxT("/AudioIO/NullDevice"), &snapshot->nullDevice,
+      (long)NullDeviceOff);
+   gPrefs->Read(wxT("/AudioIO/NullDeviceBufferFrames"),
+      &snapshot->nullDeviceBufferFrames, 512L);
+
+   snapshot->dBRange = gPrefs->Read(ENV_DB_KEY, ENV_DB_RANGE);
+   gPrefs->Read(wxT("/GUI/ShowClipping"), &snapshot->showClipping, false);
+   gPrefs->Read(wxT("/GUI/ShowTrackNameInWaveform"),
+      &snapshot->showTrackNameInWaveform, false);
+
+   std::atomic_store(&sSnapshot,
+      std::shared_ptr<const PrefsSnapshot>{ std::move(snapshot) });
+}
@@ -0,0 +1,78 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PrefsSnapshot.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class PrefsSnapshot
+\brief Typed copies of the preferences that hot paths read, such as the
+start of a stream, the drawing of tracks, and effect previews, so that
+they need not look up the configuration by path each time.
+
+  Each Flush() of gPrefs makes a NEW snapshot, with a greater version, so
+  that users may also tell cheaply whether anything changed.  A snapshot
+  once made never changes, and may be held on any thread.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_PREFS_SNAPSHOT__
+#define __AUDACITY_PREFS_SNAPSHOT__
+
+#include "MemoryX.h"
+#include <wx/string.h>
+
+/// Values of /AudioIO/NullDevice
+enum NullDeviceChoice : long
+{
+   NullDeviceOff,
+   /// Calls back at the rate of a device
+   NullDevicePaced,
+   /// Calls back as soon as the playback buffers are ready
+   NullDeviceUnpaced,
+};
+
+struct PrefsSnapshot
+{
+   /// The latest snapshot; may be called on any thread
+   static std::shared_ptr<const PrefsSnapshot> Get();
+
+   /// Reads the preferences again.  Call on the main thread; flushing the
+   /// preferences does.
+   static void Update();
+
+   unsigned version { 0 };
+
+   // Recording and playback
+   wxString host;
+   long recordChannels { 2 };
+   double latencyDuration;
+   double latencyCorrection;
+   bool swPlaythrough { false };
+   double playthroughBufferMs { 0.0 };
+   bool playthroughEffects { false };
+   bool soundActivatedRecord { false };
+   int silenceLevel { -50 };
+   bool detectDropouts { true };
+   bool realtimeLookAhead { false };
+   double realtimeLookAheadMs { 200.0 };
+   double fillBuffersThreads { 0.0 };
+   double effectsPreviewLen { 6.0 };
+   double seekShortPeriod { 1.0 };
+   // For measuring playback without a sound card
+   long nullDevice { NullDeviceOff };
+   long nullDeviceBufferFrames { 512 };
+
+   // Display
+   int dBRange;
+   bool showClipping { false };
+   bool showTrackNameInWaveform { false };
+
+   PrefsSnapshot();
+};
+
+#endif
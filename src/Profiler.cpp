@@ -5,153 +5,187 @@
   Profiler.cpp
 
   Created by Michael Chinen (mchinen) on 8/12/08
-  Audacity(R) is copyright (c) 1999-2008 Audacity Team.
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
   License: GPL v2.  See License.txt.
 
 ******************************************************************//**
 
 \class Profiler
-\brief A simple profiler to measure the average time lengths that a
-particular task/function takes.  Currently not thread-safe and not thread-smart,
-but it will probably work fine if you use it on a high level.
-
-\class TaskProfile
-\brief a simple class to keep track of one task that may be called multiple times.
+\brief Records the times of scoped sections of code, on any thread, and
+writes them as a trace that chrome://tracing or Perfetto can show.
 
 *//*******************************************************************/
 
 #include "Audacity.h"
 #include "Profiler.h"
-#include <stdio.h>
-#include <string.h>
-#include <wx/crt.h>
 
-///write to a profile at the end of the test.
-Profiler::~Profiler()
-{
-   if(mTasks.size())
-   {
-      //print everything out.  append to a log.
-      FILE* log = fopen("AudacityProfilerLog.txt", "a");
-      time_t now;
-
-      time(&now);
-      wxFprintf(log,"Audacity Profiler Run, Ended at ");
-      wxFprintf(log,"%s",ctime(&now));
-      wxFprintf(log,"****************************************\n");
-      //print out the tasks
-      for(int i=0;i<(int)mTasks.size();i++)
-      {
-         if(mTasks[i]->mNumHits>0)
-         {
-            wxFprintf(log,"Task: %s\n(begins at line %d in %s)\n\n",mTasks[i]->mDescription.get(), mTasks[i]->mLine, mTasks[i]->mFileName.get());
-            wxFprintf(log,"Number of times run: %d\n",mTasks[i]->mNumHits);
-            wxFprintf(log,"Total run time (seconds): %f\n", (double)mTasks[i]->mCumTime/CLOCKS_PER_SEC);
-            wxFprintf(log,"Average run time (seconds): %f\n",mTasks[i]->ComputeAverageRunTime());
-
-            if(i < ((int)mTasks.size()) -1)
-               wxFprintf(log,"----------------------------\n");
-         }
-      }
-      wxFprintf(log,"\n****************************************\n\n\n");
+#include <algorithm>
+#include <chrono>
+#include <wx/ffile.h>
 
-      fclose(log);
-   }
-}
+namespace {
+// Per thread; 64K events are 2 MB
+const size_t RingSize = 1 << 16;
 
-///start the task timer.
-void Profiler::Begin(const char* fileName, int lineNum, const char* taskDescription)
-{
-   mTasksMutex.Lock();
-   GetOrCreateTaskProfile(fileName,lineNum)->Begin(fileName,lineNum,taskDescription);
-   mTasksMutex.Unlock();
-}
+// Events this close to being overwritten are not reported, because the
+// owning thread may be writing them while they are copied
+const size_t RingMargin = RingSize / 8;
 
-///end the task timer.
-void Profiler::End(const char* fileName, int lineNum, const char* taskDescription)
+long long SteadyNanoseconds()
 {
-   mTasksMutex.Lock();
-   TaskProfile* tp;
-   tp=GetTaskProfileByDescription(taskDescription);
-   if(tp)
-      tp->End(fileName,lineNum,taskDescription);
-   mTasksMutex.Unlock();
+   using namespace std::chrono;
+   return duration_cast< nanoseconds >(
+      steady_clock::now().time_since_epoch() ).count();
 }
-
-///Gets the singleton instance
-Profiler* Profiler::Instance()
-{
-   static Profiler pro;
-   //this isn't 100% threadsafe but I think Okay for this purpose.
-
-   return &pro;
 }
 
-///find a taskProfile for the given task, otherwise create
-TaskProfile* Profiler::GetOrCreateTaskProfile(const char* fileName, int lineNum)
+struct Profiler::ThreadBuffer
+{
+   ThreadBuffer()
+      : events{ RingSize }
+   {}
+
+   ArrayOf< Event > events;
+   // Written only by the owning thread
+   std::atomic< unsigned long long > count { 0 };
+   // Events before this are forgotten
+   std::atomic< unsigned long long > cleared { 0 };
+   // Of the thread that now owns it
+   unsigned threadId { 0 };
+};
+
+// Gives the thread's buffer back when the thread ends
+struct Profiler::ThreadRegistration
 {
-   for(int i=0;i<(int)mTasks.size();i++)
+   ~ThreadRegistration()
    {
-      if(strcmp(fileName, mTasks[i]->mFileName.get())==0 && lineNum == mTasks[i]->mLine)
-         return mTasks[i].get();
+      if ( pBuffer )
+         Profiler::Get().RetireThreadBuffer( *pBuffer );
    }
+   ThreadBuffer *pBuffer { nullptr };
+};
 
-   auto tp = std::make_unique<TaskProfile>();
-   mTasks.push_back(std::move(tp));
-   return mTasks.back().get();
-}
+std::atomic< bool > Profiler::sRecording{ false };
 
-TaskProfile* Profiler::GetTaskProfileByDescription(const char* description)
+Profiler &Profiler::Get()
 {
-   for(int i=0;i<(int)mTasks.size();i++)
-   {
-      if(strcmp(description, mTasks[i]->mDescription.get())==0)
-         return mTasks[i].get();
-   }
+   // Never destroyed, so that threads may end after static destruction
+   static Profiler *pProfiler = safenew Profiler;
+   return *pProfiler;
+}
 
-   return NULL;
+Profiler::Profiler()
+   : mOrigin{ SteadyNanoseconds() }
+{
+}
 
+Profiler::~Profiler()
+{
 }
 
+void Profiler::SetRecording( bool recording )
+{
+   sRecording.store( recording, std::memory_order_relaxed );
+}
 
-///Task Profile
-TaskProfile::TaskProfile()
+long long Profiler::Now() const
 {
-   mCumTime=0;
-   mNumHits=0;
+   return SteadyNanoseconds() - mOrigin;
 }
 
-TaskProfile::~TaskProfile()
+void Profiler::Record( const char *name, long long begin, long long end )
 {
+   auto &buffer = GetThreadBuffer();
+   const auto count = buffer.count.load( std::memory_order_relaxed );
+   buffer.events[ count % RingSize ] = { name, begin, end, buffer.threadId };
+   buffer.count.store( count + 1, std::memory_order_release );
 }
 
-///start the task timer.
-void TaskProfile::Begin(const char* fileName, int lineNum, const char* taskDescription)
+auto Profiler::GetThreadBuffer() -> ThreadBuffer &
 {
-   if(!mFileName)
-   {
-      mFileName.reinit( strlen(fileName) + 1 );
-      strcpy(mFileName.get(), fileName);
-      mDescription.reinit( strlen(taskDescription) + 1 );
-      strcpy(mDescription.get(), taskDescription);
-      mLine = lineNum;
+   static thread_local ThreadRegistration registration;
+   if ( !registration.pBuffer ) {
+      std::lock_guard< std::mutex > lock{ mBuffersMutex };
+      if ( mRetired.empty() ) {
+         mBuffers.push_back( std::make_unique< ThreadBuffer >() );
+         registration.pBuffer = mBuffers.back().get();
+      }
+      else {
+         registration.pBuffer = mRetired.back();
+         mRetired.pop_back();
+      }
+      registration.pBuffer->threadId = mNextThreadId++;
    }
+   return *registration.pBuffer;
+}
 
-   mLastTime = clock();
+void Profiler::RetireThreadBuffer( ThreadBuffer &buffer )
+{
+   // The events stay, reported under the old thread's id, until the new
+   // owner overwrites them
+   std::lock_guard< std::mutex > lock{ mBuffersMutex };
+   mRetired.push_back( &buffer );
+}
 
+void Profiler::Clear()
+{
+   std::lock_guard< std::mutex > lock{ mBuffersMutex };
+   for ( auto &pBuffer : mBuffers )
+      pBuffer->cleared.store( pBuffer->count.load( std::memory_order_acquire ),
+         std::memory_order_relaxed );
 }
 
-///end the task timer.
-void TaskProfile::End(const char* WXUNUSED(fileName), int WXUNUSED(lineNum), const char* WXUNUSED(taskDescription))
+auto Profiler::GetEvents() const -> std::vector< Event >
 {
-   mCumTime += clock() - mLastTime;
-   mNumHits++;
+   std::vector< Event > result;
+   std::lock_guard< std::mutex > lock{ mBuffersMutex };
+   for ( const auto &pBuffer : mBuffers ) {
+      const auto count = pBuffer->count.load( std::memory_order_acquire );
+      auto first = pBuffer->cleared.load( std::memory_order_relaxed );
+      if ( count > RingSize - RingMargin )
+         first = std::max( first, count - ( RingSize - RingMargin ) );
+      for ( auto ii = first; ii < count; ++ii )
+         result.push_back( pBuffer->events[ ii % RingSize ] );
+   }
+   return result;
 }
 
-double TaskProfile::ComputeAverageRunTime()
+bool Profiler::WriteTrace( const wxString &fileName ) const
 {
-   if(mNumHits)
-      return (double) ((double)mCumTime/CLOCKS_PER_SEC)/mNumHits;
-   else
-      return 0.0;
+   wxFFile file{ fileName, wxT("w") };
+   if ( !file.IsOpened() )
+      return false;
+
+   // Names are string literals in the source, but escape them anyway
+   auto escape = []( const char *name ){
+      wxString result;
+      for ( auto p = name; *p; ++p ) {
+         if ( *p == '"' || *p == '\\' )
+            result += wxT('\\');
+         result += wxUniChar( (unsigned char) *p );
+      }
+      return result;
+   };
+
+   // Microseconds with three decimals, formatted without the locale
+   auto micros = []( long long nanoseconds ){
+      return wxString::Format( wxT("%lld.%03lld"),
+         nanoseconds / 1000, nanoseconds % 1000 );
+   };
+
+   bool ok = file.Write( wxT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n") );
+   bool first = true;
+   for ( const auto &event : GetEvents() ) {
+      ok = ok && file.Write( wxString::Format(
+         wxT("%s{\"name\":\"%s\",\"cat\":\"audacity\",\"ph\":\"X\",")
+         wxT("\"ts\":%s,\"dur\":%s,\"pid\":1,\"tid\":%u}"),
+         first ? wxT("") : wxT(",\n"),
+         escape( event.name ),
+         micros( event.begin ), micros( event.end - event.begin ),
+         event.threadId ) );
+      first = false;
+   }
+   ok = ok && file.Write( wxT("\n]}\n") );
+
+   return file.Close() && ok;
 }
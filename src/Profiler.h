@@ -5,88 +5,122 @@
   Profiler.h
 
   Created by Michael Chinen (mchinen) on 8/12/08
-  Audacity(R) is copyright (c) 1999-2008 Audacity Team.
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
   License: GPL v2.  See License.txt.
 
 ******************************************************************//**
 
 \class Profiler
-\brief A simple profiler to measure the average time lengths that a
-particular task/function takes.  Currently not thread-safe and not thread-smart,
-but it will probably work fine if you use it on a high level.
-
-\class TaskProfile
-\brief a simple class to keep track of one task that may be called multiple times.
-
-*//*******************************************************************/
-
+\brief Records the times of scoped sections of code, on any thread, and
+writes them as a trace that chrome://tracing or Perfetto can show.
 
+  Recording is off until SetRecording(true).  Each thread writes to its
+  own fixed size ring of events without taking locks, so a probe in the
+  audio callback costs two clock reads.  When a ring is full the oldest
+  events are overwritten.
 
+\class ProfileScope
+\brief Records the time from its construction to its destruction, under a
+name that must be a string literal.
 
+*//*******************************************************************/
 
 #ifndef __AUDACITY_PROFILER__
 #define __AUDACITY_PROFILER__
+
 #include "MemoryX.h"
+#include <atomic>
+#include <mutex>
 #include <vector>
-#include <time.h>
-#include "ondemand/ODTaskThread.h"
+#include <wx/string.h>
 
+#define PROFILE_NAME_CAT(a, b) a ## b
+#define PROFILE_NAME(a, b) PROFILE_NAME_CAT(a, b)
+/// Time the rest of the enclosing block
+#define PROFILE_SCOPE(NAME) \
+   ProfileScope PROFILE_NAME(profileScope, __LINE__){ NAME }
 
-#define BEGIN_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->Begin(__FILE__,__LINE__,TASK_DESCRIPTION)
-#define END_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->End(__FILE__,__LINE__,TASK_DESCRIPTION)
-
-class TaskProfile;
 class Profiler
 {
  public:
+   struct Event
+   {
+      const char *name;
+      // Nanoseconds since the profiler was made
+      long long begin;
+      long long end;
+      unsigned threadId;
+   };
 
-   ///write to a profile at the end of the test.
-   virtual ~Profiler();
+   ///Gets the singleton instance
+   static Profiler &Get();
 
-   ///start the task timer.
-   void Begin(const char* fileName, int lineNum, const char* taskDescription);
-   ///end the task timer.
-   void End(const char* fileName, int lineNum, const char* taskDescription);
+   static bool IsRecording()
+   { return sRecording.load( std::memory_order_relaxed ); }
+   void SetRecording( bool recording );
 
-   ///Gets the singleton instance
-   static Profiler* Instance();
+   ///Nanoseconds since the profiler was made
+   long long Now() const;
+
+   ///Appends to the calling thread's ring.  Lock-free except for the first
+   ///call on each thread.
+   void Record( const char *name, long long begin, long long end );
 
-  protected:
-   ///private constructor - Singleton.
-   Profiler(){};
+   ///Forget events so far
+   void Clear();
 
-   ///find a taskProfile for the given task, otherwise create
-   TaskProfile* GetOrCreateTaskProfile(const char* fileName, int lineNum);
-   TaskProfile* GetTaskProfileByDescription(const char* description);
+   ///Events so far, of all threads, in no particular order
+   std::vector< Event > GetEvents() const;
 
-   //List of current Task to do.
-   std::vector<std::unique_ptr<TaskProfile>> mTasks;
-   //mutex for above variable
-   ODLock mTasksMutex;
+   ///Writes the events in the Trace Event JSON format.  Returns false if the
+   ///file can't be written.
+   bool WriteTrace( const wxString &fileName ) const;
 
+  private:
+   struct ThreadBuffer;
+   struct ThreadRegistration;
+
+   Profiler();
+   ~Profiler();
+   Profiler( const Profiler& ) PROHIBITED;
+   Profiler &operator= ( const Profiler& ) PROHIBITED;
+
+   ThreadBuffer &GetThreadBuffer();
+   void RetireThreadBuffer( ThreadBuffer &buffer );
+
+   static std::atomic< bool > sRecording;
+
+   long long mOrigin;
+
+   mutable std::mutex mBuffersMutex;
+   // Guarded by mBuffersMutex:
+   std::vector< std::unique_ptr< ThreadBuffer > > mBuffers;
+   // Buffers of threads that ended, to be reused by new threads
+   std::vector< ThreadBuffer* > mRetired;
+   unsigned mNextThreadId { 0 };
 };
 
- class TaskProfile
+class ProfileScope
+{
+ public:
+   explicit ProfileScope( const char *name )
+      : mName{ Profiler::IsRecording() ? name : nullptr }
+      , mBegin{ mName ? Profiler::Get().Now() : 0 }
+   {}
+   ~ProfileScope()
    {
-   public:
-      TaskProfile();
-      virtual ~TaskProfile();
-
-      ///start the task timer.
-      void Begin(const char* fileName, int lineNum, const char* taskDescription);
-      ///end the task timer.
-      void End(const char* fileName, int lineNum, const char* taskDescription);
-
-      double ComputeAverageRunTime();
-
-      ArrayOf<char> mFileName;
-      int mLine;
-      ArrayOf<char> mDescription;
-      int mNumHits;
-      clock_t mCumTime;
-      clock_t mLastTime;
-   };
-
+      if ( mName ) {
+         auto &profiler = Profiler::Get();
+         profiler.Record( mName, mBegin, profiler.Now() );
+      }
+   }
+
+   ProfileScope( const ProfileScope& ) PROHIBITED;
+   ProfileScope &operator= ( const ProfileScope& ) PROHIBITED;
+
+ private:
+   const char *const mName;
+   const long long mBegin;
+};
 
 #endif
-
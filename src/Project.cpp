@@ -54,6 +54,8 @@ scroll information.  It also has some status flags.
 
 #include <stdio.h>
 #include <iostream>
+#include <atomic>
+#include <thread>
 #include <wx/wxprec.h>
 #include <wx/apptrait.h>
 
@@ -95,6 +97,9 @@ scroll information.  It also has some status flags.
 #include "AudacityApp.h"
 #include "AColor.h"
 #include "AudioIO.h"
+#include "BlockCompactor.h"
+#include "BlockPrefetchQueue.h"
+#include "BlockWriteQueue.h"
 #include "Dependencies.h"
 #include "Diags.h"
 #include "HistoryWindow.h"
@@ -122,6 +127,7 @@ scroll information.  It also has some status flags.
 #include "widgets/ErrorDialog.h"
 #include "widgets/Ruler.h"
 #include "widgets/Warning.h"
+#include "xml/BinaryXMLFile.h"
 #include "xml/XMLFileReader.h"
 #include "PlatformCompatibility.h"
 #include "Experimental.h"
@@ -131,9 +137,12 @@ scroll information.  It also has some status flags.
 #include "ondemand/ODManager.h"
 #include "ondemand/ODTask.h"
 #include "ondemand/ODComputeSummaryTask.h"
+#include "ondemand/ODResampleTask.h"
 #ifdef EXPERIMENTAL_OD_FLAC
 #include "ondemand/ODDecodeFlacTask.h"
 #endif
+#include "ondemand/ODDecodeMP3Task.h"
+#include "ondemand/ODDecodeOggTask.h"
 #include "ModuleManager.h"
 
 #include "Theme.h"
@@ -465,14 +474,7 @@ public:
             mProject->HandleResize(); // Adjust scrollers for NEW track sizes.
          } );
 
-         for (const auto &name : sortednames) {
-#ifdef USE_MIDI
-            if (Importer::IsMidi(name))
-               AudacityProject::DoImportMIDI(mProject, name);
-            else
-#endif
-               mProject->Import(name);
-         }
+         mProject->ImportFiles(sortednames);
 
          mProject->ZoomAfterImport(nullptr);
 
@@ -546,7 +548,7 @@ bool ImportXMLTagHandler::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    return bSuccess;
 };
 
-AudacityProject *CreateNewAudacityProject()
+AudacityProject *CreateNewAudacityProject(bool bShow)
 {
    wxRect wndRect;
    bool bMaximized = false;
@@ -589,7 +591,10 @@ AudacityProject *CreateNewAudacityProject()
 
    ModuleManager::Get().Dispatch(ProjectInitialized);
 
-   p->Show(true);
+   // A hidden project is never painted, as for batches run from the
+   // command line
+   if (bShow)
+      p->Show(true);
 
    return p;
 }
@@ -918,6 +923,26 @@ BEGIN_EVENT_TABLE(AudacityProject, wxFrame)
    EVT_COMMAND(wxID_ANY, EVT_ODTASK_COMPLETE, AudacityProject::OnODTaskComplete)
 END_EVENT_TABLE()
 
+// Defined here, before the constructor and destructor need it
+struct AudacityProject::BackgroundSave
+{
+   ~BackgroundSave()
+   {
+      if (thread.joinable())
+         thread.join();
+   }
+
+   // Of an undo state, so never modified while the worker reads them
+   std::shared_ptr<const TrackList> tracks;
+   std::unique_ptr<XMLFileWriter> saveFile;
+   std::unique_ptr<BinaryXMLWriter> binaryFile;
+   SaveCallback callback;
+   std::thread thread;
+   // Set by the worker as it finishes
+   std::atomic<bool> done{ false };
+   bool success{ false };
+};
+
 AudacityProject::AudacityProject(wxWindow * parent, wxWindowID id,
                                  const wxPoint & pos,
                                  const wxSize & size)
@@ -947,6 +972,8 @@ AudacityProject::AudacityProject(wxWindow * parent, wxWindowID id,
 
    mTracks = TrackList::Create();
 
+   mAutoSaveJournal = std::make_unique<AutoSaveJournal>();
+
 #ifdef EXPERIMENTAL_DA2
    SetBackgroundColour(theTheme.Colour( clrMedium ));
 #endif
@@ -2059,16 +2086,10 @@ std::shared_ptr<Track> AudacityProject::GetFirstVisible()
 {
    std::shared_ptr<Track> pTrack;
    if (GetTracks()) {
-      TrackListIterator iter(GetTracks());
-      for (Track *t = iter.First(); t; t = iter.Next()) {
-         int y = t->GetY();
-         int h = t->GetHeight();
-         if (y + h - 1 >= mViewInfo.vpos) {
-            // At least the bottom row of pixels is not scrolled away above
-            pTrack = Track::Pointer(t);
-            break;
-         }
-      }
+      // At least the bottom row of pixels is not scrolled away above
+      Track *t = GetTracks()->FindAtY(mViewInfo.vpos);
+      if (t)
+         pTrack = Track::Pointer(t);
    }
 
    return pTrack;
@@ -2244,6 +2265,7 @@ void AudacityProject::OnODTaskUpdate(wxCommandEvent & WXUNUSED(event))
 //redraws the task and does other book keeping after the task is complete.
 void AudacityProject::OnODTaskComplete(wxCommandEvent & WXUNUSED(event))
 {
+  ODResampleTask::FinishPending(*this);
   if(mTrackPanel)
       mTrackPanel->Refresh(false);
  }
@@ -2286,11 +2308,32 @@ void AudacityProject::DoScroll()
       mTrackPanel->Refresh(false);
    }
 
+   PrefetchOffscreenSummaries();
+
    CallAfter(
       [this]{ if (GetTrackPanel())
          GetTrackPanel()->HandleCursorForPresentMouseState(); } );
 }
 
+void AudacityProject::PrefetchOffscreenSummaries()
+{
+   const double screen = GetScreenEndTime() - mViewInfo.h;
+   if (screen <= 0)
+      return;
+
+   // Summaries are small beside the samples, so both sides are read
+   BlockPrefetchQueue::BlockFiles files;
+   TrackListOfKindIterator iterWaveTrack(Track::Wave, mTracks.get());
+   for (auto t = iterWaveTrack.First(); t; t = iterWaveTrack.Next()) {
+      const auto pWaveTrack = static_cast<WaveTrack*>(t);
+      pWaveTrack->CollectBlockFiles(
+         mViewInfo.h + screen, mViewInfo.h + 2 * screen, files);
+      pWaveTrack->CollectBlockFiles(
+         mViewInfo.h - screen, mViewInfo.h, files);
+   }
+   BlockPrefetchQueue::Get().PushSummaries(std::move(files));
+}
+
 bool AudacityProject::ReportIfActionNotAllowed
    ( const wxString & Name, CommandFlag & flags, CommandFlag flagsRqd, CommandFlag mask )
 {
@@ -2519,6 +2562,9 @@ void AudacityProject::OnCloseWindow(wxCloseEvent & event)
       return;
    }
 
+   // Commit the file before deciding whether there are unsaved changes
+   WaitForBackgroundSave();
+
    // TODO: consider postponing these steps until after the possible veto
    // below:  closing the two analysis dialogs, and stopping audio streams.
    // Streams can be for play, recording, or monitoring.  But maybe it still
@@ -2683,6 +2729,7 @@ void AudacityProject::OnCloseWindow(wxCloseEvent & event)
    mImportXMLTagHandler.reset();
 
    // Delete all the tracks to free up memory and DirManager references.
+   BlockCompactor::Get().Abandon(*this);
    mTracks->Clear();
    mTracks.reset();
 
@@ -3120,7 +3167,10 @@ void AudacityProject::OpenFile(const wxString &fileNameArg, bool addtohistory)
       }
    }
 
+   // Binary projects are read without parsing any XML
+   const bool binary = BinaryXMLFileReader::IsBinaryFile(fileName);
    XMLFileReader xmlFile;
+   BinaryXMLFileReader binaryFile;
 
    // 'Lossless copy' projects have dependencies. We need to always copy-in
    // these dependencies when converting to a normal project.
@@ -3132,7 +3182,9 @@ void AudacityProject::OpenFile(const wxString &fileNameArg, bool addtohistory)
       gPrefs->Write(wxT("/Warnings/CopyOrEditUncompressedDataAsk"), (long) false);
    gPrefs->Flush();
 
-   bool bParseSuccess = xmlFile.Parse(this, fileName);
+   bool bParseSuccess = binary
+      ? binaryFile.Parse(this, fileName)
+      : xmlFile.Parse(this, fileName);
 
    // and restore old settings if necessary.
    if (oldAction != wxT("copy"))
@@ -3236,11 +3288,8 @@ void AudacityProject::OpenFile(const wxString &fileNameArg, bool addtohistory)
          // Shouldn't need it any more.
          mImportXMLTagHandler.reset();
 
-         if ( bParseSuccess ) {
-            // This is a no-fail:
-            GetDirManager()->FillBlockfilesCache();
+         if ( bParseSuccess )
             EnqueueODTasks();
-         }
 
          // For an unknown reason, OSX requires that the project window be
          // raised if a recovery took place.
@@ -3344,9 +3393,12 @@ void AudacityProject::OpenFile(const wxString &fileNameArg, bool addtohistory)
       mFileName = wxT("");
       SetProjectTitle();
 
-      wxLogError(wxT("Could not parse file \"%s\". \nError: %s"), fileName, xmlFile.GetErrorStr());
+      wxString errorStr = binary
+         ? binaryFile.GetErrorStr()
+         : xmlFile.GetErrorStr();
+
+      wxLogError(wxT("Could not parse file \"%s\". \nError: %s"), fileName, errorStr);
 
-      wxString errorStr = xmlFile.GetErrorStr();
       wxString url = wxT("FAQ:Errors_on_opening_or_recovering_an_Audacity_project");
 
       // Certain errors have dedicated help.
@@ -3453,6 +3505,20 @@ void AudacityProject::EnqueueODTasks()
                   createdODTasks = createdODTasks | ODTask::eODFLAC;
                }
                else
+#endif
+#if defined(USE_LIBMAD) && defined(EXPERIMENTAL_OD_MP3)
+               if(!(createdODTasks&ODTask::eODMP3) && (odFlags & ODTask::eODMP3)) {
+                  newTask = std::make_unique<ODDecodeMP3Task>();
+                  createdODTasks = createdODTasks | ODTask::eODMP3;
+               }
+               else
+#endif
+#if defined(USE_LIBVORBIS) && defined(EXPERIMENTAL_OD_OGG)
+               if(!(createdODTasks&ODTask::eODOGG) && (odFlags & ODTask::eODOGG)) {
+                  newTask = std::make_unique<ODDecodeOggTask>();
+                  createdODTasks = createdODTasks | ODTask::eODOGG;
+               }
+               else
 #endif
                if(!(createdODTasks&ODTask::eODPCMSummary) && (odFlags & ODTask::eODPCMSummary)) {
                   newTask = std::make_unique<ODComputeSummaryTask>();
@@ -3757,10 +3823,9 @@ void AudacityProject::WriteXMLHeader(XMLWriter &xmlFile) const
    xmlFile.Write(wxT(">\n"));
 }
 
-void AudacityProject::WriteXML(XMLWriter &xmlFile, bool bWantSaveCopy)
+void AudacityProject::WriteXMLProjectStart(XMLWriter &xmlFile)
 // may throw
 {
-   //TIMER_START( "AudacityProject::WriteXML", xml_writer_timer );
    // Warning: This block of code is duplicated in Save, for now...
    wxString project = mFileName;
    if (project.Len() > 4 && project.Mid(project.Len() - 4) == wxT(".aup"))
@@ -3804,6 +3869,13 @@ void AudacityProject::WriteXML(XMLWriter &xmlFile, bool bWantSaveCopy)
                      GetBandwidthSelectionFormatName().Internal());
 
    mTags->WriteXML(xmlFile);
+}
+
+void AudacityProject::WriteXML(XMLWriter &xmlFile, bool bWantSaveCopy)
+// may throw
+{
+   //TIMER_START( "AudacityProject::WriteXML", xml_writer_timer );
+   WriteXMLProjectStart(xmlFile);
 
    const Track *t;
    WaveTrack* pWaveTrack;
@@ -3845,7 +3917,14 @@ void AudacityProject::WriteXML(XMLWriter &xmlFile, bool bWantSaveCopy)
       {
          pWaveTrack = (WaveTrack*)t;
          pWaveTrack->SetAutoSaveIdent(mAutoSaving ? ++ndx : 0);
-         t->WriteXML(xmlFile);
+         if (mAutoSaving && mAutoSaveJournal->IsSaving())
+            // Clips unchanged since the last auto-save are not encoded again
+            pWaveTrack->WriteXML(xmlFile,
+               [&](const WaveClip &clip, size_t index) {
+                  mAutoSaveJournal->WriteClip(*pWaveTrack, clip, index);
+               });
+         else
+            t->WriteXML(xmlFile);
       }
       else
       {
@@ -3905,6 +3984,36 @@ bool AudacityProject::Save()
 }
 
 
+bool AudacityProject::ConfirmSave()
+{
+   TrackListIterator iter(GetTracks());
+   bool bHasTracks = (iter.First() != NULL);
+   if (!bHasTracks)
+   {
+      if (GetUndoManager()->UnsavedChanges() && mEmptyCanBeDirty) {
+         int result = AudacityMessageBox(_("Your project is now empty.\nIf saved, the project will have no tracks.\n\nTo save any previously open tracks:\nClick 'No', Edit > Undo until all tracks\nare open, then File > Save Project.\n\nSave anyway?"),
+                                   _("Warning - Empty Project"),
+                                   wxYES_NO | wxICON_QUESTION, this);
+         if (result == wxNO)
+            return false;
+      }
+   }
+
+   // If the user has recently imported dependencies, show
+   // a dialog where the user can see audio files that are
+   // aliased by this project.  The user may make the project
+   // self-contained during this dialog, it modifies the project!
+   if (mImportedDependencies)
+   {
+      bool bSuccess = ShowDependencyDialogIfNeeded(this, true);
+      if (!bSuccess)
+         return false;
+      mImportedDependencies = false; // do not show again
+   }
+
+   return true;
+}
+
 // Assumes AudacityProject::mFileName has been set to the desired path.
 bool AudacityProject::DoSave (const bool fromSaveAs,
                               const bool bWantSaveCopy,
@@ -3915,34 +4024,12 @@ bool AudacityProject::DoSave (const bool fromSaveAs,
 
    wxASSERT_MSG(!bWantSaveCopy || fromSaveAs, "Copy Project SHOULD only be availabele from SaveAs");
 
-   // Some confirmation dialogs
-   if (!bWantSaveCopy)
-   {
-      TrackListIterator iter(GetTracks());
-      bool bHasTracks = (iter.First() != NULL);
-      if (!bHasTracks)
-      {
-         if (GetUndoManager()->UnsavedChanges() && mEmptyCanBeDirty) {
-            int result = AudacityMessageBox(_("Your project is now empty.\nIf saved, the project will have no tracks.\n\nTo save any previously open tracks:\nClick 'No', Edit > Undo until all tracks\nare open, then File > Save Project.\n\nSave anyway?"),
-                                      _("Warning - Empty Project"),
-                                      wxYES_NO | wxICON_QUESTION, this);
-            if (result == wxNO)
-               return false;
-         }
-      }
+   // A save still running would commit its file after this one
+   WaitForBackgroundSave();
 
-      // If the user has recently imported dependencies, show
-      // a dialog where the user can see audio files that are
-      // aliased by this project.  The user may make the project
-      // self-contained during this dialog, it modifies the project!
-      if (mImportedDependencies)
-      {
-         bool bSuccess = ShowDependencyDialogIfNeeded(this, true);
-         if (!bSuccess)
-            return false;
-         mImportedDependencies = false; // do not show again
-      }
-   }
+   // Some confirmation dialogs
+   if (!bWantSaveCopy && !ConfirmSave())
+      return false;
    // End of confirmations
 
    //
@@ -4029,6 +4116,24 @@ bool AudacityProject::DoSave (const bool fromSaveAs,
          return false;
    }
 
+   if (!bWantSaveCopy) {
+      // Records that paste shared with other projects are copied into ours
+      // only now, so that the .aup refers to none outside our _data folder
+      bool adopted = false;
+      success = GuardedCall< bool >( [&] {
+         TrackListOfKindIterator iter(Track::Wave, GetTracks());
+         for (Track *t = iter.First(); t; t = iter.Next())
+            adopted =
+               static_cast<WaveTrack*>(t)->AdoptBorrowedBlocks() || adopted;
+         return true;
+      }, MakeSimpleGuard(false) );
+      // The samples are the same, but the undo state must share the copies
+      if (adopted)
+         ModifyState(false);
+      if (!success)
+         return false;
+   }
+
    // Write the .aup now, before DirManager::SetProject,
    // because it's easier to clean up the effects of successful write of .aup
    // followed by failed SetProject, than the other way about.
@@ -4037,8 +4142,16 @@ bool AudacityProject::DoSave (const bool fromSaveAs,
    // (SetProject, when it fails, cleans itself up.)
    XMLFileWriter saveFile{ mFileName, _("Error Saving Project") };
    success = GuardedCall< bool >( [&] {
-         WriteXMLHeader(saveFile);
-         WriteXML(saveFile, bWantSaveCopy);
+         if (gPrefs->Read(wxT("/FileFormats/SaveBinaryProjects"), false)) {
+            BinaryXMLWriter binaryFile{ saveFile };
+            WriteXMLHeader(binaryFile);
+            WriteXML(binaryFile, bWantSaveCopy);
+            binaryFile.Flush();
+         }
+         else {
+            WriteXMLHeader(saveFile);
+            WriteXML(saveFile, bWantSaveCopy);
+         }
          // Flushes files, forcing space exhaustion errors before trying
          // SetProject():
          saveFile.PreCommit();
@@ -4159,6 +4272,139 @@ bool AudacityProject::DoSave (const bool fromSaveAs,
    return true;
 }
 
+bool AudacityProject::SaveInBackground(const SaveCallback &callback)
+{
+   if (mBackgroundSave)
+      return false;
+
+   // The first save moves the block files into the new _data folder, and
+   // the dependency dialog may change the project, so neither is done on
+   // another thread
+   auto tracks = GetUndoManager()->GetCurrentTracks();
+   if (!IsProjectSaved() || !tracks || mImportedDependencies) {
+      const bool success = Save();
+      if (callback)
+         callback(success);
+      return success;
+   }
+
+   if (!ConfirmSave())
+      return false;
+
+   // The project file stays as it was until the new one is committed, so
+   // no safety file is needed as in DoSave()
+   auto save = std::make_unique<BackgroundSave>();
+   save->tracks = tracks;
+   save->callback = callback;
+
+   XMLWriter *writer = nullptr;
+   bool success = GuardedCall< bool >( [&] {
+         save->saveFile = std::make_unique<XMLFileWriter>(
+            mFileName, _("Error Saving Project"));
+         writer = save->saveFile.get();
+         if (gPrefs->Read(wxT("/FileFormats/SaveBinaryProjects"), false)) {
+            save->binaryFile =
+               std::make_unique<BinaryXMLWriter>(*save->saveFile);
+            writer = save->binaryFile.get();
+         }
+         // Attributes of the project itself are read here, not on the worker
+         WriteXMLHeader(*writer);
+         WriteXMLProjectStart(*writer);
+         return true;
+      },
+      MakeSimpleGuard(false),
+      [](void*){}
+   );
+
+   if (!success) {
+      AudacityMessageBox(wxString::Format(_("Could not save project. Perhaps %s \nis not writable or the disk is full."),
+                                    mFileName),
+                   _("Error Saving Project"),
+                   wxICON_ERROR, this);
+      return false;
+   }
+
+   auto pSave = save.get();
+   pSave->thread = std::thread( [pSave, writer] {
+      try {
+         TrackListConstIterator iter(pSave->tracks.get());
+         for (auto t = iter.First(); t; t = iter.Next())
+            t->WriteXML(*writer);
+         writer->EndTag(wxT("project"));
+         if (pSave->binaryFile)
+            pSave->binaryFile->Flush();
+         pSave->saveFile->PreCommit();
+         pSave->success = true;
+      }
+      catch (...) {
+         // Reported by FinishBackgroundSave()
+      }
+      pSave->done.store(true, std::memory_order_release);
+   } );
+   mBackgroundSave = std::move(save);
+
+   mStatusBar->SetStatusText(wxString::Format(_("Saving %s..."),
+                                              mFileName), mainStatusBarField);
+
+   return true;
+}
+
+void AudacityProject::WaitForBackgroundSave()
+{
+   if (mBackgroundSave)
+      FinishBackgroundSave();
+}
+
+void AudacityProject::FinishBackgroundSave()
+{
+   auto save = std::move(mBackgroundSave);
+   save->thread.join();
+
+   bool success = save->success && GuardedCall< bool >( [&] {
+         save->saveFile->PostCommit();
+         return true;
+   } );
+   save->binaryFile.reset();
+   // Removes the temporary file if not committed
+   save->saveFile.reset();
+
+   if (!success) {
+      AudacityMessageBox(wxString::Format(_("Could not save project. Perhaps %s \nis not writable or the disk is full."),
+                                    mFileName),
+                   _("Error Saving Project"),
+                   wxICON_ERROR, this);
+   }
+   else {
+      // Keep the auto-saved version if it has changes made since saving began
+      if (GetUndoManager()->GetCurrentTracks() == save->tracks)
+         DeleteCurrentAutoSaveFile();
+
+      if (mIsRecovered)
+      {
+         // As in DoSave()
+         mDirManager->RemoveOrphanBlockfiles();
+         mIsRecovered = false;
+         mRecoveryAutoSaveDataDir = wxT("");
+         SetProjectTitle();
+      }
+
+      if (mLastSavedTracks)
+         mLastSavedTracks->Clear();
+      mLastSavedTracks = TrackList::Create();
+
+      TrackListConstIterator iter(save->tracks.get());
+      for (auto t = iter.First(); t; t = iter.Next())
+         mLastSavedTracks->Add(t->Duplicate());
+
+      GetUndoManager()->StateSaved(save->tracks.get());
+
+      mStatusBar->SetStatusText(wxString::Format(_("Saved %s"),
+                                                 mFileName), mainStatusBarField);
+   }
+
+   if (save->callback)
+      save->callback(success);
+}
 
 bool AudacityProject::SaveCopyWaveTracks(const wxString & strProjectPathName,
                                          const bool bLossless /*= false*/)
@@ -4407,6 +4653,62 @@ bool AudacityProject::Import(const wxString &fileName, WaveTrackArray* pTrackArr
       cleanup.release();
    }
 
+   return FinishImport(fileName, std::move(newTracks), pTrackArray);
+}
+
+void AudacityProject::ImportFiles(const wxArrayString &fileNames)
+{
+   // Files in a run between LOF or MIDI files are imported at once
+   wxArrayString batch;
+   const auto importBatch = [&] {
+      if (batch.size() == 1)
+         Import(batch[0]);
+      else if (batch.size() > 1) {
+         const auto startTags = mTags ? mTags->Duplicate() : std::make_shared<Tags>();
+         auto results =
+            Importer::Get().ImportFiles(batch, GetTrackFactory(), mTags.get());
+         for (size_t ii = 0; ii < batch.size(); ++ii) {
+            auto &result = results[ii];
+            if (!result.errorMessage.IsEmpty())
+               ShowErrorDialog(this, _("Error Importing"),
+                               result.errorMessage, wxT("Importing_Audio"));
+            if (!result.success)
+               continue;
+
+            wxGetApp().AddFileToHistory(batch[ii]);
+            // Keep what the file's import did to the tags, as Import() would
+            if (!(*result.tags == *startTags))
+               mTags = result.tags;
+            FinishImport(batch[ii], std::move(result.tracks), nullptr);
+         }
+      }
+      batch.Clear();
+   };
+
+   for (const auto &fileName : fileNames) {
+      bool alone = fileName.AfterLast('.').IsSameAs(wxT("lof"), false);
+#ifdef USE_MIDI
+      alone = alone || Importer::IsMidi(fileName);
+#endif
+      if (alone) {
+         importBatch();
+#ifdef USE_MIDI
+         if (Importer::IsMidi(fileName))
+            DoImportMIDI(this, fileName);
+         else
+#endif
+            Import(fileName);
+      }
+      else
+         batch.Add(fileName);
+   }
+   importBatch();
+}
+
+bool AudacityProject::FinishImport(const wxString &fileName,
+                                   TrackHolders &&newTracks,
+                                   WaveTrackArray *pTrackArray)
+{
    // for LOF ("list of files") files, do not import the file as if it
    // were an audio file itself
    if (fileName.AfterLast('.').IsSameAs(wxT("lof"), false)) {
@@ -4440,8 +4742,6 @@ bool AudacityProject::Import(const wxString &fileName, WaveTrackArray* pTrackArr
          OnEffectFlags::kConfigured);
    }
 
-   // This is a no-fail:
-   GetDirManager()->FillBlockfilesCache();
    return true;
 }
 
@@ -4712,6 +5012,8 @@ void AudacityProject::PushState(const wxString &desc,
                           desc, shortDesc, flags);
 
    mDirty = true;
+   // A loop that plays from memory must hear the change
+   gAudioIO->InvalidateLoopCache();
 
    if (mHistoryWindow)
       mHistoryWindow->UpdateDisplay();
@@ -4747,6 +5049,7 @@ void AudacityProject::RollbackState()
 void AudacityProject::ModifyState(bool bWantsAutoSave)
 {
    GetUndoManager()->ModifyState(GetTracks(), mViewInfo.selectedRegion, mTags);
+   gAudioIO->InvalidateLoopCache();
    if (bWantsAutoSave)
       AutoSave();
    GetTrackPanel()->HandleCursorForPresentMouseState();
@@ -5118,6 +5421,13 @@ void AudacityProject::SetCaptureMeter(MeterPanel *capture)
 
 void AudacityProject::OnTimer(wxTimerEvent& WXUNUSED(event))
 {
+   if (mBackgroundSave &&
+       mBackgroundSave->done.load(std::memory_order_acquire))
+      FinishBackgroundSave();
+
+   ODResampleTask::FinishPending(*this);
+   BlockCompactor::Get().Poll(*this);
+
    MixerToolBar *mixerToolBar = GetMixerToolBar();
    if( mixerToolBar )
       mixerToolBar->UpdateControls();
@@ -5137,6 +5447,14 @@ void AudacityProject::OnTimer(wxTimerEvent& WXUNUSED(event))
 
          mStatusBar->SetStatusText(sMessage, mainStatusBarField);
       }
+
+      // Recorded blocks wait in memory for a slow disk, but not without limit
+      const auto depth = BlockWriteQueue::Get().GetDepth();
+      if (depth > BlockWriteQueue::WarningDepth)
+         mStatusBar->SetStatusText(
+            wxString::Format(_("Warning: the disk is not keeping up with recording (%lld blocks waiting)"),
+               (long long) depth),
+            mainStatusBarField);
    }
    else if(ODManager::IsInstanceCreated())
    {
@@ -5366,8 +5684,6 @@ void AudacityProject::TP_DisplayStatusMessage(const wxString &msg)
 
 void AudacityProject::TP_DisplaySelection()
 {
-   double audioTime;
-
    if (mRuler) {
       if (!gAudioIO->IsBusy() && !mLockPlayRegion)
          mRuler->SetPlayRegion(mViewInfo.selectedRegion.t0(),
@@ -5377,6 +5693,13 @@ void AudacityProject::TP_DisplaySelection()
          mRuler->Refresh();
    }
 
+   DisplaySelectionTimes();
+}
+
+void AudacityProject::DisplaySelectionTimes()
+{
+   double audioTime;
+
    if (gAudioIO->IsBusy())
       audioTime = gAudioIO->GetStreamTime();
    else {
@@ -5458,17 +5781,27 @@ void AudacityProject::AutoSave()
 {
    //    SonifyBeginAutoSave(); // part of RBD's r10680 stuff now backed out
 
-   // To minimize the possibility of race conditions, we first write to a
-   // file with the extension ".tmp", then rename the file to .autosave
-   wxString projName;
+   // Append to the journal already begun, if there is one.  Otherwise the
+   // journal is first written to a file with the extension ".tmp", then
+   // renamed to .autosave, to minimize the possibility of race conditions.
+   const bool append = !mAutoSaveFileName.IsEmpty() &&
+      mAutoSaveJournal->GetFileName() == mAutoSaveFileName;
 
-   if (mFileName.IsEmpty())
-      projName = wxT("New Project");
-   else
-      projName = wxFileName(mFileName).GetName();
+   wxString fn;
+   if (append)
+      fn = mAutoSaveFileName;
+   else {
+      wxString projName;
+
+      if (mFileName.IsEmpty())
+         projName = wxT("New Project");
+      else
+         projName = wxFileName(mFileName).GetName();
 
-   wxString fn = wxFileName(FileNames::AutoSaveDir(),
-      projName + wxString(wxT(" - ")) + CreateUniqueName()).GetFullPath();
+      fn = wxFileName(FileNames::AutoSaveDir(),
+         projName + wxString(wxT(" - ")) + CreateUniqueName()).GetFullPath()
+         + wxT(".autosave");
+   }
 
    // PRL:  I found a try-catch and rewrote it,
    // but this guard is unnecessary because AutoSaveFile does not throw
@@ -5476,17 +5809,17 @@ void AudacityProject::AutoSave()
    {
       VarSetter<bool> setter(&mAutoSaving, true, false);
 
-      AutoSaveFile buffer;
-      WriteXMLHeader(buffer);
-      WriteXML(buffer, false);
-      mStrOtherNamesArray.Clear();
-
-      wxFFile saveFile;
-      saveFile.Open(fn + wxT(".tmp"), wxT("wb"));
-      return buffer.Write(saveFile);
+      // While recording appends to the file, it must not be compacted
+      return mAutoSaveJournal->Save( fn, GetUndoManager()->GetCurrentTracks(),
+         !IsAudioActive(),
+         [&]( AutoSaveFile &buffer ) {
+            WriteXMLHeader(buffer);
+            WriteXML(buffer, false);
+            mStrOtherNamesArray.Clear();
+         } );
    } );
 
-   if (!success)
+   if (!success || append)
       return;
 
    // Now that we have a NEW auto-save file, DELETE the old one
@@ -5495,16 +5828,7 @@ void AudacityProject::AutoSave()
    if (!mAutoSaveFileName.IsEmpty())
       return; // could not remove auto-save file
 
-   if (!wxRenameFile(fn + wxT(".tmp"), fn + wxT(".autosave")))
-   {
-      AudacityMessageBox(
-         wxString::Format( _("Could not create autosave file: %s"),
-            fn + wxT(".autosave") ),
-         _("Error"), wxICON_STOP, this);
-      return;
-   }
-
-   mAutoSaveFileName += fn + wxT(".autosave");
+   mAutoSaveFileName = fn;
    // no-op cruft that's not #ifdefed for NoteTrack
    // See above for further comments.
    //   SonifyEndAutoSave();
@@ -5514,6 +5838,10 @@ void AudacityProject::DeleteCurrentAutoSaveFile()
 {
    if (!mAutoSaveFileName.IsEmpty())
    {
+      // Stop appending to it
+      if (mAutoSaveJournal->GetFileName() == mAutoSaveFileName)
+         mAutoSaveJournal->Reset();
+
       if (wxFileExists(mAutoSaveFileName))
       {
          if (!wxRemoveFile(mAutoSaveFileName))
@@ -43,6 +43,8 @@
 #include <wx/frame.h>
 #include <wx/intl.h>
 #include <wx/dcclient.h>
+#include <functional>
+#include <vector>
 
 #include "import/ImportRaw.h" // defines TrackHolders
 
@@ -58,10 +60,12 @@ class wxTimerEvent;
 
 class AudacityProject;
 class AutoSaveFile;
+class AutoSaveJournal;
 class Importer;
 class ODLock;
 class RecordingRecoveryHandler;
 class TrackList;
+class LabelTrack;
 class Tags;
 
 class TrackPanel;
@@ -105,7 +109,7 @@ class WaveClip;
 class BackgroundCell;
 
 
-AudacityProject *CreateNewAudacityProject();
+AudacityProject *CreateNewAudacityProject(bool bShow = true);
 AUDACITY_DLL_API AudacityProject *GetActiveProject();
 void RedrawAllProjects();
 void RefreshCursorForAllProjects();
@@ -280,6 +284,10 @@ public:
    // If pNewTrackList is passed in non-NULL, it gets filled with the pointers to NEW tracks.
    bool Import(const wxString &fileName, WaveTrackArray *pTrackArray = NULL);
 
+   // Imports several audio files, decoding as many as possible at once, and
+   // adds their tracks in the order of the names
+   void ImportFiles(const wxArrayString &fileNames);
+
    void ZoomAfterImport(Track *pTrack);
 
    // Takes array of unique pointers; returns array of shared
@@ -287,7 +295,26 @@ public:
    AddImportedTracks(const wxString &fileName,
                      TrackHolders &&newTracks);
 
+private:
+   // After the tracks of a file are imported
+   bool FinishImport(const wxString &fileName, TrackHolders &&newTracks,
+                     WaveTrackArray *pTrackArray);
+
+public:
+
    bool Save();
+
+   // Like Save(), but the file is written on a worker thread from the tracks
+   // of the current undo state, so that editing and playback go on.  The
+   // callback is called on the main thread with the result.  Projects not
+   // saved before, or with dependencies just imported, are saved at once
+   // by Save() instead.  Returns false if saving could not begin.
+   using SaveCallback = std::function< void( bool success ) >;
+   bool SaveInBackground( const SaveCallback &callback = {} );
+   bool IsSavingInBackground() const { return mBackgroundSave != nullptr; }
+   // Finish a save begun by SaveInBackground(), if any, waiting for it
+   void WaitForBackgroundSave();
+
    bool SaveAs(bool bWantSaveCopy = false, bool bLossless = false);
    bool SaveAs(const wxString & newFileName, bool bWantSaveCopy = false, bool addToHistory = true);
    // strProjectPathName is full path for aup except extension
@@ -295,6 +322,11 @@ public:
 
 private:
    bool DoSave(bool fromSaveAs, bool bWantSaveCopy, bool bLossless = false);
+   // Warnings before saving the project itself; false if the user declines
+   bool ConfirmSave();
+
+   struct BackgroundSave;
+   void FinishBackgroundSave();
 public:
 
    void Clear();
@@ -371,6 +403,8 @@ public:
    void OnShow(wxShowEvent & event);
    void OnMove(wxMoveEvent & event);
    void DoScroll();
+   // Has the summaries of a screen's width either side of the view read ahead
+   void PrefetchOffscreenSummaries();
    void OnScroll(wxScrollEvent & event);
    void OnCloseWindow(wxCloseEvent & event);
    void OnTimer(wxTimerEvent & event);
@@ -473,6 +507,10 @@ public:
    wxSize GetTPTracksUsableArea() /* not override */;
    void RefreshTPTrack(Track* pTrk, bool refreshbacking = true) /* not override */;
 
+   // Like TP_DisplaySelection(), but only the times in the toolbars, with
+   // no redrawing of the ruler
+   void DisplaySelectionTimes();
+
    // TrackPanel callback methods, overrides of TrackPanelListener
    void TP_DisplaySelection() override;
    void TP_DisplayStatusMessage(const wxString &msg) override;
@@ -551,6 +589,8 @@ public:
    XMLTagHandler *HandleXMLChild(const wxChar *tag) override;
    void WriteXML(
       XMLWriter &xmlFile, bool bWantSaveCopy) /* not override */;
+   // The start tag and attributes of the project, and its tags
+   void WriteXMLProjectStart(XMLWriter &xmlFile);
 
    void WriteXMLHeader(XMLWriter &xmlFile) const;
 
@@ -660,6 +700,19 @@ private:
 
    CommandFlag mLastFlags;
 
+   // The flags that GetUpdateFlags() finds by visiting the tracks, kept
+   // until the tracks or the undo history change.  The label tracks are
+   // kept too, because their labels and text selections are visited each
+   // time.
+   struct TrackFlagsCache {
+      const TrackList *tracks {};
+      unsigned long long trackGeneration {};
+      unsigned long long undoGeneration {};
+      bool valid { false };
+      CommandFlag flags { AlwaysEnabledFlag };
+      std::vector<LabelTrack*> labelTracks;
+   } mTrackFlagsCache;
+
    // Window elements
 
    std::unique_ptr<wxTimer> mTimer;
@@ -741,6 +794,12 @@ private:
    // Last auto-save file name and path (empty if none)
    wxString mAutoSaveFileName;
 
+   // Appends each auto-save to that file
+   std::unique_ptr<AutoSaveJournal> mAutoSaveJournal;
+
+   // Not null while SaveInBackground() runs
+   std::unique_ptr<BackgroundSave> mBackgroundSave;
+
    // Are we currently auto-saving or not?
    bool mAutoSaving{ false };
 
@@ -37,6 +37,10 @@
 */
 
 #include "Audacity.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <vector>
 #include <stdlib.h>
 #include <stdio.h>
@@ -54,14 +58,83 @@
 #define	M_PI		3.14159265358979323846  /* pi */
 #endif
 
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+static void PortableRealFFTf(fft_type *buffer, const FFTParam *h);
+static void PortableInverseRealFFTf(fft_type *buffer, const FFTParam *h);
+
+/*
+*  Time the 1x functions of RealFFTf48x against the portable ones, for
+*  one length, and choose the fastest that gives the same answers.  Their
+*  results are in the same bit-reversed order, so callers can't tell.
+*  The 4x functions transform four buffers at once, so they are left for
+*  callers like EffectEqualization48x that have four.
+*/
+static int ChooseVariant(FFTParam &h)
+{
+   const size_t fftlen = 2 * h.Points;
+   // The tables of the variants are sized for BR16
+   if (h.pow2Bits < 4 || h.pow2Bits > 16)
+      return -1;
+
+   std::vector<fft_type> input(fftlen), buffer(fftlen);
+   for (size_t i = 0; i < fftlen; i++)
+      input[i] = (fft_type)(sin(0.37 * i) + 0.5 * cos(2.9 * i));
+   auto expected = input;
+   PortableRealFFTf(expected.data(), &h);
+   auto expectedInverse = expected;
+   PortableInverseRealFFTf(expectedInverse.data(), &h);
+   fft_type largest = 0;
+   for (auto value : expected)
+      largest = std::max(largest, (fft_type)fabs(value));
+   auto close = [&](const std::vector<fft_type> &a,
+                    const std::vector<fft_type> &b){
+      for (size_t i = 0; i < fftlen; i++)
+         if (fabs(a[i] - b[i]) > 1e-4 * largest)
+            return false;
+      return true;
+   };
+
+   // About a quarter million points per candidate
+   const size_t repeats = std::max<size_t>(4, (1 << 18) / fftlen);
+   auto time = [&](const std::function<void(fft_type*)> &transform){
+      const auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < repeats; i++) {
+         buffer = input;
+         transform(buffer.data());
+      }
+      return std::chrono::steady_clock::now() - start;
+   };
+
+   int best = -1;
+   auto bestTime = time([&](fft_type *data){ PortableRealFFTf(data, &h); });
+   for (int variant : { FFT_SinCosBRTable, FFT_SinCosTableVBR16,
+        FFT_SinCosTableBR16, FFT_FastMathBR16, FFT_FastMathBR24 }) {
+      buffer = input;
+      RealFFTf1x(buffer.data(), &h, variant);
+      if (!close(buffer, expected))
+         continue;
+      buffer = expected;
+      InverseRealFFTf1x(buffer.data(), &h, variant);
+      if (!close(buffer, expectedInverse))
+         continue;
+
+      const auto variantTime = time([&](fft_type *data){
+         RealFFTf1x(data, &h, variant); });
+      if (variantTime < bestTime)
+         best = variant, bestTime = variantTime;
+   }
+   return best;
+}
+#endif
+
 /*
 *  Initialize the Sine table and Twiddle pointers (bit-reversed pointers)
 *  for the FFT routine.
 */
-HFFT InitializeFFT(size_t fftlen)
+static std::unique_ptr<FFTParam> InitializeFFT(size_t fftlen)
 {
    int temp;
-   HFFT h{ safenew FFTParam };
+   std::unique_ptr<FFTParam> h{ safenew FFTParam };
 
    /*
    *  FFT size is only half the number of data points
@@ -94,56 +167,34 @@ HFFT InitializeFFT(size_t fftlen)
    for(size_t i = 0; i < 32; i++)
       if((1 << i) & fftlen)
          h->pow2Bits = i;
+   h->variant = ChooseVariant(*h);
 #endif
 
    return h;
 }
 
-enum : size_t { MAX_HFFT = 10 };
-
-// Maintain a pool:
-static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
+// Maintain a pool, by length.  Lengths are powers of two, so there are
+// few, and the tables are kept until exit.  They are never changed after
+// they are made, so all threads may use them at once.
+static std::map< size_t, std::unique_ptr<FFTParam> > hFFTPool;
 wxCriticalSection getFFTMutex;
 
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
 HFFT GetFFT(size_t fftlen)
 {
-   // To do:  smarter policy about when to retain in the pool and when to
-   // allocate a unique instance.
-
    wxCriticalSectionLocker locker{ getFFTMutex };
-   
-   size_t h = 0;
-   auto n = fftlen/2;
-   auto size = hFFTArray.size();
-   for(;
-       (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
-       h++)
-      ;
-   if(h < size) {
-      if(hFFTArray[h] == NULL) {
-         hFFTArray[h].reset( InitializeFFT(fftlen).release() );
-      }
-      return HFFT{ hFFTArray[h].get() };
-   } else {
-      // All buffers used, so fall back to allocating a NEW set of tables
-      return InitializeFFT(fftlen);
-   }
+
+   auto &pParam = hFFTPool[fftlen];
+   if (!pParam)
+      pParam = InitializeFFT(fftlen);
+   return HFFT{ pParam.get() };
 }
 
 /* Release a previously requested handle to the FFT tables */
-void FFTDeleter::operator() (FFTParam *hFFT) const
+void FFTDeleter::operator() (FFTParam *) const
 {
-   wxCriticalSectionLocker locker{ getFFTMutex };
-
-   auto it = hFFTArray.begin(), end = hFFTArray.end();
-   while (it != end && it->get() != hFFT)
-      ++it;
-   if ( it != end )
-      ;
-   else
-      delete hFFT;
+   // The tables stay in the pool
 }
 
 /*
@@ -164,7 +215,11 @@ void FFTDeleter::operator() (FFTParam *hFFT) const
 *        values would be similar in amplitude to the input values, which is
 *        good when using fixed point arithmetic)
 */
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+static void PortableRealFFTf(fft_type *buffer, const FFTParam *h)
+#else
 void RealFFTf(fft_type *buffer, const FFTParam *h)
+#endif
 {
    fft_type *A,*B;
    const fft_type *sptr;
@@ -266,7 +321,11 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
 *        values would be similar in amplitude to the input values, which is
 *        good when using fixed point arithmetic)
 */
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+static void PortableInverseRealFFTf(fft_type *buffer, const FFTParam *h)
+#else
 void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
+#endif
 {
    fft_type *A,*B;
    const fft_type *sptr;
@@ -349,6 +408,26 @@ void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
    }
 }
 
+#ifdef EXPERIMENTAL_EQ_SSE_THREADED
+// Dispatch to the choice that GetFFT made for the length.  The variants
+// do not change the tables, though they are not declared const.
+void RealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   if (h->variant >= 0)
+      RealFFTf1x(buffer, const_cast<FFTParam*>(h), h->variant);
+   else
+      PortableRealFFTf(buffer, h);
+}
+
+void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   if (h->variant >= 0)
+      InverseRealFFTf1x(buffer, const_cast<FFTParam*>(h), h->variant);
+   else
+      PortableInverseRealFFTf(buffer, h);
+}
+#endif
+
 void ReorderToFreq(const FFTParam *hFFT, const fft_type *buffer,
 		   fft_type *RealOut, fft_type *ImagOut)
 {
@@ -12,6 +12,9 @@ struct FFTParam {
    size_t Points;
 #ifdef EXPERIMENTAL_EQ_SSE_THREADED
    int pow2Bits;
+   // The fastest of the RealFFTf48x 1x functions for this length, used by
+   // RealFFTf and InverseRealFFTf; or -1 to use none
+   int variant;
 #endif
 };
 
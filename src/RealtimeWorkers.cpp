@@ -0,0 +1,133 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeWorkers.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "RealtimeWorkers.h"
+
+#include <chrono>
+
+namespace {
+
+// The index half of the claim while a loop is being set up
+const uint64_t Closed = 0xffffffff;
+
+inline uint32_t GenerationOf( uint64_t claim ) { return claim >> 32; }
+inline size_t IndexOf( uint64_t claim ) { return claim & Closed; }
+
+// How long workers stay awake after a loop, for the next one
+const std::chrono::microseconds SpinTime { 1000 };
+// How long they sleep before looking again, in case a wakeup was missed
+const std::chrono::milliseconds SleepTime { 10 };
+
+}
+
+RealtimeWorkers::RealtimeWorkers( unsigned nWorkers )
+{
+   mWorkers.reserve( nWorkers );
+   for ( unsigned ii = 0; ii < nWorkers; ++ii )
+      mWorkers.emplace_back( [this]{ WorkerLoop(); } );
+}
+
+RealtimeWorkers::~RealtimeWorkers()
+{
+   mStopping = true;
+   {
+      // Don't let the notification fall between a worker's test and wait
+      std::lock_guard< std::mutex > lock{ mMutex };
+   }
+   mWakeCondition.notify_all();
+   for ( auto &worker : mWorkers )
+      worker.join();
+}
+
+void RealtimeWorkers::Run(
+   size_t count, Function function, const void *context )
+{
+   if ( count == 0 )
+      return;
+
+   if ( mWorkers.empty() || count == 1 ) {
+      // Skip the synchronization
+      for ( size_t ii = 0; ii < count; ++ii )
+         function( context, ii );
+      return;
+   }
+
+   // Close claims while the loop is described, so that a worker still
+   // looking at the last loop can't take an iteration of this one
+   const uint32_t generation = GenerationOf( mClaim.load() ) + 1;
+   mClaim.store( ( uint64_t( generation ) << 32 ) | Closed );
+   mFunction.store( function, std::memory_order_relaxed );
+   mContext.store( context, std::memory_order_relaxed );
+   mCount.store( count, std::memory_order_relaxed );
+   mDone.store( 0, std::memory_order_relaxed );
+   mClaim.store( uint64_t( generation ) << 32 );
+
+   // Spinning workers need no notification, and this takes no lock; a
+   // worker that misses it wakes at its timeout, or the caller does the work
+   if ( mSleeping.load() > 0 )
+      mWakeCondition.notify_all();
+
+   // The calling thread does whatever the workers have not yet claimed
+   RunIterations( generation );
+
+   while ( mDone.load( std::memory_order_acquire ) < count )
+      std::this_thread::yield();
+}
+
+void RealtimeWorkers::WorkerLoop()
+{
+   uint32_t generation = 0;
+   auto spinUntil = std::chrono::steady_clock::now() + SpinTime;
+   // Whether the worker has a loop it has not yet joined
+   const auto ready = [&]{
+      const auto claim = mClaim.load();
+      return GenerationOf( claim ) != generation &&
+         IndexOf( claim ) != Closed;
+   };
+
+   while ( !mStopping ) {
+      if ( ready() ) {
+         generation = GenerationOf( mClaim.load() );
+         RunIterations( generation );
+         spinUntil = std::chrono::steady_clock::now() + SpinTime;
+      }
+      else if ( std::chrono::steady_clock::now() < spinUntil )
+         std::this_thread::yield();
+      else {
+         ++mSleeping;
+         {
+            std::unique_lock< std::mutex > lock{ mMutex };
+            mWakeCondition.wait_for( lock, SleepTime, [&]{
+               return mStopping || ready(); } );
+         }
+         --mSleeping;
+      }
+   }
+}
+
+void RealtimeWorkers::RunIterations( uint32_t generation )
+{
+   // Take indices until none remain, or the loop is another's
+   auto claim = mClaim.load( std::memory_order_acquire );
+   while ( GenerationOf( claim ) == generation &&
+           IndexOf( claim ) < mCount.load( std::memory_order_relaxed ) ) {
+      if ( !mClaim.compare_exchange_weak( claim, claim + 1,
+              std::memory_order_acq_rel, std::memory_order_acquire ) )
+         continue;
+
+      mFunction.load( std::memory_order_relaxed )(
+         mContext.load( std::memory_order_relaxed ), IndexOf( claim ) );
+      mDone.fetch_add( 1, std::memory_order_release );
+
+      claim = mClaim.load( std::memory_order_acquire );
+   }
+}
@@ -0,0 +1,88 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeWorkers.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class RealtimeWorkers
+\brief Like ThreadPool, a fixed set of threads that share the iterations
+of a loop, but one that a realtime thread such as the PortAudio callback
+may call.
+
+  The caller of ParallelFor() never takes a lock and never sleeps.  It
+  claims iterations from the same counter as the workers, so a worker that
+  is late to wake just finds that the caller has done its share:  at worst
+  the loop runs serially.  The caller waits, spinning, only for iterations
+  that workers have already begun.
+
+  After each loop the workers spin for a short while, so that the next one
+  finds them awake, then sleep until woken.
+
+  The body must not throw.  Only one thread at a time may call
+  ParallelFor().
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_REALTIME_WORKERS__
+#define __AUDACITY_REALTIME_WORKERS__
+
+#include "Audacity.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RealtimeWorkers
+{
+public:
+   explicit RealtimeWorkers( unsigned nWorkers );
+   ~RealtimeWorkers();
+
+   RealtimeWorkers( const RealtimeWorkers& ) PROHIBITED;
+   RealtimeWorkers &operator= ( const RealtimeWorkers& ) PROHIBITED;
+
+   unsigned GetWorkers() const { return mWorkers.size(); }
+
+   // Call body(i) for each i in [0, count), in unspecified order and
+   // threads, and return when all are done.  Nothing is allocated.
+   template< typename Body >
+   void ParallelFor( size_t count, const Body &body )
+   {
+      Run( count, []( const void *context, size_t index ) {
+         ( *static_cast< const Body* >( context ) )( index );
+      }, &body );
+   }
+
+private:
+   using Function = void (*)( const void *context, size_t index );
+
+   void Run( size_t count, Function function, const void *context );
+   void WorkerLoop();
+   void RunIterations( uint32_t generation );
+
+   std::vector< std::thread > mWorkers;
+
+   // The generation of the loop in the high half, and the next iteration
+   // to claim in the low half, so that a worker still finishing one loop
+   // can't claim from the next
+   std::atomic< uint64_t > mClaim { 0 };
+   std::atomic< size_t > mCount { 0 };
+   std::atomic< size_t > mDone { 0 };
+   std::atomic< Function > mFunction { nullptr };
+   std::atomic< const void* > mContext { nullptr };
+
+   std::atomic< unsigned > mSleeping { 0 };
+   std::atomic< bool > mStopping { false };
+   std::mutex mMutex;
+   std::condition_variable mWakeCondition;
+};
+
+#endif
@@ -16,9 +16,9 @@
 
       libsoxr, written by Rob Sykes. LGPL.
 
-   Since Audacity always does resampling on mono streams that are
-   contiguous in memory, this class doesn't support multiple channels
-   or some of the other optional features of some of these resamplers.
+   Audacity resamples streams that are contiguous in memory, one buffer
+   for each channel.  Offline processing may resample the channels of a
+   stereo track at once, letting libsoxr use threads for them.
 
 *//*******************************************************************/
 
@@ -28,9 +28,12 @@
 #include "Internat.h"
 #include "../include/audacity/IdentInterface.h"
 
+#include <atomic>
 #include <soxr.h>
 
-Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+                   unsigned numChannels, bool threaded)
+   : mNumChannels{ numChannels }
 {
    this->SetMethod(useBestMethod);
    soxr_quality_spec_t q_spec;
@@ -44,7 +47,12 @@ Resample::Resample(const bool useBestMethod, const double dMinFactor, const doub
       mbWantConstRateResampling = false; // variable rate resampling
       q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
    }
-   mHandle.reset(soxr_create(1, dMinFactor, 1, 0, 0, &q_spec, 0));
+   // Channels are given as separate buffers; zero threads lets libsoxr
+   // choose how many
+   soxr_io_spec_t io_spec = soxr_io_spec(SOXR_FLOAT32_S, SOXR_FLOAT32_S);
+   soxr_runtime_spec_t runtime_spec = soxr_runtime_spec(threaded ? 0 : 1);
+   mHandle.reset(soxr_create(1, dMinFactor, numChannels, 0,
+                             &io_spec, &q_spec, &runtime_spec));
 }
 
 Resample::~Resample()
@@ -110,12 +118,28 @@ std::pair<size_t, size_t>
                         float  *outBuffer,
                         size_t  outBufferLen)
 {
+   wxASSERT(mNumChannels == 1);
+   return Process(factor, &inBuffer, inBufferLen, lastFlag,
+                  &outBuffer, outBufferLen);
+}
+
+std::pair<size_t, size_t>
+      Resample::Process(double  factor,
+                        float  *const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float  *const *outBuffers,
+                        size_t  outBufferLen)
+{
+   mProcessed = true;
+   // libsoxr only reads the array of output pointers
+   const auto outs = const_cast<float **>(outBuffers);
    size_t idone, odone;
    if (mbWantConstRateResampling)
    {
       soxr_process(mHandle.get(),
-            inBuffer , (lastFlag? ~inBufferLen : inBufferLen), &idone,
-            outBuffer,                           outBufferLen, &odone);
+            inBuffers , (lastFlag? ~inBufferLen : inBufferLen), &idone,
+            outs,                                 outBufferLen, &odone);
    }
    else
    {
@@ -123,16 +147,26 @@ std::pair<size_t, size_t>
 
       inBufferLen = lastFlag? ~inBufferLen : inBufferLen;
       soxr_process(mHandle.get(),
-            inBuffer , inBufferLen , &idone,
-            outBuffer, outBufferLen, &odone);
+            inBuffers , inBufferLen , &idone,
+            outs      , outBufferLen, &odone);
    }
    return { idone, odone };
 }
 
+// Copies of the settings, because wxConfig is not thread-safe
+static std::atomic<int> sFastMethod{ intChoicesMethod[fastMethodDefault] };
+static std::atomic<int> sBestMethod{ intChoicesMethod[bestMethodDefault] };
+
+void Resample::UpdateMethods()
+{
+   sFastMethod.store(FastMethodSetting.ReadInt());
+   sBestMethod.store(BestMethodSetting.ReadInt());
+}
+
 void Resample::SetMethod(const bool useBestMethod)
 {
    if (useBestMethod)
-      mMethod = BestMethodSetting.ReadInt();
+      mMethod = sBestMethod.load();
    else
-      mMethod = FastMethodSetting.ReadInt();
+      mMethod = sFastMethod.load();
 }
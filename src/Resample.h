@@ -42,12 +42,20 @@ class Resample final
    /// the fast method.
    // dMinFactor and dMaxFactor specify the range of factors for variable-rate resampling.
    // For constant-rate, pass the same value for both.
-   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
+   // A resampler of more than one channel takes a buffer for each in
+   // Process().  If threaded, the library may use several threads for the
+   // channels, which suits offline processing, but not playback.
+   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor,
+            unsigned numChannels = 1, bool threaded = false);
    ~Resample();
 
    static EncodedEnumSetting FastMethodSetting;
    static EncodedEnumSetting BestMethodSetting;
 
+   /// Reads the method settings, so that resamplers may then be made on any
+   /// thread.  Call on the main thread at startup and when they change.
+   static void UpdateMethods();
+
    /** @brief Main processing function. Resamples from the input buffer to the
     * output buffer.
     *
@@ -78,6 +86,21 @@ class Resample final
                         float  *outBuffer,
                         size_t  outBufferLen);
 
+   /// The same, for one buffer of each channel, all of the given lengths
+   std::pair<size_t, size_t>
+                Process(double  factor,
+                        float  *const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float  *const *outBuffers,
+                        size_t  outBufferLen);
+
+   unsigned GetNumChannels() const { return mNumChannels; }
+
+   /// Whether Process() was called, so that the resampler holds samples of
+   /// a signal, and can't serve for a fresh one
+   bool HasProcessed() const { return mProcessed; }
+
  protected:
    void SetMethod(const bool useBestMethod);
 
@@ -85,6 +108,8 @@ class Resample final
    int   mMethod; // resampler-specific enum for resampling method
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
    bool mbWantConstRateResampling;
+   unsigned mNumChannels;
+   bool mProcessed { false };
 };
 
 #endif // __AUDACITY_RESAMPLE_H__
@@ -184,3 +184,40 @@ size_t RingBuffer::Discard(size_t samplesToDiscard)
 
    return samplesToDiscard;
 }
+
+//
+// Zero-copy access
+// The acquire and release orderings are the same as in Put() and Get(),
+// split between the acquisition of a region and its commit
+//
+
+samplePtr RingBuffer::AcquireForPut(size_t &samples)
+{
+   auto start = mStart.load( std::memory_order_acquire );
+   auto end = mEnd.load( std::memory_order_relaxed );
+   samples = std::min( Free( start, end ), mBufferSize - end );
+   return mBuffer.ptr() + end * SAMPLE_SIZE(mFormat);
+}
+
+void RingBuffer::CommitPut(size_t samples)
+{
+   auto end = mEnd.load( std::memory_order_relaxed );
+   // Caller must not commit more than was acquired
+   mEnd.store( (end + samples) % mBufferSize, std::memory_order_release );
+}
+
+samplePtr RingBuffer::AcquireForGet(size_t &samples)
+{
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   samples = std::min( Filled( start, end ), mBufferSize - start );
+   return mBuffer.ptr() + start * SAMPLE_SIZE(mFormat);
+}
+
+void RingBuffer::CommitGet(size_t samples)
+{
+   auto start = mStart.load( std::memory_order_relaxed );
+   // Release, because the reader may have written in place to the region
+   // that the writer will now reuse
+   mStart.store( (start + samples) % mBufferSize, std::memory_order_release );
+}
@@ -35,6 +35,26 @@ class RingBuffer {
    size_t Get(samplePtr buffer, sampleFormat format, size_t samples);
    size_t Discard(size_t samples);
 
+   //
+   // Zero-copy access, for callers that can use the buffer's own
+   // sampleFormat.  Each call returns the largest contiguous region, which
+   // may be shorter than the total available because of wrap-around; the
+   // region stays valid only until the matching commit.
+   //
+
+   // For the writer only:
+   samplePtr AcquireForPut(size_t &samples);
+   void CommitPut(size_t samples);
+
+   // For the reader only:
+   // The reader may also modify the samples in place before committing.
+   samplePtr AcquireForGet(size_t &samples);
+   void CommitGet(size_t samples);
+
+   sampleFormat GetFormat() const { return mFormat; }
+   // The most samples it can hold
+   size_t GetCapacity() const { return mBufferSize - 4; }
+
  private:
    size_t Filled( size_t start, size_t end );
    size_t Free( size_t start, size_t end );
@@ -46,6 +66,12 @@ class RingBuffer {
       std::hardware_destructive_interference_size;
     */
 
+   // Members that never change after construction come first, so that
+   // they share no cache line with either of the atomics below
+   sampleFormat  mFormat;
+   const size_t  mBufferSize;
+   SampleBuffer  mBuffer;
+
    // Align the two atomics to avoid false sharing
    // TODO MSVC2017: use alignas
 #ifdef __WXMSW__
@@ -61,11 +87,8 @@ class RingBuffer {
    alignas(CacheLine)
 #endif
       std::atomic<size_t> mEnd{ 0 };
-
-   const size_t  mBufferSize;
-
-   sampleFormat  mFormat;
-   SampleBuffer  mBuffer;
+   // (The alignment also rounds the size of the whole object up to whole
+   // cache lines, so nothing allocated after it can share the line of mEnd)
 };
 
 #endif /*  __AUDACITY_RING_BUFFER__ */
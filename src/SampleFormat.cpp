@@ -48,7 +48,82 @@
 
 static DitherType gLowQualityDither = DitherType::none;
 static DitherType gHighQualityDither = DitherType::none;
-static Dither gDitherAlgorithm;
+// Each thread has its own, because dithering keeps state
+static thread_local Dither gDitherAlgorithm;
+
+namespace {
+   // Buffers of BufferPool are at least this many bytes, and those of more
+   // than the largest class are not kept
+   const unsigned MinClassShift = 12;
+   const unsigned MaxClassShift = 24;
+   const size_t BuffersPerClass = 2;
+   const size_t MaxCachedBytes = 32 * 1048576;
+
+   // Trivially destructible, so that buffers freed in static destructors,
+   // after the pool of the thread is destroyed, are freed directly
+   thread_local bool sPoolDestroyed = false;
+
+   struct ThreadBufferPool {
+      ~ThreadBufferPool()
+      {
+         sPoolDestroyed = true;
+         for (unsigned shift = 0; shift <= MaxClassShift; ++shift)
+            for (size_t ii = 0; ii < mCounts[shift]; ++ii)
+               free(mFree[shift][ii]);
+      }
+
+      void *mFree[MaxClassShift + 1][BuffersPerClass] {};
+      size_t mCounts[MaxClassShift + 1] {};
+      size_t mCachedBytes {};
+   };
+
+   ThreadBufferPool *GetThreadPool()
+   {
+      if (sPoolDestroyed)
+         return nullptr;
+      static thread_local ThreadBufferPool pool;
+      return &pool;
+   }
+
+   unsigned ClassShift(size_t bytes)
+   {
+      unsigned shift = MinClassShift;
+      while (shift <= MaxClassShift && (size_t(1) << shift) < bytes)
+         ++shift;
+      return shift;
+   }
+}
+
+// static
+void *BufferPool::Acquire(size_t &bytes)
+{
+   const auto shift = ClassShift(bytes);
+   if (shift > MaxClassShift)
+      return malloc(bytes);
+
+   bytes = size_t(1) << shift;
+   auto pool = GetThreadPool();
+   if (pool && pool->mCounts[shift] > 0) {
+      pool->mCachedBytes -= bytes;
+      return pool->mFree[shift][--pool->mCounts[shift]];
+   }
+   return malloc(bytes);
+}
+
+// static
+void BufferPool::Release(void *pointer, size_t bytes)
+{
+   const auto shift = ClassShift(bytes);
+   auto pool = GetThreadPool();
+   if (shift <= MaxClassShift && bytes == (size_t(1) << shift) && pool &&
+       pool->mCounts[shift] < BuffersPerClass &&
+       pool->mCachedBytes + bytes <= MaxCachedBytes) {
+      pool->mCachedBytes += bytes;
+      pool->mFree[shift][pool->mCounts[shift]++] = pointer;
+      return;
+   }
+   free(pointer);
+}
 
 void InitDitherers()
 {
@@ -99,6 +174,55 @@ void ReverseSamples(samplePtr dst, sampleFormat format,
    }
 }
 
+// Little-endian machines do four samples at a time, as three 32-bit words
+void PackInt24(const int *src, unsigned char *dst, size_t len)
+{
+   size_t i = 0;
+#if wxBYTE_ORDER == wxLITTLE_ENDIAN
+   for (; i + 4 <= len; i += 4, dst += 12) {
+      const auto a = (wxUint32)src[i], b = (wxUint32)src[i + 1],
+         c = (wxUint32)src[i + 2], d = (wxUint32)src[i + 3];
+      const wxUint32 words[3] = {
+         (a & 0xffffff) | (b << 24),
+         ((b >> 8) & 0xffff) | (c << 16),
+         ((c >> 16) & 0xff) | (d << 8)
+      };
+      memcpy(dst, words, sizeof words);
+   }
+#endif
+   for (; i < len; ++i, dst += 3) {
+      const auto sample = (wxUint32)src[i];
+#if wxBYTE_ORDER == wxBIG_ENDIAN
+      dst[0] = sample >> 16, dst[1] = sample >> 8, dst[2] = sample;
+#else
+      dst[0] = sample, dst[1] = sample >> 8, dst[2] = sample >> 16;
+#endif
+   }
+}
+
+void UnpackInt24(const unsigned char *src, int *dst, size_t len)
+{
+   size_t i = 0;
+#if wxBYTE_ORDER == wxLITTLE_ENDIAN
+   for (; i + 4 <= len; i += 4, src += 12) {
+      wxUint32 words[3];
+      memcpy(words, src, sizeof words);
+      // Shift each sample to the top, then back down, extending the sign
+      dst[i] = (int)(words[0] << 8) >> 8;
+      dst[i + 1] = (int)(((words[0] >> 24) | (words[1] << 8)) << 8) >> 8;
+      dst[i + 2] = (int)(((words[1] >> 16) | (words[2] << 16)) << 8) >> 8;
+      dst[i + 3] = (int)words[2] >> 8;
+   }
+#endif
+   for (; i < len; ++i, src += 3)
+      dst[i] =
+#if wxBYTE_ORDER == wxBIG_ENDIAN
+         ((signed char)src[0] << 16) | (src[1] << 8) | src[2];
+#else
+         ((signed char)src[2] << 16) | (src[1] << 8) | src[0];
+#endif
+}
+
 void CopySamples(samplePtr src, sampleFormat srcFormat,
                  samplePtr dst, sampleFormat dstFormat,
                  unsigned int len,
@@ -14,6 +14,8 @@
 #include "Audacity.h"
 #include "MemoryX.h"
 #include <wx/defs.h>
+#include <new>
+#include <type_traits>
 
 #include "audacity/Types.h"
 
@@ -49,14 +51,27 @@ const wxChar *GetSampleFormatStr(sampleFormat format);
 // Allocating/Freeing Samples
 //
 
+// Memory for temporary buffers, as made per call or per block in playback,
+// drawing and effects.  Each thread keeps a few freed buffers of each size
+// class, a power of two, for the next to ask for one.
+class BufferPool {
+public:
+   // Returns at least bytes, and changes bytes to the size of the class,
+   // to be passed to Release.  Returns null if memory is exhausted.
+   static void *Acquire(size_t &bytes);
+   // May be called on another thread than Acquire
+   static void Release(void *pointer, size_t bytes);
+};
+
 class SampleBuffer {
 
 public:
    SampleBuffer()
-      : mPtr(0)
+      : mBytes(0), mPtr(0)
    {}
    SampleBuffer(size_t count, sampleFormat format)
-      : mPtr((samplePtr)malloc(count * SAMPLE_SIZE(format)))
+      : mBytes(count * SAMPLE_SIZE(format))
+      , mPtr((samplePtr)BufferPool::Acquire(mBytes))
    {}
    ~SampleBuffer()
    {
@@ -67,14 +82,16 @@ public:
    SampleBuffer &Allocate(size_t count, sampleFormat format)
    {
       Free();
-      mPtr = (samplePtr)malloc(count * SAMPLE_SIZE(format));
+      mBytes = count * SAMPLE_SIZE(format);
+      mPtr = (samplePtr)BufferPool::Acquire(mBytes);
       return *this;
    }
 
 
    void Free()
    {
-      free(mPtr);
+      if (mPtr)
+         BufferPool::Release(mPtr, mBytes);
       mPtr = 0;
    }
 
@@ -82,9 +99,54 @@ public:
 
 
 private:
+   size_t mBytes;
    samplePtr mPtr;
 };
 
+// Like ArrayOf, but for temporaries of trivial types, from BufferPool.
+// The elements are not initialized.
+template<typename X>
+class PooledArrayOf {
+public:
+   static_assert(std::is_trivial<X>::value, "Trivial types only");
+
+   PooledArrayOf() {}
+   explicit PooledArrayOf(size_t count)
+   {
+      reinit(count);
+   }
+   ~PooledArrayOf()
+   {
+      Free();
+   }
+   PooledArrayOf(const PooledArrayOf&) PROHIBITED;
+   PooledArrayOf &operator= (const PooledArrayOf&) PROHIBITED;
+
+   void reinit(size_t count)
+   {
+      Free();
+      mBytes = count * sizeof(X);
+      mPtr = static_cast<X*>(BufferPool::Acquire(mBytes));
+      if (!mPtr)
+         throw std::bad_alloc{};
+   }
+
+   X *get() const { return mPtr; }
+   X &operator[] (size_t index) const { return mPtr[index]; }
+   explicit operator bool () const { return mPtr != nullptr; }
+
+private:
+   void Free()
+   {
+      if (mPtr)
+         BufferPool::Release(mPtr, mBytes);
+      mPtr = nullptr;
+   }
+
+   size_t mBytes {};
+   X *mPtr {};
+};
+
 class GrowableSampleBuffer : private SampleBuffer
 {
 public:
@@ -141,6 +203,11 @@ void      ClearSamples(samplePtr buffer, sampleFormat format,
 void      ReverseSamples(samplePtr buffer, sampleFormat format,
                          int start, int len);
 
+// 24-bit samples are stored in three bytes each, in native byte order,
+// but held in memory padded to 32 bits; these convert between the two
+void      PackInt24(const int *src, unsigned char *dst, size_t len);
+void      UnpackInt24(const unsigned char *src, int *dst, size_t len);
+
 //
 // This must be called on startup and everytime NEW ditherers
 // are set in preferences.
@@ -43,13 +43,16 @@
 #include "AudacityException.h"
 
 #include "BlockFile.h"
+#include "BlockPrefetchQueue.h"
 #include "blockfile/ODDecodeBlockFile.h"
 #include "DirManager.h"
 
+#include "blockfile/PackedBlockFile.h"
 #include "blockfile/SimpleBlockFile.h"
 #include "blockfile/SilentBlockFile.h"
 
 #include "InconsistencyException.h"
+#include "Profiler.h"
 
 #include "widgets/ErrorDialog.h"
 
@@ -114,6 +117,23 @@ bool Sequence::Unlock()
    return true;
 }
 
+bool Sequence::SharesBlocks(const Sequence &other) const
+{
+   if (mSampleFormat != other.mSampleFormat ||
+       mMinSamples != other.mMinSamples ||
+       mMaxSamples != other.mMaxSamples ||
+       mNumSamples != other.mNumSamples ||
+       mBlock.size() != other.mBlock.size())
+      return false;
+
+   for (size_t ii = 0, nn = mBlock.size(); ii < nn; ++ii)
+      if (mBlock[ii].f != other.mBlock[ii].f ||
+          mBlock[ii].start != other.mBlock[ii].start)
+         return false;
+
+   return true;
+}
+
 sampleFormat Sequence::GetSampleFormat() const
 {
    return mSampleFormat;
@@ -387,6 +407,42 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
    return sqrt(sumsq / length.as_double() );
 }
 
+double Sequence::GetSum(sampleCount start, sampleCount len, bool mayThrow) const
+{
+   if (len == 0 || mBlock.size() == 0)
+      return 0.0;
+
+   double sum = 0.0;
+
+   unsigned int block0 = FindBlock(start);
+   unsigned int block1 = FindBlock(start + len - 1);
+
+   // Each entire block reads its samples at most once, then keeps its sum
+   for (unsigned b = block0 + 1; b < block1; b++) {
+      const auto &theFile = mBlock[b].f;
+      sum += theFile->GetSum(0, theFile->GetLength(), mayThrow);
+   }
+
+   {
+      const SeqBlock &theBlock = mBlock[block0];
+      const auto &theFile = theBlock.f;
+      const auto s0 = ( start - theBlock.start ).as_size_t();
+      const auto maxl0 =
+         (theBlock.start + theFile->GetLength() - start).as_size_t();
+      const auto l0 = limitSampleBufferSize( maxl0, len );
+      sum += theFile->GetSum(s0, l0, mayThrow);
+   }
+
+   if (block1 > block0) {
+      const SeqBlock &theBlock = mBlock[block1];
+      const auto &theFile = theBlock.f;
+      const auto l0 = ( start + len - theBlock.start ).as_size_t();
+      sum += theFile->GetSum(0, l0, mayThrow);
+   }
+
+   return sum;
+}
+
 std::unique_ptr<Sequence> Sequence::Copy(sampleCount s0, sampleCount s1) const
 {
    auto dest = std::make_unique<Sequence>(mDirManager, mSampleFormat);
@@ -511,8 +567,10 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       // onto the end because the current last block is longer than the
       // minimum size
 
-      // Build and swap a copy so there is a strong exception safety guarantee
-      BlockArray newBlock{ mBlock };
+      // Build the added blocks apart so there is a strong exception safety
+      // guarantee
+      BlockArray newBlock;
+      newBlock.reserve(srcNumBlocks);
       sampleCount samples = mNumSamples;
       for (unsigned int i = 0; i < srcNumBlocks; i++)
          // AppendBlock may throw for limited disk space, if pasting from
@@ -520,8 +578,8 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          AppendBlock(*mDirManager, newBlock, samples, srcBlock[i]);
          // Increase ref count or duplicate file
 
-      CommitChangesIfConsistent
-         (newBlock, samples, wxT("Paste branch one"));
+      AppendBlocksIfConsistent
+         (newBlock, false, samples, wxT("Paste branch one"));
       return;
    }
 
@@ -577,10 +635,9 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    // Case three: if we are inserting four or fewer blocks,
    // it's simplest to just lump all the data together
    // into one big block along with the split block,
-   // then resplit it all
+   // then resplit it all.  The NEW blocks replace the split block.
    BlockArray newBlock;
-   newBlock.reserve(numBlocks + srcNumBlocks + 2);
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b);
+   newBlock.reserve(srcNumBlocks + 4);
 
    SeqBlock &splitBlock = mBlock[b];
    auto splitLen = splitBlock.f->GetLength();
@@ -608,55 +665,131 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    } else {
 
       // The final case is that we're inserting at least five blocks.
-      // We divide these into three groups: the first two get merged
-      // with the first half of the split block, the middle ones get
-      // copied in as is, and the last two get merged with the last
-      // half of the split block.
-
-      const auto srcFirstTwoLen =
-          srcBlock[0].f->GetLength() + srcBlock[1].f->GetLength();
-      const auto leftLen = splitPoint + srcFirstTwoLen;
-
-      const SeqBlock &penultimate = srcBlock[srcNumBlocks - 2];
-      const auto srcLastTwoLen =
-         penultimate.f->GetLength() +
-         srcBlock[srcNumBlocks - 1].f->GetLength();
-      const auto rightSplit = splitBlock.f->GetLength() - splitPoint;
-      const auto rightLen = rightSplit + srcLastTwoLen;
-
-      SampleBuffer sampleBuffer(std::max(leftLen, rightLen), mSampleFormat);
-
-      Read(sampleBuffer.ptr(), mSampleFormat, splitBlock, 0, splitPoint, true);
-      src->Get(0, sampleBuffer.ptr() + splitPoint*sampleSize,
-         mSampleFormat, 0, srcFirstTwoLen, true);
-
-      Blockify(*mDirManager, mMaxSamples, mSampleFormat,
-               newBlock, splitBlock.start, sampleBuffer.ptr(), leftLen);
+      // The pasted blocks are shared as they are, except that a part of
+      // the split block too short to stand alone is merged with the
+      // neighbouring pasted block.  So only the blocks at the edges are
+      // written, and none at all when pasting at a block boundary, as
+      // for repeated pastes one after another.
+
+      const SeqBlock &first = srcBlock[0];
+      const SeqBlock &last = srcBlock[srcNumBlocks - 1];
+      const auto firstLen = first.f->GetLength();
+      const auto lastLen = last.f->GetLength();
+      const auto rightSplit = splitLen - splitPoint;
+      const bool mergeLeft = splitPoint > 0 && splitPoint < mMinSamples;
+      const bool mergeRight = rightSplit > 0 && rightSplit < mMinSamples;
+
+      SampleBuffer sampleBuffer(
+         std::max(splitPoint + firstLen, rightSplit + lastLen), mSampleFormat);
+
+      if (mergeLeft) {
+         Read(sampleBuffer.ptr(), mSampleFormat, splitBlock, 0, splitPoint, true);
+         src->Get(0, sampleBuffer.ptr() + splitPoint*sampleSize,
+            mSampleFormat, 0, firstLen, true);
+         Blockify(*mDirManager, mMaxSamples, mSampleFormat,
+                  newBlock, splitBlock.start, sampleBuffer.ptr(),
+                  splitPoint + firstLen);
+      }
+      else if (rightSplit == 0)
+         // Pasting after the whole block
+         newBlock.push_back(splitBlock);
+      else if (splitPoint > 0) {
+         Read(sampleBuffer.ptr(), mSampleFormat, splitBlock, 0, splitPoint, true);
+         Blockify(*mDirManager, mMaxSamples, mSampleFormat,
+                  newBlock, splitBlock.start, sampleBuffer.ptr(), splitPoint);
+      }
 
-      for (i = 2; i < srcNumBlocks - 2; i++) {
+      const unsigned int end = mergeRight ? srcNumBlocks - 1 : srcNumBlocks;
+      for (i = mergeLeft ? 1 : 0; i < end; i++) {
          const SeqBlock &block = srcBlock[i];
          auto file = mDirManager->CopyBlockFile(block.f);
          // We can assume file is not null
          newBlock.push_back(SeqBlock(file, block.start + s));
       }
 
-      auto lastStart = penultimate.start;
-      src->Get(srcNumBlocks - 2, sampleBuffer.ptr(), mSampleFormat,
-               lastStart, srcLastTwoLen, true);
-      Read(sampleBuffer.ptr() + srcLastTwoLen * sampleSize, mSampleFormat,
-           splitBlock, splitPoint, rightSplit, true);
+      if (mergeRight) {
+         src->Get(srcNumBlocks - 1, sampleBuffer.ptr(), mSampleFormat,
+                  last.start, lastLen, true);
+         Read(sampleBuffer.ptr() + lastLen * sampleSize, mSampleFormat,
+              splitBlock, splitPoint, rightSplit, true);
+         Blockify(*mDirManager, mMaxSamples, mSampleFormat,
+                  newBlock, s + last.start, sampleBuffer.ptr(),
+                  lastLen + rightSplit);
+      }
+      else if (splitPoint == 0)
+         // Pasting before the whole block
+         newBlock.push_back(SeqBlock(splitBlock.f, s + addedLen));
+      else if (rightSplit > 0) {
+         Read(sampleBuffer.ptr(), mSampleFormat, splitBlock, splitPoint,
+              rightSplit, true);
+         Blockify(*mDirManager, mMaxSamples, mSampleFormat,
+                  newBlock, s + addedLen, sampleBuffer.ptr(), rightSplit);
+      }
+   }
+
+   SpliceBlocksIfConsistent
+      (b, b + 1, newBlock, addedLen, wxT("Paste branch three"));
+}
 
-      Blockify(*mDirManager, mMaxSamples, mSampleFormat,
-               newBlock, s + lastStart, sampleBuffer.ptr(), rightLen);
+std::vector<Sequence::BlockRun> Sequence::FindSmallBlockRuns() const
+{
+   std::vector<BlockRun> runs;
+   const auto numBlocks = mBlock.size();
+   for (size_t b = 0; b < numBlocks;) {
+      size_t count = 0;
+      size_t total = 0;
+      for (; b + count < numBlocks; ++count) {
+         const auto &file = *mBlock[b + count].f;
+         const auto len = file.GetLength();
+         if (file.IsAlias() || !file.IsDataAvailable() ||
+             len >= mMinSamples || total + len > mMaxSamples)
+            break;
+         total += len;
+      }
+      if (count >= 2)
+         runs.push_back({ b, count });
+      b += std::max<size_t>(1, count);
    }
+   return runs;
+}
 
-   // Copy remaining blocks to NEW block array and
-   // swap the NEW block array in for the old
-   for (i = b + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(addedLen));
+void Sequence::MergeBlocks(const BlockRun &run, samplePtr buffer)
+// STRONG-GUARANTEE
+{
+   const auto first = run.first, last = run.first + run.second;
+   if (run.second < 2 || last > mBlock.size())
+      THROW_INCONSISTENCY_EXCEPTION;
 
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
+   DeleteUpdateMutexLocker locker(*this);
+
+   const auto start = mBlock[first].start;
+   const auto end = last < mBlock.size() ? mBlock[last].start : mNumSamples;
+   const auto len = (end - start).as_size_t();
+
+   BlockArray newBlock;
+   newBlock.push_back(SeqBlock(
+      mDirManager->NewSimpleBlockFile(buffer, len, mSampleFormat), start));
+   SpliceBlocksIfConsistent(first, last, newBlock, 0, wxT("MergeBlocks"));
+}
+
+bool Sequence::AdoptBorrowedBlocks()
+// STRONG-GUARANTEE
+{
+   BlockArray newBlock;
+   newBlock.reserve(mBlock.size());
+   bool adopted = false;
+   for (const auto &block : mBlock) {
+      auto file = mDirManager->AdoptBlockFile(block.f);
+      adopted = adopted || (file != block.f);
+      newBlock.push_back(SeqBlock(file, block.start));
+   }
+   if (!adopted)
+      return false;
+
+   // Same samples, so no consistency check is needed
+   DeleteUpdateMutexLocker locker(*this);
+   mBlock.swap(newBlock);
+   return true;
 }
 
 void Sequence::SetSilence(sampleCount s0, sampleCount len)
@@ -665,6 +798,41 @@ void Sequence::SetSilence(sampleCount s0, sampleCount len)
    SetSamples(NULL, mSampleFormat, s0, len);
 }
 
+void Sequence::Reverse()
+// STRONG-GUARANTEE
+{
+   BlockArray newBlock;
+   newBlock.reserve(mBlock.size());
+
+   SampleBuffer buffer(mMaxSamples, mSampleFormat);
+   sampleCount start = 0;
+   for (auto iter = mBlock.rbegin(), end = mBlock.rend(); iter != end; ++iter) {
+      const SeqBlock &block = *iter;
+      const auto len = block.f->GetLength();
+      auto file = block.f;
+      // Reversed silence is the same silence
+      if (!dynamic_cast<const SilentBlockFile*>(file.get())) {
+         Read(buffer.ptr(), mSampleFormat, block, 0, len, true);
+         switch (mSampleFormat) {
+         case int16Sample:
+            std::reverse((short *)buffer.ptr(), (short *)buffer.ptr() + len);
+            break;
+         case int24Sample:
+            std::reverse((int *)buffer.ptr(), (int *)buffer.ptr() + len);
+            break;
+         case floatSample:
+            std::reverse((float *)buffer.ptr(), (float *)buffer.ptr() + len);
+            break;
+         }
+         file = mDirManager->NewSimpleBlockFile(buffer.ptr(), len, mSampleFormat);
+      }
+      newBlock.push_back(SeqBlock(file, start));
+      start += len;
+   }
+
+   CommitChangesIfConsistent(newBlock, mNumSamples, wxT("Reverse"));
+}
+
 void Sequence::InsertSilence(sampleCount s0, sampleCount len)
 // STRONG-GUARANTEE
 {
@@ -693,7 +861,7 @@ void Sequence::InsertSilence(sampleCount s0, sampleCount len)
 
    BlockFilePtr silentFile {};
    if (len >= idealSamples)
-      silentFile = make_blockfile<SilentBlockFile>(idealSamples);
+      silentFile = SilentBlockFile::Get(idealSamples);
    while (len >= idealSamples) {
       sTrack.mBlock.push_back(SeqBlock(silentFile, pos));
 
@@ -703,7 +871,7 @@ void Sequence::InsertSilence(sampleCount s0, sampleCount len)
    if (len != 0) {
       sTrack.mBlock.push_back(SeqBlock(
          // len is not more than idealSamples:
-         make_blockfile<SilentBlockFile>( len.as_size_t() ), pos));
+         SilentBlockFile::Get( len.as_size_t() ), pos));
       pos += len;
    }
 
@@ -732,6 +900,25 @@ void Sequence::AppendAlias(const wxString &fullPath,
    mNumSamples += len;
 }
 
+void Sequence::AppendAlias(const wxString &fullPath,
+                           sampleCount start,
+                           size_t len, int channel,
+                           samplePtr buffer, sampleFormat format)
+// STRONG-GUARANTEE
+{
+   // Quick check to make sure that it doesn't overflow
+   if (Overflows((mNumSamples.as_double()) + ((double)len)))
+      THROW_INCONSISTENCY_EXCEPTION;
+
+   SeqBlock newBlock(
+      mDirManager->NewAliasBlockFile(fullPath, start, len, channel,
+                                     buffer, format),
+      mNumSamples
+   );
+   mBlock.push_back(newBlock);
+   mNumSamples += len;
+}
+
 void Sequence::AppendCoded(const wxString &fName, sampleCount start,
                             size_t len, int channel, int decodeType)
 // STRONG-GUARANTEE
@@ -936,6 +1123,12 @@ bool Sequence::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
          }
       } // while
 
+      // Blocks of a loaded sequence are mostly full, so this is near the
+      // count, and saves reallocating a large array as they are read.
+      // Don't trust a damaged file for more than a generous guess.
+      const auto expected = mNumSamples / mMaxSamples + 1;
+      mBlock.reserve( std::min( expected, sampleCount{ 1 << 20 } ).as_size_t() );
+
       //// Both mMaxSamples and mSampleFormat should have been set.
       //// Check that mMaxSamples is right for mSampleFormat, using the calculations from the constructor.
       //if ((mMinSamples != sMaxDiskBlockSize / SAMPLE_SIZE(mSampleFormat) / 2) ||
@@ -956,6 +1149,10 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
    if (wxStrcmp(tag, wxT("sequence")) != 0)
       return;
 
+   // Don't keep the spare capacity of the array for the life of the project
+   if (mBlock.capacity() > mBlock.size() + mBlock.size() / 8)
+      mBlock.shrink_to_fit();
+
    // Make sure that the sequence is valid.
    // First, replace missing blockfiles with SilentBlockFiles
    for (unsigned b = 0, nn = mBlock.size(); b < nn; b++) {
@@ -980,7 +1177,7 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
             len = mMaxSamples;
          }
          // len is at most mMaxSamples:
-         block.f = make_blockfile<SilentBlockFile>( len.as_size_t() );
+         block.f = SilentBlockFile::Get( len.as_size_t() );
          wxLogWarning(
             wxT("Gap detected in project file. Replacing missing block file with silence."));
          mErrorOpening = true;
@@ -1077,6 +1274,71 @@ void Sequence::WriteXML(XMLWriter &xmlFile) const
    xmlFile.EndTag(wxT("sequence"));
 }
 
+void Sequence::CollectBlockFiles(sampleCount start, sampleCount len,
+   std::vector< std::weak_ptr<BlockFile> > &files) const
+{
+   if (start < 0) {
+      len += start;
+      start = 0;
+   }
+   len = std::min(len, mNumSamples - start);
+   if (len <= 0)
+      return;
+
+   for (size_t b = FindBlock(start), numBlocks = mBlock.size();
+        b < numBlocks && mBlock[b].start < start + len; ++b)
+      files.push_back(mBlock[b].f);
+}
+
+void Sequence::GetPeakGroups(sampleCount start, sampleCount len,
+   std::vector<PeakGroup> &groups) const
+{
+   if (start < 0) {
+      len += start;
+      start = 0;
+   }
+   len = std::min(len, mNumSamples - start);
+   if (len <= 0)
+      return;
+
+   const auto end = start + len;
+   for (size_t b = FindBlock(start), numBlocks = mBlock.size();
+        b < numBlocks && mBlock[b].start < end; ++b) {
+      const SeqBlock &theBlock = mBlock[b];
+      const auto &theFile = theBlock.f;
+      if (!theFile->IsSummaryAvailable())
+         continue;
+
+      // Groups of the block from the first starting in the region, to the
+      // last ending in it; only the last of the block may be short
+      const auto fileLen = theFile->GetLength();
+      const auto blockEnd = theBlock.start + fileLen;
+      const size_t first = start > theBlock.start
+         ? ((start - theBlock.start).as_size_t() + 255) / 256
+         : 0;
+      const size_t last = end >= blockEnd
+         ? (fileLen + 255) / 256
+         : (end - theBlock.start).as_size_t() / 256;
+      if (first >= last)
+         continue;
+
+      Floats summary{ 3 * (last - first) };
+      // Reading the summary changes no more than the mutable log flag
+      if (!const_cast<BlockFile&>(*theFile).Read256(
+             summary.get(), first, last - first))
+         continue;
+
+      for (size_t i = 0; i < last - first; ++i) {
+         const auto groupStart = (first + i) * 256;
+         groups.push_back({
+            theBlock.start + groupStart,
+            std::min<size_t>(256, fileLen - groupStart),
+            std::max(-summary[3 * i], summary[3 * i + 1])
+         });
+      }
+   }
+}
+
 int Sequence::FindBlock(sampleCount pos) const
 {
    wxASSERT(pos >= 0 && pos < mNumSamples);
@@ -1086,6 +1348,19 @@ int Sequence::FindBlock(sampleCount pos) const
 
    int numBlocks = mBlock.size();
 
+   // Try the hint and its successor before searching
+   const auto hint = mBlockHint.load(std::memory_order_relaxed);
+   for (auto b = hint; b < std::min<size_t>(hint + 2, numBlocks); ++b) {
+      const SeqBlock &block = mBlock[b];
+      if (pos < block.start)
+         break;
+      if (pos < block.start + block.f->GetLength()) {
+         if (b != hint)
+            mBlockHint.store(b, std::memory_order_relaxed);
+         return b;
+      }
+   }
+
    size_t lo = 0, hi = numBlocks, guess;
    sampleCount loSamples = 0, hiSamples = mNumSamples;
 
@@ -1123,6 +1398,7 @@ int Sequence::FindBlock(sampleCount pos) const
             pos >= mBlock[rval].start &&
             pos < mBlock[rval].start + mBlock[rval].f->GetLength());
 
+   mBlockHint.store(rval, std::memory_order_relaxed);
    return rval;
 }
 
@@ -1151,6 +1427,7 @@ bool Sequence::Read(samplePtr buffer, sampleFormat format,
 bool Sequence::Get(samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
+   PROFILE_SCOPE("Sequence::Get");
    if (start == mNumSamples) {
       return len == 0;
    }
@@ -1170,6 +1447,18 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
    bool result = true;
+
+   // Packed blocks are gathered, so that the records of neighbors in the
+   // sequence, which are usually neighbors on disk too, are read at once
+   std::vector<PackedBlockFile::BatchRead> batch;
+   auto readBatch = [&]{
+      if (!batch.empty()) {
+         if (!PackedBlockFile::ReadBatch(batch, format, mayThrow))
+            result = false;
+         batch.clear();
+      }
+   };
+
    while (len) {
       const SeqBlock &block = mBlock[b];
       // start is in block
@@ -1177,14 +1466,21 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
       // bstart is not more than block length
       const auto blen = std::min(len, block.f->GetLength() - bstart);
 
-      if (! Read(buffer, format, block, bstart, blen, mayThrow) )
-         result = false;
+      if (const auto packed =
+             dynamic_cast<const PackedBlockFile*>(block.f.get()))
+         batch.push_back({ packed, bstart, blen, buffer });
+      else {
+         readBatch();
+         if (! Read(buffer, format, block, bstart, blen, mayThrow) )
+            result = false;
+      }
 
       len -= blen;
       buffer += (blen * SAMPLE_SIZE(format));
       b++;
       start += blen;
    }
+   readBatch();
    return result;
 }
 
@@ -1207,9 +1503,10 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
       temp.Allocate(tempSize, mSampleFormat);
    }
 
-   int b = FindBlock(start);
+   const int first = FindBlock(start);
+   int b = first;
+   // The blocks from first to b, changed or not
    BlockArray newBlock;
-   std::copy( mBlock.begin(), mBlock.begin() + b, std::back_inserter(newBlock) );
 
    while (len > 0
       // Redundant termination condition,
@@ -1257,28 +1554,37 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
       // we copy the old block entirely into memory, dereference it,
       // make the change, and then write the NEW block to disk.
 
+      // Blocks left unchanged keep sharing their files, so that an effect
+      // that alters only some of the selection writes only those blocks
       if ( bstart > 0 || blen < fileLength ) {
          // First or last block is only partially overwritten
          Read(scratch.ptr(), mSampleFormat, block, 0, fileLength, true);
 
+         auto sampleSize = SAMPLE_SIZE(mSampleFormat);
+         const auto dest = scratch.ptr() + bstart * sampleSize;
          if (useBuffer) {
-            auto sampleSize = SAMPLE_SIZE(mSampleFormat);
-            memcpy(scratch.ptr() +
-                   bstart * sampleSize, useBuffer, blen * sampleSize);
+            if (memcmp(dest, useBuffer, blen * sampleSize) != 0) {
+               memcpy(dest, useBuffer, blen * sampleSize);
+               block.f = mDirManager->NewSimpleBlockFile(
+                  scratch.ptr(), fileLength, mSampleFormat);
+            }
          }
-         else
+         else {
             ClearSamples(scratch.ptr(), mSampleFormat, bstart, blen);
-
-         block.f = mDirManager->NewSimpleBlockFile(
-            scratch.ptr(), fileLength, mSampleFormat);
+            block.f = mDirManager->NewSimpleBlockFile(
+               scratch.ptr(), fileLength, mSampleFormat);
+         }
       }
       else {
-         // Avoid reading the disk when the replacement is total
-         if (useBuffer)
-            block.f = mDirManager->NewSimpleBlockFile(
-               useBuffer, fileLength, mSampleFormat);
+         // Avoid reading the disk when the replacement is total, unless
+         // the summary suggests the samples may be the same
+         if (useBuffer) {
+            if (!SameAsBlock(block, useBuffer, scratch.ptr()))
+               block.f = mDirManager->NewSimpleBlockFile(
+                  useBuffer, fileLength, mSampleFormat);
+         }
          else
-            block.f = make_blockfile<SilentBlockFile>(fileLength);
+            block.f = SilentBlockFile::Get(fileLength);
       }
 
       // blen might be zero for inconsistent Sequence...
@@ -1292,9 +1598,27 @@ void Sequence::SetSamples(samplePtr buffer, sampleFormat format,
       b++;
    }
 
-   std::copy( mBlock.begin() + b, mBlock.end(), std::back_inserter(newBlock) );
+   SpliceBlocksIfConsistent( first, b, newBlock, 0, wxT("SetSamples") );
+}
+
+bool Sequence::SameAsBlock(const SeqBlock &b, samplePtr buffer,
+                           samplePtr scratch) const
+{
+   const auto len = b.f->GetLength();
+
+   // The summary holds floats, so check it only for float samples.  If the
+   // summary is not yet computed, the block only seems changed.
+   if (mSampleFormat == floatSample) {
+      const auto results = b.f->GetMinMaxRMS(false);
+      const auto fbuffer = reinterpret_cast<const float *>(buffer);
+      const auto range = std::minmax_element(fbuffer, fbuffer + len);
+      if (*range.first != results.min || *range.second != results.max)
+         return false;
+   }
 
-   CommitChangesIfConsistent( newBlock, mNumSamples, wxT("SetSamples") );
+   if (!Read(scratch, mSampleFormat, b, 0, len, false))
+      return false;
+   return memcmp(scratch, buffer, len * SAMPLE_SIZE(mSampleFormat)) == 0;
 }
 
 namespace {
@@ -1340,10 +1664,90 @@ struct MinMaxSumsq
 
 }
 
+SummaryPyramid::SummaryPyramid(const Sequence &sequence)
+   : mNumSamples{ sequence.GetNumSamples() }
+{
+   const auto &blocks = sequence.GetBlockArray();
+   std::vector< Node > leaves;
+   leaves.reserve(blocks.size());
+   for (const auto &seqBlock : blocks) {
+      const auto &f = seqBlock.f;
+      auto node = Empty();
+      if (f->IsSummaryAvailable()) {
+         // Block-level values are kept in memory, so this reads no file
+         const auto results = f->GetMinMaxRMS(false);
+         node.min = results.min;
+         node.max = results.max;
+         node.sumsq = (double)results.RMS * results.RMS * f->GetLength();
+      }
+      else
+         node.available = mComplete = false;
+      leaves.push_back(node);
+   }
+   mLevels.push_back(std::move(leaves));
+
+   while (mLevels.back().size() > 1) {
+      const auto &lower = mLevels.back();
+      std::vector< Node > upper((lower.size() + FanOut - 1) / FanOut, Empty());
+      for (size_t ii = 0; ii < lower.size(); ++ii)
+         upper[ii / FanOut].Combine(lower[ii]);
+      mLevels.push_back(std::move(upper));
+   }
+
+   size_t bytes = mLevels.capacity() * sizeof(mLevels[0]);
+   for (const auto &level : mLevels)
+      bytes += level.capacity() * sizeof(Node);
+   mMemory.Set(bytes);
+}
+
+bool SummaryPyramid::Matches(const Sequence &sequence) const
+{
+   return mNumSamples == sequence.GetNumSamples() &&
+      mLevels[0].size() == sequence.GetBlockArray().size();
+}
+
+void SummaryPyramid::Node::Combine(const Node &other)
+{
+   min = std::min(min, other.min);
+   max = std::max(max, other.max);
+   sumsq += other.sumsq;
+   available = available && other.available;
+}
+
+auto SummaryPyramid::Empty() -> Node
+{
+   return { FLT_MAX, -FLT_MAX, 0.0, true };
+}
+
+auto SummaryPyramid::Query(size_t b0, size_t b1) const -> Node
+{
+   auto result = Empty();
+   for (size_t level = 0; b0 < b1; ++level) {
+      const auto &nodes = mLevels[level];
+      if (level + 1 == mLevels.size()) {
+         while (b0 < b1)
+            result.Combine(nodes[b0++]);
+         break;
+      }
+
+      // Take the ragged ends at this level, and the rest from the next
+      while (b0 < b1 && b0 % FanOut)
+         result.Combine(nodes[b0++]);
+      while (b0 < b1 && b1 % FanOut)
+         result.Combine(nodes[--b1]);
+      b0 /= FanOut;
+      b1 /= FanOut;
+   }
+   return result;
+}
+
 bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
-                              size_t len, const sampleCount *where) const
+                              size_t len, const sampleCount *where,
+                              const SummaryPyramid *pPyramid) const
 {
    wxASSERT(len > 0);
+   if (pPyramid)
+      return GetWaveDisplayFromPyramid(min, max, rms, bl, len, where, *pPyramid);
    const auto s0 = std::max(sampleCount(0), where[0]);
    if (s0 >= mNumSamples)
       // None of the samples asked for are in range. Abandon.
@@ -1354,7 +1758,7 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
    // ... unless the mNumSamples ceiling applies, and then there are other defenses
    const auto s1 =
       std::min(mNumSamples, std::max(1 + where[len - 1], where[len]));
-   Floats temp{ mMaxSamples };
+   PooledArrayOf<float> temp{ mMaxSamples };
 
    decltype(len) pixel = 0;
 
@@ -1364,6 +1768,8 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
    int lastDivisor = 0;
    auto whereNow = std::min(s1 - 1, where[0]);
    decltype(whereNow) whereNext = 0;
+   // Blocks that would have been read at the 4096 level if it were made
+   BlockPrefetchQueue::BlockFiles unreduced;
    // Loop over block files, opening and reading and closing each
    // not more than once
    unsigned nBlocks = mBlock.size();
@@ -1412,8 +1818,13 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
       // Decide the summary level
       const double samplesPerPixel =
          (whereNext - whereNow).as_double() / (nextPixel - pixel);
+      const bool reduced = seqBlock.f->IsSummary4KAvailable();
+      if (samplesPerPixel >= 4096 && samplesPerPixel < 65536 && !reduced &&
+          seqBlock.f->IsSummaryAvailable())
+         unreduced.push_back(seqBlock.f);
       const int divisor =
            (samplesPerPixel >= 65536) ? 65536
+         : (samplesPerPixel >= 4096 && reduced) ? 4096
          : (samplesPerPixel >= 256) ? 256
          : 1;
 
@@ -1460,6 +1871,10 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
             //otherwise, mark the display as not yet computed
             blockStatus = -1 - b;
          break;
+      case 4096:
+         // Read triples, made only from an available summary
+         seqBlock.f->Read4K(temp.get(), startPosition, num);
+         break;
       case 65536:
          // Read triples
          //check to see if summary data has been computed
@@ -1544,6 +1959,106 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
 
    wxASSERT(pixel == len);
 
+   // Later fillings of the display read the 4096 level instead
+   if (!unreduced.empty())
+      BlockPrefetchQueue::Get().PushReductions(std::move(unreduced));
+
+   return true;
+}
+
+bool Sequence::GetWaveDisplayFromPyramid(
+   float *min, float *max, float *rms, int* bl,
+   size_t len, const sampleCount *where, const SummaryPyramid &pyramid) const
+{
+   // Unlike the general case above, this visits only the blocks at the
+   // boundaries of columns, so the cost is proportional to the width
+   // and not to the length of the sequence
+   wxASSERT(pyramid.Matches(*this));
+
+   const auto s0 = std::max(sampleCount(0), where[0]);
+   if (s0 >= mNumSamples)
+      // None of the samples asked for are in range. Abandon.
+      return false;
+
+   // As above, let the last column get at least one sample
+   const auto s1 =
+      std::min(mNumSamples, std::max(1 + where[len - 1], where[len]));
+
+   // The 256-sample summary of the block last partly used, which is
+   // usually shared by two adjacent columns
+   Floats summary{ 3 * ((mMaxSamples + 255) / 256) };
+   int summaryBlock = -1;
+
+   for (size_t pixel = 0; pixel < len; ++pixel) {
+      const auto from = std::min(s1 - 1, std::max(s0, where[pixel]));
+      auto to = (pixel + 1 == len)
+         ? s1
+         : std::min(s1, where[pixel + 1]);
+      if (to <= from)
+         to = from + 1;
+
+      auto node = SummaryPyramid::Empty();
+      auto addPartial = [&](unsigned b, sampleCount partFrom, sampleCount partTo) {
+         const SeqBlock &seqBlock = mBlock[b];
+         if (!seqBlock.f->IsSummaryAvailable()) {
+            node.available = false;
+            return;
+         }
+         if ((int)b != summaryBlock) {
+            // Ignore the return value.
+            // This function fills with zeroes if read fails
+            seqBlock.f->Read256(summary.get(), 0,
+               (seqBlock.f->GetLength() + 255) / 256);
+            summaryBlock = b;
+         }
+         const auto firstFrame =
+            ((partFrom - seqBlock.start) / 256).as_size_t();
+         const auto lastFrame =
+            ((partTo - 1 - seqBlock.start) / 256).as_size_t();
+         for (auto ii = firstFrame; ii <= lastFrame; ++ii) {
+            const float *const triple = &summary[3 * ii];
+            node.min = std::min(node.min, triple[0]);
+            node.max = std::max(node.max, triple[1]);
+            node.sumsq += (double)triple[2] * triple[2] * 256;
+         }
+      };
+
+      const unsigned b0 = FindBlock(from);
+      const unsigned b1 = FindBlock(to - 1);
+      const auto &first = mBlock[b0];
+      const auto &last = mBlock[b1];
+      const auto firstEnd = first.start + first.f->GetLength();
+      const auto lastEnd = last.start + last.f->GetLength();
+
+      // The range of blocks entirely in the column
+      const auto wholeBegin = (first.start >= from) ? b0 : b0 + 1;
+      const auto wholeEnd = (lastEnd <= to) ? b1 + 1 : b1;
+      if (wholeBegin < wholeEnd)
+         node.Combine(pyramid.Query(wholeBegin, wholeEnd));
+
+      // Blocks at the ends of the column, partly in it
+      if (b0 == b1) {
+         if (wholeBegin >= wholeEnd)
+            addPartial(b0, from, to);
+      }
+      else {
+         if (b0 < wholeBegin)
+            addPartial(b0, from, firstEnd);
+         if (wholeEnd <= b1)
+            addPartial(b1, last.start, to);
+      }
+
+      if (node.min > node.max)
+         // Nothing was available
+         min[pixel] = max[pixel] = rms[pixel] = 0;
+      else {
+         min[pixel] = node.min;
+         max[pixel] = node.max;
+         rms[pixel] = sqrt(node.sumsq / (to - from).as_double());
+      }
+      bl[pixel] = node.available ? (int)b0 : -1 - (int)b0;
+   }
+
    return true;
 }
 
@@ -1757,25 +2272,25 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       return;
    }
 
-   // Create a NEW array of blocks
+   // Create a NEW array of the blocks to replace those from first,
+   // which is b0 unless the previous block is merged too, to b1
    BlockArray newBlock;
-   newBlock.reserve(numBlocks - (b1 - b0) + 2);
-
-   // Copy the blocks before the deletion point over to
-   // the NEW array
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b0);
-   unsigned int i;
+   newBlock.reserve(4);
+   auto first = b0;
 
    // First grab the samples in block b0 before the deletion point
    // into preBuffer.  If this is enough samples for its own block,
-   // or if this would be the first block in the array, write it out.
-   // Otherwise combine it with the previous block (splitting them
-   // 50/50 if necessary).
+   // or if this would be the first or the last block in the array, write
+   // it out.  (A short block at either end harms nothing, and so splitting
+   // a clip, which deletes to the end of one copy and from the start of the
+   // other, writes only the split block.)  Otherwise combine it with the
+   // previous block (splitting them 50/50 if necessary).
    const SeqBlock &preBlock = mBlock[b0];
    // start is within preBlock
    auto preBufferLen = ( start - preBlock.start ).as_size_t();
    if (preBufferLen) {
-      if (preBufferLen >= mMinSamples || b0 == 0) {
+      if (preBufferLen >= mMinSamples || b0 == 0 ||
+          start + len == mNumSamples) {
          if (!scratch.ptr())
             scratch.Allocate(scratchSize, mSampleFormat);
          ensureSampleBufferSize(scratch, mSampleFormat, scratchSize, preBufferLen);
@@ -1798,7 +2313,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          Read(scratch.ptr() + prepreLen*sampleSize, mSampleFormat,
               preBlock, 0, preBufferLen, true);
 
-         newBlock.pop_back();
+         first = b0 - 1;
          Blockify(*mDirManager, mMaxSamples, mSampleFormat,
                   newBlock, prepreBlock.start, scratch.ptr(), sum);
       }
@@ -1810,8 +2325,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
 
    // Now, symmetrically, grab the samples in block b1 after the
    // deletion point into postBuffer.  If this is enough samples
-   // for its own block, or if this would be the last block in
-   // the array, write it out.  Otherwise combine it with the
+   // for its own block, or if this would be the first or the last block
+   // in the array, write it out.  Otherwise combine it with the
    // subsequent block (splitting them 50/50 if necessary).
    const SeqBlock &postBlock = mBlock[b1];
    // start + len - 1 lies within postBlock
@@ -1819,7 +2334,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
        (postBlock.start + postBlock.f->GetLength()) - (start + len)
    ).as_size_t();
    if (postBufferLen) {
-      if (postBufferLen >= mMinSamples || b1 == numBlocks - 1) {
+      if (postBufferLen >= mMinSamples || b1 == numBlocks - 1 ||
+          start == 0) {
          if (!scratch.ptr())
             // Last use of scratch, can ask for smaller
             scratch.Allocate(postBufferLen, mSampleFormat);
@@ -1854,12 +2370,8 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       // right on the end of a block.
    }
 
-   // Copy the remaining blocks over from the old array
-   for (i = b1 + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(-len));
-
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples - len, wxT("Delete - branch two"));
+   SpliceBlocksIfConsistent
+      (first, b1 + 1, newBlock, -len, wxT("Delete - branch two"));
 }
 
 void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
@@ -1974,6 +2486,55 @@ void Sequence::AppendBlocksIfConsistent
    consistent = true;
 }
 
+void Sequence::SpliceBlocksIfConsistent
+   (size_t first, size_t last, BlockArray &replacement,
+    sampleCount delta, const wxChar *whereStr)
+{
+   // The blocks after last only move, so they stay consistent if the
+   // replacement covers the same samples, less or more by delta
+   const auto numBlocks = mBlock.size();
+   const auto start = first < numBlocks ? mBlock[first].start : mNumSamples;
+   const auto end = last < numBlocks ? mBlock[last].start : mNumSamples;
+   auto pos = start;
+   bool consistent = true;
+   for (const auto &block : replacement) {
+      if (!block.f || block.start != pos ||
+          block.f->GetLength() > mMaxSamples) {
+         consistent = false;
+         break;
+      }
+      pos += block.f->GetLength();
+   }
+   if (!consistent || pos != end + delta) {
+      wxLogError(wxT("*** Consistency check failed after %s. ***"), whereStr);
+      THROW_INCONSISTENCY_EXCEPTION;
+   }
+
+   // Only this may throw, before anything changes
+   const auto removed = last - first;
+   const auto added = replacement.size();
+   if (added > removed)
+      mBlock.reserve(numBlocks - removed + added);
+
+   // now commit
+   // use NOFAIL-GUARANTEE
+
+   const auto at = mBlock.begin() + first;
+   const auto common = std::min(removed, added);
+   std::move(replacement.begin(), replacement.begin() + common, at);
+   if (added > removed)
+      mBlock.insert(at + common,
+         std::make_move_iterator(replacement.begin() + common),
+         std::make_move_iterator(replacement.end()));
+   else
+      mBlock.erase(at + common, at + removed);
+
+   if (delta != 0)
+      for (auto ii = first + added, nn = mBlock.size(); ii < nn; ++ii)
+         mBlock[ii].start += delta;
+   mNumSamples += delta;
+}
+
 void Sequence::DebugPrintf
    (const BlockArray &mBlock, sampleCount mNumSamples, wxString *dest)
 {
@@ -2018,6 +2579,20 @@ size_t Sequence::GetMaxDiskBlockSize()
    return sMaxDiskBlockSize;
 }
 
+void Sequence::AppendNewBlockFile(const BlockFilePtr &blockFile)
+// STRONG-GUARANTEE
+{
+   const auto len = blockFile->GetLength();
+   wxASSERT(len <= mMaxSamples);
+
+   // Quick check to make sure that it doesn't overflow
+   if (Overflows((mNumSamples.as_double()) + ((double)len)))
+      THROW_INCONSISTENCY_EXCEPTION;
+
+   mBlock.push_back(SeqBlock(blockFile, mNumSamples));
+   mNumSamples += len;
+}
+
 void Sequence::AppendBlockFile(const BlockFilePtr &blockFile)
 {
    // We assume blockFile has the correct ref count already
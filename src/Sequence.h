@@ -12,6 +12,8 @@
 #define __AUDACITY_SEQUENCE__
 
 #include "MemoryX.h"
+#include "MemoryUse.h"
+#include <atomic>
 #include <vector>
 #include <wx/string.h>
 
@@ -48,9 +50,47 @@ class SeqBlock {
       return SeqBlock(f, start + delta);
    }
 };
-class BlockArray : public std::vector<SeqBlock> {};
+class BlockArray : public std::vector<SeqBlock,
+   MemoryUse::Allocator<SeqBlock, MemoryUse::BlockArrays>> {};
 using BlockPtrArray = std::vector<SeqBlock*>; // non-owning pointers
 
+class Sequence;
+
+/// Block-level min, max and RMS of a Sequence, reduced in levels of 16
+/// blocks, 256 blocks, and so on, so that any range of whole blocks can be
+/// summarized in logarithmic time.  It does not follow changes of the
+/// Sequence and must be rebuilt.
+class SummaryPyramid {
+ public:
+   explicit SummaryPyramid(const Sequence &sequence);
+
+   // Cheap test that the sequence did not obviously change
+   bool Matches(const Sequence &sequence) const;
+   // False if some block summaries were not yet computed (on demand)
+   bool IsComplete() const { return mComplete; }
+
+   struct Node {
+      float min, max;
+      double sumsq; // of all samples
+      bool available;
+
+      void Combine(const Node &other);
+   };
+   static Node Empty();
+
+   // Reduce over blocks [b0, b1)
+   Node Query(size_t b0, size_t b1) const;
+
+ private:
+   enum : size_t { FanOut = 16 };
+
+   // Level 0 has one node per block, and the last level one node
+   std::vector< std::vector< Node > > mLevels;
+   sampleCount mNumSamples;
+   bool mComplete { true };
+   MemoryUse::Tracker mMemory{ MemoryUse::SummaryPyramids };
+};
+
 class PROFILE_DLL_API Sequence final : public XMLTagHandler{
  public:
 
@@ -98,9 +138,12 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    // The column for pixel p covers samples from
    // where[p] up to (but excluding) where[p + 1].
    // bl is negative wherever data are not yet available.
+   // pPyramid, if not null, must have been built from this sequence as it
+   // now is, and is used when columns span whole blocks.
    // Return true if successful.
    bool GetWaveDisplay(float *min, float *max, float *rms, int* bl,
-                       size_t len, const sampleCount *where) const;
+                       size_t len, const sampleCount *where,
+                       const SummaryPyramid *pPyramid = nullptr) const;
 
    // Return non-null, or else throw!
    std::unique_ptr<Sequence> Copy(sampleCount s0, sampleCount s1) const;
@@ -113,6 +156,11 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    void AppendAlias(const wxString &fullPath,
                     sampleCount start,
                     size_t len, int channel, bool useOD);
+   // The samples were just read from the aliased file, to summarize
+   void AppendAlias(const wxString &fullPath,
+                    sampleCount start,
+                    size_t len, int channel,
+                    samplePtr buffer, sampleFormat format);
 
    void AppendCoded(const wxString &fName, sampleCount start,
                             size_t len, int channel, int decodeType);
@@ -127,10 +175,31 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    // when the blockfile is created using DirManager::NewSimpleBlockFile or
    // loaded from an XML file via DirManager::HandleXMLTag
    void AppendBlockFile(const BlockFilePtr &blockFile);
+   // The same, for a block file just made in the format of the sequence,
+   // with checks
+   void AppendNewBlockFile(const BlockFilePtr &blockFile);
 
    void SetSilence(sampleCount s0, sampleCount len);
    void InsertSilence(sampleCount s0, sampleCount len);
 
+   // Reverses all the samples, writing each block once, in its mirrored
+   // place.  Silent blocks are kept as they are.
+   void Reverse();
+
+   // A first block index and a count of blocks
+   using BlockRun = std::pair<size_t, size_t>;
+   // Runs of at least two adjacent blocks, each shorter than the minimum
+   // block size, with no more samples together than the maximum.  Alias
+   // blocks and blocks not yet decoded are left out.
+   std::vector<BlockRun> FindSmallBlockRuns() const;
+   // Replaces the blocks of a run with one block of the given samples, in
+   // the sample format of the sequence, which must be the same as theirs
+   void MergeBlocks(const BlockRun &run, samplePtr buffer);
+
+   // Copies into our project the records that blocks borrow from the stores
+   // of other projects.  Returns whether there were any.
+   bool AdoptBorrowedBlocks();
+
    const std::shared_ptr<DirManager> &GetDirManager() { return mDirManager; }
 
    //
@@ -173,6 +242,23 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    std::pair<float, float> GetMinMax(
       sampleCount start, sampleCount len, bool mayThrow) const;
    float GetRMS(sampleCount start, sampleCount len, bool mayThrow) const;
+   double GetSum(sampleCount start, sampleCount len, bool mayThrow) const;
+
+   // Appends the block files holding any of the samples, to be read ahead
+   void CollectBlockFiles(sampleCount start, sampleCount len,
+      std::vector< std::weak_ptr<BlockFile> > &files) const;
+
+   // The greatest magnitude of a group of samples, from the summary
+   struct PeakGroup {
+      sampleCount start;
+      size_t len;
+      float peak;
+   };
+   // Appends, in order, the groups of the 256-sample summaries lying wholly
+   // in the region.  Blocks whose summaries are not yet computed or can't
+   // be read are left out.  Reads no samples.
+   void GetPeakGroups(sampleCount start, sampleCount len,
+      std::vector<PeakGroup> &groups) const;
 
    //
    // Getting block size and alignment information
@@ -192,6 +278,11 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    //
 
    BlockArray &GetBlockArray() {return mBlock;}
+   const BlockArray &GetBlockArray() const {return mBlock;}
+
+   // Whether the other has the same format and the very same block files
+   // at the same positions; cheaper than comparing samples or copying
+   bool SharesBlocks(const Sequence &other) const;
 
    ///
    void LockDeleteUpdateMutex(){mDeleteUpdateMutex.Lock();}
@@ -240,6 +331,11 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    ///To block the Delete() method against the ODCalcSummaryTask::Update() method
    ODLock   mDeleteUpdateMutex;
 
+   // The block FindBlock() found last.  Play and draw go forward, so the next
+   // search usually ends there or in the block after.  Only a hint, checked
+   // before use, so threads may race for it.
+   mutable std::atomic<size_t> mBlockHint{ 0 };
+
    //
    // Private methods
    //
@@ -254,6 +350,11 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
              const SeqBlock &b,
              size_t blockRelativeStart, size_t len, bool mayThrow);
 
+   // Whether buffer holds just the samples of the whole block, in this
+   // sequence's format.  May read the block into scratch, but first compares
+   // the summary in memory, so that a changed block is seldom read.
+   bool SameAsBlock(const SeqBlock &b, samplePtr buffer, samplePtr scratch) const;
+
    // Accumulate NEW block files onto the end of a block array.
    // Does not change this sequence.  The intent is to use
    // CommitChangesIfConsistent later.
@@ -264,6 +365,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    bool Get(int b, samplePtr buffer, sampleFormat format,
       sampleCount start, size_t len, bool mayThrow) const;
 
+   bool GetWaveDisplayFromPyramid(float *min, float *max, float *rms, int* bl,
+                       size_t len, const sampleCount *where,
+                       const SummaryPyramid &pyramid) const;
+
 public:
 
    //
@@ -296,6 +401,14 @@ private:
       (BlockArray &additionalBlocks, bool replaceLast,
        sampleCount numSamples, const wxChar *whereStr);
 
+   // Replaces the blocks from first up to last with replacement, and moves
+   // the later blocks by delta samples.  Only the replacement is checked,
+   // and the array is changed in place, so that an edit in a long sequence
+   // does not copy and check every block.
+   void SpliceBlocksIfConsistent
+      (size_t first, size_t last, BlockArray &replacement,
+       sampleCount delta, const wxChar *whereStr);
+
 };
 
 #endif // __AUDACITY_SEQUENCE__
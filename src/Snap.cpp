@@ -54,12 +54,14 @@ SnapManager::SnapManager(const TrackList *tracks,
    wxASSERT(mProject);
 
    mSnapTo = 0;
+   mSnapToTime = false;
    mRate = 0.0;
    mFormat = {};
 
    // Two time points closer than this are considered the same
    mEpsilon = 1 / 44100.0;
 
+   BuildSnapPoints();
    Reinit();
 }
 
@@ -84,8 +86,6 @@ void SnapManager::Reinit()
    mRate = rate;
    mFormat = format;
 
-   mSnapPoints.clear();
-
    // Grab time-snapping prefs (unless otherwise requested)
    mSnapToTime = false;
 
@@ -96,10 +96,29 @@ void SnapManager::Reinit()
       mConverter.SetSampleRate(mRate);
       mConverter.SetFormatName(mFormat);
    }
+}
+
+// Gathers all the points once.  Whether each is on the time grid, which
+// costs a formatting of the time, is decided only for the few near the
+// times snapped, so that a handle may make a SnapManager cheaply even when
+// there are many labels or clips.
+void SnapManager::BuildSnapPoints()
+{
+   mSnapPoints.clear();
 
    // Add a SnapPoint at t=0
    mSnapPoints.push_back(SnapPoint{});
 
+   // The excluded clips, sorted, for binary search
+   using ClipKey = std::pair<const Track *, const WaveClip *>;
+   std::vector<ClipKey> clipExclusions;
+   if (mClipExclusions)
+   {
+      for (const auto &trackClip : *mClipExclusions)
+         clipExclusions.push_back(ClipKey{ trackClip.track, trackClip.clip });
+      std::sort(clipExclusions.begin(), clipExclusions.end());
+   }
+
    TrackListConstIterator iter(mTracks);
    for (const Track *track = iter.First();  track; track = iter.Next())
    {
@@ -118,10 +137,10 @@ void SnapManager::Reinit()
             const LabelStruct *label = labelTrack->GetLabel(i);
             const double t0 = label->getT0();
             const double t1 = label->getT1();
-            CondListAdd(t0, labelTrack);
+            mSnapPoints.push_back(SnapPoint{ t0, labelTrack });
             if (t1 != t0)
             {
-               CondListAdd(t1, labelTrack);
+               mSnapPoints.push_back(SnapPoint{ t1, labelTrack });
             }
          }
       }
@@ -130,34 +149,21 @@ void SnapManager::Reinit()
          auto waveTrack = static_cast<const WaveTrack *>(track);
          for (const auto &clip: waveTrack->GetClips())
          {
-            if (mClipExclusions)
+            if (std::binary_search(clipExclusions.begin(),
+                  clipExclusions.end(), ClipKey{ waveTrack, clip.get() }))
             {
-               bool skip = false;
-               for (size_t j = 0, cnt = mClipExclusions->size(); j < cnt; ++j)
-               {
-                  if ((*mClipExclusions)[j].track == waveTrack &&
-                      (*mClipExclusions)[j].clip == clip.get())
-                  {
-                     skip = true;
-                     break;
-                  }
-               }
-
-               if (skip)
-               {
-                  continue;
-               }
+               continue;
             }
 
-            CondListAdd(clip->GetStartTime(), waveTrack);
-            CondListAdd(clip->GetEndTime(), waveTrack);
+            mSnapPoints.push_back(SnapPoint{ clip->GetStartTime(), waveTrack });
+            mSnapPoints.push_back(SnapPoint{ clip->GetEndTime(), waveTrack });
          }
       }
 #ifdef USE_MIDI
       else if (track->GetKind() == Track::Note)
       {
-         CondListAdd(track->GetStartTime(), track);
-         CondListAdd(track->GetEndTime(), track);
+         mSnapPoints.push_back(SnapPoint{ track->GetStartTime(), track });
+         mSnapPoints.push_back(SnapPoint{ track->GetEndTime(), track });
       }
 #endif
    }
@@ -166,18 +172,17 @@ void SnapManager::Reinit()
    std::sort(mSnapPoints.begin(), mSnapPoints.end());
 }
 
-// Adds to mSnapPoints, filtering by TimeConverter
-void SnapManager::CondListAdd(double t, const Track *track)
+// Whether the point survives filtering by TimeConverter.  The point at
+// t=0 always does.
+bool SnapManager::OnGrid(const SnapPoint &point)
 {
-   if (mSnapToTime)
+   if (!mSnapToTime || !point.track)
    {
-      mConverter.SetValue(t);
+      return true;
    }
 
-   if (!mSnapToTime || mConverter.GetValue() == t)
-   {
-      mSnapPoints.push_back(SnapPoint{ t, track });
-   }
+   mConverter.SetValue(point.t);
+   return mConverter.GetValue() == point.t;
 }
 
 // Return the time of the SnapPoint at a given index
@@ -186,56 +191,6 @@ double SnapManager::Get(size_t index)
    return mSnapPoints[index].t;
 }
 
-// Returns the difference in time between t and the point at a given index
-wxInt64 SnapManager::PixelDiff(double t, size_t index)
-{
-   return std::abs(mZoomInfo->TimeToPosition(t, 0) -
-                   mZoomInfo->TimeToPosition(Get(index), 0));
-}
-
-// Find the index where this SnapPoint should go in
-// sorted order, between i0 (inclusive) and i1 (exclusive).
-size_t SnapManager::Find(double t, size_t i0, size_t i1)
-{
-   if (i1 <= i0 + 1)
-   {
-      return i0;
-   }
-
-   size_t half = (i0 + i1) / 2;
-
-   if (t < Get(half))
-   {
-      return Find(t, i0, half);
-   }
-
-   return Find(t, half, i1);
-}
-
-// Find the SnapPoint nearest to time t
-size_t SnapManager::Find(double t)
-{
-   size_t cnt = mSnapPoints.size();
-   size_t index = Find(t, 0, cnt);
-
-   // At this point, either index is the closest, or the next one
-   // to the right is.  Keep moving to the right until we get a
-   // different value
-   size_t next = index + 1;
-   while (next + 1 < cnt && Get(next) == Get(index))
-   {
-      next++;
-   }
-
-   // Now return whichever one is closer to time t
-   if (next < cnt && PixelDiff(t, next) < PixelDiff(t, index))
-   {
-      return next;
-   }
-
-   return index;
-}
-
 // Helper: performs snap-to-points for Snap(). Returns true if a snap happened.
 bool SnapManager::SnapToPoints(Track *currentTrack,
                                double t,
@@ -244,47 +199,47 @@ bool SnapManager::SnapToPoints(Track *currentTrack,
 {
    *outT = t;
 
-   size_t cnt = mSnapPoints.size();
-   if (cnt == 0)
+   // Positions increase with time, so the points within the allowed range
+   // of pixels are together, and found by binary search
+   const auto position = mZoomInfo->TimeToPosition(t, 0);
+   auto first = std::partition_point(mSnapPoints.begin(), mSnapPoints.end(),
+      [&](const SnapPoint &point){
+         return position - mZoomInfo->TimeToPosition(point.t, 0) >=
+            mPixelTolerance; });
+   auto last = std::partition_point(first, mSnapPoints.end(),
+      [&](const SnapPoint &point){
+         return mZoomInfo->TimeToPosition(point.t, 0) - position <
+            mPixelTolerance; });
+
+   // Of those, the ones on the time grid
+   std::vector<size_t> candidates;
+   for (auto it = first; it != last; ++it)
    {
-      return false;
+      if (OnGrid(*it))
+      {
+         candidates.push_back(it - mSnapPoints.begin());
+      }
    }
 
-   // Find the nearest SnapPoint
-   size_t index = Find(t);
-
-   // If it's too far away, just give up now
-   if (PixelDiff(t, index) >= mPixelTolerance)
+   // If all are too far away, just give up now
+   if (candidates.empty())
    {
       return false;
    }
 
-   // Otherwise, search left and right for all of the points
-   // within the allowed range.
-   size_t left = index;
-   size_t right = index;
-   size_t i;
-
-   while (left > 0 && PixelDiff(t, left - 1) < mPixelTolerance)
-   {
-      left--;
-   }
-
-   while (right < cnt - 1 && PixelDiff(t, right + 1) < mPixelTolerance)
-   {
-      right++;
-   }
-
-   if (left == index && right == index)
+   if (candidates.size() == 1)
    {
       // Awesome, there's only one point that matches!
-      *outT = Get(index);
+      *outT = Get(candidates[0]);
       return true;
    }
 
+   const size_t left = candidates.front();
+   const size_t right = candidates.back();
+
    size_t indexInThisTrack = 0;
    size_t countInThisTrack = 0;
-   for (i = left; i <= right; ++i)
+   for (auto i : candidates)
    {
       if (mSnapPoints[i].track == currentTrack)
       {
@@ -345,7 +300,7 @@ SnapResults SnapManager::Snap
    {
       if (results.snappedPoint)
       {
-         // Since mSnapPoints only contains points on the grid, we're done
+         // Since only points on the grid are snapped to, we're done
          results.snappedTime = true;
       }
       else
@@ -111,11 +111,9 @@ public:
 private:
 
    void Reinit();
-   void CondListAdd(double t, const Track *track);
+   void BuildSnapPoints();
+   bool OnGrid(const SnapPoint &point);
    double Get(size_t index);
-   wxInt64 PixelDiff(double t, size_t index);
-   size_t Find(double t, size_t i0, size_t i1);
-   size_t Find(double t);
    bool SnapToPoints(Track *currentTrack, double t, bool rightEdge, double *outT);
 
 private:
@@ -129,6 +127,7 @@ private:
    bool mNoTimeSnap;
    
    double mEpsilon;
+   // All the points, sorted by time, whether or not on the time grid
    SnapPointArray mSnapPoints;
 
    // Info for snap-to-time
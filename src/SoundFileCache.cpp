@@ -0,0 +1,165 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SoundFileCache.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "SoundFileCache.h"
+
+#include <wx/filefn.h>
+#include <cstring>
+#include <iterator>
+
+namespace {
+   using Clock = std::chrono::steady_clock;
+
+   // How long a handle is used before the file's modification time is
+   // looked at again.  That costs a round trip to a network share, but
+   // far less than opening the file.
+   const auto RecheckInterval = std::chrono::seconds( 2 );
+}
+
+SoundFileCache::Lease &SoundFileCache::Lease::operator= ( Lease &&that )
+{
+   if (this != &that) {
+      if (mCache && mHandle)
+         mCache->Release( std::move( mHandle ) );
+      mCache = that.mCache;
+      mHandle = std::move( that.mHandle );
+   }
+   return *this;
+}
+
+SoundFileCache::Lease::~Lease()
+{
+   if (mCache && mHandle)
+      mCache->Release( std::move( mHandle ) );
+}
+
+SoundFileCache::SoundFileCache( size_t capacity )
+   : mCapacity{ capacity }
+{
+}
+
+void SoundFileCache::SetCapacity( size_t capacity )
+{
+   List evicted;
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mCapacity = capacity;
+      while (mIdle.size() > mCapacity) {
+         evicted.splice( evicted.end(), mIdle, std::prev( mIdle.end() ) );
+         ++mEvictions;
+      }
+   }
+   // The files close here, outside of the lock
+}
+
+auto SoundFileCache::Acquire( const wxString &path ) -> Lease
+{
+   std::unique_ptr< Handle > handle;
+   unsigned long long generation;
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      generation = mGeneration;
+      for (auto iter = mIdle.begin(), end = mIdle.end(); iter != end; ++iter)
+         if ((*iter)->path == path) {
+            handle = std::move( *iter );
+            mIdle.erase( iter );
+            break;
+         }
+      if (handle)
+         ++mHits;
+      else
+         ++mMisses;
+   }
+
+   if (handle) {
+      const auto now = Clock::now();
+      if (now - handle->checked < RecheckInterval)
+         return { this, std::move( handle ) };
+      if (wxFileModificationTime( path ) == handle->modified) {
+         handle->checked = now;
+         return { this, std::move( handle ) };
+      }
+      // The file changed; forget what was read of its header
+      handle.reset();
+      std::lock_guard< std::mutex > lock{ mMutex };
+      ++mReopens;
+   }
+
+   if (!wxFile::Exists( path ))
+      return {};
+
+   handle = std::make_unique< Handle >();
+   memset( &handle->info, 0, sizeof( handle->info ) );
+   if (!handle->file.Open( path ))
+      return {};
+   // Even though there is an sf_open() that takes a filename, use the one that
+   // takes a file descriptor since wxWidgets can open a file with a Unicode name and
+   // libsndfile can't (under Windows).
+   handle->sf.reset( SFCall<SNDFILE*>(
+      sf_open_fd, handle->file.fd(), SFM_READ, &handle->info, FALSE ) );
+   if (!handle->sf)
+      return {};
+
+   handle->path = path;
+   handle->modified = wxFileModificationTime( path );
+   handle->checked = Clock::now();
+   handle->generation = generation;
+   return { this, std::move( handle ) };
+}
+
+void SoundFileCache::Release( std::unique_ptr< Handle > handle )
+{
+   List evicted;
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      if (handle->generation != mGeneration || mCapacity == 0)
+         // Invalidated while leased, or no pooling wanted; close it
+         return;
+
+      mIdle.push_front( std::move( handle ) );
+      while (mIdle.size() > mCapacity) {
+         evicted.splice( evicted.end(), mIdle, std::prev( mIdle.end() ) );
+         ++mEvictions;
+      }
+   }
+}
+
+void SoundFileCache::Invalidate( const wxString &path )
+{
+   List invalid;
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      ++mGeneration;
+      for (auto iter = mIdle.begin(); iter != mIdle.end();) {
+         auto next = std::next( iter );
+         if ((*iter)->path == path)
+            invalid.splice( invalid.end(), mIdle, iter );
+         iter = next;
+      }
+   }
+}
+
+void SoundFileCache::Clear()
+{
+   List invalid;
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      ++mGeneration;
+      invalid.swap( mIdle );
+   }
+}
+
+auto SoundFileCache::GetStatistics() -> Statistics
+{
+   std::lock_guard< std::mutex > lock{ mMutex };
+   return { mHits, mMisses, mReopens, mEvictions, mIdle.size(), mCapacity };
+}
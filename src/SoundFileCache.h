@@ -0,0 +1,124 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SoundFileCache.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class SoundFileCache
+\brief A bounded, least-recently-used pool of sound files opened with
+libsndfile, keyed by path, that may be used from any thread.
+
+  Aliased files are read one block at a time, and opening one, which
+  parses its header, can cost more than the read, especially from a
+  network share.  The pool keeps files open between reads.
+
+  A handle is leased to one reader at a time, who seeks and reads it
+  alone; a second reader of the same file is given another handle.  Idle
+  handles beyond the capacity are closed, oldest first.  A handle whose
+  file was modified since it was opened is reopened, so that a replaced
+  file is not read from its old contents.  Before a file is renamed or
+  removed, it must be invalidated, because some systems (Windows) forbid
+  those operations on open files.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SOUND_FILE_CACHE__
+#define __AUDACITY_SOUND_FILE_CACHE__
+
+#include "FileFormats.h"
+#include "MemoryX.h"
+#include <wx/file.h>
+#include <wx/string.h>
+
+#include <chrono>
+#include <list>
+#include <mutex>
+
+class SoundFileCache
+{
+public:
+   struct Handle
+   {
+      // Declared before sf, so that it is closed after
+      wxFile file;
+      SFFile sf;
+      SF_INFO info;
+      wxString path;
+      time_t modified;
+      std::chrono::steady_clock::time_point checked;
+      unsigned long long generation;
+   };
+
+   // Exclusive use of a handle until destroyed, when the handle returns
+   // to the pool
+   class Lease
+   {
+   public:
+      Lease() = default;
+      Lease( Lease &&that )
+         : mCache{ that.mCache }, mHandle{ std::move( that.mHandle ) }
+      {}
+      Lease &operator= ( Lease &&that );
+      ~Lease();
+
+      explicit operator bool () const { return mHandle != nullptr; }
+      Handle *operator-> () const { return mHandle.get(); }
+
+      // Close the handle instead of returning it, as after a failed read
+      void Discard() { mHandle.reset(); }
+
+   private:
+      friend SoundFileCache;
+      Lease( SoundFileCache *cache, std::unique_ptr< Handle > &&handle )
+         : mCache{ cache }, mHandle{ std::move( handle ) }
+      {}
+
+      SoundFileCache *mCache { nullptr };
+      std::unique_ptr< Handle > mHandle;
+   };
+
+   explicit SoundFileCache( size_t capacity );
+
+   size_t GetCapacity() const { return mCapacity; }
+   // Closes idle handles as needed to fit the NEW capacity
+   void SetCapacity( size_t capacity );
+
+   // Returns an open handle, opening the file if necessary, or an empty
+   // lease if it can't be opened
+   Lease Acquire( const wxString &path );
+
+   void Invalidate( const wxString &path );
+   void Clear();
+
+   // Counts since the cache was made, for diagnostics
+   struct Statistics {
+      unsigned long long hits, misses, reopens, evictions;
+      size_t idle, capacity;
+   };
+   Statistics GetStatistics();
+
+private:
+   void Release( std::unique_ptr< Handle > handle );
+
+   using List = std::list< std::unique_ptr< Handle > >;
+
+   std::mutex mMutex;
+   // Idle handles, most recently used first
+   List mIdle;
+   size_t mCapacity;
+   // Advanced by each invalidation, so that handles leased meanwhile are
+   // closed when they return
+   unsigned long long mGeneration { 0 };
+
+   unsigned long long mHits { 0 };
+   unsigned long long mMisses { 0 };
+   unsigned long long mReopens { 0 };
+   unsigned long long mEvictions { 0 };
+};
+
+#endif
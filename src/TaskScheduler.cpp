@@ -0,0 +1,249 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TaskScheduler.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "ThreadPool.h"
+
+namespace {
+   // One more than the index of the worker running on this thread, or zero
+   thread_local size_t sWorkerIndex = 0;
+
+   // The iterations of one ParallelFor, shared with the tasks that help,
+   // which may start after the loop is done
+   struct Job
+   {
+      const TaskScheduler::Body *body;
+      size_t count;
+      std::atomic< size_t > next{ 0 };
+
+      std::mutex mutex;
+      std::condition_variable doneCondition;
+      // Guarded by mutex:
+      unsigned running { 0 };
+      bool closed { false };
+      std::exception_ptr exception;
+
+      void Run()
+      {
+         // Take indices until none remain
+         size_t index;
+         while ( ( index = next.fetch_add( 1, std::memory_order_relaxed ) )
+                 < count ) {
+            try {
+               (*body)( index );
+            }
+            catch ( ... ) {
+               std::lock_guard< std::mutex > lock{ mutex };
+               if ( !exception )
+                  exception = std::current_exception();
+            }
+         }
+      }
+   };
+}
+
+TaskScheduler &TaskScheduler::Get()
+{
+   static TaskScheduler scheduler;
+   return scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+{
+   for ( auto &posted : mPosted )
+      posted.store( 0 );
+
+   // The threads that call ParallelFor work too, so leave a processor for
+   // one of them; but Post needs a worker
+   const auto nWorkers =
+      std::max( 1u, ThreadPool::DefaultConcurrency() - 1 );
+   mWorkers.reserve( nWorkers );
+   for ( unsigned ii = 0; ii < nWorkers; ++ii )
+      mWorkers.push_back( std::make_unique< Worker >() );
+   // Start them only when all queues exist, because they steal
+   for ( size_t ii = 0; ii < mWorkers.size(); ++ii )
+      mWorkers[ii]->thread = std::thread{ [this, ii]{ WorkerLoop( ii ); } };
+}
+
+TaskScheduler::~TaskScheduler()
+{
+   {
+      std::lock_guard< std::mutex > lock{ mSleepMutex };
+      mStopping = true;
+   }
+   mWakeCondition.notify_all();
+   for ( auto &pWorker : mWorkers )
+      pWorker->thread.join();
+   // Tasks not yet taken are destroyed without running
+}
+
+void TaskScheduler::Post( Lane lane, Task task )
+{
+   ++mPosted[ lane ];
+
+   // Count it first, so that the count is never less than the tasks queued
+   ++mPending;
+   const auto index = sWorkerIndex;
+   if ( index > 0 ) {
+      // Keep it near the data of the task that posted it, unless another
+      // worker is idle and steals it
+      auto &worker = *mWorkers[ index - 1 ];
+      std::lock_guard< std::mutex > lock{ worker.mutex };
+      worker.queues[ lane ].push_back( std::move( task ) );
+   }
+   else {
+      std::lock_guard< std::mutex > lock{ mInjectedMutex };
+      mInjected[ lane ].push_back( std::move( task ) );
+   }
+
+   {
+      // Synchronize with the test of mPending in WorkerLoop
+      std::lock_guard< std::mutex > lock{ mSleepMutex };
+   }
+   mWakeCondition.notify_one();
+}
+
+bool TaskScheduler::TakeTask( size_t index, Task &task )
+{
+   const auto nWorkers = mWorkers.size();
+   for ( unsigned lane = 0; lane < nLanes; ++lane ) {
+      // The newest of its own, whose data may still be in the cache
+      {
+         auto &worker = *mWorkers[ index ];
+         std::lock_guard< std::mutex > lock{ worker.mutex };
+         auto &queue = worker.queues[ lane ];
+         if ( !queue.empty() ) {
+            task = std::move( queue.back() );
+            queue.pop_back();
+            --mPending;
+            return true;
+         }
+      }
+
+      // Else the oldest posted from outside
+      {
+         std::lock_guard< std::mutex > lock{ mInjectedMutex };
+         auto &queue = mInjected[ lane ];
+         if ( !queue.empty() ) {
+            task = std::move( queue.front() );
+            queue.pop_front();
+            --mPending;
+            return true;
+         }
+      }
+
+      // Else the oldest of another worker
+      for ( size_t ii = 1; ii < nWorkers; ++ii ) {
+         auto &victim = *mWorkers[ ( index + ii ) % nWorkers ];
+         std::lock_guard< std::mutex > lock{ victim.mutex };
+         auto &queue = victim.queues[ lane ];
+         if ( !queue.empty() ) {
+            task = std::move( queue.front() );
+            queue.pop_front();
+            --mPending;
+            ++mStolen;
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+void TaskScheduler::WorkerLoop( size_t index )
+{
+   sWorkerIndex = index + 1;
+
+   Task task;
+   while ( true ) {
+      if ( TakeTask( index, task ) ) {
+         task();
+         task = nullptr;
+         continue;
+      }
+
+      std::unique_lock< std::mutex > lock{ mSleepMutex };
+      mWakeCondition.wait( lock, [this]{
+         return mStopping || mPending.load() > 0; } );
+      if ( mStopping )
+         return;
+   }
+}
+
+void TaskScheduler::ParallelFor(
+   Lane lane, size_t count, const Body &body, unsigned maxConcurrency )
+{
+   if ( count == 0 )
+      return;
+
+   auto concurrency = GetConcurrency();
+   if ( maxConcurrency > 0 )
+      concurrency = std::min( concurrency, maxConcurrency );
+   const auto nHelpers = std::min< size_t >( concurrency - 1, count - 1 );
+
+   if ( nHelpers == 0 ) {
+      // Skip the synchronization
+      for ( size_t ii = 0; ii < count; ++ii )
+         body( ii );
+      return;
+   }
+
+   auto job = std::make_shared< Job >();
+   job->body = &body;
+   job->count = count;
+
+   for ( size_t ii = 0; ii < nHelpers; ++ii )
+      Post( lane, [job]{
+         {
+            std::lock_guard< std::mutex > lock{ job->mutex };
+            if ( job->closed )
+               // The loop finished without this helper
+               return;
+            ++job->running;
+         }
+         job->Run();
+         bool last;
+         {
+            std::lock_guard< std::mutex > lock{ job->mutex };
+            last = ( --job->running == 0 );
+         }
+         if ( last )
+            job->doneCondition.notify_one();
+      } );
+
+   // The calling thread does its share too, and all of it if the workers
+   // are busy
+   job->Run();
+
+   std::exception_ptr exception;
+   {
+      std::unique_lock< std::mutex > lock{ job->mutex };
+      job->closed = true;
+      job->doneCondition.wait( lock, [&]{ return job->running == 0; } );
+      std::swap( exception, job->exception );
+   }
+
+   if ( exception )
+      std::rethrow_exception( exception );
+}
+
+auto TaskScheduler::GetStatistics() const -> Statistics
+{
+   Statistics result;
+   for ( unsigned lane = 0; lane < nLanes; ++lane )
+      result.posted[ lane ] = mPosted[ lane ].load();
+   result.stolen = mStolen.load();
+   return result;
+}
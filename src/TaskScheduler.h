@@ -0,0 +1,121 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  TaskScheduler.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class TaskScheduler
+\brief One set of worker threads, as many as there are processors, that
+runs the work of the whole program, so that effects, exporters, importers,
+spectrograms and on-demand tasks running at once do not each start threads
+for every processor.
+
+  Each worker keeps its own queue of tasks for each lane, and takes the
+  newest task of its own; an idle worker takes the oldest task of another
+  worker, or of the tasks posted from threads that are not workers.  Lanes
+  are taken in order of priority, so that a buffer for playback is not
+  queued behind an export, but a running task is never interrupted.
+
+  ParallelFor() lends the iterations of a loop to the workers, and the
+  calling thread does its share too, so that the loop finishes even when
+  every worker is busy, and a task may run a loop of its own.  Any number
+  of threads may call it at once.
+
+  Work that waits on the disk or the network should not be given to the
+  workers; it would keep them from the processors.  See ThreadPool.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_TASK_SCHEDULER__
+#define __AUDACITY_TASK_SCHEDULER__
+
+#include "Audacity.h"
+#include "MemoryX.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskScheduler
+{
+public:
+   // In order of priority
+   enum Lane {
+      // Buffers for playback and recording, which must be ready in time
+      RealtimeAdjacent,
+      // Work the user waits for:  effects, exports, imports, drawing
+      Interactive,
+      // Work that fills in while the user does something else
+      Background,
+
+      nLanes
+   };
+
+   using Task = std::function< void() >;
+   using Body = std::function< void( size_t index ) >;
+
+   // Made on first use
+   static TaskScheduler &Get();
+
+   // Number of threads that work on a loop, counting its caller
+   unsigned GetConcurrency() const { return mWorkers.size() + 1; }
+
+   // Run the task on some worker, eventually.  It must not throw.
+   void Post( Lane lane, Task task );
+
+   // Call body(i) for each i in [0, count), in unspecified order and
+   // threads, using no more than maxConcurrency threads counting the
+   // caller, or GetConcurrency() if zero.  If any calls throw, the first
+   // exception is rethrown here, after all other iterations have finished.
+   void ParallelFor( Lane lane, size_t count, const Body &body,
+                     unsigned maxConcurrency = 0 );
+
+   // Counts since the program started, for diagnostics
+   struct Statistics {
+      unsigned long long posted[ nLanes ];
+      unsigned long long stolen;
+   };
+   Statistics GetStatistics() const;
+
+private:
+   TaskScheduler();
+   ~TaskScheduler();
+   TaskScheduler( const TaskScheduler& ) PROHIBITED;
+   TaskScheduler &operator= ( const TaskScheduler& ) PROHIBITED;
+
+   struct Worker {
+      std::mutex mutex;
+      std::deque< Task > queues[ nLanes ];
+      std::thread thread;
+   };
+
+   void WorkerLoop( size_t index );
+   bool TakeTask( size_t index, Task &task );
+
+   std::vector< std::unique_ptr< Worker > > mWorkers;
+
+   // Tasks posted from threads that are not workers
+   std::mutex mInjectedMutex;
+   std::deque< Task > mInjected[ nLanes ];
+
+   // Posted and not yet taken, so that a worker need not look for any
+   // when it is zero
+   std::atomic< size_t > mPending{ 0 };
+   std::mutex mSleepMutex;
+   std::condition_variable mWakeCondition;
+   bool mStopping { false };
+
+   std::atomic< unsigned long long > mPosted[ nLanes ];
+   std::atomic< unsigned long long > mStolen{ 0 };
+};
+
+#endif
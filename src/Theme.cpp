@@ -61,10 +61,13 @@ can't be.
 
 #include "Audacity.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <wx/wxprec.h>
 #include <wx/image.h>
 #include <wx/file.h>
 #include <wx/ffile.h>
+#include <wx/filename.h>
 #include <wx/mstream.h>
 #include <wx/settings.h>
 
@@ -78,6 +81,7 @@ can't be.
 #include "AllThemeResources.h"  // can remove this later, only needed for 'XPMS_RETIRED'.
 #include "FileNames.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "AColor.h"
 #include "ImageManipulation.h"
 #include "widgets/ErrorDialog.h"
@@ -234,16 +238,187 @@ void Theme::EnsureInitialised()
 
 }
 
-bool ThemeBase::LoadPreferredTheme()
+wxString ThemeBase::PreferredThemeName()
 {
 // DA: Default themes differ.
 #ifdef EXPERIMENTAL_DA
-   wxString theme = gPrefs->Read(wxT("/GUI/Theme"), wxT("dark"));
+   return gPrefs->Read(wxT("/GUI/Theme"), wxT("dark"));
 #else
-   wxString theme = gPrefs->Read(wxT("/GUI/Theme"), wxT("light"));
+   return gPrefs->Read(wxT("/GUI/Theme"), wxT("light"));
 #endif
+}
 
-   theTheme.LoadTheme( theTheme.ThemeTypeOfTypeName( theme ) );
+bool ThemeBase::LoadPreferredTheme()
+{
+   theTheme.LoadTheme( theTheme.ThemeTypeOfTypeName( PreferredThemeName() ) );
+   return true;
+}
+
+// Must be wide enough for bmpAudacityLogo. Use double width + 10.
+const int ImageCacheWidth = 440;
+
+const int ImageCacheHeight = 836;
+
+namespace {
+   // The decoded cache holds this header, then the rgb bytes, then the
+   // alpha bytes if any.  It is a copy that can always be made again, so
+   // it is in the byte order of the machine.
+   struct DecodedHeader
+   {
+      char magic[8];
+      unsigned long long key;
+      unsigned int width, height, hasAlpha;
+   };
+   const char DecodedMagic[8] = { 'A', 'u', 'd', 'T', 'h', 'm', '0', '1' };
+
+   // Changes when the png changes:  a hash of the data compiled in, or the
+   // size and time of the file
+   unsigned long long DecodedKey( const unsigned char *pData, size_t size )
+   {
+      // FNV-1a
+      unsigned long long hash = 14695981039346656037ULL;
+      for( size_t ii = 0; ii < size; ++ii )
+         hash = ( hash ^ pData[ii] ) * 1099511628211ULL;
+      return hash ^ size;
+   }
+
+   unsigned long long DecodedKey( const wxString &FileName )
+   {
+      const unsigned long long size = wxFileName::GetSize( FileName ).GetValue();
+      const unsigned long long time = wxFileModificationTime( FileName );
+      return ( size << 40 ) ^ time;
+   }
+
+   bool ReadDecoded( const wxString &CacheName, unsigned long long key,
+      wxImage &image )
+   {
+      wxFFile file;
+      if( !wxFileExists( CacheName ) || !file.Open( CacheName, wxT("rb") ) )
+         return false;
+      DecodedHeader header;
+      if( file.Read( &header, sizeof(header) ) != sizeof(header) ||
+          memcmp( header.magic, DecodedMagic, sizeof(DecodedMagic) ) != 0 ||
+          header.key != key ||
+          header.width == 0 || header.width > unsigned(ImageCacheWidth) ||
+          header.height == 0 || header.height > unsigned(16 * ImageCacheHeight) )
+         return false;
+
+      const size_t pixels = size_t(header.width) * header.height;
+      // wxImage takes ownership of malloc'd buffers
+      auto rgb = static_cast<unsigned char*>( malloc( 3 * pixels ) );
+      auto alpha = header.hasAlpha
+         ? static_cast<unsigned char*>( malloc( pixels ) ) : nullptr;
+      if( !rgb || ( header.hasAlpha && !alpha ) ||
+          file.Read( rgb, 3 * pixels ) != 3 * pixels ||
+          ( alpha && file.Read( alpha, pixels ) != pixels ) ) {
+         free( rgb );
+         free( alpha );
+         return false;
+      }
+      image.Create( header.width, header.height, rgb );
+      if( alpha )
+         image.SetAlpha( alpha );
+      return image.IsOk();
+   }
+
+   void WriteDecoded( const wxString &CacheName, unsigned long long key,
+      const wxImage &image )
+   {
+      // A mask would be lost
+      if( !image.IsOk() || image.HasMask() )
+         return;
+      DecodedHeader header{};
+      memcpy( header.magic, DecodedMagic, sizeof(DecodedMagic) );
+      header.key = key;
+      header.width = image.GetWidth();
+      header.height = image.GetHeight();
+      header.hasAlpha = image.HasAlpha() ? 1 : 0;
+      const size_t pixels = size_t(header.width) * header.height;
+
+      // Write aside and rename, so that a reader never sees half a file
+      const wxString TempName = CacheName + wxT(".tmp");
+      {
+         wxFFile file;
+         if( !file.Open( TempName, wxT("wb") ) )
+            return;
+         bool ok = file.Write( &header, sizeof(header) ) == sizeof(header) &&
+            file.Write( image.GetData(), 3 * pixels ) == 3 * pixels &&
+            ( !header.hasAlpha ||
+              file.Write( image.GetAlpha(), pixels ) == pixels );
+         ok = file.Close() && ok;
+         if( !ok ) {
+            wxRemoveFile( TempName );
+            return;
+         }
+      }
+      if( !wxRenameFile( TempName, CacheName, true ) )
+         wxRemoveFile( TempName );
+   }
+}
+
+void ThemeBase::PrefetchPreferredTheme()
+{
+   if( mPrefetched.valid() )
+      return;
+
+   const auto name = PreferredThemeName();
+   const auto type = ThemeTypeOfTypeName( name );
+   wxString FileName;
+   size_t ImageSize = 0;
+   const unsigned char * pImage = nullptr;
+   if( type == themeFromFile )
+      FileName = FileNames::ThemeCachePng();
+   else
+      GetImageCacheData( type, pImage, ImageSize );
+   // Find the directories here; FileNames is not for other threads
+   const wxString CacheName = FileNames::ThemeDecodedCache(
+      type == themeFromFile ? wxString{ wxT("custom") } : name );
+
+   // Only the decoding moves; ReadImageCache() still slices the image into
+   // bitmaps on the main thread, and reports any failure when it decodes
+   // again for itself.  The decoded pixels, already shrunk to the width of
+   // the cache, are kept on disk, so that later startups need not inflate
+   // the png at all.
+   mPrefetchedType = type;
+   mPrefetched = std::async( std::launch::async, [=]{
+      PROFILE_SCOPE("Startup::DecodeTheme");
+      wxLogNull noLog;
+      wxImage image;
+      const bool fromFile = !FileName.empty();
+      if( fromFile && !wxFileExists( FileName ) )
+         return image;
+      const auto key = fromFile
+         ? DecodedKey( FileName ) : DecodedKey( pImage, ImageSize );
+      if( ReadDecoded( CacheName, key, image ) )
+         return image;
+
+      if( !fromFile ) {
+         wxMemoryInputStream InternalStream( pImage, ImageSize );
+         image.LoadFile( InternalStream, wxBITMAP_TYPE_PNG );
+      }
+      else
+         image.LoadFile( FileName, wxBITMAP_TYPE_PNG );
+      if( !image.IsOk() )
+         return image;
+      // As ReadImageCache() would
+      if( image.GetWidth() > ImageCacheWidth ) {
+         int h = image.GetHeight() * ((1.0*ImageCacheWidth)/image.GetWidth());
+         image.Rescale( ImageCacheWidth, h );
+      }
+      WriteDecoded( CacheName, key, image );
+      return image;
+   } );
+}
+
+bool ThemeBase::TakePrefetched( teThemeType type, wxImage &ImageCache )
+{
+   if( !mPrefetched.valid() )
+      return false;
+   // Wait for the decoding even if it is not wanted now, and use it once only
+   auto image = mPrefetched.get();
+   if( type != mPrefetchedType || !image.IsOk() )
+      return false;
+   ImageCache = image;
    return true;
 }
 
@@ -286,6 +461,7 @@ void Theme::RegisterColours()
 ThemeBase::ThemeBase(void)
 {
    bRecolourOnLoad = false;
+   mPrefetchedType = themeFromFile;
    bIsUsingSystemTextColour = false;
 }
 
@@ -652,11 +828,6 @@ SourceOutputStream::~SourceOutputStream()
 }
 
 
-// Must be wide enough for bmpAudacityLogo. Use double width + 10.
-const int ImageCacheWidth = 440;
-
-const int ImageCacheHeight = 836;
-
 void ThemeBase::CreateImageCache( bool bBinarySave )
 {
    EnsureInitialised();
@@ -950,6 +1121,30 @@ teThemeType ThemeBase::ThemeTypeOfTypeName( const wxString & Name )
 ///   otherwise the data is taken from a compiled in block of memory.
 /// @param bOkIfNotFound if true means do not report absent file.
 /// @return true iff we loaded the images.
+void ThemeBase::GetImageCacheData( teThemeType type,
+   const unsigned char *&pImage, size_t &ImageSize )
+{
+   switch( type ){
+      default: 
+      case themeClassic : 
+         ImageSize = sizeof(ClassicImageCacheAsData);
+         pImage = ClassicImageCacheAsData;
+         break;
+      case themeLight : 
+         ImageSize = sizeof(LightImageCacheAsData);
+         pImage = LightImageCacheAsData;
+         break;
+      case themeDark : 
+         ImageSize = sizeof(DarkImageCacheAsData);
+         pImage = DarkImageCacheAsData;
+         break;
+      case themeHiContrast : 
+         ImageSize = sizeof(HiContrastImageCacheAsData);
+         pImage = HiContrastImageCacheAsData;
+         break;
+   }
+}
+
 bool ThemeBase::ReadImageCache( teThemeType type, bool bOkIfNotFound)
 {
    EnsureInitialised();
@@ -964,7 +1159,11 @@ bool ThemeBase::ReadImageCache( teThemeType type, bool bOkIfNotFound)
 
    gPrefs->Read(wxT("/GUI/BlendThemes"), &bRecolourOnLoad, true);
 
-   if(  type == themeFromFile )
+   if( TakePrefetched( type, ImageCache ) )
+   {
+      // Decoded already, on another thread, during startup
+   }
+   else if(  type == themeFromFile )
    {
       const wxString &FileName = FileNames::ThemeCachePng();
       if( !wxFileExists( FileName ))
@@ -992,25 +1191,7 @@ bool ThemeBase::ReadImageCache( teThemeType type, bool bOkIfNotFound)
    {
       size_t ImageSize = 0;
       const unsigned char * pImage = nullptr;
-      switch( type ){
-         default: 
-         case themeClassic : 
-            ImageSize = sizeof(ClassicImageCacheAsData);
-            pImage = ClassicImageCacheAsData;
-            break;
-         case themeLight : 
-            ImageSize = sizeof(LightImageCacheAsData);
-            pImage = LightImageCacheAsData;
-            break;
-         case themeDark : 
-            ImageSize = sizeof(DarkImageCacheAsData);
-            pImage = DarkImageCacheAsData;
-            break;
-         case themeHiContrast : 
-            ImageSize = sizeof(HiContrastImageCacheAsData);
-            pImage = HiContrastImageCacheAsData;
-            break;
-      }
+      GetImageCacheData( type, pImage, ImageSize );
       //wxLogDebug("Reading ImageCache %p size %i", pImage, ImageSize );
       wxMemoryInputStream InternalStream( pImage, ImageSize );
 
@@ -16,6 +16,7 @@
 
 #include "Audacity.h"
 
+#include <future>
 #include <vector>
 #include <wx/wx.h>
 #include <wx/bitmap.h>
@@ -115,6 +116,9 @@ public:
    void WriteImageDefs( );
    void WriteImageMap( );
    static bool LoadPreferredTheme();
+   // Start decoding the theme that LoadPreferredTheme() will want, on
+   // another thread, so that it overlaps the rest of startup
+   void PrefetchPreferredTheme();
    bool IsUsingSystemTextColour(){ return bIsUsingSystemTextColour;};
    void RecolourBitmap( int iIndex, wxColour From, wxColour To );
    void RecolourTheme();
@@ -151,6 +155,15 @@ protected:
    std::vector<wxColour> mColours;
    wxArrayString mColourNames;
    FlowPacker mFlow;
+
+private:
+   static wxString PreferredThemeName();
+   static void GetImageCacheData( teThemeType type,
+      const unsigned char *&pImage, size_t &ImageSize );
+   bool TakePrefetched( teThemeType type, wxImage &ImageCache );
+
+   std::future<wxImage> mPrefetched;
+   teThemeType mPrefetchedType;
 };
 
 
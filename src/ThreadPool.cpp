@@ -0,0 +1,120 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPool.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "Audacity.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+unsigned ThreadPool::DefaultConcurrency()
+{
+   // hardware_concurrency may return 0 when it can't tell
+   return std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+ThreadPool::ThreadPool( unsigned concurrency )
+{
+   concurrency = std::max( 1u, concurrency );
+   mWorkers.reserve( concurrency - 1 );
+   for ( unsigned ii = 1; ii < concurrency; ++ii )
+      mWorkers.emplace_back( [this]{ WorkerLoop(); } );
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mStopping = true;
+   }
+   mStartCondition.notify_all();
+   for ( auto &worker : mWorkers )
+      worker.join();
+}
+
+void ThreadPool::ParallelFor( size_t count, const Body &body )
+{
+   if ( count == 0 )
+      return;
+
+   if ( mWorkers.empty() || count == 1 ) {
+      // Skip the synchronization
+      for ( size_t ii = 0; ii < count; ++ii )
+         body( ii );
+      return;
+   }
+
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mBody = &body;
+      mCount = count;
+      mNext.store( 0, std::memory_order_relaxed );
+      mException = nullptr;
+      mBusy = mWorkers.size();
+      ++mGeneration;
+   }
+   mStartCondition.notify_all();
+
+   // The calling thread does its share too
+   RunIterations();
+
+   std::exception_ptr exception;
+   {
+      std::unique_lock< std::mutex > lock{ mMutex };
+      mDoneCondition.wait( lock, [this]{ return mBusy == 0; } );
+      mBody = nullptr;
+      std::swap( exception, mException );
+   }
+
+   if ( exception )
+      std::rethrow_exception( exception );
+}
+
+void ThreadPool::WorkerLoop()
+{
+   unsigned long generation = 0;
+   while ( true ) {
+      {
+         std::unique_lock< std::mutex > lock{ mMutex };
+         mStartCondition.wait( lock, [&]{
+            return mStopping || mGeneration != generation; } );
+         if ( mStopping )
+            return;
+         generation = mGeneration;
+      }
+
+      RunIterations();
+
+      bool last;
+      {
+         std::lock_guard< std::mutex > lock{ mMutex };
+         last = ( --mBusy == 0 );
+      }
+      if ( last )
+         mDoneCondition.notify_one();
+   }
+}
+
+void ThreadPool::RunIterations()
+{
+   // Take indices until none remain
+   size_t index;
+   while ( ( index = mNext.fetch_add( 1, std::memory_order_relaxed ) )
+           < mCount ) {
+      try {
+         (*mBody)( index );
+      }
+      catch ( ... ) {
+         std::lock_guard< std::mutex > lock{ mMutex };
+         if ( !mException )
+            mException = std::current_exception();
+      }
+   }
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPool.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class ThreadPool
+\brief A fixed set of worker threads that execute the iterations of a
+loop in parallel.
+
+  ParallelFor() hands out the indices of the loop from one atomic counter,
+  to the workers and to the calling thread as well, and returns only when
+  all iterations are done, so each call is also a barrier.
+
+  Only one thread at a time may call ParallelFor() on a given pool.
+
+  Its threads are its own, so it suits work that mostly waits, on the disk
+  or the network.  Work for the processors should go to the TaskScheduler,
+  which all of the program shares.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_THREAD_POOL__
+#define __AUDACITY_THREAD_POOL__
+
+#include "Audacity.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+   using Body = std::function< void( size_t index ) >;
+
+   // Number of threads to use, counting the caller of ParallelFor, when the
+   // user has not chosen:  one per processor
+   static unsigned DefaultConcurrency();
+
+   // Starts concurrency - 1 workers; the caller of ParallelFor is the other
+   explicit ThreadPool( unsigned concurrency = DefaultConcurrency() );
+   ~ThreadPool();
+
+   ThreadPool( const ThreadPool& ) PROHIBITED;
+   ThreadPool &operator= ( const ThreadPool& ) PROHIBITED;
+
+   unsigned GetConcurrency() const { return mWorkers.size() + 1; }
+
+   // Call body(i) for each i in [0, count), in unspecified order and
+   // threads.  If any calls throw, the first exception is rethrown here,
+   // after all other iterations have finished.
+   void ParallelFor( size_t count, const Body &body );
+
+private:
+   void WorkerLoop();
+   void RunIterations();
+
+   std::vector< std::thread > mWorkers;
+
+   std::mutex mMutex;
+   std::condition_variable mStartCondition;
+   std::condition_variable mDoneCondition;
+
+   // Guarded by mMutex:
+   unsigned long mGeneration { 0 };
+   unsigned mBusy { 0 };
+   bool mStopping { false };
+   std::exception_ptr mException;
+
+   // Valid during ParallelFor:
+   const Body *mBody { nullptr };
+   size_t mCount { 0 };
+   std::atomic< size_t > mNext { 0 };
+};
+
+#endif
@@ -37,6 +37,8 @@
 #include "Project.h"
 #include "Internat.h"
 #include "Prefs.h"
+#include "DirManager.h"
+#include "prefs/QualityPrefs.h"
 #include "widgets/NumericTextCtrl.h"
 #include "widgets/HelpSystem.h"
 #include "widgets/ErrorDialog.h"
@@ -168,6 +170,8 @@ TimerRecordDialog::TimerRecordDialog(wxWindow* parent, bool bAlreadySaved)
    // Do we allow the user to change the Automatic Save file?
    m_bProjectAlreadySaved = bAlreadySaved;
 
+   m_bReserveSpace = false;
+
    ShuttleGui S(this, eIsCreating);
    this->PopulateOrExchange(S);
 
@@ -431,6 +435,21 @@ void TimerRecordDialog::OnOK(wxCommandEvent& WXUNUSED(event))
       }
    }
 
+   // Allocate the space now, so that a recording of days does not fail
+   // late for lack of it.  RunWaitDialog() gives back what is unused.
+   const auto &dirManager = pProject->GetDirManager();
+   if (m_bReserveSpace && dirManager->UsesPackedBlockStore()) {
+      long lCaptureChannels;
+      gPrefs->Read(wxT("/AudioIO/RecordChannels"), &lCaptureChannels, 2L);
+      const auto samples = sampleCount{ m_TimeSpan_Duration.GetSeconds().ToDouble() *
+         pProject->GetRate() * lCaptureChannels };
+      if (!dirManager->ReserveSpaceFor(samples, QualityPrefs::SampleFormatChoice())) {
+         AudacityMessageBox(_("The disk space for this Timer Recording could not be reserved.\n\nFree some space, or shorten the recording."),
+            _("Timer Recording Disk Space Warning"), wxICON_EXCLAMATION | wxOK);
+         return;
+      }
+   }
+
    m_timer.Stop(); // Don't need to keep updating m_DateTime_Start to prevent backdating.
    this->EndModal(wxID_OK);
    wxLongLong duration = m_TimeSpan_Duration.GetSeconds();
@@ -511,7 +530,13 @@ bool TimerRecordDialog::RemoveAllAutoSaveFiles()
 int TimerRecordDialog::RunWaitDialog()
 {
    AudacityProject* pProject = GetActiveProject();
-   
+
+   // Whether cancelled or done, the space that OnOK() reserved and the
+   // recording did not fill is given back
+   auto release = finally( [&] {
+      pProject->GetDirManager()->ReleaseReservedSpace();
+   } );
+
    auto updateResult = ProgressResult::Success;
 
    if (m_DateTime_Start > wxDateTime::UNow())
@@ -785,6 +810,7 @@ void TimerRecordDialog::PopulateOrExchange(ShuttleGui& S)
    bool bAutoSave = gPrefs->ReadBool("/TimerRecord/AutoSave", false);
    bool bAutoExport = gPrefs->ReadBool("/TimerRecord/AutoExport", false);
    int iPostTimerRecordAction = gPrefs->ReadLong("/TimerRecord/PostAction", 0);
+   bool bReserveSpace = gPrefs->ReadBool("/TimerRecord/ReserveSpace", false);
 
    S.SetBorder(5);
    S.StartMultiColumn(2, wxCENTER);
@@ -943,6 +969,12 @@ void TimerRecordDialog::PopulateOrExchange(ShuttleGui& S)
                m_pTimerAfterCompleteChoiceCtrl = S.AddChoice(_("After Recording completes:"),
                                                              m_sTimerAfterCompleteOption,
                                                              &m_sTimerAfterCompleteOptionsArray);
+
+               // Only packed blocks are written into space allocated ahead
+               m_pTimerReserveSpaceCheckBoxCtrl = S.AddCheckBox(_("&Reserve disk space before recording"),
+                                                                (bReserveSpace ? "true" : "false"));
+               m_pTimerReserveSpaceCheckBoxCtrl->Enable(
+                  GetActiveProject()->GetDirManager()->UsesPackedBlockStore());
             }
             S.EndMultiColumn();
          }
@@ -995,6 +1027,7 @@ bool TimerRecordDialog::TransferDataFromWindow()
    // Pull the settings from the auto save/export controls and write to the pref file
    m_bAutoSaveEnabled = m_pTimerAutoSaveCheckBoxCtrl->GetValue();
    m_bAutoExportEnabled = m_pTimerAutoExportCheckBoxCtrl->GetValue();
+   m_bReserveSpace = m_pTimerReserveSpaceCheckBoxCtrl->GetValue();
 
    // MY: Obtain the index from the choice control so we can save to the prefs file
    int iPostRecordAction = m_pTimerAfterCompleteChoiceCtrl->GetSelection();
@@ -1003,6 +1036,7 @@ bool TimerRecordDialog::TransferDataFromWindow()
    gPrefs->Write("/TimerRecord/AutoSave", m_bAutoSaveEnabled);
    gPrefs->Write("/TimerRecord/AutoExport", m_bAutoExportEnabled);
    gPrefs->Write("/TimerRecord/PostAction", iPostRecordAction);
+   gPrefs->Write("/TimerRecord/ReserveSpace", m_bReserveSpace);
 
    return true;
 }
@@ -131,6 +131,10 @@ private:
    // After Timer Record Options Choice
    wxChoice *m_pTimerAfterCompleteChoiceCtrl;
 
+   // Preallocation of the disk space for the recording
+   wxCheckBox *m_pTimerReserveSpaceCheckBoxCtrl;
+   bool m_bReserveSpace;
+
    // After Timer Record do we need to clean up?
    bool m_bProjectCleanupRequired;
 
@@ -26,6 +26,7 @@ and TimeTrack.
 #include "Track.h"
 
 #include <float.h>
+#include <wx/ffile.h>
 #include <wx/file.h>
 #include <wx/textfile.h>
 #include <wx/log.h>
@@ -36,6 +37,7 @@ and TimeTrack.
 #include "LabelTrack.h"
 #include "Project.h"
 #include "DirManager.h"
+#include "FileException.h"
 
 #include "Experimental.h"
 
@@ -98,7 +100,11 @@ void Track::Init(const Track &orig)
 
 void Track::SetSelected(bool s)
 {
-   mSelected = s;
+   if (mSelected != s) {
+      mSelected = s;
+      if (auto pList = mList.lock())
+         ++pList->mGeneration;
+   }
 }
 
 void Track::Merge(const Track &orig)
@@ -108,6 +114,45 @@ void Track::Merge(const Track &orig)
 
 Track::~Track()
 {
+   if (IsSpilled())
+      wxRemoveFile(mSpillPath);
+}
+
+size_t Track::Spill(const wxString &path)
+{
+   const auto bytes = GetSpillableBytes();
+   if (IsSpilled() || bytes == 0)
+      return 0;
+
+   bool written;
+   {
+      wxLogNull noLog;
+      wxFFile file{ path, wxT("wb") };
+      written = file.IsOpened() && WriteSpill(file) && file.Close();
+   }
+   if (!written) {
+      // As of a full disk; the content stays in memory
+      wxRemoveFile(path);
+      return 0;
+   }
+
+   FreeSpilled();
+   mSpillPath = path;
+   return bytes;
+}
+
+void Track::Unspill()
+{
+   if (!IsSpilled())
+      return;
+
+   {
+      wxFFile file{ mSpillPath, wxT("rb") };
+      if (!file.IsOpened() || !ReadSpill(file))
+         throw FileException{ FileException::Cause::Read, mSpillPath };
+   }
+   wxRemoveFile(mSpillPath);
+   mSpillPath.clear();
 }
 
 
@@ -630,6 +675,31 @@ VisibleTrackIterator::VisibleTrackIterator(AudacityProject *project)
    mPanelRect.SetSize(mProject->GetTPTracksUsableArea());
 }
 
+Track *VisibleTrackIterator::First(TrackList *val)
+{
+   if (val && val != mProject->GetTracks())
+      return TrackListCondIterator::First(val);
+
+   Track *t = mProject->GetTracks()->FindAtY(mPanelRect.GetTop());
+   if (!t)
+      return nullptr;
+
+   // The first channel of a stereo pair counts as visible if the second is
+   Track *partner = t->GetLink();
+   if (partner && !t->GetLinked())
+      t = partner;
+
+   return StartWith(t);
+}
+
+Track *VisibleTrackIterator::Next(bool skiplinked)
+{
+   Track *t = TrackListCondIterator::Next(skiplinked);
+   if (t && t->GetY() > mPanelRect.GetBottom())
+      return nullptr;
+   return t;
+}
+
 bool VisibleTrackIterator::Condition(Track *t)
 {
    wxRect r(0, t->GetY(), 1, t->GetHeight());
@@ -821,6 +891,8 @@ void TrackList::Swap(TrackList &that)
    SwapLOTs( *this, mSelf, that, that.mSelf );
    SwapLOTs( this->mPendingUpdates, mSelf, that.mPendingUpdates, that.mSelf );
    mUpdaters.swap(that.mUpdaters);
+   ClearIndexes();
+   that.ClearIndexes();
 }
 
 TrackList::~TrackList()
@@ -830,6 +902,10 @@ TrackList::~TrackList()
 
 void TrackList::RecalcPositions(TrackNodePointer node)
 {
+   // Every change of the order of tracks comes here, even the removal of
+   // the last track
+   ClearIndexes();
+
    if ( isNull( node ) )
       return;
 
@@ -893,13 +969,27 @@ void TrackList::Permute(const std::vector<TrackNodePointer> &permutation)
 
 Track *TrackList::FindById( TrackId id )
 {
-   // Linear search.  Tracks in a project are usually very few.
+   // Binary search, because projects may have hundreds of tracks.
    // Search only the non-pending tracks.
-   auto it = std::find_if( ListOfTracks::begin(), ListOfTracks::end(),
-      [=](const ListOfTracks::value_type &ptr){ return ptr->GetId() == id; } );
-   if (it == ListOfTracks::end())
+   BuildIndexes();
+   auto it = std::lower_bound( mById.begin(), mById.end(), id,
+      [](const Track *t, const TrackId &id){ return t->GetId() < id; } );
+   if (it == mById.end() || (*it)->GetId() != id)
       return {};
-   return it->get();
+   return *it;
+}
+
+void TrackList::BuildIndexes() const
+{
+   if (!mByPosition.empty() || empty())
+      return;
+
+   for (const auto &pTrack : static_cast<const ListOfTracks&>(*this))
+      mByPosition.push_back(pTrack.get());
+
+   mById = mByPosition;
+   std::sort(mById.begin(), mById.end(),
+      [](const Track *a, const Track *b){ return a->GetId() < b->GetId(); });
 }
 
 template<typename TrackKind>
@@ -1014,6 +1104,7 @@ void TrackList::Clear(bool sendEvent)
 
    ListOfTracks tempList;
    tempList.swap( *this );
+   ClearIndexes();
 
    ListOfTracks updating;
    updating.swap( mPendingUpdates );
@@ -1113,6 +1204,14 @@ int TrackList::GetGroupHeight(Track * t) const
    return height;
 }
 
+Track *TrackList::FindAtY(int y) const
+{
+   BuildIndexes();
+   auto it = std::lower_bound(mByPosition.begin(), mByPosition.end(), y,
+      [](const Track *t, int y){ return t->GetY() + t->GetHeight() <= y; });
+   return it == mByPosition.end() ? nullptr : *it;
+}
+
 bool TrackList::CanMoveUp(Track * t) const
 {
    return GetPrev(t, true) != NULL;
@@ -1489,6 +1588,7 @@ void TrackList::ClearPendingTracks( ListOfTracks *pAdded )
          ++it;
    }
 
+   ClearIndexes();
    if (!empty())
       RecalcPositions(getBegin());
 }
@@ -31,6 +31,7 @@
 #pragma warning(disable:4284)
 #endif
 
+class wxFFile;
 class wxTextFile;
 class DirManager;
 class Track;
@@ -264,6 +265,34 @@ public:
    using Holder = std::unique_ptr<Track>;
    virtual Holder Duplicate() const = 0;
 
+   // Like Duplicate, but the result may share parts with previous, an
+   // earlier duplicate of this track, where nothing has changed since.
+   // So neither previous nor the result may be modified afterward; these
+   // are for the states of the undo history.
+   virtual Holder DuplicateSharing(const Track &previous) const
+   { return Duplicate(); }
+
+   // For old states of the undo history, which are not used until they
+   // are restored:  move content held in memory to a file, and read it
+   // again.  Spill returns the bytes freed, or 0 if it could not write.
+   size_t Spill(const wxString &path);
+   // Throws FileException if the file can't be read
+   void Unspill();
+   bool IsSpilled() const { return !mSpillPath.empty(); }
+   // Bytes of memory that Spill would free
+   virtual size_t GetSpillableBytes() const { return 0; }
+
+ protected:
+   // Spill writes the content, and only if that succeeds, frees it
+   virtual bool WriteSpill(wxFFile &) const { return false; }
+   virtual void FreeSpilled() {}
+   virtual bool ReadSpill(wxFFile &) { return false; }
+
+ private:
+   wxString mSpillPath;
+
+ public:
+
    // Called when this track is merged to stereo with another, and should
    // take on some paramaters of its partner.
    virtual void Merge(const Track &orig);
@@ -557,6 +586,11 @@ class AUDACITY_DLL_API VisibleTrackIterator final : public TrackListCondIterator
    VisibleTrackIterator(AudacityProject *project);
    virtual ~VisibleTrackIterator() {}
 
+   // Tracks are in vertical order, so these skip the tracks scrolled away
+   // above, and stop at the first below the panel, without testing the rest
+   Track *First(TrackList *val = NULL) override;
+   Track *Next(bool skiplinked = false) override;
+
  protected:
    bool Condition(Track *t) override;
 
@@ -700,6 +734,14 @@ class TrackList final : public wxEvtHandler, public ListOfTracks
    Track *GetNext(Track * t, bool linked = false) const;
    int GetGroupHeight(Track * t) const;
 
+   /// Return the first track not entirely above y, or null if there is none.
+   /// A binary search, through an index rebuilt only after the list changes.
+   Track *FindAtY(int y) const;
+
+   /// Changes whenever tracks are added, removed, moved, linked, or
+   /// selected or deselected
+   unsigned long long GetGeneration() const { return mGeneration; }
+
    bool CanMoveUp(Track * t) const;
    bool CanMoveDown(Track * t) const;
 
@@ -799,6 +841,17 @@ private:
 
    std::weak_ptr<TrackList> mSelf;
 
+   // The tracks in list order, and so in order of y, for FindAtY(), and in
+   // order of id, for FindById().  Emptied whenever tracks are added,
+   // removed, or moved, and rebuilt when next needed.  Each emptying is
+   // also a new generation.
+   void ClearIndexes() const
+   { mByPosition.clear(); mById.clear(); ++mGeneration; }
+   void BuildIndexes() const;
+   mutable std::vector< Track* > mByPosition;
+   mutable std::vector< Track* > mById;
+   mutable unsigned long long mGeneration {};
+
    // Nondecreasing during the session.
    // Nonpersistent.
    // Used to assign ids to added tracks.
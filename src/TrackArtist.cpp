@@ -145,12 +145,14 @@ audio tracks.
 
 #include <math.h>
 #include <float.h>
+#include <algorithm>
 #include <limits>
 
 #ifdef HAVE_ALLOCA_H
 #include <alloca.h>
 #endif
 
+#include <wx/bitmap.h>
 #include <wx/brush.h>
 #include <wx/colour.h>
 #include <wx/dc.h>
@@ -174,6 +176,7 @@ audio tracks.
 #include "LabelTrack.h"
 #include "TimeTrack.h"
 #include "Prefs.h"
+#include "PrefsSnapshot.h"
 #include "prefs/GUISettings.h"
 #include "prefs/SpectrogramSettings.h"
 #include "prefs/TracksPrefs.h"
@@ -185,54 +188,9 @@ audio tracks.
 #include "AllThemeResources.h"
 #include "Experimental.h"
 #include "TrackPanelDrawingContext.h"
+#include "Profiler.h"
 
 
-#undef PROFILE_WAVEFORM
-#ifdef PROFILE_WAVEFORM
-   #ifdef __WXMSW__
-      #include <time.h>
-   #else
-      #include <sys/time.h>
-   #endif
-double gWaveformTimeTotal = 0;
-int gWaveformTimeCount = 0;
-
-namespace {
-   struct Profiler {
-      Profiler()
-      {
-#   ifdef __WXMSW__
-         _time64(&tv0);
-#   else
-         gettimeofday(&tv0, NULL);
-#   endif
-      }
-
-      ~Profiler()
-      {
-#   ifdef __WXMSW__
-         _time64(&tv1);
-         double elapsed = _difftime64(tv1, tv0);
-#   else
-         gettimeofday(&tv1, NULL);
-         double elapsed =
-            (tv1.tv_sec + tv1.tv_usec*0.000001) -
-            (tv0.tv_sec + tv0.tv_usec*0.000001);
-#   endif
-         gWaveformTimeTotal += elapsed;
-         gWaveformTimeCount++;
-         wxPrintf(wxT("Avg waveform drawing time: %f\n"),
-            gWaveformTimeTotal / gWaveformTimeCount);
-      }
-
-#   ifdef __WXMSW__
-      __time64_t tv0, tv1;
-#else
-      struct timeval tv0, tv1;
-#endif
-   };
-}
-#endif
 
 #ifdef USE_MIDI
 /*
@@ -264,6 +222,62 @@ int TrackArtist::GetBottom(NoteTrack *t, const wxRect &rect)
 */
 #endif // USE_MIDI
 
+namespace {
+// Bounds the memory of the waveform images:  64 MB at 32 bits per pixel
+const size_t MaxWaveformImagePixels = 16 * 1024 * 1024;
+}
+
+// A clip's waveform as last drawn, with everything it was drawn from, so
+// that a repaint need redraw only the columns whose inputs changed.
+// Because the inputs are compared, the image is never wrong, even if the
+// clip is destroyed and another is made at the same address.
+struct TrackArtist::WaveformImage
+{
+   struct Parameters {
+      std::vector<wxColour> colours;
+      float zoomMin, zoomMax;
+      int zeroLevel;
+      bool dB;
+      float dBRange;
+      bool drawEnvelope, syncLockSelected, highlightEnvelope, muted;
+      long showClipping;
+
+      bool operator== (const Parameters &other) const
+      {
+         return colours == other.colours &&
+            zoomMin == other.zoomMin && zoomMax == other.zoomMax &&
+            zeroLevel == other.zeroLevel &&
+            dB == other.dB && dBRange == other.dBRange &&
+            drawEnvelope == other.drawEnvelope &&
+            syncLockSelected == other.syncLockSelected &&
+            highlightEnvelope == other.highlightEnvelope &&
+            muted == other.muted && showClipping == other.showClipping;
+      }
+   };
+
+   struct Column {
+      double env;
+      float min, max, rms;
+      bool sel;
+      bool valid;
+
+      bool operator== (const Column &other) const
+      {
+         return valid && other.valid && env == other.env &&
+            min == other.min && max == other.max && rms == other.rms &&
+            sel == other.sel;
+      }
+   };
+
+   Parameters parameters;
+   wxBitmap bitmap;
+   std::vector<Column> columns;
+   // Clip time of the first column, and pixels per second
+   double start { 0 };
+   double pps { 0 };
+   unsigned long long lastUse { 0 };
+};
+
 TrackArtist::TrackArtist()
 {
    mMarginLeft   = 0;
@@ -381,7 +395,7 @@ void TrackArtist::DrawTracks(TrackPanelDrawingContext &context,
    dc.DrawRectangle(clip);
 #endif
 
-   gPrefs->Read(wxT("/GUI/ShowTrackNameInWaveform"), &mbShowTrackNameInWaveform, false);
+   mbShowTrackNameInWaveform = PrefsSnapshot::Get()->showTrackNameInWaveform;
 
    t = iter.StartWith(start);
    while (t) {
@@ -1210,9 +1224,9 @@ void TrackArtist::DrawMinMaxRMS(wxDC &dc, const wxRect & rect, const double env[
    int lasth2 = std::numeric_limits<int>::min();
    int h1;
    int h2;
-   ArrayOf<int> r1{ size_t(rect.width) };
-   ArrayOf<int> r2{ size_t(rect.width) };
-   ArrayOf<int> clipped;
+   PooledArrayOf<int> r1{ size_t(rect.width) };
+   PooledArrayOf<int> r2{ size_t(rect.width) };
+   PooledArrayOf<int> clipped;
    int clipcnt = 0;
 
    if (mShowClipping) {
@@ -1333,6 +1347,154 @@ void TrackArtist::DrawMinMaxRMS(wxDC &dc, const wxRect & rect, const double env[
    }
 }
 
+void TrackArtist::DrawClipWaveformImage(wxDC &dc, const WaveClip *clip,
+   const wxRect &mid, int leftOffset, const double env[],
+   float zoomMin, float zoomMax, int zeroLevelYCoordinate,
+   bool dB, float dBRange,
+   const float *min, const float *max, const float *rms, const int *bl,
+   double t0, double pps, double sel0, double sel1,
+   const ZoomInfo &zoomInfo,
+   bool drawEnvelope, bool bIsSyncLockSelected, bool highlightEnvelope,
+   bool muted)
+{
+   PROFILE_SCOPE("TrackArtist::DrawClipWaveformImage");
+
+   // The image is drawn with its top left at 0, 0
+   WaveformImage::Parameters parameters{
+      {
+         blankBrush.GetColour(), unselectedBrush.GetColour(),
+         selectedBrush.GetColour(),
+         samplePen.GetColour(), muteSamplePen.GetColour(),
+         rmsPen.GetColour(), muteRmsPen.GetColour(),
+         clippedPen.GetColour(), muteClippedPen.GetColour(),
+      },
+      zoomMin, zoomMax, zeroLevelYCoordinate - mid.y,
+      dB, dBRange,
+      drawEnvelope, bIsSyncLockSelected, highlightEnvelope, muted,
+      mShowClipping
+   };
+
+   auto &pImage = mWaveformImages[clip];
+   if (!pImage || !(pImage->parameters == parameters) ||
+       pImage->bitmap.GetHeight() != mid.height) {
+      pImage = std::make_unique<WaveformImage>();
+      pImage->parameters = std::move(parameters);
+   }
+   auto &image = *pImage;
+   image.lastUse = ++mWaveformImageUses;
+
+   // After horizontal scrolling by whole pixels, or resizing, keep the
+   // columns that still show the same times
+   std::vector<WaveformImage::Column> columns(mid.width);
+   wxBitmap bitmap;
+   wxMemoryDC memDC;
+   {
+      const int oldWidth = image.columns.size();
+      int shift = oldWidth;
+      if (image.bitmap.IsOk() && image.pps == pps) {
+         const double offset = (t0 - image.start) * pps;
+         const double rounded = floor(offset + 0.5);
+         if (fabs(offset - rounded) < 0.01 && fabs(rounded) < oldWidth)
+            shift = (int)rounded;
+      }
+
+      if (shift == 0 && oldWidth == mid.width) {
+         bitmap = image.bitmap;
+         image.bitmap = wxNullBitmap;
+         columns.swap(image.columns);
+         memDC.SelectObject(bitmap);
+      }
+      else {
+         bitmap.Create(mid.width, mid.height);
+         memDC.SelectObject(bitmap);
+         const int begin = std::max(0, -shift);
+         const int end = std::min(mid.width, oldWidth - shift);
+         if (begin < end) {
+            std::copy(image.columns.begin() + begin + shift,
+               image.columns.begin() + end + shift,
+               columns.begin() + begin);
+            wxMemoryDC oldDC;
+            oldDC.SelectObject(image.bitmap);
+            memDC.Blit(begin, 0, end - begin, mid.height,
+               &oldDC, begin + shift, 0);
+            oldDC.SelectObject(wxNullBitmap);
+         }
+      }
+   }
+
+   // Find the columns to redraw.  Each also depends on the column to its
+   // left, with which DrawMinMaxRMS makes the waveform continuous.
+   std::vector<bool> redraw(mid.width);
+   {
+      bool changed = false;
+      double time = zoomInfo.PositionToTime(0, -leftOffset), nextTime;
+      for (int xx = 0; xx < mid.width; ++xx, time = nextTime) {
+         nextTime = zoomInfo.PositionToTime(xx + 1, -leftOffset);
+         // As in DrawWaveformBackground
+         const bool sel =
+            (sel0 <= time && nextTime < sel1) && !bIsSyncLockSelected;
+         const WaveformImage::Column column{
+            env[xx], min[xx], max[xx], rms[xx], sel, true };
+         const bool leftChanged = changed;
+         changed = !(columns[xx] == column);
+         redraw[xx] = changed || leftChanged;
+         columns[xx] = column;
+      }
+   }
+
+   for (int xx = 0; xx < mid.width;) {
+      if (!redraw[xx]) {
+         ++xx;
+         continue;
+      }
+      const int begin = xx;
+      while (xx < mid.width && redraw[xx])
+         ++xx;
+
+      // Start one column early, but clipped, for the continuity
+      const int from = std::max(0, begin - 1);
+      const wxRect strip{ from, 0, xx - from, mid.height };
+      memDC.SetClippingRegion(begin, 0, xx - begin, mid.height);
+      DrawWaveformBackground(memDC, leftOffset + from, strip,
+         env + from,
+         zoomMin, zoomMax,
+         zeroLevelYCoordinate - mid.y,
+         dB, dBRange,
+         sel0, sel1, zoomInfo, drawEnvelope,
+         bIsSyncLockSelected, highlightEnvelope);
+      DrawMinMaxRMS(memDC, strip, env + from,
+         zoomMin, zoomMax,
+         dB, dBRange,
+         min + from, max + from, rms + from, bl + from,
+         false, muted);
+      memDC.DestroyClippingRegion();
+   }
+
+   dc.Blit(mid.x, mid.y, mid.width, mid.height, &memDC, 0, 0);
+   memDC.SelectObject(wxNullBitmap);
+
+   image.bitmap = bitmap;
+   image.columns.swap(columns);
+   image.start = t0;
+   image.pps = pps;
+
+   // Forget the least recently drawn images, which may be of clips that
+   // no longer exist
+   size_t pixels = 0;
+   for (const auto &pair : mWaveformImages)
+      pixels += pair.second->columns.size() * pair.second->bitmap.GetHeight();
+   while (pixels > MaxWaveformImagePixels && mWaveformImages.size() > 1) {
+      auto oldest = std::min_element(
+         mWaveformImages.begin(), mWaveformImages.end(),
+         [](const WaveformImages::value_type &a,
+            const WaveformImages::value_type &b){
+            return a.second->lastUse < b.second->lastUse; });
+      pixels -=
+         oldest->second->columns.size() * oldest->second->bitmap.GetHeight();
+      mWaveformImages.erase(oldest);
+   }
+}
+
 void TrackArtist::DrawIndividualSamples(wxDC &dc, int leftOffset, const wxRect &rect,
                                         float zoomMin, float zoomMax,
                                         bool dB, float dBRange,
@@ -1359,14 +1521,14 @@ void TrackArtist::DrawIndividualSamples(wxDC &dc, int leftOffset, const wxRect &
    if (slen <= 0)
       return;
 
-   Floats buffer{ size_t(slen) };
+   PooledArrayOf<float> buffer{ size_t(slen) };
    clip->GetSamples((samplePtr)buffer.get(), floatSample, s0, slen,
                     // Suppress exceptions in this drawing operation:
                     false);
 
-   ArrayOf<int> xpos{ size_t(slen) };
-   ArrayOf<int> ypos{ size_t(slen) };
-   ArrayOf<int> clipped;
+   PooledArrayOf<int> xpos{ size_t(slen) };
+   PooledArrayOf<int> ypos{ size_t(slen) };
+   PooledArrayOf<int> clipped;
    int clipcnt = 0;
 
    if (mShowClipping)
@@ -1806,9 +1968,7 @@ void TrackArtist::DrawClipWaveform(TrackPanelDrawingContext &context,
                                    bool muted)
 {
    auto &dc = context.dc;
-#ifdef PROFILE_WAVEFORM
-   Profiler profiler;
-#endif
+   PROFILE_SCOPE("TrackArtist::DrawClipWaveform");
 
    bool highlightEnvelope = false;
 #ifdef EXPERIMENTAL_TRACK_PANEL_HIGHLIGHTING
@@ -1861,25 +2021,18 @@ void TrackArtist::DrawClipWaveform(TrackPanelDrawingContext &context,
 
         env, mid.width, leftOffset, zoomInfo );
 
-   // Draw the background of the track, outlining the shape of
-   // the envelope and using a colored pen for the selected
+   // The background of the track outlines the shape of
+   // the envelope and uses a colored pen for the selected
    // part of the waveform
-   {
-      double t0, t1;
-      if (track->GetSelected() || track->IsSyncLockSelected()) {
-         t0 = track->LongSamplesToTime(track->TimeToLongSamples(selectedRegion.t0())),
-            t1 = track->LongSamplesToTime(track->TimeToLongSamples(selectedRegion.t1()));
-      }
-      else
-         t0 = t1 = 0.0;
-      DrawWaveformBackground(dc, leftOffset, mid,
-         env,
-         zoomMin, zoomMax,
-         track->ZeroLevelYCoordinate(mid),
-         dB, dBRange,
-         t0, t1, zoomInfo, drawEnvelope,
-         !track->GetSelected(), highlightEnvelope);
+   double sel0, sel1;
+   if (track->GetSelected() || track->IsSyncLockSelected()) {
+      sel0 = track->LongSamplesToTime(track->TimeToLongSamples(selectedRegion.t0())),
+         sel1 = track->LongSamplesToTime(track->TimeToLongSamples(selectedRegion.t1()));
    }
+   else
+      sel0 = sel1 = 0.0;
+   const bool syncLockSelected = !track->GetSelected();
+   const int zeroLevelYCoordinate = track->ZeroLevelYCoordinate(mid);
 
    WaveDisplay display(hiddenMid.width);
    bool isLoadingOD = false;//true if loading on demand block in sequence.
@@ -1898,8 +2051,8 @@ void TrackArtist::DrawClipWaveform(TrackPanelDrawingContext &context,
    // Require at least 3 pixels per sample for drawing the draggable points.
    const double threshold2 = 3 * rate;
 
+   bool showIndividualSamples = false;
    {
-      bool showIndividualSamples = false;
       for (unsigned ii = 0; !showIndividualSamples && ii < nPortions; ++ii) {
          const WavePortion &portion = portions[ii];
          showIndividualSamples =
@@ -1918,12 +2071,45 @@ void TrackArtist::DrawClipWaveform(TrackPanelDrawingContext &context,
          // redrawing.
 
          if (!clip->GetWaveDisplay(display,
-            t0, pps, isLoadingOD))
+            t0, pps, isLoadingOD)) {
+            DrawWaveformBackground(dc, leftOffset, mid,
+               env,
+               zoomMin, zoomMax,
+               zeroLevelYCoordinate,
+               dB, dBRange,
+               sel0, sel1, zoomInfo, drawEnvelope,
+               syncLockSelected, highlightEnvelope);
             return;
+         }
       }
    }
 
-   for (unsigned ii = 0; ii < nPortions; ++ii) {
+   // Without fisheye, individual samples, or the animation of unloaded
+   // on-demand data, reuse the image of the last repaint where its
+   // inputs are the same.  The sync-lock pattern is not reused, because
+   // it is aligned to the track, not to the clip.
+   const bool useImage = nPortions == 1 && !portions[0].inFisheye &&
+      !showIndividualSamples && !isLoadingOD && mid == hiddenMid &&
+      !(syncLockSelected && sel0 < sel1);
+   if (useImage) {
+      const int pos = leftOffset - params.hiddenLeftOffset;
+      DrawClipWaveformImage(dc, clip, mid, leftOffset, env,
+         zoomMin, zoomMax, zeroLevelYCoordinate, dB, dBRange,
+         display.min + pos, display.max + pos, display.rms + pos,
+         display.bl + pos,
+         t0, pps, sel0, sel1, zoomInfo, drawEnvelope,
+         syncLockSelected, highlightEnvelope, muted);
+   }
+   else
+      DrawWaveformBackground(dc, leftOffset, mid,
+         env,
+         zoomMin, zoomMax,
+         zeroLevelYCoordinate,
+         dB, dBRange,
+         sel0, sel1, zoomInfo, drawEnvelope,
+         syncLockSelected, highlightEnvelope);
+
+   for (unsigned ii = 0; !useImage && ii < nPortions; ++ii) {
       WavePortion &portion = portions[ii];
       const bool showIndividualSamples = portion.averageZoom > threshold1;
       const bool showPoints = portion.averageZoom > threshold2;
@@ -2118,6 +2304,45 @@ void TrackArtist::DrawSpectrum(const WaveTrack *track,
    }
 }
 
+// Maximum method, and no apportionment of any single bins over multiple pixel rows
+// See Bug971
+// The indices depend only on the row, so they can be found once for all columns
+static inline void findBinIndices
+(float bin0, float bin1, unsigned nBins, bool autocorrelation,
+ int &index, int &limitIndex)
+{
+   if (autocorrelation) {
+      // bin = 2 * nBins / (nBins - 1 - array_index);
+      // Solve for index
+      index = std::max(0.0f, std::min(float(nBins - 1),
+         (nBins - 1) - (2 * nBins) / (std::max(1.0f, bin0))
+      ));
+      limitIndex = std::max(0.0f, std::min(float(nBins - 1),
+         (nBins - 1) - (2 * nBins) / (std::max(1.0f, bin1))
+      ));
+   }
+   else {
+      index = std::min<int>(nBins - 1, (int)(floor(0.5 + bin0)));
+      limitIndex = std::min<int>(nBins, (int)(floor(0.5 + bin1)));
+   }
+}
+
+static inline float findValueInIndices
+(const float *spectrum, int index, int limitIndex,
+ bool autocorrelation, int gain, int range)
+{
+   float value = spectrum[index];
+   while (++index < limitIndex)
+      value = std::max(value, spectrum[index]);
+
+   if (!autocorrelation) {
+      // Last step converts dB to a 0.0-1.0 range
+      value = (value + range + gain) / (double)range;
+   }
+   value = std::min(1.0f, std::max(0.0f, value));
+   return value;
+}
+
 static inline float findValue
 (const float *spectrum, float bin0, float bin1, unsigned nBins,
  bool autocorrelation, int gain, int range)
@@ -2146,34 +2371,18 @@ static inline float findValue
       value += spectrum[(int)(bin1)] * (bin1 - (int)(bin1));
       value /= binwidth;
    }
-#else
-   // Maximum method, and no apportionment of any single bins over multiple pixel rows
-   // See Bug971
-   int index, limitIndex;
-   if (autocorrelation) {
-      // bin = 2 * nBins / (nBins - 1 - array_index);
-      // Solve for index
-      index = std::max(0.0f, std::min(float(nBins - 1),
-         (nBins - 1) - (2 * nBins) / (std::max(1.0f, bin0))
-      ));
-      limitIndex = std::max(0.0f, std::min(float(nBins - 1),
-         (nBins - 1) - (2 * nBins) / (std::max(1.0f, bin1))
-      ));
-   }
-   else {
-      index = std::min<int>(nBins - 1, (int)(floor(0.5 + bin0)));
-      limitIndex = std::min<int>(nBins, (int)(floor(0.5 + bin1)));
-   }
-   value = spectrum[index];
-   while (++index < limitIndex)
-      value = std::max(value, spectrum[index]);
-#endif
    if (!autocorrelation) {
       // Last step converts dB to a 0.0-1.0 range
       value = (value + range + gain) / (double)range;
    }
    value = std::min(1.0f, std::max(0.0f, value));
    return value;
+#else
+   int index, limitIndex;
+   findBinIndices(bin0, bin1, nBins, autocorrelation, index, limitIndex);
+   return findValueInIndices(spectrum, index, limitIndex,
+      autocorrelation, gain, range);
+#endif
 }
 
 
@@ -2206,9 +2415,7 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
                                    const SelectedRegion &selectedRegion,
                                    const ZoomInfo &zoomInfo)
 {
-#ifdef PROFILE_WAVEFORM
-   Profiler profiler;
-#endif
+   PROFILE_SCOPE("TrackArtist::DrawClipSpectrum");
 
    const WaveTrack *const track = waveTrackCache.GetTrack();
    const SpectrogramSettings &settings = track->GetSpectrogramSettings();
@@ -2261,19 +2468,6 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
 
    dc.SetPen(*wxTRANSPARENT_PEN);
 
-   // We draw directly to a bit image in memory,
-   // and then paint this directly to our offscreen
-   // bitmap.  Note that this could be optimized even
-   // more, but for now this is not bad.  -dmazzoni
-   wxImage image((int)mid.width, (int)mid.height);
-   if (!image.IsOk())
-      return;
-#ifdef EXPERIMENTAL_SPECTROGRAM_OVERLAY
-   image.SetAlpha();
-   unsigned char *alpha = image.GetAlpha();
-#endif
-   unsigned char *data = image.GetData();
-
    const auto half = settings.GetFFTLength() / 2;
    const double binUnit = rate / (2 * half);
    const float *freq = 0;
@@ -2311,6 +2505,13 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
       bins[yy] = nextBin;
    }
 
+   // The range of fft bins for each pixel row, found once for all columns
+   ArrayOf<int> binIndices{ size_t(hiddenMid.height) };
+   ArrayOf<int> binLimits{ size_t(hiddenMid.height) };
+   for (int yy = 0; yy < hiddenMid.height; ++yy)
+      findBinIndices(bins[yy], bins[yy + 1], nBins, autocorrelation,
+         binIndices[yy], binLimits[yy]);
+
 #ifdef EXPERIMENTAL_FFT_Y_GRID
    const float
       log2 = logf(2.0f),
@@ -2460,12 +2661,15 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
 #endif //EXPERIMENTAL_FIND_NOTES
 
          for (int yy = 0; yy < hiddenMid.height; ++yy) {
+#ifdef EXPERIMENTAL_FIND_NOTES
             const float bin     = bins[yy];
             const float nextBin = bins[yy+1];
+#endif
 
             if (settings.scaleType != SpectrogramSettings::stLogarithmic) {
-               const float value = findValue
-                  (freq + nBins * xx, bin, nextBin, nBins, autocorrelation, gain, range);
+               const float value = findValueInIndices
+                  (freq + nBins * xx, binIndices[yy], binLimits[yy],
+                   autocorrelation, gain, range);
                clip->mSpecPxCache->values[xx * hiddenMid.height + yy] = value;
             }
             else {
@@ -2501,8 +2705,9 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
                else
 #endif //EXPERIMENTAL_FIND_NOTES
                {
-                  value = findValue
-                     (freq + nBins * xx, bin, nextBin, nBins, autocorrelation, gain, range);
+                  value = findValueInIndices
+                     (freq + nBins * xx, binIndices[yy], binLimits[yy],
+                      autocorrelation, gain, range);
                }
                clip->mSpecPxCache->values[xx * hiddenMid.height + yy] = value;
             } // logF
@@ -2526,6 +2731,27 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
       : std::min(mid.width, (int)(zoomInfo.GetFisheyeRightBoundary(-leftOffset)));
    const size_t numPixels = std::max(0, end - begin);
 
+   // build color gradient tables (not thread safe)
+   if (!AColor::gradient_inited)
+      AColor::PreComputeGradient();
+
+   // Without the fisheye, the image depends only on the cached values and
+   // these, so a repaint for other reasons can reuse it
+   const SpecPxCache::ImageParameters imageParameters{
+      (int)leftOffset, (int)hiddenLeftOffset, mid.width, mid.height,
+      zoomInfo.h, averagePixelsPerSample * rate, tOffset,
+      ssel0, ssel1, freqLo, freqHi, isSpectral, isGrayscale,
+      AColor::gradient_version
+   };
+   auto &pxCache = *clip->mSpecPxCache;
+   if (hidden && pxCache.bitmap.IsOk() &&
+       pxCache.imageParameters == imageParameters) {
+      wxMemoryDC memDC;
+      memDC.SelectObject(pxCache.bitmap);
+      dc.Blit(mid.x, mid.y, mid.width, mid.height, &memDC, 0, 0, wxCOPY, FALSE);
+      return;
+   }
+
    SpecCache specCache;
 
    // need explicit resize since specCache.where[] accessed before Populate()
@@ -2545,13 +2771,33 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
        );
    }
 
-   // build color gradient tables (not thread safe)
-   if (!AColor::gradient_inited)
-      AColor::PreComputeGradient();
+   // We draw directly to a bit image in memory,
+   // and then paint this directly to our offscreen
+   // bitmap.  Note that this could be optimized even
+   // more, but for now this is not bad.  -dmazzoni
+   wxImage image((int)mid.width, (int)mid.height);
+   if (!image.IsOk())
+      return;
+#ifdef EXPERIMENTAL_SPECTROGRAM_OVERLAY
+   image.SetAlpha();
+   unsigned char *alpha = image.GetAlpha();
+#endif
+   unsigned char *data = image.GetData();
 
    // left pixel column of the fisheye
    int fisheyeLeft = zoomInfo.GetFisheyeLeftBoundary(-leftOffset);
 
+   // The color set of each row within the time selection depends only on
+   // whether the column is in a dash of the selection edges, or between
+   ArrayOf<AColor::ColorGradientChoice> dashSets{ size_t(hiddenMid.height) };
+   ArrayOf<AColor::ColorGradientChoice> gapSets{ size_t(hiddenMid.height) };
+   for (int yy = 0; yy < hiddenMid.height; ++yy) {
+      dashSets[yy] = ChooseColorSet(bins[yy], bins[yy + 1],
+         selBinLo, selBinCenter, selBinHi, 0, isSpectral);
+      gapSets[yy] = ChooseColorSet(bins[yy], bins[yy + 1],
+         selBinLo, selBinCenter, selBinHi, 1, isSpectral);
+   }
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -2581,25 +2827,27 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
 
       bool maybeSelected = ssel0 <= w0 && w1 < ssel1;
 
-      for (int yy = 0; yy < hiddenMid.height; ++yy) {
-         const float bin     = bins[yy];
-         const float nextBin = bins[yy+1];
-
-         // For spectral selection, determine what colour
-         // set to use.  We use a darker selection if
-         // in both spectral range and time range.
+      // For spectral selection, determine what colour
+      // set to use.  We use a darker selection if
+      // in both spectral range and time range.
+      // If we are in the time selected range, then we may use a different color set.
+      const int dashCount = (xx + leftOffset - hiddenLeftOffset) / DASH_LENGTH;
+      const AColor::ColorGradientChoice *const sets = !maybeSelected
+         ? nullptr
+         : (0 == dashCount % 2) ? dashSets.get() : gapSets.get();
 
-         AColor::ColorGradientChoice selected = AColor::ColorGradientUnselected;
+      const float *const values = uncached
+         ? nullptr
+         : &clip->mSpecPxCache->values[correctedX * hiddenMid.height];
 
-         // If we are in the time selected range, then we may use a different color set.
-         if (maybeSelected)
-            selected =
-               ChooseColorSet(bin, nextBin, selBinLo, selBinCenter, selBinHi,
-                  (xx + leftOffset - hiddenLeftOffset) / DASH_LENGTH, isSpectral);
+      for (int yy = 0; yy < hiddenMid.height; ++yy) {
+         const AColor::ColorGradientChoice selected =
+            sets ? sets[yy] : AColor::ColorGradientUnselected;
 
-         const float value = uncached
-            ? findValue(uncached, bin, nextBin, nBins, autocorrelation, gain, range)
-            : clip->mSpecPxCache->values[correctedX * hiddenMid.height + yy];
+         const float value = values
+            ? values[yy]
+            : findValueInIndices(uncached, binIndices[yy], binLimits[yy],
+                 autocorrelation, gain, range);
 
          unsigned char rv, gv, bv;
          GetColorGradient(value, selected, isGrayscale, &rv, &gv, &bv);
@@ -2631,6 +2879,14 @@ void TrackArtist::DrawClipSpectrum(WaveTrackCache &waveTrackCache,
    memDC.SelectObject(converted);
 
    dc.Blit(mid.x, mid.y, mid.width, mid.height, &memDC, 0, 0, wxCOPY, FALSE);
+
+   memDC.SelectObject(wxNullBitmap);
+   if (hidden) {
+      pxCache.bitmap = converted;
+      pxCache.imageParameters = imageParameters;
+   }
+   else
+      pxCache.bitmap = wxNullBitmap;
 }
 
 #ifdef USE_MIDI
@@ -2927,8 +3183,6 @@ void TrackArtist::DrawNoteTrack(const NoteTrack *track,
    const double h = X_TO_TIME(rect.x);
    const double h1 = X_TO_TIME(rect.x + rect.width);
 
-   Alg_seq_ptr seq = &track->GetSeq();
-
    if (!track->GetSelected())
       sel0 = sel1 = 0.0;
 
@@ -3024,14 +3278,14 @@ void TrackArtist::DrawNoteTrack(const NoteTrack *track,
    Alg_attribute sizei = symbol_table.insert_string("sizei");
    Alg_attribute justifys = symbol_table.insert_string("justifys");
 
-   // We want to draw in seconds, so we need to convert to seconds
-   seq->convert_to_seconds();
+   // We want to draw in seconds; the index converts to seconds
+   std::vector<Alg_note_ptr> visibleNotes;
+   track->GetEventIndex().FindNotes(
+      h - track->GetOffset(), h1 - track->GetOffset(), visibleNotes);
 
-   Alg_iterator iterator(seq, false);
-   iterator.begin();
-   //for every event
-   Alg_event_ptr evt;
-   while (0 != (evt = iterator.next())) {
+   //for every note in view
+   for (const auto visibleNote : visibleNotes) {
+      const Alg_event_ptr evt = visibleNote;
       if (evt->get_type() == 'n') { // 'n' means a note
          Alg_note_ptr note = (Alg_note_ptr) evt;
          // if the note's channel is visible
@@ -3257,7 +3511,6 @@ void TrackArtist::DrawNoteTrack(const NoteTrack *track,
          }
       }
    }
-   iterator.end();
    // draw black line between top/bottom margins and the track
    dc.SetPen(*wxBLACK_PEN);
    AColor::Line(dc, rect.x, rect.y + marg, rect.x + rect.width, rect.y + marg);
@@ -3310,8 +3563,9 @@ void TrackArtist::DrawTimeTrack(TrackPanelDrawingContext &context,
 
 void TrackArtist::UpdatePrefs()
 {
-   mdBrange = gPrefs->Read(ENV_DB_KEY, mdBrange);
-   mShowClipping = gPrefs->Read(wxT("/GUI/ShowClipping"), mShowClipping);
+   const auto prefs = PrefsSnapshot::Get();
+   mdBrange = prefs->dBRange;
+   mShowClipping = prefs->showClipping;
    mSampleDisplay = TracksPrefs::SampleViewChoice();
    SetColours(0);
 }
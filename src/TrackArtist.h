@@ -19,6 +19,8 @@
 #define __AUDACITY_TRACKARTIST__
 
 #include "MemoryX.h"
+#include <unordered_map>
+#include <vector>
 #include <wx/brush.h>
 #include <wx/pen.h>
 #include "Experimental.h"
@@ -161,6 +163,20 @@ class AUDACITY_DLL_API TrackArtist {
                       bool dB, float dBRange,
                       const float *min, const float *max, const float *rms, const int *bl,
                       bool /* showProgress */, bool muted);
+   // Same as DrawWaveformBackground and DrawMinMaxRMS for the whole of
+   // mid, but reusing what was drawn for the clip before
+   void DrawClipWaveformImage(wxDC &dc, const WaveClip *clip,
+                              const wxRect &mid, int leftOffset,
+                              const double env[],
+                              float zoomMin, float zoomMax,
+                              int zeroLevelYCoordinate,
+                              bool dB, float dBRange,
+                              const float *min, const float *max,
+                              const float *rms, const int *bl,
+                              double t0, double pps, double sel0, double sel1,
+                              const ZoomInfo &zoomInfo,
+                              bool drawEnvelope, bool bIsSyncLockSelected,
+                              bool highlightEnvelope, bool muted);
    void DrawIndividualSamples(wxDC & dc, int leftOffset, const wxRect & rect,
                               float zoomMin, float zoomMax,
                               bool dB, float dBRange,
@@ -212,6 +228,13 @@ class AUDACITY_DLL_API TrackArtist {
 
    std::unique_ptr<Ruler> vruler;
 
+   // Waveforms as last drawn, by clip
+   struct WaveformImage;
+   using WaveformImages =
+      std::unordered_map<const WaveClip*, std::unique_ptr<WaveformImage>>;
+   WaveformImages mWaveformImages;
+   unsigned long long mWaveformImageUses { 0 };
+
 #ifdef EXPERIMENTAL_FFT_Y_GRID
    bool fftYGridOld;
 #endif //EXPERIMENTAL_FFT_Y_GRID
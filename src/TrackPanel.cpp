@@ -1894,7 +1894,9 @@ void TrackPanel::DrawEverythingElse(TrackPanelDrawingContext &context,
          if (mAx->IsFocused(t)) {
             focusRect = borderRect;
          }
-         DrawOutside(context, borderTrack, borderRect);
+         // When only some tracks were refreshed, leave the others alone
+         if (region.Contains(borderRect) != wxOutRegion)
+            DrawOutside(context, borderTrack, borderRect);
       }
 
       // Believe it or not, we can speed up redrawing if we don't
@@ -22,20 +22,24 @@ UndoManager
 
 #include "Audacity.h"
 
+#include <wx/filename.h>
 #include <wx/hashset.h>
 
 #include "BlockFile.h"
 #include "Diags.h"
+#include "FileNames.h"
 #include "Internat.h"
 #include "Project.h"
 #include "Sequence.h"
 #include "WaveTrack.h"          // temp
 #include "NoteTrack.h"  // for Sonify* function declarations
 #include "Diags.h"
+#include "Prefs.h"
 #include "Tags.h"
 
 #include "UndoManager.h"
 
+#include <map>
 #include <unordered_set>
 
 using ConstBlockFilePtr = const BlockFile*;
@@ -57,6 +61,14 @@ struct UndoStackElem {
    UndoState state;
    wxString description;
    wxString shortDescription;
+
+   // Increases up the stack
+   unsigned long long serial {};
+   // Bytes of the block files charged to this state
+   unsigned long long spaceUsage {};
+   // Bytes of the content of tracks that could be spilled to files
+   unsigned long long memoryUsage {};
+   bool spilled {};
 };
 
 UndoManager::UndoManager()
@@ -64,6 +76,10 @@ UndoManager::UndoManager()
    current = -1;
    saved = -1;
    ResetODChangesFlag();
+
+   long megabytes;
+   gPrefs->Read(wxT("/History/UndoMemoryMB"), &megabytes, 256L);
+   mMemoryBudget = megabytes > 0 ? (unsigned long long)megabytes << 20 : 0;
 }
 
 UndoManager::~UndoManager()
@@ -72,10 +88,10 @@ UndoManager::~UndoManager()
 }
 
 namespace {
-   SpaceArray::value_type
+   unsigned long long
    CalculateUsage(TrackList *tracks, Set *seen)
    {
-      SpaceArray::value_type result = 0;
+      unsigned long long result = 0;
 
       //TIMER_START( "CalculateSpaceUsage", space_calc );
       TrackListOfKindIterator iter(Track::Wave);
@@ -110,40 +126,215 @@ namespace {
 
       return result;
    }
+
+   // Copy the tracks for a state.  Clips that did not change since the
+   // previous state are shared with it rather than copied, so the cost is
+   // in proportion to what changed.  This is safe because the tracks of
+   // states are never modified.
+   std::shared_ptr<TrackList>
+   CopyTracks(const TrackList &l, const TrackList *previous)
+   {
+      std::map<TrackId, const Track*> previousTracks;
+      if (previous)
+         for (auto t : *previous)
+            previousTracks[t->GetId()] = t;
+
+      auto tracksCopy = TrackList::Create();
+      for (auto t : l) {
+         if ( t->GetId() == TrackId{} )
+            // Don't copy a pending added track
+            continue;
+         const auto it = previousTracks.find(t->GetId());
+         if (it == previousTracks.end())
+            tracksCopy->Add(t->Duplicate());
+         else
+            tracksCopy->Add(t->DuplicateSharing(*it->second));
+      }
+      return tracksCopy;
+   }
+
+   template<typename Function>
+   void ForEachClip(TrackList *tracks, const Function &function)
+   {
+      TrackListOfKindIterator iter(Track::Wave);
+      for (auto wt = (WaveTrack *) iter.First(tracks); wt;
+           wt = (WaveTrack *) iter.Next())
+         for (const auto &clip : wt->GetAllClips())
+            function(*clip);
+   }
 }
 
-void UndoManager::CalculateSpaceUsage()
+// After copies and pastes, a block file may be used in more than
+// one place in one undo history state, and it may be used in more than
+// one undo history state.  It might even be used in two states, but not
+// in another state that is between them -- as when you have state A,
+// then make a cut to get state B, but then paste it back into state C.
+
+// So be sure to count each block file once only, in the last undo item that
+// contains it.
+
+// Why the last and not the first? Because the user of the History dialog
+// may DELETE undo states, oldest first.  To reclaim disk space you must
+// DELETE all states containing the block file.  So the block file's
+// contribution to space usage should be counted only in that latest state.
+
+// The charges are kept up to date as states are added, replaced and removed,
+// so that the History window need not scan all of the states.
+
+void UndoManager::AddUsage(UndoStackElem &elem)
+{
+   const auto stamp = ++mUsageStamp;
+   ForEachClip(elem.state.tracks.get(), [&](WaveClip &clip){
+      for (const auto &block : *clip.GetSequenceBlockArray()) {
+         auto &usage = mBlockUsage[ &*block.f ];
+         if (usage.stamp == stamp)
+            // Repeated within this state
+            continue;
+         usage.stamp = stamp;
+
+         if (usage.count++ == 0)
+            usage.bytes = block.f->GetSpaceUsage();
+
+         if (!usage.latest) {
+            if (usage.count > 1 && mOrphans > 0)
+               --mOrphans;
+         }
+         else if (usage.latest->serial < elem.serial)
+            usage.latest->spaceUsage -= usage.bytes;
+         else
+            continue;
+
+         usage.latest = &elem;
+         elem.spaceUsage += usage.bytes;
+      }
+   });
+}
+
+void UndoManager::RemoveUsage(UndoStackElem &elem)
 {
-   space.clear();
-   space.resize(stack.size(), 0);
+   const auto stamp = ++mUsageStamp;
+   ForEachClip(elem.state.tracks.get(), [&](WaveClip &clip){
+      for (const auto &block : *clip.GetSequenceBlockArray()) {
+         auto iter = mBlockUsage.find( &*block.f );
+         if (iter == mBlockUsage.end())
+            // Repeated within this state, and used by no other
+            continue;
+         auto &usage = iter->second;
+         if (usage.stamp == stamp)
+            // Repeated within this state
+            continue;
+         usage.stamp = stamp;
+
+         const bool charged = (usage.latest == &elem);
+         if (charged) {
+            elem.spaceUsage -= usage.bytes;
+            usage.latest = nullptr;
+         }
 
-   Set seen;
+         if (--usage.count == 0)
+            mBlockUsage.erase(iter);
+         else if (charged)
+            // Some lower state still uses it
+            ++mOrphans;
+      }
+   });
+}
 
-   // After copies and pastes, a block file may be used in more than
-   // one place in one undo history state, and it may be used in more than
-   // one undo history state.  It might even be used in two states, but not
-   // in another state that is between them -- as when you have state A,
-   // then make a cut to get state B, but then paste it back into state C.
+void UndoManager::ChargeOrphans(size_t n)
+{
+   // Clips are shared among states.  A clip seen in a higher state had its
+   // orphans charged there, so it need not be examined again.
+   std::unordered_set<const WaveClip*> seen;
+   while (mOrphans > 0 && n-- > 0) {
+      auto &elem = *stack[n];
+      ForEachClip(elem.state.tracks.get(), [&](WaveClip &clip){
+         if (!seen.insert(&clip).second)
+            return;
+         for (const auto &block : *clip.GetSequenceBlockArray()) {
+            auto iter = mBlockUsage.find( &*block.f );
+            if (iter != mBlockUsage.end() && !iter->second.latest) {
+               iter->second.latest = &elem;
+               elem.spaceUsage += iter->second.bytes;
+               --mOrphans;
+            }
+         }
+      });
+   }
 
-   // So be sure to count each block file once only, in the last undo item that
-   // contains it.
+   // Should not happen, but don't let the count go wrong for next time
+   wxASSERT(mOrphans == 0);
+   mOrphans = 0;
+}
 
-   // Why the last and not the first? Because the user of the History dialog
-   // may DELETE undo states, oldest first.  To reclaim disk space you must
-   // DELETE all states containing the block file.  So the block file's
-   // contribution to space usage should be counted only in that latest state.
+void UndoManager::AddMemory(UndoStackElem &elem)
+{
+   elem.memoryUsage = 0;
+   for (auto t : *elem.state.tracks)
+      elem.memoryUsage += t->GetSpillableBytes();
+   mMemoryUsage += elem.memoryUsage;
+}
 
-   for (size_t nn = stack.size(); nn--;)
-   {
-      // Scan all tracks at current level
-      auto tracks = stack[nn]->state.tracks.get();
-      space[nn] = CalculateUsage(tracks, &seen);
+void UndoManager::RemoveMemory(UndoStackElem &elem)
+{
+   if (!elem.spilled)
+      mMemoryUsage -= elem.memoryUsage;
+}
+
+void UndoManager::SpillStates()
+{
+   if (mMemoryBudget == 0)
+      return;
+
+   // The oldest first, then the farthest redo states; never the current
+   for (int ii = 0; ii < current && mMemoryUsage > mMemoryBudget; ++ii)
+      Spill(*stack[ii]);
+   for (int ii = (int)stack.size() - 1;
+        ii > current && mMemoryUsage > mMemoryBudget; --ii)
+      Spill(*stack[ii]);
+}
+
+void UndoManager::Spill(UndoStackElem &elem)
+{
+   if (elem.spilled || elem.memoryUsage == 0)
+      return;
+
+   const auto dir =
+      FileNames::MkDir(FileNames::TempDir() + wxFILE_SEP_PATH + wxT("undo"));
+   for (auto t : *elem.state.tracks) {
+      if (t->GetSpillableBytes() == 0)
+         continue;
+      const auto path =
+         wxFileName::CreateTempFileName(dir + wxFILE_SEP_PATH + wxT("state"));
+      if (path.empty())
+         // What was spilled stays so, and is read again with the rest
+         break;
+      if (t->Spill(path) == 0)
+         wxRemoveFile(path);
    }
 
+   // Counted as spilled even if only some tracks could be:  don't try
+   // again each time
+   elem.spilled = true;
+   mMemoryUsage -= elem.memoryUsage;
+}
+
+void UndoManager::Unspill(UndoStackElem &elem)
+{
+   if (!elem.spilled)
+      return;
+
+   for (auto t : *elem.state.tracks)
+      t->Unspill();
+   elem.spilled = false;
+   mMemoryUsage += elem.memoryUsage;
+}
+
+void UndoManager::CalculateSpaceUsage()
+{
+   // The usage of states is always up to date; only the clipboard needs
+   // counting
    mClipboardSpaceUsage = CalculateUsage
       (AudacityProject::GetClipboardTracks(), nullptr);
-
-   //TIMER_STOP( space_calc );
 }
 
 wxLongLong_t UndoManager::GetLongDescription(unsigned int n, wxString *desc,
@@ -152,13 +343,13 @@ wxLongLong_t UndoManager::GetLongDescription(unsigned int n, wxString *desc,
    n -= 1; // 1 based to zero based
 
    wxASSERT(n < stack.size());
-   wxASSERT(space.size() == stack.size());
 
    *desc = stack[n]->description;
 
-   *size = Internat::FormatSize(space[n]);
+   const auto usage = stack[n]->spaceUsage;
+   *size = Internat::FormatSize(usage);
 
-   return space[n];
+   return usage;
 }
 
 void UndoManager::GetShortDescription(unsigned int n, wxString *desc)
@@ -181,7 +372,10 @@ void UndoManager::SetLongDescription(unsigned int n, const wxString &desc)
 
 void UndoManager::RemoveStateAt(int n)
 {
+   RemoveUsage(*stack[n]);
+   RemoveMemory(*stack[n]);
    stack.erase(stack.begin() + n);
+   ChargeOrphans(n);
 }
 
 
@@ -210,6 +404,13 @@ unsigned int UndoManager::GetCurrentState()
    return current + 1;  // the array is 0 based, the abstraction is 1 based
 }
 
+std::shared_ptr<const TrackList> UndoManager::GetCurrentTracks() const
+{
+   if (current < 0)
+      return {};
+   return stack[current]->state.tracks;
+}
+
 bool UndoManager::UndoAvailable()
 {
    return (current > 0);
@@ -229,23 +430,21 @@ void UndoManager::ModifyState(const TrackList * l,
    }
 
    SonifyBeginModifyState();
-   // Delete current -- not necessary, but let's reclaim space early
-   stack[current]->state.tracks.reset();
-
-   // Duplicate
-   auto tracksCopy = TrackList::Create();
-   for (auto t : *l) {
-      if ( t->GetId() == TrackId{} )
-         // Don't copy a pending added track
-         continue;
-      tracksCopy->Add(t->Duplicate());
-   }
+
+   // Duplicate, sharing what is unchanged with the state being replaced
+   auto tracksCopy = CopyTracks(*l, stack[current]->state.tracks.get());
 
    // Replace
+   RemoveUsage(*stack[current]);
+   RemoveMemory(*stack[current]);
    stack[current]->state.tracks = std::move(tracksCopy);
+   AddUsage(*stack[current]);
+   AddMemory(*stack[current]);
+   ChargeOrphans(current);
    stack[current]->state.tags = tags;
 
    stack[current]->state.selectedRegion = selectedRegion;
+   ++mGeneration;
    SonifyEndModifyState();
 }
 
@@ -270,13 +469,8 @@ void UndoManager::PushState(const TrackList * l,
       return;
    }
 
-   auto tracksCopy = TrackList::Create();
-   for (auto t : *l) {
-      if ( t->GetId() == TrackId{} )
-         // Don't copy a pending added track
-         continue;
-      tracksCopy->Add(t->Duplicate());
-   }
+   auto tracksCopy = CopyTracks(*l,
+      current >= 0 ? stack[current]->state.tracks.get() : nullptr);
 
    mayConsolidate = true;
 
@@ -292,8 +486,13 @@ void UndoManager::PushState(const TrackList * l,
          (std::move(tracksCopy),
             longDescription, shortDescription, selectedRegion, tags)
    );
+   stack.back()->serial = mNextSerial++;
+   AddUsage(*stack.back());
+   AddMemory(*stack.back());
 
    current++;
+   ++mGeneration;
+   SpillStates();
 
    if (saved >= current) {
       saved = -1;
@@ -320,7 +519,10 @@ const UndoState &UndoManager::SetStateTo
 
    lastAction = wxT("");
    mayConsolidate = false;
+   ++mGeneration;
 
+   Unspill(*stack[current]);
+   SpillStates();
    return stack[current]->state;
 }
 
@@ -334,7 +536,10 @@ const UndoState &UndoManager::Undo(SelectedRegion *selectedRegion)
 
    lastAction = wxT("");
    mayConsolidate = false;
+   ++mGeneration;
 
+   Unspill(*stack[current]);
+   SpillStates();
    return stack[current]->state;
 }
 
@@ -361,7 +566,10 @@ const UndoState &UndoManager::Redo(SelectedRegion *selectedRegion)
 
    lastAction = wxT("");
    mayConsolidate = false;
+   ++mGeneration;
 
+   Unspill(*stack[current]);
+   SpillStates();
    return stack[current]->state;
 }
 
@@ -376,6 +584,18 @@ void UndoManager::StateSaved()
    ResetODChangesFlag();
 }
 
+void UndoManager::StateSaved(const TrackList *tracks)
+{
+   saved = -1;
+   for (size_t ii = 0, nn = stack.size(); ii < nn; ++ii)
+      if (stack[ii]->state.tracks.get() == tracks) {
+         saved = ii;
+         break;
+      }
+   if (saved == current)
+      ResetODChangesFlag();
+}
+
 // currently unused
 //void UndoManager::Debug()
 //{
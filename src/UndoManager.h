@@ -8,9 +8,11 @@
 
   After each operation, call UndoManager's PushState, pass it
   the entire track hierarchy.  The UndoManager makes a duplicate
-  of every single track using its Duplicate method, which should
-  increment reference counts.  If we were not at the top of
-  the stack when this is called, DELETE above first.
+  of every single track using its DuplicateSharing method, which
+  shares the clips that did not change with the current state,
+  and copies the others, incrementing reference counts of block
+  files.  If we were not at the top of the stack when this is
+  called, DELETE above first.
 
   If a minor change is made, for example changing the visual
   display of a track or changing the selection, you can call
@@ -50,11 +52,13 @@
 #define __AUDACITY_UNDOMANAGER__
 
 #include "MemoryX.h"
+#include <unordered_map>
 #include <vector>
 #include <wx/string.h>
 #include "ondemand/ODTaskThread.h"
 #include "SelectedRegion.h"
 
+class BlockFile;
 class Tags;
 class Track;
 class TrackList;
@@ -74,8 +78,6 @@ struct UndoState {
 
 using UndoStack = std::vector <std::unique_ptr<UndoStackElem>>;
 
-using SpaceArray = std::vector <unsigned long long> ;
-
 // These flags control what extra to do on a PushState
 // Default is AUTOSAVE
 // Frequent/faster actions use CONSOLIDATE
@@ -107,11 +109,16 @@ class AUDACITY_DLL_API UndoManager {
    void RemoveStateAt(int n);   // removes the n'th state (1 is oldest)
    unsigned int GetNumStates();
    unsigned int GetCurrentState();
+   // The tracks of the current state, which are never modified; or null
+   std::shared_ptr<const TrackList> GetCurrentTracks() const;
+   // Changes whenever a state is pushed, modified, or made current, so
+   // that what is computed from the tracks of the project may be kept
+   // until then
+   unsigned long long GetGeneration() const { return mGeneration; }
 
    void StopConsolidating() { mayConsolidate = false; }
 
    void GetShortDescription(unsigned int n, wxString *desc);
-   // Return value must first be calculated by CalculateSpaceUsage():
    wxLongLong_t GetLongDescription(unsigned int n, wxString *desc, wxString *size);
    void SetLongDescription(unsigned int n, const wxString &desc);
 
@@ -124,6 +131,8 @@ class AUDACITY_DLL_API UndoManager {
 
    bool UnsavedChanges();
    void StateSaved();
+   // Mark saved the state with these tracks, if it is still in the stack
+   void StateSaved(const TrackList *tracks);
 
    // Return value must first be calculated by CalculateSpaceUsage():
    // The clipboard is global, not specific to this project, but it is
@@ -131,6 +140,7 @@ class AUDACITY_DLL_API UndoManager {
    wxLongLong_t GetClipboardSpaceUsage() const
    { return mClipboardSpaceUsage; }
 
+   // Counts the clipboard; the usage of states is kept up to date
    void CalculateSpaceUsage();
 
    // void Debug(); // currently unused
@@ -141,6 +151,28 @@ class AUDACITY_DLL_API UndoManager {
    void ResetODChangesFlag();
 
  private:
+   // The states that use a block file, and the latest of them, which is
+   // charged with its space.  latest is null only while it is being found.
+   struct BlockUsage {
+      unsigned long long bytes {};
+      unsigned count {};
+      UndoStackElem *latest {};
+      // Detects repetitions within one state
+      unsigned long long stamp {};
+   };
+
+   void AddUsage(UndoStackElem &elem);
+   void RemoveUsage(UndoStackElem &elem);
+   // Memory of tracks of states, other than the current, is bounded by
+   // spilling the oldest to files, to be read again when restored
+   void AddMemory(UndoStackElem &elem);
+   void RemoveMemory(UndoStackElem &elem);
+   void SpillStates();
+   void Spill(UndoStackElem &elem);
+   void Unspill(UndoStackElem &elem);
+   // Charge uncharged block files to the highest states below n using them
+   void ChargeOrphans(size_t n);
+
    int current;
    int saved;
    UndoStack stack;
@@ -148,9 +180,18 @@ class AUDACITY_DLL_API UndoManager {
    wxString lastAction;
    bool mayConsolidate { false };
 
-   SpaceArray space;
+   std::unordered_map<const BlockFile*, BlockUsage> mBlockUsage;
+   unsigned long long mNextSerial {};
+   unsigned long long mUsageStamp {};
+   size_t mOrphans {};
+   unsigned long long mGeneration {};
    unsigned long long mClipboardSpaceUsage {};
 
+   // Bytes of spillable content of states not spilled, and the most to
+   // allow, or 0 for no limit
+   unsigned long long mMemoryUsage {};
+   unsigned long long mMemoryBudget {};
+
    bool mODChanges;
    ODLock mODChangesMutex;//mODChanges is accessed from many threads.
 
@@ -25,6 +25,9 @@ or "OFF" point
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
+#include <vector>
+
 #include <wx/filedlg.h>
 #include <wx/textfile.h>
 #include <wx/intl.h>
@@ -37,6 +40,184 @@ or "OFF" point
 using std::cout;
 using std::endl;
 
+namespace {
+
+// The statistics of windows already in memory.  The loops have no branches,
+// so that they may be vectorized.  As always here, sgn() takes the value
+// truncated to int.
+
+double SumOfSquares(const float *buffer, size_t len)
+{
+   // Separate sums, which need not wait for each other
+   double sums[4] = { 0, 0, 0, 0 };
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4)
+      for (size_t j = 0; j < 4; j++)
+         sums[j] += buffer[i + j] * buffer[i + j];
+   for (; i < len; i++)
+      sums[0] += buffer[i] * buffer[i];
+   return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+//Counts the changes from sign, the sign before the buffer, and updates it
+unsigned long CountSignChanges(const float *buffer, size_t len, int &sign)
+{
+   if (len == 0)
+      return 0;
+
+   unsigned long changes = (sgn(buffer[0]) != sign);
+   for (size_t i = 1; i < len; i++)
+      changes += (sgn(buffer[i]) != sgn(buffer[i - 1]));
+   sign = sgn(buffer[len - 1]);
+   return changes;
+}
+
+//Counts the changes from direction, the direction into the sample last
+//before the buffer, and updates both
+unsigned long CountDirectionChanges(
+   const float *buffer, size_t len, float &last, int &direction)
+{
+   if (len == 0)
+      return 0;
+
+   const int first = sgn(buffer[0] - last);
+   unsigned long changes = (first != direction);
+   direction = first;
+   if (len > 1) {
+      changes += (sgn(buffer[1] - buffer[0]) != first);
+      for (size_t i = 2; i < len; i++)
+         changes += (sgn(buffer[i] - buffer[i - 1]) !=
+                     sgn(buffer[i - 1] - buffer[i - 2]));
+      direction = sgn(buffer[len - 1] - buffer[len - 2]);
+   }
+   last = buffer[len - 1];
+   return changes;
+}
+
+// These are as TestEnergy, TestSignChanges and TestDirectionChanges compute
+// them for one window
+double WindowEnergy(const float *buffer, size_t len)
+{
+   return (1 + SumOfSquares(buffer, len)) / len;
+}
+
+double WindowSignChanges(const float *buffer, size_t len)
+{
+   int sign = sgn(buffer[0]);
+   return (double)(1 + CountSignChanges(buffer, len, sign)) / len;
+}
+
+double WindowDirectionChanges(const float *buffer, size_t len)
+{
+   float last = buffer[0];
+   int direction = 1;
+   return (double)(1 + CountDirectionChanges(buffer, len, last, direction))
+      / len;
+}
+
+}
+
+//This reads the windows of a scan in chunks much larger than a window, to
+//avoid a t.Get() for each, and finds the peaks of the chunks from the block
+//summaries, so that quiet stretches need not be read at all.
+class VoiceKey::WindowReader
+{
+public:
+   //For windows of no more than windowSize samples in [start, end), taken
+   //in increasing order, or decreasing if backward
+   WindowReader(const WaveTrack & t, sampleCount start, sampleCount end,
+                bool backward, size_t windowSize)
+      : mTrack{ t }
+      , mStart{ start }
+      , mEnd{ std::max(start, end) }
+      , mBackward{ backward }
+      , mChunkSize{ std::max(ChunkSize, windowSize) }
+      , mBuffer{ 2 * mChunkSize }
+   {}
+
+   //The samples of [start, start + len)
+   const float *Get(sampleCount start, size_t len)
+   {
+      if (len > mChunkSize)
+      {
+         mBuffer.reinit(2 * len);
+         mChunkSize = len;
+         mBufferLen = 0;
+      }
+
+      if (mBufferLen == 0 || start < mBufferStart ||
+          start + len > mBufferStart + mBufferLen)
+      {
+         //Read ahead in the direction of the scan, but not out of the range
+         sampleCount from, to;
+         if (mBackward)
+         {
+            to = start + len;
+            from = std::min(start, std::max(mStart, to - 2 * mChunkSize));
+         }
+         else
+         {
+            from = start;
+            to = std::max(start + len, std::min(mEnd, from + 2 * mChunkSize));
+         }
+         mBufferStart = from;
+         mBufferLen = (to - from).as_size_t();
+         mTrack.Get((samplePtr)mBuffer.get(), floatSample, from, mBufferLen);
+      }
+
+      return mBuffer.get() + (start - mBufferStart).as_size_t();
+   }
+
+   //No sample of [start, start + len) has a greater magnitude
+   float GetPeak(sampleCount start, size_t len)
+   {
+      if (start < mStart || start + len > mEnd)
+         return Peak(start, start + len);
+
+      //The peaks of the chunks of the range, found only once
+      const auto first = ((start - mStart) / mChunkSize).as_size_t();
+      const auto last = ((start + len - 1 - mStart) / mChunkSize).as_size_t();
+      if (mPeaks.size() <= last)
+         mPeaks.resize(last + 1, -1.0f);
+
+      float peak = 0;
+      for (auto k = first; k <= last; k++)
+      {
+         if (mPeaks[k] < 0)
+         {
+            const auto from = mStart + k * mChunkSize;
+            mPeaks[k] = Peak(from, std::min(mEnd, from + mChunkSize));
+         }
+         peak = std::max(peak, mPeaks[k]);
+      }
+      return peak;
+   }
+
+private:
+   static const size_t ChunkSize = 65536;
+
+   float Peak(sampleCount from, sampleCount to) const
+   {
+      //A sample more on each side, in case the times round inward
+      const auto range = mTrack.GetMinMax(
+         mTrack.LongSamplesToTime(from - 1), mTrack.LongSamplesToTime(to + 1));
+      return std::max(fabs(range.first), fabs(range.second));
+   }
+
+   const WaveTrack & mTrack;
+   const sampleCount mStart;
+   const sampleCount mEnd;
+   const bool mBackward;
+   size_t mChunkSize;
+
+   Floats mBuffer;
+   sampleCount mBufferStart{ 0 };
+   size_t mBufferLen{ 0 };
+
+   //Of each chunk of the range, from the start; negative if not yet found
+   std::vector<float> mPeaks;
+};
+
 
 
 VoiceKey::VoiceKey()
@@ -110,6 +291,9 @@ sampleCount VoiceKey::OnForward (
       auto lastsubthresholdsample = start;          //start this off at the selection start
       // keeps track of the sample number of the last sample to not exceed the threshold
 
+      //Reads the windows ahead in chunks
+      WindowReader reader{ t, start, start + len, false, WindowSizeInt };
+
       int blockruns=0;                         //keeps track of the number of consecutive above-threshold blocks
 
 
@@ -125,7 +309,7 @@ sampleCount VoiceKey::OnForward (
          const auto blocksize = limitSampleBufferSize( WindowSizeInt, samplesleft);
 
          //Test whether we are above threshold (the number of stats)
-         if(AboveThreshold(t,i,blocksize))
+         if(AboveThreshold(reader,i,blocksize))
             {
                blockruns++;                   //Hit
             } else {
@@ -258,6 +442,9 @@ sampleCount VoiceKey::OnBackward (
       auto lastsubthresholdsample = end;            //start this off at the end
       // keeps track of the sample number of the last sample to not exceed the threshold
 
+      //Reads the windows behind in chunks
+      WindowReader reader{ t, end - len, end, true, WindowSizeInt };
+
       int blockruns=0;                         //keeps track of the number of consecutive above-threshold blocks
 
 
@@ -274,7 +461,7 @@ sampleCount VoiceKey::OnBackward (
 
 
          //Test whether we are above threshold
-         if(AboveThreshold(t,i,blocksize))
+         if(AboveThreshold(reader,i,blocksize))
             {
                blockruns++;                   //Hit
             }
@@ -404,6 +591,9 @@ sampleCount VoiceKey::OffForward (
       auto lastsubthresholdsample = start;          //start this off at the selection start
       // keeps track of the sample number of the last sample to not exceed the threshold
 
+      //Reads the windows ahead in chunks
+      WindowReader reader{ t, start, start + len, false, WindowSizeInt };
+
       int blockruns=0;                         //keeps track of the number of consecutive above-threshold blocks
 
       //This loop goes through the selection a block at a time.  If a long enough run
@@ -416,7 +606,7 @@ sampleCount VoiceKey::OffForward (
          //Set blocksize so that it is the right size
          const auto blocksize = limitSampleBufferSize( WindowSizeInt, samplesleft);
 
-         if(!AboveThreshold(t,i,blocksize))
+         if(!AboveThreshold(reader,i,blocksize))
             {
                blockruns++;                   //Hit
             }
@@ -540,6 +730,9 @@ sampleCount VoiceKey::OffBackward (
       auto lastsubthresholdsample = end;            //start this off at the end
       // keeps track of the sample number of the last sample to not exceed the threshold
 
+      //Reads the windows behind in chunks
+      WindowReader reader{ t, end - len, end, true, WindowSizeInt };
+
       int blockruns=0;                         //keeps track of the number of consecutive above-threshold blocks
 
       //This loop goes through the selection a block at a time in reverse order.  If a long enough run
@@ -552,7 +745,7 @@ sampleCount VoiceKey::OffBackward (
          //Set blocksize so that it is the right size
          const auto blocksize = limitSampleBufferSize( WindowSizeInt, samplesleft);
 
-         if(!AboveThreshold(t,i,blocksize))
+         if(!AboveThreshold(reader,i,blocksize))
             {
 
                blockruns++;                   //Hit
@@ -725,6 +918,70 @@ bool VoiceKey::AboveThreshold(
 
 }
 
+bool VoiceKey::AboveThreshold(
+   WindowReader & reader, sampleCount start, size_t len)
+{
+   //Every test must pass.  The energy is at least 1/len, and no more than
+   //(1 + len * peak^2)/len, so the summaries may decide it without the samples.
+   if(mUseEnergy)
+      {
+         const bool energyOnly = !(mUseSignChangesLow || mUseSignChangesHigh ||
+            mUseDirectionChangesLow || mUseDirectionChangesHigh);
+         if(energyOnly && 1.0 / len > mThresholdEnergy)
+            return true;
+
+         const double peak = reader.GetPeak(start, len);
+         if((1.0 + len * peak * peak) / len < mThresholdEnergy)
+            return false;
+      }
+
+   return AboveThreshold(reader.Get(start, len), len);
+}
+
+bool VoiceKey::AboveThreshold(const float *buffer, size_t len)
+{
+   int tests =0;   //Keeps track of how many statistics surpass the threshold.
+   int testThreshold=0;  //Keeps track of the threshold.
+
+   if(mUseEnergy)
+      {
+         testThreshold++;
+         tests += (int)(WindowEnergy(buffer, len) > mThresholdEnergy);
+      }
+
+   if(mUseSignChangesLow || mUseSignChangesHigh)
+      {
+         const double sc = WindowSignChanges(buffer, len);
+         if(mUseSignChangesLow)
+            {
+               testThreshold++;
+               tests += (int)(sc < mThresholdSignChangesLower);
+            }
+         if(mUseSignChangesHigh)
+            {
+               testThreshold++;
+               tests += (int)(sc > mThresholdSignChangesUpper);
+            }
+      }
+
+   if(mUseDirectionChangesLow || mUseDirectionChangesHigh)
+      {
+         const double dc = WindowDirectionChanges(buffer, len);
+         if(mUseDirectionChangesLow)
+            {
+               testThreshold++;
+               tests += (int)(dc < mThresholdDirectionChangesLower);
+            }
+         if(mUseDirectionChangesHigh)
+            {
+               testThreshold++;
+               tests += (int)(dc > mThresholdDirectionChangesUpper);
+            }
+      }
+
+   return (tests >= testThreshold);
+}
+
 //This adjusts the threshold.  Larger values of t expand the noise region,
 //making more things be classified as noise (and requiring a stronger signal).
 void VoiceKey::AdjustThreshold(double t)
@@ -787,6 +1044,8 @@ void VoiceKey::CalibrateNoise(const WaveTrack & t, sampleCount start, sampleCoun
    auto samplesleft = len - WindowSizeInt;
    int samples=0;
 
+   WindowReader reader{ t, start, start + len, false, WindowSizeInt };
+
    for(auto i = start; samplesleft >= 10;
        i += (WindowSizeInt - 1), samplesleft -= (WindowSizeInt -1) ) {
          //Take samples chunk-by-chunk.
@@ -795,19 +1054,20 @@ void VoiceKey::CalibrateNoise(const WaveTrack & t, sampleCount start, sampleCoun
 
          samples++;          //Increment the number of samples we have
          const auto blocksize = limitSampleBufferSize( WindowSizeInt, samplesleft);
+         const float *buffer = reader.Get(i, blocksize);
 
-         erg = TestEnergy(t, i, blocksize);
+         erg = WindowEnergy(buffer, blocksize);
          sumerg +=(double)erg;
-         sumerg2 += pow((double)erg,2);
+         sumerg2 += erg * erg;
 
-         sc = TestSignChanges(t,i, blocksize);
+         sc = WindowSignChanges(buffer, blocksize);
          sumsc += (double)sc;
-         sumsc2 += pow((double)sc,2);
+         sumsc2 += sc * sc;
 
 
-         dc = TestDirectionChanges(t,i,blocksize);
+         dc = WindowDirectionChanges(buffer, blocksize);
          sumdc += (double)dc;
-         sumdc2 += pow((double)dc,2);
+         sumdc2 += dc * dc;
       }
 
    mEnergyMean = sumerg / samples;
@@ -865,10 +1125,7 @@ double VoiceKey::TestEnergy (
          t.Get((samplePtr)buffer.get(), floatSample, s,block);                      //grab the block;
 
          //Now, go through the block and calculate energy
-         for(decltype(block) i = 0; i< block; i++)
-            {
-               sum += buffer[i]*buffer[i];
-            }
+         sum += SumOfSquares(buffer.get(), block);
 
          len -= block;
          s += block;
@@ -914,16 +1171,7 @@ double VoiceKey::TestSignChanges(
          }
 
       //Now, go through the block and calculate zero crossings
-
-      for(decltype(block) i = 0; i< block; i++)
-         {
-            if( sgn(buffer[i]) != currentsign)
-               {
-                  currentsign = sgn(buffer[i]);
-                  signchanges++;
-               }
-
-         }
+      signchanges += CountSignChanges(buffer.get(), block, currentsign);
       len -= block;
       s += block;
    }
@@ -969,18 +1217,9 @@ double VoiceKey::TestDirectionChanges(
          lastval = buffer[0];
       }
 
-      //Now, go through the block and calculate zero crossings
-
-
-      for(decltype(block) i = 0; i< block; i++){
-
-         if( sgn(buffer[i]-lastval) != lastdirection) {
-            directionchanges++;
-            lastdirection = sgn(buffer[i] - lastval);
-         }
-         lastval = buffer[i];
-
-      }
+      //Now, go through the block and calculate direction changes
+      directionchanges +=
+         CountDirectionChanges(buffer.get(), block, lastval, lastdirection);
       len -= block;
       s += block;
    }
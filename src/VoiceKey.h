@@ -79,6 +79,13 @@ class VoiceKey {
    double mSilentWindowSize;           //Time in milliseconds of below-threshold windows required for silence
    double mSignalWindowSize;           //Time in milliseconds of above-threshold windows required for speech
 
+   class WindowReader;
+   //As AboveThreshold, for the windows of a scan; the summaries may decide
+   //the energy test without reading the samples
+   bool AboveThreshold(WindowReader & reader, sampleCount start, size_t len);
+   //Of samples already read
+   bool AboveThreshold(const float *buffer, size_t len);
+
    double TestEnergy (const WaveTrack & t, sampleCount start,sampleCount len);
    double TestSignChanges (
       const WaveTrack & t, sampleCount start, sampleCount len);
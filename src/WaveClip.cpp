@@ -22,6 +22,7 @@
 #include "WaveClip.h"
 
 #include <math.h>
+#include <algorithm>
 #include "MemoryX.h"
 #include <functional>
 #include <vector>
@@ -36,6 +37,7 @@
 #include "WaveTrack.h"
 #include "FFT.h"
 #include "Profiler.h"
+#include "TaskScheduler.h"
 #include "InconsistencyException.h"
 #include "UserException.h"
 
@@ -65,8 +67,10 @@ public:
    {
    }
 
-   WaveCache(size_t len_, double pixelsPerSecond, double rate_, double t0, int dirty_)
+   WaveCache(size_t len_, double pixelsPerSecond, double rate_, double t0, int dirty_,
+             sampleCount numSamples_)
       : dirty(dirty_)
+      , numSamples(numSamples_)
       , len(len_)
       , start(t0)
       , pps(pixelsPerSecond)
@@ -81,6 +85,10 @@ public:
 
       //find the number of OD pixels - the only way to do this is by recounting since we've lost some old cache.
       numODPixels = CountODPixels(0, len);
+
+      memory.Set(where.capacity() * sizeof(sampleCount) +
+         (min.capacity() + max.capacity() + rms.capacity()) * sizeof(float) +
+         bl.capacity() * sizeof(int));
    }
 
    ~WaveCache()
@@ -88,7 +96,17 @@ public:
       ClearInvalidRegions();
    }
 
+   // How many leading columns end within the first numSamples, so that
+   // appending can't change them
+   size_t CountComplete() const
+   {
+      return std::upper_bound(where.begin() + 1, where.begin() + 1 + len,
+         numSamples) - (where.begin() + 1);
+   }
+
    int          dirty;
+   // In the sequence and the append buffer, when made
+   const sampleCount numSamples { 0 };
    const size_t len { 0 }; // counts pixels, not samples
    const double start;
    const double pps;
@@ -266,6 +284,8 @@ protected:
    std::vector<InvalidRegion> mRegions;
    ODLock mRegionsMutex;
 
+private:
+   MemoryUse::Tracker memory{ MemoryUse::WaveDisplay };
 };
 
 static void ComputeSpectrumUsingRealFFTf
@@ -584,13 +604,22 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
       const bool ppsMatch = mWaveCache &&
          (fabs(tstep - 1.0 / mWaveCache->pps) * numPixels < (1.0 / mRate));
 
+      // If samples were only appended, as while recording, the columns
+      // before the old end are still good, and only the rest are computed.
+      // (A failed flush may instead lose the append buffer.)
+      const auto numSamples = mSequence->GetNumSamples() + mAppendBufferLen;
+      const bool appended = mWaveCache &&
+         mWaveCache->dirty != mDirty &&
+         mWaveCache->dirty >= mEditDirty &&
+         mWaveCache->numSamples <= numSamples;
+
       const bool match =
          mWaveCache &&
          ppsMatch &&
          mWaveCache->len > 0 &&
-         mWaveCache->dirty == mDirty;
+         (mWaveCache->dirty == mDirty || appended);
 
-      if (match &&
+      if (match && !appended &&
          mWaveCache->start == t0 &&
          mWaveCache->len >= numPixels) {
          mWaveCache->LoadInvalidRegions(mSequence.get(), true);
@@ -620,13 +649,14 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
          // For what range of pixels can data be copied?
          copyBegin = std::min<size_t>(numPixels, std::max(0, -oldX0));
          copyEnd = std::min<size_t>(numPixels, std::max(0,
-            (int)oldCache->len - oldX0
+            (int)(appended ? oldCache->CountComplete() : oldCache->len) - oldX0
          ));
       }
       if (!(copyEnd > copyBegin))
          oldCache.reset(0);
 
-      mWaveCache = std::make_unique<WaveCache>(numPixels, pixelsPerSecond, mRate, t0, mDirty);
+      mWaveCache = std::make_unique<WaveCache>(numPixels, pixelsPerSecond, mRate, t0, mDirty,
+         numSamples);
       min = &mWaveCache->min[0];
       max = &mWaveCache->max[0];
       rms = &mWaveCache->rms[0];
@@ -740,12 +770,28 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
       // Done with append buffer, now fetch the rest of the cache miss
       // from the sequence
       if (p1 > p0) {
+         // When columns span whole blocks, summarize them from a pyramid
+         // over the blocks, rather than visit every block
+         const SummaryPyramid *pPyramid = nullptr;
+         if ((where[p1] - where[p0]).as_double() >=
+             (p1 - p0) * (double)mSequence->GetMaxBlockSize()) {
+            if (!mSummaryPyramid ||
+                mSummaryPyramidDirty != mDirty ||
+                !mSummaryPyramid->IsComplete() ||
+                !mSummaryPyramid->Matches(*mSequence)) {
+               mSummaryPyramid = std::make_unique<SummaryPyramid>(*mSequence);
+               mSummaryPyramidDirty = mDirty;
+            }
+            pPyramid = mSummaryPyramid.get();
+         }
+
          if (!mSequence->GetWaveDisplay(&min[p0],
                                         &max[p0],
                                         &rms[p0],
                                         &bl[p0],
                                         p1-p0,
-                                        &where[p0]))
+                                        &where[p0],
+                                        pPyramid))
          {
             isLoadingOD=false;
             return false;
@@ -798,7 +844,7 @@ void ComputeSpectrogramGainFactors
 }
 
 bool SpecCache::Matches
-   (int dirty_, double pixelsPerSecond,
+   (int editDirty, double pixelsPerSecond,
     const SpectrogramSettings &settings, double rate) const
 {
    // Make a tolerant comparison of the pps values in this wise:
@@ -810,7 +856,7 @@ bool SpecCache::Matches
 
    return
       ppsMatch &&
-      dirty == dirty_ &&
+      dirty >= editDirty &&
       windowType == settings.windowType &&
       windowSize == settings.WindowSize() &&
       zeroPaddingFactor == settings.ZeroPaddingFactor() &&
@@ -818,6 +864,14 @@ bool SpecCache::Matches
       algorithm == settings.algorithm;
 }
 
+size_t SpecCache::CountComplete(sampleCount numSamples_) const
+{
+   // Columns are centered on where, but allow a whole window after it
+   const auto last = numSamples_ - windowSize;
+   return std::upper_bound(where.begin(), where.begin() + len, last)
+      - where.begin();
+}
+
 bool SpecCache::CalculateOneSpectrum
    (const SpectrogramSettings &settings,
     WaveTrackCache &waveTrackCache,
@@ -825,7 +879,8 @@ bool SpecCache::CalculateOneSpectrum
     double offset, double rate, double pixelsPerSecond,
     int lowerBoundX, int upperBoundX,
     const std::vector<float> &gainFactors,
-    float* __restrict scratch, float* __restrict out) const
+    float* __restrict scratch, float* __restrict out,
+    int outBeginX, int outEndX, Spill *spill) const
 {
    bool result = false;
    const bool reassignment =
@@ -937,21 +992,21 @@ bool SpecCache::CalculateOneSpectrum
          std::copy(scratch, scratch2, scratch3);
 
          {
-            const float *const window = settings.window.get();
+            const float *const window = settings.windows->window.get();
             for (size_t ii = 0; ii < fftLen; ++ii)
                scratch[ii] *= window[ii];
             RealFFTf(scratch, hFFT);
          }
 
          {
-            const float *const dWindow = settings.dWindow.get();
+            const float *const dWindow = settings.windows->dWindow.get();
             for (size_t ii = 0; ii < fftLen; ++ii)
                scratch2[ii] *= dWindow[ii];
             RealFFTf(scratch2, hFFT);
          }
 
          {
-            const float *const tWindow = settings.tWindow.get();
+            const float *const tWindow = settings.windows->tWindow.get();
             for (size_t ii = 0; ii < fftLen; ++ii)
                scratch3[ii] *= tWindow[ii];
             RealFFTf(scratch3, hFFT);
@@ -1007,13 +1062,18 @@ bool SpecCache::CalculateOneSpectrum
 
                   // This is non-negative, because bin and correctedX are
                   auto ind = (int)nBins * correctedX + bin;
+                  if (correctedX < outBeginX || correctedX >= outEndX)
+                     spill->emplace_back( ind, power );
+                  else {
+                     ind -= (int)nBins * outBeginX;
 #ifdef _OPENMP
-                  // This assignment can race if index reaches into another thread's bins.
-                  // The probability of a race very low, so this carries little overhead,
-                  // about 5% slower vs allowing it to race.
-                  #pragma omp atomic update
+                     // This assignment can race if index reaches into another thread's bins.
+                     // The probability of a race very low, so this carries little overhead,
+                     // about 5% slower vs allowing it to race.
+                     #pragma omp atomic update
 #endif
-                  out[ind] += power;
+                     out[ind] += power;
+                  }
                }
             }
          }
@@ -1030,7 +1090,7 @@ bool SpecCache::CalculateOneSpectrum
 
          // This function mutates useBuffer
          ComputeSpectrumUsingRealFFTf
-            (useBuffer, settings.hFFT.get(), settings.window.get(), fftLen, results);
+            (useBuffer, settings.hFFT.get(), settings.windows->window.get(), fftLen, results);
          if (!gainFactors.empty()) {
             // Apply a frequency-dependant gain factor
             for (size_t ii = 0; ii < nBins; ++ii)
@@ -1063,13 +1123,148 @@ void SpecCache::Grow(size_t len_, const SpectrogramSettings& settings,
    windowSize = settings.WindowSize();
    zeroPaddingFactor = settings.ZeroPaddingFactor();
    frequencyGain = settings.frequencyGain;
+
+   memory.Set(freq.capacity() * sizeof(float) +
+      where.capacity() * sizeof(sampleCount));
+}
+
+namespace {
+   // Samples in each tile of SpecColumnCache
+   const long long ColumnTileSamples = 1 << 16;
+   // Past this many values in a clip's SpecColumnCache, tiles are forgotten.
+   // With the default window, it is some thousands of columns.
+   const size_t MaxCachedColumnValues = 8 * 1024 * 1024;
+
+   long long TileOf(long long where)
+   {
+      // Round down, also for negatives
+      return where >= 0
+         ? where / ColumnTileSamples
+         : -((-where - 1) / ColumnTileSamples) - 1;
+   }
+}
+
+void SpecColumnCache::Validate(const SpectrogramSettings &settings,
+   int dirty, int editDirty, sampleCount numSamples,
+   double offset, double rate)
+{
+   const bool sameSettings =
+       mAlgorithm == settings.algorithm &&
+       mWindowType == settings.windowType &&
+       mWindowSize == settings.WindowSize() &&
+       mZeroPaddingFactor == settings.ZeroPaddingFactor() &&
+       mFrequencyGain == settings.frequencyGain &&
+       mNBins == settings.NBins() &&
+       mOffset == offset &&
+       mRate == rate;
+   if (sameSettings && mDirty == dirty)
+      return;
+
+   if (sameSettings && mDirty >= editDirty) {
+      // Only appended; a window that reached past the old end was padded
+      const auto last = (mNumSamples - mWindowSize).as_long_long();
+      for (auto iter = mTiles.begin(); iter != mTiles.end();) {
+         auto &columns = iter->second.columns;
+         const auto first = columns.upper_bound(last);
+         mNValues -= std::distance(first, columns.end()) * mNBins;
+         columns.erase(first, columns.end());
+         if (columns.empty())
+            iter = mTiles.erase(iter);
+         else
+            ++iter;
+      }
+      Account();
+      mDirty = dirty;
+      mNumSamples = numSamples;
+      return;
+   }
+
+   mTiles.clear();
+   mNValues = 0;
+   Account();
+
+   mDirty = dirty;
+   mNumSamples = numSamples;
+   mAlgorithm = settings.algorithm;
+   mWindowType = settings.windowType;
+   mWindowSize = settings.WindowSize();
+   mZeroPaddingFactor = settings.ZeroPaddingFactor();
+   mFrequencyGain = settings.frequencyGain;
+   mNBins = settings.NBins();
+   mOffset = offset;
+   mRate = rate;
+}
+
+const float *SpecColumnCache::Find(sampleCount where_, double tolerance)
+{
+   const auto where = where_.as_long_long();
+   const auto reach = (long long)tolerance;
+
+   const float *result = nullptr;
+   Tile *pResultTile = nullptr;
+   long long distance = reach + 1;
+   for (auto tile = TileOf(where - reach), last = TileOf(where + reach);
+        tile <= last; ++tile) {
+      auto iter = mTiles.find(tile);
+      if (iter == mTiles.end())
+         continue;
+      auto &columns = iter->second.columns;
+
+      // Compare the nearest column at or after, and the one before
+      auto after = columns.lower_bound(where);
+      if (after != columns.end() && after->first - where < distance) {
+         distance = after->first - where;
+         result = after->second.data();
+         pResultTile = &iter->second;
+      }
+      if (after != columns.begin()) {
+         auto before = after;
+         --before;
+         if (where - before->first < distance) {
+            distance = where - before->first;
+            result = before->second.data();
+            pResultTile = &iter->second;
+         }
+      }
+   }
+
+   if (pResultTile)
+      pResultTile->lastUse = ++mUses;
+   return result;
+}
+
+void SpecColumnCache::Store(sampleCount where_, const float *column)
+{
+   const auto where = where_.as_long_long();
+   auto &tile = mTiles[TileOf(where)];
+   tile.lastUse = ++mUses;
+   auto &values = tile.columns[where];
+   if (values.empty())
+      mNValues += mNBins;
+   values.assign(column, column + mNBins);
+
+   // Forget the least recently used tiles, but never the one just used
+   while (mNValues > MaxCachedColumnValues && mTiles.size() > 1) {
+      auto oldest = std::min_element(mTiles.begin(), mTiles.end(),
+         [](const Tiles::value_type &a, const Tiles::value_type &b){
+            return a.second.lastUse < b.second.lastUse; });
+      mNValues -= oldest->second.columns.size() * mNBins;
+      mTiles.erase(oldest);
+   }
+   Account();
+}
+
+namespace {
+   // Fewer are not worth the synchronization
+   const int MinColumnsPerThread = 16;
 }
 
 void SpecCache::Populate
    (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
     int copyBegin, int copyEnd, size_t numPixels,
     sampleCount numSamples,
-    double offset, double rate, double pixelsPerSecond)
+    double offset, double rate, double pixelsPerSecond,
+    SpecColumnCache *columns)
 {
    const int &frequencyGain = settings.frequencyGain;
    const size_t windowSize = settings.WindowSize();
@@ -1102,40 +1297,105 @@ void SpecCache::Populate
       const int lowerBoundX = jj == 0 ? 0 : copyEnd;
       const int upperBoundX = jj == 0 ? copyBegin : numPixels;
 
-#ifdef _OPENMP
-      // Storage for mutable per-thread data.
-      // private clause ensures one copy per thread
-      struct ThreadLocalStorage {
-         ThreadLocalStorage()  { }
-         ~ThreadLocalStorage() { }
-
-         void init(WaveTrackCache &waveTrackCache, size_t scratchSize) {
-            if (!cache) {
-               cache = std::make_unique<WaveTrackCache>(waveTrackCache.GetTrack());
-               scratch.resize(scratchSize);
+      const auto nColumns = std::max(0, upperBoundX - lowerBoundX);
+
+      // Take the columns already computed.  The nearest within half a pixel
+      // stands in for each, as if resampled to this zoom.  Time reassignment
+      // adds into neighboring columns, so nothing is kept for it.
+      std::vector<char> found;
+      if (columns && !reassignment) {
+         found.resize(nColumns);
+         const double tolerance = 0.5 * rate / pixelsPerSecond;
+         for (auto xx = lowerBoundX; xx < upperBoundX; ++xx) {
+            if (where[xx] < 0 || where[xx] >= numSamples)
+               continue;
+            if (auto column = columns->Find(where[xx], tolerance)) {
+               std::copy(column, column + nBins, &freq[nBins * xx]);
+               found[xx - lowerBoundX] = 1;
             }
          }
-         std::unique_ptr<WaveTrackCache> cache;
-         std::vector<float> scratch;
-      } tls;
+      }
+      const auto wanted = [&](int xx) {
+         return found.empty() || !found[xx - lowerBoundX];
+      };
 
-      #pragma omp parallel for private(tls)
-#endif
-      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
-      {
-#ifdef _OPENMP
-         tls.init(waveTrackCache, scratchSize);
-         WaveTrackCache& cache = *tls.cache;
-         float* buffer = &tls.scratch[0];
-#else
-         WaveTrackCache& cache = waveTrackCache;
-         float* buffer = &scratch[0];
-#endif
-         CalculateOneSpectrum(
-            settings, cache, xx, numSamples,
-            offset, rate, pixelsPerSecond,
-            lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
+      // Each range of columns gets its own track cache and FFT scratch.
+      // Time reassignment adds into other columns, so there each range also
+      // gets its own sums, for its columns and the neighbors that a window
+      // overlaps.
+      const size_t nRanges =
+         std::min<size_t>(nColumns / MinColumnsPerThread,
+                          TaskScheduler::Get().GetConcurrency());
+      if (nRanges <= 1) {
+         for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
+            if (wanted(xx))
+               CalculateOneSpectrum(
+                  settings, waveTrackCache, xx, numSamples,
+                  offset, rate, pixelsPerSecond,
+                  lowerBoundX, upperBoundX,
+                  gainFactors, &scratch[0], &freq[0]);
+      }
+      else if (reassignment) {
+         const int margin =
+            (int)ceil(fftLen * pixelsPerSecond / rate) + 1;
+         struct Part {
+            int beginX, endX;
+            std::vector<float> sums;
+            Spill spill;
+         };
+         std::vector<Part> parts(nRanges);
+
+         const auto pTrack = waveTrackCache.GetSharedTrack();
+         TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, nRanges, [&](size_t ii) {
+            const int begin = lowerBoundX + nColumns * ii / nRanges;
+            const int end = lowerBoundX + nColumns * (ii + 1) / nRanges;
+            auto &part = parts[ii];
+            part.beginX = std::max(lowerBoundX, begin - margin);
+            part.endX = std::min(upperBoundX, end + margin);
+            part.sums.assign(nBins * (part.endX - part.beginX), 0.0f);
+            WaveTrackCache cache{ pTrack, 2 };
+            std::vector<float> myScratch(scratchSize);
+            for (auto xx = begin; xx < end; ++xx)
+               CalculateOneSpectrum(
+                  settings, cache, xx, numSamples,
+                  offset, rate, pixelsPerSecond,
+                  lowerBoundX, upperBoundX,
+                  gainFactors, &myScratch[0], &part.sums[0],
+                  part.beginX, part.endX, &part.spill);
+         });
+
+         // Add up the parts in order, so that the result does not depend
+         // on the threads
+         for (const auto &part : parts) {
+            float *const dest = &freq[nBins * part.beginX];
+            for (size_t ii = 0, nn = part.sums.size(); ii < nn; ++ii)
+               dest[ii] += part.sums[ii];
+            for (const auto &spilled : part.spill)
+               freq[spilled.first] += spilled.second;
+         }
+      }
+      else {
+         const auto pTrack = waveTrackCache.GetSharedTrack();
+         TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, nRanges, [&](size_t ii) {
+            const int begin = lowerBoundX + nColumns * ii / nRanges;
+            const int end = lowerBoundX + nColumns * (ii + 1) / nRanges;
+            // A window may straddle two blocks, so two buffers suffice
+            WaveTrackCache cache{ pTrack, 2 };
+            std::vector<float> myScratch(scratchSize);
+            for (auto xx = begin; xx < end; ++xx)
+               if (wanted(xx))
+                  CalculateOneSpectrum(
+                     settings, cache, xx, numSamples,
+                     offset, rate, pixelsPerSecond,
+                     lowerBoundX, upperBoundX,
+                     gainFactors, &myScratch[0], &freq[0]);
+         });
+      }
+
+      if (!found.empty()) {
+         for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
+            if (wanted(xx) && where[xx] >= 0 && where[xx] < numSamples)
+               columns->Store(where[xx], &freq[nBins * xx]);
       }
 
       if (reassignment) {
@@ -1172,9 +1432,6 @@ void SpecCache::Populate
 
          // Now Convert to dB terms.  Do this only after accumulating
          // power values, which may cross columns with the time correction.
-#ifdef _OPENMP
-         #pragma omp parallel for
-#endif
          for (auto xx = lowerBoundX; xx < upperBoundX; ++xx) {
             float *const results = &freq[nBins * xx];
             for (size_t ii = 0; ii < nBins; ++ii) {
@@ -1207,9 +1464,12 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
       mSpecCache &&
       mSpecCache->len > 0 &&
       mSpecCache->Matches
-      (mDirty, pixelsPerSecond, settings, mRate);
+      (mEditDirty, pixelsPerSecond, settings, mRate);
+   // If samples were only appended, as while recording, the columns
+   // before the old end are still good, and only the rest are computed
+   const bool appended = match && mSpecCache->dirty != mDirty;
 
-   if (match &&
+   if (match && !appended &&
        mSpecCache->start == t0 &&
        mSpecCache->len >= numPixels) {
       spectrogram = &mSpecCache->freq[0];
@@ -1251,7 +1511,9 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
       // For what range of pixels can data be copied?
       copyBegin = std::min((int)numPixels, std::max(0, -oldX0));
       copyEnd = std::min((int)numPixels, std::max(0,
-         (int)mSpecCache->len - oldX0
+         (int)(appended
+            ? mSpecCache->CountComplete(mSpecCache->numSamples)
+            : mSpecCache->len) - oldX0
       ));
    }
 
@@ -1293,18 +1555,83 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
    fillWhere(mSpecCache->where, numPixels, 0.5, correction,
       t0, mRate, samplesPerPixel);
 
+   if (!mSpecColumns)
+      mSpecColumns = std::make_unique<SpecColumnCache>();
+   const auto numSamples = mSequence->GetNumSamples();
+   mSpecColumns->Validate(settings, mDirty, mEditDirty, numSamples,
+      mOffset, mRate);
+
    mSpecCache->Populate
       (settings, waveTrackCache, copyBegin, copyEnd, numPixels,
-       mSequence->GetNumSamples(),
-       mOffset, mRate, pixelsPerSecond);
+       numSamples,
+       mOffset, mRate, pixelsPerSecond, mSpecColumns.get());
 
    mSpecCache->dirty = mDirty;
+   mSpecCache->numSamples = numSamples;
    spectrogram = &mSpecCache->freq[0];
    where = &mSpecCache->where[0];
 
    return true;
 }
 
+bool WaveClip::AccumulateCachedSpectrum(const SpectrogramSettings &settings,
+   double t0, double t1,
+   std::vector<double> &powers, size_t &count) const
+{
+   const auto nBins = settings.NBins();
+   if (!mSpecCache ||
+       mSpecCache->len < 2 ||
+       mSpecCache->dirty != mDirty ||
+       settings.algorithm != SpectrogramSettings::algSpectrum ||
+       mSpecCache->algorithm != settings.algorithm ||
+       mSpecCache->windowType != settings.windowType ||
+       mSpecCache->windowSize != settings.WindowSize() ||
+       mSpecCache->zeroPaddingFactor != settings.ZeroPaddingFactor() ||
+       mSpecCache->frequencyGain != settings.frequencyGain ||
+       powers.size() != nBins)
+      return false;
+
+   const auto numSamples = mSequence->GetNumSamples();
+   const auto s0 = std::max(sampleCount{ 0 },
+      sampleCount( floor( (t0 - mOffset) * mRate + 0.5 ) ));
+   const auto s1 = std::min(numSamples,
+      sampleCount( floor( (t1 - mOffset) * mRate + 0.5 ) ));
+   if (s1 <= s0)
+      // The range misses this clip
+      return true;
+
+   // The columns must reach the ends of the range, to within one of them
+   const auto &where = mSpecCache->where;
+   const auto len = mSpecCache->len;
+   const auto spacing = where[1] - where[0];
+   if (where[0] > s0 + spacing || where[len - 1] + spacing < s1)
+      return false;
+
+   const auto first = std::lower_bound(where.begin(), where.begin() + len, s0)
+      - where.begin();
+   const auto last = std::lower_bound(where.begin(), where.begin() + len, s1)
+      - where.begin();
+   if (last <= first)
+      return false;
+
+   // Undo the gain for display before adding powers
+   std::vector<float> gainFactors;
+   ComputeSpectrogramGainFactors(
+      settings.GetFFTLength(), mRate, settings.frequencyGain, gainFactors);
+
+   for (auto xx = first; xx < last; ++xx) {
+      const float *const column = &mSpecCache->freq[nBins * xx];
+      for (size_t ii = 0; ii < nBins; ++ii) {
+         auto dB = column[ii];
+         if (!gainFactors.empty())
+            dB -= gainFactors[ii];
+         powers[ii] += pow(10.0, dB / 10.0);
+      }
+   }
+   count += last - first;
+   return true;
+}
+
 std::pair<float, float> WaveClip::GetMinMax(
    double t0, double t1, bool mayThrow) const
 {
@@ -1347,6 +1674,25 @@ float WaveClip::GetRMS(double t0, double t1, bool mayThrow) const
    return mSequence->GetRMS(s0, s1-s0, mayThrow);
 }
 
+double WaveClip::GetSum(double t0, double t1, bool mayThrow) const
+{
+   if (t0 > t1) {
+      if (mayThrow)
+         THROW_INCONSISTENCY_EXCEPTION;
+      return 0.0;
+   }
+
+   if (t0 == t1)
+      return 0.0;
+
+   sampleCount s0, s1;
+
+   TimeToSamplesClip(t0, &s0);
+   TimeToSamplesClip(t1, &s1);
+
+   return mSequence->GetSum(s0, s1-s0, mayThrow);
+}
+
 void WaveClip::ConvertToSampleFormat(sampleFormat format)
 {
    // Note:  it is not necessary to do this recursively to cutlines.
@@ -1409,7 +1755,7 @@ void WaveClip::Append(samplePtr buffer, sampleFormat format,
    auto cleanup = finally( [&] {
       // use NOFAIL-GUARANTEE
       UpdateEnvelopeTrackLen();
-      MarkChanged();
+      MarkAppended();
    } );
 
    for(;;) {
@@ -1456,7 +1802,20 @@ void WaveClip::AppendAlias(const wxString &fName, sampleCount start,
 
    // use NOFAIL-GUARANTEE
    UpdateEnvelopeTrackLen();
-   MarkChanged();
+   MarkAppended();
+}
+
+void WaveClip::AppendAlias(const wxString &fName, sampleCount start,
+                            size_t len, int channel,
+                            samplePtr buffer, sampleFormat format)
+// STRONG-GUARANTEE
+{
+   // use STRONG-GUARANTEE
+   mSequence->AppendAlias(fName, start, len, channel, buffer, format);
+
+   // use NOFAIL-GUARANTEE
+   UpdateEnvelopeTrackLen();
+   MarkAppended();
 }
 
 void WaveClip::AppendCoded(const wxString &fName, sampleCount start,
@@ -1468,7 +1827,20 @@ void WaveClip::AppendCoded(const wxString &fName, sampleCount start,
 
    // use NOFAIL-GUARANTEE
    UpdateEnvelopeTrackLen();
-   MarkChanged();
+   MarkAppended();
+}
+
+void WaveClip::AppendBlockFile(const BlockFilePtr &blockFile)
+// STRONG-GUARANTEE
+{
+   wxASSERT(mAppendBufferLen == 0);
+
+   // use STRONG-GUARANTEE
+   mSequence->AppendNewBlockFile(blockFile);
+
+   // use NOFAIL-GUARANTEE
+   UpdateEnvelopeTrackLen();
+   MarkAppended();
 }
 
 void WaveClip::Flush()
@@ -1490,7 +1862,7 @@ void WaveClip::Flush()
          // Use NOFAIL-GUARANTEE of these steps.
          mAppendBufferLen = 0;
          UpdateEnvelopeTrackLen();
-         MarkChanged();
+         MarkAppended();
       } );
 
       mSequence->Append(mAppendBuffer.ptr(), mSequence->GetSampleFormat(),
@@ -1873,6 +2245,16 @@ void WaveClip::Lock()
       cutline->Lock();
 }
 
+bool WaveClip::AdoptBorrowedBlocks()
+{
+   bool adopted = GetSequence()->AdoptBorrowedBlocks();
+   for (const auto &cutline: mCutLines)
+      adopted = cutline->AdoptBorrowedBlocks() || adopted;
+   if (adopted)
+      MarkChanged();
+   return adopted;
+}
+
 void WaveClip::CloseLock()
 {
    GetSequence()->CloseLock();
@@ -1967,17 +2349,22 @@ void WaveClip::Resample(int rate, ProgressDialog *progress)
          _("Resampling failed.")
       };
    else
-   {
-      // Use NOFAIL-GUARANTEE in these steps
+      SetResampledSequence(std::move(newSequence), rate);
+}
 
-      // Invalidate wave display cache
-      mWaveCache = std::make_unique<WaveCache>();
-      // Invalidate the spectrum display cache
-      mSpecCache = std::make_unique<SpecCache>();
+void WaveClip::SetResampledSequence(std::unique_ptr<Sequence> &&sequence,
+                                    int rate)
+// NOFAIL-GUARANTEE
+{
+   // Invalidate wave display cache
+   mWaveCache = std::make_unique<WaveCache>();
+   // Invalidate the spectrum display cache
+   mSpecCache = std::make_unique<SpecCache>();
+   mSpecColumns.reset();
 
-      mSequence = std::move(newSequence);
-      mRate = rate;
-   }
+   mSequence = std::move(sequence);
+   mRate = rate;
+   MarkChanged();
 }
 
 // Used by commands which interact with clips using the keyboard.
@@ -1993,3 +2380,21 @@ bool WaveClip::SharesBoundaryWithNextClip(const WaveClip* next) const
    // of half a sample should be safe in all normal usage.
    return fabs(startNext - endThis) < 0.5;
 }
+
+bool WaveClip::IsEquivalent(const WaveClip &other) const
+{
+   if (mOffset != other.mOffset ||
+       mRate != other.mRate ||
+       mColourIndex != other.mColourIndex ||
+       mIsPlaceholder != other.mIsPlaceholder ||
+       mCutLines.size() != other.mCutLines.size() ||
+       !mSequence->SharesBlocks(*other.mSequence) ||
+       !mEnvelope->IsEquivalent(*other.mEnvelope))
+      return false;
+
+   for (size_t ii = 0, nn = mCutLines.size(); ii < nn; ++ii)
+      if (!mCutLines[ii]->IsEquivalent(*other.mCutLines[ii]))
+         return false;
+
+   return true;
+}
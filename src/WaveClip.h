@@ -14,6 +14,7 @@
 
 #include "Audacity.h"
 #include "MemoryX.h"
+#include "MemoryUse.h"
 #include "SampleFormat.h"
 #include "widgets/ProgressDialog.h"
 #include "ondemand/ODTaskThread.h"
@@ -22,19 +23,29 @@
 #include "Experimental.h"
 #include "RealFFTf.h"
 
+#include <wx/bitmap.h>
 #include <wx/gdicmn.h>
 #include <wx/longlong.h>
 
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class BlockArray;
+class BlockFile;
+using BlockFilePtr = std::shared_ptr<BlockFile>;
 class DirManager;
 class Envelope;
 class Sequence;
 class SpectrogramSettings;
+class SummaryPyramid;
 class WaveCache;
 class WaveTrackCache;
 
+class SpecColumnCache;
+
 class SpecCache {
 public:
 
@@ -53,10 +64,22 @@ public:
    {
    }
 
-   bool Matches(int dirty_, double pixelsPerSecond,
+   // Whether the columns were computed with these settings, and from the
+   // samples now in the clip, except for any appended since
+   bool Matches(int editDirty, double pixelsPerSecond,
       const SpectrogramSettings &settings, double rate) const;
 
-   // Calculate one column of the spectrum
+   // How many leading columns have windows within the first numSamples, so
+   // that appending can't change them
+   size_t CountComplete(sampleCount numSamples) const;
+
+   // Reassigned power that lands outside of the columns of a buffer, as
+   // indices into freq, and amounts
+   using Spill = std::vector< std::pair< size_t, float > >;
+
+   // Calculate one column of the spectrum.  Time reassignment adds into
+   // columns outBeginX to outEndX of out, which starts at column outBeginX,
+   // and adds to spill for other columns between the bounds.
    bool CalculateOneSpectrum
       (const SpectrogramSettings &settings,
        WaveTrackCache &waveTrackCache,
@@ -65,18 +88,23 @@ public:
        int lowerBoundX, int upperBoundX,
        const std::vector<float> &gainFactors,
        float* __restrict scratch,
-       float* __restrict out) const;
+       float* __restrict out,
+       int outBeginX = 0,
+       int outEndX = std::numeric_limits<int>::max(),
+       Spill *spill = nullptr) const;
 
    // Grow the cache while preserving the (possibly now invalid!) contents
    void Grow(size_t len_, const SpectrogramSettings& settings,
                double pixelsPerSecond, double start_);
 
-   // Calculate the dirty columns at the begin and end of the cache
+   // Calculate the dirty columns at the begin and end of the cache,
+   // taking what columns it can from columns, and adding the others to it
    void Populate
       (const SpectrogramSettings &settings, WaveTrackCache &waveTrackCache,
        int copyBegin, int copyEnd, size_t numPixels,
        sampleCount numSamples,
-       double offset, double rate, double pixelsPerSecond);
+       double offset, double rate, double pixelsPerSecond,
+       SpecColumnCache *columns = nullptr);
 
    size_t       len { 0 }; // counts pixels, not samples
    int          algorithm;
@@ -90,6 +118,56 @@ public:
    std::vector<sampleCount> where;
 
    int          dirty;
+   sampleCount  numSamples { 0 }; // in the sequence, when computed
+
+private:
+   MemoryUse::Tracker memory{ MemoryUse::Spectrograms };
+};
+
+// Spectrum columns kept by the sample at the center of their windows, not by
+// pixel, so that they can be found again after zooming, or scrolling away and
+// back.  They are grouped in tiles of samples, and the least recently used
+// tiles are forgotten when there are too many.
+class SpecColumnCache {
+public:
+   // Forget all columns, unless computed with the same settings, from the
+   // same samples; if samples were only appended since, forget just the
+   // columns whose windows reached past the old end
+   void Validate(const SpectrogramSettings &settings, int dirty,
+      int editDirty, sampleCount numSamples, double offset, double rate);
+
+   // The column centered nearest to where, or null if none is within
+   // tolerance samples
+   const float *Find(sampleCount where, double tolerance);
+
+   void Store(sampleCount where, const float *column);
+
+private:
+   void Account() { mMemory.Set(mNValues * sizeof(float)); }
+
+   using Columns = std::map< long long, std::vector<float> >;
+   struct Tile {
+      Columns columns;
+      unsigned long long lastUse { 0 };
+   };
+
+   using Tiles = std::unordered_map< long long, Tile >;
+   Tiles mTiles;
+   size_t mNValues { 0 };
+   unsigned long long mUses { 0 };
+
+   size_t mNBins { 0 };
+   int mDirty { -1 };
+   sampleCount mNumSamples { 0 };
+   int mAlgorithm { -1 };
+   int mWindowType { -1 };
+   size_t mWindowSize { 0 };
+   unsigned mZeroPaddingFactor { 0 };
+   int mFrequencyGain { -1 };
+   double mOffset { 0 };
+   double mRate { 0 };
+
+   MemoryUse::Tracker mMemory{ MemoryUse::Spectrograms };
 };
 
 class SpecPxCache {
@@ -102,6 +180,7 @@ public:
       scaleType = 0;
       range = gain = -1;
       minFreq = maxFreq = -1;
+      memory.Set(len * sizeof(float));
    }
 
    size_t  len;
@@ -113,6 +192,36 @@ public:
    int gain;
    int minFreq;
    int maxFreq;
+
+   // What else the colors of the last drawn image depended on
+   struct ImageParameters {
+      int leftOffset, hiddenLeftOffset, width, height;
+      double h, pps, tOffset;
+      sampleCount ssel0, ssel1;
+      double freqLo, freqHi;
+      bool isSpectral, isGrayscale;
+      unsigned gradientVersion;
+
+      bool operator== (const ImageParameters &other) const
+      {
+         return leftOffset == other.leftOffset &&
+            hiddenLeftOffset == other.hiddenLeftOffset &&
+            width == other.width && height == other.height &&
+            h == other.h && pps == other.pps && tOffset == other.tOffset &&
+            ssel0 == other.ssel0 && ssel1 == other.ssel1 &&
+            freqLo == other.freqLo && freqHi == other.freqHi &&
+            isSpectral == other.isSpectral &&
+            isGrayscale == other.isGrayscale &&
+            gradientVersion == other.gradientVersion;
+      }
+   };
+   // Reused while the values and the parameters are unchanged, so that
+   // repainting for other reasons need not color and convert the image again
+   wxBitmap bitmap;
+   ImageParameters imageParameters;
+
+private:
+   MemoryUse::Tracker memory{ MemoryUse::Spectrograms };
 };
 
 class WaveClip;
@@ -216,6 +325,10 @@ public:
    // the length of the clip
    void Resample(int rate, ProgressDialog *progress = NULL);
 
+   // Take samples already resampled to the rate, as Resample() would
+   // compute them.  NOFAIL-GUARANTEE
+   void SetResampledSequence(std::unique_ptr<Sequence> &&sequence, int rate);
+
    void SetColourIndex( int index ){ mColourIndex = index;};
    int GetColourIndex( ) const { return mColourIndex;};
    void SetOffset(double offset);
@@ -248,12 +361,22 @@ public:
    // but use more high-level functions inside WaveClip (or add them if you
    // think they are useful for general use)
    Sequence* GetSequence() { return mSequence.get(); }
+   const Sequence* GetSequence() const { return mSequence.get(); }
 
    /** WaveTrack calls this whenever data in the wave clip changes. It is
     * called automatically when WaveClip has a chance to know that something
     * has changed, like when member functions SetSamples() etc. are called. */
    void MarkChanged() // NOFAIL-GUARANTEE
-      { mDirty++; }
+      { mEditDirty = ++mDirty; }
+
+   /** Like MarkChanged(), but when samples were only added at the end, so
+    * that the display caches may keep what they computed before, as they
+    * do while recording. */
+   void MarkAppended() // NOFAIL-GUARANTEE
+      { ++mDirty; }
+
+   // Changes whenever the samples do
+   int GetDirty() const { return mDirty; }
 
    /** Getting high-level data for screen display and clipping
     * calculations and Contrast */
@@ -264,9 +387,19 @@ public:
                        const sampleCount *& where,
                        size_t numPixels,
                        double t0, double pixelsPerSecond) const;
+   // Add into powers, for each frequency bin, the powers of the spectrum
+   // columns already computed for display whose windows center between
+   // times t0 and t1, and add their number to count.  False, and nothing
+   // added, unless such columns cover the part of the clip in the range,
+   // and were computed from the present samples with the plain spectrum
+   // algorithm and these settings.
+   bool AccumulateCachedSpectrum(const SpectrogramSettings &settings,
+      double t0, double t1,
+      std::vector<double> &powers, size_t &count) const;
    std::pair<float, float> GetMinMax(
       double t0, double t1, bool mayThrow = true) const;
    float GetRMS(double t0, double t1, bool mayThrow = true) const;
+   double GetSum(double t0, double t1, bool mayThrow = true) const;
 
    // Set/clear/get rectangle that this WaveClip fills on screen. This is
    // called by TrackArtist while actually drawing the tracks and clips.
@@ -289,9 +422,18 @@ public:
    void AppendAlias(const wxString &fName, sampleCount start,
                     size_t len, int channel,bool useOD);
 
+   /// The samples were just read from the aliased file, to summarize
+   void AppendAlias(const wxString &fName, sampleCount start,
+                    size_t len, int channel,
+                    samplePtr buffer, sampleFormat format);
+
    void AppendCoded(const wxString &fName, sampleCount start,
                             size_t len, int channel, int decodeType);
 
+   /// Appends a block file made by the caller, in the format of the
+   /// sequence, after anything appended before has been flushed
+   void AppendBlockFile(const BlockFilePtr &blockFile);
+
    /// This name is consistent with WaveTrack::Clear. It performs a "Cut"
    /// operation (but without putting the cutted audio to the clipboard)
    void Clear(double t0, double t1);
@@ -342,6 +484,10 @@ public:
    void CloseLock(); //similar to Lock but should be called when the project closes.
    // not balanced by unlocking calls.
 
+   /// Copy into the project the records that blockfiles, also of cutlines,
+   /// borrow from other projects; returns whether there were any
+   bool AdoptBorrowedBlocks();
+
    ///Delete the wave cache - force redraw.  Thread-safe
    void ClearWaveCache();
 
@@ -364,6 +510,10 @@ public:
    // used by commands which interact with clips using the keyboard
    bool SharesBoundaryWithNextClip(const WaveClip* next) const;
 
+   // Whether a copy of the other would be the same as a copy of this clip,
+   // comparing block files by identity, and including cut lines
+   bool IsEquivalent(const WaveClip &other) const;
+
 public:
    // Cache of values to colour pixels of Spectrogram - used by TrackArtist
    mutable std::unique_ptr<SpecPxCache> mSpecPxCache;
@@ -374,6 +524,8 @@ protected:
    double mOffset { 0 };
    int mRate;
    int mDirty { 0 };
+   // The value of mDirty after the last change that was not an append
+   int mEditDirty { 0 };
    int mColourIndex;
 
    std::unique_ptr<Sequence> mSequence;
@@ -381,7 +533,11 @@ protected:
 
    mutable std::unique_ptr<WaveCache> mWaveCache;
    mutable ODLock       mWaveCacheMutex {};
+   // For the most zoomed out displays; rebuilt when dirty
+   mutable std::unique_ptr<SummaryPyramid> mSummaryPyramid;
+   mutable int          mSummaryPyramidDirty { 0 };
    mutable std::unique_ptr<SpecCache> mSpecCache;
+   mutable std::unique_ptr<SpecColumnCache> mSpecColumns;
    SampleBuffer  mAppendBuffer {};
    size_t        mAppendBufferLen { 0 };
 
@@ -35,6 +35,9 @@ Track classes.
 #include <float.h>
 #include <math.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include "MemoryX.h"
 
 #include "float_cast.h"
@@ -47,6 +50,7 @@ Track classes.
 #include "Internat.h"
 
 #include "AudioIO.h"
+#include "BlockReadBatch.h"
 #include "Prefs.h"
 
 #include "ondemand/ODManager.h"
@@ -77,6 +81,10 @@ WaveTrack::Holder TrackFactory::DuplicateWaveTrack(const WaveTrack &orig)
 
 WaveTrack::Holder TrackFactory::NewWaveTrack(sampleFormat format, double rate)
 {
+   // Tracks read the preferences when made, and files importing at once
+   // make them on several threads
+   static std::mutex mutex;
+   std::lock_guard<std::mutex> lock{ mutex };
    return std::unique_ptr<WaveTrack>
    { safenew WaveTrack(mDirManager, format, rate) };
 }
@@ -122,6 +130,11 @@ WaveTrack::WaveTrack(const std::shared_ptr<DirManager> &projDirManager, sampleFo
 }
 
 WaveTrack::WaveTrack(const WaveTrack &orig):
+   WaveTrack{ orig, nullptr }
+{
+}
+
+WaveTrack::WaveTrack(const WaveTrack &orig, const WaveTrack *pPrevious):
    PlayableTrack(orig)
    , mpSpectrumSettings(orig.mpSpectrumSettings
       ? std::make_unique<SpectrogramSettings>(*orig.mpSpectrumSettings)
@@ -136,12 +149,25 @@ WaveTrack::WaveTrack(const WaveTrack &orig):
    mLastdBRange = -1;
 
    mLegacyProjectFileOffset = 0;
+   mAutoSaveIdent = 0;
 
    Init(orig);
 
-   for (const auto &clip : orig.mClips)
-      mClips.push_back
-         ( std::make_unique<WaveClip>( *clip, mDirManager, true ) );
+   if (pPrevious && pPrevious->mDirManager != mDirManager)
+      pPrevious = nullptr;
+
+   for (size_t ii = 0, nn = orig.mClips.size(); ii < nn; ++ii) {
+      const auto &clip = orig.mClips[ii];
+      WaveClipHolder shared;
+      if (pPrevious)
+         shared = pPrevious->FindEquivalentClip(*clip, ii);
+
+      if (shared)
+         mClips.push_back(std::move(shared));
+      else
+         mClips.push_back
+            ( std::make_unique<WaveClip>( *clip, mDirManager, true ) );
+   }
 }
 
 // Copy the track metadata but not the contents.
@@ -395,6 +421,28 @@ Track::Holder WaveTrack::Duplicate() const
    return Track::Holder{ safenew WaveTrack{ *this } };
 }
 
+WaveClipHolder WaveTrack::FindEquivalentClip(
+   const WaveClip &clip, size_t index) const
+{
+   // Usually the clip is at the same index as before
+   if (index < mClips.size() && clip.IsEquivalent(*mClips[index]))
+      return mClips[index];
+
+   auto end = mClips.end();
+   auto it = std::find_if(mClips.begin(), end,
+      [&](const WaveClipHolder &other){ return clip.IsEquivalent(*other); });
+   if (it != end)
+      return *it;
+
+   return {};
+}
+
+Track::Holder WaveTrack::DuplicateSharing(const Track &previous) const
+{
+   return Track::Holder{ safenew WaveTrack{ *this,
+      dynamic_cast<const WaveTrack*>(&previous) } };
+}
+
 double WaveTrack::GetRate() const
 {
    return mRate;
@@ -1572,6 +1620,15 @@ void WaveTrack::AppendAlias(const wxString &fName, sampleCount start,
    RightmostOrNewClip()->AppendAlias(fName, start, len, channel, useOD);
 }
 
+void WaveTrack::AppendAlias(const wxString &fName, sampleCount start,
+                            size_t len, int channel,
+                            samplePtr buffer, sampleFormat format)
+// STRONG-GUARANTEE
+{
+   RightmostOrNewClip()->AppendAlias(fName, start, len, channel,
+                                     buffer, format);
+}
+
 void WaveTrack::AppendCoded(const wxString &fName, sampleCount start,
                             size_t len, int channel, int decodeType)
 // STRONG-GUARANTEE
@@ -1579,6 +1636,12 @@ void WaveTrack::AppendCoded(const wxString &fName, sampleCount start,
    RightmostOrNewClip()->AppendCoded(fName, start, len, channel, decodeType);
 }
 
+void WaveTrack::AppendBlockFile(const BlockFilePtr &blockFile)
+// STRONG-GUARANTEE
+{
+   RightmostOrNewClip()->AppendBlockFile(blockFile);
+}
+
 ///gets an int with OD flags so that we can determine which ODTasks should be run on this track after save/open, etc.
 unsigned int WaveTrack::GetODFlags() const
 {
@@ -1780,6 +1843,14 @@ XMLTagHandler *WaveTrack::HandleXMLChild(const wxChar *tag)
 
 void WaveTrack::WriteXML(XMLWriter &xmlFile) const
 // may throw
+{
+   WriteXML(xmlFile, [&](const WaveClip &clip, size_t){
+      clip.WriteXML(xmlFile);
+   });
+}
+
+void WaveTrack::WriteXML(XMLWriter &xmlFile, const ClipWriter &clipWriter) const
+// may throw
 {
    xmlFile.StartTag(wxT("wavetrack"));
    if (mAutoSaveIdent)
@@ -1798,9 +1869,9 @@ void WaveTrack::WriteXML(XMLWriter &xmlFile) const
    xmlFile.WriteAttr(wxT("pan"), (double)mPan);
    xmlFile.WriteAttr(wxT("colorindex"), mWaveColorIndex );
 
-   for (const auto &clip : mClips)
+   for (size_t ii = 0, nn = mClips.size(); ii < nn; ++ii)
    {
-      clip->WriteXML(xmlFile);
+      clipWriter(*mClips[ii], ii);
    }
 
    xmlFile.EndTag(wxT("wavetrack"));
@@ -1823,6 +1894,14 @@ bool WaveTrack::Lock() const
    return true;
 }
 
+bool WaveTrack::AdoptBorrowedBlocks()
+{
+   bool adopted = false;
+   for (const auto &clip : mClips)
+      adopted = clip->AdoptBorrowedBlocks() || adopted;
+   return adopted;
+}
+
 bool WaveTrack::CloseLock()
 {
    for (const auto &clip : mClips)
@@ -1968,6 +2047,71 @@ float WaveTrack::GetRMS(double t0, double t1, bool mayThrow) const
    return length > 0 ? sqrt(sumsq / length.as_double()) : 0.0;
 }
 
+float WaveTrack::GetMean(double t0, double t1, bool mayThrow) const
+{
+   if (t0 > t1) {
+      if (mayThrow)
+         THROW_INCONSISTENCY_EXCEPTION;
+      return 0.f;
+   }
+
+   if (t0 == t1)
+      return 0.f;
+
+   double sum = 0.0;
+   sampleCount length = 0;
+
+   for (const auto &clip: mClips)
+   {
+      if (t1 >= clip->GetStartTime() && t0 <= clip->GetEndTime())
+      {
+         sampleCount clipStart, clipEnd;
+
+         sum += clip->GetSum(t0, t1, mayThrow);
+
+         clip->TimeToSamplesClip(wxMax(t0, clip->GetStartTime()), &clipStart);
+         clip->TimeToSamplesClip(wxMin(t1, clip->GetEndTime()), &clipEnd);
+         length += (clipEnd - clipStart);
+      }
+   }
+   return length > 0 ? sum / length.as_double() : 0.0;
+}
+
+void WaveTrack::CollectBlockFiles(double t0, double t1,
+   std::vector< std::weak_ptr<BlockFile> > &files) const
+{
+   for (const auto &clip: mClips)
+   {
+      if (t1 > clip->GetStartTime() && t0 < clip->GetEndTime())
+      {
+         sampleCount clipStart, clipEnd;
+         clip->TimeToSamplesClip(t0, &clipStart);
+         clip->TimeToSamplesClip(t1, &clipEnd);
+         clip->GetSequence()->CollectBlockFiles(
+            clipStart, clipEnd - clipStart, files);
+      }
+   }
+}
+
+void WaveTrack::GetPeakGroups(sampleCount start, size_t len,
+   std::vector<Sequence::PeakGroup> &groups) const
+{
+   // Clips don't overlap, so taking them in order keeps the groups in order
+   for (const auto clip: SortedClipArray())
+   {
+      const auto clipStart = clip->GetStartSample();
+      const auto clipEnd = clip->GetEndSample();
+      if (clipEnd > start && clipStart < start + len)
+      {
+         const auto first = groups.size();
+         clip->GetSequence()->GetPeakGroups(
+            start - clipStart, len, groups);
+         for (auto ii = first, nn = groups.size(); ii < nn; ++ii)
+            groups[ii].start += clipStart;
+      }
+   }
+}
+
 bool WaveTrack::Get(samplePtr buffer, sampleFormat format,
                     sampleCount start, size_t len, fillFormat fill,
                     bool mayThrow, sampleCount * pNumCopied) const
@@ -2094,6 +2238,18 @@ void WaveTrack::Set(samplePtr buffer, sampleFormat format,
 
 void WaveTrack::GetEnvelopeValues(double *buffer, size_t bufferLen,
                                   double t0) const
+{
+   DoGetEnvelopeValues(buffer, bufferLen, t0);
+}
+
+void WaveTrack::GetEnvelopeValues(float *buffer, size_t bufferLen,
+                                  double t0) const
+{
+   DoGetEnvelopeValues(buffer, bufferLen, t0);
+}
+
+template< typename Value > void WaveTrack::DoGetEnvelopeValues
+   (Value *buffer, size_t bufferLen, double t0) const
 {
    // The output buffer corresponds to an unbroken span of time which the callers expect
    // to be fully valid.  As clips are processed below, the output buffer is updated with
@@ -2549,12 +2705,19 @@ void WaveTrack::MergeClips(int clipidx1, int clipidx2)
    mClips.erase(it);
 }
 
-void WaveTrack::Resample(int rate, ProgressDialog *progress)
+void WaveTrack::Resample(int rate, ProgressDialog *progress,
+                         const ResampledSequenceFunction &getResampled)
 // WEAK-GUARANTEE
 // Partial completion may leave clips at differing sample rates!
 {
-   for (const auto &clip : mClips)
-      clip->Resample(rate, progress);
+   for (const auto &clip : mClips) {
+      auto sequence = getResampled
+         ? getResampled(*clip) : std::unique_ptr<Sequence>{};
+      if (sequence)
+         clip->SetResampledSequence(std::move(sequence), rate);
+      else
+         clip->Resample(rate, progress);
+   }
 
    mRate = rate;
 }
@@ -2607,187 +2770,284 @@ void WaveTrack::SetAutoSaveIdent(int ident)
    mAutoSaveIdent = ident;
 }
 
+namespace {
+   std::atomic<unsigned long long> sCacheHits{ 0 };
+   std::atomic<unsigned long long> sCacheMisses{ 0 };
+   std::atomic<unsigned long long> sCachePrefetches{ 0 };
+}
+
+auto WaveTrackCache::GetStatistics() -> Statistics
+{
+   return {
+      sCacheHits.load(std::memory_order_relaxed),
+      sCacheMisses.load(std::memory_order_relaxed),
+      sCachePrefetches.load(std::memory_order_relaxed),
+   };
+}
+
 WaveTrackCache::~WaveTrackCache()
 {
+   // The other thread must not outlive the buffer
+   if (mPrefetch.valid())
+      mPrefetch.wait();
 }
 
 void WaveTrackCache::SetTrack(const std::shared_ptr<const WaveTrack> &pTrack)
 {
    if (mPTrack != pTrack) {
+      if (mPrefetch.valid()) {
+         mPrefetch.wait();
+         mPrefetch = {};
+      }
+      mPrefetchBuffer.len = 0;
       if (pTrack) {
          mBufferSize = pTrack->GetMaxBlockSize();
          if (!mPTrack ||
              mPTrack->GetMaxBlockSize() != mBufferSize) {
             Free();
-            mBuffers[0].data = Floats{ mBufferSize };
-            mBuffers[1].data = Floats{ mBufferSize };
+            for (auto &buffer : mBuffers)
+               buffer.data = Floats{ mBufferSize };
+            mPrefetchBuffer.data = Floats{ mBufferSize };
          }
       }
       else
          Free();
       mPTrack = pTrack;
-      mNValidBuffers = 0;
+      for (auto &buffer : mBuffers)
+         buffer.len = 0;
+      mLastEnd = -1;
    }
 }
 
-constSamplePtr WaveTrackCache::Get(sampleFormat format,
-   sampleCount start, size_t len, bool mayThrow)
+auto WaveTrackCache::Find(sampleCount pos) -> Buffer *
 {
-   if (format == floatSample && len > 0) {
-      const auto end = start + len;
+   for (auto &buffer : mBuffers)
+      if (buffer.Contains(pos)) {
+         buffer.lastUse = ++mUseCount;
+         return &buffer;
+      }
+   return nullptr;
+}
 
-      bool fillFirst = (mNValidBuffers < 1);
-      bool fillSecond = (mNValidBuffers < 2);
+auto WaveTrackCache::LeastRecentlyUsed() -> Buffer &
+{
+   // Empty buffers have lastUse 0
+   return *std::min_element(mBuffers.begin(), mBuffers.end(),
+      [](const Buffer &a, const Buffer &b){ return a.lastUse < b.lastUse; });
+}
 
-      // Discard cached results that we no longer need
-      if (mNValidBuffers > 0 &&
-          (end <= mBuffers[0].start ||
-           start >= mBuffers[mNValidBuffers - 1].end())) {
-         // Complete miss
-         fillFirst = true;
-         fillSecond = true;
-      }
-      else if (mNValidBuffers == 2 &&
-               start >= mBuffers[1].start &&
-               end > mBuffers[1].end()) {
-         // Request starts in the second buffer and extends past it.
-         // Discard the first buffer.
-         // (But don't deallocate the buffer space.)
-         mBuffers[0] .swap ( mBuffers[1] );
-         fillSecond = true;
-         mNValidBuffers = 1;
+auto WaveTrackCache::Load(sampleCount pos, bool mayThrow, bool &success)
+   -> Buffer *
+{
+   success = true;
+   const auto start0 = mPTrack->GetBlockStart(pos);
+   if (start0 < 0)
+      // Request may fall between the clips of a track.
+      // WaveTrack::Get() will return zeroes.
+      return nullptr;
+   const auto len0 = mPTrack->GetBestBlockSize(start0);
+   wxASSERT(len0 <= mBufferSize);
+
+   auto &buffer = LeastRecentlyUsed();
+   // Keep the state consistent if Get() throws
+   buffer.len = 0;
+   buffer.lastUse = 0;
+   if (!mPTrack->Get(
+         samplePtr(buffer.data.get()), floatSample, start0, len0,
+         fillZero, mayThrow)) {
+      success = false;
+      return nullptr;
+   }
+   buffer.start = start0;
+   buffer.len = len0;
+   buffer.lastUse = ++mUseCount;
+   ++sCacheMisses;
+   return buffer.Contains(pos) ? &buffer : nullptr;
+}
+
+void WaveTrackCache::StartPrefetch(sampleCount pos)
+{
+   if (mPrefetch.valid() || !mPrefetchBuffer.data)
+      return;
+   for (const auto &buffer : mBuffers)
+      if (buffer.Contains(pos))
+         return;
+
+   const auto start0 = mPTrack->GetBlockStart(pos);
+   if (start0 < 0)
+      return;
+   const auto len0 = mPTrack->GetBestBlockSize(start0);
+   wxASSERT(len0 <= mBufferSize);
+
+   mPrefetchBuffer.start = start0;
+   mPrefetchBuffer.len = len0;
+   auto pTrack = mPTrack;
+   const auto data = samplePtr(mPrefetchBuffer.data.get());
+   mPrefetch = std::async(std::launch::async, [=]{
+      try {
+         return pTrack->Get(data, floatSample, start0, len0, fillZero, false);
       }
-      else if (mNValidBuffers > 0 &&
-         start < mBuffers[0].start &&
-         0 <= mPTrack->GetBlockStart(start)) {
-         // Request is not a total miss but starts before the cache,
-         // and there is a clip to fetch from.
-         // Not the access pattern for drawing spectrogram or playback,
-         // but maybe scrubbing causes this.
-         // Move the first buffer into second place, and later
-         // refill the first.
-         // (This case might be useful when marching backwards through
-         // the track, as with scrubbing.)
-         mBuffers[0] .swap ( mBuffers[1] );
-         fillFirst = true;
-         fillSecond = false;
-         // Cache is not in a consistent state yet
-         mNValidBuffers = 0;
+      catch (...) {
+         return false;
       }
+   });
+}
 
-      // Refill buffers as needed
-      if (fillFirst) {
-         const auto start0 = mPTrack->GetBlockStart(start);
-         if (start0 >= 0) {
-            const auto len0 = mPTrack->GetBestBlockSize(start0);
-            wxASSERT(len0 <= mBufferSize);
-            if (!mPTrack->Get(
-                  samplePtr(mBuffers[0].data.get()), floatSample, start0, len0,
-                  fillZero, mayThrow))
-               return 0;
-            mBuffers[0].start = start0;
-            mBuffers[0].len = len0;
-            if (!fillSecond &&
-                mBuffers[0].end() != mBuffers[1].start)
-               fillSecond = true;
-            // Keep the partially updated state consistent:
-            mNValidBuffers = fillSecond ? 1 : 2;
-         }
-         else {
-            // Request may fall between the clips of a track.
-            // Invalidate all.  WaveTrack::Get() will return zeroes.
-            mNValidBuffers = 0;
-            fillSecond = false;
-         }
+void WaveTrackCache::FinishPrefetch()
+{
+   if (!mPrefetch.valid())
+      return;
+   if (mPrefetch.get()) {
+      // Replace the least recently used buffer without copying
+      auto &buffer = LeastRecentlyUsed();
+      buffer.swap(mPrefetchBuffer);
+      buffer.lastUse = ++mUseCount;
+      ++sCachePrefetches;
+   }
+   mPrefetchBuffer.len = 0;
+}
+
+void WaveTrackCache::PlanRead(
+   sampleCount start, sampleCount len, BlockReadBatch &batch)
+{
+   if (!mPTrack || len <= 0)
+      return;
+
+   const auto end = start + len;
+   // Each buffer found or claimed is marked as just used, so that the least
+   // recently used one is never one of them
+   auto available = mBuffers.size() - 1;
+   auto pos = start;
+   while (pos < end && available > 0) {
+      if (const auto pBuffer = Find(pos)) {
+         pos = pBuffer->end();
+         --available;
+         continue;
       }
-      wxASSERT(!fillSecond || mNValidBuffers > 0);
-      if (fillSecond) {
-         mNValidBuffers = 1;
-         const auto end0 = mBuffers[0].end();
-         if (end > end0) {
-            const auto start1 = mPTrack->GetBlockStart(end0);
-            if (start1 == end0) {
-               const auto len1 = mPTrack->GetBestBlockSize(start1);
-               wxASSERT(len1 <= mBufferSize);
-               if (!mPTrack->Get(samplePtr(mBuffers[1].data.get()), floatSample, start1, len1, fillZero, mayThrow))
-                  return 0;
-               mBuffers[1].start = start1;
-               mBuffers[1].len = len1;
-               mNValidBuffers = 2;
-            }
-         }
+      if (mPrefetch.valid() && mPrefetchBuffer.Contains(pos)) {
+         // Get() will take it
+         pos = mPrefetchBuffer.end();
+         continue;
       }
-      wxASSERT(mNValidBuffers < 2 || mBuffers[0].end() == mBuffers[1].start);
 
-      samplePtr buffer = 0;
-      auto remaining = len;
+      const auto start0 = mPTrack->GetBlockStart(pos);
+      if (start0 < 0)
+         // Between clips, where Get() makes zeroes
+         break;
+      const auto len0 = mPTrack->GetBestBlockSize(start0);
+      wxASSERT(len0 <= mBufferSize);
+      if (len0 == 0)
+         break;
+
+      auto &buffer = LeastRecentlyUsed();
+      buffer.len = 0;
+      buffer.lastUse = ++mUseCount;
+      const auto pBuffer = &buffer;
+      const auto pTrack = mPTrack;
+      const auto data = samplePtr(buffer.data.get());
+      batch.Add(
+         [=]{
+            try {
+               return pTrack->Get(
+                  data, floatSample, start0, len0, fillZero, false);
+            }
+            catch (...) {
+               return false;
+            }
+         },
+         [=](bool success){
+            if (success) {
+               pBuffer->start = start0;
+               pBuffer->len = len0;
+               ++sCachePrefetches;
+            }
+            else
+               // Get() loads it again, and reports the error
+               pBuffer->lastUse = 0;
+         });
+      pos = start0 + len0;
+      --available;
+   }
+}
 
-      // Possibly get an initial portion that is uncached
+constSamplePtr WaveTrackCache::Get(sampleFormat format,
+   sampleCount start, size_t len, bool mayThrow)
+{
+   if (format == floatSample && len > 0) {
+      const auto end = start + len;
 
-      // This may be negative
-      const auto initLen =
-         mNValidBuffers < 1 ? sampleCount( len )
-            : std::min(sampleCount( len ), mBuffers[0].start - start);
+      // Take the prefetched block once it is needed, or ready anyway
+      if (mPrefetch.valid() &&
+          ((start < mPrefetchBuffer.end() && mPrefetchBuffer.start < end) ||
+           mPrefetch.wait_for(std::chrono::seconds(0)) ==
+              std::future_status::ready))
+         FinishPrefetch();
+
+      // Varispeed may overlap the previous request a little
+      const bool sequential = (mLastStart <= start && start <= mLastEnd);
+      mLastStart = start;
+      mLastEnd = end;
+
+      const auto prefetch = [&](const Buffer *pLast){
+         if (sequential && pLast)
+            StartPrefetch(pLast->end());
+      };
 
-      if (initLen > 0) {
-         // This might be fetching zeroes between clips
-         mOverlapBuffer.Resize(len, format);
-         // initLen is not more than len:
-         auto sinitLen = initLen.as_size_t();
-         if (!mPTrack->Get(mOverlapBuffer.ptr(), format, start, sinitLen,
-                           fillZero, mayThrow))
-            return 0;
-         wxASSERT( sinitLen <= remaining );
-         remaining -= sinitLen;
-         start += initLen;
-         buffer = mOverlapBuffer.ptr() + sinitLen * SAMPLE_SIZE(format);
+      bool success = true;
+      auto pBuffer = Find(start);
+      if (!pBuffer)
+         pBuffer = Load(start, mayThrow, success);
+      else
+         ++sCacheHits;
+      if (!success)
+         return 0;
+
+      if (pBuffer && end <= pBuffer->end()) {
+         // All is contiguous already.  We can completely avoid copying
+         prefetch(pBuffer);
+         return samplePtr(
+            pBuffer->data.get() + (start - pBuffer->start).as_size_t() );
       }
 
-      // Now satisfy the request from the buffers
-      for (int ii = 0; ii < mNValidBuffers && remaining > 0; ++ii) {
-         const auto starti = start - mBuffers[ii].start;
-         // Treatment of initLen above establishes this loop invariant,
-         // and statements below preserve it:
-         wxASSERT(starti >= 0);
-
-         // This may be negative
-         const auto leni =
-            std::min( sampleCount( remaining ), mBuffers[ii].len - starti );
-         if (initLen <= 0 && leni == len) {
-            // All is contiguous already.  We can completely avoid copying
-            // leni is nonnegative, therefore start falls within mBuffers[ii],
-            // so starti is bounded between 0 and buffer length
-            return samplePtr(mBuffers[ii].data.get() + starti.as_size_t() );
+      // Satisfy the request piecewise, from the buffers where possible
+      mOverlapBuffer.Resize(len, format);
+      auto buffer = mOverlapBuffer.ptr();
+      auto remaining = len;
+      const Buffer *pLast = nullptr;
+      while (true) {
+         if (pBuffer) {
+            const auto offset = (start - pBuffer->start).as_size_t();
+            const auto leni = std::min(remaining,
+               (pBuffer->end() - start).as_size_t());
+            memcpy(buffer, pBuffer->data.get() + offset, sizeof(float) * leni);
+            remaining -= leni;
+            start += leni;
+            buffer += sizeof(float) * leni;
+            pLast = pBuffer;
          }
-         else if (leni > 0) {
-            // leni is nonnegative, therefore start falls within mBuffers[ii]
-            // But we can't satisfy all from one buffer, so copy
-            if (buffer == 0) {
-               mOverlapBuffer.Resize(len, format);
-               buffer = mOverlapBuffer.ptr();
-            }
-            // leni is positive and not more than remaining
-            const size_t size = sizeof(float) * leni.as_size_t();
-            // starti is less than mBuffers[ii].len and nonnegative
-            memcpy(buffer, mBuffers[ii].data.get() + starti.as_size_t(), size);
-            wxASSERT( leni <= remaining );
-            remaining -= leni.as_size_t();
+         else {
+            // This might be fetching zeroes between clips
+            const auto leni = std::min(remaining, std::max<size_t>(1, mBufferSize));
+            if (!mPTrack->Get(buffer, format, start, leni, fillZero, mayThrow))
+               return 0;
+            remaining -= leni;
             start += leni;
-            buffer += size;
+            buffer += sizeof(float) * leni;
          }
-      }
 
-      if (remaining > 0) {
-         // Very big request!
-         // Fall back to direct fetch
-         if (buffer == 0) {
-            mOverlapBuffer.Resize(len, format);
-            buffer = mOverlapBuffer.ptr();
-         }
-         if (!mPTrack->Get(buffer, format, start, remaining, fillZero, mayThrow))
+         if (remaining == 0)
+            break;
+
+         pBuffer = Find(start);
+         if (!pBuffer)
+            pBuffer = Load(start, mayThrow, success);
+         else
+            ++sCacheHits;
+         if (!success)
             return 0;
       }
 
+      prefetch(pLast);
       return mOverlapBuffer.ptr();
    }
 
@@ -2801,8 +3061,8 @@ constSamplePtr WaveTrackCache::Get(sampleFormat format,
 
 void WaveTrackCache::Free()
 {
-   mBuffers[0].Free();
-   mBuffers[1].Free();
+   for (auto &buffer : mBuffers)
+      buffer.Free();
+   mPrefetchBuffer.Free();
    mOverlapBuffer.Free();
-   mNValidBuffers = 0;
 }
@@ -13,10 +13,14 @@
 
 #include "Track.h"
 #include "SampleFormat.h"
+#include "Sequence.h"
 #include "WaveClip.h"
 #include "Experimental.h"
 #include "widgets/ProgressDialog.h"
 
+#include <algorithm>
+#include <functional>
+#include <future>
 #include <vector>
 #include <wx/gdicmn.h>
 #include <wx/longlong.h>
@@ -24,6 +28,8 @@
 
 #include "WaveTrackLocation.h"
 
+class BlockFile;
+class BlockReadBatch;
 class SpectrogramSettings;
 class WaveformSettings;
 class TimeWarper;
@@ -71,6 +77,9 @@ class AUDACITY_DLL_API WaveTrack final : public PlayableTrack {
              sampleFormat format = (sampleFormat)0,
              double rate = 0);
    WaveTrack(const WaveTrack &orig);
+   // Copies the clips of orig, except for those equivalent to clips of
+   // pPrevious, which are shared instead
+   WaveTrack(const WaveTrack &orig, const WaveTrack *pPrevious);
 
    void Init(const WaveTrack &orig);
 
@@ -81,6 +90,7 @@ public:
 
 private:
    Track::Holder Duplicate() const override;
+   Track::Holder DuplicateSharing(const Track &previous) const override;
 
    friend class TrackFactory;
 
@@ -225,6 +235,12 @@ private:
    void AppendAlias(const wxString &fName, sampleCount start,
                     size_t len, int channel,bool useOD);
 
+   /// Appends an alias block whose summary is computed from samples the
+   /// caller has just read from the aliased file, so no OD task is needed
+   void AppendAlias(const wxString &fName, sampleCount start,
+                    size_t len, int channel,
+                    samplePtr buffer, sampleFormat format);
+
    ///for use with On-Demand decoding of compressed files.
    ///decodeType should be an enum from ODDecodeTask that specifies what
    ///Type of encoded file this is, such as eODFLAC
@@ -232,6 +248,11 @@ private:
    void AppendCoded(const wxString &fName, sampleCount start,
                             size_t len, int channel, int decodeType);
 
+   /// Appends a block file made by the caller, such as an importer that
+   /// makes blocks on several threads.  Its samples must be in the format of
+   /// the track, and no longer than GetMaxBlockSize().
+   void AppendBlockFile(const BlockFilePtr &blockFile);
+
    ///gets an int with OD flags so that we can determine which ODTasks should be run on this track after save/open, etc.
    unsigned int GetODFlags() const;
 
@@ -261,12 +282,27 @@ private:
    // starting at the given time.
    void GetEnvelopeValues(double *buffer, size_t bufferLen,
                          double t0) const;
+   // The same, in single precision, as mixing uses
+   void GetEnvelopeValues(float *buffer, size_t bufferLen,
+                         double t0) const;
 
    // May assume precondition: t0 <= t1
    std::pair<float, float> GetMinMax(
       double t0, double t1, bool mayThrow = true) const;
    // May assume precondition: t0 <= t1
    float GetRMS(double t0, double t1, bool mayThrow = true) const;
+   // May assume precondition: t0 <= t1
+   // The mean of the samples in clips, from whole block sums where known
+   float GetMean(double t0, double t1, bool mayThrow = true) const;
+
+   // Appends the block files of the clips in the time range, to be read ahead
+   // Appends, in order, the groups of samples of the clips from start
+   // that the block summaries give the peaks of; see Sequence
+   void GetPeakGroups(sampleCount start, size_t len,
+      std::vector<Sequence::PeakGroup> &groups) const;
+
+   void CollectBlockFiles(double t0, double t1,
+      std::vector< std::weak_ptr<BlockFile> > &files) const;
 
    //
    // MM: We now have more than one sequence and envelope per track, so
@@ -303,6 +339,12 @@ private:
    XMLTagHandler *HandleXMLChild(const wxChar *tag) override;
    void WriteXML(XMLWriter &xmlFile) const override;
 
+   // As above, but each clip is written by clipWriter instead, which is
+   // given the clip and its index
+   using ClipWriter =
+      std::function< void( const WaveClip &clip, size_t index ) >;
+   void WriteXML(XMLWriter &xmlFile, const ClipWriter &clipWriter) const;
+
    // Returns true if an error occurred while reading from XML
    bool GetErrorOpening() override;
 
@@ -338,6 +380,11 @@ private:
    bool CloseLock(); //similar to Lock but should be called when the project closes.
    // not balanced by unlocking calls.
 
+   // Pasting between projects shares the records of packed blockfiles.
+   // Before saving, copy those of other projects into ours.  Returns
+   // whether there were any.
+   bool AdoptBorrowedBlocks();
+
    /** @brief Convert correctly between an (absolute) time in seconds and a number of samples.
     *
     * This method will not give the correct results if used on a relative time (difference of two
@@ -365,6 +412,10 @@ private:
    const WaveClipConstHolders &GetClips() const
       { return reinterpret_cast< const WaveClipConstHolders& >( mClips ); }
 
+   // A clip of this track that WaveClip::IsEquivalent to clip, trying the
+   // one at index first; or null
+   WaveClipHolder FindEquivalentClip(const WaveClip &clip, size_t index) const;
+
    // Get access to all clips (in some unspecified sequence),
    // including those hidden in cutlines.
    class AllClipsIterator
@@ -511,8 +562,12 @@ private:
    // from the NEW partner.
    void Merge(const Track &orig) override;
 
-   // Resample track (i.e. all clips in the track)
-   void Resample(int rate, ProgressDialog *progress = NULL);
+   // Resample track (i.e. all clips in the track).  A clip for which
+   // getResampled gives a sequence, already at the rate, takes that instead.
+   using ResampledSequenceFunction =
+      std::function< std::unique_ptr<Sequence>(const WaveClip &clip) >;
+   void Resample(int rate, ProgressDialog *progress = NULL,
+                 const ResampledSequenceFunction &getResampled = {});
 
    //
    // AutoSave related
@@ -641,6 +696,9 @@ private:
    // Private variables
    //
 
+   template< typename Value > void DoGetEnvelopeValues
+      (Value *buffer, size_t bufferLen, double t0) const;
+
    wxCriticalSection mFlushCriticalSection;
    wxCriticalSection mAppendCriticalSection;
    double mLegacyProjectFileOffset;
@@ -662,25 +720,45 @@ protected:
 // the contents of the WaveTrack are known not to change.  It can replace
 // repeated calls to WaveTrack::Get() (each of which opens and closes at least
 // one block file).
+// It keeps the samples of the most recently used blocks.  When requests are
+// sequential, the block after the last one read is fetched on another thread
+// meanwhile, so that it is ready when wanted.
 class WaveTrackCache {
 public:
+   // Enough for a look-back window and a varispeed or scrubbing reader
+   static const size_t DefaultBuffers = 4;
+
+   // Counts for all caches, for diagnostics
+   struct Statistics {
+      unsigned long long hits, misses, prefetches;
+   };
+   static Statistics GetStatistics();
+
    WaveTrackCache()
+      : WaveTrackCache{ DefaultBuffers }
+   {
+   }
+
+   explicit WaveTrackCache(size_t nBuffers)
       : mBufferSize(0)
+      , mBuffers(std::max<size_t>(1, nBuffers))
       , mOverlapBuffer()
-      , mNValidBuffers(0)
    {
    }
 
-   explicit WaveTrackCache(const std::shared_ptr<const WaveTrack> &pTrack)
+   explicit WaveTrackCache(const std::shared_ptr<const WaveTrack> &pTrack,
+                           size_t nBuffers = DefaultBuffers)
       : mBufferSize(0)
+      , mBuffers(std::max<size_t>(1, nBuffers))
       , mOverlapBuffer()
-      , mNValidBuffers(0)
    {
       SetTrack(pTrack);
    }
    ~WaveTrackCache();
 
    const WaveTrack *GetTrack() const { return mPTrack.get(); }
+   const std::shared_ptr<const WaveTrack> &GetSharedTrack() const
+   { return mPTrack; }
    void SetTrack(const std::shared_ptr<const WaveTrack> &pTrack);
 
    // Uses fillZero always
@@ -690,6 +768,11 @@ public:
    constSamplePtr Get(
       sampleFormat format, sampleCount start, size_t len, bool mayThrow);
 
+   // Adds to the batch reads of the blocks that samples [start, start + len)
+   // will need, as many as fit in the cache with a buffer to spare.  Run the
+   // batch before calling Get() or SetTrack() again.
+   void PlanRead(sampleCount start, sampleCount len, BlockReadBatch &batch);
+
 private:
    void Free();
 
@@ -697,24 +780,48 @@ private:
       Floats data;
       sampleCount start;
       sampleCount len;
+      // For least-recently-used replacement
+      unsigned long long lastUse;
 
-      Buffer() : start(0), len(0) {}
-      void Free() { data.reset(); start = 0; len = 0; }
+      Buffer() : start(0), len(0), lastUse(0) {}
+      void Free() { data.reset(); start = 0; len = 0; lastUse = 0; }
       sampleCount end() const { return start + len; }
+      bool Contains(sampleCount pos) const
+      { return len > 0 && start <= pos && pos < end(); }
 
       void swap ( Buffer &other )
       {
          data .swap ( other.data );
          std::swap( start, other.start );
          std::swap( len, other.len );
+         std::swap( lastUse, other.lastUse );
       }
    };
 
+   // Null if no buffer holds pos
+   Buffer *Find(sampleCount pos);
+   // Fill the least recently used buffer with the block holding pos; null,
+   // with success, if pos is not in a clip
+   Buffer *Load(sampleCount pos, bool mayThrow, bool &success);
+   Buffer &LeastRecentlyUsed();
+
+   void StartPrefetch(sampleCount pos);
+   // Waits for the prefetch, if any, then puts its buffer in the cache
+   void FinishPrefetch();
+
    std::shared_ptr<const WaveTrack> mPTrack;
    size_t mBufferSize;
-   Buffer mBuffers[2];
+   std::vector<Buffer> mBuffers;
    GrowableSampleBuffer mOverlapBuffer;
-   int mNValidBuffers;
+   unsigned long long mUseCount { 0 };
+
+   // Where the previous request began and ended, to detect sequential reads
+   sampleCount mLastStart { 0 };
+   sampleCount mLastEnd { -1 };
+
+   // Filled on another thread while mPrefetch is valid
+   Buffer mPrefetchBuffer;
+   std::future<bool> mPrefetch;
 };
 
 #endif // __AUDACITY_WAVETRACK__
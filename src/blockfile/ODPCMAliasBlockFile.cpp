@@ -346,11 +346,7 @@ void ODPCMAliasBlockFile::Recover(void)
 
 bool ODPCMAliasBlockFile::IsSummaryAvailable() const
 {
-   bool retval;
-   mSummaryAvailableMutex.Lock();
-   retval= mSummaryAvailable;
-   mSummaryAvailableMutex.Unlock();
-   return retval;
+   return mSummaryAvailable;
 }
 
 ///Calls write summary, and makes sure it is only done once in a thread-safe fashion.
@@ -428,9 +424,7 @@ void ODPCMAliasBlockFile::WriteSummary()
 
     //     wxPrintf("write successful. filename: %s\n", fileNameChar);
 
-   mSummaryAvailableMutex.Lock();
-   mSummaryAvailable=true;
-   mSummaryAvailableMutex.Unlock();
+   mSummaryAvailable = true;
 }
 
 
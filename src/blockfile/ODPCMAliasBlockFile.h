@@ -40,6 +40,7 @@ Some of these methods have been overridden only because they used the unsafe wxL
 #include "../BlockFile.h"
 #include "../ondemand/ODTaskThread.h"
 #include "../DirManager.h"
+#include <atomic>
 #include <wx/thread.h>
 
 /// An AliasBlockFile that references uncompressed data in an existing file
@@ -56,7 +57,7 @@ class ODPCMAliasBlockFile final : public PCMAliasBlockFile
                         float min, float max, float rms, bool summaryAvailable);
    virtual ~ODPCMAliasBlockFile();
 
-   //checks to see if summary data has been computed and written to disk yet.  Thread safe.  Blocks if we are writing summary data.
+   //checks to see if summary data has been computed and written to disk yet.  Thread safe, and never blocks.
    bool IsSummaryAvailable() const override;
 
    /// Returns TRUE if the summary has not yet been written, but is actively being computed and written to disk
@@ -155,8 +156,8 @@ protected:
    //lock the read data - libsndfile can't handle two reads at once?
    mutable ODLock mReadDataMutex;
 
-   mutable ODLock    mSummaryAvailableMutex;
-   bool mSummaryAvailable;
+   // Read by the GUI for every block it draws, so not under a lock
+   std::atomic<bool> mSummaryAvailable;
    bool mSummaryBeingComputed;
    bool mHasBeenSaved;
 
@@ -51,6 +51,18 @@ PCMAliasBlockFile::PCMAliasBlockFile(
       AliasBlockFile::WriteSummary();
 }
 
+PCMAliasBlockFile::PCMAliasBlockFile(
+      wxFileNameWrapper &&fileName,
+      wxFileNameWrapper &&aliasedFileName,
+      sampleCount aliasStart,
+      size_t aliasLen, int aliasChannel,
+      samplePtr sampleData, sampleFormat format)
+: AliasBlockFile{ std::move(fileName), std::move(aliasedFileName),
+                  aliasStart, aliasLen, aliasChannel }
+{
+   AliasBlockFile::WriteSummaryFromSamples(sampleData, format);
+}
+
 PCMAliasBlockFile::PCMAliasBlockFile(
       wxFileNameWrapper &&existingSummaryFileName,
       wxFileNameWrapper &&aliasedFileName,
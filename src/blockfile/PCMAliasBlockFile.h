@@ -28,6 +28,13 @@ class PCMAliasBlockFile /* not final */ : public AliasBlockFile
                      wxFileNameWrapper &&aliasedFileName,
                      sampleCount aliasStart,
                      size_t aliasLen, int aliasChannel,bool writeSummary);
+   ///Constructs a PCMAliasBlockFile, writing the summary of samples the
+   ///caller has already read from the aliased file
+   PCMAliasBlockFile(wxFileNameWrapper &&baseFileName,
+                     wxFileNameWrapper &&aliasedFileName,
+                     sampleCount aliasStart,
+                     size_t aliasLen, int aliasChannel,
+                     samplePtr sampleData, sampleFormat format);
 
    PCMAliasBlockFile(wxFileNameWrapper &&existingSummaryFileName,
                      wxFileNameWrapper &&aliasedFileName,
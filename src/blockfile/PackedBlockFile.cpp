@@ -0,0 +1,359 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockFile.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+*******************************************************************//**
+
+\class PackedBlockFile
+\brief A BlockFile stored as a record within the extents of a BlockStore.
+
+The record holds the summary, as SimpleBlockFile writes it, followed by
+the samples in native byte order.  24 bit samples are packed in three
+bytes each, as on disk elsewhere; records written before that hold them
+in four, and say so by the absence of the "samplebytes" attribute.  The
+sample format and the block-level min, max and RMS are kept in the
+project file instead of a header.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "PackedBlockFile.h"
+
+#include "../FileException.h"
+#include "../Internat.h"
+#include "../xml/XMLTagHandler.h"
+#include "../xml/XMLWriter.h"
+
+PackedBlockFile::PackedBlockFile(const std::shared_ptr<BlockStore> &pStore,
+                                 samplePtr sampleData, size_t sampleLen,
+                                 sampleFormat format)
+: BlockFile{ wxFileNameWrapper{}, sampleLen }
+, mStore{ pStore }
+, mFormat{ format }
+, mSampleBytes{ SAMPLE_SIZE_DISK(format) }
+{
+   // Also sets mMin, mMax and mRMS
+   ArrayOf<char> cleanup;
+   void *summaryData = CalcSummary(sampleData, sampleLen, format, cleanup);
+
+   ArrayOf<unsigned char> packed;
+   if (IsPacked()) {
+      packed.reinit(sampleLen * mSampleBytes);
+      PackInt24((const int *)sampleData, packed.get(), sampleLen);
+      sampleData = (samplePtr)packed.get();
+   }
+
+   mLocation = mStore->Append(
+      summaryData, mSummaryInfo.totalSummaryBytes,
+      sampleData, sampleLen * mSampleBytes);
+}
+
+PackedBlockFile::PackedBlockFile(const std::shared_ptr<BlockStore> &pStore,
+                                 const BlockStore::Location &location,
+                                 size_t sampleLen, sampleFormat format,
+                                 size_t sampleBytes,
+                                 float min, float max, float rms)
+: BlockFile{ wxFileNameWrapper{}, sampleLen }
+, mStore{ pStore }
+, mLocation{ location }
+, mFormat{ format }
+, mSampleBytes{ sampleBytes }
+{
+   mMin = min;
+   mMax = max;
+   mRMS = rms;
+}
+
+PackedBlockFile::~PackedBlockFile()
+{
+}
+
+bool PackedBlockFile::ReadSummary(ArrayOf<char> &data)
+{
+   data.reinit( mSummaryInfo.totalSummaryBytes );
+   const auto bytes = mStore->Read(
+      mLocation, 0, data.get(), mSummaryInfo.totalSummaryBytes );
+   if ( bytes != mSummaryInfo.totalSummaryBytes ) {
+      // FIXME: TRAP_ERR no report to user of absent summary,
+      // as for other block files
+      memset( data.get(), 0, mSummaryInfo.totalSummaryBytes );
+      mSilentLog = TRUE;
+      return false;
+   }
+   return true;
+}
+
+void PackedBlockFile::Prefetch(bool summaryOnly) const
+{
+   const auto bytes = summaryOnly
+      ? mSummaryInfo.totalSummaryBytes
+      : GetRecordBytes();
+   ArrayOf<char> scratch{ bytes };
+   mStore->Read( mLocation, 0, scratch.get(), bytes );
+}
+
+size_t PackedBlockFile::ReadData(samplePtr data, sampleFormat format,
+                                 size_t start, size_t len, bool mayThrow) const
+{
+   const auto sampleSize = mSampleBytes;
+   const auto offset =
+      mSummaryInfo.totalSummaryBytes + (unsigned long long)start * sampleSize;
+   const auto available = start < mLen ? std::min(len, mLen - start) : 0;
+
+   size_t framesRead = 0;
+   if ( available > 0 ) {
+      if ( format == mFormat && !IsPacked() )
+         framesRead = mStore->Read(
+            mLocation, offset, data, available * sampleSize ) / sampleSize;
+      else {
+         SampleBuffer buffer( available, mFormat );
+         framesRead = mStore->Read(
+            mLocation, offset, buffer.ptr(), available * sampleSize )
+               / sampleSize;
+         if ( IsPacked() ) {
+            if ( format == mFormat )
+               UnpackInt24( (const unsigned char *)buffer.ptr(),
+                  (int *)data, framesRead );
+            else {
+               SampleBuffer unpacked( framesRead, mFormat );
+               UnpackInt24( (const unsigned char *)buffer.ptr(),
+                  (int *)unpacked.ptr(), framesRead );
+               CopySamples( unpacked.ptr(), mFormat, data, format, framesRead );
+            }
+         }
+         else
+            CopySamples( buffer.ptr(), mFormat, data, format, framesRead );
+      }
+   }
+
+   if ( framesRead < len ) {
+      if ( mayThrow )
+         throw FileException{ FileException::Cause::Read,
+            mStore->GetExtentPath( mLocation.extent ) };
+      ClearSamples( data, format, framesRead, len - framesRead );
+   }
+
+   return framesRead;
+}
+
+bool PackedBlockFile::ReadBatch(const std::vector<BatchRead> &reads,
+                                sampleFormat format, bool mayThrow)
+{
+   bool result = true;
+   auto readEach = [&](size_t first, size_t last) {
+      for (auto ii = first; ii < last; ++ii) {
+         const auto &read = reads[ii];
+         if (read.file->ReadData(read.data, format, read.start, read.len,
+                                 mayThrow) != read.len)
+            result = false;
+      }
+   };
+
+   std::vector<BlockStore::Piece> pieces;
+   ArrayOf<unsigned char> packed;
+   for (size_t first = 0, nReads = reads.size(); first < nReads;) {
+      const auto file = reads[first].file;
+      auto last = first + 1;
+      if (file->mFormat == format) {
+         while (last < nReads) {
+            const auto next = reads[last].file;
+            if (next->mStore != file->mStore ||
+                next->mLocation.extent != file->mLocation.extent ||
+                next->mFormat != format ||
+                next->mSampleBytes != file->mSampleBytes)
+               break;
+            ++last;
+         }
+      }
+
+      // Packed samples are read together into one buffer, then unpacked
+      const bool isPacked = file->IsPacked();
+      const auto sampleSize = file->mSampleBytes;
+      size_t packedLen = 0;
+      if (isPacked) {
+         for (auto ii = first; ii < last; ++ii)
+            packedLen += reads[ii].len;
+         packed.reinit(packedLen * sampleSize);
+      }
+
+      pieces.clear();
+      size_t packedPos = 0;
+      for (auto ii = first; ii < last; ++ii) {
+         const auto &read = reads[ii];
+         if (read.start + read.len > read.file->mLen) {
+            pieces.clear();
+            break;
+         }
+         pieces.push_back({
+            read.file->mLocation.offset +
+               read.file->mSummaryInfo.totalSummaryBytes +
+               (unsigned long long)read.start * sampleSize,
+            isPacked
+               ? (samplePtr)(packed.get() + packedPos * sampleSize)
+               : read.data,
+            read.len * sampleSize });
+         packedPos += read.len;
+      }
+
+      // On any failure, let ReadData find and report what is wrong
+      if (last == first + 1 || pieces.empty() ||
+          !file->mStore->ReadPieces(file->mLocation.extent, pieces))
+         readEach(first, last);
+      else if (isPacked) {
+         packedPos = 0;
+         for (auto ii = first; ii < last; ++ii) {
+            const auto &read = reads[ii];
+            UnpackInt24(packed.get() + packedPos * sampleSize,
+               (int *)read.data, read.len);
+            packedPos += read.len;
+         }
+      }
+
+      first = last;
+   }
+
+   return result;
+}
+
+BlockFilePtr PackedBlockFile::Copy(wxFileNameWrapper &&)
+{
+   auto result = make_blockfile<PackedBlockFile>
+      (mStore, mLocation, mLen, mFormat, mSampleBytes, mMin, mMax, mRMS);
+   result->mBorrowed = mBorrowed;
+   return result;
+}
+
+BlockFilePtr PackedBlockFile::Borrow() const
+{
+   auto result = make_blockfile<PackedBlockFile>
+      (mStore, mLocation, mLen, mFormat, mSampleBytes, mMin, mMax, mRMS);
+   result->mBorrowed = true;
+   return result;
+}
+
+BlockFilePtr PackedBlockFile::CopyTo(
+   const std::shared_ptr<BlockStore> &pStore) const
+{
+   const auto bytes = GetRecordBytes();
+   ArrayOf<char> record{ bytes };
+   if ( mStore->Read( mLocation, 0, record.get(), bytes ) != bytes )
+      throw FileException{ FileException::Cause::Read,
+         mStore->GetExtentPath( mLocation.extent ) };
+
+   const auto location = pStore->Append( record.get(), bytes, nullptr, 0 );
+   return make_blockfile<PackedBlockFile>
+      (pStore, location, mLen, mFormat, mSampleBytes, mMin, mMax, mRMS);
+}
+
+void PackedBlockFile::SaveXML(XMLWriter &xmlFile)
+// may throw
+{
+   xmlFile.StartTag(wxT("packedblockfile"));
+
+   // Only auto-save writes this; saving copies the record into the project
+   if (mBorrowed)
+      xmlFile.WriteAttr(wxT("store"), mStore->GetDirectory());
+   xmlFile.WriteAttr(wxT("extent"), (long) mLocation.extent);
+   xmlFile.WriteAttr(wxT("offset"), (long long) mLocation.offset);
+   xmlFile.WriteAttr(wxT("len"), mLen);
+   xmlFile.WriteAttr(wxT("format"), (long) mFormat);
+   xmlFile.WriteAttr(wxT("samplebytes"), mSampleBytes);
+   xmlFile.WriteAttr(wxT("min"), mMin);
+   xmlFile.WriteAttr(wxT("max"), mMax);
+   xmlFile.WriteAttr(wxT("rms"), mRMS);
+
+   xmlFile.EndTag(wxT("packedblockfile"));
+}
+
+auto PackedBlockFile::GetSpaceUsage() const -> DiskByteCount
+{
+   return GetRecordBytes();
+}
+
+wxString PackedBlockFile::GetKey() const
+{
+   const auto key = wxString::Format( wxT("%u:%llu"),
+      mLocation.extent, mLocation.offset );
+   return mBorrowed ? mStore->GetDirectory() + wxT(":") + key : key;
+}
+
+size_t PackedBlockFile::GetRecordBytes() const
+{
+   return mSummaryInfo.totalSummaryBytes + mLen * mSampleBytes;
+}
+
+// BuildFromXML methods should always return a BlockFile, not NULL,
+// even if the result is flawed (e.g., refers to a missing extent),
+// as testing will be done in DirManager::ProjectFSCK().
+/// static
+BlockFilePtr PackedBlockFile::BuildFromXML(DirManager &dm, const wxChar **attrs)
+{
+   BlockStore::Location location;
+   sampleFormat format = floatSample;
+   // Absent from records written before 24 bit samples were packed
+   long sampleBytes = 0;
+   float min = 0.0f, max = 0.0f, rms = 0.0f;
+   size_t len = 0;
+   double dblValue;
+   long nValue;
+   long long llValue;
+   std::shared_ptr<BlockStore> pStore = dm.GetBlockStore();
+   bool borrowed = false;
+
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!wxStrcmp(attr, wxT("extent")) &&
+          XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+          nValue >= 0)
+         location.extent = nValue;
+      else if (!wxStrcmp(attr, wxT("offset")) &&
+               XMLValueChecker::IsGoodInt64(strValue) &&
+               strValue.ToLongLong(&llValue) && llValue >= 0)
+         location.offset = llValue;
+      else if (!wxStrcmp(attr, wxT("len")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue > 0)
+         len = nValue;
+      else if (!wxStrcmp(attr, wxT("format")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               XMLValueChecker::IsValidSampleFormat(nValue))
+         format = (sampleFormat) nValue;
+      else if (!wxStrcmp(attr, wxT("samplebytes")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue))
+         sampleBytes = nValue;
+      else if (!wxStrcmp(attr, wxT("store")) &&
+               XMLValueChecker::IsGoodPathString(strValue) &&
+               strValue != pStore->GetDirectory()) {
+         pStore = BlockStore::Open(strValue);
+         borrowed = true;
+      }
+      else if (XMLValueChecker::IsGoodString(strValue) && Internat::CompatibleToDouble(strValue, &dblValue))
+      {  // double parameters
+         if (!wxStricmp(attr, wxT("min")))
+            min = dblValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = dblValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (dblValue >= 0.0))
+            rms = dblValue;
+      }
+   }
+
+   if (sampleBytes != (long)SAMPLE_SIZE_DISK(format))
+      sampleBytes = SAMPLE_SIZE(format);
+
+   auto result = make_blockfile<PackedBlockFile>
+      (pStore, location, len, format, sampleBytes, min, max, rms);
+   result->mBorrowed = borrowed;
+   return result;
+}
@@ -0,0 +1,99 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockFile.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_PACKED_BLOCKFILE__
+#define __AUDACITY_PACKED_BLOCKFILE__
+
+#include "../BlockFile.h"
+#include "../BlockStore.h"
+#include "../DirManager.h"
+
+/// A BlockFile whose summary and samples are one record in a BlockStore,
+/// rather than a file of its own.
+///
+/// The record is written once, by the constructor that takes sample data,
+/// and never changes, so copies refer to the same record.
+class PackedBlockFile final : public BlockFile {
+ public:
+
+   // Constructor / Destructor
+
+   /// Create a disk record and write these samples to it
+   PackedBlockFile(const std::shared_ptr<BlockStore> &pStore,
+                   samplePtr sampleData, size_t sampleLen,
+                   sampleFormat format);
+
+   /// Refer to an existing record, holding sampleBytes for each sample
+   PackedBlockFile(const std::shared_ptr<BlockStore> &pStore,
+                   const BlockStore::Location &location,
+                   size_t sampleLen, sampleFormat format, size_t sampleBytes,
+                   float min, float max, float rms);
+
+   virtual ~PackedBlockFile();
+
+   // Reading
+
+   /// Read the summary section of the record
+   bool ReadSummary(ArrayOf<char> &data) override;
+   /// Reads the record, or its summary part, into a scratch buffer
+   void Prefetch(bool summaryOnly) const override;
+   /// Read the data section of the record
+   size_t ReadData(samplePtr data, sampleFormat format,
+                   size_t start, size_t len, bool mayThrow) const override;
+
+   /// Create a NEW block file referring to the same record
+   BlockFilePtr Copy(wxFileNameWrapper &&newFileName) override;
+   /// Create a NEW block file with a copy of the record in another store
+   /// May throw
+   BlockFilePtr CopyTo(const std::shared_ptr<BlockStore> &pStore) const;
+   /// Create a NEW block file for another project, referring to the same
+   /// record in this store, until that project copies it when saved
+   BlockFilePtr Borrow() const;
+   bool IsBorrowed() const { return mBorrowed; }
+
+   /// Write an XML representation of this file
+   void SaveXML(XMLWriter &xmlFile) override;
+   DiskByteCount GetSpaceUsage() const override;
+   void Recover() override { };
+
+   const std::shared_ptr<BlockStore> &GetStore() const { return mStore; }
+   /// Identifies the record within its store
+   wxString GetKey() const;
+
+   static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+   /// Part of the samples of one block file, to be read into data
+   struct BatchRead {
+      const PackedBlockFile *file;
+      size_t start;
+      size_t len;
+      samplePtr data;
+   };
+   /// Reads parts of several block files, as ReadData would.  Those in the
+   /// same extent as the one before, and in the format wanted and stored
+   /// alike, are read with it.  Returns false if any read was short.
+   static bool ReadBatch(const std::vector<BatchRead> &reads,
+                         sampleFormat format, bool mayThrow);
+
+ private:
+   size_t GetRecordBytes() const;
+   // Whether the record holds 24 bit samples in three bytes each
+   bool IsPacked() const { return mSampleBytes != SAMPLE_SIZE(mFormat); }
+
+   std::shared_ptr<BlockStore> mStore;
+   BlockStore::Location mLocation;
+   sampleFormat mFormat;
+   size_t mSampleBytes;
+   // The store is not that of the project that has this block file
+   bool mBorrowed { false };
+};
+
+#endif
@@ -0,0 +1,460 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RawAliasBlockFile.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+*******************************************************************//**
+
+\class RawLayout
+\brief The encoding, channels and offset of a file with no header, and
+the conversion of its samples, done here so that the importer and the
+alias blocks can decode from a memory mapping with no copy.
+
+\class RawAliasBlockFile
+\brief An alias to one channel of a block of frames of such a file.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "RawAliasBlockFile.h"
+
+#include <wx/file.h>
+#include <wx/log.h>
+#include <wx/utils.h>
+#include <wx/wxchar.h>
+
+#include <algorithm>
+#include <string.h>
+
+#include <sndfile.h>
+
+#include "../AudacityApp.h"
+#include "../FileException.h"
+#include "../Internat.h"
+#include "../MappedFile.h"
+#include "../MemoryX.h"
+
+namespace {
+
+bool IsBigEndian(int encoding)
+{
+   switch (encoding & SF_FORMAT_ENDMASK) {
+      case SF_ENDIAN_LITTLE:
+         return false;
+      case SF_ENDIAN_BIG:
+         return true;
+      default:
+         // libsndfile reads raw data in the byte order of the machine,
+         // unless told otherwise
+         return wxBYTE_ORDER == wxBIG_ENDIAN;
+   }
+}
+
+// An unsigned integer of N bytes in the given byte order.  Compilers make
+// single loads, swapped if need be, of these.
+template< typename T, unsigned N, bool Big >
+inline T Load(const unsigned char *p)
+{
+   T result = 0;
+   for (unsigned ii = 0; ii < N; ++ii)
+      result |= (T)p[Big ? ii : N - 1 - ii] << (8 * (N - 1 - ii));
+   return result;
+}
+
+// Signed integer samples of N bytes, moved to the top of 32 bits, so that
+// one scale suits all widths, as in libsndfile
+template< unsigned N, bool Big > struct IntSample {
+   wxInt32 operator () (const unsigned char *p) const
+   { return (wxInt32)(Load< wxUint32, N, Big >(p) << (32 - 8 * N)); }
+};
+
+struct UnsignedByteSample {
+   wxInt32 operator () (const unsigned char *p) const
+   { return (wxInt32)((wxUint32)(p[0] ^ 0x80) << 24); }
+};
+
+template< bool Big > struct FloatSample {
+   float operator () (const unsigned char *p) const
+   {
+      const auto bits = Load< wxUint32, 4, Big >(p);
+      float result;
+      memcpy(&result, &bits, sizeof result);
+      return result;
+   }
+};
+
+template< bool Big > struct DoubleSample {
+   float operator () (const unsigned char *p) const
+   {
+      const auto bits = Load< wxUint64, 8, Big >(p);
+      double result;
+      memcpy(&result, &bits, sizeof result);
+      return (float)result;
+   }
+};
+
+// Integers go straight to integer formats, truncated if narrower
+template< typename Fetch >
+void DecodeInts(const unsigned char *src, size_t stride, size_t len,
+                samplePtr dst, sampleFormat format, Fetch fetch)
+{
+   switch (format) {
+      case int16Sample: {
+         const auto out = (short *)dst;
+         for (size_t ii = 0; ii < len; ++ii, src += stride)
+            out[ii] = fetch(src) >> 16;
+         break;
+      }
+      case int24Sample: {
+         const auto out = (int *)dst;
+         for (size_t ii = 0; ii < len; ++ii, src += stride)
+            out[ii] = fetch(src) >> 8;
+         break;
+      }
+      default: {
+         const auto out = (float *)dst;
+         for (size_t ii = 0; ii < len; ++ii, src += stride)
+            out[ii] = fetch(src) * (1.0f / 2147483648.0f);
+         break;
+      }
+   }
+}
+
+// Floating point samples are dithered to integer formats, as libsndfile
+// data are in BlockFile::CommonReadData()
+template< typename Fetch >
+void DecodeFloats(const unsigned char *src, size_t stride, size_t len,
+                  samplePtr dst, sampleFormat format, Fetch fetch)
+{
+   if (format == floatSample) {
+      const auto out = (float *)dst;
+      for (size_t ii = 0; ii < len; ++ii, src += stride)
+         out[ii] = fetch(src);
+   }
+   else {
+      Floats buffer{ len };
+      for (size_t ii = 0; ii < len; ++ii, src += stride)
+         buffer[ii] = fetch(src);
+      CopySamples((samplePtr)buffer.get(), floatSample, dst, format, len);
+   }
+}
+
+unsigned BytesPerSample(int encoding)
+{
+   switch (encoding & SF_FORMAT_SUBMASK) {
+      case SF_FORMAT_PCM_S8:
+      case SF_FORMAT_PCM_U8:
+         return 1;
+      case SF_FORMAT_PCM_16:
+         return 2;
+      case SF_FORMAT_PCM_24:
+         return 3;
+      case SF_FORMAT_PCM_32:
+      case SF_FORMAT_FLOAT:
+         return 4;
+      case SF_FORMAT_DOUBLE:
+         return 8;
+      default:
+         return 0;
+   }
+}
+
+}
+
+RawLayout::RawLayout(int encoding, unsigned channels, wxFileOffset offset)
+: mEncoding{ encoding }
+, mChannels{ std::max(1u, channels) }
+, mOffset{ std::max<wxFileOffset>(0, offset) }
+, mBytesPerSample{ std::max(1u, BytesPerSample(encoding)) }
+{
+}
+
+bool RawLayout::IsSupported(int encoding)
+{
+   return BytesPerSample(encoding) > 0;
+}
+
+void RawLayout::Decode(const char *src, unsigned channel, size_t len,
+                       samplePtr dst, sampleFormat format) const
+{
+   const auto first = (const unsigned char *)src + channel * mBytesPerSample;
+   const auto stride = GetBytesPerFrame();
+   const bool big = IsBigEndian(mEncoding);
+
+   switch (mEncoding & SF_FORMAT_SUBMASK) {
+      case SF_FORMAT_PCM_S8:
+         DecodeInts(first, stride, len, dst, format, IntSample<1, false>{});
+         break;
+      case SF_FORMAT_PCM_U8:
+         DecodeInts(first, stride, len, dst, format, UnsignedByteSample{});
+         break;
+      case SF_FORMAT_PCM_16:
+         if (big)
+            DecodeInts(first, stride, len, dst, format, IntSample<2, true>{});
+         else
+            DecodeInts(first, stride, len, dst, format, IntSample<2, false>{});
+         break;
+      case SF_FORMAT_PCM_24:
+         if (big)
+            DecodeInts(first, stride, len, dst, format, IntSample<3, true>{});
+         else
+            DecodeInts(first, stride, len, dst, format, IntSample<3, false>{});
+         break;
+      case SF_FORMAT_PCM_32:
+         if (big)
+            DecodeInts(first, stride, len, dst, format, IntSample<4, true>{});
+         else
+            DecodeInts(first, stride, len, dst, format, IntSample<4, false>{});
+         break;
+      case SF_FORMAT_FLOAT:
+         if (big)
+            DecodeFloats(first, stride, len, dst, format, FloatSample<true>{});
+         else
+            DecodeFloats(first, stride, len, dst, format, FloatSample<false>{});
+         break;
+      case SF_FORMAT_DOUBLE:
+         if (big)
+            DecodeFloats(first, stride, len, dst, format, DoubleSample<true>{});
+         else
+            DecodeFloats(first, stride, len, dst, format, DoubleSample<false>{});
+         break;
+      default:
+         ClearSamples(dst, format, 0, len);
+         break;
+   }
+}
+
+RawAliasBlockFile::RawAliasBlockFile(
+      wxFileNameWrapper &&fileName,
+      wxFileNameWrapper &&aliasedFileName,
+      sampleCount aliasStart,
+      size_t aliasLen, int aliasChannel,
+      const RawLayout &layout,
+      samplePtr sampleData, sampleFormat format)
+: AliasBlockFile{ std::move(fileName), std::move(aliasedFileName),
+                  aliasStart, aliasLen, aliasChannel }
+, mLayout{ layout }
+{
+   AliasBlockFile::WriteSummaryFromSamples(sampleData, format);
+}
+
+RawAliasBlockFile::RawAliasBlockFile(
+      wxFileNameWrapper &&existingSummaryFileName,
+      wxFileNameWrapper &&aliasedFileName,
+      sampleCount aliasStart,
+      size_t aliasLen, int aliasChannel,
+      const RawLayout &layout,
+      float min, float max, float rms)
+: AliasBlockFile{ std::move(existingSummaryFileName), std::move(aliasedFileName),
+                  aliasStart, aliasLen,
+                  aliasChannel, min, max, rms }
+, mLayout{ layout }
+{
+}
+
+RawAliasBlockFile::~RawAliasBlockFile()
+{
+}
+
+/// Reads the specified data from the aliased file, and converts it to the
+/// given sample format.
+///
+/// @param data   The buffer to read the sample data into.
+/// @param format The format to convert the data into
+/// @param start  The offset within the block to begin reading
+/// @param len    The number of samples to read
+size_t RawAliasBlockFile::ReadData(samplePtr data, sampleFormat format,
+                                size_t start, size_t len, bool mayThrow) const
+{
+   if(!mAliasedFileName.IsOk() || // intentionally silenced
+      mAliasChannel < 0 || (unsigned)mAliasChannel >= mLayout.GetChannels()) {
+      memset(data, 0, SAMPLE_SIZE(format) * len);
+      return len;
+   }
+
+   const auto frameBytes = mLayout.GetBytesPerFrame();
+   const auto position = mLayout.GetOffset() +
+      ( mAliasStart + start ).as_long_long() * (wxFileOffset)frameBytes;
+   const auto fullPath = mAliasedFileName.GetFullPath();
+
+   bool found = false;
+   size_t framesRead = 0;
+   if (const auto pFile = DirManager::GetRawFileMappings().Get(fullPath)) {
+      found = true;
+      const auto size = (wxFileOffset)pFile->GetSize();
+      if (position < size) {
+         framesRead = std::min<wxFileOffset>(
+            len, (size - position) / (wxFileOffset)frameBytes );
+         mLayout.Decode(pFile->GetData() + position, mAliasChannel,
+                        framesRead, data, format);
+      }
+   }
+   else {
+      // There is no address space for the mapping, or the file is missing
+      Maybe<wxLogNull> silence{};
+      if (mSilentAliasLog)
+         silence.create();
+
+      wxFile f;
+      if (wxFile::Exists(fullPath) && f.Open(fullPath)) {
+         found = true;
+         ArrayOf<char> buffer{ len * frameBytes };
+         if (f.Seek(position) == position) {
+            const auto bytesRead = f.Read(buffer.get(), len * frameBytes);
+            if (bytesRead != wxInvalidOffset) {
+               framesRead = (size_t)bytesRead / frameBytes;
+               mLayout.Decode(buffer.get(), mAliasChannel,
+                              framesRead, data, format);
+            }
+         }
+      }
+   }
+
+   if (!found) {
+      // Set a marker to display an error message for the silence
+      if (!wxGetApp().ShouldShowMissingAliasedFileWarning())
+         wxGetApp().MarkAliasedFilesMissingWarning(this);
+   }
+   mSilentAliasLog = !found;
+
+   if ( framesRead < len ) {
+      if (mayThrow)
+         throw FileException{ FileException::Cause::Read, mAliasedFileName };
+      ClearSamples(data, format, framesRead, len - framesRead);
+   }
+
+   return framesRead;
+}
+
+/// Construct a NEW RawAliasBlockFile based on this one, but writing
+/// the summary data to a NEW file.
+///
+/// @param newFileName The filename to copy the summary data to.
+BlockFilePtr RawAliasBlockFile::Copy(wxFileNameWrapper &&newFileName)
+{
+   auto newBlockFile = make_blockfile<RawAliasBlockFile>
+      (std::move(newFileName), wxFileNameWrapper{mAliasedFileName},
+       mAliasStart, mLen, mAliasChannel, mLayout, mMin, mMax, mRMS);
+
+   return newBlockFile;
+}
+
+void RawAliasBlockFile::SaveXML(XMLWriter &xmlFile)
+// may throw
+{
+   xmlFile.StartTag(wxT("rawaliasblockfile"));
+
+   xmlFile.WriteAttr(wxT("summaryfile"), mFileName.GetFullName());
+   xmlFile.WriteAttr(wxT("aliasfile"), mAliasedFileName.GetFullPath());
+   xmlFile.WriteAttr(wxT("aliasstart"),
+                     mAliasStart.as_long_long());
+   xmlFile.WriteAttr(wxT("aliaslen"), mLen);
+   xmlFile.WriteAttr(wxT("aliaschannel"), mAliasChannel);
+   xmlFile.WriteAttr(wxT("rawencoding"), mLayout.GetEncoding());
+   xmlFile.WriteAttr(wxT("rawchannels"), (int)mLayout.GetChannels());
+   xmlFile.WriteAttr(wxT("rawoffset"), (long long)mLayout.GetOffset());
+   xmlFile.WriteAttr(wxT("min"), mMin);
+   xmlFile.WriteAttr(wxT("max"), mMax);
+   xmlFile.WriteAttr(wxT("rms"), mRMS);
+
+   xmlFile.EndTag(wxT("rawaliasblockfile"));
+}
+
+// BuildFromXML methods should always return a BlockFile, not NULL,
+// even if the result is flawed (e.g., refers to nonexistent file),
+// as testing will be done in DirManager::ProjectFSCK().
+BlockFilePtr RawAliasBlockFile::BuildFromXML(DirManager &dm, const wxChar **attrs)
+{
+   wxFileNameWrapper summaryFileName;
+   wxFileNameWrapper aliasFileName;
+   int aliasStart=0, aliasLen=0, aliasChannel=0;
+   int encoding = 0;
+   unsigned channels = 1;
+   long long offset = 0;
+   float min = 0.0f, max = 0.0f, rms = 0.0f;
+   double dblValue;
+   long nValue;
+   long long nnValue;
+
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!wxStricmp(attr, wxT("summaryfile")) &&
+            // Can't use XMLValueChecker::IsGoodFileName here, but do part of its test.
+            XMLValueChecker::IsGoodFileString(strValue) &&
+            (strValue.Length() + 1 + dm.GetProjectDataDir().Length() <= PLATFORM_MAX_PATH))
+      {
+         if (!dm.AssignFile(summaryFileName, strValue, false))
+            // Make sure summaryFileName is back to uninitialized state so we can detect problem later.
+            summaryFileName.Clear();
+      }
+      else if (!wxStricmp(attr, wxT("aliasfile")))
+      {
+         if (XMLValueChecker::IsGoodPathName(strValue))
+            aliasFileName.Assign(strValue);
+         else if (XMLValueChecker::IsGoodFileName(strValue, dm.GetProjectDataDir()))
+            // Allow fallback of looking for the file name, located in the data directory.
+            aliasFileName.Assign(dm.GetProjectDataDir(), strValue);
+         else if (XMLValueChecker::IsGoodPathString(strValue))
+            // Keep the reference to a missing file, as PCMAliasBlockFile does
+            aliasFileName.Assign(strValue);
+      }
+      else if ( !wxStricmp(attr, wxT("aliasstart")) ||
+                !wxStricmp(attr, wxT("rawoffset")) )
+      {
+         if (XMLValueChecker::IsGoodInt64(strValue) &&
+             strValue.ToLongLong(&nnValue) && (nnValue >= 0)) {
+            if (!wxStricmp(attr, wxT("aliasstart")))
+               aliasStart = nnValue;
+            else
+               offset = nnValue;
+         }
+      }
+      else if (XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue))
+      {  // integer parameters
+         if (!wxStricmp(attr, wxT("aliaslen")) && (nValue >= 0))
+            aliasLen = nValue;
+         else if (!wxStricmp(attr, wxT("aliaschannel")) && XMLValueChecker::IsValidChannel(nValue))
+            aliasChannel = nValue;
+         else if (!wxStricmp(attr, wxT("rawencoding")))
+            encoding = nValue;
+         else if (!wxStricmp(attr, wxT("rawchannels")) && (nValue >= 1))
+            channels = nValue;
+         else if (!wxStricmp(attr, wxT("min")))
+            min = nValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = nValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (nValue >= 0))
+            rms = nValue;
+      }
+      else if (XMLValueChecker::IsGoodString(strValue) && Internat::CompatibleToDouble(strValue, &dblValue))
+      {  // double parameters
+         if (!wxStricmp(attr, wxT("min")))
+            min = dblValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = dblValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (dblValue >= 0.0))
+            rms = dblValue;
+      }
+   }
+
+   return make_blockfile<RawAliasBlockFile>
+      (std::move(summaryFileName), std::move(aliasFileName),
+       aliasStart, aliasLen, aliasChannel,
+       RawLayout{ encoding, channels, (wxFileOffset)offset },
+       min, max, rms);
+}
+
+void RawAliasBlockFile::Recover(void)
+{
+   WriteSummary();
+}
@@ -0,0 +1,88 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RawAliasBlockFile.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_RAWALIASBLOCKFILE__
+#define __AUDACITY_RAWALIASBLOCKFILE__
+
+#include "../BlockFile.h"
+#include "../DirManager.h"
+
+/// How samples are laid out in a file with no header:  a libsndfile
+/// encoding, the number of interleaved channels, and the offset in bytes
+/// of the first frame
+class RawLayout
+{
+ public:
+   RawLayout() = default;
+   RawLayout(int encoding, unsigned channels, wxFileOffset offset);
+
+   /// Whether Decode() handles the encoding.  The others are read with
+   /// libsndfile.
+   static bool IsSupported(int encoding);
+
+   int GetEncoding() const { return mEncoding; }
+   unsigned GetChannels() const { return mChannels; }
+   wxFileOffset GetOffset() const { return mOffset; }
+   size_t GetBytesPerFrame() const { return mBytesPerSample * mChannels; }
+
+   /// Convert len samples of one channel, from the frames beginning at
+   /// src, scaled as libsndfile would scale them
+   void Decode(const char *src, unsigned channel, size_t len,
+               samplePtr dst, sampleFormat format) const;
+
+ private:
+   int mEncoding { 0 };
+   unsigned mChannels { 1 };
+   wxFileOffset mOffset { 0 };
+   unsigned mBytesPerSample { 1 };
+};
+
+/// An AliasBlockFile that references headerless samples in an existing
+/// file, as imported with File > Import > Raw Data.
+///
+/// The file is read through a memory mapping when there is address space
+/// for it, so samples are decoded straight from the page cache.
+class RawAliasBlockFile final : public AliasBlockFile
+{
+ public:
+   ///Constructs a RawAliasBlockFile, writing the summary of samples the
+   ///caller has already decoded from the aliased file
+   RawAliasBlockFile(wxFileNameWrapper &&baseFileName,
+                     wxFileNameWrapper &&aliasedFileName,
+                     sampleCount aliasStart,
+                     size_t aliasLen, int aliasChannel,
+                     const RawLayout &layout,
+                     samplePtr sampleData, sampleFormat format);
+
+   RawAliasBlockFile(wxFileNameWrapper &&existingSummaryFileName,
+                     wxFileNameWrapper &&aliasedFileName,
+                     sampleCount aliasStart,
+                     size_t aliasLen, int aliasChannel,
+                     const RawLayout &layout,
+                     float min, float max, float rms);
+   virtual ~RawAliasBlockFile();
+
+   /// Reads the specified data from the mapping of the aliased file, or
+   /// else with ordinary reads
+   size_t ReadData(samplePtr data, sampleFormat format,
+                        size_t start, size_t len, bool mayThrow) const override;
+
+   void SaveXML(XMLWriter &xmlFile) override;
+   BlockFilePtr Copy(wxFileNameWrapper &&fileName) override;
+   void Recover() override;
+
+   static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+ private:
+   const RawLayout mLayout;
+};
+
+#endif
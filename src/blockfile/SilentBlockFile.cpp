@@ -12,12 +12,16 @@
 #include "SilentBlockFile.h"
 #include "../FileFormats.h"
 
+#include <mutex>
+#include <unordered_map>
+
 SilentBlockFile::SilentBlockFile(size_t sampleLen):
 BlockFile{ wxFileNameWrapper{}, sampleLen }
 {
    mMin = 0.;
    mMax = 0.;
    mRMS = 0.;
+   mSampleSum.store(0.);
 }
 
 SilentBlockFile::~SilentBlockFile()
@@ -73,15 +77,13 @@ BlockFilePtr SilentBlockFile::BuildFromXML(DirManager & WXUNUSED(dm), const wxCh
          len = nValue;
    }
 
-   return make_blockfile<SilentBlockFile>(len);
+   return Get(len);
 }
 
 /// Create a copy of this BlockFile
 BlockFilePtr SilentBlockFile::Copy(wxFileNameWrapper &&)
 {
-   auto newBlockFile = make_blockfile<SilentBlockFile>(mLen);
-
-   return newBlockFile;
+   return Get(mLen);
 }
 
 auto SilentBlockFile::GetSpaceUsage() const -> DiskByteCount
@@ -89,3 +91,27 @@ auto SilentBlockFile::GetSpaceUsage() const -> DiskByteCount
    return 0;
 }
 
+// static
+BlockFilePtr SilentBlockFile::Get(size_t sampleLen)
+{
+   // Long silences, as in a timer recording or a project with gaps, would
+   // otherwise make an object for every block
+   static std::mutex mutex;
+   static std::unordered_map< size_t, std::weak_ptr<BlockFile> > files;
+
+   std::lock_guard<std::mutex> lock{ mutex };
+   auto result = files[sampleLen].lock();
+   if (!result) {
+      // Lengths of partial blocks vary; forget those no longer used
+      if (files.size() > 256)
+         for (auto iter = files.begin(); iter != files.end();) {
+            if (iter->second.expired())
+               iter = files.erase(iter);
+            else
+               ++iter;
+         }
+      result = make_blockfile<SilentBlockFile>(sampleLen);
+      files[sampleLen] = result;
+   }
+   return result;
+}
@@ -46,6 +46,10 @@ class SilentBlockFile final : public BlockFile {
    void Recover() override { };
 
    static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+   /// A silent block file of this length.  All those in use of one length
+   /// are the same object, as nothing about them can change.
+   static BlockFilePtr Get(size_t sampleLen);
 };
 
 #endif
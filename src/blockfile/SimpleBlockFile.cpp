@@ -26,27 +26,24 @@ supply data and have the constructor write the file.  The other
 is for when the file already exists and we simply want to create
 the data structure to refer to it.
 
-The block file can be cached in two ways. Caching is enabled if the
-preference "/Directories/CacheBlockFiles" is set, otherwise disabled. The
-default is to disable caching.
-
-* Read-caching: If caching is enabled, all block files will always be
-  read-cached. Block files on disk will be read as soon as they are created
-  and held in memory. New block files will be written to disk, but held in
-  memory, so they are never read from disk in the current session.
-
-* Write-caching: If caching is enabled and the parameter allowDeferredWrite
-  is enabled at the block file constructor, NEW block files are held in memory
-  and written to disk only when WriteCacheToDisk() is called. This is used
-  during recording to prevent disk access. After recording, WriteCacheToDisk()
-  will be called on all block files and they will be written to disk. During
-  normal editing, no write cache is active, that is, any block files will be
-  written to disk instantly.
-
-  Even with write cache, auto recovery during normal editing will work as
-  expected. However, auto recovery during recording will not work (not even
-  manual auto recovery, because the files are never written physically to
-  disk).
+Reads of the data and summary go through memory mappings of the .au
+files, held by DirManager in a bounded least-recently-used cache.  The
+libsndfile path is the fallback, for files that can't be mapped or are
+not in the native byte order.
+
+The block file can also be write-cached, if the deprecated preference
+"/Directories/CacheBlockFiles" is set.  Then if the parameter
+allowDeferredWrite is enabled at the block file constructor, NEW block files
+are held in memory and written to disk only when WriteCacheToDisk() is
+called.  This is used during recording to prevent disk access.
+
+Otherwise, blocks made while recording are held in memory only until the
+BlockWriteQueue writes them on its own thread, and then dropped.
+
+Float data whose samples are all exact 16 or 24 bit values, as from
+importing integer files into a float project, are written in that
+narrower encoding unless "/Directories/NarrowFloatBlockFiles" is off.
+Reading converts them back exactly, so nothing else needs to know.
 
 *//****************************************************************//**
 
@@ -67,6 +64,7 @@ to get its definition, rather than rolling our own.
 #include <wx/log.h>
 
 #include "../FileException.h"
+#include "../MappedFile.h"
 #include "../Prefs.h"
 
 #include "../FileFormats.h"
@@ -88,6 +86,78 @@ static wxUint32 SwapUintEndianess(wxUint32 in)
   return out;
 }
 
+namespace {
+
+// Get the mapping of a block file, with its header, if it is in native
+// byte order and one of our formats.  Otherwise return null.
+MappedFilePtr MapBlockFile(
+   const wxFileName &fileName, auHeader &header, sampleFormat &format)
+{
+   auto pFile =
+      DirManager::GetMappedFileCache().Get(fileName.GetFullPath());
+   if (!pFile || pFile->GetSize() < sizeof(auHeader))
+      return {};
+
+   memcpy(&header, pFile->GetData(), sizeof(auHeader));
+   if (header.magic != 0x2e736e64 ||
+       header.dataOffset < sizeof(auHeader) ||
+       header.dataOffset > pFile->GetSize())
+      return {};
+
+   switch (header.encoding) {
+      case AU_SAMPLE_FORMAT_16:
+         format = int16Sample; break;
+      case AU_SAMPLE_FORMAT_24:
+         format = int24Sample; break;
+      case AU_SAMPLE_FORMAT_FLOAT:
+         format = floatSample; break;
+      default:
+         return {};
+   }
+
+   return pFile;
+}
+
+// The narrowest integer format holding all the samples exactly, as
+// BlockFile::ReadData will convert them back, or else floatSample
+sampleFormat NarrowestExactFormat(const float *samples, size_t len)
+{
+   auto result = int16Sample;
+   for (size_t i = 0; i < len; ++i) {
+      // Comparisons are false for NaN, so it stays float
+      if (result == int16Sample) {
+         const float scaled = samples[i] * 32768.0f;
+         if (scaled >= -32768.0f && scaled <= 32767.0f &&
+             scaled == (float)(int)scaled)
+            continue;
+         result = int24Sample;
+      }
+      const float scaled = samples[i] * 8388608.0f;
+      if (!(scaled >= -8388608.0f && scaled <= 8388607.0f &&
+            scaled == (float)(int)scaled))
+         return floatSample;
+   }
+   return result;
+}
+
+// Exact, so without the dithering of CopySamples
+void NarrowSamples(const float *samples, samplePtr dest, sampleFormat format,
+                   size_t len)
+{
+   if (format == int16Sample) {
+      auto out = (short *)dest;
+      for (size_t i = 0; i < len; ++i)
+         out[i] = (short)(samples[i] * 32768.0f);
+   }
+   else {
+      auto out = (int *)dest;
+      for (size_t i = 0; i < len; ++i)
+         out[i] = (int)(samples[i] * 8388608.0f);
+   }
+}
+
+}
+
 /// Constructs a SimpleBlockFile based on sample data and writes
 /// it to disk.
 ///
@@ -109,12 +179,17 @@ SimpleBlockFile::SimpleBlockFile(wxFileNameWrapper &&baseFileName,
    }
 {
    mFormat = format;
+   mNarrowFloat = GetNarrowFloat();
 
    mCache.active = false;
+   mCache.needWrite = false;
+   mCache.writeBehind = false;
 
    bool useCache = GetCache() && (!bypassCache);
+   // DirManager gives the file to the BlockWriteQueue
+   bool writeBehind = allowDeferredWrite && !useCache && !bypassCache;
 
-   if (!(allowDeferredWrite && useCache) && !bypassCache)
+   if (!allowDeferredWrite && !bypassCache)
    {
       bool bSuccess = WriteSimpleBlockFile(sampleData, sampleLen, format, NULL);
       if (!bSuccess)
@@ -122,10 +197,11 @@ SimpleBlockFile::SimpleBlockFile(wxFileNameWrapper &&baseFileName,
             FileException::Cause::Write, GetFileName().name };
    }
 
-   if (useCache) {
+   if (useCache || writeBehind) {
       //wxLogDebug("SimpleBlockFile::SimpleBlockFile(): Caching block file data.");
       mCache.active = true;
       mCache.needWrite = true;
+      mCache.writeBehind = writeBehind;
       mCache.format = format;
       const auto sampleDataSize = sampleLen * SAMPLE_SIZE(format);
       mCache.sampleData.reinit(sampleDataSize);
@@ -155,6 +231,8 @@ SimpleBlockFile::SimpleBlockFile(wxFileNameWrapper &&existingFile, size_t len,
    mRMS = rms;
 
    mCache.active = false;
+   mCache.needWrite = false;
+   mCache.writeBehind = false;
 }
 
 SimpleBlockFile::~SimpleBlockFile()
@@ -167,6 +245,7 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
     sampleFormat format,
     void* summaryData)
 {
+   DirManager::GetMappedFileCache().Invalidate(mFileName.GetFullPath());
    wxFFile file(mFileName.GetFullPath(), wxT("wb"));
    if( !file.IsOpened() ){
       // Can't do anything else.
@@ -189,6 +268,26 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
    // dataSize is optional, and we opt out
    header.dataSize = 0xffffffff;
 
+   // The summary is of the data as given, so they are not narrowed first
+   ArrayOf<char> cleanup;
+   if (!summaryData)
+      summaryData = /*BlockFile::*/CalcSummary(sampleData, sampleLen, format, cleanup);
+      //mchinen:allowing virtual override of calc summary for ODDecodeBlockFile.
+      // PRL: cleanup fixes a possible memory leak!
+
+   SampleBuffer narrowed;
+   if (format == floatSample && mNarrowFloat) {
+      const auto narrowFormat =
+         NarrowestExactFormat((const float *)sampleData, sampleLen);
+      if (narrowFormat != floatSample) {
+         narrowed.Allocate(sampleLen, narrowFormat);
+         NarrowSamples((const float *)sampleData, narrowed.ptr(), narrowFormat,
+                       sampleLen);
+         sampleData = narrowed.ptr();
+         format = narrowFormat;
+      }
+   }
+
    switch(format) {
       case int16Sample:
          header.encoding = AU_SAMPLE_FORMAT_16;
@@ -210,12 +309,6 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
    header.channels = 1;
 
    // Write the file
-   ArrayOf<char> cleanup;
-   if (!summaryData)
-      summaryData = /*BlockFile::*/CalcSummary(sampleData, sampleLen, format, cleanup);
-      //mchinen:allowing virtual override of calc summary for ODDecodeBlockFile.
-      // PRL: cleanup fixes a possible memory leak!
-
    size_t nBytesToWrite = sizeof(header);
    size_t nBytesWritten = file.Write(&header, nBytesToWrite);
    if (nBytesWritten != nBytesToWrite)
@@ -236,23 +329,15 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
    {
       // we can't write the buffer directly to disk, because 24-bit samples
       // on disk need to be packed, not padded to 32 bits like they are in
-      // memory
-      int *int24sampleData = (int*)sampleData;
-
-      for( size_t i = 0; i < sampleLen; i++ )
+      // memory; pack them all, then write once
+      ArrayOf<unsigned char> packed{ sampleLen * 3 };
+      PackInt24((const int*)sampleData, packed.get(), sampleLen);
+      nBytesToWrite = sampleLen * 3;
+      nBytesWritten = file.Write(packed.get(), nBytesToWrite);
+      if (nBytesWritten != nBytesToWrite)
       {
-         nBytesToWrite = 3;
-         nBytesWritten =
-            #if wxBYTE_ORDER == wxBIG_ENDIAN
-               file.Write((char*)&int24sampleData[i] + 1, nBytesToWrite);
-            #else
-               file.Write((char*)&int24sampleData[i], nBytesToWrite);
-            #endif
-         if (nBytesWritten != nBytesToWrite)
-         {
-            wxLogDebug(wxT("Wrote %lld bytes, expected %lld."), (long long) nBytesWritten, (long long) nBytesToWrite);
-            return false;
-         }
+         wxLogDebug(wxT("Wrote %lld bytes, expected %lld."), (long long) nBytesWritten, (long long) nBytesToWrite);
+         return false;
       }
    }
    else
@@ -268,75 +353,10 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
       }
    }
 
-   return true;
-}
-
-// This function should try to fill the cache, but just return without effect
-// (not throwing) if there is failure.
-void SimpleBlockFile::FillCache()
-{
-   if (mCache.active)
-      return; // cache is already filled
-
-   // Check sample format
-   wxFFile file(mFileName.GetFullPath(), wxT("rb"));
-   if (!file.IsOpened())
-   {
-      // Don't read into cache if file not available
-      return;
-   }
-
-   auHeader header;
-
-   if (file.Read(&header, sizeof(header)) != sizeof(header))
-   {
-      // Corrupt file
-      return;
-   }
-
-   wxUint32 encoding;
-
-   if (header.magic == 0x2e736e64)
-      encoding = header.encoding; // correct endianness
-   else
-      encoding = SwapUintEndianess(header.encoding);
-
-   switch (encoding)
-   {
-   case AU_SAMPLE_FORMAT_16:
-      mCache.format = int16Sample;
-      break;
-   case AU_SAMPLE_FORMAT_24:
-      mCache.format = int24Sample;
-      break;
-   default:
-      // floatSample is a safe default (we will never loose data)
-      mCache.format = floatSample;
-      break;
-   }
-
-   file.Close();
-
-   // Read samples into cache
-   mCache.sampleData.reinit(mLen * SAMPLE_SIZE(mCache.format));
-   if (ReadData(mCache.sampleData.get(), mCache.format, 0, mLen,
-                // no exceptions!
-                false) != mLen)
-   {
-      // Could not read all samples
-      mCache.sampleData.reset();
-      return;
-   }
-
-   // Read summary data into cache
-   // Fills with zeroes in case of failure:
-   ReadSummary(mCache.summaryData);
-
-   // Cache is active but already on disk
-   mCache.active = true;
-   mCache.needWrite = false;
+   // Space usage is of the encoding actually written
+   mFormat = format;
 
-   //wxLogDebug("SimpleBlockFile::FillCache(): Succesfully read simple block file into cache.");
+   return true;
 }
 
 /// Read the summary section of the disk file.
@@ -347,10 +367,17 @@ bool SimpleBlockFile::ReadSummary(ArrayOf<char> &data)
 {
    data.reinit( mSummaryInfo.totalSummaryBytes );
    if (mCache.active) {
-      //wxLogDebug("SimpleBlockFile::ReadSummary(): Summary is already in cache.");
-      memcpy(data.get(), mCache.summaryData.get(), mSummaryInfo.totalSummaryBytes);
-      return true;
+      std::lock_guard<std::mutex> lock{ mCacheMutex };
+      // Check again:  the writer may have just dropped the cache
+      if (mCache.active) {
+         //wxLogDebug("SimpleBlockFile::ReadSummary(): Summary is already in cache.");
+         memcpy(data.get(), mCache.summaryData.get(), mSummaryInfo.totalSummaryBytes);
+         return true;
+      }
    }
+
+   if (ReadMappedSummary(data))
+      return true;
    else
    {
       //wxLogDebug("SimpleBlockFile::ReadSummary(): Reading summary from disk.");
@@ -397,26 +424,119 @@ size_t SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
 {
    if (mCache.active)
    {
-      //wxLogDebug("SimpleBlockFile::ReadData(): Data are already in cache.");
-
-      auto framesRead = std::min(len, std::max(start, mLen) - start);
-      CopySamples(
-         (samplePtr)(mCache.sampleData.get() +
-            start * SAMPLE_SIZE(mCache.format)),
-         mCache.format, data, format, framesRead);
-
-      if ( framesRead < len ) {
-         if (mayThrow)
-            // Not the best exception class?
-            throw FileException{ FileException::Cause::Read, mFileName };
-         ClearSamples(data, format, framesRead, len - framesRead);
+      std::unique_lock<std::mutex> lock{ mCacheMutex };
+      // Check again:  the writer may have just dropped the cache
+      if (mCache.active) {
+         //wxLogDebug("SimpleBlockFile::ReadData(): Data are already in cache.");
+
+         auto framesRead = std::min(len, std::max(start, mLen) - start);
+         CopySamples(
+            (samplePtr)(mCache.sampleData.get() +
+               start * SAMPLE_SIZE(mCache.format)),
+            mCache.format, data, format, framesRead);
+         lock.unlock();
+
+         if ( framesRead < len ) {
+            if (mayThrow)
+               // Not the best exception class?
+               throw FileException{ FileException::Cause::Read, mFileName };
+            ClearSamples(data, format, framesRead, len - framesRead);
+         }
+
+         return framesRead;
       }
+   }
 
+   size_t framesRead;
+   if (ReadMappedData(data, format, start, len, mayThrow, framesRead))
       return framesRead;
+   return CommonReadData( mayThrow,
+      mFileName, mSilentLog, nullptr, 0, 0, data, format, start, len);
+}
+
+void SimpleBlockFile::Prefetch(bool summaryOnly) const
+{
+   if (mCache.active)
+      return;
+
+   const auto pFile =
+      DirManager::GetMappedFileCache().Get(mFileName.GetFullPath());
+   if (!pFile)
+      return;
+
+   const auto size = pFile->GetSize();
+   const auto end = summaryOnly
+      ? std::min(size, sizeof(auHeader) + mSummaryInfo.totalSummaryBytes)
+      : size;
+
+   // Reading one byte of a page brings in all of it
+   enum { PageSize = 4096 };
+   const auto data = pFile->GetData();
+   volatile char sink = 0;
+   for (size_t pos = 0; pos < end; pos += PageSize)
+      sink = sink + data[pos];
+}
+
+bool SimpleBlockFile::ReadMappedSummary(ArrayOf<char> &data)
+{
+   auHeader header;
+   sampleFormat diskFormat;
+   auto pFile = MapBlockFile(mFileName, header, diskFormat);
+   if (!pFile ||
+       pFile->GetSize() < sizeof(auHeader) + mSummaryInfo.totalSummaryBytes)
+      return false;
+
+   // The offset is just past the au header
+   memcpy(data.get(), pFile->GetData() + sizeof(auHeader),
+          mSummaryInfo.totalSummaryBytes);
+   mSilentLog = FALSE;
+
+   FixSummary(data.get());
+   return true;
+}
+
+bool SimpleBlockFile::ReadMappedData(samplePtr data, sampleFormat format,
+   size_t start, size_t len, bool mayThrow, size_t &framesRead) const
+{
+   auHeader header;
+   sampleFormat diskFormat;
+   auto pFile = MapBlockFile(mFileName, header, diskFormat);
+   if (!pFile)
+      return false;
+
+   mFormat = diskFormat;
+   const auto diskSampleSize = SAMPLE_SIZE_DISK(diskFormat);
+   const auto available =
+      (pFile->GetSize() - header.dataOffset) / diskSampleSize;
+   framesRead = std::min(len, std::max(start, available) - start);
+
+   const auto src = pFile->GetData() + header.dataOffset +
+      start * diskSampleSize;
+   if (diskFormat != int24Sample)
+      // Directly from the mapping; only a memcpy if the formats match
+      CopySamples((samplePtr)src, diskFormat, data, format, framesRead);
+   else {
+      // 24-bit samples on disk are packed, not padded to 32 bits as
+      // in memory
+      ArrayOf<int> unpacked;
+      int *dest = (int *)data;
+      if (format != int24Sample) {
+         unpacked.reinit(framesRead);
+         dest = unpacked.get();
+      }
+      UnpackInt24((const unsigned char *)src, dest, framesRead);
+      if (format != int24Sample)
+         CopySamples((samplePtr)dest, int24Sample, data, format, framesRead);
    }
-   else
-      return CommonReadData( mayThrow,
-         mFileName, mSilentLog, nullptr, 0, 0, data, format, start, len);
+
+   if ( framesRead < len ) {
+      if (mayThrow)
+         throw FileException{ FileException::Cause::Read, mFileName };
+      ClearSamples(data, format, framesRead, len - framesRead);
+   }
+
+   mSilentLog = FALSE;
+   return true;
 }
 
 void SimpleBlockFile::SaveXML(XMLWriter &xmlFile)
@@ -551,6 +671,7 @@ auto SimpleBlockFile::GetSpaceUsage() const -> DiskByteCount
 }
 
 void SimpleBlockFile::Recover(){
+   DirManager::GetMappedFileCache().Invalidate(mFileName.GetFullPath());
    wxFFile file(mFileName.GetFullPath(), wxT("wb"));
 
    if( !file.IsOpened() ){
@@ -580,12 +701,25 @@ void SimpleBlockFile::Recover(){
 
 void SimpleBlockFile::WriteCacheToDisk()
 {
+   std::lock_guard<std::mutex> writeLock{ mWriteMutex };
    if (!GetNeedWriteCacheToDisk())
       return;
 
-   if (WriteSimpleBlockFile(mCache.sampleData.get(), mLen, mCache.format,
-                            mCache.summaryData.get()))
-      mCache.needWrite = false;
+   // Readers still use the cache while the file is written, because only
+   // this thread could drop it
+   if (!WriteSimpleBlockFile(mCache.sampleData.get(), mLen, mCache.format,
+                             mCache.summaryData.get()))
+      return;
+
+   mCache.needWrite = false;
+
+   if (mCache.writeBehind) {
+      // The file is complete, so readers may go to it now
+      std::lock_guard<std::mutex> lock{ mCacheMutex };
+      mCache.active = false;
+      mCache.sampleData.reset();
+      mCache.summaryData.reset();
+   }
 }
 
 bool SimpleBlockFile::GetNeedWriteCacheToDisk()
@@ -593,6 +727,13 @@ bool SimpleBlockFile::GetNeedWriteCacheToDisk()
    return mCache.active && mCache.needWrite;
 }
 
+bool SimpleBlockFile::GetNarrowFloat()
+{
+   bool narrow = true;
+   gPrefs->Read(wxT("/Directories/NarrowFloatBlockFiles"), &narrow, true);
+   return narrow;
+}
+
 bool SimpleBlockFile::GetCache()
 {
 #ifdef DEPRECATED_AUDIO_CACHE
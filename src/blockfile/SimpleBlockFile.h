@@ -11,6 +11,8 @@
 #ifndef __AUDACITY_SIMPLE_BLOCKFILE__
 #define __AUDACITY_SIMPLE_BLOCKFILE__
 
+#include <atomic>
+#include <mutex>
 #include <wx/string.h>
 #include <wx/filename.h>
 
@@ -19,8 +21,12 @@
 #include "../xml/XMLWriter.h"
 
 struct SimpleBlockFileCache {
-   bool active;
-   bool needWrite;
+   // May change on the thread of the BlockWriteQueue
+   std::atomic<bool> active;
+   std::atomic<bool> needWrite;
+   // Whether the data are dropped once written; not so for the deprecated
+   // cache
+   bool writeBehind;
    sampleFormat format;
    ArrayOf<char> sampleData, summaryData;
 
@@ -64,6 +70,8 @@ class PROFILE_DLL_API SimpleBlockFile /* not final */ : public BlockFile {
 
    /// Read the summary section of the disk file
    bool ReadSummary(ArrayOf<char> &data) override;
+   /// Faults in the pages of the memory mapping
+   void Prefetch(bool summaryOnly) const override;
    /// Read the data section of the disk file
    size_t ReadData(samplePtr data, sampleFormat format,
                         size_t start, size_t len, bool mayThrow) const override;
@@ -79,20 +87,36 @@ class PROFILE_DLL_API SimpleBlockFile /* not final */ : public BlockFile {
    static BlockFilePtr BuildFromXML(DirManager &dm, const wxChar **attrs);
 
    bool GetNeedWriteCacheToDisk() override;
+   // May be called on any thread
    void WriteCacheToDisk() override;
 
-   bool GetNeedFillCache() override { return !mCache.active; }
-
-   void FillCache() /* noexcept */ override;
+   // Whether the file is still to be written by the BlockWriteQueue
+   bool GetNeedWriteBehind() const
+   { return mCache.writeBehind && mCache.needWrite; }
 
  protected:
 
    bool WriteSimpleBlockFile(samplePtr sampleData, size_t sampleLen,
                              sampleFormat format, void* summaryData);
    static bool GetCache();
-   void ReadIntoCache();
+   // Whether float data that are all exact 16 or 24 bit values are written
+   // in the narrower encoding; they read back unchanged
+   static bool GetNarrowFloat();
+
+   // Fast paths reading through DirManager's memory mappings; they return
+   // false if the file can't be mapped, and the slower paths must be tried
+   bool ReadMappedSummary(ArrayOf<char> &data);
+   bool ReadMappedData(samplePtr data, sampleFormat format,
+                       size_t start, size_t len, bool mayThrow,
+                       size_t &framesRead) const;
 
    SimpleBlockFileCache mCache;
+   // Keeps the cached data from being dropped while they are read
+   mutable std::mutex mCacheMutex;
+   // Only one thread writes the file
+   std::mutex mWriteMutex;
+   // Found when constructed, because the file may be written on another thread
+   bool mNarrowFloat{ false };
 
  private:
    mutable sampleFormat mFormat; // may be found lazily
@@ -192,7 +192,6 @@ void CommandBuilder::BuildCommand(const wxString &cmdStringArg)
    int splitAt = cmdString.Find(wxT(':'));
    if (splitAt < 0 && cmdString.Find(wxT(' ')) >= 0) {
       mError = wxT("Command is missing ':'");
-      ScriptCommandRelay::SendResponse(wxT("\n"));
       mValid = false;
       return;
    }
@@ -225,11 +225,33 @@ public:
 };
 
 /// Adds messages to a response queue (to be sent back to a script)
+/// Long output goes in chunks of whole lines as it is made, so that the
+/// script thread converts and collects it while the command runs on.  The
+/// receiver ends each response with a newline, so a chunk ends just
+/// before one, which is not sent.
 class ResponseQueueTarget final : public CommandMessageTarget
 {
 private:
+   enum { ChunkLength = 64 * 1024 };
    ResponseQueue &mResponseQueue;
    wxString mBuffer;
+   bool mSent{ false };
+
+   void SendLines()
+   {
+      const auto end = mBuffer.rfind( wxT('\n') );
+      if( end == wxString::npos || end == 0 )
+         return;
+      wxString lines = mBuffer.Left( end );
+      if( !mSent && lines.StartsWith("\n" ) )
+         lines = lines.Mid( 1 );
+      if( lines == wxT("\n") )
+         // That would end the response early
+         return;
+      mBuffer = mBuffer.Mid( end + 1 );
+      mResponseQueue.AddResponse( lines );
+      mSent = true;
+   }
 public:
    ResponseQueueTarget(ResponseQueue &responseQueue)
       : mResponseQueue(responseQueue),
@@ -237,7 +259,7 @@ public:
    { }
    virtual ~ResponseQueueTarget()
    {
-      if( mBuffer.StartsWith("\n" ) )
+      if( !mSent && mBuffer.StartsWith("\n" ) )
          mBuffer = mBuffer.Mid( 1 );
       mResponseQueue.AddResponse( mBuffer  );
       mResponseQueue.AddResponse(wxString(wxT("\n")));
@@ -245,9 +267,8 @@ public:
    void Update(const wxString &message) override
    {
       mBuffer += message;
-#if 0
-         mResponseQueue.AddResponse(message);
-#endif
+      if( mBuffer.length() >= ChunkLength )
+         SendLines();
    }
 };
 
@@ -20,13 +20,21 @@ threshold of difference in two selected tracks
 
 #include "../Audacity.h"
 #include "CompareAudioCommand.h"
+#include "../BlockFile.h"
 #include "../MemoryX.h"
 #include "../Project.h"
+#include "../Sequence.h"
+#include "../TaskScheduler.h"
+#include "../WaveClip.h"
 #include "../WaveTrack.h"
 #include "Command.h"
 
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <float.h>
+#include <thread>
 #include <wx/intl.h>
 
 #include "../ShuttleGui.h"
@@ -35,6 +43,17 @@ threshold of difference in two selected tracks
 #include "../SampleFormat.h"
 #include "CommandContext.h"
 
+// SSE2 is part of every x86-64 processor, and NEON with doubles of every
+// AArch64 processor, so no run time test is needed for either
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COMPARE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define COMPARE_NEON
+#include <arm_neon.h>
+#endif
+
 extern void RegisterCompareAudio( Registrar & R){
    R.AddCommand( std::make_unique<CompareAudioCommand>() );
 // std::unique_ptr<CommandOutputTargets> &&target
@@ -44,6 +63,7 @@ extern void RegisterCompareAudio( Registrar & R){
 
 bool CompareAudioCommand::DefineParams( ShuttleParams & S ){
    S.Define( errorThreshold,  wxT("Threshold"),   0.0f,  0.0f,    0.01f,    1.0f );
+   S.Define( mStopAtFirst,    wxT("StopAtFirst"), false );
    return true;
 }
 
@@ -58,6 +78,7 @@ void CompareAudioCommand::PopulateOrExchange(ShuttleGui & S)
    S.StartMultiColumn(2, wxALIGN_CENTER);
    {
       S.TieTextBox(_("Threshold:"),errorThreshold);
+      S.TieCheckBox(_("Stop at first difference:"), mStopAtFirst);
    }
    S.EndMultiColumn();
 }
@@ -101,9 +122,134 @@ double CompareAudioCommand::CompareSample(double value1, double value2)
    return fabs(value1 - value2);
 }
 
-inline int min(int a, int b)
+namespace {
+
+// Samples of the range that one thread compares at a time
+const size_t ChunkBlocks = 4;
+
+struct Differences
+{
+   size_t count{ 0 };
+   // Index of the first, or the length compared if none
+   size_t first;
+};
+
+// As CompareSample, counts where |a - b| > threshold, in double, so that
+// the vector loops agree exactly with the scalar loop
+Differences CountDifferences(
+   const float *a, const float *b, size_t len, double threshold,
+   bool stopAtFirst)
+{
+   Differences result;
+   result.first = len;
+   size_t ii = 0;
+
+#if defined(COMPARE_SSE2)
+   const __m128d limit = _mm_set1_pd(threshold);
+   const __m128d signMask = _mm_set1_pd(-0.0);
+   for (; ii + 4 <= len; ii += 4) {
+      const __m128 fa = _mm_loadu_ps(a + ii);
+      const __m128 fb = _mm_loadu_ps(b + ii);
+      const __m128d dLow = _mm_sub_pd(_mm_cvtps_pd(fa), _mm_cvtps_pd(fb));
+      const __m128d dHigh = _mm_sub_pd(
+         _mm_cvtps_pd(_mm_movehl_ps(fa, fa)),
+         _mm_cvtps_pd(_mm_movehl_ps(fb, fb)));
+      const int mask =
+         _mm_movemask_pd(_mm_cmpgt_pd(_mm_andnot_pd(signMask, dLow), limit)) |
+         (_mm_movemask_pd(
+            _mm_cmpgt_pd(_mm_andnot_pd(signMask, dHigh), limit)) << 2);
+      if (mask) {
+         if (result.count == 0)
+            for (int bit = 0; bit < 4; ++bit)
+               if (mask & (1 << bit)) {
+                  result.first = ii + bit;
+                  break;
+               }
+         if (stopAtFirst) {
+            result.count = 1;
+            return result;
+         }
+         result.count += (mask & 1) + ((mask >> 1) & 1) +
+            ((mask >> 2) & 1) + ((mask >> 3) & 1);
+      }
+   }
+#elif defined(COMPARE_NEON)
+   const float64x2_t limit = vdupq_n_f64(threshold);
+   for (; ii + 4 <= len; ii += 4) {
+      const float32x4_t fa = vld1q_f32(a + ii);
+      const float32x4_t fb = vld1q_f32(b + ii);
+      const float64x2_t dLow = vabdq_f64(
+         vcvt_f64_f32(vget_low_f32(fa)), vcvt_f64_f32(vget_low_f32(fb)));
+      const float64x2_t dHigh = vabdq_f64(
+         vcvt_high_f64_f32(fa), vcvt_high_f64_f32(fb));
+      const uint64x2_t over0 = vcgtq_f64(dLow, limit);
+      const uint64x2_t over1 = vcgtq_f64(dHigh, limit);
+      // Each lane is all ones or zero
+      const unsigned count =
+         (vgetq_lane_u64(over0, 0) & 1) + (vgetq_lane_u64(over0, 1) & 1) +
+         (vgetq_lane_u64(over1, 0) & 1) + (vgetq_lane_u64(over1, 1) & 1);
+      if (count) {
+         if (result.count == 0) {
+            result.first = ii +
+               (vgetq_lane_u64(over0, 0) ? 0
+               : vgetq_lane_u64(over0, 1) ? 1
+               : vgetq_lane_u64(over1, 0) ? 2 : 3);
+         }
+         if (stopAtFirst) {
+            result.count = 1;
+            return result;
+         }
+         result.count += count;
+      }
+   }
+#endif
+
+   for (; ii < len; ++ii) {
+      if (fabs(double(a[ii]) - double(b[ii])) > threshold) {
+         if (result.count == 0)
+            result.first = ii;
+         ++result.count;
+         if (stopAtFirst)
+            break;
+      }
+   }
+   return result;
+}
+
+// The block of a clip of the track that holds the sample at pos, and the
+// track position of its first sample, or a null block if the sample is in
+// no block
+struct TrackBlock
+{
+   const BlockFile *file{ nullptr };
+   sampleCount start{ 0 };
+   size_t len{ 0 };
+};
+
+TrackBlock FindTrackBlock(const WaveTrack &track, sampleCount pos)
 {
-   return (a < b) ? a : b;
+   TrackBlock result;
+   for (const auto &clip : track.GetClips()) {
+      const auto clipStart = clip->GetStartSample();
+      const auto clipEnd = clipStart + clip->GetSequence()->GetNumSamples();
+      if (pos < clipStart || pos >= clipEnd)
+         continue;
+      const auto &blocks = clip->GetSequence()->GetBlockArray();
+      const auto where = pos - clipStart;
+      auto it = std::upper_bound(blocks.begin(), blocks.end(), where,
+         [](sampleCount value, const SeqBlock &block) {
+            return value < block.start; });
+      if (it == blocks.begin())
+         break;
+      --it;
+      result.file = it->f.get();
+      result.start = clipStart + it->start;
+      result.len = it->f->GetLength();
+      break;
+   }
+   return result;
+}
+
 }
 
 bool CompareAudioCommand::Apply(const CommandContext & context)
@@ -118,46 +264,114 @@ bool CompareAudioCommand::Apply(const CommandContext & context)
       + mTrack1->GetName() + wxT("'.");
    context.Status(msg);
 
-   long errorCount = 0;
-   // Initialize buffers for track data to be analyzed
-   auto buffSize = std::min(mTrack0->GetMaxBlockSize(), mTrack1->GetMaxBlockSize());
+   // Compare tracks in chunks of a few blocks, on all processors.  Where
+   // both tracks hold the same block file at the same place, as after a
+   // copy, or because the files are of identical samples, equality needs no
+   // reading.
+   const auto s0 = mTrack0->TimeToLongSamples(mT0);
+   const auto s1 = mTrack0->TimeToLongSamples(mT1);
+   const auto length = s1 - s0;
+   const auto maxBlock =
+      std::max(mTrack0->GetMaxBlockSize(), mTrack1->GetMaxBlockSize());
+   const auto chunkSize = ChunkBlocks * maxBlock;
+   const auto nChunks =
+      ((length + chunkSize - 1) / chunkSize).as_size_t();
 
-   Floats buff0{ buffSize };
-   Floats buff1{ buffSize };
+   std::atomic<long> errorCount{ 0 };
+   std::atomic<bool> found{ false };
+   std::atomic<size_t> done{ 0 };
+   // The first difference of each chunk, if any
+   std::vector<sampleCount> firsts(nChunks, s1);
 
-   // Compare tracks block by block
-   auto s0 = mTrack0->TimeToLongSamples(mT0);
-   auto s1 = mTrack0->TimeToLongSamples(mT1);
-   auto position = s0;
-   auto length = s1 - s0;
-   while (position < s1)
-   {
-      // Get a block of data into the buffers
-      auto block = limitSampleBufferSize(
-         mTrack0->GetBestBlockSize(position), s1 - position
-      );
-      mTrack0->Get((samplePtr)buff0.get(), floatSample, position, block);
-      mTrack1->Get((samplePtr)buff1.get(), floatSample, position, block);
-
-      for (decltype(block) buffPos = 0; buffPos < block; ++buffPos)
-      {
-         if (CompareSample(buff0[buffPos], buff1[buffPos]) > errorThreshold)
-         {
-            ++errorCount;
+   const auto compareChunk = [&](size_t chunk) {
+      if (mStopAtFirst && found.load())
+         return;
+      const auto chunkStart = s0 + chunk * sampleCount{ chunkSize };
+      const auto chunkEnd = std::min(s1, chunkStart + chunkSize);
+      Floats buff0{ maxBlock };
+      Floats buff1{ maxBlock };
+
+      auto position = chunkStart;
+      while (position < chunkEnd) {
+         if (mStopAtFirst && found.load())
+            return;
+
+         const auto block0 = FindTrackBlock(*mTrack0, position);
+         const auto block1 = FindTrackBlock(*mTrack1, position);
+         if (block0.file && block0.file == block1.file &&
+             block0.start == block1.start) {
+            position = std::min(chunkEnd, block0.start + block0.len);
+            continue;
          }
+
+         // Up to the next block boundary of either track
+         auto end = std::min(chunkEnd, position + maxBlock);
+         if (block0.file)
+            end = std::min(end, block0.start + block0.len);
+         if (block1.file)
+            end = std::min(end, block1.start + block1.len);
+         const auto len = (end - position).as_size_t();
+
+         mTrack0->Get((samplePtr)buff0.get(), floatSample, position, len);
+         mTrack1->Get((samplePtr)buff1.get(), floatSample, position, len);
+         const auto differences = CountDifferences(
+            buff0.get(), buff1.get(), len, errorThreshold, mStopAtFirst);
+         if (differences.count > 0) {
+            if (firsts[chunk] == s1)
+               firsts[chunk] = position + differences.first;
+            errorCount += differences.count;
+            found.store(true);
+            if (mStopAtFirst)
+               return;
+         }
+         position = end;
       }
+      ++done;
+   };
+
+   {
+      auto &scheduler = TaskScheduler::Get();
 
-      position += block;
-      context.Progress(
-         (position - s0).as_double() /
-         length.as_double()
-      );
+      // The loop runs on another thread, so that this one can show progress
+      std::exception_ptr exception;
+      std::atomic<bool> finished{ false };
+      std::thread runner{ [&] {
+         try {
+            scheduler.ParallelFor(TaskScheduler::Interactive, nChunks, compareChunk);
+         }
+         catch (...) {
+            exception = std::current_exception();
+         }
+         finished.store(true);
+      } };
+      while (!finished.load()) {
+         context.Progress( nChunks ? double(done.load()) / nChunks : 1.0 );
+         std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+      runner.join();
+      if (exception)
+         std::rethrow_exception(exception);
    }
 
+   const auto first = firsts.empty()
+      ? s1 : *std::min_element(firsts.begin(), firsts.end());
+   // Stopping early, other chunks may have found theirs at the same time
+   if (mStopAtFirst)
+      errorCount = found.load() ? 1 : 0;
+
    // Output the results
-   double errorSeconds = mTrack0->LongSamplesToTime(errorCount);
-   context.Status(wxString::Format(wxT("%li"), errorCount));
+   const long count = errorCount.load();
+   double errorSeconds = mTrack0->LongSamplesToTime(count);
+   context.Status(wxString::Format(wxT("%li"), count));
    context.Status(wxString::Format(wxT("%.4f"), errorSeconds));
-   context.Status(wxString::Format(wxT("Finished comparison: %li samples (%.3f seconds) exceeded the error threshold of %f."), errorCount, errorSeconds, errorThreshold));
+   if (count > 0)
+      context.Status(wxString::Format(wxT("First difference at %.6f seconds."),
+         mTrack0->LongSamplesToTime(first)));
+   if (mStopAtFirst)
+      context.Status(count > 0
+         ? wxString(wxT("Stopped at the first difference."))
+         : wxString::Format(wxT("Finished comparison: no samples exceeded the error threshold of %f."), errorThreshold));
+   else
+      context.Status(wxString::Format(wxT("Finished comparison: %li samples (%.3f seconds) exceeded the error threshold of %f."), count, errorSeconds, errorThreshold));
    return true;
 }
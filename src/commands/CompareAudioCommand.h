@@ -42,6 +42,7 @@ public:
 
 private:
    double errorThreshold;
+   bool mStopAtFirst{ false };
    double mT0, mT1;
    const WaveTrack *mTrack0;
    const WaveTrack *mTrack1;
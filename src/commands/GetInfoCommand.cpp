@@ -17,11 +17,18 @@ This class now lists
 - Clips
 - Labels
 - Boxes
+- Audio I/O telemetry
+- On-demand tasks
+- Memory use, by subsystem
 
 *//*******************************************************************/
 
 #include "../Audacity.h"
 #include "GetInfoCommand.h"
+#include <float.h>
+#include <limits.h>
+#include "../AudioIO.h"
+#include "../ondemand/ODManager.h"
 #include "../Project.h"
 #include "CommandManager.h"
 #include "../effects/EffectManager.h"
@@ -32,6 +39,7 @@ This class now lists
 #include "../WaveTrack.h"
 #include "../LabelTrack.h"
 #include "../Envelope.h"
+#include "../MemoryUse.h"
 #include "CommandContext.h"
 
 #include "SelectCommand.h"
@@ -52,6 +60,9 @@ enum {
    kEnvelopes,
    kLabels,
    kBoxes,
+   kAudioIO,
+   kODTasks,
+   kMemory,
    nTypes
 };
 
@@ -66,6 +77,9 @@ static const IdentInterfaceSymbol kTypes[nTypes] =
    { XO("Envelopes") },
    { XO("Labels") },
    { XO("Boxes") },
+   { wxT("AudioIO"), XO("Audio I/O") },
+   { wxT("ODTasks"), XO("On-Demand Tasks") },
+   { XO("Memory") },
 };
 
 enum {
@@ -91,6 +105,12 @@ static const IdentInterfaceSymbol kFormats[nFormats] =
 bool GetInfoCommand::DefineParams( ShuttleParams & S ){
    S.DefineEnum( mInfoType, wxT("Type"), 0, kTypes, nTypes );
    S.DefineEnum( mFormat, wxT("Format"), 0, kFormats, nFormats );
+   S.OptionalN( bHasT0 ).Define( mT0, wxT("Start"), 0.0, 0.0, (double)FLT_MAX);
+   S.OptionalN( bHasT1 ).Define( mT1, wxT("End"), 0.0, 0.0, (double)FLT_MAX);
+   S.OptionalN( bHasFirstTrack ).Define( mFirstTrack, wxT("Track"), 0, 0, INT_MAX);
+   S.OptionalN( bHasNumTracks ).Define( mNumTracks, wxT("TrackCount"), 1, 0, INT_MAX);
+   S.OptionalN( bHasOffset ).Define( mOffset, wxT("Offset"), 0, 0, INT_MAX);
+   S.OptionalN( bHasLimit ).Define( mLimit, wxT("Limit"), 1000, 0, INT_MAX);
    return true;
 }
 
@@ -106,6 +126,17 @@ void GetInfoCommand::PopulateOrExchange(ShuttleGui & S)
       S.TieChoice( _("Format:"), mFormat, &formats);
    }
    S.EndMultiColumn();
+   S.StartMultiColumn(3, wxEXPAND);
+   {
+      S.SetStretchyCol( 2 );
+      S.Optional( bHasT0 ).TieTextBox(_("Start Time:"), mT0);
+      S.Optional( bHasT1 ).TieTextBox(_("End Time:"), mT1);
+      S.Optional( bHasFirstTrack ).TieTextBox(_("First Track:"), mFirstTrack);
+      S.Optional( bHasNumTracks ).TieTextBox(_("Track Count:"), mNumTracks);
+      S.Optional( bHasOffset ).TieTextBox(_("Offset:"), mOffset);
+      S.Optional( bHasLimit ).TieTextBox(_("Limit:"), mLimit);
+   }
+   S.EndMultiColumn();
 }
 
 bool GetInfoCommand::Apply(const CommandContext &context)
@@ -146,12 +177,108 @@ bool GetInfoCommand::ApplyInner(const CommandContext &context)
       case kEnvelopes    : return SendEnvelopes( context );
       case kLabels       : return SendLabels( context );
       case kBoxes        : return SendBoxes( context );
+      case kAudioIO      : return SendAudioIO( context );
+      case kODTasks      : return SendODTasks( context );
+      case kMemory       : return SendMemory( context );
       default:
          context.Status( "Command options not recognised" );
    }
    return false;
 }
 
+bool GetInfoCommand::SendAudioIO(const CommandContext &context)
+{
+   const auto telemetry = gAudioIO->GetTelemetry();
+   const auto addArray = [&](const unsigned long long *counts, size_t n,
+                             const wxString &name) {
+      context.StartField( name );
+      context.StartArray();
+      for (size_t ii = 0; ii < n; ++ii)
+         context.AddItem( (double)counts[ii] );
+      context.EndArray();
+      context.EndField();
+   };
+
+   context.StartStruct();
+   context.AddItem( (double)telemetry.callbacks, "callbacks" );
+   context.AddItem( telemetry.maxCallbackMillis, "maxcallbackms" );
+   addArray( telemetry.callbackLoad, AudioIO::Telemetry::nLoadBuckets,
+      "callbackload" );
+   addArray( telemetry.playbackFill, AudioIO::Telemetry::nFillBuckets,
+      "playbackfill" );
+   addArray( telemetry.captureFill, AudioIO::Telemetry::nFillBuckets,
+      "capturefill" );
+   addArray( telemetry.fillBuffersMillis,
+      AudioIO::Telemetry::nFillBuffersBuckets, "fillbuffersms" );
+   context.AddItem( telemetry.maxFillBuffersMillis, "maxfillbuffersms" );
+   context.AddItem( (double)telemetry.playbackUnderruns, "playbackunderruns" );
+   context.AddItem( (double)telemetry.captureOverruns, "captureoverruns" );
+   context.AddItem( (double)telemetry.deviceUnderflows, "deviceunderflows" );
+   context.AddItem( (double)telemetry.deviceOverflows, "deviceoverflows" );
+   context.AddItem( (double)telemetry.lostSamples, "lostsamples" );
+   context.AddItem( telemetry.inputLatencyMillis, "inputlatencyms" );
+   context.AddItem( telemetry.outputLatencyMillis, "outputlatencyms" );
+   context.AddItem( telemetry.lastDriftMillis, "driftms" );
+   context.AddItem( telemetry.maxDriftMillis, "maxdriftms" );
+   context.AddItem( telemetry.monitorLatencyMillis, "monitorlatencyms" );
+   context.AddItem( (double)telemetry.midiEvents, "midievents" );
+   context.AddItem( (double)telemetry.midiLateEvents, "midilateevents" );
+   context.AddItem( telemetry.minMidiLeadMillis, "minmidileadms" );
+   context.AddItem( (double)telemetry.midiWakes, "midiwakes" );
+   context.AddItem( telemetry.meanMidiWakeMillis, "meanmidiwakems" );
+   context.AddItem( telemetry.maxMidiWakeMillis, "maxmidiwakems" );
+   context.AddItem( telemetry.nullAudioSeconds, "nullaudioseconds" );
+   context.AddItem( telemetry.nullWallSeconds, "nullwallseconds" );
+   context.AddItem( telemetry.nullCallbackSeconds, "nullcallbackseconds" );
+   context.AddItem( (double)telemetry.playbackTracks, "playbacktracks" );
+   context.AddItem( (double)telemetry.fillThreads, "fillthreads" );
+   context.AddItem( telemetry.tracksPerCore, "trackspercore" );
+   context.EndStruct();
+   return true;
+}
+
+bool GetInfoCommand::SendODTasks(const CommandContext &context)
+{
+   std::vector<ODManager::TaskStatistics> tasks;
+   if (ODManager::IsInstanceCreated())
+      tasks = ODManager::Instance()->GetTaskStatistics();
+
+   context.StartArray();
+   for (const auto &task : tasks) {
+      const auto &stats = task.statistics;
+      context.StartStruct();
+      context.AddItem( task.name, "name" );
+      context.AddItem( (double)task.taskNumber, "number" );
+      context.AddItem( (double)task.percentComplete, "complete" );
+      context.AddBool( task.running, "running" );
+      context.AddItem( (double)stats.dispatches, "dispatches" );
+      context.AddItem( (double)stats.units, "units" );
+      context.AddItem( stats.seconds, "seconds" );
+      context.AddItem( stats.seconds > 0 ? stats.units / stats.seconds : 0.0,
+         "unitspersecond" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   return true;
+}
+
+bool GetInfoCommand::SendMemory(const CommandContext &context)
+{
+   context.StartArray();
+   for( int ii = 0; ii < MemoryUse::nSubsystems; ++ii )
+   {
+      const auto subsystem = static_cast<MemoryUse::Subsystem>( ii );
+      const auto stats = MemoryUse::GetStatistics( subsystem );
+      context.StartStruct();
+      context.AddItem( MemoryUse::GetName( subsystem ), "name" );
+      context.AddItem( (double)stats.live, "bytes" );
+      context.AddItem( (double)stats.peak, "peakbytes" );
+      context.EndStruct();
+   }
+   context.EndArray();
+   return true;
+}
+
 bool GetInfoCommand::SendMenus(const CommandContext &context)
 {
    wxMenuBar * pBar = context.GetProject()->GetMenuBar();
@@ -245,18 +372,56 @@ bool GetInfoCommand::SendBoxes(const CommandContext &context)
    return true;
 }
 
+bool GetInfoCommand::TrackWanted( int track ) const
+{
+   const int first = bHasFirstTrack ? mFirstTrack : 0;
+   return track >= first &&
+      ( !bHasNumTracks || track < first + mNumTracks );
+}
+
+// Items overlapping the time range are wanted
+bool GetInfoCommand::TimeWanted( double t0, double t1 ) const
+{
+   return ( !bHasT0 || t1 >= mT0 ) && ( !bHasT1 || t0 <= mT1 );
+}
+
+bool GetInfoCommand::OnPage( size_t &count ) const
+{
+   const size_t index = count++;
+   return ( !bHasOffset || index >= (size_t)mOffset ) && !PageFull( index );
+}
+
+bool GetInfoCommand::PageFull( size_t count ) const
+{
+   return bHasLimit &&
+      count >= ( bHasOffset ? (size_t)mOffset : 0 ) + (size_t)mLimit;
+}
+
 bool GetInfoCommand::SendTracks(const CommandContext & context)
 {
    TrackList *projTracks = context.GetProject()->GetTracks();
    TrackListIterator iter(projTracks);
    Track *trk = iter.First();
+   int i=0;
+   size_t count=0;
    context.StartArray();
-   while (trk)
+   while (trk && !PageFull( count ))
    {
 
       TrackPanel *panel = context.GetProject()->GetTrackPanel();
       Track * fTrack = panel->GetFocusedTrack();
 
+      if( !TrackWanted( i ) ||
+          !TimeWanted( trk->GetStartTime(), trk->GetEndTime() ) ||
+          !OnPage( count ) ) {
+         if( trk->GetLinked() )
+            trk= iter.Next();
+         if( trk )
+            trk=iter.Next();
+         i++;
+         continue;
+      }
+
       context.StartStruct();
       context.AddItem( trk->GetName(), "name" );
       context.AddBool( (trk == fTrack), "focused");
@@ -278,6 +443,7 @@ bool GetInfoCommand::SendTracks(const CommandContext & context)
          trk= iter.Next();
       if( trk )
          trk=iter.Next();
+      i++;
    }
    context.EndArray();
    return true;
@@ -289,12 +455,16 @@ bool GetInfoCommand::SendClips(const CommandContext &context)
    TrackListIterator iter(tracks);
    Track *t = iter.First();
    int i=0;
+   size_t count=0;
    context.StartArray();
-   while (t) {
-      if (t->GetKind() == Track::Wave) {
+   while (t && !PageFull( count )) {
+      if (t->GetKind() == Track::Wave && TrackWanted( i )) {
          WaveTrack *waveTrack = static_cast<WaveTrack*>(t);
          WaveClipPointers ptrs( waveTrack->SortedClipArray());
          for(WaveClip * pClip : ptrs ) {
+            if( !TimeWanted( pClip->GetStartTime(), pClip->GetEndTime() ) ||
+                !OnPage( count ) )
+               continue;
             context.StartStruct();
             context.AddItem( (double)i, "track" );
             context.AddItem( pClip->GetStartTime(), "start" );
@@ -322,12 +492,18 @@ bool GetInfoCommand::SendEnvelopes(const CommandContext &context)
    Track *t = iter.First();
    int i=0;
    int j=0;
+   size_t count=0;
    context.StartArray();
-   while (t) {
-      if (t->GetKind() == Track::Wave) {
+   while (t && !PageFull( count )) {
+      if (t->GetKind() == Track::Wave && TrackWanted( i )) {
          WaveTrack *waveTrack = static_cast<WaveTrack*>(t);
          WaveClipPointers ptrs( waveTrack->SortedClipArray());
          for(WaveClip * pClip : ptrs ) {
+            if( !TimeWanted( pClip->GetStartTime(), pClip->GetEndTime() ) ||
+                !OnPage( count ) ) {
+               j++;
+               continue;
+            }
             context.StartStruct();
             context.AddItem( (double)i, "track" );
             context.AddItem( (double)j, "clip" );
@@ -338,8 +514,11 @@ bool GetInfoCommand::SendEnvelopes(const CommandContext &context)
             double offset = pEnv->mOffset;
             for( size_t k=0;k<pEnv->mEnv.size(); k++)
             {
+               const double time = pEnv->mEnv[k].GetT()+offset;
+               if( !TimeWanted( time, time ) )
+                  continue;
                context.StartStruct( );
-               context.AddItem( pEnv->mEnv[k].GetT()+offset, "t" );
+               context.AddItem( time, "t" );
                context.AddItem( pEnv->mEnv[k].GetVal(), "y" );
                context.EndStruct();
             }
@@ -355,6 +534,7 @@ bool GetInfoCommand::SendEnvelopes(const CommandContext &context)
          t= iter.Next();
       if( t )
          t=iter.Next();
+      i++;
    }
    context.EndArray();
 
@@ -368,9 +548,10 @@ bool GetInfoCommand::SendLabels(const CommandContext &context)
    TrackListIterator iter(tracks);
    Track *t = iter.First();
    int i=0;
+   size_t count=0;
    context.StartArray();
-   while (t) {
-      if (t->GetKind() == Track::Label) {
+   while (t && !PageFull( count )) {
+      if (t->GetKind() == Track::Label && TrackWanted( i )) {
          LabelTrack *labelTrack = static_cast<LabelTrack*>(t);
          if( labelTrack )
          {
@@ -378,6 +559,9 @@ bool GetInfoCommand::SendLabels(const CommandContext &context)
 #ifdef VERBOSE_LABELS_FORMATTING
             for (int nn = 0; nn< (int)labelTrack->mLabels.size(); nn++) {
                const auto &label = labelTrack->mLabels[nn];
+               if( !TimeWanted( label.getT0(), label.getT1() ) ||
+                   !OnPage( count ) )
+                  continue;
                context.StartStruct();
                context.AddItem( (double)i, "track" );
                context.AddItem( label.getT0(), "start" );
@@ -390,6 +574,9 @@ bool GetInfoCommand::SendLabels(const CommandContext &context)
             context.StartArray();
             for (int nn = 0; nn< (int)labelTrack->mLabels.size(); nn++) {
                const auto &label = labelTrack->mLabels[nn];
+               if( !TimeWanted( label.getT0(), label.getT1() ) ||
+                   !OnPage( count ) )
+                  continue;
                context.StartArray();
                context.AddItem( label.getT0() ); // start
                context.AddItem( label.getT1() ); // end
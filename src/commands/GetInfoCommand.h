@@ -46,6 +46,21 @@ public:
    int mInfoType;
    int mFormat;
 
+   // Optional filters of the tracks, clips, envelopes and labels sent, and
+   // a page of them, so that a script can fetch a big project in parts
+   bool bHasT0;
+   bool bHasT1;
+   bool bHasFirstTrack;
+   bool bHasNumTracks;
+   bool bHasOffset;
+   bool bHasLimit;
+   double mT0;
+   double mT1;
+   int mFirstTrack;
+   int mNumTracks;
+   int mOffset;
+   int mLimit;
+
 private:
    bool SendCommands(const CommandContext & context, int flags);
    bool SendMenus(const CommandContext & context);
@@ -55,6 +70,15 @@ private:
    bool SendClips(const CommandContext & context);
    bool SendEnvelopes(const CommandContext & context);
    bool SendBoxes(const CommandContext & context);
+   bool SendAudioIO(const CommandContext & context);
+   bool SendODTasks(const CommandContext & context);
+   bool SendMemory(const CommandContext & context);
+
+   bool TrackWanted( int track ) const;
+   bool TimeWanted( double t0, double t1 ) const;
+   // Count an item that passed the filters; true if it is on the page
+   bool OnPage( size_t &count ) const;
+   bool PageFull( size_t count ) const;
 
    void ExploreMenu( const CommandContext &context, wxMenu * pMenu, int Id, int depth );
    void ExploreTrackPanel( const CommandContext & context,
@@ -0,0 +1,180 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   File License: wxWidgets
+
+******************************************************************//**
+
+\file GetSamplesCommand.cpp
+\brief Definitions for GetSamplesCommand class
+
+  The script creates the shared memory, of whatever size it likes, and
+  removes it again, so nothing is left behind if it goes away.  As many
+  samples as fit are written from the start of it, and their number is
+  returned, so that a long channel can be read in pieces.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "GetSamplesCommand.h"
+
+#include <float.h>
+
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../Project.h"
+#include "../Track.h"
+#include "../WaveTrack.h"
+#include "../ShuttleGui.h"
+#include "CommandContext.h"
+
+namespace {
+
+// A mapping of existing shared memory, named as the platform names it
+class SharedMemory
+{
+public:
+   explicit SharedMemory( const wxString &name )
+   {
+#ifdef __WXMSW__
+      mHandle = OpenFileMappingW( FILE_MAP_WRITE, FALSE, name.wc_str() );
+      if( !mHandle )
+         return;
+      mData = MapViewOfFile( mHandle, FILE_MAP_WRITE, 0, 0, 0 );
+      MEMORY_BASIC_INFORMATION info;
+      if( mData && VirtualQuery( mData, &info, sizeof(info) ) )
+         mSize = info.RegionSize;
+#else
+      const int fd = shm_open( name.utf8_str(), O_RDWR, 0 );
+      if( fd < 0 )
+         return;
+      struct stat st;
+      if( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+         void *data = mmap( nullptr, st.st_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+         if( data != MAP_FAILED ) {
+            mData = data;
+            mSize = st.st_size;
+         }
+      }
+      close( fd );
+#endif
+   }
+
+   ~SharedMemory()
+   {
+#ifdef __WXMSW__
+      if( mData )
+         UnmapViewOfFile( mData );
+      if( mHandle )
+         CloseHandle( mHandle );
+#else
+      if( mData )
+         munmap( mData, mSize );
+#endif
+   }
+
+   SharedMemory( const SharedMemory& ) PROHIBITED;
+   SharedMemory &operator= ( const SharedMemory& ) PROHIBITED;
+
+   float *Data() const { return static_cast<float*>( mData ); }
+   size_t Size() const { return mData ? mSize : 0; }
+
+private:
+#ifdef __WXMSW__
+   HANDLE mHandle{};
+#endif
+   void *mData{};
+   size_t mSize{};
+};
+
+}
+
+bool GetSamplesCommand::DefineParams( ShuttleParams & S ){
+   S.Define( mChannelIndex, wxT("Channel"), 0, 0, 100 );
+   S.Define( mT0, wxT("Start"), 0.0, 0.0, (double)FLT_MAX );
+   S.OptionalN( bHasT1 ).Define( mT1, wxT("End"), 0.0, 0.0, (double)FLT_MAX );
+   S.Define( mMemoryName, wxT("Memory"), wxT("") );
+   return true;
+}
+
+void GetSamplesCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieNumericTextBox( _("Channel Index:"), mChannelIndex );
+      S.TieNumericTextBox( _("Start:"), mT0 );
+   }
+   S.EndMultiColumn();
+   S.StartMultiColumn(3, wxALIGN_CENTER);
+   {
+      S.Optional( bHasT1 ).TieNumericTextBox( _("End:"), mT1 );
+   }
+   S.EndMultiColumn();
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieTextBox( _("Shared Memory:"), mMemoryName );
+   }
+   S.EndMultiColumn();
+}
+
+bool GetSamplesCommand::Apply(const CommandContext & context)
+{
+   // Channels are counted as SetTrack counts them
+   WaveTrack *track = nullptr;
+   TrackListIterator iter(context.GetProject()->GetTracks());
+   long j = 0;
+   for( Track *t = iter.First(); t; t = iter.Next(), ++j ) {
+      if( j == mChannelIndex ) {
+         if( t->GetKind() == Track::Wave )
+            track = static_cast<WaveTrack*>( t );
+         break;
+      }
+   }
+   if( !track ) {
+      context.Error(
+         wxString::Format(_("Channel %d is not audio"), mChannelIndex) );
+      return false;
+   }
+
+   SharedMemory memory{ mMemoryName };
+   if( !memory.Data() ) {
+      context.Error(
+         wxString::Format(_("Could not open shared memory %s"), mMemoryName) );
+      return false;
+   }
+
+   const auto s0 = track->TimeToLongSamples( mT0 );
+   const auto s1 = track->TimeToLongSamples(
+      bHasT1 ? mT1 : track->GetEndTime() );
+   const size_t count = s1 > s0
+      ? limitSampleBufferSize( memory.Size() / sizeof(float), s1 - s0 )
+      : 0;
+
+   // Straight into the shared memory, a block at a time
+   float *const buffer = memory.Data();
+   for( size_t done = 0; done < count; ) {
+      const auto position = s0 + done;
+      const auto block = limitSampleBufferSize(
+         track->GetBestBlockSize( position ), count - done );
+      track->Get( (samplePtr)( buffer + done ), floatSample, position, block );
+      done += block;
+   }
+
+   context.StartStruct();
+   context.AddItem( s0.as_double(), "start" );
+   context.AddItem( (double)count, "samples" );
+   context.AddItem( track->GetRate(), "rate" );
+   context.EndStruct();
+   return true;
+}
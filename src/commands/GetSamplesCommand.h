@@ -0,0 +1,50 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   File License: wxWidgets
+
+******************************************************************//**
+
+\file GetSamplesCommand.h
+\brief Declarations for GetSamplesCommand class
+
+*//***************************************************************//**
+
+\class GetSamplesCommand
+\brief Command that copies the samples of one channel, as 32 bit floats,
+into shared memory that a script has made, rather than sending them back
+as text.
+
+*//*******************************************************************/
+
+#ifndef __GET_SAMPLES_COMMAND__
+#define __GET_SAMPLES_COMMAND__
+
+#include "Command.h"
+#include "CommandType.h"
+
+#define GET_SAMPLES_PLUGIN_SYMBOL IdentInterfaceSymbol{ XO("Get Samples") }
+
+class GetSamplesCommand : public AudacityCommand
+{
+public:
+   // CommandDefinitionInterface overrides
+   IdentInterfaceSymbol GetSymbol() override {return GET_SAMPLES_PLUGIN_SYMBOL;};
+   wxString GetDescription() override {return _("Copies the samples of a channel into shared memory.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#get_samples");};
+public:
+   int mChannelIndex;
+   double mT0;
+   double mT1;
+   wxString mMemoryName;
+
+   bool bHasT1;
+};
+
+#endif /* End of include guard: __GET_SAMPLES_COMMAND__ */
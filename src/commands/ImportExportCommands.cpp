@@ -22,6 +22,8 @@
 #include "../ShuttleGui.h"
 #include "CommandContext.h"
 
+#include <wx/arrstr.h>
+
 bool ImportCommand::DefineParams( ShuttleParams & S ){
    S.Define( mFileName, wxT("Filename"),  "" );
    return true;
@@ -68,6 +70,10 @@ bool ExportCommand::Apply(const CommandContext & context)
    t0 = context.GetProject()->mViewInfo.selectedRegion.t0();
    t1 = context.GetProject()->mViewInfo.selectedRegion.t1();
 
+   // Several names, separated by '|', are exported together from one mix
+   if (mFileName.Find(wxUniChar('|')) != wxNOT_FOUND)
+      return ApplyFanOut(context, t0, t1);
+
    // Find the extension and check it's valid
    int splitAt = mFileName.Find(wxUniChar('.'), true);
    if (splitAt < 0)
@@ -95,3 +101,32 @@ bool ExportCommand::Apply(const CommandContext & context)
    return false;
 }
 
+bool ExportCommand::ApplyFanOut(
+   const CommandContext & context, double t0, double t1)
+{
+   std::vector<Exporter::Target> targets;
+   for (const auto &name : wxSplit(mFileName, wxUniChar('|'), 0)) {
+      int splitAt = name.Find(wxUniChar('.'), true);
+      if (splitAt < 0)
+      {
+         context.Error(wxT("Export filename must have an extension!"));
+         return false;
+      }
+      targets.emplace_back(name.Mid(splitAt+1).MakeUpper(), name);
+   }
+
+   Exporter exporter;
+
+   if (exporter.ProcessFanOut(context.GetProject(),
+                              std::max(0, mnChannels),
+                              targets, true, t0, t1))
+   {
+      context.Status(wxString::Format(wxT("Exported to %d files: %s"),
+                              (int)targets.size(), mFileName));
+      return true;
+   }
+
+   context.Error(wxString::Format(wxT("Could not export all of: %s"), mFileName));
+   return false;
+}
+
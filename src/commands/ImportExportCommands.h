@@ -55,6 +55,8 @@ public:
 
    // AudacityCommand overrides
    wxString ManualPage() override {return wxT("Export");};
+private:
+   bool ApplyFanOut(const CommandContext & context, double t0, double t1);
 public:
    wxString mFileName;
    int mnChannels;
@@ -38,6 +38,8 @@ modelled on BuiltinEffectsModule
 #include "../commands/SetClipCommand.h"
 #include "../commands/SetProjectCommand.h"
 #include "../commands/DragCommand.h"
+#include "../commands/ProfileCommand.h"
+#include "../commands/GetSamplesCommand.h"
 
 //
 // Define the list of COMMANDs that will be autoregistered and how to instantiate each
@@ -68,6 +70,9 @@ modelled on BuiltinEffectsModule
    COMMAND( EXPORT,              ExportCommand, () )           \
    COMMAND( OPEN_PROJECT,        OpenProjectCommand, () )      \
    COMMAND( SAVE_PROJECT,        SaveProjectCommand, () )      \
+   COMMAND( CONVERT_PROJECT,     ConvertProjectCommand, () )   \
+   COMMAND( PROFILE,             ProfileCommand, () )          \
+   COMMAND( GET_SAMPLES,         GetSamplesCommand, () )       \
 
    // GET_TRACK_INFO subsumed by GET_INFO
    //COMMAND( GET_TRACK_INFO,    GetTrackInfoCommand, () )   
@@ -16,9 +16,12 @@
 
 #include "../Audacity.h"
 #include "OpenSaveCommands.h"
+
+#include <wx/filename.h>
 #include "../Project.h"
 #include "../export/Export.h"
 #include "../ShuttleGui.h"
+#include "../xml/BinaryXMLFile.h"
 #include "CommandContext.h"
 
 
@@ -87,3 +90,43 @@ bool SaveProjectCommand::Apply(const CommandContext &context)
    else
       return context.GetProject()->SaveAs(mFileName,mbCompress,mbAddToHistory);
 }
+
+bool ConvertProjectCommand::DefineParams( ShuttleParams & S ){
+   S.Define( mFileName, wxT("Filename"),  "name.aup" );
+   S.Define( mOutput, wxT("Output"),  "converted.aup" );
+   return true;
+}
+
+void ConvertProjectCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieTextBox(_("File Name:"),mFileName);
+      S.TieTextBox(_("Output:"),mOutput);
+   }
+   S.EndMultiColumn();
+}
+
+bool ConvertProjectCommand::Apply(const CommandContext &context)
+{
+   // The conversion writes a NEW file and renames it, so it can't replace
+   // the file that it reads
+   if (mFileName.IsEmpty() || mOutput.IsEmpty() ||
+       wxFileName(mFileName).SameAs(wxFileName(mOutput))) {
+      context.Error(_("Give different names for the project and the output."));
+      return false;
+   }
+
+   // The data folder is not copied; the output names the same folder, which
+   // must be beside it
+   const bool result = BinaryXMLFileReader::IsBinaryFile(mFileName)
+      ? BinaryXMLFileReader::ConvertToXML(mFileName, mOutput)
+      : BinaryXMLWriter::ConvertFromXML(mFileName, mOutput);
+   if (!result)
+      context.Error(
+         wxString::Format(_("Could not convert %s"), mFileName) );
+   return result;
+}
+
@@ -16,6 +16,10 @@
 \class SaveProjectCommand
 \brief Command for saving an Audacity project
 
+\class ConvertProjectCommand
+\brief Command for converting a project file between the XML and binary
+formats
+
 *//*******************************************************************/
 
 #include "Command.h"
@@ -62,3 +66,22 @@ public:
    bool bHasAddToHistory;
    bool bHasCompress;
 };
+
+#define CONVERT_PROJECT_PLUGIN_SYMBOL IdentInterfaceSymbol{ XO("Convert Project") }
+
+class ConvertProjectCommand : public AudacityCommand
+{
+public:
+   // CommandDefinitionInterface overrides
+   IdentInterfaceSymbol GetSymbol() override {return CONVERT_PROJECT_PLUGIN_SYMBOL;};
+   wxString GetDescription() override {return _("Converts a project file from XML to binary, or back.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#convert_project");};
+public:
+   wxString mFileName;
+   wxString mOutput;
+};
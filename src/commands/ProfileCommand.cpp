@@ -0,0 +1,56 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   File License: wxWidgets
+
+******************************************************************//**
+
+\file ProfileCommand.cpp
+\brief Definitions for ProfileCommand class
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "ProfileCommand.h"
+#include "../Profiler.h"
+#include "../ShuttleGui.h"
+#include "CommandContext.h"
+
+bool ProfileCommand::DefineParams( ShuttleParams & S ){
+   S.OptionalN(bHasRecord).Define( mbRecord, wxT("Record"), false );
+   S.OptionalN(bHasClear).Define( mbClear, wxT("Clear"), false );
+   S.OptionalN(bHasFileName).Define( mFileName, wxT("Filename"), "trace.json" );
+   return true;
+}
+
+void ProfileCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(3, wxALIGN_CENTER);
+   {
+      S.Optional( bHasRecord ).TieCheckBox(_("Record:"), mbRecord );
+      S.Optional( bHasClear ).TieCheckBox(_("Clear:"), mbClear );
+      S.Optional( bHasFileName ).TieTextBox(_("File Name:"), mFileName );
+   }
+   S.EndMultiColumn();
+}
+
+bool ProfileCommand::Apply(const CommandContext & context)
+{
+   auto &profiler = Profiler::Get();
+
+   // Save before clearing, so that one command can do both
+   if( bHasFileName && !mFileName.IsEmpty() &&
+       !profiler.WriteTrace( mFileName ) ) {
+      context.Error(
+         wxString::Format(_("Could not write profile to %s"), mFileName) );
+      return false;
+   }
+   if( bHasClear && mbClear )
+      profiler.Clear();
+   if( bHasRecord )
+      profiler.SetRecording( mbRecord );
+   return true;
+}
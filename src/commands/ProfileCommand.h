@@ -0,0 +1,50 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2018 Audacity Team
+   File License: wxWidgets
+
+******************************************************************//**
+
+\file ProfileCommand.h
+\brief Declarations for ProfileCommand class
+
+*//***************************************************************//**
+
+\class ProfileCommand
+\brief Command that starts, stops and clears the recording of the Profiler,
+and saves what it recorded as a trace file.
+
+*//*******************************************************************/
+
+#ifndef __PROFILE_COMMAND__
+#define __PROFILE_COMMAND__
+
+#include "Command.h"
+#include "CommandType.h"
+
+#define PROFILE_PLUGIN_SYMBOL IdentInterfaceSymbol{ XO("Profile") }
+
+class ProfileCommand : public AudacityCommand
+{
+public:
+   // CommandDefinitionInterface overrides
+   IdentInterfaceSymbol GetSymbol() override {return PROFILE_PLUGIN_SYMBOL;};
+   wxString GetDescription() override {return _("Records timings of audio and drawing, and saves them as a trace.");};
+   bool DefineParams( ShuttleParams & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   wxString ManualPage() override {return wxT("Extra_Menu:_Scriptables_II#profile");};
+public:
+   bool mbRecord;
+   bool mbClear;
+   wxString mFileName;
+
+   bool bHasRecord;
+   bool bHasClear;
+   bool bHasFileName;
+};
+
+#endif /* End of include guard: __PROFILE_COMMAND__ */
@@ -26,6 +26,7 @@ code out of ModuleManager.
 #include "ResponseQueue.h"
 #include "../Project.h"
 #include "../AudacityApp.h"
+#include <wx/arrstr.h>
 #include <wx/string.h>
 
 // Declare static class members
@@ -61,37 +62,52 @@ void ScriptCommandRelay::PostCommand(AudacityProject *project, const OldStyleCom
    project->GetEventHandler()->AddPendingEvent(ev);
 }
 
-/// This is the function which actually obeys one command.  Rather than applying
-/// the command directly, an event containing a reference to the command is sent
-/// to the main (GUI) thread. This is because having more than one thread access
-/// the GUI at a time causes problems with wxwidgets.
+/// This is the function which actually obeys commands, one per line of pIn.
+/// Rather than applying the commands directly, an event containing a
+/// reference to each command is sent to the main (GUI) thread. This is
+/// because having more than one thread access the GUI at a time causes
+/// problems with wxwidgets.  All of a batch is sent before any response is
+/// awaited, so that the main thread can run it without waiting on the script.
 int ExecCommand(wxString *pIn, wxString *pOut)
 {
+   *pOut = wxEmptyString;
+
+   // Syntax errors, or empty for a command that was sent
+   wxArrayString errors;
+   for (const auto &line : wxSplit(*pIn, wxT('\n'), 0))
    {
-      CommandBuilder builder(*pIn);
+      if (line.IsEmpty())
+         continue;
+      CommandBuilder builder(line);
       if (builder.WasValid())
       {
          AudacityProject *project = GetActiveProject();
          OldStyleCommandPointer cmd = builder.GetCommand();
          ScriptCommandRelay::PostCommand(project, cmd);
-
-         *pOut = wxEmptyString;
+         errors.Add(wxEmptyString);
       }
       else
-      {
-         *pOut = wxT("Syntax error!\n");
-         *pOut += builder.GetErrorMessage() + wxT("\n");
-      }
+         errors.Add(wxT("Syntax error!\n") + builder.GetErrorMessage() + wxT("\n"));
    }
 
-   // Wait until all responses from the command have been received.
-   // The last response is signalled by an empty line.
-   wxString msg = ScriptCommandRelay::ReceiveResponse().GetMessage();
-   while (msg != wxT("\n"))
+   for (const auto &error : errors)
    {
-      //wxLogDebug( "Msg: %s", msg );
-      *pOut += msg + wxT("\n");
-      msg = ScriptCommandRelay::ReceiveResponse().GetMessage();
+      if (!error.IsEmpty())
+      {
+         *pOut += error;
+         continue;
+      }
+
+      // Wait until all responses from the command have been received.
+      // The last response is signalled by an empty line.  Commands respond
+      // in the order they were sent.
+      wxString msg = ScriptCommandRelay::ReceiveResponse().GetMessage();
+      while (msg != wxT("\n"))
+      {
+         //wxLogDebug( "Msg: %s", msg );
+         *pOut += msg + wxT("\n");
+         msg = ScriptCommandRelay::ReceiveResponse().GetMessage();
+      }
    }
 
    return 0;
@@ -74,8 +74,10 @@ bool SetEnvelopeCommand::ApplyInner( const CommandContext & context, Track * t )
       {
          // Inside this IF is where we actually apply the command
          Envelope* pEnv = pClip->GetEnvelope();
-         if( bHasDelete && mbDelete )
+         if( bHasDelete && mbDelete ) {
             pEnv->mEnv.clear();
+            pEnv->Changed();
+         }
          if( bHasT && bHasV )
             pEnv->InsertOrReplace( mT, mV );
       }
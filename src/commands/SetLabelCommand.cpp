@@ -101,8 +101,10 @@ bool SetLabelCommand::Apply(const CommandContext & context)
       pLabel->selectedRegion.setT0(mT0, false);
    if( bHasT1 )
       pLabel->selectedRegion.setT1(mT1, false);
-   if( bHasT0 || bHasT1 )
+   if( bHasT0 || bHasT1 ) {
       pLabel->selectedRegion.ensureOrdering();
+      labelTrack->InvalidateSpatialIndex();
+   }
    pLabel->updated = true;
 
    // Only one label can be selected.
@@ -197,6 +197,20 @@ bool EffectAmplify::Init()
    return true;
 }
 
+bool EffectAmplify::SupportsParallelChunks(size_t &lookBack)
+{
+   // ProcessBlock only reads mRatio
+   lookBack = 0;
+   return true;
+}
+
+bool EffectAmplify::SupportsConcurrentTracks(bool &useProcessors)
+{
+   // ProcessBlock may be called at once for any tracks, as for chunks
+   useProcessors = false;
+   return true;
+}
+
 void EffectAmplify::Preview(bool dryOnly)
 {
    auto cleanup1 = valueRestorer( mRatio );
@@ -56,6 +56,8 @@ public:
    // Effect implementation
 
    bool Init() override;
+   bool SupportsParallelChunks(size_t &lookBack) override;
+   bool SupportsConcurrentTracks(bool &useProcessors) override;
    void Preview(bool dryOnly) override;
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
@@ -55,6 +55,34 @@ Param( MaximumPause,       double,  wxT("MaximumPause"),     1.0,     0.0,     D
 static const size_t kBufSize = 131072u;     // number of samples to process at once
 static const size_t kRMSWindowSize = 100u;  // samples in circular RMS window buffer
 
+/*
+ * Multiplies by gains rising or falling evenly in decibels, so forming a
+ * geometric series.  The series is kept in a few lanes that advance
+ * together, so that the loop may be vectorized.
+ */
+
+static void ApplyGainRamp(float *buffer, size_t len,
+                          double startDb, double stepDb)
+{
+   const size_t Lanes = 8;
+   double gains[Lanes];
+   for (size_t k = 0; k < Lanes; k++)
+      gains[k] = DB_TO_LINEAR(startDb + k * stepDb);
+   const double ratio = DB_TO_LINEAR(Lanes * stepDb);
+
+   size_t i = 0;
+   for (; i + Lanes <= len; i += Lanes)
+   {
+      for (size_t k = 0; k < Lanes; k++)
+      {
+         buffer[i + k] *= gains[k];
+         gains[k] *= ratio;
+      }
+   }
+   for (size_t k = 0; i + k < len; k++)
+      buffer[i + k] *= gains[k];
+}
+
 /*
  * A auto duck region and an array of auto duck regions
  */
@@ -296,10 +324,20 @@ bool EffectAutoDuck::Process()
    // adjust the threshold so we can compare it to the rmsSum value
    threshold = threshold * threshold * kRMSWindowSize;
 
+   CopyInputTracks(); // Set up mOutputTracks.
+   std::vector<WaveTrack *> tracks;
+   {
+      SelectedTrackListOfKindIterator iter(Track::Wave, mOutputTracks.get());
+      for (Track *t = iter.First(); t; t = iter.Next())
+         tracks.push_back(static_cast<WaveTrack *>(t));
+   }
+
    int rmsPos = 0;
    float rmsSum = 0;
-   // to make the progress bar appear more natural, we first look for all
-   // duck regions and apply them all at once afterwards
+   // Each duck region ends, with its fade up, no later than the maximum
+   // pause before the point where it is found, so it is applied to the
+   // tracks straight away, and only the regions found in one buffer of the
+   // control track are ever held
    std::vector<AutoDuckRegion> regions;
    bool inDuckRegion = false;
    {
@@ -369,56 +407,28 @@ bool EffectAutoDuck::Process()
 
          pos += len;
 
+         // apply last duck fade, if any
+         if (pos >= end && inDuckRegion)
+         {
+            double duckRegionEnd =
+               mControlTrack->LongSamplesToTime(end - curSamplesPause);
+            regions.push_back(AutoDuckRegion(
+               duckRegionStart - mOuterFadeDownLen,
+               duckRegionEnd + mOuterFadeUpLen));
+         }
+
+         ApplyDuckFades(regions, tracks);
+         regions.clear();
+
          if (TotalProgress(
             (pos - start).as_double() /
-            (end - start).as_double() /
-            (GetNumWaveTracks() + 1)
+            (end - start).as_double()
          ))
          {
             cancel = true;
             break;
          }
       }
-
-      // apply last duck fade, if any
-      if (inDuckRegion)
-      {
-         double duckRegionEnd =
-            mControlTrack->LongSamplesToTime(end - curSamplesPause);
-         regions.push_back(AutoDuckRegion(
-            duckRegionStart - mOuterFadeDownLen,
-            duckRegionEnd + mOuterFadeUpLen));
-      }
-   }
-
-   if (!cancel)
-   {
-      CopyInputTracks(); // Set up mOutputTracks.
-      SelectedTrackListOfKindIterator iter(Track::Wave, mOutputTracks.get());
-      Track *iterTrack = iter.First();
-
-      int trackNum = 0;
-
-      while (iterTrack)
-      {
-         WaveTrack* t = (WaveTrack*)iterTrack;
-
-         for (size_t i = 0; i < regions.size(); i++)
-         {
-            const AutoDuckRegion& region = regions[i];
-            if (ApplyDuckFade(trackNum, t, region.t0, region.t1))
-            {
-               cancel = true;
-               break;
-            }
-         }
-
-         if (cancel)
-            break;
-
-         iterTrack = iter.Next();
-         trackNum++;
-      }
    }
 
    ReplaceProcessedTracks(!cancel);
@@ -517,17 +527,31 @@ bool EffectAutoDuck::TransferDataFromWindow()
 
 // EffectAutoDuck implementation
 
-// this currently does an exponential fade
-bool EffectAutoDuck::ApplyDuckFade(int trackNum, WaveTrack* t,
-                                   double t0, double t1)
+void EffectAutoDuck::ApplyDuckFades(
+   const std::vector<AutoDuckRegion> &regions,
+   const std::vector<WaveTrack *> &tracks)
 {
-   bool cancel = false;
+   if (regions.empty())
+      return;
 
+   // The tracks are independent, but each takes its regions in order, in
+   // case the fades of two of them overlap
+   std::mutex writeMutex;
+   ParallelFor(tracks.size(), [&](size_t ii) {
+      Floats buf{ kBufSize };
+      for (const auto &region : regions)
+         ApplyDuckFade(tracks[ii], region.t0, region.t1, buf.get(), writeMutex);
+   });
+}
+
+// this currently does an exponential fade
+void EffectAutoDuck::ApplyDuckFade(WaveTrack* t, double t0, double t1,
+                                   float *buf, std::mutex &writeMutex)
+{
    auto start = t->TimeToLongSamples(t0);
    auto end = t->TimeToLongSamples(t1);
-
-   Floats buf{ kBufSize };
-   auto pos = start;
+   if (end <= start)
+      return;
 
    auto fadeDownSamples = t->TimeToLongSamples(
       mOuterFadeDownLen + mInnerFadeDownLen);
@@ -539,47 +563,63 @@ bool EffectAutoDuck::ApplyDuckFade(int trackNum, WaveTrack* t,
    if (fadeUpSamples < 1)
       fadeUpSamples = 1;
 
-   float fadeDownStep = mDuckAmountDb / fadeDownSamples.as_double();
-   float fadeUpStep = mDuckAmountDb / fadeUpSamples.as_double();
+   const double fadeDownStep = mDuckAmountDb / fadeDownSamples.as_double();
+   const double fadeUpStep = mDuckAmountDb / fadeUpSamples.as_double();
+
+   // The gain is the greatest of the fade down, the fade up, and the duck
+   // amount, so it falls, then holds, then rises.  When the region is too
+   // short to hold, the fades meet where they are equal.
+   const auto total = end - start;
+   auto downEnd = fadeDownSamples;
+   auto upStart = total - fadeUpSamples;
+   if (downEnd > upStart)
+      downEnd = upStart = sampleCount(ceil(total.as_double() *
+         fadeDownSamples.as_double() /
+         (fadeDownSamples + fadeUpSamples).as_double()));
 
+   auto pos = start;
    while (pos < end)
    {
       const auto len = limitSampleBufferSize( kBufSize, end - pos );
 
-      t->Get((samplePtr)buf.get(), floatSample, pos, len);
+      t->Get((samplePtr)buf, floatSample, pos, len);
 
-      for (auto i = pos; i < pos + len; i++)
+      auto n = pos - start;
+      const auto last = n + len;
+      float *piece = buf;
+      while (n < last)
       {
-         float gainDown = fadeDownStep * (i - start).as_float();
-         float gainUp = fadeUpStep * (end - i).as_float();
-
-         float gain;
-         if (gainDown > gainUp)
-            gain = gainDown;
-         else
-            gain = gainUp;
-         if (gain < mDuckAmountDb)
-            gain = mDuckAmountDb;
-
-         // i - pos is bounded by len:
-         buf[ ( i - pos ).as_size_t() ] *= DB_TO_LINEAR(gain);
+         sampleCount to;
+         double startDb, stepDb;
+         if (n < downEnd) {
+            to = std::min(last, downEnd);
+            startDb = fadeDownStep * n.as_double();
+            stepDb = fadeDownStep;
+         }
+         else if (n < upStart) {
+            to = std::min(last, upStart);
+            startDb = mDuckAmountDb;
+            stepDb = 0;
+         }
+         else {
+            to = last;
+            startDb = fadeUpStep * (total - n).as_double();
+            stepDb = -fadeUpStep;
+         }
+         // to - n is bounded by len:
+         const auto count = (to - n).as_size_t();
+         ApplyGainRamp(piece, count, startDb, stepDb);
+         piece += count;
+         n = to;
       }
 
-      t->Set((samplePtr)buf.get(), floatSample, pos, len);
-
-      pos += len;
-
-      float curTime = t->LongSamplesToTime(pos);
-      float fractionFinished = (curTime - mT0) / (mT1 - mT0);
-      if (TotalProgress( (trackNum + 1 + fractionFinished) /
-                         (GetNumWaveTracks() + 1) ))
       {
-         cancel = true;
-         break;
+         std::lock_guard<std::mutex> lock{ writeMutex };
+         t->Set((samplePtr)buf, floatSample, pos, len);
       }
-   }
 
-   return cancel;
+      pos += len;
+   }
 }
 
 void EffectAutoDuck::OnValueChanged(wxCommandEvent & WXUNUSED(evt))
@@ -11,6 +11,9 @@
 #ifndef __AUDACITY_EFFECT_AUTODUCK__
 #define __AUDACITY_EFFECT_AUTODUCK__
 
+#include <mutex>
+#include <vector>
+
 #include <wx/bitmap.h>
 #include <wx/event.h>
 #include <wx/gdicmn.h>
@@ -22,6 +25,7 @@
 #include "../widgets/wxPanelWrapper.h"
 
 class EffectAutoDuckPanel;
+struct AutoDuckRegion;
 class ShuttleGui;
 
 #define AUTO_DUCK_PANEL_NUM_CONTROL_POINTS 5
@@ -63,7 +67,10 @@ public:
 private:
    // EffectAutoDuck implementation
 
-   bool ApplyDuckFade(int trackNum, WaveTrack *t, double t0, double t1);
+   void ApplyDuckFades(const std::vector<AutoDuckRegion> &regions,
+      const std::vector<WaveTrack *> &tracks);
+   void ApplyDuckFade(WaveTrack *t, double t0, double t1,
+      float *buf, std::mutex &writeMutex);
 
    void OnValueChanged(wxCommandEvent & evt);
 
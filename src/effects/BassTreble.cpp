@@ -207,6 +207,20 @@ bool EffectBassTreble::CheckWhetherSkipEffect()
    return (mBass == 0.0 && mTreble == 0.0 && mGain == 0.0);
 }
 
+bool EffectBassTreble::SupportsParallelChunks(size_t &lookBack)
+{
+   // The shelf filters forget their state long before a tenth of a second
+   lookBack = size_t(mSampleRate / 10);
+   return true;
+}
+
+bool EffectBassTreble::SupportsConcurrentTracks(bool &useProcessors)
+{
+   // Each track needs its own filter state
+   useProcessors = true;
+   return true;
+}
+
 
 // Effect implementation
 
@@ -324,15 +338,7 @@ void EffectBassTreble::InstanceInit(EffectBassTrebleState & data, float sampleRa
    data.b1Treble = 0;
    data.b2Treble = 0;
 
-   data.xn1Bass = 0;
-   data.xn2Bass = 0;
-   data.yn1Bass = 0;
-   data.yn2Bass = 0;
-
-   data.xn1Treble = 0;
-   data.xn2Treble = 0;
-   data.yn1Treble = 0;
-   data.yn2Treble = 0;
+   data.filters.SetSections(2);
 
    data.bass = -1;
    data.treble = -1;
@@ -370,8 +376,18 @@ size_t EffectBassTreble::InstanceProcess(EffectBassTrebleState & data,
                   data.a0Treble, data.a1Treble, data.a2Treble,
                   data.b0Treble, data.b1Treble, data.b2Treble);
 
+   data.filters.SetSection(0,
+      data.b0Bass / data.a0Bass, data.b1Bass / data.a0Bass,
+      data.b2Bass / data.a0Bass, data.a1Bass / data.a0Bass,
+      data.a2Bass / data.a0Bass);
+   data.filters.SetSection(1,
+      data.b0Treble / data.a0Treble, data.b1Treble / data.a0Treble,
+      data.b2Treble / data.a0Treble, data.a1Treble / data.a0Treble,
+      data.a2Treble / data.a0Treble);
+
+   data.filters.Process(ibuf, obuf, blockLen);
    for (decltype(blockLen) i = 0; i < blockLen; i++) {
-      obuf[i] = DoFilter(data, ibuf[i]) * data.gain;
+      obuf[i] *= data.gain;
    }
 
    return blockLen;
@@ -410,29 +426,6 @@ void EffectBassTreble::Coefficents(double hz, double slope, double gain, double
    }
 }
 
-float EffectBassTreble::DoFilter(EffectBassTrebleState & data, float in)
-{
-   // Bass filter
-   float out = (data.b0Bass * in + data.b1Bass * data.xn1Bass + data.b2Bass * data.xn2Bass -
-         data.a1Bass * data.yn1Bass - data.a2Bass * data.yn2Bass) / data.a0Bass;
-   data.xn2Bass = data.xn1Bass;
-   data.xn1Bass = in;
-   data.yn2Bass = data.yn1Bass;
-   data.yn1Bass = out;
-
-   // Treble filter
-   in = out;
-   out = (data.b0Treble * in + data.b1Treble * data.xn1Treble + data.b2Treble * data.xn2Treble -
-         data.a1Treble * data.yn1Treble - data.a2Treble * data.yn2Treble) / data.a0Treble;
-   data.xn2Treble = data.xn1Treble;
-   data.xn1Treble = in;
-   data.yn2Treble = data.yn1Treble;
-   data.yn1Treble = out;
-
-   return out;
-}
-
-
 void EffectBassTreble::OnBassText(wxCommandEvent & WXUNUSED(evt))
 {
    double oldBass = mBass;
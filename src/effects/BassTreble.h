@@ -20,6 +20,7 @@
 #include <wx/checkbox.h>
 
 #include "Effect.h"
+#include "Biquad.h"
 
 class ShuttleGui;
 
@@ -35,8 +36,8 @@ public:
    double slope, hzBass, hzTreble;
    double a0Bass, a1Bass, a2Bass, b0Bass, b1Bass, b2Bass;
    double a0Treble, a1Treble, a2Treble, b0Treble, b1Treble, b2Treble;
-   double xn1Bass, xn2Bass, yn1Bass, yn2Bass;
-   double xn1Treble, xn2Treble, yn1Treble, yn2Treble;
+   // The bass filter, then the treble filter
+   BiquadCascade filters;
 };
 
 class EffectBassTreble final : public Effect
@@ -81,6 +82,8 @@ public:
    bool TransferDataFromWindow() override;
 
    bool CheckWhetherSkipEffect() override;
+   bool SupportsParallelChunks(size_t &lookBack) override;
+   bool SupportsConcurrentTracks(bool &useProcessors) override;
 
 private:
    // EffectBassTreble implementation
@@ -90,7 +93,6 @@ private:
 
    void Coefficents(double hz, double slope, double gain, double samplerate, int type,
                     double& a0, double& a1, double& a2, double& b0, double& b1, double& b2);
-   float DoFilter(EffectBassTrebleState & data, float in);
 
    void OnBassText(wxCommandEvent & evt);
    void OnTrebleText(wxCommandEvent & evt);
@@ -1,5 +1,7 @@
 #include "Biquad.h"
 
+#include <algorithm>
+
 #define square(a) ((a)*(a))
 
 void Biquad_Process (BiquadStruct* pBQ, int iNumSamples)
@@ -49,3 +51,58 @@ float Calc2D_DistSqr (float fX1, float fY1, float fX2, float fY2)
    return square (fX1 - fX2) + square (fY1 - fY2);
 }
 
+BiquadCascade::BiquadCascade()
+{
+   SetSections (0);
+}
+
+void BiquadCascade::SetSections (size_t nSections)
+{
+   mSections = std::min<size_t> (nSections, MaxSections);
+   for (size_t i = 0; i < mSections; i++)
+      SetSection (i, 1, 0, 0, 0, 0);
+   Reset ();
+}
+
+void BiquadCascade::SetSection (size_t iSection,
+   double b0, double b1, double b2, double a1, double a2)
+{
+   if (iSection >= mSections)
+      return;
+   mB0 [iSection] = b0;
+   mB1 [iSection] = b1;
+   mB2 [iSection] = b2;
+   mA1 [iSection] = a1;
+   mA2 [iSection] = a2;
+}
+
+void BiquadCascade::Reset ()
+{
+   std::fill (mS1, mS1 + MaxSections, 0.0);
+   std::fill (mS2, mS2 + MaxSections, 0.0);
+}
+
+void BiquadCascade::Process (const float* pfIn, float* pfOut, size_t len)
+{
+   if (mSections == 0 && pfIn != pfOut)
+      std::copy (pfIn, pfIn + len, pfOut);
+
+   const float* pfSource = pfIn;
+   for (size_t iSection = 0; iSection < mSections; iSection++)
+   {
+      const double b0 = mB0 [iSection], b1 = mB1 [iSection], b2 = mB2 [iSection];
+      const double a1 = mA1 [iSection], a2 = mA2 [iSection];
+      double s1 = mS1 [iSection], s2 = mS2 [iSection];
+      for (size_t i = 0; i < len; i++)
+      {
+         const double x = pfSource [i];
+         const double y = b0 * x + s1;
+         s1 = b1 * x - a1 * y + s2;
+         s2 = b2 * x - a2 * y;
+         pfOut [i] = y;
+      }
+      mS1 [iSection] = s1;
+      mS2 [iSection] = s2;
+      pfSource = pfOut;
+   }
+}
@@ -1,6 +1,8 @@
 #ifndef __BIQUAD_H__
 #define __BIQUAD_H__
 
+#include <cstddef>
+
 #if 0
 //initialisations not supported in MSVC 2013.
 //Gives error C2905
@@ -36,4 +38,37 @@ void ComplexDiv (float fNumerR, float fNumerI, float fDenomR, float fDenomI, flo
 bool BilinTransform (float fSX, float fSY, float* pfZX, float* pfZY);
 float Calc2D_DistSqr (float fX1, float fY1, float fX2, float fY2);
 
+// Up to MaxSections second order sections in series, in transposed direct
+// form II.  Coefficients and state are kept in double precision, in an
+// array for each, and a block is filtered one section at a time, so that
+// each section's state stays in registers.  Nothing is allocated, so it
+// may be used in realtime processing.
+class BiquadCascade
+{
+public:
+   enum { MaxSections = 8 };
+
+   BiquadCascade();
+
+   // Sets the number of sections, each passing its input unchanged until
+   // SetSection() is called for it, and resets the state
+   void SetSections (size_t nSections);
+   size_t GetSections () const { return mSections; }
+
+   // Coefficients of H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+   void SetSection (size_t iSection,
+      double b0, double b1, double b2, double a1, double a2);
+
+   void Reset ();
+
+   // out may be the same as in
+   void Process (const float* pfIn, float* pfOut, size_t len);
+
+private:
+   size_t mSections;
+   double mB0 [MaxSections], mB1 [MaxSections], mB2 [MaxSections];
+   double mA1 [MaxSections], mA2 [MaxSections];
+   double mS1 [MaxSections], mS2 [MaxSections];
+};
+
 #endif
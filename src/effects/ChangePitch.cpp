@@ -182,7 +182,6 @@ bool EffectChangePitch::LoadFactoryDefaults()
 
 bool EffectChangePitch::Init()
 {
-   mSoundTouch.reset();
    return true;
 }
 
@@ -201,15 +200,17 @@ bool EffectChangePitch::Process()
    else
 #endif
    {
-      mSoundTouch = std::make_unique<SoundTouch>();
+      auto initer = [&](soundtouch::SoundTouch *soundtouch)
+      {
+         soundtouch->setPitchSemiTones((float)(m_dSemitonesChange));
+      };
       IdentityTimeWarper warper;
-      mSoundTouch->setPitchSemiTones((float)(m_dSemitonesChange));
 #ifdef USE_MIDI
       // Pitch shifting note tracks is currently only supported by SoundTouchEffect
       // and non-real-time-preview effects require an audio track selection.
       //
       // Note: m_dSemitonesChange is private to ChangePitch because it only
-      // needs to pass it along to mSoundTouch (above). I added mSemitones
+      // needs to pass it along to SoundTouch (above). I added mSemitones
       // to SoundTouchEffect (the super class) to convey this value
       // to process Note tracks. This approach minimizes changes to existing
       // code, but it would be cleaner to change all m_dSemitonesChange to
@@ -217,7 +218,7 @@ bool EffectChangePitch::Process()
       // eliminate the next line:
       mSemitones = m_dSemitonesChange;
 #endif
-      return EffectSoundTouch::ProcessWithTimeWarper(warper);
+      return EffectSoundTouch::ProcessWithTimeWarper(initer, warper);
    }
 }
 
@@ -266,12 +266,32 @@ bool EffectChangeSpeed::Process()
             auto start = pOutWaveTrack->TimeToLongSamples(mCurT0);
             auto end = pOutWaveTrack->TimeToLongSamples(mCurT1);
 
-            //ProcessOne() (implemented below) processes a single track
-            if (!ProcessOne(pOutWaveTrack, start, end))
+            // Resample a stereo pair at once if both channels cover the
+            // same samples
+            WaveTrack *pRight = nullptr;
+            if (pOutWaveTrack->GetLinked())
+            {
+               auto pLink = static_cast<WaveTrack*>(pOutWaveTrack->GetLink());
+               if (pLink && pLink->GetSelected() &&
+                   pLink->GetRate() == pOutWaveTrack->GetRate() &&
+                   pLink->GetStartTime() == pOutWaveTrack->GetStartTime() &&
+                   pLink->GetEndTime() == pOutWaveTrack->GetEndTime())
+                  pRight = pLink;
+            }
+
+            //ProcessOne() (implemented below) processes a single track,
+            //or a pair
+            if (!ProcessOne(pOutWaveTrack, pRight, start, end))
             {
                bGoodResult = false;
                break;
             }
+
+            if (pRight)
+            {
+               t = iter.Next();
+               mCurTrackNum++;
+            }
          }
          mCurTrackNum++;
       }
@@ -477,19 +497,24 @@ bool EffectChangeSpeed::ProcessLabelTrack(LabelTrack *lt)
    return true;
 }
 
-// ProcessOne() takes a track, transforms it to bunch of buffer-blocks,
-// and calls libsamplerate code on these blocks.
-bool EffectChangeSpeed::ProcessOne(WaveTrack * track,
+// ProcessOne() takes a track, or a pair, transforms it to bunch of
+// buffer-blocks, and calls libsoxr code on these blocks.
+bool EffectChangeSpeed::ProcessOne(WaveTrack * track, WaveTrack * right,
                            sampleCount start, sampleCount end)
 {
    if (track == NULL)
       return false;
 
+   WaveTrack *const tracks[] = { track, right };
+   const unsigned nChannels = right ? 2 : 1;
+
    // initialization, per examples of Mixer::Mixer and
    // EffectSoundTouch::ProcessOne
 
-   auto outputTrack = mFactory->NewWaveTrack(track->GetSampleFormat(),
-                                                    track->GetRate());
+   std::unique_ptr<WaveTrack> outputTracks[2];
+   for (unsigned cc = 0; cc < nChannels; ++cc)
+      outputTracks[cc] = mFactory->NewWaveTrack(tracks[cc]->GetSampleFormat(),
+                                                tracks[cc]->GetRate());
 
    //Get the length of the selection (as double). len is
    //used simple to calculate a progress meter, so it is easier
@@ -500,14 +525,17 @@ bool EffectChangeSpeed::ProcessOne(WaveTrack * track,
    // the length of the selection being processed.
    auto inBufferSize = track->GetMaxBlockSize();
 
-   Floats inBuffer{ inBufferSize };
+   FloatBuffers inBuffers{ nChannels, inBufferSize };
+   float *inPointers[] = { inBuffers[0].get(), right ? inBuffers[1].get() : nullptr };
 
    // mFactor is at most 100-fold so this shouldn't overflow size_t
    auto outBufferSize = size_t( mFactor * inBufferSize + 10 );
-   Floats outBuffer{ outBufferSize };
+   FloatBuffers outBuffers{ nChannels, outBufferSize };
+   float *outPointers[] = { outBuffers[0].get(), right ? outBuffers[1].get() : nullptr };
 
-   // Set up the resampling stuff for this track.
-   Resample resample(true, mFactor, mFactor); // constant rate resampling
+   // Set up the resampling stuff for this track.  This is offline, so the
+   // channels of a pair may be resampled on several threads.
+   Resample resample(true, mFactor, mFactor, nChannels, true); // constant rate resampling
 
    //Go through the track one buffer at a time. samplePos counts which
    //sample the current buffer starts at.
@@ -520,42 +548,48 @@ bool EffectChangeSpeed::ProcessOne(WaveTrack * track,
          end - samplePos
       );
 
-      //Get the samples from the track and put them in the buffer
-      track->Get((samplePtr) inBuffer.get(), floatSample, samplePos, blockSize);
+      //Get the samples from the tracks and put them in the buffers
+      for (unsigned cc = 0; cc < nChannels; ++cc)
+         tracks[cc]->Get((samplePtr) inPointers[cc], floatSample,
+                         samplePos, blockSize);
 
       const auto results = resample.Process(mFactor,
-                                    inBuffer.get(),
+                                    inPointers,
                                     blockSize,
                                     ((samplePos + blockSize) >= end),
-                                    outBuffer.get(),
+                                    outPointers,
                                     outBufferSize);
       const auto outgen = results.second;
 
       if (outgen > 0)
-         outputTrack->Append((samplePtr)outBuffer.get(), floatSample,
-                             outgen);
+         for (unsigned cc = 0; cc < nChannels; ++cc)
+            outputTracks[cc]->Append((samplePtr)outPointers[cc], floatSample,
+                                     outgen);
 
       // Increment samplePos
       samplePos += results.first;
 
-      // Update the Progress meter
-      if (TrackProgress(mCurTrackNum, (samplePos - start).as_double() / len)) {
+      // Update the Progress meter; a pair counts for two tracks
+      const auto frac = (samplePos - start).as_double() / len;
+      if (TrackProgress(mCurTrackNum, nChannels * frac)) {
          bResult = false;
          break;
       }
    }
 
-   // Flush the output WaveTrack (since it's buffered, too)
-   outputTrack->Flush();
+   // Flush the output WaveTracks (since they're buffered, too)
+   for (unsigned cc = 0; cc < nChannels; ++cc)
+      outputTracks[cc]->Flush();
 
-   // Take the output track and insert it in place of the original
+   // Take the output tracks and insert them in place of the original
    // sample data
-   double newLength = outputTrack->GetEndTime();
+   double newLength = outputTracks[0]->GetEndTime();
    if (bResult)
    {
       LinearTimeWarper warper { mCurT0, mCurT0, mCurT1, mCurT0 + newLength };
-      track->ClearAndPaste(
-         mCurT0, mCurT1, outputTrack.get(), true, false, &warper);
+      for (unsigned cc = 0; cc < nChannels; ++cc)
+         tracks[cc]->ClearAndPaste(
+            mCurT0, mCurT1, outputTracks[cc].get(), true, false, &warper);
    }
 
    if (newLength > mMaxNewLength)
@@ -64,7 +64,9 @@ public:
 private:
    // EffectChangeSpeed implementation
 
-   bool ProcessOne(WaveTrack *t, sampleCount start, sampleCount end);
+   // right, if not null, is resampled together with t
+   bool ProcessOne(WaveTrack *t, WaveTrack *right,
+                   sampleCount start, sampleCount end);
    bool ProcessLabelTrack(LabelTrack *t);
 
    // handlers
@@ -27,6 +27,7 @@
 #include "../Audacity.h"
 #include "ClickRemoval.h"
 
+#include <algorithm>
 #include <math.h>
 
 #include <wx/intl.h>
@@ -38,6 +39,7 @@
 #include "../widgets/valnum.h"
 
 #include "../WaveTrack.h"
+#include "../TaskScheduler.h"
 
 enum
 {
@@ -220,29 +222,59 @@ bool EffectClickRemoval::ProcessOne(int count, WaveTrack * track, sampleCount st
    if (idealBlockLen % windowSize != 0)
       idealBlockLen += (windowSize - (idealBlockLen % windowSize));
 
+   // Windows overlap by half.  Each is cleaned in parallel with the others
+   // of its batch, as if the one before changed nothing in the half they
+   // share, and again, in turn, in the rare case that it did.
+   const auto hop = windowSize / 2;
+   const size_t batchSize = 4 * TaskScheduler::Get().GetConcurrency();
+   Floats windows{ batchSize * windowSize };
+   Floats squares{ batchSize * windowSize };
+   Doubles sums{ batchSize * (windowSize + 1) };
+   ArrayOf<bool> changed{ batchSize };
+
    bool bResult = true;
    decltype(len) s = 0;
    Floats buffer{ idealBlockLen };
-   Floats datawindow{ windowSize };
-   while ((len - s) > windowSize / 2)
+   while ((len - s) > hop)
    {
       auto block = limitSampleBufferSize( idealBlockLen, len - s );
 
       track->Get((samplePtr) buffer.get(), floatSample, start + s, block);
 
-      for (decltype(block) i = 0; i + windowSize / 2 < block; i += windowSize / 2)
-      {
-         auto wcopy = std::min( windowSize, block - i );
-
-         for(decltype(wcopy) j = 0; j < wcopy; j++)
-            datawindow[j] = buffer[i+j];
-         for(auto j = wcopy; j < windowSize; j++)
-            datawindow[j] = 0;
-
-         mbDidSomething |= RemoveClicks(windowSize, datawindow.get());
-
-         for(decltype(wcopy) j = 0; j < wcopy; j++)
-           buffer[i+j] = datawindow[j];
+      const auto nWindows = (block - 1) / hop;
+      // Copies window w of the buffer into slot n, padded with zeroes,
+      // and cleans it
+      const auto clean = [&](size_t w, size_t n) {
+         const auto wcopy = std::min( windowSize, block - w * hop );
+         const auto window = windows.get() + n * windowSize;
+         std::copy(buffer.get() + w * hop, buffer.get() + w * hop + wcopy,
+                   window);
+         std::fill(window + wcopy, window + windowSize, 0.0f);
+         changed[n] = RemoveClicks(windowSize, window,
+            squares.get() + n * windowSize,
+            sums.get() + n * (windowSize + 1));
+      };
+
+      for (size_t first = 0; first < nWindows; first += batchSize) {
+         const auto nn = std::min(batchSize, nWindows - first);
+         TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, nn, [&](size_t n) {
+            clean(first + n, n);
+         });
+
+         bool redo = false;
+         for (size_t n = 0; n < nn; ++n) {
+            const auto w = first + n;
+            if (redo)
+               clean(w, n);
+            mbDidSomething |= changed[n];
+
+            const auto wcopy = std::min( windowSize, block - w * hop );
+            const auto window = windows.get() + n * windowSize;
+            auto dest = buffer.get() + w * hop;
+            redo = changed[n] &&
+               !std::equal(window + hop, window + wcopy, dest + hop);
+            std::copy(window, window + wcopy, dest);
+         }
       }
 
       if (mbDidSomething) // RemoveClicks() actually did something.
@@ -260,59 +292,57 @@ bool EffectClickRemoval::ProcessOne(int count, WaveTrack * track, sampleCount st
    return bResult;
 }
 
-bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer)
+bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer,
+                                      float *b2, double *sums) const
 {
    bool bResult = false; // This effect usually does nothing.
    size_t i;
    size_t j;
    int left = 0;
 
-   float msw;
-   int ww;
-   int s2 = sep/2;
-   Floats ms_seq{ len };
-   Floats b2{ len };
+   /* Cheat by rounding sep up to a power of two, as the passes of
+    * doubling that once summed the squares did.
+    */
+   size_t span = 1;
+   while ((int)span < sep)
+      span *= 2;
+   const size_t s2 = span / 2;
 
    for( i=0; i<len; i++)
       b2[i] = buffer[i]*buffer[i];
 
-   /* Shortcut for rms - multiple passes through b2, accumulating
-    * as we go.
+   /* Prefix sums of the squares give the mean square of the span
+    * following each sample.
     */
-   for(i=0;i<len;i++)
-      ms_seq[i]=b2[i];
-
-   for(i=1; (int)i < sep; i *= 2) {
-      for(j=0;j<len-i; j++)
-         ms_seq[j] += ms_seq[j+i];
-   }
-
-   /* Cheat by truncating sep to next-lower power of two... */
-   sep = i;
+   sums[0] = 0;
+   for( i=0; i<len; i++)
+      sums[i+1] = sums[i] + b2[i];
 
-   for( i=0; i<len-sep; i++ ) {
-      ms_seq[i] /= sep;
-   }
    /* ww runs from about 4 to mClickWidth.  wrc is the reciprocal;
     * chosen so that integer roundoff doesn't clobber us.
     */
    int wrc;
    for(wrc=mClickWidth/4; wrc>=1; wrc /= 2) {
-      ww = mClickWidth/wrc;
+      const size_t ww = mClickWidth/wrc;
 
-      for( i=0; i<len-sep; i++ ){
-         msw = 0;
-         for( j=0; (int)j<ww; j++) {
-            msw += b2[i+s2+j];
-         }
-         msw /= ww;
+      /* The sum of the ww squares from i+s2, kept running, but summed
+       * again after an interpolation changes them.
+       */
+      double msw = 0;
+      for( j=0; j<ww; j++)
+         msw += b2[s2+j];
+
+      for( i=0; i<len-span; i++ ){
+         if (i > 0)
+            msw += b2[i+s2+ww-1] - b2[i+s2-1];
+         const double ms = (sums[i+span] - sums[i]) / span;
 
-         if(msw >= mThresholdLevel * ms_seq[i]/10) {
+         if(msw / ww >= mThresholdLevel * ms / 10) {
             if( left == 0 ) {
                left = i+s2;
             }
          } else {
-            if(left != 0 && ((int)i-left+s2) <= ww*2) {
+            if(left != 0 && ((int)i-left+(int)s2) <= (int)ww*2) {
                float lv = buffer[left];
                float rv = buffer[i+ww+s2];
                for(j=left; j<i+ww+s2; j++) {
@@ -321,6 +351,9 @@ bool EffectClickRemoval::RemoveClicks(size_t len, float *buffer)
                   b2[j] = buffer[j]*buffer[j];
                }
                left=0;
+               msw = 0;
+               for( j=0; j<ww; j++)
+                  msw += b2[i+s2+j];
             } else if(left != 0) {
                left = 0;
             }
@@ -63,7 +63,9 @@ private:
    bool ProcessOne(int count, WaveTrack * track,
                    sampleCount start, sampleCount len);
 
-   bool RemoveClicks(size_t len, float *buffer);
+   // squares and sums are scratch of len and len + 1 values
+   bool RemoveClicks(size_t len, float *buffer,
+                     float *squares, double *sums) const;
 
    void OnWidthText(wxCommandEvent & evt);
    void OnThreshText(wxCommandEvent & evt);
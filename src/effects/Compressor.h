@@ -21,15 +21,15 @@
 #include <wx/window.h>
 #include "../widgets/wxPanelWrapper.h"
 
-#include "TwoPassSimpleMono.h"
-#include "../SampleFormat.h"
+#include "Effect.h"
+#include "CompressorCore.h"
 
 class EffectCompressorPanel;
 class ShuttleGui;
 
 #define COMPRESSOR_PLUGIN_SYMBOL IdentInterfaceSymbol{ XO("Compressor") }
 
-class EffectCompressor final : public EffectTwoPassSimpleMono
+class EffectCompressor final : public Effect
 {
 public:
 
@@ -48,6 +48,11 @@ public:
 
    // EffectClientInterface implementation
 
+   unsigned GetAudioInCount() override;
+   unsigned GetAudioOutCount() override;
+   sampleCount GetLatency() override;
+   bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
+   size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
    bool DefineParams( ShuttleParams & S ) override;
    bool GetAutomationParameters(CommandParameters & parms) override;
    bool SetAutomationParameters(CommandParameters & parms) override;
@@ -59,32 +64,20 @@ public:
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
 
-protected:
-   // EffectTwoPassSimpleMono implementation
-
+   // The first pass compresses, and the second, if normalizing, divides
+   // by the peak that the first found
    bool InitPass1() override;
    bool InitPass2() override;
-   bool NewTrackPass1() override;
-   bool ProcessPass2(float *buffer, size_t len) override;
-   bool TwoBufferProcessPass1
-      (float *buffer1, size_t len1, float *buffer2, size_t len2) override;
 
 private:
    // EffectCompressor implementation
 
-   void FreshenCircle();
-   float AvgCircle(float x);
-   void Follow(float *buffer, float *env, size_t len, float *previous, size_t previous_len);
-   float DoCompression(float x, double env);
-
    void OnSlider(wxCommandEvent & evt);
    void UpdateUI();
 
 private:
-   double    mRMSSum;
-   size_t    mCircleSize;
-   size_t    mCirclePos;
-   Doubles   mCircle;
+   CompressorCore mCore;
+   bool      mLatencyDone;
 
    double    mAttackTime;
    double    mThresholdDB;
@@ -94,19 +87,8 @@ private:
    bool      mUsePeak;
 
    double    mDecayTime;   // The "Release" time.
-   double    mAttackFactor;
-   double    mAttackInverseFactor;
-   double    mDecayFactor;
-   double    mThreshold;
-   double    mCompression;
-   double    mNoiseFloor;
-   int       mNoiseCounter;
-   double    mGain;
-   double    mLastLevel;
-   Floats mFollow1, mFollow2;
-   size_t    mFollowLen;
-
-   double    mMax;			//MJS
+
+   float     mMax;			//MJS
 
    EffectCompressorPanel *mPanel;
 
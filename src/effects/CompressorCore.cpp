@@ -0,0 +1,208 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CompressorCore.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "../Audacity.h"
+#include "CompressorCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Samples followed at a time, so that the gains of each block are
+// computed together, on the stack
+const size_t BlockSize = 256;
+// Squares averaged for the RMS level
+const size_t CircleSize = 100;
+// Quiet samples in a row before the envelope is held
+const int NoiseHold = 100;
+
+// log2(x) for normal x > 0, within about 1e-7 relative.  Without
+// branches or library calls, so that a loop of them may be vectorized.
+inline float FastLog2(float x)
+{
+   uint32_t bits;
+   memcpy(&bits, &x, sizeof bits);
+   // Split x into 2^exponent times a mantissa in [sqrt(1/2), sqrt(2))
+   const uint32_t high = (bits & 0x007fffff) > 0x3504f3 ? 1 : 0;
+   const int exponent = int((bits >> 23) & 0xff) - 127 + int(high);
+   bits = (bits & 0x007fffff) | ((127 - high) << 23);
+   float m;
+   memcpy(&m, &bits, sizeof m);
+
+   // ln m = 2 atanh t, by its series, with |t| < 0.172
+   const float t = (m - 1.0f) / (m + 1.0f);
+   const float t2 = t * t;
+   const float ln =
+      2.0f * t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7))));
+   return exponent + ln * float(M_LOG2E);
+}
+
+// 2^y, within about 1e-7 relative, for y in [-126, 126] and clamped
+// beyond
+inline float FastExp2(float y)
+{
+   y = std::min(126.0f, std::max(-126.0f, y));
+   // Round to the nearest, so that the fraction is no more than a half
+   const int n = int(y + 126.5f) - 126;
+   const float f = (y - n) * float(M_LN2);
+   const float p = 1.0f + f * (1.0f + f * (1.0f / 2 + f * (1.0f / 6 +
+      f * (1.0f / 24 + f * (1.0f / 120 + f * (1.0f / 720))))));
+
+   const uint32_t bits = uint32_t(n + 127) << 23;
+   float scale;
+   memcpy(&scale, &bits, sizeof scale);
+   return p * scale;
+}
+
+}
+
+void CompressorCore::Init(const Settings &settings, double rate)
+{
+   mUsePeak = settings.usePeak;
+   mThreshold = DB_TO_LINEAR(settings.thresholdDB);
+   mNoiseFloor = DB_TO_LINEAR(settings.noiseFloorDB);
+
+   // Each falls from 1.0 to the threshold in the given time
+   const double attackSamples = rate * settings.attackTime + 0.5;
+   mAttackInverseFactor = exp(log(mThreshold) / attackSamples);
+   mDecayFactor = exp(log(mThreshold) / (rate * settings.releaseTime + 0.5));
+
+   mCompression =
+      settings.ratio > 1 ? 1.0 - 1.0 / settings.ratio : 0.0;
+   // Peak values map 1.0 to 1.0 - 'upward' compression.  With RMS-based
+   // compression don't change values below the threshold - 'downward'
+   // compression
+   mLog2Reference = mUsePeak ? 0.0f : log2(mThreshold);
+
+   mLookAhead = (size_t)ceil(attackSamples);
+   mRingSize = mLookAhead + BlockSize;
+   mInput.reinit(mRingSize);
+   mEnvelope.reinit(mRingSize);
+   mCircle.reinit(CircleSize);
+
+   Reset();
+}
+
+void CompressorCore::Reset()
+{
+   mRingPos = 0;
+   mPending = 0;
+
+   std::fill(mCircle.get(), mCircle.get() + CircleSize, 0.0);
+   mCirclePos = 0;
+   mRMSSum = 0.0;
+
+   mLastLevel = mThreshold;
+   mNoiseCounter = NoiseHold;
+}
+
+void CompressorCore::Process(const float *in, float *out, size_t len)
+{
+   while (len > 0) {
+      const auto block = std::min(len, BlockSize);
+      ProcessBlock(in, out, block);
+      in += block;
+      out += block;
+      len -= block;
+   }
+}
+
+float CompressorCore::AvgCircle(float value)
+{
+   // Calculate current level from root-mean-squared of
+   // circular buffer ("RMS")
+   mRMSSum -= mCircle[mCirclePos];
+   mCircle[mCirclePos] = value * value;
+   mRMSSum += mCircle[mCirclePos];
+   mCirclePos = (mCirclePos + 1) % CircleSize;
+
+   return sqrt(std::max(0.0, mRMSSum) / CircleSize);
+}
+
+void CompressorCore::ProcessBlock(const float *in, float *out, size_t len)
+{
+   if (!mUsePeak) {
+      // Recompute the RMS sum periodically to prevent accumulation of
+      // rounding errors during long waveforms
+      mRMSSum = 0;
+      for (size_t i = 0; i < CircleSize; i++)
+         mRMSSum += mCircle[i];
+   }
+
+   // First apply a peak detect with the requested decay rate
+   double last = mLastLevel;
+   for (size_t i = 0; i < len; i++) {
+      const float value = in[i];
+      const double level = mUsePeak ? fabs(value) : AvgCircle(value);
+      // Don't increase gain when signal is continuously below the noise floor
+      if (level < mNoiseFloor)
+         mNoiseCounter = std::min(mNoiseCounter + 1, NoiseHold);
+      else
+         mNoiseCounter = 0;
+      if (mNoiseCounter < NoiseHold) {
+         last *= mDecayFactor;
+         if (last < mThreshold)
+            last = mThreshold;
+         if (level > last)
+            last = level;
+      }
+      mInput[mRingPos] = value;
+      mEnvelope[mRingPos] = last;
+      if (++mRingPos == mRingSize)
+         mRingPos = 0;
+   }
+   mLastLevel = last;
+
+   // Then go back over the new samples, and on into those pending, to
+   // start the rise to each peak at the attack rate.  The pending envelope
+   // already falls no faster than that, so where the rise meets it, it
+   // meets all of it before.
+   auto index = mRingPos;
+   for (size_t i = 0; i < len + mPending; i++) {
+      index = (index == 0 ? mRingSize : index) - 1;
+      last *= mAttackInverseFactor;
+      if (last < mThreshold)
+         last = mThreshold;
+      if (mEnvelope[index] < last)
+         mEnvelope[index] = last;
+      else {
+         last = mEnvelope[index];
+         if (i >= len)
+            break;
+      }
+   }
+
+   // Output the oldest samples, once as many follow them as the attack
+   // needs, and silence before the first of them
+   const auto total = mPending + len;
+   const auto ready = total > mLookAhead ? total - mLookAhead : 0;
+   const auto silent = len - ready;
+   std::fill(out, out + silent, 0.0f);
+
+   float envelope[BlockSize];
+   float samples[BlockSize];
+   index = (mRingPos + mRingSize - total) % mRingSize;
+   for (size_t i = 0; i < ready; i++) {
+      envelope[i] = mEnvelope[index];
+      samples[i] = mInput[index];
+      if (++index == mRingSize)
+         index = 0;
+   }
+   out += silent;
+   for (size_t i = 0; i < ready; i++)
+      out[i] = samples[i] *
+         FastExp2(mCompression * (mLog2Reference - FastLog2(envelope[i])));
+
+   mPending = total - ready;
+}
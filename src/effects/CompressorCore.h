@@ -0,0 +1,93 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CompressorCore.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class CompressorCore
+\brief The envelope follower and gain of the Compressor, as a stream with
+constant memory.
+
+  The follower is Roger Dannenberg's, from Nyquist:  the level, peak or
+  RMS, is held up with the release rate going forward, and then the rise
+  to each peak is started ahead of it at the attack rate, by working back
+  over the samples not yet output.  Those are kept in a ring as long as
+  the attack time, so the output lags the input by that many samples, and
+  the rise to any peak no louder than 0 dB starts from the threshold.
+
+  Samples are taken in short blocks, with the gains computed by a fast
+  log and exp over each block.  Process() allocates nothing, so it may be
+  called by a realtime thread.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_COMPRESSOR_CORE__
+#define __AUDACITY_COMPRESSOR_CORE__
+
+#include "../SampleFormat.h"
+
+class CompressorCore
+{
+public:
+   struct Settings
+   {
+      double thresholdDB;
+      double noiseFloorDB;
+      double ratio;
+      double attackTime;   // seconds
+      double releaseTime;  // seconds
+      bool usePeak;
+   };
+
+   /// Allocates the rings for the attack time, and Reset()s
+   void Init(const Settings &settings, double rate);
+
+   /// Forgets the input already seen
+   void Reset();
+
+   /// The delay, in samples, that Process() adds
+   size_t GetLatency() const { return mLookAhead; }
+
+   /// Compresses len samples, delayed by GetLatency(), the first of them
+   /// silence.  out may be the same as in.
+   void Process(const float *in, float *out, size_t len);
+
+private:
+   // Follows and outputs no more than BlockSize samples
+   void ProcessBlock(const float *in, float *out, size_t len);
+   float AvgCircle(float value);
+
+   size_t mLookAhead{ 0 };
+
+   // The input and its envelope, the last mLookAhead samples not yet
+   // output, and room for a block after them
+   Floats mInput;
+   Floats mEnvelope;
+   size_t mRingSize{ 0 };
+   size_t mRingPos{ 0 };
+   size_t mPending{ 0 };
+
+   // The squares of the last samples, for the RMS level
+   Doubles mCircle;
+   size_t mCirclePos{ 0 };
+   double mRMSSum{ 0 };
+
+   bool mUsePeak{ false };
+   double mThreshold{ 1 };
+   double mNoiseFloor{ 0 };
+   double mAttackInverseFactor{ 1 };
+   double mDecayFactor{ 1 };
+   float mCompression{ 0 };
+   // log2 of the level that is left unchanged
+   float mLog2Reference{ 0 };
+
+   double mLastLevel{ 1 };
+   int mNoiseCounter{ 0 };
+};
+
+#endif
@@ -0,0 +1,130 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  Convolver.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "../Audacity.h"
+#include "Convolver.h"
+
+#include <algorithm>
+
+Convolver::Convolver(size_t blockSize)
+   : mBlockSize{ blockSize }
+   , hFFT{ GetFFT(2 * blockSize) }
+   , mInput{ 2 * blockSize, true }
+   , mScratch{ 2 * blockSize }
+   , mSum{ 2 * blockSize }
+   , mPending{ blockSize, true }
+   , mFiltered{ blockSize, true }
+{
+   SetFilter(nullptr, 0);
+}
+
+void Convolver::SetFilter(const float *taps, size_t nTaps)
+{
+   const auto size = 2 * mBlockSize;
+   const auto partitions =
+      std::max<size_t>(1, (nTaps + mBlockSize - 1) / mBlockSize);
+   if (partitions != mPartitions) {
+      mPartitions = partitions;
+      mFilterSpectra.reinit(mPartitions * size);
+      mInputSpectra.reinit(mPartitions * size);
+      Reset();
+   }
+
+   for (size_t p = 0; p < mPartitions; ++p) {
+      float *spectrum = &mFilterSpectra[p * size];
+      const auto first = std::min(nTaps, p * mBlockSize);
+      const auto count = std::min(nTaps - first, mBlockSize);
+      if (count > 0)
+         std::copy(taps + first, taps + first + count, spectrum);
+      // Padded to twice the length, so that the products don't wrap around
+      std::fill(spectrum + count, spectrum + size, 0.0f);
+      Transform(spectrum);
+   }
+}
+
+void Convolver::Reset()
+{
+   const auto size = 2 * mBlockSize;
+   std::fill(mInputSpectra.get(), mInputSpectra.get() + mPartitions * size,
+      0.0f);
+   std::fill(mInput.get(), mInput.get() + size, 0.0f);
+   std::fill(mPending.get(), mPending.get() + mBlockSize, 0.0f);
+   std::fill(mFiltered.get(), mFiltered.get() + mBlockSize, 0.0f);
+   mNewest = 0;
+   mPendingCount = 0;
+}
+
+void Convolver::ProcessBlock(const float *in, float *out)
+{
+   const auto size = 2 * mBlockSize;
+
+   std::copy(mInput.get() + mBlockSize, mInput.get() + size, mInput.get());
+   std::copy(in, in + mBlockSize, mInput.get() + mBlockSize);
+
+   mNewest = (mNewest + 1) % mPartitions;
+   float *newest = &mInputSpectra[mNewest * size];
+   std::copy(mInput.get(), mInput.get() + size, newest);
+   Transform(newest);
+
+   // The p-th partition of the response meets the input of p blocks ago
+   std::fill(mSum.get(), mSum.get() + size, 0.0f);
+   for (size_t p = 0; p < mPartitions; ++p) {
+      const auto slot = (mNewest + mPartitions - p) % mPartitions;
+      const float *x = &mInputSpectra[slot * size];
+      const float *h = &mFilterSpectra[p * size];
+      // DC and Fs/2 components are purely real
+      mSum[0] += x[0] * h[0];
+      mSum[1] += x[1] * h[1];
+      for (size_t i = 2; i < size; i += 2) {
+         mSum[i] += x[i] * h[i] - x[i + 1] * h[i + 1];
+         mSum[i + 1] += x[i] * h[i + 1] + x[i + 1] * h[i];
+      }
+   }
+
+   // Inverse FFT and normalization; the first half of the result has
+   // wrapped around, and the second is this block's output
+   InverseRealFFTf(mSum.get(), hFFT.get());
+   ReorderToTime(hFFT.get(), mSum.get(), mScratch.get());
+   std::copy(mScratch.get() + mBlockSize, mScratch.get() + size, out);
+}
+
+void Convolver::Process(const float *in, float *out, size_t len)
+{
+   while (len > 0) {
+      const auto count = std::min(len, mBlockSize - mPendingCount);
+      // Take the input before writing the output, which may overlap it
+      std::copy(in, in + count, mPending.get() + mPendingCount);
+      std::copy(mFiltered.get() + mPendingCount,
+         mFiltered.get() + mPendingCount + count, out);
+      mPendingCount += count;
+      in += count;
+      out += count;
+      len -= count;
+
+      if (mPendingCount == mBlockSize) {
+         ProcessBlock(mPending.get(), mFiltered.get());
+         mPendingCount = 0;
+      }
+   }
+}
+
+void Convolver::Transform(float *buffer)
+{
+   RealFFTf(buffer, hFFT.get());
+
+   mScratch[0] = buffer[0];
+   mScratch[1] = buffer[1];
+   for (size_t i = 1; i < mBlockSize; ++i) {
+      mScratch[2 * i] = buffer[hFFT->BitReversed[i]];
+      mScratch[2 * i + 1] = buffer[hFFT->BitReversed[i] + 1];
+   }
+   std::copy(mScratch.get(), mScratch.get() + 2 * mBlockSize, buffer);
+}
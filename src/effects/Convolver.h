@@ -0,0 +1,86 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  Convolver.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class Convolver
+\brief Filters a stream with a long FIR response, such as an equalization
+curve or an impulse response, by uniformly partitioned convolution.
+
+  The response is cut into partitions of the block size, each transformed
+  once.  Each block of input is transformed once too, and kept in a
+  frequency domain delay line; a block of output is the sum over the
+  partitions of their products with the spectra of as many past blocks,
+  transformed back with overlap-save.  So the FFTs stay small, at twice
+  the block size, however long the response, and the delay is only that
+  of the block.
+
+  ProcessBlock() filters whole blocks without delay.  Process() takes any
+  number of samples, such as a realtime effect is given, and delays them
+  by the block size.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_CONVOLVER__
+#define __AUDACITY_CONVOLVER__
+
+#include "../RealFFTf.h"
+#include "../SampleFormat.h"
+
+class Convolver
+{
+public:
+   /// blockSize must be a power of two, at least 4
+   explicit Convolver(size_t blockSize);
+
+   size_t GetBlockSize() const { return mBlockSize; }
+   /// The delay, in samples, that Process() adds
+   size_t GetLatency() const { return mBlockSize; }
+
+   /// Replaces the response.  The input already seen is kept, unless the
+   /// number of partitions changes.
+   void SetFilter(const float *taps, size_t nTaps);
+
+   /// Forgets the input already seen
+   void Reset();
+
+   /// Filters GetBlockSize() samples.  out may be the same as in.
+   void ProcessBlock(const float *in, float *out);
+
+   /// Filters len samples, delayed by GetLatency().  out may be the same
+   /// as in.  Don't mix with ProcessBlock() without a Reset() between.
+   void Process(const float *in, float *out, size_t len);
+
+private:
+   // Spectra are kept as RealFFTf leaves them, but in the natural order:
+   // the DC and Fs/2 values, then the real and imaginary parts of each bin
+   void Transform(float *buffer);
+
+   const size_t mBlockSize;
+   HFFT hFFT;
+
+   size_t mPartitions{ 0 };
+   // The spectra of the partitions of the response, one after another
+   Floats mFilterSpectra;
+   // The spectra of as many past blocks of input, as a ring
+   Floats mInputSpectra;
+   size_t mNewest{ 0 };
+
+   // The last two blocks of input, the newer second
+   Floats mInput;
+   Floats mScratch;
+   Floats mSum;
+
+   // For Process(), blocks gathered and blocks filtered
+   Floats mPending;
+   Floats mFiltered;
+   size_t mPendingCount{ 0 };
+};
+
+#endif
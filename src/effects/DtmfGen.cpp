@@ -17,6 +17,8 @@
 #include "../Experimental.h"
 #include "DtmfGen.h"
 
+#include <algorithm>
+
 #include <wx/intl.h>
 #include <wx/valgen.h>
 #include <wx/valtext.h>
@@ -469,9 +471,9 @@ bool EffectDtmf::MakeDtmfTone(float *buffer, size_t len, float fs, wxChar tone,
   sin wave is generated by:
    s(n)=sin(2*pi*n*f/fs)
 
-  We will precalculate:
-     A= 2*pi*f1/fs
-     B= 2*pi*f2/fs
+  The sines are read from a table by two
+  oscillators, at f1/fs and f2/fs cycles per
+  sample.
 
   And use two switch statements to select the frequency
 
@@ -482,7 +484,7 @@ bool EffectDtmf::MakeDtmfTone(float *buffer, size_t len, float fs, wxChar tone,
 */
 
    float f1, f2=0.0;
-   double A,B;
+   double A;
 
    // select low tone: left column
    switch (tone) {
@@ -536,17 +538,22 @@ bool EffectDtmf::MakeDtmfTone(float *buffer, size_t len, float fs, wxChar tone,
          f2=0;
    }
 
-   // precalculations
-   A=B=2*M_PI/fs;
-   A*=f1;
-   B*=f2;
-
-   // now generate the wave: 'last' is used to avoid phase errors
-   // when inside the inner for loop of the Process() function.
-   for(decltype(len) i = 0; i < len; i++) {
-      buffer[i] = amplitude * 0.5 *
-         (sin( A * (i + last).as_double() ) +
-          sin( B * (i + last).as_double() ));
+   // now generate the wave: the oscillators keep their phases from one
+   // call to the next, so only restart them at the start of the tone
+   if (last == 0) {
+      lowTone.SetPhase(0);
+      highTone.SetPhase(0);
+   }
+   const size_t ChunkSize = 256;
+   float high[ChunkSize];
+   for(decltype(len) done = 0; done < len;) {
+      const auto count = std::min(ChunkSize, len - done);
+      float *low = buffer + done;
+      lowTone.Generate(low, count, double(f1) / fs);
+      highTone.Generate(high, count, double(f2) / fs);
+      for(size_t i = 0; i < count; i++)
+         low[i] = amplitude * 0.5 * (low[i] + high[i]);
+      done += count;
    }
 
    // generate a fade-in of duration 1/250th of second
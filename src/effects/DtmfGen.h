@@ -22,6 +22,7 @@
 #include "../widgets/NumericTextCtrl.h"
 
 #include "Effect.h"
+#include "WavetableOscillator.h"
 
 class ShuttleGui;
 
@@ -84,6 +85,8 @@ private:
    sampleCount curTonePos;          // position in tone to start the wave
    bool isTone;                     // true if block is tone, otherwise silence
    int curSeqPos;                   // index into dtmf tone string
+   WavetableOscillator lowTone;     // the two sines of the current tone
+   WavetableOscillator highTone;
 
    wxString dtmfSequence;             // dtmf tone string
    int    dtmfNTones;               // total number of tones to generate
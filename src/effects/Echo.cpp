@@ -22,6 +22,7 @@
 #include "../Audacity.h"
 #include "Echo.h"
 
+#include <algorithm>
 #include <float.h>
 
 #include <wx/intl.h>
@@ -74,6 +75,15 @@ EffectType EffectEcho::GetType()
    return EffectTypeProcess;
 }
 
+bool EffectEcho::SupportsRealtime()
+{
+#if defined(EXPERIMENTAL_REALTIME_AUDACITY_EFFECTS)
+   return true;
+#else
+   return false;
+#endif
+}
+
 // EffectClientInterface implementation
 
 unsigned EffectEcho::GetAudioInCount()
@@ -93,47 +103,81 @@ bool EffectEcho::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames
       return false;
    }
 
-   histPos = 0;
-   auto requestedHistLen = (sampleCount) (mSampleRate * delay);
-
-   // Guard against extreme delay values input by the user
-   try {
-      // Guard against huge delay values from the user.
-      // Don't violate the assertion in as_size_t
-      if (requestedHistLen !=
-            (histLen = static_cast<size_t>(requestedHistLen.as_long_long())))
-         throw std::bad_alloc{};
-      history.reinit(histLen, true);
-   }
-   catch ( const std::bad_alloc& ) {
+   if (!InstanceInit(mMaster, mSampleRate))
+   {
       Effect::MessageBox(_("Requested value exceeds memory capacity."));
       return false;
    }
 
-   return history != NULL;
+   return true;
 }
 
 bool EffectEcho::ProcessFinalize()
 {
-   history.reset();
+   mMaster.history.reset();
    return true;
 }
 
 size_t EffectEcho::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
 {
-   float *ibuf = inBlock[0];
-   float *obuf = outBlock[0];
+   return InstanceProcess(mMaster, inBlock, outBlock, blockLen);
+}
+
+bool EffectEcho::RealtimeInitialize()
+{
+   SetBlockSize(512);
+
+   mSlaves.clear();
+
+   return delay != 0.0;
+}
+
+bool EffectEcho::RealtimeAddProcessor(unsigned WXUNUSED(numChannels), float sampleRate)
+{
+   EffectEchoState slave;
+
+   if (!InstanceInit(slave, sampleRate))
+   {
+      return false;
+   }
+
+   mSlaves.push_back(std::move(slave));
+
+   return true;
+}
+
+bool EffectEcho::RealtimeFinalize()
+{
+   mSlaves.clear();
+
+   return true;
+}
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++, histPos++)
+bool EffectEcho::RealtimeProcessStart()
+{
+   // A new delay needs a delay line of another length; the echoes so far are
+   // lost.  Keep the old one if the new one can't be had.
+   for (auto &slave : mSlaves)
    {
-      if (histPos == histLen)
+      if (slave.delay != delay && delay != 0.0)
       {
-         histPos = 0;
+         EffectEchoState replacement;
+         if (InstanceInit(replacement, slave.samplerate))
+         {
+            slave = std::move(replacement);
+         }
       }
-      history[histPos] = obuf[i] = ibuf[i] + history[histPos] * decay;
    }
 
-   return blockLen;
+   return true;
+}
+
+size_t EffectEcho::RealtimeProcess(int group,
+                                   float **inbuf,
+                                   float **outbuf,
+                                   size_t numSamples)
+{
+   return InstanceProcess(mSlaves[group], inbuf, outbuf, numSamples);
 }
 
 bool EffectEcho::DefineParams( ShuttleParams & S ){
@@ -199,3 +243,61 @@ bool EffectEcho::TransferDataFromWindow()
    return true;
 }
 
+
+// EffectEcho implementation
+
+bool EffectEcho::InstanceInit(EffectEchoState & data, float sampleRate)
+{
+   data.samplerate = sampleRate;
+   data.delay = delay;
+   data.histPos = 0;
+   auto requestedHistLen =
+      std::max<sampleCount>(1, (sampleCount) (sampleRate * delay));
+
+   // Guard against extreme delay values input by the user
+   try {
+      // Guard against huge delay values from the user.
+      // Don't violate the assertion in as_size_t
+      if (requestedHistLen !=
+            (data.histLen = static_cast<size_t>(requestedHistLen.as_long_long())))
+         throw std::bad_alloc{};
+      data.history.reinit(data.histLen, true);
+   }
+   catch ( const std::bad_alloc& ) {
+      data.history.reset();
+      return false;
+   }
+
+   return data.history != NULL;
+}
+
+size_t EffectEcho::InstanceProcess(EffectEchoState & data, float **inBlock, float **outBlock, size_t blockLen)
+{
+   const float *ibuf = inBlock[0];
+   float *obuf = outBlock[0];
+   const double decayd = decay;
+   const auto total = blockLen;
+
+   // Each sample of the delay line is read and written once in a run that
+   // does not wrap, so the loop has no dependency from one sample to the
+   // next, and vectorizes
+   while (blockLen > 0)
+   {
+      if (data.histPos == data.histLen)
+      {
+         data.histPos = 0;
+      }
+      const auto len = std::min(blockLen, data.histLen - data.histPos);
+      float *hist = data.history.get() + data.histPos;
+      for (decltype(blockLen) i = 0; i < len; i++)
+      {
+         hist[i] = obuf[i] = ibuf[i] + hist[i] * decayd;
+      }
+      data.histPos += len;
+      ibuf += len;
+      obuf += len;
+      blockLen -= len;
+   }
+
+   return total;
+}
@@ -16,6 +16,8 @@
 #include <wx/string.h>
 #include <wx/textctrl.h>
 
+#include <vector>
+
 #include "Effect.h"
 #include "../SampleFormat.h"
 
@@ -23,6 +25,17 @@ class ShuttleGui;
 
 #define ECHO_PLUGIN_SYMBOL IdentInterfaceSymbol{ XO("Echo") }
 
+// A circular delay line, as long as the delay
+class EffectEchoState
+{
+public:
+   float samplerate {};
+   double delay {};
+   Floats history;
+   size_t histPos {};
+   size_t histLen {};
+};
+
 class EffectEcho final : public Effect
 {
 public:
@@ -38,6 +51,7 @@ public:
    // EffectDefinitionInterface implementation
 
    EffectType GetType() override;
+   bool SupportsRealtime() override;
 
    // EffectClientInterface implementation
 
@@ -46,6 +60,14 @@ public:
    bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    bool ProcessFinalize() override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
+   bool RealtimeInitialize() override;
+   bool RealtimeAddProcessor(unsigned numChannels, float sampleRate) override;
+   bool RealtimeFinalize() override;
+   bool RealtimeProcessStart() override;
+   size_t RealtimeProcess(int group,
+                          float **inbuf,
+                          float **outbuf,
+                          size_t numSamples) override;
    bool DefineParams( ShuttleParams & S ) override;
    bool GetAutomationParameters(CommandParameters & parms) override;
    bool SetAutomationParameters(CommandParameters & parms) override;
@@ -58,12 +80,15 @@ public:
 private:
    // EffectEcho implementation
 
+   bool InstanceInit(EffectEchoState & data, float sampleRate);
+   size_t InstanceProcess(EffectEchoState & data, float **inBlock, float **outBlock, size_t blockLen);
+
 private:
+   EffectEchoState mMaster;
+   std::vector<EffectEchoState> mSlaves;
+
    double delay;
    double decay;
-   Floats history;
-   size_t histPos;
-   size_t histLen;
 };
 
 #endif // __AUDACITY_EFFECT_ECHO__
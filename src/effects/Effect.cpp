@@ -25,6 +25,10 @@ greater use in future.
 #include "Effect.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include <wx/defs.h>
 #include <wx/hashmap.h>
@@ -43,7 +47,9 @@ greater use in future.
 #include "../LabelTrack.h"
 #include "../Mix.h"
 #include "../Prefs.h"
+#include "../PrefsSnapshot.h"
 #include "../Project.h"
+#include "../TaskScheduler.h"
 #include "../ShuttleGui.h"
 #include "../Shuttle.h"
 #include "../WaveTrack.h"
@@ -401,6 +407,16 @@ size_t Effect::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
    return 0;
 }
 
+bool Effect::SupportsInPlace()
+{
+   if (mClient)
+   {
+      return mClient->SupportsInPlace();
+   }
+
+   return false;
+}
+
 bool Effect::RealtimeInitialize()
 {
    if (mClient)
@@ -1216,6 +1232,9 @@ bool Effect::DoEffect(wxWindow *parent,
       return false;
    }
 
+   // The tracks may change once the prompt is closed
+   auto cleanupPreview = finally( [&] { mPreviewInput.reset(); } );
+
    // Prompting will be bypassed when applying an effect that has already 
    // been configured, e.g. repeating the last effect on a different selection.
    // Prompting may call Effect::Preview
@@ -1272,6 +1291,16 @@ bool Effect::PromptUser(wxWindow *parent)
    return ShowInterface(parent, IsBatchProcessing());
 }
 
+bool Effect::SupportsParallelChunks(size_t & WXUNUSED(lookBack))
+{
+   return false;
+}
+
+bool Effect::SupportsConcurrentTracks(bool & WXUNUSED(useProcessors))
+{
+   return false;
+}
+
 int Effect::GetPass()
 {
    return mPass;
@@ -1287,6 +1316,29 @@ bool Effect::InitPass2()
    return false;
 }
 
+namespace {
+   // Processors buffer several of the largest blocks of the track, so that
+   // output can be written in whole blocks and the effect called less often
+   const size_t ProcessBufferBlocks = 4;
+
+   // The most samples, not more than limit, from pos that end at a block
+   // boundary of the track, or limit if there is none
+   size_t AlignedOutputCount(const WaveTrack *track, sampleCount pos, size_t limit)
+   {
+      size_t result = 0;
+      while (true)
+      {
+         const auto next = track->GetBestBlockSize(pos + result);
+         if (result + next > limit)
+         {
+            break;
+         }
+         result += next;
+      }
+      return result > 0 ? result : limit;
+   }
+}
+
 bool Effect::Process()
 {
    CopyInputTracks(Track::All);
@@ -1318,6 +1370,15 @@ bool Effect::ProcessPass()
    bool bGoodResult = true;
    bool isGenerator = GetType() == EffectTypeGenerate;
 
+   bool useProcessors = false;
+   if (GetType() == EffectTypeProcess &&
+       SupportsConcurrentTracks(useProcessors) &&
+       GetLatency() == 0 &&
+       ProcessTracksConcurrently(useProcessors, bGoodResult))
+   {
+      return bGoodResult;
+   }
+
    FloatBuffers inBuffer, outBuffer;
    ArrayOf<float *> inBufPos, outBufPos;
 
@@ -1408,7 +1469,8 @@ bool Effect::ProcessPass()
       SetSampleRate(left->GetRate());
 
       // Get the block size the client wants to use
-      auto max = left->GetMaxBlockSize() * 2;
+      auto max = left->GetMaxBlockSize() *
+         (GetType() == EffectTypeProcess ? ProcessBufferBlocks : 2);
       mBlockSize = SetBlockSize(max);
 
       // Calculate the buffer size to be at least the max rounded up to the clients
@@ -1483,6 +1545,282 @@ bool Effect::ProcessPass()
    return bGoodResult;
 }
 
+static ChannelName ChannelNameOf(const Track *track)
+{
+   switch (track->GetChannel())
+   {
+   case Track::LeftChannel:
+      return ChannelNameFrontLeft;
+   case Track::RightChannel:
+      return ChannelNameFrontRight;
+   default:
+      return ChannelNameMono;
+   }
+}
+
+bool Effect::ProcessTracksConcurrently(bool useProcessors, bool &bGoodResult)
+{
+   struct Group {
+      WaveTrack *left, *right;
+      sampleCount leftStart, rightStart, len;
+      unsigned nChannels;
+      ChannelName map[3];
+   };
+   std::vector<Group> groups;
+
+   // Find the groups as ProcessPass does, without changing anything yet
+   TrackListIterator iter(mOutputTracks.get());
+   for (Track *t = iter.First(); t; t = iter.Next())
+   {
+      if (t->GetKind() != Track::Wave || !t->GetSelected())
+      {
+         continue;
+      }
+
+      Group group{};
+      group.left = static_cast<WaveTrack *>(t);
+      GetSamples(group.left, &group.leftStart, &group.len);
+      group.nChannels = 1;
+      group.map[0] = ChannelNameOf(group.left);
+      group.map[1] = ChannelNameEOL;
+      if (group.left->GetLinked() && mNumAudioIn > 1)
+      {
+         group.right = static_cast<WaveTrack *>(iter.Next());
+         GetSamples(group.right, &group.rightStart, &group.len);
+         group.nChannels = 2;
+         group.map[1] = ChannelNameOf(group.right);
+         group.map[2] = ChannelNameEOL;
+      }
+
+      if (!groups.empty() && group.left->GetRate() != groups[0].left->GetRate())
+      {
+         return false;
+      }
+      groups.push_back(group);
+   }
+   if (groups.size() < 2)
+   {
+      return false;
+   }
+
+   for (Track *t = iter.First(); t; t = iter.Next())
+   {
+      if ((t->GetKind() != Track::Wave || !t->GetSelected()) &&
+          t->IsSyncLockSelected())
+      {
+         t->SyncLockAdjust(mT1, mT0 + mDuration);
+      }
+   }
+
+   bGoodResult = true;
+
+   SetSampleRate(groups[0].left->GetRate());
+   size_t max = 0;
+   for (const auto &group : groups)
+   {
+      max = std::max(max, group.left->GetMaxBlockSize() * 2);
+   }
+   mBlockSize = SetBlockSize(max);
+   mBufferSize = ((max + (mBlockSize - 1)) / mBlockSize) * mBlockSize;
+   mNumChannels = groups[0].nChannels;
+
+   if (!ProcessInitialize(groups[0].len, groups[0].map))
+   {
+      bGoodResult = false;
+      return true;
+   }
+
+   auto cleanup = finally( [&] {
+      if (!ProcessFinalize())
+      {
+         bGoodResult = false;
+      }
+   } );
+
+   const auto oldBlockSize = mBlockSize;
+   auto restoreBlockSize = finally( [&] { mBlockSize = oldBlockSize; } );
+   if (useProcessors)
+   {
+      RealtimeInitialize();
+      for (const auto &group : groups)
+      {
+         RealtimeAddProcessor(group.nChannels, mSampleRate);
+      }
+   }
+   auto finalize = finally( [&] {
+      if (useProcessors)
+      {
+         RealtimeFinalize();
+      }
+   } );
+   const auto blockSize = std::min(mBlockSize, oldBlockSize);
+   const auto bufferSize = mBufferSize;
+
+   // Tracks may be read at once, but writing them makes block files
+   std::mutex writeMutex;
+
+   auto processGroup = [&](size_t gg, const ConcurrentProgress &progress) {
+      const auto &group = groups[gg];
+      const auto chans = std::min<unsigned>(mNumAudioOut, group.nChannels);
+      WaveTrack *const tracks[] = { group.left, group.right };
+      const sampleCount starts[] = { group.leftStart, group.rightStart };
+
+      // An effect that may write over its input needs no output buffers,
+      // unless some of its inputs are not refilled from the tracks
+      const bool inPlace = SupportsInPlace() &&
+         mNumAudioIn == mNumAudioOut && group.nChannels >= mNumAudioIn;
+
+      // Room to pad the last block
+      FloatBuffers inBuffer{ mNumAudioIn, bufferSize + blockSize, true };
+      FloatBuffers outBuffer;
+      if (!inPlace)
+      {
+         outBuffer.reinit(mNumAudioOut, bufferSize + blockSize);
+      }
+      auto &resultBuffer = inPlace ? inBuffer : outBuffer;
+      ArrayOf<float *> inBufPos{ mNumAudioIn }, outBufPos{ mNumAudioOut };
+
+      for (sampleCount pos = 0; pos < group.len;)
+      {
+         const auto cnt = limitSampleBufferSize(bufferSize, group.len - pos);
+         for (size_t cc = 0; cc < group.nChannels; ++cc)
+         {
+            tracks[cc]->Get((samplePtr) inBuffer[cc].get(), floatSample,
+               starts[cc] + pos, cnt);
+            std::fill(inBuffer[cc].get() + cnt,
+                      inBuffer[cc].get() + cnt + blockSize, 0.0f);
+         }
+
+         for (size_t block = 0; block < cnt; block += blockSize)
+         {
+            for (size_t i = 0; i < mNumAudioIn; i++)
+            {
+               inBufPos[i] = inBuffer[i].get() + block;
+            }
+            for (size_t i = 0; i < mNumAudioOut; i++)
+            {
+               outBufPos[i] = resultBuffer[i].get() + block;
+            }
+            const auto blockLen = std::min(blockSize, cnt - block);
+            if (useProcessors)
+            {
+               RealtimeProcess((int) gg, inBufPos.get(), outBufPos.get(), blockLen);
+            }
+            else
+            {
+               ProcessBlock(inBufPos.get(), outBufPos.get(), blockLen);
+            }
+         }
+
+         {
+            std::lock_guard<std::mutex> writeLock{ writeMutex };
+            group.left->Set((samplePtr) resultBuffer[0].get(), floatSample,
+               group.leftStart + pos, cnt);
+            if (group.right)
+            {
+               group.right->Set((samplePtr) resultBuffer[chans >= 2 ? 1 : 0].get(),
+                  floatSample, group.rightStart + pos, cnt);
+            }
+         }
+
+         pos += cnt;
+         if (progress(pos.as_double() / group.len.as_double()))
+         {
+            break;
+         }
+      }
+   };
+
+   if (!ParallelForWithProgress(groups.size(), processGroup))
+   {
+      bGoodResult = false;
+   }
+
+   return true;
+}
+
+bool Effect::ParallelForWithProgress(size_t count,
+   const std::function< void( size_t, const ConcurrentProgress & ) > &body)
+{
+   if (count == 0)
+   {
+      return true;
+   }
+
+   std::atomic<bool> cancelled{ false };
+   std::vector< std::atomic<double> > fractions(count);
+   for (auto &fraction : fractions)
+   {
+      fraction.store(0.0);
+   }
+
+   auto &scheduler = TaskScheduler::Get();
+
+   // The loop runs on another thread, so that this one can show progress
+   std::exception_ptr exception;
+   std::atomic<bool> done{ false };
+   std::thread runner{ [&] {
+      try
+      {
+         scheduler.ParallelFor(TaskScheduler::Interactive, count, [&](size_t ii) {
+            body(ii, [&](double frac) {
+               fractions[ii].store(frac);
+               return cancelled.load();
+            });
+         });
+      }
+      catch (...)
+      {
+         exception = std::current_exception();
+      }
+      done.store(true);
+   } };
+   while (!done.load())
+   {
+      ::wxMilliSleep(50);
+      double sum = 0;
+      for (const auto &fraction : fractions)
+      {
+         sum += fraction.load();
+      }
+      if (!cancelled.load() && TotalProgress(sum / count))
+      {
+         cancelled.store(true);
+      }
+   }
+   runner.join();
+
+   if (exception)
+   {
+      try
+      {
+         std::rethrow_exception(exception);
+      }
+      catch( const AudacityException & WXUNUSED(e) )
+      {
+         // Pass this along to our application-level handler
+         throw;
+      }
+      catch(...)
+      {
+         // As in ProcessTrack, exceptions for other reasons fail the effect
+         return false;
+      }
+   }
+
+   return !cancelled.load();
+}
+
+unsigned Effect::GetConcurrency()
+{
+   return TaskScheduler::Get().GetConcurrency();
+}
+
+void Effect::ParallelFor(size_t count, const std::function< void( size_t ) > &body)
+{
+   TaskScheduler::Get().ParallelFor(TaskScheduler::Interactive, count, body);
+}
+
 bool Effect::ProcessTrack(int count,
                           ChannelNames map,
                           WaveTrack *left,
@@ -1497,6 +1835,17 @@ bool Effect::ProcessTrack(int count,
 {
    bool rc = true;
 
+   // Long tracks may be divided among processors
+   size_t lookBack = 0;
+   if (GetType() == EffectTypeProcess &&
+       len > mBufferSize &&
+       SupportsParallelChunks(lookBack) &&
+       GetLatency() == 0)
+   {
+      return ProcessTrackInChunks(
+         count, map, left, right, leftStart, rightStart, len, lookBack);
+   }
+
    // Give the plugin a chance to initialize
    if (!ProcessInitialize(len, map))
    {
@@ -1550,7 +1899,7 @@ bool Effect::ProcessTrack(int count,
    if (isGenerator)
    {
       if (mIsPreview) {
-         gPrefs->Read(wxT("/AudioIO/EffectsPreviewLen"), &genDur, 6.0);
+         genDur = PrefsSnapshot::Get()->effectsPreviewLen;
          genDur = wxMin(mDuration, CalcPreviewInputLength(genDur));
       }
       else {
@@ -1572,6 +1921,40 @@ bool Effect::ProcessTrack(int count,
       }
    }
 
+   // A processor writes its output back up to block boundaries of the left
+   // track, which lets Sequence::SetSamples replace whole blocks with new
+   // block files instead of reading and rewriting the partial ones
+   bool alignOutput = isProcessor;
+   auto outputTarget = alignOutput
+      ? AlignedOutputCount(left, outLeftPos, mBufferSize)
+      : mBufferSize;
+
+   auto writeOutput = [&](size_t cnt) {
+      if (isProcessor)
+      {
+         left->Set((samplePtr) outBuffer[0].get(), floatSample, outLeftPos, cnt);
+         if (right)
+         {
+            if (chans >= 2)
+            {
+               right->Set((samplePtr) outBuffer[1].get(), floatSample, outRightPos, cnt);
+            }
+            else
+            {
+               right->Set((samplePtr) outBuffer[0].get(), floatSample, outRightPos, cnt);
+            }
+         }
+      }
+      else if (isGenerator)
+      {
+         genLeft->Append((samplePtr) outBuffer[0].get(), floatSample, cnt);
+         if (genRight)
+         {
+            genRight->Append((samplePtr) outBuffer[1].get(), floatSample, cnt);
+         }
+      }
+   };
+
    // Call the effect until we run out of input or delayed samples
    while (inputRemaining != 0 || delayRemaining != 0)
    {
@@ -1729,7 +2112,7 @@ bool Effect::ProcessTrack(int count,
       outputBufferCnt += curBlockSize;
 
       // Still have room in the output buffers
-      if (outputBufferCnt < mBufferSize)
+      if (outputBufferCnt < outputTarget)
       {
          // Bump to next output buffer position
          for (size_t i = 0; i < chans; i++)
@@ -1740,41 +2123,34 @@ bool Effect::ProcessTrack(int count,
       // Output buffers have filled
       else
       {
-         if (isProcessor)
+         // Write them out; when aligned, only up to a block boundary, keeping
+         // the rest for next time
+         do
          {
-            // Write them out
-            left->Set((samplePtr) outBuffer[0].get(), floatSample, outLeftPos, outputBufferCnt);
-            if (right)
+            const auto writeCnt = alignOutput ? outputTarget : outputBufferCnt;
+            writeOutput(writeCnt);
+
+            outputBufferCnt -= writeCnt;
+            for (size_t i = 0; i < chans; i++)
             {
-               if (chans >= 2)
-               {
-                  right->Set((samplePtr) outBuffer[1].get(), floatSample, outRightPos, outputBufferCnt);
-               }
-               else
-               {
-                  right->Set((samplePtr) outBuffer[0].get(), floatSample, outRightPos, outputBufferCnt);
-               }
+               memmove(outBuffer[i].get(), outBuffer[i].get() + writeCnt,
+                  sizeof(float) * outputBufferCnt);
             }
-         }
-         else if (isGenerator)
-         {
-            genLeft->Append((samplePtr) outBuffer[0].get(), floatSample, outputBufferCnt);
-            if (genRight)
+
+            // Bump to the next track position
+            outLeftPos += writeCnt;
+            outRightPos += writeCnt;
+            if (alignOutput)
             {
-               genRight->Append((samplePtr) outBuffer[1].get(), floatSample, outputBufferCnt);
+               outputTarget = AlignedOutputCount(left, outLeftPos, mBufferSize);
             }
-         }
+         } while (outputBufferCnt > 0 && outputBufferCnt >= outputTarget);
 
          // Reset the output buffer positions
          for (size_t i = 0; i < chans; i++)
          {
-            outBufPos[i] = outBuffer[i].get();
+            outBufPos[i] = outBuffer[i].get() + outputBufferCnt;
          }
-
-         // Bump to the next track position
-         outLeftPos += outputBufferCnt;
-         outRightPos += outputBufferCnt;
-         outputBufferCnt = 0;
       }
 
       if (mNumChannels > 1)
@@ -1802,29 +2178,7 @@ bool Effect::ProcessTrack(int count,
    // Put any remaining output
    if (rc && outputBufferCnt)
    {
-      if (isProcessor)
-      {
-         left->Set((samplePtr) outBuffer[0].get(), floatSample, outLeftPos, outputBufferCnt);
-         if (right)
-         {
-            if (chans >= 2)
-            {
-               right->Set((samplePtr) outBuffer[1].get(), floatSample, outRightPos, outputBufferCnt);
-            }
-            else
-            {
-               right->Set((samplePtr) outBuffer[0].get(), floatSample, outRightPos, outputBufferCnt);
-            }
-         }
-      }
-      else if (isGenerator)
-      {
-         genLeft->Append((samplePtr) outBuffer[0].get(), floatSample, outputBufferCnt);
-         if (genRight)
-         {
-            genRight->Append((samplePtr) outBuffer[1].get(), floatSample, outputBufferCnt);
-         }
-      }
+      writeOutput(outputBufferCnt);
    }
 
    if (rc && isGenerator)
@@ -1864,6 +2218,191 @@ bool Effect::ProcessTrack(int count,
    return rc;
 }
 
+bool Effect::ProcessTrackInChunks(int count,
+                                  ChannelNames map,
+                                  WaveTrack *left,
+                                  WaveTrack *right,
+                                  sampleCount leftStart,
+                                  sampleCount rightStart,
+                                  sampleCount len,
+                                  size_t lookBack)
+{
+   bool rc = true;
+
+   if (!ProcessInitialize(len, map))
+   {
+      return false;
+   }
+
+   auto cleanup = finally( [&] {
+      if (!ProcessFinalize())
+      {
+         rc = false;
+      }
+   } );
+
+   auto &scheduler = TaskScheduler::Get();
+
+   // Chunks are the size of the usual buffers, and a wave of one chunk per
+   // thread is processed at once.  Then the results are written in order
+   // on this thread, because tracks can't be changed from several threads.
+   // The earlier input that a chunk needs might then be overwritten, so a
+   // copy is kept.
+   const auto nThreads = scheduler.GetConcurrency();
+   const bool useProcessors = lookBack > 0;
+   lookBack = std::min(lookBack, mBufferSize);
+   const auto chans = std::min<unsigned>(mNumAudioOut, mNumChannels);
+
+   const auto oldBlockSize = mBlockSize;
+   auto blockSize = mBlockSize;
+   auto restoreBlockSize = finally( [&] { mBlockSize = oldBlockSize; } );
+
+   struct Chunk {
+      FloatBuffers in, out;
+      sampleCount start;
+      size_t warmUp, len;
+   };
+   std::vector<Chunk> chunks(nThreads);
+   const auto chunkBufferSize = lookBack + mBufferSize + blockSize;
+   for (auto &chunk : chunks)
+   {
+      chunk.in.reinit(mNumAudioIn, chunkBufferSize, true);
+      chunk.out.reinit(mNumAudioOut, chunkBufferSize);
+   }
+   FloatBuffers history{ mNumChannels, lookBack };
+
+   sampleCount done = 0;
+   while (rc && done < len)
+   {
+      size_t nChunks = 0;
+      for (; nChunks < nThreads && done < len; ++nChunks)
+      {
+         auto &chunk = chunks[nChunks];
+         chunk.start = done;
+         chunk.warmUp = limitSampleBufferSize(lookBack, done);
+         chunk.len = limitSampleBufferSize(mBufferSize, len - done);
+         done += chunk.len;
+      }
+
+      if (useProcessors)
+      {
+         RealtimeInitialize();
+         blockSize = std::min(mBlockSize, oldBlockSize);
+         for (size_t ii = 0; ii < nChunks; ++ii)
+         {
+            RealtimeAddProcessor(mNumChannels, mSampleRate);
+         }
+      }
+      auto finalize = finally( [&] {
+         if (useProcessors)
+         {
+            RealtimeFinalize();
+         }
+      } );
+
+      try
+      {
+         scheduler.ParallelFor(TaskScheduler::Interactive, nChunks, [&](size_t ii) {
+            auto &chunk = chunks[ii];
+            WaveTrack *const tracks[] = { left, right };
+            const sampleCount starts[] = { leftStart, rightStart };
+            for (size_t cc = 0; cc < mNumChannels; ++cc)
+            {
+               // Earlier input in this wave is not yet overwritten
+               const auto warmUpStart = chunk.start - chunk.warmUp;
+               if (ii == 0 && chunk.warmUp > 0)
+               {
+                  std::copy(history[cc].get() + lookBack - chunk.warmUp,
+                            history[cc].get() + lookBack,
+                            chunk.in[cc].get());
+                  tracks[cc]->Get((samplePtr) (chunk.in[cc].get() + chunk.warmUp),
+                     floatSample, starts[cc] + chunk.start, chunk.len);
+               }
+               else
+               {
+                  tracks[cc]->Get((samplePtr) chunk.in[cc].get(), floatSample,
+                     starts[cc] + warmUpStart, chunk.warmUp + chunk.len);
+               }
+               // Pad the last block
+               const auto total = chunk.warmUp + chunk.len;
+               std::fill(chunk.in[cc].get() + total,
+                         chunk.in[cc].get() + total + blockSize, 0.0f);
+            }
+
+            ArrayOf<float *> inPos{ mNumAudioIn }, outPos{ mNumAudioOut };
+            const auto total = chunk.warmUp + chunk.len;
+            for (size_t pos = 0; pos < total; pos += blockSize)
+            {
+               const auto cnt = std::min(blockSize, total - pos);
+               for (size_t i = 0; i < mNumAudioIn; i++)
+               {
+                  inPos[i] = chunk.in[i].get() + pos;
+               }
+               for (size_t i = 0; i < mNumAudioOut; i++)
+               {
+                  outPos[i] = chunk.out[i].get() + pos;
+               }
+               if (useProcessors)
+               {
+                  RealtimeProcess(ii, inPos.get(), outPos.get(), cnt);
+               }
+               else
+               {
+                  ProcessBlock(inPos.get(), outPos.get(), cnt);
+               }
+            }
+         });
+      }
+      catch( const AudacityException & WXUNUSED(e) )
+      {
+         // Pass this along to our application-level handler
+         throw;
+      }
+      catch(...)
+      {
+         // As in ProcessTrack, exceptions for other reasons fail the effect
+         return false;
+      }
+
+      // Keep the input that the next wave will need
+      {
+         const auto &last = chunks[nChunks - 1];
+         const auto total = last.warmUp + last.len;
+         if (total >= lookBack)
+         {
+            for (size_t cc = 0; cc < mNumChannels; ++cc)
+            {
+               std::copy(last.in[cc].get() + total - lookBack,
+                         last.in[cc].get() + total,
+                         history[cc].get());
+            }
+         }
+      }
+
+      for (size_t ii = 0; ii < nChunks; ++ii)
+      {
+         const auto &chunk = chunks[ii];
+         left->Set((samplePtr) (chunk.out[0].get() + chunk.warmUp),
+            floatSample, leftStart + chunk.start, chunk.len);
+         if (right)
+         {
+            right->Set((samplePtr) (chunk.out[chans >= 2 ? 1 : 0].get() + chunk.warmUp),
+               floatSample, rightStart + chunk.start, chunk.len);
+         }
+      }
+
+      const auto frac = done.as_double() / len.as_double();
+      if (mNumChannels > 1
+          ? TrackGroupProgress(count, frac)
+          : TrackProgress(count, frac))
+      {
+         rc = false;
+      }
+   }
+
+   return rc;
+}
+
 void Effect::End()
 {
 }
@@ -2459,6 +2998,15 @@ size_t Effect::RealtimeProcess(int group,
    return len;
 }
 
+bool Effect::RealtimeProcessesInPlace(unsigned chans)
+{
+   // Only when each processor is given the same channels in and out, with
+   // none replicated and no dummy output
+   return SupportsInPlace() &&
+      mNumAudioIn > 0 && mNumAudioIn == mNumAudioOut &&
+      chans % mNumAudioIn == 0;
+}
+
 bool Effect::IsRealtimeActive()
 {
    return mRealtimeSuspendCount == 0;
@@ -2486,8 +3034,7 @@ void Effect::Preview(bool dryOnly)
    bool isGenerator = GetType() == EffectTypeGenerate;
 
    // Mix a few seconds of audio from all of the tracks
-   double previewLen;
-   gPrefs->Read(wxT("/AudioIO/EffectsPreviewLen"), &previewLen, 6.0);
+   double previewLen = PrefsSnapshot::Get()->effectsPreviewLen;
 
    const double rate = mProjectRate;
 
@@ -2539,41 +3086,61 @@ void Effect::Preview(bool dryOnly)
       ReplaceProcessedTracks( false );
    } );
 
-   // Build NEW tracklist from rendering tracks
-   auto uTracks = TrackList::Create();
-   mTracks = uTracks.get();
-
-   // Linear Effect preview optimised by pre-mixing to one track.
-   // Generators need to generate per track.
-   if (mIsLinearEffect && !isGenerator) {
-      WaveTrack::Holder mixLeft, mixRight;
-      MixAndRender(saveTracks, mFactory, rate, floatSample, mT0, t1, mixLeft, mixRight);
-      if (!mixLeft)
-         return;
-
-      mixLeft->Offset(-mixLeft->GetStartTime());
-      mixLeft->SetSelected(true);
-      mixLeft->SetDisplay(WaveTrack::NoDisplay);
-      mTracks->Add(std::move(mixLeft));
-      if (mixRight) {
-         mixRight->Offset(-mixRight->GetStartTime());
-         mixRight->SetSelected(true);
-         mTracks->Add(std::move(mixRight));
+   // The project can't change while the prompt is open, so the input of the
+   // last preview serves again, unless the times are changed, as some
+   // effects do.  Processing replaces tracks in the list it is given, so
+   // it is given duplicates, which share the block files, writing none.
+   if (!(mPreviewInput && mPreviewSource == saveTracks &&
+         mPreviewInputT0 == mT0 && mPreviewInputT1 == t1)) {
+      mPreviewInput.reset();
+      auto input = TrackList::Create();
+
+      // Linear Effect preview optimised by pre-mixing to one track.
+      // Generators need to generate per track.
+      if (mIsLinearEffect && !isGenerator) {
+         WaveTrack::Holder mixLeft, mixRight;
+         MixAndRender(saveTracks, mFactory, rate, floatSample, mT0, t1, mixLeft, mixRight);
+         if (!mixLeft)
+            return;
+
+         mixLeft->Offset(-mixLeft->GetStartTime());
+         mixLeft->SetSelected(true);
+         mixLeft->SetDisplay(WaveTrack::NoDisplay);
+         input->Add(std::move(mixLeft));
+         if (mixRight) {
+            mixRight->Offset(-mixRight->GetStartTime());
+            mixRight->SetSelected(true);
+            input->Add(std::move(mixRight));
+         }
       }
-   }
-   else {
-      TrackListOfKindIterator iter(Track::Wave, saveTracks);
-      WaveTrack *src = (WaveTrack *) iter.First();
-      while (src)
-      {
-         if (src->GetSelected() || mPreviewWithNotSelected) {
-            auto dest = src->Copy(mT0, t1);
-            dest->SetSelected(src->GetSelected());
-            static_cast<WaveTrack*>(dest.get())->SetDisplay(WaveTrack::NoDisplay);
-            mTracks->Add(std::move(dest));
+      else {
+         TrackListOfKindIterator iter(Track::Wave, saveTracks);
+         WaveTrack *src = (WaveTrack *) iter.First();
+         while (src)
+         {
+            if (src->GetSelected() || mPreviewWithNotSelected) {
+               auto dest = src->Copy(mT0, t1);
+               dest->SetSelected(src->GetSelected());
+               static_cast<WaveTrack*>(dest.get())->SetDisplay(WaveTrack::NoDisplay);
+               input->Add(std::move(dest));
+            }
+            src = (WaveTrack *) iter.Next();
          }
-         src = (WaveTrack *) iter.Next();
       }
+
+      mPreviewInput = std::move(input);
+      mPreviewSource = saveTracks;
+      mPreviewInputT0 = mT0;
+      mPreviewInputT1 = t1;
+   }
+
+   // Build NEW tracklist from rendering tracks
+   auto uTracks = TrackList::Create();
+   mTracks = uTracks.get();
+   {
+      TrackListIterator iter(mPreviewInput.get());
+      for (Track *t = iter.First(); t; t = iter.Next())
+         mTracks->Add(t->Duplicate());
    }
 
    // NEW tracks start at time zero.
@@ -3509,8 +4076,7 @@ void EffectUIHost::OnRewind(wxCommandEvent & WXUNUSED(evt))
 {
    if (mPlaying)
    {
-      double seek;
-      gPrefs->Read(wxT("/AudioIO/SeekShortPeriod"), &seek, 1.0);
+      double seek = PrefsSnapshot::Get()->seekShortPeriod;
 
       double pos = gAudioIO->GetStreamTime();
       if (pos - seek < mRegion.t0())
@@ -3530,8 +4096,7 @@ void EffectUIHost::OnFFwd(wxCommandEvent & WXUNUSED(evt))
 {
    if (mPlaying)
    {
-      double seek;
-      gPrefs->Read(wxT("/AudioIO/SeekShortPeriod"), &seek, 1.0);
+      double seek = PrefsSnapshot::Get()->seekShortPeriod;
 
       double pos = gAudioIO->GetStreamTime();
       if (mRegion.t0() < mRegion.t1() && pos + seek > mRegion.t1())
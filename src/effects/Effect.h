@@ -14,6 +14,7 @@
 
 #include "../Audacity.h"
 #include "../MemoryX.h"
+#include <functional>
 #include <set>
 
 #include "../MemoryX.h"
@@ -116,6 +117,7 @@ class AUDACITY_DLL_API Effect /* not final */ : public wxEvtHandler,
    bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    bool ProcessFinalize() override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
+   bool SupportsInPlace() override;
 
    bool RealtimeInitialize() override;
    bool RealtimeAddProcessor(unsigned numChannels, float sampleRate) override;
@@ -258,6 +260,9 @@ class AUDACITY_DLL_API Effect /* not final */ : public wxEvtHandler,
                                float **inbuf,
                                float **outbuf,
                                size_t numSamples);
+   // Whether RealtimeProcess() of a group of chans channels may be given the
+   // same buffers for input and output
+   /* not virtual */ bool RealtimeProcessesInPlace(unsigned chans);
    /* not virtual */ bool IsRealtimeActive();
 
    virtual bool IsHidden();
@@ -303,6 +308,24 @@ protected:
    virtual bool InitPass2();
    virtual int GetPass();
 
+   // Return true to let the default ProcessPass divide long tracks into
+   // chunks and process them on all processors at once.  Set lookBack to
+   // the number of samples of earlier input that ProcessBlock needs to
+   // reach the state it would have had from the start.  When this is 0,
+   // ProcessBlock is called from several threads at once, so it must not
+   // change the effect.  Otherwise each chunk gets its own processor, as by
+   // RealtimeAddProcessor, which is first given the lookBack samples.
+   // The effect must have no latency.
+   virtual bool SupportsParallelChunks(size_t &lookBack);
+
+   // Return true to let the default ProcessPass process all selected
+   // tracks, or pairs of them, at once, each on its own thread.  Leave
+   // useProcessors false if ProcessBlock may be called from several
+   // threads at once; otherwise each track gets its own processor, as by
+   // RealtimeAddProcessor.  The effect must have no latency, and
+   // ProcessInitialize is then called only once, for the first track.
+   virtual bool SupportsConcurrentTracks(bool &useProcessors);
+
    // clean up any temporary memory, needed only per invocation of the
    // effect, after either successful or failed or exception-aborted processing.
    // Invoked inside a "finally" block so it must be no-throw.
@@ -340,6 +363,22 @@ protected:
    // (when doing stereo groups at a time)
    bool TrackGroupProgress(int whichGroup, double frac, const wxString & = wxEmptyString);
 
+   // Calls body(ii, progress) for each ii below count, at once on the
+   // workers of the TaskScheduler.  A body passes its fraction done to progress, which returns
+   // true if the user has cancelled; this thread meanwhile shows the mean
+   // fraction.  Returns false if cancelled, or if a body threw other than
+   // an AudacityException, which is rethrown.
+   using ConcurrentProgress = std::function< bool( double frac ) >;
+   bool ParallelForWithProgress(size_t count,
+      const std::function< void( size_t, const ConcurrentProgress & ) > &body);
+
+   // Calls body(ii) for each ii below count, at once on the same workers,
+   // and returns when all are done.  For short loops inside one
+   // track's processing, so nothing is shown meanwhile.  The body must not
+   // throw.
+   static unsigned GetConcurrency();
+   void ParallelFor(size_t count, const std::function< void( size_t ) > &body);
+
    int GetNumWaveTracks() { return mNumTracks; }
 
    int GetNumWaveGroups() { return mNumGroups; }
@@ -495,6 +534,17 @@ protected:
                      FloatBuffers &outBuffer,
                      ArrayOf< float * > &inBufPos,
                      ArrayOf< float *> &outBufPos);
+   // Returns false, having done nothing, if there are too few tracks,
+   // or their rates differ
+   bool ProcessTracksConcurrently(bool useProcessors, bool &bGoodResult);
+   bool ProcessTrackInChunks(int count,
+                             ChannelNames map,
+                             WaveTrack *left,
+                             WaveTrack *right,
+                             sampleCount leftStart,
+                             sampleCount rightStart,
+                             sampleCount len,
+                             size_t lookBack);
 
  //
  // private data
@@ -515,6 +565,13 @@ private:
 
    bool mIsPreview;
 
+   // The input of the last preview, of which the next one, for the same
+   // times, can play duplicates
+   std::shared_ptr<TrackList> mPreviewInput;
+   const TrackList *mPreviewSource {};
+   double mPreviewInputT0 {};
+   double mPreviewInputT1 {};
+
    bool mUIDebug;
 
    std::vector<Track*> mIMap;
@@ -32,6 +32,9 @@ effects.
 #endif
 
 #include "EffectManager.h"
+#include "../AudioIO.h"
+#include "../Prefs.h"
+#include "../RealtimeWorkers.h"
 #include "../commands/Command.h"
 #include "../commands/CommandContext.h"
 
@@ -154,6 +157,11 @@ wxString EffectManager::GetCommandName(const PluginID & ID)
 
 wxString EffectManager::GetEffectFamilyName(const PluginID & ID)
 {
+   // The registry has it, so menus can be built without loading the effect
+   auto plug = PluginManager::Get().GetPlugin(ID);
+   if (plug && !plug->GetEffectFamilyId().empty())
+      return IdentInterfaceSymbol{ plug->GetEffectFamilyId() }.Translation();
+
    auto effect = GetEffect(ID);
    if (effect)
       return effect->GetFamilyId().Translation();
@@ -162,6 +170,10 @@ wxString EffectManager::GetEffectFamilyName(const PluginID & ID)
 
 wxString EffectManager::GetVendorName(const PluginID & ID)
 {
+   auto plug = PluginManager::Get().GetPlugin(ID);
+   if (plug && !plug->GetVendor().empty())
+      return IdentInterfaceSymbol{ plug->GetVendor() }.Translation();
+
    auto effect = GetEffect(ID);
    if (effect)
       return effect->GetVendor().Translation();
@@ -529,6 +541,8 @@ void EffectManager::RealtimeSetEffects(const EffectArray & effects)
       {
          e->RealtimeFinalize();
       }
+      if (e)
+         mRealtimeDelays.erase(e);
    }
       
    // Tell any NEW effects to get ready
@@ -549,6 +563,11 @@ void EffectManager::RealtimeSetEffects(const EffectArray & effects)
       if (e && mRealtimeActive)
       {
          e->RealtimeInitialize();
+         RealtimeQueryDelay(e);
+      }
+      else if (e)
+      {
+         RealtimeWarmUp(e);
       }
    }
 
@@ -581,6 +600,7 @@ void EffectManager::RealtimeAddEffect(Effect *effect)
    {
       // Initialize realtime processing
       effect->RealtimeInitialize();
+      RealtimeQueryDelay(effect);
 
       // Add the required processors
       for (size_t i = 0, cnt = mRealtimeChans.size(); i < cnt; i++)
@@ -588,6 +608,10 @@ void EffectManager::RealtimeAddEffect(Effect *effect)
          effect->RealtimeAddProcessor(i, mRealtimeChans[i], mRealtimeRates[i]);
       }
    }
+   else
+   {
+      RealtimeWarmUp(effect);
+   }
    
    // Add to list of active effects
    mRealtimeEffects.push_back(effect);
@@ -606,6 +630,7 @@ void EffectManager::RealtimeRemoveEffect(Effect *effect)
       // Cleanup realtime processing
       effect->RealtimeFinalize();
    }
+   mRealtimeDelays.erase(effect);
       
    // Remove from list of active effects
    auto end = mRealtimeEffects.end();
@@ -629,13 +654,26 @@ void EffectManager::RealtimeInitialize(double rate)
    // RealtimeAdd/RemoveEffect() needs to know when we're active so it can
    // initialize newly added effects
    mRealtimeActive = true;
+   mLastRealtimeRate = rate;
 
    // Tell each effect to get ready for action
    for (auto e : mRealtimeEffects) {
       e->SetSampleRate(rate);
       e->RealtimeInitialize();
+      RealtimeQueryDelay(e);
    }
 
+   // The workers for parallel groups stay between streams, unless the
+   // preference changed.  By default, leave one processor for the callback
+   // and one for the rest.
+   long nWorkers = gPrefs->Read(wxT("/Effects/RealtimeWorkers"), -1L);
+   if (nWorkers < 0)
+      nWorkers = std::min(3, std::max(0,
+         (int)std::thread::hardware_concurrency() - 2));
+   if (!mRealtimeWorkers ||
+       mRealtimeWorkers->GetWorkers() != (unsigned)nWorkers)
+      mRealtimeWorkers = std::make_unique<RealtimeWorkers>(nWorkers);
+
    // Get things moving
    RealtimeResume();
 }
@@ -656,12 +694,16 @@ void EffectManager::RealtimeFinalize()
 
    // It is now safe to clean up
    mRealtimeLatency = 0;
+   mRealtimeDelays.clear();
+   mRealtimeDelay.store(0);
 
    // Tell each effect to clean up as well
    for (auto e : mRealtimeEffects)
       e->RealtimeFinalize();
 
-   // Reset processor parameters
+   // Reset processor parameters, remembering them for RealtimeWarmUp()
+   mLastRealtimeChans.swap(mRealtimeChans);
+   mLastRealtimeRates.swap(mRealtimeRates);
    mRealtimeChans.clear();
    mRealtimeRates.clear();
 
@@ -671,6 +713,7 @@ void EffectManager::RealtimeFinalize()
 
 void EffectManager::RealtimeSuspend()
 {
+   ASSERT_NOT_AUDIO_CALLBACK();
    mRealtimeLock.Enter();
 
    // Already suspended...bail
@@ -692,6 +735,7 @@ void EffectManager::RealtimeSuspend()
 
 void EffectManager::RealtimeResume()
 {
+   ASSERT_NOT_AUDIO_CALLBACK();
    mRealtimeLock.Enter();
 
    // Already running...bail
@@ -712,12 +756,16 @@ void EffectManager::RealtimeResume()
 }
 
 //
-// This will be called in a different thread than the main GUI thread.
+// This will be called in the PortAudio callback, which must not wait for the
+// main thread.  The lock is held from here to RealtimeProcessEnd(); if the
+// main thread has it, the whole cycle passes the samples unprocessed.
 //
 void EffectManager::RealtimeProcessStart()
 {
    // Protect ourselves from the main thread
-   mRealtimeLock.Enter();
+   mRealtimeCycleLocked = mRealtimeLock.TryEnter();
+   if (!mRealtimeCycleLocked)
+      return;
 
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
@@ -730,29 +778,60 @@ void EffectManager::RealtimeProcessStart()
       }
    }
 
-   mRealtimeLock.Leave();
+   RealtimeUpdateDelay();
 }
 
 //
-// This will be called in a different thread than the main GUI thread.
+// This will be called in the PortAudio callback, between
+// RealtimeProcessStart() and RealtimeProcessEnd().
 //
 size_t EffectManager::RealtimeProcess(int group, unsigned chans, float **buffers, size_t numSamples)
 {
-   // Protect ourselves from the main thread
-   mRealtimeLock.Enter();
-
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended, so allow the samples to pass as-is.
-   if (mRealtimeSuspended || mRealtimeEffects.empty())
-   {
-      mRealtimeLock.Leave();
+   if (!mRealtimeCycleLocked || mRealtimeSuspended || mRealtimeEffects.empty())
       return numSamples;
-   }
 
    // Remember when we started so we can calculate the amount of latency we
    // are introducing
    wxMilliClock_t start = wxGetLocalTimeMillis();
 
+   RealtimeProcessChain(group, chans, buffers, numSamples);
+
+   // Remember the latency
+   mRealtimeLatency = (int) (wxGetLocalTimeMillis() - start).GetValue();
+
+   //
+   // This is wrong...needs to handle tails
+   //
+   return numSamples;
+}
+
+void EffectManager::RealtimeProcessGroups(RealtimeGroup *groups, size_t count)
+{
+   if (!mRealtimeCycleLocked || mRealtimeSuspended || mRealtimeEffects.empty())
+      return;
+
+   wxMilliClock_t start = wxGetLocalTimeMillis();
+
+   // Each group has its own processors in each effect, so distinct groups
+   // may run at once on different threads
+   const auto process = [this, groups](size_t ii) {
+      auto &group = groups[ii];
+      RealtimeProcessChain(group.group, group.chans, group.buffers,
+         group.numSamples);
+   };
+   if (mRealtimeWorkers)
+      mRealtimeWorkers->ParallelFor(count, process);
+   else
+      for (size_t ii = 0; ii < count; ++ii)
+         process(ii);
+
+   mRealtimeLatency = (int) (wxGetLocalTimeMillis() - start).GetValue();
+}
+
+void EffectManager::RealtimeProcessChain(int group, unsigned chans, float **buffers, size_t numSamples)
+{
    // Allocate the in/out buffer arrays
    float **ibuf = (float **) alloca(chans * sizeof(float *));
    float **obuf = (float **) alloca(chans * sizeof(float *));
@@ -766,16 +845,23 @@ size_t EffectManager::RealtimeProcess(int group, unsigned chans, float **buffers
    }
 
    // Now call each effect in the chain while swapping buffer pointers to feed the
-   // output of one effect as the input to the next effect
-   size_t called = 0;
+   // output of one effect as the input to the next effect.  An effect that
+   // processes in place writes over its input, and nothing is swapped.
    for (auto e : mRealtimeEffects)
    {
-      if (e->IsRealtimeActive())
+      if (!e->IsRealtimeActive())
       {
-         e->RealtimeProcess(group, chans, ibuf, obuf, numSamples);
-         called++;
+         continue;
       }
 
+      if (e->RealtimeProcessesInPlace(chans))
+      {
+         e->RealtimeProcess(group, chans, ibuf, ibuf, numSamples);
+         continue;
+      }
+
+      e->RealtimeProcess(group, chans, ibuf, obuf, numSamples);
+
       for (unsigned int j = 0; j < chans; j++)
       {
          float *temp;
@@ -787,34 +873,75 @@ size_t EffectManager::RealtimeProcess(int group, unsigned chans, float **buffers
 
    // Once we're done, we might wind up with the last effect storing its results
    // in the temporary buffers.  If that's the case, we need to copy it over to
-   // the caller's buffers.  This happens when the number of effects proccessed
-   // is odd.
-   if (called & 1)
+   // the caller's buffers.  This happens when the number of buffer swaps is
+   // odd.
+   if (chans > 0 && ibuf[0] != buffers[0])
    {
       for (unsigned int i = 0; i < chans; i++)
       {
          memcpy(buffers[i], ibuf[i], numSamples * sizeof(float));
       }
    }
+}
 
-   // Remember the latency
-   mRealtimeLatency = (int) (wxGetLocalTimeMillis() - start).GetValue();
+//
+// These will be called in the audio thread, when realtime effects are
+// processed a buffer ahead.  The lock is held from the start to the end,
+// so that the groups need not take it in turn.
+//
+void EffectManager::RealtimeProcessStartConcurrent()
+{
+   ASSERT_NOT_AUDIO_CALLBACK();
+   mRealtimeLock.Enter();
 
-   mRealtimeLock.Leave();
+   if (!mRealtimeSuspended)
+   {
+      for (auto e : mRealtimeEffects)
+      {
+         if (e->IsRealtimeActive())
+            e->RealtimeProcessStart();
+      }
+   }
+
+   RealtimeUpdateDelay();
+
+   mRealtimeConcurrentStart = wxGetLocalTimeMillis();
+}
+
+size_t EffectManager::RealtimeProcessConcurrent(int group, unsigned chans, float **buffers, size_t numSamples)
+{
+   // Each group has its own processors in each effect, so distinct groups
+   // may run at once on different threads
+   if (!mRealtimeSuspended && !mRealtimeEffects.empty())
+      RealtimeProcessChain(group, chans, buffers, numSamples);
 
-   //
-   // This is wrong...needs to handle tails
-   //
    return numSamples;
 }
 
+void EffectManager::RealtimeProcessEndConcurrent()
+{
+   if (!mRealtimeSuspended)
+   {
+      for (auto e : mRealtimeEffects)
+      {
+         if (e->IsRealtimeActive())
+            e->RealtimeProcessEnd();
+      }
+   }
+
+   mRealtimeLatency =
+      (int) (wxGetLocalTimeMillis() - mRealtimeConcurrentStart).GetValue();
+
+   mRealtimeLock.Leave();
+}
+
 //
-// This will be called in a different thread than the main GUI thread.
+// This will be called in the PortAudio callback.
 //
 void EffectManager::RealtimeProcessEnd()
 {
-   // Protect ourselves from the main thread
-   mRealtimeLock.Enter();
+   if (!mRealtimeCycleLocked)
+      return;
 
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
@@ -827,6 +954,7 @@ void EffectManager::RealtimeProcessEnd()
       }
    }
 
+   mRealtimeCycleLocked = false;
    mRealtimeLock.Leave();
 }
 
@@ -835,6 +963,43 @@ int EffectManager::GetRealtimeLatency()
    return mRealtimeLatency;
 }
 
+void EffectManager::RealtimeWarmUp(Effect *effect)
+{
+   // Effects that are slow to make their processors keep them through
+   // RealtimeFinalize(), to set them up again for the next stream.  For
+   // the others, this costs one more making and freeing of them.
+   if (mLastRealtimeChans.empty())
+      return;
+
+   effect->SetSampleRate(mLastRealtimeRate);
+   effect->RealtimeInitialize();
+   for (size_t i = 0, cnt = mLastRealtimeChans.size(); i < cnt; i++)
+      effect->RealtimeAddProcessor(i, mLastRealtimeChans[i], mLastRealtimeRates[i]);
+   effect->RealtimeFinalize();
+}
+
+void EffectManager::RealtimeQueryDelay(Effect *effect)
+{
+   const auto latency = effect->GetLatency();
+   mRealtimeDelays[effect] = latency > 0 ? latency.as_size_t() : 0;
+}
+
+void EffectManager::RealtimeUpdateDelay()
+{
+   // Suspended effects pass the samples as they are
+   size_t delay = 0;
+   if (!mRealtimeSuspended)
+      for (auto e : mRealtimeEffects)
+      {
+         if (!e->IsRealtimeActive())
+            continue;
+         const auto found = mRealtimeDelays.find(e);
+         if (found != mRealtimeDelays.end())
+            delay += found->second;
+      }
+   mRealtimeDelay.store(delay);
+}
+
 Effect *EffectManager::GetEffect(const PluginID & ID)
 {
    // Must have a "valid" ID
@@ -14,11 +14,13 @@
 
 #include "../Experimental.h"
 
+#include <atomic>
 #include <vector>
 #include <wx/choice.h>
 #include <wx/dialog.h>
 #include <wx/event.h>
 #include <wx/listbox.h>
+#include <wx/stopwatch.h>
 #include <wx/string.h>
 
 #include "audacity/EffectInterface.h"
@@ -30,6 +32,7 @@
 class AudacityCommand;
 class CommandContext;
 class CommandMessageTarget;
+class RealtimeWorkers;
 
 using EffectArray = std::vector <Effect*> ;
 using EffectMap = std::unordered_map<wxString, Effect *>;
@@ -142,7 +145,27 @@ public:
    void RealtimeProcessStart();
    size_t RealtimeProcess(int group, unsigned chans, float **buffers, size_t numSamples);
    void RealtimeProcessEnd();
+   // Alternatives to the three above, for processing a buffer ahead in the
+   // audio thread:  between start and end, RealtimeProcessConcurrent() may be
+   // called at once from several threads, each for a different group
+   void RealtimeProcessStartConcurrent();
+   size_t RealtimeProcessConcurrent(int group, unsigned chans, float **buffers, size_t numSamples);
+   void RealtimeProcessEndConcurrent();
+   // One group's part of RealtimeProcessGroups()
+   struct RealtimeGroup
+   {
+      int group;
+      unsigned chans;
+      float **buffers;
+      size_t numSamples;
+   };
+   // Like RealtimeProcess() for each of the groups, but some of them on the
+   // realtime workers at once; for calling in the PortAudio callback
+   void RealtimeProcessGroups(RealtimeGroup *groups, size_t count);
    int GetRealtimeLatency();
+   // Samples by which the active effects delay what they process, as of
+   // the last processing cycle; for any thread
+   size_t GetRealtimeDelay() const { return mRealtimeDelay.load(); }
 
 #if defined(EXPERIMENTAL_EFFECTS_RACK)
    void ShowRack();
@@ -155,6 +178,17 @@ private:
    Effect *GetEffect(const PluginID & ID);
    AudacityCommand *GetAudacityCommand(const PluginID & ID);
 
+   // Makes the processors of the effect, for the groups of the last
+   // stream, so that the effect can keep them for the next
+   void RealtimeWarmUp(Effect *effect);
+   // Asks the effect, just initialized for realtime, for its latency
+   void RealtimeQueryDelay(Effect *effect);
+   // Sums the delays of the active effects; the caller holds mRealtimeLock
+   void RealtimeUpdateDelay();
+
+   // Runs the active effects on the buffers; the caller holds mRealtimeLock
+   void RealtimeProcessChain(int group, unsigned chans, float **buffers, size_t numSamples);
+
 #if defined(EXPERIMENTAL_EFFECTS_RACK)
    EffectRack *GetRack();
 #endif
@@ -171,8 +205,20 @@ private:
    int mRealtimeLatency;
    bool mRealtimeSuspended;
    bool mRealtimeActive;
+   wxMilliClock_t mRealtimeConcurrentStart;
+   // Whether the callback's cycle got the lock; used only by that thread
+   bool mRealtimeCycleLocked{ false };
+   std::unique_ptr<RealtimeWorkers> mRealtimeWorkers;
    std::vector<unsigned> mRealtimeChans;
    std::vector<double> mRealtimeRates;
+   // The processors of the last stream
+   std::vector<unsigned> mLastRealtimeChans;
+   std::vector<double> mLastRealtimeRates;
+   double mLastRealtimeRate{ 0 };
+   // The latency of each effect of the chain, asked once when it is
+   // initialized, because effects report it only once
+   std::unordered_map<Effect*, size_t> mRealtimeDelays;
+   std::atomic<size_t> mRealtimeDelay{ 0 };
 
    // Set true if we want to skip pushing state 
    // after processing at effect run time.
@@ -93,6 +93,7 @@
 #include "../WaveTrack.h"
 #include "../widgets/Ruler.h"
 #include "../xml/XMLFileReader.h"
+#include "Convolver.h"
 #include "../Theme.h"
 #include "../AllThemeResources.h"
 #include "../float_cast.h"
@@ -161,6 +162,16 @@ static const double kThirdOct[] =
    2500., 3150., 4000., 5000., 6300., 8000., 10000., 12500., 16000., 20000.,
 };
 
+// Partitions of about a quarter of the filter keep the FFTs small and in
+// cache; much smaller ones would spend the time summing the partitions
+static size_t ConvolverBlockSize(size_t filterLength)
+{
+   size_t size = 256;
+   while (size < 4096 && size * 4 < filterLength)
+      size *= 2;
+   return size;
+}
+
 // Define keys, defaults, minimums, and maximums for the effect parameters
 //
 //     Name          Type        Key                     Def      Min      Max      Scale
@@ -1055,53 +1066,34 @@ bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
    auto output = p->GetTrackFactory()->NewWaveTrack(floatSample, t->GetRate());
 
    wxASSERT(mM - 1 < windowSize);
-   size_t L = windowSize - (mM - 1);   //Process L samples at a go
+   Convolver convolver{ ConvolverBlockSize(mM) };
+   convolver.SetFilter(mFilterTaps.data(), mM);
+   const auto L = convolver.GetBlockSize();   //Process L samples at a go
    auto s = start;
-   auto idealBlockLen = t->GetMaxBlockSize() * 4;
+   // At least room for the tail, and the lump of zeros that finishes it
+   auto idealBlockLen = std::max(t->GetMaxBlockSize() * 4, mM - 1 + 2 * L);
    if (idealBlockLen % L != 0)
       idealBlockLen += (L - (idealBlockLen % L));
 
    Floats buffer{ idealBlockLen };
 
-   Floats window1{ windowSize };
-   Floats window2{ windowSize };
-   float *thisWindow = window1.get();
-   float *lastWindow = window2.get();
-
    auto originalLen = len;
 
-   for(size_t i = 0; i < windowSize; i++)
-      lastWindow[i] = 0;
-
    TrackProgress(count, 0.);
    bool bLoopSuccess = true;
-   size_t wcopy = 0;
+   size_t block = 0, padded = 0;
    int offset = (mM - 1) / 2;
 
    while (len != 0)
    {
-      auto block = limitSampleBufferSize( idealBlockLen, len );
+      block = limitSampleBufferSize( idealBlockLen, len );
+      padded = block + (L - block % L) % L;
 
       t->Get((samplePtr)buffer.get(), floatSample, s, block);
+      std::fill(buffer.get() + block, buffer.get() + padded, 0.0f);
 
-      for(size_t i = 0; i < block; i += L)   //go through block in lumps of length L
-      {
-         wcopy = std::min <size_t> (L, block - i);
-         for(size_t j = 0; j < wcopy; j++)
-            thisWindow[j] = buffer[i+j];   //copy the L (or remaining) samples
-         for(auto j = wcopy; j < windowSize; j++)
-            thisWindow[j] = 0;   //this includes the padding
-
-         Filter(windowSize, thisWindow);
-
-         // Overlap - Add
-         for(size_t j = 0; (j < mM - 1) && (j < wcopy); j++)
-            buffer[i+j] = thisWindow[j] + lastWindow[L + j];
-         for(size_t j = mM - 1; j < wcopy; j++)
-            buffer[i+j] = thisWindow[j];
-
-         std::swap( thisWindow, lastWindow );
-      }  //next i, lump of this block
+      for(size_t i = 0; i < padded; i += L)   //go through block in lumps of length L
+         convolver.ProcessBlock(&buffer[i], &buffer[i]);
 
       output->Append((samplePtr)buffer.get(), floatSample, block);
       len -= block;
@@ -1117,20 +1109,13 @@ bool EffectEqualization::ProcessOne(int count, WaveTrack * t,
 
    if(bLoopSuccess)
    {
-      // mM-1 samples of 'tail' left in lastWindow, get them now
-      if(wcopy < (mM - 1)) {
-         // Still have some overlap left to process
-         // (note that lastWindow and thisWindow have been exchanged at this point
-         //  so that 'thisWindow' is really the window prior to 'lastWindow')
-         size_t j = 0;
-         for(; j < mM - 1 - wcopy; j++)
-            buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
-         // And fill in the remainder after the overlap
-         for( ; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
-      } else {
-         for(size_t j = 0; j < mM - 1; j++)
-            buffer[j] = lastWindow[wcopy + j];
+      // mM-1 samples of 'tail' are the response to the silence after the
+      // end; the padding of the last lump already began them
+      size_t tail = padded - block;
+      std::copy(buffer.get() + block, buffer.get() + padded, buffer.get());
+      for(; tail < mM - 1; tail += L) {
+         std::fill(buffer.get() + tail, buffer.get() + tail + L, 0.0f);
+         convolver.ProcessBlock(&buffer[tail], &buffer[tail]);
       }
       output->Append((samplePtr)buffer.get(), floatSample, mM - 1);
       output->Flush();
@@ -1298,6 +1283,7 @@ bool EffectEqualization::CalcFilter()
    {   //and copy useful values back
       outr[i] = tempr[i];
    }
+   mFilterTaps.assign(outr.get(), outr.get() + mM);
    for (size_t i = mM; i < mWindowSize; i++)
    {   //rest is padding
       outr[i]=0.;
@@ -1309,31 +1295,6 @@ bool EffectEqualization::CalcFilter()
    return TRUE;
 }
 
-void EffectEqualization::Filter(size_t len, float *buffer)
-{
-   float re,im;
-   // Apply FFT
-   RealFFTf(buffer, hFFT.get());
-   //FFT(len, false, inr, NULL, outr, outi);
-
-   // Apply filter
-   // DC component is purely real
-   mFFTBuffer[0] = buffer[0] * mFilterFuncR[0];
-   for(size_t i = 1; i < (len / 2); i++)
-   {
-      re=buffer[hFFT->BitReversed[i]  ];
-      im=buffer[hFFT->BitReversed[i]+1];
-      mFFTBuffer[2*i  ] = re*mFilterFuncR[i] - im*mFilterFuncI[i];
-      mFFTBuffer[2*i+1] = re*mFilterFuncI[i] + im*mFilterFuncR[i];
-   }
-   // Fs/2 component is purely real
-   mFFTBuffer[1] = buffer[1] * mFilterFuncR[len/2];
-
-   // Inverse FFT and normalization
-   InverseRealFFTf(mFFTBuffer.get(), hFFT.get());
-   ReorderToTime(hFFT.get(), mFFTBuffer.get(), buffer);
-}
-
 //
 // Load external curves with fallback to default, then message
 //
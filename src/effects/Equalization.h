@@ -149,7 +149,6 @@ private:
    bool ProcessOne(int count, WaveTrack * t,
                    sampleCount start, sampleCount len);
    bool CalcFilter();
-   void Filter(size_t len, float *buffer);
    
    void Flatten();
    void ForceRecalc();
@@ -206,6 +205,8 @@ private:
 private:
    HFFT hFFT;
    Floats mFFTBuffer, mFilterFuncR, mFilterFuncI;
+   // The impulse response that CalcFilter() windowed, mM long
+   std::vector<float> mFilterTaps;
    size_t mM;
    wxString mCurveName;
    bool mLin;
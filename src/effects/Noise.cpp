@@ -17,6 +17,7 @@
 #include "Noise.h"
 
 #include <math.h>
+#include <stdlib.h>
 
 #include <wx/choice.h>
 #include <wx/intl.h>
@@ -98,22 +99,30 @@ unsigned EffectNoise::GetAudioOutCount()
    return 1;
 }
 
+bool EffectNoise::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames WXUNUSED(chanMap))
+{
+   // Different noise in each track, and each time
+   mRandom.Seed(rand());
+
+   return true;
+}
+
 size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t size)
 {
    float *buffer = outbuf[0];
 
    float white;
    float amplitude;
-   float div = ((float) RAND_MAX) / 2.0f;
+
+   // Make the white noise for the whole block at once; the other types
+   // filter it in place
+   const float whiteAmp = (mType == kPink || mType == kBrownian) ? 1.0f : mAmp;
+   mRandom.FillUniform(buffer, size, -whiteAmp, whiteAmp);
 
    switch (mType)
    {
    default:
    case kWhite: // white
-       for (decltype(size) i = 0; i < size; i++)
-       {
-          buffer[i] = mAmp * ((rand() / div) - 1.0f);
-       }
        break;
 
    case kPink: // pink
@@ -123,7 +132,7 @@ size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t
       amplitude = mAmp * 0.129f;
       for (decltype(size) i = 0; i < size; i++)
       {
-         white = (rand() / div) - 1.0f;
+         white = buffer[i];
          buf0 = 0.99886f * buf0 + 0.0555179f * white;
          buf1 = 0.99332f * buf1 + 0.0750759f * white;
          buf2 = 0.96900f * buf2 + 0.1538520f * white;
@@ -131,8 +140,8 @@ size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t
          buf4 = 0.55000f * buf4 + 0.5329522f * white;
          buf5 = -0.7616f * buf5 - 0.0168980f * white;
          buffer[i] = amplitude *
-            (buf0 + buf1 + buf2 + buf3 + buf4 + buf5 + buf6 + white * 0.5362);
-         buf6 = white * 0.115926;
+            (buf0 + buf1 + buf2 + buf3 + buf4 + buf5 + buf6 + white * 0.5362f);
+         buf6 = white * 0.115926f;
       }
       break;
 
@@ -150,7 +159,7 @@ size_t EffectNoise::ProcessBlock(float **WXUNUSED(inbuf), float **outbuf, size_t
  
       for (decltype(size) i = 0; i < size; i++)
       {
-         white = (rand() / div) - 1.0f;
+         white = buffer[i];
          z = leakage * y + white * scaling;
          y = fabs(z) > 1.0
             ? leakage * y - white * scaling
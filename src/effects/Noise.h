@@ -18,6 +18,7 @@
 #include "../widgets/NumericTextCtrl.h"
 
 #include "Effect.h"
+#include "../FastRandom.h"
 
 class ShuttleGui;
 
@@ -42,6 +43,7 @@ public:
    // EffectClientInterface implementation
 
    unsigned GetAudioOutCount() override;
+   bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
    bool DefineParams( ShuttleParams & S ) override;
    bool GetAutomationParameters(CommandParameters & parms) override;
@@ -61,6 +63,7 @@ private:
    int mType;
    double mAmp;
 
+   FastRandom mRandom;
    float y, z, buf0, buf1, buf2, buf3, buf4, buf5, buf6;
 
    NumericTextCtrl *mNoiseDurationT;
@@ -50,6 +50,12 @@
 #include "../widgets/valnum.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <math.h>
 
@@ -267,23 +273,34 @@ public:
                 SelectedTrackListOfKindIterator &iter, double mT0, double mT1);
 
 private:
-   bool ProcessOne(EffectNoiseReduction &effect,
-                   Statistics &statistics,
+   struct Record;
+
+   bool ProcessOne(Statistics &statistics,
                    TrackFactory &factory,
-                   int count, WaveTrack *track,
-                   sampleCount start, sampleCount len);
+                   WaveTrack *track,
+                   sampleCount start, sampleCount len,
+                   const Effect::ConcurrentProgress &progress);
 
    void StartNewTrack();
-   void ProcessSamples(Statistics &statistics,
-      WaveTrack *outputTrack, size_t len, float *buffer);
-   void FillFirstHistoryWindow();
+   void ProcessSamples(Statistics &statistics, size_t len, float *buffer);
+   void FillFirstHistoryWindow(Record &record);
    void ApplyFreqSmoothing(FloatVector &gains);
    void GatherStatistics(Statistics &statistics);
    inline bool Classify(const Statistics &statistics, int band);
    void ReduceNoise(const Statistics &statistics, WaveTrack *outputTrack);
+   void AppendOutput(WaveTrack *outputTrack, const float *buffer, size_t len);
+   void FlushOutput(WaveTrack *outputTrack);
    void RotateHistoryWindows();
    void FinishTrackStatistics(Statistics &statistics);
-   void FinishTrack(Statistics &statistics, WaveTrack *outputTrack);
+   void FinishTrack(Statistics &statistics);
+
+   // Noise reduction is pipelined:  the analysis of windows, on the thread
+   // reading the track, passes records to the synthesis of the output, on
+   // another thread, through a bounded queue
+   std::unique_ptr<Record> TakeFreeRecord();
+   void PushAnalysed(std::unique_ptr<Record> record);
+   void FinishAnalysis();
+   void Synthesize(const Statistics &statistics, WaveTrack *outputTrack);
 
 private:
 
@@ -294,7 +311,10 @@ private:
    const size_t mWindowSize;
    // These have that size:
    HFFT     hFFT;
+   // Used in analysis:
    FloatVector mFFTBuffer;
+   // Used in synthesis:
+   FloatVector mOutFFTBuffer;
    FloatVector mInWaveBuffer;
    FloatVector mOutOverlapBuffer;
    // These have that size, or 0:
@@ -316,6 +336,8 @@ private:
 
 
    sampleCount       mInSampleCount;
+   // Counting windows analysed, and synthesized
+   sampleCount       mInStepCount;
    sampleCount       mOutStepCount;
    int                   mInWavePos;
 
@@ -343,7 +365,21 @@ private:
       FloatVector mRealFFTs;
       FloatVector mImagFFTs;
    };
+   // The history of windows, which synthesis examines
    std::vector<std::unique_ptr<Record>> mQueue;
+
+   // Guarded by mPipelineMutex:
+   std::mutex mPipelineMutex;
+   std::condition_variable mPipelineCondition;
+   std::deque<std::unique_ptr<Record>> mAnalysed;
+   std::vector<std::unique_ptr<Record>> mFreeRecords;
+   bool mAnalysisDone;
+   // Also read without the lock, by analysis
+   std::atomic<bool> mSynthesisStopped;
+
+   // Whole blocks of output are appended to the track at once
+   FloatVector mOutputBuffer;
+   size_t mOutputBlockSize;
 };
 
 /****************************************************************//**
@@ -644,6 +680,18 @@ bool EffectNoiseReduction::Process()
    return bGoodResult;
 }
 
+namespace {
+   // Most windows analysed ahead of synthesis
+   const size_t PipelineDepth = 32;
+
+   // The block files of all tracks are made by one DirManager
+   std::mutex &TrackWriteMutex()
+   {
+      static std::mutex mutex;
+      return mutex;
+   }
+}
+
 EffectNoiseReduction::Worker::~Worker()
 {
 }
@@ -652,6 +700,13 @@ bool EffectNoiseReduction::Worker::Process
 (EffectNoiseReduction &effect, Statistics &statistics, TrackFactory &factory,
  SelectedTrackListOfKindIterator &iter, double inT0, double inT1)
 {
+   struct Job {
+      WaveTrack *track;
+      sampleCount start, len;
+      int count;
+   };
+   std::vector<Job> jobs;
+
    int count = 0;
    WaveTrack *track = (WaveTrack *) iter.First();
    while (track) {
@@ -671,16 +726,43 @@ bool EffectNoiseReduction::Worker::Process
       if (t1 > t0) {
          auto start = track->TimeToLongSamples(t0);
          auto end = track->TimeToLongSamples(t1);
-         auto len = end - start;
-
-         if (!ProcessOne(effect, statistics, factory,
-                         count, track, start, len))
-            return false;
+         jobs.push_back({ track, start, end - start, count });
       }
       track = (WaveTrack *) iter.Next();
       ++count;
    }
 
+   if (mDoProfile || jobs.size() < 2) {
+      // Profiling accumulates statistics, so goes one track at a time
+      for (const auto &job : jobs) {
+         auto progress = [&](double frac) {
+            return effect.TrackProgress(job.count, frac);
+         };
+         if (!ProcessOne(statistics, factory,
+                         job.track, job.start, job.len, progress))
+            return false;
+      }
+   }
+   else {
+      // Reduce the channels at once, each with its own worker, sharing the
+      // statistics, which are now only read
+      std::vector<std::unique_ptr<Worker>> workers;
+      for (size_t ii = 1; ii < jobs.size(); ++ii)
+         workers.push_back(std::make_unique<Worker>(*effect.mSettings, mSampleRate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+                           , effect.mF0, effect.mF1
+#endif
+            ));
+      auto body = [&](size_t ii, const Effect::ConcurrentProgress &progress) {
+         Worker &worker = (ii == 0) ? *this : *workers[ii - 1];
+         const auto &job = jobs[ii];
+         worker.ProcessOne(statistics, factory,
+                           job.track, job.start, job.len, progress);
+      };
+      if (!effect.ParallelForWithProgress(jobs.size(), body))
+         return false;
+   }
+
    if (mDoProfile) {
       if (statistics.mTotalWindows == 0) {
          effect.Effect::MessageBox(_("Selected noise profile is too short."));
@@ -735,6 +817,7 @@ EffectNoiseReduction::Worker::Worker
 , mWindowSize(settings.WindowSize())
 , hFFT(GetFFT(mWindowSize))
 , mFFTBuffer(mWindowSize)
+, mOutFFTBuffer(mWindowSize)
 , mInWaveBuffer(mWindowSize)
 , mOutOverlapBuffer(mWindowSize)
 , mInWindow()
@@ -755,8 +838,13 @@ EffectNoiseReduction::Worker::Worker
 , mNewSensitivity(settings.mNewSensitivity * log(10.0))
 
 , mInSampleCount(0)
+, mInStepCount(0)
 , mOutStepCount(0)
 , mInWavePos(0)
+
+, mAnalysisDone(false)
+, mSynthesisStopped(false)
+, mOutputBlockSize(0)
 {
 #ifdef EXPERIMENTAL_SPECTRAL_EDITING
    {
@@ -803,6 +891,12 @@ EffectNoiseReduction::Worker::Worker
    for (unsigned ii = 0; ii < mHistoryLen; ++ii)
       mQueue[ii] = std::make_unique<Record>(mSpectrumSize);
 
+   if (!mDoProfile) {
+      mFreeRecords.resize(PipelineDepth);
+      for (auto &pRecord : mFreeRecords)
+         pRecord = std::make_unique<Record>(mSpectrumSize);
+   }
+
    // Create windows
 
    const double constantTerm =
@@ -911,15 +1005,23 @@ void EffectNoiseReduction::Worker::StartNewTrack()
          // before the first full window:
          - (int)(mStepsPerWindow - 1);
    }
+   mInStepCount = mOutStepCount;
 
    mInSampleCount = 0;
+
+   // Records left in the pipeline by a cancelled track are free again
+   std::move(mAnalysed.begin(), mAnalysed.end(),
+             std::back_inserter(mFreeRecords));
+   mAnalysed.clear();
+   mAnalysisDone = false;
+   mSynthesisStopped = false;
+   mOutputBuffer.clear();
 }
 
 void EffectNoiseReduction::Worker::ProcessSamples
-(Statistics &statistics, WaveTrack *outputTrack,
- size_t len, float *buffer)
+(Statistics &statistics, size_t len, float *buffer)
 {
-   while (len && mOutStepCount * mStepSize < mInSampleCount) {
+   while (len && mInStepCount * mStepSize < mInSampleCount) {
       auto avail = std::min(len, mWindowSize - mInWavePos);
       memmove(&mInWaveBuffer[mInWavePos], buffer, avail * sizeof(float));
       buffer += avail;
@@ -927,13 +1029,20 @@ void EffectNoiseReduction::Worker::ProcessSamples
       mInWavePos += avail;
 
       if (mInWavePos == (int)mWindowSize) {
-         FillFirstHistoryWindow();
-         if (mDoProfile)
+         if (mDoProfile) {
+            FillFirstHistoryWindow(*mQueue[0]);
             GatherStatistics(statistics);
-         else
-            ReduceNoise(statistics, outputTrack);
-         ++mOutStepCount;
-         RotateHistoryWindows();
+            RotateHistoryWindows();
+         }
+         else {
+            auto pRecord = TakeFreeRecord();
+            if (!pRecord)
+               // Synthesis failed, and ProcessOne will say why
+               return;
+            FillFirstHistoryWindow(*pRecord);
+            PushAnalysed(std::move(pRecord));
+         }
+         ++mInStepCount;
 
          // Rotate for overlap-add
          memmove(&mInWaveBuffer[0], &mInWaveBuffer[mStepSize],
@@ -943,7 +1052,7 @@ void EffectNoiseReduction::Worker::ProcessSamples
    }
 }
 
-void EffectNoiseReduction::Worker::FillFirstHistoryWindow()
+void EffectNoiseReduction::Worker::FillFirstHistoryWindow(Record &record)
 {
    // Transform samples to frequency domain, windowed as needed
    if (mInWindow.size() > 0)
@@ -953,8 +1062,6 @@ void EffectNoiseReduction::Worker::FillFirstHistoryWindow()
       memmove(&mFFTBuffer[0], &mInWaveBuffer[0], mWindowSize * sizeof(float));
    RealFFTf(&mFFTBuffer[0], hFFT.get());
 
-   Record &record = *mQueue[0];
-
    // Store real and imaginary parts for later inverse FFT, and compute
    // power
    {
@@ -993,6 +1100,85 @@ void EffectNoiseReduction::Worker::RotateHistoryWindows()
    std::rotate(mQueue.begin(), mQueue.end() - 1, mQueue.end());
 }
 
+auto EffectNoiseReduction::Worker::TakeFreeRecord() -> std::unique_ptr<Record>
+{
+   std::unique_lock<std::mutex> lock{ mPipelineMutex };
+   mPipelineCondition.wait(lock, [this]{
+      return mSynthesisStopped || !mFreeRecords.empty(); });
+   if (mSynthesisStopped)
+      return {};
+   auto pRecord = std::move(mFreeRecords.back());
+   mFreeRecords.pop_back();
+   return pRecord;
+}
+
+void EffectNoiseReduction::Worker::PushAnalysed(std::unique_ptr<Record> record)
+{
+   {
+      std::lock_guard<std::mutex> lock{ mPipelineMutex };
+      mAnalysed.push_back(std::move(record));
+   }
+   mPipelineCondition.notify_all();
+}
+
+void EffectNoiseReduction::Worker::FinishAnalysis()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mPipelineMutex };
+      mAnalysisDone = true;
+   }
+   mPipelineCondition.notify_all();
+}
+
+void EffectNoiseReduction::Worker::Synthesize
+(const Statistics &statistics, WaveTrack *outputTrack)
+{
+   while (true) {
+      std::unique_ptr<Record> pRecord;
+      {
+         std::unique_lock<std::mutex> lock{ mPipelineMutex };
+         mPipelineCondition.wait(lock, [this]{
+            return mAnalysisDone || !mAnalysed.empty(); });
+         if (mAnalysed.empty())
+            break;
+         pRecord = std::move(mAnalysed.front());
+         mAnalysed.pop_front();
+      }
+
+      // The new window enters the history in place of the one that left
+      // it at the last rotation, which can be reused for analysis
+      std::swap(mQueue[0], pRecord);
+      {
+         std::lock_guard<std::mutex> lock{ mPipelineMutex };
+         mFreeRecords.push_back(std::move(pRecord));
+      }
+      mPipelineCondition.notify_all();
+
+      ReduceNoise(statistics, outputTrack);
+      ++mOutStepCount;
+      RotateHistoryWindows();
+   }
+
+   FlushOutput(outputTrack);
+}
+
+void EffectNoiseReduction::Worker::AppendOutput
+(WaveTrack *outputTrack, const float *buffer, size_t len)
+{
+   mOutputBuffer.insert(mOutputBuffer.end(), buffer, buffer + len);
+   if (mOutputBuffer.size() >= mOutputBlockSize)
+      FlushOutput(outputTrack);
+}
+
+void EffectNoiseReduction::Worker::FlushOutput(WaveTrack *outputTrack)
+{
+   if (mOutputBuffer.empty())
+      return;
+   std::lock_guard<std::mutex> lock{ TrackWriteMutex() };
+   outputTrack->Append((samplePtr)&mOutputBuffer[0], floatSample, mOutputBuffer.size());
+   mOutputBuffer.clear();
+}
+
 void EffectNoiseReduction::Worker::FinishTrackStatistics(Statistics &statistics)
 {
    const int windows = statistics.mTrackWindows;
@@ -1014,8 +1200,7 @@ void EffectNoiseReduction::Worker::FinishTrackStatistics(Statistics &statistics)
    statistics.mTotalWindows = denom;
 }
 
-void EffectNoiseReduction::Worker::FinishTrack
-(Statistics &statistics, WaveTrack *outputTrack)
+void EffectNoiseReduction::Worker::FinishTrack(Statistics &statistics)
 {
    // Keep flushing empty input buffers through the history
    // windows until we've output exactly as many samples as
@@ -1026,8 +1211,10 @@ void EffectNoiseReduction::Worker::FinishTrack
 
    FloatVector empty(mStepSize);
 
-   while (mOutStepCount * mStepSize < mInSampleCount) {
-      ProcessSamples(statistics, outputTrack, mStepSize, &empty[0]);
+   while (mInStepCount * mStepSize < mInSampleCount) {
+      ProcessSamples(statistics, mStepSize, &empty[0]);
+      if (!mDoProfile && mSynthesisStopped)
+         break;
    }
 }
 
@@ -1222,7 +1409,7 @@ void EffectNoiseReduction::Worker::ReduceNoise
          const float *pGain = &record.mGains[1];
          const float *pReal = &record.mRealFFTs[1];
          const float *pImag = &record.mImagFFTs[1];
-         float *pBuffer = &mFFTBuffer[2];
+         float *pBuffer = &mOutFFTBuffer[2];
          auto nn = mSpectrumSize - 2;
          if (mNoiseReductionChoice == NRC_LEAVE_RESIDUE) {
             for (; nn--;) {
@@ -1232,9 +1419,9 @@ void EffectNoiseReduction::Worker::ReduceNoise
                *pBuffer++ = *pReal++ * gain;
                *pBuffer++ = *pImag++ * gain;
             }
-            mFFTBuffer[0] = record.mRealFFTs[0] * (record.mGains[0] - 1.0);
+            mOutFFTBuffer[0] = record.mRealFFTs[0] * (record.mGains[0] - 1.0);
             // The Fs/2 component is stored as the imaginary part of the DC component
-            mFFTBuffer[1] = record.mImagFFTs[0] * (record.mGains[last] - 1.0);
+            mOutFFTBuffer[1] = record.mImagFFTs[0] * (record.mGains[last] - 1.0);
          }
          else {
             for (; nn--;) {
@@ -1242,14 +1429,14 @@ void EffectNoiseReduction::Worker::ReduceNoise
                *pBuffer++ = *pReal++ * gain;
                *pBuffer++ = *pImag++ * gain;
             }
-            mFFTBuffer[0] = record.mRealFFTs[0] * record.mGains[0];
+            mOutFFTBuffer[0] = record.mRealFFTs[0] * record.mGains[0];
             // The Fs/2 component is stored as the imaginary part of the DC component
-            mFFTBuffer[1] = record.mImagFFTs[0] * record.mGains[last];
+            mOutFFTBuffer[1] = record.mImagFFTs[0] * record.mGains[last];
          }
       }
 
       // Invert the FFT into the output buffer
-      InverseRealFFTf(&mFFTBuffer[0], hFFT.get());
+      InverseRealFFTf(&mOutFFTBuffer[0], hFFT.get());
 
       // Overlap-add
       if (mOutWindow.size() > 0) {
@@ -1258,8 +1445,8 @@ void EffectNoiseReduction::Worker::ReduceNoise
          int *pBitReversed = &hFFT->BitReversed[0];
          for (unsigned int jj = 0; jj < last; ++jj) {
             int kk = *pBitReversed++;
-            *pOut++ += mFFTBuffer[kk] * (*pWindow++);
-            *pOut++ += mFFTBuffer[kk + 1] * (*pWindow++);
+            *pOut++ += mOutFFTBuffer[kk] * (*pWindow++);
+            *pOut++ += mOutFFTBuffer[kk + 1] * (*pWindow++);
          }
       }
       else {
@@ -1267,15 +1454,15 @@ void EffectNoiseReduction::Worker::ReduceNoise
          int *pBitReversed = &hFFT->BitReversed[0];
          for (unsigned int jj = 0; jj < last; ++jj) {
             int kk = *pBitReversed++;
-            *pOut++ += mFFTBuffer[kk];
-            *pOut++ += mFFTBuffer[kk + 1];
+            *pOut++ += mOutFFTBuffer[kk];
+            *pOut++ += mOutFFTBuffer[kk + 1];
          }
       }
 
       float *buffer = &mOutOverlapBuffer[0];
       if (mOutStepCount >= 0) {
          // Output the first portion of the overlap buffer, they're done
-         outputTrack->Append((samplePtr)buffer, floatSample, mStepSize);
+         AppendOutput(outputTrack, buffer, mStepSize);
       }
 
       // Shift the remainder over.
@@ -1285,24 +1472,52 @@ void EffectNoiseReduction::Worker::ReduceNoise
 }
 
 bool EffectNoiseReduction::Worker::ProcessOne
-(EffectNoiseReduction &effect,  Statistics &statistics, TrackFactory &factory,
- int count, WaveTrack * track, sampleCount start, sampleCount len)
+(Statistics &statistics, TrackFactory &factory,
+ WaveTrack * track, sampleCount start, sampleCount len,
+ const Effect::ConcurrentProgress &progress)
 {
    if (track == NULL)
       return false;
 
    StartNewTrack();
 
+   auto bufferSize = track->GetMaxBlockSize();
+   FloatVector buffer(bufferSize);
+   mOutputBlockSize = bufferSize;
+
    WaveTrack::Holder outputTrack;
-   if(!mDoProfile)
+   if(!mDoProfile) {
+      std::lock_guard<std::mutex> lock{ TrackWriteMutex() };
       outputTrack = factory.NewWaveTrack(track->GetSampleFormat(), track->GetRate());
+   }
 
-   auto bufferSize = track->GetMaxBlockSize();
-   FloatVector buffer(bufferSize);
+   // Start synthesis when reducing noise
+   std::exception_ptr synthesisException;
+   std::thread synthesis;
+   if (!mDoProfile)
+      synthesis = std::thread{ [&]{
+         try {
+            Synthesize(statistics, outputTrack.get());
+         }
+         catch (...) {
+            synthesisException = std::current_exception();
+         }
+         {
+            std::lock_guard<std::mutex> lock{ mPipelineMutex };
+            mSynthesisStopped = true;
+         }
+         mPipelineCondition.notify_all();
+      } };
+   auto joinSynthesis = finally( [&]{
+      if (synthesis.joinable()) {
+         FinishAnalysis();
+         synthesis.join();
+      }
+   } );
 
    bool bLoopSuccess = true;
    auto samplePos = start;
-   while (bLoopSuccess && samplePos < start + len) {
+   while (bLoopSuccess && samplePos < start + len && !mSynthesisStopped) {
       //Get a blockSize of samples (smaller than the size of the buffer)
       const auto blockSize = limitSampleBufferSize(
          track->GetBestBlockSize(samplePos),
@@ -1314,23 +1529,31 @@ bool EffectNoiseReduction::Worker::ProcessOne
       samplePos += blockSize;
 
       mInSampleCount += blockSize;
-      ProcessSamples(statistics, outputTrack.get(), blockSize, &buffer[0]);
+      ProcessSamples(statistics, blockSize, &buffer[0]);
 
       // Update the Progress meter, let user cancel
       bLoopSuccess = 
-         !effect.TrackProgress(count,
-                               ( samplePos - start ).as_double() /
-                               len.as_double() );
+         !progress(( samplePos - start ).as_double() /
+                   len.as_double() );
    }
 
    if (bLoopSuccess) {
       if (mDoProfile)
          FinishTrackStatistics(statistics);
       else
-         FinishTrack(statistics, &*outputTrack);
+         FinishTrack(statistics);
+   }
+
+   if (synthesis.joinable()) {
+      FinishAnalysis();
+      synthesis.join();
+      if (synthesisException)
+         std::rethrow_exception(synthesisException);
    }
 
    if (bLoopSuccess && !mDoProfile) {
+      std::lock_guard<std::mutex> lock{ TrackWriteMutex() };
+
       // Flush the output WaveTrack (since it's buffered)
       outputTrack->Flush();
 
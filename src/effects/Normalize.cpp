@@ -383,73 +383,26 @@ bool EffectNormalize::AnalyseTrack(const WaveTrack * track, const wxString &msg,
    }
 }
 
-//AnalyseDC() takes a track, transforms it to bunch of buffer-blocks,
-//and executes AnalyzeData on it...
+//AnalyseDC() finds the mean of the samples from the sums of whole blocks,
+//which are known for blocks written in this session, so that usually only
+//the edges of the selection are read
 bool EffectNormalize::AnalyseDC(const WaveTrack * track, const wxString &msg,
                                 int curTrackNum,
                                 float &offset)
 {
-   bool rc = true;
-
    offset = 0.0; // we might just return
 
    if(!mDC)  // don't do analysis if not doing dc removal
-      return(rc);
-
-   //Transform the marker timepoints to samples
-   auto start = track->TimeToLongSamples(mCurT0);
-   auto end = track->TimeToLongSamples(mCurT1);
-
-   //Get the length of the buffer (as double). len is
-   //used simply to calculate a progress meter, so it is easier
-   //to make it a double now than it is to do it later
-   auto len = (end - start).as_double();
-
-   //Initiate a processing buffer.  This buffer will (most likely)
-   //be shorter than the length of the track being processed.
-   Floats buffer{ track->GetMaxBlockSize() };
-
-   mSum = 0.0; // dc offset inits
-   mCount = 0;
-
-   sampleCount blockSamples;
-   sampleCount totalSamples = 0;
-
-   //Go through the track one buffer at a time. s counts which
-   //sample the current buffer starts at.
-   auto s = start;
-   while (s < end) {
-      //Get a block of samples (smaller than the size of the buffer)
-      //Adjust the block size if it is the final block in the track
-      const auto block = limitSampleBufferSize(
-         track->GetBestBlockSize(s),
-         end - s
-      );
-
-      //Get the samples from the track and put them in the buffer
-      track->Get((samplePtr) buffer.get(), floatSample, s, block, fillZero, true, &blockSamples);
-      totalSamples += blockSamples;
-
-      //Process the buffer.
-      AnalyzeData(buffer.get(), block);
+      return true;
 
-      //Increment s one blockfull of samples
-      s += block;
+   // Let the user cancel before any blocks are read
+   if (TrackProgress(curTrackNum, 0.0, msg))
+      return false;
 
-      //Update the Progress meter
-      if (TrackProgress(curTrackNum,
-                        ((s - start).as_double() / len)/2.0, msg)) {
-         rc = false; //lda .. break, not return, so that buffer is deleted
-         break;
-      }
-   }
-   if( totalSamples > 0 )
-      offset = -mSum / totalSamples.as_double();  // calculate actual offset (amount that needs to be added on)
-   else
-      offset = 0.0;
+   // calculate actual offset (amount that needs to be added on)
+   offset = -track->GetMean(mCurT0, mCurT1); // may throw
 
-   //Return true because the effect processing succeeded ... unless cancelled
-   return rc;
+   return true;
 }
 
 //ProcessOne() takes a track, transforms it to bunch of buffer-blocks,
@@ -461,6 +414,10 @@ bool EffectNormalize::ProcessOne(
 {
    bool rc = true;
 
+   // Samples would be unchanged, so don't rewrite any
+   if (offset == 0.0 && mMult == 1.0)
+      return rc;
+
    //Transform the marker timepoints to samples
    auto start = track->TimeToLongSamples(mCurT0);
    auto end = track->TimeToLongSamples(mCurT1);
@@ -499,7 +456,7 @@ bool EffectNormalize::ProcessOne(
 
       //Update the Progress meter
       if (TrackProgress(curTrackNum,
-                        0.5+((s - start).as_double() / len)/2.0, msg)) {
+                        (s - start).as_double() / len, msg)) {
          rc = false; //lda .. break, not return, so that buffer is deleted
          break;
       }
@@ -509,13 +466,6 @@ bool EffectNormalize::ProcessOne(
    return rc;
 }
 
-void EffectNormalize::AnalyzeData(float *buffer, size_t len)
-{
-   for(decltype(len) i = 0; i < len; i++)
-      mSum += (double)buffer[i];
-   mCount += len;
-}
-
 void EffectNormalize::ProcessData(float *buffer, size_t len, float offset)
 {
    for(decltype(len) i = 0; i < len; i++) {
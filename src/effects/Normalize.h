@@ -63,7 +63,6 @@ private:
    bool AnalyseTrack(const WaveTrack * track, const wxString &msg,
                      int curTrackNum,
                      float &offset, float &min, float &max);
-   void AnalyzeData(float *buffer, size_t len);
    bool AnalyseDC(const WaveTrack * track, const wxString &msg, int curTrackNum,
                   float &offset);
    void ProcessData(float *buffer, size_t len, float offset);
@@ -80,8 +79,6 @@ private:
    double mCurT0;
    double mCurT1;
    float  mMult;
-   double mSum;
-   sampleCount    mCount;
 
    wxCheckBox *mGainCheckBox;
    wxCheckBox *mDCCheckBox;
@@ -18,6 +18,7 @@
 #include "Paulstretch.h"
 
 #include <algorithm>
+#include <vector>
 
 #include <math.h>
 #include <float.h>
@@ -26,7 +27,9 @@
 #include <wx/valgen.h>
 
 #include "../ShuttleGui.h"
+#include "../FastRandom.h"
 #include "../FFT.h"
+#include "../RealFFTf.h"
 #include "../widgets/valnum.h"
 #include "../widgets/ErrorDialog.h"
 #include "../Prefs.h"
@@ -39,14 +42,25 @@
 Param( Amount, float,   wxT("Stretch Factor"),   10.0,    1.0,     FLT_MAX, 1   );
 Param( Time,   float,   wxT("Time Resolution"),  0.25f,   0.00099f,  FLT_MAX, 1   );
 
+// The windows of the input are transformed in batches, one per slot, on
+// several threads; only the sliding of the input pool and the overlap-add
+// of the outputs go in order.
 class PaulStretch
 {
 public:
-   PaulStretch(float rap_, size_t in_bufsize_, float samplerate_);
+   PaulStretch(float rap_, size_t in_bufsize_, float samplerate_,
+               size_t nslots_, unsigned seed_);
    //in_bufsize is also a half of a FFT buffer (in samples)
    virtual ~PaulStretch();
 
-   void process(float *smps, size_t nsmps);
+   //add nsmps samples to the pool, and take the next window from it into slot
+   void push(const float *smps, size_t nsmps, size_t slot);
+   //randomize the phases of the window in slot; different slots may be
+   //processed on different threads at once
+   void process_slot(size_t slot);
+   //mix the window in slot into out_buf; slots must be taken in the order
+   //they were pushed
+   void make_output(size_t slot);
 
    size_t get_nsamples();//how many samples are required to be added in the pool next time
    size_t get_nsamples_for_fill();//how many samples are required to be added for a complete buffer refill (at start of the song or after seek)
@@ -67,13 +81,29 @@ private:
 
 public:
    const size_t poolsize;//how many samples are inside the input_pool size (need to know how many samples to fill when seeking)
+   const size_t nslots;
 
 private:
    const Floats in_pool;//de marimea in_bufsize
 
    double remained_samples;//how many fraction of samples has remained (0..1)
 
-   const Floats fft_smps, fft_c, fft_s, fft_freq, fft_tmp;
+   const HFFT hFFT;
+   const Floats window;
+   //cosines and sines of the 2^15 random phases
+   const Floats phase_c, phase_s;
+
+   //the crossfade from the old output, and the gain, at each output sample
+   const Floats out_fade, out_gain;
+
+   //for each slot, the window and then its transforms, and the magnitudes
+   //and then the output
+   const FloatBuffers slot_smps, slot_freq;
+   //the index of the window in each slot, which seeds its phases, so that
+   //the result does not depend on the threads
+   std::vector<unsigned long> slot_windows;
+   unsigned long nwindows;
+   const unsigned seed;
 };
 
 //
@@ -331,7 +361,9 @@ bool EffectPaulstretch::ProcessOne(WaveTrack *track,double t0,double t1,int coun
       // This encloses all the allocations of buffers, including those in
       // the constructor of the PaulStretch object
 
-      PaulStretch stretch(amount, stretch_buf_size, track->GetRate());
+      // Two slots at least, for the pair of windows at the start
+      PaulStretch stretch(amount, stretch_buf_size, track->GetRate(),
+         std::max(2u, GetConcurrency()), rand());
 
       auto nget = stretch.get_nsamples_for_fill();
 
@@ -343,48 +375,77 @@ bool EffectPaulstretch::ProcessOne(WaveTrack *track,double t0,double t1,int coun
       const auto fade_len = std::min<size_t>(100, bufsize / 2 - 1);
       bool cancelled = false;
 
+      // What to do with the output of each window of a batch
+      struct Window {
+         bool append, fadeIn;
+         decltype(len) s;
+      };
+      std::vector<Window> windows;
+      windows.reserve(stretch.nslots);
+
       {
          Floats fade_track_smps{ fade_len };
          decltype(len) s=0;
 
-         while (s < len) {
-            track->Get((samplePtr)bufferptr0, floatSample, start + s, nget);
-            stretch.process(buffer0.get(), nget);
-
-            if (first_time) {
-               stretch.process(buffer0.get(), 0);
-            };
+         while (s < len && !cancelled) {
+            // Read the input for a batch of windows, in order
+            windows.clear();
+            while (s < len && windows.size() < stretch.nslots) {
+               track->Get((samplePtr)bufferptr0, floatSample, start + s, nget);
+               stretch.push(buffer0.get(), nget, windows.size());
 
-            s += nget;
+               s += nget;
 
-            if (first_time){//blend the the start of the selection
-               track->Get((samplePtr)fade_track_smps.get(), floatSample, start, fade_len);
-               first_time = false;
-               for (size_t i = 0; i < fade_len; i++){
-                  float fi = (float)i / (float)fade_len;
-                  stretch.out_buf[i] =
-                     stretch.out_buf[i] * fi + (1.0 - fi) * fade_track_smps[i];
+               if (first_time) {
+                  // The first window only starts the overlap of the next
+                  windows.push_back({ false, false, s });
+                  stretch.push(buffer0.get(), 0, windows.size());
                }
+               windows.push_back({ true, first_time, s });
+               first_time = false;
+
+               nget = stretch.get_nsamples();
             }
-            if (s >= len){//blend the end of the selection
-               track->Get((samplePtr)fade_track_smps.get(), floatSample, end - fade_len, fade_len);
-               for (size_t i = 0; i < fade_len; i++){
-                  float fi = (float)i / (float)fade_len;
-                  auto i2 = bufsize / 2 - 1 - i;
-                  stretch.out_buf[i2] =
-                     stretch.out_buf[i2] * fi + (1.0 - fi) *
-                     fade_track_smps[fade_len - 1 - i];
+
+            // The transforms are independent
+            ParallelFor(windows.size(), [&](size_t slot) {
+               stretch.process_slot(slot);
+            });
+
+            // Overlap and write, in order
+            for (size_t slot = 0; slot < windows.size(); ++slot) {
+               const auto &window = windows[slot];
+               stretch.make_output(slot);
+               if (!window.append)
+                  continue;
+
+               if (window.fadeIn){//blend the the start of the selection
+                  track->Get((samplePtr)fade_track_smps.get(), floatSample, start, fade_len);
+                  for (size_t i = 0; i < fade_len; i++){
+                     float fi = (float)i / (float)fade_len;
+                     stretch.out_buf[i] =
+                        stretch.out_buf[i] * fi + (1.0 - fi) * fade_track_smps[i];
+                  }
+               }
+               if (window.s >= len){//blend the end of the selection
+                  track->Get((samplePtr)fade_track_smps.get(), floatSample, end - fade_len, fade_len);
+                  for (size_t i = 0; i < fade_len; i++){
+                     float fi = (float)i / (float)fade_len;
+                     auto i2 = bufsize / 2 - 1 - i;
+                     stretch.out_buf[i2] =
+                        stretch.out_buf[i2] * fi + (1.0 - fi) *
+                        fade_track_smps[fade_len - 1 - i];
+                  }
                }
-            }
 
-            outputTrack->Append((samplePtr)stretch.out_buf.get(), floatSample, stretch.out_bufsize);
+               outputTrack->Append((samplePtr)stretch.out_buf.get(), floatSample, stretch.out_bufsize);
 
-            nget = stretch.get_nsamples();
-            if (TrackProgress(count,
-               s.as_double() / len.as_double()
-            )) {
-               cancelled = true;
-               break;
+               if (TrackProgress(count,
+                  window.s.as_double() / len.as_double()
+               )) {
+                  cancelled = true;
+                  break;
+               }
             }
          }
       }
@@ -408,7 +469,12 @@ bool EffectPaulstretch::ProcessOne(WaveTrack *track,double t0,double t1,int coun
 /*************************************************************/
 
 
-PaulStretch::PaulStretch(float rap_, size_t in_bufsize_, float samplerate_ )
+namespace {
+   const size_t PhaseCount = 0x8000;
+}
+
+PaulStretch::PaulStretch(float rap_, size_t in_bufsize_, float samplerate_,
+                         size_t nslots_, unsigned seed_)
    : samplerate { samplerate_ }
    , rap { std::max(1.0f, rap_) }
    , in_bufsize { in_bufsize_ }
@@ -416,95 +482,123 @@ PaulStretch::PaulStretch(float rap_, size_t in_bufsize_, float samplerate_ )
    , out_buf { out_bufsize }
    , old_out_smp_buf { out_bufsize * 2, true }
    , poolsize { in_bufsize_ * 2 }
+   , nslots { std::max(size_t{ 1 }, nslots_) }
    , in_pool { poolsize, true }
    , remained_samples { 0.0 }
-   , fft_smps { poolsize, true }
-   , fft_c { poolsize, true }
-   , fft_s { poolsize, true }
-   , fft_freq { poolsize, true }
-   , fft_tmp { poolsize }
+   , hFFT { GetFFT(poolsize) }
+   , window { poolsize }
+   , phase_c { PhaseCount }
+   , phase_s { PhaseCount }
+   , out_fade { out_bufsize }
+   , out_gain { out_bufsize }
+   , slot_smps { nslots, poolsize }
+   , slot_freq { nslots, poolsize }
+   , slot_windows( nslots )
+   , nwindows { 0 }
+   , seed { seed_ }
 {
+   std::fill(window.get(), window.get() + poolsize, 1.0f);
+   WindowFunc(eWinFuncHanning, poolsize, window.get());
+
+   float inv_2p15_2pi = 1.0 / 16384.0 * (float)M_PI;
+   for (size_t i = 0; i < PhaseCount; i++) {
+      float phase = i * inv_2p15_2pi;
+      phase_c[i] = cos(phase);
+      phase_s[i] = sin(phase);
+   }
+
+   float tmp = 1.0 / (float) out_bufsize * M_PI;
+   float hinv_sqrt2 = 0.853553390593f;//(1.0+1.0/sqrt(2))*0.5;
+
+   float ampfactor = 1.0;
+   if (rap < 1.0)
+      ampfactor = rap * 0.707;
+   else
+      ampfactor = (out_bufsize / (float)poolsize) * 4.0;
+
+   for (size_t i = 0; i < out_bufsize; i++) {
+      out_fade[i] = (0.5 + 0.5 * cos(i * tmp));
+      out_gain[i] =
+         (hinv_sqrt2 - (1.0 - hinv_sqrt2) * cos(i * 2.0 * tmp)) * ampfactor;
+   }
 }
 
 PaulStretch::~PaulStretch()
 {
 }
 
-void PaulStretch::process(float *smps, size_t nsmps)
+void PaulStretch::push(const float *smps, size_t nsmps, size_t slot)
 {
    //add NEW samples to the pool
    if ((smps != NULL) && (nsmps != 0)) {
       if (nsmps > poolsize) {
          nsmps = poolsize;
       }
-      int nleft = poolsize - nsmps;
+      size_t nleft = poolsize - nsmps;
 
       //move left the samples from the pool to make room for NEW samples
-      for (int i = 0; i < nleft; i++)
-         in_pool[i] = in_pool[i + nsmps];
+      std::copy(in_pool.get() + nsmps, in_pool.get() + poolsize, in_pool.get());
 
       //add NEW samples to the pool
-      for (size_t i = 0; i < nsmps; i++)
-         in_pool[i + nleft] = smps[i];
+      std::copy(smps, smps + nsmps, in_pool.get() + nleft);
    }
 
    //get the samples from the pool
+   float *fft_smps = slot_smps[slot].get();
+   const float *win = window.get();
    for (size_t i = 0; i < poolsize; i++)
-      fft_smps[i] = in_pool[i];
-   WindowFunc(eWinFuncHanning, poolsize, fft_smps.get());
+      fft_smps[i] = in_pool[i] * win[i];
 
-   RealFFT(poolsize, fft_smps.get(), fft_c.get(), fft_s.get());
-
-   for (size_t i = 0; i < poolsize / 2; i++)
-      fft_freq[i] = sqrt(fft_c[i] * fft_c[i] + fft_s[i] * fft_s[i]);
-   process_spectrum(fft_freq.get());
+   slot_windows[slot] = nwindows++;
+}
 
+void PaulStretch::process_slot(size_t slot)
+{
+   float *fft_smps = slot_smps[slot].get();
+   float *fft_freq = slot_freq[slot].get();
+   const int *bitReversed = hFFT->BitReversed.get();
+   const size_t half = poolsize / 2;
+
+   //the spectrum comes out of RealFFTf in bit-reversed order, and goes into
+   //InverseRealFFTf in the natural order, so it is rebuilt in the other buffer
+   RealFFTf(fft_smps, hFFT.get());
+
+   for (size_t i = 1; i < half; i++) {
+      const float re = fft_smps[bitReversed[i]];
+      const float im = fft_smps[bitReversed[i] + 1];
+      fft_freq[i] = sqrt(re * re + im * im);
+   }
+   process_spectrum(fft_freq);
 
    //put randomize phases to frequencies and do a IFFT
-   float inv_2p15_2pi = 1.0 / 16384.0 * (float)M_PI;
-   for (size_t i = 1; i < poolsize / 2; i++) {
-      unsigned int random = (rand()) & 0x7fff;
-      float phase = random * inv_2p15_2pi;
-      float s = fft_freq[i] * sin(phase);
-      float c = fft_freq[i] * cos(phase);
-
-      fft_c[i] = fft_c[poolsize - i] = c;
-
-      fft_s[i] = s; fft_s[poolsize - i] = -s;
+   //seeding is cheap, unlike that of a Mersenne twister for each window
+   FastRandom generator{ (uint64_t(seed) << 32) | uint32_t(slot_windows[slot]) };
+   for (size_t i = 1; i < half; i++) {
+      const auto phase = generator.Next() >> 17;
+      const float mag = fft_freq[i];
+      fft_smps[2 * i] = mag * phase_c[phase];
+      fft_smps[2 * i + 1] = mag * phase_s[phase];
    }
-   fft_c[0] = fft_s[0] = 0.0;
-   fft_c[poolsize / 2] = fft_s[poolsize / 2] = 0.0;
-
-   FFT(poolsize, true, fft_c.get(), fft_s.get(), fft_smps.get(), fft_tmp.get());
+   //the DC and fs/2 bins
+   fft_smps[0] = fft_smps[1] = 0.0;
 
-   float max = 0.0, max2 = 0.0;
-   for (size_t i = 0; i < poolsize; i++) {
-      max = std::max(max, fabsf(fft_tmp[i]));
-      max2 = std::max(max2, fabsf(fft_smps[i]));
-   }
+   InverseRealFFTf(fft_smps, hFFT.get());
+   ReorderToTime(hFFT.get(), fft_smps, fft_freq);
+}
 
+void PaulStretch::make_output(size_t slot)
+{
+   const float *fft_smps = slot_freq[slot].get();
 
    //make the output buffer
-   float tmp = 1.0 / (float) out_bufsize * M_PI;
-   float hinv_sqrt2 = 0.853553390593f;//(1.0+1.0/sqrt(2))*0.5;
-
-   float ampfactor = 1.0;
-   if (rap < 1.0)
-      ampfactor = rap * 0.707;
-   else
-      ampfactor = (out_bufsize / (float)poolsize) * 4.0;
-
    for (size_t i = 0; i < out_bufsize; i++) {
-      float a = (0.5 + 0.5 * cos(i * tmp));
+      float a = out_fade[i];
       float out = fft_smps[i + out_bufsize] * (1.0 - a) + old_out_smp_buf[i] * a;
-      out_buf[i] =
-         out * (hinv_sqrt2 - (1.0 - hinv_sqrt2) * cos(i * 2.0 * tmp)) *
-         ampfactor;
+      out_buf[i] = out * out_gain[i];
    }
 
    //copy the current output buffer to old buffer
-   for (size_t i = 0; i < out_bufsize * 2; i++)
-      old_out_smp_buf[i] = fft_smps[i];
+   std::copy(fft_smps, fft_smps + out_bufsize * 2, old_out_smp_buf.get());
 }
 
 size_t PaulStretch::get_nsamples()
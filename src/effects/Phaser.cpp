@@ -22,6 +22,7 @@
 #include "../Audacity.h"
 #include "Phaser.h"
 
+#include <algorithm>
 #include <math.h>
 
 #include <wx/intl.h>
@@ -399,18 +400,33 @@ size_t EffectPhaser::InstanceProcess(EffectPhaserState & data, float **inBlock,
    data.phase = mPhase * M_PI / 180;
    data.outgain = DB_TO_LINEAR(mOutGain);
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++)
-   {
-      double in = ibuf[i];
+   // The settings may change on another thread; take them once for the block
+   const int stages = mStages;
+   const int feedback = mFeedback;
+   const int dryWet = mDryWet;
+   const double outgain = data.outgain;
+
+   // The state stays in registers and on the stack, not in data, while the
+   // samples between two steps of the lfo are filtered with the same gain
+   double old[NUM_STAGES];
+   std::copy(data.old, data.old + stages, old);
+   double fbout = data.fbout;
 
-      double m = in + data.fbout * mFeedback / 101;  // Feedback must be less than 100% to avoid infinite gain.
+   for (decltype(blockLen) i = 0; i < blockLen;)
+   {
+      const auto position = (data.skipcount % lfoskipsamples).as_size_t();
+      const auto run = std::min(blockLen - i, lfoskipsamples - position);
+      data.skipcount += run;
 
-      if (((data.skipcount++) % lfoskipsamples) == 0)
+      if (position == 0)
       {
+         // The lfo is computed for the count after the run's first sample
+         const auto count = data.skipcount - run + 1;
+
          //compute sine between 0 and 1
          data.gain =
             (1.0 +
-             cos(data.skipcount.as_double() * data.lfoskip
+             cos(count.as_double() * data.lfoskip
                  + data.phase)) / 2.0;
 
          // change lfo shape
@@ -419,19 +435,30 @@ size_t EffectPhaser::InstanceProcess(EffectPhaserState & data, float **inBlock,
          // attenuate the lfo
          data.gain = 1.0 - data.gain / 255.0 * mDepth;
       }
+      const double gain = data.gain;
 
-      // phasing routine
-      for (int j = 0; j < mStages; j++)
+      for (const auto end = i + run; i < end; i++)
       {
-         double tmp = data.old[j];
-         data.old[j] = data.gain * tmp + m;
-         m = tmp - data.gain * data.old[j];
-      }
-      data.fbout = m;
+         double in = ibuf[i];
 
-      obuf[i] = (float) (data.outgain * (m * mDryWet + in * (255 - mDryWet)) / 255);
+         double m = in + fbout * feedback / 101;  // Feedback must be less than 100% to avoid infinite gain.
+
+         // phasing routine
+         for (int j = 0; j < stages; j++)
+         {
+            double tmp = old[j];
+            old[j] = gain * tmp + m;
+            m = tmp - gain * old[j];
+         }
+         fbout = m;
+
+         obuf[i] = (float) (outgain * (m * dryWet + in * (255 - dryWet)) / 255);
+      }
    }
 
+   std::copy(old, old + stages, data.old);
+   data.fbout = fbout;
+
    return blockLen;
 }
 
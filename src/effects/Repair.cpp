@@ -33,6 +33,10 @@ the audio, rather than actually finding the clicks.
 
 #include "Repair.h"
 
+// The most samples repaired at once.  InterpolateAudio takes time in
+// proportion to the length, but longer gaps are guessed less well.
+static const size_t MaxRepairLen = 4096;
+
 EffectRepair::EffectRepair()
 {
 }
@@ -90,8 +94,8 @@ bool EffectRepair::Process()
          const auto repair0 = track->TimeToLongSamples(repair_t0);
          const auto repair1 = track->TimeToLongSamples(repair_t1);
          const auto repairLen = repair1 - repair0;
-         if (repairLen > 128) {
-            ::Effect::MessageBox(_("The Repair effect is intended to be used on very short sections of damaged audio (up to 128 samples).\n\nZoom in and select a tiny fraction of a second to repair."));
+         if (repairLen > MaxRepairLen) {
+            ::Effect::MessageBox(wxString::Format(_("The Repair effect is intended to be used on short sections of damaged audio (up to %d samples).\n\nZoom in and select a fraction of a second to repair."), (int)MaxRepairLen));
             bGoodResult = false;
             break;
          }
@@ -103,7 +107,7 @@ bool EffectRepair::Process()
 
          const auto s0 = track->TimeToLongSamples(t0);
          const auto s1 = track->TimeToLongSamples(t1);
-         // The difference is at most 2 * 128:
+         // The difference is at most 2 * MaxRepairLen:
          const auto repairStart = (repair0 - s0).as_size_t();
          const auto len = s1 - s0;
 
@@ -115,10 +119,10 @@ bool EffectRepair::Process()
          }
 
          if (!ProcessOne(count, track, s0,
-                         // len is at most 5 * 128.
+                         // len is at most 5 * MaxRepairLen.
                          len.as_size_t(),
                          repairStart,
-                         // repairLen is at most 128.
+                         // repairLen is at most MaxRepairLen.
                          repairLen.as_size_t() )) {
             bGoodResult = false;
             break;
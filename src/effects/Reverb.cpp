@@ -82,6 +82,20 @@ struct Reverb_priv_t
    float *wet[2];
 };
 
+bool EffectReverb::Params::operator== (const Params &that) const
+{
+   return mRoomSize == that.mRoomSize &&
+      mPreDelay == that.mPreDelay &&
+      mReverberance == that.mReverberance &&
+      mHfDamping == that.mHfDamping &&
+      mToneLow == that.mToneLow &&
+      mToneHigh == that.mToneHigh &&
+      mWetGain == that.mWetGain &&
+      mDryGain == that.mDryGain &&
+      mStereoWidth == that.mStereoWidth &&
+      mWetOnly == that.mWetOnly;
+}
+
 //
 // EffectReverb
 //
@@ -152,6 +166,15 @@ EffectType EffectReverb::GetType()
    return EffectTypeProcess;
 }
 
+bool EffectReverb::SupportsRealtime()
+{
+#if defined(EXPERIMENTAL_REALTIME_AUDACITY_EFFECTS)
+   return true;
+#else
+   return false;
+#endif
+}
+
 // EffectClientInterface implementation
 
 unsigned EffectReverb::GetAudioInCount()
@@ -169,106 +192,87 @@ static size_t BLOCK = 16384;
 bool EffectReverb::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames chanMap)
 {
    bool isStereo = false;
-   mNumChans = 1;
    if (chanMap && chanMap[0] != ChannelNameEOL && chanMap[1] == ChannelNameFrontRight)
    {
       isStereo = true;
-      mNumChans = 2;
    }
 
-   mP = (Reverb_priv_t *) calloc(sizeof(*mP), mNumChans);
-
-   for (unsigned int i = 0; i < mNumChans; i++)
-   {
-      reverb_create(&mP[i].reverb,
-                    mSampleRate,
-                    mParams.mWetGain,
-                    mParams.mRoomSize,
-                    mParams.mReverberance,
-                    mParams.mHfDamping,
-                    mParams.mPreDelay,
-                    mParams.mStereoWidth * (isStereo ? 1 : 0),
-                    mParams.mToneLow,
-                    mParams.mToneHigh,
-                    BLOCK,
-                    mP[i].wet);
-   }
+   InstanceInit(mMaster, mSampleRate, isStereo ? 2 : 1);
 
    return true;
 }
 
 bool EffectReverb::ProcessFinalize()
 {
-   for (unsigned int i = 0; i < mNumChans; i++)
-   {
-      reverb_delete(&mP[i].reverb);
-   }
-
-   free(mP);
+   InstanceFinalize(mMaster);
 
    return true;
 }
 
 size_t EffectReverb::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
 {
-   float *ichans[2] = {NULL, NULL};
-   float *ochans[2] = {NULL, NULL};
+   return InstanceProcess(mMaster, inBlock, outBlock, blockLen);
+}
 
-   for (unsigned int c = 0; c < mNumChans; c++)
-   {
-      ichans[c] = inBlock[c];
-      ochans[c] = outBlock[c];
-   }
-   
-   float const dryMult = mParams.mWetOnly ? 0 : dB_to_linear(mParams.mDryGain);
+bool EffectReverb::RealtimeInitialize()
+{
+   SetBlockSize(512);
 
-   auto remaining = blockLen;
+   mSlaves.clear();
+   mSlaveParams = mParams;
 
-   while (remaining)
-   {
-      auto len = std::min(remaining, decltype(remaining)(BLOCK));
-      for (unsigned int c = 0; c < mNumChans; c++)
-      {
-         // Write the input samples to the reverb fifo.  Returned value is the address of the
-         // fifo buffer which contains a copy of the input samples.
-         mP[c].dry = (float *) fifo_write(&mP[c].reverb.input_fifo, len, ichans[c]);
-         reverb_process(&mP[c].reverb, len);
-      }
+   return true;
+}
 
-      if (mNumChans == 2)
-      {
-         for (decltype(len) i = 0; i < len; i++)
-         {
-            for (int w = 0; w < 2; w++)
-            {
-               ochans[w][i] = dryMult *
-                              mP[w].dry[i] +
-                              0.5 *
-                              (mP[0].wet[w][i] + mP[1].wet[w][i]);
-            }
-         }
-      }
-      else
-      {
-         for (decltype(len) i = 0; i < len; i++)
-         {
-            ochans[0][i] = dryMult * 
-                           mP[0].dry[i] +
-                           mP[0].wet[0][i];
-         }
-      }
+bool EffectReverb::RealtimeAddProcessor(unsigned numChannels, float sampleRate)
+{
+   EffectReverbState slave;
 
-      remaining -= len;
+   InstanceInit(slave, sampleRate, numChannels >= 2 ? 2 : 1);
+
+   mSlaves.push_back(slave);
+
+   return true;
+}
+
+bool EffectReverb::RealtimeFinalize()
+{
+   for (auto &slave : mSlaves)
+   {
+      InstanceFinalize(slave);
+   }
+   mSlaves.clear();
 
-      for (unsigned int c = 0; c < mNumChans; c++)
+   return true;
+}
+
+bool EffectReverb::RealtimeProcessStart()
+{
+   // The reverb is built from the parameters, so build it again when they
+   // change; the tail so far is lost
+   if (!(mParams == mSlaveParams))
+   {
+      mSlaveParams = mParams;
+      for (auto &slave : mSlaves)
       {
-         ichans[c] += len;
-         ochans[c] += len;
+         auto rate = slave.mRate;
+         auto numChans = slave.mNumChans;
+         InstanceFinalize(slave);
+         InstanceInit(slave, rate, numChans);
       }
    }
 
-   return blockLen;
+   return true;
 }
+
+size_t EffectReverb::RealtimeProcess(int group,
+                                     float **inbuf,
+                                     float **outbuf,
+                                     size_t numSamples)
+{
+   return InstanceProcess(mSlaves[group], inbuf, outbuf, numSamples);
+}
+
 bool EffectReverb::DefineParams( ShuttleParams & S ){
    S.SHUTTLE_PARAM( mParams.mRoomSize,       RoomSize );
    S.SHUTTLE_PARAM( mParams.mPreDelay,       PreDelay );
@@ -537,6 +541,109 @@ SpinSliderHandlers(StereoWidth)
 
 #undef SpinSliderHandlers
 
+// EffectReverb implementation
+
+void EffectReverb::InstanceInit(EffectReverbState & data, double sampleRate, unsigned numChans)
+{
+   data.mRate = sampleRate;
+   data.mNumChans = numChans;
+   data.mDryMult = mParams.mWetOnly ? 0 : dB_to_linear(mParams.mDryGain);
+
+   data.mP = (Reverb_priv_t *) calloc(sizeof(*data.mP), numChans);
+
+   for (unsigned int i = 0; i < numChans; i++)
+   {
+      reverb_create(&data.mP[i].reverb,
+                    sampleRate,
+                    mParams.mWetGain,
+                    mParams.mRoomSize,
+                    mParams.mReverberance,
+                    mParams.mHfDamping,
+                    mParams.mPreDelay,
+                    mParams.mStereoWidth * (numChans == 2 ? 1 : 0),
+                    mParams.mToneLow,
+                    mParams.mToneHigh,
+                    BLOCK,
+                    data.mP[i].wet);
+   }
+}
+
+void EffectReverb::InstanceFinalize(EffectReverbState & data)
+{
+   for (unsigned int i = 0; i < data.mNumChans; i++)
+   {
+      reverb_delete(&data.mP[i].reverb);
+   }
+
+   free(data.mP);
+   data.mP = NULL;
+   data.mNumChans = 0;
+}
+
+// The reverb's output does not depend on how its input is divided into
+// blocks, so that playing it in real time sounds as the effect applied does
+size_t EffectReverb::InstanceProcess(EffectReverbState & data, float **inBlock, float **outBlock, size_t blockLen)
+{
+   Reverb_priv_t *const priv = data.mP;
+   float *ichans[2] = {NULL, NULL};
+   float *ochans[2] = {NULL, NULL};
+
+   for (unsigned int c = 0; c < data.mNumChans; c++)
+   {
+      ichans[c] = inBlock[c];
+      ochans[c] = outBlock[c];
+   }
+
+   float const dryMult = data.mDryMult;
+
+   auto remaining = blockLen;
+
+   while (remaining)
+   {
+      auto len = std::min(remaining, decltype(remaining)(BLOCK));
+      for (unsigned int c = 0; c < data.mNumChans; c++)
+      {
+         // Write the input samples to the reverb fifo.  Returned value is the address of the
+         // fifo buffer which contains a copy of the input samples.
+         priv[c].dry = (float *) fifo_write(&priv[c].reverb.input_fifo, len, ichans[c]);
+         reverb_process(&priv[c].reverb, len);
+      }
+
+      if (data.mNumChans == 2)
+      {
+         for (decltype(len) i = 0; i < len; i++)
+         {
+            for (int w = 0; w < 2; w++)
+            {
+               ochans[w][i] = dryMult *
+                              priv[w].dry[i] +
+                              0.5 *
+                              (priv[0].wet[w][i] + priv[1].wet[w][i]);
+            }
+         }
+      }
+      else
+      {
+         for (decltype(len) i = 0; i < len; i++)
+         {
+            ochans[0][i] = dryMult * 
+                           priv[0].dry[i] +
+                           priv[0].wet[0][i];
+         }
+      }
+
+      remaining -= len;
+
+      for (unsigned int c = 0; c < data.mNumChans; c++)
+      {
+         ichans[c] += len;
+         ochans[c] += len;
+      }
+   }
+
+   return blockLen;
+}
+
 void EffectReverb::SetTitle(const wxString & name)
 {
    wxString title(_("Reverb"));
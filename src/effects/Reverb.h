@@ -18,6 +18,8 @@
 #include <wx/spinctrl.h>
 #include <wx/string.h>
 
+#include <vector>
+
 #include "Effect.h"
 
 class ShuttleGui;
@@ -26,6 +28,15 @@ class ShuttleGui;
 
 struct Reverb_priv_t;
 
+class EffectReverbState
+{
+public:
+   double mRate {};
+   unsigned mNumChans {};
+   float mDryMult {};
+   Reverb_priv_t *mP {};
+};
+
 class EffectReverb final : public Effect
 {
 public:
@@ -44,6 +55,8 @@ public:
       double mDryGain;
       double mStereoWidth;
       bool mWetOnly;
+
+      bool operator== (const Params &that) const;
    };
 
    // IdentInterface implementation
@@ -55,6 +68,7 @@ public:
    // EffectDefinitionInterface implementation
 
    EffectType GetType() override;
+   bool SupportsRealtime() override;
 
    // EffectClientInterface implementation
 
@@ -63,6 +77,14 @@ public:
    bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    bool ProcessFinalize() override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
+   bool RealtimeInitialize() override;
+   bool RealtimeAddProcessor(unsigned numChannels, float sampleRate) override;
+   bool RealtimeFinalize() override;
+   bool RealtimeProcessStart() override;
+   size_t RealtimeProcess(int group,
+                          float **inbuf,
+                          float **outbuf,
+                          size_t numSamples) override;
    bool DefineParams( ShuttleParams & S ) override;
    bool GetAutomationParameters(CommandParameters & parms) override;
    bool SetAutomationParameters(CommandParameters & parms) override;
@@ -79,6 +101,10 @@ public:
 private:
    // EffectReverb implementation
 
+   void InstanceInit(EffectReverbState & data, double sampleRate, unsigned numChans);
+   size_t InstanceProcess(EffectReverbState & data, float **inBlock, float **outBlock, size_t blockLen);
+   void InstanceFinalize(EffectReverbState & data);
+
    void SetTitle(const wxString & name = wxT(""));
 
 #define SpinSliderHandlers(n) \
@@ -98,8 +124,10 @@ private:
 #undef SpinSliderHandlers
 
 private:
-   unsigned mNumChans {};
-   Reverb_priv_t *mP;
+   EffectReverbState mMaster;
+   std::vector<EffectReverbState> mSlaves;
+   // The parameters the slaves were made with
+   Params mSlaveParams;
 
    Params mParams;
 
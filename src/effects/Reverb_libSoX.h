@@ -23,6 +23,13 @@
 using std::min;
 using std::max;
 
+// SSE2 is part of every x86-64 processor, so no run time test is needed
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REVERB_SSE2
+#include <emmintrin.h>
+#endif
+
 #define array_length(a) (sizeof(a)/sizeof(a[0]))
 #define dB_to_linear(x) exp((x) * M_LN10 * 0.05)
 #define midi_to_freq(n) (440 * pow(2,((n)-69)/12.))
@@ -30,7 +37,7 @@ using std::max;
 #define FIFO_MIN 0x4000
 #define fifo_read_ptr(f) fifo_read(f, (FIFO_SIZE_T)0, NULL)
 #define lsx_zalloc(var, n) var = (float *)calloc(n, sizeof(*var))
-#define filter_advance(p) if (--(p)->ptr < (p)->buffer) (p)->ptr += (p)->size
+#define filter_advance(p, n) if (((p)->ptr += (n)) == (p)->buffer + (p)->size) (p)->ptr = (p)->buffer
 #define filter_delete(p) free((p)->buffer)
 
 typedef struct {
@@ -110,23 +117,120 @@ typedef struct {
    float   store;
 } filter_t;
 
-static float comb_process(filter_t * p,  /* gcc -O2 will inline this */
-      float const * input, float const * feedback, float const * hf_damping)
+static const size_t /* Filter delay lengths in samples (44100Hz sample-rate) */
+   comb_lengths[] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617},
+   allpass_lengths[] = {225, 341, 441, 556}, stereo_adjust = 12;
+
+/* Filters process blocks of samples, no longer than any filter, so that no
+ * sample a filter reads in a block was written in it.  The pointers of the
+ * filters move forward. */
+#define block_max 64
+
+/* The combs run side by side, as the lanes of vectors, four samples at a
+ * time.  Each lane computes just what one comb did when they ran one at a
+ * time, and the lanes are summed in the same order, so that the output does
+ * not change, nor depend on how the input is divided.  No comb's pointer may
+ * reach the end of its buffer within the n samples, so that each comb reads
+ * and writes one run in place. */
+#define comb_lanes array_length(comb_lengths)
+
+static void comb_bank_process(filter_t * comb, size_t n,
+      float const * input, float * output, float feedback, float hf_damping)
 {
-   float output = *p->ptr;
-   p->store = output + (p->store - output) * *hf_damping;
-   *p->ptr = *input + p->store * *feedback;
-   filter_advance(p);
-   return output;
+   float * rows[comb_lanes];
+   float store[comb_lanes];
+   size_t i, t = 0;
+
+   for (i = 0; i < comb_lanes; ++i)
+      rows[i] = comb[i].ptr, store[i] = comb[i].store;
+
+#ifdef REVERB_SSE2
+   {
+      __m128 const fb = _mm_set1_ps(feedback), damping = _mm_set1_ps(hf_damping);
+      __m128 s[comb_lanes / 4];
+      size_t g;
+
+      for (g = 0; g < comb_lanes / 4; ++g)
+         s[g] = _mm_loadu_ps(store + 4 * g);
+      for (; t + 4 <= n; t += 4) {
+         __m128 const in = _mm_loadu_ps(input + t);
+         __m128 const in0 = _mm_shuffle_ps(in, in, _MM_SHUFFLE(0, 0, 0, 0));
+         __m128 const in1 = _mm_shuffle_ps(in, in, _MM_SHUFFLE(1, 1, 1, 1));
+         __m128 const in2 = _mm_shuffle_ps(in, in, _MM_SHUFFLE(2, 2, 2, 2));
+         __m128 const in3 = _mm_shuffle_ps(in, in, _MM_SHUFFLE(3, 3, 3, 3));
+         __m128 sum = _mm_setzero_ps();
+
+         /* From the last comb to the first, as they were summed */
+         g = comb_lanes / 4;
+         while (g--) {
+            float * const * row = rows + 4 * g;
+            /* Four samples of each of four combs */
+            __m128 d0 = _mm_loadu_ps(row[0] + t), d1 = _mm_loadu_ps(row[1] + t);
+            __m128 d2 = _mm_loadu_ps(row[2] + t), d3 = _mm_loadu_ps(row[3] + t);
+            __m128 w0, w1, w2, w3;
+
+            sum = _mm_add_ps(sum, d3);
+            sum = _mm_add_ps(sum, d2);
+            sum = _mm_add_ps(sum, d1);
+            sum = _mm_add_ps(sum, d0);
+
+            /* Now each holds one sample of the four */
+            _MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+#define comb_lane_step(d, in, w) \
+            s[g] = _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(s[g], d), damping)); \
+            w = _mm_add_ps(in, _mm_mul_ps(s[g], fb))
+            comb_lane_step(d0, in0, w0);
+            comb_lane_step(d1, in1, w1);
+            comb_lane_step(d2, in2, w2);
+            comb_lane_step(d3, in3, w3);
+#undef comb_lane_step
+            _MM_TRANSPOSE4_PS(w0, w1, w2, w3);
+
+            _mm_storeu_ps(row[0] + t, w0), _mm_storeu_ps(row[1] + t, w1);
+            _mm_storeu_ps(row[2] + t, w2), _mm_storeu_ps(row[3] + t, w3);
+         }
+         _mm_storeu_ps(output + t, sum);
+      }
+      for (g = 0; g < comb_lanes / 4; ++g)
+         _mm_storeu_ps(store + 4 * g, s[g]);
+   }
+#endif
+
+   for (; t < n; ++t) {
+      float out = 0, in = input[t];
+
+      i = comb_lanes - 1;
+      do {
+         float const delayed = rows[i][t];
+         store[i] = delayed + (store[i] - delayed) * hf_damping;
+         rows[i][t] = in + store[i] * feedback;
+         out += delayed;
+      } while (i--);
+      output[t] = out;
+   }
+
+   for (i = 0; i < comb_lanes; ++i) {
+      comb[i].store = store[i];
+      filter_advance(comb + i, n);
+   }
 }
 
-static float allpass_process(filter_t * p,  /* gcc -O2 will inline this */
-      float const * input)
+/* In place, over n samples */
+static void allpass_process(filter_t * p, size_t n, float * data)
 {
-   float output = *p->ptr;
-   *p->ptr = *input + output * .5;
-   filter_advance(p);
-   return output - *input;
+   while (n) {
+      size_t m = min(n, (size_t)(p->buffer + p->size - p->ptr)), t;
+      float * ptr = p->ptr;
+
+      for (t = 0; t < m; ++t) {
+         float output = ptr[t];
+         ptr[t] = data[t] + output * .5;
+         data[t] = output - data[t];
+      }
+      filter_advance(p, m);
+      data += m;
+      n -= m;
+   }
 }
 
 typedef struct {double b0, b1, a1, i1, o1;} one_pole_t;
@@ -138,10 +242,6 @@ static float one_pole_process(one_pole_t * p, float i0)
    return p->o1 = o0;
 }
 
-static const size_t /* Filter delay lengths in samples (44100Hz sample-rate) */
-   comb_lengths[] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617},
-   allpass_lengths[] = {225, 341, 441, 556}, stereo_adjust = 12;
-
 typedef struct {
    filter_t comb   [array_length(comb_lengths)];
    filter_t allpass[array_length(allpass_lengths)];
@@ -157,13 +257,13 @@ static void filter_array_create(filter_array_t * p, double rate,
    for (i = 0; i < array_length(comb_lengths); ++i, offset = -offset)
    {
       filter_t * pcomb = &p->comb[i];
-      pcomb->size = (size_t)(scale * r * (comb_lengths[i] + stereo_adjust * offset) + .5);
+      pcomb->size = max((size_t)1, (size_t)(scale * r * (comb_lengths[i] + stereo_adjust * offset) + .5));
       pcomb->ptr = lsx_zalloc(pcomb->buffer, pcomb->size);
    }
    for (i = 0; i < array_length(allpass_lengths); ++i, offset = -offset)
    {
       filter_t * pallpass = &p->allpass[i];
-      pallpass->size = (size_t)(r * (allpass_lengths[i] + stereo_adjust * offset) + .5);
+      pallpass->size = max((size_t)1, (size_t)(r * (allpass_lengths[i] + stereo_adjust * offset) + .5));
       pallpass->ptr = lsx_zalloc(pallpass->buffer, pallpass->size);
    }
    { /* EQ: highpass */
@@ -182,20 +282,34 @@ static void filter_array_process(filter_array_t * p,
       size_t length, float const * input, float * output,
       float const * feedback, float const * hf_damping, float const * gain)
 {
-   while (length--) {
-      float out = 0, in = *input++;
+   float out[block_max];
+   size_t block = block_max, i, t;
 
-      size_t i = array_length(comb_lengths) - 1;
-      do out += comb_process(p->comb + i, &in, feedback, hf_damping);
-      while (i--);
+   for (i = 0; i < array_length(comb_lengths); ++i)
+      block = min(block, p->comb[i].size);
+   for (i = 0; i < array_length(allpass_lengths); ++i)
+      block = min(block, p->allpass[i].size);
+
+   while (length) {
+      size_t n = min(block, length);
+      for (i = 0; i < array_length(comb_lengths); ++i)
+         n = min(n, (size_t)(p->comb[i].buffer + p->comb[i].size - p->comb[i].ptr));
+
+      comb_bank_process(p->comb, n, input, out, *feedback, *hf_damping);
 
       i = array_length(allpass_lengths) - 1;
-      do out = allpass_process(p->allpass + i, &out);
+      do allpass_process(p->allpass + i, n, out);
       while (i--);
 
-      out = one_pole_process(&p->one_pole[0], out);
-      out = one_pole_process(&p->one_pole[1], out);
-      *output++ = out * *gain;
+      for (t = 0; t < n; ++t) {
+         float o = one_pole_process(&p->one_pole[0], out[t]);
+         o = one_pole_process(&p->one_pole[1], o);
+         output[t] = o * *gain;
+      }
+
+      input += n;
+      output += n;
+      length -= n;
    }
 }
 
@@ -22,6 +22,7 @@
 #include <wx/intl.h>
 
 #include "../LabelTrack.h"
+#include "../Sequence.h"
 #include "../WaveTrack.h"
 
 //
@@ -217,6 +218,20 @@ bool EffectReverse::ProcessOneClip(int count, WaveTrack *track,
                                sampleCount originalStart, sampleCount originalEnd)
 {
    bool rc = true;
+
+   auto originalLen = originalEnd - originalStart;
+
+   // The splits made before give whole clips, which are reversed block by
+   // block, writing each once, and none that are silent
+   auto clip = track->GetClipAtSample(start);
+   if (clip && clip->GetStartSample() == start &&
+       clip->GetNumSamples() == len) {
+      clip->GetSequence()->Reverse();
+      clip->MarkChanged();
+      return !TrackProgress(count, ( start + len - originalStart ).as_double() /
+                            originalLen.as_double());
+   }
+
    // keep track of two blocks whose data we will swap
    auto first = start;
 
@@ -225,8 +240,6 @@ bool EffectReverse::ProcessOneClip(int count, WaveTrack *track,
    Floats buffer1{ blockSize };
    Floats buffer2{ blockSize };
 
-   auto originalLen = originalEnd - originalStart;
-
    while (len > 1) {
       auto block =
          limitSampleBufferSize( track->GetBestBlockSize(first), len / 2 );
@@ -16,6 +16,8 @@ effect that uses SBSMS to do its processing (TimeScale)
 #if USE_SBSMS
 
 #include <math.h>
+#include <functional>
+#include <vector>
 
 #include "SBSMSEffect.h"
 #include "../LabelTrack.h"
@@ -210,6 +212,76 @@ double EffectSBSMS::getRate(double rateStart, double rateEnd, SlideType slideTyp
    return slide.getRate(t);
 }
 
+namespace {
+
+// A mono track or stereo pair, which is set up and pasted back on the main
+// thread, but may be stretched on another, alongside other pairs
+struct SBSMSGroup
+{
+   // Each group has its own, because slides keep state.  They are used
+   // by rb, so must outlive it
+   std::unique_ptr<Slide> rateSlide;
+   std::unique_ptr<Slide> pitchSlide;
+   ResampleBuf rb;
+   std::unique_ptr<Resampler> resampler;
+   WaveTrack *leftTrack;
+   WaveTrack *rightTrack;
+   double t0, t1;
+   int trackNum;
+   sampleCount samplesOut;
+   std::unique_ptr<TimeWarper> warper;
+};
+
+// Returns false if progress reports cancellation
+bool StretchGroup(SBSMSGroup &group,
+                  const std::function<bool(double)> &progress)
+{
+   auto &rb = group.rb;
+   const auto samplesOut = group.samplesOut;
+
+   audio outBuf[SBSMSOutBlockSize];
+   float outBufLeft[2*SBSMSOutBlockSize];
+   float outBufRight[2*SBSMSOutBlockSize];
+
+   long pos = 0;
+   long outputCount = -1;
+
+   // process
+   while(pos<samplesOut && outputCount) {
+      const auto frames =
+         limitSampleBufferSize( SBSMSOutBlockSize, samplesOut - pos );
+
+      outputCount = group.resampler->read(outBuf,frames);
+      for(int i = 0; i < outputCount; i++) {
+         outBufLeft[i] = outBuf[i][0];
+         if(group.rightTrack)
+            outBufRight[i] = outBuf[i][1];
+      }
+      pos += outputCount;
+      rb.outputLeftTrack->Append((samplePtr)outBufLeft, floatSample, outputCount);
+      if(group.rightTrack)
+         rb.outputRightTrack->Append((samplePtr)outBufRight, floatSample, outputCount);
+
+      if (progress((double)pos / samplesOut.as_double()))
+         return false;
+   }
+
+   {
+      auto pException = rb.mpException;
+      rb.mpException = {};
+      if (pException)
+         std::rethrow_exception(pException);
+   }
+
+   rb.outputLeftTrack->Flush();
+   if(group.rightTrack)
+      rb.outputRightTrack->Flush();
+
+   return true;
+}
+
+}
+
 bool EffectSBSMS::Process()
 {
    bool bGoodResult = true;
@@ -226,9 +298,11 @@ bool EffectSBSMS::Process()
    // Must sync if selection length will change
    bool mustSync = (rateStart != rateEnd);
    Slide rateSlide(rateSlideType,rateStart,rateEnd);
-   Slide pitchSlide(pitchSlideType,pitchStart,pitchEnd);
    mTotalStretch = rateSlide.getTotalStretch();
 
+   // Set up all of the groups first, then stretch them at once
+   std::vector< std::unique_ptr<SBSMSGroup> > groups;
+
    t = iter.First();
    while (bGoodResult && t != NULL) {
       if (t->GetKind() == Track::Label &&
@@ -286,8 +360,20 @@ bool EffectSBSMS::Process()
             float srTrack = leftTrack->GetRate();
             float srProcess = bLinkRatePitch ? srTrack : 44100.0;
 
+            groups.push_back(std::make_unique<SBSMSGroup>());
+            auto &group = *groups.back();
+            group.leftTrack = leftTrack;
+            group.rightTrack = rightTrack;
+            group.t0 = mCurT0;
+            group.t1 = mCurT1;
+            group.trackNum = mCurTrackNum;
+            group.rateSlide =
+               std::make_unique<Slide>(rateSlideType,rateStart,rateEnd);
+            group.pitchSlide =
+               std::make_unique<Slide>(pitchSlideType,pitchStart,pitchEnd);
+
             // the resampler needs a callback to supply its samples
-            ResampleBuf rb;
+            ResampleBuf &rb = group.rb;
             auto maxBlockSize = leftTrack->GetMaxBlockSize();
             rb.blockSize = maxBlockSize;
             rb.buf.reinit(rb.blockSize, true);
@@ -316,7 +402,8 @@ bool EffectSBSMS::Process()
                              sizeof(_sbsms_::SampleCountType),
                              "Type _sbsms_::SampleCountType is too narrow to hold a sampleCount");
               rb.iface = std::make_unique<SBSMSInterfaceSliding>
-                  (&rateSlide, &pitchSlide, bPitchReferenceInput,
+                  (group.rateSlide.get(), group.pitchSlide.get(),
+                   bPitchReferenceInput,
                    static_cast<_sbsms_::SampleCountType>
                       ( samplesToProcess.as_long_long() ),
                    0, nullptr);
@@ -348,8 +435,8 @@ bool EffectSBSMS::Process()
               rb.offset = start - trackPresamples;
               rb.end = trackEnd;
               rb.iface = std::make_unique<SBSMSEffectInterface>
-                  (rb.resampler.get(), &rateSlide, &pitchSlide,
-                   bPitchReferenceInput,
+                  (rb.resampler.get(), group.rateSlide.get(),
+                   group.pitchSlide.get(), bPitchReferenceInput,
                    // UNSAFE_SAMPLE_COUNT_TRUNCATION
                    // The argument type is only long!
                    static_cast<long> ( samplesToProcess.as_long_long() ),
@@ -358,17 +445,14 @@ bool EffectSBSMS::Process()
                    rb.quality.get());
             }
             
-            Resampler resampler(outResampleCB,&rb,outSlideType);
-
-            audio outBuf[SBSMSOutBlockSize];
-            float outBufLeft[2*SBSMSOutBlockSize];
-            float outBufRight[2*SBSMSOutBlockSize];
+            group.resampler =
+               std::make_unique<Resampler>(outResampleCB,&rb,outSlideType);
 
             // Samples in output after SBSMS
             sampleCount samplesToOutput = rb.iface->getSamplesToOutput();
 
             // Samples in output after resampling back
-            auto samplesOut = (sampleCount) (samplesToOutput.as_float() * (srTrack/srProcess));
+            group.samplesOut = (sampleCount) (samplesToOutput.as_float() * (srTrack/srProcess));
 
             // Duration in track time
             double duration =  (mCurT1-mCurT0) * mTotalStretch;
@@ -376,36 +460,32 @@ bool EffectSBSMS::Process()
             if(duration > maxDuration)
                maxDuration = duration;
 
-            auto warper = createTimeWarper(mCurT0,mCurT1,maxDuration,rateStart,rateEnd,rateSlideType);
+            group.warper = createTimeWarper(mCurT0,mCurT1,maxDuration,rateStart,rateEnd,rateSlideType);
 
             rb.outputLeftTrack = mFactory->NewWaveTrack(leftTrack->GetSampleFormat(),
                                                         leftTrack->GetRate());
             if(rightTrack)
                rb.outputRightTrack = mFactory->NewWaveTrack(rightTrack->GetSampleFormat(),
                                                             rightTrack->GetRate());
-            long pos = 0;
-            long outputCount = -1;
-
-            // process
-            while(pos<samplesOut && outputCount) {
-               const auto frames =
-                  limitSampleBufferSize( SBSMSOutBlockSize, samplesOut - pos );
-
-               outputCount = resampler.read(outBuf,frames);
-               for(int i = 0; i < outputCount; i++) {
-                  outBufLeft[i] = outBuf[i][0];
-                  if(rightTrack)
-                     outBufRight[i] = outBuf[i][1];
-               }
-               pos += outputCount;
-               rb.outputLeftTrack->Append((samplePtr)outBufLeft, floatSample, outputCount);
-               if(rightTrack)
-                  rb.outputRightTrack->Append((samplePtr)outBufRight, floatSample, outputCount);
-
-               double frac = (double)pos / samplesOut.as_double();
-               int nWhichTrack = mCurTrackNum;
-               if(rightTrack) {
-                  nWhichTrack = 2*(mCurTrackNum/2);
+         }
+         mCurTrackNum++;
+      }
+      else if (mustSync && t->IsSyncLockSelected())
+      {
+         t->SyncLockAdjust(mCurT1, mCurT0 + (mCurT1 - mCurT0) * mTotalStretch);
+      }
+      //Iterate to the next track
+      t = iter.Next();
+   }
+
+   if (bGoodResult) {
+      if (groups.size() < 2) {
+         for (auto &pGroup : groups) {
+            const auto &group = *pGroup;
+            auto progress = [&](double frac) {
+               int nWhichTrack = group.trackNum;
+               if(group.rightTrack) {
+                  nWhichTrack = 2*(group.trackNum/2);
                   if (frac < 0.5)
                      frac *= 2.0; // Show twice as far for each track, because we're doing 2 at once.
                   else {
@@ -414,42 +494,35 @@ bool EffectSBSMS::Process()
                      frac *= 2.0; // Show twice as far for each track, because we're doing 2 at once.
                   }
                }
-               if (TrackProgress(nWhichTrack, frac))
-                  return false;
-            }
-
-            {
-               auto pException = rb.mpException;
-               rb.mpException = {};
-               if (pException)
-                  std::rethrow_exception(pException);
-            }
-
-            if (bGoodResult) {
-               rb.outputLeftTrack->Flush();
-               if(rightTrack)
-                  rb.outputRightTrack->Flush();
-
-               leftTrack->ClearAndPaste(mCurT0, mCurT1, rb.outputLeftTrack.get(),
-                                        true, false, warper.get());
-
-               if(rightTrack)
-                  rightTrack->ClearAndPaste(mCurT0, mCurT1, rb.outputRightTrack.get(),
-                                            true, false, warper.get());
-            }
+               return TrackProgress(nWhichTrack, frac);
+            };
+            if (!StretchGroup(*pGroup, progress))
+               return false;
          }
-         mCurTrackNum++;
       }
-      else if (mustSync && t->IsSyncLockSelected())
-      {
-         t->SyncLockAdjust(mCurT1, mCurT0 + (mCurT1 - mCurT0) * mTotalStretch);
+      else {
+         // The groups are independent until pasted back
+         auto body = [&](size_t ii, const ConcurrentProgress &progress) {
+            StretchGroup(*groups[ii], progress);
+         };
+         if (!ParallelForWithProgress(groups.size(), body))
+            return false;
       }
-      //Iterate to the next track
-      t = iter.Next();
    }
 
-   if (bGoodResult)
+   if (bGoodResult) {
+      for (auto &pGroup : groups) {
+         auto &group = *pGroup;
+         group.leftTrack->ClearAndPaste(group.t0, group.t1,
+            group.rb.outputLeftTrack.get(), true, false, group.warper.get());
+
+         if(group.rightTrack)
+            group.rightTrack->ClearAndPaste(group.t0, group.t1,
+               group.rb.outputRightTrack.get(), true, false, group.warper.get());
+      }
+
       ReplaceProcessedTracks(bGoodResult);
+   }
 
    // Update selection
    mT0 = mCurT0;
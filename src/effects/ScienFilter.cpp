@@ -217,12 +217,14 @@ unsigned EffectScienFilter::GetAudioOutCount()
 
 bool EffectScienFilter::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames WXUNUSED(chanMap))
 {
+   // SetSections() also resets the state
+   mCascade.SetSections((mOrder + 1) / 2);
    for (int iPair = 0; iPair < (mOrder + 1) / 2; iPair++)
    {
-      mpBiquad[iPair].fPrevIn = 0;
-      mpBiquad[iPair].fPrevPrevIn = 0;
-      mpBiquad[iPair].fPrevOut = 0;
-      mpBiquad[iPair].fPrevPrevOut = 0;
+      const BiquadStruct &bq = mpBiquad[iPair];
+      mCascade.SetSection(iPair,
+         bq.fNumerCoeffs[0], bq.fNumerCoeffs[1], bq.fNumerCoeffs[2],
+         bq.fDenomCoeffs[0], bq.fDenomCoeffs[1]);
    }
 
    return true;
@@ -230,14 +232,7 @@ bool EffectScienFilter::ProcessInitialize(sampleCount WXUNUSED(totalLen), Channe
 
 size_t EffectScienFilter::ProcessBlock(float **inBlock, float **outBlock, size_t blockLen)
 {
-   float *ibuf = inBlock[0];
-   for (int iPair = 0; iPair < (mOrder + 1) / 2; iPair++)
-   {
-      mpBiquad[iPair].pfIn = ibuf;
-      mpBiquad[iPair].pfOut = outBlock[0];
-      Biquad_Process(&mpBiquad[iPair], blockLen);
-      ibuf = outBlock[0];
-   }
+   mCascade.Process(inBlock[0], outBlock[0], blockLen);
 
    return blockLen;
 }
@@ -103,6 +103,7 @@ private:
    int mOrder;
    int mOrderIndex;
    ArrayOf<BiquadStruct> mpBiquad;
+   BiquadCascade mCascade;
 
    double mdBMax;
    double mdBMin;
@@ -17,6 +17,7 @@ effect that uses SoundTouch to do its processing (ChangeTempo
 #if USE_SOUNDTOUCH
 
 #include <math.h>
+#include <vector>
 
 #include "../LabelTrack.h"
 #include "../WaveTrack.h"
@@ -25,6 +26,27 @@ effect that uses SoundTouch to do its processing (ChangeTempo
 #include "TimeWarper.h"
 #include "../NoteTrack.h"
 
+namespace {
+
+// Samples fed to SoundTouch at a time, per channel, in units of the track's
+// maximum block size; fewer calls mean less overhead in its FIFOs
+const size_t FeedBlocks = 4;
+
+// One mono track or stereo pair, stretched independently of the others
+struct SoundTouchGroup
+{
+   WaveTrack *leftTrack{};
+   WaveTrack *rightTrack{};
+   sampleCount start, end;
+   double t0, t1;
+   int trackNum;
+   std::unique_ptr<SoundTouch> soundTouch;
+   WaveTrack::Holder outputLeftTrack;
+   WaveTrack::Holder outputRightTrack;
+};
+
+}
+
 bool EffectSoundTouch::ProcessLabelTrack(
    LabelTrack *lt, const TimeWarper &warper)
 {
@@ -43,11 +65,11 @@ bool EffectSoundTouch::ProcessNoteTrack(NoteTrack *nt, const TimeWarper &warper)
 }
 #endif
 
-bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
+bool EffectSoundTouch::ProcessWithTimeWarper(
+   const InitFunction &initer, const TimeWarper &warper)
 {
-   // Assumes that mSoundTouch has already been initialized
-   // by the subclass for subclass-specific parameters. The
-   // time warper should also be set.
+   // The initer sets the subclass-specific parameters of each of the
+   // SoundTouch objects.
 
    // Check if this effect will alter the selection length; if so, we need
    // to operate on sync-lock selected tracks.
@@ -66,6 +88,9 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
    mCurTrackNum = 0;
    m_maxNewLength = 0.0;
 
+   // First find the wave tracks to stretch, and warp the others
+   std::vector<SoundTouchGroup> groups;
+
    t = iter.First();
    while (t != NULL) {
       if (t->GetKind() == Track::Label &&
@@ -102,11 +127,15 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
 
          // Process only if the right marker is to the right of the left marker
          if (mCurT1 > mCurT0) {
+            SoundTouchGroup group;
+            group.leftTrack = leftTrack;
+            group.trackNum = mCurTrackNum;
 
             if (leftTrack->GetLinked()) {
                double t;
                // Assume linked track is wave
                WaveTrack* rightTrack = static_cast<WaveTrack*>(iter.Next());
+               group.rightTrack = rightTrack;
 
                //Adjust bounds by the right tracks markers
                t = rightTrack->GetStartTime();
@@ -116,35 +145,31 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
                t = wxMin(mT1, t);
                mCurT1 = wxMax(mCurT1, t);
 
-               //Transform the marker timepoints to samples
-               auto start = leftTrack->TimeToLongSamples(mCurT0);
-               auto end = leftTrack->TimeToLongSamples(mCurT1);
-
-               //Inform soundtouch there's 2 channels
-               mSoundTouch->setChannels(2);
-
-               //ProcessStereo() (implemented below) processes a stereo track
-               if (!ProcessStereo(leftTrack, rightTrack, start, end, warper))
-               {
-                  bGoodResult = false;
-                  break;
-               }
                mCurTrackNum++; // Increment for rightTrack, too.
-            } else {
-               //Transform the marker timepoints to samples
-               auto start = leftTrack->TimeToLongSamples(mCurT0);
-               auto end = leftTrack->TimeToLongSamples(mCurT1);
-
-               //Inform soundtouch there's a single channel
-               mSoundTouch->setChannels(1);
-
-               //ProcessOne() (implemented below) processes a single track
-               if (!ProcessOne(leftTrack, start, end, warper))
-               {
-                  bGoodResult = false;
-                  break;
-               }
             }
+
+            //Transform the marker timepoints to samples
+            group.start = leftTrack->TimeToLongSamples(mCurT0);
+            group.end = leftTrack->TimeToLongSamples(mCurT1);
+            group.t0 = mCurT0;
+            group.t1 = mCurT1;
+
+            // Each group has its own SoundTouch, so that they can run at once
+            group.soundTouch = std::make_unique<SoundTouch>();
+            initer(group.soundTouch.get());
+            //Inform soundtouch how many channels there are
+            group.soundTouch->setChannels(group.rightTrack ? 2 : 1);
+            group.soundTouch->setSampleRate(
+               (unsigned int)(leftTrack->GetRate() + 0.5));
+
+            group.outputLeftTrack = mFactory->NewWaveTrack(
+               leftTrack->GetSampleFormat(), leftTrack->GetRate());
+            if (group.rightTrack)
+               group.outputRightTrack = mFactory->NewWaveTrack(
+                  group.rightTrack->GetSampleFormat(),
+                  group.rightTrack->GetRate());
+
+            groups.push_back(std::move(group));
          }
          mCurTrackNum++;
       }
@@ -156,8 +181,69 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
       t = iter.Next();
    }
 
-   if (bGoodResult)
+   if (bGoodResult) {
+      const auto processGroup =
+      [this](SoundTouchGroup &group, const ConcurrentProgress &progress) {
+         if (group.rightTrack)
+            //ProcessStereo() (implemented below) processes a stereo track
+            return ProcessStereo(*group.soundTouch,
+               group.leftTrack, group.rightTrack, group.start, group.end,
+               group.outputLeftTrack.get(), group.outputRightTrack.get(),
+               progress);
+         else
+            //ProcessOne() (implemented below) processes a single track
+            return ProcessOne(*group.soundTouch,
+               group.leftTrack, group.start, group.end,
+               group.outputLeftTrack.get(), progress);
+      };
+
+      if (groups.size() < 2) {
+         // Nothing to gain from the threads; show progress by track as before
+         for (auto &group : groups) {
+            const auto progress = [&](double frac) {
+               if (!group.rightTrack)
+                  return TrackProgress(group.trackNum, frac);
+               // Show twice as far for each track, because we're doing 2
+               // at once.
+               if (frac < 0.5)
+                  return TrackProgress(group.trackNum, frac * 2.0);
+               return TrackProgress(group.trackNum + 1, (frac - 0.5) * 2.0);
+            };
+            if (!processGroup(group, progress)) {
+               bGoodResult = false;
+               break;
+            }
+         }
+      }
+      else {
+         // The groups are independent until pasted back
+         auto body = [&](size_t ii, const ConcurrentProgress &progress) {
+            processGroup(groups[ii], progress);
+         };
+         bGoodResult = ParallelForWithProgress(groups.size(), body);
+      }
+   }
+
+   if (bGoodResult) {
+      // Take the output tracks and insert them in place of the original
+      // sample data, in track order
+      for (auto &group : groups) {
+         group.leftTrack->ClearAndPaste(group.t0, group.t1,
+            group.outputLeftTrack.get(), true, false, &warper);
+         // Track the longest result length
+         m_maxNewLength =
+            wxMax(m_maxNewLength, group.outputLeftTrack->GetEndTime());
+
+         if (group.rightTrack) {
+            group.rightTrack->ClearAndPaste(group.t0, group.t1,
+               group.outputRightTrack.get(), true, false, &warper);
+            m_maxNewLength =
+               wxMax(m_maxNewLength, group.outputRightTrack->GetEndTime());
+         }
+      }
+
       ReplaceProcessedTracks(bGoodResult);
+   }
 
 //   mT0 = mCurT0;
 //   mT1 = mCurT0 + m_maxNewLength; // Update selection.
@@ -165,21 +251,14 @@ bool EffectSoundTouch::ProcessWithTimeWarper(const TimeWarper &warper)
    return bGoodResult;
 }
 
-void EffectSoundTouch::End()
-{
-   mSoundTouch.reset();
-}
-
 //ProcessOne() takes a track, transforms it to bunch of buffer-blocks,
 //and executes ProcessSoundTouch on these blocks
-bool EffectSoundTouch::ProcessOne(WaveTrack *track,
+bool EffectSoundTouch::ProcessOne(SoundTouch &soundTouch,
+                                  WaveTrack *track,
                                   sampleCount start, sampleCount end,
-                                  const TimeWarper &warper)
+                                  WaveTrack *outputTrack,
+                                  const ConcurrentProgress &progress)
 {
-   mSoundTouch->setSampleRate((unsigned int)(track->GetRate()+0.5));
-
-   auto outputTrack = mFactory->NewWaveTrack(track->GetSampleFormat(), track->GetRate());
-
    //Get the length of the buffer (as double). len is
    //used simple to calculate a progress meter, so it is easier
    //to make it a double now than it is to do it later
@@ -188,74 +267,64 @@ bool EffectSoundTouch::ProcessOne(WaveTrack *track,
    {
       //Initiate a processing buffer.  This buffer will (most likely)
       //be shorter than the length of the track being processed.
-      Floats buffer{ track->GetMaxBlockSize() };
+      const auto bufferSize = FeedBlocks * track->GetMaxBlockSize();
+      Floats buffer{ bufferSize };
+      // Grows to the most SoundTouch has yet returned at once
+      Floats buffer2;
+      size_t buffer2Size = 0;
+      const auto receive = [&] {
+         unsigned int outputCount = soundTouch.numSamples();
+         if (outputCount > 0) {
+            if (outputCount > buffer2Size)
+               buffer2.reinit(buffer2Size = outputCount);
+            soundTouch.receiveSamples(buffer2.get(), outputCount);
+            outputTrack->Append((samplePtr)buffer2.get(), floatSample, outputCount);
+         }
+      };
 
       //Go through the track one buffer at a time. s counts which
       //sample the current buffer starts at.
       auto s = start;
       while (s < end) {
-         //Get a block of samples (smaller than the size of the buffer)
-         const auto block =
-            limitSampleBufferSize( track->GetBestBlockSize(s), end - s );
+         //Get a block of samples (no larger than the buffer)
+         const auto block = limitSampleBufferSize( bufferSize, end - s );
 
          //Get the samples from the track and put them in the buffer
          track->Get((samplePtr)buffer.get(), floatSample, s, block);
 
          //Add samples to SoundTouch
-         mSoundTouch->putSamples(buffer.get(), block);
+         soundTouch.putSamples(buffer.get(), block);
 
          //Get back samples from SoundTouch
-         unsigned int outputCount = mSoundTouch->numSamples();
-         if (outputCount > 0) {
-            Floats buffer2{ outputCount };
-            mSoundTouch->receiveSamples(buffer2.get(), outputCount);
-            outputTrack->Append((samplePtr)buffer2.get(), floatSample, outputCount);
-         }
+         receive();
 
          //Increment s one blockfull of samples
          s += block;
 
          //Update the Progress meter
-         if (TrackProgress(mCurTrackNum, (s - start).as_double() / len))
+         if (progress((s - start).as_double() / len))
             return false;
       }
 
       // Tell SoundTouch to finish processing any remaining samples
-      mSoundTouch->flush();   // this should only be used for changeTempo - it dumps data otherwise with pRateTransposer->clear();
+      soundTouch.flush();   // this should only be used for changeTempo - it dumps data otherwise with pRateTransposer->clear();
 
-      unsigned int outputCount = mSoundTouch->numSamples();
-      if (outputCount > 0) {
-         Floats buffer2{ outputCount };
-         mSoundTouch->receiveSamples(buffer2.get(), outputCount);
-         outputTrack->Append((samplePtr)buffer2.get(), floatSample, outputCount);
-      }
+      receive();
 
       // Flush the output WaveTrack (since it's buffered, too)
       outputTrack->Flush();
    }
 
-   // Take the output track and insert it in place of the original
-   // sample data
-   track->ClearAndPaste(mCurT0, mCurT1, outputTrack.get(), true, false, &warper);
-
-   double newLength = outputTrack->GetEndTime();
-   m_maxNewLength = wxMax(m_maxNewLength, newLength);
-
    //Return true because the effect processing succeeded.
    return true;
 }
 
-bool EffectSoundTouch::ProcessStereo(
+bool EffectSoundTouch::ProcessStereo(SoundTouch &soundTouch,
    WaveTrack* leftTrack, WaveTrack* rightTrack,
-   sampleCount start, sampleCount end, const TimeWarper &warper)
+   sampleCount start, sampleCount end,
+   WaveTrack* outputLeftTrack, WaveTrack* outputRightTrack,
+   const ConcurrentProgress &progress)
 {
-   mSoundTouch->setSampleRate((unsigned int)(leftTrack->GetRate() + 0.5));
-
-   auto outputLeftTrack = mFactory->NewWaveTrack(leftTrack->GetSampleFormat(),
-                                                       leftTrack->GetRate());
-   auto outputRightTrack = mFactory->NewWaveTrack(rightTrack->GetSampleFormat(),
-                                                        rightTrack->GetRate());
-
    //Get the length of the buffer (as double). len is
    //used simple to calculate a progress meter, so it is easier
    //to make it a double now than it is to do it later
@@ -263,24 +332,22 @@ bool EffectSoundTouch::ProcessStereo(
 
    //Initiate a processing buffer.  This buffer will (most likely)
    //be shorter than the length of the track being processed.
-   // Make soundTouchBuffer twice as big as MaxBlockSize for each channel,
+   // Make soundTouchBuffer twice as big as the buffer for each channel,
    // because Soundtouch wants them interleaved, i.e., each
    // Soundtouch sample is left-right pair.
-   auto maxBlockSize = leftTrack->GetMaxBlockSize();
+   const auto bufferSize = FeedBlocks * leftTrack->GetMaxBlockSize();
    {
-      Floats leftBuffer{ maxBlockSize };
-      Floats rightBuffer{ maxBlockSize };
-      Floats soundTouchBuffer{ maxBlockSize * 2 };
+      Floats leftBuffer{ bufferSize };
+      Floats rightBuffer{ bufferSize };
+      Floats soundTouchBuffer{ bufferSize * 2 };
 
       // Go through the track one stereo buffer at a time.
       // sourceSampleCount counts the sample at which the current buffer starts,
       // per channel.
       auto sourceSampleCount = start;
       while (sourceSampleCount < end) {
-         auto blockSize = limitSampleBufferSize(
-            leftTrack->GetBestBlockSize(sourceSampleCount),
-            end - sourceSampleCount
-         );
+         auto blockSize =
+            limitSampleBufferSize(bufferSize, end - sourceSampleCount);
 
          // Get the samples from the tracks and put them in the buffers.
          leftTrack->Get((samplePtr)(leftBuffer.get()), floatSample, sourceSampleCount, blockSize);
@@ -293,67 +360,46 @@ bool EffectSoundTouch::ProcessStereo(
          }
 
          //Add samples to SoundTouch
-         mSoundTouch->putSamples(soundTouchBuffer.get(), blockSize);
+         soundTouch.putSamples(soundTouchBuffer.get(), blockSize);
 
          //Get back samples from SoundTouch
-         unsigned int outputCount = mSoundTouch->numSamples();
+         unsigned int outputCount = soundTouch.numSamples();
          if (outputCount > 0)
-            this->ProcessStereoResults(outputCount, outputLeftTrack.get(), outputRightTrack.get());
+            this->ProcessStereoResults(soundTouch,
+               outputCount, outputLeftTrack, outputRightTrack);
 
          //Increment sourceSampleCount one blockfull of samples
          sourceSampleCount += blockSize;
 
          //Update the Progress meter
-         // mCurTrackNum is left track. Include right track.
-         int nWhichTrack = mCurTrackNum;
-         double frac = (sourceSampleCount - start).as_double() / len;
-         if (frac < 0.5)
-            frac *= 2.0; // Show twice as far for each track, because we're doing 2 at once.
-         else
-         {
-            nWhichTrack++;
-            frac -= 0.5;
-            frac *= 2.0; // Show twice as far for each track, because we're doing 2 at once.
-         }
-         if (TrackProgress(nWhichTrack, frac))
+         if (progress((sourceSampleCount - start).as_double() / len))
             return false;
       }
 
       // Tell SoundTouch to finish processing any remaining samples
-      mSoundTouch->flush();
+      soundTouch.flush();
 
-      unsigned int outputCount = mSoundTouch->numSamples();
+      unsigned int outputCount = soundTouch.numSamples();
       if (outputCount > 0)
-         this->ProcessStereoResults(outputCount, outputLeftTrack.get(), outputRightTrack.get());
+         this->ProcessStereoResults(soundTouch,
+            outputCount, outputLeftTrack, outputRightTrack);
 
       // Flush the output WaveTracks (since they're buffered, too)
       outputLeftTrack->Flush();
       outputRightTrack->Flush();
    }
 
-   // Take the output tracks and insert in place of the original
-   // sample data.
-   leftTrack->ClearAndPaste(
-      mCurT0, mCurT1, outputLeftTrack.get(), true, false, &warper);
-   rightTrack->ClearAndPaste(
-      mCurT0, mCurT1, outputRightTrack.get(), true, false, &warper);
-
-   // Track the longest result length
-   double newLength = outputLeftTrack->GetEndTime();
-   m_maxNewLength = wxMax(m_maxNewLength, newLength);
-   newLength = outputRightTrack->GetEndTime();
-   m_maxNewLength = wxMax(m_maxNewLength, newLength);
-
    //Return true because the effect processing succeeded.
    return true;
 }
 
-bool EffectSoundTouch::ProcessStereoResults(const size_t outputCount,
+bool EffectSoundTouch::ProcessStereoResults(SoundTouch &soundTouch,
+                                            const size_t outputCount,
                                             WaveTrack* outputLeftTrack,
                                             WaveTrack* outputRightTrack)
 {
    Floats outputSoundTouchBuffer{ outputCount * 2 };
-   mSoundTouch->receiveSamples(outputSoundTouchBuffer.get(), outputCount);
+   soundTouch.receiveSamples(outputSoundTouchBuffer.get(), outputCount);
 
    // Dis-interleave outputSoundTouchBuffer into separate track buffers.
    Floats outputLeftBuffer{ outputCount };
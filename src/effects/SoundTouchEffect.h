@@ -19,6 +19,8 @@
 #ifndef __AUDACITY_EFFECT_SOUNDTOUCH__
 #define __AUDACITY_EFFECT_SOUNDTOUCH__
 
+#include <functional>
+
 #include "Effect.h"
 
 // Soundtouch defines these as well, so get rid of them before including
@@ -39,10 +41,6 @@ class EffectSoundTouch /* not final */ : public Effect
 {
 public:
 
-   // Effect implementation
-
-   void End() override;
-
    // EffectSoundTouch implementation
 
 #ifdef USE_MIDI
@@ -53,9 +51,12 @@ public:
 protected:
    // Effect implementation
 
-   bool ProcessWithTimeWarper(const TimeWarper &warper);
+   // Called for each of the SoundTouch objects, one per mono track or
+   // stereo pair, to set the subclass-specific parameters
+   using InitFunction = std::function< void(SoundTouch *soundtouch) >;
+   bool ProcessWithTimeWarper(
+      const InitFunction &initer, const TimeWarper &warper);
 
-   std::unique_ptr<SoundTouch> mSoundTouch;
    double mCurT0;
    double mCurT1;
 
@@ -64,13 +65,18 @@ private:
 #ifdef USE_MIDI
    bool ProcessNoteTrack(NoteTrack *track, const TimeWarper &warper);
 #endif
-   bool ProcessOne(
+   // These only fill the output tracks, and may run on any thread, for
+   // different tracks at once
+   bool ProcessOne(SoundTouch &soundTouch,
       WaveTrack * t, sampleCount start, sampleCount end,
-      const TimeWarper &warper);
-   bool ProcessStereo(WaveTrack* leftTrack, WaveTrack* rightTrack,
-                     sampleCount start, sampleCount end,
-                      const TimeWarper &warper);
-   bool ProcessStereoResults(const size_t outputCount,
+      WaveTrack *outputTrack, const ConcurrentProgress &progress);
+   bool ProcessStereo(SoundTouch &soundTouch,
+                      WaveTrack* leftTrack, WaveTrack* rightTrack,
+                      sampleCount start, sampleCount end,
+                      WaveTrack* outputLeftTrack, WaveTrack* outputRightTrack,
+                      const ConcurrentProgress &progress);
+   bool ProcessStereoResults(SoundTouch &soundTouch,
+                              const size_t outputCount,
                               WaveTrack* outputLeftTrack,
                               WaveTrack* outputRightTrack);
 
@@ -23,6 +23,7 @@ frequency changes smoothly during the tone.
 
 #include <math.h>
 #include <float.h>
+#include <algorithm>
 
 #include <wx/intl.h>
 #include <wx/valgen.h>
@@ -52,6 +53,7 @@ enum kWaveforms
    kSquare,
    kSawtooth,
    kSquareNoAlias,
+   kSawtoothNoAlias,
    nWaveforms
 };
 
@@ -60,7 +62,8 @@ static const IdentInterfaceSymbol kWaveStrings[nWaveforms] =
    { XO("Sine") },
    { XO("Square") },
    { XO("Sawtooth") },
-   { wxT("SquareNoAlias"), XO("Square, no alias") }
+   { wxT("SquareNoAlias"), XO("Square, no alias") },
+   { wxT("SawtoothNoAlias"), XO("Sawtooth, no alias") }
 };
 
 // Define keys, defaults, minimums, and maximums for the effect parameters
@@ -121,8 +124,8 @@ IdentInterfaceSymbol EffectToneGen::GetSymbol()
 wxString EffectToneGen::GetDescription()
 {
    return mChirp
-      ? _("Generates an ascending or descending tone of one of four types")
-      : _("Generates a constant frequency tone of one of four types");
+      ? _("Generates an ascending or descending tone of one of five types")
+      : _("Generates a constant frequency tone of one of five types");
 }
 
 wxString EffectToneGen::ManualPage()
@@ -148,6 +151,17 @@ unsigned EffectToneGen::GetAudioOutCount()
 
 bool EffectToneGen::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames WXUNUSED(chanMap))
 {
+   switch (mWaveform)
+   {
+   case kSquareNoAlias:
+      mOscillator = WavetableOscillator{ WavetableOscillator::Square };
+      break;
+   case kSawtoothNoAlias:
+      mOscillator = WavetableOscillator{ WavetableOscillator::Sawtooth };
+      break;
+   default:
+      mOscillator = WavetableOscillator{ WavetableOscillator::Sine };
+   }
    mPositionInCycles = 0.0;
    mSample = 0;
 
@@ -158,14 +172,10 @@ size_t EffectToneGen::ProcessBlock(float **WXUNUSED(inBlock), float **outBlock,
 {
    float *buffer = outBlock[0];
    double throwaway = 0;        //passed to modf but never used
-   double f = 0.0;
-   double a, b;
-   int k;
 
    double frequencyQuantum;
    double BlendedFrequency;
    double BlendedAmplitude;
-   double BlendedLogFrequency = 0.0;
 
    // calculate delta, and reposition from where we left
    auto doubleSampleCount = mSampleCnt.as_double();
@@ -175,10 +185,6 @@ size_t EffectToneGen::ProcessBlock(float **WXUNUSED(inBlock), float **outBlock,
    BlendedAmplitude = mAmplitude[0] +
       amplitudeQuantum * doubleSample;
 
-   // precalculations:
-   double pre2PI = 2.0 * M_PI;
-   double pre4divPI = 4.0 / M_PI;
-
    // initial setup should calculate deltas
    if (mInterpolation == kLogarithmic)
    {
@@ -187,8 +193,10 @@ size_t EffectToneGen::ProcessBlock(float **WXUNUSED(inBlock), float **outBlock,
       mLogFrequency[1] = log10(mFrequency[1]);
       // calculate delta, and reposition from where we left
       frequencyQuantum = (mLogFrequency[1] - mLogFrequency[0]) / doubleSampleCount;
-      BlendedLogFrequency = mLogFrequency[0] + frequencyQuantum * doubleSample;
-      BlendedFrequency = pow(10.0, BlendedLogFrequency);
+      BlendedFrequency =
+         pow(10.0, mLogFrequency[0] + frequencyQuantum * doubleSample);
+      // which is a constant ratio from one sample to the next
+      frequencyQuantum = pow(10.0, frequencyQuantum);
    }
    else
    {
@@ -196,47 +204,57 @@ size_t EffectToneGen::ProcessBlock(float **WXUNUSED(inBlock), float **outBlock,
       frequencyQuantum = (mFrequency[1] - mFrequency[0]) / doubleSampleCount;
       BlendedFrequency = mFrequency[0] + frequencyQuantum * doubleSample;
    }
+   const bool constantFrequency = mFrequency[0] == mFrequency[1];
 
-   // synth loop
-   for (decltype(blockLen) i = 0; i < blockLen; i++)
+   // synth loop, a chunk at a time, with the frequency of each sample, in
+   // cycles per sample, worked out first
+   const size_t ChunkSize = 256;
+   double increments[ChunkSize];
+   for (decltype(blockLen) done = 0; done < blockLen;)
    {
+      const auto len = std::min(ChunkSize, blockLen - done);
+      float *chunk = buffer + done;
+
+      for (size_t i = 0; i < len; i++)
+      {
+         increments[i] = BlendedFrequency / mSampleRate;
+         if (mInterpolation == kLogarithmic)
+            BlendedFrequency *= frequencyQuantum;
+         else
+            BlendedFrequency += frequencyQuantum;
+      }
+
       switch (mWaveform)
       {
-      case kSine:
-         f = sin(pre2PI * mPositionInCycles / mSampleRate);
-         break;
       case kSquare:
-         f = (modf(mPositionInCycles / mSampleRate, &throwaway) < 0.5) ? 1.0 : -1.0;
+         for (size_t i = 0; i < len; i++)
+         {
+            chunk[i] = (modf(mPositionInCycles, &throwaway) < 0.5) ? 1.0 : -1.0;
+            mPositionInCycles += increments[i];
+         }
          break;
       case kSawtooth:
-         f = (2.0 * modf(mPositionInCycles / mSampleRate + 0.5, &throwaway)) - 1.0;
-         break;
-      case kSquareNoAlias:    // Good down to 110Hz @ 44100Hz sampling.
-         //do fundamental (k=1) outside loop
-         b = (1.0 + cos((pre2PI * BlendedFrequency) / mSampleRate)) / pre4divPI;  //scaling
-         f = pre4divPI * sin(pre2PI * mPositionInCycles / mSampleRate);
-         for (k = 3; (k < 200) && (k * BlendedFrequency < mSampleRate / 2.0); k += 2)
+         for (size_t i = 0; i < len; i++)
          {
-            //Hanning Window in freq domain
-            a = 1.0 + cos((pre2PI * k * BlendedFrequency) / mSampleRate);
-            //calc harmonic, apply window, scale to amplitude of fundamental
-            f += a * sin(pre2PI * mPositionInCycles / mSampleRate * k) / (b * k);
+            chunk[i] = (2.0 * modf(mPositionInCycles + 0.5, &throwaway)) - 1.0;
+            mPositionInCycles += increments[i];
          }
+         break;
+      default:
+         if (constantFrequency)
+            mOscillator.Generate(chunk, len, increments[0]);
+         else
+            mOscillator.Generate(chunk, len, increments);
       }
-      // insert value in buffer
-      buffer[i] = (float) (BlendedAmplitude * f);
-      // update freq,amplitude
-      mPositionInCycles += BlendedFrequency;
-      BlendedAmplitude += amplitudeQuantum;
-      if (mInterpolation == kLogarithmic)
-      {
-         BlendedLogFrequency += frequencyQuantum;
-         BlendedFrequency = pow(10.0, BlendedLogFrequency);
-      }
-      else
+      mPositionInCycles -= floor(mPositionInCycles);
+
+      for (size_t i = 0; i < len; i++)
       {
-         BlendedFrequency += frequencyQuantum;
+         chunk[i] *= BlendedAmplitude;
+         BlendedAmplitude += amplitudeQuantum;
       }
+
+      done += len;
    }
 
    // update external placeholder
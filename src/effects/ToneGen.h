@@ -19,6 +19,7 @@
 #include "../widgets/NumericTextCtrl.h"
 
 #include "Effect.h"
+#include "WavetableOscillator.h"
 
 class ShuttleGui;
 
@@ -67,7 +68,10 @@ private:
    // mSample is an external placeholder to remember the last "buffer"
    // position so we use it to reinitialize from where we left
    sampleCount mSample;
+   // Phase of the naive square and sawtooth
    double mPositionInCycles;
+   // Sine, or band-limited square or sawtooth
+   WavetableOscillator mOscillator;
 
    // If we made these static variables,
    // Tone and Chirp would share the same parameters.
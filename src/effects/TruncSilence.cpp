@@ -690,6 +690,18 @@ bool EffectTruncSilence::Analyze(RegionList& silenceList,
       // Limit size of current block if we've reached the end
       auto count = limitSampleBufferSize( blockLen, end - *index );
 
+      // A silence at least two groups of the summary long must cover a
+      // whole group, so the loud groups need not be read, except where one
+      // may begin or end.  Not while measuring for preview, which counts
+      // the samples of output one at a time.
+      if (!inputLength && minSilenceFrames >= 2 * 256) {
+         AnalyzeFromSummaries(trackSilences, wt, *index, count,
+            truncDbSilenceThreshold, minSilenceFrames, *silentFrame,
+            buffer.get());
+         *index += count;
+         continue;
+      }
+
       // Fill buffer
       wt->Get((samplePtr)(buffer.get()), floatSample, *index, count);
 
@@ -752,6 +764,63 @@ bool EffectTruncSilence::Analyze(RegionList& silenceList,
    return true;
 }
 
+void EffectTruncSilence::AnalyzeFromSummaries(RegionList &trackSilences,
+                                              const WaveTrack *wt,
+                                              sampleCount index, size_t count,
+                                              double threshold,
+                                              sampleCount minSilenceFrames,
+                                              sampleCount &silentFrame,
+                                              float *buffer)
+{
+   // Read some samples, and look for silences in them
+   auto scan = [&](sampleCount from, size_t len) {
+      wt->Get((samplePtr)buffer, floatSample, from, len);
+      for (decltype(len) i = 0; i < len; ++i) {
+         if (fabs(buffer[i]) < threshold)
+            ++silentFrame;
+         else {
+            if (silentFrame >= minSilenceFrames)
+               trackSilences.push_back(Region(
+                  wt->LongSamplesToTime(from + i - silentFrame),
+                  wt->LongSamplesToTime(from + i)
+               ));
+            silentFrame = 0;
+         }
+      }
+   };
+
+   std::vector<Sequence::PeakGroup> groups;
+   wt->GetPeakGroups(index, count, groups);
+
+   const auto isLoud = [&](size_t ii) {
+      return groups[ii].peak >= threshold;
+   };
+   const auto adjoins = [&](size_t ii) {
+      return groups[ii].start + groups[ii].len == groups[ii + 1].start;
+   };
+
+   // Samples not in any group, such as those between clips, are read
+   auto pos = index;
+   for (size_t ii = 0, nn = groups.size(); ii < nn; ++ii) {
+      const auto &group = groups[ii];
+      if (group.start > pos)
+         scan(pos, (group.start - pos).as_size_t());
+
+      if (!isLoud(ii))
+         silentFrame += group.len;
+      else if (ii > 0 && adjoins(ii - 1) && isLoud(ii - 1) &&
+               ii + 1 < nn && adjoins(ii) && isLoud(ii + 1))
+         // Silences beginning or ending here are shorter than two groups
+         silentFrame = 0;
+      else
+         scan(group.start, group.len);
+
+      pos = group.start + group.len;
+   }
+   const auto end = index + count;
+   if (pos < end)
+      scan(pos, (end - pos).as_size_t());
+}
 
 void EffectTruncSilence::PopulateOrExchange(ShuttleGui & S)
 {
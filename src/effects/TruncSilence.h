@@ -84,6 +84,15 @@ private:
    // void BlendFrames(float* buffer, int leftIndex, int rightIndex, int blendFrameCount);
    void Intersect(RegionList &dest, const RegionList & src);
 
+   // Finds the silences in count samples from index as Analyze() does,
+   // without reading groups of samples that the summaries show to be all
+   // quiet, or loud between loud groups
+   void AnalyzeFromSummaries(RegionList &trackSilences,
+                             const WaveTrack *wt,
+                             sampleCount index, size_t count,
+                             double threshold, sampleCount minSilenceFrames,
+                             sampleCount &silentFrame, float *buffer);
+
    void OnControlChange(wxCommandEvent & evt);
    void UpdateUI();
 
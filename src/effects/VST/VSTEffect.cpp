@@ -53,6 +53,7 @@
 #include <wx/combobox.h>
 #include <wx/dcclient.h>
 #include <wx/file.h>
+#include <wx/fileconf.h>
 #include <wx/filename.h>
 #include <wx/frame.h>
 #include <wx/imaglist.h>
@@ -68,6 +69,7 @@
 #include <wx/sstream.h>
 #include <wx/statbox.h>
 #include <wx/stattext.h>
+#include <wx/stopwatch.h>
 #include <wx/timer.h>
 #include <wx/tokenzr.h>
 #include <wx/utils.h>
@@ -85,6 +87,7 @@
 #include "../../FileNames.h"
 #include "../../Internat.h"
 #include "../../PlatformCompatibility.h"
+#include "../../Prefs.h"
 #include "../../ShuttleGui.h"
 #include "../../effects/Effect.h"
 #include "../../widgets/NumericTextCtrl.h"
@@ -103,6 +106,8 @@
 #include "VSTEffect.h"
 #include "../../MemoryX.h"
 #include <cstring>
+#include <map>
+#include <thread>
 
 static float reinterpretAsFloat(uint32_t x)
 {
@@ -297,6 +302,216 @@ public:
    bool mAutomatable;
 };
 
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+///
+/// Runs one check of a plugin in another process, without waiting for it
+///
+///////////////////////////////////////////////////////////////////////////////
+class VSTCheckProcess final : public wxProcess
+{
+public:
+   VSTCheckProcess()
+   {
+      Redirect();
+   }
+
+   void OnTerminate(int WXUNUSED(pid), int WXUNUSED(status)) override
+   {
+      Drain();
+      mActive = false;
+   }
+
+   // Read what is available, so that the pipe never fills and blocks the
+   // process
+   void Drain()
+   {
+      wxInputStream *stream = GetInputStream();
+      while (stream && stream->CanRead())
+      {
+         char buffer[4096];
+         stream->Read(buffer, WXSIZEOF(buffer));
+         mOutput.append(buffer, stream->LastRead());
+      }
+   }
+
+   long mPid{ 0 };
+   bool mActive{ true };
+   bool mKilled{ false };
+   size_t mIndex{ 0 };
+   std::string mOutput;
+   wxStopWatch mTimer;
+};
+
+// Runs the commands, as many at once as there are processors, killing any
+// that takes longer than the timeout.  Calls done for each in the order
+// they finish, with the output, and whether the process ended by itself;
+// stops starting more when done returns false.
+void RunChecks(const wxArrayString &cmds,
+   const std::function<bool(size_t, const wxString &, bool)> &done)
+{
+   const size_t maxRunning =
+      std::max(1u, std::thread::hardware_concurrency());
+   const long timeout =
+      1000 * gPrefs->Read(wxT("/VST/ScanTimeout"), 30L);
+
+   int flags = wxEXEC_ASYNC;
+#if defined(__WXMSW__)
+   flags += wxEXEC_NOHIDE;
+#endif
+
+   std::vector< std::unique_ptr<VSTCheckProcess> > running;
+   size_t next = 0;
+   bool cont = true;
+   while (!running.empty() || (cont && next < cmds.size()))
+   {
+      while (cont && next < cmds.size() && running.size() < maxRunning)
+      {
+         auto proc = std::make_unique<VSTCheckProcess>();
+         proc->mIndex = next;
+         proc->mPid = wxExecute(cmds[next++], flags, proc.get());
+         if (proc->mPid == 0)
+         {
+            cont = done(next - 1, wxEmptyString, false);
+            continue;
+         }
+         running.push_back(std::move(proc));
+      }
+
+      wxMilliSleep(10);
+      // Termination is reported through the event loop
+      wxTheApp->Yield();
+
+      for (auto iter = running.begin(); iter != running.end();)
+      {
+         auto &proc = **iter;
+         proc.Drain();
+         if (proc.mActive)
+         {
+            // A hung plugin, or a cancelled scan; the process must still
+            // report its end before it can be destroyed
+            if (!proc.mKilled && (!cont || proc.mTimer.Time() > timeout))
+            {
+               wxProcess::Kill(proc.mPid, wxSIGKILL, wxKILL_CHILDREN);
+               proc.mKilled = true;
+            }
+            ++iter;
+            continue;
+         }
+
+         const auto index = proc.mIndex;
+         const bool completed = !proc.mKilled;
+         auto output = wxString::FromUTF8(proc.mOutput.c_str());
+         if (output.empty())
+            // Not UTF-8, but the lines we look for are ASCII
+            output = wxString(proc.mOutput.c_str(), wxConvISO8859_1);
+         iter = running.erase(iter);
+         if (cont)
+            cont = done(index, output, completed);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///
+/// The output of checks, kept between sessions with the modification time
+/// and size of each plugin file, so that only new or changed plugins are
+/// loaded again
+///
+///////////////////////////////////////////////////////////////////////////////
+class VSTScanCache
+{
+public:
+   static VSTScanCache &Get()
+   {
+      static VSTScanCache cache;
+      return cache;
+   }
+
+   static wxString Stamp(const wxString &path)
+   {
+      wxFileName name{ path };
+      wxString modified = wxT("0");
+      wxString size = wxT("0");
+      if (name.FileExists())
+      {
+         modified = name.GetModificationTime().GetValue().ToString();
+         size = name.GetSize().ToString();
+      }
+      else if (wxFileName::DirExists(path))
+      {
+         // A bundle
+         modified = wxFileName::DirName(path).GetModificationTime()
+            .GetValue().ToString();
+      }
+      return modified + wxT(":") + size;
+   }
+
+   bool Lookup(const wxString &key, const wxString &stamp, wxString &output)
+   {
+      auto iter = mEntries.find(key);
+      if (iter == mEntries.end() || iter->second.stamp != stamp)
+         return false;
+      output = iter->second.output;
+      return true;
+   }
+
+   void Store(const wxString &key, const wxString &stamp, const wxString &output)
+   {
+      mEntries[key] = { stamp, output };
+   }
+
+   void Save()
+   {
+      wxFileConfig config(wxEmptyString, wxEmptyString, GetFileName());
+      config.DeleteAll();
+      long ii = 0;
+      for (const auto &entry : mEntries)
+      {
+         config.SetPath(wxString::Format(wxT("/Scan%ld"), ii++));
+         config.Write(wxT("Key"), entry.first);
+         config.Write(wxT("Stamp"), entry.second.stamp);
+         config.Write(wxT("Output"), entry.second.output);
+      }
+      config.SetPath(wxT("/"));
+      config.Write(wxT("Count"), ii);
+      config.Flush();
+   }
+
+private:
+   VSTScanCache()
+   {
+      wxFileConfig config(wxEmptyString, wxEmptyString, GetFileName());
+      const long count = config.Read(wxT("Count"), 0L);
+      for (long ii = 0; ii < count; ++ii)
+      {
+         config.SetPath(wxString::Format(wxT("/Scan%ld"), ii));
+         Entry entry;
+         wxString key;
+         if (config.Read(wxT("Key"), &key) &&
+             config.Read(wxT("Stamp"), &entry.stamp) &&
+             config.Read(wxT("Output"), &entry.output))
+            mEntries[key] = entry;
+      }
+   }
+
+   static wxString GetFileName()
+   {
+      return wxFileName( FileNames::DataDir(), wxT("vstscancache.cfg") )
+         .GetFullPath();
+   }
+
+   struct Entry
+   {
+      wxString stamp;
+      wxString output;
+   };
+   std::map<wxString, Entry> mEntries;
+};
+
+}
+
 // ============================================================================
 //
 // VSTEffectsModule
@@ -503,41 +718,16 @@ unsigned VSTEffectsModule::DiscoverPluginsAtPath(
    // TODO:  Fix this for external usage
    const wxString &cmdpath = PlatformCompatibility::GetExecutablePath();
 
-   wxString effectIDs = wxT("0;");
-   wxStringTokenizer effectTzr(effectIDs, wxT(";"));
-
-   Maybe<wxProgressDialog> progress{};
-   size_t idCnt = 0;
-   size_t idNdx = 0;
+   auto &cache = VSTScanCache::Get();
+   const auto stamp = VSTScanCache::Stamp(path);
 
-   bool cont = true;
+   VSTSubProcess proc;
 
-   while (effectTzr.HasMoreTokens() && cont)
+   // Registers each plugin described by the output of a check, and returns
+   // the list of effect IDs, if the path is a shell
+   auto parse = [&](const wxString &output)
    {
-      wxString effectID = effectTzr.GetNextToken();
-
-      wxString cmd;
-      cmd.Printf(wxT("\"%s\" %s \"%s;%s\""), cmdpath, VSTCMDKEY, path, effectID);
-
-      VSTSubProcess proc;
-      try
-      {
-         int flags = wxEXEC_SYNC | wxEXEC_NODISABLE;
-#if defined(__WXMSW__)
-         flags += wxEXEC_NOHIDE;
-#endif
-         wxExecute(cmd, flags, &proc);
-      }
-      catch (...)
-      {
-         wxLogMessage(_("VST plugin registration failed for %s\n"), path);
-         error = true;
-      }
-
-      wxString output;
-      wxStringOutputStream ss(&output);
-      proc.GetInputStream()->Read(ss);
-
+      wxString effectIDs;
       int keycount = 0;
       bool haveBegin = false;
       wxStringTokenizer tzr(output, wxT("\n"));
@@ -562,23 +752,6 @@ unsigned VSTEffectsModule::DiscoverPluginsAtPath(
          {
             case kKeySubIDs:
                effectIDs = val;
-               effectTzr.Reinit(effectIDs);
-               idCnt = effectTzr.CountTokens();
-               if (idCnt > 3)
-               {
-                  progress.create( _("Scanning Shell VST"),
-                        wxString::Format(_("Registering %d of %d: %-64.64s"), 0, idCnt,
-                                         proc.GetSymbol().Translation()),
-                        static_cast<int>(idCnt),
-                        nullptr,
-                        wxPD_APP_MODAL |
-                           wxPD_AUTO_HIDE |
-                           wxPD_CAN_ABORT |
-                           wxPD_ELAPSED_TIME |
-                           wxPD_ESTIMATED_TIME |
-                           wxPD_REMAINING_TIME );
-                  progress->Show();
-               }
             break;
 
             case kKeyBegin:
@@ -637,21 +810,9 @@ unsigned VSTEffectsModule::DiscoverPluginsAtPath(
                   continue;
                }
 
-               bool skip = false;
-               if (progress)
-               {
-                  idNdx++;
-                  cont = progress->Update(idNdx,
-                     wxString::Format(_("Registering %d of %d: %-64.64s"), idNdx, idCnt,
-                        proc.GetSymbol().Translation() ));
-               }
-
-               if (!skip && cont)
-               {
-                  if (callback)
-                     callback( this, &proc );
-                  ++nFound;
-               }
+               if (callback)
+                  callback( this, &proc );
+               ++nFound;
             }
             break;
 
@@ -661,6 +822,92 @@ unsigned VSTEffectsModule::DiscoverPluginsAtPath(
             break;
          }
       }
+      return effectIDs;
+   };
+
+   // Checks path with each effect ID, passing each output to done, from
+   // the cache if the plugin is unchanged, or else from the processes,
+   // several at once
+   auto check = [&](const wxArrayString &effectIDs,
+                    const std::function<bool(const wxString &)> &done)
+   {
+      wxArrayString cmds;
+      wxArrayString keys;
+      for (const auto &effectID : effectIDs)
+      {
+         const auto key = path + wxT(";") + effectID;
+         wxString output;
+         if (cache.Lookup(key, stamp, output))
+         {
+            if (!done(output))
+               return;
+            continue;
+         }
+
+         wxString cmd;
+         cmd.Printf(wxT("\"%s\" %s \"%s\""), cmdpath, VSTCMDKEY, key);
+         cmds.Add(cmd);
+         keys.Add(key);
+      }
+
+      RunChecks(cmds, [&](size_t ii, const wxString &output, bool completed)
+      {
+         if (completed)
+            // Even a crash is worth remembering, so that an unchanged
+            // plugin is not loaded again
+            cache.Store(keys[ii], stamp, output);
+         else
+         {
+            wxLogMessage(_("VST plugin registration failed for %s\n"), path);
+            error = true;
+         }
+         return done(output);
+      });
+      cache.Save();
+   };
+
+   wxString shellIDs;
+   wxArrayString firstID;
+   firstID.Add(wxT("0"));
+   check(firstID, [&](const wxString &output)
+   {
+      shellIDs = parse(output);
+      return true;
+   });
+
+   if (!shellIDs.empty())
+   {
+      const auto effectIDs = wxStringTokenize(shellIDs, wxT(";"));
+      const size_t idCnt = effectIDs.size();
+      size_t idNdx = 0;
+
+      Maybe<wxProgressDialog> progress{};
+      if (idCnt > 3)
+      {
+         progress.create( _("Scanning Shell VST"),
+               wxString::Format(_("Registering %d of %d: %-64.64s"), 0, idCnt,
+                                proc.GetSymbol().Translation()),
+               static_cast<int>(idCnt),
+               nullptr,
+               wxPD_APP_MODAL |
+                  wxPD_AUTO_HIDE |
+                  wxPD_CAN_ABORT |
+                  wxPD_ELAPSED_TIME |
+                  wxPD_ESTIMATED_TIME |
+                  wxPD_REMAINING_TIME );
+         progress->Show();
+      }
+
+      check(effectIDs, [&](const wxString &output)
+      {
+         parse(output);
+         if (!progress)
+            return true;
+         idNdx++;
+         return progress->Update(idNdx,
+            wxString::Format(_("Registering %d of %d: %-64.64s"), idNdx, idCnt,
+               proc.GetSymbol().Translation() ));
+      });
    }
 
    if (error)
@@ -764,6 +1011,7 @@ public:
 private:
    EffectHostInterface *mHost;
    int mBufferSize;
+   bool mUseLargeOfflineBuffers;
    bool mUseLatency;
    bool mUseGUI;
 
@@ -780,6 +1028,7 @@ VSTEffectOptionsDialog::VSTEffectOptionsDialog(wxWindow * parent, EffectHostInte
    mHost = host;
 
    mHost->GetSharedConfig(wxT("Options"), wxT("BufferSize"), mBufferSize, 8192);
+   mHost->GetSharedConfig(wxT("Options"), wxT("UseLargeOfflineBuffers"), mUseLargeOfflineBuffers, false);
    mHost->GetSharedConfig(wxT("Options"), wxT("UseLatency"), mUseLatency, true);
    mHost->GetSharedConfig(wxT("Options"), wxT("UseGUI"), mUseGUI, true);
 
@@ -820,6 +1069,18 @@ void VSTEffectOptionsDialog::PopulateOrExchange(ShuttleGui & S)
                t->SetValidator(vld);
             }
             S.EndHorizontalLay();
+
+            S.AddVariableText(wxString() +
+               _("When applying an effect, rather than playing it, Audacity can ") +
+               _("instead send as many samples as it has read at once, up to the ") +
+               _("largest buffer size."))->Wrap(650);
+
+            S.StartHorizontalLay(wxALIGN_LEFT);
+            {
+               S.TieCheckBox(_("Use &largest buffers when applying effects"),
+                             mUseLargeOfflineBuffers);
+            }
+            S.EndHorizontalLay();
          }
          S.EndStatic();
 
@@ -874,6 +1135,7 @@ void VSTEffectOptionsDialog::OnOk(wxCommandEvent & WXUNUSED(evt))
    PopulateOrExchange(S);
 
    mHost->SetSharedConfig(wxT("Options"), wxT("BufferSize"), mBufferSize);
+   mHost->SetSharedConfig(wxT("Options"), wxT("UseLargeOfflineBuffers"), mUseLargeOfflineBuffers);
    mHost->SetSharedConfig(wxT("Options"), wxT("UseLatency"), mUseLatency);
    mHost->SetSharedConfig(wxT("Options"), wxT("UseGUI"), mUseGUI);
 
@@ -1148,6 +1410,7 @@ VSTEffect::VSTEffect(const wxString & path, VSTEffect *master)
    mWantsIdle = false;
    mWantsEditIdle = false;
    mUseLatency = true;
+   mUseLargeOfflineBuffers = false;
    mReady = false;
 
    memset(&mTimeInfo, 0, sizeof(mTimeInfo));
@@ -1313,6 +1576,7 @@ bool VSTEffect::SetHost(EffectHostInterface *host)
       int userBlockSize;
       mHost->GetSharedConfig(wxT("Options"), wxT("BufferSize"), userBlockSize, 8192);
       mUserBlockSize = std::max( 1, userBlockSize );
+      mHost->GetSharedConfig(wxT("Options"), wxT("UseLargeOfflineBuffers"), mUseLargeOfflineBuffers, false);
       mHost->GetSharedConfig(wxT("Options"), wxT("UseLatency"), mUseLatency, true);
 
       mBlockSize = mUserBlockSize;
@@ -1353,7 +1617,12 @@ int VSTEffect::GetMidiOutCount()
 
 size_t VSTEffect::SetBlockSize(size_t maxBlockSize)
 {
-   mBlockSize = std::min( maxBlockSize, mUserBlockSize );
+   // Applying an effect, the host offers the whole of its buffer, where
+   // realtime processing offers little.  VST has no way to ask a plugin
+   // for its best size; effSetBlockSize only tells the most it will get.
+   const size_t largestBlockSize = 1048576;
+   mBlockSize = std::min( maxBlockSize,
+      mUseLargeOfflineBuffers ? largestBlockSize : mUserBlockSize );
    return mBlockSize;
 }
 
@@ -1455,7 +1724,15 @@ bool VSTEffect::RealtimeInitialize()
 
 bool VSTEffect::RealtimeAddProcessor(unsigned numChannels, float sampleRate)
 {
-   mSlaves.push_back(std::make_unique<VSTEffect>(mPath, this));
+   // A spare is set up again below, as a new one would be, and powering it
+   // on again resets its state
+   if (!mSpareSlaves.empty())
+   {
+      mSlaves.push_back(std::move(mSpareSlaves.back()));
+      mSpareSlaves.pop_back();
+   }
+   else
+      mSlaves.push_back(std::make_unique<VSTEffect>(mPath, this));
    VSTEffect *const slave = mSlaves.back().get();
 
    slave->SetBlockSize(mBlockSize);
@@ -1491,8 +1768,11 @@ bool VSTEffect::RealtimeAddProcessor(unsigned numChannels, float sampleRate)
 
 bool VSTEffect::RealtimeFinalize()
 {
-   for (const auto &slave : mSlaves)
+   for (auto &slave : mSlaves)
+   {
       slave->ProcessFinalize();
+      mSpareSlaves.push_back(std::move(slave));
+   }
    mSlaves.clear();
 
    mMasterIn.reset();
@@ -1966,6 +2246,7 @@ void VSTEffect::ShowOptions()
       int userBlockSize;
       mHost->GetSharedConfig(wxT("Options"), wxT("BufferSize"), userBlockSize, 8192);
       mUserBlockSize = std::max( 1, userBlockSize );
+      mHost->GetSharedConfig(wxT("Options"), wxT("UseLargeOfflineBuffers"), mUseLargeOfflineBuffers, false);
       mHost->GetSharedConfig(wxT("Options"), wxT("UseLatency"), mUseLatency, true);
    }
 }
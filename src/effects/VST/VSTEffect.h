@@ -319,6 +319,7 @@ private:
    VstTimeInfo mTimeInfo;
 
    bool mUseLatency;
+   bool mUseLargeOfflineBuffers;
    int mBufferDelay;
 
    unsigned mBlockSize;
@@ -336,6 +337,8 @@ private:
    // Realtime processing
    VSTEffect *mMaster;     // non-NULL if a slave
    VSTEffectArray mSlaves;
+   // Slaves of past streams, kept for the next, because loading is slow
+   VSTEffectArray mSpareSlaves;
    unsigned mNumChannels;
    FloatBuffers mMasterIn, mMasterOut;
    size_t mNumSamples;
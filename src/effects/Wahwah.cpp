@@ -21,6 +21,7 @@
 #include "../Audacity.h"
 #include "Wahwah.h"
 
+#include <algorithm>
 #include <math.h>
 
 #include <wx/intl.h>
@@ -358,7 +359,6 @@ size_t EffectWahwah::InstanceProcess(EffectWahwahState & data, float **inBlock,
    float *ibuf = inBlock[0];
    float *obuf = outBlock[0];
    double frequency, omega, sn, cs, alpha;
-   double in, out;
 
    data.lfoskip = mFreq * 2 * M_PI / data.samplerate;
    data.depth = mDepth / 100.0;
@@ -367,36 +367,60 @@ size_t EffectWahwah::InstanceProcess(EffectWahwahState & data, float **inBlock,
    data.phase = mPhase * M_PI / 180.0;
    data.outgain = DB_TO_LINEAR(mOutGain);
 
-   for (decltype(blockLen) i = 0; i < blockLen; i++)
+   const double res = mRes;
+   const double outgain = data.outgain;
+
+   // The filter's history stays in registers while the samples between two
+   // steps of the lfo are filtered with the same coefficients
+   double xn1 = data.xn1, xn2 = data.xn2, yn1 = data.yn1, yn2 = data.yn2;
+
+   for (decltype(blockLen) i = 0; i < blockLen;)
    {
-      in = (double) ibuf[i];
+      const auto position = data.skipcount % lfoskipsamples;
+      const auto run = std::min<size_t>(blockLen - i, lfoskipsamples - position);
+      data.skipcount += run;
 
-      if ((data.skipcount++) % lfoskipsamples == 0)
+      if (position == 0)
       {
-         frequency = (1 + cos(data.skipcount * data.lfoskip + data.phase)) / 2;
+         // The lfo is computed for the count after the run's first sample
+         const auto count = data.skipcount - run + 1;
+         frequency = (1 + cos(count * data.lfoskip + data.phase)) / 2;
          frequency = frequency * data.depth * (1 - data.freqofs) + data.freqofs;
          frequency = exp((frequency - 1) * 6);
          omega = M_PI * frequency;
          sn = sin(omega);
          cs = cos(omega);
-         alpha = sn / (2 * mRes);
+         alpha = sn / (2 * res);
          data.b0 = (1 - cs) / 2;
          data.b1 = 1 - cs;
          data.b2 = (1 - cs) / 2;
          data.a0 = 1 + alpha;
          data.a1 = -2 * cs;
          data.a2 = 1 - alpha;
-      };
-      out = (data.b0 * in + data.b1 * data.xn1 + data.b2 * data.xn2 - data.a1 * data.yn1 - data.a2 * data.yn2) / data.a0;
-      data.xn2 = data.xn1;
-      data.xn1 = in;
-      data.yn2 = data.yn1;
-      data.yn1 = out;
-      out *= data.outgain;
-
-      obuf[i] = (float) out;
+      }
+
+      // Normalized once for the run, so that no division is in the loop
+      const double b0 = data.b0 / data.a0, b1 = data.b1 / data.a0,
+         b2 = data.b2 / data.a0, a1 = data.a1 / data.a0, a2 = data.a2 / data.a0;
+
+      for (const auto end = i + run; i < end; i++)
+      {
+         const double in = (double) ibuf[i];
+         const double out = b0 * in + b1 * xn1 + b2 * xn2 - a1 * yn1 - a2 * yn2;
+         xn2 = xn1;
+         xn1 = in;
+         yn2 = yn1;
+         yn1 = out;
+
+         obuf[i] = (float) (out * outgain);
+      }
    }
 
+   data.xn1 = xn1;
+   data.xn2 = xn2;
+   data.yn1 = yn1;
+   data.yn2 = yn2;
+
    return blockLen;
 }
 
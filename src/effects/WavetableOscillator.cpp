@@ -0,0 +1,159 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WavetableOscillator.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "../Audacity.h"
+#include "WavetableOscillator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../SampleFormat.h"
+
+namespace {
+
+// So that linear interpolation of the sine is within 1e-7, and the 512th
+// harmonic still has 16 points to a cycle
+const size_t TableBits = 13;
+const size_t TableSize = 1 << TableBits;
+// Tables of 1, 2, 4 ... 512 harmonics
+const size_t NumOctaves = 10;
+
+struct Tables
+{
+   explicit Tables(WavetableOscillator::Shape shape);
+
+   std::vector<Floats> tables;
+   std::vector<const float *> pointers;
+};
+
+Tables::Tables(WavetableOscillator::Shape shape)
+{
+   Doubles sines{ TableSize };
+   for (size_t n = 0; n < TableSize; n++)
+      sines[n] = sin(2.0 * M_PI * n / TableSize);
+
+   const size_t numTables =
+      shape == WavetableOscillator::Sine ? 1 : NumOctaves;
+   for (size_t octave = 0; octave < numTables; octave++) {
+      const size_t harmonics = 1 << octave;
+      const double windowEdge = M_PI / (harmonics + 1);
+
+      Doubles sum{ TableSize, true };
+      for (size_t k = 1; k <= harmonics; k++) {
+         double amplitude;
+         if (shape == WavetableOscillator::Sine)
+            amplitude = 1.0;
+         else if (shape == WavetableOscillator::Square) {
+            if (k % 2 == 0)
+               continue;
+            amplitude = 4.0 / (M_PI * k);
+         }
+         else
+            amplitude = (k % 2 ? 2.0 : -2.0) / (M_PI * k);
+
+         // Hann window in the frequency domain, scaled to leave the
+         // fundamental alone
+         amplitude *= (1.0 + cos(windowEdge * k)) / (1.0 + cos(windowEdge));
+
+         // The k-th harmonic is the sine read k times as fast
+         for (size_t n = 0; n < TableSize; n++)
+            sum[n] += amplitude * sines[(k * n) & (TableSize - 1)];
+      }
+
+      // One more point, so that interpolation needs no wrapping
+      Floats table{ TableSize + 1 };
+      std::copy(sum.get(), sum.get() + TableSize, table.get());
+      table[TableSize] = table[0];
+      pointers.push_back(table.get());
+      tables.push_back(std::move(table));
+   }
+}
+
+const Tables &GetTables(WavetableOscillator::Shape shape)
+{
+   switch (shape) {
+   case WavetableOscillator::Square:
+      {
+         static const Tables square{ WavetableOscillator::Square };
+         return square;
+      }
+   case WavetableOscillator::Sawtooth:
+      {
+         static const Tables sawtooth{ WavetableOscillator::Sawtooth };
+         return sawtooth;
+      }
+   case WavetableOscillator::Sine:
+   default:
+      {
+         static const Tables sine{ WavetableOscillator::Sine };
+         return sine;
+      }
+   }
+}
+
+// phase is in [0, 1)
+inline float Read(const float *table, double phase)
+{
+   const double position = phase * TableSize;
+   const size_t index = position;
+   const float fraction = position - index;
+   return table[index] + fraction * (table[index + 1] - table[index]);
+}
+
+}
+
+WavetableOscillator::WavetableOscillator(Shape shape)
+{
+   const auto &tables = GetTables(shape);
+   mTables = tables.pointers.data();
+   mNumTables = tables.pointers.size();
+}
+
+const float *WavetableOscillator::TableFor(double increment) const
+{
+   // Harmonics up to the Nyquist frequency
+   const double harmonics = 0.5 / fabs(increment);
+   if (mNumTables == 1 || !(harmonics >= 2))
+      return mTables[0];
+   if (harmonics >= (1 << (mNumTables - 1)))
+      return mTables[mNumTables - 1];
+
+   // The greatest power of two no more than harmonics
+   int exponent;
+   frexp(harmonics, &exponent);
+   return mTables[exponent - 1];
+}
+
+void WavetableOscillator::Generate(float *out, size_t len, double increment)
+{
+   // Each phase is found from the first, so that the loop carries nothing
+   // from one sample to the next
+   const float *table = TableFor(increment);
+   for (size_t i = 0; i < len; i++) {
+      double phase = mPhase + i * increment;
+      phase -= floor(phase);
+      out[i] = Read(table, phase);
+   }
+   SetPhase(mPhase + len * increment);
+}
+
+void WavetableOscillator::Generate(
+   float *out, size_t len, const double *increments)
+{
+   double phase = mPhase;
+   for (size_t i = 0; i < len; i++) {
+      out[i] = Read(TableFor(increments[i]), phase);
+      phase += increments[i];
+      if (phase >= 1.0 || phase < 0.0)
+         phase -= floor(phase);
+   }
+   mPhase = phase;
+}
@@ -0,0 +1,64 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WavetableOscillator.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class WavetableOscillator
+\brief A phase accumulator reading one cycle of a waveform from a table,
+for the tone generators.
+
+  The sine is one table, read with linear interpolation to within 1e-7.
+  The square and sawtooth are band-limited:  each has a table for every
+  octave of harmonics, from the fundamental alone to 512 harmonics, made
+  with the same Hann window over the harmonics as the old "Square, no
+  alias".  Each sample is read from the richest table with no harmonic
+  above the Nyquist frequency, so nothing aliases at any frequency, and
+  the top harmonics of a table, which the window makes quiet, are the
+  only ones to change at a switch.
+
+  The tables are built once, on first use, and shared.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_WAVETABLE_OSCILLATOR__
+#define __AUDACITY_WAVETABLE_OSCILLATOR__
+
+#include <cmath>
+
+class WavetableOscillator
+{
+public:
+   enum Shape
+   {
+      Sine,
+      Square,
+      Sawtooth,
+   };
+
+   explicit WavetableOscillator(Shape shape = Sine);
+
+   /// The phase of the next sample, in cycles
+   void SetPhase(double phase) { mPhase = phase - floor(phase); }
+   double GetPhase() const { return mPhase; }
+
+   /// Writes len samples at a constant frequency, in cycles per sample
+   void Generate(float *out, size_t len, double increment);
+
+   /// Writes len samples, each at its own frequency in cycles per sample
+   void Generate(float *out, size_t len, const double *increments);
+
+private:
+   const float *TableFor(double increment) const;
+
+   const float *const *mTables;
+   size_t mNumTables;
+   double mPhase{ 0 };
+};
+
+#endif
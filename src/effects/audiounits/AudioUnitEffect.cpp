@@ -1346,9 +1346,19 @@ bool AudioUnitEffect::RealtimeInitialize()
 
 bool AudioUnitEffect::RealtimeAddProcessor(unsigned numChannels, float sampleRate)
 {
-   auto slave = std::make_unique<AudioUnitEffect>(mPath, mName, mComponent, this);
-   if (!slave->SetHost(NULL))
-      return false;
+   // A spare is set up again below, as a new one would be
+   std::unique_ptr<AudioUnitEffect> slave;
+   if (!mSpareSlaves.empty())
+   {
+      slave = std::move(mSpareSlaves.back());
+      mSpareSlaves.pop_back();
+   }
+   else
+   {
+      slave = std::make_unique<AudioUnitEffect>(mPath, mName, mComponent, this);
+      if (!slave->SetHost(NULL))
+         return false;
+   }
 
    slave->SetBlockSize(mBlockSize);
    slave->SetChannelCount(numChannels);
@@ -1366,7 +1376,10 @@ bool AudioUnitEffect::RealtimeAddProcessor(unsigned numChannels, float sampleRat
 bool AudioUnitEffect::RealtimeFinalize()
 {
    for (size_t i = 0, cnt = mSlaves.size(); i < cnt; i++)
+   {
       mSlaves[i]->ProcessFinalize();
+      mSpareSlaves.push_back(std::move(mSlaves[i]));
+   }
    mSlaves.clear();
 
    mMasterIn.reset();
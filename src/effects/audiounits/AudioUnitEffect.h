@@ -205,6 +205,8 @@ private:
 
    AudioUnitEffect *mMaster;     // non-NULL if a slave
    AudioUnitEffectArray mSlaves;
+   // Slaves of past streams, kept for the next, because instantiating is slow
+   AudioUnitEffectArray mSpareSlaves;
    unsigned mNumChannels;
    ArraysOf<float> mMasterIn, mMasterOut;
    size_t mNumSamples;
@@ -591,6 +591,7 @@ LadspaEffect::LadspaEffect(const wxString & path, int index)
 
    mHost = NULL;
    mMaster = NULL;
+   mMasterRate = 0;
    mReady = false;
 
    mInteractive = false;
@@ -610,6 +611,7 @@ LadspaEffect::LadspaEffect(const wxString & path, int index)
 
 LadspaEffect::~LadspaEffect()
 {
+   CleanupSpareInstances();
 }
 
 // ============================================================================
@@ -919,7 +921,8 @@ bool LadspaEffect::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelName
    /* Instantiate the plugin */
    if (!mReady)
    {
-      mMaster = InitInstance(mSampleRate);
+      mMasterRate = mSampleRate;
+      mMaster = InitInstance(mMasterRate);
       if (!mMaster)
       {
          return false;
@@ -938,7 +941,7 @@ bool LadspaEffect::ProcessFinalize()
    {
       mReady = false;
 
-      FreeInstance(mMaster);
+      FreeInstance(mMaster, mMasterRate);
       mMaster = NULL;
    }
 
@@ -964,6 +967,13 @@ size_t LadspaEffect::ProcessBlock(float **inBlock, float **outBlock, size_t bloc
    return blockLen;
 }
 
+bool LadspaEffect::SupportsInPlace()
+{
+   // Unless the plugin says otherwise, it may read and write one buffer
+   return mData && !LADSPA_IS_INPLACE_BROKEN(mData->Properties) &&
+      mAudioIns == mAudioOuts;
+}
+
 bool LadspaEffect::RealtimeInitialize()
 {
    return true;
@@ -978,6 +988,7 @@ bool LadspaEffect::RealtimeAddProcessor(unsigned WXUNUSED(numChannels), float sa
    }
 
    mSlaves.push_back(slave);
+   mSlaveRates.push_back(sampleRate);
 
    return true;
 }
@@ -986,9 +997,10 @@ bool LadspaEffect::RealtimeFinalize()
 {
    for (size_t i = 0, cnt = mSlaves.size(); i < cnt; i++)
    {
-      FreeInstance(mSlaves[i]);
+      FreeInstance(mSlaves[i], mSlaveRates[i]);
    }
    mSlaves.clear();
+   mSlaveRates.clear();
 
    return true;
 }
@@ -1586,6 +1598,8 @@ bool LadspaEffect::Load()
 
 void LadspaEffect::Unload()
 {
+   CleanupSpareInstances();
+
    if (mLib.IsLoaded())
    {
       mLib.Unload();
@@ -1628,6 +1642,24 @@ bool LadspaEffect::SaveParameters(const wxString & group)
 
 LADSPA_Handle LadspaEffect::InitInstance(float sampleRate)
 {
+   // Reuse a deactivated instance, whose control ports are still connected;
+   // activating it again resets its state
+   for (auto iter = mSpares.begin(); iter != mSpares.end(); ++iter)
+   {
+      if (iter->first == sampleRate)
+      {
+         LADSPA_Handle handle = iter->second;
+         mSpares.erase(iter);
+
+         if (mData->activate)
+         {
+            mData->activate(handle);
+         }
+
+         return handle;
+      }
+   }
+
    /* Instantiate the plugin */
    LADSPA_Handle handle = mData->instantiate(mData, sampleRate);
    if (!handle)
@@ -1659,14 +1691,23 @@ LADSPA_Handle LadspaEffect::InitInstance(float sampleRate)
    return handle;
 }
 
-void LadspaEffect::FreeInstance(LADSPA_Handle handle)
+void LadspaEffect::FreeInstance(LADSPA_Handle handle, float sampleRate)
 {
    if (mData->deactivate)
    {
       mData->deactivate(handle);
    }
 
-   mData->cleanup(handle);
+   mSpares.push_back(std::make_pair(sampleRate, handle));
+}
+
+void LadspaEffect::CleanupSpareInstances()
+{
+   for (const auto &spare : mSpares)
+   {
+      mData->cleanup(spare.second);
+   }
+   mSpares.clear();
 }
 
 void LadspaEffect::OnCheckBox(wxCommandEvent & evt)
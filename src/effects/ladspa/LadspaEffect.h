@@ -85,6 +85,7 @@ public:
    bool ProcessInitialize(sampleCount totalLen, ChannelNames chanMap = NULL) override;
    bool ProcessFinalize() override;
    size_t ProcessBlock(float **inBlock, float **outBlock, size_t blockLen) override;
+   bool SupportsInPlace() override;
 
    bool RealtimeInitialize() override;
    bool RealtimeAddProcessor(unsigned numChannels, float sampleRate) override;
@@ -136,7 +137,10 @@ private:
    bool SaveParameters(const wxString & group);
 
    LADSPA_Handle InitInstance(float sampleRate);
-   void FreeInstance(LADSPA_Handle handle);
+   // Deactivates the instance, and keeps it for the next InitInstance at
+   // the same rate
+   void FreeInstance(LADSPA_Handle handle, float sampleRate);
+   void CleanupSpareInstances();
 
    void OnCheckBox(wxCommandEvent & evt);
    void OnSlider(wxCommandEvent & evt);
@@ -157,6 +161,7 @@ private:
    bool mReady;
 
    LADSPA_Handle mMaster;
+   float mMasterRate;
 
    double mSampleRate;
    size_t mBlockSize;
@@ -180,6 +185,11 @@ private:
 
    // Realtime processing
    std::vector<LADSPA_Handle> mSlaves;
+   std::vector<float> mSlaveRates;
+
+   // Deactivated instances, with their rates, for reuse by later passes,
+   // so that each track or realtime group need not instantiate again
+   std::vector<std::pair<float, LADSPA_Handle>> mSpares;
 
    EffectUIHostInterface *mUIHost;
 
@@ -13,6 +13,7 @@
 
 #if defined(USE_LV2)
 
+#include <algorithm>
 #include <cmath>
 
 #include <wx/button.h>
@@ -319,6 +320,10 @@ LV2Effect::LV2Effect(const LilvPlugin *plug)
 
 LV2Effect::~LV2Effect()
 {
+   for (const auto &spare : mSpareSlaves)
+   {
+      FreeInstance(spare.first);
+   }
 }
 
 // ============================================================================
@@ -749,7 +754,7 @@ bool LV2Effect::IsReady()
 
 bool LV2Effect::ProcessInitialize(sampleCount WXUNUSED(totalLen), ChannelNames WXUNUSED(chanMap))
 {
-   mProcess = InitInstance(mSampleRate);
+   mProcess = InitInstance(mSampleRate, false);
    if (!mProcess)
    {
       return false;
@@ -788,6 +793,7 @@ size_t LV2Effect::ProcessBlock(float **inbuf, float **outbuf, size_t size)
    }
 
    lilv_instance_run(mProcess, size);
+   EndRun(mProcess);
 
    return size;
 }
@@ -813,9 +819,10 @@ bool LV2Effect::RealtimeFinalize()
    {
       lilv_instance_deactivate(mSlaves[i]);
 
-      FreeInstance(mSlaves[i]);
+      mSpareSlaves.push_back({ mSlaves[i], mSlaveRates[i] });
    }
    mSlaves.clear();
+   mSlaveRates.clear();
 
    lilv_instance_deactivate(mMaster);
 
@@ -881,21 +888,36 @@ size_t LV2Effect::RealtimeProcess(int group,
    }
 
    lilv_instance_run(slave, numSamples);
+   EndRun(slave);
 
    return numSamples;
 }
 
 bool LV2Effect::RealtimeAddProcessor(unsigned WXUNUSED(numChannels), float sampleRate)
 {
-   LilvInstance *slave = InitInstance(sampleRate);
-   if (!slave)
+   // The rate is fixed when instantiating; activating again resets a spare
+   LilvInstance *slave = NULL;
+   auto found = std::find_if(mSpareSlaves.begin(), mSpareSlaves.end(),
+      [=](const std::pair<LilvInstance*, float> &spare)
+         { return spare.second == sampleRate; });
+   if (found != mSpareSlaves.end())
    {
-      return false;
+      slave = found->first;
+      mSpareSlaves.erase(found);
+   }
+   else
+   {
+      slave = InitInstance(sampleRate);
+      if (!slave)
+      {
+         return false;
+      }
    }
 
    lilv_instance_activate(slave);
 
    mSlaves.push_back(slave);
+   mSlaveRates.push_back(sampleRate);
 
    return true;
 }
@@ -903,6 +925,7 @@ bool LV2Effect::RealtimeAddProcessor(unsigned WXUNUSED(numChannels), float sampl
 bool LV2Effect::RealtimeProcessEnd()
 {
    lilv_instance_run(mMaster, mNumSamples);
+   EndRun(mMaster);
 
    return true;
 }
@@ -1312,16 +1335,33 @@ LV2_Feature *LV2Effect::AddFeature(const char *uri, void *data)
    return mFeatures[ndx].get();
 }
 
-LilvInstance *LV2Effect::InitInstance(float sampleRate)
+LilvInstance *LV2Effect::InitInstance(float sampleRate, bool threadedWorker)
 {
+   // Each instance has its own worker, so the features are copied
+   auto worker = std::make_unique<LV2Worker>(threadedWorker);
+   std::vector<const LV2_Feature *> features;
+   for (const auto &feature : mFeatures)
+   {
+      if (feature)
+      {
+         features.push_back(feature.get());
+      }
+   }
+   features.push_back(worker->GetFeature());
+   features.push_back(NULL);
+
    LilvInstance *handle = lilv_plugin_instantiate(
-      mPlug, sampleRate,
-      reinterpret_cast<const LV2_Feature *const *>(mFeatures.data()));
+      mPlug, sampleRate, features.data());
    if (!handle)
    {
       return NULL;
    }
 
+   if (worker->SetInstance(handle))
+   {
+      mWorkers[handle] = std::move(worker);
+   }
+
    mOptionsInterface = (LV2_Options_Interface *)
       lilv_instance_get_extension_data(handle, LV2_OPTIONS__interface);
 
@@ -1345,9 +1385,20 @@ LilvInstance *LV2Effect::InitInstance(float sampleRate)
 
 void LV2Effect::FreeInstance(LilvInstance *handle)
 {
+   // Stop the worker first, which may be working on the instance
+   mWorkers.erase(handle);
    lilv_instance_free(handle);
 }
 
+void LV2Effect::EndRun(LilvInstance *handle)
+{
+   auto found = mWorkers.find(handle);
+   if (found != mWorkers.end())
+   {
+      found->second->EndRun();
+   }
+}
+
 bool LV2Effect::BuildFancy()
 {
    // Set the native UI type
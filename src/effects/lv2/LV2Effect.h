@@ -37,6 +37,7 @@
 #include "../../widgets/NumericTextCtrl.h"
 
 #include "LoadLV2.h"
+#include "LV2Worker.h"
 
 #include <unordered_map>
 
@@ -195,8 +196,11 @@ private:
    bool LoadParameters(const wxString & group);
    bool SaveParameters(const wxString & group);
 
-   LilvInstance *InitInstance(float sampleRate);
+   // Work the instance schedules is done at once, unless threaded
+   LilvInstance *InitInstance(float sampleRate, bool threadedWorker = true);
    void FreeInstance(LilvInstance *handle);
+   // Call after each run of the instance
+   void EndRun(LilvInstance *handle);
 
    static uint32_t uri_to_id(LV2_URI_Map_Callback_Data callback_data,
                              const char *map,
@@ -280,6 +284,10 @@ private:
    LilvInstance *mMaster;
    LilvInstance *mProcess;
    std::vector<LilvInstance*> mSlaves;
+   // Deactivated slaves of past streams, with their sample rates, kept for
+   // the next, because instantiating is slow
+   std::vector<std::pair<LilvInstance*, float>> mSpareSlaves;
+   std::vector<float> mSlaveRates;
 
    FloatBuffers mMasterIn, mMasterOut;
    size_t mNumSamples;
@@ -311,6 +319,9 @@ private:
    LV2_Feature *mInstanceAccessFeature;
    LV2_Feature *mParentFeature;
 
+   // For the instances of plugins with the worker extension
+   std::unordered_map<LilvInstance*, std::unique_ptr<LV2Worker>> mWorkers;
+
    const LV2UI_Idle_Interface *mIdleFeature;
 
    SuilHost *mSuilHost;
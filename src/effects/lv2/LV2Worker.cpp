@@ -0,0 +1,196 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LV2Worker.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "../../Audacity.h"
+
+#if defined(USE_LV2)
+
+#include "LV2Worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+   // Enough for the paths and small structures that plugins send
+   const size_t QueueCapacity = 65536;
+   // A missed notification delays the work no longer than this
+   const auto WorkerWakeInterval = std::chrono::milliseconds( 10 );
+}
+
+// Messages of a size and that many bytes, from one writer thread to one
+// reader thread, without locks
+class LV2Worker::MessageQueue
+{
+public:
+   explicit MessageQueue(size_t capacity)
+      : mBuffer( capacity )
+   {
+   }
+
+   // For the writer only
+   bool Write(uint32_t size, const void *data)
+   {
+      const auto read = mRead.load( std::memory_order_acquire );
+      const auto write = mWrite.load( std::memory_order_relaxed );
+      const size_t needed = sizeof(size) + size;
+      if (mBuffer.size() - (write - read) < needed)
+         return false;
+      Copy(write, &size, sizeof(size));
+      Copy(write + sizeof(size), data, size);
+      mWrite.store( write + needed, std::memory_order_release );
+      return true;
+   }
+
+   // For the reader only; buffer holds the capacity
+   bool Read(char *buffer, uint32_t &size)
+   {
+      const auto write = mWrite.load( std::memory_order_acquire );
+      const auto read = mRead.load( std::memory_order_relaxed );
+      if (write == read)
+         return false;
+      Extract(read, &size, sizeof(size));
+      Extract(read + sizeof(size), buffer, size);
+      mRead.store( read + sizeof(size) + size, std::memory_order_release );
+      return true;
+   }
+
+private:
+   // Positions only grow; the index in the buffer is the remainder
+   void Copy(size_t position, const void *data, size_t size)
+   {
+      const auto start = position % mBuffer.size();
+      const auto first = std::min(size, mBuffer.size() - start);
+      memcpy(&mBuffer[start], data, first);
+      memcpy(&mBuffer[0], static_cast<const char*>(data) + first, size - first);
+   }
+
+   void Extract(size_t position, void *data, size_t size) const
+   {
+      const auto start = position % mBuffer.size();
+      const auto first = std::min(size, mBuffer.size() - start);
+      memcpy(data, &mBuffer[start], first);
+      memcpy(static_cast<char*>(data) + first, &mBuffer[0], size - first);
+   }
+
+   std::vector<char> mBuffer;
+   std::atomic<size_t> mRead{ 0 };
+   std::atomic<size_t> mWrite{ 0 };
+};
+
+LV2Worker::LV2Worker(bool threaded)
+   : mThreaded{ threaded }
+   , mResponses{ std::make_unique<MessageQueue>(QueueCapacity) }
+   , mResponse( QueueCapacity )
+{
+   mSchedule.handle = this;
+   mSchedule.schedule_work = LV2Worker::ScheduleWork;
+   mFeature.URI = LV2_WORKER__schedule;
+   mFeature.data = &mSchedule;
+
+   if (mThreaded)
+   {
+      mRequests = std::make_unique<MessageQueue>(QueueCapacity);
+      mRequest.resize(QueueCapacity);
+   }
+}
+
+LV2Worker::~LV2Worker()
+{
+   mStopping.store( true );
+   mCondition.notify_all();
+   if (mThread.joinable())
+      mThread.join();
+}
+
+bool LV2Worker::SetInstance(LilvInstance *instance)
+{
+   mInstance = instance;
+   mInterface = static_cast<const LV2_Worker_Interface *>(
+      lilv_instance_get_extension_data(instance, LV2_WORKER__interface));
+   if (!mInterface || !mInterface->work || !mInterface->work_response)
+   {
+      mInterface = nullptr;
+      return false;
+   }
+
+   if (mThreaded)
+      mThread = std::thread{ [this]{ WorkerLoop(); } };
+
+   return true;
+}
+
+void LV2Worker::EndRun()
+{
+   if (!mInterface)
+      return;
+
+   const auto handle = lilv_instance_get_handle(mInstance);
+   uint32_t size;
+   while (mResponses->Read(mResponse.data(), size))
+      mInterface->work_response(handle, size, mResponse.data());
+
+   if (mInterface->end_run)
+      mInterface->end_run(handle);
+}
+
+LV2_Worker_Status LV2Worker::ScheduleWork(
+   LV2_Worker_Schedule_Handle handle, uint32_t size, const void *data)
+{
+   auto &worker = *static_cast<LV2Worker *>(handle);
+   if (!worker.mInterface)
+      return LV2_WORKER_ERR_UNKNOWN;
+
+   // Offline, as the extension allows, so that the work takes effect
+   // with sample accuracy
+   if (!worker.mThreaded)
+      return worker.DoWork(size, data);
+
+   if (!worker.mRequests->Write(size, data))
+      return LV2_WORKER_ERR_NO_SPACE;
+   // Notifying takes no lock, so the audio thread can't wait here
+   worker.mCondition.notify_one();
+   return LV2_WORKER_SUCCESS;
+}
+
+LV2_Worker_Status LV2Worker::Respond(
+   LV2_Worker_Respond_Handle handle, uint32_t size, const void *data)
+{
+   auto &worker = *static_cast<LV2Worker *>(handle);
+   return worker.mResponses->Write(size, data)
+      ? LV2_WORKER_SUCCESS
+      : LV2_WORKER_ERR_NO_SPACE;
+}
+
+LV2_Worker_Status LV2Worker::DoWork(uint32_t size, const void *data)
+{
+   return mInterface->work(lilv_instance_get_handle(mInstance),
+      LV2Worker::Respond, this, size, data);
+}
+
+void LV2Worker::WorkerLoop()
+{
+   std::unique_lock< std::mutex > lock{ mMutex };
+   while (!mStopping.load())
+   {
+      uint32_t size;
+      if (mRequests->Read(mRequest.data(), size))
+      {
+         lock.unlock();
+         DoWork(size, mRequest.data());
+         lock.lock();
+         continue;
+      }
+      mCondition.wait_for(lock, WorkerWakeInterval);
+   }
+}
+
+#endif
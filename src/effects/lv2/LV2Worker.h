@@ -0,0 +1,96 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LV2Worker.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class LV2Worker
+\brief The host's side of the LV2 worker extension, for one instance of
+a plugin.
+
+  A plugin's run() may schedule work, such as loading a file, that must
+  not be done in the audio thread.  For an instance in realtime use, the
+  requests go through a lock-free queue to a thread of the worker's own,
+  and the responses come back through another, to be delivered after a
+  later run().  For offline processing the work is done at once, as the
+  extension allows, so that its effect is sample accurate.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_LV2_WORKER__
+#define __AUDACITY_LV2_WORKER__
+
+#include "../../Audacity.h"
+
+#if USE_LV2
+
+#include "../../MemoryX.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lv2/lv2plug.in/ns/ext/worker/worker.h"
+
+#include <lilv/lilv.h>
+
+class LV2Worker final
+{
+public:
+   /// If not threaded, work is done as soon as it is scheduled
+   explicit LV2Worker(bool threaded);
+   ~LV2Worker();
+   LV2Worker(const LV2Worker&) PROHIBITED;
+   LV2Worker &operator= (const LV2Worker&) PROHIBITED;
+
+   /// To pass when instantiating the plugin; valid as long as the worker
+   const LV2_Feature *GetFeature() const { return &mFeature; }
+
+   /// Call once the instance is made.  Returns false if the plugin has no
+   /// worker interface, and then the worker is not needed.
+   bool SetInstance(LilvInstance *instance);
+
+   /// Delivers the responses ready so far; call after each run() of the
+   /// instance, from the same thread
+   void EndRun();
+
+private:
+   class MessageQueue;
+
+   static LV2_Worker_Status ScheduleWork(
+      LV2_Worker_Schedule_Handle handle, uint32_t size, const void *data);
+   static LV2_Worker_Status Respond(
+      LV2_Worker_Respond_Handle handle, uint32_t size, const void *data);
+
+   void WorkerLoop();
+   LV2_Worker_Status DoWork(uint32_t size, const void *data);
+
+   const bool mThreaded;
+   LV2_Worker_Schedule mSchedule;
+   LV2_Feature mFeature;
+
+   LilvInstance *mInstance{};
+   const LV2_Worker_Interface *mInterface{};
+
+   std::unique_ptr<MessageQueue> mRequests;
+   std::unique_ptr<MessageQueue> mResponses;
+   // Space for one message, for the worker thread and the run() thread
+   // each, so that neither allocates
+   std::vector<char> mRequest;
+   std::vector<char> mResponse;
+
+   std::atomic<bool> mStopping{ false };
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::thread mThread;
+};
+
+#endif
+
+#endif
@@ -27,6 +27,7 @@ effects from this one class.
 #include "../../Audacity.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 
 #include <locale.h>
@@ -747,6 +748,10 @@ bool NyquistEffect::Process()
       mProps += wxString::Format(wxT("(putprop '*SELECTION* %d 'CHANNELS)\n"), mNumSelectedChannels);
    }
 
+   // The controls and the script are the same for every track, so prepare
+   // them once for the whole invocation
+   mScriptCmd = MakeScriptCommand();
+
    // Keep track of whether the current track is first selected in its sync-lock group
    // (we have no idea what the length of the returned audio will be, so we have
    // to handle sync-lock group behavior the "old" way).
@@ -811,8 +816,12 @@ _("Selection too long for Nyquist code.\nMaximum allowed selection is %ld sample
          nyx_init();
          nyx_set_os_callback(StaticOSCallback, (void *)this);
          nyx_capture_output(StaticOutputCallback, (void *)this);
+         if (mProfiling)
+            nyx_set_profiling(1);
 
          auto cleanup = finally( [&] {
+            if (mProfiling)
+               nyx_set_profiling(0);
             nyx_capture_output(NULL, (void *)NULL);
             nyx_set_os_callback(NULL, (void *)NULL);
             nyx_cleanup();
@@ -973,6 +982,78 @@ bool NyquistEffect::TransferDataFromWindow()
 
 // NyquistEffect implementation
 
+wxString NyquistEffect::MakeScriptCommand()
+{
+   wxString cmd;
+
+   for (unsigned int j = 0; j < mControls.size(); j++) {
+      if (mControls[j].type == NYQ_CTRL_FLOAT || mControls[j].type == NYQ_CTRL_FLOAT_TEXT ||
+          mControls[j].type == NYQ_CTRL_TIME) {
+         // We use Internat::ToString() rather than "%f" here because we
+         // always have to use the dot as decimal separator when giving
+         // numbers to Nyquist, whereas using "%f" will use the user's
+         // decimal separator which may be a comma in some countries.
+         cmd += wxString::Format(wxT("(setf %s %s)\n"),
+                                 mControls[j].var,
+                                 Internat::ToString(mControls[j].val, 14));
+      }
+      else if (mControls[j].type == NYQ_CTRL_INT ||
+            mControls[j].type == NYQ_CTRL_INT_TEXT ||
+            mControls[j].type == NYQ_CTRL_CHOICE) {
+         cmd += wxString::Format(wxT("(setf %s %d)\n"),
+                                 mControls[j].var,
+                                 (int)(mControls[j].val));
+      }
+      else if (mControls[j].type == NYQ_CTRL_STRING || mControls[j].type == NYQ_CTRL_FILE) {
+         cmd += wxT("(setf ");
+         // restrict variable names to 7-bit ASCII:
+         cmd += mControls[j].var;
+         cmd += wxT(" \"");
+         cmd += EscapeString(mControls[j].valStr); // unrestricted value will become quoted UTF-8
+         cmd += wxT("\")\n");
+      }
+   }
+
+   if (mIsSal) {
+      wxString str = EscapeString(mCmd);
+      // this is tricky: we need SAL to call main so that we can get a
+      // SAL traceback in the event of an error (sal-compile catches the
+      // error and calls sal-error-output), but SAL does not return values.
+      // We will catch the value in a special global aud:result and if no
+      // error occurs, we will grab the value with a LISP expression
+      str += wxT("\nset aud:result = main()\n");
+
+      if (mDebug || mTrace) {
+         // since we're about to evaluate SAL, remove LISP trace enable and
+         // break enable (which stops SAL processing) and turn on SAL stack
+         // trace
+         cmd += wxT("(setf *tracenable* nil)\n");
+         cmd += wxT("(setf *breakenable* nil)\n");
+         cmd += wxT("(setf *sal-traceback* t)\n");
+      }
+
+      if (mCompiler) {
+         cmd += wxT("(setf *sal-compiler-debug* t)\n");
+      }
+
+      cmd += wxT("(setf *sal-call-stack* nil)\n");
+      // if we do not set this here and an error occurs in main, another
+      // error will be raised when we try to return the value of aud:result
+      // which is unbound
+      cmd += wxT("(setf aud:result nil)\n");
+      cmd += wxT("(sal-compile-audacity \"") + str + wxT("\" t t nil)\n");
+      // Capture the value returned by main (saved in aud:result), but
+      // set aud:result to nil so sound results can be evaluated without
+      // retaining audio in memory
+      cmd += wxT("(prog1 aud:result (setf aud:result nil))\n");
+   }
+   else {
+      cmd += mCmd;
+   }
+
+   return cmd;
+}
+
 bool NyquistEffect::ProcessOne()
 {
    mpException = {};
@@ -1182,79 +1263,43 @@ bool NyquistEffect::ProcessOne()
       cmd += wxT("(setf *tracenable* NIL)\n");
    }
 
-   for (unsigned int j = 0; j < mControls.size(); j++) {
-      if (mControls[j].type == NYQ_CTRL_FLOAT || mControls[j].type == NYQ_CTRL_FLOAT_TEXT ||
-          mControls[j].type == NYQ_CTRL_TIME) {
-         // We use Internat::ToString() rather than "%f" here because we
-         // always have to use the dot as decimal separator when giving
-         // numbers to Nyquist, whereas using "%f" will use the user's
-         // decimal separator which may be a comma in some countries.
-         cmd += wxString::Format(wxT("(setf %s %s)\n"),
-                                 mControls[j].var,
-                                 Internat::ToString(mControls[j].val, 14));
-      }
-      else if (mControls[j].type == NYQ_CTRL_INT ||
-            mControls[j].type == NYQ_CTRL_INT_TEXT ||
-            mControls[j].type == NYQ_CTRL_CHOICE) {
-         cmd += wxString::Format(wxT("(setf %s %d)\n"),
-                                 mControls[j].var,
-                                 (int)(mControls[j].val));
-      }
-      else if (mControls[j].type == NYQ_CTRL_STRING || mControls[j].type == NYQ_CTRL_FILE) {
-         cmd += wxT("(setf ");
-         // restrict variable names to 7-bit ASCII:
-         cmd += mControls[j].var;
-         cmd += wxT(" \"");
-         cmd += EscapeString(mControls[j].valStr); // unrestricted value will become quoted UTF-8
-         cmd += wxT("\")\n");
-      }
-   }
-
-   if (mIsSal) {
-      wxString str = EscapeString(mCmd);
-      // this is tricky: we need SAL to call main so that we can get a
-      // SAL traceback in the event of an error (sal-compile catches the
-      // error and calls sal-error-output), but SAL does not return values.
-      // We will catch the value in a special global aud:result and if no
-      // error occurs, we will grab the value with a LISP expression
-      str += wxT("\nset aud:result = main()\n");
-
-      if (mDebug || mTrace) {
-         // since we're about to evaluate SAL, remove LISP trace enable and
-         // break enable (which stops SAL processing) and turn on SAL stack
-         // trace
-         cmd += wxT("(setf *tracenable* nil)\n");
-         cmd += wxT("(setf *breakenable* nil)\n");
-         cmd += wxT("(setf *sal-traceback* t)\n");
-      }
-
-      if (mCompiler) {
-         cmd += wxT("(setf *sal-compiler-debug* t)\n");
-      }
-
-      cmd += wxT("(setf *sal-call-stack* nil)\n");
-      // if we do not set this here and an error occurs in main, another
-      // error will be raised when we try to return the value of aud:result
-      // which is unbound
-      cmd += wxT("(setf aud:result nil)\n");
-      cmd += wxT("(sal-compile-audacity \"") + str + wxT("\" t t nil)\n");
-      // Capture the value returned by main (saved in aud:result), but
-      // set aud:result to nil so sound results can be evaluated without
-      // retaining audio in memory
-      cmd += wxT("(prog1 aud:result (setf aud:result nil))\n");
-   }
-   else {
-      cmd += mCmd;
-   }
+   cmd += mScriptCmd;
 
-   // Put the fetch buffers in a clean initial state
+   // Read the input through caches, which fetch each next block on another
+   // thread while Nyquist works on the last
    for (size_t i = 0; i < mCurNumChannels; i++)
-      mCurBuffer[i].Free();
+      mCurCache[i].SetTrack(Track::Pointer<const WaveTrack>(mCurTrack[i]));
 
    // Guarantee release of memory when done
    auto cleanup = finally( [&] {
       for (size_t i = 0; i < mCurNumChannels; i++)
-         mCurBuffer[i].Free();
+         mCurCache[i].SetTrack(nullptr);
+   } );
+
+   // Through the computing of the sound, on every return from here
+   const auto profileStart = std::chrono::steady_clock::now();
+   long gcCallsStart;
+   double gcSecondsStart;
+   nyx_get_gc_stats(&gcCallsStart, &gcSecondsStart);
+   auto profile = finally( [&] {
+      if (!mProfiling)
+         return;
+      const std::chrono::duration<double> elapsed =
+         std::chrono::steady_clock::now() - profileStart;
+      long gcCalls;
+      double gcSeconds;
+      nyx_get_gc_stats(&gcCalls, &gcSeconds);
+      ++mProfile.runs;
+      mProfile.seconds += elapsed.count();
+      mProfile.samples += mCurLen.as_double() * mCurNumChannels;
+      mProfile.gcCalls += gcCalls - gcCallsStart;
+      mProfile.gcSeconds += gcSeconds - gcSecondsStart;
+      for (unsigned ii = 0, nn = nyx_get_num_profile_entries(); ii < nn; ++ii) {
+         const char *name;
+         long count;
+         nyx_get_profile_entry(ii, &name, &count);
+         mProfile.evaluations[UTF8CTOWX(name)] += count;
+      }
    } );
 
    // Evaluate the expression, which may invoke the get callback, but often does
@@ -1385,10 +1430,6 @@ bool NyquistEffect::ProcessOne()
 
       outputTrack[i] = mFactory->NewWaveTrack(format, rate);
       outputTrack[i]->SetWaveColorIndex( mCurTrack[i]->GetWaveColorIndex() );
-
-      // Clean the initial buffer states again for the get callbacks
-      // -- is this really needed?
-      mCurBuffer[i].Free();
    }
 
    // Now fully evaluate the sound
@@ -1523,6 +1564,11 @@ void NyquistEffect::RedirectOutput()
    mRedirectOutput = true;
 }
 
+void NyquistEffect::EnableProfiling()
+{
+   mProfiling = true;
+}
+
 void NyquistEffect::SetCommand(const wxString &cmd)
 {
    mExternal = true;
@@ -2136,43 +2182,20 @@ int NyquistEffect::StaticGetCallback(float *buffer, int channel,
 int NyquistEffect::GetCallback(float *buffer, int ch,
                                long start, long len, long WXUNUSED(totlen))
 {
-   if (mCurBuffer[ch].ptr()) {
-      if ((mCurStart[ch] + start) < mCurBufferStart[ch] ||
-          (mCurStart[ch] + start)+len >
-          mCurBufferStart[ch]+mCurBufferLen[ch]) {
-         mCurBuffer[ch].Free();
-      }
+   constSamplePtr samples;
+   try {
+      samples = mCurCache[ch].Get(
+         floatSample, mCurStart[ch] + start, len, true);
    }
-
-   if (!mCurBuffer[ch].ptr()) {
-      mCurBufferStart[ch] = (mCurStart[ch] + start);
-      mCurBufferLen[ch] = mCurTrack[ch]->GetBestBlockSize(mCurBufferStart[ch]);
-
-      if (mCurBufferLen[ch] < (size_t) len) {
-         mCurBufferLen[ch] = mCurTrack[ch]->GetIdealBlockSize();
-      }
-
-      mCurBufferLen[ch] =
-         limitSampleBufferSize( mCurBufferLen[ch],
-                                mCurStart[ch] + mCurLen - mCurBufferStart[ch] );
-
-      mCurBuffer[ch].Allocate(mCurBufferLen[ch], floatSample);
-      try {
-         mCurTrack[ch]->Get(
-            mCurBuffer[ch].ptr(), floatSample,
-            mCurBufferStart[ch], mCurBufferLen[ch]);
-      }
-      catch ( ... ) {
-         // Save the exception object for re-throw when out of the library
-         mpException = std::current_exception();
-         return -1;
-      }
+   catch ( ... ) {
+      // Save the exception object for re-throw when out of the library
+      mpException = std::current_exception();
+      return -1;
    }
+   if (!samples)
+      return -1;
 
-   // We have guaranteed above that this is nonnegative and bounded by
-   // mCurBufferLen[ch]:
-   auto offset = ( mCurStart[ch] + start - mCurBufferStart[ch] ).as_size_t();
-   CopySamples(mCurBuffer[ch].ptr() + offset*SAMPLE_SIZE(floatSample), floatSample,
+   CopySamples(samples, floatSample,
                (samplePtr)buffer, floatSample,
                len);
 
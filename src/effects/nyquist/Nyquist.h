@@ -22,8 +22,10 @@
 #include <wx/textbuf.h>
 #include <wx/textctrl.h>
 #include <wx/tokenzr.h>
+#include <map>
 
 #include "../Effect.h"
+#include "../../WaveTrack.h"
 
 #include "nyx.h"
 
@@ -128,9 +130,28 @@ public:
    void Break();
    void Stop();
 
+   // Sums over all the runs of the effect, since profiling was enabled
+   struct Profile
+   {
+      // One per track, or stereo pair, that the script processed
+      unsigned runs{ 0 };
+      // Evaluating the expression and computing the sound
+      double seconds{ 0 };
+      // Samples of input, or of output for generators, in all channels
+      double samples{ 0 };
+      long gcCalls{ 0 };
+      double gcSeconds{ 0 };
+      // Evaluations directly within each named function, as XLISP's
+      // (PROFILE T) counts them
+      std::map<wxString, long> evaluations;
+   };
+   void EnableProfiling();
+   const Profile &GetProfile() const { return mProfile; }
+
 private:
    // NyquistEffect implementation
 
+   wxString MakeScriptCommand();
    bool ProcessOne();
 
    void BuildPromptWindow(ShuttleGui & S);
@@ -242,6 +263,8 @@ private:
 
    bool              mDebug;        // When true, debug window is shown.
    bool              mRedirectOutput;
+   bool              mProfiling{ false };
+   Profile           mProfile;
    bool              mProjectChanged;
    wxString          mDebugOutput;
 
@@ -263,9 +286,7 @@ private:
    double            mProgressTot;
    double            mScale;
 
-   SampleBuffer      mCurBuffer[2];
-   sampleCount       mCurBufferStart[2];
-   size_t            mCurBufferLen[2];
+   WaveTrackCache    mCurCache[2];
 
    WaveTrack        *mOutputTrack[2];
 
@@ -273,6 +294,7 @@ private:
 
    wxString          mProps;
    wxString          mPerTrackProps;
+   wxString          mScriptCmd;
 
    bool              mRestoreSplits;
    int               mMergeClips;
@@ -43,6 +43,9 @@
 #include "../../LabelTrack.h"
 #include "../../WaveTrack.h"
 
+#include <functional>
+#include <vector>
+
 enum
 {
    ID_Program  =  10000,
@@ -52,6 +55,103 @@ enum
    ID_Toggles  =  14000,
 };
 
+namespace {
+
+// One mono track or stereo pair, analysed by its own plugin instance,
+// independently of the others
+struct VampGroup
+{
+   WaveTrack *left{};
+   WaveTrack *right{};
+   unsigned channels{ 1 };
+   sampleCount lstart, rstart, len;
+   size_t step, block;
+   std::unique_ptr<Vamp::Plugin> plugin;
+   LabelTrack *ltrack{};
+   // Collected here, and added to the label track afterwards on the main
+   // thread
+   Vamp::Plugin::FeatureList features;
+};
+
+bool AnalyseGroup(VampGroup &group, int output, double rate,
+                  const std::function<bool(double)> &progress)
+{
+   const auto channels = group.channels;
+   const auto block = group.block;
+   const auto step = group.step;
+   auto &plugin = *group.plugin;
+
+   const auto collect = [&](Vamp::Plugin::FeatureSet &features) {
+      auto &list = features[output];
+      group.features.insert(group.features.end(), list.begin(), list.end());
+   };
+
+   FloatBuffers data{ channels, block };
+
+   auto len = group.len;
+   auto originalLen = len;
+   auto ls = group.lstart;
+   auto rs = group.rstart;
+
+   while (len != 0)
+   {
+      const auto request = limitSampleBufferSize( block, len );
+
+      group.left->Get((samplePtr)data[0].get(), floatSample, ls, request);
+
+      if (group.right)
+      {
+         group.right->Get((samplePtr)data[1].get(), floatSample, rs, request);
+      }
+
+      if (request < block)
+      {
+         for (unsigned int c = 0; c < channels; ++c)
+         {
+            for (decltype(block) i = request; i < block; ++i)
+            {
+               data[c][i] = 0.f;
+            }
+         }
+      }
+
+      // UNSAFE_SAMPLE_COUNT_TRUNCATION
+      // Truncation in case of very long tracks!
+      Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(
+         long( ls.as_long_long() ),
+         (int)(rate + 0.5)
+      );
+
+      Vamp::Plugin::FeatureSet features = plugin.process(
+         reinterpret_cast< float** >( data.get() ), timestamp);
+      collect(features);
+
+      if (len > (int)step)
+      {
+         len -= step;
+      }
+      else
+      {
+         len = 0;
+      }
+
+      ls += step;
+      rs += step;
+
+      if (progress((ls - group.lstart).as_double() / originalLen.as_double()))
+      {
+         return false;
+      }
+   }
+
+   Vamp::Plugin::FeatureSet features = plugin.getRemainingFeatures();
+   collect(features);
+
+   return true;
+}
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // VampEffect
@@ -328,10 +428,11 @@ bool VampEffect::Init()
       mRate = mProjectRate;
    }
 
-   // The plugin must be reloaded to allow changing parameters
-
-   Vamp::HostExt::PluginLoader *loader = Vamp::HostExt::PluginLoader::getInstance();
-   mPlugin.reset(loader->loadPlugin(mKey, mRate, Vamp::HostExt::PluginLoader::ADAPT_ALL));
+   // Reload for the rate, keeping the parameters.  mPlugin itself is never
+   // initialised; Process() gives each track its own copy of it.  Loading
+   // before the old instance goes, and keeping the instance after the
+   // run, keeps the library loaded too.
+   mPlugin = NewInstance();
    if (!mPlugin)
    {
       Effect::MessageBox(_("Sorry, failed to load Vamp Plug-in."));
@@ -355,7 +456,6 @@ bool VampEffect::Process()
    WaveTrack *left = (WaveTrack *)iter.First();
 
    bool multiple = false;
-   unsigned prevTrackChannels = 0;
 
    if (GetNumWaveGroups() > 1)
    {
@@ -367,28 +467,24 @@ bool VampEffect::Process()
    }
 
    std::vector<std::shared_ptr<Effect::AddedAnalysisTrack>> addedTracks;
+   std::vector<VampGroup> groups;
 
    while (left)
    {
-      sampleCount lstart, rstart = 0;
-      sampleCount len;
-      GetSamples(left, &lstart, &len);
-
-      WaveTrack *right = NULL;
-      unsigned channels = 1;
+      VampGroup group;
+      group.left = left;
+      GetSamples(left, &group.lstart, &group.len);
 
       if (left->GetLinked())
       {
-         right = (WaveTrack *)iter.Next();
-         channels = 2;
-         GetSamples(right, &rstart, &len);
+         group.right = (WaveTrack *)iter.Next();
+         group.channels = 2;
+         GetSamples(group.right, &group.rstart, &group.len);
       }
 
       size_t step = mPlugin->getPreferredStepSize();
       size_t block = mPlugin->getPreferredBlockSize();
 
-      bool initialiseRequired = true;
-
       if (block == 0)
       {
          if (step != 0)
@@ -406,31 +502,17 @@ bool VampEffect::Process()
          step = block;
       }
 
-      if (prevTrackChannels > 0)
-      {
-         // Plugin has already been initialised, so if the number of
-         // channels remains the same, we only need to do a reset.
-         // Otherwise we need to re-construct the whole plugin,
-         // because a Vamp plugin can't be re-initialised.
-         if (prevTrackChannels == channels)
-         {
-            mPlugin->reset();
-            initialiseRequired = false;
-         }
-         else
-         {
-            //!!! todo: retain parameters previously set
-            Init();
-         }
-      }
+      group.step = step;
+      group.block = block;
 
-      if (initialiseRequired)
+      // A Vamp plugin can't be re-initialised, nor used by two threads at
+      // once, so each group has a fresh instance
+      group.plugin = NewInstance();
+      if (!group.plugin ||
+          !group.plugin->initialise(group.channels, step, block))
       {
-         if (!mPlugin->initialise(channels, step, block))
-         {
-            Effect::MessageBox(_("Sorry, Vamp Plug-in failed to initialize."));
-            return false;
-         }
+         Effect::MessageBox(_("Sorry, Vamp Plug-in failed to initialize."));
+         return false;
       }
 
       const auto effectName = GetSymbol().Translation();
@@ -439,88 +521,44 @@ bool VampEffect::Process()
          ? wxString::Format( _("%s: %s"), left->GetName(), effectName )
          : effectName
       ));
-      LabelTrack *ltrack = addedTracks.back()->get();
+      group.ltrack = addedTracks.back()->get();
 
-      FloatBuffers data{ channels, block };
+      groups.push_back(std::move(group));
 
-      auto originalLen = len;
-      auto ls = lstart;
-      auto rs = rstart;
+      left = (WaveTrack *)iter.Next();
+   }
 
-      while (len != 0)
+   if (groups.size() < 2)
+   {
+      // Nothing to gain from the threads; show progress by track as before
+      for (auto &group : groups)
       {
-         const auto request = limitSampleBufferSize( block, len );
-
-         if (left)
-         {
-            left->Get((samplePtr)data[0].get(), floatSample, ls, request);
-         }
-
-         if (right)
-         {
-            right->Get((samplePtr)data[1].get(), floatSample, rs, request);
-         }
-
-         if (request < block)
-         {
-            for (unsigned int c = 0; c < channels; ++c)
-            {
-               for (decltype(block) i = request; i < block; ++i)
-               {
-                  data[c][i] = 0.f;
-               }
-            }
-         }
-
-         // UNSAFE_SAMPLE_COUNT_TRUNCATION
-         // Truncation in case of very long tracks!
-         Vamp::RealTime timestamp = Vamp::RealTime::frame2RealTime(
-            long( ls.as_long_long() ),
-            (int)(mRate + 0.5)
-         );
-
-         Vamp::Plugin::FeatureSet features = mPlugin->process(
-            reinterpret_cast< float** >( data.get() ), timestamp);
-         AddFeatures(ltrack, features);
-
-         if (len > (int)step)
-         {
-            len -= step;
-         }
-         else
-         {
-            len = 0;
-         }
-
-         ls += step;
-         rs += step;
-
-         if (channels > 1)
-         {
-            if (TrackGroupProgress(count,
-                  (ls - lstart).as_double() /
-                  originalLen.as_double() ))
-            {
-               return false;
-            }
-         }
-         else
+         const auto progress = [&](double frac) {
+            return group.channels > 1
+               ? TrackGroupProgress(count, frac)
+               : TrackProgress(count, frac);
+         };
+         if (!AnalyseGroup(group, mOutput, mRate, progress))
          {
-            if (TrackProgress(count,
-                  (ls - lstart).as_double() /
-                  originalLen.as_double() ))
-            {
-               return false;
-            }
+            return false;
          }
       }
+   }
+   else
+   {
+      // The tracks are independent, and only read
+      auto body = [&](size_t ii, const ConcurrentProgress &progress) {
+         AnalyseGroup(groups[ii], mOutput, mRate, progress);
+      };
+      if (!ParallelForWithProgress(groups.size(), body))
+      {
+         return false;
+      }
+   }
 
-      Vamp::Plugin::FeatureSet features = mPlugin->getRemainingFeatures();
-      AddFeatures(ltrack, features);
-
-      prevTrackChannels = channels;
-
-      left = (WaveTrack *)iter.Next();
+   for (auto &group : groups)
+   {
+      AddFeatures(group.ltrack, group.features);
    }
 
    // All completed without cancellation, so commit the addition of tracks now
@@ -530,11 +568,6 @@ bool VampEffect::Process()
    return true;
 }
 
-void VampEffect::End()
-{
-   mPlugin.reset();
-}
-
 void VampEffect::PopulateOrExchange(ShuttleGui & S)
 {
    Vamp::Plugin::ProgramList programs = mPlugin->getPrograms();
@@ -732,11 +765,34 @@ bool VampEffect::TransferDataFromWindow()
 
 // VampEffect implementation
 
+std::unique_ptr<Vamp::Plugin> VampEffect::NewInstance()
+{
+   Vamp::HostExt::PluginLoader *loader = Vamp::HostExt::PluginLoader::getInstance();
+   std::unique_ptr<Vamp::Plugin> plugin{
+      loader->loadPlugin(mKey, mRate, Vamp::HostExt::PluginLoader::ADAPT_ALL) };
+   if (!plugin || !mPlugin)
+   {
+      return plugin;
+   }
+
+   // Copy the program first, since selecting one may change the parameters
+   if (!plugin->getPrograms().empty())
+   {
+      plugin->selectProgram(mPlugin->getCurrentProgram());
+   }
+   for (const auto &descriptor : mPlugin->getParameterDescriptors())
+   {
+      plugin->setParameter(descriptor.identifier,
+                           mPlugin->getParameter(descriptor.identifier));
+   }
+
+   return plugin;
+}
+
 void VampEffect::AddFeatures(LabelTrack *ltrack,
-                             Vamp::Plugin::FeatureSet &features)
+                             const Vamp::Plugin::FeatureList &features)
 {
-   for (Vamp::Plugin::FeatureList::iterator fli = features[mOutput].begin();
-        fli != features[mOutput].end(); ++fli)
+   for (auto fli = features.begin(); fli != features.end(); ++fli)
    {
       Vamp::RealTime ftime0 = fli->timestamp;
       double ltime0 = ftime0.sec + (double(ftime0.nsec) / 1000000000.0);
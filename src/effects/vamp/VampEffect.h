@@ -69,7 +69,6 @@ public:
 
    bool Init() override;
    bool Process() override;
-   void End() override;
    void PopulateOrExchange(ShuttleGui & S) override;
    bool TransferDataToWindow() override;
    bool TransferDataFromWindow() override;
@@ -77,7 +76,11 @@ public:
 private:
    // VampEffect implemetation
 
-   void AddFeatures(LabelTrack *track, Vamp::Plugin::FeatureSet & features);
+   // A new instance of the plugin at mRate, with the parameters of mPlugin
+   std::unique_ptr<Vamp::Plugin> NewInstance();
+
+   void AddFeatures(LabelTrack *track,
+                    const Vamp::Plugin::FeatureList & features);
 
    void UpdateFromPlugin();
 
@@ -44,6 +44,9 @@
 #include <wx/dcmemory.h>
 #include <wx/window.h>
 
+#include <atomic>
+#include <thread>
+
 #include "ExportPCM.h"
 #include "ExportMP3.h"
 #include "ExportOGG.h"
@@ -51,6 +54,7 @@
 #include "ExportCL.h"
 #include "ExportMP2.h"
 #include "ExportFFmpeg.h"
+#include "SharedMix.h"
 
 #include "sndfile.h"
 
@@ -231,6 +235,15 @@ wxWindow *ExportPlugin::OptionsCreate(wxWindow *parent, int WXUNUSED(format))
    return p;
 }
 
+ProgressResult ExportPlugin::ExportConcurrently(
+   const ConcurrentJob & WXUNUSED(job),
+   const ConcurrentProgress & WXUNUSED(progress), wxString &error)
+{
+   // Not called unless SupportsConcurrentExport() is overridden
+   error = _("Unable to export");
+   return ProgressResult::Cancelled;
+}
+
 //Create a mixer by computing the time warp factor
 std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const WaveTrackConstArray &inputTracks,
          const TimeTrack *timeTrack,
@@ -250,6 +263,30 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const WaveTrackConstArray &inpu
                   highQuality, mixerSpec);
 }
 
+std::unique_ptr<PipelinedMixer> ExportPlugin::CreatePipelinedMixer(
+         const WaveTrackConstArray &inputTracks,
+         const TimeTrack *timeTrack,
+         double startTime, double stopTime,
+         unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
+         double outRate, sampleFormat outFormat,
+         bool highQuality, MixerSpec *mixerSpec, size_t depth)
+{
+   // In an export to several files at once, convert the one mix of all
+   if (!mixerSpec && highQuality) {
+      size_t consumer;
+      if (auto mix = SharedMix::Take(
+            numOutChannels, outRate, startTime, stopTime, consumer))
+         return std::make_unique<PipelinedMixer>(mix, consumer,
+            numOutChannels, outBufferSize, outInterleaved, outFormat, depth);
+   }
+
+   return std::make_unique<PipelinedMixer>(
+      CreateMixer(inputTracks, timeTrack, startTime, stopTime,
+                  numOutChannels, outBufferSize, outInterleaved,
+                  outRate, outFormat, highQuality, mixerSpec),
+      numOutChannels, outBufferSize, outInterleaved, outFormat, depth);
+}
+
 void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
    const wxString &title, const wxString &message)
 {
@@ -392,6 +429,13 @@ bool Exporter::Process(AudacityProject *project, unsigned numChannels,
    mT1 = t1;
    mActualName = mFilename;
 
+   return FindFormat(type, mFormat, mSubFormat) &&
+      CheckFilename() && ExportTracks();
+}
+
+bool Exporter::FindFormat(
+   const wxString &type, int &format, int &subFormat) const
+{
    int i = -1;
    for (const auto &pPlugin : mPlugins) {
       ++i;
@@ -399,16 +443,195 @@ bool Exporter::Process(AudacityProject *project, unsigned numChannels,
       {
          if (pPlugin->GetFormat(j).IsSameAs(type, false))
          {
-            mFormat = i;
-            mSubFormat = j;
-            return CheckFilename() && ExportTracks();
+            format = i;
+            subFormat = j;
+            return true;
          }
       }
    }
-
    return false;
 }
 
+namespace {
+   // Keep any file of the name, in case of failure
+   void BackUpFile(const wxFileName &actualName, const wxFileName &backup)
+   {
+      if (actualName != backup)
+         ::wxRenameFile(actualName.GetFullPath(), backup.GetFullPath());
+   }
+
+   void FinishFile(bool success,
+                   const wxFileName &actualName, const wxFileName &backup)
+   {
+      if (actualName != backup) {
+         // Remove backup
+         if ( success )
+            ::wxRemoveFile(backup.GetFullPath());
+         else {
+            // Restore original, if needed
+            ::wxRemoveFile(actualName.GetFullPath());
+            ::wxRenameFile(backup.GetFullPath(), actualName.GetFullPath());
+         }
+      }
+      else {
+         if ( ! success )
+            // Remove any new, and only partially written, file.
+            ::wxRemoveFile(actualName.GetFullPath());
+      }
+   }
+}
+
+bool Exporter::ProcessFanOut(AudacityProject *project, unsigned numChannels,
+                             const std::vector< Target > &targets,
+                             bool selectedOnly, double t0, double t1)
+{
+   mProject = project;
+   mSelectedOnly = selectedOnly;
+   mT0 = t0;
+   mT1 = t1;
+
+   if (numChannels == 0) {
+      // Down-mix, as CheckMix() does by default
+      if (!ExamineTracks())
+         return false;
+      numChannels = (mNumRight > 0 || mNumLeft > 0) ? 2 : 1;
+      t0 = mT0, t1 = mT1;
+   }
+
+   struct File { int format; wxFileName backup, actualName; };
+   std::vector<File> files;
+   std::vector<ExportPlugin::ConcurrentJob> jobs;
+   bool success = true;
+
+   const auto tracks = project->GetTracks();
+   ExportPlugin::ConcurrentJob job;
+   job.tracks = tracks->GetWaveTrackConstArray(selectedOnly, false);
+   job.timeTrack = tracks->GetTimeTrack();
+   job.rate = project->GetRate();
+   job.channels = numChannels;
+   job.t0 = t0;
+   job.t1 = t1;
+   job.tags = *project->GetTags();
+
+   for (const auto &target : targets) {
+      int format, subFormat;
+      if (!FindFormat(target.first, format, subFormat)) {
+         success = false;
+         continue;
+      }
+      if (job.tracks.empty() ||
+          numChannels > mPlugins[format]->GetMaxChannels(subFormat) ||
+          !mPlugins[format]->SupportsConcurrentExport(subFormat)) {
+         success = Process(project, numChannels, target.first.c_str(),
+            target.second,
+            selectedOnly, t0, t1) && success;
+         continue;
+      }
+
+      mFormat = format;
+      mSubFormat = subFormat;
+      mFilename = target.second;
+      if (!CheckFilename()) {
+         success = false;
+         continue;
+      }
+      files.push_back({ format, mFilename, mActualName });
+      job.fName = mActualName.GetFullPath();
+      job.subformat = subFormat;
+      jobs.push_back(job);
+   }
+
+   const auto count = jobs.size();
+   if (count == 0)
+      return success;
+
+   // The tracks are read and mixed once, in floats, for all the files
+   std::shared_ptr<SharedMix> mix;
+   if (count > 1)
+      mix = std::make_shared<SharedMix>(
+         std::make_unique<Mixer>(job.tracks,
+            // Throw, to stop exporting, if read fails:
+            true,
+            Mixer::WarpOptions(job.timeTrack),
+            t0, t1,
+            numChannels, SharedMix::DefaultChunkSize, true,
+            job.rate, floatSample, true, nullptr),
+         numChannels, job.rate, t0, t1, count);
+
+   std::vector<ProgressResult> results(count, ProgressResult::Cancelled);
+   std::vector<wxString> errors(count);
+   std::vector<std::exception_ptr> exceptions(count);
+   {
+      for (const auto &file : files)
+         BackUpFile(file.actualName, file.backup);
+      auto cleanup = finally( [&] {
+         for (size_t ii = 0; ii < count; ++ii)
+            FinishFile(results[ii] == ProgressResult::Success ||
+                          results[ii] == ProgressResult::Stopped,
+                       files[ii].actualName, files[ii].backup);
+      } );
+
+      ProgressDialog progress(_("Export"),
+         wxString::Format(_("Exporting %d files"), (int)count));
+
+      // The jobs see the latest answer of the dialog
+      std::atomic<ProgressResult> latest{ ProgressResult::Success };
+      std::vector< std::atomic<double> > fractions(count);
+      for (auto &fraction : fractions)
+         fraction.store(0.0);
+      std::atomic<size_t> running{ count };
+
+      // All must run at once, because they take turns with the mix
+      std::vector<std::thread> threads;
+      for (size_t ii = 0; ii < count; ++ii)
+         threads.emplace_back([&, ii] {
+            try {
+               std::unique_ptr<SharedMix::Offer> offer;
+               if (mix)
+                  offer = std::make_unique<SharedMix::Offer>(mix, ii);
+               results[ii] = mPlugins[files[ii].format]->ExportConcurrently(
+                  jobs[ii],
+                  [&](double fraction) {
+                     fractions[ii].store(fraction);
+                     return latest.load();
+                  },
+                  errors[ii]);
+            }
+            catch (...) {
+               exceptions[ii] = std::current_exception();
+            }
+            fractions[ii].store(1.0);
+            --running;
+         });
+      while (running.load() > 0) {
+         ::wxMilliSleep(50);
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (latest.load() == ProgressResult::Success)
+            latest.store(progress.Update(sum, (double)count));
+      }
+      for (auto &thread : threads)
+         thread.join();
+   }
+
+   for (const auto &exception : exceptions)
+      if (exception)
+         std::rethrow_exception(exception);
+
+   for (size_t ii = 0; ii < count; ++ii) {
+      const auto result = results[ii];
+      if (result != ProgressResult::Success &&
+          result != ProgressResult::Stopped) {
+         if (!errors[ii].empty())
+            AudacityMessageBox(errors[ii]);
+         success = false;
+      }
+   }
+
+   return success;
+}
+
 bool Exporter::ExamineTracks()
 {
    // Init
@@ -832,28 +1055,12 @@ bool Exporter::CheckMix()
 bool Exporter::ExportTracks()
 {
    // Keep original in case of failure
-   if (mActualName != mFilename) {
-      ::wxRenameFile(mActualName.GetFullPath(), mFilename.GetFullPath());
-   }
+   BackUpFile(mActualName, mFilename);
 
    bool success = false;
 
    auto cleanup = finally( [&] {
-      if (mActualName != mFilename) {
-         // Remove backup
-         if ( success )
-            ::wxRemoveFile(mFilename.GetFullPath());
-         else {
-            // Restore original, if needed
-            ::wxRemoveFile(mActualName.GetFullPath());
-            ::wxRenameFile(mFilename.GetFullPath(), mActualName.GetFullPath());
-         }
-      }
-      else {
-         if ( ! success )
-            // Remove any new, and only partially written, file.
-            ::wxRemoveFile(mFilename.GetFullPath());
-      }
+      FinishFile(success, mActualName, mFilename);
    } );
 
    std::unique_ptr<ProgressDialog> pDialog;
@@ -12,6 +12,7 @@
 #define __AUDACITY_EXPORT__
 
 #include "../MemoryX.h"
+#include <functional>
 #include <vector>
 #include <wx/dialog.h>
 #include <wx/filename.h>
@@ -19,6 +20,7 @@
 #include "../Tags.h"
 #include "../SampleFormat.h"
 #include "../widgets/wxPanelWrapper.h"
+#include "PipelinedMixer.h"
 
 class FileDialogWrapper;
 class wxFileCtrlEvent;
@@ -130,6 +132,37 @@ public:
                        const Tags *metadata = NULL,
                        int subformat = 0) = 0;
 
+   /** \brief What ExportConcurrently() needs, gathered on the main thread,
+    * so that it uses neither the project nor the selection */
+   struct ConcurrentJob
+   {
+      WaveTrackConstArray tracks; /**< All to be mixed */
+      const TimeTrack *timeTrack;
+      double rate;
+      unsigned channels;
+      wxString fName;
+      double t0;
+      double t1;
+      Tags tags;
+      int subformat;
+   };
+
+   /** \brief Takes the fraction of a job done, and gives the latest result
+    * of the dialog that shows the progress of all of them */
+   using ConcurrentProgress = std::function< ProgressResult(double fraction) >;
+
+   /** \brief Whether ExportConcurrently() can export the sub-format */
+   virtual bool SupportsConcurrentExport(int WXUNUSED(subformat))
+   { return false; }
+
+   /** \brief Like Export(), but may run on a worker thread, at the same time
+    * as other jobs.  So it shows nothing, but reports progress to the
+    * callback, and puts any message for the user into error.
+    * Might throw, as Export() does. */
+   virtual ProgressResult ExportConcurrently(const ConcurrentJob &job,
+                       const ConcurrentProgress &progress,
+                       wxString &error);
+
 protected:
    std::unique_ptr<Mixer> CreateMixer(const WaveTrackConstArray &inputTracks,
          const TimeTrack *timeTrack,
@@ -138,6 +171,17 @@ protected:
          double outRate, sampleFormat outFormat,
          bool highQuality = true, MixerSpec *mixerSpec = NULL);
 
+   // Like CreateMixer, but the mixer runs on a thread of its own, up to
+   // depth buffers ahead of the caller, which encodes meanwhile
+   std::unique_ptr<PipelinedMixer> CreatePipelinedMixer(
+         const WaveTrackConstArray &inputTracks,
+         const TimeTrack *timeTrack,
+         double startTime, double stopTime,
+         unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
+         double outRate, sampleFormat outFormat,
+         bool highQuality = true, MixerSpec *mixerSpec = NULL,
+         size_t depth = PipelinedMixer::DefaultDepth);
+
    // Create or recycle a dialog.
    static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
          const wxString &title, const wxString &message);
@@ -169,6 +213,15 @@ public:
                 const wxChar *type, const wxString & filename,
                 bool selectedOnly, double t0, double t1);
 
+   /// A format, named as for Process(), and the file to export to
+   using Target = std::pair< wxString, wxString >;
+   /// Like Process(), but to several files.  Those of formats that can
+   /// export concurrently are encoded at once, on threads of their own,
+   /// from one mix of the tracks; the others are exported one by one.
+   bool ProcessFanOut(AudacityProject *project, unsigned numChannels,
+                      const std::vector< Target > &targets,
+                      bool selectedOnly, double t0, double t1);
+
    void DisplayOptions(int index);
    int FindFormatIndex(int exportindex);
 
@@ -190,6 +243,7 @@ public:
    wxFileName GetAutoExportFileName();
 
 private:
+   bool FindFormat(const wxString &type, int &format, int &subFormat) const;
    bool ExamineTracks();
    bool GetFilename();
    bool CheckFilename();
@@ -23,6 +23,10 @@
 #include <wx/process.h>
 #include <wx/sizer.h>
 #include <wx/textctrl.h>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
 #include "../FileNames.h"
 #include "Export.h"
 
@@ -209,6 +213,59 @@ static void Drain(wxInputStream *s, wxString *o)
    }
 }
 
+// Writes at most this much at once; a pipe takes what it has room for
+static const size_t PipeWriteSize = 65536;
+
+// Copies the mix to the command until the end, or until stopping.  Runs on
+// a thread of its own, so that the command is fed as fast as it reads,
+// while the mixer works ahead on its own.  Returns false if the pipe fails.
+static bool PipeSamples(PipelinedMixer &mixer, size_t maxBlockLen,
+                        unsigned channels, wxOutputStream &os,
+                        const std::atomic<bool> &stopping,
+                        std::atomic<size_t> &samplesWritten)
+{
+   while (!stopping.load()) {
+      auto numSamples = mixer.Process(maxBlockLen);
+      if (numSamples == 0) {
+         return true;
+      }
+
+      samplePtr mixed = mixer.GetBuffer();
+      size_t numBytes = numSamples * channels;
+
+      // Byte-swapping is neccesary on big-endian machines, since
+      // WAV files are little-endian
+#if wxBYTE_ORDER == wxBIG_ENDIAN
+      wxUint16 *buffer = (wxUint16 *) mixed;
+      for (int i = 0; i < numBytes; i++) {
+         buffer[i] = wxUINT16_SWAP_ON_BE(buffer[i]);
+      }
+#endif
+      numBytes *= SAMPLE_SIZE(int16Sample);
+
+      while (numBytes > 0) {
+         if (stopping.load()) {
+            return true;
+         }
+         os.Write(mixed, wxMin(numBytes, PipeWriteSize));
+         if (!os.IsOk()) {
+            return false;
+         }
+         const auto written = os.LastWrite();
+         if (written == 0) {
+            // The pipe is full; the command is busy
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+         }
+         numBytes -= written;
+         mixed += written;
+      }
+
+      samplesWritten += numSamples;
+   }
+   return true;
+}
+
 class ExportCLProcess final : public wxProcess
 {
 public:
@@ -426,7 +483,7 @@ ProgressResult ExportCL::Export(AudacityProject *project,
    const TrackList *tracks = project->GetTracks();
    const WaveTrackConstArray waveTracks =
       tracks->GetWaveTrackConstArray(selectionOnly, false);
-   auto mixer = CreateMixer(
+   auto mixer = CreatePipelinedMixer(
                             waveTracks,
                             tracks->GetTimeTrack(),
                             t0,
@@ -439,8 +496,6 @@ ProgressResult ExportCL::Export(AudacityProject *project,
                             true,
                             mixerSpec);
 
-   size_t numBytes = 0;
-   samplePtr mixed = NULL;
    auto updateResult = ProgressResult::Success;
 
    {
@@ -456,49 +511,50 @@ ProgressResult ExportCL::Export(AudacityProject *project,
             : _("Exporting the audio using command-line encoder") );
       auto &progress = *pDialog;
 
-      // Start piping the mixed data to the command
-      while (updateResult == ProgressResult::Success && process.IsActive() && os->IsOk()) {
-         // Capture any stdout and stderr from the command
-         Drain(process.GetInputStream(), &output);
-         Drain(process.GetErrorStream(), &output);
-
-         // Need to mix another block
-         if (numBytes == 0) {
-            auto numSamples = mixer->Process(maxBlockLen);
-            if (numSamples == 0) {
-               break;
-            }
-
-            mixed = mixer->GetBuffer();
-            numBytes = numSamples * channels;
-
-            // Byte-swapping is neccesary on big-endian machines, since
-            // WAV files are little-endian
-#if wxBYTE_ORDER == wxBIG_ENDIAN
-            wxUint16 *buffer = (wxUint16 *) mixed;
-            for (int i = 0; i < numBytes; i++) {
-               buffer[i] = wxUINT16_SWAP_ON_BE(buffer[i]);
-            }
-#endif
-            numBytes *= SAMPLE_SIZE(int16Sample);
+      // Start piping the mixed data to the command, while this thread
+      // gathers its output, so that a full stderr pipe never stalls it
+      std::atomic<bool> stopping{ false };
+      std::atomic<bool> writing{ true };
+      std::atomic<size_t> samplesWritten{ 0 };
+      bool pipeOk = true;
+      std::exception_ptr exception;
+      std::thread writer{ [&] {
+         // Logging is turned off for each thread
+         wxLogNull nolog;
+         try {
+            pipeOk = PipeSamples(*mixer, maxBlockLen, channels, *os,
+                                 stopping, samplesWritten);
+         }
+         catch (...) {
+            exception = std::current_exception();
          }
+         writing.store(false);
+      } };
 
-         // Don't write too much at once...pipes may not be able to handle it
-         size_t bytes = wxMin(numBytes, 4096);
-         numBytes -= bytes;
-
-         while (bytes > 0) {
-            os->Write(mixed, bytes);
-            if (!os->IsOk()) {
-               updateResult = ProgressResult::Cancelled;
-               break;
-            }
-            bytes -= os->LastWrite();
-            mixed += os->LastWrite();
+      {
+         auto joinIt = finally( [&] {
+            stopping.store(true);
+            writer.join();
+         } );
+
+         while (updateResult == ProgressResult::Success && process.IsActive() &&
+                writing.load()) {
+            // Capture any stdout and stderr from the command
+            Drain(process.GetInputStream(), &output);
+            Drain(process.GetErrorStream(), &output);
+
+            // Update the progress display
+            updateResult = progress.Update(
+               double(samplesWritten.load()) / rate, t1 - t0);
+            wxMilliSleep(10);
          }
+      }
 
-         // Update the progress display
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+      if (exception) {
+         std::rethrow_exception(exception);
+      }
+      if (!pipeOk && updateResult == ProgressResult::Success) {
+         updateResult = ProgressResult::Cancelled;
       }
       // Done with the progress display
    }
@@ -112,8 +112,8 @@ public:
    /// Sets individual metadata values
    void SetMetadata(const Tags *tags, const char *name, const wxChar *tag);
 
-   /// Encodes audio
-   bool EncodeAudioFrame(int16_t *pFrame, size_t frameSize);
+   /// Encodes the samples the mixer just made, as many frames as they fill
+   bool EncodeAudioFrames(Mixer &mixer, size_t length);
 
    /// Flushes audio encoder
    bool Finalize();
@@ -156,7 +156,11 @@ private:
    AVOutputFormat  *   mEncFormatDesc{};       // describes our output file to libavformat
    int               default_frame_size{};
    AVStream        *   mEncAudioStream{};      // the output audio stream (may remain NULL)
-   int               mEncAudioFifoOutBufSiz{};
+   int               mEncAudioFrameFilled{}; // samples in mEncAudioFrame so far
+
+   // The mixer makes the encoder's format, or one that converts to it simply
+   sampleFormat      mMixerFormat{ int16Sample };
+   bool              mMixerInterleaved{ true };
 
    wxString          mName;
 
@@ -166,9 +170,15 @@ private:
    unsigned          mChannels{};
    bool              mSupportsUTF8{};
 
+   /// Copies samples of the mixer's buffers to the frame, after those it has
+   void CopyToFrame(Mixer &mixer, size_t from, size_t count);
+   /// Encodes the frame, or flushes the encoder if NULL, and writes the
+   /// packet.  Returns 0 if there was none, 1 if there was, negative on error.
+   int EncodeAndWrite(AVFrame *frame);
+
    // Smart pointer fields, their order is the reverse in which they are reset in FreeResources():
-   AVFifoBufferHolder   mEncAudioFifo;          // FIFO to write incoming audio samples into
-   AVMallocHolder<int16_t> mEncAudioFifoOutBuf;  // buffer to read _out_ of the FIFO into
+   AVFrameHolder        mEncAudioFrame;         // filled from the mixer and encoded, again and again
+   AVMallocHolder<uint8_t> mEncAudioFrameBuf;   // the samples of mEncAudioFrame
    AVFormatContextHolder mEncFormatCtx;        // libavformat's context for our output file
    UFileHolder          mUfileCloser;
    AVCodecContextHolder mEncAudioCodecCtx;    // the encoder for the output audio stream
@@ -179,8 +189,7 @@ ExportFFmpeg::ExportFFmpeg()
 {
    mEncFormatDesc = NULL;      // describes our output file to libavformat
    mEncAudioStream = NULL;     // the output audio stream (may remain NULL)
-   #define MAX_AUDIO_PACKET_SIZE (128 * 1024)
-   mEncAudioFifoOutBufSiz = 0;
+   mEncAudioFrameFilled = 0;
 
    mSampleRate = 0;
    mSupportsUTF8 = true;
@@ -538,116 +547,83 @@ bool ExportFFmpeg::InitCodecs(AudacityProject *project)
 
    wxLogDebug(wxT("FFmpeg : Audio Output Codec Frame Size: %d samples."), mEncAudioCodecCtx->frame_size);
 
-   // The encoder may require a minimum number of raw audio samples for each encoding but we can't
-   // guarantee we'll get this minimum each time an audio frame is decoded from the input file so
-   // we use a FIFO to store up incoming raw samples until we have enough for one call to the codec.
-   mEncAudioFifo.reset(av_fifo_alloc(1024));
+   // The mixer makes samples of the encoder's format when it can, planar
+   // if the encoder's are, so that frames are filled by copying
+   const auto fmt = mEncAudioCodecCtx->sample_fmt;
+   switch (fmt) {
+   case AV_SAMPLE_FMT_FLT:
+   case AV_SAMPLE_FMT_FLTP:
+      mMixerFormat = floatSample;
+      break;
+   case AV_SAMPLE_FMT_S32:
+   case AV_SAMPLE_FMT_S32P:
+      mMixerFormat = int24Sample;
+      break;
+   default:
+      mMixerFormat = int16Sample;
+      break;
+   }
+   mMixerInterleaved = !(fmt == AV_SAMPLE_FMT_U8P || fmt == AV_SAMPLE_FMT_S16P ||
+                         fmt == AV_SAMPLE_FMT_S32P || fmt == AV_SAMPLE_FMT_FLTP);
 
-   mEncAudioFifoOutBufSiz = 2*MAX_AUDIO_PACKET_SIZE;
-   // Allocate a buffer to read OUT of the FIFO into. The FIFO maintains its own buffer internally.
-   mEncAudioFifoOutBuf.reset(static_cast<int16_t*>(av_malloc(mEncAudioFifoOutBufSiz)));
-   if (!mEncAudioFifoOutBuf)
-   {
+   // The encoder takes a frame of samples at a time, but the mixer may give
+   // fewer or more, so its samples are gathered in one frame made here
+   mEncAudioFrame.reset(av_frame_alloc());
+   if (!mEncAudioFrame) {
       AudacityMessageBox(
-         _("FFmpeg : ERROR - Can't allocate buffer to read into from audio FIFO."),
+         _("FFmpeg : ERROR - Could not setup audio frame"),
          _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
       );
       return false;
    }
+   AVFrame *frame = mEncAudioFrame.get();
+   frame->nb_samples     = default_frame_size;
+   frame->format         = fmt;
+#if !defined(DISABLE_DYNAMIC_LOADING_FFMPEG) || (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(54, 13, 0))
+   frame->channel_layout = mEncAudioCodecCtx->channel_layout;
+#endif
+
+   const int buffer_size = av_samples_get_buffer_size(NULL, mChannels,
+      default_frame_size, fmt, 0);
+   if (buffer_size < 0) {
+      AudacityMessageBox(
+         _("FFmpeg : ERROR - Could not get sample buffer size"),
+         _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
+      );
+      return false;
+   }
+   mEncAudioFrameBuf.reset(static_cast<uint8_t*>(av_malloc(buffer_size)));
+   if (!mEncAudioFrameBuf) {
+      AudacityMessageBox(
+         _("FFmpeg : ERROR - Could not allocate bytes for samples buffer"),
+         _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
+      );
+      return false;
+   }
+   if (avcodec_fill_audio_frame(frame, mChannels, fmt,
+                                mEncAudioFrameBuf.get(), buffer_size, 0) < 0) {
+      AudacityMessageBox(
+         _("FFmpeg : ERROR - Could not setup audio frame"),
+         _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
+      );
+      return false;
+   }
+   mEncAudioFrameFilled = 0;
 
    return true;
 }
 
 // Returns 0 if no more output, 1 if more output, negative if error
-static int encode_audio(AVCodecContext *avctx, AVPacket *pkt, int16_t *audio_samples, int nb_samples)
+static int encode_audio(AVCodecContext *avctx, AVPacket *pkt, AVFrame *frame)
 {
    // Assume *pkt is already initialized.
 
-   int i, ch, buffer_size, ret, got_output = 0;
-   AVMallocHolder<uint8_t> samples;
-   AVFrameHolder frame;
-
-   if (audio_samples) {
-      frame.reset(av_frame_alloc());
-      if (!frame)
-         return AVERROR(ENOMEM);
-
-      frame->nb_samples     = nb_samples;
-      frame->format         = avctx->sample_fmt;
-#if !defined(DISABLE_DYNAMIC_LOADING_FFMPEG) || (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(54, 13, 0))
-      frame->channel_layout = avctx->channel_layout;
-#endif
-
-      buffer_size = av_samples_get_buffer_size(NULL, avctx->channels, frame->nb_samples,
-                                              avctx->sample_fmt, 0);
-      if (buffer_size < 0) {
-         AudacityMessageBox(
-            _("FFmpeg : ERROR - Could not get sample buffer size"),
-            _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
-         );
-         return buffer_size;
-      }
-      samples.reset(static_cast<uint8_t*>(av_malloc(buffer_size)));
-      if (!samples) {
-         AudacityMessageBox(
-            _("FFmpeg : ERROR - Could not allocate bytes for samples buffer"),
-            _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
-         );
-         return AVERROR(ENOMEM);
-      }
-      /* setup the data pointers in the AVFrame */
-      ret = avcodec_fill_audio_frame(frame.get(), avctx->channels, avctx->sample_fmt,
-                                  samples.get(), buffer_size, 0);
-      if (ret < 0) {
-         AudacityMessageBox(
-            _("FFmpeg : ERROR - Could not setup audio frame"),
-            _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
-         );
-         return ret;
-      }
-
-      for (ch = 0; ch < avctx->channels; ch++) {
-         for (i = 0; i < frame->nb_samples; i++) {
-            switch(avctx->sample_fmt) {
-            case AV_SAMPLE_FMT_U8:
-               ((uint8_t*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels]/258 + 128;
-               break;
-            case AV_SAMPLE_FMT_U8P:
-               ((uint8_t*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels]/258 + 128;
-               break;
-            case AV_SAMPLE_FMT_S16:
-               ((int16_t*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels];
-               break;
-            case AV_SAMPLE_FMT_S16P:
-               ((int16_t*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels];
-               break;
-            case AV_SAMPLE_FMT_S32:
-               ((int32_t*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels]<<16;
-               break;
-            case AV_SAMPLE_FMT_S32P:
-               ((int32_t*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels]<<16;
-               break;
-            case AV_SAMPLE_FMT_FLT:
-               ((float*)(frame->data[0]))[ch + i*avctx->channels] = audio_samples[ch + i*avctx->channels] / 32767.0;
-               break;
-            case AV_SAMPLE_FMT_FLTP:
-               ((float*)(frame->data[ch]))[i] = audio_samples[ch + i*avctx->channels] / 32767.;
-               break;
-            case AV_SAMPLE_FMT_NONE:
-            case AV_SAMPLE_FMT_DBL:
-            case AV_SAMPLE_FMT_DBLP:
-            case AV_SAMPLE_FMT_NB:
-               wxASSERT(false);
-               break;
-            }
-         }
-      }
-   }
+   int ret, got_output = 0;
 
    pkt->data = NULL; // packet data will be allocated by the encoder
    pkt->size = 0;
 
-   ret = avcodec_encode_audio2(avctx, pkt, frame.get(), &got_output);
+   ret = avcodec_encode_audio2(avctx, pkt, frame, &got_output);
    if (ret < 0) {
       AudacityMessageBox(
          _("FFmpeg : ERROR - encoding frame failed"),
@@ -661,66 +637,133 @@ static int encode_audio(AVCodecContext *avctx, AVPacket *pkt, int16_t *audio_sam
    return got_output;
 }
 
-
-bool ExportFFmpeg::Finalize()
+int ExportFFmpeg::EncodeAndWrite(AVFrame *frame)
 {
-   // Flush the audio FIFO and encoder.
-   for (;;)
+   AVPacketEx pkt;
+
+   int ret = encode_audio(mEncAudioCodecCtx.get(), &pkt, frame);
+   if (ret <= 0)
+      return ret;
+
+   // Rescale from the codec time_base to the AVStream time_base.
+   if (pkt.pts != int64_t(AV_NOPTS_VALUE))
+      pkt.pts = av_rescale_q(pkt.pts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
+   if (pkt.dts != int64_t(AV_NOPTS_VALUE))
+      pkt.dts = av_rescale_q(pkt.dts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
+   if (pkt.duration)
+      pkt.duration = av_rescale_q(pkt.duration, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
+   //wxLogDebug(wxT("FFmpeg : (%d) Writing audio frame with PTS: %lld."), mEncAudioCodecCtx->frame_number, (long long) pkt.pts);
+
+   pkt.stream_index = mEncAudioStream->index;
+
+   // Write the encoded audio frame to the output file.
+   if (av_interleaved_write_frame(mEncFormatCtx.get(), &pkt) < 0)
    {
-      AVPacketEx pkt;
-      const int nFifoBytes = av_fifo_size(mEncAudioFifo.get()); // any bytes left in audio FIFO?
-      int encodeResult = 0;
+      AudacityMessageBox(
+         _("FFmpeg : ERROR - Failed to write audio frame to file."),
+         _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
+      );
+      return -1;
+   }
 
-      // Flush the audio FIFO first if necessary. It won't contain a _full_ audio frame because
-      // if it did we'd have pulled it from the FIFO during the last encodeAudioFrame() call
-      if (nFifoBytes > 0)
-      {
-         const int nAudioFrameSizeOut = default_frame_size * mEncAudioCodecCtx->channels * sizeof(int16_t);
-
-         if (nAudioFrameSizeOut > mEncAudioFifoOutBufSiz || nFifoBytes > mEncAudioFifoOutBufSiz) {
-            AudacityMessageBox(
-               _("FFmpeg : ERROR - Too much remaining data."),
-               _("FFmpeg Error"), wxOK | wxCENTER | wxICON_EXCLAMATION
-            );
-            return false;
-         }
+   return 1;
+}
 
-         // We have an incomplete buffer of samples left, encode it.
-         // If codec supports CODEC_CAP_SMALL_LAST_FRAME, we can feed it with smaller frame
-         // Or if frame_size is 1, then it's some kind of PCM codec, they don't have frames and will be fine with the samples
-         // Otherwise we'll send a full frame of audio + silence padding to ensure all audio is encoded
-         int frame_size = default_frame_size;
-         if (mEncAudioCodecCtx->codec->capabilities & AV_CODEC_CAP_SMALL_LAST_FRAME ||
-             frame_size == 1)
-            frame_size = nFifoBytes / (mEncAudioCodecCtx->channels * sizeof(int16_t));
-
-         wxLogDebug(wxT("FFmpeg : Audio FIFO still contains %d bytes, writing %d sample frame ..."),
-            nFifoBytes, frame_size);
-
-         // Fill audio buffer with zeroes. If codec tries to read the whole buffer,
-         // it will just read silence. If not - who cares?
-         memset(mEncAudioFifoOutBuf.get(), 0, mEncAudioFifoOutBufSiz);
-         //const AVCodec *codec = mEncAudioCodecCtx->codec;
-
-         // Pull the bytes out from the FIFO and feed them to the encoder.
-         if (av_fifo_generic_read(mEncAudioFifo.get(), mEncAudioFifoOutBuf.get(), nFifoBytes, NULL) == 0)
-         {
-            encodeResult = encode_audio(mEncAudioCodecCtx.get(), &pkt, mEncAudioFifoOutBuf.get(), frame_size);
+void ExportFFmpeg::CopyToFrame(Mixer &mixer, size_t from, size_t count)
+{
+   AVFrame *frame = mEncAudioFrame.get();
+   const size_t channels = mChannels;
+   const size_t to = mEncAudioFrameFilled;
+   const auto fmt = mEncAudioCodecCtx->sample_fmt;
+
+   // Formats the mixer makes are copied as they are
+   if (fmt == AV_SAMPLE_FMT_S16 || fmt == AV_SAMPLE_FMT_FLT) {
+      const auto size = channels * SAMPLE_SIZE(mMixerFormat);
+      memcpy(frame->data[0] + to * size, mixer.GetBuffer() + from * size,
+             count * size);
+      return;
+   }
+   if (fmt == AV_SAMPLE_FMT_S16P || fmt == AV_SAMPLE_FMT_FLTP) {
+      const auto size = SAMPLE_SIZE(mMixerFormat);
+      for (size_t ch = 0; ch < channels; ch++)
+         memcpy(frame->data[ch] + to * size, mixer.GetBuffer(ch) + from * size,
+                count * size);
+      return;
+   }
+
+   for (size_t ch = 0; ch < channels; ch++) {
+      const size_t stride = mMixerInterleaved ? channels : 1;
+      const samplePtr buffer = mMixerInterleaved
+         ? mixer.GetBuffer() + ch * SAMPLE_SIZE(mMixerFormat)
+         : mixer.GetBuffer(ch);
+      for (size_t i = 0; i < count; i++) {
+         const size_t src = (from + i) * stride;
+         switch (fmt) {
+         case AV_SAMPLE_FMT_U8:
+            ((uint8_t*)(frame->data[0]))[ch + (to + i)*channels] = ((int16_t*)buffer)[src]/258 + 128;
+            break;
+         case AV_SAMPLE_FMT_U8P:
+            ((uint8_t*)(frame->data[ch]))[to + i] = ((int16_t*)buffer)[src]/258 + 128;
+            break;
+         case AV_SAMPLE_FMT_S32:
+            // From 24 bits
+            ((int32_t*)(frame->data[0]))[ch + (to + i)*channels] = ((int*)buffer)[src] * 256;
+            break;
+         case AV_SAMPLE_FMT_S32P:
+            ((int32_t*)(frame->data[ch]))[to + i] = ((int*)buffer)[src] * 256;
+            break;
+         default:
+            wxASSERT(false);
+            break;
          }
+      }
+   }
+}
+
+bool ExportFFmpeg::Finalize()
+{
+   // Encode what is left in the frame, less than a frame.
+   // If codec supports CODEC_CAP_SMALL_LAST_FRAME, we can feed it with smaller frame
+   // Or if frame_size is 1, then it's some kind of PCM codec, they don't have frames and will be fine with the samples
+   // Otherwise we'll send a full frame of audio + silence padding to ensure all audio is encoded
+   if (mEncAudioFrameFilled > 0)
+   {
+      AVFrame *frame = mEncAudioFrame.get();
+      const auto fmt = mEncAudioCodecCtx->sample_fmt;
+
+      wxLogDebug(wxT("FFmpeg : Audio frame still contains %d samples ..."),
+         mEncAudioFrameFilled);
+
+      if (mEncAudioCodecCtx->codec->capabilities & AV_CODEC_CAP_SMALL_LAST_FRAME ||
+          default_frame_size == 1)
+         frame->nb_samples = mEncAudioFrameFilled;
+      else {
+         // Unsigned samples are silent at half their range
+         const int silence =
+            (fmt == AV_SAMPLE_FMT_U8 || fmt == AV_SAMPLE_FMT_U8P) ? 0x80 : 0;
+         const int size = av_get_bytes_per_sample(fmt);
+         const int rest = default_frame_size - mEncAudioFrameFilled;
+         if (mMixerInterleaved)
+            memset(frame->data[0] + mEncAudioFrameFilled * size * mChannels,
+                   silence, rest * size * mChannels);
          else
-         {
-            wxLogDebug(wxT("FFmpeg : Reading from Audio FIFO failed, aborting"));
-            // TODO: more precise message
-            AudacityMessageBox(_("Unable to export"));
-            return false;
-         }
+            for (unsigned ch = 0; ch < mChannels; ch++)
+               memset(frame->data[ch] + mEncAudioFrameFilled * size,
+                      silence, rest * size);
       }
-      else
-      {
-         // Fifo is empty, flush encoder. May be called multiple times.
-         encodeResult = encode_audio(mEncAudioCodecCtx.get(), &pkt, NULL, 0);
+      mEncAudioFrameFilled = 0;
+
+      if (EncodeAndWrite(frame) < 0) {
+         // TODO: more precise message
+         AudacityMessageBox(_("Unable to export"));
+         return false;
       }
+   }
 
+   // Flush the encoder. May be called multiple times.
+   for (;;)
+   {
+      const int encodeResult = EncodeAndWrite(NULL);
       if (encodeResult < 0) {
          // TODO: more precise message
          AudacityMessageBox(_("Unable to export"));
@@ -728,26 +771,6 @@ bool ExportFFmpeg::Finalize()
       }
       else if (encodeResult == 0)
          break;
-
-      // We have a packet, send to the muxer
-      pkt.stream_index = mEncAudioStream->index;
-
-      // Set presentation time of frame (currently in the codec's timebase) in the stream timebase.
-      if (pkt.pts != int64_t(AV_NOPTS_VALUE))
-         pkt.pts = av_rescale_q(pkt.pts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-      if (pkt.dts != int64_t(AV_NOPTS_VALUE))
-         pkt.dts = av_rescale_q(pkt.dts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-      if (pkt.duration)
-         pkt.duration = av_rescale_q(pkt.duration, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-
-      if (av_interleaved_write_frame(mEncFormatCtx.get(), &pkt) != 0)
-      {
-         AudacityMessageBox(
-            _("FFmpeg : ERROR - Couldn't write last audio frame to output file."),
-            _("FFmpeg Error"), wxOK | wxCENTER | wxICON_EXCLAMATION
-         );
-         return false;
-      }
    }
 
    // Write any file trailers.
@@ -771,52 +794,29 @@ void ExportFFmpeg::FreeResources()
    // Free any buffers or structures we allocated.
    mEncFormatCtx.reset();
 
-   mEncAudioFifoOutBuf.reset();
-   mEncAudioFifoOutBufSiz = 0;
+   mEncAudioFrameBuf.reset();
+   mEncAudioFrameFilled = 0;
 
-   mEncAudioFifo.reset();
+   mEncAudioFrame.reset();
 
    av_log_set_callback(av_log_default_callback);
 }
 
-bool ExportFFmpeg::EncodeAudioFrame(int16_t *pFrame, size_t frameSize)
+bool ExportFFmpeg::EncodeAudioFrames(Mixer &mixer, size_t length)
 {
-   int nBytesToWrite = 0;
-   uint8_t *pRawSamples = NULL;
-   int nAudioFrameSizeOut = default_frame_size * mEncAudioCodecCtx->channels * sizeof(int16_t);
-   int ret;
-
-   nBytesToWrite = frameSize;
-   pRawSamples  = (uint8_t*)pFrame;
-   if (av_fifo_realloc2(mEncAudioFifo.get(), av_fifo_size(mEncAudioFifo.get()) + frameSize) < 0)
-      return false;
-
-   // Put the raw audio samples into the FIFO.
-   ret = av_fifo_generic_write(mEncAudioFifo.get(), pRawSamples, nBytesToWrite,NULL);
-
-   if(ret != nBytesToWrite)
-      return false;
-
-   if (nAudioFrameSizeOut > mEncAudioFifoOutBufSiz) {
-      AudacityMessageBox(
-         _("FFmpeg : ERROR - nAudioFrameSizeOut too large."),
-         _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
-      );
-      return false;
-   }
-
-   // Read raw audio samples out of the FIFO in nAudioFrameSizeOut byte-sized groups to encode.
-   while ((ret = av_fifo_size(mEncAudioFifo.get())) >= nAudioFrameSizeOut)
+   size_t done = 0;
+   while (done < length)
    {
-      ret = av_fifo_generic_read(mEncAudioFifo.get(), mEncAudioFifoOutBuf.get(), nAudioFrameSizeOut, NULL);
-
-      AVPacketEx pkt;
+      const size_t count =
+         std::min<size_t>(default_frame_size - mEncAudioFrameFilled, length - done);
+      CopyToFrame(mixer, done, count);
+      mEncAudioFrameFilled += count;
+      done += count;
+      if (mEncAudioFrameFilled < default_frame_size)
+         break;
 
-      int ret= encode_audio(mEncAudioCodecCtx.get(),
-         &pkt,                          // out
-         mEncAudioFifoOutBuf.get(), // in
-         default_frame_size);
-      if (ret < 0)
+      mEncAudioFrameFilled = 0;
+      if (EncodeAndWrite(mEncAudioFrame.get()) < 0)
       {
          AudacityMessageBox(
             _("FFmpeg : ERROR - Can't encode audio frame."),
@@ -824,27 +824,6 @@ bool ExportFFmpeg::EncodeAudioFrame(int16_t *pFrame, size_t frameSize)
          );
          return false;
       }
-      if (ret == 0)
-         continue;
-
-      // Rescale from the codec time_base to the AVStream time_base.
-      if (pkt.pts != int64_t(AV_NOPTS_VALUE))
-         pkt.pts = av_rescale_q(pkt.pts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-      if (pkt.dts != int64_t(AV_NOPTS_VALUE))
-         pkt.dts = av_rescale_q(pkt.dts, mEncAudioCodecCtx->time_base, mEncAudioStream->time_base);
-      //wxLogDebug(wxT("FFmpeg : (%d) Writing audio frame with PTS: %lld."), mEncAudioCodecCtx->frame_number, (long long) pkt.pts);
-
-      pkt.stream_index = mEncAudioStream->index;
-
-      // Write the encoded audio frame to the output file.
-      if ((ret = av_interleaved_write_frame(mEncFormatCtx.get(), &pkt)) < 0)
-      {
-         AudacityMessageBox(
-            _("FFmpeg : ERROR - Failed to write audio frame to file."),
-            _("FFmpeg Error"), wxOK|wxCENTER|wxICON_EXCLAMATION
-         );
-         return false;
-      }
    }
    return true;
 }
@@ -893,15 +872,16 @@ ProgressResult ExportFFmpeg::Export(AudacityProject *project,
       return ProgressResult::Cancelled;
    }
 
-   size_t pcmBufferSize = 1024;
+   // A frame at a time, if frames are not too small
+   size_t pcmBufferSize = std::max(default_frame_size, 1024);
 
    const WaveTrackConstArray waveTracks =
       tracks->GetWaveTrackConstArray(selectionOnly, false);
    auto mixer = CreateMixer(waveTracks,
       tracks->GetTimeTrack(),
       t0, t1,
-      channels, pcmBufferSize, true,
-      mSampleRate, int16Sample, true, mixerSpec);
+      channels, pcmBufferSize, mMixerInterleaved,
+      mSampleRate, mMixerFormat, true, mixerSpec);
 
    auto updateResult = ProgressResult::Success;
    {
@@ -919,10 +899,7 @@ ProgressResult ExportFFmpeg::Export(AudacityProject *project,
          if (pcmNumSamples == 0)
             break;
 
-         short *pcmBuffer = (short *)mixer->GetBuffer();
-
-         if (!EncodeAudioFrame(
-            pcmBuffer, (pcmNumSamples)*sizeof(int16_t)*mChannels)) {
+         if (!EncodeAudioFrames(*mixer, pcmNumSamples)) {
             // TODO: more precise message, and fix redundancy with messages
             // already given on some of the failure paths of the above call
             AudacityMessageBox(_("Unable to export"));
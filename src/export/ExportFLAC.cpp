@@ -28,6 +28,13 @@ and libvorbis examples, Monty <monty@xiph.org>
 #include <wx/progdlg.h>
 #include <wx/ffile.h>
 #include <wx/log.h>
+#include <wx/utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
 
 #include "FLAC++/encoder.h"
 
@@ -39,6 +46,7 @@ and libvorbis examples, Monty <monty@xiph.org>
 
 #include "../Internat.h"
 #include "../Tags.h"
+#include "../TaskScheduler.h"
 
 #include "../Track.h"
 #include "../widgets/ErrorDialog.h"
@@ -110,6 +118,13 @@ void ExportFLACOptions::PopulateOrExchange(ShuttleGui & S)
          S.EndMultiColumn();
       }
       S.EndHorizontalLay();
+      S.StartHorizontalLay(wxCENTER);
+      {
+         S.TieCheckBox(_("Encode on all processors"),
+                       wxT("/FileFormats/FLACParallel"),
+                       true);
+      }
+      S.EndHorizontalLay();
    }
    S.EndVerticalLay();
 
@@ -171,6 +186,37 @@ static struct
    {  true,    false,   true,    false,   0, 0, 6, 0, 12 },
 };
 
+// Settings common to the whole stream and to each segment of it
+template< typename Encoder >
+static bool ConfigureEncoder(Encoder &encoder, unsigned numChannels,
+                             double rate, sampleFormat format, int level)
+{
+   bool success =
+   encoder.set_channels(numChannels) &&
+   encoder.set_sample_rate(lrint(rate)) &&
+   encoder.set_bits_per_sample(format == int24Sample ? 24 : 16) &&
+   encoder.set_do_exhaustive_model_search(flacLevels[level].do_exhaustive_model_search) &&
+   encoder.set_do_escape_coding(flacLevels[level].do_escape_coding);
+
+   if (numChannels != 2) {
+      success = success &&
+      encoder.set_do_mid_side_stereo(false) &&
+      encoder.set_loose_mid_side_stereo(false);
+   }
+   else {
+      success = success &&
+      encoder.set_do_mid_side_stereo(flacLevels[level].do_mid_side_stereo) &&
+      encoder.set_loose_mid_side_stereo(flacLevels[level].loose_mid_side_stereo);
+   }
+
+   return success &&
+   encoder.set_qlp_coeff_precision(flacLevels[level].qlp_coeff_precision) &&
+   encoder.set_min_residual_partition_order(flacLevels[level].min_residual_partition_order) &&
+   encoder.set_max_residual_partition_order(flacLevels[level].max_residual_partition_order) &&
+   encoder.set_rice_parameter_search_dist(flacLevels[level].rice_parameter_search_dist) &&
+   encoder.set_max_lpc_order(flacLevels[level].max_lpc_order);
+}
+
 //----------------------------------------------------------------------------
 
 struct FLAC__StreamMetadataDeleter {
@@ -181,6 +227,174 @@ using FLAC__StreamMetadataHandle = std::unique_ptr<
    FLAC__StreamMetadata, FLAC__StreamMetadataDeleter
 >;
 
+#ifndef LEGACY_FLAC
+
+// To encode in parallel, the stream is cut into segments of whole frames,
+// each encoded by a separate libFLAC encoder.  FLAC frames are independent
+// of each other, so the frames of the segments make a valid stream, once
+// their numbers and checksums are corrected.  The header is that of the
+// first segment, with the totals filled in at the end.  The MD5 signature
+// of the audio is left unset, as the format allows.
+namespace {
+   // About six seconds at 44100 Hz with the usual 4096 samples per frame
+   const size_t FramesPerSegment = 64;
+
+   // Where the STREAMINFO block begins, after "fLaC" and its block header
+   const size_t StreamInfoOffset = 8;
+   const size_t StreamInfoLength = 34;
+
+   // The checksums of frame headers and of whole frames
+   FLAC__uint8 FrameHeaderCRC(const FLAC__byte *data, size_t len)
+   {
+      unsigned crc = 0;
+      while (len--) {
+         crc ^= *data++;
+         for (int bit = 0; bit < 8; ++bit)
+            crc = ((crc << 1) ^ ((crc & 0x80) ? 0x07 : 0)) & 0xFF;
+      }
+      return crc;
+   }
+
+   FLAC__uint16 FrameCRC(const FLAC__byte *data, size_t len)
+   {
+      static const std::vector<FLAC__uint16> table = []{
+         std::vector<FLAC__uint16> result(256);
+         for (unsigned ii = 0; ii < 256; ++ii) {
+            unsigned crc = ii << 8;
+            for (int bit = 0; bit < 8; ++bit)
+               crc = ((crc << 1) ^ ((crc & 0x8000) ? 0x8005 : 0)) & 0xFFFF;
+            result[ii] = crc;
+         }
+         return result;
+      }();
+
+      unsigned crc = 0;
+      while (len--)
+         crc = ((crc << 8) ^ table[(crc >> 8) ^ *data++]) & 0xFFFF;
+      return crc;
+   }
+
+   // Frame numbers are coded as in UTF-8, extended to 36 bits
+   size_t CodedNumberLength(FLAC__byte first)
+   {
+      size_t length = 1;
+      if (first & 0x80)
+         while (length < 7 && (first & (0x80 >> length)))
+            ++length;
+      return length;
+   }
+
+   void AppendCodedNumber(std::vector<FLAC__byte> &out, FLAC__uint64 value)
+   {
+      if (value < 0x80) {
+         out.push_back(value);
+         return;
+      }
+      // n bytes hold 5n + 1 bits
+      unsigned length = 2;
+      while (length < 7 && value >= (FLAC__uint64(1) << (5 * length + 1)))
+         ++length;
+      out.push_back(((0xFF00 >> length) & 0xFF) |
+                    (value >> (6 * (length - 1))));
+      for (auto ii = length - 1; ii-- > 0;)
+         out.push_back(0x80 | ((value >> (6 * ii)) & 0x3F));
+   }
+
+   // Copies a whole frame, giving it another number.  Returns its new size.
+   size_t AppendRenumberedFrame(std::vector<FLAC__byte> &out,
+      const FLAC__byte *frame, size_t bytes, FLAC__uint64 number)
+   {
+      // The header has the sync code and the codes of the block size,
+      // rate, channels and sample size in four bytes, then the number, then
+      // the block size and rate if they have no codes, then the CRC-8
+      const auto numberLength = CodedNumberLength(frame[4]);
+      const unsigned sizeCode = frame[2] >> 4, rateCode = frame[2] & 0x0F;
+      size_t extra = 0;
+      if (sizeCode == 6)
+         extra += 1;
+      else if (sizeCode == 7)
+         extra += 2;
+      if (rateCode == 12)
+         extra += 1;
+      else if (rateCode == 13 || rateCode == 14)
+         extra += 2;
+      const auto bodyStart = 4 + numberLength + extra + 1;
+
+      const auto start = out.size();
+      out.insert(out.end(), frame, frame + 4);
+      AppendCodedNumber(out, number);
+      out.insert(out.end(),
+         frame + 4 + numberLength, frame + 4 + numberLength + extra);
+      out.push_back(FrameHeaderCRC(&out[start], out.size() - start));
+
+      // Then the subframes, and the CRC-16 of all before it
+      out.insert(out.end(), frame + bodyStart, frame + bytes - 2);
+      const auto crc = FrameCRC(&out[start], out.size() - start);
+      out.push_back(crc >> 8);
+      out.push_back(crc & 0xFF);
+
+      return out.size() - start;
+   }
+
+   void PutBigEndian(FLAC__byte *dest, FLAC__uint64 value, size_t bytes)
+   {
+      while (bytes--) {
+         dest[bytes] = value & 0xFF;
+         value >>= 8;
+      }
+   }
+
+   struct Segment
+   {
+      ArraysOf<FLAC__int32> samples;
+      size_t length;
+
+      // Results of encoding
+      bool ok;
+      std::vector<FLAC__byte> header;
+      std::vector<FLAC__byte> frames;
+      size_t minFrameSize, maxFrameSize;
+   };
+
+   class SegmentEncoder final : public FLAC::Encoder::Stream
+   {
+   public:
+      SegmentEncoder(Segment &segment, FLAC__uint64 firstFrame)
+         : mSegment{ segment }, mFirstFrame{ firstFrame }
+      {
+         mSegment.header.clear();
+         mSegment.frames.clear();
+         mSegment.minFrameSize = std::numeric_limits<size_t>::max();
+         mSegment.maxFrameSize = 0;
+      }
+
+   protected:
+      ::FLAC__StreamEncoderWriteStatus write_callback(
+         const FLAC__byte buffer[], size_t bytes,
+         unsigned samples, unsigned current_frame) override
+      {
+         // libFLAC writes each frame in one call, and metadata with no
+         // samples, before the frames
+         if (samples == 0)
+            mSegment.header.insert(mSegment.header.end(),
+               buffer, buffer + bytes);
+         else {
+            const auto size = AppendRenumberedFrame(mSegment.frames,
+               buffer, bytes, mFirstFrame + current_frame);
+            mSegment.minFrameSize = std::min(mSegment.minFrameSize, size);
+            mSegment.maxFrameSize = std::max(mSegment.maxFrameSize, size);
+         }
+         return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+      }
+
+   private:
+      Segment &mSegment;
+      const FLAC__uint64 mFirstFrame;
+   };
+}
+
+#endif
+
 class ExportFLAC final : public ExportPlugin
 {
 public:
@@ -205,6 +419,20 @@ private:
 
    bool GetMetadata(AudacityProject *project, const Tags *tags);
 
+#ifndef LEGACY_FLAC
+   // Encodes segments of the stream on all processors and writes the
+   // file itself
+   ProgressResult ExportInSegments(ProgressDialog &progress,
+                                   PipelinedMixer &mixer,
+                                   unsigned numChannels,
+                                   double rate,
+                                   sampleFormat format,
+                                   int level,
+                                   const wxString &fName,
+                                   double t0,
+                                   double t1);
+#endif
+
    // Should this be a stack variable instead in Export?
    FLAC__StreamMetadataHandle mMetadata;
 };
@@ -245,70 +473,63 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    wxString bitDepthPref =
       gPrefs->Read(wxT("/FileFormats/FLACBitDepth"), wxT("16"));
 
-   FLAC::Encoder::File encoder;
+   sampleFormat format;
+   if (bitDepthPref == wxT("24"))
+      format = int24Sample;
+   else //convert float to 16 bits
+      format = int16Sample;
 
-   bool success = true;
-   success = success &&
-#ifdef LEGACY_FLAC
-   encoder.set_filename(OSOUTPUT(fName)) &&
-#endif
-   encoder.set_channels(numChannels) &&
-   encoder.set_sample_rate(lrint(rate));
+   // Duplicate the flac command line compression levels
+   if (levelPref < 0 || levelPref > 8) {
+      levelPref = 5;
+   }
 
    // See note in GetMetadata() about a bug in libflac++ 1.1.2
-   if (success && !GetMetadata(project, metadata)) {
+   if (!GetMetadata(project, metadata)) {
       // TODO: more precise message
       AudacityMessageBox(_("Unable to export"));
       return ProgressResult::Cancelled;
    }
 
-   if (success && mMetadata) {
-      // set_metadata expects an array of pointers to metadata and a size.
-      // The size is 1.
-      FLAC__StreamMetadata *p = mMetadata.get();
-      success = encoder.set_metadata(&p, 1);
-   }
-
    auto cleanup1 = finally( [&] {
       mMetadata.reset(); // need this?
    } );
 
-   sampleFormat format;
-   if (bitDepthPref == wxT("24")) {
-      format = int24Sample;
-      success = success && encoder.set_bits_per_sample(24);
-   } else { //convert float to 16 bits
-      format = int16Sample;
-      success = success && encoder.set_bits_per_sample(16);
+   const WaveTrackConstArray waveTracks =
+      tracks->GetWaveTrackConstArray(selectionOnly, false);
+   const wxString message = selectionOnly
+      ? _("Exporting the selected audio as FLAC")
+      : _("Exporting the audio as FLAC");
+
+#ifndef LEGACY_FLAC
+   bool parallel;
+   gPrefs->Read(wxT("/FileFormats/FLACParallel"), &parallel, true);
+   if (parallel && TaskScheduler::Get().GetConcurrency() > 1) {
+      auto mixer = CreatePipelinedMixer(waveTracks,
+                                        tracks->GetTimeTrack(),
+                                        t0, t1,
+                                        numChannels, SAMPLES_PER_RUN, false,
+                                        rate, format, true, mixerSpec);
+      InitProgress( pDialog, wxFileName(fName).GetName(), message );
+      return ExportInSegments(*pDialog, *mixer, numChannels, rate, format,
+                              levelPref, fName, t0, t1);
    }
+#endif
 
+   FLAC::Encoder::File encoder;
 
-   // Duplicate the flac command line compression levels
-   if (levelPref < 0 || levelPref > 8) {
-      levelPref = 5;
-   }
-   success = success &&
-   encoder.set_do_exhaustive_model_search(flacLevels[levelPref].do_exhaustive_model_search) &&
-   encoder.set_do_escape_coding(flacLevels[levelPref].do_escape_coding);
+   bool success = ConfigureEncoder(encoder, numChannels, rate, format, levelPref);
+#ifdef LEGACY_FLAC
+   success = success && encoder.set_filename(OSOUTPUT(fName));
+#endif
 
-   if (numChannels != 2) {
-      success = success &&
-      encoder.set_do_mid_side_stereo(false) &&
-      encoder.set_loose_mid_side_stereo(false);
-   }
-   else {
-      success = success &&
-      encoder.set_do_mid_side_stereo(flacLevels[levelPref].do_mid_side_stereo) &&
-      encoder.set_loose_mid_side_stereo(flacLevels[levelPref].loose_mid_side_stereo);
+   if (success && mMetadata) {
+      // set_metadata expects an array of pointers to metadata and a size.
+      // The size is 1.
+      FLAC__StreamMetadata *p = mMetadata.get();
+      success = encoder.set_metadata(&p, 1);
    }
 
-   success = success &&
-   encoder.set_qlp_coeff_precision(flacLevels[levelPref].qlp_coeff_precision) &&
-   encoder.set_min_residual_partition_order(flacLevels[levelPref].min_residual_partition_order) &&
-   encoder.set_max_residual_partition_order(flacLevels[levelPref].max_residual_partition_order) &&
-   encoder.set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist) &&
-   encoder.set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
-
    if (!success) {
       // TODO: more precise message
       AudacityMessageBox(_("Unable to export"));
@@ -346,20 +567,15 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
       }
    } );
 
-   const WaveTrackConstArray waveTracks =
-      tracks->GetWaveTrackConstArray(selectionOnly, false);
-   auto mixer = CreateMixer(waveTracks,
-                            tracks->GetTimeTrack(),
-                            t0, t1,
-                            numChannels, SAMPLES_PER_RUN, false,
-                            rate, format, true, mixerSpec);
+   auto mixer = CreatePipelinedMixer(waveTracks,
+                                     tracks->GetTimeTrack(),
+                                     t0, t1,
+                                     numChannels, SAMPLES_PER_RUN, false,
+                                     rate, format, true, mixerSpec);
 
    ArraysOf<FLAC__int32> tmpsmplbuf{ numChannels, SAMPLES_PER_RUN, true };
 
-   InitProgress( pDialog, wxFileName(fName).GetName(),
-      selectionOnly
-         ? _("Exporting the selected audio as FLAC")
-         : _("Exporting the audio as FLAC") );
+   InitProgress( pDialog, wxFileName(fName).GetName(), message );
    auto &progress = *pDialog;
 
    while (updateResult == ProgressResult::Success) {
@@ -412,6 +628,230 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
    return updateResult;
 }
 
+#ifndef LEGACY_FLAC
+
+ProgressResult ExportFLAC::ExportInSegments(ProgressDialog &progress,
+                                            PipelinedMixer &mixer,
+                                            unsigned numChannels,
+                                            double rate,
+                                            sampleFormat format,
+                                            int level,
+                                            const wxString &fName,
+                                            double t0,
+                                            double t1)
+{
+   // Every segment but the last holds whole frames
+   size_t segmentLength;
+   {
+      Segment probe;
+      SegmentEncoder encoder{ probe, 0 };
+      if (!ConfigureEncoder(encoder, numChannels, rate, format, level)) {
+         // TODO: more precise message
+         AudacityMessageBox(_("Unable to export"));
+         return ProgressResult::Cancelled;
+      }
+      segmentLength = encoder.get_blocksize() * FramesPerSegment;
+   }
+
+   wxFFile f;     // will be closed when it goes out of scope
+   if (!f.Open(fName, wxT("wb"))) {
+      AudacityMessageBox(wxString::Format(_("FLAC export couldn't open %s"), fName));
+      return ProgressResult::Cancelled;
+   }
+
+   auto &scheduler = TaskScheduler::Get();
+
+   // One batch of segments is encoded while the next is mixed
+   const size_t batchSize = scheduler.GetConcurrency();
+   std::vector<Segment> batches[2];
+   for (auto &batch : batches) {
+      batch = std::vector<Segment>(batchSize);
+      for (auto &segment : batch)
+         segment.samples.reinit(numChannels, segmentLength);
+   }
+
+   const double totalSamples = std::max(1.0, (t1 - t0) * rate);
+   FLAC__uint64 samplesWritten = 0;
+   std::atomic<size_t> samplesEncoded{ 0 };
+   auto updateResult = ProgressResult::Success;
+   const auto update = [&] {
+      if (updateResult == ProgressResult::Success)
+         updateResult = progress.Update(
+            double(samplesWritten + samplesEncoded.load()), totalSamples);
+   };
+
+   size_t mixedLength = 0, mixedOffset = 0;
+   bool mixerDone = false;
+   const auto fill = [&](std::vector<Segment> &batch) {
+      size_t count = 0;
+      for (auto &segment : batch) {
+         segment.length = 0;
+         while (segment.length < segmentLength &&
+                updateResult == ProgressResult::Success) {
+            if (mixedOffset == mixedLength) {
+               if (mixerDone)
+                  break;
+               mixedOffset = 0;
+               mixedLength = mixer.Process(SAMPLES_PER_RUN);
+               if (mixedLength == 0) {
+                  mixerDone = true;
+                  break;
+               }
+               update();
+            }
+            const auto len = std::min(
+               segmentLength - segment.length, mixedLength - mixedOffset);
+            for (size_t i = 0; i < numChannels; i++) {
+               samplePtr mixed = mixer.GetBuffer(i);
+               auto dest = &segment.samples[i][segment.length];
+               if (format == int24Sample)
+                  std::copy((int *)mixed + mixedOffset,
+                            (int *)mixed + mixedOffset + len, dest);
+               else
+                  std::copy((short *)mixed + mixedOffset,
+                            (short *)mixed + mixedOffset + len, dest);
+            }
+            segment.length += len;
+            mixedOffset += len;
+         }
+         if (segment.length == 0)
+            break;
+         ++count;
+      }
+      return count;
+   };
+
+   std::vector<FLAC__byte> header;
+   size_t minFrameSize = std::numeric_limits<size_t>::max(), maxFrameSize = 0;
+   size_t firstSegment = 0;
+   int current = 0;
+
+   // Even no audio at all needs a header
+   auto count = std::max<size_t>(1, fill(batches[current]));
+   while (count > 0 && updateResult == ProgressResult::Success) {
+      auto &batch = batches[current];
+      samplesEncoded.store(0);
+
+      // The loop runs on another thread, so that this one can mix
+      // and show progress
+      std::exception_ptr exception;
+      std::atomic<bool> done{ false };
+      std::atomic<bool> stopping{ false };
+      std::thread runner{ [&] {
+         try {
+            scheduler.ParallelFor(TaskScheduler::Interactive, count, [&](size_t ii) {
+               auto &segment = batch[ii];
+               segment.ok = false;
+               if (stopping.load())
+                  return;
+               const auto index = firstSegment + ii;
+               SegmentEncoder encoder{ segment, index * FramesPerSegment };
+               bool ok =
+                  ConfigureEncoder(encoder, numChannels, rate, format, level) &&
+                  encoder.set_do_md5(false);
+               if (ok && index == 0 && mMetadata) {
+                  FLAC__StreamMetadata *p = mMetadata.get();
+                  ok = encoder.set_metadata(&p, 1);
+               }
+               ok = ok &&
+                  encoder.init() == FLAC__STREAM_ENCODER_INIT_STATUS_OK;
+               ok = ok && encoder.process(
+                  reinterpret_cast<FLAC__int32**>( segment.samples.get() ),
+                  segment.length);
+               // Flushes the last frames
+               ok = encoder.finish() && ok;
+               segment.ok = ok;
+               samplesEncoded += segment.length;
+            });
+         }
+         catch (...) {
+            exception = std::current_exception();
+         }
+         done.store(true);
+      } };
+
+      size_t next = 0;
+      {
+         // A stopped export keeps the batch; a cancelled one does not
+         auto cleanup = finally( [&] {
+            stopping.store(!(updateResult == ProgressResult::Success ||
+                             updateResult == ProgressResult::Stopped));
+            runner.join();
+         } );
+         next = fill(batches[1 - current]);
+         while (!done.load() && updateResult == ProgressResult::Success) {
+            ::wxMilliSleep(50);
+            update();
+         }
+      }
+      if (exception)
+         std::rethrow_exception(exception);
+      if (!(updateResult == ProgressResult::Success ||
+            updateResult == ProgressResult::Stopped))
+         return updateResult;
+
+      for (size_t ii = 0; ii < count; ++ii) {
+         auto &segment = batch[ii];
+         if (firstSegment + ii == 0) {
+            header = segment.header;
+            if (!segment.ok ||
+                header.size() < StreamInfoOffset + StreamInfoLength) {
+               // TODO: more precise message
+               AudacityMessageBox(_("Unable to export"));
+               return ProgressResult::Cancelled;
+            }
+            if (f.Write(header.data(), header.size()) != header.size()) {
+               AudacityMessageBox(_("Unable to export"));
+               return ProgressResult::Failed;
+            }
+         }
+         if (!segment.ok) {
+            // TODO: more precise message
+            AudacityMessageBox(_("Unable to export"));
+            return ProgressResult::Cancelled;
+         }
+         if (f.Write(segment.frames.data(), segment.frames.size()) !=
+             segment.frames.size()) {
+            AudacityMessageBox(_("Unable to export"));
+            return ProgressResult::Failed;
+         }
+         if (segment.length > 0) {
+            minFrameSize = std::min(minFrameSize, segment.minFrameSize);
+            maxFrameSize = std::max(maxFrameSize, segment.maxFrameSize);
+         }
+         samplesWritten += segment.length;
+      }
+
+      firstSegment += count;
+      current = 1 - current;
+      count = next;
+   }
+
+   // Complete the STREAMINFO:  frame sizes, then the low 36 bits of the
+   // eight bytes ending the rate, channels and sample size
+   auto streamInfo = &header[StreamInfoOffset];
+   if (maxFrameSize > 0) {
+      PutBigEndian(streamInfo + 4, minFrameSize, 3);
+      PutBigEndian(streamInfo + 7, maxFrameSize, 3);
+   }
+   FLAC__uint64 packed = 0;
+   for (size_t ii = 10; ii < 18; ++ii)
+      packed = (packed << 8) | streamInfo[ii];
+   const auto mask = (FLAC__uint64(1) << 36) - 1;
+   packed = (packed & ~mask) | (samplesWritten & mask);
+   PutBigEndian(streamInfo + 10, packed, 8);
+
+   if (!f.Seek(0) ||
+       f.Write(header.data(), StreamInfoOffset + StreamInfoLength) !=
+          StreamInfoOffset + StreamInfoLength ||
+       !f.Flush() || !f.Close())
+      return ProgressResult::Failed;
+
+   return updateResult;
+}
+
+#endif
+
 wxWindow *ExportFLAC::OptionsCreate(wxWindow *parent, int format)
 {
    wxASSERT(parent); // to justify safenew
@@ -80,6 +80,13 @@
 #include <wx/utils.h>
 #include <wx/window.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
 #include "../FileNames.h"
 #include "../float_cast.h"
 #include "../Internat.h"
@@ -88,6 +95,7 @@
 #include "../Project.h"
 #include "../ShuttleGui.h"
 #include "../Tags.h"
+#include "../TaskScheduler.h"
 #include "../Track.h"
 #include "../widgets/HelpSystem.h"
 #include "../widgets/LinkingHtmlWindow.h"
@@ -422,6 +430,13 @@ void ExportMP3Options::PopulateOrExchange(ShuttleGui & S)
                   mMono = S.Id(ID_MONO).AddCheckBox(_("Force export to mono"), mono? wxT("true") : wxT("false"));
                }
                S.EndTwoColumn();
+
+               // Off by default:  without the bit reservoir, frames that
+               // need more bits than their share cannot borrow them
+               S.AddPrompt(wxT(""));
+               S.TieCheckBox(_("Encode on all processors"),
+                             wxT("/FileFormats/MP3Parallel"),
+                             false);
             }
             S.EndTwoColumn();
          }
@@ -851,8 +866,32 @@ public:
 
    bool PutInfoTag(wxFFile & f, wxFileOffset off);
 
+   /* For encoding segments of the stream at once, each with a stream of its
+      own.  These have the settings of this one, but no bit reservoir, so
+      that each frame holds all its data and frames of different streams can
+      be joined.  Only the first segment needs the info tag. */
+   bool CanEncodeSegments();
+   /* Call on one thread at a time; returns NULL on failure */
+   lame_global_flags *InitializeSegmentStream(unsigned channels, int sampleRate,
+                                              bool infoTag);
+   /* These may be called at once for different streams.  The output must
+      have room for 5/4 of the samples and 7200 bytes more. */
+   int EncodeSegment(lame_global_flags *gf, unsigned channels,
+                     short int inbuffer[], int nSamples,
+                     unsigned char outbuffer[], int outSize);
+   int FinishSegment(lame_global_flags *gf,
+                     unsigned char outbuffer[], int outSize);
+   /* The info tag of a finished stream, or 0 */
+   size_t GetSegmentInfoTag(lame_global_flags *gf,
+                            unsigned char buffer[], size_t size);
+   /* Call on one thread at a time */
+   void CloseSegmentStream(lame_global_flags *gf);
+
 private:
 
+   int ConfigureStream(lame_global_flags *gf, unsigned channels,
+                       int sampleRate, bool reservoir, bool infoTag);
+
 #ifndef DISABLE_DYNAMIC_LOADING_LAME
    wxString mLibPath;
    wxDynamicLibrary lame_lib;
@@ -1218,19 +1257,37 @@ int MP3Exporter::InitializeStream(unsigned channels, int sampleRate)
       return -1;
    }
 
-   lame_set_error_protection(mGF, false);
-   lame_set_num_channels(mGF, channels);
-   lame_set_in_samplerate(mGF, sampleRate);
-   lame_set_out_samplerate(mGF, sampleRate);
-   lame_set_disable_reservoir(mGF, false);
+   int rc = ConfigureStream(mGF, channels, sampleRate, true, true);
+   if (rc < 0) {
+      return rc;
+   }
+
+#if 0
+   dump_config(mGF);
+#endif
+
+   mInfoTagLen = 0;
+   mEncoding = true;
+
+   return mSamplesPerChunk;
+}
+
+int MP3Exporter::ConfigureStream(lame_global_flags *gf, unsigned channels,
+                                 int sampleRate, bool reservoir, bool infoTag)
+{
+   lame_set_error_protection(gf, false);
+   lame_set_num_channels(gf, channels);
+   lame_set_in_samplerate(gf, sampleRate);
+   lame_set_out_samplerate(gf, sampleRate);
+   lame_set_disable_reservoir(gf, !reservoir);
 #ifndef DISABLE_DYNAMIC_LOADING_LAME
 // TODO: Make this configurable (detect the existance of this function)
-   lame_set_padding_type(mGF, PAD_NO);
+   lame_set_padding_type(gf, PAD_NO);
 #endif // DISABLE_DYNAMIC_LOADING_LAME
 
    // Add the VbrTag for all types.  For ABR/VBR, a Xing tag will be created.
    // For CBR, it will be a Lame Info tag.
-   lame_set_bWriteVbrTag(mGF, true);
+   lame_set_bWriteVbrTag(gf, infoTag);
 
    // Set the VBR quality or ABR/CBR bitrate
    switch (mMode) {
@@ -1264,22 +1321,22 @@ int MP3Exporter::InitializeStream(unsigned channels, int sampleRate)
             }
          }
 
-         lame_set_preset(mGF, preset);
+         lame_set_preset(gf, preset);
       }
       break;
 
       case MODE_VBR:
-         lame_set_VBR(mGF, (mRoutine == ROUTINE_STANDARD ? vbr_rh : vbr_mtrh ));
-         lame_set_VBR_q(mGF, mQuality);
+         lame_set_VBR(gf, (mRoutine == ROUTINE_STANDARD ? vbr_rh : vbr_mtrh ));
+         lame_set_VBR_q(gf, mQuality);
       break;
 
       case MODE_ABR:
-         lame_set_preset(mGF, mBitrate );
+         lame_set_preset(gf, mBitrate );
       break;
 
       default:
-         lame_set_VBR(mGF, vbr_off);
-         lame_set_brate(mGF, mBitrate);
+         lame_set_VBR(gf, vbr_off);
+         lame_set_brate(gf, mBitrate);
       break;
    }
 
@@ -1295,21 +1352,9 @@ int MP3Exporter::InitializeStream(unsigned channels, int sampleRate)
    else {
       mode = STEREO;
    }
-   lame_set_mode(mGF, mode);
-
-   int rc = lame_init_params(mGF);
-   if (rc < 0) {
-      return rc;
-   }
-
-#if 0
-   dump_config(mGF);
-#endif
-
-   mInfoTagLen = 0;
-   mEncoding = true;
+   lame_set_mode(gf, mode);
 
-   return mSamplesPerChunk;
+   return lame_init_params(gf);
 }
 
 int MP3Exporter::GetOutBufferSize()
@@ -1388,6 +1433,69 @@ void MP3Exporter::CancelEncoding()
    mEncoding = false;
 }
 
+bool MP3Exporter::CanEncodeSegments()
+{
+#if defined(DISABLE_DYNAMIC_LOADING_LAME)
+   return true;
+#else
+   // The joined stream needs a tag made from the first segment's
+   return mLibraryLoaded && lame_get_lametag_frame != NULL;
+#endif
+}
+
+lame_global_flags *MP3Exporter::InitializeSegmentStream(unsigned channels,
+                                                        int sampleRate,
+                                                        bool infoTag)
+{
+   if (!CanEncodeSegments() || channels > 2) {
+      return NULL;
+   }
+
+   lame_global_flags *gf = lame_init();
+   if (gf == NULL) {
+      return NULL;
+   }
+
+   if (ConfigureStream(gf, channels, sampleRate, false, infoTag) < 0) {
+      lame_close(gf);
+      return NULL;
+   }
+
+   return gf;
+}
+
+int MP3Exporter::EncodeSegment(lame_global_flags *gf, unsigned channels,
+                               short int inbuffer[], int nSamples,
+                               unsigned char outbuffer[], int outSize)
+{
+   if (channels > 1) {
+      return lame_encode_buffer_interleaved(gf, inbuffer, nSamples,
+         outbuffer, outSize);
+   }
+
+   return lame_encode_buffer(gf, inbuffer, inbuffer, nSamples,
+      outbuffer, outSize);
+}
+
+int MP3Exporter::FinishSegment(lame_global_flags *gf,
+                               unsigned char outbuffer[], int outSize)
+{
+   return lame_encode_flush(gf, outbuffer, outSize);
+}
+
+size_t MP3Exporter::GetSegmentInfoTag(lame_global_flags *gf,
+                                      unsigned char buffer[], size_t size)
+{
+   return lame_get_lametag_frame(gf, buffer, size);
+}
+
+void MP3Exporter::CloseSegmentStream(lame_global_flags *gf)
+{
+   if (gf) {
+      lame_close(gf);
+   }
+}
+
 bool MP3Exporter::PutInfoTag(wxFFile & f, wxFileOffset off)
 {
    if (mGF) {
@@ -1590,6 +1698,274 @@ static void dump_config( 	lame_global_flags*	gfp )
 }
 #endif
 
+//----------------------------------------------------------------------------
+// Encoding in segments
+//----------------------------------------------------------------------------
+
+// To encode on all processors, the stream is cut into segments of whole
+// frames, each encoded by a LAME stream of its own with the bit reservoir
+// disabled, so that every frame stands alone.  Each stream is also given a
+// few frames before and after its segment, which warm up its psychoacoustic
+// model and give the last frame the samples its transform overlaps, and the
+// frames made of those are dropped.  All streams have the same delay, so
+// their frames align with those of the first, whose Xing or Info tag is
+// then corrected for the whole stream, keeping the delay and padding right
+// for gapless playback.
+namespace {
+   // In samples, multiples of the 1152 of an MPEG-1 frame and so also of
+   // the 576 of the others:  about seven seconds at 44100 Hz, and four
+   // frames more before and after
+   const size_t SegmentLength = 256 * 1152;
+   const size_t SegmentOverlap = 4 * 1152;
+
+   // The length in bytes and samples of the layer III frame that begins
+   // here, or false if there is none
+   bool ParseFrameHeader(const unsigned char *h, size_t available,
+                         size_t &bytes, size_t &samples)
+   {
+      static const int mpeg1Rates[] =
+         { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+      static const int mpeg2Rates[] =
+         { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+      static const int sampleRates[] = { 44100, 48000, 32000 };
+
+      if (available < 4 || h[0] != 0xFF || (h[1] & 0xE0) != 0xE0)
+         return false;
+      // Version 3 is MPEG-1, 2 is MPEG-2, 0 is MPEG-2.5
+      const unsigned version = (h[1] >> 3) & 3;
+      const unsigned layer = (h[1] >> 1) & 3;
+      const unsigned rateIndex = h[2] >> 4;
+      const unsigned sampleRateIndex = (h[2] >> 2) & 3;
+      if (version == 1 || layer != 1 ||
+          rateIndex == 0 || rateIndex == 15 || sampleRateIndex == 3)
+         return false;
+
+      const bool mpeg1 = (version == 3);
+      const int bitrate =
+         (mpeg1 ? mpeg1Rates : mpeg2Rates)[rateIndex] * 1000;
+      const int sampleRate =
+         sampleRates[sampleRateIndex] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+      const size_t padding = (h[2] >> 1) & 1;
+
+      bytes = (mpeg1 ? 144 : 72) * bitrate / sampleRate + padding;
+      samples = mpeg1 ? 1152 : 576;
+      return bytes <= available;
+   }
+
+   // As LAME computes it for the music and the tag
+   unsigned short InfoCRC(unsigned short crc,
+                          const unsigned char *data, size_t len)
+   {
+      static const std::vector<unsigned short> table = []{
+         std::vector<unsigned short> result(256);
+         for (unsigned ii = 0; ii < 256; ++ii) {
+            unsigned crc = ii;
+            for (int bit = 0; bit < 8; ++bit)
+               crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+            result[ii] = crc;
+         }
+         return result;
+      }();
+
+      while (len--)
+         crc = (crc >> 8) ^ table[(crc ^ *data++) & 0xFF];
+      return crc;
+   }
+
+   unsigned long long GetBigEndian(const unsigned char *src, size_t bytes)
+   {
+      unsigned long long value = 0;
+      while (bytes--)
+         value = (value << 8) | *src++;
+      return value;
+   }
+
+   void PutBigEndian(unsigned char *dest, unsigned long long value,
+                     size_t bytes)
+   {
+      while (bytes--) {
+         dest[bytes] = value & 0xFF;
+         value >>= 8;
+      }
+   }
+
+   // Totals of a stream of frames that follow an info tag
+   struct StreamTotals
+   {
+      long long frames { 0 };
+      // Counting the tag
+      long long bytes { 0 };
+      long long samples { 0 };
+   };
+
+   // Where the Xing or Info tag begins in its frame, and where LAME's
+   // extension of it would, or false if the frame has no tag
+   bool LocateInfoTag(const std::vector<unsigned char> &tag,
+                      size_t &offset, size_t &ext)
+   {
+      const auto t = tag.data();
+      const auto size = tag.size();
+      if (size < 4)
+         return false;
+
+      // The tag follows the side information
+      const bool mpeg1 = ((t[1] >> 3) & 3) == 3;
+      const bool mono = (t[3] >> 6) == 3;
+      offset = 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+      if (size < offset + 8 ||
+          (memcmp(t + offset, "Xing", 4) && memcmp(t + offset, "Info", 4)))
+         return false;
+
+      // Then flags for the fields present, of frames, bytes, the table of
+      // contents and the quality
+      const auto flags = GetBigEndian(t + offset + 4, 4);
+      ext = offset + 8 + ((flags & 1) ? 4 : 0) + ((flags & 2) ? 4 : 0) +
+         ((flags & 4) ? 100 : 0) + ((flags & 8) ? 4 : 0);
+      return true;
+   }
+
+   const size_t InfoExtensionLength = 36;
+
+   // The CRC of the music that LAME put in the tag, or false if none
+   bool GetMusicCRC(const std::vector<unsigned char> &tag, unsigned short &crc)
+   {
+      size_t offset, ext;
+      if (!LocateInfoTag(tag, offset, ext) ||
+          tag.size() < ext + InfoExtensionLength)
+         return false;
+      crc = GetBigEndian(&tag[ext + 32], 2);
+      return true;
+   }
+
+   // Makes the tag that the first segment's stream wrote describe the
+   // whole stream.  The counts change by the differences from that
+   // stream's own, so that they keep whatever conventions LAME has.
+   void PatchInfoTag(std::vector<unsigned char> &tag,
+                     const StreamTotals &first, const StreamTotals &whole,
+                     size_t samplesPerFrame, unsigned short musicCRC,
+                     const std::vector<unsigned short> &frameSizes)
+   {
+      size_t offset, ext;
+      if (!LocateInfoTag(tag, offset, ext) || tag.size() < ext)
+         return;
+      const auto t = tag.data();
+      const auto size = tag.size();
+
+      const auto flags = GetBigEndian(t + offset + 4, 4);
+      auto pos = offset + 8;
+      long long bytes = whole.bytes;
+      if (flags & 1) {
+         PutBigEndian(t + pos,
+            GetBigEndian(t + pos, 4) + whole.frames - first.frames, 4);
+         pos += 4;
+      }
+      if (flags & 2) {
+         bytes = GetBigEndian(t + pos, 4) + whole.bytes - first.bytes;
+         PutBigEndian(t + pos, bytes, 4);
+         pos += 4;
+      }
+      if (flags & 4) {
+         // The position of each percent of the frames, in 256ths of the
+         // stream
+         if (whole.frames > 0 && bytes > 0) {
+            long long position = whole.bytes - std::accumulate(
+               frameSizes.begin(), frameSizes.end(), 0LL);
+            size_t frame = 0;
+            for (int ii = 0; ii < 100; ++ii) {
+               const auto target = size_t(ii * whole.frames / 100);
+               for (; frame < target; ++frame)
+                  position += frameSizes[frame];
+               t[pos + ii] = std::min(255LL, 256 * position / bytes);
+            }
+         }
+         pos += 100;
+      }
+
+      // Then LAME's extension of the tag
+      if (size < ext + InfoExtensionLength)
+         return;
+
+      // The delay and padding, twelve bits each
+      const auto delays = GetBigEndian(t + ext + 21, 3);
+      const auto delay = delays >> 12;
+      auto padding = (long long)(delays & 0xFFF) +
+         (whole.frames - first.frames) * (long long)samplesPerFrame -
+         (whole.samples - first.samples);
+      padding = std::max(0LL, std::min(0xFFFLL, padding));
+      PutBigEndian(t + ext + 21, (delay << 12) | padding, 3);
+
+      PutBigEndian(t + ext + 28,
+         GetBigEndian(t + ext + 28, 4) + whole.bytes - first.bytes, 4);
+      PutBigEndian(t + ext + 32, musicCRC, 2);
+      // Last, that of all of the tag before it
+      PutBigEndian(t + ext + 34, InfoCRC(0, t, ext + 34), 2);
+   }
+
+   struct MP3Segment
+   {
+      // Interleaved, from leadIn samples before the segment to as many
+      // after it as there are
+      std::vector<short> samples;
+      size_t leadIn;
+      size_t length;
+      bool last;
+      lame_global_flags *gf { nullptr };
+
+      // Results of encoding
+      bool ok;
+      std::vector<unsigned char> output;
+      // The frames of the segment itself, and their sizes
+      std::vector<unsigned char> frames;
+      std::vector<unsigned short> frameSizes;
+      // Only for the first segment:  the length of the place for the tag,
+      // what the stream made, and the tag
+      size_t tagLength;
+      size_t samplesPerFrame;
+      StreamTotals totals;
+      std::vector<unsigned char> tag;
+   };
+
+   // Splits the output of the segment's stream into frames, keeping the
+   // segment's own
+   bool SplitFrames(MP3Segment &segment, unsigned channels, bool first)
+   {
+      const auto data = segment.output.data();
+      const auto size = segment.output.size();
+      size_t pos = 0, bytes = 0, samples = 0;
+
+      segment.tagLength = 0;
+      if (first) {
+         if (!ParseFrameHeader(data, size, bytes, samples))
+            return false;
+         segment.tagLength = bytes;
+         pos = bytes;
+      }
+
+      size_t skip = 0, keep = 0;
+      long long frames = 0;
+      for (; pos < size; pos += bytes, ++frames) {
+         if (!ParseFrameHeader(data + pos, size - pos, bytes, samples))
+            return false;
+         if (frames == 0) {
+            skip = segment.leadIn / samples;
+            keep = segment.length / samples;
+         }
+         if (frames < (long long)skip ||
+             (!segment.last && frames >= (long long)(skip + keep)))
+            continue;
+         segment.frames.insert(segment.frames.end(),
+            data + pos, data + pos + bytes);
+         segment.frameSizes.push_back(bytes);
+      }
+
+      segment.samplesPerFrame = samples;
+      segment.totals.frames = frames;
+      segment.totals.bytes = size;
+      segment.totals.samples = segment.samples.size() / channels;
+      return true;
+   }
+}
+
 //----------------------------------------------------------------------------
 // ExportMP3
 //----------------------------------------------------------------------------
@@ -1620,6 +1996,18 @@ private:
    int FindValue(CHOICES *choices, int cnt, int needle, int def);
    wxString FindName(CHOICES *choices, int cnt, int needle);
    int AskResample(int bitrate, int rate, int lowrate, int highrate);
+   // Encodes segments of the stream on all processors, writing the frames
+   // and then the info tag at pos
+   ProgressResult ExportInSegments(MP3Exporter &exporter,
+                                   ProgressDialog &progress,
+                                   PipelinedMixer &mixer,
+                                   size_t bufferSize,
+                                   unsigned channels,
+                                   int rate,
+                                   wxFFile &outFile,
+                                   wxFileOffset pos,
+                                   double t0,
+                                   double t1);
    id3_length_t AddTags(AudacityProject *project, ArrayOf<char> &buffer, bool *endOfFile, const Tags *tags);
 #ifdef USE_LIBID3TAG
    void AddFrame(struct id3_tag *tp, const wxString & n, const wxString & v, const char *name);
@@ -1783,6 +2171,11 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
       exporter.SetChannel(CHANNEL_STEREO);
    }
 
+   bool parallel;
+   gPrefs->Read(wxT("/FileFormats/MP3Parallel"), &parallel, false);
+   parallel = parallel && TaskScheduler::Get().GetConcurrency() > 1 &&
+      exporter.CanEncodeSegments();
+
    auto inSamples = exporter.InitializeStream(channels, rate);
    if (((int)inSamples) < 0) {
       AudacityMessageBox(_("Unable to initialize MP3 stream"));
@@ -1828,7 +2221,7 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
    const WaveTrackConstArray waveTracks =
       tracks->GetWaveTrackConstArray(selectionOnly, false);
    {
-      auto mixer = CreateMixer(waveTracks,
+      auto mixer = CreatePipelinedMixer(waveTracks,
          tracks->GetTimeTrack(),
          t0, t1,
          channels, inSamples, true,
@@ -1857,7 +2250,12 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
       InitProgress( pDialog, wxFileName(fName).GetName(), title );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success) {
+      if (parallel)
+         updateResult = ExportInSegments(exporter, progress, *mixer,
+                                         inSamples, channels, rate,
+                                         outFile, pos, t0, t1);
+
+      while (!parallel && updateResult == ProgressResult::Success) {
          auto blockLen = mixer->Process(inSamples);
 
          if (blockLen == 0) {
@@ -1904,7 +2302,8 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
 
    if ( updateResult == ProgressResult::Success ||
         updateResult == ProgressResult::Stopped ) {
-      bytes = exporter.FinishStream(buffer.get());
+      // The segments' streams were finished, and the tag written
+      bytes = parallel ? 0 : exporter.FinishStream(buffer.get());
 
       if (bytes < 0) {
          // TODO: more precise message
@@ -1935,7 +2334,7 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
       //
       // Also, if beWriteInfoTag() is used, mGF will no longer be valid after
       // this call, so do not use it.
-      if (!exporter.PutInfoTag(outFile, pos) ||
+      if ((!parallel && !exporter.PutInfoTag(outFile, pos)) ||
           !outFile.Flush() ||
           !outFile.Close()) {
          // TODO: more precise message
@@ -1947,6 +2346,250 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
    return updateResult;
 }
 
+ProgressResult ExportMP3::ExportInSegments(MP3Exporter &exporter,
+                                           ProgressDialog &progress,
+                                           PipelinedMixer &mixer,
+                                           size_t bufferSize,
+                                           unsigned channels,
+                                           int rate,
+                                           wxFFile &outFile,
+                                           wxFileOffset pos,
+                                           double t0,
+                                           double t1)
+{
+   auto &scheduler = TaskScheduler::Get();
+
+   // One batch of segments is encoded while the next is mixed
+   const size_t batchSize = scheduler.GetConcurrency();
+   std::vector<MP3Segment> batches[2];
+   for (auto &batch : batches)
+      batch = std::vector<MP3Segment>(batchSize);
+
+   const double totalSamples = std::max(1.0, (t1 - t0) * rate);
+   long long samplesWritten = 0;
+   std::atomic<size_t> samplesEncoded{ 0 };
+   auto updateResult = ProgressResult::Success;
+   const auto update = [&] {
+      if (updateResult == ProgressResult::Success)
+         updateResult = progress.Update(
+            double(samplesWritten + samplesEncoded.load()), totalSamples);
+   };
+
+   // The mixed samples from streamStart, which the segments of the next
+   // batch copy, with their overlaps
+   std::vector<short> stream;
+   size_t streamStart = 0;
+   bool mixerDone = false;
+   const auto fill = [&](std::vector<MP3Segment> &batch, size_t first) {
+      const auto needed = (first + batch.size()) * SegmentLength + SegmentOverlap;
+      while (!mixerDone && streamStart + stream.size() / channels < needed &&
+             updateResult == ProgressResult::Success) {
+         const auto len = mixer.Process(bufferSize);
+         if (len == 0) {
+            mixerDone = true;
+            break;
+         }
+         const auto mixed = (const short *)mixer.GetBuffer();
+         stream.insert(stream.end(), mixed, mixed + len * channels);
+         update();
+      }
+
+      const auto streamEnd = streamStart + stream.size() / channels;
+      size_t count = 0;
+      for (auto &segment : batch) {
+         const auto start = (first + count) * SegmentLength;
+         // Even no audio at all needs a tag
+         if (start >= streamEnd && (first + count) > 0)
+            break;
+         const auto from = start - std::min(start, SegmentOverlap);
+         const auto to = std::min(streamEnd, start + SegmentLength + SegmentOverlap);
+         segment.samples.assign(
+            stream.begin() + (from - streamStart) * channels,
+            stream.begin() + (to - streamStart) * channels);
+         segment.leadIn = start - from;
+         segment.length = std::min(streamEnd, start + SegmentLength) - start;
+         segment.last = streamEnd <= start + SegmentLength;
+         ++count;
+      }
+
+      // Keep what the next batch's first segment overlaps
+      const auto next = (first + count) * SegmentLength;
+      const auto keep = std::min(streamEnd, next - std::min(next, SegmentOverlap));
+      if (keep > streamStart) {
+         stream.erase(stream.begin(),
+                      stream.begin() + (keep - streamStart) * channels);
+         streamStart = keep;
+      }
+      return count;
+   };
+
+   StreamTotals firstTotals, totals;
+   std::vector<unsigned char> tag;
+   std::vector<unsigned short> frameSizes;
+   size_t samplesPerFrame = 1152;
+   // Whether LAME's CRC of the music counts the place for the tag is
+   // learned from the first segment, so both are kept
+   unsigned short firstMusicCRC = 0, firstAllCRC = 0;
+   unsigned short musicCRC = 0, allCRC = 0;
+   size_t firstSegment = 0;
+   int current = 0;
+
+   auto count = fill(batches[current], firstSegment);
+   while (count > 0 && updateResult == ProgressResult::Success) {
+      auto &batch = batches[current];
+      samplesEncoded.store(0);
+
+      // LAME initializes tables shared by its streams, so streams are made
+      // and closed here, not on the pool
+      bool made = true;
+      for (size_t ii = 0; ii < count; ++ii) {
+         batch[ii].gf = exporter.InitializeSegmentStream(
+            channels, rate, firstSegment + ii == 0);
+         made = made && batch[ii].gf;
+      }
+      auto cleanup = finally( [&exporter, &batch, count] {
+         for (size_t ii = 0; ii < count; ++ii) {
+            exporter.CloseSegmentStream(batch[ii].gf);
+            batch[ii].gf = nullptr;
+         }
+      } );
+      if (!made) {
+         AudacityMessageBox(_("Unable to initialize MP3 stream"));
+         return ProgressResult::Cancelled;
+      }
+
+      // The loop runs on another thread, so that this one can mix
+      // and show progress
+      std::exception_ptr exception;
+      std::atomic<bool> done{ false };
+      std::atomic<bool> stopping{ false };
+      std::thread runner{ [&] {
+         try {
+            scheduler.ParallelFor(TaskScheduler::Interactive, count, [&](size_t ii) {
+               auto &segment = batch[ii];
+               segment.ok = false;
+               segment.frames.clear();
+               segment.frameSizes.clear();
+               if (stopping.load())
+                  return;
+               const bool first = (firstSegment + ii == 0);
+               const int len = segment.samples.size() / channels;
+               segment.output.resize(len + len / 4 + 7200);
+               int bytes = exporter.EncodeSegment(segment.gf, channels,
+                  segment.samples.data(), len,
+                  segment.output.data(), segment.output.size());
+               if (bytes < 0)
+                  return;
+               segment.output.resize(bytes + 7200);
+               int flushed = exporter.FinishSegment(segment.gf,
+                  segment.output.data() + bytes, 7200);
+               if (flushed < 0)
+                  return;
+               segment.output.resize(bytes + flushed);
+               if (first) {
+                  // See MAXFRAMESIZE in libmp3lame/VbrTag.c for 2880
+                  segment.tag.resize(2880);
+                  segment.tag.resize(exporter.GetSegmentInfoTag(segment.gf,
+                     segment.tag.data(), segment.tag.size()));
+               }
+               segment.ok = SplitFrames(segment, channels, first);
+               samplesEncoded += segment.length;
+            });
+         }
+         catch (...) {
+            exception = std::current_exception();
+         }
+         done.store(true);
+      } };
+
+      size_t next = 0;
+      {
+         // A stopped export keeps the batch; a cancelled one does not
+         auto cleanup = finally( [&] {
+            stopping.store(!(updateResult == ProgressResult::Success ||
+                             updateResult == ProgressResult::Stopped));
+            runner.join();
+         } );
+         next = fill(batches[1 - current], firstSegment + count);
+         while (!done.load() && updateResult == ProgressResult::Success) {
+            ::wxMilliSleep(50);
+            update();
+         }
+      }
+      if (exception)
+         std::rethrow_exception(exception);
+      if (!(updateResult == ProgressResult::Success ||
+            updateResult == ProgressResult::Stopped))
+         return updateResult;
+
+      for (size_t ii = 0; ii < count; ++ii) {
+         auto &segment = batch[ii];
+         if (!segment.ok) {
+            AudacityMessageBox(_("Unable to export"));
+            return ProgressResult::Cancelled;
+         }
+         if (firstSegment + ii == 0) {
+            // The place for the tag, written at the end
+            tag = std::move(segment.tag);
+            firstTotals = segment.totals;
+            samplesPerFrame = segment.samplesPerFrame;
+            const auto data = segment.output.data();
+            const auto tagLength = segment.tagLength;
+            firstAllCRC = InfoCRC(0, data, segment.output.size());
+            firstMusicCRC = InfoCRC(0, data + tagLength,
+                                    segment.output.size() - tagLength);
+            allCRC = InfoCRC(0, data, tagLength);
+            totals.bytes = tagLength;
+            if (tagLength > outFile.Write(data, tagLength)) {
+               AudacityMessageBox(_("Unable to export"));
+               return ProgressResult::Cancelled;
+            }
+         }
+         const auto size = segment.frames.size();
+         if (size > outFile.Write(segment.frames.data(), size)) {
+            AudacityMessageBox(_("Unable to export"));
+            return ProgressResult::Cancelled;
+         }
+         musicCRC = InfoCRC(musicCRC, segment.frames.data(), size);
+         allCRC = InfoCRC(allCRC, segment.frames.data(), size);
+         frameSizes.insert(frameSizes.end(),
+            segment.frameSizes.begin(), segment.frameSizes.end());
+         totals.frames += segment.frameSizes.size();
+         totals.bytes += size;
+         totals.samples += segment.length;
+         samplesWritten += segment.length;
+
+         segment.output.clear();
+         segment.frames.clear();
+      }
+
+      firstSegment += count;
+      current = 1 - current;
+      count = next;
+   }
+
+   if (!(updateResult == ProgressResult::Success ||
+         updateResult == ProgressResult::Stopped))
+      return updateResult;
+
+   if (!tag.empty()) {
+      unsigned short stored = 0;
+      const bool countsTag = GetMusicCRC(tag, stored) &&
+         stored == firstAllCRC && stored != firstMusicCRC;
+      PatchInfoTag(tag, firstTotals, totals, samplesPerFrame,
+                   countsTag ? allCRC : musicCRC, frameSizes);
+
+      if ( !outFile.Seek(pos, wxFromStart) ||
+           tag.size() > outFile.Write(tag.data(), tag.size()) ||
+           !outFile.SeekEnd() ) {
+         AudacityMessageBox(_("Unable to export"));
+         return ProgressResult::Cancelled;
+      }
+   }
+
+   return updateResult;
+}
+
 wxWindow *ExportMP3::OptionsCreate(wxWindow *parent, int format)
 {
    wxASSERT(parent); // to justify safenew
@@ -36,6 +36,9 @@
 #include <wx/textctrl.h>
 #include <wx/textdlg.h>
 
+#include <atomic>
+#include <thread>
+
 #include "Export.h"
 
 #include "../Internat.h"
@@ -46,6 +49,7 @@
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
 #include "../Tags.h"
+#include "../TaskScheduler.h"
 #include "../WaveTrack.h"
 #include "../widgets/HelpSystem.h"
 #include "../widgets/ErrorDialog.h"
@@ -741,6 +745,15 @@ ProgressResult ExportMultiple::ExportMultipleByLabel(bool byName,
       l++;  // next label, count up one
    }
 
+   if (CanExportConcurrently(exportSettings.size())) {
+      std::vector<ExportPlugin::ConcurrentJob> jobs;
+      for (const auto &activeSetting : exportSettings)
+         if( !activeSetting.destfile.GetName().IsEmpty() )
+            jobs.push_back(MakeJob(mTracks->GetWaveTrackConstArray(false, false),
+               channels, activeSetting));
+      return DoConcurrentExports(jobs);
+   }
+
    auto ok = ProgressResult::Success;   // did it work?
    int count = 0; // count the number of sucessful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
@@ -884,6 +897,31 @@ ProgressResult ExportMultiple::ExportMultipleByTrack(bool byName,
    }
    // end of user-interactive data gathering loop, start of export processing
    // loop
+   if (CanExportConcurrently(exportSettings.size())) {
+      // The same tracks as the loop below selects, in the same order
+      std::vector<ExportPlugin::ConcurrentJob> jobs;
+      size_t count = 0;
+      for (tr = iter.First(mTracks); tr != NULL; tr = iter.Next()) {
+         auto wt = static_cast<const WaveTrack *>(tr);
+         if ((tr->GetKind() != Track::Wave) || (wt->GetMute()))
+            continue;
+
+         WaveTrackConstArray tracks{ Track::Pointer<const WaveTrack>(wt) };
+         if (tr->GetLinked()) {
+            tr2 = iter.Next();
+            if (tr2 && tr2->GetKind() == Track::Wave &&
+                !static_cast<const WaveTrack *>(tr2)->GetMute())
+               tracks.push_back(Track::Pointer<const WaveTrack>(tr2));
+         }
+
+         const auto &activeSetting = exportSettings[count++];
+         if( !activeSetting.destfile.GetName().IsEmpty() )
+            jobs.push_back(MakeJob(std::move(tracks),
+               activeSetting.channels, activeSetting));
+      }
+      return DoConcurrentExports(jobs);
+   }
+
    int count = 0; // count the number of sucessful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
    std::unique_ptr<ProgressDialog> pDialog;
@@ -952,10 +990,164 @@ ProgressResult ExportMultiple::DoExport(std::unique_ptr<ProgressDialog> &pDialog
       wxLogDebug(wxT("Whole Project"));
 
    wxFileName backup;
+   if (!PrepareFile(inName, name, backup))
+      return ProgressResult::Cancelled;
+
+   ProgressResult success = ProgressResult::Cancelled;
+   const wxString fullPath{name.GetFullPath()};
+
+   auto cleanup = finally( [&] {
+      FinishFile(success, fullPath, backup);
+   } );
+
+   // Call the format export routine
+   success = mPlugins[mPluginIndex]->Export(mProject,
+                                            pDialog,
+                                                channels,
+                                                fullPath,
+                                                selectedOnly,
+                                                t0,
+                                                t1,
+                                                NULL,
+                                                &tags,
+                                                mSubFormatIndex);
+
+   if (success == ProgressResult::Success || success == ProgressResult::Stopped) {
+      mExported.Add(fullPath);
+   }
+
+   Refresh();
+   Update();
+
+   return success;
+}
+
+bool ExportMultiple::CanExportConcurrently(size_t numFiles)
+{
+   return numFiles > 1 &&
+      mPlugins[mPluginIndex]->SupportsConcurrentExport(mSubFormatIndex);
+}
+
+ExportPlugin::ConcurrentJob ExportMultiple::MakeJob(
+   WaveTrackConstArray &&tracks, unsigned channels, const ExportKit &setting)
+{
+   ExportPlugin::ConcurrentJob job;
+   job.tracks = std::move(tracks);
+   job.timeTrack = mTracks->GetTimeTrack();
+   job.rate = mProject->GetRate();
+   job.channels = channels;
+   job.fName = setting.destfile.GetFullPath();
+   job.t0 = setting.t0;
+   job.t1 = setting.t1;
+   job.tags = setting.filetags;
+   job.subformat = mSubFormatIndex;
+   return job;
+}
+
+ProgressResult ExportMultiple::DoConcurrentExports(
+   std::vector<ExportPlugin::ConcurrentJob> &jobs)
+{
+   const auto count = jobs.size();
+
+   std::vector<wxFileName> backups(count);
+   std::vector<ProgressResult> results(count, ProgressResult::Cancelled);
+   std::vector<wxString> errors(count);
+   size_t nPrepared = 0;
+   {
+      auto cleanup = finally( [&] {
+         for (size_t ii = 0; ii < nPrepared; ++ii)
+            FinishFile(results[ii], jobs[ii].fName, backups[ii]);
+      } );
+
+      // The names are chosen here, not on the worker threads
+      for (; nPrepared < count; ++nPrepared) {
+         wxFileName name;
+         if (!PrepareFile(wxFileName{ jobs[nPrepared].fName },
+                          name, backups[nPrepared]))
+            return ProgressResult::Cancelled;
+         jobs[nPrepared].fName = name.GetFullPath();
+      }
+
+      ProgressDialog progress(_("Export Multiple"),
+         wxString::Format(_("Exporting %d files"), (int)count));
+
+      // The jobs see the latest answer of the dialog
+      std::atomic<ProgressResult> latest{ ProgressResult::Success };
+      std::vector< std::atomic<double> > fractions(count);
+      for (auto &fraction : fractions)
+         fraction.store(0.0);
+
+      const auto &plugin = mPlugins[mPluginIndex];
+      auto &scheduler = TaskScheduler::Get();
+
+      // The loop runs on another thread, so that this one can show progress
+      std::exception_ptr exception;
+      std::atomic<bool> done{ false };
+      std::thread runner{ [&] {
+         try {
+            scheduler.ParallelFor(TaskScheduler::Interactive, count, [&](size_t ii) {
+               // Files not begun when the user stops are not begun at all
+               if (latest.load() != ProgressResult::Success)
+                  return;
+               results[ii] = plugin->ExportConcurrently(jobs[ii],
+                  [&](double fraction) {
+                     fractions[ii].store(fraction);
+                     return latest.load();
+                  },
+                  errors[ii]);
+               fractions[ii].store(1.0);
+            });
+         }
+         catch (...) {
+            exception = std::current_exception();
+         }
+         done.store(true);
+      } };
+      while (!done.load()) {
+         ::wxMilliSleep(50);
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (latest.load() == ProgressResult::Success)
+            latest.store(progress.Update(sum, (double)count));
+      }
+      runner.join();
+
+      if (exception)
+         std::rethrow_exception(exception);
+   }
+
+   // Report the first failure, as the loop over DoExport() would
+   auto ok = ProgressResult::Success;
+   for (size_t ii = 0; ii < count; ++ii) {
+      const auto result = results[ii];
+      if (result == ProgressResult::Success ||
+          result == ProgressResult::Stopped) {
+         mExported.Add(jobs[ii].fName);
+         if (result == ProgressResult::Stopped && ok == ProgressResult::Success)
+            ok = result;
+      }
+      else if (ok == ProgressResult::Success ||
+               ok == ProgressResult::Stopped) {
+         ok = result;
+         if (!errors[ii].empty())
+            AudacityMessageBox(errors[ii]);
+      }
+   }
+
+   Refresh();
+   Update();
+
+   return ok;
+}
+
+bool ExportMultiple::PrepareFile(const wxFileName &inName,
+                                 wxFileName &name, wxFileName &backup)
+{
    if (mOverwrite->GetValue()) {
       // Make sure we don't overwrite (corrupt) alias files
       if (!mProject->GetDirManager()->EnsureSafeFilename(inName)) {
-         return ProgressResult::Cancelled;
+         return false;
       }
       name = inName;
       backup.Assign(name);
@@ -978,50 +1170,31 @@ ProgressResult ExportMultiple::DoExport(std::unique_ptr<ProgressDialog> &pDialog
       }
    }
 
-   ProgressResult success = ProgressResult::Cancelled;
-   const wxString fullPath{name.GetFullPath()};
+   return true;
+}
 
-   auto cleanup = finally( [&] {
-      bool ok =
-         success == ProgressResult::Stopped ||
-         success == ProgressResult::Success;
-      if (backup.IsOk()) {
-         if ( ok )
-            // Remove backup
-            ::wxRemoveFile(backup.GetFullPath());
-         else {
-            // Restore original
-            ::wxRemoveFile(fullPath);
-            ::wxRenameFile(backup.GetFullPath(), fullPath);
-         }
-      }
+void ExportMultiple::FinishFile(ProgressResult success,
+                                const wxString &fullPath,
+                                const wxFileName &backup)
+{
+   bool ok =
+      success == ProgressResult::Stopped ||
+      success == ProgressResult::Success;
+   if (backup.IsOk()) {
+      if ( ok )
+         // Remove backup
+         ::wxRemoveFile(backup.GetFullPath());
       else {
-         if ( ! ok )
-            // Remove any new, and only partially written, file.
-            ::wxRemoveFile(fullPath);
+         // Restore original
+         ::wxRemoveFile(fullPath);
+         ::wxRenameFile(backup.GetFullPath(), fullPath);
       }
-   } );
-
-   // Call the format export routine
-   success = mPlugins[mPluginIndex]->Export(mProject,
-                                            pDialog,
-                                                channels,
-                                                fullPath,
-                                                selectedOnly,
-                                                t0,
-                                                t1,
-                                                NULL,
-                                                &tags,
-                                                mSubFormatIndex);
-
-   if (success == ProgressResult::Success || success == ProgressResult::Stopped) {
-      mExported.Add(fullPath);
    }
-
-   Refresh();
-   Update();
-
-   return success;
+   else {
+      if ( ! ok )
+         // Remove any new, and only partially written, file.
+         ::wxRemoveFile(fullPath);
+   }
 }
 
 wxString ExportMultiple::MakeFileName(const wxString &input)
@@ -27,6 +27,7 @@ class wxRadioButton;
 class wxTextCtrl;
 
 class AudacityProject;
+class ExportKit;
 class LabelTrack;
 class SelectionState;
 class ShuttleGui;
@@ -82,6 +83,33 @@ private:
                  double t0,
                  double t1,
                  const Tags &tags);
+
+   /** \brief Whether the plug-in can export the files at once, on
+    * worker threads */
+   bool CanExportConcurrently(size_t numFiles);
+
+   /** \brief What DoConcurrentExports() needs for one file
+    *
+    * @param tracks The tracks to mix, whatever the selection */
+   ExportPlugin::ConcurrentJob MakeJob(WaveTrackConstArray &&tracks,
+                 unsigned channels, const ExportKit &setting);
+
+   /** Export all the files of an export multiple set at once, showing the
+    * progress of all of them in one dialog.  As DoExport() for each, except
+    * that the first error is shown when all are done. */
+   ProgressResult DoConcurrentExports(
+                 std::vector<ExportPlugin::ConcurrentJob> &jobs);
+
+   /** \brief Chooses the name of a file to export, which is inName, or is
+    * unique, and moves any file to be overwritten to backup.
+    * Returns false if the file must not be overwritten. */
+   bool PrepareFile(const wxFileName &inName,
+                 wxFileName &name, wxFileName &backup);
+   /** \brief Removes the backup, or restores it, or removes a partial file,
+    * as the export succeeded or not */
+   void FinishFile(ProgressResult success, const wxString &fullPath,
+                 const wxFileName &backup);
+
    /** \brief Takes an arbitrary text string and converts it to a form that can
     * be used as a file name, if necessary prompting the user to edit the file
     * name produced */
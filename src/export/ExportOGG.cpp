@@ -22,6 +22,12 @@
 #include "ExportOGG.h"
 #include "Export.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <wx/log.h>
 #include <wx/slider.h>
  
@@ -123,6 +129,20 @@ bool ExportOGGOptions::TransferDataFromWindow()
 
 #define SAMPLES_PER_RUN 8192u
 
+namespace {
+   // Packets analysed ahead of the writer, at most
+   const size_t PacketQueueDepth = 64;
+
+   // A packet with its own copy of the bytes
+   struct EncodedPacket
+   {
+      std::vector<unsigned char> bytes;
+      ogg_packet packet;
+      // Of the end of the mix that made it
+      double time;
+   };
+}
+
 class ExportOGG final : public ExportPlugin
 {
 public:
@@ -142,10 +162,32 @@ public:
                MixerSpec *mixerSpec = NULL,
                const Tags *metadata = NULL,
                int subformat = 0) override;
+   bool SupportsConcurrentExport(int subformat) override;
+   ProgressResult ExportConcurrently(const ConcurrentJob &job,
+               const ConcurrentProgress &progress,
+               wxString &error) override;
 
 private:
 
-   bool FillComment(AudacityProject *project, vorbis_comment *comment, const Tags *metadata);
+   // Shared by Export() and ExportConcurrently(); startProgress is called
+   // once, when the encoding begins
+   ProgressResult ExportTracks(const WaveTrackConstArray &waveTracks,
+               const TimeTrack *timeTrack,
+               double rate,
+               unsigned numChannels,
+               const wxString &fName,
+               double t0,
+               double t1,
+               MixerSpec *mixerSpec,
+               const Tags *metadata,
+               double quality,
+               const std::function< ConcurrentProgress() > &startProgress,
+               wxString &error);
+
+   static bool FillComment(vorbis_comment *comment, const Tags *metadata);
+
+   // The quality for concurrent exports, read on the main thread
+   double mConcurrentQuality{ 0.5 };
 };
 
 ExportOGG::ExportOGG()
@@ -174,6 +216,63 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    const TrackList *tracks = project->GetTracks();
    double    quality = (gPrefs->Read(wxT("/FileFormats/OggExportQuality"), 50)/(float)100.0);
 
+   // Retrieve tags from project if not over-ridden
+   if (metadata == NULL)
+      metadata = project->GetTags();
+
+   wxString error;
+   const auto result = ExportTracks(
+      tracks->GetWaveTrackConstArray(selectionOnly, false),
+      tracks->GetTimeTrack(),
+      rate, numChannels, fName, t0, t1, mixerSpec, metadata, quality,
+      [&]() -> ConcurrentProgress {
+         InitProgress( pDialog, wxFileName(fName).GetName(),
+            selectionOnly
+               ? _("Exporting the selected audio as Ogg Vorbis")
+               : _("Exporting the audio as Ogg Vorbis") );
+         const auto pProgress = pDialog.get();
+         return [=](double fraction)
+            { return pProgress->Update(fraction, 1.0); };
+      },
+      error);
+
+   if (!error.empty())
+      AudacityMessageBox(error);
+   return result;
+}
+
+bool ExportOGG::SupportsConcurrentExport(int WXUNUSED(subformat))
+{
+   // Called on the main thread, just before the jobs start, so they need
+   // not read the preferences
+   mConcurrentQuality =
+      gPrefs->Read(wxT("/FileFormats/OggExportQuality"), 50)/(float)100.0;
+   return true;
+}
+
+ProgressResult ExportOGG::ExportConcurrently(const ConcurrentJob &job,
+                       const ConcurrentProgress &progress,
+                       wxString &error)
+{
+   return ExportTracks(job.tracks, job.timeTrack, job.rate, job.channels,
+      job.fName, job.t0, job.t1, NULL, &job.tags, mConcurrentQuality,
+      [&]{ return progress; },
+      error);
+}
+
+ProgressResult ExportOGG::ExportTracks(const WaveTrackConstArray &waveTracks,
+                       const TimeTrack *timeTrack,
+                       double rate,
+                       unsigned numChannels,
+                       const wxString &fName,
+                       double t0,
+                       double t1,
+                       MixerSpec *mixerSpec,
+                       const Tags *metadata,
+                       double quality,
+                       const std::function< ConcurrentProgress() > &startProgress,
+                       wxString &error)
+{
    wxLogNull logNo;            // temporarily disable wxWidgets error messages
    auto updateResult = ProgressResult::Success;
    int       eos = 0;
@@ -181,7 +280,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    FileIO outFile(fName, FileIO::Output);
 
    if (!outFile.IsOpened()) {
-      AudacityMessageBox(_("Unable to open target file for writing"));
+      error = _("Unable to open target file for writing");
       return ProgressResult::Cancelled;
    }
 
@@ -211,14 +310,14 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    vorbis_info_init(&info);
    if (vorbis_encode_init_vbr(&info, numChannels, (int)(rate + 0.5), quality)) {
       // TODO: more precise message
-      AudacityMessageBox(_("Unable to export"));
+      error = _("Unable to export");
       return ProgressResult::Cancelled;
    }
 
    // Retrieve tags
-   if (!FillComment(project, &comment, metadata)) {
+   if (!FillComment(&comment, metadata)) {
       // TODO: more precise message
-      AudacityMessageBox(_("Unable to export"));
+      error = _("Unable to export");
       return ProgressResult::Cancelled;
    }
 
@@ -226,7 +325,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    if (vorbis_analysis_init(&dsp, &info) ||
        vorbis_block_init(&dsp, &block)) {
       // TODO: more precise message
-      AudacityMessageBox(_("Unable to export"));
+      error = _("Unable to export");
       return ProgressResult::Cancelled;
    }
 
@@ -236,7 +335,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
    srand(time(NULL));
    if (ogg_stream_init(&stream, rand())) {
       // TODO: more precise message
-      AudacityMessageBox(_("Unable to export"));
+      error = _("Unable to export");
       return ProgressResult::Cancelled;
    }
 
@@ -259,7 +358,7 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
       ogg_stream_packetin(&stream, &comment_header) ||
       ogg_stream_packetin(&stream, &codebook_header)) {
       // TODO: more precise message
-      AudacityMessageBox(_("Unable to export"));
+      error = _("Unable to export");
       return ProgressResult::Cancelled;
    }
 
@@ -269,103 +368,176 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
       if ( outFile.Write(page.header, page.header_len).GetLastError() ||
            outFile.Write(page.body, page.body_len).GetLastError()) {
          // TODO: more precise message
-         AudacityMessageBox(_("Unable to export"));
+         error = _("Unable to export");
          return ProgressResult::Cancelled;
       }
    }
 
-   const WaveTrackConstArray waveTracks =
-      tracks->GetWaveTrackConstArray(selectionOnly, false);
+   // The encoder thread analyses the mix and gives packets to this one,
+   // which makes the pages and writes them
+   std::mutex mutex;
+   std::condition_variable filledCondition;
+   std::condition_variable freedCondition;
+   // Guarded by mutex:
+   std::deque<EncodedPacket> packets;
+   bool encoded = false;
+   bool stopping = false;
+   int err = 0;
+   std::exception_ptr exception;
+
    {
-      auto mixer = CreateMixer(waveTracks,
-         tracks->GetTimeTrack(),
+      auto mixer = CreatePipelinedMixer(waveTracks,
+         timeTrack,
          t0, t1,
          numChannels, SAMPLES_PER_RUN, false,
          rate, floatSample, true, mixerSpec);
 
-      InitProgress( pDialog, wxFileName(fName).GetName(),
-         selectionOnly
-            ? _("Exporting the selected audio as Ogg Vorbis")
-            : _("Exporting the audio as Ogg Vorbis") );
-      auto &progress = *pDialog;
-
-      while (updateResult == ProgressResult::Success && !eos) {
-         float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
-         auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
+      const auto progress = startProgress();
+
+      std::thread encoder{ [&] {
+         int encodeErr = 0;
+         std::exception_ptr encodeException;
+         try {
+            bool done = false;
+            while (!encodeErr && !done) {
+               float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
+               auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
+
+               if (samplesThisRun == 0) {
+                  // Tell the library that we wrote 0 bytes - signalling the end.
+                  encodeErr = vorbis_analysis_wrote(&dsp, 0);
+                  done = true;
+               }
+               else {
 
-         int err;
-         if (samplesThisRun == 0) {
-            // Tell the library that we wrote 0 bytes - signalling the end.
-            err = vorbis_analysis_wrote(&dsp, 0);
-         }
-         else {
+                  for (size_t i = 0; i < numChannels; i++) {
+                     float *temp = (float *)mixer->GetBuffer(i);
+                     memcpy(vorbis_buffer[i], temp, sizeof(float)*SAMPLES_PER_RUN);
+                  }
 
-            for (size_t i = 0; i < numChannels; i++) {
-               float *temp = (float *)mixer->GetBuffer(i);
-               memcpy(vorbis_buffer[i], temp, sizeof(float)*SAMPLES_PER_RUN);
+                  // tell the encoder how many samples we have
+                  encodeErr = vorbis_analysis_wrote(&dsp, samplesThisRun);
+               }
+               const double time = mixer->MixGetCurrentTime();
+
+               // I don't understand what this call does, so here is the comment
+               // from the example, verbatim:
+               //
+               //    vorbis does some data preanalysis, then divvies up blocks
+               //    for more involved (potentially parallel) processing. Get
+               //    a single block for encoding now
+               while (!encodeErr && vorbis_analysis_blockout(&dsp, &block) == 1) {
+
+                  // analysis, assume we want to use bitrate management
+                  encodeErr = vorbis_analysis(&block, NULL);
+                  if (!encodeErr)
+                     encodeErr = vorbis_bitrate_addblock(&block);
+
+                  ogg_packet out;
+                  while (!encodeErr && vorbis_bitrate_flushpacket(&dsp, &out)) {
+                     // libvorbis reuses the bytes of the packet
+                     EncodedPacket encodedPacket;
+                     encodedPacket.bytes.assign(out.packet, out.packet + out.bytes);
+                     encodedPacket.packet = out;
+                     encodedPacket.packet.packet = encodedPacket.bytes.data();
+                     encodedPacket.time = time;
+
+                     std::unique_lock<std::mutex> lock{ mutex };
+                     freedCondition.wait(lock, [&]{
+                        return stopping || packets.size() < PacketQueueDepth; });
+                     if (stopping)
+                        return;
+                     packets.push_back(std::move(encodedPacket));
+                     filledCondition.notify_one();
+                  }
+               }
             }
-
-            // tell the encoder how many samples we have
-            err = vorbis_analysis_wrote(&dsp, samplesThisRun);
+         }
+         catch (...) {
+            encodeException = std::current_exception();
          }
 
-         // I don't understand what this call does, so here is the comment
-         // from the example, verbatim:
-         //
-         //    vorbis does some data preanalysis, then divvies up blocks
-         //    for more involved (potentially parallel) processing. Get
-         //    a single block for encoding now
-         while (!err && vorbis_analysis_blockout(&dsp, &block) == 1) {
+         std::lock_guard<std::mutex> lock{ mutex };
+         err = encodeErr;
+         exception = encodeException;
+         encoded = true;
+         filledCondition.notify_one();
+      } };
 
-            // analysis, assume we want to use bitrate management
-            err = vorbis_analysis(&block, NULL);
-            if (!err)
-               err = vorbis_bitrate_addblock(&block);
+      auto joinIt = finally( [&] {
+         {
+            std::lock_guard<std::mutex> lock{ mutex };
+            stopping = true;
+         }
+         freedCondition.notify_one();
+         encoder.join();
+      } );
 
-            while (!err && vorbis_bitrate_flushpacket(&dsp, &packet)) {
+      while (updateResult == ProgressResult::Success && !eos) {
+         EncodedPacket encodedPacket;
+         {
+            std::unique_lock<std::mutex> lock{ mutex };
+            filledCondition.wait(lock, [&]{
+               return encoded || !packets.empty(); });
+            if (packets.empty())
+               break;
+            encodedPacket = std::move(packets.front());
+            packets.pop_front();
+            freedCondition.notify_one();
+         }
+         packet = encodedPacket.packet;
 
-               // add the packet to the bitstream
-               err = ogg_stream_packetin(&stream, &packet);
+         // add the packet to the bitstream
+         int writeErr = ogg_stream_packetin(&stream, &packet);
 
-               // From vorbis-tools-1.0/oggenc/encode.c:
-               //   If we've gone over a page boundary, we can do actual output,
-               //   so do so (for however many pages are available).
+         // From vorbis-tools-1.0/oggenc/encode.c:
+         //   If we've gone over a page boundary, we can do actual output,
+         //   so do so (for however many pages are available).
 
-               while (!err && !eos) {
-                  int result = ogg_stream_pageout(&stream, &page);
-                  if (!result) {
-                     break;
-                  }
+         while (!writeErr && !eos) {
+            int result = ogg_stream_pageout(&stream, &page);
+            if (!result) {
+               break;
+            }
 
-                  if ( outFile.Write(page.header, page.header_len).GetLastError() ||
-                       outFile.Write(page.body, page.body_len).GetLastError()) {
-                     // TODO: more precise message
-                     AudacityMessageBox(_("Unable to export"));
-                     return ProgressResult::Cancelled;
-                  }
+            if ( outFile.Write(page.header, page.header_len).GetLastError() ||
+                 outFile.Write(page.body, page.body_len).GetLastError()) {
+               // TODO: more precise message
+               error = _("Unable to export");
+               return ProgressResult::Cancelled;
+            }
 
-                  if (ogg_page_eos(&page)) {
-                     eos = 1;
-                  }
-               }
+            if (ogg_page_eos(&page)) {
+               eos = 1;
             }
          }
 
-         if (err) {
+         if (writeErr) {
             updateResult = ProgressResult::Cancelled;
             // TODO: more precise message
-            AudacityMessageBox(_("Unable to export"));
+            error = _("Unable to export");
             break;
          }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+         updateResult = progress(t1 > t0
+            ? (encodedPacket.time - t0) / (t1 - t0) : 1.0);
       }
    }
 
+   // The encoder thread is joined now
+   if (exception)
+      std::rethrow_exception(exception);
+
+   if (err && updateResult == ProgressResult::Success) {
+      updateResult = ProgressResult::Cancelled;
+      // TODO: more precise message
+      error = _("Unable to export");
+   }
+
    if ( !outFile.Close() ) {
       updateResult = ProgressResult::Cancelled;
       // TODO: more precise message
-      AudacityMessageBox(_("Unable to export"));
+      error = _("Unable to export");
    }
 
    return updateResult;
@@ -377,12 +549,8 @@ wxWindow *ExportOGG::OptionsCreate(wxWindow *parent, int format)
    return safenew ExportOGGOptions(parent, format);
 }
 
-bool ExportOGG::FillComment(AudacityProject *project, vorbis_comment *comment, const Tags *metadata)
+bool ExportOGG::FillComment(vorbis_comment *comment, const Tags *metadata)
 {
-   // Retrieve tags from project if not over-ridden
-   if (metadata == NULL)
-      metadata = project->GetTags();
-
    vorbis_comment_init(comment);
 
    wxString n;
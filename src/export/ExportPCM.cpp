@@ -34,10 +34,13 @@
 #include "../ShuttleGui.h"
 #include "../Tags.h"
 #include "../Track.h"
+#include "../WaveClip.h"
+#include "../WaveTrack.h"
 #include "../ondemand/ODManager.h"
 #include "../widgets/ErrorDialog.h"
 
 #include "Export.h"
+#include "SharedMix.h"
 
 #ifdef USE_LIBID3TAG
    #include <id3tag.h>
@@ -331,12 +334,32 @@ public:
                MixerSpec *mixerSpec = NULL,
                const Tags *metadata = NULL,
                int subformat = 0) override;
+   bool SupportsConcurrentExport(int subformat) override;
+   ProgressResult ExportConcurrently(const ConcurrentJob &job,
+               const ConcurrentProgress &progress,
+               wxString &error) override;
    // optional
    wxString GetExtension(int index) override;
    bool CheckFileName(wxFileName &filename, int format) override;
 
 private:
 
+   // Shared by Export() and ExportConcurrently(); startProgress is called
+   // once, with the name of the format
+   ProgressResult ExportTracks(const WaveTrackConstArray &waveTracks,
+               const TimeTrack *timeTrack,
+               double rate,
+               unsigned numChannels,
+               const wxString &fName,
+               double t0,
+               double t1,
+               MixerSpec *mixerSpec,
+               const Tags *metadata,
+               int sf_format,
+               const std::function< ConcurrentProgress(const wxString &formatStr) >
+                  &startProgress,
+               wxString &error);
+
    ArrayOf<char> AdjustString(const wxString & wxStr, int sf_format);
    bool AddStrings(AudacityProject *project, SNDFILE *sf, const Tags *tags, int sf_format);
    bool AddID3Chunk(wxString fName, const Tags *tags, int sf_format);
@@ -417,6 +440,104 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       sf_format = kFormats[subformat].format;
    }
 
+   // Retrieve tags if not given a set
+   if (metadata == NULL)
+      metadata = project->GetTags();
+
+   wxString error;
+   const auto result = ExportTracks(
+      tracks->GetWaveTrackConstArray(selectionOnly, false),
+      tracks->GetTimeTrack(),
+      rate, numChannels, fName, t0, t1, mixerSpec, metadata, sf_format,
+      [&](const wxString &formatStr) -> ConcurrentProgress {
+         InitProgress( pDialog, wxFileName(fName).GetName(),
+            selectionOnly
+               ? wxString::Format(_("Exporting the selected audio as %s"),
+                  formatStr)
+               : wxString::Format(_("Exporting the audio as %s"),
+                  formatStr) );
+         const auto pProgress = pDialog.get();
+         return [=](double fraction)
+            { return pProgress->Update(fraction, 1.0); };
+      },
+      error);
+
+   if (!error.empty())
+      AudacityMessageBox(error);
+   return result;
+}
+
+bool ExportPCM::SupportsConcurrentExport(int subformat)
+{
+   // Not the generic format, which reads the preferences for its encoding
+   return subformat >= 0 &&
+      static_cast<unsigned int>(subformat) < WXSIZEOF(kFormats);
+}
+
+ProgressResult ExportPCM::ExportConcurrently(const ConcurrentJob &job,
+                       const ConcurrentProgress &progress,
+                       wxString &error)
+{
+   return ExportTracks(job.tracks, job.timeTrack, job.rate, job.channels,
+      job.fName, job.t0, job.t1, NULL, &job.tags,
+      kFormats[job.subformat].format,
+      [&](const wxString &) { return progress; },
+      error);
+}
+
+// Whether the tracks can be written as they are, without a Mixer:  one mono
+// track, or one stereo pair, needing no gain, envelope or resampling, and
+// kept in a format that converts to the exported one without dither
+static bool CanCopyUnmixed(const WaveTrackConstArray &waveTracks,
+                           const TimeTrack *timeTrack,
+                           double rate,
+                           unsigned numChannels,
+                           const MixerSpec *mixerSpec,
+                           sampleFormat format)
+{
+   if (timeTrack || mixerSpec ||
+       numChannels < 1 || numChannels > 2 ||
+       waveTracks.size() != numChannels)
+      return false;
+
+   if (numChannels == 2 &&
+       (waveTracks[0]->GetChannel() != Track::LeftChannel ||
+        waveTracks[1]->GetChannel() != Track::RightChannel))
+      return false;
+
+   for (const auto &track : waveTracks) {
+      // The formats are ordered from narrowest to widest
+      if (track->GetRate() != rate ||
+          track->GetSampleFormat() > format ||
+          track->GetGain() != 1.0 ||
+          track->GetPan() != 0.0)
+         return false;
+
+      for (const auto &clip : track->GetClips()) {
+         const auto envelope = clip->GetEnvelope();
+         if (envelope->GetNumberOfPoints() > 0 ||
+             envelope->GetValue(envelope->GetOffset()) != 1.0)
+            return false;
+      }
+   }
+
+   return true;
+}
+
+ProgressResult ExportPCM::ExportTracks(const WaveTrackConstArray &waveTracks,
+                       const TimeTrack *timeTrack,
+                       double rate,
+                       unsigned numChannels,
+                       const wxString &fName,
+                       double t0,
+                       double t1,
+                       MixerSpec *mixerSpec,
+                       const Tags *metadata,
+                       int sf_format,
+                       const std::function< ConcurrentProgress(const wxString &) >
+                          &startProgress,
+                       wxString &error)
+{
    auto updateResult = ProgressResult::Success;
    {
       wxFile f;   // will be closed when it goes out of scope
@@ -445,7 +566,7 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       if (!sf_format_check(&info))
          info.format = (info.format & SF_FORMAT_TYPEMASK);
       if (!sf_format_check(&info)) {
-         AudacityMessageBox(_("Cannot export audio in this format."));
+         error = _("Cannot export audio in this format.");
          return ProgressResult::Cancelled;
       }
 
@@ -459,19 +580,14 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       }
 
       if (!sf) {
-         AudacityMessageBox(wxString::Format(_("Cannot export audio to %s"),
-                                       fName));
+         error = wxString::Format(_("Cannot export audio to %s"), fName);
          return ProgressResult::Cancelled;
       }
-      // Retrieve tags if not given a set
-      if (metadata == NULL)
-         metadata = project->GetTags();
-
       // Install the metata at the beginning of the file (except for
       // WAV and WAVEX formats)
       if ((sf_format & SF_FORMAT_TYPEMASK) != SF_FORMAT_WAV &&
           (sf_format & SF_FORMAT_TYPEMASK) != SF_FORMAT_WAVEX) {
-         if (!AddStrings(project, sf.get(), metadata, sf_format)) {
+         if (!AddStrings(NULL, sf.get(), metadata, sf_format)) {
             return ProgressResult::Cancelled;
          }
       }
@@ -484,53 +600,90 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
 
       size_t maxBlockLen = 44100 * 5;
 
-      const WaveTrackConstArray waveTracks =
-      tracks->GetWaveTrackConstArray(selectionOnly, false);
-      {
-         wxASSERT(info.channels >= 0);
-         auto mixer = CreateMixer(waveTracks,
-                                  tracks->GetTimeTrack(),
+      const auto writeFrames = [&](samplePtr buffer, size_t numSamples) -> bool {
+         sf_count_t samplesWritten;
+         if (format == int16Sample)
+            samplesWritten = SFCall<sf_count_t>(sf_writef_short, sf.get(), (short *)buffer, numSamples);
+         else
+            samplesWritten = SFCall<sf_count_t>(sf_writef_float, sf.get(), (float *)buffer, numSamples);
+
+         if (static_cast<size_t>(samplesWritten) != numSamples) {
+            char buffer2[1000];
+            sf_error_str(sf.get(), buffer2, 1000);
+            error = wxString::Format(
+               /* i18n-hint: %s will be the error message from libsndfile, which
+                * is usually something unhelpful (and untranslated) like "system
+                * error" */
+               _("Error while writing %s file (disk full?).\nLibsndfile says \"%s\""),
+               formatStr,
+               wxString::FromAscii(buffer2));
+            return false;
+         }
+         return true;
+      };
+
+      wxASSERT(info.channels >= 0);
+      if (CanCopyUnmixed(waveTracks, timeTrack, rate, info.channels,
+                         mixerSpec, format)) {
+         // Read the samples straight from the blocks, with gaps between
+         // clips as silence, as the mixer would give them.  That is exact,
+         // so it is preferred to a mix shared with other exports.
+         SharedMix::Decline();
+         const auto &track0 = waveTracks[0];
+         const auto start = track0->TimeToLongSamples(t0);
+         const auto end = track0->TimeToLongSamples(t1);
+         const auto sampleSize = SAMPLE_SIZE(format);
+         SampleBuffer channelBuffer{ maxBlockLen, format };
+         SampleBuffer interleaved{ maxBlockLen * info.channels, format };
+
+         const auto progress = startProgress(formatStr);
+
+         auto pos = start;
+         while (pos < end && updateResult == ProgressResult::Success) {
+            const auto numSamples = limitSampleBufferSize(maxBlockLen, end - pos);
+
+            if (info.channels == 1)
+               track0->Get(interleaved.ptr(), format, pos, numSamples);
+            else
+               for (int cc = 0; cc < info.channels; ++cc) {
+                  waveTracks[cc]->Get(channelBuffer.ptr(), format, pos, numSamples);
+                  CopySamplesNoDither(channelBuffer.ptr(), format,
+                     interleaved.ptr() + cc * sampleSize, format,
+                     numSamples, 1, info.channels);
+               }
+
+            if (!writeFrames(interleaved.ptr(), numSamples)) {
+               updateResult = ProgressResult::Cancelled;
+               break;
+            }
+
+            pos += numSamples;
+            updateResult = progress(
+               (pos - start).as_double() / (end - start).as_double());
+         }
+      }
+      else {
+         auto mixer = CreatePipelinedMixer(waveTracks,
+                                  timeTrack,
                                   t0, t1,
                                   info.channels, maxBlockLen, true,
                                   rate, format, true, mixerSpec);
 
-         InitProgress( pDialog, wxFileName(fName).GetName(),
-            selectionOnly
-               ? wxString::Format(_("Exporting the selected audio as %s"),
-                  formatStr)
-               : wxString::Format(_("Exporting the audio as %s"),
-                  formatStr) );
-         auto &progress = *pDialog;
+         const auto progress = startProgress(formatStr);
 
          while (updateResult == ProgressResult::Success) {
-            sf_count_t samplesWritten;
             size_t numSamples = mixer->Process(maxBlockLen);
 
             if (numSamples == 0)
                break;
 
-            samplePtr mixed = mixer->GetBuffer();
-
-            if (format == int16Sample)
-               samplesWritten = SFCall<sf_count_t>(sf_writef_short, sf.get(), (short *)mixed, numSamples);
-            else
-               samplesWritten = SFCall<sf_count_t>(sf_writef_float, sf.get(), (float *)mixed, numSamples);
-
-            if (static_cast<size_t>(samplesWritten) != numSamples) {
-               char buffer2[1000];
-               sf_error_str(sf.get(), buffer2, 1000);
-               AudacityMessageBox(wxString::Format(
-                                             /* i18n-hint: %s will be the error message from libsndfile, which
-                                              * is usually something unhelpful (and untranslated) like "system
-                                              * error" */
-                                             _("Error while writing %s file (disk full?).\nLibsndfile says \"%s\""),
-                                             formatStr,
-                                             wxString::FromAscii(buffer2)));
+            if (!writeFrames(mixer->GetBuffer(), numSamples)) {
                updateResult = ProgressResult::Cancelled;
                break;
             }
             
-            updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+            updateResult = progress(t1 > t0
+               ? (mixer->MixGetCurrentTime() - t0) / (t1 - t0) : 1.0);
          }
       }
       
@@ -539,15 +692,15 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
           updateResult == ProgressResult::Stopped) {
          if ((sf_format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV ||
              (sf_format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAVEX) {
-            if (!AddStrings(project, sf.get(), metadata, sf_format)) {
+            if (!AddStrings(NULL, sf.get(), metadata, sf_format)) {
                // TODO: more precise message
-               AudacityMessageBox(_("Unable to export"));
+               error = _("Unable to export");
                return ProgressResult::Cancelled;
             }
          }
          if (0 != sf.close()) {
             // TODO: more precise message
-            AudacityMessageBox(_("Unable to export"));
+            error = _("Unable to export");
             return ProgressResult::Cancelled;
          }
       }
@@ -560,7 +713,7 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
          // Note: file has closed, and gets reopened and closed again here:
          if (!AddID3Chunk(fName, metadata, sf_format) ) {
             // TODO: more precise message
-            AudacityMessageBox(_("Unable to export"));
+            error = _("Unable to export");
             return ProgressResult::Cancelled;
          }
 
@@ -0,0 +1,227 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PipelinedMixer.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "../Audacity.h"
+#include "PipelinedMixer.h"
+
+#include <algorithm>
+#include <string.h>
+#include <wx/debug.h>
+
+#include "../Mix.h"
+
+PipelinedMixer::PipelinedMixer(std::unique_ptr<Mixer> &&mixer,
+   unsigned numChannels, size_t bufferSize, bool interleaved,
+   sampleFormat format, size_t depth)
+   : mMixer{ std::move( mixer ) }
+   , mNumChannels{ numChannels }
+   , mBufferSize{ bufferSize }
+   , mInterleaved{ interleaved }
+   , mFormat{ format }
+   , mCurrentTime{ mMixer->MixGetCurrentTime() }
+{
+   AllocateSlots( depth );
+   mThread = std::thread{ [this]{ MixerLoop(); } };
+}
+
+PipelinedMixer::PipelinedMixer(const std::shared_ptr<SharedMix> &mix,
+   size_t consumer,
+   unsigned numChannels, size_t bufferSize, bool interleaved,
+   sampleFormat format, size_t depth)
+   : mSharedMix{ mix }
+   , mConsumer{ consumer }
+   , mNumChannels{ numChannels }
+   , mBufferSize{ bufferSize }
+   , mInterleaved{ interleaved }
+   , mFormat{ format }
+   , mCurrentTime{ mix->GetStartTime() }
+{
+   wxASSERT( mix->GetNumChannels() == numChannels );
+   AllocateSlots( depth );
+   mThread = std::thread{ [this]{ MixerLoop(); } };
+}
+
+void PipelinedMixer::AllocateSlots(size_t depth)
+{
+   // One more slot than the depth, for the buffer the exporter has
+   const auto nSlots = std::max<size_t>( 1, depth ) + 1;
+   const auto nBuffers = mInterleaved ? 1 : mNumChannels;
+   const auto bufferLength = mInterleaved
+      ? mBufferSize * mNumChannels
+      : mBufferSize;
+   mSlots.reinit( nSlots );
+   for ( size_t ii = 0; ii < nSlots; ++ii ) {
+      auto &slot = mSlots[ ii ];
+      slot.buffers.reinit( nBuffers );
+      for ( size_t jj = 0; jj < nBuffers; ++jj )
+         slot.buffers[ jj ].Allocate( bufferLength, mFormat );
+      slot.length = 0;
+      slot.time = mCurrentTime;
+      mFree.push_back( &slot );
+   }
+}
+
+PipelinedMixer::~PipelinedMixer()
+{
+   // Buffers not yet taken are discarded, as when an export is cancelled
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mStopping = true;
+   }
+   mFreedCondition.notify_one();
+   mThread.join();
+
+   // The mix need not wait for this consumer any more
+   if ( mSharedMix )
+      mSharedMix->Detach( mConsumer );
+}
+
+size_t PipelinedMixer::Process(size_t WXUNUSED_UNLESS_DEBUG(maxSamples))
+{
+   wxASSERT( maxSamples == mBufferSize );
+
+   std::unique_lock< std::mutex > lock{ mMutex };
+   if ( mCurrent ) {
+      mFree.push_back( mCurrent );
+      mCurrent = nullptr;
+      mFreedCondition.notify_one();
+   }
+
+   mFilledCondition.wait( lock, [this]{
+      return mFinished || !mFilled.empty(); } );
+
+   if ( !mFilled.empty() ) {
+      mCurrent = mFilled.front();
+      mFilled.pop_front();
+      mCurrentTime = mCurrent->time;
+      return mCurrent->length;
+   }
+
+   // Throw only once, after all the buffers mixed before the failure
+   if ( mException ) {
+      auto exception = mException;
+      mException = nullptr;
+      std::rethrow_exception( exception );
+   }
+
+   return 0;
+}
+
+samplePtr PipelinedMixer::GetBuffer()
+{
+   wxASSERT( mInterleaved );
+   return mCurrent ? mCurrent->buffers[ 0 ].ptr() : nullptr;
+}
+
+samplePtr PipelinedMixer::GetBuffer(int channel)
+{
+   wxASSERT( !mInterleaved );
+   return mCurrent ? mCurrent->buffers[ channel ].ptr() : nullptr;
+}
+
+double PipelinedMixer::MixGetCurrentTime()
+{
+   return mCurrentTime;
+}
+
+size_t PipelinedMixer::Fill(Slot &slot)
+{
+   if ( mSharedMix )
+      return FillFromSharedMix( slot );
+
+   const auto length = mMixer->Process( mBufferSize );
+   if ( length > 0 ) {
+      if ( mInterleaved )
+         memcpy( slot.buffers[ 0 ].ptr(), mMixer->GetBuffer(),
+            length * mNumChannels * SAMPLE_SIZE( mFormat ) );
+      else
+         for ( unsigned cc = 0; cc < mNumChannels; ++cc )
+            memcpy( slot.buffers[ cc ].ptr(), mMixer->GetBuffer( cc ),
+               length * SAMPLE_SIZE( mFormat ) );
+   }
+   slot.time = mMixer->MixGetCurrentTime();
+   return length;
+}
+
+size_t PipelinedMixer::FillFromSharedMix(Slot &slot)
+{
+   // Convert as a Mixer does to its format, dithering each channel, but from
+   // the interleaved floats of the chunks, which need not align with slots
+   const auto sampleSize = SAMPLE_SIZE( mFormat );
+   size_t length = 0;
+   while ( length < mBufferSize ) {
+      if ( !mChunk || mChunkOffset == mChunk->length ) {
+         mChunk = mSharedMix->Next( mConsumer );
+         mChunkOffset = 0;
+         if ( !mChunk )
+            break;
+      }
+      const auto count =
+         std::min( mBufferSize - length, mChunk->length - mChunkOffset );
+      const auto src = mChunk->samples.get() + mChunkOffset * mNumChannels;
+      for ( unsigned cc = 0; cc < mNumChannels; ++cc ) {
+         if ( mInterleaved )
+            CopySamples( (samplePtr)( src + cc ), floatSample,
+               slot.buffers[ 0 ].ptr() +
+                  ( length * mNumChannels + cc ) * sampleSize,
+               mFormat, count, true, mNumChannels, mNumChannels );
+         else
+            CopySamples( (samplePtr)( src + cc ), floatSample,
+               slot.buffers[ cc ].ptr() + length * sampleSize,
+               mFormat, count, true, mNumChannels, 1 );
+      }
+      length += count;
+      mChunkOffset += count;
+      slot.time = mChunk->time;
+   }
+   return length;
+}
+
+void PipelinedMixer::MixerLoop()
+{
+   while ( true ) {
+      Slot *slot;
+      {
+         std::unique_lock< std::mutex > lock{ mMutex };
+         mFreedCondition.wait( lock, [this]{
+            return mStopping || !mFree.empty(); } );
+         if ( mStopping )
+            return;
+         slot = mFree.front();
+         mFree.pop_front();
+      }
+
+      size_t length = 0;
+      std::exception_ptr exception;
+      try {
+         length = slot->length = Fill( *slot );
+      }
+      catch ( ... ) {
+         exception = std::current_exception();
+      }
+
+      const bool finished = ( length == 0 || exception );
+      {
+         std::lock_guard< std::mutex > lock{ mMutex };
+         if ( finished ) {
+            mFree.push_back( slot );
+            mException = exception;
+            mFinished = true;
+         }
+         else
+            mFilled.push_back( slot );
+      }
+      mFilledCondition.notify_one();
+
+      if ( finished )
+         return;
+   }
+}
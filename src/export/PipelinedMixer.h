@@ -0,0 +1,111 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PipelinedMixer.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class PipelinedMixer
+\brief Runs a Mixer on a thread of its own, a few buffers ahead of the
+exporter that encodes its output, so that mixing and encoding overlap.
+Or, instead of a mixer, converts the chunks of a SharedMix.
+
+  It has the part of the interface of Mixer that the exporters use.  Each
+  Process() gives the next buffer the thread filled, while the thread
+  fills others, up to the given depth.  An exception from the mixer is
+  thrown again by Process().
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_PIPELINED_MIXER__
+#define __AUDACITY_PIPELINED_MIXER__
+
+#include "../MemoryX.h"
+#include "../SampleFormat.h"
+#include "SharedMix.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+class Mixer;
+
+class PipelinedMixer
+{
+ public:
+   // Buffers mixed ahead of the encoder, at most
+   static const size_t DefaultDepth = 4;
+
+   /// The arguments after the mixer are those it was made with
+   PipelinedMixer(std::unique_ptr<Mixer> &&mixer,
+                  unsigned numChannels, size_t bufferSize, bool interleaved,
+                  sampleFormat format, size_t depth = DefaultDepth);
+   /// Takes the consumer's place in the mix, which must have numChannels
+   PipelinedMixer(const std::shared_ptr<SharedMix> &mix, size_t consumer,
+                  unsigned numChannels, size_t bufferSize, bool interleaved,
+                  sampleFormat format, size_t depth = DefaultDepth);
+   ~PipelinedMixer();
+
+   /// The length of the next buffer, or 0 at the end.  Waits for the
+   /// thread if it is behind.  maxSamples must be the buffer size.
+   size_t Process(size_t maxSamples);
+
+   /// As for Mixer, of the buffer that Process() gave last
+   samplePtr GetBuffer();
+   samplePtr GetBuffer(int channel);
+   double MixGetCurrentTime();
+
+ private:
+   PipelinedMixer( const PipelinedMixer& ) PROHIBITED;
+   PipelinedMixer &operator= ( const PipelinedMixer& ) PROHIBITED;
+
+   struct Slot
+   {
+      ArrayOf<SampleBuffer> buffers;
+      size_t length;
+      double time;
+   };
+
+   void AllocateSlots(size_t depth);
+   void MixerLoop();
+   // Fill the slot on the thread; returns its length
+   size_t Fill(Slot &slot);
+   size_t FillFromSharedMix(Slot &slot);
+
+   const std::unique_ptr<Mixer> mMixer;
+   const std::shared_ptr<SharedMix> mSharedMix;
+   const size_t mConsumer { 0 };
+   const unsigned mNumChannels;
+   const size_t mBufferSize;
+   const bool mInterleaved;
+   const sampleFormat mFormat;
+
+   ArrayOf<Slot> mSlots;
+   // Given by Process(), so neither free nor filled
+   Slot *mCurrent { nullptr };
+   double mCurrentTime;
+
+   std::mutex mMutex;
+   std::condition_variable mFilledCondition;
+   std::condition_variable mFreedCondition;
+
+   // Guarded by mMutex:
+   std::deque< Slot* > mFree;
+   std::deque< Slot* > mFilled;
+   bool mStopping { false };
+   bool mFinished { false };
+   std::exception_ptr mException;
+
+   // Used by the thread only:  the chunk of the shared mix being converted
+   std::shared_ptr<const SharedMix::Chunk> mChunk;
+   size_t mChunkOffset { 0 };
+
+   std::thread mThread;
+};
+
+#endif
@@ -0,0 +1,197 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SharedMix.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "../Audacity.h"
+#include "SharedMix.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+#include "../Mix.h"
+
+namespace {
+   const auto Detached = std::numeric_limits< unsigned long long >::max();
+
+   // The innermost offer on the thread
+   thread_local SharedMix::Offer *sOffer = nullptr;
+}
+
+SharedMix::SharedMix(std::unique_ptr<Mixer> &&mixer, unsigned numChannels,
+   double rate, double t0, double t1, size_t numConsumers,
+   size_t chunkSize, size_t depth)
+   : mMixer{ std::move( mixer ) }
+   , mNumChannels{ numChannels }
+   , mRate{ rate }
+   , mT0{ t0 }
+   , mT1{ t1 }
+   , mChunkSize{ chunkSize }
+   , mDepth{ std::max<size_t>( 1, depth ) }
+   , mPositions( numConsumers, 0 )
+{
+   mThread = std::thread{ [this]{ MixerLoop(); } };
+}
+
+SharedMix::~SharedMix()
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mStopping = true;
+   }
+   mTakenCondition.notify_one();
+   mThread.join();
+}
+
+bool SharedMix::Matches(
+   unsigned numChannels, double rate, double t0, double t1) const
+{
+   return numChannels == mNumChannels &&
+      rate == mRate && t0 == mT0 && t1 == mT1;
+}
+
+unsigned long long SharedMix::Slowest() const
+{
+   auto result = Detached;
+   for ( auto position : mPositions )
+      result = std::min( result, position );
+   return result;
+}
+
+void SharedMix::DiscardTaken()
+{
+   const auto slowest = Slowest();
+   while ( !mChunks.empty() && mFirst < slowest ) {
+      mChunks.pop_front();
+      ++mFirst;
+   }
+}
+
+auto SharedMix::Next(size_t consumer) -> std::shared_ptr<const Chunk>
+{
+   std::unique_lock< std::mutex > lock{ mMutex };
+   auto &position = mPositions[ consumer ];
+   if ( position == Detached )
+      return {};
+
+   mMixedCondition.wait( lock, [&]{
+      return mFinished || position < mFirst + mChunks.size(); } );
+
+   if ( position < mFirst + mChunks.size() ) {
+      auto chunk = mChunks[ position - mFirst ];
+      ++position;
+      DiscardTaken();
+      lock.unlock();
+      mTakenCondition.notify_one();
+      return chunk;
+   }
+
+   // Every consumer fails, after all the chunks mixed before the failure
+   if ( mException )
+      std::rethrow_exception( mException );
+
+   return {};
+}
+
+void SharedMix::Detach(size_t consumer)
+{
+   {
+      std::lock_guard< std::mutex > lock{ mMutex };
+      mPositions[ consumer ] = Detached;
+      DiscardTaken();
+   }
+   mTakenCondition.notify_one();
+}
+
+void SharedMix::MixerLoop()
+{
+   while ( true ) {
+      {
+         std::unique_lock< std::mutex > lock{ mMutex };
+         mTakenCondition.wait( lock, [this]{
+            const auto slowest = Slowest();
+            return mStopping || slowest == Detached ||
+               mFirst + mChunks.size() < slowest + mDepth; } );
+         if ( mStopping || Slowest() == Detached ) {
+            // No one wants more
+            mFinished = true;
+            lock.unlock();
+            mMixedCondition.notify_all();
+            return;
+         }
+      }
+
+      auto chunk = std::make_shared< Chunk >();
+      size_t length = 0;
+      std::exception_ptr exception;
+      try {
+         length = mMixer->Process( mChunkSize );
+         if ( length > 0 ) {
+            chunk->samples.reinit( length * mNumChannels );
+            memcpy( chunk->samples.get(), mMixer->GetBuffer(),
+               length * mNumChannels * sizeof( float ) );
+         }
+         chunk->length = length;
+         chunk->time = mMixer->MixGetCurrentTime();
+      }
+      catch ( ... ) {
+         exception = std::current_exception();
+      }
+
+      const bool finished = ( length == 0 || exception );
+      {
+         std::lock_guard< std::mutex > lock{ mMutex };
+         if ( finished ) {
+            mException = exception;
+            mFinished = true;
+         }
+         else
+            mChunks.push_back( std::move( chunk ) );
+      }
+      mMixedCondition.notify_all();
+
+      if ( finished )
+         return;
+   }
+}
+
+SharedMix::Offer::Offer(
+   const std::shared_ptr<SharedMix> &mix, size_t consumer)
+   : mMix{ mix }
+   , mConsumer{ consumer }
+   , mPrevious{ sOffer }
+{
+   sOffer = this;
+}
+
+SharedMix::Offer::~Offer()
+{
+   sOffer = mPrevious;
+   mMix->Detach( mConsumer );
+}
+
+std::shared_ptr<SharedMix> SharedMix::Take(unsigned numChannels,
+   double rate, double t0, double t1, size_t &consumer)
+{
+   if ( !sOffer || sOffer->mTaken ||
+        !sOffer->mMix->Matches( numChannels, rate, t0, t1 ) )
+      return {};
+   sOffer->mTaken = true;
+   consumer = sOffer->mConsumer;
+   return sOffer->mMix;
+}
+
+void SharedMix::Decline()
+{
+   if ( sOffer && !sOffer->mTaken ) {
+      sOffer->mTaken = true;
+      sOffer->mMix->Detach( sOffer->mConsumer );
+   }
+}
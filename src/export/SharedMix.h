@@ -0,0 +1,133 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SharedMix.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class SharedMix
+\brief Runs one Mixer on a thread of its own, for several exporters that
+encode the same mix to different files at once.
+
+  The mix is made once, in floats, interleaved, in chunks that are shared
+  read-only by all consumers, so that the tracks are read and mixed once.
+  Each consumer converts the chunks to the format it wants.  A chunk is
+  freed when all consumers have taken it, and the mixer waits when the
+  slowest consumer is the given depth of chunks behind.  So all consumers
+  must run at the same time, or detach.
+
+  The exporters make their mixers with ExportPlugin::CreatePipelinedMixer(),
+  which takes the mix offered to the thread, if it fits the request.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SHARED_MIX__
+#define __AUDACITY_SHARED_MIX__
+
+#include "../MemoryX.h"
+#include "../SampleFormat.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Mixer;
+
+class SharedMix final
+{
+ public:
+   // Frames in each chunk, and chunks mixed ahead of the slowest consumer
+   static const size_t DefaultChunkSize = 16384;
+   static const size_t DefaultDepth = 8;
+
+   struct Chunk
+   {
+      Floats samples; // interleaved
+      size_t length;  // frames
+      double time;    // of the mixer, after the chunk
+   };
+
+   /// The mixer must make interleaved floats of numChannels, into a buffer
+   /// of at least chunkSize; the times and rate are those it was made with
+   SharedMix(std::unique_ptr<Mixer> &&mixer, unsigned numChannels,
+             double rate, double t0, double t1, size_t numConsumers,
+             size_t chunkSize = DefaultChunkSize,
+             size_t depth = DefaultDepth);
+   ~SharedMix();
+
+   unsigned GetNumChannels() const { return mNumChannels; }
+   double GetStartTime() const { return mT0; }
+   /// Whether a mixer made with these arguments makes this mix
+   bool Matches(unsigned numChannels, double rate, double t0, double t1) const;
+
+   /// The next chunk for the consumer, or null at the end.  Waits for the
+   /// mixer if it is behind.  Rethrows an exception of the mixer.
+   std::shared_ptr<const Chunk> Next(size_t consumer);
+
+   /// The consumer takes no more chunks, so that no one waits for it
+   void Detach(size_t consumer);
+
+   /// While it lives, CreatePipelinedMixer() on this thread may take the
+   /// consumer's place in the mix; the consumer is detached at the end
+   class Offer
+   {
+   public:
+      Offer(const std::shared_ptr<SharedMix> &mix, size_t consumer);
+      ~Offer();
+   private:
+      Offer( const Offer& ) PROHIBITED;
+      Offer &operator= ( const Offer& ) PROHIBITED;
+      friend SharedMix;
+      std::shared_ptr<SharedMix> mMix;
+      size_t mConsumer;
+      bool mTaken { false };
+      Offer *mPrevious;
+   };
+
+   /// The mix offered to this thread, if not yet taken and if it matches;
+   /// then consumer is set, and the offer is taken
+   static std::shared_ptr<SharedMix> Take(unsigned numChannels,
+      double rate, double t0, double t1, size_t &consumer);
+   /// Detach the consumer offered to this thread, if not taken, when the
+   /// exporter will not mix after all
+   static void Decline();
+
+ private:
+   SharedMix( const SharedMix& ) PROHIBITED;
+   SharedMix &operator= ( const SharedMix& ) PROHIBITED;
+
+   void MixerLoop();
+   // Index of the first chunk not taken by all; requires mMutex
+   unsigned long long Slowest() const;
+   void DiscardTaken();
+
+   const std::unique_ptr<Mixer> mMixer;
+   const unsigned mNumChannels;
+   const double mRate, mT0, mT1;
+   const size_t mChunkSize;
+   const size_t mDepth;
+
+   std::mutex mMutex;
+   std::condition_variable mMixedCondition;
+   std::condition_variable mTakenCondition;
+
+   // Guarded by mMutex:
+   // Chunks from index mFirst on
+   std::deque< std::shared_ptr<const Chunk> > mChunks;
+   unsigned long long mFirst { 0 };
+   // The index of the next chunk for each consumer; Detached, if none
+   std::vector< unsigned long long > mPositions;
+   bool mStopping { false };
+   bool mFinished { false };
+   std::exception_ptr mException;
+
+   std::thread mThread;
+};
+
+#endif
@@ -0,0 +1,278 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DecodedAudioCache.cpp
+
+  Audacity(R) is copyright (c) 1999-2017 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************/
+
+#include "../Audacity.h"
+#include "DecodedAudioCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <wx/datetime.h>
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "ImportPlugin.h"
+#include "../ContentHash.h"
+#include "../FileNames.h"
+#include "../Prefs.h"
+#include "../SampleFormat.h"
+#include "../Track.h"
+#include "../WaveTrack.h"
+#include "../widgets/ProgressDialog.h"
+
+namespace {
+
+const char Magic[8] = { 'A', 'u', 'd', 'P', 'C', 'M', '0', '1' };
+const wxChar *const EntryExtension = wxT("pcm");
+const wxChar *const PartExtension = wxT("part");
+const size_t HashBufferSize = 1 << 20;
+
+// An entry holds these for all its tracks, then the samples of each in turn
+struct TrackHeader
+{
+   int32_t format;
+   int32_t channel;
+   int32_t linked;
+   int32_t reserved;
+   double rate;
+   int64_t length;
+};
+
+unsigned long long CacheLimit()
+{
+   long megabytes;
+   gPrefs->Read(wxT("/Library/DecodeCacheSizeMB"), &megabytes, 1024L);
+   return megabytes > 0 ? (unsigned long long)megabytes << 20 : 0;
+}
+
+wxString CacheDir()
+{
+   const auto temp = FileNames::TempDir();
+   if (temp.empty())
+      return {};
+   wxFileName dir(temp, wxEmptyString);
+   dir.AppendDir(wxT("DecodeCache"));
+   return FileNames::MkDir(dir.GetPath());
+}
+
+// Removes the entries used least recently, until the rest fit in limit
+void TrimCache(const wxString &dir, unsigned long long limit)
+{
+   struct Entry
+   {
+      wxString path;
+      wxDateTime used;
+      unsigned long long size;
+   };
+
+   wxArrayString paths;
+   wxDir::GetAllFiles(dir, &paths,
+      wxString(wxT("*.")) + EntryExtension, wxDIR_FILES);
+
+   std::vector<Entry> entries;
+   for (const auto &path : paths) {
+      wxFileName fn(path);
+      const auto size = fn.GetSize();
+      entries.push_back({ path, fn.GetModificationTime(),
+         size == wxInvalidSize ? 0 : size.GetValue() });
+   }
+   std::sort(entries.begin(), entries.end(),
+      [](const Entry &a, const Entry &b) {
+         return a.used.IsLaterThan(b.used);
+      });
+
+   unsigned long long total = 0;
+   for (const auto &entry : entries) {
+      total += entry.size;
+      if (total > limit)
+         wxRemoveFile(entry.path);
+   }
+}
+
+}
+
+wxString DecodedAudioCache::MakeKey(const wxString &fileName, const wxString &variant)
+{
+   if (CacheLimit() == 0 || CacheDir().empty())
+      return {};
+
+   wxFFile file;
+   if (!file.Open(fileName, wxT("rb")))
+      return {};
+
+   ContentHash hash;
+   ArrayOf<char> buffer{ HashBufferSize };
+   unsigned long long total = 0;
+   while (!file.Eof()) {
+      const auto read = file.Read(buffer.get(), HashBufferSize);
+      if (file.Error())
+         return {};
+      hash.Add(buffer.get(), read);
+      total += read;
+      if (read < HashBufferSize)
+         break;
+   }
+   hash.Add(&total, sizeof total);
+
+   const auto utf8 = variant.utf8_str();
+   hash.Add(utf8.data(), utf8.length());
+
+   return wxString::Format(wxT("%016llx"), (unsigned long long)hash.Value());
+}
+
+ProgressResult DecodedAudioCache::Load(const wxString &key,
+   TrackFactory *trackFactory, TrackHolders &outTracks,
+   ImportProgress &progress)
+{
+   if (key.empty())
+      return ProgressResult::Failed;
+
+   wxFileName path(CacheDir(), key, EntryExtension);
+   wxFFile file;
+   if (!path.FileExists() || !file.Open(path.GetFullPath(), wxT("rb")))
+      return ProgressResult::Failed;
+
+   char magic[sizeof Magic];
+   uint32_t nTracks = 0;
+   if (file.Read(magic, sizeof magic) != sizeof magic ||
+       memcmp(magic, Magic, sizeof Magic) != 0 ||
+       file.Read(&nTracks, sizeof nTracks) != sizeof nTracks ||
+       nTracks == 0)
+      return ProgressResult::Failed;
+
+   std::vector<TrackHeader> headers(nTracks);
+   const auto headerBytes = nTracks * sizeof(TrackHeader);
+   if (file.Read(headers.data(), headerBytes) != headerBytes)
+      return ProgressResult::Failed;
+
+   // Reject an entry that was cut short, before making any tracks
+   sampleCount total = 0;
+   auto expected = (wxFileOffset)(sizeof magic + sizeof nTracks + headerBytes);
+   for (const auto &header : headers) {
+      const auto format = (sampleFormat)header.format;
+      if ((format != int16Sample && format != int24Sample &&
+           format != floatSample) || header.length < 0)
+         return ProgressResult::Failed;
+      total += header.length;
+      expected += header.length * SAMPLE_SIZE(format);
+   }
+   if (file.Length() != expected)
+      return ProgressResult::Failed;
+
+   TrackHolders tracks;
+   auto result = ProgressResult::Success;
+   sampleCount done = 0;
+   for (const auto &header : headers) {
+      const auto format = (sampleFormat)header.format;
+      auto track = trackFactory->NewWaveTrack(format, header.rate);
+      track->SetChannel(header.channel);
+      track->SetLinked(header.linked != 0);
+
+      const auto maxBlockSize = track->GetMaxBlockSize();
+      SampleBuffer buffer(maxBlockSize, format);
+      const sampleCount length = header.length;
+      for (sampleCount pos = 0;
+           pos < length && result == ProgressResult::Success;) {
+         const auto len = limitSampleBufferSize(maxBlockSize, length - pos);
+         const auto bytes = len * SAMPLE_SIZE(format);
+         if (file.Read(buffer.ptr(), bytes) != bytes)
+            return ProgressResult::Failed;
+         track->Append(buffer.ptr(), format, len);
+         pos += len;
+         done += len;
+         result = progress.Update(done.as_long_long(), total.as_long_long());
+      }
+
+      track->Flush();
+      tracks.push_back(std::move(track));
+
+      // As the decoders do, keep the audio read so far if stopped
+      if (result != ProgressResult::Success)
+         break;
+   }
+
+   if (result == ProgressResult::Cancelled || result == ProgressResult::Failed)
+      return result;
+
+   // Mark the entry as used lately, so it is trimmed last
+   file.Close();
+   path.Touch();
+
+   outTracks = std::move(tracks);
+   return result;
+}
+
+void DecodedAudioCache::Store(const wxString &key, const TrackHolders &tracks)
+{
+   if (key.empty() || tracks.empty())
+      return;
+
+   const auto limit = CacheLimit();
+   std::vector<TrackHeader> headers;
+   unsigned long long bytes = 0;
+   for (const auto &track : tracks) {
+      TrackHeader header{};
+      header.format = track->GetSampleFormat();
+      header.channel = track->GetChannel();
+      header.linked = track->GetLinked() ? 1 : 0;
+      header.rate = track->GetRate();
+      header.length =
+         track->TimeToLongSamples(track->GetEndTime()).as_long_long();
+      bytes += header.length * SAMPLE_SIZE(track->GetSampleFormat());
+      headers.push_back(header);
+   }
+   if (bytes > limit)
+      return;
+
+   // Write under another name first, so that a partial entry is never loaded
+   const auto dir = CacheDir();
+   const wxFileName path(dir, key, EntryExtension);
+   const wxFileName part(dir, key, PartExtension);
+   const bool written = [&]{
+      wxFFile file(part.GetFullPath(), wxT("wb"));
+      if (!file.IsOpened())
+         return false;
+
+      const uint32_t nTracks = headers.size();
+      const auto headerBytes = nTracks * sizeof(TrackHeader);
+      if (file.Write(Magic, sizeof Magic) != sizeof Magic ||
+          file.Write(&nTracks, sizeof nTracks) != sizeof nTracks ||
+          file.Write(headers.data(), headerBytes) != headerBytes)
+         return false;
+
+      for (size_t ii = 0; ii < tracks.size(); ++ii) {
+         const auto &track = tracks[ii];
+         const auto format = track->GetSampleFormat();
+         const auto maxBlockSize = track->GetMaxBlockSize();
+         SampleBuffer buffer(maxBlockSize, format);
+         const sampleCount length = headers[ii].length;
+         for (sampleCount pos = 0; pos < length;) {
+            const auto len = limitSampleBufferSize(maxBlockSize, length - pos);
+            const auto count = len * SAMPLE_SIZE(format);
+            if (!track->Get(buffer.ptr(), format, pos, len, fillZero, false) ||
+                file.Write(buffer.ptr(), count) != count)
+               return false;
+            pos += len;
+         }
+      }
+      return file.Close();
+   }();
+
+   if (!written ||
+       !wxRenameFile(part.GetFullPath(), path.GetFullPath(), true)) {
+      wxRemoveFile(part.GetFullPath());
+      return;
+   }
+
+   TrimCache(dir, limit);
+}
@@ -0,0 +1,49 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DecodedAudioCache.h
+
+  Audacity(R) is copyright (c) 1999-2017 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class DecodedAudioCache
+\brief Keeps the decoded audio of imported files in the temporary
+directory, so that importing the same content again need not decode it.
+
+Entries are named by a hash of the whole source file and of the choice
+of streams, so a renamed or copied file still hits, and an edited one
+misses.  The total size is capped by "/Library/DecodeCacheSizeMB"; the
+entries used least recently are removed first.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_DECODED_AUDIO_CACHE__
+#define __AUDACITY_DECODED_AUDIO_CACHE__
+
+#include "ImportRaw.h" // defines TrackHolders
+
+class ImportProgress;
+enum class ProgressResult : unsigned;
+
+class DecodedAudioCache
+{
+public:
+   /// Identifies the audio that variant selects from the file.
+   /// Returns an empty string if the cache is off or the file can't be read.
+   static wxString MakeKey(const wxString &fileName, const wxString &variant);
+
+   /// Makes tracks from the audio stored under key.  Returns
+   /// ProgressResult::Failed if there is no usable entry, and the file must
+   /// be decoded after all.
+   static ProgressResult Load(const wxString &key, TrackFactory *trackFactory,
+      TrackHolders &outTracks, ImportProgress &progress);
+
+   /// Stores the audio of the tracks under key, then trims the cache.
+   /// Failing to store is not an error; the entry is just left out.
+   static void Store(const wxString &key, const TrackHolders &tracks);
+};
+
+#endif
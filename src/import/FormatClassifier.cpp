@@ -20,6 +20,7 @@ for classification of the sample format and the used endianness.
 #include "FormatClassifier.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include <cmath>
 #include <cfloat>
 #include <vector>
@@ -29,10 +30,10 @@ for classification of the sample format and the used endianness.
 
 #include "MultiFormatReader.h"
 #include "sndfile.h"
+#include "../TaskScheduler.h"
 
 FormatClassifier::FormatClassifier(const char* filename) :
-   mReader(filename),
-   mMeter(cSiglen)
+   mFileName(filename)
 {
    FormatClassT fClass;
 
@@ -146,56 +147,25 @@ unsigned FormatClassifier::GetResultChannels()
 
 void FormatClassifier::Run()
 {
-   // Calc the mono feature vector
-   for (unsigned int n = 0; n < mClasses.size(); n++)
-   {
-      // Read the signal
-      ReadSignal(mClasses[n], 1);
-#ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
-      mpWriter->WriteSignal(mSigBuffer, cSiglen);
-#endif
-
-      // Do some simple preprocessing
-      // Remove DC offset
-      float smean = Mean(mSigBuffer.get(), cSiglen);
-      Sub(mSigBuffer.get(), smean, cSiglen);
-      // Normalize to +- 1.0
-      Abs(mSigBuffer.get(), mAuxBuffer.get(), cSiglen);
-      float smax = Max(mAuxBuffer.get(), cSiglen);
-      Div(mSigBuffer.get(), smax, cSiglen);
-
-      // Now actually fill the feature vector
-      // Low to high band power ratio
-      float pLo = mMeter.CalcPower(mSigBuffer.get(), 0.15f, 0.3f);
-      float pHi = mMeter.CalcPower(mSigBuffer.get(), 0.45f, 0.1f);
-      mMonoFeat[n] = pLo / pHi;
-   }
+   // Each class is read and measured twice, as mono and as stereo
+   const size_t nClasses = mClasses.size();
+   auto evaluate = [&](size_t ii) {
+      const size_t n = ii % nClasses;
+      if (ii < nClasses)
+         mMonoFeat[n] = CalcFeature(mClasses[n], 1);
+      else
+         mStereoFeat[n] = CalcFeature(mClasses[n], 2);
+   };
 
-   // Calc the stereo feature vector
-   for (unsigned int n = 0; n < mClasses.size(); n++)
-   {
-      // Read the signal
-      ReadSignal(mClasses[n], 2);
 #ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
-      mpWriter->WriteSignal(mSigBuffer, cSiglen);
+   // Write the signals in order
+   for (size_t ii = 0; ii < 2 * nClasses; ii++)
+      evaluate(ii);
+#else
+   TaskScheduler::Get().ParallelFor(
+      TaskScheduler::Interactive, 2 * nClasses, evaluate);
 #endif
 
-      // Do some simple preprocessing
-      // Remove DC offset
-      float smean = Mean(mSigBuffer.get(), cSiglen);
-      Sub(mSigBuffer.get(), smean, cSiglen);
-      // Normalize to +- 1.0
-      Abs(mSigBuffer.get(), mAuxBuffer.get(), cSiglen);
-      float smax = Max(mAuxBuffer.get(), cSiglen);
-      Div(mSigBuffer.get(), smax, cSiglen);
-
-      // Now actually fill the feature vector
-      // Low to high band power ratio
-      float pLo = mMeter.CalcPower(mSigBuffer.get(), 0.15f, 0.3f);
-      float pHi = mMeter.CalcPower(mSigBuffer.get(), 0.45f, 0.1f);
-      mStereoFeat[n] = pLo / pHi;
-   }
-
    // Get the results
    size_t midx, sidx;
    float monoMax = Max(mMonoFeat.get(), mClasses.size(), &midx);
@@ -214,35 +184,68 @@ void FormatClassifier::Run()
 
 }
 
-void FormatClassifier::ReadSignal(FormatClassT format, size_t stride)
+float FormatClassifier::CalcFeature(FormatClassT format, size_t stride)
+{
+   MultiFormatReader reader(mFileName.c_str());
+   SpecPowerCalculation meter(cSiglen);
+   Floats sigBuffer{ cSiglen };
+   Floats auxBuffer{ cSiglen };
+   ArrayOf<uint8_t> rawBuffer{ cSiglen * 8 };
+
+   // Read the signal
+   ReadSignal(reader, format, stride,
+              rawBuffer.get(), sigBuffer.get(), auxBuffer.get());
+#ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
+   mpWriter->WriteSignal(sigBuffer.get(), cSiglen);
+#endif
+
+   // Do some simple preprocessing
+   // Remove DC offset
+   float smean = Mean(sigBuffer.get(), cSiglen);
+   Sub(sigBuffer.get(), smean, cSiglen);
+   // Normalize to +- 1.0
+   Abs(sigBuffer.get(), auxBuffer.get(), cSiglen);
+   float smax = Max(auxBuffer.get(), cSiglen);
+   Div(sigBuffer.get(), smax, cSiglen);
+
+   // Now actually fill the feature vector
+   // Low to high band power ratio
+   float pLo = meter.CalcPower(sigBuffer.get(), 0.15f, 0.3f);
+   float pHi = meter.CalcPower(sigBuffer.get(), 0.45f, 0.1f);
+   return pLo / pHi;
+}
+
+void FormatClassifier::ReadSignal(MultiFormatReader &reader,
+                                  FormatClassT format, size_t stride,
+                                  uint8_t* raw, float* sig, float* aux)
 {
    size_t actRead = 0;
    unsigned int n = 0;
 
-   mReader.Reset();
+   reader.Reset();
 
    // Do a dummy read of 1024 bytes to skip potential header information
-   mReader.ReadSamples(mRawBuffer.get(), 1024, MultiFormatReader::Uint8, MachineEndianness::Little);
+   reader.ReadSamples(raw, 1024, MultiFormatReader::Uint8, MachineEndianness::Little);
 
    do
    {
-      actRead = mReader.ReadSamples(mRawBuffer.get(), cSiglen, stride, format.format, format.endian);
+      actRead = reader.ReadSamples(raw, cSiglen, stride, format.format, format.endian);
 
       if (n == 0)
       {
-         ConvertSamples(mRawBuffer.get(), mSigBuffer.get(), format);
+         ConvertSamples(raw, sig, format);
       }
       else
       {
          if (actRead == cSiglen)
          {
-            ConvertSamples(mRawBuffer.get(), mAuxBuffer.get(), format);
+            ConvertSamples(raw, aux, format);
 
             // Integrate signals
-            Add(mSigBuffer.get(), mAuxBuffer.get(), cSiglen);
+            Add(sig, aux, cSiglen);
 
             // Do some dummy reads to break signal coherence
-            mReader.ReadSamples(mRawBuffer.get(), n + 1, stride, format.format, format.endian);
+            reader.ReadSamples(raw, n + 1, stride, format.format, format.endian);
          }
       }
 
@@ -283,9 +286,12 @@ void FormatClassifier::ConvertSamples(void* in, float* out, FormatClassT format)
    }
 }
 
-void FormatClassifier::Add(float* in1, float* in2, size_t len)
+// The kernels below are written as plain loops without branches or
+// loop-carried dependencies, which compilers vectorize
+
+void FormatClassifier::Add(float* in1, const float* in2, size_t len)
 {
-   for (unsigned int n = 0; n < len; n++)
+   for (size_t n = 0; n < len; n++)
    {
       in1[n] += in2[n];
    }
@@ -293,7 +299,7 @@ void FormatClassifier::Add(float* in1, float* in2, size_t len)
 
 void FormatClassifier::Sub(float* in, float subt, size_t len)
 {
-   for (unsigned int n = 0; n < len; n++)
+   for (size_t n = 0; n < len; n++)
    {
       in[n] -= subt;
    }
@@ -301,54 +307,63 @@ void FormatClassifier::Sub(float* in, float subt, size_t len)
 
 void FormatClassifier::Div(float* in, float div, size_t len)
 {
-   for (unsigned int n = 0; n < len; n++)
+   for (size_t n = 0; n < len; n++)
    {
       in[n] /= div;
    }
 }
 
 
-void FormatClassifier::Abs(float* in, float* out, size_t len)
+void FormatClassifier::Abs(const float* in, float* out, size_t len)
 {
-   for (unsigned int n = 0; n < len; n++)
+   for (size_t n = 0; n < len; n++)
    {
-      if (in[n] < 0.0f)
-      {
-         out[n] = -in[n];
-      }
-      else
-      {
-         out[n] = in[n];
-      }
+      out[n] = std::fabs(in[n]);
    }
 }
 
-float FormatClassifier::Mean(float* in, size_t len)
+float FormatClassifier::Mean(const float* in, size_t len)
 {
-   float mean = 0.0f;
+   // Four running sums, so that the additions need not be in order
+   float sums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+   size_t n = 0;
 
-   for (unsigned int n = 0; n < len; n++)
+   for (; n + 4 <= len; n += 4)
    {
-      mean += in[n];
+      sums[0] += in[n];
+      sums[1] += in[n + 1];
+      sums[2] += in[n + 2];
+      sums[3] += in[n + 3];
+   }
+   for (; n < len; n++)
+   {
+      sums[0] += in[n];
    }
 
+   float mean = (sums[0] + sums[1]) + (sums[2] + sums[3]);
    mean /= len;
    
    return mean;
 }
 
-float FormatClassifier::Max(float* in, size_t len)
+float FormatClassifier::Max(const float* in, size_t len)
 {
-   size_t dummyidx;
-   return Max(in, len, &dummyidx);
+   float max = -FLT_MAX;
+
+   for (size_t n = 0; n < len; n++)
+   {
+      max = std::max(max, in[n]);
+   }
+
+   return max;
 }
 
-float FormatClassifier::Max(float* in, size_t len, size_t* maxidx)
+float FormatClassifier::Max(const float* in, size_t len, size_t* maxidx)
 {
    float max = -FLT_MAX;
    *maxidx = 0;
    
-   for (unsigned int n = 0; n < len; n++)
+   for (size_t n = 0; n < len; n++)
    {
       if (in[n] > max)
       {
@@ -360,9 +375,9 @@ float FormatClassifier::Max(float* in, size_t len, size_t* maxidx)
    return max;
 }
 
-template<class T> void FormatClassifier::ToFloat(T* in, float* out, size_t len)
+template<class T> void FormatClassifier::ToFloat(const T* in, float* out, size_t len)
 {
-   for(unsigned int n = 0; n < len; n++)
+   for(size_t n = 0; n < len; n++)
    {
       out[n] = (float) in[n];
    }
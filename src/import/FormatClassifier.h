@@ -11,6 +11,7 @@
 #ifndef __AUDACITY_FORMATCLASSIFIER_H_
 #define __AUDACITY_FORMATCLASSIFIER_H_
 
+#include <string>
 #include <vector>
 #include "../SampleFormat.h"
 #include "MultiFormatReader.h"
@@ -74,18 +75,13 @@ private:
    static const size_t cSiglen = 512;
    static const size_t cNumInts = 32;
 
+   const std::string    mFileName;
    FormatVectorT        mClasses;
-   MultiFormatReader    mReader;
-   SpecPowerCalculation mMeter;
 
 #ifdef FORMATCLASSIFIER_SIGNAL_DEBUG
    std::unique_ptr<DebugWriter> mpWriter;
 #endif
 
-   Floats               mSigBuffer{ cSiglen };
-   Floats               mAuxBuffer{ cSiglen };
-   ArrayOf<uint8_t> mRawBuffer{ cSiglen * 8 };
-
    Floats               mMonoFeat;
    Floats               mStereoFeat;
    
@@ -101,18 +97,23 @@ public:
    unsigned GetResultChannels();
 private:
    void Run();
-   void ReadSignal(FormatClassT format, size_t stride);
-   void ConvertSamples(void* in, float* out, FormatClassT format);
-
-   void Add(float* in1, float* in2, size_t len);
-   void Sub(float* in, float subt, size_t len);
-   void Div(float* in, float div, size_t len);
-   void Abs(float* in, float* out, size_t len);
-   float Mean(float* in, size_t len);
-   float Max(float* in, size_t len);
-   float Max(float* in, size_t len, size_t* maxidx);
-
-   template<class T> void ToFloat(T* in, float* out, size_t len);
+   // Low to high band power ratio of the signal read as the given class;
+   // uses only its own reader and buffers, so classes can be evaluated
+   // on several threads at once
+   float CalcFeature(FormatClassT format, size_t stride);
+   void ReadSignal(MultiFormatReader &reader, FormatClassT format, size_t stride,
+                   uint8_t* raw, float* sig, float* aux);
+   static void ConvertSamples(void* in, float* out, FormatClassT format);
+
+   static void Add(float* in1, const float* in2, size_t len);
+   static void Sub(float* in, float subt, size_t len);
+   static void Div(float* in, float div, size_t len);
+   static void Abs(const float* in, float* out, size_t len);
+   static float Mean(const float* in, size_t len);
+   static float Max(const float* in, size_t len);
+   static float Max(const float* in, size_t len, size_t* maxidx);
+
+   template<class T> static void ToFloat(const T* in, float* out, size_t len);
 };
 
 #endif
@@ -39,12 +39,15 @@ and ImportLOF.cpp.
 #include "Import.h"
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include "ImportPlugin.h"
 
 #include <wx/textctrl.h>
 #include <wx/string.h>
 #include <wx/intl.h>
 #include <wx/log.h>
+#include <wx/utils.h>
 #include <wx/sizer.h>         //for wxBoxSizer
 #include <wx/listimpl.cpp>
 #include "../ShuttleGui.h"
@@ -60,6 +63,8 @@ and ImportLOF.cpp.
 #include "ImportFFmpeg.h"
 #include "ImportGStreamer.h"
 #include "../Prefs.h"
+#include "../Tags.h"
+#include "../TaskScheduler.h"
 
 // ============================================================================
 //
@@ -332,34 +337,13 @@ bool Importer::IsMidi(const wxString &fName)
 }
 
 // returns number of tracks imported
-bool Importer::Import(const wxString &fName,
-                     TrackFactory *trackFactory,
-                     TrackHolders &tracks,
-                     Tags *tags,
-                     wxString &errorMessage)
+auto Importer::GetPluginsFor(const wxString &fName) -> ImportPluginPtrs
 {
-   AudacityProject *pProj = GetActiveProject();
-   auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
-
    wxString extension = fName.AfterLast(wxT('.'));
 
-   // Always refuse to import MIDI, even though the FFmpeg plugin pretends to know how (but makes very bad renderings)
-#ifdef USE_MIDI
-   // MIDI files must be imported, not opened
-   if (IsMidi(fName)) {
-      errorMessage.Printf(_("\"%s\" \nis a MIDI file, not an audio file. \nAudacity cannot open this type of file for playing, but you can\nedit it by clicking File > Import > MIDI."), fName);
-      return false;
-   }
-#endif
-
-   using ImportPluginPtrs = std::vector< ImportPlugin* >;
-
    // This list is used to call plugins in correct order
    ImportPluginPtrs importPlugins;
 
-   // This list is used to remember plugins that should have been compatible with the file.
-   ImportPluginPtrs compatiblePlugins;
-
    // If user explicitly selected a filter,
    // then we should try importing via corresponding plugin first
    wxString type = gPrefs->Read(wxT("/LastOpenType"),wxT(""));
@@ -505,6 +489,34 @@ bool Importer::Import(const wxString &fName,
       }
    }
 
+   return importPlugins;
+}
+
+bool Importer::Import(const wxString &fName,
+                     TrackFactory *trackFactory,
+                     TrackHolders &tracks,
+                     Tags *tags,
+                     wxString &errorMessage)
+{
+   AudacityProject *pProj = GetActiveProject();
+   auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
+
+   wxString extension = fName.AfterLast(wxT('.'));
+
+   // Always refuse to import MIDI, even though the FFmpeg plugin pretends to know how (but makes very bad renderings)
+#ifdef USE_MIDI
+   // MIDI files must be imported, not opened
+   if (IsMidi(fName)) {
+      errorMessage.Printf(_("\"%s\" \nis a MIDI file, not an audio file. \nAudacity cannot open this type of file for playing, but you can\nedit it by clicking File > Import > MIDI."), fName);
+      return false;
+   }
+#endif
+
+   // This list is used to remember plugins that should have been compatible with the file.
+   ImportPluginPtrs compatiblePlugins;
+
+   auto importPlugins = GetPluginsFor(fName);
+
    // Try the import plugins, in the permuted sequences just determined
    for (const auto plugin : importPlugins)
    {
@@ -674,6 +686,156 @@ bool Importer::Import(const wxString &fName,
    return false;
 }
 
+std::unique_ptr<ImportFileHandle> Importer::OpenForBatch(
+   const wxString &fName, bool &concurrent)
+{
+   concurrent = false;
+
+   // Import() gives the messages about these, and LOF imports other files
+   // at once, so must take its turn
+#ifdef USE_MIDI
+   if (IsMidi(fName))
+      return {};
+#endif
+   if (fName.AfterLast(wxT('.')).IsSameAs(wxT("lof"), false))
+      return {};
+
+   for (const auto plugin : GetPluginsFor(fName))
+   {
+      wxLogMessage(wxT("Opening with %s"),plugin->GetPluginStringID());
+      auto inFile = plugin->Open(fName);
+      if ( (inFile != NULL) && (inFile->GetStreamCount() > 0) )
+      {
+         wxLogMessage(wxT("Open(%s) succeeded"), fName);
+         // Import() displays the stream selector
+         if (inFile->GetStreamCount() > 1)
+            return {};
+         inFile->SetStreamUsage(0,TRUE);
+         concurrent = inFile->PrepareConcurrentImport();
+         return inFile;
+      }
+   }
+
+   return {};
+}
+
+auto Importer::ImportFiles(const wxArrayString &fileNames,
+                           TrackFactory *trackFactory,
+                           const Tags *tags) -> std::vector<FileResult>
+{
+   AudacityProject *pProj = GetActiveProject();
+   auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
+
+   const auto count = fileNames.size();
+   std::vector<FileResult> results(count);
+
+   // Files are opened here, where the importers may ask questions
+   std::vector< std::unique_ptr<ImportFileHandle> > handles(count);
+   std::vector<bool> opened(count, false);
+   std::vector<size_t> concurrent;
+   for (size_t ii = 0; ii < count; ++ii) {
+      results[ii].tags = tags ? tags->Duplicate() : std::make_shared<Tags>();
+      bool isConcurrent;
+      handles[ii] = OpenForBatch(fileNames[ii], isConcurrent);
+      opened[ii] = (handles[ii] != nullptr);
+      if (isConcurrent)
+         concurrent.push_back(ii);
+   }
+
+   // As in Import(), after an opened file's import
+   std::vector<bool> retry(count, false);
+   const auto finish = [&](size_t ii, ProgressResult res) {
+      auto &result = results[ii];
+      if ((res == ProgressResult::Success || res == ProgressResult::Stopped) &&
+          result.tracks.size() > 0)
+         result.success = true;
+      else {
+         result.tracks.clear();
+         // Other plugins may yet understand the file
+         if (!(res == ProgressResult::Cancelled || res == ProgressResult::Failed))
+            retry[ii] = true;
+      }
+      handles[ii].reset();
+   };
+
+   auto latest = ProgressResult::Success;
+   if (concurrent.size() > 0) {
+      const auto nConcurrent = concurrent.size();
+
+      ProgressDialog progress(_("Import"),
+         wxString::Format(_("Importing %d files"), (int)nConcurrent));
+
+      // The imports see the latest answer of the dialog
+      std::atomic<ProgressResult> answer{ ProgressResult::Success };
+      std::vector< std::atomic<double> > fractions(nConcurrent);
+      for (auto &fraction : fractions)
+         fraction.store(0.0);
+      std::vector<ProgressResult> outcomes(nConcurrent, ProgressResult::Cancelled);
+
+      auto &scheduler = TaskScheduler::Get();
+
+      // The loop runs on another thread, so that this one can show progress
+      std::exception_ptr exception;
+      std::atomic<bool> done{ false };
+      std::thread runner{ [&] {
+         try {
+            scheduler.ParallelFor(TaskScheduler::Interactive, nConcurrent, [&](size_t jj) {
+               // Files not begun when the user stops are not begun at all
+               if (answer.load() != ProgressResult::Success)
+                  return;
+               const auto ii = concurrent[jj];
+               auto &inFile = handles[ii];
+               inFile->SetConcurrentProgress([&, jj](double fraction) {
+                  fractions[jj].store(fraction);
+                  return answer.load();
+               });
+               outcomes[jj] = inFile->Import(trackFactory,
+                  results[ii].tracks, results[ii].tags.get());
+               fractions[jj].store(1.0);
+            });
+         }
+         catch (...) {
+            exception = std::current_exception();
+         }
+         done.store(true);
+      } };
+      while (!done.load()) {
+         ::wxMilliSleep(50);
+         double sum = 0;
+         for (const auto &fraction : fractions)
+            sum += fraction.load();
+         if (answer.load() == ProgressResult::Success)
+            answer.store(progress.Update(sum, (double)nConcurrent));
+      }
+      runner.join();
+
+      if (exception)
+         std::rethrow_exception(exception);
+
+      latest = answer.load();
+      for (size_t jj = 0; jj < nConcurrent; ++jj)
+         finish(concurrent[jj], outcomes[jj]);
+   }
+
+   // The others in turn, unless the user stopped; and those that no
+   // plugin opened, so that Import() gives its messages
+   if (latest == ProgressResult::Success) {
+      for (size_t ii = 0; ii < count; ++ii) {
+         auto &result = results[ii];
+         if (handles[ii])
+            finish(ii, handles[ii]->Import(trackFactory,
+               result.tracks, result.tags.get()));
+         else if (!opened[ii])
+            retry[ii] = true;
+         if (retry[ii])
+            result.success = Import(fileNames[ii], trackFactory,
+               result.tracks, result.tags.get(), result.errorMessage);
+      }
+   }
+
+   return results;
+}
+
 //-------------------------------------------------------------------------
 // ImportStreamDialog
 //-------------------------------------------------------------------------
@@ -145,7 +145,36 @@ public:
               Tags *tags,
               wxString &errorMessage);
 
+   // The outcome of importing one of the files given to ImportFiles()
+   struct FileResult
+   {
+      bool success { false };
+      TrackHolders tracks;
+      // The tags as this file's import left them
+      std::shared_ptr<Tags> tags;
+      wxString errorMessage;
+   };
+
+   // Imports several files:  those whose importers allow it at once, on a
+   // pool of threads with one progress dialog for all, then the others in
+   // turn, as Import() would.  Each file begins with its own copy of the
+   // tags.  The results are in the order of the files.
+   std::vector<FileResult> ImportFiles(const wxArrayString &fileNames,
+              TrackFactory *trackFactory,
+              const Tags *tags);
+
 private:
+   using ImportPluginPtrs = std::vector< ImportPlugin* >;
+
+   // The plugins to try for the file, in order
+   ImportPluginPtrs GetPluginsFor(const wxString &fName);
+
+   // The file opened as Import() would, with its one stream chosen, and
+   // whether it may be imported at once with others; null if Import()
+   // should do it all
+   std::unique_ptr<ImportFileHandle> OpenForBatch(const wxString &fName,
+                                                  bool &concurrent);
+
    static Importer mInstance;
 
    ExtImportItems mExtImportItems;
@@ -153,6 +153,7 @@ static const wxChar *exts[] =
 
 // all the includes live here by default
 #include "Import.h"
+#include "DecodedAudioCache.h"
 #include "../Tags.h"
 #include "../Internat.h"
 #include "../WaveTrack.h"
@@ -494,6 +495,20 @@ ProgressResult FFmpegImportFileHandle::Import(TrackFactory *trackFactory,
       else i++;
    }
 
+   // The same content with the same streams chosen was decoded before
+   wxString variant = wxT("ffmpeg");
+   for (int i = 0; i < mNumStreams; i++)
+      variant += wxString::Format(wxT(",%d"), scs[i]->m_stream->index);
+   const auto cacheKey = DecodedAudioCache::MakeKey(mFilename, variant);
+   {
+      auto cached = DecodedAudioCache::Load(cacheKey, trackFactory, outTracks, *mProgress);
+      if (cached != ProgressResult::Failed) {
+         if (cached != ProgressResult::Cancelled)
+            WriteMetadata(tags);
+         return cached;
+      }
+   }
+
    mChannels.resize(mNumStreams);
 
    int s = -1;
@@ -585,17 +600,16 @@ ProgressResult FFmpegImportFileHandle::Import(TrackFactory *trackFactory,
    //so for OD loading we create the tracks and releasee the modal lock after starting the ODTask.
    if (mUsingOD) {
       std::vector<std::unique_ptr<ODDecodeFFmpegTask>> tasks;
-      //append blockfiles to each stream and add an individual ODDecodeTask for each one.
+      //append blockfiles to each stream and add an individual ODDecodeTask for each one,
+      //so that the streams are decoded at once.  The decoders open the file for themselves.
       s = -1;
       for (const auto &stream : mChannels) {
          ++s;
-         auto odTask =
-            std::make_unique<ODDecodeFFmpegTask>(mScs, ODDecodeFFmpegTask::FromList(mChannels), mContext, s);
-         odTask->CreateFileDecoder(mFilename);
+         auto sc = scs[s].get();
+         auto odTask = std::make_unique<ODDecodeFFmpegTask>(sc->m_stream->index);
 
          //each stream has different duration.  We need to know it if seeking is to be allowed.
          sampleCount sampleDuration = 0;
-         auto sc = scs[s].get();
          if (sc->m_stream->duration > 0)
             sampleDuration = ((sampleCount)sc->m_stream->duration * sc->m_stream->time_base.num) * sc->m_stream->codec->sample_rate / sc->m_stream->time_base.den;
          else
@@ -699,6 +713,14 @@ ProgressResult FFmpegImportFileHandle::Import(TrackFactory *trackFactory,
    // Save metadata
    WriteMetadata(tags);
 
+   // Only audio decoded to the end is worth keeping
+   if (res == ProgressResult::Success
+#ifdef EXPERIMENTAL_OD_FFMPEG
+       && !mUsingOD
+#endif
+      )
+      DecodedAudioCache::Store(cacheKey, outTracks);
+
    return res;
 }
 
@@ -170,6 +170,16 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   bool PrepareConcurrentImport() override
+   {
+#ifdef EXPERIMENTAL_OD_FLAC
+      // Decoding on demand makes tasks, which need the main thread
+      return false;
+#else
+      return true;
+#endif
+   }
+
 private:
    sampleFormat          mFormat;
    std::unique_ptr<MyFLACFile> mFile;
@@ -86,6 +86,8 @@ extern "C" {
 }
 
 #include "../WaveTrack.h"
+#include "../ondemand/ODDecodeMP3Task.h"
+#include "../ondemand/ODManager.h"
 
 #define INPUT_BUFFER_SIZE 65535
 #define PROGRESS_SCALING_FACTOR 100000
@@ -99,7 +101,7 @@ struct private_data {
    int inputBufferFill;     /* amount of data in inputBuffer */
    TrackFactory *trackFactory;
    TrackHolders channels;
-   ProgressDialog *progress;
+   ImportProgress *progress;
    unsigned numChannels;
    ProgressResult updateResult;
    bool id3checked;
@@ -148,6 +150,17 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   bool PrepareConcurrentImport() override
+   {
+#ifdef EXPERIMENTAL_OD_MP3
+      // Decoding on demand makes tasks, which need the main thread
+      return false;
+#else
+      // Only decodes, with libmad
+      return true;
+#endif
+   }
+
 private:
    void ImportID3(Tags *tags);
 
@@ -215,6 +228,64 @@ ProgressResult MP3ImportFileHandle::Import(TrackFactory *trackFactory, TrackHold
 
    CreateProgress();
 
+#ifdef EXPERIMENTAL_OD_MP3
+   // If the frames can be indexed, make the tracks of blocks that an
+   // OD task decodes later; otherwise decode the whole file now
+   {
+      auto decoderTask = std::make_unique<ODDecodeMP3Task>();
+      auto decoder = static_cast<ODMP3Decoder*>(
+         decoderTask->CreateFileDecoder(mFilename));
+      if (decoder->ReadHeader()) {
+         const auto numChannels = decoder->GetChannels();
+         const auto fileTotalFrames = decoder->GetNumSamples();
+         auto format = QualityPrefs::SampleFormatChoice();
+
+         TrackHolders channels(numChannels);
+         for (auto &channel : channels) {
+            channel = trackFactory->NewWaveTrack(format, decoder->GetRate());
+            channel->SetChannel(Track::MonoChannel);
+         }
+         if (numChannels == 2) {
+            channels.begin()->get()->SetChannel(Track::LeftChannel);
+            channels.rbegin()->get()->SetChannel(Track::RightChannel);
+            channels.begin()->get()->SetLinked(true);
+         }
+
+         auto updateResult = ProgressResult::Success;
+         auto maxBlockSize = channels.begin()->get()->GetMaxBlockSize();
+         for (sampleCount i = 0; i < fileTotalFrames; i += maxBlockSize) {
+            const auto blockLen =
+               limitSampleBufferSize( maxBlockSize, fileTotalFrames - i );
+
+            for (size_t c = 0; c < numChannels; ++c)
+               channels[c]->AppendCoded(mFilename, i, blockLen, c, ODTask::eODMP3);
+
+            updateResult = mProgress->Update(
+               i.as_long_long(),
+               fileTotalFrames.as_long_long()
+            );
+            if (updateResult != ProgressResult::Success)
+               break;
+         }
+
+         if (updateResult == ProgressResult::Failed ||
+             updateResult == ProgressResult::Cancelled)
+            return updateResult;
+
+         for (const auto &channel : channels) {
+            channel->Flush();
+            decoderTask->AddWaveTrack(channel.get());
+         }
+         ODManager::Instance()->AddNewTask(std::move(decoderTask));
+         outTracks.swap(channels);
+
+         ImportID3(tags);
+
+         return updateResult;
+      }
+   }
+#endif
+
    /* Prepare decoder data, initialize decoder */
 
    private_data privateData;
@@ -81,6 +81,8 @@ void GetOGGImportPlugin(ImportPluginList &importPluginList,
 
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
+#include "../ondemand/ODDecodeOggTask.h"
+#include "../ondemand/ODManager.h"
 
 class OggImportPlugin final : public ImportPlugin
 {
@@ -149,7 +151,20 @@ public:
       }
    }
 
+   bool PrepareConcurrentImport() override
+   {
+#ifdef EXPERIMENTAL_OD_OGG
+      // Decoding on demand makes tasks, which need the main thread
+      if (mVorbisFile->links == 1)
+         return false;
+#endif
+      // Only decodes, with libvorbisfile
+      return true;
+   }
+
 private:
+   void ImportComments(Tags *tags);
+
    std::unique_ptr<wxFFile> mFile;
    std::unique_ptr<OggVorbis_File> mVorbisFile;
 
@@ -237,6 +252,69 @@ ProgressResult OggImportFileHandle::Import(TrackFactory *trackFactory, TrackHold
 
    CreateProgress();
 
+#ifdef EXPERIMENTAL_OD_OGG
+   // A stream of one link is made of blocks that an OD task decodes later
+   if (mVorbisFile->links == 1 && mStreamUsage[0] != 0) {
+      auto decoderTask = std::make_unique<ODDecodeOggTask>();
+      auto decoder = static_cast<ODOggDecoder*>(
+         decoderTask->CreateFileDecoder(mFilename));
+      if (decoder->ReadHeader()) {
+         const auto numChannels = decoder->GetChannels();
+         const auto fileTotalFrames = decoder->GetNumSamples();
+
+         TrackHolders channels(numChannels);
+         for (auto &channel : channels) {
+            channel = trackFactory->NewWaveTrack(mFormat, decoder->GetRate());
+            channel->SetChannel(Track::MonoChannel);
+         }
+         if (numChannels == 2) {
+            channels.begin()->get()->SetChannel(Track::LeftChannel);
+            channels.rbegin()->get()->SetChannel(Track::RightChannel);
+            channels.begin()->get()->SetLinked(true);
+         }
+
+         auto updateResult = ProgressResult::Success;
+         auto maxBlockSize = channels.begin()->get()->GetMaxBlockSize();
+         for (sampleCount i = 0; i < fileTotalFrames; i += maxBlockSize) {
+            const auto blockLen =
+               limitSampleBufferSize( maxBlockSize, fileTotalFrames - i );
+
+            for (size_t c = 0; c < numChannels; ++c)
+               channels[c]->AppendCoded(mFilename, i, blockLen, c, ODTask::eODOGG);
+
+            updateResult = mProgress->Update(
+               i.as_long_long(),
+               fileTotalFrames.as_long_long()
+            );
+            if (updateResult != ProgressResult::Success)
+               break;
+         }
+
+         if (updateResult == ProgressResult::Failed ||
+             updateResult == ProgressResult::Cancelled)
+            return updateResult;
+
+         //if we have 3 more channels, they get imported on seperate tracks, so we add individual tasks for each.
+         bool moreThanStereo = numChannels > 2;
+         for (const auto &channel : channels) {
+            channel->Flush();
+            decoderTask->AddWaveTrack(channel.get());
+            if (moreThanStereo) {
+               ODManager::Instance()->AddNewTask(std::move(decoderTask));
+               decoderTask = std::make_unique<ODDecodeOggTask>();
+            }
+         }
+         if (!moreThanStereo)
+            ODManager::Instance()->AddNewTask(std::move(decoderTask));
+         outTracks.swap(channels);
+
+         ImportComments(tags);
+
+         return updateResult;
+      }
+   }
+#endif
+
    //Number of streams used may be less than mVorbisFile->links,
    //but this way bitstream matches array index.
    mChannels.resize(mVorbisFile->links);
@@ -380,6 +458,13 @@ ProgressResult OggImportFileHandle::Import(TrackFactory *trackFactory, TrackHold
       }
    }
 
+   ImportComments(tags);
+
+   return res;
+}
+
+void OggImportFileHandle::ImportComments(Tags *tags)
+{
    //\todo { Extract comments from each stream? }
    if (mVorbisFile->vc[0].comments > 0) {
       tags->Clear();
@@ -396,8 +481,6 @@ ProgressResult OggImportFileHandle::Import(TrackFactory *trackFactory, TrackHold
          tags->SetTag(name, value);
       }
    }
-
-   return res;
 }
 
 OggImportFileHandle::~OggImportFileHandle()
@@ -36,14 +36,8 @@
 
 #include "sndfile.h"
 
-#include "../ondemand/ODManager.h"
-#include "../ondemand/ODComputeSummaryTask.h"
 #include "../prefs/QualityPrefs.h"
 
-//If OD is enabled, he minimum number of samples a file has to use it.
-//Otherwise, we use the older PCMAliasBlockFile method since it should be fast enough.
-#define kMinimumODFileSampleSize 44100*30
-
 #ifndef SNDFILE_1
 #error Requires libsndfile 1.0 or higher
 #endif
@@ -108,10 +102,14 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   bool PrepareConcurrentImport() override;
+
 private:
    SFFile                mFile;
    const SF_INFO         mInfo;
    sampleFormat          mFormat;
+   // "copy" or "edit" once asked, so that Import() need not ask
+   wxString              mCopyEdit;
 };
 
 void GetPCMImportPlugin(ImportPluginList & importPluginList,
@@ -342,6 +340,14 @@ struct id3_tag_deleter {
 using id3_tag_holder = std::unique_ptr<id3_tag, id3_tag_deleter>;
 #endif
 
+bool PCMImportFileHandle::PrepareConcurrentImport()
+{
+   mCopyEdit = AskCopyOrEdit();
+
+   // Aliased files are summarized as they are read, with no OD task
+   return !mCopyEdit.IsSameAs(wxT("cancel"), false);
+}
+
 ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
                                 TrackHolders &outTracks,
                                 Tags *tags)
@@ -351,7 +357,7 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
    wxASSERT(mFile.get());
 
    // Get the preference / warn the user about aliased files.
-   wxString copyEdit = AskCopyOrEdit();
+   wxString copyEdit = mCopyEdit.empty() ? AskCopyOrEdit() : mCopyEdit;
 
    if (copyEdit == wxT("cancel"))
       return ProgressResult::Cancelled;
@@ -403,55 +409,46 @@ ProgressResult PCMImportFileHandle::Import(TrackFactory *trackFactory,
       // aliases to the files we're editing, i.e. ("foo.wav", 12000-18000)
       // instead of actually making fresh copies of the samples.
 
-      // lets use OD only if the file is longer than 30 seconds.  Otherwise, why wake up extra threads.
-      //todo: make this a user pref.
-      bool useOD =fileTotalFrames>kMinimumODFileSampleSize;
-      int updateCounter = 0;
+      // The file is read once, in order, and each block's summary is
+      // computed from the samples as the block is made, so the tracks can
+      // be drawn as soon as this finishes, with no OD task to read it again.
+      // Samples are read as float, as PCMAliasBlockFile::ReadData does.
+      if (mInfo.channels < 1)
+         return ProgressResult::Failed;
+      Floats srcbuffer{ maxBlockSize * mInfo.channels };
+      Floats buffer{ maxBlockSize };
 
       for (decltype(fileTotalFrames) i = 0; i < fileTotalFrames; i += maxBlockSize) {
 
          const auto blockLen =
             limitSampleBufferSize( maxBlockSize, fileTotalFrames - i );
 
+         auto framesRead = SFCall<sf_count_t>(
+            sf_readf_float, mFile.get(), srcbuffer.get(), blockLen);
+         if (framesRead < 0)
+            framesRead = 0;
+         // A short file reads as silence, as the block will later
+         std::fill(srcbuffer.get() + framesRead * mInfo.channels,
+                   srcbuffer.get() + blockLen * mInfo.channels, 0.0f);
+
          auto iter = channels.begin();
-         for (int c = 0; c < mInfo.channels; ++iter, ++c)
-            iter->get()->AppendAlias(mFilename, i, blockLen, c,useOD);
-
-         if (++updateCounter == 50) {
-            updateResult = mProgress->Update(
-               i.as_long_long(),
-               fileTotalFrames.as_long_long()
-            );
-            updateCounter = 0;
-            if (updateResult != ProgressResult::Success)
-               break;
+         for (int c = 0; c < mInfo.channels; ++iter, ++c) {
+            for (size_t j = 0; j < blockLen; j++)
+               buffer[j] = srcbuffer[mInfo.channels * j + c];
+            iter->get()->AppendAlias(mFilename, i, blockLen, c,
+                                     (samplePtr)buffer.get(), floatSample);
          }
-      }
 
-      // One last update for completion
-      updateResult = mProgress->Update(
-         fileTotalFrames.as_long_long(),
-         fileTotalFrames.as_long_long()
-      );
-
-      if(useOD)
-      {
-         auto computeTask = std::make_unique<ODComputeSummaryTask>();
-         bool moreThanStereo = mInfo.channels>2;
-         for (const auto &channel : channels)
-         {
-            computeTask->AddWaveTrack(channel.get());
-            if(moreThanStereo)
-            {
-               //if we have 3 more channels, they get imported on seperate tracks, so we add individual tasks for each.
-               ODManager::Instance()->AddNewTask(std::move(computeTask));
-               computeTask = std::make_unique<ODComputeSummaryTask>();
-            }
-         }
-         //if we have a linked track, we add ONE task.
-         if(!moreThanStereo)
-            ODManager::Instance()->AddNewTask(std::move(computeTask));
+         updateResult = mProgress->Update(
+            (i + blockLen).as_long_long(),
+            fileTotalFrames.as_long_long()
+         );
+         if (updateResult != ProgressResult::Success)
+            break;
       }
+
+      if (fileTotalFrames == 0)
+         updateResult = ProgressResult::Success;
    }
    else {
       // Otherwise, we're in the "copy" mode, where we read in the actual
@@ -27,6 +27,13 @@ Gives API for sound file import.
 
 *//****************************************************************//**
 
+\class ImportProgress
+\brief The progress of importing one file:  a dialog of its own, or,
+when several files are imported at once, a report to the dialog they
+share.
+
+*//****************************************************************//**
+
 \class ImportPlugin
 \brief Base class for FlacImportPlugin, LOFImportPlugin,
 MP3ImportPlugin, OggImportPlugin and PCMImportPlugin.
@@ -57,6 +64,7 @@ but little else.
 
 #include "../Audacity.h"
 #include "../Internat.h"
+#include <functional>
 #include <wx/filename.h>
 #include "../MemoryX.h"
 
@@ -116,6 +124,42 @@ protected:
 };
 
 
+class ImportProgress
+{
+public:
+   // Reports the fraction done, from the thread importing, and returns
+   // the latest answer of the shared dialog
+   using Report = std::function< ProgressResult( double fraction ) >;
+
+   ImportProgress(const wxString &title, const wxString &message)
+   {
+      mDialog.create(title, message);
+   }
+
+   explicit ImportProgress(const Report &report)
+   :  mReport{ report }
+   {
+   }
+
+   ProgressResult Update(double current, double total)
+   {
+      if (mReport)
+         return mReport(total > 0 ? current / total : 0.0);
+      return mDialog->Update(current, total);
+   }
+
+   // For the various types that importers count in
+   template< typename Count1, typename Count2 >
+   ProgressResult Update(Count1 current, Count2 total)
+   {
+      return Update(static_cast<double>(current), static_cast<double>(total));
+   }
+
+private:
+   Report mReport;
+   Maybe<ProgressDialog> mDialog;
+};
+
 class ImportFileHandle /* not final */
 {
 public:
@@ -137,7 +181,23 @@ public:
       wxString title;
 
       title.Printf(_("Importing %s"), GetFileDescription());
-      mProgress.create(title, ff.GetFullName());
+      if (mReport)
+         mProgress.create(mReport);
+      else
+         mProgress.create(title, ff.GetFullName());
+   }
+
+   // Called on the main thread after the streams are chosen.  Should ask
+   // the user anything that Import() would, and return whether Import()
+   // may then run on another thread, at once with the imports of other
+   // files:  it must show nothing but its progress, and use no
+   // preferences.
+   virtual bool PrepareConcurrentImport() { return false; }
+
+   // Before a concurrent Import(), to have its progress reported so
+   void SetConcurrentProgress(const ImportProgress::Report &report)
+   {
+      mReport = report;
    }
 
    // This is similar to GetImporterDescription, but if possible the
@@ -171,7 +231,8 @@ public:
 
 protected:
    wxString mFilename;
-   Maybe<ProgressDialog> mProgress;
+   Maybe<ImportProgress> mProgress;
+   ImportProgress::Report mReport;
 };
 
 
@@ -30,12 +30,16 @@ and sample size to help you importing data of an unknown format.
 #include "../FileException.h"
 #include "../FileFormats.h"
 #include "../Internat.h"
+#include "../MappedFile.h"
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
+#include "../TaskScheduler.h"
 #include "../UserException.h"
 #include "../WaveTrack.h"
+#include "../blockfile/RawAliasBlockFile.h"
 #include "../prefs/QualityPrefs.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <stdint.h>
@@ -95,6 +99,66 @@ class ImportRawDialog final : public wxDialogWrapper {
    DECLARE_EVENT_TABLE()
 };
 
+// Decode the frames of the mapped file into blocks of every channel, a few
+// blocks for each processor at a time, and append them to the tracks in
+// order.  In edit mode the blocks alias the file, and only summaries are
+// written.
+static ProgressResult ImportMapped(const MappedFile &file,
+   const RawLayout &layout, const wxString &fileName, bool doEdit,
+   double percent, TrackHolders &channels, ProgressDialog &progress)
+{
+   const auto numChannels = layout.GetChannels();
+   const auto frameBytes = layout.GetBytesPerFrame();
+   const auto size = (wxFileOffset)file.GetSize();
+   const auto fileFrames = size > layout.GetOffset()
+      ? ( size - layout.GetOffset() ) / (wxFileOffset)frameBytes
+      : 0;
+   const auto totalFrames =
+      std::max( 0LL, (long long)(fileFrames * percent / 100.0) );
+
+   const auto firstChannel = channels.begin()->get();
+   const auto format = firstChannel->GetSampleFormat();
+   const long long maxBlockSize = firstChannel->GetMaxBlockSize();
+   const auto &dirManager = firstChannel->GetDirManager();
+   const auto data = file.GetData() + layout.GetOffset();
+
+   auto &scheduler = TaskScheduler::Get();
+   const long long nBlocks = ( totalFrames + maxBlockSize - 1 ) / maxBlockSize;
+   // Enough to keep the workers busy, few enough that the progress moves
+   const long long batch = 4 * scheduler.GetConcurrency();
+
+   for (long long first = 0; first < nBlocks; first += batch) {
+      const auto count = std::min( batch, nBlocks - first );
+      std::vector< BlockFilePtr > blocks( count * numChannels );
+      scheduler.ParallelFor( TaskScheduler::Interactive, blocks.size(),
+         [&]( size_t ii ) {
+            // Channels of the same frames are neighbors, sharing pages
+            const unsigned channel = ii % numChannels;
+            const auto start = ( first + ii / numChannels ) * maxBlockSize;
+            const auto len = limitSampleBufferSize(
+               maxBlockSize, totalFrames - start );
+            SampleBuffer buffer( len, format );
+            layout.Decode( data + start * frameBytes, channel, len,
+                           buffer.ptr(), format );
+            blocks[ii] = doEdit
+               ? dirManager->NewRawAliasBlockFile( fileName, start, len,
+                    channel, layout, buffer.ptr(), format )
+               : dirManager->NewSimpleBlockFile( buffer.ptr(), len, format );
+         } );
+
+      for (size_t ii = 0; ii < blocks.size(); ++ii)
+         channels[ ii % numChannels ]->AppendBlockFile( blocks[ii] );
+
+      const auto result = progress.Update(
+         std::min( totalFrames, ( first + count ) * maxBlockSize ),
+         totalFrames );
+      if (result != ProgressResult::Success)
+         return result;
+   }
+
+   return ProgressResult::Success;
+}
+
 // This function leaves outTracks empty as an indication of error,
 // but may also throw FileException to make use of the application's
 // user visible error reporting.
@@ -148,44 +212,6 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       offset = (sf_count_t)dlog.mOffset;
       percent = dlog.mPercent;
 
-      memset(&sndInfo, 0, sizeof(SF_INFO));
-      sndInfo.samplerate = (int)rate;
-      sndInfo.channels = (int)numChannels;
-      sndInfo.format = encoding | SF_FORMAT_RAW;
-
-      wxFile f;   // will be closed when it goes out of scope
-      SFFile sndFile;
-
-      if (f.Open(fileName)) {
-         // Even though there is an sf_open() that takes a filename, use the one that
-         // takes a file descriptor since wxWidgets can open a file with a Unicode name and
-         // libsndfile can't (under Windows).
-         sndFile.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &sndInfo, FALSE));
-      }
-
-      if (!sndFile){
-         char str[1000];
-         sf_error_str((SNDFILE *)NULL, str, 1000);
-         wxPrintf("%s\n", str);
-
-         throw FileException{ FileException::Cause::Open, fileName };
-      }
-
-      result = sf_command(sndFile.get(), SFC_SET_RAW_START_OFFSET, &offset, sizeof(offset));
-      if (result != 0) {
-         char str[1000];
-         sf_error_str(sndFile.get(), str, 1000);
-         wxPrintf("%s\n", str);
-
-         throw FileException{ FileException::Cause::Read, fileName };
-      }
-
-      SFCall<sf_count_t>(sf_seek, sndFile.get(), 0, SEEK_SET);
-
-      auto totalFrames =
-         // fraction of a sf_count_t value
-         (sampleCount)(sndInfo.frames * percent / 100.0);
-
       //
       // Sample format:
       //
@@ -225,17 +251,6 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
          firstChannel->SetLinked(true);
       }
 
-      auto maxBlockSize = firstChannel->GetMaxBlockSize();
-
-      SampleBuffer srcbuffer(maxBlockSize * numChannels, format);
-      SampleBuffer buffer(maxBlockSize, format);
-
-      decltype(totalFrames) framescompleted = 0;
-      if (totalFrames < 0) {
-         wxASSERT(false);
-         totalFrames = 0;
-      }
-
       wxString msg;
 
       msg.Printf(_("Importing %s"), wxFileName::FileName(fileName).GetFullName());
@@ -243,53 +258,120 @@ void ImportRaw(wxWindow *parent, const wxString &fileName,
       /* i18n-hint: 'Raw' means 'unprocessed' here and should usually be tanslated.*/
       ProgressDialog progress(_("Import Raw"), msg);
 
-      size_t block;
-      do {
-         block =
-            limitSampleBufferSize( maxBlockSize, totalFrames - framescompleted );
+      // The encodings decoded here are imported from a mapping of the
+      // whole file, on several threads; others are read with libsndfile
+      std::unique_ptr<MappedFile> pMapped;
+      if (RawLayout::IsSupported(encoding))
+         pMapped = std::make_unique<MappedFile>(fileName);
+
+      if (pMapped && pMapped->IsOk()) {
+         // Fall back to "copy" if it doesn't match anything else, since it
+         // is safer
+         const bool doEdit = gPrefs->Read(
+            wxT("/FileFormats/CopyOrEditUncompressedData"), wxT("copy"))
+               .IsSameAs(wxT("edit"), false);
+         updateResult = ImportMapped(*pMapped,
+            RawLayout{ encoding, numChannels, (wxFileOffset)offset },
+            fileName, doEdit, percent, channels, progress);
+      }
+      else {
+         memset(&sndInfo, 0, sizeof(SF_INFO));
+         sndInfo.samplerate = (int)rate;
+         sndInfo.channels = (int)numChannels;
+         sndInfo.format = encoding | SF_FORMAT_RAW;
+
+         wxFile f;   // will be closed when it goes out of scope
+         SFFile sndFile;
+
+         if (f.Open(fileName)) {
+            // Even though there is an sf_open() that takes a filename, use the one that
+            // takes a file descriptor since wxWidgets can open a file with a Unicode name and
+            // libsndfile can't (under Windows).
+            sndFile.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &sndInfo, FALSE));
+         }
 
-         sf_count_t result;
-         if (format == int16Sample)
-            result = SFCall<sf_count_t>(sf_readf_short, sndFile.get(), (short *)srcbuffer.ptr(), block);
-         else
-            result = SFCall<sf_count_t>(sf_readf_float, sndFile.get(), (float *)srcbuffer.ptr(), block);
+         if (!sndFile){
+            char str[1000];
+            sf_error_str((SNDFILE *)NULL, str, 1000);
+            wxPrintf("%s\n", str);
 
-         if (result >= 0) {
-            block = result;
+            throw FileException{ FileException::Cause::Open, fileName };
          }
-         else {
-            // This is not supposed to happen, sndfile.h says result is always
-            // a count, not an invalid value for error
+
+         result = sf_command(sndFile.get(), SFC_SET_RAW_START_OFFSET, &offset, sizeof(offset));
+         if (result != 0) {
+            char str[1000];
+            sf_error_str(sndFile.get(), str, 1000);
+            wxPrintf("%s\n", str);
+
             throw FileException{ FileException::Cause::Read, fileName };
          }
 
-         if (block) {
-            auto iter = channels.begin();
-            for(decltype(numChannels) c = 0; c < numChannels; ++iter, ++c) {
-               if (format==int16Sample) {
-                  for(decltype(block) j=0; j<block; j++)
-                     ((short *)buffer.ptr())[j] =
-                     ((short *)srcbuffer.ptr())[numChannels*j+c];
-               }
-               else {
-                  for(decltype(block) j=0; j<block; j++)
-                     ((float *)buffer.ptr())[j] =
-                     ((float *)srcbuffer.ptr())[numChannels*j+c];
-               }
+         SFCall<sf_count_t>(sf_seek, sndFile.get(), 0, SEEK_SET);
 
-               iter->get()->Append(buffer.ptr(), (format == int16Sample)?int16Sample:floatSample, block);
-            }
-            framescompleted += block;
+         auto totalFrames =
+            // fraction of a sf_count_t value
+            (sampleCount)(sndInfo.frames * percent / 100.0);
+
+         auto maxBlockSize = firstChannel->GetMaxBlockSize();
+
+         SampleBuffer srcbuffer(maxBlockSize * numChannels, format);
+         SampleBuffer buffer(maxBlockSize, format);
+
+         decltype(totalFrames) framescompleted = 0;
+         if (totalFrames < 0) {
+            wxASSERT(false);
+            totalFrames = 0;
          }
 
-         updateResult = progress.Update(
-            framescompleted.as_long_long(),
-            totalFrames.as_long_long()
-         );
-         if (updateResult != ProgressResult::Success)
-            break;
+         size_t block;
+         do {
+            block =
+               limitSampleBufferSize( maxBlockSize, totalFrames - framescompleted );
+
+            sf_count_t result;
+            if (format == int16Sample)
+               result = SFCall<sf_count_t>(sf_readf_short, sndFile.get(), (short *)srcbuffer.ptr(), block);
+            else
+               result = SFCall<sf_count_t>(sf_readf_float, sndFile.get(), (float *)srcbuffer.ptr(), block);
+
+            if (result >= 0) {
+               block = result;
+            }
+            else {
+               // This is not supposed to happen, sndfile.h says result is always
+               // a count, not an invalid value for error
+               throw FileException{ FileException::Cause::Read, fileName };
+            }
+
+            if (block) {
+               auto iter = channels.begin();
+               for(decltype(numChannels) c = 0; c < numChannels; ++iter, ++c) {
+                  if (format==int16Sample) {
+                     for(decltype(block) j=0; j<block; j++)
+                        ((short *)buffer.ptr())[j] =
+                        ((short *)srcbuffer.ptr())[numChannels*j+c];
+                  }
+                  else {
+                     for(decltype(block) j=0; j<block; j++)
+                        ((float *)buffer.ptr())[j] =
+                        ((float *)srcbuffer.ptr())[numChannels*j+c];
+                  }
+
+                  iter->get()->Append(buffer.ptr(), (format == int16Sample)?int16Sample:floatSample, block);
+               }
+               framescompleted += block;
+            }
+
+            updateResult = progress.Update(
+               framescompleted.as_long_long(),
+               totalFrames.as_long_long()
+            );
+            if (updateResult != ProgressResult::Success)
+               break;
          
-      } while (block > 0 && framescompleted < totalFrames);
+         } while (block > 0 && framescompleted < totalFrames);
+      }
    }
 
    if (updateResult == ProgressResult::Failed || updateResult == ProgressResult::Cancelled)
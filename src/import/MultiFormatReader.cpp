@@ -17,6 +17,7 @@ machine endianness representations.
 #include "MultiFormatReader.h"
 
 #include <exception>
+#include <algorithm>
 #include <stdexcept>
 #include <cstring>
 #include <stdint.h>
@@ -114,13 +115,20 @@ size_t MultiFormatReader::Read(void* buffer, size_t size, size_t len, size_t str
    
    if (stride > 1)
    {
-      // There are gaps between consecutive samples,
-      // so do a scattered read
-      for (size_t n = 0; n < len; n++)
+      // There are gaps between consecutive samples, so read the
+      // whole span at once and gather the samples from it, rather
+      // than seeking after each one
+      const size_t span = len * stride * size;
+      if (mScatterBuffer.size() < span)
+         mScatterBuffer.resize(span);
+      size_t bytes = fread(mScatterBuffer.data(), 1, span, mpFid);
+
+      // A sample counts if it was read whole, gap or no gap after it
+      if (bytes >= size)
+         actRead = std::min(len, (bytes - size) / (stride * size) + 1);
+      for (size_t n = 0; n < actRead; n++)
       {
-         actRead += fread(&(pWork[n*size]), size, 1, mpFid);
-         // FIXME: TRAP_ERR fseek return in MultiFormatReader unchecked.
-         fseek(mpFid, (stride - 1) * size, SEEK_CUR);
+         memcpy(&(pWork[n*size]), &mScatterBuffer[n*stride*size], size);
       }
    }
    else
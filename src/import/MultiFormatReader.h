@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <vector>
 
 class MachineEndianness
 {
@@ -51,6 +52,7 @@ class MultiFormatReader
    FILE* mpFid;   
    MachineEndianness mEnd;
    uint8_t mSwapBuffer[8];
+   std::vector<uint8_t> mScatterBuffer;
 
 public:
    typedef enum
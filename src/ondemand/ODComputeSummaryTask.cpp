@@ -19,11 +19,13 @@ updating the ODPCMAliasBlockFile and the GUI of the newly available data.
 
 
 #include "ODComputeSummaryTask.h"
+#include "ODManager.h"
 #include "../AudacityException.h"
 #include "../blockfile/ODPCMAliasBlockFile.h"
 #include "../Sequence.h"
 #include "../WaveTrack.h"
 #include <wx/wx.h>
+#include <algorithm>
 
 //36 blockfiles > 3 minutes stereo 44.1kHz per ODTask::DoSome
 #define nBlockFilesPerDoSome 36
@@ -54,7 +56,7 @@ void ODComputeSummaryTask::Terminate()
    mBlockFilesMutex.Unlock();
 }
 
-///Computes and writes the data for one BlockFile if it still has a refcount.
+///Computes and writes the data for a batch of BlockFiles that still have a refcount.
 void ODComputeSummaryTask::DoSomeInternal()
 {
    if(mBlockFiles.size()<=0)
@@ -65,62 +67,74 @@ void ODComputeSummaryTask::DoSomeInternal()
       return;
    }
 
+   const auto pManager = ODManager::Instance();
+
+   //Take the batch from the front of the array, which Update() has put in order of
+   //priority, so the blocks nearest a demand request are done first.  The batch is
+   //small enough that a new request is honored soon.
+   std::vector< std::shared_ptr< ODPCMAliasBlockFile > > blocks;
    mBlockFilesMutex.Lock();
-   for(size_t j=0; j < mWaveTracks.size() && mBlockFiles.size();j++)
-   {
-      bool success = false;
-      const auto bf = mBlockFiles[0].lock();
+   const auto nBlocks = std::min( mBlockFiles.size(),
+      std::max<size_t>( mWaveTracks.size(), pManager->GetWorkerConcurrency() ) );
+   for(size_t j=0; j < nBlocks; j++)
+      blocks.push_back( mBlockFiles[j].lock() );
+   //Don't hold the lock while computing:  ODComputeSummaryTask::Terminate() uses it to
+   //remove everything, and we don't want it to wait since the UI is being blocked.
+   mBlockFilesMutex.Unlock();
 
-      sampleCount blockStartSample = 0;
-      sampleCount blockEndSample = 0;
+   //Each thread claims the next block as it finishes one, so the threads stay busy
+   //even when some blocks are slower to read than others.
+   //A char for each block rather than std::vector<bool>, which threads can't share.
+   std::vector< char > succeeded( nBlocks );
+   pManager->ParallelFor( nBlocks, [&]( size_t j ){
+      const auto &bf = blocks[j];
+      // WriteSummary might throw, but this is a worker thread, so stop
+      // the exceptions here!
+      succeeded[j] = !bf || GuardedCall<bool>( [&] {
+         bf->DoWriteSummary();
+         return true;
+      } );
+   } );
+
+   wxThread::Yield();
 
-      if(bf)
-      {
-         // WriteSummary might throw, but this is a worker thread, so stop
-         // the exceptions here!
-         success = GuardedCall<bool>( [&] {
-            bf->DoWriteSummary();
-            return true;
-         } );
-         blockStartSample = bf->GetStart();
-         blockEndSample = blockStartSample + bf->GetLength();
-      }
-      else
-      {
-         success = true;
-         // The block file disappeared.
-         //the waveform in the wavetrack now is shorter, so we need to update mMaxBlockFiles
-         //because now there is less work to do.
-         mMaxBlockFiles--;
-      }
+   mBlockFilesMutex.Lock();
 
-      if (success)
+   //Only Terminate() changes the array on another thread, and it empties it.
+   if (mBlockFiles.size() >= nBlocks) {
+      //take the finished ones out of the array - we are done with them.
+      //Failures stay at the front; the task does not make progress with them.
+      for(size_t j = nBlocks; j--;)
       {
-         //take it out of the array - we are done with it.
-         mBlockFiles.erase(mBlockFiles.begin());
+         if (succeeded[j])
+         {
+            mBlockFiles.erase(mBlockFiles.begin() + j);
+            if (!blocks[j])
+               // The block file disappeared.
+               //the waveform in the wavetrack now is shorter, so we need to update mMaxBlockFiles
+               //because now there is less work to do.
+               mMaxBlockFiles--;
+         }
       }
-      else
-         // The task does not make progress
-         ;
-
-      //This is a bit of a convenience in case someone tries to terminate the task by closing the trackpanel or window.
-      //ODComputeSummaryTask::Terminate() uses this lock to remove everything, and we don't want it to wait since the UI is being blocked.
-      mBlockFilesMutex.Unlock();
-      wxThread::This()->Yield();
-      mBlockFilesMutex.Lock();
 
       //update the gui for all associated blocks.  It doesn't matter that we're hitting more wavetracks then we should
-      //because this loop runs a number of times equal to the number of tracks, they probably are getting processed in
-      //the next iteration at the same sample window.
-      if (success && bf) {
-         mWaveTrackMutex.Lock();
+      //because the batch holds at least as many blocks as tracks, they probably are getting processed at
+      //the same sample window.
+      mWaveTrackMutex.Lock();
+      for(size_t j = 0; j < nBlocks; j++)
+      {
+         const auto &bf = blocks[j];
+         if (!(succeeded[j] && bf))
+            continue;
+         const auto blockStartSample = bf->GetStart();
+         const auto blockEndSample = blockStartSample + bf->GetLength();
          for(size_t i=0;i<mWaveTracks.size();i++)
          {
-            if(success && mWaveTracks[i])
+            if(mWaveTracks[i])
                mWaveTracks[i]->AddInvalidRegion(blockStartSample,blockEndSample);
          }
-         mWaveTrackMutex.Unlock();
       }
+      mWaveTrackMutex.Unlock();
    }
 
    mBlockFilesMutex.Unlock();
@@ -190,47 +204,49 @@ void ODComputeSummaryTask::Update()
          //gather all the blockfiles that we should process in the wavetrack.
          for (const auto &clip : mWaveTracks[j]->GetAllClips()) {
             seq = clip->GetSequence();
-            //This lock may be way too big since the whole file is one sequence.
-            //TODO: test for large files and find a way to break it down.
-            Sequence::DeleteUpdateMutexLocker locker(*seq);
-
-            //See Sequence::Delete() for why need this for now..
-            //We don't need the mBlockFilesMutex here because it is only for the vector list.
-            //These are existing blocks, and its wavetrack or blockfiles won't be deleted because
-            //of the respective mWaveTrackMutex lock and LockDeleteUpdateMutex() call.
-            blocks = clip->GetSequenceBlockArray();
-            int i;
-            int insertCursor;
+            const sampleCount clipOffset(
+               clip->GetStartTime()*clip->GetRate()
+            );
 
-            insertCursor =0;//OD TODO:see if this works, removed from inner loop (bfore was n*n)
-
-            for(i=0; i<(int)blocks->size(); i++)
+            std::vector< std::shared_ptr< ODPCMAliasBlockFile > > pending;
             {
-               //if there is data but no summary, this blockfile needs summarizing.
-               SeqBlock &block = (*blocks)[i];
-               const auto &file = block.f;
-               if(file->IsDataAvailable() && !file->IsSummaryAvailable())
+               //Held only while finding the blocks, not while ordering them below,
+               //so that Sequence::Delete() on the main thread waits less.
+               Sequence::DeleteUpdateMutexLocker locker(*seq);
+
+               //See Sequence::Delete() for why need this for now..
+               //We don't need the mBlockFilesMutex here because it is only for the vector list.
+               //These are existing blocks, and its wavetrack or blockfiles won't be deleted because
+               //of the respective mWaveTrackMutex lock and LockDeleteUpdateMutex() call.
+               blocks = clip->GetSequenceBlockArray();
+               for (auto &block : *blocks)
                {
-                  const auto odpcmaFile =
-                     std::static_pointer_cast<ODPCMAliasBlockFile>(file);
-                  odpcmaFile->SetStart(block.start);
-                  odpcmaFile->SetClipOffset(sampleCount(
-                     clip->GetStartTime()*clip->GetRate()
-                  ));
-
-                  //these will always be linear within a sequence-lets take advantage of this by keeping a cursor.
+                  //if there is data but no summary, this blockfile needs summarizing.
+                  const auto &file = block.f;
+                  if(file->IsDataAvailable() && !file->IsSummaryAvailable())
                   {
-                     std::shared_ptr< ODPCMAliasBlockFile > ptr;
-                     while(insertCursor < (int)tempBlocks.size() &&
-                           (!(ptr = tempBlocks[insertCursor].lock()) ||
-                            ptr->GetStart() + ptr->GetClipOffset() <
-                            odpcmaFile->GetStart() + odpcmaFile->GetClipOffset()))
-                        insertCursor++;
+                     const auto odpcmaFile =
+                        std::static_pointer_cast<ODPCMAliasBlockFile>(file);
+                     odpcmaFile->SetStart(block.start);
+                     odpcmaFile->SetClipOffset(clipOffset);
+                     pending.push_back(odpcmaFile);
                   }
-
-                  tempBlocks.insert(tempBlocks.begin() + insertCursor++, odpcmaFile);
                }
             }
+
+            //these will always be linear within a sequence-lets take advantage of this by keeping a cursor.
+            size_t insertCursor = 0;
+            for (const auto &odpcmaFile : pending)
+            {
+               std::shared_ptr< ODPCMAliasBlockFile > ptr;
+               while(insertCursor < tempBlocks.size() &&
+                     (!(ptr = tempBlocks[insertCursor].lock()) ||
+                      ptr->GetStart() + ptr->GetClipOffset() <
+                      odpcmaFile->GetStart() + odpcmaFile->GetClipOffset()))
+                  insertCursor++;
+
+               tempBlocks.insert(tempBlocks.begin() + insertCursor++, odpcmaFile);
+            }
          }
       }
    }
@@ -56,7 +56,8 @@ protected:
    ///recalculates the percentage complete.
    void CalculatePercentComplete() override;
 
-   ///Computes and writes the data for one BlockFile if it still has a refcount.
+   ///Computes and writes the data for a batch of BlockFiles that still have a refcount,
+   ///in parallel on the ODManager's worker threads.
    void DoSomeInternal() override;
 
    ///Readjusts the blockfile order in the default manner.  If we have had an ODRequest
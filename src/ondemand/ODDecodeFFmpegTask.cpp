@@ -24,22 +24,52 @@
 #ifdef EXPERIMENTAL_OD_FFMPEG
 
 #include <algorithm>
-#include <functional>
+#include <vector>
 
 #include "../FFmpeg.h"      // which brings in avcodec.h, avformat.h
 #include "../import/ImportFFmpeg.h"
+#include "../SampleFormat.h"
+#include "ODManager.h"
 
 
 extern FFmpegLibs *FFmpegLibsInst();
 #include "ODDecodeFFmpegTask.h"
 
 
-#define ODFFMPEG_SEEKING_TEST_UNKNOWN 0
-#define ODFFMPEG_SEEKING_TEST_FAILED -1
-#define ODFFMPEG_SEEKING_TEST_SUCCESS 1
-
 #define kMaxSamplesInCache 4410000
 
+//the seek index keeps one packet in about this many samples.
+#define kIndexSpacing 16384
+//a seek lands this far before the samples wanted, so that the decoder has settled
+//(overlapped transforms, bit reservoirs) by the time it reaches them.
+#define kSeekPreroll 8192
+
+namespace {
+   //opening and closing contexts and codecs is not thread-safe in the versions of
+   //libavformat and libavcodec we load, and neither is their reference count.
+   ODLock sContextMutex;
+
+   //import_ffmpeg_decode_frame interleaves the channels of planar formats
+   AVSampleFormat InterleavedFormat(AVSampleFormat format)
+   {
+      switch (format)
+      {
+      case AV_SAMPLE_FMT_U8P:
+         return AV_SAMPLE_FMT_U8;
+      case AV_SAMPLE_FMT_S16P:
+         return AV_SAMPLE_FMT_S16;
+      case AV_SAMPLE_FMT_S32P:
+         return AV_SAMPLE_FMT_S32;
+      case AV_SAMPLE_FMT_FLTP:
+         return AV_SAMPLE_FMT_FLT;
+      case AV_SAMPLE_FMT_DBLP:
+         return AV_SAMPLE_FMT_DBL;
+      default:
+         return format;
+      }
+   }
+}
+
 //struct for caching the decoded samples to be used over multiple blockfiles
 struct FFMpegDecodeCache
 {
@@ -51,19 +81,64 @@ struct FFMpegDecodeCache
 
 };
 
+/// The seek index and the decoded samples of one stream of one file, shared by
+/// the decoders of the stream, which may run on several threads.
+///
+/// The index maps timestamps of packets decoded so far to the first samples
+/// decoded from them, so that a decoder can seek back into what has been
+/// decoded and know exactly where it is.  Beyond the last packet, positions
+/// are extrapolated from timestamps, only if one tick of the time base of
+/// the stream is no longer than a sample.
+struct FFmpegStreamCache
+{
+   ///puts the actual audio samples into the blockfile's data array
+   int Fill(samplePtr & data, sampleFormat outFormat, sampleCount & start, size_t& len, unsigned int channel);
+   void Insert(std::unique_ptr<FFMpegDecodeCache> &&cache);
+
+   ///The sample decoded first from the packet with the timestamp, if it is in the index
+   bool Find(int64_t ts, sampleCount &sample);
+   ///The sample of a packet not in the index, counted from the last packet before it
+   bool Extrapolate(int64_t ts, sampleCount &sample);
+   ///The timestamp to seek to, so as to land at or before the sample
+   bool FindTimestamp(sampleCount sample, int64_t &ts);
+   void Add(int64_t ts, sampleCount sample);
+
+   void SetSamplesPerTick(double samplesPerTick);
+   void MarkSeekFailed();
+   bool SeekFailed();
+   ///Whether a decoder starting anywhere can learn its position
+   bool AllowsParallel();
+
+private:
+   struct Entry {
+      int64_t ts;
+      sampleCount sample;
+   };
+
+   ODLock mMutex;
+   // Guarded by mMutex:
+   //sorted by timestamp, and so by sample.
+   std::vector<Entry> mIndex;
+   //sorted by start.
+   std::vector<std::unique_ptr<FFMpegDecodeCache>> mDecoded;
+   size_t mNumSamplesInCache{ 0 };
+   //zero until a decoder has opened the file, or if the ticks are too coarse
+   double mSamplesPerTick{ 0 };
+   bool mOpened{ false };
+   bool mSeekFailed{ false };
+};
+
 
 //------ ODFFmpegDecoder declaration and defs - here because we strip dependencies from .h files
 
-///class to decode a particular file (one per file).  Saves info such as filename and length (after the header is read.)
+///class to decode one stream of a file.  Each has its own contexts, so that several may
+///decode the same stream on different threads.
 class ODFFmpegDecoder final : public ODFileDecoder
 {
 public:
    ///This should handle unicode converted to UTF-8 on mac/linux, but OD TODO:check on windows
-   ODFFmpegDecoder(const wxString & fileName,
-      const ScsPtr &scs,
-      ODDecodeFFmpegTask::Streams &&channels,
-      const std::shared_ptr<FFmpegContext> &formatContext,
-      int streamIndex);
+   ODFFmpegDecoder(const wxString & fileName, int streamIndex,
+      const std::shared_ptr<FFmpegStreamCache> &cache);
    virtual ~ODFFmpegDecoder();
 
    ///Decodes the samples for this blockfile from the real file into a float buffer.
@@ -75,19 +150,25 @@ public:
    ///the file object if it needs to.
    int Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel) override;
 
-   ///This is a must implement abstract virtual in the superclass.
-   ///However it doesn't do anything because ImportFFMpeg does all that for us.
-   bool ReadHeader() override {return true;}
+   ///Opens the file, and the codec of the stream.
+   bool ReadHeader() override;
 
-   bool SeekingAllowed() ;
+   bool SeekingAllowed() override;
 
 private:
-   void InsertCache(std::unique_ptr<FFMpegDecodeCache> &&cache);
-
-   //puts the actual audio samples into the blockfile's data array
-   int FillDataFromCache(samplePtr & data, sampleFormat outFormat, sampleCount & start, size_t& len, unsigned int channel);
-         ///REFACTORABLE CODE FROM IMPORT FFMPEG
-      ///! Reads next audio frame
+   bool Open();
+   void Close();
+   bool Reopen();
+
+   ///Seeks to a packet a little before start.  The position is known again
+   ///when a packet is found in the index, or extrapolated.
+   bool SeekTo(sampleCount start);
+   ///Finds the position of the packet just read, and adds it to the index.
+   ///False if it is unknown.
+   bool PlacePacket();
+
+   ///REFACTORABLE CODE FROM IMPORT FFMPEG
+   ///! Reads next audio frame
    ///\return pointer to the stream context structure to which the frame belongs to or NULL on error, or 1 if stream is not to be imported.
    streamContext* ReadNextFrame();
 
@@ -97,374 +178,28 @@ private:
    ///\return 0 on success, -1 if it can't decode any further
    int DecodeFrame(streamContext *sc, bool flushing);
 
-   ScsPtr mScs;           //!< Pointer to array of pointers to stream contexts.
-   ODDecodeFFmpegTask::Streams mChannels;
-   std::shared_ptr<FFmpegContext> mContext; //!< Format description, also contains metadata and some useful info
-   std::vector<std::unique_ptr<FFMpegDecodeCache>> mDecodeCache;
-   int                  mNumSamplesInCache;
-   sampleCount                  mCurrentPos;     //the index of the next sample to be decoded
-   size_t                       mCurrentLen;     //length of the last packet decoded
+   const int mStreamIndex;
+   const std::shared_ptr<FFmpegStreamCache> mCache;
+   std::unique_ptr<FFmpegContext> mContext; //!< Format description, private to this decoder
+   std::unique_ptr<streamContext> mSc;      //!< The one stream that is decoded
 
-   bool                 mSeekingAllowedStatus;
-   int                  mStreamIndex;
+   sampleFormat         mFormat;
+   double               mSamplesPerTick;
+   sampleCount          mCurrentPos;     //the index of the next sample to be decoded
+   bool                 mPositionKnown;  //false after a seek, until a packet is placed
+   sampleCount          mKeepFrom;       //frames ending before this are not cached
 };
 
-auto ODDecodeFFmpegTask::FromList(const std::list<TrackHolders> &channels) -> Streams
-{
-   Streams streams;
-   streams.reserve(channels.size());
-   using namespace std;
-   transform(channels.begin(), channels.end(), back_inserter(streams),
-      [](const TrackHolders &holders) {
-         Channels channels;
-         channels.reserve(holders.size());
-         transform(holders.begin(), holders.end(), back_inserter(channels),
-            mem_fun_ref(&TrackHolders::value_type::get)
-         );
-         return channels;
-      }
-   );
-   return streams;
-}
-
-//------ ODDecodeFFmpegTask definitions
-ODDecodeFFmpegTask::ODDecodeFFmpegTask(const ScsPtr &scs, Streams &&channels, const std::shared_ptr<FFmpegContext> &context, int streamIndex)
-   : mChannels(std::move(channels))
-{
-   mScs=scs;
-   mContext = context;
-   mStreamIndex = streamIndex;
-}
-ODDecodeFFmpegTask::~ODDecodeFFmpegTask()
-{
-}
-
-
-std::unique_ptr<ODTask> ODDecodeFFmpegTask::Clone() const
-{
-   auto clone = std::make_unique<ODDecodeFFmpegTask>(mScs, Streams{ mChannels }, mContext, mStreamIndex);
-   clone->mDemandSample=GetDemandSample();
-
-   //the decoders and blockfiles should not be copied.  They are created as the task runs.
-   // This std::move is needed to "upcast" the pointer type
-   return std::move(clone);
-}
-
-///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
-//
-//compare to FLACImportPlugin::Open(wxString filename)
-ODFileDecoder* ODDecodeFFmpegTask::CreateFileDecoder(const wxString & fileName)
-{
-   // Open the file for import
-   auto decoder =
-      std::make_unique<ODFFmpegDecoder>(fileName, mScs, ODDecodeFFmpegTask::Streams{ mChannels },
-      mContext, mStreamIndex);
-
-   mDecoders.push_back(std::move(decoder));
-   return mDecoders.back().get();
-
-}
-
-/// subclasses need to override this if they cannot always seek.
-/// seeking will be enabled once this is true.
-bool ODFFmpegDecoder::SeekingAllowed()
-{
-   return false;
-   /*
-   if(ODFFMPEG_SEEKING_TEST_UNKNOWN != mSeekingAllowedStatus)
-      return mSeekingAllowedStatus == ODFFMPEG_SEEKING_TEST_SUCCESS;
-
-   //we can seek if the following checks pass:
-   //-sample rate is less than the reciprocal of the time_base of the seeking stream.
-   //-a seek test has been made and dts updates as expected.
-   //we want to clone this to run a seek test.
-   AVFormatContext* ic = (AVFormatContext*)mFormatContext;
-   bool  audioStreamExists = false;
-   AVStream* st;
-
-   //test the audio stream(s)
-   for (unsigned int i = 0; i < ic->nb_streams; i++)
-   {
-      if (ic->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO)
-      {
-         audioStreamExists = true;
-         st = ic->streams[i];
-         if(st->duration <= 0 || st->codec->sample_rate <= 0)
-            goto test_failed;
-
-         //if the time base reciprocal is less than the sample rate it means we can't accurately represent a sample with the timestamp in av.
-         float time_base_inv = ((float)st->time_base.den/st->time_base.num);
-         if(time_base_inv < st->codec->sample_rate)
-            goto test_failed;
-
-      }
-   }
-
-   if(!audioStreamExists)
-      goto test_failed;
-   //TODO: now try a seek and see if dts/pts (decode/presentation timestamp) is updated as we expected it to be.
-   //This should be done using a NEW AVFormatContext clone so that we don't ruin the file pointer if we fail.
-//   url_fseek(mFormatContext->pb,0,SEEK_SET);
-
-
-   std::unique_ptr<FFmpegContext> tempMpegContext;
-   AVFormatContext* tempContext;
-   int err;
-   err = ufile_fopen_input(tempMpegContext, mFName);
-   if (err < 0)
-   {
-      goto test_failed;
-   }
-   tempContext = tempMpegContext->ic_ptr;
-
-   err = avformat_find_stream_info(tempContext, NULL);
-   if (err < 0)
-   {
-      goto test_failed;
-   }
-
-   if(av_seek_frame(tempContext, st->index, 0, 0) >= 0) {
-      mSeekingAllowedStatus = ODFFMPEG_SEEKING_TEST_SUCCESS;
-      return SeekingAllowed();
-   }
-
-test_failed:
-   mSeekingAllowedStatus = ODFFMPEG_SEEKING_TEST_FAILED;
-   return SeekingAllowed();
-   */
-}
-
-
-//------ ODDecodeFFmpegFileDecoder
-ODFFmpegDecoder::ODFFmpegDecoder(const wxString & fileName,
-   const ScsPtr &scs,
-   ODDecodeFFmpegTask::Streams &&channels,
-   const std::shared_ptr<FFmpegContext> &context,
-int streamIndex)
-:ODFileDecoder(fileName),
-//mSamplesDone(0),
-mScs(scs),
-mContext(context),
-mNumSamplesInCache(0),
-mCurrentLen(0),
-mSeekingAllowedStatus(ODFFMPEG_SEEKING_TEST_UNKNOWN),
-mStreamIndex(streamIndex)
-{
-   PickFFmpegLibs();
-
-   //do a shallow copy of the 2d array.
-   mChannels = std::move(channels);
-
-   // get the current stream start time.
-   int64_t stream_delay = 0;
-   const auto sc = mScs->get()[streamIndex].get();
-   if (sc->m_stream->start_time != int64_t(AV_NOPTS_VALUE) &&
-       sc->m_stream->start_time > 0) {
-      stream_delay = sc->m_stream->start_time;
-   }
-   mCurrentPos = sampleCount{ double(stream_delay) / AV_TIME_BASE };
-
-   //TODO: add a ref counter to scs?  This will be necessary if we want to allow copy and paste of not-yet decoded
-   //ODDecodeBlockFiles that point to FFmpeg files.
-}
-
-//we have taken ownership, so DELETE the ffmpeg stuff allocated in ImportFFmpeg that was given to us.
-ODFFmpegDecoder::~ODFFmpegDecoder()
-{
-   // Do this before unloading libraries
-   mContext.reset();
+//------ FFmpegStreamCache
 
-   //DELETE our caches.
-   while(mDecodeCache.size())
-      mDecodeCache.erase(mDecodeCache.begin());
-
-   DropFFmpegLibs();
-}
-
-//we read the file from left to right, so in some cases it makes more sense not to seek and just carry on the decode if the gap is small enough.
-//this value controls this amount.  this should be a value that is much larger than the payload for a single packet, and around block file size around 1-10 secs.
-#define kDecodeSampleAllowance 400000
-//number of jump backwards seeks
-#define kMaxSeekRewindAttempts 8
-int ODFFmpegDecoder::Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel)
-{
-   auto mFormatContext = mContext->ic_ptr;
-
-   auto scs = mScs->get();
-   auto sci = scs[mStreamIndex].get();
-   format = sci->m_osamplefmt;
-
-   data.Allocate(len, format);
-   samplePtr bufStart = data.ptr();
-   streamContext* sc = NULL;
-
-   // wxPrintf("start %llu len %lu\n", start, len);
-   //TODO update this to work with seek - this only works linearly now.
-   if(mCurrentPos > start && mCurrentPos  <= start+len + kDecodeSampleAllowance)
-   {
-      //this next call takes data, start and len as reference variables and updates them to reflect the NEW area that is needed.
-      FillDataFromCache(bufStart, format, start,len,channel);
-   }
-
-   bool seeking = false;
-   //look at the decoding timestamp and see if the next sample that will be decoded is not the next sample we need.
-   if(len && (mCurrentPos > start + len  || mCurrentPos + kDecodeSampleAllowance < start ) && SeekingAllowed()) {
-      sc = sci;
-      AVStream* st = sc->m_stream;
-      int stindex = -1;
-      uint64_t targetts;
-
-      //wxPrintf("attempting seek to %llu\n", start);
-      //we have to find the index for this stream.
-      for (unsigned int i = 0; i < mFormatContext->nb_streams; i++) {
-         if (mFormatContext->streams[i] == sc->m_stream )
-            stindex =i;
-      }
-
-      if(stindex >=0) {
-         int numAttempts = 0;
-         //reset mCurrentPos to a bogus value
-         mCurrentPos = start+len +1;
-         while(numAttempts++ < kMaxSeekRewindAttempts && mCurrentPos > start) {
-            //we want to move slightly before the start of the block file, but not too far ahead
-            targetts =
-               (start - kDecodeSampleAllowance * numAttempts / kMaxSeekRewindAttempts)
-                  .as_long_long() *
-               ((double)st->time_base.den/(st->time_base.num * st->codec->sample_rate ));
-            if(targetts<0)
-               targetts=0;
-
-            //wxPrintf("attempting seek to %llu, attempts %d\n", targetts, numAttempts);
-            if(av_seek_frame(mFormatContext,stindex,targetts,0) >= 0){
-               //find out the dts we've seekd to.
-               sampleCount actualDecodeStart { 0.5 + st->codec->sample_rate * st->cur_dts  * ((double)st->time_base.num/st->time_base.den) };      //this is mostly safe because den is usually 1 or low number but check for high values.
-
-               mCurrentPos = actualDecodeStart;
-               seeking = true;
-
-               //if the seek was past our desired position, rewind a bit.
-               //wxPrintf("seek ok to %llu samps, float: %f\n",actualDecodeStart,actualDecodeStartDouble);
-            } else {
-               wxPrintf("seek failed");
-               break;
-            }
-         }
-         if(mCurrentPos>start){
-            mSeekingAllowedStatus = (bool)ODFFMPEG_SEEKING_TEST_FAILED;
-            //               url_fseek(mFormatContext->pb,sc->m_pkt.pos,SEEK_SET);
-            wxPrintf("seek fail, reverting to previous pos\n");
-            return -1;
-         }
-      }
-   }
-   bool firstpass = true;
-
-   //we decode up to the end of the blockfile
-   while (len>0 && (mCurrentPos < start+len) && (sc = ReadNextFrame()) != NULL)
-   {
-      // ReadNextFrame returns 1 if stream is not to be imported
-      if (sc != (streamContext*)1)
-      {
-         //find out the dts we've seekd to.  can't use the stream->cur_dts because it is faulty.  also note that until we do the first seek, pkt.dts can be false and will change for the same samples after the initial seek.
-         auto actualDecodeStart = mCurrentPos;
-
-         // we need adjacent samples, so don't use dts most of the time which will leave gaps between frames
-         // for some formats
-         // The only other case for inserting silence is for initial offset and ImportFFmpeg.cpp does this for us
-         if (seeking) {
-            actualDecodeStart = sampleCount{ 0.52 + (sc->m_stream->codec->sample_rate * sc->m_pkt->dts
-                                        * ((double)sc->m_stream->time_base.num / sc->m_stream->time_base.den)) };
-            //this is mostly safe because den is usually 1 or low number but check for high values.
-
-            //hack to get rounding to work to neareset frame size since dts isn't exact
-            if (sc->m_stream->codec->frame_size) {
-               actualDecodeStart = ((actualDecodeStart + sc->m_stream->codec->frame_size/2) / sc->m_stream->codec->frame_size) * sc->m_stream->codec->frame_size;
-            }
-            // reset for the next one
-            seeking = false;
-         }
-         if(actualDecodeStart != mCurrentPos)
-            wxPrintf("ts not matching - now:%llu , last:%llu, lastlen:%lu, start %llu, len %lu\n",actualDecodeStart.as_long_long(), mCurrentPos.as_long_long(), mCurrentLen, start.as_long_long(), len);
-            //if we've skipped over some samples, fill the gap with silence.  This could happen often in the beginning of the file.
-         if(actualDecodeStart>start && firstpass) {
-            // find the number of samples for the leading silence
-
-            // UNSAFE_SAMPLE_COUNT_TRUNCATION
-            // -- but used only experimentally as of this writing
-            // Is there a proof size_t will not overflow size_t?
-            // Result is surely nonnegative.
-            auto amt = (actualDecodeStart - start).as_size_t();
-            auto cache = std::make_unique<FFMpegDecodeCache>();
-
-            //wxPrintf("skipping/zeroing %i samples. - now:%llu (%f), last:%llu, lastlen:%lu, start %llu, len %lu\n",amt,actualDecodeStart, actualDecodeStartdouble, mCurrentPos, mCurrentLen, start, len);
-
-            //put it in the cache so the other channels can use it.
-            // wxASSERT(sc->m_stream->codec->channels > 0);
-            cache->numChannels = std::max<unsigned>(0, sc->m_stream->codec->channels);
-            cache->len = amt;
-            cache->start=start;
-            // 8 bit and 16 bit audio output from ffmpeg means
-            // 16 bit int out.
-            // 32 bit int, float, double mean float out.
-            if (format == int16Sample)
-               cache->samplefmt = AV_SAMPLE_FMT_S16;
-            else
-               cache->samplefmt = AV_SAMPLE_FMT_FLT;
-
-            cache->samplePtr.reinit(amt * cache->numChannels * SAMPLE_SIZE(format), true);
-
-            InsertCache(std::move(cache));
-         }
-         firstpass=false;
-         mCurrentPos = actualDecodeStart;
-         //decode the entire packet (unused bits get saved in cache, so as long as cache size limit is bigger than the
-         //largest packet size, we're ok.
-         while (sc->m_pktRemainingSiz > 0)
-            //Fill the cache with decoded samples
-               if (DecodeFrame(sc,false) < 0)
-                  break;
-
-         // Cleanup after frame decoding
-         sc->m_pkt.reset();
-      }
-   }
-
-   // Flush the decoders if we're done.
-   if((!sc || sc == (streamContext*) 1)&& len>0)
-   {
-      for (int i = 0; i < mChannels.size(); i++)
-      {
-         sc = scs[i].get();
-         sc->m_pkt.create();
-         if (DecodeFrame(sc, true) == 0)
-         {
-            sc->m_pkt.reset();
-         }
-      }
-   }
-
-   //this next call takes data, start and len as reference variables and updates them to reflect the NEW area that is needed.
-   FillDataFromCache(bufStart, format, start, len, channel);
-
-   // CHECK: not sure if we need this.  In any case it has to be updated for the NEW float case (not just int16)
-   //if for some reason we couldn't get the samples, fill them with silence
-   /*
-   int16_t* outBuf = (int16_t*) bufStart;
-   for(int i=0;i<len;i++)
-      outBuf[i]=0;
-   */
-   return 1;
-}
-
-
-//puts the actual audio samples into the blockfile's data array
 // the minimum amount of cache entries necessary to warrant a binary search.
 #define kODFFmpegSearchThreshold 10
 ///returns the number of samples filled in from start.
 //also updates data and len to reflect NEW unfilled area - start is unmodified.
-int ODFFmpegDecoder::FillDataFromCache(samplePtr & data, sampleFormat outFormat, sampleCount &start, size_t& len, unsigned int channel)
+int FFmpegStreamCache::Fill(samplePtr & data, sampleFormat outFormat, sampleCount &start, size_t& len, unsigned int channel)
 {
-   if(mDecodeCache.size() <= 0)
+   ODLocker locker{ &mMutex };
+   if(mDecoded.size() <= 0)
       return 0;
    int samplesFilled=0;
 
@@ -474,7 +209,7 @@ int ODFFmpegDecoder::FillDataFromCache(samplePtr & data, sampleFormat outFormat,
    //all we need for this to work is a location in the cache array
    //that has a start time of less than our start sample, but try to get closer with binary search
    int searchStart = 0;
-   int searchEnd = mDecodeCache.size();
+   int searchEnd = mDecoded.size();
    int guess;
    if(searchEnd>kODFFmpegSearchThreshold)
    {
@@ -482,10 +217,10 @@ int ODFFmpegDecoder::FillDataFromCache(samplePtr & data, sampleFormat outFormat,
       //by guessing where our hit will be.
       while(searchStart+1<searchEnd)
       {
-         guess = (searchStart+searchEnd)/2;//find a midpoint. //searchStart+ (searchEnd-searchStart)*  ((float)start - mDecodeCache[searchStart]->start )/mDecodeCache[searchEnd]->start;
+         guess = (searchStart+searchEnd)/2;//find a midpoint.
 
          //we want guess to point at the first index that hits even if there are duplicate start times (which can happen)
-         if(mDecodeCache[guess]->start+mDecodeCache[guess]->len >= start)
+         if(mDecoded[guess]->start+mDecoded[guess]->len >= start)
             searchEnd = --guess;
          else
             searchStart = guess;
@@ -493,68 +228,64 @@ int ODFFmpegDecoder::FillDataFromCache(samplePtr & data, sampleFormat outFormat,
    }
 
    //this is a sorted array
-   for(int i=searchStart; i < (int)mDecodeCache.size(); i++)
+   for(int i=searchStart; i < (int)mDecoded.size(); i++)
    {
+      const auto &entry = *mDecoded[i];
       //check for a cache hit - be careful to include the first/last sample an nothing more.
       //we only accept cache hits that touch either end - no piecing out of the middle.
       //this way the amount to be decoded remains set.
-      if(start < mDecodeCache[i]->start+mDecodeCache[i]->len &&
-         start + len > mDecodeCache[i]->start)
+      if(start < entry.start+entry.len &&
+         start + len > entry.start)
       {
          uint8_t* outBuf;
          outBuf = (uint8_t*)data;
          //reject buffers that would split us into two pieces because we don't have
          //a method of dealing with this yet, and it won't happen very often.
-         if(start<mDecodeCache[i]->start && start+len  > mDecodeCache[i]->start+mDecodeCache[i]->len)
+         if(start<entry.start && start+len  > entry.start+entry.len)
             continue;
 
-         auto nChannels = mDecodeCache[i]->numChannels;
+         auto nChannels = entry.numChannels;
+         //the stream lost this channel
+         if(channel >= nChannels)
+            continue;
          auto samplesHit = (
             // Proof that the result is never negative: consider four cases
             // of FFMIN and FFMAX choices, and use the if-condition enclosing.
             // The result is not more than len.
-            FFMIN(start+len,mDecodeCache[i]->start+mDecodeCache[i]->len)
-               - FFMAX(mDecodeCache[i]->start, start)
+            FFMIN(start+len,entry.start+entry.len)
+               - FFMAX(entry.start, start)
          ).as_size_t();
          //find the start of the hit relative to the cache buffer start.
-         // UNSAFE_SAMPLE_COUNT_TRUNCATION
-         // -- but used only experimentally as of this writing
-         // Is there a proof size_t will not overflow?
          const auto hitStartInCache =
-            // result is less than mDecodeCache[i]->len:
-            FFMAX(sampleCount{0},start-mDecodeCache[i]->start).as_size_t();
+            // result is less than entry.len:
+            FFMAX(sampleCount{0},start-entry.start).as_size_t();
          //we also need to find out which end was hit - if it is the tail only we need to update from a later index.
-         const auto hitStartInRequest = start < mDecodeCache[i]->start
+         const auto hitStartInRequest = start < entry.start
             ? len - samplesHit : 0;
          for(decltype(samplesHit) j = 0; j < samplesHit; j++)
          {
             const auto outIndex = hitStartInRequest + j;
             const auto inIndex = (hitStartInCache + j) * nChannels + channel;
-            switch (mDecodeCache[i]->samplefmt)
+            switch (entry.samplefmt)
             {
                case AV_SAMPLE_FMT_U8:
-                  //wxPrintf("u8 in %lu out %lu cachelen %lu outLen %lu\n", inIndex, outIndex, mDecodeCache[i]->len, len);
-                  ((int16_t *)outBuf)[outIndex] = (int16_t) (((uint8_t*)mDecodeCache[i]->samplePtr.get())[inIndex] - 0x80) << 8;
+                  ((int16_t *)outBuf)[outIndex] = (int16_t) (((uint8_t*)entry.samplePtr.get())[inIndex] - 0x80) << 8;
                break;
 
                case AV_SAMPLE_FMT_S16:
-                  //wxPrintf("u16 in %lu out %lu cachelen %lu outLen % lu\n", inIndex, outIndex, mDecodeCache[i]->len, len);
-                  ((int16_t *)outBuf)[outIndex] = ((int16_t*)mDecodeCache[i]->samplePtr.get())[inIndex];
+                  ((int16_t *)outBuf)[outIndex] = ((int16_t*)entry.samplePtr.get())[inIndex];
                break;
 
                case AV_SAMPLE_FMT_S32:
-                  //wxPrintf("s32 in %lu out %lu cachelen %lu outLen %lu\n", inIndex, outIndex, mDecodeCache[i]->len, len);
-                  ((float *)outBuf)[outIndex] = (float) ((int32_t*)mDecodeCache[i]->samplePtr.get())[inIndex] * (1.0 / (1u << 31));
+                  ((float *)outBuf)[outIndex] = (float) ((int32_t*)entry.samplePtr.get())[inIndex] * (1.0 / (1u << 31));
                break;
 
                case AV_SAMPLE_FMT_FLT:
-                  //wxPrintf("f in %lu out %lu cachelen %lu outLen %lu\n", inIndex, outIndex, mDecodeCache[i]->len, len);
-                  ((float *)outBuf)[outIndex] = (float) ((float*)mDecodeCache[i]->samplePtr.get())[inIndex];
+                  ((float *)outBuf)[outIndex] = (float) ((float*)entry.samplePtr.get())[inIndex];
                break;
 
                case AV_SAMPLE_FMT_DBL:
-                  //wxPrintf("dbl in %lu out %lu cachelen %lu outLen %lu\n", inIndex, outIndex, mDecodeCache[i]->len, len);
-                  ((float *)outBuf)[outIndex] = (float) ((double*)mDecodeCache[i]->samplePtr.get())[inIndex];
+                  ((float *)outBuf)[outIndex] = (float) ((double*)entry.samplePtr.get())[inIndex];
                break;
 
                default:
@@ -568,7 +299,7 @@ int ODFFmpegDecoder::FillDataFromCache(samplePtr & data, sampleFormat outFormat,
 
          //update the input start/len params - if the end was hit we can take off just len.
          //otherwise, we can assume only the front of the request buffer was hit since we don't allow it to be split.
-         if(start < mDecodeCache[i]->start)
+         if(start < entry.start)
             len-=samplesHit;
          else
          {
@@ -579,22 +310,438 @@ int ODFFmpegDecoder::FillDataFromCache(samplePtr & data, sampleFormat outFormat,
          }
       }
       //if we've had our fill, leave.  if we've passed the point which can have hits, leave.
-      if(len<=0 ||  mDecodeCache[i]->start > start+len)
+      if(len<=0 ||  mDecoded[i]->start > start+len)
          break;
    }
    return samplesFilled;
 }
 
+void FFmpegStreamCache::Insert(std::unique_ptr<FFMpegDecodeCache> &&cache)
+{
+   ODLocker locker{ &mMutex };
+   int searchStart = 0;
+   int searchEnd = mDecoded.size(); //size() is also a valid insert index.
+   int guess = 0;
+   while(searchStart<searchEnd)
+   {
+      guess = (searchStart+searchEnd)/2;
+      //check greater than OR equals because we want to insert infront of old dupes.
+      if(mDecoded[guess]->start>= cache->start)
+         searchEnd = guess;
+      else
+         searchStart = ++guess;
+   }
+   mNumSamplesInCache += cache->len;
+   mDecoded.insert(mDecoded.begin()+guess, std::move(cache));
+
+   //if the cache is too big, drop some.
+   while(mNumSamplesInCache>kMaxSamplesInCache)
+   {
+      int dropindex;
+      //drop which ever index is further from our newly added one.
+      dropindex = (guess > (int)mDecoded.size()/2) ? 0 : (mDecoded.size()-1);
+      mNumSamplesInCache-=mDecoded[dropindex]->len;
+      mDecoded.erase(mDecoded.begin()+dropindex);
+      if(dropindex < guess)
+         --guess;
+   }
+}
+
+bool FFmpegStreamCache::Find(int64_t ts, sampleCount &sample)
+{
+   ODLocker locker{ &mMutex };
+   const auto iter = std::lower_bound(mIndex.begin(), mIndex.end(), ts,
+      [](const Entry &entry, int64_t value){ return entry.ts < value; });
+   if(iter == mIndex.end() || iter->ts != ts)
+      return false;
+   sample = iter->sample;
+   return true;
+}
+
+bool FFmpegStreamCache::Extrapolate(int64_t ts, sampleCount &sample)
+{
+   ODLocker locker{ &mMutex };
+   if(mSamplesPerTick <= 0)
+      return false;
+   auto iter = std::upper_bound(mIndex.begin(), mIndex.end(), ts,
+      [](int64_t value, const Entry &entry){ return value < entry.ts; });
+   if(iter == mIndex.begin())
+      return false;
+   --iter;
+   sample = iter->sample + sampleCount{ 0.5 + (ts - iter->ts) * mSamplesPerTick };
+   return true;
+}
+
+bool FFmpegStreamCache::FindTimestamp(sampleCount sample, int64_t &ts)
+{
+   ODLocker locker{ &mMutex };
+   if(mIndex.empty())
+      return false;
+   //the last packet that starts at or before the sample
+   auto iter = std::upper_bound(mIndex.begin(), mIndex.end(), sample,
+      [](sampleCount value, const Entry &entry){ return value < entry.sample; });
+   if(iter != mIndex.begin())
+      --iter;
+   ts = iter->ts;
+   //beyond the packets decoded so far
+   if(mSamplesPerTick > 0 && iter + 1 == mIndex.end() && sample > iter->sample)
+      ts += (int64_t)((sample - iter->sample).as_double() / mSamplesPerTick);
+   return true;
+}
+
+void FFmpegStreamCache::Add(int64_t ts, sampleCount sample)
+{
+   ODLocker locker{ &mMutex };
+   const auto iter = std::lower_bound(mIndex.begin(), mIndex.end(), ts,
+      [](const Entry &entry, int64_t value){ return entry.ts < value; });
+   if(iter != mIndex.end() && iter->ts == ts)
+      return;
+   //keep the index small; a seek lands on the packets it has
+   if(iter != mIndex.begin() && sample - (iter - 1)->sample < kIndexSpacing)
+      return;
+   mIndex.insert(iter, Entry{ ts, sample });
+}
+
+void FFmpegStreamCache::SetSamplesPerTick(double samplesPerTick)
+{
+   ODLocker locker{ &mMutex };
+   mSamplesPerTick = samplesPerTick;
+   mOpened = true;
+}
+
+void FFmpegStreamCache::MarkSeekFailed()
+{
+   ODLocker locker{ &mMutex };
+   mSeekFailed = true;
+}
+
+bool FFmpegStreamCache::SeekFailed()
+{
+   ODLocker locker{ &mMutex };
+   return mSeekFailed;
+}
+
+bool FFmpegStreamCache::AllowsParallel()
+{
+   ODLocker locker{ &mMutex };
+   return mOpened && mSamplesPerTick > 0 && !mSeekFailed;
+}
+
+//------ ODDecodeFFmpegTask definitions
+ODDecodeFFmpegTask::ODDecodeFFmpegTask(int streamIndex)
+   : mStreamIndex(streamIndex)
+{
+   ODLocker locker{ &sContextMutex };
+   PickFFmpegLibs();
+}
+ODDecodeFFmpegTask::~ODDecodeFFmpegTask()
+{
+   // The decoders close their contexts before the libraries are unloaded
+   mDecoders.clear();
+   ODLocker locker{ &sContextMutex };
+   DropFFmpegLibs();
+}
+
+
+std::unique_ptr<ODTask> ODDecodeFFmpegTask::Clone() const
+{
+   auto clone = std::make_unique<ODDecodeFFmpegTask>(mStreamIndex);
+   clone->mDemandSample=GetDemandSample();
+   {
+      //the clone seeks by the same index, and finds what was decoded already.
+      ODLocker locker{ &mStreamCachesMutex };
+      clone->mStreamCaches = mStreamCaches;
+   }
+
+   //the decoders and blockfiles should not be copied.  They are created as the task runs.
+   // This std::move is needed to "upcast" the pointer type
+   return std::move(clone);
+}
+
+///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
+//
+//compare to FLACImportPlugin::Open(wxString filename)
+ODFileDecoder* ODDecodeFFmpegTask::CreateFileDecoder(const wxString & fileName)
+{
+   std::shared_ptr<FFmpegStreamCache> cache;
+   {
+      ODLocker locker{ &mStreamCachesMutex };
+      auto &pCache = mStreamCaches[fileName];
+      if (!pCache)
+         pCache = std::make_shared<FFmpegStreamCache>();
+      cache = pCache;
+   }
+
+   // The file is opened when the decoder is initialized
+   auto decoder =
+      std::make_unique<ODFFmpegDecoder>(fileName, mStreamIndex, cache);
+
+   mDecoders.push_back(std::move(decoder));
+   return mDecoders.back().get();
+
+}
+
+unsigned ODDecodeFFmpegTask::GetMaxDecodersPerFile()
+{
+   //until a decoder has opened the file, or if a decoder starting elsewhere
+   //could not know where it is, decode in order.
+   ODLocker locker{ &mStreamCachesMutex };
+   if (mStreamCaches.empty())
+      return 1;
+   for (const auto &pair : mStreamCaches)
+      if (!pair.second->AllowsParallel())
+         return 1;
+   return ODManager::Instance()->GetWorkerConcurrency();
+}
+
+/// subclasses need to override this if they cannot always seek.
+/// seeking will be enabled once this is true.
+bool ODFFmpegDecoder::SeekingAllowed()
+{
+   return !mCache->SeekFailed();
+}
+
+
+//------ ODDecodeFFmpegFileDecoder
+ODFFmpegDecoder::ODFFmpegDecoder(const wxString & fileName,
+   int streamIndex,
+   const std::shared_ptr<FFmpegStreamCache> &cache)
+:ODFileDecoder(fileName),
+mStreamIndex(streamIndex),
+mCache(cache),
+mFormat(floatSample),
+mSamplesPerTick(0),
+mCurrentPos(0),
+mPositionKnown(true),
+mKeepFrom(0)
+{
+}
+
+ODFFmpegDecoder::~ODFFmpegDecoder()
+{
+   Close();
+}
+
+bool ODFFmpegDecoder::ReadHeader()
+{
+   if (!Open())
+      return false;
+   MarkInitialized();
+   return true;
+}
+
+//compare to FFmpegImportFileHandle::Init and InitCodecs, which open all of the streams.
+bool ODFFmpegDecoder::Open()
+{
+   ODLocker locker{ &sContextMutex };
+
+   if (!FFmpegLibsInst()->ValidLibsLoaded())
+      return false;
+
+   std::unique_ptr<FFmpegContext> context;
+   wxString name = mFName;
+   if (ufile_fopen_input(context, name) < 0)
+      return false;
+   const auto ic = context->ic_ptr;
+
+   if (avformat_find_stream_info(ic, NULL) < 0 ||
+       mStreamIndex < 0 || mStreamIndex >= (int)ic->nb_streams)
+      return false;
+
+   auto sc = std::make_unique<streamContext>();
+   sc->m_stream = ic->streams[mStreamIndex];
+   sc->m_codecCtx = sc->m_stream->codec;
+   if (sc->m_codecCtx->codec_type != AVMEDIA_TYPE_AUDIO)
+      return false;
+
+   const AVCodec *codec = avcodec_find_decoder(sc->m_codecCtx->codec_id);
+   if (codec == NULL || avcodec_open2(sc->m_codecCtx, codec, NULL) < 0)
+      return false;
+
+   //the other streams are decoded by other tasks, with contexts of their own.
+   for (unsigned int i = 0; i < ic->nb_streams; i++)
+      if ((int)i != mStreamIndex)
+         ic->streams[i]->discard = AVDISCARD_ALL;
+
+   // as FFmpegImportFileHandle::Import chooses the format of the tracks
+   switch (sc->m_codecCtx->sample_fmt)
+   {
+      case AV_SAMPLE_FMT_U8:
+      case AV_SAMPLE_FMT_S16:
+      case AV_SAMPLE_FMT_U8P:
+      case AV_SAMPLE_FMT_S16P:
+         mFormat = int16Sample;
+      break;
+      default:
+         mFormat = floatSample;
+      break;
+   }
+   sc->m_osamplefmt = mFormat;
+   sc->m_osamplesize = SAMPLE_SIZE(mFormat);
+   sc->m_initialchannels = sc->m_codecCtx->channels;
+
+   //if the time base reciprocal is less than the sample rate, a timestamp can't
+   //accurately represent a sample, so positions are only learned by decoding.
+   const auto &timeBase = sc->m_stream->time_base;
+   const double samplesPerTick =
+      double(sc->m_codecCtx->sample_rate) * timeBase.num / timeBase.den;
+   mSamplesPerTick = (samplesPerTick > 0 && samplesPerTick <= 1.0) ? samplesPerTick : 0;
+   mCache->SetSamplesPerTick(mSamplesPerTick);
+
+   mContext = std::move(context);
+   mSc = std::move(sc);
+   mCurrentPos = 0;
+   mPositionKnown = true;
+   mKeepFrom = 0;
+   return true;
+}
+
+void ODFFmpegDecoder::Close()
+{
+   ODLocker locker{ &sContextMutex };
+   if (mSc) {
+      mSc->m_pkt.reset();
+      if (FFmpegLibsInst()->ValidLibsLoaded())
+         avcodec_close(mSc->m_codecCtx);
+   }
+   mSc.reset();
+   mContext.reset();
+}
+
+bool ODFFmpegDecoder::Reopen()
+{
+   Close();
+   return Open();
+}
+
+//we read the file from left to right, so in some cases it makes more sense not to seek and just carry on the decode if the gap is small enough.
+//this value controls this amount.  this should be a value that is much larger than the payload for a single packet, and around block file size around 1-10 secs.
+#define kDecodeSampleAllowance 400000
+int ODFFmpegDecoder::Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel)
+{
+   format = mFormat;
+
+   data.Allocate(len, format);
+   samplePtr bufStart = data.ptr();
+
+   //another channel, or another decoder, may have decoded these already.
+   //this next call takes data, start and len as reference variables and updates them to reflect the NEW area that is needed.
+   mCache->Fill(bufStart, format, start, len, channel);
+   if (len == 0)
+      return 1;
+
+   if (!mContext)
+      return -1;
+
+   //look at the position of the next sample that will be decoded and see if it is not near the samples we need.
+   if (!mPositionKnown || mCurrentPos > start || mCurrentPos + kDecodeSampleAllowance < start) {
+      const bool sought = SeekingAllowed() && SeekTo(start);
+      //otherwise decode onward, or else from the beginning again.
+      if (!sought && (!mPositionKnown || mCurrentPos > start) && !Reopen())
+         return -1;
+   }
+
+   //we decode up to the end of the blockfile
+   bool ended = false;
+   while (!mPositionKnown || mCurrentPos < start + len)
+   {
+      streamContext* sc = ReadNextFrame();
+      if (!sc) {
+         ended = true;
+         break;
+      }
+
+      // ReadNextFrame returns 1 if stream is not to be imported
+      if (sc == (streamContext*)1)
+         continue;
+
+      if (!PlacePacket()) {
+         //the seek landed where the index can't place it; don't trust seeking for this stream again.
+         mCache->MarkSeekFailed();
+         if (!Reopen())
+            return -1;
+         continue;
+      }
+
+      //decode the entire packet (unused bits get saved in cache, so as long as cache size limit is bigger than the
+      //largest packet size, we're ok.
+      while (sc->m_pktRemainingSiz > 0)
+         //Fill the cache with decoded samples
+         if (DecodeFrame(sc,false) < 0)
+            break;
+
+      // Cleanup after frame decoding
+      sc->m_pkt.reset();
+   }
+
+   // Flush the decoder if we're at the end of the stream.
+   if (ended && mPositionKnown)
+   {
+      mSc->m_pkt.create();
+      if (DecodeFrame(mSc.get(), true) == 0)
+         mSc->m_pkt.reset();
+   }
+
+   //this next call takes data, start and len as reference variables and updates them to reflect the NEW area that is needed.
+   mCache->Fill(bufStart, format, start, len, channel);
+
+   //beyond the end of the stream, whose duration the importer estimated, is silence.
+   if (len > 0)
+      ClearSamples(bufStart, format, 0, len);
+   return 1;
+}
+
+bool ODFFmpegDecoder::SeekTo(sampleCount start)
+{
+   const auto target = std::max(sampleCount{ 0 }, start - kSeekPreroll);
+   int64_t ts;
+   if (!mCache->FindTimestamp(target, ts))
+      return false;
+
+   if (av_seek_frame(mContext->ic_ptr, mStreamIndex, ts, AVSEEK_FLAG_BACKWARD) < 0)
+      return false;
+
+   avcodec_flush_buffers(mSc->m_codecCtx);
+   mSc->m_pkt.reset();
+   mPositionKnown = false;
+   //what is decoded before start may be disturbed by the flush.
+   mKeepFrom = start;
+   return true;
+}
+
+bool ODFFmpegDecoder::PlacePacket()
+{
+   const auto &pkt = *mSc->m_pkt;
+   const auto ts = pkt.pts != int64_t(AV_NOPTS_VALUE) ? pkt.pts : pkt.dts;
+   if (ts == int64_t(AV_NOPTS_VALUE))
+      //it follows the packet before, if that was placed.
+      return mPositionKnown;
+
+   sampleCount position;
+   //we need adjacent samples, so the timestamps are believed only where decoding
+   //has not already counted the samples.
+   if (mCache->Find(ts, position)) {
+      mCurrentPos = position;
+      mPositionKnown = true;
+      return true;
+   }
+   if (!mPositionKnown) {
+      if (!mCache->Extrapolate(ts, position))
+         return false;
+      mCurrentPos = position;
+      mPositionKnown = true;
+   }
+   mCache->Add(ts, mCurrentPos);
+   return true;
+}
+
 
 //these next few look highly refactorable.
 //get the right stream pointer.
 streamContext* ODFFmpegDecoder::ReadNextFrame()
 {
-   // Get pointer to array of contiguous unique_ptrs
-   auto scs = mScs->get();
-   // This reinterpret_cast to array of plain pointers is innocent
-   return import_ffmpeg_read_next_frame
-      (mContext->ic_ptr, reinterpret_cast<streamContext**>(scs), mChannels.size());
+   auto sc = mSc.get();
+   return import_ffmpeg_read_next_frame(mContext->ic_ptr, &sc, 1);
 }
 
 
@@ -606,60 +753,22 @@ int ODFFmpegDecoder::DecodeFrame(streamContext *sc, bool flushing)
       //stick it in the cache.
       //TODO- consider growing/unioning a few cache buffers like WaveCache does.
       //however we can't use wavecache as it isn't going to handle our stereo interleaved part, and isn't for samples
-      //However if other ODDecode tasks need this, we should do a NEW class for caching.
       auto cache = std::make_unique<FFMpegDecodeCache>();
       //len is number of samples per channel
-      // wxASSERT(sc->m_stream->codec->channels > 0);
-      cache->numChannels = std::max<unsigned>(0, sc->m_stream->codec->channels);
+      cache->numChannels = std::max(1, sc->m_codecCtx->channels);
 
       cache->len = (sc->m_decodedAudioSamplesValidSiz / sc->m_samplesize) / cache->numChannels;
       cache->start = mCurrentPos;
-      cache->samplePtr.reinit(sc->m_decodedAudioSamplesValidSiz);
-      cache->samplefmt = sc->m_samplefmt;
-      memcpy(cache->samplePtr.get(), sc->m_decodedAudioSamples.get(), sc->m_decodedAudioSamplesValidSiz);
-
-      InsertCache(std::move(cache));
-   }
-   return ret;
-}
-
-void ODFFmpegDecoder::InsertCache(std::unique_ptr<FFMpegDecodeCache> &&cache) {
-   int searchStart = 0;
-   int searchEnd = mDecodeCache.size(); //size() is also a valid insert index.
-   int guess = 0;
-   //first just guess that the cache is contiguous and we can just use math to figure it out like a dictionary
-   //by guessing where our hit will be.
+      cache->samplefmt = InterleavedFormat(sc->m_samplefmt);
+      mCurrentPos += cache->len;
 
-//   wxPrintf("inserting cache start %llu, mCurrentPos %llu\n", cache->start, mCurrentPos);
-   while(searchStart<searchEnd)
-   {
-      guess = (searchStart+searchEnd)/2;//searchStart+ (searchEnd-searchStart)*  ((float)cache->start - mDecodeCache[searchStart]->start )/mDecodeCache[searchEnd]->start;
-      //check greater than OR equals because we want to insert infront of old dupes.
-      if(mDecodeCache[guess]->start>= cache->start) {
-//         if(mDecodeCache[guess]->start == cache->start) {
-//            wxPrintf("dupe! start cache %llu start NEW cache %llu, mCurrentPos %llu\n",mDecodeCache[guess]->start, cache->start, mCurrentPos);
-//         }
-         searchEnd = guess;
+      if (cache->start + cache->len > mKeepFrom) {
+         cache->samplePtr.reinit(sc->m_decodedAudioSamplesValidSiz);
+         memcpy(cache->samplePtr.get(), sc->m_decodedAudioSamples.get(), sc->m_decodedAudioSamplesValidSiz);
+         mCache->Insert(std::move(cache));
       }
-      else
-         searchStart = ++guess;
-   }
-   mCurrentLen = cache->len;
-   mCurrentPos=cache->start+cache->len;
-   mDecodeCache.insert(mDecodeCache.begin()+guess, std::move(cache));
-   //      mDecodeCache.push_back(cache);
-
-   mNumSamplesInCache+=cache->len;
-
-   //if the cache is too big, drop some.
-   while(mNumSamplesInCache>kMaxSamplesInCache)
-   {
-      int dropindex;
-      //drop which ever index is further from our newly added one.
-      dropindex = (guess > (int)mDecodeCache.size()/2) ? 0 : (mDecodeCache.size()-1);
-      mNumSamplesInCache-=mDecodeCache[dropindex]->len;
-      mDecodeCache.erase(mDecodeCache.begin()+dropindex);
    }
+   return ret;
 }
 
 #endif //EXPERIMENTAL_OD_FFMPEG
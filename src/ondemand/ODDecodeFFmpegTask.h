@@ -17,41 +17,44 @@
 #ifndef __ODDECODEFFMPEGTASK__
 #define __ODDECODEFFMPEGTASK__
 
-#include <vector>
+#include <map>
 #include "ODDecodeTask.h"
 #include "ODTaskThread.h"
 
-struct FFmpegContext;
+struct FFmpegStreamCache;
 class ODFileDecoder;
 class WaveTrack;
 /// A class representing a modular task to be used with the On-Demand structures.
+///
+/// It decodes one audio stream of a file; a file with several is decoded by
+/// as many tasks, at once.  Its decoders open the file for themselves, so that
+/// several may seek and decode at once, sharing an index of packet timestamps
+/// and the samples they have decoded.
 class ODDecodeFFmpegTask final : public ODDecodeTask
 {
 public:
-   using Channels = std::vector < WaveTrack* >;
-   using Streams = std::vector < Channels >;
-
-   static Streams FromList(const std::list<TrackHolders> &channels);
-
-   /// Constructs an ODTask
-   ODDecodeFFmpegTask(const ScsPtr &scs, Streams &&channels, const std::shared_ptr<FFmpegContext> &context, int streamIndex);
+   /// Constructs an ODTask for the stream with the given index in the
+   /// AVFormatContext of the file
+   ODDecodeFFmpegTask(int streamIndex);
    virtual ~ODDecodeFFmpegTask();
 
    std::unique_ptr<ODTask> Clone() const override;
    ///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
    ODFileDecoder* CreateFileDecoder(const wxString & fileName) override;
 
+   ///As many as there are workers, each with its own context
+   unsigned GetMaxDecodersPerFile() override;
+
    ///Lets other classes know that this class handles the ffmpeg type
    ///Subclasses should override to return respective type.
    unsigned int GetODType() override {return eODFFMPEG;}
 
 protected:
-   // non-owning pointers to WaveTracks:
-   Streams mChannels;
-
-   ScsPtr mScs;
-   std::shared_ptr<FFmpegContext> mContext;
    int   mStreamIndex;
+
+   // For each file, shared by its decoders and with clones of the task
+   std::map<wxString, std::shared_ptr<FFmpegStreamCache>> mStreamCaches;
+   mutable ODLock mStreamCachesMutex;
 };
 #endif //__ODDECODEFFMPEGTASK__
 
@@ -9,6 +9,7 @@
 
 #include "../Audacity.h"
 #include "ODDecodeFlacTask.h"
+#include "ODManager.h"
 
 #include "../Prefs.h"
 #include <wx/string.h>
@@ -32,6 +33,11 @@ ODDecodeFlacTask::~ODDecodeFlacTask()
 {
 }
 
+unsigned ODDecodeFlacTask::GetMaxDecodersPerFile()
+{
+   return ODManager::Instance()->GetWorkerConcurrency();
+}
+
 
 std::unique_ptr<ODTask> ODDecodeFlacTask::Clone() const
 {
@@ -58,6 +58,10 @@ class ODDecodeFlacTask final : public ODDecodeTask
    ///Lets other classes know that this class handles flac
    ///Subclasses should override to return respective type.
    unsigned int GetODType() override { return eODFLAC; }
+
+   ///Each decoder opens the file for itself, and seeks with the seek table, so
+   ///as many may run as there are workers.
+   unsigned GetMaxDecodersPerFile() override;
 };
 
 
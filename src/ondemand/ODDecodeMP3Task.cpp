@@ -0,0 +1,342 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ODDecodeMP3Task.cpp
+
+  Audacity(R) is copyright (c) 1999-2017 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************/
+
+#include "../Audacity.h"
+#include "ODDecodeMP3Task.h"
+
+#if defined(USE_LIBMAD) && defined(EXPERIMENTAL_OD_MP3)
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include "mad.h"
+}
+
+namespace {
+
+// The most main data a Layer III frame may take from the frames before it
+const size_t MaxReservoir = 511;
+// Header, CRC and the longest side information of a frame
+const size_t MaxFrameOverhead = 4 + 2 + 32;
+// Frames decoded and discarded before the first one wanted, at least
+const size_t MinPrerollFrames = 2;
+
+const size_t ScanBufferSize = 65536;
+
+struct FrameHeader
+{
+   unsigned version; // bits of the header: 3 for MPEG 1, 2 for 2, 0 for 2.5
+   unsigned layer;
+   unsigned rate;
+   unsigned channels;
+   size_t samples;
+   size_t length;
+
+   bool SameStream(const FrameHeader &other) const
+   {
+      return version == other.version && layer == other.layer &&
+         rate == other.rate;
+   }
+};
+
+// Free format streams (no bitrate index) are not handled
+bool ParseFrameHeader(const unsigned char *h, FrameHeader &header)
+{
+   static const unsigned bitrates[5][14] = {
+      // MPEG 1, layers I, II, III
+      { 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+      { 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+      { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+      // MPEG 2 and 2.5, layer I, then layers II and III
+      { 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+      { 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+   };
+   static const unsigned rates[3] = { 44100, 48000, 32000 };
+
+   if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0)
+      return false;
+
+   header.version = (h[1] >> 3) & 3;
+   const unsigned layerBits = (h[1] >> 1) & 3;
+   const unsigned bitrateIndex = h[2] >> 4;
+   const unsigned rateIndex = (h[2] >> 2) & 3;
+   if (header.version == 1 || layerBits == 0 ||
+       bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+      return false;
+
+   header.layer = 4 - layerBits;
+   const bool mpeg1 = header.version == 3;
+   const unsigned table = mpeg1
+      ? header.layer - 1
+      : (header.layer == 1 ? 3 : 4);
+   const unsigned bitrate = bitrates[table][bitrateIndex - 1] * 1000;
+
+   header.rate = rates[rateIndex] >> (mpeg1 ? 0 : header.version == 2 ? 1 : 2);
+   header.channels = (h[3] >> 6) == 3 ? 1 : 2;
+
+   const unsigned padding = (h[2] >> 1) & 1;
+   if (header.layer == 1) {
+      header.samples = 384;
+      header.length = (12 * bitrate / header.rate + padding) * 4;
+   }
+   else {
+      header.samples = (header.layer == 3 && !mpeg1) ? 576 : 1152;
+      header.length = header.samples / 8 * bitrate / header.rate + padding;
+   }
+   return true;
+}
+
+// Reads the file forward through a buffer, so the scan does not make
+// a system call for every frame
+class ScanReader
+{
+public:
+   ScanReader(wxFile &file)
+      : mFile(file), mLength(file.Length()), mBuffer{ ScanBufferSize }
+   {}
+
+   wxFileOffset Length() const { return mLength; }
+
+   // Returns null if fewer than count bytes remain
+   const unsigned char *Get(wxFileOffset pos, size_t count)
+   {
+      if (pos + (wxFileOffset)count > mLength)
+         return nullptr;
+      if (pos < mStart || pos + (wxFileOffset)count > mStart + (wxFileOffset)mFill) {
+         mStart = pos;
+         mFile.Seek(pos);
+         auto read = mFile.Read(mBuffer.get(), ScanBufferSize);
+         mFill = read == wxInvalidOffset ? 0 : read;
+         if (mFill < count)
+            return nullptr;
+      }
+      return mBuffer.get() + (pos - mStart);
+   }
+
+private:
+   wxFile &mFile;
+   const wxFileOffset mLength;
+   ArrayOf<unsigned char> mBuffer;
+   wxFileOffset mStart{ 0 };
+   size_t mFill{ 0 };
+};
+
+// Is there a frame of the stream at pos, which the next frame follows,
+// or which ends the file if lastAllowed?
+bool IsFrameAt(ScanReader &reader, wxFileOffset pos,
+               const FrameHeader *stream, bool lastAllowed,
+               FrameHeader &header)
+{
+   auto h = reader.Get(pos, 4);
+   if (!h || !ParseFrameHeader(h, header) ||
+       (stream && !header.SameStream(*stream)))
+      return false;
+
+   const auto next = pos + (wxFileOffset)header.length;
+   if (next > reader.Length())
+      return false;
+   if (next == reader.Length())
+      return lastAllowed;
+
+   FrameHeader nextHeader;
+   h = reader.Get(next, 4);
+   return h && ParseFrameHeader(h, nextHeader) &&
+      nextHeader.SameStream(stream ? *stream : header);
+}
+
+inline float scale(mad_fixed_t sample)
+{
+   return (float) (sample / (float) (1L << MAD_F_FRACBITS));
+}
+
+}
+
+ODDecodeMP3Task::~ODDecodeMP3Task()
+{
+}
+
+std::unique_ptr<ODTask> ODDecodeMP3Task::Clone() const
+{
+   auto clone = std::make_unique<ODDecodeMP3Task>();
+   clone->mDemandSample = GetDemandSample();
+
+   //the decoders and blockfiles should not be copied.  They are created as the task runs.
+   // This std::move is needed to "upcast" the pointer type
+   return std::move(clone);
+}
+
+///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
+ODFileDecoder* ODDecodeMP3Task::CreateFileDecoder(const wxString & fileName)
+{
+   mDecoders.push_back(std::make_unique<ODMP3Decoder>(fileName));
+   return mDecoders.back().get();
+}
+
+ODMP3Decoder::ODMP3Decoder(const wxString & fileName)
+   : ODFileDecoder(fileName)
+   , mSamplesPerFrame(0)
+{
+   mSampleRate = 0;
+   mNumSamples = 0;
+   mNumChannels = 0;
+}
+
+ODMP3Decoder::~ODMP3Decoder()
+{
+}
+
+sampleCount ODMP3Decoder::GetNumSamples() const
+{
+   if (mFrameOffsets.empty())
+      return 0;
+   return sampleCount(mFrameOffsets.size() - 1) * mSamplesPerFrame;
+}
+
+bool ODMP3Decoder::ReadHeader()
+{
+   if (!mFile.Open(mFName))
+      return false;
+
+   ScanReader reader{ mFile };
+   mFrameOffsets.clear();
+
+   // Skip an ID3v2 tag; its size is stored in seven bits per byte
+   wxFileOffset pos = 0;
+   if (auto h = reader.Get(0, 10)) {
+      if (h[0] == 'I' && h[1] == 'D' && h[2] == '3')
+         pos = 10 + (h[9] | (h[8] << 7) | (h[7] << 14) | (h[6] << 21)) +
+            ((h[5] & 0x10) ? 10 : 0);
+   }
+
+   // Find the first frame; it fixes the layer and the rate of the stream
+   FrameHeader stream, header;
+   while (!IsFrameAt(reader, pos, nullptr, true, stream)) {
+      if (++pos >= reader.Length())
+         return false;
+   }
+   mSampleRate = stream.rate;
+   mNumChannels = stream.channels;
+   mSamplesPerFrame = stream.samples;
+
+   wxFileOffset end = pos;
+   while (pos < reader.Length()) {
+      auto h = reader.Get(pos, 4);
+      if (h && ParseFrameHeader(h, header) && header.SameStream(stream) &&
+          pos + (wxFileOffset)header.length <= reader.Length()) {
+         mFrameOffsets.push_back(pos);
+         pos = end = pos + header.length;
+         continue;
+      }
+
+      // Lost sync, as libmad would: look for two good frames in a row.
+      // Trailing tags end the scan here
+      do
+         ++pos;
+      while (pos < reader.Length() &&
+             !IsFrameAt(reader, pos, &stream, false, header));
+   }
+   if (mFrameOffsets.empty())
+      return false;
+   mFrameOffsets.push_back(end);
+
+   MarkInitialized();
+   return true;
+}
+
+int ODMP3Decoder::Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel)
+{
+   ODLocker locker{ &mFileLock };
+
+   data.Allocate(len, floatSample);
+   format = floatSample;
+   auto buffer = (float *)data.ptr();
+   std::fill(buffer, buffer + len, 0.0f);
+
+   if (mFrameOffsets.size() < 2)
+      return -1;
+
+   const size_t nFrames = mFrameOffsets.size() - 1;
+   const auto first = (start / mSamplesPerFrame).as_size_t();
+   if (first >= nFrames)
+      return 1;
+   const auto last = std::min(nFrames,
+      ((start + len + mSamplesPerFrame - 1) / mSamplesPerFrame).as_size_t());
+
+   // Back up far enough that the frame before the first one wanted has
+   // all of its reservoir, so the overlap it leaves is exact
+   size_t preroll = first;
+   while (preroll > 0 &&
+          (first - preroll < MinPrerollFrames ||
+           mFrameOffsets[first - 1] - mFrameOffsets[preroll] <
+              (wxFileOffset)(MaxReservoir + (first - 1 - preroll) * MaxFrameOverhead)))
+      --preroll;
+
+   const auto base = mFrameOffsets[preroll];
+   const auto bytes = (size_t)(mFrameOffsets[last] - base);
+   ArrayOf<unsigned char> input{ bytes + MAD_BUFFER_GUARD, true };
+   if (!mFile.Seek(base) ||
+       mFile.Read(input.get(), bytes) != (ssize_t)bytes)
+      return -1;
+
+   mad_stream stream;
+   mad_frame frame;
+   mad_synth synth;
+   mad_stream_init(&stream);
+   mad_frame_init(&frame);
+   mad_synth_init(&synth);
+   auto cleanup = finally([&]{
+      mad_synth_finish(&synth);
+      mad_frame_finish(&frame);
+      mad_stream_finish(&stream);
+   });
+
+   mad_stream_buffer(&stream, input.get(), bytes + MAD_BUFFER_GUARD);
+
+   const auto frameBegin = mFrameOffsets.begin() + preroll;
+   const auto frameEnd = mFrameOffsets.begin() + last;
+   while (true) {
+      if (mad_frame_decode(&frame, &stream) != 0) {
+         if (MAD_RECOVERABLE(stream.error))
+            // A frame without its reservoir is left silent
+            continue;
+         break;
+      }
+
+      // Find the frame by where it starts, in case libmad resynchronized
+      const auto offset = base + (stream.this_frame - input.get());
+      const auto iter = std::upper_bound(frameBegin, frameEnd, offset);
+      if (iter == frameBegin || *(iter - 1) != offset)
+         continue;
+      const size_t index = (iter - mFrameOffsets.begin()) - 1;
+
+      mad_synth_frame(&synth, &frame);
+      if (index < first)
+         continue;
+
+      // Copy the part of the frame that overlaps the block
+      const auto &pcm = synth.pcm;
+      const auto frameStart = sampleCount(index) * mSamplesPerFrame;
+      const auto from = std::max(frameStart, start);
+      const auto to = std::min(frameStart + pcm.length, start + len);
+      const auto source = pcm.samples[channel < pcm.channels ? channel : 0];
+      for (auto ss = from; ss < to; ++ss)
+         buffer[(ss - start).as_size_t()] =
+            scale(source[(ss - frameStart).as_size_t()]);
+
+      if (index + 1 >= last)
+         break;
+   }
+
+   return 1;
+}
+
+#endif
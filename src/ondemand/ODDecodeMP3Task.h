@@ -0,0 +1,79 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ODDecodeMP3Task.h
+
+  Audacity(R) is copyright (c) 1999-2017 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class ODDecodeMP3Task
+\brief Decodes an MP3 file into ODDecodeBlockFiles, but not immediately.
+
+libmad cannot seek, so the decoder scans the frame headers once when it
+is opened and keeps the offset of every frame.  A block is then decoded
+from the frames that cover it, starting a few frames early so that the
+bit reservoir and the overlap of the previous frame are primed.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_ODDecodeMP3Task__
+#define __AUDACITY_ODDecodeMP3Task__
+
+#include "../Experimental.h"
+
+#if defined(USE_LIBMAD) && defined(EXPERIMENTAL_OD_MP3)
+
+#include <vector>
+#include <wx/file.h>
+#include "ODDecodeTask.h"
+#include "ODTaskThread.h"
+
+/// A class representing a modular task to be used with the On-Demand structures.
+class ODDecodeMP3Task final : public ODDecodeTask
+{
+ public:
+
+   /// Constructs an ODTask
+   ODDecodeMP3Task(){}
+   virtual ~ODDecodeMP3Task();
+
+   std::unique_ptr<ODTask> Clone() const override;
+   ///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
+   ODFileDecoder* CreateFileDecoder(const wxString & fileName) override;
+
+   ///Lets other classes know that this class handles mp3
+   unsigned int GetODType() override { return eODMP3; }
+};
+
+///class to decode a particular file (one per file).  Holds the frame index built by ReadHeader().
+class ODMP3Decoder final : public ODFileDecoder
+{
+public:
+   ODMP3Decoder(const wxString & fileName);
+   virtual ~ODMP3Decoder();
+
+   ///Decodes the frames covering the samples into a float buffer.
+   int Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel) override;
+
+   ///Scans the frame headers of the file and records where each frame starts.
+   ///Returns false if the file is not a constant layer and rate MPEG audio stream.
+   bool ReadHeader() override;
+
+   unsigned GetRate() const { return mSampleRate; }
+   unsigned GetChannels() const { return mNumChannels; }
+   sampleCount GetNumSamples() const;
+
+private:
+   wxFile                   mFile;
+   ODLock                   mFileLock;//for mFile
+   //byte offsets of the frames, and the end of the last one
+   std::vector<wxFileOffset> mFrameOffsets;
+   size_t                   mSamplesPerFrame;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ODDecodeOggTask.cpp
+
+  Audacity(R) is copyright (c) 1999-2017 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************/
+
+#include "../Audacity.h"
+#include "ODDecodeOggTask.h"
+
+#if defined(USE_LIBVORBIS) && defined(EXPERIMENTAL_OD_OGG)
+
+#include <algorithm>
+#include <vorbis/vorbisfile.h>
+
+/* The number of bytes to get from the codec in each run, as in the importer */
+#define CODEC_TRANSFER_SIZE 4096u
+
+ODDecodeOggTask::~ODDecodeOggTask()
+{
+}
+
+std::unique_ptr<ODTask> ODDecodeOggTask::Clone() const
+{
+   auto clone = std::make_unique<ODDecodeOggTask>();
+   clone->mDemandSample = GetDemandSample();
+
+   //the decoders and blockfiles should not be copied.  They are created as the task runs.
+   // This std::move is needed to "upcast" the pointer type
+   return std::move(clone);
+}
+
+///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
+ODFileDecoder* ODDecodeOggTask::CreateFileDecoder(const wxString & fileName)
+{
+   mDecoders.push_back(std::make_unique<ODOggDecoder>(fileName));
+   return mDecoders.back().get();
+}
+
+ODOggDecoder::ODOggDecoder(const wxString & fileName)
+   : ODFileDecoder(fileName)
+{
+   mSampleRate = 0;
+   mNumSamples = 0;
+   mNumChannels = 0;
+}
+
+ODOggDecoder::~ODOggDecoder()
+{
+   if (mVorbisFile) {
+      ov_clear(mVorbisFile.get());
+      mHandle.Detach();    // ov_clear() closed the file already
+   }
+}
+
+bool ODOggDecoder::ReadHeader()
+{
+   // Suppress some compiler warnings about unused global variables in the library header
+   wxUnusedVar(OV_CALLBACKS_DEFAULT);
+   wxUnusedVar(OV_CALLBACKS_NOCLOSE);
+   wxUnusedVar(OV_CALLBACKS_STREAMONLY);
+   wxUnusedVar(OV_CALLBACKS_STREAMONLY_NOCLOSE);
+
+   if (!mHandle.Open(mFName, wxT("rb")))
+      return false;
+
+   auto vorbisFile = std::make_unique<OggVorbis_File>();
+   if (ov_open(mHandle.fp(), vorbisFile.get(), NULL, 0) < 0)
+      return false;
+   mVorbisFile = std::move(vorbisFile);
+
+   if (!ov_seekable(mVorbisFile.get()) || mVorbisFile->links != 1)
+      return false;
+
+   vorbis_info *vi = ov_info(mVorbisFile.get(), 0);
+   mSampleRate = vi->rate;
+   mNumChannels = vi->channels;
+   mTotalSamples = ov_pcm_total(mVorbisFile.get(), -1);
+
+   MarkInitialized();
+   return true;
+}
+
+int ODOggDecoder::Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel)
+{
+   ODLocker locker{ &mVorbisFileLock };
+
+   data.Allocate(len, int16Sample);
+   format = int16Sample;
+   auto buffer = (short *)data.ptr();
+   std::fill(buffer, buffer + len, 0);
+
+   if (!IsInitialized() || channel >= mNumChannels)
+      return -1;
+
+   if (ov_pcm_seek(mVorbisFile.get(), start.as_long_long()) != 0)
+      return -1;
+
+   int testvar = 1;
+   const int endian = *(char *)&testvar ? 0 : 1;
+
+   ArrayOf<short> mainBuffer{ CODEC_TRANSFER_SIZE };
+   size_t done = 0;
+   while (done < len) {
+      int bitstream = 0;
+      long bytesRead = ov_read(mVorbisFile.get(), (char *)mainBuffer.get(),
+         CODEC_TRANSFER_SIZE,
+         endian,
+         2,    // word length (2 for 16 bit samples)
+         1,    // signed
+         &bitstream);
+
+      if (bytesRead == OV_HOLE)
+         continue;
+      else if (bytesRead < 0)
+         return -1;
+      else if (bytesRead == 0)
+         break;
+
+      const size_t samplesRead = bytesRead / mNumChannels / sizeof(short);
+      const auto count = std::min(samplesRead, len - done);
+      for (size_t ii = 0; ii < count; ++ii)
+         buffer[done + ii] = mainBuffer[ii * mNumChannels + channel];
+      done += count;
+   }
+
+   return 1;
+}
+
+#endif
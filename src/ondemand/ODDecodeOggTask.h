@@ -0,0 +1,78 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ODDecodeOggTask.h
+
+  Audacity(R) is copyright (c) 1999-2017 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class ODDecodeOggTask
+\brief Decodes an Ogg Vorbis file into ODDecodeBlockFiles, but not immediately.
+
+Only files with a single logical bitstream are decoded this way.
+libvorbisfile finds the pages of a seekable file when it is opened, and
+seeks to a sample by bisecting them, so no index of our own is kept.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_ODDecodeOggTask__
+#define __AUDACITY_ODDecodeOggTask__
+
+#include "../Experimental.h"
+
+#if defined(USE_LIBVORBIS) && defined(EXPERIMENTAL_OD_OGG)
+
+#include <wx/ffile.h>
+#include "ODDecodeTask.h"
+#include "ODTaskThread.h"
+
+struct OggVorbis_File;
+
+/// A class representing a modular task to be used with the On-Demand structures.
+class ODDecodeOggTask final : public ODDecodeTask
+{
+ public:
+
+   /// Constructs an ODTask
+   ODDecodeOggTask(){}
+   virtual ~ODDecodeOggTask();
+
+   std::unique_ptr<ODTask> Clone() const override;
+   ///Creates an ODFileDecoder that decodes a file of filetype the subclass handles.
+   ODFileDecoder* CreateFileDecoder(const wxString & fileName) override;
+
+   ///Lets other classes know that this class handles ogg vorbis
+   unsigned int GetODType() override { return eODOGG; }
+};
+
+///class to decode a particular file (one per file).
+class ODOggDecoder final : public ODFileDecoder
+{
+public:
+   ODOggDecoder(const wxString & fileName);
+   virtual ~ODOggDecoder();
+
+   ///Seeks to the first sample and decodes one channel into a 16 bit buffer,
+   ///as the importer does.
+   int Decode(SampleBuffer & data, sampleFormat & format, sampleCount start, size_t len, unsigned int channel) override;
+
+   ///Opens the file.  Returns false unless it is a seekable stream of one link.
+   bool ReadHeader() override;
+
+   unsigned GetRate() const { return mSampleRate; }
+   unsigned GetChannels() const { return mNumChannels; }
+   sampleCount GetNumSamples() const { return mTotalSamples; }
+
+private:
+   wxFFile                         mHandle;
+   std::unique_ptr<OggVorbis_File> mVorbisFile;
+   ODLock                          mVorbisFileLock;//for mVorbisFile
+   sampleCount                     mTotalSamples;
+};
+
+#endif
+
+#endif
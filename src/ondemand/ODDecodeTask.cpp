@@ -18,10 +18,12 @@ updating the ODDecodeBlockFile and the GUI of the newly available data.
 
 #include "../Audacity.h"
 #include "ODDecodeTask.h"
+#include "ODManager.h"
 #include "../blockfile/ODDecodeBlockFile.h"
 #include "../Sequence.h"
 #include "../WaveTrack.h"
 #include <wx/wx.h>
+#include <algorithm>
 
 ///Creates a NEW task that decodes files
 ODDecodeTask::ODDecodeTask()
@@ -41,67 +43,87 @@ void ODDecodeTask::DoSomeInternal()
       return;
    }
 
-   ODFileDecoder* decoder;
-
-   for(size_t j=0; j < mWaveTracks.size() && mBlockFiles.size();j++)
-   {
-      const auto bf = mBlockFiles[0].lock();
-      sampleCount blockStartSample = 0;
-      sampleCount blockEndSample = 0;
-      bool success =false;
+   //one block for each track, as a unit of work, or as many as may be decoded at once.
+   //The first blocks are those nearest the demand, so a demanded region is decoded at once
+   //by decoders of its own, not after the blocks before it.
+   const auto maxDecoders = std::max(1u, GetMaxDecodersPerFile());
+   const size_t count = std::min(mBlockFiles.size(),
+      std::max<size_t>(mWaveTracks.size(), maxDecoders));
+
+   struct Result {
+      std::shared_ptr<ODDecodeBlockFile> bf;
+      bool success { false };
+      sampleCount blockStartSample { 0 };
+      sampleCount blockEndSample { 0 };
+   };
+   std::vector<Result> results(count);
+
+   const auto decodeOne = [&](size_t ii) {
+      auto &result = results[ii];
+      const auto bf = result.bf = mBlockFiles[ii].lock();
+      if(!bf)
+      {
+         // The block file disappeared.
+         result.success = true;
+         return;
+      }
 
       int ret = 1;
-
-      if(bf)
+      //OD TODO: somehow pass the bf a reference to the decoder that manages its file.
+      //we need to ensure that the filename won't change or be moved.  We do this by calling LockRead(),
+      //which the dirmanager::EnsureSafeFilename also does.
       {
-         //OD TODO: somehow pass the bf a reference to the decoder that manages its file.
-         //we need to ensure that the filename won't change or be moved.  We do this by calling LockRead(),
-         //which the dirmanager::EnsureSafeFilename also does.
-         {
-            auto locker = bf->LockForRead();
-            //Get the decoder.  If the file was moved, we need to create another one and init it.
-            decoder = GetOrCreateMatchingFileDecoder( &*bf );
-            if(!decoder->IsInitialized())
-               decoder->Init();
-            bf->SetODFileDecoder(decoder);
-            // Does not throw:
-            ret = bf->DoWriteBlockFile();
-         }
-
-         if(ret >= 0) {
-            success = true;
-            blockStartSample = bf->GetStart();
-            blockEndSample = blockStartSample + bf->GetLength();
-         }
+         auto locker = bf->LockForRead();
+         //Get a decoder.  If the file was moved, we need to create another one and init it.
+         const auto decoder = AcquireFileDecoder( &*bf );
+         auto cleanup = finally( [&]{ ReleaseFileDecoder( decoder ); } );
+         if(!decoder->IsInitialized())
+            decoder->Init();
+         bf->SetODFileDecoder(decoder);
+         // Does not throw:
+         ret = bf->DoWriteBlockFile();
       }
-      else
-      {
-         success = true;
-         // The block file disappeared.
-         //the waveform in the wavetrack now is shorter, so we need to update mMaxBlockFiles
-         //because now there is less work to do.
-         mMaxBlockFiles--;
+
+      if(ret >= 0) {
+         result.success = true;
+         result.blockStartSample = bf->GetStart();
+         result.blockEndSample = result.blockStartSample + bf->GetLength();
       }
+   };
+
+   //the decoders of different blocks are independent, and FLAC's seek
+   //table lets each start at its own block
+   if(count > 1 && maxDecoders > 1)
+      ODManager::Instance()->ParallelFor(count, decodeOne);
+   else
+      for(size_t ii = 0; ii < count; ii++)
+         decodeOne(ii);
 
-      if (success)
+   for(auto ii = count; ii--; )
+   {
+      const auto &result = results[ii];
+      if (result.success)
       {
          //take it out of the array - we are done with it.
-         mBlockFiles.erase(mBlockFiles.begin());
+         mBlockFiles.erase(mBlockFiles.begin() + ii);
+         if (!result.bf)
+            //the waveform in the wavetrack now is shorter, so we need to update mMaxBlockFiles
+            //because now there is less work to do.
+            mMaxBlockFiles--;
       }
       else
-         // The task does not make progress
+         // The task does not make progress with this block
          ;
 
-      //Release the refcount we placed on it if we are successful
-      if( bf && success ) {
+      if( result.bf && result.success ) {
          //upddate the gui for all associated blocks.  It doesn't matter that we're hitting more wavetracks then we should
-         //because this loop runs a number of times equal to the number of tracks, they probably are getting processed in
-         //the next iteration at the same sample window.
+         //because the blocks of the tracks are probably at the same sample window.
          mWaveTrackMutex.Lock();
          for(size_t i=0;i<mWaveTracks.size();i++)
          {
             if(mWaveTracks[i])
-               mWaveTracks[i]->AddInvalidRegion(blockStartSample,blockEndSample);
+               mWaveTracks[i]->AddInvalidRegion(
+                  result.blockStartSample, result.blockEndSample);
          }
          mWaveTrackMutex.Unlock();
       }
@@ -120,6 +142,7 @@ void ODDecodeTask::CalculatePercentComplete()
 
 bool ODDecodeTask::SeekingAllowed()
 {
+   ODLocker locker{ &mDecodersMutex };
    for (unsigned int i = 0; i < mDecoders.size(); i++) {
       if(!mDecoders[i]->SeekingAllowed())
          return false;
@@ -144,45 +167,47 @@ void ODDecodeTask::Update()
          //gather all the blockfiles that we should process in the wavetrack.
          for (const auto &clip : mWaveTracks[j]->GetAllClips()) {
             seq = clip->GetSequence();
-            //TODO:this lock is way to big since the whole file is one sequence.  find a way to break it down.
-            seq->LockDeleteUpdateMutex();
-
-            //See Sequence::Delete() for why need this for now..
-            blocks = clip->GetSequenceBlockArray();
-            int i;
-            int insertCursor;
+            const sampleCount clipOffset(
+               clip->GetStartTime()*clip->GetRate()
+            );
 
-            insertCursor =0;//OD TODO:see if this works, removed from inner loop (bfore was n*n)
-            for (i = 0; i<(int)blocks->size(); i++)
+            std::vector< std::shared_ptr< ODDecodeBlockFile > > pending;
             {
-               //since we have more than one ODDecodeBlockFile, we will need type flags to cast.
-               SeqBlock &block = (*blocks)[i];
-               const auto &file = block.f;
-               std::shared_ptr<ODDecodeBlockFile> oddbFile;
-               if (!file->IsDataAvailable() &&
-                   (oddbFile =
-                       std::static_pointer_cast<ODDecodeBlockFile>(file))->GetDecodeType() == this->GetODType())
-               {
-                  oddbFile->SetStart(block.start);
-                  oddbFile->SetClipOffset(sampleCount(
-                     clip->GetStartTime()*clip->GetRate()
-                  ));
+               //Held only while finding the blocks, not while ordering them below,
+               //so that Sequence::Delete() on the main thread waits less.
+               Sequence::DeleteUpdateMutexLocker locker(*seq);
 
-                  //these will always be linear within a sequence-lets take advantage of this by keeping a cursor.
+               //See Sequence::Delete() for why need this for now..
+               blocks = clip->GetSequenceBlockArray();
+               for (auto &block : *blocks)
+               {
+                  //since we have more than one ODDecodeBlockFile, we will need type flags to cast.
+                  const auto &file = block.f;
+                  std::shared_ptr<ODDecodeBlockFile> oddbFile;
+                  if (!file->IsDataAvailable() &&
+                      (oddbFile =
+                          std::static_pointer_cast<ODDecodeBlockFile>(file))->GetDecodeType() == this->GetODType())
                   {
-                     std::shared_ptr< ODDecodeBlockFile > ptr;
-                     while(insertCursor < (int)tempBlocks.size() &&
-                           (!(ptr = tempBlocks[insertCursor].lock()) ||
-                            ptr->GetStart() + ptr->GetClipOffset() <
-                            oddbFile->GetStart() + oddbFile->GetClipOffset()))
-                        insertCursor++;
+                     oddbFile->SetStart(block.start);
+                     oddbFile->SetClipOffset(clipOffset);
+                     pending.push_back(oddbFile);
                   }
-
-                  tempBlocks.insert(tempBlocks.begin() + insertCursor++, oddbFile);
                }
             }
 
-            seq->UnlockDeleteUpdateMutex();
+            //these will always be linear within a sequence-lets take advantage of this by keeping a cursor.
+            size_t insertCursor = 0;
+            for (const auto &oddbFile : pending)
+            {
+               std::shared_ptr< ODDecodeBlockFile > ptr;
+               while(insertCursor < tempBlocks.size() &&
+                     (!(ptr = tempBlocks[insertCursor].lock()) ||
+                      ptr->GetStart() + ptr->GetClipOffset() <
+                      oddbFile->GetStart() + oddbFile->GetClipOffset()))
+                  insertCursor++;
+
+               tempBlocks.insert(tempBlocks.begin() + insertCursor++, oddbFile);
+            }
          }
       }
    }
@@ -288,6 +313,43 @@ int ODDecodeTask::GetNumFileDecoders()
    return mDecoders.size();
 }
 
+ODFileDecoder* ODDecodeTask::AcquireFileDecoder(ODDecodeBlockFile* blockFile)
+{
+   const auto fileName = blockFile->GetAudioFileName().GetFullPath();
+
+   ODLocker locker{ &mDecodersMutex };
+   //importers may have made decoders with CreateFileDecoder
+   mDecoderBusy.resize(mDecoders.size(), 0);
+   for(size_t i=0;i<mDecoders.size();i++)
+   {
+      if(!mDecoderBusy[i] && mDecoders[i]->GetFileName()==fileName &&
+         GetODType() == blockFile->GetDecodeType() )
+      {
+         mDecoderBusy[i] = 1;
+         return mDecoders[i].get();
+      }
+   }
+
+   //all busy, or none yet.  The caller initializes it, not under the lock.
+   const auto decoder = CreateFileDecoder(fileName);
+   mDecoderBusy.resize(mDecoders.size(), 0);
+   mDecoderBusy.back() = 1;
+   return decoder;
+}
+
+void ODDecodeTask::ReleaseFileDecoder(ODFileDecoder* decoder)
+{
+   ODLocker locker{ &mDecodersMutex };
+   for(size_t i=0;i<mDecoders.size();i++)
+   {
+      if(mDecoders[i].get() == decoder)
+      {
+         mDecoderBusy[i] = 0;
+         break;
+      }
+   }
+}
+
 
 
 ///This should handle unicode converted to UTF-8 on mac/linux, but OD TODO:check on windows
@@ -71,6 +71,11 @@ class ODDecodeTask /* not final */ : public ODTask
    virtual ODFileDecoder* GetOrCreateMatchingFileDecoder(ODDecodeBlockFile* blockFile);
    virtual int GetNumFileDecoders();
 
+   ///How many decoders of one file may decode at once, each its own range of blocks, on the
+   ///workers of ODManager::ParallelFor.  1 unless the decoders of the subclass are
+   ///independent of each other and can seek.
+   virtual unsigned GetMaxDecodersPerFile() { return 1; }
+
 
 protected:
 
@@ -88,9 +93,17 @@ protected:
    void OrderBlockFiles
       (std::vector< std::weak_ptr< ODDecodeBlockFile > > &unorderedBlocks);
 
+   ///Gives the caller exclusive use of an idle decoder of the block's file, creating one if all are busy.
+   ///Thread-safe.
+   ODFileDecoder* AcquireFileDecoder(ODDecodeBlockFile* blockFile);
+   void ReleaseFileDecoder(ODFileDecoder* decoder);
+
 
    std::vector<std::weak_ptr<ODDecodeBlockFile>> mBlockFiles;
    std::vector<std::unique_ptr<ODFileDecoder>> mDecoders;
+   //parallel to mDecoders; nonzero for those acquired
+   std::vector<char> mDecoderBusy;
+   ODLock mDecodersMutex;
 
    int mMaxBlockFiles;
 
@@ -19,12 +19,15 @@ ODTask requests and internals.
 #include "ODTask.h"
 #include "ODTaskThread.h"
 #include "ODWaveTrackTaskQueue.h"
+#include "../AudioIO.h"
 #include "../Project.h"
+#include "../Prefs.h"
 #include <NonGuiThread.h>
 #include <wx/utils.h>
 #include <wx/wx.h>
 #include <wx/thread.h>
 #include <wx/event.h>
+#include <algorithm>
 
 static ODLock gODInitedMutex;
 static bool gManagerCreated=false;
@@ -32,6 +35,19 @@ static bool gPause=false; //to be loaded in and used with Pause/Resume before OD
 /// a flag that is set if we have loaded some OD blockfiles from PCM.
 static bool sHasLoadedOD=false;
 
+//how long a task thread waits between units of work while audio is streaming.
+//A unit is about one block, so this bounds the disk bandwidth taken from playback.
+static const unsigned long kThrottleMilliseconds = 100;
+
+//the most task threads to run at once, from the preferences
+static int ReadMaxThreads()
+{
+   long result = 5;
+   if (gPrefs)
+      gPrefs->Read(wxT("/OnDemand/MaxThreads"), &result, 5L);
+   return (int) std::max(1L, std::min(64L, result));
+}
+
 std::unique_ptr<ODManager> ODManager::pMan{};
 //init the accessor function pointer - use the first time version of the interface fetcher
 //first we need to typedef the function pointer type because the compiler doesn't support it in the raw
@@ -57,9 +73,11 @@ ODManager::ODManager()
    mTerminate = false;
    mTerminated = false;
    mPause = gPause;
+   mWakeup = false;
 
    //must set up the queue condition
    mQueueNotEmptyCond = std::make_unique<ODCondition>(&mQueueNotEmptyCondLock);
+   mTerminatedCond = std::make_unique<ODCondition>(&mTerminatedMutex);
 }
 
 //private destructor - DELETE with static method Quit()
@@ -69,22 +87,25 @@ ODManager::~ODManager()
    mTerminate = true;
    mTerminateMutex.Unlock();
 
-   //This while loop waits for ODTasks to finish and the DELETE removes all tasks from the Queue.
+   //wake the ODMan thread, which waits on the queue condition, and wait for it to leave its loop.
    //This function is called from the main audacity event thread, so there should not be more requests for pMan
-   mTerminatedMutex.Lock();
-   while (!mTerminated)
+   Wake();
    {
-      mTerminatedMutex.Unlock();
-      wxThread::Sleep(200);
-
-      //signal the queue not empty condition since the ODMan thread will wait on the queue condition
-      mQueueNotEmptyCondLock.Lock();
-      mQueueNotEmptyCond->Signal();
-      mQueueNotEmptyCondLock.Unlock();
+      ODLocker locker{ &mTerminatedMutex };
+      while (!mTerminated)
+         mTerminatedCond->Wait();
+   }
 
-      mTerminatedMutex.Lock();
+   //turns of tasks on the scheduler's workers use this object, so wait for them to finish
+   while (true)
+   {
+      mCurrentThreadsMutex.Lock();
+      const bool running = mCurrentThreads > 0;
+      mCurrentThreadsMutex.Unlock();
+      if (!running)
+         break;
+      wxMilliSleep(10);
    }
-   mTerminatedMutex.Unlock();
 
    //get rid of all the queues.  The queues get rid of the tasks, so we don't worry abut them.
    //nothing else should be running on OD related threads at this point, so we don't lock.
@@ -97,28 +118,20 @@ void ODManager::AddTask(ODTask* task)
    mTasksMutex.Lock();
    mTasks.push_back(task);
    mTasksMutex.Unlock();
-   //signal the queue not empty condition.
-   bool paused;
-
-   mPauseLock.Lock();
-   paused=mPause;
-   mPauseLock.Unlock();
-
-   //don't signal if we are paused since if we wake up the loop it will start processing other tasks while paused
-   if(!paused)
-      mQueueNotEmptyCond->Signal();
+   //the loop starts nothing while paused, so it is safe to wake it then.
+   Wake();
 }
 
 void ODManager::SignalTaskQueueLoop()
 {
-   bool paused;
+   Wake();
+}
 
-   mPauseLock.Lock();
-   paused=mPause;
-   mPauseLock.Unlock();
-   //don't signal if we are paused
-   if(!paused)
-      mQueueNotEmptyCond->Signal();
+void ODManager::Wake()
+{
+   ODLocker locker{ &mQueueNotEmptyCondLock };
+   mWakeup = true;
+   mQueueNotEmptyCond->Signal();
 }
 
 ///removes a task from the active task queue
@@ -211,11 +224,19 @@ bool ODManager::IsInstanceCreated()
    return ret;
 }
 
+void ODManager::Throttle()
+{
+   //mStreamToken is set before the stream starts and cleared after it stops,
+   //so this covers the priming of the playback buffers too.
+   if (gAudioIO && gAudioIO->IsBusy())
+      wxMilliSleep(kThrottleMilliseconds);
+}
+
 ///Launches a thread for the manager and starts accepting Tasks.
 void ODManager::Init()
 {
    mCurrentThreads = 0;
-   mMaxThreads = 5;
+   mMaxThreads = ReadMaxThreads();
 
    //   wxLogDebug(wxT("Initializing ODManager...Creating manager thread"));
    // This is a detached thread, so it deletes itself when it finishes
@@ -231,17 +252,96 @@ void ODManager::Init()
    //destruction of thread is taken care of by thread library
 }
 
+unsigned ODManager::GetWorkerConcurrency()
+{
+   return std::min( TaskScheduler::Get().GetConcurrency(),
+                    (unsigned) std::max( 1, mMaxThreads ) );
+}
+
+void ODManager::ParallelFor(size_t count, const TaskScheduler::Body &body)
+{
+   TaskScheduler::Get().ParallelFor(
+      TaskScheduler::Background, count, body, GetWorkerConcurrency() );
+}
+
 void ODManager::DecrementCurrentThreads()
 {
    mCurrentThreadsMutex.Lock();
    mCurrentThreads--;
    mCurrentThreadsMutex.Unlock();
+
+   //a thread is free, and its task may have completed
+   Wake();
+}
+
+void ODManager::UpdateMaxThreads()
+{
+   if(IsInstanceCreated())
+   {
+      pMan->mCurrentThreadsMutex.Lock();
+      pMan->mMaxThreads = ReadMaxThreads();
+      pMan->mCurrentThreadsMutex.Unlock();
+      pMan->Wake();
+   }
+}
+
+ODTask* ODManager::TakeBestTask()
+{
+   while (true)
+   {
+      std::vector<ODTask*> tasks;
+      {
+         ODLocker locker{ &mTasksMutex };
+         tasks = mTasks;
+      }
+      if (tasks.empty())
+         return NULL;
+
+      struct Rank {
+         bool active;
+         unsigned long long demand;
+         int number;
+         bool operator < (const Rank &other) const
+         {
+            if (active != other.active)
+               return active;
+            if (demand != other.demand)
+               return demand > other.demand;
+            return number < other.number;
+         }
+      };
+
+      ODTask* best = NULL;
+      Rank bestRank{};
+      {
+         ODLocker locker{ &AudacityProject::AllProjectDeleteMutex() };
+         AudacityProject* proj = GetActiveProject();
+         for (auto task : tasks)
+         {
+            const Rank rank{ proj && task->IsTaskAssociatedWithProject(proj),
+               task->GetDemandSerial(), task->GetTaskNumber() };
+            if (!best || rank < bestRank)
+            {
+               best = task;
+               bestRank = rank;
+            }
+         }
+      }
+
+      //take it, unless it was removed meanwhile; then rank again
+      ODLocker locker{ &mTasksMutex };
+      auto iter = std::find(mTasks.begin(), mTasks.end(), best);
+      if (iter != mTasks.end())
+      {
+         mTasks.erase(iter);
+         return best;
+      }
+   }
 }
 
 ///Main loop for managing threads and tasks.
 void ODManager::Start()
 {
-   bool tasksInArray;
    bool paused;
    int  numQueues=0;
 
@@ -262,46 +362,59 @@ void ODManager::Start()
 
       //start some threads if necessary
 
-      mTasksMutex.Lock();
-      tasksInArray = mTasks.size()>0;
-      mTasksMutex.Unlock();
-
       mPauseLock.Lock();
       paused=mPause;
       mPauseLock.Unlock();
 
-      mCurrentThreadsMutex.Lock();
-      // keep adding tasks if there is work to do, up to the limit.
-      while(!paused && tasksInArray && (mCurrentThreads < mMaxThreads))
+      // Turns of tasks are long and may wait on the disk, so they leave a
+      // worker of the scheduler to work that the user waits for
+      const int maxTasks = std::min(mMaxThreads,
+         std::max(1, (int) TaskScheduler::Get().GetConcurrency() - 2));
+
+      // keep adding tasks if there is work to do, best first, up to the limit.
+      // Only this thread adds to mCurrentThreads, so the count cannot rise
+      // between the test and the increment.
+      while(!paused)
       {
-         mCurrentThreads++;
+         mCurrentThreadsMutex.Lock();
+         const bool threadFree = mCurrentThreads < maxTasks;
          mCurrentThreadsMutex.Unlock();
+         if(!threadFree)
+            break;
 
-         mTasksMutex.Lock();
-         //detach a NEW thread.
-         // This is a detached thread, so it deletes itself when it finishes
-         // ... except on Mac where we we don't use wxThread for reasons unexplained
-         auto thread = safenew ODTaskThread(mTasks[0]);//task);
-         //thread->SetPriority(10);//default is 50.
-         thread->Create();
-         thread->Run();
-
-         mTasks.erase(mTasks.begin());
-         tasksInArray = mTasks.size()>0;
-         mTasksMutex.Unlock();
+         //ranking locks the projects, so do it holding no other lock
+         ODTask* task = TakeBestTask();
+         if(!task)
+            break;
 
          mCurrentThreadsMutex.Lock();
-      }
+         mCurrentThreads++;
+         mCurrentThreadsMutex.Unlock();
 
-      mCurrentThreadsMutex.Unlock();
-      //use a conditon variable to block here instead of a sleep.
+         task->CountDispatch();
+         // Run a turn of the task on the shared workers
+         TaskScheduler::Get().Post(TaskScheduler::Background, [this, task]{
+            // A turn that starts after the manager began to quit is skipped
+            mTerminateMutex.Lock();
+            const bool terminate = mTerminate;
+            mTerminateMutex.Unlock();
+
+            //Do at least 5 percent of the task
+            if (!terminate)
+               task->DoSome(0.05f);
+
+            //release the thread count so that the ODManager knows how many active threads are alive.
+            DecrementCurrentThreads();
+         });
+      }
 
-      // JKC: If there are no tasks ready to run, or we're paused then
-      // we wait for there to be tasks in the queue.
+      // Everything that can start has started, so wait until something
+      // changes:  each change wakes the loop, even one that came before this wait.
       {
          ODLocker locker{ &mQueueNotEmptyCondLock };
-         if( (!tasksInArray) || paused)
+         while(!mWakeup)
             mQueueNotEmptyCond->Wait();
+         mWakeup = false;
       }
 
       //if there is some ODTask running, then there will be something in the queue.  If so then redraw to show progress
@@ -328,6 +441,7 @@ void ODManager::Start()
 
    mTerminatedMutex.Lock();
    mTerminated=true;
+   mTerminatedCond->Signal();
    mTerminatedMutex.Unlock();
 
    //wxLogDebug Not thread safe.
@@ -347,7 +461,7 @@ void ODManager::Pauser::Pause(bool pause)
 
       if(!pause)
          //we should check the queue again.
-         pMan->mQueueNotEmptyCond->Signal();
+         pMan->Wake();
    }
    else
    {
@@ -551,6 +665,27 @@ float ODManager::GetOverallPercentComplete()
    return (float) total/(totalTasks>0?totalTasks:1);
 }
 
+std::vector<ODManager::TaskStatistics> ODManager::GetTaskStatistics()
+{
+   std::vector<TaskStatistics> result;
+   ODLocker locker{ &mQueuesMutex };
+   for(unsigned int i=0;i<mQueues.size();i++)
+   {
+      for(int j=0;j<mQueues[i]->GetNumTasks();j++)
+      {
+         ODTask* task = mQueues[i]->GetTask(j);
+         TaskStatistics stats;
+         stats.name = wxString::FromUTF8(task->GetTaskName());
+         stats.taskNumber = task->GetTaskNumber();
+         stats.percentComplete = task->PercentComplete();
+         stats.running = task->IsRunning();
+         stats.statistics = task->GetStatistics();
+         result.push_back(stats);
+      }
+   }
+   return result;
+}
+
 ///Get Total Number of Tasks.
 int ODManager::GetTotalNumTasks()
 {
@@ -14,6 +14,12 @@
 \brief A singleton that manages currently running Tasks on an arbitrary
 number of threads.
 
+  Its thread sleeps until something changes:  a task is added or put back
+  after doing some of its work, a task thread ends, the limit of threads
+  changes, or the tasks are paused or resumed.  Then it gives threads to the
+  ready tasks in order of rank:  first those of the active project, then
+  those of the tracks most recently demanded, then the oldest.
+
 *//*******************************************************************/
 
 #ifndef __AUDACITY_ODMANAGER__
@@ -22,6 +28,7 @@ number of threads.
 #include <vector>
 #include "ODTask.h"
 #include "ODTaskThread.h"
+#include "../TaskScheduler.h"
 #include <wx/thread.h>
 #include <wx/wx.h>
 
@@ -58,7 +65,7 @@ class ODManager final
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    void DemandTrackUpdate(WaveTrack* track, double seconds);
 
-   ///Reduces the count of current threads running.  Meant to be called when ODTaskThreads end in their own threads.  Thread-safe.
+   ///Reduces the count of current threads running, and wakes the queue loop.  Meant to be called when ODTaskThreads end in their own threads.  Thread-safe.
    void DecrementCurrentThreads();
 
    ///Adds a wavetrack, creates a queue member.
@@ -85,6 +92,14 @@ class ODManager final
 
    void RemoveTaskIfInQueue(ODTask* task);
 
+   ///Number of threads, counting the caller, that ParallelFor uses.  No more than the
+   ///maximum number of task threads.
+   unsigned GetWorkerConcurrency();
+
+   ///Calls body for each index in [0, count) on the workers of the TaskScheduler, in
+   ///its background lane, so that one task can use more than its own turn.  Thread-safe.
+   void ParallelFor(size_t count, const TaskScheduler::Body &body);
+
    ///sets a flag that is set if we have loaded some OD blockfiles from PCM.
    static void MarkLoadedODFlag();
 
@@ -97,6 +112,10 @@ class ODManager final
    ///returns whether or not the singleton instance was created yet
    static bool IsInstanceCreated();
 
+   ///Called by task threads between units of work.  While audio is playing or
+   ///recording, sleeps a while, so that the audio thread gets the disk first.
+   static void Throttle();
+
    ///fills in the status bar message for a given track
    void FillTipForWaveTrack( const WaveTrack * t, wxString &tip );
 
@@ -106,6 +125,21 @@ class ODManager final
    ///Get Total Number of Tasks.
    int GetTotalNumTasks();
 
+   ///Reads the most task threads to run at once from the preferences.  Fewer take
+   ///effect as running threads finish their turns.
+   static void UpdateMaxThreads();
+
+   struct TaskStatistics
+   {
+      wxString name;
+      int taskNumber;
+      float percentComplete;
+      bool running;
+      ODTask::Statistics statistics;
+   };
+   ///For each task in the queues, in queue order
+   std::vector<TaskStatistics> GetTaskStatistics();
+
    // RAII object for pausing and resuming..
    class Pauser
    {
@@ -136,6 +170,12 @@ class ODManager final
    ///Remove references in our array to Tasks that have been completed/Schedule NEW ones
    void UpdateQueues();
 
+   ///Removes and returns the best ranked of the ready tasks, or null if none is ready
+   ODTask* TakeBestTask();
+
+   ///Wakes the queue loop, or makes its next wait return at once if it is not waiting
+   void Wake();
+
    //instance
    static std::unique_ptr<ODManager> pMan;
 
@@ -167,10 +207,14 @@ class ODManager final
 
    volatile bool mTerminated;
    ODLock mTerminatedMutex;
+   std::unique_ptr<ODCondition> mTerminatedCond;
 
    //for the queue not empty comdition
    ODLock         mQueueNotEmptyCondLock;
    std::unique_ptr<ODCondition> mQueueNotEmptyCond;
+   //set by Wake() and cleared by the queue loop, under mQueueNotEmptyCondLock,
+   //so that no signal is lost while the loop is busy
+   bool mWakeup;
 
 #ifdef __WXMAC__
 
@@ -0,0 +1,420 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ODResampleTask.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#include "ODResampleTask.h"
+#include "../AudacityException.h"
+#include "../AudioIO.h"
+#include "../Prefs.h"
+#include "../Project.h"
+#include "../Resample.h"
+#include "../Sequence.h"
+#include "../WaveClip.h"
+#include "../WaveTrack.h"
+#include "../widgets/ProgressDialog.h"
+#include <wx/utils.h>
+#include <algorithm>
+
+namespace {
+// Samples read from a clip at a time, as in WaveClip::Resample()
+const size_t BufferSize = 65536;
+
+// So that a new demand is honored soon
+const size_t BuffersPerDoSome = 16;
+
+// Resampled samples may wait this long for the main thread; then the task
+// waits too, rather than filling memory
+const size_t MaxPendingSamples = 16 * BufferSize;
+}
+
+struct ODResampleTask::Job
+{
+   Job(WaveTrack &track, WaveClip &clip_)
+      : pTrack{ Track::Pointer<WaveTrack>(&track) }
+      , clip{ &clip_ }
+      , blocks{ *clip_.GetSequenceBlockArray() }
+      , rate{ clip_.GetRate() }
+      , start{ clip_.GetStartTime() }
+      , end{ clip_.GetEndTime() }
+   {
+      const auto sequence = clip_.GetSequence();
+      source = std::make_unique<Sequence>(*sequence, sequence->GetDirManager());
+      result = std::make_unique<Sequence>(
+         sequence->GetDirManager(), sequence->GetSampleFormat());
+   }
+
+   // Whether the clip still has the samples that the job resamples.  Every
+   // edit of the samples makes NEW block files.
+   bool Matches(const WaveClip &other) const
+   {
+      if (&other != clip || other.GetRate() != rate)
+         return false;
+      const auto &otherBlocks = other.GetSequence()->GetBlockArray();
+      return otherBlocks.size() == blocks.size() &&
+         std::equal(blocks.begin(), blocks.end(), otherBlocks.begin(),
+            [](const SeqBlock &a, const SeqBlock &b)
+               { return a.f == b.f && a.start == b.start; });
+   }
+
+   std::weak_ptr<WaveTrack> pTrack;
+   // Compared, never dereferenced
+   const WaveClip *clip;
+   // Holding the block files also keeps their addresses from being reused
+   const BlockArray blocks;
+   const int rate;
+   const double start, end;
+
+   // Used only by the task thread:
+   std::unique_ptr<Sequence> source;
+   std::unique_ptr<Resample> resample;
+   sampleCount pos{ 0 };
+   size_t lastGenerated{ 0 };
+
+   // Guarded by State::mutex:
+   std::vector<float> pending;
+   bool finished{ false };
+   bool failed{ false };
+
+   // Used only by the main thread:
+   std::unique_ptr<Sequence> result;
+};
+
+struct ODResampleTask::State
+{
+   State(AudacityProject *project_, int rate_)
+      : project{ project_ }, rate{ rate_ }
+   {}
+
+   // Compared, never dereferenced
+   AudacityProject *const project;
+   const int rate;
+   std::vector< std::weak_ptr<WaveTrack> > tracks;
+   std::vector< std::unique_ptr<Job> > jobs;
+
+   ODLock mutex;
+   // Guarded by mutex:
+   size_t pendingSamples{ 0 };
+   bool done{ false };
+   bool abandoned{ false };
+};
+
+bool ODResampleTask::IsEnabled()
+{
+   bool enabled;
+   gPrefs->Read(wxT("/Quality/ResampleInBackground"), &enabled, false);
+   return enabled;
+}
+
+ODResampleTask::ODResampleTask(const std::shared_ptr<State> &state)
+   : mState{ state }
+   , mInBuffer{ BufferSize }
+   , mOutBuffer{ BufferSize }
+   , mTotalSamples{ 0 }
+   , mSamplesDone{ 0 }
+   , mDone{ false }
+{
+}
+
+ODResampleTask::ODResampleTask(AudacityProject &project,
+                               const std::vector<WaveTrack*> &tracks,
+                               int rate)
+   : ODResampleTask{ std::make_shared<State>(&project, rate) }
+{
+   for (const auto track : tracks) {
+      AddWaveTrack(track);
+      mState->tracks.push_back(Track::Pointer<WaveTrack>(track));
+      for (const auto &clip : track->GetClips())
+         if (clip->GetRate() != rate)
+            mState->jobs.push_back(std::make_unique<Job>(*track, *clip));
+   }
+
+   for (const auto &job : mState->jobs) {
+      mOrder.push_back(job.get());
+      mTotalSamples += job->source->GetNumSamples();
+   }
+
+   AllPending().push_back(mState);
+}
+
+ODResampleTask::~ODResampleTask()
+{
+   // The samples of an unfinished task are of no use
+   ODLocker locker{ &mState->mutex };
+   if (!mState->done)
+      mState->abandoned = true;
+}
+
+std::unique_ptr<ODTask> ODResampleTask::Clone() const
+{
+   // The clone resamples nothing:  the clips stay with the original's State
+   auto clone = std::unique_ptr<ODResampleTask>{ safenew ODResampleTask{
+      std::make_shared<State>(mState->project, mState->rate) } };
+   clone->mDemandSample = GetDemandSample();
+   // This std::move is needed to "upcast" the pointer type
+   return std::move(clone);
+}
+
+void ODResampleTask::Terminate()
+{
+   //The terminate block won't allow DoSomeInternal and this method to be run async, so this is thread-safe.
+   for (const auto &job : mState->jobs) {
+      job->source.reset();
+      job->resample.reset();
+   }
+
+   ODLocker locker{ &mState->mutex };
+   mState->abandoned = true;
+}
+
+float ODResampleTask::ComputeNextWorkUntilPercentageComplete()
+{
+   if (mTotalSamples == 0)
+      return 1.0;
+
+   float nextPercent;
+   mPercentCompleteMutex.Lock();
+   nextPercent = mPercentComplete +
+      (float)(BuffersPerDoSome * BufferSize) / (mTotalSamples.as_double() + 1);
+   mPercentCompleteMutex.Unlock();
+
+   return nextPercent;
+}
+
+void ODResampleTask::CalculatePercentComplete()
+{
+   mPercentCompleteMutex.Lock();
+   // Not 1.0 until the resamplers have given all their output
+   if (mDone)
+      mPercentComplete = 1.0;
+   else
+      mPercentComplete = (float)
+         (mSamplesDone.as_double() / (mTotalSamples.as_double() + 1));
+   mPercentCompleteMutex.Unlock();
+}
+
+void ODResampleTask::Update()
+{
+   if (mOrder.empty())
+      return;
+
+   // Clips after the demand sample come first, in order of time, then the
+   // earlier ones.  The sort is stable, so the channels alternate.
+   const double demand =
+      GetDemandSample().as_double() / mOrder.front()->rate;
+   std::stable_sort(mOrder.begin(), mOrder.end(),
+      [=](const Job *a, const Job *b) {
+         const bool aBefore = a->end <= demand, bBefore = b->end <= demand;
+         if (aBefore != bBefore)
+            return bBefore;
+         return a->start < b->start;
+      });
+}
+
+void ODResampleTask::DoSomeInternal()
+{
+   auto &state = *mState;
+
+   bool anyTrack = false;
+   mWaveTrackMutex.Lock();
+   for (const auto track : mWaveTracks)
+      anyTrack = anyTrack || track;
+   mWaveTrackMutex.Unlock();
+
+   Job *job = nullptr;
+   bool wait = false;
+   {
+      ODLocker locker{ &state.mutex };
+      if (!anyTrack)
+         state.abandoned = true;
+      if (!state.abandoned) {
+         wait = state.pendingSamples >= MaxPendingSamples;
+         const auto iter = std::find_if(mOrder.begin(), mOrder.end(),
+            [](const Job *job){ return !job->finished; });
+         if (iter != mOrder.end())
+            job = *iter;
+      }
+      if (!job)
+         state.done = true;
+   }
+
+   if (!job) {
+      mPercentCompleteMutex.Lock();
+      mDone = true;
+      mPercentCompleteMutex.Unlock();
+      CalculatePercentComplete();
+      return;
+   }
+
+   if (wait) {
+      // The main thread is busy; give it time to take the samples
+      wxMilliSleep(10);
+      return;
+   }
+
+   const double factor = (double)state.rate / job->rate;
+   if (!job->resample)
+      // constant rate resampling
+      job->resample = std::make_unique<Resample>(true, factor, factor);
+
+   const auto numSamples = job->source->GetNumSamples();
+   const auto inLen = limitSampleBufferSize(BufferSize, numSamples - job->pos);
+   const bool isLast = (job->pos + inLen == numSamples);
+
+   // Get() might throw, but this is a worker thread, so stop
+   // the exceptions here!
+   const bool ok = GuardedCall<bool>( [&] {
+      return job->source->Get(
+         (samplePtr)mInBuffer.get(), floatSample, job->pos, inLen, true);
+   } );
+
+   std::pair<size_t, size_t> results{ 0, 0 };
+   if (ok)
+      results = job->resample->Process(factor, mInBuffer.get(), inLen, isLast,
+                                       mOutBuffer.get(), BufferSize);
+   const auto oldPos = job->pos;
+   job->pos += results.first;
+   job->lastGenerated = results.second;
+
+   // As in WaveClip::Resample(), the resampler may have more output after
+   // the last input
+   const bool finished =
+      !ok || !(job->pos < numSamples || job->lastGenerated > 0);
+   {
+      ODLocker locker{ &state.mutex };
+      job->pending.insert(job->pending.end(),
+         mOutBuffer.get(), mOutBuffer.get() + results.second);
+      state.pendingSamples += results.second;
+      job->finished = finished;
+      job->failed = !ok;
+   }
+
+   if (finished) {
+      job->source.reset();
+      job->resample.reset();
+   }
+
+   mPercentCompleteMutex.Lock();
+   // A failed clip counts as done; the main thread resamples it again
+   mSamplesDone += (finished ? numSamples : job->pos) - oldPos;
+   mPercentCompleteMutex.Unlock();
+
+   CalculatePercentComplete();
+}
+
+std::vector< std::shared_ptr<ODResampleTask::State> > &
+ODResampleTask::AllPending()
+{
+   // Used only by the main thread
+   static std::vector< std::shared_ptr<State> > states;
+   return states;
+}
+
+void ODResampleTask::FinishPending(AudacityProject &project)
+{
+   auto &all = AllPending();
+   for (size_t ii = 0; ii < all.size();) {
+      const auto pState = all[ii];
+      auto &state = *pState;
+      if (state.project != &project) {
+         ++ii;
+         continue;
+      }
+
+      bool done, abandoned;
+      std::vector< std::vector<float> > pending( state.jobs.size() );
+      {
+         ODLocker locker{ &state.mutex };
+         for (size_t jj = 0; jj < state.jobs.size(); ++jj)
+            pending[jj].swap(state.jobs[jj]->pending);
+         state.pendingSamples = 0;
+         done = state.done;
+         abandoned = state.abandoned;
+      }
+
+      // The block files are made here, because DirManager is not thread-safe
+      if (!abandoned)
+         abandoned = !GuardedCall<bool>( [&] {
+            for (size_t jj = 0; jj < state.jobs.size(); ++jj)
+               if (!pending[jj].empty())
+                  state.jobs[jj]->result->Append((samplePtr)pending[jj].data(),
+                     floatSample, pending[jj].size());
+            return true;
+         } );
+
+      // Deleting the tracks, or undoing, replaces them
+      const auto tracks = project.GetTracks();
+      const bool anyTrack = std::any_of(
+         state.tracks.begin(), state.tracks.end(),
+         [&](const std::weak_ptr<WaveTrack> &pTrack)
+            { return tracks->Lock(pTrack) != nullptr; });
+
+      if (abandoned || !anyTrack)
+         all.erase(all.begin() + ii);
+      else if (done && CanReplace(project)) {
+         all.erase(all.begin() + ii);
+         Replace(project, state);
+      }
+      else
+         ++ii;
+   }
+}
+
+bool ODResampleTask::CanReplace(AudacityProject &project)
+{
+   // Not while the audio thread reads the tracks, nor while a dialog or a
+   // drag might hold on to their clips
+   return !gAudioIO->IsBusy() && project.IsEnabled() && !wxWindow::GetCapture();
+}
+
+void ODResampleTask::Replace(AudacityProject &project, State &state)
+{
+   const auto tracks = project.GetTracks();
+
+   auto findJob = [&](const WaveClip &clip) -> Job * {
+      for (const auto &job : state.jobs)
+         if (job->finished && !job->failed && job->Matches(clip))
+            return job.get();
+      return nullptr;
+   };
+
+   // Clips made or edited since the task began are resampled now, as
+   // OnResample does without the task
+   bool anyEdited = false;
+   for (const auto &pTrack : state.tracks)
+      if (const auto track = tracks->Lock(pTrack))
+         for (const auto &clip : track->GetClips())
+            anyEdited = anyEdited ||
+               (clip->GetRate() != state.rate && !findJob(*clip));
+
+   std::unique_ptr<ProgressDialog> progress;
+   if (anyEdited)
+      progress = std::make_unique<ProgressDialog>(
+         _("Resample"), _("Resampling edited clips"));
+
+   const bool success = GuardedCall<bool>( [&] {
+      for (const auto &pTrack : state.tracks)
+         if (const auto track = tracks->Lock(pTrack))
+            track->Resample(state.rate, progress.get(),
+               [&](const WaveClip &clip) {
+                  const auto job = findJob(clip);
+                  return job
+                     ? std::move(job->result) : std::unique_ptr<Sequence>{};
+               });
+      return true;
+   } );
+   progress.reset();
+
+   if (success)
+      project.PushState(_("Resampled audio track(s)"), _("Resample Track"));
+   else
+      // Leave no track partly resampled
+      project.RollbackState();
+   project.RedrawProject();
+}
@@ -0,0 +1,103 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ODResampleTask.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+******************************************************************//**
+
+\class ODResampleTask
+\brief Resamples the clips of wave tracks in the background, beginning
+near the cursor, while the tracks keep playing at the old rate with
+real-time conversion; then the new samples replace the old all at once.
+
+  The task reads copies of the sequences, so the tracks may be edited
+  meanwhile.  The samples it makes pass to the main thread, where
+  FinishPending() makes block files of them, and when the task is done,
+  gives them to the tracks and pushes one undo state.  A clip edited since
+  the task began is then resampled at once, as before.  Deleting the
+  tracks, or undoing past the command, abandons the task.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_ODRESAMPLETASK__
+#define __AUDACITY_ODRESAMPLETASK__
+
+#include "ODTask.h"
+#include "../SampleFormat.h"
+
+class AudacityProject;
+class WaveTrack;
+
+class ODResampleTask final : public ODTask
+{
+ public:
+   ///Whether AudacityProject::OnResample should make these tasks
+   static bool IsEnabled();
+
+   ///Copies the sequences of the clips, so construct on the main thread.
+   ///The tracks should be one channel group.
+   ODResampleTask(AudacityProject &project,
+                  const std::vector<WaveTrack*> &tracks, int rate);
+   virtual ~ODResampleTask();
+
+   std::unique_ptr<ODTask> Clone() const override;
+
+   unsigned int GetODType() override { return eODResample; }
+
+   const char* GetTaskName() override { return "ODResampleTask"; }
+
+   const wxChar* GetTip() override { return _("Resampling in the background"); }
+
+   ///The samples belong to the original tracks, so tasks do not combine
+   ///when tracks are joined
+   bool CanMergeWith(ODTask*) override { return false; }
+
+   bool UsesCustomWorkUntilPercentage() override { return true; }
+   float ComputeNextWorkUntilPercentageComplete() override;
+
+   ///releases the copies of the sequences.
+   void Terminate() override;
+
+   ///Call on the main thread, often.  Makes block files of the samples
+   ///resampled so far, and when it is safe, replaces the samples of the
+   ///tracks of finished tasks.
+   static void FinishPending(AudacityProject &project);
+
+protected:
+   ///recalculates the percentage complete.
+   void CalculatePercentComplete() override;
+
+   ///Resamples one buffer of the clip nearest the demand sample.
+   void DoSomeInternal() override;
+
+   ///Orders the clips from the demand sample.
+   void Update() override;
+
+private:
+   struct Job;
+   struct State;
+
+   ODResampleTask(const std::shared_ptr<State> &state);
+
+   static std::vector< std::shared_ptr<State> > &AllPending();
+   static bool CanReplace(AudacityProject &project);
+   static void Replace(AudacityProject &project, State &state);
+
+   std::shared_ptr<State> mState;
+
+   // Used only by the task thread:
+   std::vector<Job*> mOrder;
+   Floats mInBuffer;
+   Floats mOutBuffer;
+   sampleCount mTotalSamples;
+
+   // Guarded by mPercentCompleteMutex:
+   sampleCount mSamplesDone;
+   bool mDone;
+};
+
+#endif
@@ -22,13 +22,19 @@ in a background thread.
 #include "ODManager.h"
 #include "../WaveTrack.h"
 #include "../Project.h"
+#include "../Profiler.h"
 #include "../UndoManager.h"
+#include <chrono>
 //temporarilly commented out till it is added to all projects
-//#include "../Profiler.h"
 
 
 DEFINE_EVENT_TYPE(EVT_ODTASK_COMPLETE)
 
+namespace {
+   //counts demands of all tasks, so that the latest has the greatest serial
+   std::atomic<unsigned long long> sDemandCounter{ 0 };
+}
+
 /// Constructs an ODTask
 ODTask::ODTask()
 : mDemandSample(0)
@@ -68,6 +74,8 @@ void ODTask::TerminateAndBlock()
 /// will do the smallest unit of work possible
 void ODTask::DoSome(float amountWork)
 {
+   // GetTaskName() returns a string literal, as the profiler requires
+   ProfileScope profileScope{ GetTaskName() };
    SetIsRunning(true);
    mBlockUntilTerminateMutex.Lock();
 
@@ -104,15 +112,22 @@ void ODTask::DoSome(float amountWork)
    mTerminateMutex.Lock();
    while(PercentComplete() < workUntil && PercentComplete() < 1.0 && !mTerminate)
    {
-      wxThread::This()->Yield();
+      wxThread::Yield();
       //release within the loop so we can cut the number of iterations short
 
+      const auto unitStart = std::chrono::steady_clock::now();
       DoSomeInternal(); //keep the terminate mutex on so we don't remo
+      mWorkNanos.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now() - unitStart ).count() );
+      ++mUnits;
       mTerminateMutex.Unlock();
       //check to see if ondemand has been called
       if(GetNeedsODUpdate() && PercentComplete() < 1.0)
          ODUpdate();
 
+      //leave the disk to playback and recording while they run.
+      //Not under the terminate mutex, so that stopping the task need not wait.
+      ODManager::Throttle();
 
       //But add the mutex lock back before we check the value again.
       mTerminateMutex.Lock();
@@ -143,12 +158,6 @@ void ODTask::DoSome(float amountWork)
    }
    else
    {
-      //for profiling, uncomment and look in audacity.app/exe's folder for AudacityProfile.txt
-      //static int tempLog =0;
-      //if(++tempLog % 5==0)
-         //END_TASK_PROFILING("On Demand Drag and Drop 5 80 mb files into audacity, 5 wavs per task");
-      //END_TASK_PROFILING("On Demand open an 80 mb wav stereo file");
-
       wxCommandEvent event( EVT_ODTASK_COMPLETE );
 
       ODLocker locker{ &AudacityProject::AllProjectDeleteMutex() };
@@ -343,6 +352,33 @@ void ODTask::DemandTrackUpdate(WaveTrack* track, double seconds)
 }
 
 
+void ODTask::MarkDemanded(const WaveTrack* track)
+{
+   bool found = false;
+   mWaveTrackMutex.Lock();
+   for(size_t i=0;i<mWaveTracks.size();i++)
+   {
+      if(track == mWaveTracks[i])
+      {
+         found = true;
+         break;
+      }
+   }
+   mWaveTrackMutex.Unlock();
+
+   if(found)
+      mDemandSerial.store( ++sDemandCounter );
+}
+
+ODTask::Statistics ODTask::GetStatistics() const
+{
+   Statistics result;
+   result.units = mUnits.load();
+   result.seconds = mWorkNanos.load() * 1e-9;
+   result.dispatches = mDispatches.load();
+   return result;
+}
+
 void ODTask::StopUsingWaveTrack(WaveTrack* track)
 {
    mWaveTrackMutex.Lock();
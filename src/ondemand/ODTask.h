@@ -28,6 +28,7 @@ in a background thread.
 #include "../Project.h"
 
 #include "../MemoryX.h"
+#include <atomic>
 #include <vector>
 #include <wx/wx.h>
 class WaveTrack;
@@ -44,7 +45,9 @@ class ODTask /* not final */
       eODFLAC     =  0x00000001,
       eODMP3      =  0x00000002,
       eODFFMPEG   =  0x00000004,
+      eODOGG      =  0x00000008,
       eODPCMSummary  = 0x00001000,
+      eODResample = 0x00002000,
       eODOTHER    =  0x10000000,
    } ODTypeEnum;
    // Constructor / Destructor
@@ -94,6 +97,26 @@ class ODTask /* not final */
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    virtual void DemandTrackUpdate(WaveTrack* track, double seconds);
 
+   ///if the track is one of this task's, ranks the task ahead of those demanded less recently.
+   ///Unlike DemandTrackUpdate, applies even to tasks that cannot seek.
+   void MarkDemanded(const WaveTrack* track);
+   ///greater for tasks demanded more recently, and 0 for those never demanded.  Thread-safe.
+   unsigned long long GetDemandSerial() const { return mDemandSerial.load(); }
+
+   ///How fast the task has gone so far.  Thread-safe.
+   struct Statistics
+   {
+      ///calls of DoSomeInternal()
+      unsigned long long units { 0 };
+      ///spent in DoSomeInternal()
+      double seconds { 0 };
+      ///times given a thread by the ODManager
+      unsigned long dispatches { 0 };
+   };
+   Statistics GetStatistics() const;
+   ///called by the ODManager when it gives the task a thread.
+   void CountDispatch() { ++mDispatches; }
+
    bool IsComplete();
 
    void TerminateAndBlock();
@@ -165,6 +188,12 @@ class ODTask /* not final */
    volatile bool mIsRunning;
    ODLock mIsRunningMutex;
 
+   std::atomic<unsigned long long> mDemandSerial{ 0 };
+   std::atomic<unsigned long long> mUnits{ 0 };
+   // In nanoseconds
+   std::atomic<long long> mWorkNanos{ 0 };
+   std::atomic<unsigned long> mDispatches{ 0 };
+
 
    private:
 
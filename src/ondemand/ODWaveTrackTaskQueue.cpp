@@ -197,6 +197,7 @@ void ODWaveTrackTaskQueue::DemandTrackUpdate(WaveTrack* track, double seconds)
       for(unsigned int i=0;i<mTasks.size();i++)
       {
          mTasks[i]->DemandTrackUpdate(track,seconds);
+         mTasks[i]->MarkDemanded(track);
       }
 
       mTracksMutex.Unlock();
@@ -33,6 +33,7 @@
 
 #include "../Prefs.h"
 #include "../AudacityApp.h"
+#include "../DirManager.h"
 #include "../Internat.h"
 #include "../ShuttleGui.h"
 #include "../widgets/ErrorDialog.h"
@@ -105,27 +106,27 @@ void DirectoriesPrefs::PopulateOrExchange(ShuttleGui & S)
    }
    S.EndStatic();
 
-#ifdef DEPRECATED_AUDIO_CACHE
-   // See http://bugzilla.audacityteam.org/show_bug.cgi?id=545.
    S.StartStatic(_("Audio cache"));
    {
-      S.TieCheckBox(_("Play and/or record using &RAM (useful for slow drives)"),
-                    wxT("/Directories/CacheBlockFiles"),
-                    false);
-
-      S.StartTwoColumn();
+      S.StartThreeColumn();
       {
-         S.TieNumericTextBox(_("Mi&nimum Free Memory (MB):"),
-                             wxT("/Directories/CacheLowMem"),
-                             16,
+         S.TieNumericTextBox(_("&Memory for reading audio files directly:"),
+                             wxT("/Directories/MappedFilesMB"),
+                             sizeof(void*) > 4 ? 512 : 64,
                              9);
+         S.AddUnits(_("MB"));
       }
-      S.EndTwoColumn();
+      S.EndThreeColumn();
+   }
+   S.EndStatic();
 
-      S.AddVariableText(_("If the available system memory falls below this value, audio will no longer\nbe cached in memory and will be written to disk."))->Wrap(600);
+   S.StartStatic(_("Project data"));
+   {
+      S.TieCheckBox(_("&Pack audio of new projects into a few large files"),
+                    wxT("/Directories/PackedBlockStore"),
+                    false);
    }
    S.EndStatic();
-#endif // DEPRECATED_AUDIO_CACHE
    S.EndScroller();
 
 }
@@ -268,6 +269,8 @@ bool DirectoriesPrefs::Commit()
    ShuttleGui S(this, eIsSavingToPrefs);
    PopulateOrExchange(S);
 
+   DirManager::UpdateMappedFileBudget();
+
    return true;
 }
 
@@ -21,6 +21,7 @@
 
 #include "../Prefs.h"
 #include "../ShuttleGui.h"
+#include "../ondemand/ODManager.h"
 
 #include "ImportExportPrefs.h"
 #include "../Internat.h"
@@ -66,6 +67,15 @@ void ImportExportPrefs::PopulateOrExchange(ShuttleGui & S)
       S.TieCheckBox(_("&Normalize all tracks in project"),
                     wxT("/AudioFiles/NormalizeOnLoad"),
                     false);
+
+      S.StartThreeColumn();
+      {
+         S.TieNumericTextBox(_("&Background tasks at once:"),
+                             wxT("/OnDemand/MaxThreads"),
+                             5,
+                             4);
+      }
+      S.EndThreeColumn();
    }
    S.EndStatic();
 
@@ -110,6 +120,8 @@ bool ImportExportPrefs::Commit()
    ShuttleGui S(this, eIsSavingToPrefs);
    PopulateOrExchange(S);
 
+   ODManager::UpdateMaxThreads();
+
    return true;
 }
 
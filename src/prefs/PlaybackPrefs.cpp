@@ -115,6 +115,21 @@ void PlaybackPrefs::PopulateOrExchange(ShuttleGui & S)
       S.EndThreeColumn();
    }
    S.EndStatic();
+
+   S.StartStatic(_("Performance"));
+   {
+      S.StartThreeColumn();
+      {
+         w = S.TieNumericTextBox(_("&Threads for filling buffers:"),
+                                 wxT("/AudioIO/FillBuffersThreads"),
+                                 0,
+                                 9);
+         /* i18n-hint: zero threads means choose according to the number of processors  */
+         S.AddUnits(_("(0 for automatic)"));
+      }
+      S.EndThreeColumn();
+   }
+   S.EndStatic();
    S.EndScroller();
 
 }
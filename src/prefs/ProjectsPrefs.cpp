@@ -72,6 +72,14 @@ void ProjectsPrefs::PopulateOrExchange(ShuttleGui & S)
       S.EndRadioButtonGroup();
    }
    S.EndStatic();
+
+   S.StartStatic(_("Project files"));
+   {
+      S.TieCheckBox(_("Save in a compact &binary format, which opens faster but only in this version"),
+                    wxT("/FileFormats/SaveBinaryProjects"),
+                    false);
+   }
+   S.EndStatic();
    S.EndScroller();
 
 }
@@ -228,6 +228,10 @@ void QualityPrefs::PopulateOrExchange(ShuttleGui & S)
                      bestDitherSetting);
       }
       S.EndMultiColumn();
+
+      S.TieCheckBox(_("Resample tracks in the bac&kground"),
+                    wxT("/Quality/ResampleInBackground"),
+                    false);
    }
    S.EndStatic();
    S.EndScroller();
@@ -256,6 +260,8 @@ bool QualityPrefs::Commit()
 
    // Tell CopySamples() to use these ditherers now
    InitDitherers();
+   // And new resamplers, these methods
+   Resample::UpdateMethods();
 
    return true;
 }
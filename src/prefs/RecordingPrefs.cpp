@@ -95,6 +95,9 @@ void RecordingPrefs::PopulateOrExchange(ShuttleGui & S)
       S.TieCheckBox(_("&Software playthrough of input"),
                     wxT("/AudioIO/SWPlaythrough"),
                     false);
+      S.TieCheckBox(_("Apply realtime effects to playthrough"),
+                    wxT("/AudioIO/PlaythroughEffects"),
+                    false);
 #if !defined(__WXMAC__)
       //S.AddUnits(wxString(wxT("     ")) + _("(uncheck when recording computer playback)"));
 #endif
@@ -25,6 +25,9 @@ Paul Licameli
 #include "../RealFFTf.h"
 
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include "../Experimental.h"
 #include "../widgets/ErrorDialog.h"
@@ -91,9 +94,7 @@ SpectrogramSettings::SpectrogramSettings(const SpectrogramSettings &other)
 
    // Do not copy these!
    , hFFT{}
-   , window{}
-   , tWindow{}
-   , dWindow{}
+   , windows{}
 {
 }
 
@@ -350,9 +351,7 @@ SpectrogramSettings::~SpectrogramSettings()
 void SpectrogramSettings::DestroyWindows()
 {
    hFFT.reset();
-   window.reset();
-   dWindow.reset();
-   tWindow.reset();
+   windows.reset();
 }
 
 
@@ -412,17 +411,35 @@ namespace
 
 void SpectrogramSettings::CacheWindows() const
 {
-   if (hFFT == NULL || window == NULL) {
+   if (hFFT == NULL || windows == NULL) {
 
       double scale;
       const auto fftLen = WindowSize() * ZeroPaddingFactor();
       const auto padding = (WindowSize() * (zeroPaddingFactor - 1)) / 2;
+      const bool reassignment = algorithm == algReassignment;
 
       hFFT = GetFFT(fftLen);
-      RecreateWindow(window, WINDOW, fftLen, padding, windowType, windowSize, scale);
-      if (algorithm == algReassignment) {
-         RecreateWindow(tWindow, TWINDOW, fftLen, padding, windowType, windowSize, scale);
-         RecreateWindow(dWindow, DWINDOW, fftLen, padding, windowType, windowSize, scale);
+
+      // Windows in use by any settings are found here, and made only if
+      // there are none
+      static std::mutex registryMutex;
+      static std::map<
+         std::tuple<size_t, size_t, int, size_t, bool>,
+         std::weak_ptr<const Windows>
+      > registry;
+      std::lock_guard<std::mutex> lock{ registryMutex };
+      auto &shared = registry[ std::make_tuple(
+         fftLen, padding, windowType, WindowSize(), reassignment) ];
+      windows = shared.lock();
+      if (!windows) {
+         auto newWindows = std::make_shared<Windows>();
+         RecreateWindow(newWindows->window, WINDOW, fftLen, padding, windowType, windowSize, scale);
+         if (reassignment) {
+            RecreateWindow(newWindows->tWindow, TWINDOW, fftLen, padding, windowType, windowSize, scale);
+            RecreateWindow(newWindows->dWindow, DWINDOW, fftLen, padding, windowType, windowSize, scale);
+         }
+         windows = newWindows;
+         shared = windows;
       }
    }
 }
@@ -157,10 +157,16 @@ public:
 
    // Variables used for computing the spectrum
    mutable HFFT           hFFT;
-   mutable Floats         window;
 
-   // Two other windows for computing reassigned spectrogram
-   mutable Floats         tWindow; // Window times time parameter
-   mutable Floats         dWindow; // Derivative of window
+   // Never changed once made, and shared by all settings that make the
+   // same windows, so that all threads may use them
+   struct Windows {
+      Floats         window;
+
+      // Two other windows for computing reassigned spectrogram
+      Floats         tWindow; // Window times time parameter
+      Floats         dWindow; // Derivative of window
+   };
+   mutable std::shared_ptr<const Windows> windows;
 };
 #endif
@@ -158,8 +158,9 @@ void PlayIndicatorOverlay::OnTimer(wxCommandEvent &event)
          playPos,
          mProject->GetScreenEndTime());
 
-      // This displays the audio time, too...
-      mProject->TP_DisplaySelection();
+      // This displays the audio time.  Only the indicator overlays move
+      // in the ruler, unless the view does, which is tested below.
+      mProject->DisplaySelectionTimes();
 
       // BG: Scroll screen if option is set
       // msmeyer: But only if not playing looped or in one-second mode
@@ -190,6 +191,17 @@ void PlayIndicatorOverlay::OnTimer(wxCommandEvent &event)
          mNewIndicatorX = viewInfo.TimeToPosition(playPos, trackPanel->GetLeftOffset());
       else
          mNewIndicatorX = -1;
+
+      // Redraw the whole ruler only when scrolled or zoomed, by this or by
+      // the PlaybackScroller, not at every tick
+      const auto endTime = mProject->GetScreenEndTime();
+      if (viewInfo.h != mLastH || endTime != mLastEndTime) {
+         mLastH = viewInfo.h;
+         mLastEndTime = endTime;
+         auto ruler = mProject->GetRulerPanel();
+         if (ruler)
+            ruler->Refresh();
+      }
    }
 
    if(mPartner)
@@ -50,6 +50,10 @@ private:
    void OnTimer(wxCommandEvent &event);
 
    std::unique_ptr<PlayIndicatorOverlayBase> mPartner;
+
+   // The view at the last tick, to tell when the ruler needs redrawing
+   double mLastH { -1.0 };
+   double mLastEndTime { -1.0 };
 };
 
 #endif
@@ -33,6 +33,7 @@ Paul Licameli split from TrackPanel.cpp
 #include "../../../images/Cursors.h"
 
 #include <wx/event.h>
+#include <tuple>
 
 // Only for definition of SonifyBeginModifyState:
 //#include "../../NoteTrack.h"
@@ -1329,6 +1330,64 @@ void SelectHandle::HandleCenterFrequencyClick
    }
 }
 
+namespace
+{
+   // Identifies the samples of the clips in a range of times
+   using ClipSignature =
+      std::vector< std::tuple< const WaveClip*, int, sampleCount, sampleCount > >;
+
+   ClipSignature SignatureOf(const WaveTrack &track, double t0, double t1)
+   {
+      ClipSignature result;
+      for (const auto &clip : track.GetClips())
+         if (clip->GetEndTime() > t0 && clip->GetStartTime() < t1)
+            result.emplace_back( clip.get(), clip->GetDirty(),
+               clip->GetStartSample(), clip->GetNumSamples() );
+      return result;
+   }
+
+   // The spectrum last made for snapping, kept while the track, its
+   // samples, the time selection and the spectrogram settings are the same,
+   // so that dragging again or snapping repeatedly needs no more analysis
+   struct SnappingSpectrum
+   {
+      std::weak_ptr<const WaveTrack> track;
+      double t0 {}, t1 {};
+      double rate {};
+      int windowType { -1 };
+      size_t windowSize { 0 };
+      ClipSignature clips;
+      SpectrumAnalyst analyst;
+   };
+
+   SnappingSpectrum &LastSnappingSpectrum()
+   {
+      static SnappingSpectrum spectrum;
+      return spectrum;
+   }
+
+   // The spectrogram display may already have analyzed the range, in
+   // windows like those wanted.  Average them, if they are there for all
+   // clips.
+   bool SnappingSpectrumFromDisplay(SpectrumAnalyst &analyst,
+      const WaveTrack &track, double t0, double t1, size_t windowSize)
+   {
+      const SpectrogramSettings &settings = track.GetSpectrogramSettings();
+      if (windowSize != settings.GetFFTLength())
+         return false;
+
+      std::vector<double> powers(settings.NBins(), 0.0);
+      size_t count = 0;
+      for (const auto &clip : track.GetClips())
+         if (clip->GetEndTime() > t0 && clip->GetStartTime() < t1 &&
+             !clip->AccumulateCachedSpectrum(settings, t0, t1, powers, count))
+            return false;
+
+      return analyst.CalculateFromPowers(
+         windowSize, track.GetRate(), powers, count);
+   }
+}
+
 void SelectHandle::StartSnappingFreqSelection
    (SpectrumAnalyst &analyst,
     const ViewInfo &viewInfo, const WaveTrack *pTrack)
@@ -1336,24 +1395,18 @@ void SelectHandle::StartSnappingFreqSelection
    static const size_t minLength = 8;
 
    const double rate = pTrack->GetRate();
+   const double t0 = viewInfo.selectedRegion.t0();
+   const double t1 = viewInfo.selectedRegion.t1();
 
-   // Grab samples, just for this track, at these times
+   // Samples, just for this track, at these times
    std::vector<float> frequencySnappingData;
-   const auto start =
-      pTrack->TimeToLongSamples(viewInfo.selectedRegion.t0());
-   const auto end =
-      pTrack->TimeToLongSamples(viewInfo.selectedRegion.t1());
+   const auto start = pTrack->TimeToLongSamples(t0);
+   const auto end = pTrack->TimeToLongSamples(t1);
    const auto length =
       std::min(frequencySnappingData.max_size(),
          limitSampleBufferSize(10485760, // as in FreqWindow.cpp
             end - start));
    const auto effectiveLength = std::max(minLength, length);
-   frequencySnappingData.resize(effectiveLength, 0.0f);
-   pTrack->Get(
-      reinterpret_cast<samplePtr>(&frequencySnappingData[0]),
-      floatSample, start, length, fillZero,
-      // Don't try to cope with exceptions, just read zeroes instead.
-      false);
 
    // Use same settings as are now used for spectrogram display,
    // except, shrink the window as needed so we get some answers
@@ -1365,11 +1418,39 @@ void SelectHandle::StartSnappingFreqSelection
       windowSize >>= 1;
    const int windowType = settings.windowType;
 
-   analyst.Calculate(
-      SpectrumAnalyst::Spectrum, windowType, windowSize, rate,
-      &frequencySnappingData[0], length);
+   auto &last = LastSnappingSpectrum();
+   auto clips = SignatureOf(*pTrack, t0, t1);
+   if (last.track.lock().get() == pTrack &&
+       last.t0 == t0 && last.t1 == t1 && last.rate == rate &&
+       last.windowType == windowType && last.windowSize == windowSize &&
+       last.clips == clips) {
+      analyst = last.analyst;
+      return;
+   }
+
+   if (!SnappingSpectrumFromDisplay(analyst, *pTrack, t0, t1, windowSize)) {
+      frequencySnappingData.resize(effectiveLength, 0.0f);
+      pTrack->Get(
+         reinterpret_cast<samplePtr>(&frequencySnappingData[0]),
+         floatSample, start, length, fillZero,
+         // Don't try to cope with exceptions, just read zeroes instead.
+         false);
+
+      analyst.Calculate(
+         SpectrumAnalyst::Spectrum, windowType, windowSize, rate,
+         &frequencySnappingData[0], length);
+
+      // We can now throw away the sample data but we keep the spectrum.
+   }
 
-   // We can now throw away the sample data but we keep the spectrum.
+   last.track = Track::Pointer<const WaveTrack>( pTrack );
+   last.t0 = t0;
+   last.t1 = t1;
+   last.rate = rate;
+   last.windowType = windowType;
+   last.windowSize = windowSize;
+   last.clips = std::move(clips);
+   last.analyst = analyst;
 }
 
 void SelectHandle::MoveSnappingFreqSelection
@@ -1442,9 +1523,8 @@ void SelectHandle::SnapCenterOnce
    const int originalBin = floor(0.5 + centerFrequency / binFrequency);
    const int limitingBin = up ? floor(0.5 + nyq / binFrequency) : 1;
 
-   // This is crude and wasteful, doing the FFT each time the command is called.
-   // It would be better to cache the data, but then invalidation of the cache would
-   // need doing in all places that change the time selection.
+   // The spectrum is remembered for the time selection, so repeating the
+   // command does not repeat the FFT
    StartSnappingFreqSelection(analyst, viewInfo, pTrack);
    double snappedFrequency = centerFrequency;
    int bin = originalBin;
@@ -23,6 +23,9 @@ Paul Licameli split from TrackPanel.cpp
 #include "../../WaveTrack.h"
 #include "../../../images/Cursors.h"
 
+#include <unordered_map>
+#include <unordered_set>
+
 TimeShiftHandle::TimeShiftHandle
 ( const std::shared_ptr<Track> &pTrack, bool gripHit )
    : mCapturedTrack{ pTrack }
@@ -154,28 +157,47 @@ namespace
             pTrack->GetStartTime(), pTrack->GetEndTime());
    }
 
+   // What state.capturedClipArray and state.trackExclusions hold, so that
+   // each test for a duplicate takes constant time, even when sync-lock
+   // captures thousands of clips
+   struct CapturedSet
+   {
+      std::unordered_set< const WaveClip * > clips;
+      // Tracks captured whole, which are not wave tracks
+      std::unordered_set< const Track * > tracks;
+      std::unordered_set< const Track * > exclusions;
+   };
+
+   void AddCaptured
+      ( ClipMoveState &state, CapturedSet &captured, Track *t, WaveClip *clip )
+   {
+      if (clip)
+         captured.clips.insert(clip);
+      else
+         captured.tracks.insert(t);
+      state.capturedClipArray.push_back( TrackClip(t, clip) );
+   }
+
+   void AddExclusion
+      ( ClipMoveState &state, CapturedSet &captured, Track *t )
+   {
+      if (captured.exclusions.insert(t).second)
+         state.trackExclusions.push_back(t);
+   }
+
    // Adds a track's clips to state.capturedClipArray within a specified time
    void AddClipsToCaptured
-      ( ClipMoveState &state, Track *t, double t0, double t1 )
+      ( ClipMoveState &state, CapturedSet &captured,
+        Track *t, double t0, double t1 )
    {
       if (t->GetKind() == Track::Wave)
       {
          for(const auto &clip: static_cast<WaveTrack*>(t)->GetClips())
          {
-            if ( ! clip->AfterClip(t0) && ! clip->BeforeClip(t1) )
-            {
-               // Avoid getting clips that were already captured
-               bool newClip = true;
-               for (unsigned int i = 0; i < state.capturedClipArray.size(); ++i) {
-                  if ( state.capturedClipArray[i].clip == clip.get() ) {
-                     newClip = false;
-                     break;
-                  }
-               }
-
-               if (newClip)
-                  state.capturedClipArray.push_back( TrackClip(t, clip.get()) );
-            }
+            if ( ! clip->AfterClip(t0) && ! clip->BeforeClip(t1) &&
+                 // Avoid getting clips that were already captured
+                 ! captured.clips.count( clip.get() ) )
+               AddCaptured( state, captured, t, clip.get() );
          }
       }
       else
@@ -184,15 +206,7 @@ namespace
          // treat individual labels like clips
 
          // Avoid adding a track twice
-         bool newClip = true;
-         for ( unsigned int i = 0; i < state.capturedClipArray.size(); ++i ) {
-            if ( state.capturedClipArray[i].track == t ) {
-               newClip = false;
-               break;
-            }
-         }
-
-         if (newClip) {
+         if ( ! captured.tracks.count( t ) ) {
    #ifdef USE_MIDI
             // do not add NoteTrack if the data is outside of time bounds
             if (t->GetKind() == Track::Note) {
@@ -200,7 +214,7 @@ namespace
                   return;
             }
    #endif
-            state.capturedClipArray.push_back(TrackClip(t, NULL));
+            AddCaptured( state, captured, t, NULL );
          }
       }
    }
@@ -208,14 +222,15 @@ namespace
    // Helper for the above, adds a track's clips to mCapturedClipArray (eliminates
    // duplication of this logic)
    void AddClipsToCaptured
-      ( ClipMoveState &state, const ViewInfo &viewInfo,
+      ( ClipMoveState &state, CapturedSet &captured, const ViewInfo &viewInfo,
         Track *t, bool withinSelection )
    {
       if (withinSelection)
-         AddClipsToCaptured( state, t, viewInfo.selectedRegion.t0(),
+         AddClipsToCaptured( state, captured, t, viewInfo.selectedRegion.t0(),
                             viewInfo.selectedRegion.t1() );
       else
-         AddClipsToCaptured( state, t, t->GetStartTime(), t->GetEndTime() );
+         AddClipsToCaptured( state, captured, t,
+            t->GetStartTime(), t->GetEndTime() );
    }
 
    // Don't count right channels.
@@ -270,6 +285,9 @@ void TimeShiftHandle::CreateListOfCapturedClips
    // of all clips that have to move, also...
 
    state.capturedClipArray.clear();
+   CapturedSet captured;
+   for (auto t : state.trackExclusions)
+      captured.exclusions.insert(t);
 
    // First, if click was in selection, capture selected clips; otherwise
    // just the clicked-on clip
@@ -277,15 +295,14 @@ void TimeShiftHandle::CreateListOfCapturedClips
       TrackListIterator iter( &trackList );
       for (Track *t = iter.First(); t; t = iter.Next()) {
          if (t->GetSelected()) {
-            AddClipsToCaptured( state, viewInfo, t, true );
+            AddClipsToCaptured( state, captured, viewInfo, t, true );
             if (t->GetKind() != Track::Wave)
-               state.trackExclusions.push_back(t);
+               AddExclusion( state, captured, t );
          }
       }
    }
    else {
-      state.capturedClipArray.push_back
-         (TrackClip( &capturedTrack, state.capturedClip ));
+      AddCaptured( state, captured, &capturedTrack, state.capturedClip );
 
       // Check for stereo partner
       Track *partner = capturedTrack.GetLink();
@@ -296,7 +313,7 @@ void TimeShiftHandle::CreateListOfCapturedClips
          WaveClip *const clip = FindClipAtTime(wt, clickTime);
 
          if (clip)
-            state.capturedClipArray.push_back(TrackClip(partner, clip));
+            AddCaptured( state, captured, partner, clip );
       }
    }
 
@@ -317,11 +334,11 @@ void TimeShiftHandle::CreateListOfCapturedClips
             for (Track *t = git.StartWith( state.capturedClipArray[i].track  );
                   t; t = git.Next() )
             {
-               AddClipsToCaptured(state, t,
+               AddClipsToCaptured(state, captured, t,
                      state.capturedClipArray[i].clip->GetStartTime(),
                      state.capturedClipArray[i].clip->GetEndTime() );
                if (t->GetKind() != Track::Wave)
-                  state.trackExclusions.push_back(t);
+                  AddExclusion( state, captured, t );
             }
          }
 #ifdef USE_MIDI
@@ -333,9 +350,9 @@ void TimeShiftHandle::CreateListOfCapturedClips
             for (Track *t = git.StartWith(nt); t; t = git.Next())
             {
                AddClipsToCaptured
-                  ( state, t, nt->GetStartTime(), nt->GetEndTime() );
+                  ( state, captured, t, nt->GetStartTime(), nt->GetEndTime() );
                if (t->GetKind() != Track::Wave)
-                  state.trackExclusions.push_back(t);
+                  AddExclusion( state, captured, t );
             }
          }
 #endif
@@ -357,22 +374,31 @@ void TimeShiftHandle::DoSlideHorizontal
       double safeBigDistance = 1000 + 2.0 * ( trackList.GetEndTime() -
                                               trackList.GetStartTime() );
 
+      // CanOffsetClip() looks only at the clips of one track, so only the
+      // captured clips of the same track need to get out of the way, and
+      // not all of them, for each of them
+      std::unordered_map< const Track *, std::vector< WaveClip * > >
+         clipsOfTrack;
+      for ( const auto &trackClip : state.capturedClipArray )
+         if ( trackClip.clip )
+            clipsOfTrack[ trackClip.track ].push_back( trackClip.clip );
+
       do { // loop to compute allowed, does not actually move anything yet
          initialAllowed = state.hSlideAmount;
 
-         unsigned int i, j;
+         unsigned int i;
          for ( i = 0; i < state.capturedClipArray.size(); ++i ) {
             WaveTrack *track = (WaveTrack *)state.capturedClipArray[i].track;
             WaveClip *clip = state. capturedClipArray[i].clip;
 
             if (clip) { // only audio clips are used to compute allowed
+               const auto &sameTrack = clipsOfTrack[ track ];
                // Move all other selected clips totally out of the way
                // temporarily because they're all moving together and
                // we want to find out if OTHER clips are in the way,
                // not one of the moving ones
-               for ( j = 0; j < state.capturedClipArray.size(); j++ ) {
-                  WaveClip *clip2 = state.capturedClipArray[j].clip;
-                  if (clip2 && clip2 != clip)
+               for ( auto clip2 : sameTrack ) {
+                  if (clip2 != clip)
                      clip2->Offset(-safeBigDistance);
                }
 
@@ -387,9 +413,8 @@ void TimeShiftHandle::DoSlideHorizontal
                   state.snapLeft = state.snapRight = -1; // see bug 1067
                }
 
-               for ( j = 0; j < state.capturedClipArray.size(); ++j ) {
-                  WaveClip *clip2 = state.capturedClipArray[j].clip;
-                  if (clip2 && clip2 != clip)
+               for ( auto clip2 : sameTrack ) {
+                  if (clip2 != clip)
                      clip2->Offset(safeBigDistance);
                }
             }
@@ -436,6 +461,7 @@ UIHandle::Result TimeShiftHandle::Click
 
    mClipMoveState.clear();
    mDidSlideVertically = false;
+   mHaveLastDesiredSlide = false;
 
    ToolsToolBar *const ttb = pProject->GetToolsToolBar();
    const bool multiToolModeActive = (ttb && ttb->IsDown(multiTool));
@@ -536,37 +562,11 @@ UIHandle::Result TimeShiftHandle::Drag
    // GM: DoSlide now implementing snap-to
    // samples functionality based on sample rate.
 
-   // Start by undoing the current slide amount; everything
-   // happens relative to the original horizontal position of
-   // each clip...
-#ifdef USE_MIDI
-   if (mClipMoveState.capturedClipArray.size())
-#else
-   if (mClipMoveState.capturedClip)
-#endif
-   {
-      for (unsigned ii = 0; ii < mClipMoveState.capturedClipArray.size(); ++ii) {
-         if (mClipMoveState.capturedClipArray[ii].clip)
-            mClipMoveState.capturedClipArray[ii].clip->Offset
-               ( -mClipMoveState.hSlideAmount );
-         else
-            mClipMoveState.capturedClipArray[ii].track->Offset
-               ( -mClipMoveState.hSlideAmount );
-      }
-   }
-   else {
-      // Was a shift-click
-      mCapturedTrack->Offset( -mClipMoveState.hSlideAmount );
-      Track *const link = mCapturedTrack->GetLink();
-      if (link)
-         link->Offset( -mClipMoveState.hSlideAmount );
-   }
-
-   if ( mClipMoveState.capturedClipIsSelection ) {
-      // Slide the selection, too
-      viewInfo.selectedRegion.move( -mClipMoveState.hSlideAmount );
-   }
-   mClipMoveState.hSlideAmount = 0.0;
+   // Everything happens relative to the original horizontal position of
+   // each clip, which is where it is now, less the current slide amount
+   const double oldSlideAmount = mClipMoveState.hSlideAmount;
+   const auto oldSnapLeft = mClipMoveState.snapLeft;
+   const auto oldSnapRight = mClipMoveState.snapRight;
 
    double desiredSlideAmount;
    if (mSlideUpDownOnly) {
@@ -591,13 +591,15 @@ UIHandle::Result TimeShiftHandle::Drag
          trySnap = true;
          if (mClipMoveState.capturedClip) {
             clipLeft = mClipMoveState.capturedClip->GetStartTime()
-               + desiredSlideAmount;
+               - oldSlideAmount + desiredSlideAmount;
             clipRight = mClipMoveState.capturedClip->GetEndTime()
-               + desiredSlideAmount;
+               - oldSlideAmount + desiredSlideAmount;
          }
          else {
-            clipLeft = mCapturedTrack->GetStartTime() + desiredSlideAmount;
-            clipRight = mCapturedTrack->GetEndTime() + desiredSlideAmount;
+            clipLeft = mCapturedTrack->GetStartTime()
+               - oldSlideAmount + desiredSlideAmount;
+            clipRight = mCapturedTrack->GetEndTime()
+               - oldSlideAmount + desiredSlideAmount;
          }
       }
 #else
@@ -610,9 +612,9 @@ UIHandle::Result TimeShiftHandle::Drag
             desiredSlideAmount = rint(desiredSlideAmount * rate) / rate;
             if (mSnapManager && mClipMoveState.capturedClip) {
                clipLeft = mClipMoveState.capturedClip->GetStartTime()
-                  + desiredSlideAmount;
+                  - oldSlideAmount + desiredSlideAmount;
                clipRight = mClipMoveState.capturedClip->GetEndTime()
-                 + desiredSlideAmount;
+                  - oldSlideAmount + desiredSlideAmount;
             }
          }
       }
@@ -653,15 +655,58 @@ UIHandle::Result TimeShiftHandle::Drag
       }
    }
 
+   const bool wantsVerticalSlide =
+      mClipMoveState.capturedClip &&
+      pTrack != mCapturedTrack &&
+      pTrack->GetKind() == Track::Wave;
+
+   // Many motion events change nothing, as when the pointer moves by less
+   // than a sample, or is held against a neighboring clip.  Then skip the
+   // moves of all the captured clips, and the repaint.
+   if (mHaveLastDesiredSlide && !wantsVerticalSlide &&
+       desiredSlideAmount == mLastDesiredSlide &&
+       mClipMoveState.snapLeft == oldSnapLeft &&
+       mClipMoveState.snapRight == oldSnapRight)
+      return RefreshNone;
+   mHaveLastDesiredSlide = false;
+
+   // Start by undoing the current slide amount
+#ifdef USE_MIDI
+   if (mClipMoveState.capturedClipArray.size())
+#else
+   if (mClipMoveState.capturedClip)
+#endif
+   {
+      for (unsigned ii = 0; ii < mClipMoveState.capturedClipArray.size(); ++ii) {
+         if (mClipMoveState.capturedClipArray[ii].clip)
+            mClipMoveState.capturedClipArray[ii].clip->Offset
+               ( -mClipMoveState.hSlideAmount );
+         else
+            mClipMoveState.capturedClipArray[ii].track->Offset
+               ( -mClipMoveState.hSlideAmount );
+      }
+   }
+   else {
+      // Was a shift-click
+      mCapturedTrack->Offset( -mClipMoveState.hSlideAmount );
+      Track *const link = mCapturedTrack->GetLink();
+      if (link)
+         link->Offset( -mClipMoveState.hSlideAmount );
+   }
+
+   if ( mClipMoveState.capturedClipIsSelection ) {
+      // Slide the selection, too
+      viewInfo.selectedRegion.move( -mClipMoveState.hSlideAmount );
+   }
+   mClipMoveState.hSlideAmount = 0.0;
+
    // Scroll during vertical drag.
    // EnsureVisible(pTrack); //vvv Gale says this has problems on Linux, per bug 393 thread. Revert for 2.0.2.
    bool slidVertically = false;
 
    // If the mouse is over a track that isn't the captured track,
    // decide which tracks the captured clips should go to.
-   if (mClipMoveState.capturedClip &&
-       pTrack != mCapturedTrack &&
-       pTrack->GetKind() == Track::Wave
+   if (wantsVerticalSlide
        /* && !mCapturedClipIsSelection*/)
    {
       const int diff =
@@ -803,6 +848,13 @@ UIHandle::Result TimeShiftHandle::Drag
       slidVertically = true;
    }
 
+   if (!slidVertically) {
+      // Measured from the same origin as next time, if the pointer does not
+      // go to another track
+      mHaveLastDesiredSlide = true;
+      mLastDesiredSlide = desiredSlideAmount;
+   }
+
    if (desiredSlideAmount == 0.0)
       return RefreshAll;
 
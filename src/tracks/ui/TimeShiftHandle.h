@@ -110,6 +110,11 @@ private:
 
    int mMouseClickX{};
 
+   // The slide last asked of DoSlideHorizontal(), before it limited it,
+   // while the pointer stayed over the same track
+   bool mHaveLastDesiredSlide{};
+   double mLastDesiredSlide{};
+
    // Handles snapping the selection boundaries or track boundaries to
    // line up with existing tracks or labels.  mSnapLeft and mSnapRight
    // are the horizontal index of pixels to display user feedback
@@ -58,6 +58,13 @@
 
 #include <math.h>
 
+// SSE2 is part of every x86-64 processor, so no run time test is needed
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define METER_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "../AudioIO.h"
 #include "../AColor.h"
 #include "../ImageManipulation.h"
@@ -109,13 +116,12 @@ wxString MeterUpdateMsg::toStringIfClipped()
 // The MeterPanel passes itself messages via this queue so that it can
 // communicate between the audio thread and the GUI thread.
 // This class is as simple as possible in order to be thread-safe
-// without needing mutexes.
+// without needing mutexes:  each index is written by one side only.
 //
 
 MeterUpdateQueue::MeterUpdateQueue(size_t maxLen):
    mBufferSize(maxLen)
 {
-   Clear();
 }
 
 // destructor
@@ -123,29 +129,31 @@ MeterUpdateQueue::~MeterUpdateQueue()
 {
 }
 
+// Drop all messages.  Only the consumer moves mStart, so this does not
+// race with Put().
 void MeterUpdateQueue::Clear()
 {
-   mStart = 0;
-   mEnd = 0;
+   mStart.store(mEnd.load(std::memory_order_acquire),
+      std::memory_order_release);
 }
 
 // Add a message to the end of the queue.  Return false if the
 // queue was full.
 bool MeterUpdateQueue::Put(MeterUpdateMsg &msg)
 {
-   // mStart can be greater than mEnd because it is all mod mBufferSize
-   wxASSERT( (mEnd + mBufferSize - mStart) >= 0 );
-   int len = (mEnd + mBufferSize - mStart) % mBufferSize;
+   const auto end = mEnd.load(std::memory_order_relaxed);
+   const auto next = (end + 1) % mBufferSize;
 
    // Never completely fill the queue, because then the
    // state is ambiguous (mStart==mEnd)
-   if (len + 1 >= (int)(mBufferSize))
+   if (next == mStart.load(std::memory_order_acquire))
       return false;
 
    //wxLogDebug(wxT("Put: %s"), msg.toString());
 
-   mBuffer[mEnd] = msg;
-   mEnd = (mEnd+1)%mBufferSize;
+   mBuffer[end] = msg;
+   // Publish the message only after it is written
+   mEnd.store(next, std::memory_order_release);
 
    return true;
 }
@@ -154,13 +162,14 @@ bool MeterUpdateQueue::Put(MeterUpdateMsg &msg)
 // Return false if the queue was empty.
 bool MeterUpdateQueue::Get(MeterUpdateMsg &msg)
 {
-   int len = (mEnd + mBufferSize - mStart) % mBufferSize;
+   const auto start = mStart.load(std::memory_order_relaxed);
 
-   if (len == 0)
+   if (start == mEnd.load(std::memory_order_acquire))
       return false;
 
-   msg = mBuffer[mStart];
-   mStart = (mStart+1)%mBufferSize;
+   msg = mBuffer[start];
+   // Let the slot be reused only after it is read
+   mStart.store((start + 1) % mBufferSize, std::memory_order_release);
 
    return true;
 }
@@ -841,7 +850,7 @@ void MeterPanel::Reset(double sampleRate, bool resetClipping)
 
    mLayoutValid = false;
 
-   mTimer.Start(1000 / mMeterRefreshRate);
+   StartTimer();
 
    Refresh(false);
 }
@@ -883,25 +892,73 @@ static float ToDB(float v, float range)
    return ClipZeroToOne((db + range) / range);
 }
 
+namespace {
+
+// Finds the peak and the sum of squares of each of the first num channels of
+// interleaved samples.  When the channels divide the vector width, each lane
+// of the vectors always holds the same channel, so that the samples need no
+// shuffling.
+void MeterPeaks(const float *sampleData, unsigned numChannels, unsigned num,
+                int numFrames, float *peak, float *sumSquares)
+{
+   const auto total = size_t(numFrames) * numChannels;
+   size_t done = 0;
+#if defined(METER_SSE2)
+   if (numChannels > 0 && 4 % numChannels == 0) {
+      const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+      __m128 vPeak = _mm_setzero_ps();
+      __m128 vSum = _mm_setzero_ps();
+      for (; done + 4 <= total; done += 4) {
+         const __m128 x = _mm_loadu_ps(sampleData + done);
+         vPeak = _mm_max_ps(vPeak, _mm_and_ps(x, absMask));
+         vSum = _mm_add_ps(vSum, _mm_mul_ps(x, x));
+      }
+      float lanePeak[4], laneSum[4];
+      _mm_storeu_ps(lanePeak, vPeak);
+      _mm_storeu_ps(laneSum, vSum);
+      for (unsigned l = 0; l < 4; ++l) {
+         const auto j = l % numChannels;
+         if (j < num) {
+            peak[j] = floatMax(peak[j], lanePeak[l]);
+            sumSquares[j] += laneSum[l];
+         }
+      }
+   }
+#endif
+   // done is a multiple of numChannels, so the rest begins a frame
+   for (auto sptr = sampleData + done; done < total; done += numChannels) {
+      for (unsigned j = 0; j < num; ++j) {
+         peak[j] = floatMax(peak[j], fabs(sptr[j]));
+         sumSquares[j] += sptr[j] * sptr[j];
+      }
+      sptr += numChannels;
+   }
+}
+
+}
+
 void MeterPanel::UpdateDisplay(unsigned numChannels, int numFrames, float *sampleData)
 {
-   float *sptr = sampleData;
    auto num = std::min(numChannels, mNumBars);
    MeterUpdateMsg msg;
 
    memset(&msg, 0, sizeof(msg));
    msg.numFrames = numFrames;
 
-   for(int i=0; i<numFrames; i++) {
-      for(unsigned int j=0; j<num; j++) {
-         msg.peak[j] = floatMax(msg.peak[j], fabs(sptr[j]));
-         msg.rms[j] += sptr[j]*sptr[j];
+   MeterPeaks(sampleData, numChannels, num, numFrames, msg.peak, msg.rms);
+
+   for(unsigned int j=0; j<num; j++) {
+      // Only a channel that reached full scale can have peaked samples
+      if (msg.peak[j] < MAX_AUDIO)
+         continue;
 
+      const float *sptr = sampleData + j;
+      for(int i=0; i<numFrames; i++) {
          // In addition to looking for mNumPeakSamplesToClip peaked
          // samples in a row, also send the number of peaked samples
          // at the head and tail, in case there's a run of peaked samples
          // that crosses block boundaries
-         if (fabs(sptr[j])>=MAX_AUDIO) {
+         if (fabs(*sptr)>=MAX_AUDIO) {
             if (msg.headPeakCount[j]==i)
                msg.headPeakCount[j]++;
             msg.tailPeakCount[j]++;
@@ -910,8 +967,8 @@ void MeterPanel::UpdateDisplay(unsigned numChannels, int numFrames, float *sampl
          }
          else
             msg.tailPeakCount[j] = 0;
+         sptr += numChannels;
       }
-      sptr += numChannels;
    }
    for(unsigned int j=0; j<mNumBars; j++)
       msg.rms[j] = sqrt(msg.rms[j]/numFrames);
@@ -964,7 +1021,19 @@ void MeterPanel::UpdateDisplay(unsigned numChannels, int numFrames, float *sampl
 //   mQueue.Put(msg);
 //}
 
+void MeterPanel::StartTimer()
+{
+   if (mDesiredStyle != MixerTrackCluster)
+      mTimer.Start(1000 / mMeterRefreshRate);
+}
+
 void MeterPanel::OnMeterUpdate(wxTimerEvent & WXUNUSED(event))
+{
+   if (ConsumeUpdates())
+      RepaintBarsNow();
+}
+
+bool MeterPanel::ConsumeUpdates()
 {
    MeterUpdateMsg msg;
    int numChanges = 0;
@@ -976,7 +1045,7 @@ void MeterPanel::OnMeterUpdate(wxTimerEvent & WXUNUSED(event))
    // We shouldn't receive any events if the meter is disabled, but clear it to be safe
    if (mMeterDisabled) {
       mQueue.Clear();
-      return;
+      return false;
    }
 
    // There may have been several update messages since the last
@@ -1056,8 +1125,8 @@ void MeterPanel::OnMeterUpdate(wxTimerEvent & WXUNUSED(event))
             putchar('\n');
          }
       #endif
-      RepaintBarsNow();
    }
+   return numChanges > 0;
 }
 
 float MeterPanel::GetMaxPeak() const
@@ -1810,7 +1879,7 @@ void MeterPanel::OnAudioIOStatus(wxCommandEvent &evt)
    mActive = (evt.GetInt() != 0) && (p == mProject);
 
    if( mActive ){
-      mTimer.Start(1000 / mMeterRefreshRate);
+      StartTimer();
       if (evt.GetEventType() == EVT_AUDIOIO_MONITOR)
          mMonitoring = mActive;
    } else {
@@ -1841,7 +1910,7 @@ void MeterPanel::RestoreState(const State &state)
    //wxLogDebug("Restore state for %p, is %i", this, mActive );
 
    if (mActive)
-      mTimer.Start(1000 / mMeterRefreshRate);
+      StartTimer();
 }
 
 //
@@ -16,6 +16,7 @@
 #ifndef __AUDACITY_METER__
 #define __AUDACITY_METER__
 
+#include <atomic>
 #include <wx/defs.h>
 #include <wx/timer.h>
 
@@ -69,21 +70,25 @@ class MeterUpdateMsg
    wxString toStringIfClipped();
 };
 
-// Thread-safe queue of update messages
+// Thread-safe queue of update messages, for one producer (the audio
+// callback) and one consumer (the GUI thread)
 class MeterUpdateQueue
 {
  public:
    explicit MeterUpdateQueue(size_t maxLen);
    ~MeterUpdateQueue();
 
+   // Producer only
    bool Put(MeterUpdateMsg &msg);
+   // Consumer only
    bool Get(MeterUpdateMsg &msg);
-
    void Clear();
 
  private:
-   int              mStart;
-   int              mEnd;
+   // Written only by the consumer
+   std::atomic<size_t> mStart{ 0 };
+   // Written only by the producer
+   std::atomic<size_t> mEnd{ 0 };
    size_t           mBufferSize;
    ArrayOf<MeterUpdateMsg> mBuffer{mBufferSize};
 };
@@ -181,6 +186,11 @@ class MeterPanel final : public wxPanelWrapper
 
    bool IsClipping() const;
 
+   /// Applies the updates queued since the last call, returning whether
+   /// there were any.  MixerTrackCluster meters have no timer of their
+   /// own; MixerBoard calls this for all of them together, then repaints.
+   bool ConsumeUpdates();
+
    void StartMonitoring();
    void StopMonitoring();
 
@@ -215,6 +225,7 @@ class MeterPanel final : public wxPanelWrapper
    void OnAudioIOStatus(wxCommandEvent &evt);
 
    void OnMeterUpdate(wxTimerEvent &evt);
+   void StartTimer();
 
    void HandleLayout(wxDC &dc);
    void SetActiveStyle(Style style);
@@ -1448,6 +1448,27 @@ bool NumericTextCtrl::Layout()
       memDC.DrawText(mFields[i].label,
                      mFields[i].labelX, labelTop);
 
+   // The characters that digits show, as OnPaint() would draw them
+   mGlyphChars = wxT("0123456789-");
+   mGlyphsBitmap = std::make_unique<wxBitmap>(
+      mDigitBoxW * mGlyphChars.length(), mDigitBoxH);
+   {
+      wxMemoryDC glyphDC;
+      glyphDC.SelectObject(*mGlyphsBitmap);
+      theTheme.SetBrushColour( Brush, clrTimeBack );
+      glyphDC.SetBrush(Brush);
+      glyphDC.SetPen(*wxTRANSPARENT_PEN);
+      glyphDC.DrawRectangle(0, 0, mDigitBoxW * mGlyphChars.length(), mDigitBoxH);
+      glyphDC.SetBrush( wxNullBrush );
+      glyphDC.SetFont(*mDigitFont);
+      glyphDC.SetTextForeground(theTheme.Colour( clrTimeFont ));
+      glyphDC.SetTextBackground(theTheme.Colour( clrTimeBack ));
+      for (i = 0; i < mGlyphChars.length(); i++)
+         glyphDC.DrawText(mGlyphChars.Mid(i, 1),
+                          i * mDigitBoxW + (mDigitBoxW - mDigitW)/2,
+                          (mDigitBoxH - mDigitH)/2);
+   }
+
    if (mMenuEnabled) {
       wxRect r(mWidth, 0, mButtonWidth - 1, mHeight - 1);
       AColor::Bevel(memDC, true, r);
@@ -1502,16 +1523,30 @@ void NumericTextCtrl::OnPaint(wxPaintEvent & WXUNUSED(event))
    theTheme.SetBrushColour( Brush , clrTimeBackFocus );
    dc.SetBrush( Brush );
 
+   wxMemoryDC glyphDC;
+   glyphDC.SelectObject(*mGlyphsBitmap);
+   const wxRegion &update = GetUpdateRegion();
+
    int i;
    for(i = 0; i < (int)mDigits.size(); i++) {
       wxRect box = mDigits[i].digitBox;
-      if (focused && mFocusedDigit == i) {
+      // Often only the digits that changed need painting
+      if (update.Contains(box) == wxOutRegion)
+         continue;
+      int pos = mDigits[i].pos;
+      wxString digit = mValueString.Mid(pos, 1);
+      const bool focusedDigit = focused && mFocusedDigit == i;
+      const int glyph = focusedDigit ? wxNOT_FOUND : mGlyphChars.Find(digit);
+      if (glyph != wxNOT_FOUND) {
+         dc.Blit(box.x, box.y, mDigitBoxW, mDigitBoxH,
+                 &glyphDC, glyph * mDigitBoxW, 0);
+         continue;
+      }
+      if (focusedDigit) {
          dc.DrawRectangle(box);
          dc.SetTextForeground(theTheme.Colour( clrTimeFontFocus ));
          dc.SetTextBackground(theTheme.Colour( clrTimeBackFocus ));
       }
-      int pos = mDigits[i].pos;
-      wxString digit = mValueString.Mid(pos, 1);
       int x = box.x + (mDigitBoxW - mDigitW)/2;
       int y = box.y + (mDigitBoxH - mDigitH)/2;
       dc.DrawText(digit, x, y);
@@ -1874,8 +1909,18 @@ void NumericTextCtrl::ValueToControls()
       // significant amount of CPU. Typically, when a track is
       // playing, only one of the NumericTextCtrl actually changes
       // (the audio position). We save CPU by updating the control
-      // only when needed.
-      Refresh(false);
+      // only when needed, and only the digits that changed.
+      if (mValueString.length() != previousValueString.length())
+         Refresh(false);
+      else {
+         wxRect changed;
+         for (const auto &digit : mDigits)
+            if (digit.pos < (int)mValueString.length() &&
+                mValueString[digit.pos] != previousValueString[digit.pos])
+               changed.Union(digit.digitBox);
+         if (!changed.IsEmpty())
+            RefreshRect(changed, false);
+      }
    }
 }
 
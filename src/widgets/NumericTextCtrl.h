@@ -241,6 +241,10 @@ private:
    bool           mReadOnly;
 
    std::unique_ptr<wxBitmap> mBackgroundBitmap;
+   // Each of mGlyphChars drawn unfocused in a digit box, side by side, so
+   // that painting copies them instead of drawing text
+   std::unique_ptr<wxBitmap> mGlyphsBitmap;
+   wxString       mGlyphChars;
 
    std::unique_ptr<wxFont> mDigitFont, mLabelFont;
    int            mDigitBoxW;
@@ -310,6 +310,7 @@ void Ruler::SetFonts(const wxFont &minorFont, const wxFont &majorFont, const wxF
 
    // Won't override these fonts
    mUserFonts = true;
+   ForgetLabelExtents();
 
    Invalidate();
 }
@@ -768,7 +769,7 @@ wxString Ruler::LabelString(double d, bool major)
 void Ruler::Tick(int pos, double d, bool major, bool minor)
 {
    wxString l;
-   wxCoord strW, strH, strD, strL;
+   wxCoord strW, strH;
    int strPos, strLen, strLeft, strTop;
 
    // FIXME: We don't draw a tick if off end of our label arrays
@@ -794,12 +795,11 @@ void Ruler::Tick(int pos, double d, bool major, bool minor)
    label->ly = mTop - 1000;  // don't display
    label->text = wxT("");
 
-   mDC->SetFont(major? *mMajorFont: minor? *mMinorFont : *mMinorMinorFont);
    // Bug 521.  dB view for waveforms needs a 2-sided scale.
    if(( mDbMirrorValue > 1.0 ) && ( -d > mDbMirrorValue ))
       d = -2*mDbMirrorValue - d;
    l = LabelString(d, major);
-   mDC->GetTextExtent(l, &strW, &strH, &strD, &strL);
+   GetLabelExtent(l, major, minor, &strW, &strH);
 
    if (mOrientation == wxHORIZONTAL) {
       strLen = strW;
@@ -876,6 +876,31 @@ void Ruler::Tick(int pos, double d, bool major, bool minor)
 
 }
 
+void Ruler::GetLabelExtent(const wxString &text, bool major, bool minor,
+   wxCoord *width, wxCoord *height)
+{
+   // Labels repeat from one update to the next, as the view scrolls
+   auto &extents = mLabelExtents[major ? 0 : minor ? 1 : 2];
+   auto iter = extents.find(text);
+   if (iter == extents.end()) {
+      // Don't let the cache grow without limit while zooming about
+      if (extents.size() >= 1000)
+         extents.clear();
+      wxCoord strW, strH, strD, strL;
+      mDC->SetFont(major? *mMajorFont: minor? *mMinorFont : *mMinorMinorFont);
+      mDC->GetTextExtent(text, &strW, &strH, &strD, &strL);
+      iter = extents.emplace(text, Extent{ strW, strH }).first;
+   }
+   *width = iter->second.width;
+   *height = iter->second.height;
+}
+
+void Ruler::ForgetLabelExtents()
+{
+   for (auto &extents : mLabelExtents)
+      extents.clear();
+}
+
 void Ruler::TickCustom(int labelIdx, bool major, bool minor)
 {
    //This should only used in the mCustom case
@@ -884,7 +909,7 @@ void Ruler::TickCustom(int labelIdx, bool major, bool minor)
 
    int pos;
    wxString l;
-   wxCoord strW, strH, strD, strL;
+   wxCoord strW, strH;
    int strPos, strLen, strLeft, strTop;
 
    // FIXME: We don't draw a tick if of end of our label arrays
@@ -908,9 +933,7 @@ void Ruler::TickCustom(int labelIdx, bool major, bool minor)
    label->lx = mLeft - 1000; // don't display
    label->ly = mTop - 1000;  // don't display
 
-   mDC->SetFont(major? *mMajorFont: minor? *mMinorFont : *mMinorMinorFont);
-
-   mDC->GetTextExtent(l, &strW, &strH, &strD, &strL);
+   GetLabelExtent(l, major, minor, &strW, &strH);
 
    if (mOrientation == wxHORIZONTAL) {
       strLen = strW;
@@ -1009,7 +1032,6 @@ void Ruler::Update(const TimeTrack* timetrack)// Envelope *speedEnv, long minSpe
    int j;
 
    if (!mUserFonts) {
-      int fontSize = 4;
       wxCoord strW, strH, strD, strL;
       wxString exampleText = wxT("0.9");   //ignored for height calcs on all platforms
       int desiredPixelHeight;
@@ -1033,24 +1055,35 @@ void Ruler::Update(const TimeTrack* timetrack)// Envelope *speedEnv, long minSpe
          std::max(MinPixelHeight, std::min(MaxPixelHeight,
             desiredPixelHeight));
 
-      // Keep making the font bigger until it's too big, then subtract one.
-      mDC->SetFont(wxFont(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_BOLD));
-      mDC->GetTextExtent(exampleText, &strW, &strH, &strD, &strL);
-      while ((strH - strD - strL) <= desiredPixelHeight && fontSize < 40) {
-         fontSize++;
+      // The fitting is the same each time for the same height, as when
+      // only the range changes while scrolling or playing
+      if (desiredPixelHeight != mFittedPixelHeight) {
+         int fontSize = 4;
+
+         // Keep making the font bigger until it's too big, then subtract one.
          mDC->SetFont(wxFont(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_BOLD));
          mDC->GetTextExtent(exampleText, &strW, &strH, &strD, &strL);
-      }
-      fontSize--;
-      mDC->SetFont(wxFont(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL));
-      mDC->GetTextExtent(exampleText, &strW, &strH, &strD, &strL);
-      mLead = strL;
+         while ((strH - strD - strL) <= desiredPixelHeight && fontSize < 40) {
+            fontSize++;
+            mDC->SetFont(wxFont(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_BOLD));
+            mDC->GetTextExtent(exampleText, &strW, &strH, &strD, &strL);
+         }
+         fontSize--;
+         mDC->SetFont(wxFont(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL));
+         mDC->GetTextExtent(exampleText, &strW, &strH, &strD, &strL);
+
+         mFittedPixelHeight = desiredPixelHeight;
+         mFittedLead = strL;
 
-      mMajorFont = std::make_unique<wxFont>(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_BOLD);
+         mMajorFont = std::make_unique<wxFont>(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_BOLD);
 
-      mMinorFont = std::make_unique<wxFont>(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
+         mMinorFont = std::make_unique<wxFont>(fontSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
 
-      mMinorMinorFont = std::make_unique<wxFont>(fontSize - 1, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
+         mMinorMinorFont = std::make_unique<wxFont>(fontSize - 1, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
+
+         ForgetLabelExtents();
+      }
+      mLead = mFittedLead;
    }
 
    // If ruler is being resized, we could end up with it being too small.
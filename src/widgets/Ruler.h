@@ -19,6 +19,7 @@
 #include <wx/event.h>
 #include <wx/font.h>
 #include <wx/window.h>
+#include <unordered_map>
 #include "../Experimental.h"
 
 class ViewInfo;
@@ -163,6 +164,12 @@ class AUDACITY_DLL_API Ruler {
 
    void Tick(int pos, double d, bool major, bool minor);
 
+   // Measures a label in the font for its kind of tick, remembering the
+   // sizes of strings already seen in that font
+   void GetLabelExtent(const wxString &text, bool major, bool minor,
+      wxCoord *width, wxCoord *height);
+   void ForgetLabelExtents();
+
    // Another tick generator for custom ruler case (noauto) .
    void TickCustom(int labelIdx, bool major, bool minor);
 
@@ -184,6 +191,15 @@ private:
    std::unique_ptr<wxFont> mMinorFont, mMajorFont, mMinorMinorFont;
    bool         mUserFonts;
 
+   // The automatic font size found for a pixel height, and its leading,
+   // which cost many measurements to find
+   int          mFittedPixelHeight { -1 };
+   int          mFittedLead { 0 };
+
+   // For the major, minor and minor minor fonts
+   struct Extent { wxCoord width, height; };
+   std::unordered_map< wxString, Extent > mLabelExtents[3];
+
    double       mMin, mMax;
    double       mHiddenMin, mHiddenMax;
 
@@ -0,0 +1,727 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BinaryXMLFile.cpp
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+*******************************************************************//**
+
+\class BinaryXMLWriter
+\brief An XMLWriter that makes a compact binary file, which loads much
+faster than XML.
+
+*//****************************************************************//**
+
+\class BinaryXMLFileReader
+\brief Reads a file written by BinaryXMLWriter and passes the results
+through an XMLTagHandler.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "BinaryXMLFile.h"
+
+#include <algorithm>
+#include <deque>
+#include <string.h>
+#include <wx/ffile.h>
+#include <wx/intl.h>
+
+#include "../InconsistencyException.h"
+#include "../Internat.h"
+#include "XMLFileReader.h"
+
+// The file begins with the ident, and the rest is a sequence of records,
+// each of which is a type byte and then fields, as below.
+//
+// A name is written once, in a Name record before its first use, and is
+// replaced by a 2-byte identifier everywhere else.  So the file can be
+// written and read in one pass.
+//
+// Integers are little-endian, and numbers are in IEEE format, whatever the
+// machine.  Strings are UTF-8, preceded by their length in bytes, which is
+// 2 bytes for names and 4 bytes for other strings.
+//
+// Numbers are stored as numbers, with the digits of precision that were
+// asked for, so that the conversion to XML gives the same text that
+// XMLFileWriter would have written.
+
+namespace {
+
+enum RecordType : unsigned char
+{
+   RecordName = 1,   // type, ID, name
+   RecordStartTag,   // type, ID
+   RecordEndTag,     // type, ID
+   RecordString,     // type, ID, string
+   RecordInteger,    // type, ID, 8-byte value
+   RecordBool,       // type, ID, 1-byte value
+   RecordFloat,      // type, ID, 4-byte value, 1-byte digits
+   RecordDouble,     // type, ID, 8-byte value, 1-byte digits
+   RecordData,       // type, string
+   RecordRaw,        // type, string
+};
+
+const unsigned IdBytes = 2;
+const unsigned NameLengthBytes = 2;
+const unsigned StringLengthBytes = 4;
+
+const size_t BufferSize = 1 << 20;
+
+///
+/// Input
+///
+
+// Buffered reading of the fields of records
+class Input
+{
+public:
+   explicit Input(wxFFile &file)
+      : mFile{ file }
+      , mBuffer( BufferSize )
+   {}
+
+   bool GetByte(unsigned char &byte)
+   {
+      if (mPos == mEnd && !Refill())
+         return false;
+      byte = mBuffer[mPos++];
+      return true;
+   }
+
+   bool Get(void *dest, size_t bytes)
+   {
+      auto pDest = static_cast<char*>(dest);
+      while (bytes > 0) {
+         if (mPos == mEnd && !Refill())
+            return false;
+         const auto count = std::min(bytes, mEnd - mPos);
+         memcpy(pDest, &mBuffer[mPos], count);
+         mPos += count;
+         pDest += count;
+         bytes -= count;
+      }
+      return true;
+   }
+
+   bool GetInteger(unsigned long long &value, unsigned bytes)
+   {
+      unsigned char data[8];
+      if (!Get(data, bytes))
+         return false;
+      value = 0;
+      while (bytes--)
+         value = (value << 8) | data[bytes];
+      return true;
+   }
+
+private:
+   bool Refill()
+   {
+      mPos = 0;
+      mEnd = mFile.Read(mBuffer.data(), mBuffer.size());
+      return mEnd > 0;
+   }
+
+   wxFFile &mFile;
+   std::vector<unsigned char> mBuffer;
+   size_t mPos {};
+   size_t mEnd {};
+};
+
+bool ReadIdent(wxFFile &file)
+{
+   const auto len = strlen(BinaryXMLIdent);
+   char ident[sizeof(BinaryXMLIdent)];
+   return file.Read(ident, len) == len &&
+      strncmp(ident, BinaryXMLIdent, len) == 0;
+}
+
+// Reads records after the ident and passes them to the sink.  Returns false
+// if the file is damaged.
+template<typename Sink>
+bool Decode(wxFFile &file, Sink &sink)
+{
+   Input in{ file };
+   // A deque, so that the sink may keep references to names while more
+   // are added
+   std::deque<wxString> names;
+   std::vector<char> chars;
+   wxString string;
+
+   auto getString = [&](unsigned lengthBytes) {
+      unsigned long long length;
+      if (!in.GetInteger(length, lengthBytes))
+         return false;
+      chars.resize(length);
+      if (!in.Get(chars.data(), length))
+         return false;
+      string = wxString::FromUTF8(chars.data(), length);
+      return true;
+   };
+
+   const wxString *pName {};
+   auto getName = [&] {
+      unsigned long long id;
+      if (!in.GetInteger(id, IdBytes) || id >= names.size())
+         return false;
+      pName = &names[id];
+      return true;
+   };
+
+   unsigned char type;
+   while (in.GetByte(type)) {
+      switch (type) {
+         case RecordName:
+         {
+            unsigned long long id;
+            if (!in.GetInteger(id, IdBytes) || id != names.size() ||
+                !getString(NameLengthBytes))
+               return false;
+            names.push_back(string);
+         }
+         break;
+
+         case RecordStartTag:
+            if (!getName())
+               return false;
+            sink.StartTag(*pName);
+         break;
+
+         case RecordEndTag:
+            if (!getName())
+               return false;
+            sink.EndTag(*pName);
+         break;
+
+         case RecordString:
+            if (!getName() || !getString(StringLengthBytes))
+               return false;
+            sink.Attr(*pName, string);
+         break;
+
+         case RecordInteger:
+         {
+            unsigned long long value;
+            if (!getName() || !in.GetInteger(value, 8))
+               return false;
+            sink.Attr(*pName, static_cast<long long>(value));
+         }
+         break;
+
+         case RecordBool:
+         {
+            unsigned char value;
+            if (!getName() || !in.GetByte(value))
+               return false;
+            sink.Attr(*pName, value != 0);
+         }
+         break;
+
+         case RecordFloat:
+         {
+            unsigned long long bits;
+            unsigned char digits;
+            if (!getName() || !in.GetInteger(bits, 4) || !in.GetByte(digits))
+               return false;
+            const auto bits32 = static_cast<unsigned int>(bits);
+            float value;
+            memcpy(&value, &bits32, sizeof(value));
+            sink.Attr(*pName, value, static_cast<signed char>(digits));
+         }
+         break;
+
+         case RecordDouble:
+         {
+            unsigned long long bits;
+            unsigned char digits;
+            if (!getName() || !in.GetInteger(bits, 8) || !in.GetByte(digits))
+               return false;
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            sink.Attr(*pName, value, static_cast<signed char>(digits));
+         }
+         break;
+
+         case RecordData:
+            if (!getString(StringLengthBytes))
+               return false;
+            sink.Data(string);
+         break;
+
+         case RecordRaw:
+            if (!getString(StringLengthBytes))
+               return false;
+            sink.Raw(string);
+         break;
+
+         default:
+            return false;
+      }
+   }
+
+   return true;
+}
+
+void FormatInteger(wxString &result, long long value)
+{
+   wxChar digits[24];
+   const auto end = digits + WXSIZEOF(digits);
+   auto p = end;
+   unsigned long long magnitude = value < 0
+      ? 0ull - static_cast<unsigned long long>(value)
+      : value;
+   do {
+      *--p = wxT('0') + magnitude % 10;
+      magnitude /= 10;
+   } while (magnitude);
+   if (value < 0)
+      *--p = wxT('-');
+   result.assign(p, end - p);
+}
+
+// Calls the handlers as XMLFileReader does, collecting the attributes of
+// each tag first.  Strings for names and values are reused.
+class HandlerSink
+{
+public:
+   explicit HandlerSink(XMLTagHandler *baseHandler)
+      : mBaseHandler{ baseHandler }
+   {
+      mHandlers.reserve(128);
+   }
+
+   void StartTag(const wxString &name)
+   {
+      FlushTag();
+      mPendingTag = &name;
+      mnAttrs = 0;
+   }
+
+   void EndTag(const wxString &name)
+   {
+      FlushTag();
+      if (mHandlers.empty())
+         return;
+      if (XMLTagHandler *const handler = mHandlers.back())
+         handler->HandleXMLEndTag(name.wx_str());
+      mHandlers.pop_back();
+   }
+
+   void Attr(const wxString &name, const wxString &value)
+   { NextValue(name) = value; }
+   void Attr(const wxString &name, long long value)
+   { FormatInteger(NextValue(name), value); }
+   void Attr(const wxString &name, bool value)
+   { NextValue(name) = value ? wxT("1") : wxT("0"); }
+   void Attr(const wxString &name, double value, int digits)
+   { NextValue(name) = Internat::ToString(value, digits); }
+
+   void Data(const wxString &value)
+   {
+      FlushTag();
+      if (!mHandlers.empty())
+         if (XMLTagHandler *const handler = mHandlers.back())
+            handler->HandleXMLContent(value);
+   }
+
+   // Only the XML header, which handlers never see
+   void Raw(const wxString &)
+   {
+      FlushTag();
+   }
+
+   // Whether the first-level handler was called and didn't return false
+   bool Finish()
+   {
+      FlushTag();
+      return mBaseHandler != nullptr;
+   }
+
+private:
+   wxString &NextValue(const wxString &name)
+   {
+      if (mnAttrs == mValues.size()) {
+         mValues.emplace_back();
+         mAttrNames.push_back(nullptr);
+      }
+      mAttrNames[mnAttrs] = &name;
+      return mValues[mnAttrs++];
+   }
+
+   void FlushTag()
+   {
+      if (!mPendingTag)
+         return;
+
+      mAttrs.clear();
+      for (size_t ii = 0; ii < mnAttrs; ++ii) {
+         mAttrs.push_back(mAttrNames[ii]->wx_str());
+         mAttrs.push_back(mValues[ii].wx_str());
+      }
+      mAttrs.push_back(nullptr);
+
+      const wxChar *const tag = mPendingTag->wx_str();
+      mPendingTag = nullptr;
+
+      if (mHandlers.empty())
+         mHandlers.push_back(mBaseHandler);
+      else if (XMLTagHandler *const handler = mHandlers.back())
+         mHandlers.push_back(handler->HandleXMLChild(tag));
+      else
+         mHandlers.push_back(nullptr);
+
+      if (XMLTagHandler *&handler = mHandlers.back()) {
+         if (!handler->HandleXMLTag(tag, mAttrs.data())) {
+            handler = nullptr;
+            if (mHandlers.size() == 1)
+               mBaseHandler = nullptr;
+         }
+      }
+   }
+
+   XMLTagHandler *mBaseHandler;
+   std::vector<XMLTagHandler*> mHandlers;
+
+   const wxString *mPendingTag {};
+   size_t mnAttrs {};
+   std::vector<const wxString*> mAttrNames;
+   std::vector<wxString> mValues;
+   std::vector<const wxChar*> mAttrs;
+};
+
+// Repeats the calls that were made on the BinaryXMLWriter
+class WriterSink
+{
+public:
+   explicit WriterSink(XMLWriter &writer)
+      : mWriter{ writer }
+   {}
+
+   void StartTag(const wxString &name) { mWriter.StartTag(name); }
+   void EndTag(const wxString &name) { mWriter.EndTag(name); }
+
+   void Attr(const wxString &name, const wxString &value)
+   { mWriter.WriteAttr(name, value); }
+   void Attr(const wxString &name, long long value)
+   { mWriter.WriteAttr(name, value); }
+   void Attr(const wxString &name, bool value)
+   { mWriter.WriteAttr(name, value); }
+   void Attr(const wxString &name, float value, int digits)
+   { mWriter.WriteAttr(name, value, digits); }
+   void Attr(const wxString &name, double value, int digits)
+   { mWriter.WriteAttr(name, value, digits); }
+
+   void Data(const wxString &value) { mWriter.WriteData(value); }
+   void Raw(const wxString &value) { mWriter.Write(value); }
+
+private:
+   XMLWriter &mWriter;
+};
+
+// Passes everything that XMLFileReader finds to a writer
+class CopyingHandler final : public XMLTagHandler
+{
+public:
+   explicit CopyingHandler(XMLWriter &writer)
+      : mWriter{ writer }
+   {}
+
+   bool HandleXMLTag(const wxChar *tag, const wxChar **attrs) override
+   {
+      FlushContent();
+      mWriter.StartTag(tag);
+      while (*attrs) {
+         const wxChar *attr = *attrs++;
+         const wxChar *value = *attrs++;
+         if (!value)
+            break;
+         mWriter.WriteAttr(attr, value);
+      }
+      return true;
+   }
+
+   void HandleXMLEndTag(const wxChar *tag) override
+   {
+      FlushContent();
+      mWriter.EndTag(tag);
+   }
+
+   void HandleXMLContent(const wxString &content) override
+   {
+      mContent += content;
+   }
+
+   XMLTagHandler *HandleXMLChild(const wxChar *) override
+   {
+      return this;
+   }
+
+private:
+   void FlushContent()
+   {
+      // Whitespace around content is only the layout of the XML
+      mContent.Trim(true).Trim(false);
+      if (!mContent.empty())
+         mWriter.WriteData(mContent);
+      mContent.clear();
+   }
+
+   XMLWriter &mWriter;
+   wxString mContent;
+};
+
+}
+
+///
+/// BinaryXMLWriter
+///
+BinaryXMLWriter::BinaryXMLWriter(XMLFileWriter &file)
+   : mFile{ file }
+// may throw
+{
+   mBuffer.reserve(BufferSize + BufferSize / 4);
+   mFile.WriteBytes(BinaryXMLIdent, strlen(BinaryXMLIdent));
+}
+
+BinaryXMLWriter::~BinaryXMLWriter()
+{
+}
+
+void BinaryXMLWriter::StartTag(const wxString &name)
+// may throw
+{
+   PutName(RecordStartTag, name);
+}
+
+void BinaryXMLWriter::EndTag(const wxString &name)
+// may throw
+{
+   PutName(RecordEndTag, name);
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, const wxString &value)
+// may throw
+{
+   PutName(RecordString, name);
+   PutString(value, StringLengthBytes);
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, const wxChar *value)
+// may throw
+{
+   WriteAttr(name, wxString(value));
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, int value)
+// may throw
+{
+   WriteAttr(name, static_cast<long long>(value));
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, bool value)
+// may throw
+{
+   PutName(RecordBool, name);
+   PutByte(value ? 1 : 0);
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, long value)
+// may throw
+{
+   WriteAttr(name, static_cast<long long>(value));
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, long long value)
+// may throw
+{
+   PutName(RecordInteger, name);
+   PutInteger(static_cast<unsigned long long>(value), 8);
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, size_t value)
+// may throw
+{
+   // XMLWriter also writes size_t as long long
+   WriteAttr(name, static_cast<long long>(value));
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, float value, int digits)
+// may throw
+{
+   PutName(RecordFloat, name);
+   unsigned int bits;
+   static_assert(sizeof(bits) == sizeof(value), "float is not 32 bits");
+   memcpy(&bits, &value, sizeof(bits));
+   PutInteger(bits, 4);
+   PutByte(static_cast<unsigned char>(digits));
+}
+
+void BinaryXMLWriter::WriteAttr(const wxString &name, double value, int digits)
+// may throw
+{
+   PutName(RecordDouble, name);
+   unsigned long long bits;
+   static_assert(sizeof(bits) == sizeof(value), "double is not 64 bits");
+   memcpy(&bits, &value, sizeof(bits));
+   PutInteger(bits, 8);
+   PutByte(static_cast<unsigned char>(digits));
+}
+
+void BinaryXMLWriter::WriteData(const wxString &value)
+// may throw
+{
+   PutByte(RecordData);
+   PutString(value, StringLengthBytes);
+}
+
+void BinaryXMLWriter::WriteSubTree(const wxString &value)
+// may throw
+{
+   Write(value);
+}
+
+void BinaryXMLWriter::Write(const wxString &data)
+// may throw
+{
+   PutByte(RecordRaw);
+   PutString(data, StringLengthBytes);
+}
+
+void BinaryXMLWriter::Flush()
+// may throw
+{
+   mFile.WriteBytes(mBuffer.data(), mBuffer.size());
+   mBuffer.clear();
+}
+
+void BinaryXMLWriter::PutByte(unsigned char byte)
+{
+   mBuffer.push_back(static_cast<char>(byte));
+}
+
+void BinaryXMLWriter::PutInteger(unsigned long long value, unsigned bytes)
+{
+   while (bytes--) {
+      mBuffer.push_back(static_cast<char>(value & 0xff));
+      value >>= 8;
+   }
+}
+
+void BinaryXMLWriter::PutString(const wxString &value, unsigned lengthBytes)
+{
+   const auto utf8 = value.utf8_str();
+   const size_t length = utf8.length();
+   if (lengthBytes < 8 && (length >> (8 * lengthBytes)) != 0)
+      THROW_INCONSISTENCY_EXCEPTION;
+   PutInteger(length, lengthBytes);
+   mBuffer.insert(mBuffer.end(), utf8.data(), utf8.data() + length);
+}
+
+void BinaryXMLWriter::PutName(unsigned char type, const wxString &name)
+// may throw
+{
+   // Begin each record that has a name with a check of the buffer, so that
+   // the buffer does not grow much past its size
+   if (mBuffer.size() >= BufferSize)
+      Flush();
+
+   auto iter = mNames.find(name);
+   if (iter == mNames.end()) {
+      if (mNames.size() > 0xffff)
+         THROW_INCONSISTENCY_EXCEPTION;
+      const auto id = static_cast<unsigned short>(mNames.size());
+      iter = mNames.emplace(name, id).first;
+      PutByte(RecordName);
+      PutInteger(id, IdBytes);
+      PutString(name, NameLengthBytes);
+   }
+
+   PutByte(type);
+   PutInteger(iter->second, IdBytes);
+}
+
+// static
+bool BinaryXMLWriter::ConvertFromXML(
+   const wxString &xmlFileName, const wxString &binaryFileName)
+{
+   return GuardedCall< bool >( [&] {
+      XMLFileWriter file{ binaryFileName, _("Error Converting File") };
+      BinaryXMLWriter writer{ file };
+      // The reader does not report the header, so supply the usual one
+      writer.Write(wxT("<?xml version=\"1.0\" standalone=\"no\" ?>\n"));
+
+      CopyingHandler handler{ writer };
+      XMLFileReader reader;
+      if (!reader.Parse(&handler, xmlFileName))
+         return false;
+
+      writer.Flush();
+      file.Commit();
+      return true;
+   } );
+}
+
+///
+/// BinaryXMLFileReader
+///
+BinaryXMLFileReader::BinaryXMLFileReader()
+{
+}
+
+BinaryXMLFileReader::~BinaryXMLFileReader()
+{
+}
+
+bool BinaryXMLFileReader::Parse(
+   XMLTagHandler *baseHandler, const wxString &fileName)
+{
+   wxFFile file(fileName, wxT("rb"));
+   if (!file.IsOpened()) {
+      mErrorStr.Printf(_("Could not open file: \"%s\""), fileName);
+      return false;
+   }
+
+   HandlerSink sink{ baseHandler };
+   if (!ReadIdent(file) || !Decode(file, sink)) {
+      mErrorStr.Printf(_("File may be invalid or corrupted: \"%s\""), fileName);
+      return false;
+   }
+
+   // As for XMLFileReader, succeed only if the first-level handler was
+   // actually called, and didn't return false
+   if (!sink.Finish()) {
+      mErrorStr.Printf(_("Could not load file: \"%s\""), fileName);
+      return false;
+   }
+
+   return true;
+}
+
+// static
+bool BinaryXMLFileReader::IsBinaryFile(const wxString &fileName)
+{
+   wxFFile file(fileName, wxT("rb"));
+   return file.IsOpened() && ReadIdent(file);
+}
+
+// static
+bool BinaryXMLFileReader::ConvertToXML(
+   const wxString &binaryFileName, const wxString &xmlFileName)
+{
+   wxFFile file(binaryFileName, wxT("rb"));
+   if (!file.IsOpened() || !ReadIdent(file))
+      return false;
+
+   return GuardedCall< bool >( [&] {
+      XMLFileWriter out{ xmlFileName, _("Error Converting File") };
+      WriterSink sink{ out };
+      if (!Decode(file, sink))
+         return false;
+      out.Commit();
+      return true;
+   } );
+}
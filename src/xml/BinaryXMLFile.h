@@ -0,0 +1,112 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BinaryXMLFile.h
+
+  Audacity(R) is copyright (c) 1999-2018 Audacity Team.
+  License: GPL v2.  See License.txt.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_XML_BINARY_XML_FILE__
+#define __AUDACITY_XML_BINARY_XML_FILE__
+
+#include <unordered_map>
+#include <vector>
+
+#include "XMLTagHandler.h"
+#include "XMLWriter.h"
+
+// Begins every binary file.  Should be plain ASCII, and begin like XML
+// so that the file is recognized as a project.
+#define BinaryXMLIdent "<?xml binary 1>"
+
+///
+/// BinaryXMLWriter
+///
+
+/// Encodes the calls of an XMLWriter compactly, keeping numbers in binary
+/// and each element or attribute name only once, and writes the result to
+/// an XMLFileWriter, which then Commit()s the file as usual.
+/// Might throw, as XMLFileWriter does.
+class AUDACITY_DLL_API BinaryXMLWriter final : public XMLWriter {
+
+ public:
+
+   /// Writes the ident at once
+   explicit BinaryXMLWriter(XMLFileWriter &file);
+   virtual ~BinaryXMLWriter();
+
+   void StartTag(const wxString &name) override;
+   void EndTag(const wxString &name) override;
+
+   void WriteAttr(const wxString &name, const wxString &value) override;
+   void WriteAttr(const wxString &name, const wxChar *value) override;
+
+   void WriteAttr(const wxString &name, int value) override;
+   void WriteAttr(const wxString &name, bool value) override;
+   void WriteAttr(const wxString &name, long value) override;
+   void WriteAttr(const wxString &name, long long value) override;
+   void WriteAttr(const wxString &name, size_t value) override;
+   void WriteAttr(const wxString &name, float value, int digits = -1) override;
+   void WriteAttr(const wxString &name, double value, int digits = -1) override;
+
+   void WriteData(const wxString &value) override;
+
+   void WriteSubTree(const wxString &value) override;
+
+   /// Text such as the XML header, kept only for conversion back to XML
+   void Write(const wxString &data) override;
+
+   /// Pass everything so far to the file.  Do this before committing it.
+   void Flush();
+
+   /// Make a binary file with the same elements, attributes and content as
+   /// an XML file.  Returns false if the XML can't be parsed or the binary
+   /// file can't be written; errors in writing are also shown to the user.
+   static bool ConvertFromXML(
+      const wxString &xmlFileName, const wxString &binaryFileName);
+
+ private:
+   void PutByte(unsigned char byte);
+   void PutInteger(unsigned long long value, unsigned bytes);
+   void PutString(const wxString &value, unsigned lengthBytes);
+   void PutName(unsigned char type, const wxString &name);
+
+   XMLFileWriter &mFile;
+   std::vector<char> mBuffer;
+   std::unordered_map<wxString, unsigned short> mNames;
+};
+
+///
+/// BinaryXMLFileReader
+///
+
+/// Reads a file that BinaryXMLWriter made and passes the results through
+/// an XMLTagHandler, just as XMLFileReader does for XML, but without
+/// parsing any text.
+class AUDACITY_DLL_API BinaryXMLFileReader final {
+
+ public:
+   BinaryXMLFileReader();
+   ~BinaryXMLFileReader();
+
+   bool Parse(XMLTagHandler *baseHandler, const wxString &fileName);
+
+   wxString GetErrorStr() const { return mErrorStr; }
+
+   /// Whether the file begins with BinaryXMLIdent
+   static bool IsBinaryFile(const wxString &fileName);
+
+   /// Make an XML file that is the same as what was given to the
+   /// BinaryXMLWriter.  Returns false if the binary file is damaged or the
+   /// XML can't be written; errors in writing are also shown to the user.
+   static bool ConvertToXML(
+      const wxString &binaryFileName, const wxString &xmlFileName);
+
+ private:
+   wxString mErrorStr;
+};
+
+#endif
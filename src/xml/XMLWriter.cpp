@@ -29,9 +29,11 @@ the general functionality for creating XML in UTF8 encoding.
 #include <wx/ffile.h>
 #include <wx/intl.h>
 
+#include <stdio.h>
 #include <string.h>
 
 #include "../Internat.h"
+#include "../MemoryX.h"
 #include "XMLWriter.h"
 
 //table for xml encoding compatibility with expat decoding
@@ -60,6 +62,174 @@ static int charXMLCompatiblity[] =
 #define NONCHARACTER_FFFE static_cast<wxUChar>(0xFFFE)
 #define NONCHARACTER_FFFF static_cast<wxUChar>(0xFFFF)
 
+namespace {
+
+// Append one code point in UTF-8
+inline void AppendCodePoint(std::string &out, unsigned long c)
+{
+   if (c < 0x80)
+      out += static_cast<char>(c);
+   else if (c < 0x800) {
+      out += static_cast<char>(0xC0 | (c >> 6));
+      out += static_cast<char>(0x80 | (c & 0x3F));
+   }
+   else if (c < 0x10000) {
+      out += static_cast<char>(0xE0 | (c >> 12));
+      out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (c & 0x3F));
+   }
+   else {
+      out += static_cast<char>(0xF0 | (c >> 18));
+      out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (c & 0x3F));
+   }
+}
+
+// Append text in UTF-8 without escaping it, combining surrogate pairs
+// where wxUChar is 2 bytes
+void AppendUTF8(std::string &out, const wxString &s)
+{
+   const auto end = s.end();
+   for (auto it = s.begin(); it != end; ++it) {
+      const wxUChar c = (*it).GetValue();
+      if (c < 0x80)
+         out += static_cast<char>(c);
+      else if (sizeof(c) == 2 &&
+               c >= MIN_HIGH_SURROGATE && c <= MAX_HIGH_SURROGATE &&
+               it + 1 != end) {
+         const wxUChar c2 = (*(it + 1)).GetValue();
+         if (c2 >= MIN_LOW_SURROGATE && c2 <= MAX_LOW_SURROGATE) {
+            ++it;
+            AppendCodePoint(out,
+               0x10000 + ((c - MIN_HIGH_SURROGATE) << 10) +
+                  (c2 - MIN_LOW_SURROGATE));
+         }
+         else
+            AppendCodePoint(out, c);
+      }
+      else
+         AppendCodePoint(out, c);
+   }
+}
+
+void AppendInteger(std::string &out, long long value)
+{
+   // Digits are made from the end
+   char buffer[24];
+   char *const end = buffer + sizeof buffer;
+   char *p = end;
+   unsigned long long magnitude = value < 0
+      ? 0ULL - static_cast<unsigned long long>(value)
+      : static_cast<unsigned long long>(value);
+   do {
+      *--p = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+   } while (magnitude);
+   if (value < 0)
+      *--p = '-';
+   out.append(p, end - p);
+}
+
+// The same text as Internat::ToString(), without making wxStrings
+void AppendDouble(std::string &out, double value, int digits)
+{
+   char buffer[512];
+   const int length = (digits == -1)
+      ? snprintf(buffer, sizeof buffer, "%f", value)
+      : snprintf(buffer, sizeof buffer, "%.*f", digits, value);
+   if (length < 0 || length >= (int)sizeof buffer) {
+      AppendUTF8(out, Internat::ToString(value, digits));
+      return;
+   }
+
+   // The C library may have used the locale's separator; always use a dot
+   int point = -1;
+   for (int i = 0; i < length; ++i) {
+      const char c = buffer[i];
+      if (!(c >= '0' && c <= '9') && c != '-' &&
+          !(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z')) {
+         buffer[i] = '.';
+         point = i;
+      }
+   }
+
+   int last = length - 1;
+   if (digits == -1 && point >= 0) {
+      // Strip trailing zeros, but leave one, and decimal separator.
+      while (last > 1 && buffer[last] == '0' && buffer[last - 1] != '.')
+         --last;
+   }
+
+   out.append(buffer, last + 1);
+}
+
+// See http://www.w3.org/TR/REC-xml for reference
+void AppendEscaped(std::string &out, const wxString &s)
+{
+   const auto end = s.end();
+   for (auto it = s.begin(); it != end; ++it) {
+      const wxUChar c = (*it).GetValue();
+
+      // Most text is plain ASCII; copy that at once
+      if (c >= 0x20 && c < 0x7F) {
+         switch (c) {
+            case wxT('\''):
+               out += "&apos;";
+               break;
+            case wxT('"'):
+               out += "&quot;";
+               break;
+            case wxT('&'):
+               out += "&amp;";
+               break;
+            case wxT('<'):
+               out += "&lt;";
+               break;
+            case wxT('>'):
+               out += "&gt;";
+               break;
+            default:
+               out += static_cast<char>(c);
+               break;
+         }
+      }
+      else if (sizeof(c) == 2 && c >= MIN_HIGH_SURROGATE && c <= MAX_HIGH_SURROGATE && it + 1 != end) {
+         // If wxUChar is 2 bytes, then supplementary characters (those greater than U+FFFF) are represented
+         // with a high surrogate (U+D800..U+DBFF) followed by a low surrogate (U+DC00..U+DFFF).
+         // Handle those here.
+         const wxUChar c2 = (*(it + 1)).GetValue();
+         if (c2 >= MIN_LOW_SURROGATE && c2 <= MAX_LOW_SURROGATE) {
+            // Surrogate pair found; simply add it to the output string.
+            ++it;
+            AppendCodePoint(out,
+               0x10000 + ((c - MIN_HIGH_SURROGATE) << 10) +
+                  (c2 - MIN_LOW_SURROGATE));
+         }
+         // else that high surrogate isn't paired, so ignore it.
+      }
+      else if (!wxIsprint(c)) {
+         //ignore several characters such ase eot (0x04) and stx (0x02) because it makes expat parser bail
+         //see xmltok.c in expat checkCharRefNumber() to see how expat bails on these chars.
+         //also see wxWidgets-2.8.12/src/expat/lib/asciitab.h to see which characters are nonxml compatible
+         //post decode (we can still encode '&' and '<' with this table, but it prevents us from encoding eot)
+         //everything is compatible past ascii 0x20 except for surrogates and the noncharacters U+FFFE and U+FFFF,
+         //so we don't check the compatibility table higher than this.
+         if((c> 0x1F || charXMLCompatiblity[c]!=0) &&
+               (c < MIN_HIGH_SURROGATE || c > MAX_LOW_SURROGATE) &&
+               c != NONCHARACTER_FFFE && c != NONCHARACTER_FFFF) {
+            char entity[16];
+            const int length =
+               snprintf(entity, sizeof entity, "&#x%04lx;", (unsigned long)c);
+            out.append(entity, length);
+         }
+      }
+      else
+         AppendCodePoint(out, c);
+   }
+}
+
+}
 
 ///
 /// XMLWriter base class
@@ -75,65 +245,100 @@ XMLWriter::~XMLWriter()
 {
 }
 
+void XMLWriter::WriteUTF8(const char *data, size_t length)
+// may throw from Write()
+{
+   Write(wxString::FromUTF8(data, length));
+}
+
+void XMLWriter::AppendText(const wxString &data)
+{
+   AppendUTF8(mText, data);
+}
+
+void XMLWriter::FlushText()
+// may throw from WriteUTF8()
+{
+   if (!mText.empty()) {
+      // Keep the capacity for reuse
+      auto cleanup = finally( [&]{ mText.clear(); } );
+      WriteUTF8(mText.data(), mText.size());
+   }
+}
+
+void XMLWriter::AppendIndent(int depth)
+{
+   if (depth > 0)
+      mText.append(depth, '\t');
+}
+
+void XMLWriter::AppendAttrName(const wxString &name)
+{
+   mText += ' ';
+   AppendUTF8(mText, name);
+   mText += "=\"";
+}
+
 void XMLWriter::StartTag(const wxString &name)
 // may throw
 {
-   int i;
-
    if (mInTag) {
-      Write(wxT(">\n"));
+      mText += ">\n";
       mInTag = false;
    }
 
-   for (i = 0; i < mDepth; i++) {
-      Write(wxT("\t"));
-   }
+   AppendIndent(mDepth);
 
-   Write(wxString::Format(wxT("<%s"), name));
+   mText += '<';
+   AppendUTF8(mText, name);
 
-   mTagstack.Insert(name, 0);
-   mHasKids[0] = true;
-   mHasKids.insert(mHasKids.begin(), false);
+   mTagstack.push_back(name);
+   mHasKids.back() = true;
+   mHasKids.push_back(false);
    mDepth++;
    mInTag = true;
+
+   FlushIfFull();
 }
 
 void XMLWriter::EndTag(const wxString &name)
 // may throw
 {
-   int i;
-
-   if (mTagstack.GetCount() > 0) {
-      if (mTagstack[0] == name) {
-         if (mHasKids[1]) {  // There will always be at least 2 at this point
+   if (mTagstack.size() > 0) {
+      if (mTagstack.back() == name) {
+         // There will always be at least 2 at this point
+         if (mHasKids[mHasKids.size() - 2]) {
             if (mInTag) {
-               Write(wxT("/>\n"));
+               mText += "/>\n";
             }
             else {
-               for (i = 0; i < mDepth - 1; i++) {
-                  Write(wxT("\t"));
-               }
-               Write(wxString::Format(wxT("</%s>\n"), name));
+               AppendIndent(mDepth - 1);
+               mText += "</";
+               AppendUTF8(mText, name);
+               mText += ">\n";
             }
          }
          else {
-            Write(wxT(">\n"));
+            mText += ">\n";
          }
-         mTagstack.RemoveAt(0);
-         mHasKids.erase(mHasKids.begin());
+         mTagstack.pop_back();
+         mHasKids.pop_back();
       }
    }
 
    mDepth--;
    mInTag = false;
+
+   FlushIfFull();
 }
 
 void XMLWriter::WriteAttr(const wxString &name, const wxString &value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%s\""),
-      name,
-      XMLEsc(value)));
+   AppendAttrName(name);
+   AppendEscaped(mText, value);
+   mText += '"';
+   FlushIfFull();
 }
 
 void XMLWriter::WriteAttr(const wxString &name, const wxChar *value)
@@ -145,149 +350,77 @@ void XMLWriter::WriteAttr(const wxString &name, const wxChar *value)
 void XMLWriter::WriteAttr(const wxString &name, int value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%d\""),
-      name,
-      value));
+   WriteAttr(name, (long long) value);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, bool value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%d\""),
-      name,
-      value));
+   WriteAttr(name, (long long) value);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, long value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%ld\""),
-      name,
-      value));
+   WriteAttr(name, (long long) value);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, long long value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%lld\""),
-      name,
-      value));
+   AppendAttrName(name);
+   AppendInteger(mText, value);
+   mText += '"';
+   FlushIfFull();
 }
 
 void XMLWriter::WriteAttr(const wxString &name, size_t value)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%lld\""),
-      name,
-      (long long) value));
+   WriteAttr(name, (long long) value);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, float value, int digits)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%s\""),
-      name,
-      Internat::ToString(value, digits)));
+   WriteAttr(name, (double) value, digits);
 }
 
 void XMLWriter::WriteAttr(const wxString &name, double value, int digits)
 // may throw from Write()
 {
-   Write(wxString::Format(wxT(" %s=\"%s\""),
-      name,
-      Internat::ToString(value, digits)));
+   AppendAttrName(name);
+   AppendDouble(mText, value, digits);
+   mText += '"';
+   FlushIfFull();
 }
 
 void XMLWriter::WriteData(const wxString &value)
 // may throw from Write()
 {
-   int i;
-
-   for (i = 0; i < mDepth; i++) {
-      Write(wxT("\t"));
-   }
-
-   Write(XMLEsc(value));
+   AppendIndent(mDepth);
+   AppendEscaped(mText, value);
+   FlushIfFull();
 }
 
 void XMLWriter::WriteSubTree(const wxString &value)
 // may throw from Write()
 {
    if (mInTag) {
-      Write(wxT(">\n"));
+      mText += ">\n";
       mInTag = false;
-      mHasKids[0] = true;
+      mHasKids.back() = true;
    }
 
-   Write(value);
+   AppendUTF8(mText, value);
+   FlushIfFull();
 }
 
-// See http://www.w3.org/TR/REC-xml for reference
 wxString XMLWriter::XMLEsc(const wxString & s)
 {
-   wxString result;
-   int len = s.Length();
-
-   for(int i=0; i<len; i++) {
-      wxUChar c = s.GetChar(i);
-
-      switch (c) {
-         case wxT('\''):
-            result += wxT("&apos;");
-         break;
-
-         case wxT('"'):
-            result += wxT("&quot;");
-         break;
-
-         case wxT('&'):
-            result += wxT("&amp;");
-         break;
-
-         case wxT('<'):
-            result += wxT("&lt;");
-         break;
-
-         case wxT('>'):
-            result += wxT("&gt;");
-         break;
-
-         default:
-            if (sizeof(c) == 2 && c >= MIN_HIGH_SURROGATE && c <= MAX_HIGH_SURROGATE && i < len - 1) {
-               // If wxUChar is 2 bytes, then supplementary characters (those greater than U+FFFF) are represented
-               // with a high surrogate (U+D800..U+DBFF) followed by a low surrogate (U+DC00..U+DFFF).
-               // Handle those here.
-               wxUChar c2 = s.GetChar(++i);
-               if (c2 >= MIN_LOW_SURROGATE && c2 <= MAX_LOW_SURROGATE) {
-                  // Surrogate pair found; simply add it to the output string.
-                  result += c;
-                  result += c2;
-               }
-               else {
-                  // That high surrogate isn't paired, so ignore it.
-                  i--;
-               }
-            }
-            else if (!wxIsprint(c)) {
-               //ignore several characters such ase eot (0x04) and stx (0x02) because it makes expat parser bail
-               //see xmltok.c in expat checkCharRefNumber() to see how expat bails on these chars.
-               //also see wxWidgets-2.8.12/src/expat/lib/asciitab.h to see which characters are nonxml compatible
-               //post decode (we can still encode '&' and '<' with this table, but it prevents us from encoding eot)
-               //everything is compatible past ascii 0x20 except for surrogates and the noncharacters U+FFFE and U+FFFF,
-               //so we don't check the compatibility table higher than this.
-               if((c> 0x1F || charXMLCompatiblity[c]!=0) &&
-                     (c < MIN_HIGH_SURROGATE || c > MAX_LOW_SURROGATE) &&
-                     c != NONCHARACTER_FFFE && c != NONCHARACTER_FFFF)
-                  result += wxString::Format(wxT("&#x%04x;"), c);
-            }
-            else {
-               result += c;
-            }
-         break;
-      }
-   }
-
-   return result;
+   std::string result;
+   AppendEscaped(result, s);
+   return wxString::FromUTF8(result.data(), result.size());
 }
 
 ///
@@ -300,6 +433,9 @@ XMLFileWriter::XMLFileWriter
    , mKeepBackup{ keepBackup }
 // may throw
 {
+   // Text is formatted in memory and written in large pieces
+   mFlushSize = 1024 * 1024;
+
    auto tempPath = wxFileName::CreateTempFileName( outputPath );
    if (!wxFFile::Open(tempPath, wxT("wb")) || !IsOpened())
       ThrowException( tempPath, mCaption );
@@ -349,8 +485,8 @@ void XMLFileWriter::Commit()
 void XMLFileWriter::PreCommit()
 // may throw
 {
-   while (mTagstack.GetCount()) {
-      EndTag(mTagstack[0]);
+   while (mTagstack.size()) {
+      EndTag(mTagstack.back());
    }
 
    CloseWithoutEndingTags();
@@ -386,6 +522,8 @@ void XMLFileWriter::PostCommit()
 void XMLFileWriter::CloseWithoutEndingTags()
 // may throw
 {
+   FlushText();
+
    // Before closing, we first flush it, because if Flush() fails because of a
    // "disk full" condition, we can still at least try to close the file.
    if (!wxFFile::Flush())
@@ -402,7 +540,27 @@ void XMLFileWriter::CloseWithoutEndingTags()
 void XMLFileWriter::Write(const wxString &data)
 // may throw
 {
-   if (!wxFFile::Write(data, wxConvUTF8) || Error())
+   AppendText(data);
+   FlushIfFull();
+}
+
+void XMLFileWriter::WriteBytes(const void *data, size_t bytes)
+// may throw
+{
+   FlushText();
+   WriteToFile(data, bytes);
+}
+
+void XMLFileWriter::WriteUTF8(const char *data, size_t length)
+// may throw
+{
+   WriteToFile(data, length);
+}
+
+void XMLFileWriter::WriteToFile(const void *data, size_t bytes)
+// may throw
+{
+   if (bytes > 0 && (wxFFile::Write(data, bytes) != bytes || Error()))
    {
       // When writing fails, we try to close the file before throwing the
       // exception, so it can at least be deleted.
@@ -10,6 +10,7 @@
 #ifndef __AUDACITY_XML_XML_FILE_WRITER__
 #define __AUDACITY_XML_XML_FILE_WRITER__
 
+#include <string>
 #include <vector>
 #include <wx/arrstr.h>
 #include <wx/ffile.h>
@@ -52,11 +53,36 @@ class AUDACITY_DLL_API XMLWriter /* not final */ {
 
  protected:
 
+   /// The methods above format their text into one reused UTF-8 buffer,
+   /// which is passed here whenever it holds more than mFlushSize bytes.
+   /// The default converts it for Write().  May throw.
+   virtual void WriteUTF8(const char *data, size_t length);
+
+   /// Append to the buffer, in order with the formatted text
+   void AppendText(const wxString &data);
+
+   /// Pass the buffer to WriteUTF8() if it is full enough.  May throw.
+   void FlushIfFull() { if (mText.size() > mFlushSize) FlushText(); }
+
+   /// Pass the buffer to WriteUTF8() at once.  May throw.
+   void FlushText();
+
+   /// Zero, unless a subclass prefers fewer and larger writes
+   size_t mFlushSize{ 0 };
+
    bool mInTag;
    int mDepth;
-   wxArrayString mTagstack;
+   // Innermost last
+   std::vector<wxString> mTagstack;
    std::vector<int> mHasKids;
 
+ private:
+
+   void AppendIndent(int depth);
+   void AppendAttrName(const wxString &name);
+
+   std::string mText;
+
 };
 
 ///
@@ -96,9 +122,13 @@ class AUDACITY_DLL_API XMLFileWriter final : private wxFFile, public XMLWriter {
    /// of space, but might for other reasons
    void PostCommit();
 
-   /// Write to file. Might throw.
+   /// Write to file, after the text formatted so far.  Might throw.
    void Write(const wxString &data) override;
 
+   /// Write bytes unchanged, for encodings other than XML text.
+   /// Might throw.
+   void WriteBytes(const void *data, size_t bytes);
+
    wxString GetBackupName() const { return mBackupName; }
 
  private:
@@ -109,6 +139,11 @@ class AUDACITY_DLL_API XMLFileWriter final : private wxFFile, public XMLWriter {
       throw FileException{ FileException::Cause::Write, fileName, caption };
    }
 
+   void WriteUTF8(const char *data, size_t length) override;
+
+   /// Might throw.
+   void WriteToFile(const void *data, size_t bytes);
+
    /// Close file without automatically ending tags.
    /// Might throw.
    void CloseWithoutEndingTags(); // for auto-save files
@@ -0,0 +1,222 @@
+
+// Times the storage layer:  appending to a Sequence, reading it across
+// block boundaries, pasting and deleting at several block counts, drawing
+// at many zoom levels, and writing and reading SimpleBlockFiles of each
+// sample format.  Prints JSON to stdout, so that runs may be compared.
+//
+// Usage:  SequenceBenchmark [repetitions]
+//
+// Each case reports the best of the repetitions, which is the least
+// disturbed by the rest of the system.  Reads that follow writes find the
+// files in the operating system's cache.
+
+#include "Sequence.h"
+#include "DirManager.h"
+#include "blockfile/SimpleBlockFile.h"
+#include <wx/init.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Small blocks, so that many of them fit on a test machine's disk
+const size_t BenchmarkDiskBlockSize = 64 * 1024;
+
+const size_t BlockCounts[] = { 16, 128, 1024 };
+const size_t ReadLengths[] = { 512, 4096, 65536 };
+const double SamplesPerPixel[] = { 1, 4, 16, 64, 256, 1024, 4096, 65536 };
+const size_t DisplayColumns = 1920;
+
+const sampleFormat Formats[] = { int16Sample, int24Sample, floatSample };
+
+class JsonResults
+{
+public:
+   JsonResults() { std::cout << "{\n  \"results\": ["; }
+   ~JsonResults() { std::cout << "\n  ]\n}\n"; }
+
+   // seconds for one operation on count samples
+   void Add(const std::string &name, const std::string &format,
+            size_t blocks, double seconds, double count)
+   {
+      std::cout << (mFirst ? "\n" : ",\n")
+         << "    { \"name\": \"" << name << "\""
+         << ", \"format\": \"" << format << "\""
+         << ", \"blocks\": " << blocks
+         << ", \"seconds\": " << seconds
+         << ", \"samplesPerSecond\": " << (seconds > 0 ? count / seconds : 0)
+         << " }";
+      mFirst = false;
+   }
+
+private:
+   bool mFirst{ true };
+};
+
+std::string FormatName(sampleFormat format)
+{
+   switch (format) {
+      case int16Sample: return "int16";
+      case int24Sample: return "int24";
+      default: return "float";
+   }
+}
+
+// Best of the repetitions of f, in seconds
+template<typename F> double Time(int repetitions, const F &f)
+{
+   double best = -1;
+   for (int ii = 0; ii < repetitions; ++ii) {
+      const auto start = Clock::now();
+      f();
+      const std::chrono::duration<double> elapsed = Clock::now() - start;
+      if (best < 0 || elapsed.count() < best)
+         best = elapsed.count();
+   }
+   return best;
+}
+
+// Noise that differs from block to block, so that DirManager finds no
+// identical blocks to share
+void FillNoise(SampleBuffer &buffer, sampleFormat format, size_t len,
+               unsigned &seed)
+{
+   Floats floats{ len };
+   for (size_t ii = 0; ii < len; ++ii) {
+      seed = seed * 1664525u + 1013904223u;
+      floats[ii] = (seed >> 8) / float(1 << 23) - 1.0f;
+   }
+   CopySamples((samplePtr)floats.get(), floatSample,
+      buffer.ptr(), format, len);
+}
+
+std::unique_ptr<Sequence> MakeSequence(
+   const std::shared_ptr<DirManager> &dirManager, sampleFormat format,
+   size_t blocks, unsigned &seed)
+{
+   auto sequence = std::make_unique<Sequence>(dirManager, format);
+   const auto len = sequence->GetMaxBlockSize();
+   SampleBuffer buffer{ len, format };
+   for (size_t ii = 0; ii < blocks; ++ii) {
+      FillNoise(buffer, format, len, seed);
+      sequence->Append(buffer.ptr(), format, len);
+   }
+   return sequence;
+}
+
+void BenchmarkSequence(JsonResults &results,
+   const std::shared_ptr<DirManager> &dirManager, sampleFormat format,
+   int repetitions)
+{
+   const auto name = FormatName(format);
+   unsigned seed = 1;
+
+   for (auto blocks : BlockCounts) {
+      std::unique_ptr<Sequence> sequence;
+      const auto appendSeconds = Time(repetitions, [&]{
+         sequence = MakeSequence(dirManager, format, blocks, seed);
+      });
+      const auto blockLen = sequence->GetMaxBlockSize();
+      results.Add("Sequence::Append", name, blocks, appendSeconds,
+         double(blocks * blockLen));
+
+      // Reads that straddle a block boundary in the middle
+      const auto boundary = sequence->GetNumSamples() / 2;
+      for (auto len : ReadLengths) {
+         SampleBuffer buffer{ len, floatSample };
+         const auto start = std::max<sampleCount>(0, boundary - len / 2);
+         const auto seconds = Time(repetitions, [&]{
+            sequence->Get(buffer.ptr(), floatSample, start, len, true);
+         });
+         results.Add("Sequence::Get/" + std::to_string(len), name, blocks,
+            seconds, double(len));
+      }
+
+      // Paste a block's worth into the middle, then delete it again
+      const auto clip = sequence->Copy(0, blockLen);
+      const auto pasteSeconds = Time(repetitions, [&]{
+         sequence->Paste(boundary, clip.get());
+         sequence->Delete(boundary, blockLen);
+      });
+      results.Add("Sequence::Paste+Delete", name, blocks, pasteSeconds,
+         double(blockLen));
+
+      // One screen's width of columns, at each zoom, from the start
+      Floats min{ DisplayColumns }, max{ DisplayColumns }, rms{ DisplayColumns };
+      ArrayOf<int> bl{ DisplayColumns };
+      ArrayOf<sampleCount> where{ DisplayColumns + 1 };
+      for (auto spp : SamplesPerPixel) {
+         const auto total = sequence->GetNumSamples().as_double();
+         const auto columns =
+            std::min<size_t>(DisplayColumns, std::max(1.0, total / spp));
+         for (size_t ii = 0; ii <= columns; ++ii)
+            where[ii] = sampleCount(std::min(total, ii * spp));
+         const auto seconds = Time(repetitions, [&]{
+            sequence->GetWaveDisplay(min.get(), max.get(), rms.get(),
+               bl.get(), columns, where.get());
+         });
+         results.Add("Sequence::GetWaveDisplay/" +
+               std::to_string(int(spp)), name, blocks,
+            seconds, where[columns].as_double());
+      }
+   }
+}
+
+void BenchmarkBlockFiles(JsonResults &results,
+   const std::shared_ptr<DirManager> &dirManager, sampleFormat format,
+   int repetitions)
+{
+   const auto name = FormatName(format);
+   const auto len = BenchmarkDiskBlockSize / SAMPLE_SIZE(format);
+   SampleBuffer data{ len, format };
+   unsigned seed = 2;
+
+   BlockFilePtr blockFile;
+   const auto writeSeconds = Time(repetitions, [&]{
+      // New content each time, so that each write really writes
+      FillNoise(data, format, len, seed);
+      blockFile = dirManager->NewSimpleBlockFile(data.ptr(), len, format);
+   });
+   results.Add("SimpleBlockFile::Write", name, 1, writeSeconds, double(len));
+
+   SampleBuffer buffer{ len, format };
+   const auto readSeconds = Time(repetitions, [&]{
+      blockFile->ReadData(buffer.ptr(), format, 0, len, true);
+   });
+   results.Add("SimpleBlockFile::ReadData", name, 1, readSeconds, double(len));
+
+   // Ranges that the 256-sample summaries answer, with unaligned ends
+   // read from the samples
+   const auto summarySeconds = Time(repetitions, [&]{
+      for (size_t start = 100; start + 1000 < len; start += 1000)
+         blockFile->GetMinMaxRMS(start, 1000, true);
+   });
+   results.Add("SimpleBlockFile::GetMinMaxRMS", name, 1, summarySeconds,
+      double(len));
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   wxInitializer initializer;
+   const int repetitions = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+
+   DirManager::SetTempDir("/tmp/sequence-benchmark-dir");
+   Sequence::SetMaxDiskBlockSize(BenchmarkDiskBlockSize);
+   auto dirManager = std::make_shared<DirManager>();
+
+   JsonResults results;
+   for (auto format : Formats)
+      BenchmarkSequence(results, dirManager, format, repetitions);
+   for (auto format : Formats)
+      BenchmarkBlockFiles(results, dirManager, format, repetitions);
+
+   return 0;
+}